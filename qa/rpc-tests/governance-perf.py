@@ -0,0 +1,304 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Dash Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+import hashlib
+import json
+import os
+from time import time, sleep
+
+from test_framework.ipfs import MockIPFSConfiguration, MockIPFSDaemon
+from test_framework.test_framework import HistoriaTestFramework, MasternodeInfo
+from test_framework.util import *
+
+'''
+governance-perf.py
+
+Load test for governance records, proposals and IPFS pinning.
+
+Floods a network of pinning masternodes with proposals and records, runs
+rounds of vote-many and measures:
+- acceptance latency: from "gobject submit" until every node knows the object
+- pin latency: from "gobject submit" until every masternode pinned the object
+- vote latency: from "gobject vote-many" until every node counted all votes
+- governance sync time of a fresh node
+- memory (VmRSS) of every node
+
+The IPFS daemon is mocked by test_framework/ipfs.py unless --ipfsapi points to
+a real one. Results are written as JSON to --results. This is a benchmark,
+not a pass/fail test, and is not part of the default test list.
+'''
+
+PINNING_COLLATERAL = 5000
+GOVERNANCE_FEE_CONFIRMATIONS = 6
+
+base58chars = '123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz'
+
+def make_ipfs_id(seed):
+    """A CID v0 shaped id ("Qm" followed by 44 base58 characters) derived from seed"""
+    n = int.from_bytes(hashlib.sha256(seed.encode('utf8')).digest(), 'big')
+    chars = []
+    for i in range(44):
+        n, r = divmod(n, 58)
+        chars.append(base58chars[r])
+    return 'Qm' + ''.join(chars)
+
+def summarize(values):
+    if not values:
+        return None
+    values = sorted(values)
+    return {
+        'count': len(values),
+        'min': values[0],
+        'median': values[len(values) // 2],
+        'p90': values[min(len(values) - 1, int(len(values) * 0.9))],
+        'max': values[-1],
+        'mean': sum(values) / len(values),
+    }
+
+def get_rss_kb(pid):
+    try:
+        with open('/proc/%d/status' % pid, 'r') as f:
+            for line in f:
+                if line.startswith('VmRSS:'):
+                    return int(line.split()[1])
+    except IOError:
+        pass
+    return None
+
+class GovernancePerfTest(HistoriaTestFramework):
+    def __init__(self):
+        super().__init__(6, 5, [], fast_dip3_enforcement=True)
+        self.ipfs = None
+
+    def add_options(self, parser):
+        parser.add_option("--proposals", dest="proposals", default=20, type="int",
+                          help="Number of proposals to submit (default: %default)")
+        parser.add_option("--records", dest="records", default=20, type="int",
+                          help="Number of records to submit (default: %default)")
+        parser.add_option("--voterounds", dest="voterounds", default=3, type="int",
+                          help="Number of objects voted on with vote-many, one after the other (default: %default)")
+        parser.add_option("--ipfsapi", dest="ipfsapi", default=None,
+                          help="host:port of a real IPFS daemon, a mock daemon is used when not set")
+        parser.add_option("--ipfslatency", dest="ipfslatency", default=0.0, type="float",
+                          help="Seconds added to every call to the mock IPFS daemon (default: %default)")
+        parser.add_option("--results", dest="results", default=None,
+                          help="Write the results as JSON to this file (default: governance-perf.json in the tmpdir)")
+        parser.add_option("--timeout", dest="timeout", default=300, type="int",
+                          help="Seconds to wait for each measured event (default: %default)")
+
+    def setup_network(self):
+        ipfsapi = self.options.ipfsapi
+        if ipfsapi is None:
+            conf = MockIPFSConfiguration()
+            conf.latency = self.options.ipfslatency
+            self.ipfs = MockIPFSDaemon(conf)
+            self.ipfs.start()
+            ipfsapi = self.ipfs.api_address()
+        self.log.info("Using IPFS API at %s" % ipfsapi)
+        self.extra_args += ["-masternodecollateral=%d" % PINNING_COLLATERAL, "-ipfsapi=%s" % ipfsapi]
+        super().setup_network()
+
+    def prepare_masternodes(self):
+        # the base class only mines enough for the default collateral
+        required_balance = PINNING_COLLATERAL * self.mn_count + 100
+        while self.nodes[0].getbalance() < required_balance:
+            set_mocktime(get_mocktime() + 1)
+            set_node_times(self.nodes, get_mocktime())
+            self.nodes[0].generate(10)
+        self.sync_all()
+        super().prepare_masternodes()
+
+    def prepare_masternode(self, idx):
+        bls = self.nodes[0].bls('generate')
+        address = self.nodes[0].getnewaddress()
+        ownerAddr = self.nodes[0].getnewaddress()
+        votingAddr = self.nodes[0].getnewaddress()
+        rewardsAddr = self.nodes[0].getnewaddress()
+        ipfsPeerId = make_ipfs_id('peer%d' % idx)
+        identity = 'mn%d.perf.test' % idx
+
+        port = p2p_port(len(self.nodes) + idx)
+        proTxHash = self.nodes[0].protx('register_fund', address, '127.0.0.1:%d' % port, ownerAddr, bls['public'], votingAddr, 0, rewardsAddr, ipfsPeerId, identity)
+        self.nodes[0].generate(1)
+
+        txraw = self.nodes[0].getrawtransaction(proTxHash, True)
+        collateral_vout = 0
+        for vout_idx in range(0, len(txraw["vout"])):
+            if txraw["vout"][vout_idx]["value"] == PINNING_COLLATERAL:
+                collateral_vout = vout_idx
+
+        self.mninfo.append(MasternodeInfo(proTxHash, ownerAddr, votingAddr, bls['public'], bls['secret'], address, proTxHash, collateral_vout))
+        self.sync_all()
+
+    def bump_mocktime(self, seconds):
+        set_mocktime(get_mocktime() + seconds)
+        set_node_times(self.nodes, get_mocktime())
+
+    def wait_until(self, check, what):
+        start = time()
+        while not check():
+            if time() - start > self.options.timeout:
+                raise AssertionError("timed out waiting for %s" % what)
+            sleep(0.05)
+
+    def make_object_hex(self, name, gtype, start_epoch, end_epoch):
+        address = self.nodes[0].getnewaddress()
+        # keys are serialized in order, "summary" has to be the last one
+        data = '{"end_epoch":%d,"name":"%s","payment_address":"%s","payment_amount":%d,"start_epoch":%d,"type":%d,' \
+               '"url":"http://perf.test/%s","ipfscid":"%s","summary":{"name":"%s","description":"governance load test"}}' % \
+               (end_epoch, name, address, 1 if gtype == 1 else 0, start_epoch, gtype, name, make_ipfs_id(name), name)
+        return bytes_to_hex_str(data.encode('utf8')), make_ipfs_id(name)
+
+    def prepare_objects(self):
+        now = get_mocktime()
+        objects = []
+        for i in range(self.options.proposals):
+            objects.append(('perf-proposal-%d' % i, 1))
+        for i in range(self.options.records):
+            objects.append(('perf-record-%d' % i, 4))
+
+        prepared = []
+        start = time()
+        for name, gtype in objects:
+            data_hex, cid = self.make_object_hex(name, gtype, now, now + 30 * 24 * 60 * 60)
+            obj_time = str(now)
+            txid = self.nodes[0].gobject('prepare', '0', '1', obj_time, data_hex)
+            prepared.append({'name': name, 'type': gtype, 'cid': cid, 'time': obj_time, 'hex': data_hex, 'txid': txid})
+        self.results['prepare_seconds'] = time() - start
+
+        # the collaterals need confirmations before the objects are accepted
+        for i in range(GOVERNANCE_FEE_CONFIRMATIONS):
+            self.bump_mocktime(1)
+            self.nodes[0].generate(1)
+        self.sync_all()
+        return prepared
+
+    def submit_objects(self, prepared):
+        pending = {}
+        for obj in prepared:
+            start = time()
+            obj['hash'] = self.nodes[0].gobject('submit', '0', '1', obj['time'], obj['hex'], obj['txid'])
+            obj['submit_rpc'] = time() - start
+            obj['submitted'] = start
+            pending[obj['hash']] = obj
+
+        # acceptance: every node has the object
+        missing = {i: set(pending.keys()) for i in range(len(self.nodes))}
+        def check_accepted():
+            for i, hashes in missing.items():
+                if not hashes:
+                    continue
+                known = self.nodes[i].gobject('list', 'all', 'all')
+                for h in list(hashes):
+                    if h in known:
+                        hashes.discard(h)
+                        if all(h not in other for other in missing.values()):
+                            pending[h]['accepted'] = time() - pending[h]['submitted']
+            return all(not hashes for hashes in missing.values())
+        self.wait_until(check_accepted, "objects to be accepted by all nodes")
+
+        # pinning: every masternode pinned the object
+        unpinned = {mn.nodeIdx: set(o['cid'] for o in prepared) for mn in self.mninfo}
+        by_cid = {o['cid']: o for o in prepared}
+        pin_states = {}
+        def check_pinned():
+            for idx, cids in unpinned.items():
+                for cid in list(cids):
+                    status = self.nodes[idx].gobject('pinstatus', cid)['status']
+                    if status in ('PINNED', 'TOO_BIG', 'FAILED'):
+                        cids.discard(cid)
+                        pin_states[status] = pin_states.get(status, 0) + 1
+                        if all(cid not in other for other in unpinned.values()):
+                            by_cid[cid]['pinned'] = time() - by_cid[cid]['submitted']
+            return all(not cids for cids in unpinned.values())
+        self.wait_until(check_pinned, "objects to be pinned by all masternodes")
+        self.results['pin_states'] = pin_states
+
+        self.results['submit_rpc'] = summarize([o['submit_rpc'] for o in prepared])
+        self.results['acceptance_latency'] = summarize([o['accepted'] for o in prepared])
+        self.results['pin_latency'] = summarize([o['pinned'] for o in prepared])
+
+    def vote_rounds(self, prepared):
+        vote_rpc = []
+        vote_latency = []
+        for obj in prepared[:self.options.voterounds]:
+            start = time()
+            self.nodes[0].gobject('vote-many', obj['hash'], 'funding', 'yes')
+            vote_rpc.append(time() - start)
+            def check_votes():
+                for node in self.nodes:
+                    entry = node.gobject('list', 'all', 'all').get(obj['hash'])
+                    if entry is None or entry['YesCount'] < self.mn_count:
+                        return False
+                return True
+            self.wait_until(check_votes, "votes on %s" % obj['name'])
+            vote_latency.append(time() - start)
+        self.results['vote_many_rpc'] = summarize(vote_rpc)
+        self.results['vote_latency'] = summarize(vote_latency)
+
+    def measure_sync(self):
+        idx = len(self.nodes)
+        initialize_datadir(self.options.tmpdir, idx)
+        start = time()
+        node = start_node(idx, self.options.tmpdir, self.extra_args)
+        self.nodes.append(node)
+        connect_nodes(node, 0)
+        expected = len(self.nodes[0].gobject('list', 'all', 'all'))
+        def check_synced():
+            # mnsync moves between its stages based on the (mock) time
+            self.bump_mocktime(1)
+            if not node.mnsync('status')['IsSynced']:
+                return False
+            return len(node.gobject('list', 'all', 'all')) >= expected
+        self.wait_until(check_synced, "the new node to sync governance")
+        self.results['governance_sync_seconds'] = time() - start
+        self.results['governance_sync_objects'] = expected
+
+    def measure_memory(self):
+        memory = {}
+        for i in range(len(self.nodes)):
+            if i in bitcoind_processes:
+                memory['node%d' % i] = get_rss_kb(bitcoind_processes[i].pid)
+        self.results['memory_rss_kb'] = memory
+
+    def run_test(self):
+        self.results = {
+            'timestamp': int(time()),
+            'parameters': {
+                'nodes': self.num_nodes,
+                'masternodes': self.mn_count,
+                'proposals': self.options.proposals,
+                'records': self.options.records,
+                'voterounds': self.options.voterounds,
+                'ipfs': self.options.ipfsapi or 'mock',
+                'ipfslatency': self.options.ipfslatency,
+            },
+        }
+
+        self.log.info("Preparing %d proposals and %d records" % (self.options.proposals, self.options.records))
+        prepared = self.prepare_objects()
+
+        self.log.info("Submitting objects")
+        self.submit_objects(prepared)
+
+        self.log.info("Running %d rounds of vote-many" % self.options.voterounds)
+        self.vote_rounds(prepared)
+
+        self.log.info("Syncing governance to a new node")
+        self.measure_sync()
+
+        self.measure_memory()
+        if self.ipfs is not None:
+            self.results['ipfs_calls'] = self.ipfs.get_stats()
+            self.ipfs.stop()
+
+        results_file = self.options.results or os.path.join(self.options.tmpdir, 'governance-perf.json')
+        with open(results_file, 'w') as f:
+            json.dump(self.results, f, indent=2, sort_keys=True)
+        self.log.info("Results written to %s" % results_file)
+        self.log.info(json.dumps(self.results, indent=2, sort_keys=True))
+
+if __name__ == '__main__':
+    GovernancePerfTest().main()
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Dash Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Mock IPFS daemon for testing.
+
+Answers the parts of the IPFS HTTP API (/api/v0/...) used by historiad for pinning governance
+content. Every CID is known and has a fixed size, pins are kept in memory. An artificial
+latency can be added to each call to look like a daemon which has to fetch content.
+"""
+
+import json
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, HTTPServer
+from socketserver import ThreadingMixIn
+from urllib.parse import urlparse, parse_qs
+
+class MockIPFSConfiguration(object):
+    """Mock daemon configuration."""
+    def __init__(self):
+        self.addr = ('127.0.0.1', 0) # Bind address, port 0 picks a free one
+        self.latency = 0.0 # Seconds added to every call
+        self.object_size = 1024 # CumulativeSize of every object
+
+class MockIPFSHandler(BaseHTTPRequestHandler):
+    def log_message(self, format, *args):
+        pass
+
+    def do_GET(self):
+        self.handle_call()
+
+    def do_POST(self):
+        # the request body (if any) isn't needed by any of the mocked calls
+        length = int(self.headers.get('Content-Length', 0))
+        if length:
+            self.rfile.read(length)
+        self.handle_call()
+
+    def handle_call(self):
+        url = urlparse(self.path)
+        method = url.path[len('/api/v0/'):] if url.path.startswith('/api/v0/') else None
+        args = parse_qs(url.query).get('arg', [])
+        start = time.time()
+        if self.server.conf.latency:
+            time.sleep(self.server.conf.latency)
+        try:
+            status, response = self.server.mock.call(method, args)
+        finally:
+            self.server.mock.record(method, time.time() - start)
+        body = json.dumps(response).encode('utf8')
+        self.send_response(status)
+        self.send_header('Content-Type', 'application/json')
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+class ThreadingHTTPServer(ThreadingMixIn, HTTPServer):
+    daemon_threads = True
+
+class MockIPFSDaemon(object):
+    def __init__(self, conf):
+        self.conf = conf
+        self.lock = threading.Lock()
+        self.pins = set()
+        # method -> [count, total seconds]
+        self.calls = {}
+        self.server = ThreadingHTTPServer(conf.addr, MockIPFSHandler)
+        self.server.conf = conf
+        self.server.mock = self
+        self.thread = None
+
+    def start(self):
+        self.thread = threading.Thread(target=self.server.serve_forever)
+        self.thread.daemon = True
+        self.thread.start()
+
+    def stop(self):
+        self.server.shutdown()
+        self.server.server_close()
+        self.thread.join()
+
+    def api_address(self):
+        """The address to pass to historiad with -ipfsapi"""
+        return '%s:%d' % self.server.server_address[:2]
+
+    def record(self, method, duration):
+        with self.lock:
+            stats = self.calls.setdefault(method, [0, 0.0])
+            stats[0] += 1
+            stats[1] += duration
+
+    def get_stats(self):
+        """Number of calls and their average latency per API method"""
+        with self.lock:
+            return {m: {'count': c, 'avg_latency': t / c} for m, (c, t) in self.calls.items()}
+
+    @staticmethod
+    def strip_path(path):
+        return path[len('/ipfs/'):] if path.startswith('/ipfs/') else path
+
+    def call(self, method, args):
+        if method == 'version':
+            return 200, {'Version': '0.4.22', 'Commit': '', 'Repo': '7', 'System': 'mock', 'Golang': ''}
+        if method == 'id':
+            return 200, {'ID': 'QmMockIPFSDaemon', 'Addresses': []}
+        if method in ('swarm/connect', 'swarm/disconnect'):
+            return 200, {'Strings': ['%s %s success' % (method[len('swarm/'):], a) for a in args]}
+        if method == 'object/stat':
+            cid = self.strip_path(args[0])
+            return 200, {'Hash': cid, 'NumLinks': 0, 'BlockSize': self.conf.object_size,
+                         'LinksSize': 0, 'DataSize': self.conf.object_size, 'CumulativeSize': self.conf.object_size}
+        if method == 'file/ls':
+            cid = self.strip_path(args[0])
+            return 200, {'Arguments': {args[0]: cid},
+                         'Objects': {cid: {'Hash': cid, 'Size': self.conf.object_size, 'Type': 'File', 'Links': None}}}
+        if method == 'pin/add':
+            cids = [self.strip_path(a) for a in args]
+            with self.lock:
+                self.pins.update(cids)
+            return 200, {'Pins': cids}
+        if method == 'pin/rm':
+            cids = [self.strip_path(a) for a in args]
+            with self.lock:
+                missing = [c for c in cids if c not in self.pins]
+                if missing:
+                    return 500, {'Message': 'not pinned', 'Code': 0, 'Type': 'error'}
+                self.pins.difference_update(cids)
+            return 200, {'Pins': cids}
+        if method == 'pin/ls':
+            with self.lock:
+                if args:
+                    cids = [self.strip_path(a) for a in args]
+                    if any(c not in self.pins for c in cids):
+                        return 500, {'Message': 'path is not pinned', 'Code': 0, 'Type': 'error'}
+                else:
+                    cids = list(self.pins)
+            return 200, {'Keys': {c: {'Type': 'recursive'} for c in cids}}
+        return 404, {'Message': 'unknown command %s' % method, 'Code': 0, 'Type': 'error'}
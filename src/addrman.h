@@ -9,6 +9,7 @@
 #include "netaddress.h"
 #include "protocol.h"
 #include "random.h"
+#include "saltedhasher.h"
 #include "sync.h"
 #include "timedata.h"
 #include "util.h"
@@ -16,6 +17,7 @@
 #include <map>
 #include <set>
 #include <stdint.h>
+#include <unordered_map>
 #include <vector>
 
 /**
@@ -48,7 +50,7 @@ private:
     //! in tried set? (memory only)
     bool fInTried;
 
-    //! position in vRandom
+    //! position in vRandom, -1 for the unused entries of CAddrMan::vInfo (memory only)
     int nRandomPos;
 
     friend class CAddrMan;
@@ -171,6 +173,125 @@ public:
 //! the maximum number of nodes to return in a getaddr call
 #define ADDRMAN_GETADDR_MAX 2500
 
+static_assert(ADDRMAN_BUCKET_SIZE <= 64, "the bucket occupancy bitmaps of CAddrTable are 64 bits wide");
+
+/**
+ * The "new" or "tried" table: the nId stored at each position of each bucket, and
+ * a bitmap per bucket of the positions which are in use. The bitmaps are kept
+ * together so that counting and locating entries scans a few KiB only.
+ */
+template<int nBuckets>
+class CAddrTable
+{
+private:
+    //! bit i of vUsed[bucket] is set when vvId[bucket][i] holds an entry
+    uint64_t vUsed[nBuckets];
+
+    //! nId stored at each position, -1 when the position is empty
+    int vvId[nBuckets][ADDRMAN_BUCKET_SIZE];
+
+    //! number of positions in use, over all buckets
+    int nCount;
+
+    static int CountBits(uint64_t x)
+    {
+        x = x - ((x >> 1) & 0x5555555555555555ULL);
+        x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+        x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+        return (x * 0x0101010101010101ULL) >> 56;
+    }
+
+    //! Position of the lowest bit set in a non-zero bitmap
+    static int LowestBit(uint64_t x)
+    {
+        return CountBits((x & (~x + 1)) - 1);
+    }
+
+public:
+    CAddrTable()
+    {
+        Clear();
+    }
+
+    void Clear()
+    {
+        for (int bucket = 0; bucket < nBuckets; bucket++) {
+            vUsed[bucket] = 0;
+            for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
+                vvId[bucket][i] = -1;
+            }
+        }
+        nCount = 0;
+    }
+
+    //! Return the nId at a position, or -1 if it is empty.
+    int Get(int nBucket, int nPos) const
+    {
+        return vvId[nBucket][nPos];
+    }
+
+    //! Store an nId at an empty position.
+    void Set(int nBucket, int nPos, int nId)
+    {
+        assert(vvId[nBucket][nPos] == -1);
+        vvId[nBucket][nPos] = nId;
+        vUsed[nBucket] |= (uint64_t)1 << nPos;
+        nCount++;
+    }
+
+    //! Empty a position which is in use.
+    void Erase(int nBucket, int nPos)
+    {
+        assert(vvId[nBucket][nPos] != -1);
+        vvId[nBucket][nPos] = -1;
+        vUsed[nBucket] &= ~((uint64_t)1 << nPos);
+        nCount--;
+    }
+
+    //! Empty all positions holding nId, and return how many there were.
+    int EraseAll(int nId)
+    {
+        int nErased = 0;
+        for (int bucket = 0; bucket < nBuckets; bucket++) {
+            for (uint64_t used = vUsed[bucket]; used != 0; used &= used - 1) {
+                int nPos = LowestBit(used);
+                if (vvId[bucket][nPos] == nId) {
+                    Erase(bucket, nPos);
+                    nErased++;
+                }
+            }
+        }
+        return nErased;
+    }
+
+    //! Return the number of positions in use in a bucket.
+    int CountBucket(int nBucket) const
+    {
+        return CountBits(vUsed[nBucket]);
+    }
+
+    //! Return the number of positions in use.
+    int Count() const
+    {
+        return nCount;
+    }
+
+    //! Return the nId at the n-th position in use, counting bucket by bucket from 0.
+    int GetNth(int n) const
+    {
+        assert(n >= 0 && n < nCount);
+        int bucket = 0;
+        for (int nSize = CountBits(vUsed[bucket]); n >= nSize; nSize = CountBits(vUsed[++bucket])) {
+            n -= nSize;
+        }
+        uint64_t used = vUsed[bucket];
+        while (n-- > 0) {
+            used &= used - 1;
+        }
+        return vvId[bucket][LowestBit(used)];
+    }
+};
+
 /** 
  * Stochastical (IP) address manager 
  */
@@ -180,14 +301,14 @@ private:
     //! critical section to protect the inner data structures
     mutable CCriticalSection cs;
 
-    //! last used nId
-    int nIdCount;
+    //! table with information about all nIds, indexed by nId
+    std::vector<CAddrInfo> vInfo;
 
-    //! table with information about all nIds
-    std::map<int, CAddrInfo> mapInfo;
+    //! nIds of deleted entries in vInfo, reused before vInfo grows
+    std::vector<int> vFreeIds;
 
     //! find an nId based on its network address
-    std::map<CService, int> mapAddr;
+    std::unordered_map<CService, int, SaltedHasher<CService, SaltedHasherBase>> mapAddr;
 
     //! randomly-ordered vector of all nIds
     std::vector<int> vRandom;
@@ -196,13 +317,13 @@ private:
     int nTried;
 
     //! list of "tried" buckets
-    int vvTried[ADDRMAN_TRIED_BUCKET_COUNT][ADDRMAN_BUCKET_SIZE];
+    CAddrTable<ADDRMAN_TRIED_BUCKET_COUNT> vvTried;
 
     //! number of (unique) "new" entries
     int nNew;
 
     //! list of "new" buckets
-    int vvNew[ADDRMAN_NEW_BUCKET_COUNT][ADDRMAN_BUCKET_SIZE];
+    CAddrTable<ADDRMAN_NEW_BUCKET_COUNT> vvNew;
 
     //! last time Good was called (memory only)
     int64_t nLastGood;
@@ -214,8 +335,8 @@ protected:
     //! secret key to randomize bucket select with
     uint256 nKey;
 
-    //! Source of random numbers for randomization in inner loops
-    FastRandomContext insecure_rand;
+    //! Return the key of an address in mapAddr, which has no port unless ports are discriminated.
+    CService GetAddrKey(const CService& addr) const;
 
     //! Find an entry.
     CAddrInfo* Find(const CService& addr, int *pnId = NULL);
@@ -286,7 +407,7 @@ public:
      * as incompatible. This is necessary because it did not check the version number on
      * deserialization.
      *
-     * Notice that vvTried, mapAddr and vVector are never encoded explicitly;
+     * Notice that vvTried, mapAddr and vRandom are never encoded explicitly;
      * they are instead reconstructed from the other information.
      *
      * vvNew is serialized, but only used if ADDRMAN_UNKNOWN_BUCKET_COUNT didn't change,
@@ -312,20 +433,20 @@ public:
 
         int nUBuckets = ADDRMAN_NEW_BUCKET_COUNT ^ (1 << 30);
         s << nUBuckets;
-        std::map<int, int> mapUnkIds;
+        std::vector<int> vUnkIds(vInfo.size(), -1);
         int nIds = 0;
-        for (std::map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); it++) {
-            mapUnkIds[(*it).first] = nIds;
-            const CAddrInfo &info = (*it).second;
+        for (size_t nId = 0; nId < vInfo.size(); nId++) {
+            const CAddrInfo &info = vInfo[nId];
             if (info.nRefCount) {
                 assert(nIds != nNew); // this means nNew was wrong, oh ow
+                vUnkIds[nId] = nIds;
                 s << info;
                 nIds++;
             }
         }
         nIds = 0;
-        for (std::map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); it++) {
-            const CAddrInfo &info = (*it).second;
+        for (size_t nId = 0; nId < vInfo.size(); nId++) {
+            const CAddrInfo &info = vInfo[nId];
             if (info.fInTried) {
                 assert(nIds != nTried); // this means nTried was wrong, oh ow
                 s << info;
@@ -333,15 +454,11 @@ public:
             }
         }
         for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
-            int nSize = 0;
-            for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
-                if (vvNew[bucket][i] != -1)
-                    nSize++;
-            }
+            int nSize = vvNew.CountBucket(bucket);
             s << nSize;
             for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
-                if (vvNew[bucket][i] != -1) {
-                    int nIndex = mapUnkIds[vvNew[bucket][i]];
+                if (vvNew.Get(bucket, i) != -1) {
+                    int nIndex = vUnkIds[vvNew.Get(bucket, i)];
                     s << nIndex;
                 }
             }
@@ -377,11 +494,22 @@ public:
             throw std::ios_base::failure("Corrupt CAddrMan serialization, nTried exceeds limit.");
         }
 
+        vInfo.reserve(nNew + nTried);
+        mapAddr.reserve(nNew + nTried);
+
         // Deserialize entries from the new table.
+        // Older versions could write the same address more than once, keep the first one only.
+        int nDuplicates = 0;
+        vInfo.resize(nNew);
         for (int n = 0; n < nNew; n++) {
-            CAddrInfo &info = mapInfo[n];
+            CAddrInfo &info = vInfo[n];
             s >> info;
-            mapAddr[info] = n;
+            if (!mapAddr.emplace(GetAddrKey(info), n).second) {
+                info = CAddrInfo();
+                vFreeIds.push_back(n);
+                nDuplicates++;
+                continue;
+            }
             info.nRandomPos = vRandom.size();
             vRandom.push_back(n);
             if (nVersion != 1 || nUBuckets != ADDRMAN_NEW_BUCKET_COUNT) {
@@ -389,13 +517,12 @@ public:
                 // immediately try to give them a reference based on their primary source address.
                 int nUBucket = info.GetNewBucket(nKey);
                 int nUBucketPos = info.GetBucketPosition(nKey, true, nUBucket);
-                if (vvNew[nUBucket][nUBucketPos] == -1) {
-                    vvNew[nUBucket][nUBucketPos] = n;
+                if (vvNew.Get(nUBucket, nUBucketPos) == -1) {
+                    vvNew.Set(nUBucket, nUBucketPos, n);
                     info.nRefCount++;
                 }
             }
         }
-        nIdCount = nNew;
 
         // Deserialize entries from the tried table.
         int nLost = 0;
@@ -404,14 +531,14 @@ public:
             s >> info;
             int nKBucket = info.GetTriedBucket(nKey);
             int nKBucketPos = info.GetBucketPosition(nKey, false, nKBucket);
-            if (vvTried[nKBucket][nKBucketPos] == -1) {
+            if (vvTried.Get(nKBucket, nKBucketPos) == -1 && !mapAddr.count(GetAddrKey(info))) {
+                int nId = vInfo.size();
                 info.nRandomPos = vRandom.size();
                 info.fInTried = true;
-                vRandom.push_back(nIdCount);
-                mapInfo[nIdCount] = info;
-                mapAddr[info] = nIdCount;
-                vvTried[nKBucket][nKBucketPos] = nIdCount;
-                nIdCount++;
+                vRandom.push_back(nId);
+                mapAddr[GetAddrKey(info)] = nId;
+                vInfo.push_back(info);
+                vvTried.Set(nKBucket, nKBucketPos, nId);
             } else {
                 nLost++;
             }
@@ -425,26 +552,26 @@ public:
             for (int n = 0; n < nSize; n++) {
                 int nIndex = 0;
                 s >> nIndex;
-                if (nIndex >= 0 && nIndex < nNew) {
-                    CAddrInfo &info = mapInfo[nIndex];
+                if (nIndex >= 0 && nIndex < nNew && vInfo[nIndex].nRandomPos != -1) {
+                    CAddrInfo &info = vInfo[nIndex];
                     int nUBucketPos = info.GetBucketPosition(nKey, true, bucket);
-                    if (nVersion == 1 && nUBuckets == ADDRMAN_NEW_BUCKET_COUNT && vvNew[bucket][nUBucketPos] == -1 && info.nRefCount < ADDRMAN_NEW_BUCKETS_PER_ADDRESS) {
+                    if (nVersion == 1 && nUBuckets == ADDRMAN_NEW_BUCKET_COUNT && vvNew.Get(bucket, nUBucketPos) == -1 && info.nRefCount < ADDRMAN_NEW_BUCKETS_PER_ADDRESS) {
                         info.nRefCount++;
-                        vvNew[bucket][nUBucketPos] = nIndex;
+                        vvNew.Set(bucket, nUBucketPos, nIndex);
                     }
                 }
             }
         }
 
+        nNew -= nDuplicates;
+
         // Prune new entries with refcount 0 (as a result of collisions).
-        int nLostUnk = 0;
-        for (std::map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); ) {
-            if (it->second.fInTried == false && it->second.nRefCount == 0) {
-                std::map<int, CAddrInfo>::const_iterator itCopy = it++;
-                Delete(itCopy->first);
+        int nLostUnk = nDuplicates;
+        for (int nId = 0; nId < (int)vInfo.size(); nId++) {
+            const CAddrInfo &info = vInfo[nId];
+            if (info.nRandomPos != -1 && info.fInTried == false && info.nRefCount == 0) {
+                Delete(nId);
                 nLostUnk++;
-            } else {
-                it++;
             }
         }
         if (nLost + nLostUnk > 0) {
@@ -456,20 +583,14 @@ public:
 
     void Clear()
     {
+        std::vector<CAddrInfo>().swap(vInfo);
+        std::vector<int>().swap(vFreeIds);
         std::vector<int>().swap(vRandom);
+        mapAddr.clear();
         nKey = GetRandHash();
-        for (size_t bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
-            for (size_t entry = 0; entry < ADDRMAN_BUCKET_SIZE; entry++) {
-                vvNew[bucket][entry] = -1;
-            }
-        }
-        for (size_t bucket = 0; bucket < ADDRMAN_TRIED_BUCKET_COUNT; bucket++) {
-            for (size_t entry = 0; entry < ADDRMAN_BUCKET_SIZE; entry++) {
-                vvTried[bucket][entry] = -1;
-            }
-        }
+        vvNew.Clear();
+        vvTried.Clear();
 
-        nIdCount = 0;
         nTried = 0;
         nNew = 0;
         nLastGood = 1; //Initially at 1 so that "never" is strictly worse.
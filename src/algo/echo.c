@@ -73,6 +73,21 @@ extern "C"{
 #define AES_BIG_ENDIAN   0
 #include "aes_helper.c"
 
+/*
+ * On x86 the two AES rounds applied to each 128-bit word of the state
+ * map directly onto the AESENC instruction. The AES-NI code is compiled
+ * with a target attribute and only used when the CPU supports it, so
+ * the binary still runs everywhere.
+ */
+#if !defined SPH_ECHO_AESNI && SPH_ECHO_64 && !SPH_SMALL_FOOTPRINT_ECHO \
+	&& defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+#define SPH_ECHO_AESNI   1
+#endif
+
+#if SPH_ECHO_AESNI
+#include <wmmintrin.h>
+#endif
+
 #if SPH_ECHO_64
 
 #define DECL_STATE_SMALL   \
@@ -162,7 +177,52 @@ aes_2rounds_all(sph_u64 W[16][2],
 		} \
 	} while (0)
 
+#if SPH_ECHO_AESNI
+
+__attribute__((target("aes,sse2")))
+static void
+aes_2rounds_all_aesni(sph_u64 W[16][2],
+	sph_u32 *pK0, sph_u32 *pK1, sph_u32 *pK2, sph_u32 *pK3)
+{
+	int n;
+	sph_u32 K0 = *pK0;
+	sph_u32 K1 = *pK1;
+	sph_u32 K2 = *pK2;
+	sph_u32 K3 = *pK3;
+	const __m128i zero = _mm_setzero_si128();
+
+	for (n = 0; n < 16; n ++) {
+		__m128i X = _mm_loadu_si128((const __m128i *)W[n]);
+		X = _mm_aesenc_si128(X, _mm_set_epi32(
+			(int)K3, (int)K2, (int)K1, (int)K0));
+		X = _mm_aesenc_si128(X, zero);
+		_mm_storeu_si128((__m128i *)W[n], X);
+		if ((K0 = T32(K0 + 1)) == 0) {
+			if ((K1 = T32(K1 + 1)) == 0)
+				if ((K2 = T32(K2 + 1)) == 0)
+					K3 = T32(K3 + 1);
+		}
+	}
+	*pK0 = K0;
+	*pK1 = K1;
+	*pK2 = K2;
+	*pK3 = K3;
+}
+
 #define BIG_SUB_WORDS   do { \
+		if (__builtin_cpu_supports("aes")) \
+			aes_2rounds_all_aesni(W, &K0, &K1, &K2, &K3); \
+		else \
+			BIG_SUB_WORDS_PORTABLE; \
+	} while (0)
+
+#else
+
+#define BIG_SUB_WORDS   BIG_SUB_WORDS_PORTABLE
+
+#endif
+
+#define BIG_SUB_WORDS_PORTABLE   do { \
 		AES_2ROUNDS(W[ 0]); \
 		AES_2ROUNDS(W[ 1]); \
 		AES_2ROUNDS(W[ 2]); \
@@ -30,6 +30,8 @@
 #include "lyra2.h"
 #include "gost_streebog.h"
 
+#include <vector>
+
 #ifndef QT_NO_DEBUG
 #include <string>
 #endif
@@ -324,6 +326,238 @@ inline uint256 HashX16RV2(const T1 pbegin, const T1 pend, const uint256 PrevBloc
     return hash[15].trim256();
 }
 
+/// Enough room for the context of any algorithm of the X16R/X16RV2 chain
+union sph_x16r_context {
+    sph_blake512_context     blake;
+    sph_bmw512_context       bmw;
+    sph_groestl512_context   groestl;
+    sph_jh512_context        jh;
+    sph_keccak512_context    keccak;
+    sph_skein512_context     skein;
+    sph_luffa512_context     luffa;
+    sph_cubehash512_context  cubehash;
+    sph_shavite512_context   shavite;
+    sph_simd512_context      simd;
+    sph_echo512_context      echo;
+    sph_hamsi512_context     hamsi;
+    sph_fugue512_context     fugue;
+    sph_shabal512_context    shabal;
+    sph_whirlpool_context    whirlpool;
+    sph_sha512_context       sha512;
+    sph_tiger_context        tiger;
+};
+
+/// X16RV2 runs the input through tiger first for these selections
+inline bool X16RV2UsesTiger(int hashSelection)
+{
+    return hashSelection == 4 || hashSelection == 6 || hashSelection == 15;
+}
+
+/// Initialize ctx for the function which absorbs the input of a round with the given selection
+inline void X16RRoundInit(sph_x16r_context& ctx, int hashSelection, bool fV2)
+{
+    if (fV2 && X16RV2UsesTiger(hashSelection)) {
+        sph_tiger_init(&ctx.tiger);
+        return;
+    }
+    switch (hashSelection) {
+        case 0:  sph_blake512_init(&ctx.blake); break;
+        case 1:  sph_bmw512_init(&ctx.bmw); break;
+        case 2:  sph_groestl512_init(&ctx.groestl); break;
+        case 3:  sph_jh512_init(&ctx.jh); break;
+        case 4:  sph_keccak512_init(&ctx.keccak); break;
+        case 5:  sph_skein512_init(&ctx.skein); break;
+        case 6:  sph_luffa512_init(&ctx.luffa); break;
+        case 7:  sph_cubehash512_init(&ctx.cubehash); break;
+        case 8:  sph_shavite512_init(&ctx.shavite); break;
+        case 9:  sph_simd512_init(&ctx.simd); break;
+        case 10: sph_echo512_init(&ctx.echo); break;
+        case 11: sph_hamsi512_init(&ctx.hamsi); break;
+        case 12: sph_fugue512_init(&ctx.fugue); break;
+        case 13: sph_shabal512_init(&ctx.shabal); break;
+        case 14: sph_whirlpool_init(&ctx.whirlpool); break;
+        case 15: sph_sha512_init(&ctx.sha512); break;
+    }
+}
+
+inline void X16RRoundUpdate(sph_x16r_context& ctx, int hashSelection, bool fV2, const void* data, size_t len)
+{
+    if (fV2 && X16RV2UsesTiger(hashSelection)) {
+        sph_tiger(&ctx.tiger, data, len);
+        return;
+    }
+    switch (hashSelection) {
+        case 0:  sph_blake512(&ctx.blake, data, len); break;
+        case 1:  sph_bmw512(&ctx.bmw, data, len); break;
+        case 2:  sph_groestl512(&ctx.groestl, data, len); break;
+        case 3:  sph_jh512(&ctx.jh, data, len); break;
+        case 4:  sph_keccak512(&ctx.keccak, data, len); break;
+        case 5:  sph_skein512(&ctx.skein, data, len); break;
+        case 6:  sph_luffa512(&ctx.luffa, data, len); break;
+        case 7:  sph_cubehash512(&ctx.cubehash, data, len); break;
+        case 8:  sph_shavite512(&ctx.shavite, data, len); break;
+        case 9:  sph_simd512(&ctx.simd, data, len); break;
+        case 10: sph_echo512(&ctx.echo, data, len); break;
+        case 11: sph_hamsi512(&ctx.hamsi, data, len); break;
+        case 12: sph_fugue512(&ctx.fugue, data, len); break;
+        case 13: sph_shabal512(&ctx.shabal, data, len); break;
+        case 14: sph_whirlpool(&ctx.whirlpool, data, len); break;
+        case 15: sph_sha512(&ctx.sha512, data, len); break;
+    }
+}
+
+/// Finish a round, for X16RV2 tiger rounds this also runs the 64 byte tiger output through the second function
+inline void X16RRoundClose(sph_x16r_context& ctx, int hashSelection, bool fV2, uint512& hashOut)
+{
+    if (fV2 && X16RV2UsesTiger(hashSelection)) {
+        // tiger only writes 24 bytes, the rest must stay zero
+        hashOut.SetNull();
+        sph_tiger_close(&ctx.tiger, static_cast<void*>(&hashOut));
+        X16RRoundInit(ctx, hashSelection, false);
+        X16RRoundUpdate(ctx, hashSelection, false, static_cast<const void*>(&hashOut), 64);
+        X16RRoundClose(ctx, hashSelection, false, hashOut);
+        return;
+    }
+    void* dst = static_cast<void*>(&hashOut);
+    switch (hashSelection) {
+        case 0:  sph_blake512_close(&ctx.blake, dst); break;
+        case 1:  sph_bmw512_close(&ctx.bmw, dst); break;
+        case 2:  sph_groestl512_close(&ctx.groestl, dst); break;
+        case 3:  sph_jh512_close(&ctx.jh, dst); break;
+        case 4:  sph_keccak512_close(&ctx.keccak, dst); break;
+        case 5:  sph_skein512_close(&ctx.skein, dst); break;
+        case 6:  sph_luffa512_close(&ctx.luffa, dst); break;
+        case 7:  sph_cubehash512_close(&ctx.cubehash, dst); break;
+        case 8:  sph_shavite512_close(&ctx.shavite, dst); break;
+        case 9:  sph_simd512_close(&ctx.simd, dst); break;
+        case 10: sph_echo512_close(&ctx.echo, dst); break;
+        case 11: sph_hamsi512_close(&ctx.hamsi, dst); break;
+        case 12: sph_fugue512_close(&ctx.fugue, dst); break;
+        case 13: sph_shabal512_close(&ctx.shabal, dst); break;
+        case 14: sph_whirlpool_close(&ctx.whirlpool, dst); break;
+        case 15: sph_sha512_close(&ctx.sha512, dst); break;
+    }
+}
+
+/**
+ * Hashes many block headers which only differ in the trailing 4 byte nonce.
+ *
+ * The first round of HashX16R/HashX16RV2 absorbs the whole header, so the state
+ * of its function after everything but the nonce is computed once in the
+ * constructor and copied for every nonce. The remaining rounds work on 64 byte
+ * inputs and reuse one working context. Results are identical to
+ * HashX16R/HashX16RV2 over the same bytes.
+ *
+ * Not thread safe, use one hasher per thread.
+ */
+class CX16RHasher
+{
+private:
+    bool fV2;
+    int vSelection[16];
+    sph_x16r_context ctxMidstate;
+    sph_x16r_context ctx;
+
+public:
+    /// [pbegin, pend) is the serialized header, the last 4 bytes of which are the nonce
+    template<typename T1>
+    CX16RHasher(const T1 pbegin, const T1 pend, const uint256& PrevBlockHash, bool fV2In) : fV2(fV2In)
+    {
+        size_t nLen = (pend - pbegin) * sizeof(pbegin[0]);
+        assert(nLen >= sizeof(uint32_t));
+
+        for (int i = 0; i < 16; i++) {
+            vSelection[i] = GetHashSelection(PrevBlockHash, i);
+        }
+        X16RRoundInit(ctxMidstate, vSelection[0], fV2);
+        X16RRoundUpdate(ctxMidstate, vSelection[0], fV2, static_cast<const void*>(&pbegin[0]), nLen - sizeof(uint32_t));
+    }
+
+    uint256 Hash(uint32_t nNonce)
+    {
+        uint512 hash[2];
+
+        ctx = ctxMidstate;
+        X16RRoundUpdate(ctx, vSelection[0], fV2, static_cast<const void*>(&nNonce), sizeof(nNonce));
+        X16RRoundClose(ctx, vSelection[0], fV2, hash[0]);
+
+        for (int i = 1; i < 16; i++) {
+            const uint512& hashIn = hash[(i - 1) & 1];
+            uint512& hashOut = hash[i & 1];
+            X16RRoundInit(ctx, vSelection[i], fV2);
+            X16RRoundUpdate(ctx, vSelection[i], fV2, static_cast<const void*>(&hashIn), 64);
+            X16RRoundClose(ctx, vSelection[i], fV2, hashOut);
+        }
+
+        return hash[1].trim256();
+    }
+};
+
+/// An input of HashX16RBatch, [pdata, pdata + nLen) is hashed like HashX16R/HashX16RV2 with PrevBlockHash
+struct X16RBatchInput
+{
+    const unsigned char* pdata;
+    size_t nLen;
+    uint256 PrevBlockHash;
+    bool fV2;
+};
+
+/**
+ * Hashes nCount inputs round by round instead of one after another.
+ *
+ * Each input picks a different order of the sixteen functions, hashing them one by one
+ * jumps between all of them in every hash. Here, all inputs go through round i before
+ * any goes through round i + 1, and the inputs which use the same function in a round
+ * are hashed back to back, so each function's code and tables stay warm while it's used.
+ * vHashesOut must have room for nCount hashes, the results are identical to
+ * HashX16R/HashX16RV2 of each input.
+ */
+inline void HashX16RBatch(const X16RBatchInput* vInputs, size_t nCount, uint256* vHashesOut)
+{
+    // X16RV2 tiger rounds run different code than the X16R rounds with the same selection
+    static const int NUM_GROUPS = 32;
+    static unsigned char pblank[1];
+
+    std::vector<uint512> vHashes(nCount);
+    std::vector<size_t> vOrder(nCount);
+    std::vector<unsigned char> vGroup(nCount);
+    sph_x16r_context ctx;
+
+    for (int i = 0; i < 16; i++) {
+        // counting sort of the inputs by the function they use in this round, keeping their order otherwise
+        size_t vGroupStart[NUM_GROUPS + 1] = {};
+        for (size_t j = 0; j < nCount; j++) {
+            int hashSelection = GetHashSelection(vInputs[j].PrevBlockHash, i);
+            vGroup[j] = hashSelection + ((vInputs[j].fV2 && X16RV2UsesTiger(hashSelection)) ? 16 : 0);
+            vGroupStart[vGroup[j] + 1]++;
+        }
+        for (int g = 0; g < NUM_GROUPS; g++) {
+            vGroupStart[g + 1] += vGroupStart[g];
+        }
+        for (size_t j = 0; j < nCount; j++) {
+            vOrder[vGroupStart[vGroup[j]]++] = j;
+        }
+
+        for (size_t j : vOrder) {
+            const int hashSelection = vGroup[j] & 15;
+            const bool fV2 = vInputs[j].fV2;
+            X16RRoundInit(ctx, hashSelection, fV2);
+            if (i == 0) {
+                const unsigned char* pdata = vInputs[j].nLen == 0 ? pblank : vInputs[j].pdata;
+                X16RRoundUpdate(ctx, hashSelection, fV2, static_cast<const void*>(pdata), vInputs[j].nLen);
+            } else {
+                // the output buffer is only written by the close below, after the input was absorbed
+                X16RRoundUpdate(ctx, hashSelection, fV2, static_cast<const void*>(&vHashes[j]), 64);
+            }
+            X16RRoundClose(ctx, hashSelection, fV2, vHashes[j]);
+        }
+    }
+
+    for (size_t j = 0; j < nCount; j++) {
+        vHashesOut[j] = vHashes[j].trim256();
+    }
+}
+
 /// Used for testing the algo switch from X16R to X16RV2
 
 //inline int GetX21sSelection(const uint256 PrevBlockHash, int index) {
@@ -4,6 +4,7 @@
 
 #include "bench.h"
 
+#include "crypto/sha256.h"
 #include "key.h"
 #include "stacktraces.h"
 #include "validation.h"
@@ -13,6 +14,7 @@
 
 void CleanupBLSTests();
 void CleanupBLSDkgTests();
+void CleanupBLSDkgRoundTests();
 
 int
 main(int argc, char** argv)
@@ -20,6 +22,7 @@ main(int argc, char** argv)
     RegisterPrettySignalHandlers();
     RegisterPrettyTerminateHander();
 
+    SHA256AutoDetect();
     ECC_Start();
     ECCVerifyHandle verifyHandle;
 
@@ -30,6 +33,7 @@ main(int argc, char** argv)
     benchmark::BenchRunner::RunAll();
 
     // need to be called before global destructors kick in (PoolAllocator is needed due to many BLSSecretKeys)
+    CleanupBLSDkgRoundTests();
     CleanupBLSDkgTests();
     CleanupBLSTests();
 
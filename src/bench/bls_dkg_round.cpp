@@ -0,0 +1,221 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "random.h"
+#include "bls/bls_worker.h"
+
+extern CBLSWorker blsWorker;
+
+// Simulates the BLS work a single member does in each phase of a full DKG round (see CDKGSession), without any
+// networking or chain state involved. Member operator keys are random keys, the commitment hash is random as well.
+struct DKGRound
+{
+    struct Member {
+        CBLSId id;
+        CBLSSecretKey operatorKey;
+        CBLSPublicKey operatorPubKey;
+
+        BLSVerificationVectorPtr vvec;
+        BLSSecretKeyVector skContributions;
+
+        CBLSSecretKey skShare;
+        CBLSSignature commitmentSig;
+        CBLSSignature quorumSigShare;
+    };
+
+    int quorumSize;
+    int threshold;
+    int invalidCount;
+
+    std::vector<Member> members;
+    BLSIdVector ids;
+
+    std::vector<BLSVerificationVectorPtr> receivedVvecs;
+    BLSVerificationVectorPtr quorumVvec;
+    uint256 commitmentHash;
+
+    DKGRound(int _quorumSize, int _threshold, int _invalidCount) :
+        quorumSize(_quorumSize),
+        threshold(_threshold),
+        invalidCount(_invalidCount)
+    {
+        members.resize(quorumSize);
+        ids.resize(quorumSize);
+
+        for (int i = 0; i < quorumSize; i++) {
+            members[i].id.SetInt(i + 1);
+            members[i].operatorKey.MakeNewKey();
+            members[i].operatorPubKey = members[i].operatorKey.GetPublicKey();
+            ids[i] = members[i].id;
+        }
+
+        for (auto& m : members) {
+            blsWorker.GenerateContributions(threshold, ids, m.vvec, m.skContributions);
+            receivedVvecs.emplace_back(m.vvec);
+        }
+        quorumVvec = blsWorker.BuildQuorumVerificationVector(receivedVvecs);
+        commitmentHash = GetRandHash();
+
+        for (auto& m : members) {
+            BLSSecretKeyVector skContributions = ReceiveShares(m);
+            m.skShare = blsWorker.AggregateSecretKeys(skContributions);
+            m.commitmentSig = m.operatorKey.Sign(commitmentHash);
+            m.quorumSigShare = m.skShare.Sign(commitmentHash);
+        }
+    }
+
+    BLSSecretKeyVector ReceiveShares(const Member& m) const
+    {
+        size_t whoAmI = &m - &members[0];
+        BLSSecretKeyVector skContributions;
+        skContributions.reserve(members.size());
+        for (auto& m2 : members) {
+            skContributions.emplace_back(m2.skContributions[whoAmI]);
+        }
+        return skContributions;
+    }
+
+    // CDKGSession::Contribute
+    void Bench_Contribute(benchmark::State& state)
+    {
+        while (state.KeepRunning()) {
+            BLSVerificationVectorPtr vvec;
+            BLSSecretKeyVector skContributions;
+            blsWorker.GenerateContributions(threshold, ids, vvec, skContributions);
+        }
+    }
+
+    // CDKGSession::PreVerifyMessage and CDKGSession::VerifyPendingContributions, with invalidCount bad contributions
+    void Bench_VerifyContributions(benchmark::State& state)
+    {
+        size_t memberIdx = 0;
+        while (state.KeepRunning()) {
+            auto& m = members[memberIdx];
+            BLSSecretKeyVector skContributions = ReceiveShares(m);
+            for (int i = 0; i < invalidCount; i++) {
+                skContributions[GetRandInt(skContributions.size())].MakeNewKey();
+            }
+
+            bool ok = blsWorker.VerifyVerificationVectors(receivedVvecs);
+            assert(ok);
+            blsWorker.VerifyContributionShares(m.id, receivedVvecs, skContributions);
+
+            memberIdx = (memberIdx + 1) % members.size();
+        }
+    }
+
+    // CDKGSession::ReceiveMessage(CDKGJustification), one justification for each member that complained
+    void Bench_VerifyJustifications(benchmark::State& state)
+    {
+        size_t memberIdx = 0;
+        while (state.KeepRunning()) {
+            auto& m = members[memberIdx];
+            std::vector<std::future<bool>> futures;
+            futures.reserve(invalidCount);
+            for (int i = 0; i < invalidCount; i++) {
+                auto& m2 = members[(memberIdx + i + 1) % members.size()];
+                futures.emplace_back(blsWorker.AsyncVerifyContributionShare(m2.id, m.vvec, m.skContributions[&m2 - &members[0]]));
+            }
+            for (auto& f : futures) {
+                bool ok = f.get();
+                assert(ok);
+            }
+
+            memberIdx = (memberIdx + 1) % members.size();
+        }
+    }
+
+    // CDKGSession::SendCommitment
+    void Bench_Commit(benchmark::State& state)
+    {
+        size_t memberIdx = 0;
+        while (state.KeepRunning()) {
+            auto& m = members[memberIdx];
+            BLSSecretKeyVector skContributions = ReceiveShares(m);
+
+            auto vvec = blsWorker.BuildQuorumVerificationVector(receivedVvecs);
+            auto skShare = blsWorker.AggregateSecretKeys(skContributions);
+            m.operatorKey.Sign(commitmentHash);
+            skShare.Sign(commitmentHash);
+
+            memberIdx = (memberIdx + 1) % members.size();
+        }
+    }
+
+    // CDKGSession::ReceiveMessage(CDKGPrematureCommitment), for the premature commitments of all members
+    void Bench_VerifyPrematureCommitments(benchmark::State& state)
+    {
+        while (state.KeepRunning()) {
+            for (auto& m : members) {
+                bool ok = m.commitmentSig.VerifyInsecure(m.operatorPubKey, commitmentHash);
+                auto pubKeyShare = blsWorker.BuildPubKeyShare(quorumVvec, m.id);
+                ok &= m.quorumSigShare.VerifyInsecure(pubKeyShare, commitmentHash);
+                assert(ok);
+            }
+        }
+    }
+
+    // CDKGSession::FinalizeCommitments, with all members having signed
+    void Bench_FinalizeCommitments(benchmark::State& state)
+    {
+        std::vector<CBLSSignature> aggSigs;
+        std::vector<CBLSPublicKey> aggPks;
+        std::vector<CBLSSignature> thresholdSigs;
+        for (auto& m : members) {
+            aggSigs.emplace_back(m.commitmentSig);
+            aggPks.emplace_back(m.operatorPubKey);
+            thresholdSigs.emplace_back(m.quorumSigShare);
+        }
+
+        while (state.KeepRunning()) {
+            auto membersSig = CBLSSignature::AggregateSecure(aggSigs, aggPks, commitmentHash);
+            CBLSSignature quorumSig;
+            bool ok = quorumSig.Recover(thresholdSigs, ids);
+            ok &= membersSig.IsValid() && quorumSig.VerifyInsecure((*quorumVvec)[0], commitmentHash);
+            assert(ok);
+        }
+    }
+};
+
+static std::shared_ptr<DKGRound> dkgRound50;
+static std::shared_ptr<DKGRound> dkgRound400;
+
+static void InitRoundIfNeeded(int quorumSize)
+{
+    // sizes and thresholds of llmq_50_60 and llmq_400_60
+    if (quorumSize == 50 && dkgRound50 == nullptr) {
+        dkgRound50 = std::make_shared<DKGRound>(50, 30, 2);
+    }
+    if (quorumSize == 400 && dkgRound400 == nullptr) {
+        dkgRound400 = std::make_shared<DKGRound>(400, 240, 5);
+    }
+}
+
+void CleanupBLSDkgRoundTests()
+{
+    dkgRound50.reset();
+    dkgRound400.reset();
+}
+
+#define BENCH_DKGRound(phase, quorumSize) \
+    static void BLSDKGRound_##phase##_##quorumSize(benchmark::State& state) \
+    { \
+        InitRoundIfNeeded(quorumSize); \
+        dkgRound##quorumSize->Bench_##phase(state); \
+    } \
+    BENCHMARK(BLSDKGRound_##phase##_##quorumSize)
+
+BENCH_DKGRound(Contribute, 50)
+BENCH_DKGRound(Contribute, 400)
+BENCH_DKGRound(VerifyContributions, 50)
+BENCH_DKGRound(VerifyContributions, 400)
+BENCH_DKGRound(VerifyJustifications, 50)
+BENCH_DKGRound(VerifyJustifications, 400)
+BENCH_DKGRound(Commit, 50)
+BENCH_DKGRound(Commit, 400)
+BENCH_DKGRound(VerifyPrematureCommitments, 50)
+BENCH_DKGRound(VerifyPrematureCommitments, 400)
+BENCH_DKGRound(FinalizeCommitments, 50)
+BENCH_DKGRound(FinalizeCommitments, 400)
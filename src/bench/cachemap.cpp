@@ -0,0 +1,73 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "arith_uint256.h"
+#include "bench.h"
+#include "cachemap.h"
+#include "cachemultimap.h"
+#include "uint256.h"
+
+#include <vector>
+
+static std::vector<uint256> MakeHashes(size_t nCount)
+{
+    std::vector<uint256> vecHashes(nCount);
+    for (size_t i = 0; i < nCount; i++) {
+        // cheap but well distributed keys
+        vecHashes[i] = ArithToUint256(arith_uint256(i + 1) * arith_uint256("0x9e3779b97f4a7c15f39cc0605cedc835"));
+    }
+    return vecHashes;
+}
+
+// Lookups of known and unknown votes, like done for every vote inv
+static void CacheMapLookup(benchmark::State& state)
+{
+    std::vector<uint256> vecHashes = MakeHashes(200000);
+    CacheMap<uint256, int> cmap(100000);
+    for (size_t i = 0; i < 100000; i++) {
+        cmap.Insert(vecHashes[i], i);
+    }
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        for (int j = 0; j < 1000; j++) {
+            cmap.HasKey(vecHashes[i++ % vecHashes.size()]);
+        }
+    }
+}
+
+// Inserts into a full cache, each of them prunes the oldest item
+static void CacheMapInsertPrune(benchmark::State& state)
+{
+    std::vector<uint256> vecHashes = MakeHashes(200000);
+    CacheMap<uint256, int> cmap(10000);
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        for (int j = 0; j < 1000; j++) {
+            cmap.Insert(vecHashes[i++ % vecHashes.size()], j);
+        }
+    }
+}
+
+// Orphan votes, a few per object
+static void CacheMultiMapInsertErase(benchmark::State& state)
+{
+    std::vector<uint256> vecHashes = MakeHashes(10000);
+    CacheMultiMap<uint256, int> cmmap(20000);
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        for (int j = 0; j < 1000; j++, i++) {
+            cmmap.Insert(vecHashes[i % vecHashes.size()], (int)(i % 7));
+            if (i % 3 == 0) {
+                cmmap.Erase(vecHashes[(i / 3) % vecHashes.size()]);
+            }
+        }
+    }
+}
+
+BENCHMARK(CacheMapLookup);
+BENCHMARK(CacheMapInsertPrune);
+BENCHMARK(CacheMultiMapInsertErase);
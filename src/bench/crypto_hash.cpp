@@ -71,6 +71,14 @@ static void HASH_DSHA256_0032b(benchmark::State& state)
     }
 }
 
+static void HASH_SHA256D64_1024(benchmark::State& state)
+{
+    std::vector<uint8_t> in(64 * 1024, 0);
+    while (state.KeepRunning()) {
+        SHA256D64(in.data(), in.data(), 1024);
+    }
+}
+
 static void HASH_SHA512(benchmark::State& state)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -196,6 +204,7 @@ BENCHMARK(HASH_SHA512);
 
 BENCHMARK(HASH_SHA256_0032b);
 BENCHMARK(HASH_DSHA256_0032b);
+BENCHMARK(HASH_SHA256D64_1024);
 BENCHMARK(HASH_SipHash_0032b);
 
 BENCHMARK(HASH_DSHA256_0032b_single);
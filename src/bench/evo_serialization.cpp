@@ -0,0 +1,338 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "governance-object.h"
+#include "governance-vote.h"
+#include "hash.h"
+#include "netbase.h"
+#include "script/standard.h"
+#include "streams.h"
+#include "tinyformat.h"
+#include "utilstrencodings.h"
+#include "version.h"
+
+#include "evo/cbtx.h"
+#include "evo/deterministicmns.h"
+#include "evo/providertx.h"
+#include "evo/simplifiedmns.h"
+#include "llmq/quorums_commitment.h"
+#include "llmq/quorums_instantsend.h"
+#include "llmq/quorums_signing_shares.h"
+
+#include <vector>
+
+// Enough objects per iteration to get past the per-object overhead of the benchmark loop
+static const int BENCH_OBJECTS = 1000;
+static const int BENCH_MASTERNODES = 1000;
+// The members of the largest LLMQ
+static const int BENCH_QUORUM_SIZE = 400;
+
+static uint256 MakeHash(uint32_t n, uint32_t nSalt)
+{
+    return (CHashWriter(SER_GETHASH, 0) << n << nSalt).GetHash();
+}
+
+static CKeyID MakeKeyID(uint32_t n, uint32_t nSalt)
+{
+    uint256 hash = MakeHash(n, nSalt);
+    return CKeyID(Hash160(hash.begin(), hash.end()));
+}
+
+static CService MakeService(uint32_t n)
+{
+    CService addr;
+    Lookup(strprintf("10.%d.%d.%d", (n >> 16) & 0xff, (n >> 8) & 0xff, n & 0xff).c_str(), addr, 10101, false);
+    return addr;
+}
+
+// Fill an object with bytes that look random by reading it from a stream, this is how BLS keys
+// and signatures get into the lazy wrappers when read from the network or the disk
+template <typename T>
+static void ReadRandomBytes(T& obj, size_t nSize, uint32_t n)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    for (uint32_t i = 0; ss.size() < nSize; i++) {
+        ss << MakeHash(n, i);
+    }
+    ss.resize(nSize);
+    ss >> obj;
+}
+
+static std::string MakeIPFSPeerID(uint32_t n)
+{
+    // the size of a base58 encoded IPFS peer ID
+    return ("Qm" + MakeHash(n, 3).ToString()).substr(0, 46);
+}
+
+static CProRegTx MakeProRegTx(uint32_t n)
+{
+    CProRegTx proTx;
+    proTx.collateralOutpoint = COutPoint(MakeHash(n, 0), n % 2);
+    proTx.addr = MakeService(n);
+    proTx.keyIDOwner = MakeKeyID(n, 1);
+    ReadRandomBytes(proTx.pubKeyOperator, CBLSPublicKey::SerSize, n);
+    proTx.keyIDVoting = MakeKeyID(n, 2);
+    proTx.nOperatorReward = n % 10000;
+    proTx.scriptPayout = GetScriptForDestination(MakeKeyID(n, 4));
+    proTx.inputsHash = MakeHash(n, 5);
+    // the size of a compact signature of the collateral key
+    proTx.vchSig.assign(65, (unsigned char)n);
+    proTx.IPFSPeerID = MakeIPFSPeerID(n);
+    proTx.Identity = strprintf("masternode-%d.historia.network", n);
+    return proTx;
+}
+
+static CProUpServTx MakeProUpServTx(uint32_t n)
+{
+    CProUpServTx proTx;
+    proTx.proTxHash = MakeHash(n, 0);
+    proTx.addr = MakeService(n);
+    proTx.scriptOperatorPayout = GetScriptForDestination(MakeKeyID(n, 4));
+    proTx.inputsHash = MakeHash(n, 5);
+    ReadRandomBytes(proTx.sig, CBLSSignature::SerSize, n);
+    proTx.IPFSPeerID = MakeIPFSPeerID(n);
+    proTx.Identity = strprintf("masternode-%d.historia.network", n);
+    return proTx;
+}
+
+static CCbTx MakeCbTx(uint32_t n)
+{
+    CCbTx cbTx;
+    cbTx.nHeight = n;
+    cbTx.merkleRootMNList = MakeHash(n, 0);
+    cbTx.merkleRootQuorums = MakeHash(n, 1);
+    return cbTx;
+}
+
+static llmq::CFinalCommitment MakeCommitment(uint32_t n)
+{
+    llmq::CFinalCommitment qc;
+    qc.llmqType = Consensus::LLMQ_400_60;
+    qc.quorumHash = MakeHash(n, 0);
+    qc.signers.resize(BENCH_QUORUM_SIZE);
+    qc.validMembers.resize(BENCH_QUORUM_SIZE);
+    for (int i = 0; i < BENCH_QUORUM_SIZE; i++) {
+        qc.signers[i] = (i + n) % 7 != 0;
+        qc.validMembers[i] = (i + n) % 11 != 0;
+    }
+    ReadRandomBytes(qc.quorumPublicKey, CBLSPublicKey::SerSize, n);
+    qc.quorumVvecHash = MakeHash(n, 1);
+    ReadRandomBytes(qc.quorumSig, CBLSSignature::SerSize, n + 1);
+    ReadRandomBytes(qc.membersSig, CBLSSignature::SerSize, n + 2);
+    return qc;
+}
+
+static llmq::CBatchedSigShares MakeBatchedSigShares(uint32_t n)
+{
+    llmq::CBatchedSigShares batched;
+    batched.sessionId = n;
+    // the shares of a batch are of the members of one quorum, 32 of them roughly fill one message
+    for (uint16_t i = 0; i < 32; i++) {
+        CBLSLazySignature sig;
+        ReadRandomBytes(sig, CBLSSignature::SerSize, n * 32 + i);
+        batched.sigShares.emplace_back(i * 7, sig);
+    }
+    return batched;
+}
+
+static llmq::CInstantSendLock MakeInstantSendLock(uint32_t n)
+{
+    llmq::CInstantSendLock islock;
+    islock.inputs.emplace_back(MakeHash(n, 0), 0);
+    islock.inputs.emplace_back(MakeHash(n, 1), 1);
+    islock.txid = MakeHash(n, 2);
+    ReadRandomBytes(islock.sig, CBLSSignature::SerSize, n);
+    return islock;
+}
+
+static CGovernanceObject MakeGovernanceObject(uint32_t n)
+{
+    std::string strData = strprintf("{\"end_epoch\":%d,\"name\":\"bench-proposal-%d\",\"payment_address\":\"XpG61qAVhdyN7AqVZQsHfJL7AEk4dPVinc\","
+                                    "\"payment_amount\":25.75,\"start_epoch\":1474261086,\"type\":1,\"url\":\"http://historia.network/bench-proposal-%d\","
+                                    "\"ipfscid\":\"%s\",\"summary\":{\"name\":\"Proposal %d\",\"description\":\"Synthetic proposal for benchmarking\"}}",
+        1491368400 + n, n, n, MakeIPFSPeerID(n), n);
+    CGovernanceObject govobj(uint256(), 1, 1474261086 + n, MakeHash(n, 0), HexStr(strData));
+    govobj.SetMasternodeOutpoint(COutPoint(MakeHash(n, 1), 0));
+    return govobj;
+}
+
+static CGovernanceVote MakeGovernanceVote(uint32_t n)
+{
+    CGovernanceVote vote(COutPoint(MakeHash(n, 0), n % 2), MakeHash(n % 10, 1), VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES);
+    vote.SetTime(1474261086 + n);
+    // the size of a BLS signature
+    vote.SetSignature(std::vector<unsigned char>(96, (unsigned char)n));
+    return vote;
+}
+
+static CDeterministicMNList MakeMNList()
+{
+    CDeterministicMNList mnList(MakeHash(0, 10), 100000, BENCH_MASTERNODES);
+    for (uint32_t i = 0; i < BENCH_MASTERNODES; i++) {
+        CProRegTx proTx = MakeProRegTx(i);
+        auto dmn = std::make_shared<CDeterministicMN>();
+        dmn->proTxHash = MakeHash(i, 6);
+        dmn->internalId = i;
+        dmn->collateralOutpoint = proTx.collateralOutpoint;
+        dmn->nOperatorReward = proTx.nOperatorReward;
+        auto dmnState = std::make_shared<CDeterministicMNState>(proTx);
+        dmnState->nRegisteredHeight = i;
+        dmnState->confirmedHash = MakeHash(i, 7);
+        dmn->pdmnState = dmnState;
+        mnList.AddMN(dmn);
+    }
+    return mnList;
+}
+
+// The full list as sent to a light client starting from scratch, with the active quorums
+static CSimplifiedMNListDiff MakeSimplifiedMNListDiff()
+{
+    CSimplifiedMNListDiff mnListDiff = CDeterministicMNList().BuildSimplifiedDiff(MakeMNList());
+    mnListDiff.cbTx = MakeTransactionRef();
+    for (uint32_t i = 0; i < 24; i++) {
+        mnListDiff.newQuorums.emplace_back(MakeCommitment(i));
+    }
+    return mnListDiff;
+}
+
+template <typename T, typename Make>
+static std::vector<T> MakeObjects(Make make, int nCount = BENCH_OBJECTS)
+{
+    std::vector<T> vecObjects;
+    vecObjects.reserve(nCount);
+    for (int i = 0; i < nCount; i++) {
+        vecObjects.emplace_back(make(i));
+    }
+    return vecObjects;
+}
+
+template <typename T>
+static void SerializeObjects(benchmark::State& state, const std::vector<T>& vecObjects)
+{
+    std::vector<unsigned char> vch;
+    while (state.KeepRunning()) {
+        for (const auto& obj : vecObjects) {
+            vch.clear();
+            CVectorWriter vw(SER_NETWORK, PROTOCOL_VERSION, vch, 0);
+            vw << obj;
+        }
+    }
+}
+
+template <typename T>
+static void DeserializeObjects(benchmark::State& state, const std::vector<T>& vecObjects)
+{
+    std::vector<std::vector<unsigned char>> vecSerialized;
+    for (const auto& obj : vecObjects) {
+        vecSerialized.emplace_back();
+        CVectorWriter vw(SER_NETWORK, PROTOCOL_VERSION, vecSerialized.back(), 0);
+        vw << obj;
+    }
+
+    while (state.KeepRunning()) {
+        for (const auto& vch : vecSerialized) {
+            CSpanReader s(SER_NETWORK, PROTOCOL_VERSION, vch.data(), vch.size());
+            T obj;
+            s >> obj;
+        }
+    }
+}
+
+template <typename T>
+static void HashObjects(benchmark::State& state, const std::vector<T>& vecObjects)
+{
+    while (state.KeepRunning()) {
+        for (const auto& obj : vecObjects) {
+            ::SerializeHash(obj);
+        }
+    }
+}
+
+static void ProRegTxSerialize(benchmark::State& state) { SerializeObjects(state, MakeObjects<CProRegTx>(MakeProRegTx)); }
+static void ProRegTxDeserialize(benchmark::State& state) { DeserializeObjects(state, MakeObjects<CProRegTx>(MakeProRegTx)); }
+static void ProRegTxHash(benchmark::State& state) { HashObjects(state, MakeObjects<CProRegTx>(MakeProRegTx)); }
+
+static void ProUpServTxSerialize(benchmark::State& state) { SerializeObjects(state, MakeObjects<CProUpServTx>(MakeProUpServTx)); }
+static void ProUpServTxDeserialize(benchmark::State& state) { DeserializeObjects(state, MakeObjects<CProUpServTx>(MakeProUpServTx)); }
+static void ProUpServTxHash(benchmark::State& state) { HashObjects(state, MakeObjects<CProUpServTx>(MakeProUpServTx)); }
+
+static void CbTxSerialize(benchmark::State& state) { SerializeObjects(state, MakeObjects<CCbTx>(MakeCbTx)); }
+static void CbTxDeserialize(benchmark::State& state) { DeserializeObjects(state, MakeObjects<CCbTx>(MakeCbTx)); }
+static void CbTxHash(benchmark::State& state) { HashObjects(state, MakeObjects<CCbTx>(MakeCbTx)); }
+
+static void FinalCommitmentSerialize(benchmark::State& state) { SerializeObjects(state, MakeObjects<llmq::CFinalCommitment>(MakeCommitment, 100)); }
+static void FinalCommitmentDeserialize(benchmark::State& state) { DeserializeObjects(state, MakeObjects<llmq::CFinalCommitment>(MakeCommitment, 100)); }
+static void FinalCommitmentHash(benchmark::State& state) { HashObjects(state, MakeObjects<llmq::CFinalCommitment>(MakeCommitment, 100)); }
+
+static void BatchedSigSharesSerialize(benchmark::State& state) { SerializeObjects(state, MakeObjects<llmq::CBatchedSigShares>(MakeBatchedSigShares, 100)); }
+static void BatchedSigSharesDeserialize(benchmark::State& state) { DeserializeObjects(state, MakeObjects<llmq::CBatchedSigShares>(MakeBatchedSigShares, 100)); }
+
+static void InstantSendLockSerialize(benchmark::State& state) { SerializeObjects(state, MakeObjects<llmq::CInstantSendLock>(MakeInstantSendLock)); }
+static void InstantSendLockDeserialize(benchmark::State& state) { DeserializeObjects(state, MakeObjects<llmq::CInstantSendLock>(MakeInstantSendLock)); }
+static void InstantSendLockHash(benchmark::State& state) { HashObjects(state, MakeObjects<llmq::CInstantSendLock>(MakeInstantSendLock)); }
+
+static void GovernanceObjectSerialize(benchmark::State& state) { SerializeObjects(state, MakeObjects<CGovernanceObject>(MakeGovernanceObject, 100)); }
+static void GovernanceObjectDeserialize(benchmark::State& state) { DeserializeObjects(state, MakeObjects<CGovernanceObject>(MakeGovernanceObject, 100)); }
+
+static void GovernanceObjectHash(benchmark::State& state)
+{
+    std::vector<CGovernanceObject> vecObjects = MakeObjects<CGovernanceObject>(MakeGovernanceObject, 100);
+    while (state.KeepRunning()) {
+        for (const auto& govobj : vecObjects) {
+            govobj.GetHash();
+        }
+    }
+}
+
+static void GovernanceVoteSerialize(benchmark::State& state) { SerializeObjects(state, MakeObjects<CGovernanceVote>(MakeGovernanceVote)); }
+static void GovernanceVoteDeserialize(benchmark::State& state) { DeserializeObjects(state, MakeObjects<CGovernanceVote>(MakeGovernanceVote)); }
+
+static void GovernanceVoteHash(benchmark::State& state)
+{
+    std::vector<CGovernanceVote> vecVotes = MakeObjects<CGovernanceVote>(MakeGovernanceVote);
+    while (state.KeepRunning()) {
+        for (const auto& vote : vecVotes) {
+            vote.GetHash();
+        }
+    }
+}
+
+// A whole list and a whole diff, they are read and written once per block and per light client sync
+static void SimplifiedMNListDiffSerialize(benchmark::State& state) { SerializeObjects(state, std::vector<CSimplifiedMNListDiff>{MakeSimplifiedMNListDiff()}); }
+static void SimplifiedMNListDiffDeserialize(benchmark::State& state) { DeserializeObjects(state, std::vector<CSimplifiedMNListDiff>{MakeSimplifiedMNListDiff()}); }
+
+static void DeterministicMNListSerialize(benchmark::State& state) { SerializeObjects(state, std::vector<CDeterministicMNList>{MakeMNList()}); }
+static void DeterministicMNListDeserialize(benchmark::State& state) { DeserializeObjects(state, std::vector<CDeterministicMNList>{MakeMNList()}); }
+static void DeterministicMNListHash(benchmark::State& state) { HashObjects(state, std::vector<CDeterministicMNList>{MakeMNList()}); }
+
+BENCHMARK(ProRegTxSerialize);
+BENCHMARK(ProRegTxDeserialize);
+BENCHMARK(ProRegTxHash);
+BENCHMARK(ProUpServTxSerialize);
+BENCHMARK(ProUpServTxDeserialize);
+BENCHMARK(ProUpServTxHash);
+BENCHMARK(CbTxSerialize);
+BENCHMARK(CbTxDeserialize);
+BENCHMARK(CbTxHash);
+BENCHMARK(FinalCommitmentSerialize);
+BENCHMARK(FinalCommitmentDeserialize);
+BENCHMARK(FinalCommitmentHash);
+BENCHMARK(BatchedSigSharesSerialize);
+BENCHMARK(BatchedSigSharesDeserialize);
+BENCHMARK(InstantSendLockSerialize);
+BENCHMARK(InstantSendLockDeserialize);
+BENCHMARK(InstantSendLockHash);
+BENCHMARK(GovernanceObjectSerialize);
+BENCHMARK(GovernanceObjectDeserialize);
+BENCHMARK(GovernanceObjectHash);
+BENCHMARK(GovernanceVoteSerialize);
+BENCHMARK(GovernanceVoteDeserialize);
+BENCHMARK(GovernanceVoteHash);
+BENCHMARK(SimplifiedMNListDiffSerialize);
+BENCHMARK(SimplifiedMNListDiffDeserialize);
+BENCHMARK(DeterministicMNListSerialize);
+BENCHMARK(DeterministicMNListDeserialize);
+BENCHMARK(DeterministicMNListHash);
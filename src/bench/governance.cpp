@@ -0,0 +1,219 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "base58.h"
+#include "chainparams.h"
+#include "governance.h"
+#include "governance-payload.h"
+#include "governance-validators.h"
+#include "governance-vote.h"
+#include "governance-votedb.h"
+#include "hash.h"
+#include "ipfs-utils.h"
+#include "streams.h"
+#include "tinyformat.h"
+#include "version.h"
+
+#include <univalue.h>
+
+#include <vector>
+
+// A superblock's worth of governance state: objects voted on by every masternode
+static const int BENCH_OBJECTS = 10;
+static const int BENCH_MASTERNODES = 1000;
+static const int BENCH_RECORDS = 10000;
+
+static uint256 MakeHash(uint32_t n, uint32_t nSalt)
+{
+    return (CHashWriter(SER_GETHASH, 0) << n << nSalt).GetHash();
+}
+
+static std::vector<COutPoint> MakeMasternodes()
+{
+    std::vector<COutPoint> vecOutpoints;
+    for (int i = 0; i < BENCH_MASTERNODES; i++) {
+        vecOutpoints.emplace_back(MakeHash(i, 1), i % 2);
+    }
+    return vecOutpoints;
+}
+
+static CGovernanceVote MakeVote(const COutPoint& outpoint, const uint256& nParentHash, vote_signal_enum_t eSignal, vote_outcome_enum_t eOutcome, int64_t nTime)
+{
+    CGovernanceVote vote(outpoint, nParentHash, eSignal, eOutcome);
+    vote.SetTime(nTime);
+    // the size of a BLS signature
+    vote.SetSignature(std::vector<unsigned char>(96, (unsigned char)nTime));
+    return vote;
+}
+
+// Votes of all masternodes on one object, each masternode changes its funding vote once
+static std::vector<CGovernanceVote> MakeVotes(const std::vector<COutPoint>& vecOutpoints, const uint256& nParentHash)
+{
+    std::vector<CGovernanceVote> vecVotes;
+    for (const auto& outpoint : vecOutpoints) {
+        vecVotes.push_back(MakeVote(outpoint, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES, 1000));
+    }
+    for (const auto& outpoint : vecOutpoints) {
+        vecVotes.push_back(MakeVote(outpoint, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO, 2000));
+    }
+    return vecVotes;
+}
+
+static CGovernanceObjectVoteFile MakeVoteFile(const std::vector<CGovernanceVote>& vecVotes)
+{
+    CGovernanceObjectVoteFile file;
+    for (const auto& vote : vecVotes) {
+        file.AddVote(vote);
+    }
+    return file;
+}
+
+static std::string MakeIpfsCID(uint32_t n)
+{
+    uint256 hash = MakeHash(n, 2);
+    // CID v0: "Qm" followed by 44 base58 characters
+    return ("Qm" + EncodeBase58(hash.begin(), hash.end()) + "11").substr(0, 46);
+}
+
+// Ingest of the votes of all masternodes on several objects, including vote replacement
+static void GovernanceVoteFileAddVote(benchmark::State& state)
+{
+    std::vector<COutPoint> vecOutpoints = MakeMasternodes();
+    std::vector<std::vector<CGovernanceVote> > vecObjectVotes;
+    for (int i = 0; i < BENCH_OBJECTS; i++) {
+        vecObjectVotes.push_back(MakeVotes(vecOutpoints, MakeHash(i, 0)));
+    }
+
+    while (state.KeepRunning()) {
+        for (const auto& vecVotes : vecObjectVotes) {
+            MakeVoteFile(vecVotes);
+        }
+    }
+}
+
+// Serialization of whole vote files, like done when flushing governance to disk
+static void GovernanceVoteFileSerialize(benchmark::State& state)
+{
+    CGovernanceObjectVoteFile file = MakeVoteFile(MakeVotes(MakeMasternodes(), MakeHash(0, 0)));
+
+    while (state.KeepRunning()) {
+        CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+        ss << file;
+    }
+}
+
+// Serving single votes to syncing peers, one lookup and serialization per inv
+static void GovernanceVoteFileServeVotes(benchmark::State& state)
+{
+    std::vector<CGovernanceVote> vecVotes = MakeVotes(MakeMasternodes(), MakeHash(0, 0));
+    CGovernanceObjectVoteFile file = MakeVoteFile(vecVotes);
+    std::vector<uint256> vecHashes;
+    for (size_t i = vecVotes.size() / 2; i < vecVotes.size(); i++) {
+        vecHashes.push_back(vecVotes[i].GetHash());
+    }
+
+    std::vector<unsigned char> vch;
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        for (int j = 0; j < 1000; j++) {
+            vch.clear();
+            CVectorWriter vw(SER_NETWORK, PROTOCOL_VERSION, vch, 0);
+            file.SerializeVoteToStream(vecHashes[i++ % vecHashes.size()], vw);
+        }
+    }
+}
+
+// Cleanup of the votes of masternodes which left the list, and the votes coming back
+static void GovernanceVoteFileRemoveMasternode(benchmark::State& state)
+{
+    std::vector<COutPoint> vecOutpoints = MakeMasternodes();
+    std::vector<CGovernanceVote> vecVotes = MakeVotes(vecOutpoints, MakeHash(0, 0));
+    CGovernanceObjectVoteFile file = MakeVoteFile(vecVotes);
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        for (int j = 0; j < 10; j++, i++) {
+            size_t nMasternode = i % vecOutpoints.size();
+            file.RemoveVotesFromMasternode(vecOutpoints[nMasternode]);
+            file.AddVote(vecVotes[vecOutpoints.size() + nMasternode]);
+        }
+    }
+}
+
+// Parsing and validation of proposal payloads, like done for every object on arrival and on cleanup
+static void GovernanceProposalValidate(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+
+    std::vector<std::vector<unsigned char> > vecPayloads;
+    for (int i = 0; i < BENCH_OBJECTS; i++) {
+        UniValue summary(UniValue::VOBJ);
+        summary.push_back(Pair("name", strprintf("Proposal %d", i)));
+        summary.push_back(Pair("description", "Synthetic proposal for benchmarking"));
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("end_epoch", 1491368400 + i));
+        obj.push_back(Pair("name", strprintf("bench-proposal-%d", i)));
+        obj.push_back(Pair("payment_address", "XpG61qAVhdyN7AqVZQsHfJL7AEk4dPVinc"));
+        obj.push_back(Pair("payment_amount", 25.75));
+        obj.push_back(Pair("start_epoch", 1474261086));
+        obj.push_back(Pair("type", 1));
+        obj.push_back(Pair("url", strprintf("http://historia.network/bench-proposal-%d", i)));
+        obj.push_back(Pair("ipfscid", MakeIpfsCID(i)));
+        // the validator expects the summary last
+        obj.push_back(Pair("summary", summary));
+        std::string strData = obj.write();
+        vecPayloads.emplace_back(strData.begin(), strData.end());
+    }
+
+    bool fValid = false;
+    while (state.KeepRunning()) {
+        for (const auto& vchData : vecPayloads) {
+            // a fresh payload parses and checks the data again
+            CGovernanceObjectPayload payload(vchData);
+            CProposalValidator validator(payload, false);
+            fValid |= validator.Validate(false);
+        }
+    }
+    assert(fValid);
+}
+
+// Duplicate CID checks of new records against all known records
+static void GovernanceIpfsIdDuplicate(benchmark::State& state)
+{
+    // The CID index is the last thing in the serialized governance state. Load a state
+    // with an empty one replaced by the synthetic index.
+    CGovernanceManager::cid_hash_m_t mapCIDs;
+    for (int i = 0; i < BENCH_RECORDS; i++) {
+        mapCIDs.emplace(MakeIpfsCID(i), MakeHash(i, 0));
+    }
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << governance;
+    assert(ss[ss.size() - 1] == 0);
+    ss.resize(ss.size() - 1);
+    ss << mapCIDs;
+    ss >> governance;
+
+    std::vector<std::string> vecLookups;
+    for (int i = 0; i < 2 * BENCH_RECORDS; i++) {
+        vecLookups.push_back(MakeIpfsCID(i * 7));
+    }
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        for (int j = 0; j < 1000; j++) {
+            IsIpfsIdDuplicate(vecLookups[i++ % vecLookups.size()]);
+        }
+    }
+
+    governance.Clear();
+}
+
+BENCHMARK(GovernanceVoteFileAddVote);
+BENCHMARK(GovernanceVoteFileSerialize);
+BENCHMARK(GovernanceVoteFileServeVotes);
+BENCHMARK(GovernanceVoteFileRemoveMasternode);
+BENCHMARK(GovernanceProposalValidate);
+BENCHMARK(GovernanceIpfsIdDuplicate);
@@ -0,0 +1,151 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "algo/hash_algos.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "uint256.h"
+
+#include <vector>
+
+// hashPrevBlock values which select the algorithms in different orders
+static std::vector<uint256> GetPrevBlockHashes()
+{
+    FastRandomContext ctx(true);
+    std::vector<uint256> vHashes(16);
+    for (auto& hash : vHashes) {
+        for (unsigned char* p = hash.begin(); p != hash.end(); p++) {
+            *p = ctx.rand32();
+        }
+    }
+    return vHashes;
+}
+
+static void X16RRound(benchmark::State& state, int hashSelection, bool fV2, size_t nSize)
+{
+    std::vector<unsigned char> in(nSize, 0);
+    uint512 hash;
+    sph_x16r_context ctx;
+    while (state.KeepRunning()) {
+        X16RRoundInit(ctx, hashSelection, fV2);
+        X16RRoundUpdate(ctx, hashSelection, fV2, in.data(), in.size());
+        X16RRoundClose(ctx, hashSelection, fV2, hash);
+        in[0] = *hash.begin();
+    }
+}
+
+#define BENCH_X16R_ROUND(name, selection) \
+    static void X16R_##name##_0064b(benchmark::State& state) { X16RRound(state, selection, false, 64); } \
+    static void X16R_##name##_0080b(benchmark::State& state) { X16RRound(state, selection, false, 80); } \
+    BENCHMARK(X16R_##name##_0064b); \
+    BENCHMARK(X16R_##name##_0080b);
+
+BENCH_X16R_ROUND(blake512, 0)
+BENCH_X16R_ROUND(bmw512, 1)
+BENCH_X16R_ROUND(groestl512, 2)
+BENCH_X16R_ROUND(jh512, 3)
+BENCH_X16R_ROUND(keccak512, 4)
+BENCH_X16R_ROUND(skein512, 5)
+BENCH_X16R_ROUND(luffa512, 6)
+BENCH_X16R_ROUND(cubehash512, 7)
+BENCH_X16R_ROUND(shavite512, 8)
+BENCH_X16R_ROUND(simd512, 9)
+BENCH_X16R_ROUND(echo512, 10)
+BENCH_X16R_ROUND(hamsi512, 11)
+BENCH_X16R_ROUND(fugue512, 12)
+BENCH_X16R_ROUND(shabal512, 13)
+BENCH_X16R_ROUND(whirlpool, 14)
+BENCH_X16R_ROUND(sha512, 15)
+
+// X16RV2 prefixes these three with tiger
+static void X16RV2_tiger_keccak512_0064b(benchmark::State& state) { X16RRound(state, 4, true, 64); }
+static void X16RV2_tiger_luffa512_0064b(benchmark::State& state) { X16RRound(state, 6, true, 64); }
+static void X16RV2_tiger_sha512_0064b(benchmark::State& state) { X16RRound(state, 15, true, 64); }
+
+static void HASH_X16R_0080b(benchmark::State& state)
+{
+    std::vector<uint256> vPrevBlockHashes = GetPrevBlockHashes();
+    std::vector<unsigned char> in(80, 0);
+    size_t i = 0;
+    uint256 hash;
+    while (state.KeepRunning()) {
+        hash = HashX16R(in.begin(), in.end(), vPrevBlockHashes[i++ % vPrevBlockHashes.size()]);
+        in[0] = *hash.begin();
+    }
+}
+
+static void HASH_X16RV2_0080b(benchmark::State& state)
+{
+    std::vector<uint256> vPrevBlockHashes = GetPrevBlockHashes();
+    std::vector<unsigned char> in(80, 0);
+    size_t i = 0;
+    uint256 hash;
+    while (state.KeepRunning()) {
+        hash = HashX16RV2(in.begin(), in.end(), vPrevBlockHashes[i++ % vPrevBlockHashes.size()]);
+        in[0] = *hash.begin();
+    }
+}
+
+static void HASH_X16RV2_Hasher(benchmark::State& state)
+{
+    std::vector<unsigned char> in(80, 0);
+    CX16RHasher hasher(in.begin(), in.end(), GetPrevBlockHashes()[0], true);
+    uint32_t nNonce = 0;
+    while (state.KeepRunning()) {
+        hasher.Hash(nNonce++);
+    }
+}
+
+// 64 headers per iteration, hashed one by one and as a batch
+static void X16RV2Headers(benchmark::State& state, bool fBatch)
+{
+    std::vector<uint256> vPrevBlockHashes = GetPrevBlockHashes();
+    std::vector<unsigned char> in(80 * 64, 0);
+    std::vector<X16RBatchInput> vInputs;
+    for (size_t i = 0; i < 64; i++) {
+        in[i * 80] = i;
+        vInputs.push_back(X16RBatchInput{&in[i * 80], 80, vPrevBlockHashes[i % vPrevBlockHashes.size()], true});
+    }
+    std::vector<uint256> vHashes(vInputs.size());
+    while (state.KeepRunning()) {
+        if (fBatch) {
+            HashX16RBatch(vInputs.data(), vInputs.size(), vHashes.data());
+        } else {
+            for (size_t i = 0; i < vInputs.size(); i++) {
+                vHashes[i] = HashX16RV2(vInputs[i].pdata, vInputs[i].pdata + vInputs[i].nLen, vInputs[i].PrevBlockHash);
+            }
+        }
+        in[1] = *vHashes[0].begin();
+    }
+}
+
+static void HASH_X16RV2_64Headers(benchmark::State& state) { X16RV2Headers(state, false); }
+static void HASH_X16RV2_64HeadersBatch(benchmark::State& state) { X16RV2Headers(state, true); }
+
+static void HASH_BlockHeader(benchmark::State& state)
+{
+    std::vector<uint256> vPrevBlockHashes = GetPrevBlockHashes();
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.nTime = 1577836800;
+    header.nBits = 0x1e0ffff0;
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        header.hashPrevBlock = vPrevBlockHashes[i++ % vPrevBlockHashes.size()];
+        header.nNonce++;
+        header.GetHash();
+    }
+}
+
+BENCHMARK(X16RV2_tiger_keccak512_0064b);
+BENCHMARK(X16RV2_tiger_luffa512_0064b);
+BENCHMARK(X16RV2_tiger_sha512_0064b);
+
+BENCHMARK(HASH_X16R_0080b);
+BENCHMARK(HASH_X16RV2_0080b);
+BENCHMARK(HASH_X16RV2_Hasher);
+BENCHMARK(HASH_X16RV2_64Headers);
+BENCHMARK(HASH_X16RV2_64HeadersBatch);
+BENCHMARK(HASH_BlockHeader);
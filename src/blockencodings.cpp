@@ -13,6 +13,8 @@
 #include "validation.h"
 #include "util.h"
 
+#include <atomic>
+#include <thread>
 #include <unordered_map>
 
 #define MIN_TRANSACTION_SIZE (::GetSerializeSize(CTransaction(), SER_NETWORK, PROTOCOL_VERSION))
@@ -47,6 +49,30 @@ uint64_t CBlockHeaderAndShortTxIDs::GetShortID(const uint256& txhash) const {
 
 
 
+/** Don't start another thread for matching short ids for less than this many mempool transactions */
+static const size_t MIN_TXHASHES_PER_MATCH_THREAD = 8192;
+/** Maximum number of threads used for matching short ids */
+static const int MAX_MATCH_THREADS = 8;
+
+// Find the mempool transactions vTxHashes[nBegin, nEnd) whose short ids are part of the compact block
+static void MatchShortIDs(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::unordered_map<uint64_t, uint16_t>& shorttxids,
+                          const std::vector<std::pair<uint256, CTxMemPool::txiter> >& vTxHashes, size_t nBegin, size_t nEnd,
+                          std::atomic<size_t>& nMatches, std::vector<std::pair<size_t, uint16_t> >& vMatchesRet)
+{
+    for (size_t i = nBegin; i < nEnd; i++) {
+        std::unordered_map<uint64_t, uint16_t>::const_iterator idit = shorttxids.find(cmpctblock.GetShortID(vTxHashes[i].first));
+        if (idit != shorttxids.end()) {
+            vMatchesRet.emplace_back(i, idit->second);
+            nMatches++;
+        }
+        // Though ideally we'd continue scanning for the two-txn-match-shortid case,
+        // the performance win of an early exit here is too good to pass up and worth
+        // the extra risk.
+        if (nMatches.load(std::memory_order_relaxed) >= shorttxids.size())
+            break;
+    }
+}
+
 ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn) {
     if (cmpctblock.header.IsNull() || (cmpctblock.shorttxids.empty() && cmpctblock.prefilledtxn.empty()))
         return READ_STATUS_INVALID;
@@ -107,29 +133,40 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
     {
     LOCK(pool->cs);
     const std::vector<std::pair<uint256, CTxMemPool::txiter> >& vTxHashes = pool->vTxHashes;
-    for (size_t i = 0; i < vTxHashes.size(); i++) {
-        uint64_t shortid = cmpctblock.GetShortID(vTxHashes[i].first);
-        std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
-        if (idit != shorttxids.end()) {
-            if (!have_txn[idit->second]) {
-                txn_available[idit->second] = vTxHashes[i].second->GetSharedTx();
-                have_txn[idit->second]  = true;
+
+    // Computing the short ids of a large mempool takes a while, so the scan is split over multiple
+    // threads. They only read vTxHashes and the short id map, which can't change while we hold pool->cs
+    size_t nThreads = std::min<size_t>(vTxHashes.size() / MIN_TXHASHES_PER_MATCH_THREAD, std::min(GetNumCores(), MAX_MATCH_THREADS));
+    nThreads = std::max<size_t>(nThreads, 1);
+    size_t nChunkSize = (vTxHashes.size() + nThreads - 1) / nThreads;
+    std::vector<std::vector<std::pair<size_t, uint16_t> > > vMatches(nThreads);
+    std::atomic<size_t> nMatches{0};
+    std::vector<std::thread> vThreads;
+    for (size_t i = 1; i < nThreads; i++) {
+        vThreads.emplace_back(MatchShortIDs, std::cref(cmpctblock), std::cref(shorttxids), std::cref(vTxHashes),
+                              i * nChunkSize, std::min(vTxHashes.size(), (i + 1) * nChunkSize), std::ref(nMatches), std::ref(vMatches[i]));
+    }
+    MatchShortIDs(cmpctblock, shorttxids, vTxHashes, 0, std::min(vTxHashes.size(), nChunkSize), nMatches, vMatches[0]);
+    for (auto& thread : vThreads) {
+        thread.join();
+    }
+
+    for (const auto& vThreadMatches : vMatches) {
+        for (const auto& match : vThreadMatches) {
+            if (!have_txn[match.second]) {
+                txn_available[match.second] = vTxHashes[match.first].second->GetSharedTx();
+                have_txn[match.second]  = true;
                 mempool_count++;
             } else {
                 // If we find two mempool txn that match the short id, just request it.
                 // This should be rare enough that the extra bandwidth doesn't matter,
                 // but eating a round-trip due to FillBlock failure would be annoying
-                if (txn_available[idit->second]) {
-                    txn_available[idit->second].reset();
+                if (txn_available[match.second]) {
+                    txn_available[match.second].reset();
                     mempool_count--;
                 }
             }
         }
-        // Though ideally we'd continue scanning for the two-txn-match-shortid case,
-        // the performance win of an early exit here is too good to pass up and worth
-        // the extra risk.
-        if (mempool_count == shorttxids.size())
-            break;
     }
     }
 
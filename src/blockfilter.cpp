@@ -0,0 +1,295 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilter.h"
+
+#include "coins.h"
+#include "hash.h"
+#include "primitives/block.h"
+#include "script/script.h"
+#include "streams.h"
+#include "undo.h"
+#include "version.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+// Writes the bits of the filter most significant first, as BIP158 specifies
+class CBitWriter
+{
+private:
+    std::vector<unsigned char>& vch;
+    uint8_t nBuffer;
+    int nOffset;
+
+public:
+    CBitWriter(std::vector<unsigned char>& vchIn) : vch(vchIn), nBuffer(0), nOffset(0) {}
+
+    // write the lowest nBits bits of nData
+    void Write(uint64_t nData, int nBits)
+    {
+        while (nBits > 0) {
+            int nChunk = std::min(8 - nOffset, nBits);
+            nBuffer |= (nData << (64 - nBits)) >> (64 - 8 + nOffset);
+            nOffset += nChunk;
+            nBits -= nChunk;
+            if (nOffset == 8) {
+                Flush();
+            }
+        }
+    }
+
+    void Flush()
+    {
+        if (nOffset == 0) {
+            return;
+        }
+        vch.push_back(nBuffer);
+        nBuffer = 0;
+        nOffset = 0;
+    }
+};
+
+class CBitReader
+{
+private:
+    CSpanReader& s;
+    uint8_t nBuffer;
+    int nOffset;
+
+public:
+    CBitReader(CSpanReader& sIn) : s(sIn), nBuffer(0), nOffset(8) {}
+
+    uint64_t Read(int nBits)
+    {
+        uint64_t nData = 0;
+        while (nBits > 0) {
+            if (nOffset == 8) {
+                s >> nBuffer;
+                nOffset = 0;
+            }
+            int nChunk = std::min(8 - nOffset, nBits);
+            nData <<= nChunk;
+            nData |= static_cast<uint8_t>(nBuffer << nOffset) >> (8 - nChunk);
+            nOffset += nChunk;
+            nBits -= nChunk;
+        }
+        return nData;
+    }
+};
+
+static void GolombRiceEncode(CBitWriter& bitWriter, uint8_t nP, uint64_t nValue)
+{
+    // the quotient in unary, 1s terminated by a 0
+    uint64_t nQuotient = nValue >> nP;
+    while (nQuotient > 0) {
+        int nBits = (int)std::min<uint64_t>(nQuotient, 64);
+        bitWriter.Write(~0ULL, nBits);
+        nQuotient -= nBits;
+    }
+    bitWriter.Write(0, 1);
+    bitWriter.Write(nValue, nP);
+}
+
+static uint64_t GolombRiceDecode(CBitReader& bitReader, uint8_t nP)
+{
+    uint64_t nQuotient = 0;
+    while (bitReader.Read(1) == 1) {
+        nQuotient++;
+    }
+    uint64_t nRemainder = bitReader.Read(nP);
+    return (nQuotient << nP) + nRemainder;
+}
+
+// Map x uniformly into [0, n) without a division, the upper 64 bits of x * n
+static uint64_t MapIntoRange(uint64_t x, uint64_t n)
+{
+#ifdef __SIZEOF_INT128__
+    return (uint64_t)(((unsigned __int128)x * (unsigned __int128)n) >> 64);
+#else
+    uint64_t x_hi = x >> 32, x_lo = x & 0xFFFFFFFF;
+    uint64_t n_hi = n >> 32, n_lo = n & 0xFFFFFFFF;
+    uint64_t ac = x_hi * n_hi;
+    uint64_t ad = x_hi * n_lo;
+    uint64_t bc = x_lo * n_hi;
+    uint64_t bd = x_lo * n_lo;
+    uint64_t mid34 = (bd >> 32) + (bc & 0xFFFFFFFF) + (ad & 0xFFFFFFFF);
+    return ac + (bc >> 32) + (ad >> 32) + (mid34 >> 32);
+#endif
+}
+
+GCSFilter::GCSFilter(uint64_t nSipHashK0In, uint64_t nSipHashK1In, uint8_t nPIn, uint32_t nMIn) :
+    nSipHashK0(nSipHashK0In), nSipHashK1(nSipHashK1In), nP(nPIn), nM(nMIn), nN(0), nF(0)
+{
+    CVectorWriter writer(SER_NETWORK, PROTOCOL_VERSION, vchEncoded, 0);
+    WriteCompactSize(writer, nN);
+}
+
+GCSFilter::GCSFilter(uint64_t nSipHashK0In, uint64_t nSipHashK1In, uint8_t nPIn, uint32_t nMIn, std::vector<unsigned char> vchEncodedIn) :
+    nSipHashK0(nSipHashK0In), nSipHashK1(nSipHashK1In), nP(nPIn), nM(nMIn), vchEncoded(std::move(vchEncodedIn))
+{
+    CSpanReader s(SER_NETWORK, PROTOCOL_VERSION, vchEncoded.data(), vchEncoded.size());
+    uint64_t nCount = ReadCompactSize(s);
+    if (nCount > std::numeric_limits<uint32_t>::max()) {
+        throw std::ios_base::failure("N must be < 2^32");
+    }
+    nN = (uint32_t)nCount;
+    nF = (uint64_t)nN * nM;
+
+    // decode all deltas, so a truncated or padded filter is rejected here and not on first use
+    CBitReader bitReader(s);
+    for (uint32_t i = 0; i < nN; i++) {
+        GolombRiceDecode(bitReader, nP);
+    }
+    if (!s.empty()) {
+        throw std::ios_base::failure("data after the filter");
+    }
+}
+
+GCSFilter::GCSFilter(uint64_t nSipHashK0In, uint64_t nSipHashK1In, uint8_t nPIn, uint32_t nMIn, const ElementSet& elements) :
+    nSipHashK0(nSipHashK0In), nSipHashK1(nSipHashK1In), nP(nPIn), nM(nMIn)
+{
+    if (elements.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::invalid_argument("N must be < 2^32");
+    }
+    nN = (uint32_t)elements.size();
+    nF = (uint64_t)nN * nM;
+
+    CVectorWriter writer(SER_NETWORK, PROTOCOL_VERSION, vchEncoded, 0);
+    WriteCompactSize(writer, nN);
+    if (elements.empty()) {
+        return;
+    }
+
+    std::vector<uint64_t> vecHashes;
+    vecHashes.reserve(elements.size());
+    for (const auto& element : elements) {
+        vecHashes.emplace_back(HashToRange(element));
+    }
+    std::sort(vecHashes.begin(), vecHashes.end());
+
+    CBitWriter bitWriter(vchEncoded);
+    uint64_t nLast = 0;
+    for (uint64_t nHash : vecHashes) {
+        GolombRiceEncode(bitWriter, nP, nHash - nLast);
+        nLast = nHash;
+    }
+    bitWriter.Flush();
+}
+
+uint64_t GCSFilter::HashToRange(const Element& element) const
+{
+    uint64_t nHash = CSipHasher(nSipHashK0, nSipHashK1).Write(element.data(), element.size()).Finalize();
+    return MapIntoRange(nHash, nF);
+}
+
+bool GCSFilter::MatchInternal(const std::vector<uint64_t>& vecQuery) const
+{
+    // walk the sorted query along the decoded filter
+    CSpanReader s(SER_NETWORK, PROTOCOL_VERSION, vchEncoded.data(), vchEncoded.size());
+    ReadCompactSize(s);
+    CBitReader bitReader(s);
+
+    uint64_t nValue = 0;
+    size_t nQuery = 0;
+    for (uint32_t i = 0; i < nN; i++) {
+        nValue += GolombRiceDecode(bitReader, nP);
+        while (true) {
+            if (nQuery == vecQuery.size()) {
+                return false;
+            } else if (vecQuery[nQuery] == nValue) {
+                return true;
+            } else if (vecQuery[nQuery] > nValue) {
+                break;
+            }
+            nQuery++;
+        }
+    }
+    return false;
+}
+
+bool GCSFilter::Match(const Element& element) const
+{
+    if (nN == 0) {
+        return false;
+    }
+    return MatchInternal({HashToRange(element)});
+}
+
+bool GCSFilter::MatchAny(const ElementSet& elements) const
+{
+    if (nN == 0 || elements.empty()) {
+        return false;
+    }
+    std::vector<uint64_t> vecQuery;
+    vecQuery.reserve(elements.size());
+    for (const auto& element : elements) {
+        vecQuery.emplace_back(HashToRange(element));
+    }
+    std::sort(vecQuery.begin(), vecQuery.end());
+    return MatchInternal(vecQuery);
+}
+
+BlockFilter::BlockFilter(BlockFilterType filterTypeIn, const uint256& blockHashIn, std::vector<unsigned char> vchFilter) :
+    filterType(filterTypeIn), blockHash(blockHashIn)
+{
+    if (filterType != BLOCK_FILTER_BASIC) {
+        throw std::ios_base::failure("unknown filter type");
+    }
+    filter = GCSFilter(blockHash.GetUint64(0), blockHash.GetUint64(1), GCSFilter::BASIC_P, GCSFilter::BASIC_M, std::move(vchFilter));
+}
+
+BlockFilter::BlockFilter(BlockFilterType filterTypeIn, const CBlock& block, const CBlockUndo& blockundo) :
+    BlockFilter(filterTypeIn, block.GetHash(), BasicFilterElements(block, blockundo))
+{
+}
+
+BlockFilter::BlockFilter(BlockFilterType filterTypeIn, const uint256& blockHashIn, const GCSFilter::ElementSet& elements) :
+    filterType(filterTypeIn), blockHash(blockHashIn)
+{
+    if (filterType != BLOCK_FILTER_BASIC) {
+        throw std::invalid_argument("unknown filter type");
+    }
+    filter = GCSFilter(blockHash.GetUint64(0), blockHash.GetUint64(1), GCSFilter::BASIC_P, GCSFilter::BASIC_M, elements);
+}
+
+GCSFilter::ElementSet BlockFilter::BasicFilterElements(const CBlock& block, const CBlockUndo& blockundo)
+{
+    GCSFilter::ElementSet elements;
+
+    for (const auto& tx : block.vtx) {
+        for (const auto& txout : tx->vout) {
+            const CScript& script = txout.scriptPubKey;
+            if (script.empty() || script[0] == OP_RETURN) {
+                continue;
+            }
+            elements.emplace(script.begin(), script.end());
+        }
+    }
+
+    for (const auto& txundo : blockundo.vtxundo) {
+        for (const auto& prevout : txundo.vprevout) {
+            const CScript& script = prevout.out.scriptPubKey;
+            if (script.empty()) {
+                continue;
+            }
+            elements.emplace(script.begin(), script.end());
+        }
+    }
+
+    return elements;
+}
+
+uint256 BlockFilter::GetHash() const
+{
+    const std::vector<unsigned char>& vch = filter.GetEncoded();
+    return Hash(vch.begin(), vch.end());
+}
+
+uint256 BlockFilter::ComputeHeader(const uint256& prevHeader) const
+{
+    uint256 filterHash = GetHash();
+    return Hash(filterHash.begin(), filterHash.end(), prevHeader.begin(), prevHeader.end());
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BLOCKFILTER_H
+#define BLOCKFILTER_H
+
+#include "serialize.h"
+#include "uint256.h"
+
+#include <set>
+#include <stdint.h>
+#include <vector>
+
+class CBlock;
+class CBlockUndo;
+
+/**
+ * Golomb-coded set as described in BIP158, a compact probabilistic filter over a set of
+ * byte vectors. Elements are hashed with SipHash into [0, N * M), sorted and the deltas
+ * Golomb-Rice coded with P bits of remainder. The encoding is N as CompactSize followed
+ * by the bit stream.
+ */
+class GCSFilter
+{
+public:
+    typedef std::vector<unsigned char> Element;
+    typedef std::set<Element> ElementSet;
+
+    // parameters of the basic block filter
+    static const uint8_t BASIC_P = 19;
+    static const uint32_t BASIC_M = 784931;
+
+private:
+    uint64_t nSipHashK0;
+    uint64_t nSipHashK1;
+    uint8_t nP;
+    uint32_t nM;
+    uint32_t nN;
+    uint64_t nF;
+    std::vector<unsigned char> vchEncoded;
+
+    uint64_t HashToRange(const Element& element) const;
+    bool MatchInternal(const std::vector<uint64_t>& vecQuery) const;
+
+public:
+    /// An empty filter
+    GCSFilter(uint64_t nSipHashK0In = 0, uint64_t nSipHashK1In = 0, uint8_t nPIn = BASIC_P, uint32_t nMIn = BASIC_M);
+    /// Decode a filter, throws std::ios_base::failure if the encoding is invalid
+    GCSFilter(uint64_t nSipHashK0In, uint64_t nSipHashK1In, uint8_t nPIn, uint32_t nMIn, std::vector<unsigned char> vchEncodedIn);
+    /// Build the filter of a set of elements
+    GCSFilter(uint64_t nSipHashK0In, uint64_t nSipHashK1In, uint8_t nPIn, uint32_t nMIn, const ElementSet& elements);
+
+    uint32_t GetN() const { return nN; }
+    const std::vector<unsigned char>& GetEncoded() const { return vchEncoded; }
+
+    /// Whether the element is in the set, with a false positive rate of 1/M
+    bool Match(const Element& element) const;
+    /// Whether any of the elements is in the set, cheaper than matching them one by one
+    bool MatchAny(const ElementSet& elements) const;
+};
+
+enum BlockFilterType : uint8_t {
+    BLOCK_FILTER_BASIC = 0,
+};
+
+/**
+ * BIP158 filter of a block. The basic filter has the scripts of all outputs of the block,
+ * except OP_RETURN ones, and the scripts of all outputs spent by it.
+ */
+class BlockFilter
+{
+private:
+    BlockFilterType filterType;
+    uint256 blockHash;
+    GCSFilter filter;
+
+public:
+    BlockFilter() : filterType(BLOCK_FILTER_BASIC) {}
+    /// Decode a filter, throws std::ios_base::failure if it's invalid
+    BlockFilter(BlockFilterType filterTypeIn, const uint256& blockHashIn, std::vector<unsigned char> vchFilter);
+    /// Build the filter of a block, blockundo has to be its undo data
+    BlockFilter(BlockFilterType filterTypeIn, const CBlock& block, const CBlockUndo& blockundo);
+    /// Build the filter of a block out of its BasicFilterElements
+    BlockFilter(BlockFilterType filterTypeIn, const uint256& blockHashIn, const GCSFilter::ElementSet& elements);
+
+    static GCSFilter::ElementSet BasicFilterElements(const CBlock& block, const CBlockUndo& blockundo);
+
+    BlockFilterType GetFilterType() const { return filterType; }
+    const uint256& GetBlockHash() const { return blockHash; }
+    const GCSFilter& GetFilter() const { return filter; }
+    const std::vector<unsigned char>& GetEncodedFilter() const { return filter.GetEncoded(); }
+
+    /// Double SHA256 of the encoded filter
+    uint256 GetHash() const;
+    /// Header of this filter in the chain of filter headers, the genesis block commits to a zero header
+    uint256 ComputeHeader(const uint256& prevHeader) const;
+};
+
+#endif // BLOCKFILTER_H
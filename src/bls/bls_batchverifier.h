@@ -6,6 +6,7 @@
 #define HTA_CRYPTO_BLS_BATCHVERIFIER_H
 
 #include "bls.h"
+#include "bls_sigcache.h"
 
 #include <map>
 #include <vector>
@@ -28,6 +29,9 @@ private:
     bool secureVerification;
     bool perMessageFallback;
     size_t subBatchSize;
+    // skip messages found in the BLS signature cache and add the ones found to be valid. Insecure verification must
+    // only use the cache when the public keys can't be crafted, otherwise a passing batch proves nothing about single messages
+    bool useSigCache;
 
     MessageMap messages;
     MessagesBySourceMap messagesBySource;
@@ -37,10 +41,11 @@ public:
     std::set<MessageId> badMessages;
 
 public:
-    CBLSBatchVerifier(bool _secureVerification, bool _perMessageFallback, size_t _subBatchSize = 0) :
+    CBLSBatchVerifier(bool _secureVerification, bool _perMessageFallback, size_t _subBatchSize = 0, bool _useSigCache = false) :
             secureVerification(_secureVerification),
             perMessageFallback(_perMessageFallback),
-            subBatchSize(_subBatchSize)
+            subBatchSize(_subBatchSize),
+            useSigCache(_useSigCache)
     {
     }
 
@@ -48,6 +53,10 @@ public:
     {
         assert(sig.IsValid() && pubKey.IsValid());
 
+        if (useSigCache && IsBLSSigCached(sig, pubKey, msgHash)) {
+            return;
+        }
+
         auto it = messages.emplace(msgId, Message{msgId, msgHash, sig, pubKey}).first;
         messagesBySource[sourceId].emplace_back(it);
 
@@ -73,6 +82,11 @@ public:
 
         if (VerifyBatch(byMessageHash)) {
             // full batch is valid
+            if (useSigCache) {
+                for (const auto& p : messages) {
+                    AddBLSSigCache(p.second.sig, p.second.pubKey, p.second.msgHash);
+                }
+            }
             return;
         }
 
@@ -112,6 +126,21 @@ public:
                 }
             }
         }
+
+        if (useSigCache) {
+            // messages of good sources are valid, and so are the messages of bad sources which passed individually
+            for (const auto& p : messagesBySource) {
+                bool sourceValid = !badSources.count(p.first);
+                if (!sourceValid && !perMessageFallback) {
+                    continue;
+                }
+                for (const auto& msgIt : p.second) {
+                    if (sourceValid || !badMessages.count(msgIt->first)) {
+                        AddBLSSigCache(msgIt->second.sig, msgIt->second.pubKey, msgIt->second.msgHash);
+                    }
+                }
+            }
+        }
     }
 
 private:
@@ -0,0 +1,133 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bls_sigcache.h"
+
+#include "crypto/sha256.h"
+#include "random.h"
+#include "util.h"
+
+#include "cuckoocache.h"
+#include <boost/thread.hpp>
+
+namespace {
+
+/** Entries are salted hashes, so their bytes can be used as hashes directly */
+class BLSSignatureCacheHasher
+{
+public:
+    template <uint8_t hash_select>
+    uint32_t operator()(const uint256& key) const
+    {
+        static_assert(hash_select < 8, "BLSSignatureCacheHasher only has 8 hashes available.");
+        uint32_t u;
+        std::memcpy(&u, key.begin() + 4 * hash_select, 4);
+        return u;
+    }
+};
+
+class CBLSSignatureCache
+{
+private:
+    //! Entries are SHA256(nonce || kind of verification || message hash || hash of each public key || hash of the signature)
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, BLSSignatureCacheHasher> map_type;
+    map_type setValid;
+    boost::shared_mutex cs_sigcache;
+
+public:
+    CBLSSignatureCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    void ComputeEntry(uint256& entry, bool fSecureAggregated, const uint256& hash, const std::vector<const CBLSPublicKey*>& pubKeys, const CBLSSignature& sig)
+    {
+        // the hashes of keys and signatures are computed when they are deserialized
+        unsigned char nKind = fSecureAggregated ? 1 : 0;
+        CSHA256 hasher;
+        hasher.Write(nonce.begin(), 32).Write(&nKind, 1).Write(hash.begin(), 32);
+        for (const CBLSPublicKey* pubKey : pubKeys) {
+            hasher.Write(pubKey->GetHash().begin(), 32);
+        }
+        hasher.Write(sig.GetHash().begin(), 32).Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        return setValid.contains(entry, false);
+    }
+
+    void Set(uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        setValid.insert(entry);
+    }
+
+    uint32_t setup_bytes(size_t n)
+    {
+        return setValid.setup_bytes(n);
+    }
+};
+
+static CBLSSignatureCache blsSignatureCache;
+}
+
+// To be called once in AppInitMain/BasicTestingSetup
+void InitBLSSignatureCache()
+{
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, GetArg("-blssigcachesize", DEFAULT_MAX_BLS_SIG_CACHE_SIZE)), MAX_MAX_BLS_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
+    size_t nElems = blsSignatureCache.setup_bytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for BLS signature cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, nMaxCacheSize>>20, nElems);
+}
+
+bool IsBLSSigCached(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& hash)
+{
+    uint256 entry;
+    blsSignatureCache.ComputeEntry(entry, false, hash, {&pubKey}, sig);
+    return blsSignatureCache.Get(entry);
+}
+
+void AddBLSSigCache(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& hash)
+{
+    uint256 entry;
+    blsSignatureCache.ComputeEntry(entry, false, hash, {&pubKey}, sig);
+    blsSignatureCache.Set(entry);
+}
+
+bool VerifyBLSSigCached(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& hash)
+{
+    uint256 entry;
+    blsSignatureCache.ComputeEntry(entry, false, hash, {&pubKey}, sig);
+    if (blsSignatureCache.Get(entry)) {
+        return true;
+    }
+    if (!sig.VerifyInsecure(pubKey, hash)) {
+        return false;
+    }
+    blsSignatureCache.Set(entry);
+    return true;
+}
+
+bool VerifyBLSSigSecureAggregatedCached(const CBLSSignature& sig, const std::vector<CBLSPublicKey>& pubKeys, const uint256& hash)
+{
+    std::vector<const CBLSPublicKey*> vecPubKeys;
+    vecPubKeys.reserve(pubKeys.size());
+    for (const auto& pubKey : pubKeys) {
+        vecPubKeys.emplace_back(&pubKey);
+    }
+
+    uint256 entry;
+    blsSignatureCache.ComputeEntry(entry, true, hash, vecPubKeys, sig);
+    if (blsSignatureCache.Get(entry)) {
+        return true;
+    }
+    if (!sig.VerifySecureAggregated(pubKeys, hash)) {
+        return false;
+    }
+    blsSignatureCache.Set(entry);
+    return true;
+}
@@ -0,0 +1,35 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef HTA_CRYPTO_BLS_SIGCACHE_H
+#define HTA_CRYPTO_BLS_SIGCACHE_H
+
+#include "bls.h"
+
+#include <vector>
+
+// Valid BLS signatures are cached separately from ECDSA ones, each entry takes 32 bytes
+static const unsigned int DEFAULT_MAX_BLS_SIG_CACHE_SIZE = 8;
+// Maximum BLS sig cache size allowed
+static const int64_t MAX_MAX_BLS_SIG_CACHE_SIZE = 16384;
+
+/**
+ * Cache of valid (public key, message hash, signature) triples, shared by everything that verifies BLS signatures.
+ * Recovered signatures, ISLOCKs, CLSIGs and final commitments are usually verified once when received and again
+ * when they show up in a block or are relayed by other peers. Only valid results are cached, invalid signatures
+ * are cheap to produce and would just evict valid entries.
+ */
+void InitBLSSignatureCache();
+
+/** Check if sig is known to be a valid signature of hash by pubKey */
+bool IsBLSSigCached(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& hash);
+/** Remember sig as a valid signature of hash by pubKey */
+void AddBLSSigCache(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& hash);
+
+/** CBLSSignature::VerifyInsecure, consulting and filling the cache */
+bool VerifyBLSSigCached(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& hash);
+/** CBLSSignature::VerifySecureAggregated, consulting and filling the cache */
+bool VerifyBLSSigSecureAggregatedCached(const CBLSSignature& sig, const std::vector<CBLSPublicKey>& pubKeys, const uint256& hash);
+
+#endif // HTA_CRYPTO_BLS_SIGCACHE_H
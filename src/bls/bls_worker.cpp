@@ -49,7 +49,14 @@ std::pair<std::function<void(T)>, std::future<T> > BuildFutureDoneCallback2()
 
 /////
 
-CBLSWorker::CBLSWorker()
+CBLSWorker::CBLSWorker() :
+    ownPool(new CWorkerPool()),
+    workerPool(*ownPool)
+{
+}
+
+CBLSWorker::CBLSWorker(CWorkerPool& sharedPool) :
+    workerPool(sharedPool)
 {
 }
 
@@ -60,16 +67,19 @@ CBLSWorker::~CBLSWorker()
 
 void CBLSWorker::Start()
 {
+    if (!ownPool || ownPool->Size() != 0) {
+        return;
+    }
     int workerCount = std::thread::hardware_concurrency() / 2;
     workerCount = std::max(std::min(1, workerCount), 4);
-    workerPool.resize(workerCount);
-    RenameThreadPool(workerPool, "historia-bls-worker");
+    ownPool->Start(workerCount, "historia-bls-worker");
 }
 
 void CBLSWorker::Stop()
 {
-    workerPool.clear_queue();
-    workerPool.stop(true);
+    if (ownPool) {
+        ownPool->Stop();
+    }
 }
 
 bool CBLSWorker::GenerateContributions(int quorumThreshold, const BLSIdVector& ids, BLSVerificationVectorPtr& vvecRet, BLSSecretKeyVector& skShares)
@@ -93,7 +103,7 @@ bool CBLSWorker::GenerateContributions(int quorumThreshold, const BLSIdVector& i
             }
             return true;
         };
-        futures.emplace_back(workerPool.push(f));
+        futures.emplace_back(workerPool.Push(f));
     }
 
     for (size_t i = 0; i < ids.size(); i += batchSize) {
@@ -107,7 +117,42 @@ bool CBLSWorker::GenerateContributions(int quorumThreshold, const BLSIdVector& i
             }
             return true;
         };
-        futures.emplace_back(workerPool.push(f));
+        futures.emplace_back(workerPool.Push(f));
+    }
+    bool success = true;
+    for (auto& f : futures) {
+        if (!f.get()) {
+            success = false;
+        }
+    }
+    return success;
+}
+
+bool CBLSWorker::EncryptContributions(const BLSPublicKeyVector& recipients, const BLSSecretKeyVector& skShares,
+                                      CBLSIESMultiRecipientObjects<CBLSSecretKey>& ret, int nVersion)
+{
+    if (recipients.size() != skShares.size()) {
+        return false;
+    }
+
+    // every batch only writes to its own blobs, which InitEncrypt already allocated
+    ret.InitEncrypt(skShares.size());
+
+    std::list<std::future<bool> > futures;
+    size_t batchSize = 8;
+
+    for (size_t i = 0; i < skShares.size(); i += batchSize) {
+        size_t start = i;
+        size_t count = std::min(batchSize, skShares.size() - start);
+        auto f = [&, start, count](int threadId) {
+            for (size_t j = start; j < start + count; j++) {
+                if (!ret.Encrypt(j, recipients[j], skShares[j], nVersion)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        futures.emplace_back(workerPool.Push(f));
     }
     bool success = true;
     for (auto& f : futures) {
@@ -118,6 +163,32 @@ bool CBLSWorker::GenerateContributions(int quorumThreshold, const BLSIdVector& i
     return success;
 }
 
+BLSSecretKeyVector CBLSWorker::DecryptContributionShares(const std::vector<std::shared_ptr<CBLSIESMultiRecipientObjects<CBLSSecretKey>>>& contributions,
+                                                         size_t idx, const CBLSSecretKey& sk, int nVersion)
+{
+    BLSSecretKeyVector ret(contributions.size());
+
+    std::list<std::future<void> > futures;
+    size_t batchSize = 8;
+
+    for (size_t i = 0; i < contributions.size(); i += batchSize) {
+        size_t start = i;
+        size_t count = std::min(batchSize, contributions.size() - start);
+        auto f = [&, start, count](int threadId) {
+            for (size_t j = start; j < start + count; j++) {
+                if (!contributions[j]->Decrypt(idx, sk, ret[j], nVersion)) {
+                    ret[j].Reset();
+                }
+            }
+        };
+        futures.emplace_back(workerPool.Push(f));
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
+    return ret;
+}
+
 // aggregates a single vector of BLS objects in parallel
 // the input vector is split into batches and each batch is aggregated in parallel
 // when enough batches are finished to form a new batch, the new batch is queued for further parallel aggregation
@@ -134,7 +205,7 @@ struct Aggregator {
     std::shared_ptr<std::vector<const T*> > inputVec;
 
     bool parallel;
-    ctpl::thread_pool& workerPool;
+    CWorkerPool& workerPool;
 
     std::mutex m;
     // items in the queue are all intermediate aggregation results of finished batches.
@@ -153,7 +224,7 @@ struct Aggregator {
     Aggregator(const std::vector<TP>& _inputVec,
                size_t start, size_t count,
                bool _parallel,
-               ctpl::thread_pool& _workerPool,
+               CWorkerPool& _workerPool,
                DoneCallback _doneCallback) :
             workerPool(_workerPool),
             parallel(_parallel),
@@ -314,7 +385,7 @@ struct Aggregator {
     template <typename Callable>
     void PushWork(Callable&& f)
     {
-        workerPool.push(f);
+        workerPool.Push(f);
     }
 };
 
@@ -342,7 +413,7 @@ struct VectorAggregator {
     size_t start;
     size_t count;
     bool parallel;
-    ctpl::thread_pool& workerPool;
+    CWorkerPool& workerPool;
 
     std::atomic<size_t> doneCount;
 
@@ -351,7 +422,7 @@ struct VectorAggregator {
 
     VectorAggregator(const VectorVectorType& _vecs,
                      size_t _start, size_t _count,
-                     bool _parallel, ctpl::thread_pool& _workerPool,
+                     bool _parallel, CWorkerPool& _workerPool,
                      DoneCallback _doneCallback) :
             vecs(_vecs),
             parallel(_parallel),
@@ -422,7 +493,7 @@ struct ContributionVerifier {
     bool parallel;
     bool aggregated;
 
-    ctpl::thread_pool& workerPool;
+    CWorkerPool& workerPool;
 
     size_t batchCount;
     size_t verifyCount;
@@ -433,7 +504,7 @@ struct ContributionVerifier {
 
     ContributionVerifier(const CBLSId& _forId, const std::vector<BLSVerificationVectorPtr>& _vvecs,
                          const BLSSecretKeyVector& _skShares, size_t _batchSize,
-                         bool _parallel, bool _aggregated, ctpl::thread_pool& _workerPool,
+                         bool _parallel, bool _aggregated, CWorkerPool& _workerPool,
                          std::function<void(const std::vector<bool>&)> _doneCallback) :
         forId(_forId),
         vvecs(_vvecs),
@@ -590,7 +661,7 @@ struct ContributionVerifier {
     void PushOrDoWork(Callable&& f)
     {
         if (parallel) {
-            workerPool.push(std::move(f));
+            workerPool.Push(std::move(f));
         } else {
             f(0);
         }
@@ -632,7 +703,7 @@ BLSVerificationVectorPtr CBLSWorker::BuildQuorumVerificationVector(const std::ve
 }
 
 template <typename T>
-void AsyncAggregateHelper(ctpl::thread_pool& workerPool,
+void AsyncAggregateHelper(CWorkerPool& workerPool,
                           const std::vector<T>& vec, size_t start, size_t count, bool parallel,
                           std::function<void(const T&)> doneCallback)
 {
@@ -770,7 +841,7 @@ std::future<bool> CBLSWorker::AsyncVerifyContributionShare(const CBLSId& forId,
         CBLSPublicKey pk2 = skContribution.GetPublicKey();
         return pk1 == pk2;
     };
-    return workerPool.push(f);
+    return workerPool.Push(f);
 }
 
 bool CBLSWorker::VerifyContributionShare(const CBLSId& forId, const BLSVerificationVectorPtr& vvec,
@@ -832,7 +903,7 @@ bool CBLSWorker::VerifySignatureVector(const BLSSignatureVector& sigs, size_t st
 
 void CBLSWorker::AsyncSign(const CBLSSecretKey& secKey, const uint256& msgHash, CBLSWorker::SignDoneCallback doneCallback)
 {
-    workerPool.push([secKey, msgHash, doneCallback](int threadId) {
+    workerPool.Push([secKey, msgHash, doneCallback](int threadId) {
         doneCallback(secKey.Sign(msgHash));
     });
 }
@@ -956,5 +1027,7 @@ void CBLSWorker::PushSigVerifyBatch()
     sigVerifyQueue.reserve(SIG_VERIFY_BATCH_SIZE);
 
     sigVerifyBatchesInProgress++;
-    workerPool.push(f, batch);
+    workerPool.Push([f, batch](int threadId) {
+        f(threadId, batch);
+    });
 }
@@ -6,8 +6,9 @@
 #define HTA_CRYPTO_BLS_WORKER_H
 
 #include "bls.h"
+#include "bls_ies.h"
 
-#include "ctpl.h"
+#include "workerpool.h"
 
 #include <future>
 #include <mutex>
@@ -26,7 +27,9 @@ public:
     typedef std::function<bool()> CancelCond;
 
 private:
-    ctpl::thread_pool workerPool;
+    // only used if no shared pool is passed in
+    std::unique_ptr<CWorkerPool> ownPool;
+    CWorkerPool& workerPool;
 
     static const int SIG_VERIFY_BATCH_SIZE = 8;
     struct SigVerifyJob {
@@ -51,6 +54,8 @@ private:
 
 public:
     CBLSWorker();
+    // Runs all jobs on sharedPool. Start() and Stop() then don't start or stop any threads
+    explicit CBLSWorker(CWorkerPool& sharedPool);
     ~CBLSWorker();
 
     void Start();
@@ -58,6 +63,15 @@ public:
 
     bool GenerateContributions(int threshold, const BLSIdVector& ids, BLSVerificationVectorPtr& vvecRet, BLSSecretKeyVector& skShares);
 
+    // Encrypts skShares[i] for recipients[i] in parallel batches. All recipients share the single ephemeral key of the
+    // multi recipient object, so only the ECDH and AES steps are done per recipient
+    bool EncryptContributions(const BLSPublicKeyVector& recipients, const BLSSecretKeyVector& skShares,
+                              CBLSIESMultiRecipientObjects<CBLSSecretKey>& ret, int nVersion);
+    // Decrypts the share at index idx of each of the contributions in parallel batches. Shares which could not be
+    // decrypted are returned as invalid secret keys
+    BLSSecretKeyVector DecryptContributionShares(const std::vector<std::shared_ptr<CBLSIESMultiRecipientObjects<CBLSSecretKey>>>& contributions,
+                                                 size_t idx, const CBLSSecretKey& sk, int nVersion);
+
     // The following functions are all used to aggregate verification (public key) vectors
     // Inputs are in the following form:
     //   [
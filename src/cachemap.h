@@ -5,10 +5,11 @@
 #ifndef CACHEMAP_H_
 #define CACHEMAP_H_
 
-#include <map>
-#include <list>
 #include <cstddef>
+#include <iterator>
+#include <vector>
 
+#include "saltedhasher.h"
 #include "serialize.h"
 
 /**
@@ -38,11 +39,292 @@ struct CacheItem
     }
 };
 
+/**
+ * Doubly linked list of cache items which owns its nodes, so that the
+ * index of a cache can point to the nodes directly. Most recently added
+ * items are at the front. Serialized like a std::list of the items.
+ */
+template<typename K, typename V>
+class CacheItemList
+{
+public:
+    typedef CacheItem<K,V> item_t;
+
+    struct Node
+    {
+        item_t item;
+        Node* prev{nullptr};
+        Node* next{nullptr};
+
+        Node(const item_t& itemIn) : item(itemIn) {}
+
+        const K& GetKey() const { return item.key; }
+    };
+
+    template<typename T, typename N>
+    class iterator_base : public std::iterator<std::forward_iterator_tag, T>
+    {
+        N* node;
+
+    public:
+        iterator_base(N* nodeIn = nullptr) : node(nodeIn) {}
+
+        T& operator*() const { return node->item; }
+        T* operator->() const { return &node->item; }
+        iterator_base& operator++() { node = node->next; return *this; }
+        iterator_base operator++(int) { iterator_base ret(*this); node = node->next; return ret; }
+        bool operator==(const iterator_base& other) const { return node == other.node; }
+        bool operator!=(const iterator_base& other) const { return node != other.node; }
+    };
+
+    typedef iterator_base<item_t, Node> iterator;
+
+    typedef iterator_base<const item_t, const Node> const_iterator;
+
+private:
+    Node* head{nullptr};
+    Node* tail{nullptr};
+    size_t nSize{0};
+
+public:
+    CacheItemList() {}
+
+    CacheItemList(const CacheItemList& other)
+    {
+        for(const Node* node = other.head; node; node = node->next) {
+            push_back(node->item);
+        }
+    }
+
+    ~CacheItemList()
+    {
+        clear();
+    }
+
+    CacheItemList& operator=(const CacheItemList& other)
+    {
+        if(this != &other) {
+            clear();
+            for(const Node* node = other.head; node; node = node->next) {
+                push_back(node->item);
+            }
+        }
+        return *this;
+    }
+
+    size_t size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+
+    iterator begin() { return iterator(head); }
+    iterator end() { return iterator(); }
+    const_iterator begin() const { return const_iterator(head); }
+    const_iterator end() const { return const_iterator(); }
+
+    Node* front_node() const { return head; }
+    Node* back_node() const { return tail; }
+
+    Node* push_front(const item_t& item)
+    {
+        Node* node = new Node(item);
+        node->next = head;
+        if(head) {
+            head->prev = node;
+        } else {
+            tail = node;
+        }
+        head = node;
+        nSize++;
+        return node;
+    }
+
+    Node* push_back(const item_t& item)
+    {
+        Node* node = new Node(item);
+        node->prev = tail;
+        if(tail) {
+            tail->next = node;
+        } else {
+            head = node;
+        }
+        tail = node;
+        nSize++;
+        return node;
+    }
+
+    void erase(Node* node)
+    {
+        if(node->prev) {
+            node->prev->next = node->next;
+        } else {
+            head = node->next;
+        }
+        if(node->next) {
+            node->next->prev = node->prev;
+        } else {
+            tail = node->prev;
+        }
+        nSize--;
+        delete node;
+    }
+
+    void clear()
+    {
+        while(head) {
+            Node* next = head->next;
+            delete head;
+            head = next;
+        }
+        tail = nullptr;
+        nSize = 0;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        WriteCompactSize(s, nSize);
+        for(const Node* node = head; node; node = node->next) {
+            ::Serialize(s, node->item);
+        }
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        clear();
+        uint64_t nCount = ReadCompactSize(s);
+        for(uint64_t i = 0; i < nCount; i++) {
+            item_t item;
+            ::Unserialize(s, item);
+            push_back(item);
+        }
+    }
+};
+
+/**
+ * Open addressing hash index over entries owned by someone else, one entry
+ * per key. Entries must provide GetKey(). Uses linear probing with backward
+ * shift deletion, the salted hash is kept next to the pointer so probing
+ * only dereferences entries with a matching hash.
+ */
+template<typename K, typename E, typename Hasher = StaticSaltedHasher>
+class CacheIndex
+{
+private:
+    struct Slot
+    {
+        size_t nHash{0};
+        E* entry{nullptr};
+    };
+
+    static const size_t MIN_SLOTS = 16;
+
+    std::vector<Slot> vSlots;
+    size_t nCount{0};
+    Hasher hasher;
+
+public:
+    size_t Size() const { return nCount; }
+
+    E* Find(const K& key) const
+    {
+        if(nCount == 0) {
+            return nullptr;
+        }
+        size_t nHash = hasher(key);
+        size_t nMask = vSlots.size() - 1;
+        for(size_t i = nHash & nMask; vSlots[i].entry; i = (i + 1) & nMask) {
+            if(vSlots[i].nHash == nHash && vSlots[i].entry->GetKey() == key) {
+                return vSlots[i].entry;
+            }
+        }
+        return nullptr;
+    }
+
+    /** The key of entry must not be in the index yet */
+    void Insert(E* entry)
+    {
+        // keep the load factor at or below 1/2
+        if((nCount + 1) * 2 > vSlots.size()) {
+            Rehash(vSlots.empty() ? MIN_SLOTS : vSlots.size() * 2);
+        }
+        Place(hasher(entry->GetKey()), entry);
+        nCount++;
+    }
+
+    void Erase(const E* entry)
+    {
+        if(nCount == 0) {
+            return;
+        }
+        size_t nMask = vSlots.size() - 1;
+        for(size_t i = hasher(entry->GetKey()) & nMask; vSlots[i].entry; i = (i + 1) & nMask) {
+            if(vSlots[i].entry == entry) {
+                EraseSlot(i);
+                return;
+            }
+        }
+    }
+
+    void Clear()
+    {
+        std::vector<Slot>().swap(vSlots);
+        nCount = 0;
+    }
+
+    template<typename Callable>
+    void ForEach(Callable&& func) const
+    {
+        for(const Slot& slot : vSlots) {
+            if(slot.entry) {
+                func(slot.entry);
+            }
+        }
+    }
+
+private:
+    void Place(size_t nHash, E* entry)
+    {
+        size_t nMask = vSlots.size() - 1;
+        size_t i = nHash & nMask;
+        while(vSlots[i].entry) {
+            i = (i + 1) & nMask;
+        }
+        vSlots[i].nHash = nHash;
+        vSlots[i].entry = entry;
+    }
+
+    void Rehash(size_t nSlots)
+    {
+        std::vector<Slot> vOld(nSlots);
+        vOld.swap(vSlots);
+        for(const Slot& slot : vOld) {
+            if(slot.entry) {
+                Place(slot.nHash, slot.entry);
+            }
+        }
+    }
+
+    void EraseSlot(size_t i)
+    {
+        size_t nMask = vSlots.size() - 1;
+        for(size_t j = (i + 1) & nMask; vSlots[j].entry; j = (j + 1) & nMask) {
+            // entries whose home slot is cyclically in (i, j] can't move to i
+            size_t nHome = vSlots[j].nHash & nMask;
+            if(i <= j ? (i < nHome && nHome <= j) : (i < nHome || nHome <= j)) {
+                continue;
+            }
+            vSlots[i] = vSlots[j];
+            i = j;
+        }
+        vSlots[i] = Slot();
+        nCount--;
+    }
+};
 
 /**
  * Map like container that keeps the N most recently added items
  */
-template<typename K, typename V, typename Size = uint32_t>
+template<typename K, typename V, typename Size = uint32_t, typename Hasher = StaticSaltedHasher>
 class CacheMap
 {
 public:
@@ -50,43 +332,39 @@ public:
 
     typedef CacheItem<K,V> item_t;
 
-    typedef std::list<item_t> list_t;
+    typedef CacheItemList<K,V> list_t;
 
     typedef typename list_t::iterator list_it;
 
     typedef typename list_t::const_iterator list_cit;
 
-    typedef std::map<K, list_it> map_t;
-
-    typedef typename map_t::iterator map_it;
-
-    typedef typename map_t::const_iterator map_cit;
-
 private:
+    typedef typename list_t::Node node_t;
+
     size_type nMaxSize;
 
     list_t listItems;
 
-    map_t mapIndex;
+    CacheIndex<K, node_t, Hasher> index;
 
 public:
     CacheMap(size_type nMaxSizeIn = 0)
         : nMaxSize(nMaxSizeIn),
           listItems(),
-          mapIndex()
+          index()
     {}
 
-    CacheMap(const CacheMap<K,V>& other)
+    CacheMap(const CacheMap& other)
         : nMaxSize(other.nMaxSize),
           listItems(other.listItems),
-          mapIndex()
+          index()
     {
         RebuildIndex();
     }
 
     void Clear()
     {
-        mapIndex.clear();
+        index.Clear();
         listItems.clear();
     }
 
@@ -105,48 +383,47 @@ public:
 
     bool Insert(const K& key, const V& value)
     {
-        if(mapIndex.find(key) != mapIndex.end()) {
+        if(index.Find(key)) {
             return false;
         }
         if(listItems.size() == nMaxSize) {
             PruneLast();
         }
-        listItems.push_front(item_t(key, value));
-        mapIndex.emplace(key, listItems.begin());
+        index.Insert(listItems.push_front(item_t(key, value)));
         return true;
     }
 
     bool HasKey(const K& key) const
     {
-        return (mapIndex.find(key) != mapIndex.end());
+        return index.Find(key) != nullptr;
     }
 
     bool Get(const K& key, V& value) const
     {
-        map_cit it = mapIndex.find(key);
-        if(it == mapIndex.end()) {
+        const node_t* node = index.Find(key);
+        if(!node) {
             return false;
         }
-        item_t& item = *(it->second);
-        value = item.value;
+        value = node->item.value;
         return true;
     }
 
     void Erase(const K& key)
     {
-        map_it it = mapIndex.find(key);
-        if(it == mapIndex.end()) {
+        node_t* node = index.Find(key);
+        if(!node) {
             return;
         }
-        listItems.erase(it->second);
-        mapIndex.erase(it);
+        // key might refer to the item itself, drop it last
+        index.Erase(node);
+        listItems.erase(node);
     }
 
     const list_t& GetItemList() const {
         return listItems;
     }
 
-    CacheMap<K,V>& operator=(const CacheMap<K,V>& other)
+    CacheMap& operator=(const CacheMap& other)
     {
         nMaxSize = other.nMaxSize;
         listItems = other.listItems;
@@ -169,19 +446,22 @@ public:
 private:
     void PruneLast()
     {
-        if(listItems.empty()) {
+        node_t* node = listItems.back_node();
+        if(!node) {
             return;
         }
-        item_t& item = listItems.back();
-        mapIndex.erase(item.key);
-        listItems.pop_back();
+        index.Erase(node);
+        listItems.erase(node);
     }
 
     void RebuildIndex()
     {
-        mapIndex.clear();
-        for(list_it it = listItems.begin(); it != listItems.end(); ++it) {
-            mapIndex.emplace(it->key, it);
+        index.Clear();
+        for(node_t* node = listItems.front_node(); node; node = node->next) {
+            // like before, only the newest item of a duplicate key is found
+            if(!index.Find(node->GetKey())) {
+                index.Insert(node);
+            }
         }
     }
 };
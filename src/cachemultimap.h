@@ -7,8 +7,7 @@
 
 #include <cstddef>
 #include <map>
-#include <list>
-#include <set>
+#include <vector>
 
 #include "serialize.h"
 
@@ -17,7 +16,7 @@
 /**
  * Map like container that keeps the N most recently added items
  */
-template<typename K, typename V, typename Size = uint32_t>
+template<typename K, typename V, typename Size = uint32_t, typename Hasher = StaticSaltedHasher>
 class CacheMultiMap
 {
 public:
@@ -25,49 +24,55 @@ public:
 
     typedef CacheItem<K,V> item_t;
 
-    typedef std::list<item_t> list_t;
+    typedef CacheItemList<K,V> list_t;
 
     typedef typename list_t::iterator list_it;
 
     typedef typename list_t::const_iterator list_cit;
 
-    typedef std::map<V,list_it> it_map_t;
-
-    typedef typename it_map_t::iterator it_map_it;
-
-    typedef typename it_map_t::const_iterator it_map_cit;
+private:
+    typedef typename list_t::Node node_t;
 
-    typedef std::map<K, it_map_t> map_t;
+    /** Items of a single key, ordered by value */
+    struct Group
+    {
+        K key;
+        std::map<V, node_t*> mapItems;
 
-    typedef typename map_t::iterator map_it;
+        Group(const K& keyIn) : key(keyIn) {}
 
-    typedef typename map_t::const_iterator map_cit;
+        const K& GetKey() const { return key; }
+    };
 
-private:
     size_type nMaxSize;
 
     list_t listItems;
 
-    map_t mapIndex;
+    CacheIndex<K, Group, Hasher> index;
 
 public:
     CacheMultiMap(size_type nMaxSizeIn = 0)
         : nMaxSize(nMaxSizeIn),
           listItems(),
-          mapIndex()
+          index()
     {}
 
-    CacheMultiMap(const CacheMap<K,V>& other)
+    CacheMultiMap(const CacheMultiMap& other)
         : nMaxSize(other.nMaxSize),
           listItems(other.listItems),
-          mapIndex()
+          index()
     {
         RebuildIndex();
     }
 
+    ~CacheMultiMap()
+    {
+        ClearIndex();
+    }
+
     void Clear()
     {
-        mapIndex.clear();
+        ClearIndex();
         listItems.clear();
     }
 
@@ -86,105 +91,105 @@ public:
 
     bool Insert(const K& key, const V& value)
     {
-        map_it mit = mapIndex.find(key);
-        if(mit == mapIndex.end()) {
-            mit = mapIndex.emplace(key, it_map_t()).first;
-        }
-        it_map_t& mapIt = mit->second;
-
-        if(mapIt.count(value) > 0) {
+        Group* group = index.Find(key);
+        if(group && group->mapItems.count(value) > 0) {
             // Don't insert duplicates
             return false;
         }
 
         if(listItems.size() == nMaxSize) {
             PruneLast();
+            // the group might have been the one of the pruned item
+            group = index.Find(key);
+        }
+        if(!group) {
+            group = new Group(key);
+            index.Insert(group);
         }
-        listItems.push_front(item_t(key, value));
-        mapIt.emplace(value, listItems.begin());
+        group->mapItems.emplace(value, listItems.push_front(item_t(key, value)));
         return true;
     }
 
     bool HasKey(const K& key) const
     {
-        return (mapIndex.find(key) != mapIndex.end());
+        return index.Find(key) != nullptr;
     }
 
     bool Get(const K& key, V& value) const
     {
-        map_cit it = mapIndex.find(key);
-        if(it == mapIndex.end()) {
+        const Group* group = index.Find(key);
+        if(!group) {
             return false;
         }
-        const it_map_t& mapIt = it->second;
-        const item_t& item = *(mapIt.begin()->second);
-        value = item.value;
+        value = group->mapItems.begin()->second->item.value;
         return true;
     }
 
     bool GetAll(const K& key, std::vector<V>& vecValues)
     {
-        map_cit mit = mapIndex.find(key);
-        if(mit == mapIndex.end()) {
+        const Group* group = index.Find(key);
+        if(!group) {
             return false;
         }
-        const it_map_t& mapIt = mit->second;
-
-        for(it_map_cit it = mapIt.begin(); it != mapIt.end(); ++it) {
-            const item_t& item = *(it->second);
-            vecValues.push_back(item.value);
+        for(const auto& pair : group->mapItems) {
+            vecValues.push_back(pair.second->item.value);
         }
         return true;
     }
 
+    /** Keys are returned in no particular order */
     void GetKeys(std::vector<K>& vecKeys)
     {
-        for(map_cit it = mapIndex.begin(); it != mapIndex.end(); ++it) {
-            vecKeys.push_back(it->first);
-        }
+        vecKeys.reserve(vecKeys.size() + index.Size());
+        index.ForEach([&](const Group* group) {
+            vecKeys.push_back(group->key);
+        });
     }
 
     void Erase(const K& key)
     {
-        map_it mit = mapIndex.find(key);
-        if(mit == mapIndex.end()) {
+        Group* group = index.Find(key);
+        if(!group) {
             return;
         }
-        it_map_t& mapIt = mit->second;
-
-        for(it_map_it it = mapIt.begin(); it != mapIt.end(); ++it) {
-            listItems.erase(it->second);
+        std::vector<node_t*> vecNodes;
+        vecNodes.reserve(group->mapItems.size());
+        for(const auto& pair : group->mapItems) {
+            vecNodes.push_back(pair.second);
+        }
+        // key might refer to one of the items, drop them last
+        index.Erase(group);
+        delete group;
+        for(node_t* node : vecNodes) {
+            listItems.erase(node);
         }
-
-        mapIndex.erase(mit);
     }
 
     void Erase(const K& key, const V& value)
     {
-        map_it mit = mapIndex.find(key);
-        if(mit == mapIndex.end()) {
+        Group* group = index.Find(key);
+        if(!group) {
             return;
         }
-        it_map_t& mapIt = mit->second;
-
-        it_map_it it = mapIt.find(value);
-        if(it == mapIt.end()) {
+        auto it = group->mapItems.find(value);
+        if(it == group->mapItems.end()) {
             return;
         }
-
-        listItems.erase(it->second);
-        mapIt.erase(it);
-
-        if(mapIt.empty()) {
-            mapIndex.erase(mit);
+        // key and value might refer to the item, drop it last
+        node_t* node = it->second;
+        group->mapItems.erase(it);
+        if(group->mapItems.empty()) {
+            index.Erase(group);
+            delete group;
         }
+        listItems.erase(node);
     }
 
     const list_t& GetItemList() const {
         return listItems;
     }
 
-    CacheMap<K,V>& operator=(const CacheMap<K,V>& other)
+    CacheMultiMap& operator=(const CacheMultiMap& other)
     {
         nMaxSize = other.nMaxSize;
         listItems = other.listItems;
@@ -207,40 +212,44 @@ public:
 private:
     void PruneLast()
     {
-        if(listItems.empty()) {
+        node_t* node = listItems.back_node();
+        if(!node) {
             return;
         }
 
-        list_it lit = listItems.end();
-        --lit;
-        item_t& item = *lit;
-
-        map_it mit = mapIndex.find(item.key);
-
-        if(mit != mapIndex.end()) {
-            it_map_t& mapIt = mit->second;
-
-            mapIt.erase(item.value);
-
-            if(mapIt.empty()) {
-                mapIndex.erase(item.key);
+        Group* group = index.Find(node->item.key);
+        if(group) {
+            auto it = group->mapItems.find(node->item.value);
+            if(it != group->mapItems.end() && it->second == node) {
+                group->mapItems.erase(it);
+            }
+            if(group->mapItems.empty()) {
+                index.Erase(group);
+                delete group;
             }
         }
 
-        listItems.pop_back();
+        listItems.erase(node);
+    }
+
+    void ClearIndex()
+    {
+        index.ForEach([](Group* group) {
+            delete group;
+        });
+        index.Clear();
     }
 
     void RebuildIndex()
     {
-        mapIndex.clear();
-        for(list_it lit = listItems.begin(); lit != listItems.end(); ++lit) {
-            item_t& item = *lit;
-            map_it mit = mapIndex.find(item.key);
-            if(mit == mapIndex.end()) {
-                mit = mapIndex.emplace(item.key, it_map_t()).first;
+        ClearIndex();
+        for(node_t* node = listItems.front_node(); node; node = node->next) {
+            Group* group = index.Find(node->item.key);
+            if(!group) {
+                group = new Group(node->item.key);
+                index.Insert(group);
             }
-            it_map_t& mapIt = mit->second;
-            mapIt.emplace(item.value, lit);
+            group->mapItems.emplace(node->item.value, node);
         }
     }
 };
@@ -0,0 +1,217 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainsnapshot.h"
+
+#include "chain.h"
+#include "clientversion.h"
+#include "coins.h"
+#include "governance.h"
+#include "hash.h"
+#include "streams.h"
+#include "txdb.h"
+#include "util.h"
+#include "validation.h"
+
+#include "evo/deterministicmns.h"
+#include "llmq/quorums_blockprocessor.h"
+#include "llmq/quorums_commitment.h"
+
+#include <boost/thread/thread.hpp>
+
+static const std::string SNAPSHOT_MAGIC = "chainsnapshot";
+static const int SNAPSHOT_FORMAT_VERSION = 1;
+
+typedef std::vector<std::pair<uint256, llmq::CFinalCommitment>> QuorumCommitments;
+
+// Writes to a file while hashing everything written, the counterpart of CHashVerifier
+class CHashedFileWriter : public CHashWriter
+{
+private:
+    CAutoFile& file;
+
+public:
+    CHashedFileWriter(CAutoFile& fileIn) : CHashWriter(fileIn.GetType(), fileIn.GetVersion()), file(fileIn) {}
+
+    void write(const char* pch, size_t nSize)
+    {
+        file.write(pch, nSize);
+        CHashWriter::write(pch, nSize);
+    }
+
+    template<typename T>
+    CHashedFileWriter& operator<<(const T& obj)
+    {
+        ::Serialize(*this, obj);
+        return *this;
+    }
+};
+
+bool CChainStateSnapshot::Dump(const boost::filesystem::path& path, CChainStateSnapshotInfo& info, std::string& strError)
+{
+    std::unique_ptr<CCoinsViewCursor> pcursorCount;
+    std::unique_ptr<CCoinsViewCursor> pcursor;
+    CDeterministicMNList mnList;
+    QuorumCommitments vecQuorums;
+    {
+        LOCK(cs_main);
+        FlushStateToDisk();
+        const CBlockIndex* pindex = chainActive.Tip();
+
+        // both cursors see the coins database as it is right now, no matter what gets connected meanwhile
+        pcursorCount.reset(pcoinsdbview->Cursor());
+        pcursor.reset(pcoinsdbview->Cursor());
+        if (pcursor->GetBestBlock() != pindex->GetBlockHash()) {
+            strError = "coins database is not at the tip";
+            return false;
+        }
+        info.blockHash = pindex->GetBlockHash();
+        info.nHeight = pindex->nHeight;
+
+        mnList = deterministicMNManager->GetListForBlock(pindex);
+        for (const auto& p : llmq::quorumBlockProcessor->GetMinedAndActiveCommitmentsUntilBlock(pindex)) {
+            for (const CBlockIndex* pindexQuorum : p.second) {
+                llmq::CFinalCommitment qc;
+                uint256 minedBlockHash;
+                if (!llmq::quorumBlockProcessor->GetMinedCommitment(p.first, pindexQuorum->GetBlockHash(), qc, minedBlockHash)) {
+                    strError = strprintf("commitment of quorum %s not found", pindexQuorum->GetBlockHash().ToString());
+                    return false;
+                }
+                vecQuorums.emplace_back(minedBlockHash, std::move(qc));
+            }
+        }
+    }
+    info.nMasternodes = mnList.GetAllMNsCount();
+    info.nQuorums = vecQuorums.size();
+
+    // the governance store isn't bound to a block, it's simply what we have now
+    CDataStream ssGovernance(SER_DISK, CLIENT_VERSION);
+    ssGovernance << governance;
+    std::vector<unsigned char> vchGovernance(ssGovernance.begin(), ssGovernance.end());
+    info.nGovernanceSize = vchGovernance.size();
+
+    info.nCoins = 0;
+    while (pcursorCount->Valid()) {
+        boost::this_thread::interruption_point();
+        info.nCoins++;
+        pcursorCount->Next();
+    }
+
+    boost::filesystem::path pathTmp = path;
+    pathTmp += ".new";
+    FILE* file = fopen(pathTmp.string().c_str(), "wb");
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull()) {
+        strError = strprintf("failed to open file %s", pathTmp.string());
+        return false;
+    }
+    try {
+        CHashedFileWriter writer(fileout);
+        writer << SNAPSHOT_MAGIC << SNAPSHOT_FORMAT_VERSION << info.blockHash << info.nHeight << info.nCoins;
+
+        uint64_t nWritten = 0;
+        for (; pcursor->Valid(); pcursor->Next()) {
+            boost::this_thread::interruption_point();
+            COutPoint outpoint;
+            Coin coin;
+            if (!pcursor->GetKey(outpoint) || !pcursor->GetValue(coin)) {
+                strError = "unable to read the coins database";
+                return false;
+            }
+            writer << outpoint << coin;
+            nWritten++;
+        }
+        if (nWritten != info.nCoins) {
+            strError = "coins database changed while writing";
+            return false;
+        }
+
+        writer << mnList << vecQuorums << vchGovernance;
+        info.hash = writer.GetHash();
+        fileout << info.hash;
+    } catch (const std::exception& e) {
+        strError = strprintf("I/O error - %s", e.what());
+        return false;
+    }
+    FileCommit(fileout.Get());
+    fileout.fclose();
+
+    if (!RenameOver(pathTmp, path)) {
+        strError = "rename-into-place failed";
+        return false;
+    }
+    return true;
+}
+
+bool CChainStateSnapshot::Verify(const boost::filesystem::path& path, const uint256& expectedHash, CChainStateSnapshotInfo& info, std::string& strError)
+{
+    FILE* file = fopen(path.string().c_str(), "rb");
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        strError = strprintf("failed to open file %s", path.string());
+        return false;
+    }
+
+    try {
+        CHashVerifier<CAutoFile> verifier(&filein);
+        std::string strMagic;
+        int nFormatVersion;
+        verifier >> strMagic >> nFormatVersion;
+        if (strMagic != SNAPSHOT_MAGIC || nFormatVersion != SNAPSHOT_FORMAT_VERSION) {
+            strError = "not a snapshot of this version";
+            return false;
+        }
+        verifier >> info.blockHash >> info.nHeight >> info.nCoins;
+
+        for (uint64_t i = 0; i < info.nCoins; i++) {
+            boost::this_thread::interruption_point();
+            COutPoint outpoint;
+            Coin coin;
+            verifier >> outpoint >> coin;
+            if (coin.IsSpent()) {
+                strError = strprintf("spent coin %s in the snapshot", outpoint.ToStringShort());
+                return false;
+            }
+        }
+
+        CDeterministicMNList mnList;
+        QuorumCommitments vecQuorums;
+        std::vector<unsigned char> vchGovernance;
+        verifier >> mnList >> vecQuorums >> vchGovernance;
+        if (mnList.GetBlockHash() != info.blockHash) {
+            strError = "masternode list is not the one of the snapshot block";
+            return false;
+        }
+        for (const auto& p : vecQuorums) {
+            if (p.second.IsNull()) {
+                strError = "null quorum commitment in the snapshot";
+                return false;
+            }
+        }
+        info.nMasternodes = mnList.GetAllMNsCount();
+        info.nQuorums = vecQuorums.size();
+        info.nGovernanceSize = vchGovernance.size();
+
+        info.hash = verifier.GetHash();
+        uint256 hashFile;
+        filein >> hashFile;
+        if (hashFile != info.hash) {
+            strError = "snapshot is corrupted";
+            return false;
+        }
+        if (fgetc(filein.Get()) != EOF) {
+            strError = "data after the snapshot";
+            return false;
+        }
+    } catch (const std::exception& e) {
+        strError = strprintf("invalid snapshot - %s", e.what());
+        return false;
+    }
+
+    if (!expectedHash.IsNull() && info.hash != expectedHash) {
+        strError = strprintf("snapshot hash %s doesn't match the expected %s", info.hash.ToString(), expectedHash.ToString());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,44 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CHAINSNAPSHOT_H
+#define CHAINSNAPSHOT_H
+
+#include "uint256.h"
+
+#include <boost/filesystem/path.hpp>
+
+#include <string>
+
+struct CChainStateSnapshotInfo
+{
+    uint256 blockHash;
+    int nHeight{-1};
+    uint64_t nCoins{0};
+    uint64_t nMasternodes{0};
+    uint64_t nQuorums{0};
+    uint64_t nGovernanceSize{0};
+    /// SHA256d of the snapshot, which is what gets compared against a trusted hash
+    uint256 hash;
+};
+
+/**
+ * Bootstrap snapshot of the chain state at the active tip: the UTXO set, the deterministic
+ * masternode list, the commitments of the active quorums and the serialized governance store.
+ *
+ * Format: magic, format version, block hash, height, coin count, (outpoint, coin) records,
+ * the masternode list, (mined block hash, commitment) pairs of the active quorums, the
+ * governance store as a byte vector and finally the SHA256d of everything before it.
+ */
+class CChainStateSnapshot
+{
+public:
+    /// Flush the chain state and write a snapshot of it, the lock on cs_main is only held to pin the tip
+    static bool Dump(const boost::filesystem::path& path, CChainStateSnapshotInfo& info, std::string& strError);
+
+    /// Read a whole snapshot and check that it's well formed and hashes to expectedHash (if not null)
+    static bool Verify(const boost::filesystem::path& path, const uint256& expectedHash, CChainStateSnapshotInfo& info, std::string& strError);
+};
+
+#endif // CHAINSNAPSHOT_H
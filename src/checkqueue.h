@@ -16,6 +16,16 @@
 template <typename T>
 class CCheckQueueControl;
 
+/**
+ * Called by the threads of a CCheckQueue once all checks of a batch succeeded. Checks which defer part of their work
+ * to the end of the batch provide an overload, see CScriptCheck.
+ */
+template <typename T>
+bool FinishCheckBatch(std::vector<T>& vChecks)
+{
+    return true;
+}
+
 /** 
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
@@ -122,6 +132,8 @@ private:
             BOOST_FOREACH (T& check, vChecks)
                 if (fOk)
                     fOk = check();
+            if (fOk)
+                fOk = FinishCheckBatch(vChecks);
             vChecks.clear();
         } while (true);
     }
@@ -35,6 +35,10 @@ Client::Client(const std::string& host, long port)
   http_ = new http::TransportCurl();
 }
 
+Client::Client(const std::string& host, long port, http::Transport* transport)
+    : url_prefix_("http://" + host + ":" + std::to_string(port) + "/api/v0"),
+      http_(transport) {}
+
 Client::~Client() { delete http_; }
 
 void Client::Id(Json* id) { FetchAndParseJson(MakeUrl("id"), id); }
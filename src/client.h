@@ -57,6 +57,15 @@ class Client {
       /** [in] Port to connect to. */
       long port);
 
+  /** Constructor using the given transport instead of a `TransportCurl`. */
+  Client(
+      /** [in] Hostname or IP address of the server to connect to. */
+      const std::string& host,
+      /** [in] Port to connect to. */
+      long port,
+      /** [in] Transport to use, the client takes ownership. */
+      http::Transport* transport);
+
   /** Destructor.
    * @since version 0.1.0 */
   ~Client();
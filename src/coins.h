@@ -11,6 +11,7 @@
 #include "hash.h"
 #include "memusage.h"
 #include "serialize.h"
+#include "support/allocators/pool.h"
 #include "uint256.h"
 
 #include <assert.h>
@@ -117,7 +118,16 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * The cache entries are allocated from a CPoolResource instead of one malloc each, which saves the malloc overhead
+ * of every entry. The blocks are sized for the nodes of std::unordered_map, which hold the entry, the next pointer and
+ * the cached hash. Scripts of up to 28 bytes are stored inline in the entry by CScript's prevector.
+ */
+typedef pool_allocator<std::pair<const COutPoint, CCoinsCacheEntry>,
+                       sizeof(std::pair<const COutPoint, CCoinsCacheEntry>) + sizeof(void*) * 4,
+                       alignof(void*)> CCoinsMapAllocator;
+typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>, CCoinsMapAllocator> CCoinsMap;
+typedef CCoinsMapAllocator::resource_type CCoinsMapMemoryResource;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -198,6 +208,8 @@ protected:
      * declared as "const".  
      */
     mutable uint256 hashBlock;
+    // cacheCoins allocates its entries from here, so it has to be declared first
+    mutable CCoinsMapMemoryResource cacheCoinsMemoryResource;
     mutable CCoinsMap cacheCoins;
 
     /* Cached dynamic memory usage for the inner Coin objects. */
@@ -261,6 +273,12 @@ public:
      */
     void Uncache(const COutPoint &outpoint);
 
+    /**
+     * Adds a coin which was read from the base view by the caller, e.g. in parallel
+     * ahead of time. Does nothing if the outpoint is already cached.
+     */
+    void AddFetchedCoin(const COutPoint &outpoint, Coin&& coin);
+
     //! Calculate the size of the cache (in number of transaction outputs)
     unsigned int GetCacheSize() const;
 
@@ -283,6 +301,9 @@ public:
 private:
     CCoinsMap::iterator FetchCoin(const COutPoint &outpoint) const;
 
+    //! Give the memory of the (empty) cache back, CCoinsMap::clear() keeps the buckets and the pool's chunks
+    void ReallocateCache();
+
     /**
      * By making the copy constructor private, we prevent accidentally using it when one intends to create a cache on top of a base cache.
      */
@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string>
 
 /** A hasher class for SHA-256. */
 class CSHA256
@@ -26,4 +27,20 @@ public:
     CSHA256& Reset();
 };
 
+/**
+ * Select the fastest SHA256 implementations the CPU supports, i.e. SHA-NI or SSE4 for single messages and the
+ * 2/4/8 lane kernels for SHA256D64. Must be called once before hashing from multiple threads.
+ * Returns a description of the selected implementations.
+ */
+std::string SHA256AutoDetect();
+
+/**
+ * Compute multiple double-SHA256's of 64-byte blobs, as used in merkle trees.
+ * output: pointer to a blocks*32 byte output buffer
+ * input:  pointer to a blocks*64 byte input buffer
+ * blocks: the number of hashes to compute.
+ * The output may overlap the input, as long as it doesn't start after it.
+ */
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
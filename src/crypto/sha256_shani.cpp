@@ -0,0 +1,154 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// SHA256 on the Intel SHA extensions. The state is kept in the ABEF/CDGH register layout sha256rnds2 expects,
+// each sha256rnds2 performs two rounds.
+
+#ifdef ENABLE_SHANI
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "crypto/common.h"
+
+namespace {
+
+alignas(16) const uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+alignas(16) const uint32_t IV256[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+/** Swaps the bytes of each 32 bit word */
+inline __m128i ByteSwap(__m128i x)
+{
+    return _mm_shuffle_epi8(x, _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL));
+}
+
+/** Convert the state words A..H into the ABEF/CDGH layout */
+inline void Load(const uint32_t* s, __m128i& state0, __m128i& state1)
+{
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)s), 0xB1); // CDAB
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(s + 4)), 0x1B); // EFGH
+    state0 = _mm_alignr_epi8(tmp, state1, 8); // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0); // CDGH
+}
+
+/** Convert the ABEF/CDGH layout back into the words A-D and E-H */
+inline void Unpack(__m128i state0, __m128i state1, __m128i& abcd, __m128i& efgh)
+{
+    __m128i tmp = _mm_shuffle_epi32(state0, 0x1B); // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1); // DCHG
+    abcd = _mm_blend_epi16(tmp, state1, 0xF0); // DCBA
+    efgh = _mm_alignr_epi8(state1, tmp, 8); // HGFE
+}
+
+/**
+ * One SHA-256 transformation of N independent states, m holds their message words and is overwritten. The
+ * transformations are interleaved so the latency of sha256rnds2 is hidden by the other states.
+ */
+template<int N>
+inline void Transform(__m128i* state0, __m128i* state1, __m128i (*m)[4])
+{
+    __m128i save0[N], save1[N];
+    for (int j = 0; j < N; j++) {
+        save0[j] = state0[j];
+        save1[j] = state1[j];
+    }
+    for (int g = 0; g < 16; g++) {
+        const __m128i k = _mm_load_si128((const __m128i*)(K256 + 4 * g));
+        for (int j = 0; j < N; j++) {
+            __m128i* w = m[j];
+            if (g >= 4) {
+                // w[g & 3] holds the words 4*g-16..4*g-13 and is replaced by the words 4*g..4*g+3
+                __m128i tmp = _mm_add_epi32(_mm_sha256msg1_epu32(w[g & 3], w[(g + 1) & 3]), _mm_alignr_epi8(w[(g + 3) & 3], w[(g + 2) & 3], 4));
+                w[g & 3] = _mm_sha256msg2_epu32(tmp, w[(g + 3) & 3]);
+            }
+            __m128i msg = _mm_add_epi32(w[g & 3], k);
+            state1[j] = _mm_sha256rnds2_epu32(state1[j], state0[j], msg);
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0[j] = _mm_sha256rnds2_epu32(state0[j], state1[j], msg);
+        }
+    }
+    for (int j = 0; j < N; j++) {
+        state0[j] = _mm_add_epi32(state0[j], save0[j]);
+        state1[j] = _mm_add_epi32(state1[j], save1[j]);
+    }
+}
+
+}
+
+namespace sha256_shani {
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    __m128i state0, state1, m[1][4];
+    Load(s, state0, state1);
+    while (blocks--) {
+        for (int i = 0; i < 4; i++) {
+            m[0][i] = ByteSwap(_mm_loadu_si128((const __m128i*)(chunk + 16 * i)));
+        }
+        ::Transform<1>(&state0, &state1, m);
+        chunk += 64;
+    }
+    __m128i abcd, efgh;
+    Unpack(state0, state1, abcd, efgh);
+    _mm_storeu_si128((__m128i*)s, abcd);
+    _mm_storeu_si128((__m128i*)(s + 4), efgh);
+}
+}
+
+namespace sha256d64_shani {
+void Transform_2way(unsigned char* out, const unsigned char* in)
+{
+    __m128i iv0, iv1;
+    Load(IV256, iv0, iv1);
+
+    __m128i state0[2], state1[2], m[2][4];
+
+    // Transform 1: the 64 byte inputs
+    for (int j = 0; j < 2; j++) {
+        state0[j] = iv0;
+        state1[j] = iv1;
+        for (int i = 0; i < 4; i++) {
+            m[j][i] = ByteSwap(_mm_loadu_si128((const __m128i*)(in + 64 * j + 16 * i)));
+        }
+    }
+    Transform<2>(state0, state1, m);
+
+    // Transform 2: padding of the 64 byte messages
+    for (int j = 0; j < 2; j++) {
+        m[j][0] = _mm_set_epi32(0, 0, 0, 0x80000000ul);
+        m[j][1] = _mm_setzero_si128();
+        m[j][2] = _mm_setzero_si128();
+        m[j][3] = _mm_set_epi32(0x200, 0, 0, 0);
+    }
+    Transform<2>(state0, state1, m);
+
+    // Transform 3: the 32 byte hashes of the first SHA256 and their padding
+    for (int j = 0; j < 2; j++) {
+        Unpack(state0[j], state1[j], m[j][0], m[j][1]);
+        m[j][2] = _mm_set_epi32(0, 0, 0, 0x80000000ul);
+        m[j][3] = _mm_set_epi32(0x100, 0, 0, 0);
+        state0[j] = iv0;
+        state1[j] = iv1;
+    }
+    Transform<2>(state0, state1, m);
+
+    for (int j = 0; j < 2; j++) {
+        __m128i abcd, efgh;
+        Unpack(state0[j], state1[j], abcd, efgh);
+        _mm_storeu_si128((__m128i*)(out + 32 * j), ByteSwap(abcd));
+        _mm_storeu_si128((__m128i*)(out + 32 * j + 16), ByteSwap(efgh));
+    }
+}
+}
+
+#endif
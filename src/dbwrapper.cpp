@@ -15,6 +15,9 @@
 #include <memenv.h>
 #include <stdint.h>
 #include <algorithm>
+#include <map>
+#include <mutex>
+#include <set>
 
 class CBitcoinLevelDBLogger : public leveldb::Logger {
 public:
@@ -73,13 +76,68 @@ public:
     }
 };
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+static CDBProfile MakeProfile(int nBlockCachePercent, int nFilterBits, size_t nBlockSize)
+{
+    CDBProfile profile;
+    profile.nBlockCachePercent = nBlockCachePercent;
+    profile.nFilterBits = nFilterBits;
+    profile.nBlockSize = nBlockSize;
+    return profile;
+}
+
+// Databases which aren't listed use the defaults of CDBProfile, which suit point reads like those of the UTXO set
+static const std::map<std::string, CDBProfile> mapDefaultProfiles = {
+    // the recovered sigs and islocks are mostly appended, give more of the cache to the write buffers
+    {"llmq", MakeProfile(25, 10, 4 << 10)},
+    // only ever read by range scans, which bloom filters don't help
+    {"addressindex", MakeProfile(50, 0, 16 << 10)},
+    {"timestampindex", MakeProfile(50, 0, 16 << 10)},
+    // large values read by block hash
+    {"blockfilterindex", MakeProfile(50, 10, 16 << 10)},
+};
+
+CDBProfile GetDBProfile(const std::string& strName)
+{
+    auto it = mapDefaultProfiles.find(strName);
+    CDBProfile profile = it != mapDefaultProfiles.end() ? it->second : CDBProfile();
+
+    if (!mapMultiArgs.count("-dbprofile")) {
+        return profile;
+    }
+    for (const std::string& strOverride : mapMultiArgs.at("-dbprofile")) {
+        // <name>:<key>=<value>
+        size_t nColon = strOverride.find(':');
+        size_t nEquals = strOverride.find('=', nColon);
+        if (nColon == std::string::npos || nEquals == std::string::npos || strOverride.substr(0, nColon) != strName) {
+            continue;
+        }
+        std::string strKey = strOverride.substr(nColon + 1, nEquals - nColon - 1);
+        int64_t nValue = atoi64(strOverride.substr(nEquals + 1));
+        if (strKey == "blockcache") {
+            profile.nBlockCachePercent = std::max<int64_t>(0, std::min<int64_t>(100, nValue));
+        } else if (strKey == "filterbits") {
+            profile.nFilterBits = std::max<int64_t>(0, std::min<int64_t>(64, nValue));
+        } else if (strKey == "compression") {
+            profile.fCompression = nValue != 0;
+        } else if (strKey == "blocksize") {
+            // in KiB
+            profile.nBlockSize = (size_t)std::max<int64_t>(1, std::min<int64_t>(1024, nValue)) << 10;
+        } else {
+            LogPrintf("%s: unknown -dbprofile key %s\n", __func__, strKey);
+        }
+    }
+    return profile;
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, const CDBProfile& profile)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
+    size_t nBlockCacheSize = nCacheSize / 100 * profile.nBlockCachePercent;
+    options.block_cache = leveldb::NewLRUCache(nBlockCacheSize);
+    options.write_buffer_size = (nCacheSize - nBlockCacheSize) / 2; // up to two write buffers may be held in memory simultaneously
+    options.filter_policy = profile.nFilterBits > 0 ? leveldb::NewBloomFilterPolicy(profile.nFilterBits) : nullptr;
+    options.compression = profile.fCompression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+    options.block_size = profile.nBlockSize;
     options.max_open_files = 64;
     options.info_log = new CBitcoinLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
@@ -90,14 +148,21 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
+// open databases, for GetAllStats
+static std::mutex cs_openDBs;
+static std::set<const CDBWrapper*> setOpenDBs;
+
+CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSizeIn, bool fMemory, bool fWipe, bool obfuscate, const std::string& strNameIn) :
+    strName(strNameIn.empty() ? path.filename().string() : strNameIn),
+    profile(GetDBProfile(strName)),
+    nCacheSize(nCacheSizeIn)
 {
     penv = NULL;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    options = GetOptions(nCacheSize, profile);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -139,10 +204,17 @@ CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, b
     }
 
     LogPrintf("Using obfuscation key for %s: %s\n", path.string(), HexStr(obfuscate_key));
+
+    std::lock_guard<std::mutex> lock(cs_openDBs);
+    setOpenDBs.emplace(this);
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    {
+        std::lock_guard<std::mutex> lock(cs_openDBs);
+        setOpenDBs.erase(this);
+    }
     delete pdb;
     pdb = NULL;
     delete options.filter_policy;
@@ -155,6 +227,33 @@ CDBWrapper::~CDBWrapper()
     options.env = NULL;
 }
 
+CDBStats CDBWrapper::GetStats() const
+{
+    CDBStats stats;
+    stats.strName = strName;
+    stats.profile = profile;
+    stats.nCacheSize = nCacheSize;
+    std::string strValue;
+    stats.nMemoryUsage = pdb->GetProperty("leveldb.approximate-memory-usage", &strValue) ? atoi64(strValue) : 0;
+    stats.nFiles = 0;
+    for (int nLevel = 0; pdb->GetProperty("leveldb.num-files-at-level" + std::to_string(nLevel), &strValue); nLevel++) {
+        stats.nFiles += atoi64(strValue);
+    }
+    stats.readStats = GetReadStats();
+    return stats;
+}
+
+std::vector<CDBStats> CDBWrapper::GetAllStats()
+{
+    std::lock_guard<std::mutex> lock(cs_openDBs);
+    std::vector<CDBStats> vStats;
+    for (const CDBWrapper* pdbw : setOpenDBs) {
+        vStats.emplace_back(pdbw->GetStats());
+    }
+    std::sort(vStats.begin(), vStats.end(), [](const CDBStats& a, const CDBStats& b) { return a.strName < b.strName; });
+    return vStats;
+}
+
 bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
 {
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
@@ -12,6 +12,9 @@
 #include "utilstrencodings.h"
 #include "version.h"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <typeindex>
 
 #include <boost/filesystem/path.hpp>
@@ -195,6 +198,51 @@ public:
 
 };
 
+/** Read statistics of a single database, see CDBWrapper::GetReadStats */
+struct CDBReadStats
+{
+    //! number of point reads, including the keys of multi reads
+    uint64_t nReads;
+    //! number of point reads which found the key
+    uint64_t nReadsFound;
+    //! total size of the values read
+    uint64_t nBytesRead;
+    //! number of ReadMany calls
+    uint64_t nMultiReads;
+};
+
+/**
+ * LevelDB tuning of a database. Each database has a built-in profile by name which can be
+ * overridden with -dbprofile=<name>:<key>=<value>, see GetDBProfile.
+ */
+struct CDBProfile
+{
+    //! percentage of the cache size used for the block cache, the rest is for the write buffers
+    int nBlockCachePercent{50};
+    //! bits per key of the bloom filter, which only helps point reads, 0 for none
+    int nFilterBits{10};
+    //! snappy compression, only takes effect if LevelDB was built with snappy
+    bool fCompression{false};
+    //! uncompressed size of the table blocks, larger blocks suit range scans better than point reads
+    size_t nBlockSize{4 << 10};
+};
+
+/** The profile of the database called strName, with the -dbprofile overrides applied */
+CDBProfile GetDBProfile(const std::string& strName);
+
+/** Statistics of an open database, see CDBWrapper::GetAllStats */
+struct CDBStats
+{
+    std::string strName;
+    CDBProfile profile;
+    size_t nCacheSize;
+    //! memory used by the memtables and the block cache, as estimated by LevelDB
+    uint64_t nMemoryUsage;
+    //! number of table files
+    uint64_t nFiles;
+    CDBReadStats readStats;
+};
+
 class CDBWrapper
 {
     friend const std::vector<unsigned char>& dbwrapper_private::GetObfuscateKey(const CDBWrapper &w);
@@ -220,6 +268,11 @@ private:
     //! the database itself
     leveldb::DB* pdb;
 
+    //! name of the database, which selects its CDBProfile
+    std::string strName;
+    CDBProfile profile;
+    size_t nCacheSize;
+
     //! a key used for optional XOR-obfuscation of the database
     std::vector<unsigned char> obfuscate_key;
 
@@ -231,6 +284,47 @@ private:
 
     std::vector<unsigned char> CreateObfuscateKey() const;
 
+    mutable std::atomic<uint64_t> nReads{0};
+    mutable std::atomic<uint64_t> nReadsFound{0};
+    mutable std::atomic<uint64_t> nBytesRead{0};
+    mutable std::atomic<uint64_t> nMultiReads{0};
+
+    //! iterator over a snapshot of the database, used by ReadMany
+    struct SnapshotReader
+    {
+        leveldb::DB* pdb;
+        const leveldb::Snapshot* snapshot;
+        std::unique_ptr<leveldb::Iterator> it;
+
+        SnapshotReader(leveldb::DB* _pdb, const leveldb::ReadOptions& readoptions) : pdb(_pdb)
+        {
+            snapshot = pdb->GetSnapshot();
+            leveldb::ReadOptions options = readoptions;
+            options.snapshot = snapshot;
+            it.reset(pdb->NewIterator(options));
+        }
+        ~SnapshotReader()
+        {
+            it.reset();
+            pdb->ReleaseSnapshot(snapshot);
+        }
+
+        //! position the iterator at slKey, returns false if the key does not exist
+        bool Seek(const leveldb::Slice& slKey)
+        {
+            it->Seek(slKey);
+            if (it->Valid()) {
+                return it->key() == slKey;
+            }
+            leveldb::Status status = it->status();
+            if (!status.ok()) {
+                LogPrintf("LevelDB read failure: %s\n", status.ToString());
+                dbwrapper_private::HandleError(status);
+            }
+            return false;
+        }
+    };
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
@@ -239,8 +333,10 @@ public:
      * @param[in] fWipe       If true, remove all existing data.
      * @param[in] obfuscate   If true, store data obfuscated via simple XOR. If false, XOR
      *                        with a zero'd byte array.
+     * @param[in] strNameIn   Name of the database, which selects its CDBProfile. Defaults to
+     *                        the name of the directory.
      */
-    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
+    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSizeIn, bool fMemory = false, bool fWipe = false, bool obfuscate = false, const std::string& strNameIn = "");
     ~CDBWrapper();
 
     template <typename K>
@@ -257,6 +353,7 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         std::string strValue;
+        nReads++;
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
@@ -264,6 +361,8 @@ public:
             LogPrintf("LevelDB read failure: %s\n", status.ToString());
             dbwrapper_private::HandleError(status);
         }
+        nReadsFound++;
+        nBytesRead += strValue.size();
         CDataStream ssValueTmp(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
         ssValueTmp.Xor(obfuscate_key);
         ssValue = std::move(ssValueTmp);
@@ -295,6 +394,61 @@ public:
         return true;
     }
 
+    /**
+     * Read multiple keys from one consistent snapshot of the database. The keys are resolved in database
+     * order with a single iterator, so every table block is only touched once. values and found are
+     * resized to the number of keys and filled at the index of their key. Returns the number of keys found.
+     */
+    template <typename K, typename V>
+    size_t ReadMany(const std::vector<K>& keys, std::vector<V>& values, std::vector<bool>& found) const
+    {
+        values.assign(keys.size(), V());
+        found.assign(keys.size(), false);
+        nMultiReads++;
+
+        std::vector<CDataStream> vKeys;
+        vKeys.reserve(keys.size());
+        for (const auto& key : keys) {
+            vKeys.emplace_back(SER_DISK, CLIENT_VERSION);
+            vKeys.back().reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+            vKeys.back() << key;
+        }
+        std::vector<size_t> vOrder(keys.size());
+        for (size_t i = 0; i < vOrder.size(); i++) {
+            vOrder[i] = i;
+        }
+        std::sort(vOrder.begin(), vOrder.end(), [&](size_t a, size_t b) {
+            leveldb::Slice slA(vKeys[a].data(), vKeys[a].size());
+            leveldb::Slice slB(vKeys[b].data(), vKeys[b].size());
+            // the databases use leveldb's default bytewise comparator
+            return slA.compare(slB) < 0;
+        });
+
+        // the iterator is released before the snapshot, even when HandleError throws
+        SnapshotReader reader(pdb, readoptions);
+        size_t nFound = 0;
+        for (size_t i : vOrder) {
+            leveldb::Slice slKey(vKeys[i].data(), vKeys[i].size());
+            nReads++;
+            if (!reader.Seek(slKey)) {
+                continue;
+            }
+            leveldb::Slice slValue = reader.it->value();
+            nReadsFound++;
+            nBytesRead += slValue.size();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue.Xor(obfuscate_key);
+            try {
+                ssValue >> values[i];
+            } catch (const std::exception&) {
+                continue;
+            }
+            found[i] = true;
+            nFound++;
+        }
+        return nFound;
+    }
+
     template <typename K, typename V>
     bool Write(const K& key, const V& value, bool fSync = false)
     {
@@ -317,6 +471,7 @@ public:
         leveldb::Slice slKey(key.data(), key.size());
 
         std::string strValue;
+        nReads++;
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
@@ -324,6 +479,7 @@ public:
             LogPrintf("LevelDB read failure: %s\n", status.ToString());
             dbwrapper_private::HandleError(status);
         }
+        nReadsFound++;
         return true;
     }
 
@@ -359,6 +515,16 @@ public:
      */
     bool IsEmpty();
 
+    CDBReadStats GetReadStats() const
+    {
+        return CDBReadStats{nReads, nReadsFound, nBytesRead, nMultiReads};
+    }
+
+    CDBStats GetStats() const;
+
+    //! Statistics of all open databases
+    static std::vector<CDBStats> GetAllStats();
+
     template<typename K>
     size_t EstimateSize(const K& key_begin, const K& key_end) const
     {
@@ -691,11 +857,21 @@ public:
     }
 
     void Commit() {
-        for (const auto &k : deletes) {
-            commitTarget.Erase(k);
-        }
-        for (auto &p : writes) {
-            p.second->Write(p.first, commitTarget);
+        // A key is never in both deletes and writes. Commit both in key order, which makes the resulting LevelDB batch
+        // sorted, and release every entry as soon as it moved to commitTarget so that the transaction and a batch
+        // commitTarget never hold all data twice at the same time
+        auto itDelete = deletes.begin();
+        auto itWrite = writes.begin();
+        while (itDelete != deletes.end() || itWrite != writes.end()) {
+            if (itWrite == writes.end() || (itDelete != deletes.end() && DataStreamCmp::less(*itDelete, itWrite->first))) {
+                commitTarget.Erase(*itDelete);
+                memoryUsage -= itDelete->size();
+                itDelete = deletes.erase(itDelete);
+            } else {
+                itWrite->second->Write(itWrite->first, commitTarget);
+                memoryUsage -= itWrite->first.size() + itWrite->second->memoryUsage;
+                itWrite = writes.erase(itWrite);
+            }
         }
         Clear();
     }
@@ -6,6 +6,7 @@
 #include "dsnotificationinterface.h"
 #include "instantx.h"
 #include "governance.h"
+#include "masternode-meta.h"
 #include "masternode-payments.h"
 #include "masternode-sync.h"
 #include "privatesend.h"
@@ -45,6 +46,7 @@ void CDSNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, con
         return;
 
     deterministicMNManager->UpdatedBlockTip(pindexNew);
+    mnpayments.UpdatedBlockTip(pindexNew);
 
     masternodeSync.UpdatedBlockTip(pindexNew, fInitialDownload, connman);
 
@@ -78,6 +80,8 @@ void CDSNotificationInterface::SyncTransaction(const CTransaction &tx, const CBl
     llmq::chainLocksHandler->SyncTransaction(tx, pindex, posInBlock);
     instantsend.SyncTransaction(tx, pindex, posInBlock);
     CPrivateSend::SyncTransaction(tx, pindex, posInBlock);
+    mmetaman.SyncTransaction(tx, pindex, posInBlock);
+    governance.SyncTransaction(tx, pindex, posInBlock);
 }
 
 void CDSNotificationInterface::NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff)
@@ -8,6 +8,8 @@
 #include "base58.h"
 #include "chainparams.h"
 #include "core_io.h"
+#include "core_memusage.h"
+#include "memusage.h"
 #include "script/standard.h"
 #include "ui_interface.h"
 #include "validation.h"
@@ -19,6 +21,9 @@
 
 #include <univalue.h>
 
+#include <algorithm>
+#include <tuple>
+
 static const std::string DB_LIST_SNAPSHOT = "dmn_S";
 static const std::string DB_LIST_DIFF = "dmn_D";
 
@@ -98,6 +103,50 @@ void CDeterministicMN::ToJson(UniValue& obj) const
     obj.push_back(Pair("state", stateObj));
 }
 
+// Map entries per MN in a list: mnMap, mnInternalIdMap, mnUniquePropertyMap and mnPaymentQueue
+static const size_t DMN_LIST_USAGE_PER_MN = sizeof(uint256) + sizeof(CDeterministicMNCPtr) +
+                                            sizeof(uint64_t) + sizeof(uint256) +
+                                            7 * (2 * sizeof(uint256) + sizeof(uint32_t)) +
+                                            sizeof(std::pair<int, uint256>);
+
+static size_t StringDynamicUsage(const std::string& s)
+{
+    // short strings are stored inline
+    return s.capacity() > 15 ? memusage::MallocUsage(s.capacity() + 1) : 0;
+}
+
+size_t CSerializedCache::DynamicMemoryUsage() const
+{
+    auto data = std::atomic_load(&vchData);
+    return data ? memusage::DynamicUsage(data) + memusage::DynamicUsage(*data) : 0;
+}
+
+size_t CDeterministicMNState::DynamicMemoryUsage() const
+{
+    return RecursiveDynamicUsage(scriptPayout) +
+           RecursiveDynamicUsage(scriptOperatorPayout) +
+           StringDynamicUsage(IPFSPeerID) +
+           StringDynamicUsage(Identity) +
+           serializedCache.DynamicMemoryUsage();
+}
+
+size_t CDeterministicMNList::DynamicMemoryUsage(std::unordered_set<const void*>& setSeen) const
+{
+    size_t nUsage = sizeof(CDeterministicMNList);
+    for (const auto& p : mnMap) {
+        const auto& dmn = p.second;
+        if (!setSeen.emplace(dmn.get()).second) {
+            continue;
+        }
+        // a MN object not seen before also means new map nodes on the way to it
+        nUsage += DMN_LIST_USAGE_PER_MN + memusage::DynamicUsage(dmn);
+        if (setSeen.emplace(dmn->pdmnState.get()).second) {
+            nUsage += memusage::DynamicUsage(dmn->pdmnState) + dmn->pdmnState->DynamicMemoryUsage();
+        }
+    }
+    return nUsage;
+}
+
 bool CDeterministicMNList::IsVNValid(const COutPoint& collateralOutpoint) const
 {
     Coin coin;
@@ -109,26 +158,16 @@ bool CDeterministicMNList::IsVNValid(const COutPoint& collateralOutpoint) const
     return false;
 }
 
-std::vector<std::string> CDeterministicMNList::GetIdentitiesInUse() const
+bool CDeterministicMNList::IsIdentityInUse(const std::string& identity) const
 {
-    std::vector<std::string> identities;
-
-    ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
-        identities.emplace_back(dmn->pdmnState->Identity);
-    });
-
-    return identities;
+    auto dmn = GetUniquePropertyMN(identity);
+    return dmn && IsMNValid(dmn);
 }
 
-std::vector<std::string> CDeterministicMNList::GetIPFSPeerIdInUse() const
+bool CDeterministicMNList::IsIPFSPeerIdInUse(const std::string& ipfsPeerId) const
 {
-    std::vector<std::string> ipfsPeerIDs;
-
-    ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
-        ipfsPeerIDs.emplace_back(dmn->pdmnState->IPFSPeerID);
-    });
-
-    return ipfsPeerIDs;
+    auto dmn = GetUniquePropertyMN(ipfsPeerId);
+    return dmn && IsMNValid(dmn);
 }
 
 bool CDeterministicMNList::IsMNValid(const uint256& proTxHash) const
@@ -237,19 +276,10 @@ static int CompareByLastPaid_GetHeight(const CDeterministicMN& dmn)
     return height;
 }
 
-static bool CompareByLastPaid(const CDeterministicMN& _a, const CDeterministicMN& _b)
-{
-    int ah = CompareByLastPaid_GetHeight(_a);
-    int bh = CompareByLastPaid_GetHeight(_b);
-    if (ah == bh) {
-        return _a.proTxHash < _b.proTxHash;
-    } else {
-        return ah < bh;
-    }
-}
-static bool CompareByLastPaid(const CDeterministicMNCPtr& _a, const CDeterministicMNCPtr& _b)
+// Payment order: by last paid (or registered/revived) height, ties broken by proTxHash
+static std::pair<int, uint256> GetPaymentQueueKey(const CDeterministicMN& dmn)
 {
-    return CompareByLastPaid(*_a, *_b);
+    return std::make_pair(CompareByLastPaid_GetHeight(dmn), dmn.proTxHash);
 }
 
 CDeterministicMNCPtr CDeterministicMNList::GetMNPayee() const
@@ -258,42 +288,33 @@ CDeterministicMNCPtr CDeterministicMNList::GetMNPayee() const
     if (mnMap.size() == 0) {
         return nullptr;
     }
-    int nHeight = 0;
-    CDeterministicMNCPtr best;
-    ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
-       if (CMasternodeMetaMan::CheckCollateralType(dmn->collateralOutpoint) == 1) {
-           if (!best || CompareByLastPaid(dmn, best)) {
-
-                best = dmn;
-            }
+    for (const auto& p : mnPaymentQueue) {
+        auto dmn = GetMN(p.second);
+        if (CMasternodeMetaMan::CheckCollateralType(dmn->collateralOutpoint) == 1) {
+            return dmn;
         }
-    });
-
-    return best;
+    }
+    return nullptr;
 }
 
 std::vector<CDeterministicMNCPtr> CDeterministicMNList::GetProjectedMNPayees(int nCount) const
 {
     //R100C
-    if (nCount > GetValidMNsCount()) {
-        nCount = GetValidMNsCount();
+    if (nCount > (int)mnPaymentQueue.size()) {
+        nCount = mnPaymentQueue.size();
     }
 
     std::vector<CDeterministicMNCPtr> result;
     result.reserve(nCount);
-    int nHeight = 0;
-    int tmpCount = 0;
-    ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
+    for (const auto& p : mnPaymentQueue) {
+        if ((int)result.size() >= nCount) {
+            break;
+        }
+        auto dmn = GetMN(p.second);
         if (CMasternodeMetaMan::CheckCollateralType(dmn->collateralOutpoint) == 1) {
             result.emplace_back(dmn);
-            tmpCount++;
         }
-    });
-    std::sort(result.begin(), result.end(), [&](const CDeterministicMNCPtr& a, const CDeterministicMNCPtr& b) {
-        return CompareByLastPaid(a, b);
-    });
-
-    result.resize(tmpCount);
+    }
 
     return result;
 }
@@ -436,6 +457,16 @@ CDeterministicMNListDiff CDeterministicMNList::BuildDiff(const CDeterministicMNL
     return diffRet;
 }
 
+// Compares the state fields which end up in a CSimplifiedMNListEntry, without building the entries
+static bool IsSimplifiedMNListEntryChanged(const CDeterministicMNState& a, const CDeterministicMNState& b)
+{
+    return (a.nPoSeBanHeight == -1) != (b.nPoSeBanHeight == -1) ||
+           a.confirmedHash != b.confirmedHash ||
+           a.addr != b.addr ||
+           a.keyIDVoting != b.keyIDVoting ||
+           a.pubKeyOperator != b.pubKeyOperator;
+}
+
 CSimplifiedMNListDiff CDeterministicMNList::BuildSimplifiedDiff(const CDeterministicMNList& to) const
 {
     CSimplifiedMNListDiff diffRet;
@@ -446,12 +477,8 @@ CSimplifiedMNListDiff CDeterministicMNList::BuildSimplifiedDiff(const CDetermini
         auto fromPtr = GetMN(toPtr->proTxHash);
         if (fromPtr == nullptr) {
             diffRet.mnList.emplace_back(*toPtr);
-        } else {
-            CSimplifiedMNListEntry sme1(*toPtr);
-            CSimplifiedMNListEntry sme2(*fromPtr);
-            if (sme1 != sme2) {
-                diffRet.mnList.emplace_back(*toPtr);
-            }
+        } else if (fromPtr->pdmnState != toPtr->pdmnState && IsSimplifiedMNListEntryChanged(*fromPtr->pdmnState, *toPtr->pdmnState)) {
+            diffRet.mnList.emplace_back(*toPtr);
         }
     });
     ForEachMN(false, [&](const CDeterministicMNCPtr& fromPtr) {
@@ -503,7 +530,7 @@ void CDeterministicMNList::AddMN(const CDeterministicMNCPtr& dmn)
     }
     AddUniqueProperty(dmn, dmn->pdmnState->IPFSPeerID);
     AddUniqueProperty(dmn, dmn->pdmnState->Identity);
-
+    AddToPaymentQueue(dmn);
 }
 
 void CDeterministicMNList::UpdateMN(const CDeterministicMNCPtr& oldDmn, const CDeterministicMNStateCPtr& pdmnState)
@@ -520,6 +547,8 @@ void CDeterministicMNList::UpdateMN(const CDeterministicMNCPtr& oldDmn, const CD
     UpdateUniqueProperty(dmn, oldState->IPFSPeerID, pdmnState->IPFSPeerID);
     UpdateUniqueProperty(dmn, oldState->Identity, pdmnState->Identity);
 
+    RemoveFromPaymentQueue(oldDmn);
+    AddToPaymentQueue(dmn);
 }
 
 void CDeterministicMNList::UpdateMN(const uint256& proTxHash, const CDeterministicMNStateCPtr& pdmnState)
@@ -552,14 +581,39 @@ void CDeterministicMNList::RemoveMN(const uint256& proTxHash)
     }
     DeleteUniqueProperty(dmn, dmn->pdmnState->IPFSPeerID);
     DeleteUniqueProperty(dmn, dmn->pdmnState->Identity);
+    RemoveFromPaymentQueue(dmn);
 
     mnMap = mnMap.erase(proTxHash);
     mnInternalIdMap = mnInternalIdMap.erase(dmn->internalId);
 }
 
+void CDeterministicMNList::AddToPaymentQueue(const CDeterministicMNCPtr& dmn)
+{
+    if (!IsMNValid(dmn)) {
+        return;
+    }
+    auto key = GetPaymentQueueKey(*dmn);
+    auto it = std::lower_bound(mnPaymentQueue.begin(), mnPaymentQueue.end(), key);
+    assert(it == mnPaymentQueue.end() || *it != key);
+    mnPaymentQueue = mnPaymentQueue.insert(it - mnPaymentQueue.begin(), key);
+}
+
+void CDeterministicMNList::RemoveFromPaymentQueue(const CDeterministicMNCPtr& dmn)
+{
+    if (!IsMNValid(dmn)) {
+        return;
+    }
+    auto key = GetPaymentQueueKey(*dmn);
+    auto it = std::lower_bound(mnPaymentQueue.begin(), mnPaymentQueue.end(), key);
+    assert(it != mnPaymentQueue.end() && *it == key);
+    mnPaymentQueue = mnPaymentQueue.erase(it - mnPaymentQueue.begin());
+}
+
 CDeterministicMNManager::CDeterministicMNManager(CEvoDB& _evoDb) :
     evoDb(_evoDb)
 {
+    nListsCacheDepth = std::max(1, (int)GetArg("-dmnlistcachedepth", DEFAULT_DMN_LIST_CACHE_DEPTH));
+    nHistoricalCacheMaxUsage = (size_t)std::max((int64_t)0, GetArg("-dmncachemb", DEFAULT_DMN_CACHE_MB)) << 20;
 }
 
 bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& _state, bool fJustCheck)
@@ -647,7 +701,7 @@ bool CDeterministicMNManager::UndoBlock(const CBlock& block, const CBlockIndex*
         evoDb.Erase(std::make_pair(DB_LIST_DIFF, blockHash));
         evoDb.Erase(std::make_pair(DB_LIST_SNAPSHOT, blockHash));
 
-        mnListsCache.erase(blockHash);
+        EraseCachedList(blockHash);
     }
 
     if (diff.HasChanges()) {
@@ -669,6 +723,7 @@ void CDeterministicMNManager::UpdatedBlockTip(const CBlockIndex* pindex)
     LOCK(cs);
 
     tipIndex = pindex;
+    UpdateIdentityIndex(GetListForBlock(pindex));
 }
 
 bool CDeterministicMNManager::BuildNewListFromBlock(const CBlock& block, const CBlockIndex* pindexPrev, CValidationState& _state, CDeterministicMNList& mnListRet, bool debugLogs)
@@ -838,12 +893,12 @@ bool CDeterministicMNManager::BuildNewListFromBlock(const CBlock& block, const C
                 return _state.DoS(100, false, REJECT_INVALID, "bad-protx-hash");
             }
             auto newState = std::make_shared<CDeterministicMNState>(*dmn->pdmnState);
-            if (newState->pubKeyOperator.Get() != proTx.pubKeyOperator) {
+            if (newState->pubKeyOperator.Get() != proTx.pubKeyOperator.Get()) {
                 // reset all operator related fields and put MN into PoSe-banned state in case the operator key changes
                 newState->ResetOperatorFields();
                 newState->BanIfNotBanned(nHeight);
             }
-            newState->pubKeyOperator.Set(proTx.pubKeyOperator);
+            newState->pubKeyOperator = proTx.pubKeyOperator;
             newState->IPFSPeerID  = proTx.IPFSPeerID;
             newState->keyIDVoting = proTx.keyIDVoting;
             newState->scriptPayout = proTx.scriptPayout;
@@ -968,23 +1023,28 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
     CDeterministicMNList snapshot;
     std::list<std::pair<const CBlockIndex*, CDeterministicMNListDiff>> listDiff;
 
+    // try using cache before reading from disk
+    if (GetCachedList(pindex->GetBlockHash(), snapshot)) {
+        nCacheHits++;
+        return snapshot;
+    }
+    nCacheMisses++;
+
+    const CBlockIndex* pindexRequested = pindex;
     while (true) {
-        // try using cache before reading from disk
-        auto it = mnListsCache.find(pindex->GetBlockHash());
-        if (it != mnListsCache.end()) {
-            snapshot = it->second;
+        if (pindex != pindexRequested && GetCachedList(pindex->GetBlockHash(), snapshot)) {
             break;
         }
 
         if (evoDb.Read(std::make_pair(DB_LIST_SNAPSHOT, pindex->GetBlockHash()), snapshot)) {
-            mnListsCache.emplace(pindex->GetBlockHash(), snapshot);
+            AddCachedList(pindex, snapshot, false);
             break;
         }
 
         CDeterministicMNListDiff diff;
         if (!evoDb.Read(std::make_pair(DB_LIST_DIFF, pindex->GetBlockHash()), diff)) {
             snapshot = CDeterministicMNList(pindex->GetBlockHash(), -1, 0);
-            mnListsCache.emplace(pindex->GetBlockHash(), snapshot);
+            AddCachedList(pindex, snapshot, false);
             break;
         }
 
@@ -1001,13 +1061,125 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
             snapshot.SetBlockHash(diffIndex->GetBlockHash());
             snapshot.SetHeight(diffIndex->nHeight);
         }
+        nDiffsApplied++;
 
-        mnListsCache.emplace(diffIndex->GetBlockHash(), snapshot);
+        AddCachedList(diffIndex, snapshot, diffIndex == pindexRequested);
     }
 
     return snapshot;
 }
 
+bool CDeterministicMNManager::GetCachedList(const uint256& blockHash, CDeterministicMNList& mnListRet)
+{
+    AssertLockHeld(cs);
+
+    auto it = mnListsCache.find(blockHash);
+    if (it != mnListsCache.end()) {
+        mnListRet = it->second;
+        return true;
+    }
+
+    auto itHistorical = mapHistoricalLists.find(blockHash);
+    if (itHistorical != mapHistoricalLists.end()) {
+        // mark as most recently used
+        historicalListsLRU.splice(historicalListsLRU.begin(), historicalListsLRU, itHistorical->second);
+        mnListRet = itHistorical->second->second;
+        return true;
+    }
+
+    return false;
+}
+
+void CDeterministicMNManager::AddCachedList(const CBlockIndex* pindex, const CDeterministicMNList& mnList, bool fForce)
+{
+    AssertLockHeld(cs);
+
+    int nTipHeight = tipIndex ? tipIndex->nHeight : pindex->nHeight;
+    if (pindex->nHeight + nListsCacheDepth >= nTipHeight) {
+        mnListsCache.emplace(pindex->GetBlockHash(), mnList);
+    } else if (fForce || (pindex->nHeight % HISTORICAL_LIST_PERIOD) == 0) {
+        AddHistoricalList(pindex->GetBlockHash(), mnList);
+    }
+}
+
+// Upper bound for the map nodes referenced by a list, the MN entries themselves are shared with neighbouring lists
+static size_t EstimateListUsage(const CDeterministicMNList& mnList)
+{
+    return sizeof(CDeterministicMNList) + mnList.GetAllMNsCount() * DMN_LIST_USAGE_PER_MN;
+}
+
+void CDeterministicMNManager::AddHistoricalList(const uint256& blockHash, const CDeterministicMNList& mnList)
+{
+    AssertLockHeld(cs);
+
+    if (mapHistoricalLists.count(blockHash)) {
+        return;
+    }
+
+    historicalListsLRU.emplace_front(blockHash, mnList);
+    mapHistoricalLists.emplace(blockHash, historicalListsLRU.begin());
+    nHistoricalCacheUsage += EstimateListUsage(mnList);
+
+    while (nHistoricalCacheUsage > nHistoricalCacheMaxUsage && !historicalListsLRU.empty()) {
+        auto& back = historicalListsLRU.back();
+        nHistoricalCacheUsage -= EstimateListUsage(back.second);
+        mapHistoricalLists.erase(back.first);
+        historicalListsLRU.pop_back();
+    }
+}
+
+void CDeterministicMNManager::EraseCachedList(const uint256& blockHash)
+{
+    AssertLockHeld(cs);
+
+    mnListsCache.erase(blockHash);
+
+    auto it = mapHistoricalLists.find(blockHash);
+    if (it != mapHistoricalLists.end()) {
+        nHistoricalCacheUsage -= EstimateListUsage(it->second->second);
+        historicalListsLRU.erase(it->second);
+        mapHistoricalLists.erase(it);
+    }
+}
+
+void CDeterministicMNManager::GetMemoryUsage(UniValue& obj)
+{
+    LOCK(cs);
+
+    // recent lists first, so that MNs shared with historical lists are accounted to the recent ones
+    std::unordered_set<const void*> setSeen;
+    size_t nRecentUsage = 0;
+    for (const auto& p : mnListsCache) {
+        nRecentUsage += p.second.DynamicMemoryUsage(setSeen);
+    }
+    size_t nHistoricalUsage = 0;
+    for (const auto& p : historicalListsLRU) {
+        nHistoricalUsage += p.second.DynamicMemoryUsage(setSeen);
+    }
+
+    obj.setObject();
+    obj.push_back(Pair("recentLists", (int64_t)nRecentUsage));
+    obj.push_back(Pair("historicalLists", (int64_t)nHistoricalUsage));
+    obj.push_back(Pair("sharedObjects", (int64_t)setSeen.size()));
+    obj.push_back(Pair("total", (int64_t)(nRecentUsage + nHistoricalUsage)));
+    obj.push_back(Pair("historicalLimit", (int64_t)nHistoricalCacheMaxUsage));
+}
+
+void CDeterministicMNManager::GetCacheStats(UniValue& obj)
+{
+    LOCK(cs);
+
+    obj.setObject();
+    obj.push_back(Pair("depth", nListsCacheDepth));
+    obj.push_back(Pair("recentLists", (int64_t)mnListsCache.size()));
+    obj.push_back(Pair("historicalLists", (int64_t)historicalListsLRU.size()));
+    obj.push_back(Pair("historicalUsage", (int64_t)nHistoricalCacheUsage));
+    obj.push_back(Pair("historicalMaxUsage", (int64_t)nHistoricalCacheMaxUsage));
+    obj.push_back(Pair("hits", (int64_t)nCacheHits));
+    obj.push_back(Pair("misses", (int64_t)nCacheMisses));
+    obj.push_back(Pair("diffsApplied", (int64_t)nDiffsApplied));
+}
+
 CDeterministicMNList CDeterministicMNManager::GetListAtChainTip()
 {
     LOCK(cs);
@@ -1017,6 +1189,80 @@ CDeterministicMNList CDeterministicMNManager::GetListAtChainTip()
     return GetListForBlock(tipIndex);
 }
 
+std::string CDeterministicMNManager::NormalizeIdentity(const std::string& identity)
+{
+    std::string ret = identity;
+    for (char& c : ret) {
+        if (c >= 'A' && c <= 'Z') {
+            c = c - 'A' + 'a';
+        }
+    }
+    return ret;
+}
+
+CDeterministicMNCPtr CDeterministicMNManager::ResolveIdentity(const std::string& identity)
+{
+    LOCK(cs_identities);
+
+    auto it = mapIdentities.find(NormalizeIdentity(identity));
+    if (it == mapIdentities.end()) {
+        return nullptr;
+    }
+
+    CDeterministicMNCPtr ret;
+    auto rank = [&](const CDeterministicMNCPtr& dmn) {
+        return std::make_tuple(identitiesList.IsMNValid(dmn), dmn->pdmnState->Identity == identity, -dmn->pdmnState->nRegisteredHeight);
+    };
+    for (const auto& proTxHash : it->second) {
+        auto dmn = identitiesList.GetMN(proTxHash);
+        if (dmn && (!ret || rank(dmn) > rank(ret))) {
+            ret = dmn;
+        }
+    }
+    return ret;
+}
+
+void CDeterministicMNManager::UpdateIdentityIndex(const CDeterministicMNList& newList)
+{
+    LOCK(cs_identities);
+
+    auto addIdentity = [&](const CDeterministicMNCPtr& dmn) {
+        if (!dmn->pdmnState->Identity.empty()) {
+            mapIdentities[NormalizeIdentity(dmn->pdmnState->Identity)].emplace_back(dmn->proTxHash);
+        }
+    };
+    auto removeIdentity = [&](const CDeterministicMNCPtr& dmn) {
+        auto it = mapIdentities.find(NormalizeIdentity(dmn->pdmnState->Identity));
+        if (it == mapIdentities.end()) {
+            return;
+        }
+        auto& vecProTxHashes = it->second;
+        vecProTxHashes.erase(std::remove(vecProTxHashes.begin(), vecProTxHashes.end(), dmn->proTxHash), vecProTxHashes.end());
+        if (vecProTxHashes.empty()) {
+            mapIdentities.erase(it);
+        }
+    };
+
+    // only MNs which came, went or changed their identity touch the index
+    auto diff = identitiesList.BuildDiff(newList);
+    for (const auto& internalId : diff.removedMns) {
+        removeIdentity(identitiesList.GetMNByInternalId(internalId));
+    }
+    for (const auto& p : diff.updatedMNs) {
+        if (!(p.second.fields & CDeterministicMNStateDiff::Field_Identity)) {
+            continue;
+        }
+        auto newDmn = newList.GetMNByInternalId(p.first);
+        removeIdentity(identitiesList.GetMN(newDmn->proTxHash));
+        addIdentity(newDmn);
+    }
+    for (const auto& dmn : diff.addedMNs) {
+        addIdentity(dmn);
+    }
+
+    identitiesList = newList;
+}
+
 bool CDeterministicMNManager::IsProTxWithCollateral(const CTransactionRef& tx, uint32_t n)
 {
     if (tx->nVersion != 3 || tx->nType != TRANSACTION_PROVIDER_REGISTER) {
@@ -1054,15 +1300,17 @@ void CDeterministicMNManager::CleanupCache(int nHeight)
 {
     AssertLockHeld(cs);
 
-    std::vector<uint256> toDelete;
-    for (const auto& p : mnListsCache) {
-        if (p.second.GetHeight() + LISTS_CACHE_SIZE < nHeight) {
-            toDelete.emplace_back(p.first);
+    for (auto it = mnListsCache.begin(); it != mnListsCache.end(); ) {
+        if (it->second.GetHeight() + nListsCacheDepth < nHeight) {
+            // keep some older lists around, quorum and diff lookups often go back further than the depth
+            if ((it->second.GetHeight() % HISTORICAL_LIST_PERIOD) == 0) {
+                AddHistoricalList(it->first, it->second);
+            }
+            it = mnListsCache.erase(it);
+        } else {
+            ++it;
         }
     }
-    for (const auto& h : toDelete) {
-        mnListsCache.erase(h);
-    }
 }
 
 bool CDeterministicMNManager::UpgradeDiff(CDBBatch& batch, const CBlockIndex* pindexNext, const CDeterministicMNList& curMNList, CDeterministicMNList& newMNList)
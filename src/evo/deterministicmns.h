@@ -7,16 +7,23 @@
 
 #include "arith_uint256.h"
 #include "bls/bls.h"
+#include "clientversion.h"
 #include "dbwrapper.h"
 #include "evodb.h"
 #include "providertx.h"
 #include "simplifiedmns.h"
+#include "streams.h"
 #include "sync.h"
 
+#include "immer/flex_vector.hpp"
 #include "immer/map.hpp"
 #include "immer/map_transient.hpp"
 
+#include <list>
 #include <map>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
 
 class CBlock;
 class CBlockIndex;
@@ -27,8 +34,48 @@ namespace llmq
     class CFinalCommitment;
 }
 
+/**
+ * Serialized form of an object which is not modified anymore. Copies start out empty as they are usually made to be
+ * modified, so the owner must not change after the first call to Serialize.
+ */
+class CSerializedCache
+{
+private:
+    mutable std::shared_ptr<const std::vector<unsigned char>> vchData;
+
+public:
+    CSerializedCache() {}
+    CSerializedCache(const CSerializedCache&) {}
+    CSerializedCache& operator=(const CSerializedCache&)
+    {
+        std::atomic_store(&vchData, std::shared_ptr<const std::vector<unsigned char>>());
+        return *this;
+    }
+
+    template <typename Stream, typename T>
+    void Serialize(Stream& s, const T& obj) const
+    {
+        auto data = std::atomic_load(&vchData);
+        if (!data) {
+            // the serialized forms cached here don't depend on the stream's type and version. They are written
+            // straight into the shared buffer, a temporary stream would have been allocated and copied once more
+            auto vch = std::make_shared<std::vector<unsigned char>>();
+            CVectorWriter vw(SER_DISK, CLIENT_VERSION, *vch, 0);
+            obj.SerializeUncached(vw);
+            data = std::move(vch);
+            std::atomic_store(&vchData, data);
+        }
+        s.write((const char*)data->data(), data->size());
+    }
+
+    size_t DynamicMemoryUsage() const;
+};
+
 class CDeterministicMNState
 {
+private:
+    CSerializedCache serializedCache;
+
 public:
     int nRegisteredHeight{-1};
     int nLastPaidHeight{0};
@@ -57,7 +104,7 @@ public:
     CDeterministicMNState(const CProRegTx& proTx)
     {
         keyIDOwner = proTx.keyIDOwner;
-        pubKeyOperator.Set(proTx.pubKeyOperator);
+        pubKeyOperator = proTx.pubKeyOperator;
         keyIDVoting = proTx.keyIDVoting;
         addr = proTx.addr;
         scriptPayout = proTx.scriptPayout;
@@ -70,7 +117,30 @@ public:
         s >> *this;
     }
 
-    ADD_SERIALIZE_METHODS;
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        NCONST_PTR(this)->SerializationOp(s, CSerActionSerialize());
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        SerializationOp(s, CSerActionUnserialize());
+    }
+
+    // Used for states owned by a CDeterministicMN, which are immutable. Snapshots, diffs and the size calculations
+    // done before DB writes then only serialize states which were not serialized before
+    template <typename Stream>
+    void SerializeCached(Stream& s) const
+    {
+        serializedCache.Serialize(s, *this);
+    }
+    template <typename Stream>
+    void SerializeUncached(Stream& s) const
+    {
+        Serialize(s);
+    }
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action)
@@ -118,6 +188,8 @@ public:
 public:
     std::string ToString() const;
     void ToJson(UniValue& obj) const;
+
+    size_t DynamicMemoryUsage() const;
 };
 typedef std::shared_ptr<CDeterministicMNState> CDeterministicMNStatePtr;
 typedef std::shared_ptr<const CDeterministicMNState> CDeterministicMNStateCPtr;
@@ -227,7 +299,12 @@ public:
     template<typename Stream>
     void Serialize(Stream& s) const
     {
-        NCONST_PTR(this)->SerializationOp(s, CSerActionSerialize(), false);
+        // same as SerializationOp, but reusing the serialized state
+        s << proTxHash;
+        s << VARINT(internalId);
+        s << collateralOutpoint;
+        s << nOperatorReward;
+        pdmnState->SerializeCached(s);
     }
 
     template<typename Stream>
@@ -286,6 +363,8 @@ public:
     typedef immer::map<uint256, CDeterministicMNCPtr> MnMap;
     typedef immer::map<uint64_t, uint256> MnInternalIdMap;
     typedef immer::map<uint256, std::pair<uint256, uint32_t> > MnUniquePropertyMap;
+    // (payment order height, proTxHash), sorted ascending
+    typedef immer::flex_vector<std::pair<int, uint256> > MnPaymentQueue;
 
 private:
     uint256 blockHash;
@@ -298,6 +377,10 @@ private:
     // we keep track of this as checking for duplicates would otherwise be painfully slow
     MnUniquePropertyMap mnUniquePropertyMap;
 
+    // all valid MNs in the order they get paid, maintained in AddMN/UpdateMN/RemoveMN
+    // so that payee lookups don't need to scan and sort the whole list
+    MnPaymentQueue mnPaymentQueue;
+
 public:
     CDeterministicMNList() {}
     explicit CDeterministicMNList(const uint256& _blockHash, int _height, uint32_t _totalRegisteredCount) :
@@ -331,6 +414,7 @@ public:
         mnMap = MnMap();
         mnUniquePropertyMap = MnUniquePropertyMap();
         mnInternalIdMap = MnInternalIdMap();
+        mnPaymentQueue = MnPaymentQueue();
 
         SerializationOpBase(s, CSerActionUnserialize());
 
@@ -357,6 +441,13 @@ public:
         return count;
     }
 
+    /**
+     * Memory used by this list, without the MNs and states already in setSeen. Lists derived from each other share
+     * the MN objects and states of unchanged MNs and most of their map nodes, so the map entries are only counted
+     * for MNs not seen before. Pass the same set for multiple lists to count shared structure once.
+     */
+    size_t DynamicMemoryUsage(std::unordered_set<const void*>& setSeen) const;
+
     template <typename Callback>
     void ForEachMN(bool onlyValid, Callback&& cb) const
     {
@@ -394,8 +485,9 @@ public:
     }
 
     bool IsVNValid(const COutPoint& collateralOutpoint) const;
-    std::vector<std::string> GetIdentitiesInUse() const;
-    std::vector<std::string> GetIPFSPeerIdInUse() const;
+    // Whether a valid masternode registered this Identity/IPFS peer id, looked up in mnUniquePropertyMap
+    bool IsIdentityInUse(const std::string& identity) const;
+    bool IsIPFSPeerIdInUse(const std::string& ipfsPeerId) const;
     bool IsMNValid(const uint256& proTxHash) const;
     bool IsMNPoSeBanned(const uint256& proTxHash) const;
     bool IsMNValid(const CDeterministicMNCPtr& dmn) const;
@@ -503,6 +595,9 @@ public:
     }
 
 private:
+    void AddToPaymentQueue(const CDeterministicMNCPtr& dmn);
+    void RemoveFromPaymentQueue(const CDeterministicMNCPtr& dmn);
+
     template <typename T>
     void AddUniqueProperty(const CDeterministicMNCPtr& dmn, const T& v)
     {
@@ -636,10 +731,16 @@ public:
     }
 };
 
+static const int DEFAULT_DMN_LIST_CACHE_DEPTH = 576;
+static const int DEFAULT_DMN_CACHE_MB = 32;
+
 class CDeterministicMNManager
 {
     static const int SNAPSHOT_LIST_PERIOD = 576; // once per day
-    static const int LISTS_CACHE_SIZE = 576;
+    // older lists are only kept at these heights (plus the ones asked for) so later lookups replay few diffs
+    static const int HISTORICAL_LIST_PERIOD = 32;
+
+    typedef std::list<std::pair<uint256, CDeterministicMNList> > list_lru_t;
 
 public:
     CCriticalSection cs;
@@ -647,9 +748,31 @@ public:
 private:
     CEvoDB& evoDb;
 
+    // lists of the last nListsCacheDepth blocks
     std::map<uint256, CDeterministicMNList> mnListsCache;
+
+    // older lists, most recently used first and limited to nHistoricalCacheMaxUsage bytes.
+    // Lists share most of their immer structure so this mostly holds references to shared nodes.
+    list_lru_t historicalListsLRU;
+    std::map<uint256, list_lru_t::iterator> mapHistoricalLists;
+    size_t nHistoricalCacheUsage{0};
+
+    int nListsCacheDepth;
+    size_t nHistoricalCacheMaxUsage;
+
+    uint64_t nCacheHits{0};
+    uint64_t nCacheMisses{0};
+    uint64_t nDiffsApplied{0};
+
     const CBlockIndex* tipIndex{nullptr};
 
+    // Identity index of the list at the chain tip: normalized identity -> proTxHashes of the MNs registered with it.
+    // It has its own lock so that resolutions don't wait for block processing.
+    mutable CCriticalSection cs_identities;
+    std::unordered_map<std::string, std::vector<uint256> > mapIdentities;
+    // the list mapIdentities reflects, the next tip list is applied as a diff against it
+    CDeterministicMNList identitiesList;
+
 public:
     CDeterministicMNManager(CEvoDB& _evoDb);
 
@@ -671,6 +794,18 @@ public:
 
     bool IsDIP3Enforced(int nHeight = -1);
 
+    // Identities are resolved ignoring the case of ASCII letters
+    static std::string NormalizeIdentity(const std::string& identity);
+    // The MN at the chain tip registered with this identity, answered from the identity index. If MNs registered it
+    // in different cases, valid MNs win over banned ones, then exact matches, then the earliest registration.
+    CDeterministicMNCPtr ResolveIdentity(const std::string& identity);
+    // Bring the identity index to newList, called whenever the tip changes
+    void UpdateIdentityIndex(const CDeterministicMNList& newList);
+
+    void GetCacheStats(UniValue& obj);
+    // Memory used by the cached lists, for getmemoryinfo
+    void GetMemoryUsage(UniValue& obj);
+
 public:
     // TODO these can all be removed in a future version
     bool UpgradeDiff(CDBBatch& batch, const CBlockIndex* pindexNext, const CDeterministicMNList& curMNList, CDeterministicMNList& newMNList);
@@ -678,6 +813,11 @@ public:
 
 private:
     void CleanupCache(int nHeight);
+
+    bool GetCachedList(const uint256& blockHash, CDeterministicMNList& mnListRet);
+    void AddCachedList(const CBlockIndex* pindex, const CDeterministicMNList& mnList, bool fForce);
+    void AddHistoricalList(const uint256& blockHash, const CDeterministicMNList& mnList);
+    void EraseCachedList(const uint256& blockHash);
 };
 
 extern CDeterministicMNManager* deterministicMNManager;
@@ -11,9 +11,29 @@
 #include "net_processing.h"
 #include "netmessagemaker.h"
 #include "validation.h"
+#include "workerpool.h"
+
+#include "bls/bls_batchverifier.h"
 
 #include <unordered_set>
 
+// An MNAUTH which passed the cheap checks and waits for its signature to be verified
+struct CPendingMNAuth
+{
+    NodeId nodeId;
+    uint256 proRegTxHash;
+    uint256 pubKeyHash;
+    CBLSPublicKey pubKey;
+    CBLSSignature sig;
+    uint256 signHash;
+};
+
+// When a quorum forms, all members connect to each other at the same time. Their MNAUTHs are collected here and
+// verified in batches on the worker pool instead of one by one in the message handler thread
+static CCriticalSection cs_pendingMNAuths;
+static std::vector<CPendingMNAuth> vecPendingMNAuths;
+static bool fPendingMNAuthsScheduled = false;
+
 void CMNAuth::PushMNAUTH(CNode* pnode, CConnman& connman)
 {
     if (!fMasternodeMode || activeMasternodeInfo.proTxHash.IsNull()) {
@@ -57,8 +77,8 @@ void CMNAuth::ProcessMessage(CNode* pnode, const std::string& strCommand, CDataS
 
         {
             LOCK(pnode->cs_mnauth);
-            // only one MNAUTH allowed
-            if (!pnode->verifiedProRegTxHash.IsNull()) {
+            // only one MNAUTH allowed, also while the first one is still being verified
+            if (!pnode->verifiedProRegTxHash.IsNull() || pnode->fMNAuthPending) {
                 LOCK(cs_main);
                 Misbehaving(pnode->id, 100);
                 return;
@@ -82,36 +102,129 @@ void CMNAuth::ProcessMessage(CNode* pnode, const std::string& strCommand, CDataS
             return;
         }
 
-        uint256 signHash;
+        CPendingMNAuth pending;
+        pending.nodeId = pnode->id;
+        pending.proRegTxHash = mnauth.proRegTxHash;
+        pending.pubKeyHash = dmn->pdmnState->pubKeyOperator.GetHash();
+        pending.pubKey = dmn->pdmnState->pubKeyOperator.Get();
+        pending.sig = mnauth.sig;
+        if (!pending.pubKey.IsValid()) {
+            LOCK(cs_main);
+            Misbehaving(pnode->id, 10);
+            return;
+        }
         {
             LOCK(pnode->cs_mnauth);
+            pnode->fMNAuthPending = true;
             // See comment in PushMNAUTH (fInbound is negated here as we're on the other side of the connection)
-            signHash = ::SerializeHash(std::make_tuple(dmn->pdmnState->pubKeyOperator, pnode->sentMNAuthChallenge, !pnode->fInbound));
+            pending.signHash = ::SerializeHash(std::make_tuple(dmn->pdmnState->pubKeyOperator, pnode->sentMNAuthChallenge, !pnode->fInbound));
         }
 
-        if (!mnauth.sig.VerifyInsecure(dmn->pdmnState->pubKeyOperator.Get(), signHash)) {
-            LOCK(cs_main);
-            // Same as above, MN seems to not know about his fate yet, so give him a chance to update. If this is a
-            // malicious actor (DoSing us), we'll ban him soon.
-            Misbehaving(pnode->id, 10);
+        bool fSchedule;
+        {
+            LOCK(cs_pendingMNAuths);
+            vecPendingMNAuths.emplace_back(std::move(pending));
+            fSchedule = !fPendingMNAuthsScheduled;
+            fPendingMNAuthsScheduled = true;
+        }
+        if (!fSchedule) {
+            // the scheduled job picks this one up as well
             return;
         }
+        if (g_workerPool.Size() == 0) {
+            VerifyPendingMNAuths();
+        } else {
+            g_workerPool.Push([](int threadId) {
+                VerifyPendingMNAuths();
+            });
+        }
+    }
+}
+
+void CMNAuth::VerifyPendingMNAuths()
+{
+    while (true) {
+        std::vector<CPendingMNAuth> vecMNAuths;
+        {
+            LOCK(cs_pendingMNAuths);
+            if (vecPendingMNAuths.empty()) {
+                fPendingMNAuthsScheduled = false;
+                return;
+            }
+            vecMNAuths.swap(vecPendingMNAuths);
+        }
+
+        // Every challenge is random and signed only once, so insecure verification is fine (rogue public keys can't
+        // forge an aggregate of distinct messages) and the signature cache would never hit
+        CBLSBatchVerifier<NodeId, size_t> batchVerifier(false, true);
+        for (size_t i = 0; i < vecMNAuths.size(); i++) {
+            auto& mnauth = vecMNAuths[i];
+            batchVerifier.PushMessage(mnauth.nodeId, i, mnauth.signHash, mnauth.sig, mnauth.pubKey);
+        }
+        batchVerifier.Verify();
+
+        // the list might have changed while the MNAUTHs were waiting
+        auto mnList = deterministicMNManager->GetListAtChainTip();
 
-        connman.ForEachNode([&](CNode* pnode2) {
-            if (pnode2->verifiedProRegTxHash == mnauth.proRegTxHash) {
-                LogPrint("net", "CMNAuth::ProcessMessage -- Masternode %s has already verified as peer %d, dropping old connection. peer=%d\n",
-                        mnauth.proRegTxHash.ToString(), pnode2->id, pnode->id);
-                pnode2->fDisconnect = true;
+        for (size_t i = 0; i < vecMNAuths.size(); i++) {
+            auto& mnauth = vecMNAuths[i];
+            if (batchVerifier.badMessages.count(i)) {
+                g_connman->ForNode(mnauth.nodeId, CConnman::AllNodes, [&](CNode* pnode) {
+                    LOCK(pnode->cs_mnauth);
+                    pnode->fMNAuthPending = false;
+                    return true;
+                });
+                LOCK(cs_main);
+                // Same as in ProcessMessage, MN seems to not know about his fate yet, so give him a chance to update.
+                // If this is a malicious actor (DoSing us), we'll ban him soon.
+                Misbehaving(mnauth.nodeId, 10);
+                continue;
             }
-        });
 
-        {
-            LOCK(pnode->cs_mnauth);
-            pnode->verifiedProRegTxHash = mnauth.proRegTxHash;
-            pnode->verifiedPubKeyHash = dmn->pdmnState->pubKeyOperator.GetHash();
+            auto dmn = mnList.GetMN(mnauth.proRegTxHash);
+            if (!dmn || dmn->pdmnState->pubKeyOperator.GetHash() != mnauth.pubKeyHash) {
+                // removed or its key changed, let him be connected as a regular node
+                g_connman->ForNode(mnauth.nodeId, CConnman::AllNodes, [&](CNode* pnode) {
+                    LOCK(pnode->cs_mnauth);
+                    pnode->fMNAuthPending = false;
+                    return true;
+                });
+                continue;
+            }
+
+            g_connman->ForEachNode([&](CNode* pnode2) {
+                if (pnode2->id != mnauth.nodeId && pnode2->verifiedProRegTxHash == mnauth.proRegTxHash) {
+                    LogPrint("net", "CMNAuth::VerifyPendingMNAuths -- Masternode %s has already verified as peer %d, dropping old connection. peer=%d\n",
+                            mnauth.proRegTxHash.ToString(), pnode2->id, mnauth.nodeId);
+                    pnode2->fDisconnect = true;
+                }
+            });
+
+            bool fFound = g_connman->ForNode(mnauth.nodeId, CConnman::AllNodes, [&](CNode* pnode) {
+                LOCK(pnode->cs_mnauth);
+                pnode->verifiedProRegTxHash = mnauth.proRegTxHash;
+                pnode->verifiedPubKeyHash = mnauth.pubKeyHash;
+                pnode->fMNAuthPending = false;
+                return true;
+            });
+            if (fFound) {
+                LogPrint("net", "CMNAuth::%s -- Valid MNAUTH for %s, peer=%d\n", __func__, mnauth.proRegTxHash.ToString(), mnauth.nodeId);
+            }
+            if (fFound && IsMasternodePushRelayEnabled()) {
+                // ask the masternode to announce new blocks with compact blocks right away (BIP152 high-bandwidth mode)
+                g_connman->ForNode(mnauth.nodeId, [&](CNode* pnode) {
+                    if (pnode->nVersion >= SHORT_IDS_BLOCKS_VERSION) {
+                        bool fAnnounceUsingCMPCTBLOCK = true;
+                        uint64_t nCMPCTBLOCKVersion = 1;
+                        g_connman->PushMessage(pnode, CNetMsgMaker(pnode->GetSendVersion()).Make(NetMsgType::SENDCMPCT, fAnnounceUsingCMPCTBLOCK, nCMPCTBLOCKVersion));
+                    }
+                    return true;
+                });
+            }
         }
 
-        LogPrint("net", "CMNAuth::%s -- Valid MNAUTH for %s, peer=%d\n", __func__, mnauth.proRegTxHash.ToString(), pnode->id);
+        // ProcessMessages holds back the LLMQ messages of peers while their MNAUTH is pending
+        g_connman->WakeMessageHandler();
     }
 }
 
@@ -0,0 +1,180 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "protxsigcache.h"
+#include "deterministicmns.h"
+#include "providertx.h"
+#include "specialtx.h"
+
+#include "chainparams.h"
+#include "hash.h"
+#include "util.h"
+#include "validation.h"
+#include "workerpool.h"
+
+CProTxSigCache proTxSigCache;
+
+void CProTxSigCache::Start()
+{
+    fActive = true;
+}
+
+void CProTxSigCache::Stop()
+{
+    fActive = false;
+
+    LOCK(cs);
+    setVerified.clear();
+}
+
+void CProTxSigCache::QueueBlocks(const std::vector<CBlockIndex*>& vpindex)
+{
+    AssertLockHeld(cs_main);
+
+    if (!fActive || g_workerPool.Size() == 0) {
+        return;
+    }
+
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+
+    // vpindex is ordered from the highest to the lowest block
+    for (auto it = vpindex.rbegin(); it != vpindex.rend(); ++it) {
+        const CBlockIndex* pindex = *it;
+        if (pindex->nHeight <= nLastQueuedHeight || pindex->nHeight < consensusParams.DIP0003Height) {
+            continue;
+        }
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA) || nQueuedBlocks >= MAX_QUEUED_BLOCKS) {
+            break;
+        }
+        nLastQueuedHeight = pindex->nHeight;
+
+        CDiskBlockPos pos = pindex->GetBlockPos();
+        nQueuedBlocks++;
+        g_workerPool.Push([this, pos, &consensusParams](int threadId) {
+            CBlock block;
+            if (ReadBlockFromDisk(block, pos, consensusParams)) {
+                PrecomputeBlock(block);
+            }
+            nQueuedBlocks--;
+        }, CWorkerPool::PRIORITY_LOW);
+    }
+}
+
+bool CProTxSigCache::IsVerified(const uint256& nEntry)
+{
+    LOCK(cs);
+    return setVerified.erase(nEntry) != 0;
+}
+
+void CProTxSigCache::AddVerified(const uint256& nEntry)
+{
+    LOCK(cs);
+    if (setVerified.size() >= MAX_CACHE_SIZE) {
+        // entries of blocks which ended up on another chain are never consumed
+        setVerified.clear();
+    }
+    setVerified.emplace(nEntry);
+}
+
+uint256 CProTxSigCache::MakeEntry(const uint256& nHash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig)
+{
+    CHashWriter hw(SER_GETHASH, 0);
+    hw << nHash << keyID << vchSig;
+    return hw.GetHash();
+}
+
+uint256 CProTxSigCache::MakeEntry(const uint256& nHash, const CBLSPublicKey& pubKey, const CBLSSignature& sig)
+{
+    CHashWriter hw(SER_GETHASH, 0);
+    hw << nHash << pubKey << sig;
+    return hw.GetHash();
+}
+
+void CProTxSigCache::PrecomputeBlock(const CBlock& block)
+{
+    for (const auto& tx : block.vtx) {
+        if (tx->nVersion == 3 && tx->nType != TRANSACTION_NORMAL) {
+            PrecomputeTx(*tx);
+        }
+    }
+}
+
+template <typename ProTx>
+static bool RecoverSigner(const uint256& nHash, const ProTx& proTx, CKeyID& keyIDRet)
+{
+    CPubKey pubKey;
+    if (!pubKey.RecoverCompact(nHash, proTx.vchSig)) {
+        return false;
+    }
+    keyIDRet = pubKey.GetID();
+    return true;
+}
+
+template <typename ProTx>
+static bool GetTipOperatorKey(const ProTx& proTx, CBLSPublicKey& pubKeyRet)
+{
+    auto dmn = deterministicMNManager->GetListAtChainTip().GetMN(proTx.proTxHash);
+    if (!dmn) {
+        return false;
+    }
+    pubKeyRet = dmn->pdmnState->pubKeyOperator.Get();
+    return true;
+}
+
+void CProTxSigCache::PrecomputeTx(const CTransaction& tx)
+{
+    CKeyID keyID;
+    CBLSPublicKey pubKey;
+
+    switch (tx.nType) {
+    case TRANSACTION_PROVIDER_REGISTER: {
+        CProRegTx ptx;
+        if (!GetTxPayload(tx, ptx) || ptx.vchSig.empty()) {
+            return;
+        }
+        // must match CMessageSigner::VerifyMessage
+        CHashWriter ss(SER_GETHASH, 0);
+        ss << strMessageMagic;
+        ss << ptx.MakeSignString();
+        uint256 nHash = ss.GetHash();
+        if (RecoverSigner(nHash, ptx, keyID)) {
+            AddVerified(MakeEntry(nHash, keyID, ptx.vchSig));
+        }
+        break;
+    }
+    case TRANSACTION_PROVIDER_UPDATE_SERVICE: {
+        CProUpServTx ptx;
+        if (!GetTxPayload(tx, ptx) || !GetTipOperatorKey(ptx, pubKey)) {
+            return;
+        }
+        uint256 nHash = ::SerializeHash(ptx);
+        if (ptx.sig.Get().VerifyInsecure(pubKey, nHash)) {
+            AddVerified(MakeEntry(nHash, pubKey, ptx.sig.Get()));
+        }
+        break;
+    }
+    case TRANSACTION_PROVIDER_UPDATE_REGISTRAR: {
+        CProUpRegTx ptx;
+        if (!GetTxPayload(tx, ptx)) {
+            return;
+        }
+        uint256 nHash = ::SerializeHash(ptx);
+        if (RecoverSigner(nHash, ptx, keyID)) {
+            AddVerified(MakeEntry(nHash, keyID, ptx.vchSig));
+        }
+        break;
+    }
+    case TRANSACTION_PROVIDER_UPDATE_REVOKE: {
+        CProUpRevTx ptx;
+        if (!GetTxPayload(tx, ptx) || !GetTipOperatorKey(ptx, pubKey)) {
+            return;
+        }
+        uint256 nHash = ::SerializeHash(ptx);
+        if (ptx.sig.Get().VerifyInsecure(pubKey, nHash)) {
+            AddVerified(MakeEntry(nHash, pubKey, ptx.sig.Get()));
+        }
+        break;
+    }
+    }
+}
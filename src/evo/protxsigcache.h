@@ -0,0 +1,66 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef HTA_PROTXSIGCACHE_H
+#define HTA_PROTXSIGCACHE_H
+
+#include "bls/bls.h"
+#include "pubkey.h"
+#include "saltedhasher.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <atomic>
+#include <unordered_set>
+
+class CBlock;
+class CBlockIndex;
+class CTransaction;
+
+/**
+ * During reindex and initial sync the payload signatures of ProTxs in blocks that are about to
+ * be connected are verified ahead of time on worker threads. Signatures found to be valid are
+ * remembered here and the Check*Tx functions don't verify them again, which leaves only the
+ * state dependent checks to the serial block connection.
+ *
+ * ECDSA payload signatures are checked by recovering the signing key, which doesn't need any
+ * state. BLS signatures are checked against the operator key found in the list at the current
+ * tip, an entry simply goes unused if the key was changed in between.
+ */
+class CProTxSigCache
+{
+private:
+    static const size_t MAX_CACHE_SIZE = 100000;
+    static const int MAX_QUEUED_BLOCKS = 256;
+
+    CCriticalSection cs;
+    std::unordered_set<uint256, StaticSaltedHasher> setVerified;
+
+    std::atomic<bool> fActive{false};
+    std::atomic<int> nQueuedBlocks{0};
+    int nLastQueuedHeight{-1};
+
+public:
+    /// Blocks are verified on the shared worker pool, which must have been started before
+    void Start();
+    void Stop();
+
+    /// Queue the blocks for signature verification ahead of time, cs_main must be held
+    void QueueBlocks(const std::vector<CBlockIndex*>& vpindex);
+
+    /// Check and forget an entry, signatures are only verified once per connect
+    bool IsVerified(const uint256& nEntry);
+
+    static uint256 MakeEntry(const uint256& nHash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig);
+    static uint256 MakeEntry(const uint256& nHash, const CBLSPublicKey& pubKey, const CBLSSignature& sig);
+
+private:
+    void AddVerified(const uint256& nEntry);
+    void PrecomputeBlock(const CBlock& block);
+    void PrecomputeTx(const CTransaction& tx);
+};
+
+extern CProTxSigCache proTxSigCache;
+
+#endif //HTA_PROTXSIGCACHE_H
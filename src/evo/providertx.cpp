@@ -3,10 +3,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "deterministicmns.h"
+#include "protxsigcache.h"
 #include "providertx.h"
 #include "specialtx.h"
 
 #include "base58.h"
+#include "bls/bls_sigcache.h"
 #include "chainparams.h"
 #include "clientversion.h"
 #include "core_io.h"
@@ -54,8 +56,12 @@ static bool CheckService(const uint256& proTxHash, const ProTx& proTx, CValidati
 template <typename ProTx>
 static bool CheckHashSig(const ProTx& proTx, const CKeyID& keyID, CValidationState& state)
 {
+    uint256 nHash = ::SerializeHash(proTx);
+    if (proTxSigCache.IsVerified(CProTxSigCache::MakeEntry(nHash, keyID, proTx.vchSig))) {
+        return true;
+    }
     std::string strError;
-    if (!CHashSigner::VerifyHash(::SerializeHash(proTx), keyID, proTx.vchSig, strError)) {
+    if (!CHashSigner::VerifyHash(nHash, keyID, proTx.vchSig, strError)) {
         return state.DoS(100, false, REJECT_INVALID, "bad-protx-sig", false, strError);
     }
     return true;
@@ -64,17 +70,32 @@ static bool CheckHashSig(const ProTx& proTx, const CKeyID& keyID, CValidationSta
 template <typename ProTx>
 static bool CheckStringSig(const ProTx& proTx, const CKeyID& keyID, CValidationState& state)
 {
+    std::string strMessage = proTx.MakeSignString();
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << strMessageMagic;
+    ss << strMessage;
+    if (proTxSigCache.IsVerified(CProTxSigCache::MakeEntry(ss.GetHash(), keyID, proTx.vchSig))) {
+        return true;
+    }
     std::string strError;
-    if (!CMessageSigner::VerifyMessage(keyID, proTx.vchSig, proTx.MakeSignString(), strError)) {
+    if (!CMessageSigner::VerifyMessage(keyID, proTx.vchSig, strMessage, strError)) {
         return state.DoS(100, false, REJECT_INVALID, "bad-protx-sig", false, strError);
     }
     return true;
 }
 
 template <typename ProTx>
-static bool CheckHashSig(const ProTx& proTx, const CBLSPublicKey& pubKey, CValidationState& state)
+static bool CheckHashSig(const CTransaction& tx, const ProTx& proTx, const CBLSPublicKey& pubKey, CValidationState& state, CProTxBatchVerifier* pBatchVerifier)
 {
-    if (!proTx.sig.VerifyInsecure(pubKey, ::SerializeHash(proTx))) {
+    uint256 nHash = ::SerializeHash(proTx);
+    if (proTxSigCache.IsVerified(CProTxSigCache::MakeEntry(nHash, pubKey, proTx.sig.Get()))) {
+        return true;
+    }
+    if (pBatchVerifier && proTx.sig.Get().IsValid() && pubKey.IsValid()) {
+        pBatchVerifier->PushMessage(tx.GetHash(), tx.GetHash(), nHash, proTx.sig.Get(), pubKey);
+        return true;
+    }
+    if (!VerifyBLSSigCached(proTx.sig.Get(), pubKey, nHash)) {
         return state.DoS(100, false, REJECT_INVALID, "bad-protx-sig", false);
     }
     return true;
@@ -112,7 +133,7 @@ bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValid
         return state.DoS(100, false, REJECT_INVALID, "bad-protx-mode");
     }
 
-    if (ptx.keyIDOwner.IsNull() || !ptx.pubKeyOperator.IsValid() || ptx.keyIDVoting.IsNull()) {
+    if (ptx.keyIDOwner.IsNull() || !ptx.pubKeyOperator.Get().IsValid() || ptx.keyIDVoting.IsNull()) {
         return state.DoS(10, false, REJECT_INVALID, "bad-protx-key-null");
     }
     if (!ptx.scriptPayout.IsPayToPublicKeyHash() && !ptx.scriptPayout.IsPayToScriptHash()) {
@@ -247,7 +268,7 @@ bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValid
     return true;
 }
 
-bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, CProTxBatchVerifier* pBatchVerifier)
 {
     if (tx.nType != TRANSACTION_PROVIDER_UPDATE_SERVICE) {
         return state.DoS(100, false, REJECT_INVALID, "bad-protx-type");
@@ -302,7 +323,7 @@ bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVa
         if (!CheckInputsHash(tx, ptx, state)) {
             return false;
         }
-        if (!CheckHashSig(ptx, mn->pdmnState->pubKeyOperator.Get(), state)) {
+        if (!CheckHashSig(tx, ptx, mn->pdmnState->pubKeyOperator.Get(), state, pBatchVerifier)) {
             return false;
         }
     }
@@ -328,7 +349,7 @@ bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVal
         return state.DoS(100, false, REJECT_INVALID, "bad-protx-mode");
     }
 
-    if (!ptx.pubKeyOperator.IsValid() || ptx.keyIDVoting.IsNull()) {
+    if (!ptx.pubKeyOperator.Get().IsValid() || ptx.keyIDVoting.IsNull()) {
         return state.DoS(10, false, REJECT_INVALID, "bad-protx-key-null");
     }
     if (!ptx.scriptPayout.IsPayToPublicKeyHash() && !ptx.scriptPayout.IsPayToScriptHash()) {
@@ -406,7 +427,7 @@ bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVal
     return true;
 }
 
-bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, CProTxBatchVerifier* pBatchVerifier)
 {
     if (tx.nType != TRANSACTION_PROVIDER_UPDATE_REVOKE) {
         return state.DoS(100, false, REJECT_INVALID, "bad-protx-type");
@@ -435,7 +456,7 @@ bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVal
 
         if (!CheckInputsHash(tx, ptx, state))
             return false;
-        if (!CheckHashSig(ptx, dmn->pdmnState->pubKeyOperator.Get(), state))
+        if (!CheckHashSig(tx, ptx, dmn->pdmnState->pubKeyOperator.Get(), state, pBatchVerifier))
             return false;
     }
 
@@ -477,7 +498,7 @@ std::string CProRegTx::ToString() const
     }
 
     return strprintf("CProRegTx(nVersion=%d, collateralOutpoint=%s, addr=%s, nOperatorReward=%f, ownerAddress=%s, pubKeyOperator=%s, votingAddress=%s, scriptPayout=%s, ipfsPeerId=%s, identity=%s)",
-        nVersion, collateralOutpoint.ToStringShort(), addr.ToString(), (double)nOperatorReward / 100, CBitcoinAddress(keyIDOwner).ToString(), pubKeyOperator.ToString(), CBitcoinAddress(keyIDVoting).ToString(), payee, IPFSPeerID, Identity);
+        nVersion, collateralOutpoint.ToStringShort(), addr.ToString(), (double)nOperatorReward / 100, CBitcoinAddress(keyIDOwner).ToString(), pubKeyOperator.Get().ToString(), CBitcoinAddress(keyIDVoting).ToString(), payee, IPFSPeerID, Identity);
 }
 
 void CProRegTx::ToJson(UniValue& obj) const
@@ -497,7 +518,7 @@ void CProRegTx::ToJson(UniValue& obj) const
         CBitcoinAddress bitcoinAddress(dest);
         obj.push_back(Pair("payoutAddress", bitcoinAddress.ToString()));
     }
-    obj.push_back(Pair("pubKeyOperator", pubKeyOperator.ToString()));
+    obj.push_back(Pair("pubKeyOperator", pubKeyOperator.Get().ToString()));
     obj.push_back(Pair("operatorReward", (double)nOperatorReward / 100));
 
     obj.push_back(Pair("inputsHash", inputsHash.ToString()));
@@ -540,7 +561,7 @@ std::string CProUpRegTx::ToString() const
     }
 
     return strprintf("CProUpRegTx(nVersion=%d, proTxHash=%s, pubKeyOperator=%s, votingAddress=%s, payoutAddress=%s)",
-        nVersion, proTxHash.ToString(), pubKeyOperator.ToString(), CBitcoinAddress(keyIDVoting).ToString(), payee);
+        nVersion, proTxHash.ToString(), pubKeyOperator.Get().ToString(), CBitcoinAddress(keyIDVoting).ToString(), payee);
 }
 
 void CProUpRegTx::ToJson(UniValue& obj) const
@@ -557,7 +578,7 @@ void CProUpRegTx::ToJson(UniValue& obj) const
         CBitcoinAddress bitcoinAddress(dest);
         obj.push_back(Pair("payoutAddress", bitcoinAddress.ToString()));
     }
-    obj.push_back(Pair("pubKeyOperator", pubKeyOperator.ToString()));
+    obj.push_back(Pair("pubKeyOperator", pubKeyOperator.Get().ToString()));
     obj.push_back(Pair("inputsHash", inputsHash.ToString()));
 }
 
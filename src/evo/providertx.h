@@ -6,6 +6,7 @@
 #define HTA_PROVIDERTX_H
 
 #include "bls/bls.h"
+#include "bls/bls_batchverifier.h"
 #include "consensus/validation.h"
 #include "primitives/transaction.h"
 
@@ -27,7 +28,7 @@ public:
     COutPoint collateralOutpoint{uint256(), (uint32_t)-1}; // if hash is null, we refer to a ProRegTx output
     CService addr;
     CKeyID keyIDOwner;
-    CBLSPublicKey pubKeyOperator;
+    CBLSLazyPublicKey pubKeyOperator;
     CKeyID keyIDVoting;
     uint16_t nOperatorReward{0};
     CScript scriptPayout;
@@ -78,7 +79,7 @@ public:
     CService addr;
     CScript scriptOperatorPayout;
     uint256 inputsHash; // replay protection
-    CBLSSignature sig;
+    CBLSLazySignature sig;
     std::string IPFSPeerID;
     std::string Identity;
 public:
@@ -113,7 +114,7 @@ public:
     uint16_t nVersion{CURRENT_VERSION}; // message version
     uint256 proTxHash;
     uint16_t nMode{0}; // only 0 supported for now
-    CBLSPublicKey pubKeyOperator;
+    CBLSLazyPublicKey pubKeyOperator;
     CKeyID keyIDVoting;
     CScript scriptPayout;
     uint256 inputsHash; // replay protection
@@ -165,7 +166,7 @@ public:
     uint256 proTxHash;
     uint16_t nReason{REASON_NOT_SPECIFIED};
     uint256 inputsHash; // replay protection
-    CBLSSignature sig;
+    CBLSLazySignature sig;
 
 public:
     ADD_SERIALIZE_METHODS;
@@ -188,9 +189,14 @@ public:
 };
 
 
+// Operator signatures of all ProTxs in a block, source and message id are both the tx hash
+typedef CBLSBatchVerifier<uint256, uint256> CProTxBatchVerifier;
+
+// When pBatchVerifier is passed, BLS signatures are pushed to it instead of being verified right away and the caller
+// has to verify the batch before accepting the transactions
 bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
-bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
+bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, CProTxBatchVerifier* pBatchVerifier = nullptr);
 bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
-bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
+bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, CProTxBatchVerifier* pBatchVerifier = nullptr);
 
 #endif //HTA_PROVIDERTX_H
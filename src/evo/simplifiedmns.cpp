@@ -14,7 +14,11 @@
 #include "base58.h"
 #include "chainparams.h"
 #include "consensus/merkle.h"
+#include "crypto/sha256.h"
+#include "memusage.h"
+#include "saltedhasher.h"
 #include "univalue.h"
+#include "unordered_lru_cache.h"
 #include "validation.h"
 
 CSimplifiedMNListEntry::CSimplifiedMNListEntry(const CDeterministicMN& dmn) :
@@ -85,7 +89,146 @@ uint256 CSimplifiedMNList::CalcMerkleRoot(bool* pmutated) const
     for (const auto& e : mnList) {
         leaves.emplace_back(e->CalcHash());
     }
-    return ComputeMerkleRoot(leaves, pmutated);
+    return ComputeMerkleRoot(std::move(leaves), pmutated);
+}
+
+CSimplifiedMNListMerkleCache smlMerkleCache;
+
+uint256 CSimplifiedMNListMerkleCache::CalcMerkleRoot(const CSimplifiedMNList& sml, bool* pmutated)
+{
+    LOCK(cs);
+
+    bool fSameMNs = sml.mnList.size() == vecEntries.size();
+    for (size_t i = 0; fSameMNs && i < vecEntries.size(); i++) {
+        fSameMNs = sml.mnList[i]->proRegTxHash == vecEntries[i].proRegTxHash;
+    }
+
+    if (fSameMNs) {
+        // only re-hash changed entries and the nodes above them
+        std::vector<size_t> vecDirty;
+        for (size_t i = 0; i < vecEntries.size(); i++) {
+            if (*sml.mnList[i] != vecEntries[i]) {
+                vecEntries[i] = *sml.mnList[i];
+                vecLevels[0][i] = vecEntries[i].CalcHash();
+                vecDirty.emplace_back(i);
+            }
+        }
+        for (size_t nLevel = 1; nLevel < vecLevels.size() && !vecDirty.empty(); nLevel++) {
+            std::vector<size_t> vecDirtyParents;
+            for (size_t nPos : vecDirty) {
+                if (vecDirtyParents.empty() || vecDirtyParents.back() != nPos / 2) {
+                    vecDirtyParents.emplace_back(nPos / 2);
+                }
+            }
+            UpdateNodes(nLevel, vecDirtyParents);
+            vecDirty.swap(vecDirtyParents);
+        }
+    } else {
+        // MNs were added or removed, so leaves moved. Reuse the hashes of unchanged entries and rebuild the tree
+        std::vector<CSimplifiedMNListEntry> vecNewEntries;
+        std::vector<uint256> vecLeaves;
+        vecNewEntries.reserve(sml.mnList.size());
+        vecLeaves.reserve(sml.mnList.size());
+        size_t nOld = 0;
+        for (const auto& e : sml.mnList) {
+            while (nOld < vecEntries.size() && vecEntries[nOld].proRegTxHash < e->proRegTxHash) {
+                nOld++;
+            }
+            if (nOld < vecEntries.size() && vecEntries[nOld] == *e) {
+                vecLeaves.emplace_back(vecLevels[0][nOld]);
+            } else {
+                vecLeaves.emplace_back(e->CalcHash());
+            }
+            vecNewEntries.emplace_back(*e);
+        }
+        vecEntries.swap(vecNewEntries);
+        vecLevels.assign(1, std::move(vecLeaves));
+        RebuildTree();
+    }
+
+    if (pmutated) {
+        *pmutated = nMutatedNodes != 0;
+    }
+    if (vecEntries.empty()) {
+        return uint256();
+    }
+    return vecLevels.back()[0];
+}
+
+void CSimplifiedMNListMerkleCache::Clear()
+{
+    LOCK(cs);
+    vecEntries.clear();
+    vecLevels.clear();
+    vecMutated.clear();
+    nMutatedNodes = 0;
+}
+
+size_t CSimplifiedMNListMerkleCache::DynamicMemoryUsage()
+{
+    LOCK(cs);
+    size_t nUsage = memusage::DynamicUsage(vecEntries) + memusage::DynamicUsage(vecLevels) + memusage::DynamicUsage(vecMutated);
+    for (const auto& v : vecLevels) {
+        nUsage += memusage::DynamicUsage(v);
+    }
+    for (const auto& v : vecMutated) {
+        nUsage += memusage::MallocUsage((v.capacity() + 7) / 8);
+    }
+    return nUsage;
+}
+
+void CSimplifiedMNListMerkleCache::RebuildTree()
+{
+    vecLevels.resize(1);
+    vecMutated.assign(1, std::vector<bool>(vecLevels[0].size(), false));
+    nMutatedNodes = 0;
+    while (vecLevels.back().size() > 1) {
+        size_t nSize = (vecLevels.back().size() + 1) / 2;
+        vecLevels.emplace_back(nSize);
+        vecMutated.emplace_back(nSize, false);
+        std::vector<size_t> vecPos(nSize);
+        for (size_t i = 0; i < nSize; i++) {
+            vecPos[i] = i;
+        }
+        UpdateNodes(vecLevels.size() - 1, vecPos);
+    }
+}
+
+void CSimplifiedMNListMerkleCache::UpdateNodes(size_t nLevel, const std::vector<size_t>& vecPos)
+{
+    if (vecPos.empty()) {
+        return;
+    }
+    const auto& vecChildren = vecLevels[nLevel - 1];
+
+    // the children of all nodes are hashed in one batch, which lets SHA256D64 use its multi-lane kernels
+    std::vector<uint256> vecPairs;
+    vecPairs.reserve(vecPos.size() * 2);
+    for (size_t nPos : vecPos) {
+        const uint256& left = vecChildren[2 * nPos];
+        // odd levels duplicate their last node
+        const uint256& right = 2 * nPos + 1 < vecChildren.size() ? vecChildren[2 * nPos + 1] : left;
+
+        // like ComputeMerkleRoot, only pairs of complete subtrees are checked for mutation
+        bool fComplete = ((2 * nPos + 2) << (nLevel - 1)) <= vecLevels[0].size();
+        bool fMutated = fComplete && left == right;
+        if (fMutated != vecMutated[nLevel][nPos]) {
+            vecMutated[nLevel][nPos] = fMutated;
+            if (fMutated) {
+                nMutatedNodes++;
+            } else {
+                nMutatedNodes--;
+            }
+        }
+
+        vecPairs.emplace_back(left);
+        vecPairs.emplace_back(right);
+    }
+
+    SHA256D64(vecPairs[0].begin(), vecPairs[0].begin(), vecPos.size());
+    for (size_t i = 0; i < vecPos.size(); i++) {
+        vecLevels[nLevel][vecPos[i]] = vecPairs[i];
+    }
 }
 
 CSimplifiedMNListDiff::CSimplifiedMNListDiff()
@@ -215,6 +358,14 @@ bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& bloc
         return false;
     }
 
+    // Both blocks are in the active chain, so the diff only depends on their hashes. Peers syncing up tend to ask
+    // for the same diffs, protected by cs_main
+    static unordered_lru_cache<uint256, CSimplifiedMNListDiff, StaticSaltedHasher, 32> mnListDiffsCache;
+    uint256 cacheKey = ::SerializeHash(std::make_pair(baseBlockHash, blockHash));
+    if (mnListDiffsCache.get(cacheKey, mnListDiffRet)) {
+        return true;
+    }
+
     LOCK(deterministicMNManager->cs);
 
     auto baseDmnList = deterministicMNManager->GetListForBlock(baseBlockIndex);
@@ -248,5 +399,7 @@ bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& bloc
     vMatch[0] = true; // only coinbase matches
     mnListDiffRet.cbTxMerkleTree = CPartialMerkleTree(vHashes, vMatch);
 
+    mnListDiffsCache.insert(cacheKey, mnListDiffRet);
+
     return true;
 }
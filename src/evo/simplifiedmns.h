@@ -10,6 +10,7 @@
 #include "netaddress.h"
 #include "pubkey.h"
 #include "serialize.h"
+#include "sync.h"
 #include "version.h"
 
 class UniValue;
@@ -84,6 +85,34 @@ public:
     uint256 CalcMerkleRoot(bool* pmutated = NULL) const;
 };
 
+/**
+ * Keeps the entries, leaf hashes and inner nodes of the last calculated SML merkle tree. Entries which did not change
+ * since the last calculation are not hashed again and, as long as no MNs were added or removed, only the paths from
+ * the changed leaves up to the root are recalculated. The result is identical to CSimplifiedMNList::CalcMerkleRoot.
+ */
+class CSimplifiedMNListMerkleCache
+{
+private:
+    CCriticalSection cs;
+    std::vector<CSimplifiedMNListEntry> vecEntries;
+    // vecLevels[0] holds the leaf hashes and the last level the root
+    std::vector<std::vector<uint256>> vecLevels;
+    // inner nodes whose two (complete) children are equal, see CVE-2012-2459 in consensus/merkle.cpp
+    std::vector<std::vector<bool>> vecMutated;
+    size_t nMutatedNodes{0};
+
+public:
+    uint256 CalcMerkleRoot(const CSimplifiedMNList& sml, bool* pmutated = NULL);
+    void Clear();
+    size_t DynamicMemoryUsage();
+
+private:
+    void RebuildTree();
+    void UpdateNodes(size_t nLevel, const std::vector<size_t>& vecPos);
+};
+
+extern CSimplifiedMNListMerkleCache smlMerkleCache;
+
 /// P2P messages
 
 class CGetSimplifiedMNListDiff
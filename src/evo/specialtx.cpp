@@ -5,6 +5,7 @@
 #include "chainparams.h"
 #include "clientversion.h"
 #include "consensus/validation.h"
+#include "governance-collateral.h"
 #include "hash.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
@@ -17,7 +18,7 @@
 #include "llmq/quorums_commitment.h"
 #include "llmq/quorums_blockprocessor.h"
 
-bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, CProTxBatchVerifier* pBatchVerifier)
 {
     if (tx.nVersion != 3 || tx.nType == TRANSACTION_NORMAL)
         return true;
@@ -30,11 +31,11 @@ bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVali
     case TRANSACTION_PROVIDER_REGISTER:
         return CheckProRegTx(tx, pindexPrev, state);
     case TRANSACTION_PROVIDER_UPDATE_SERVICE:
-        return CheckProUpServTx(tx, pindexPrev, state);
+        return CheckProUpServTx(tx, pindexPrev, state, pBatchVerifier);
     case TRANSACTION_PROVIDER_UPDATE_REGISTRAR:
         return CheckProUpRegTx(tx, pindexPrev, state);
     case TRANSACTION_PROVIDER_UPDATE_REVOKE:
-        return CheckProUpRevTx(tx, pindexPrev, state);
+        return CheckProUpRevTx(tx, pindexPrev, state, pBatchVerifier);
     case TRANSACTION_COINBASE:
         return CheckCbTx(tx, pindexPrev, state);
     case TRANSACTION_QUORUM_COMMITMENT:
@@ -86,7 +87,7 @@ bool UndoSpecialTx(const CTransaction& tx, const CBlockIndex* pindex)
     return false;
 }
 
-bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck, bool fCheckCbTxMerleRoots)
+bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck, bool fCheckCbTxMerleRoots, BlockConnectTimings* pTimings)
 {
     static int64_t nTimeLoop = 0;
     static int64_t nTimeQuorum = 0;
@@ -95,9 +96,13 @@ bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CV
 
     int64_t nTime1 = GetTimeMicros();
 
+    // operator signatures are verified in one batch after all other checks passed. Secure verification is required
+    // as operator keys are not proven to be owned by the registering party
+    CProTxBatchVerifier batchVerifier(true, true, 0, true);
+
     for (int i = 0; i < (int)block.vtx.size(); i++) {
         const CTransaction& tx = *block.vtx[i];
-        if (!CheckSpecialTx(tx, pindex->pprev, state)) {
+        if (!CheckSpecialTx(tx, pindex->pprev, state, &batchVerifier)) {
             return false;
         }
         if (!ProcessSpecialTx(tx, pindex, state)) {
@@ -105,10 +110,16 @@ bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CV
         }
     }
 
+    batchVerifier.Verify();
+    if (!batchVerifier.badMessages.empty()) {
+        LogPrintf("%s -- invalid operator signature in tx %s\n", __func__, batchVerifier.badMessages.begin()->ToString());
+        return state.DoS(100, false, REJECT_INVALID, "bad-protx-sig", false);
+    }
+
     int64_t nTime2 = GetTimeMicros(); nTimeLoop += nTime2 - nTime1;
     LogPrint("bench", "        - Loop: %.2fms [%.2fs]\n", 0.001 * (nTime2 - nTime1), nTimeLoop * 0.000001);
 
-    if (!llmq::quorumBlockProcessor->ProcessBlock(block, pindex, state)) {
+    if (!llmq::quorumBlockProcessor->ProcessBlock(block, pindex, state, fJustCheck)) {
         return false;
     }
 
@@ -122,6 +133,10 @@ bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CV
     int64_t nTime4 = GetTimeMicros(); nTimeDMN += nTime4 - nTime3;
     LogPrint("bench", "        - deterministicMNManager: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTime3), nTimeDMN * 0.000001);
 
+    if (!ProcessGovernanceCollateralsInBlock(block, pindex, fJustCheck)) {
+        return false;
+    }
+
     if (fCheckCbTxMerleRoots && !CheckCbTxMerkleRoots(block, pindex, state)) {
         return false;
     }
@@ -129,6 +144,13 @@ bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CV
     int64_t nTime5 = GetTimeMicros(); nTimeMerkle += nTime5 - nTime4;
     LogPrint("bench", "        - CheckCbTxMerkleRoots: %.2fms [%.2fs]\n", 0.001 * (nTime5 - nTime4), nTimeMerkle * 0.000001);
 
+    if (pTimings) {
+        pTimings->nTimeSpecialTxs = nTime2 - nTime1;
+        pTimings->nTimeQuorumBlockProcessor = nTime3 - nTime2;
+        pTimings->nTimeDeterministicMNs = nTime4 - nTime3;
+        pTimings->nTimeCbTxMerkleRoots = nTime5 - nTime4;
+    }
+
     return true;
 }
 
@@ -149,6 +171,10 @@ bool UndoSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex)
         return false;
     }
 
+    if (!UndoGovernanceCollateralsInBlock(block, pindex)) {
+        return false;
+    }
+
     return true;
 }
 
@@ -12,9 +12,13 @@
 class CBlock;
 class CBlockIndex;
 class CValidationState;
+struct BlockConnectTimings;
 
-bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
-bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck, bool fCheckCbTxMerleRoots);
+template<typename SourceId, typename MessageId>
+class CBLSBatchVerifier;
+
+bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, CBLSBatchVerifier<uint256, uint256>* pBatchVerifier = nullptr);
+bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck, bool fCheckCbTxMerleRoots, BlockConnectTimings* pTimings = nullptr);
 bool UndoSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex);
 
 template <typename T>
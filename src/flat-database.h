@@ -171,10 +171,14 @@ public:
         strMagicMessage = strMagicMessageIn;
     }
 
-    bool Load(T& objToLoad)
+    /**
+     * Without fCleanup the loaded object isn't cleaned up, which lets the file be loaded before the
+     * chain is. The caller has to call CheckAndRemove later on.
+     */
+    bool Load(T& objToLoad, bool fCleanup = true)
     {
         LogPrintf("Reading info from %s...\n", strFilename);
-        ReadResult readResult = Read(objToLoad);
+        ReadResult readResult = Read(objToLoad, !fCleanup);
         if (readResult == FileError)
             LogPrintf("Missing file %s, will try to recreate\n", strFilename);
         else if (readResult != Ok)
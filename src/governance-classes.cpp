@@ -5,6 +5,7 @@
 #include "governance-classes.h"
 #include "core_io.h"
 #include "init.h"
+#include "evo/deterministicmns.h"
 #include "utilstrencodings.h"
 #include "validation.h"
 
@@ -120,6 +121,7 @@ bool CGovernanceTriggerManager::AddNewTrigger(uint256 nHash)
     pSuperblock->SetStatus(SEEN_OBJECT_IS_VALID);
 
     mapTrigger.insert(std::make_pair(nHash, pSuperblock));
+    mapTriggersByHeight[pSuperblock->GetBlockHeight()].insert(nHash);
 
     return true;
 }
@@ -183,6 +185,15 @@ void CGovernanceTriggerManager::CleanAndRemove()
                 }
             }
             // delete the trigger
+            if (pSuperblock) {
+                auto itHeight = mapTriggersByHeight.find(pSuperblock->GetBlockHeight());
+                if (itHeight != mapTriggersByHeight.end()) {
+                    itHeight->second.erase(it->first);
+                    if (itHeight->second.empty()) {
+                        mapTriggersByHeight.erase(itHeight);
+                    }
+                }
+            }
             mapTrigger.erase(it++);
         } else {
             ++it;
@@ -193,20 +204,24 @@ void CGovernanceTriggerManager::CleanAndRemove()
 /**
 *   Get Active Triggers
 *
-*   - Look through triggers and scan for active ones
-*   - Return the triggers in a list
+*   - Look through the triggers for a superblock height and return the ones
+*     which still have a governance object
 */
 
-std::vector<CSuperblock_sptr> CGovernanceTriggerManager::GetActiveTriggers()
+std::vector<CSuperblock_sptr> CGovernanceTriggerManager::GetActiveTriggersAtHeight(int nBlockHeight)
 {
     AssertLockHeld(governance.cs);
     std::vector<CSuperblock_sptr> vecResults;
 
-    // LOOK AT THESE OBJECTS AND COMPILE A VALID LIST OF TRIGGERS
-    for (const auto& pair : mapTrigger) {
-        CGovernanceObject* pObj = governance.FindGovernanceObject(pair.first);
-        if (pObj) {
-            vecResults.push_back(pair.second);
+    auto itHeight = mapTriggersByHeight.find(nBlockHeight);
+    if (itHeight == mapTriggersByHeight.end()) {
+        return vecResults;
+    }
+
+    for (const auto& nHash : itHeight->second) {
+        auto it = mapTrigger.find(nHash);
+        if (it != mapTrigger.end() && governance.FindGovernanceObject(nHash)) {
+            vecResults.push_back(it->second);
         }
     }
 
@@ -227,8 +242,8 @@ bool CSuperblockManager::IsSuperblockTriggered(int nBlockHeight)
     }
 
     LOCK(governance.cs);
-    // GET ALL ACTIVE TRIGGERS
-    std::vector<CSuperblock_sptr> vecTriggers = triggerman.GetActiveTriggers();
+    // GET ALL ACTIVE TRIGGERS FOR THIS HEIGHT
+    std::vector<CSuperblock_sptr> vecTriggers = triggerman.GetActiveTriggersAtHeight(nBlockHeight);
 
     LogPrint("gobject", "CSuperblockManager::IsSuperblockTriggered -- vecTriggers.size() = %d\n", vecTriggers.size());
 
@@ -258,7 +273,7 @@ bool CSuperblockManager::IsSuperblockTriggered(int nBlockHeight)
 
         // MAKE SURE THIS TRIGGER IS ACTIVE VIA FUNDING CACHE FLAG
 
-        pObj->UpdateSentinelVariables();
+        pSuperblock->UpdateFunding(*pObj);
 
         if (pObj->IsSetCachedFunding()) {
             LogPrint("gobject", "CSuperblockManager::IsSuperblockTriggered -- fCacheFunding = true, returning true\n");
@@ -279,7 +294,7 @@ bool CSuperblockManager::GetBestSuperblock(CSuperblock_sptr& pSuperblockRet, int
     }
 
     AssertLockHeld(governance.cs);
-    std::vector<CSuperblock_sptr> vecTriggers = triggerman.GetActiveTriggers();
+    std::vector<CSuperblock_sptr> vecTriggers = triggerman.GetActiveTriggersAtHeight(nBlockHeight);
     int nYesCount = 0;
 
     for (const auto& pSuperblock : vecTriggers) {
@@ -390,7 +405,10 @@ CSuperblock::
     nGovObjHash(),
     nBlockHeight(0),
     nStatus(SEEN_OBJECT_UNKNOWN),
-    vecPayments()
+    vecPayments(),
+    fFundingChecked(false),
+    nFundingCheckTallyVersion(0),
+    nFundingCheckMnCount(0)
 {
 }
 
@@ -399,7 +417,10 @@ CSuperblock::
     nGovObjHash(nHash),
     nBlockHeight(0),
     nStatus(SEEN_OBJECT_UNKNOWN),
-    vecPayments()
+    vecPayments(),
+    fFundingChecked(false),
+    nFundingCheckTallyVersion(0),
+    nFundingCheckMnCount(0)
 {
     CGovernanceObject* pGovObj = GetGovernanceObject();
 
@@ -662,6 +683,25 @@ bool CSuperblock::IsValid(const CTransaction& txNew, int nBlockHeight, CAmount b
     return true;
 }
 
+void CSuperblock::UpdateFunding(CGovernanceObject& govobj)
+{
+    AssertLockHeld(governance.cs);
+
+    // for triggers the funding flag only depends on the funding votes and the number of masternodes
+    uint64_t nTallyVersion = govobj.GetVoteTallyVersion();
+    int nMnCount = (int)deterministicMNManager->GetListAtChainTip().GetValidMNsCount();
+    if (fFundingChecked && nTallyVersion == nFundingCheckTallyVersion && nMnCount == nFundingCheckMnCount) {
+        return;
+    }
+
+    govobj.UpdateSentinelVariables();
+    governance.UpdateFundingIndex(govobj);
+
+    fFundingChecked = true;
+    nFundingCheckTallyVersion = nTallyVersion;
+    nFundingCheckMnCount = nMnCount;
+}
+
 bool CSuperblock::IsExpired()
 {
     bool fExpired{false};
@@ -36,14 +36,17 @@ private:
     typedef trigger_m_t::iterator trigger_m_it;
 
     trigger_m_t mapTrigger;
+    // hashes of the triggers in mapTrigger by the height of their superblock
+    std::map<int, std::set<uint256> > mapTriggersByHeight;
 
-    std::vector<CSuperblock_sptr> GetActiveTriggers();
+    std::vector<CSuperblock_sptr> GetActiveTriggersAtHeight(int nBlockHeight);
     bool AddNewTrigger(uint256 nHash);
     void CleanAndRemove();
 
 public:
     CGovernanceTriggerManager() :
-        mapTrigger() {}
+        mapTrigger(),
+        mapTriggersByHeight() {}
 };
 
 /**
@@ -137,6 +140,11 @@ private:
     int nStatus;
     std::vector<CGovernancePayment> vecPayments;
 
+    // the vote tally and masternode count the funding flag of the trigger was last updated for
+    bool fFundingChecked;
+    uint64_t nFundingCheckTallyVersion;
+    int nFundingCheckMnCount;
+
     void ParsePaymentSchedule(const std::string& strPaymentAddresses, const std::string& strPaymentAmounts);
 
 public:
@@ -173,6 +181,9 @@ public:
 
     bool IsValid(const CTransaction& txNew, int nBlockHeight, CAmount blockReward);
     bool IsExpired();
+
+    /// Update the funding flag of the trigger object, unless the votes and the masternode count didn't change since
+    void UpdateFunding(CGovernanceObject& govobj);
 };
 
 #endif
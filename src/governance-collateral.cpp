@@ -0,0 +1,162 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-collateral.h"
+
+#include "chain.h"
+#include "chainparams.h"
+#include "init.h"
+#include "primitives/block.h"
+#include "script/script.h"
+#include "util.h"
+#include "validation.h"
+
+#include "evo/evodb.h"
+
+static const std::string DB_GOVERNANCE_COLLATERAL = "gov_c";
+// the block up to which the index is complete
+static const std::string DB_GOVERNANCE_COLLATERAL_BEST_BLOCK = "gov_c_bb";
+
+static const size_t UPGRADE_BATCH_SIZE = 16 << 20;
+
+bool IsGovernanceCollateralCandidate(const CTransaction& tx)
+{
+    if (tx.IsCoinBase()) {
+        return false;
+    }
+    for (const auto& txout : tx.vout) {
+        const CScript& script = txout.scriptPubKey;
+        if (script.size() == 34 && script[0] == OP_RETURN && script[1] == 32) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ProcessGovernanceCollateralsInBlock(const CBlock& block, const CBlockIndex* pindex, bool fJustCheck)
+{
+    AssertLockHeld(cs_main);
+
+    if (fTxIndex || fJustCheck) {
+        return true;
+    }
+
+    uint256 blockHash = block.GetHash();
+    for (const auto& tx : block.vtx) {
+        if (IsGovernanceCollateralCandidate(*tx)) {
+            evoDb->Write(std::make_pair(DB_GOVERNANCE_COLLATERAL, tx->GetHash()), std::make_pair(tx, blockHash));
+        }
+    }
+
+    // only move the best block along when nothing is missing before this block, UpgradeGovernanceCollateralIndex fills the gaps
+    uint256 bestBlock;
+    if (pindex->pprev == nullptr || (evoDb->Read(DB_GOVERNANCE_COLLATERAL_BEST_BLOCK, bestBlock) && bestBlock == pindex->pprev->GetBlockHash())) {
+        evoDb->Write(DB_GOVERNANCE_COLLATERAL_BEST_BLOCK, blockHash);
+    }
+
+    return true;
+}
+
+bool UndoGovernanceCollateralsInBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+
+    if (fTxIndex) {
+        return true;
+    }
+
+    for (const auto& tx : block.vtx) {
+        if (IsGovernanceCollateralCandidate(*tx)) {
+            evoDb->Erase(std::make_pair(DB_GOVERNANCE_COLLATERAL, tx->GetHash()));
+        }
+    }
+
+    uint256 bestBlock;
+    if (evoDb->Read(DB_GOVERNANCE_COLLATERAL_BEST_BLOCK, bestBlock) && bestBlock == pindex->GetBlockHash()) {
+        if (pindex->pprev) {
+            evoDb->Write(DB_GOVERNANCE_COLLATERAL_BEST_BLOCK, pindex->pprev->GetBlockHash());
+        } else {
+            evoDb->Erase(DB_GOVERNANCE_COLLATERAL_BEST_BLOCK);
+        }
+    }
+
+    return true;
+}
+
+void UpgradeGovernanceCollateralIndex()
+{
+    LOCK(cs_main);
+
+    if (fTxIndex || chainActive.Tip() == nullptr) {
+        return;
+    }
+
+    const CBlockIndex* pindex = chainActive.Genesis();
+    uint256 bestBlock;
+    if (evoDb->GetRawDB().Read(DB_GOVERNANCE_COLLATERAL_BEST_BLOCK, bestBlock)) {
+        if (bestBlock == chainActive.Tip()->GetBlockHash()) {
+            return;
+        }
+        auto it = mapBlockIndex.find(bestBlock);
+        if (it != mapBlockIndex.end() && chainActive.Contains(it->second)) {
+            pindex = chainActive.Next(it->second);
+        }
+    }
+
+    LogPrintf("%s -- indexing governance collaterals from height %d\n", __func__, pindex->nHeight);
+
+    CDBBatch batch(evoDb->GetRawDB());
+    int nPruned = 0;
+    for (; pindex; pindex = chainActive.Next(pindex)) {
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            // nothing we can do about pruned blocks, their collaterals stay unknown
+            nPruned++;
+        } else {
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+                LogPrintf("%s -- ERROR, failed to read block %s, stopping at height %d\n", __func__, pindex->GetBlockHash().ToString(), pindex->nHeight);
+                break;
+            }
+            for (const auto& tx : block.vtx) {
+                if (IsGovernanceCollateralCandidate(*tx)) {
+                    batch.Write(std::make_pair(DB_GOVERNANCE_COLLATERAL, tx->GetHash()), std::make_pair(tx, pindex->GetBlockHash()));
+                }
+            }
+        }
+        batch.Write(DB_GOVERNANCE_COLLATERAL_BEST_BLOCK, pindex->GetBlockHash());
+
+        if (batch.SizeEstimate() >= UPGRADE_BATCH_SIZE) {
+            evoDb->GetRawDB().WriteBatch(batch);
+            batch.Clear();
+            // the best block was written with the batch, so the next start continues from here
+            if (ShutdownRequested()) {
+                break;
+            }
+        }
+    }
+    evoDb->GetRawDB().WriteBatch(batch);
+
+    if (nPruned > 0) {
+        LogPrintf("%s -- WARNING, skipped %d pruned blocks\n", __func__, nPruned);
+    }
+    LogPrintf("%s -- done\n", __func__);
+}
+
+bool GetGovernanceCollateral(const uint256& txid, CTransactionRef& txRet, uint256& hashBlockRet)
+{
+    if (GetTransaction(txid, txRet, Params().GetConsensus(), hashBlockRet, true)) {
+        return true;
+    }
+    if (fTxIndex) {
+        return false;
+    }
+
+    std::pair<CTransactionRef, uint256> p;
+    if (!evoDb->Read(std::make_pair(DB_GOVERNANCE_COLLATERAL, txid), p)) {
+        return false;
+    }
+    txRet = p.first;
+    hashBlockRet = p.second;
+    return true;
+}
@@ -0,0 +1,36 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef GOVERNANCE_COLLATERAL_H
+#define GOVERNANCE_COLLATERAL_H
+
+#include "primitives/transaction.h"
+#include "uint256.h"
+
+class CBlock;
+class CBlockIndex;
+
+/**
+ * Index of governance collateral transactions in evoDb, so governance objects can be validated
+ * without -txindex, which is what lets full nodes and masternodes prune their block files.
+ * Collaterals only have an OP_RETURN output, so they can't be found through the coins database.
+ *
+ * Every transaction with an OP_RETURN output pushing 32 bytes (the proof of burn of a governance
+ * object) is stored as (tx, block hash) together with the block that mined it, and erased when
+ * that block is disconnected. The index is only maintained when -txindex is off.
+ */
+
+/// Whether tx looks like a governance collateral and is worth indexing
+bool IsGovernanceCollateralCandidate(const CTransaction& tx);
+
+bool ProcessGovernanceCollateralsInBlock(const CBlock& block, const CBlockIndex* pindex, bool fJustCheck);
+bool UndoGovernanceCollateralsInBlock(const CBlock& block, const CBlockIndex* pindex);
+
+/// Index the blocks connected while the index wasn't complete, e.g. in lite mode, skips pruned blocks
+void UpgradeGovernanceCollateralIndex();
+
+/// Look up a collateral through GetTransaction and fall back to the index when -txindex is off
+bool GetGovernanceCollateral(const uint256& txid, CTransactionRef& txRet, uint256& hashBlockRet);
+
+#endif // GOVERNANCE_COLLATERAL_H
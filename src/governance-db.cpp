@@ -0,0 +1,104 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-db.h"
+#include "governance-object.h"
+#include "util.h"
+
+static const std::string DB_VERSION = "gov_v";
+// uncompressed objects, as written by older versions
+static const std::string DB_OBJECT = "gov_o";
+static const std::string DB_OBJECT_COMPRESSED = "gov_z";
+static const std::string DB_STATE = "gov_s";
+static const std::string DB_SNAPSHOT_ID = "gov_n";
+
+CGovernanceDB::CGovernanceDB(size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(fMemory ? "" : (GetDataDir() / "governance"), nCacheSize, fMemory, fWipe, false, "governance")
+{
+}
+
+bool CGovernanceDB::ReadVersion(std::string& strVersionRet)
+{
+    return db.Read(DB_VERSION, strVersionRet);
+}
+
+void CGovernanceDB::WriteVersion(CDBBatch& batch, const std::string& strVersion)
+{
+    batch.Write(DB_VERSION, strVersion);
+}
+
+void CGovernanceDB::WriteObject(CDBBatch& batch, const CGovernanceObject& govobj)
+{
+    uint256 nHash = govobj.GetHash();
+    batch.Write(std::make_pair(DB_OBJECT_COMPRESSED, nHash), CGovernanceObjectCompressor(REF(govobj)));
+    batch.Erase(std::make_pair(DB_OBJECT, nHash));
+}
+
+void CGovernanceDB::EraseObject(CDBBatch& batch, const uint256& nHash)
+{
+    batch.Erase(std::make_pair(DB_OBJECT_COMPRESSED, nHash));
+    batch.Erase(std::make_pair(DB_OBJECT, nHash));
+}
+
+void CGovernanceDB::WriteState(CDBBatch& batch, const std::vector<unsigned char>& vchState)
+{
+    batch.Write(DB_STATE, vchState);
+}
+
+void CGovernanceDB::WriteSnapshotId(CDBBatch& batch, const uint256& nId)
+{
+    batch.Write(DB_SNAPSHOT_ID, nId);
+}
+
+void CGovernanceDB::EraseSnapshotId(CDBBatch& batch)
+{
+    batch.Erase(DB_SNAPSHOT_ID);
+}
+
+bool CGovernanceDB::ReadState(std::vector<unsigned char>& vchStateRet)
+{
+    return db.Read(DB_STATE, vchStateRet);
+}
+
+bool CGovernanceDB::ReadSnapshotId(uint256& nIdRet)
+{
+    return db.Read(DB_SNAPSHOT_ID, nIdRet);
+}
+
+bool CGovernanceDB::ReadVoteFile(const uint256& nHash, CGovernanceObjectVoteFile& fileRet)
+{
+    CGovernanceObject govobj;
+    CGovernanceObjectCompressor compressor(govobj);
+    if (!db.Read(std::make_pair(DB_OBJECT_COMPRESSED, nHash), compressor) && !db.Read(std::make_pair(DB_OBJECT, nHash), govobj)) {
+        return false;
+    }
+    fileRet = govobj.GetVoteFile();
+    return true;
+}
+
+bool CGovernanceDB::ForEachObject(std::function<void(CGovernanceObject&, bool)> func)
+{
+    for (const std::string& strPrefix : {DB_OBJECT, DB_OBJECT_COMPRESSED}) {
+        bool fCompressed = strPrefix == DB_OBJECT_COMPRESSED;
+        std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+        auto start = std::make_pair(strPrefix, uint256());
+        pcursor->Seek(start);
+
+        while (pcursor->Valid()) {
+            std::pair<std::string, uint256> key;
+            if (!pcursor->GetKey(key) || key.first != strPrefix) {
+                break;
+            }
+            CGovernanceObject govobj;
+            CGovernanceObjectCompressor compressor(govobj);
+            if (fCompressed ? !pcursor->GetValue(compressor) : !pcursor->GetValue(govobj)) {
+                LogPrintf("CGovernanceDB::%s -- failed to read object %s\n", __func__, key.second.ToString());
+                return false;
+            }
+            func(govobj, !fCompressed);
+            pcursor->Next();
+        }
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef GOVERNANCE_DB_H
+#define GOVERNANCE_DB_H
+
+#include "dbwrapper.h"
+#include "uint256.h"
+
+#include <functional>
+
+class CGovernanceObject;
+class CGovernanceObjectVoteFile;
+
+static const size_t DEFAULT_GOVERNANCE_DB_CACHE = 8 << 20;
+
+/**
+ * Governance objects (including their vote files) stored one key per object,
+ * plus a single entry holding the rest of CGovernanceManager's state.
+ * CGovernanceManager only writes the objects which changed since its last flush.
+ * Objects are written with their data compressed, objects stored uncompressed by
+ * older versions are still read and replaced when written again.
+ */
+class CGovernanceDB
+{
+private:
+    CDBWrapper db;
+
+public:
+    CGovernanceDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    CDBWrapper& GetRawDB() { return db; }
+
+    bool ReadVersion(std::string& strVersionRet);
+
+    static void WriteVersion(CDBBatch& batch, const std::string& strVersion);
+    static void WriteObject(CDBBatch& batch, const CGovernanceObject& govobj);
+    static void EraseObject(CDBBatch& batch, const uint256& nHash);
+    static void WriteState(CDBBatch& batch, const std::vector<unsigned char>& vchState);
+    /// Id of the governance snapshot written together with the current contents, erased by every other write
+    static void WriteSnapshotId(CDBBatch& batch, const uint256& nId);
+    static void EraseSnapshotId(CDBBatch& batch);
+
+    bool ReadState(std::vector<unsigned char>& vchStateRet);
+    bool ReadSnapshotId(uint256& nIdRet);
+
+    /// Read the vote file of a stored object, used for the vote files paged out of memory
+    bool ReadVoteFile(const uint256& nHash, CGovernanceObjectVoteFile& fileRet);
+
+    /// Call func for every stored object and whether it is stored uncompressed, stops and returns false if an entry can't be read
+    bool ForEachObject(std::function<void(CGovernanceObject&, bool)> func);
+};
+
+#endif
@@ -5,6 +5,8 @@
 #include "governance-object.h"
 #include "core_io.h"
 #include "governance-classes.h"
+#include "governance-collateral.h"
+#include "governance-db.h"
 #include "governance-validators.h"
 #include "governance-vote.h"
 #include "governance.h"
@@ -15,9 +17,12 @@
 #include "util.h"
 #include "validation.h"
 
+#include <atomic>
 #include <string>
 #include <univalue.h>
 
+static std::atomic<uint64_t> nLastVoteTallyVersion(0);
+
 CGovernanceObject::CGovernanceObject() :
     cs(),
     nObjectType(GOVERNANCE_OBJECT_UNKNOWN),
@@ -43,6 +48,9 @@ CGovernanceObject::CGovernanceObject() :
     mapCurrentMNVotes(),
     cmmapOrphanVotes(),
     fileVotes(),
+    fVotesPagedOut(false),
+    nVoteTally(),
+    nVoteTallyVersion(0),
     nCollateralBlockHeight(0)
 {
     // PARSE JSON DATA STORAGE (VCHDATA)
@@ -74,6 +82,9 @@ CGovernanceObject::CGovernanceObject(const uint256& nHashParentIn, int nRevision
     mapCurrentMNVotes(),
     cmmapOrphanVotes(),
     fileVotes(),
+    fVotesPagedOut(false),
+    nVoteTally(),
+    nVoteTallyVersion(0),
     nNextSuperblock(-1),
     nCollateralBlockHeight(0)
 {
@@ -92,6 +103,7 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other) :
     nDeletionTime(other.nDeletionTime),
     nCollateralHash(other.nCollateralHash),
     vchData(other.vchData),
+    pPayload(other.pPayload),
     masternodeOutpoint(other.masternodeOutpoint),
     vchSig(other.vchSig),
     fCachedLocalValidity(other.fCachedLocalValidity),
@@ -108,6 +120,12 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other) :
     mapCurrentMNVotes(other.mapCurrentMNVotes),
     cmmapOrphanVotes(other.cmmapOrphanVotes),
     fileVotes(other.fileVotes),
+    fVotesPagedOut(other.fVotesPagedOut),
+    pagedVotesDB(other.pagedVotesDB),
+    pagedVoteDigest(other.pagedVoteDigest),
+    vecPagedVoteHashes(other.vecPagedVoteHashes),
+    nVoteTally(other.nVoteTally),
+    nVoteTallyVersion(other.nVoteTallyVersion),
     nCollateralHashBlock(other.nCollateralHashBlock),
     nNextSuperblock(other.nNextSuperblock)
 {
@@ -116,9 +134,11 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other) :
 bool CGovernanceObject::ProcessVote(CNode* pfrom,
     const CGovernanceVote& vote,
     CGovernanceException& exception,
-    CConnman& connman)
+    CConnman& connman,
+    bool fSignatureChecked)
 {
     LOCK(cs);
+    LoadPagedVotes();
 
     // do not process already known valid votes twice
     if (fileVotes.HasVote(vote.GetHash())) {
@@ -211,15 +231,10 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
         nVoteTimeUpdate = nNow;
     }
 
-    bool onlyVotingKeyAllowed = false;
-    if (nObjectType == GOVERNANCE_OBJECT_PROPOSAL || nObjectType == GOVERNANCE_OBJECT_RECORD) {
-        if (vote.GetSignal() == VOTE_SIGNAL_FUNDING) {
-            onlyVotingKeyAllowed = true;
-        } 
-    }
+    bool onlyVotingKeyAllowed = IsVotingKeySignal(vote.GetSignal());
 
     // Finally check that the vote is actually valid (done last because of cost of signature verification)
-    if (!vote.IsValid(onlyVotingKeyAllowed)) {
+    if (!vote.IsValid(onlyVotingKeyAllowed, !fSignatureChecked)) {
         std::ostringstream ostr;
         ostr << "CGovernanceObject::ProcessVote -- Invalid vote"
              << ", MN outpoint = " << vote.GetMasternodeOutpoint().ToStringShort()
@@ -241,12 +256,19 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
         return false;
     }
 
+    UpdateVoteTally(eSignal, voteInstanceRef.eOutcome, -1);
     voteInstanceRef = vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp());
+    UpdateVoteTally(eSignal, voteInstanceRef.eOutcome, 1);
     fileVotes.AddVote(vote);
     fDirtyCache = true;
     return true;
 }
 
+bool CGovernanceObject::IsVotingKeySignal(vote_signal_enum_t eSignal) const
+{
+    return (nObjectType == GOVERNANCE_OBJECT_PROPOSAL || nObjectType == GOVERNANCE_OBJECT_RECORD) && eSignal == VOTE_SIGNAL_FUNDING;
+}
+
 void CGovernanceObject::ClearMasternodeVotes()
 {
     LOCK(cs);
@@ -260,7 +282,9 @@ void CGovernanceObject::ClearMasternodeVotes()
     while (it != mapCurrentMNVotes.end()) {
         if (!mnList.HasMNByCollateral(it->first)) {
             if (nObjectType == GOVERNANCE_OBJECT_RECORD && (nBlockHeight < this->GetCollateralNextSuperBlock())) {
+                LoadPagedVotes();
                 fileVotes.RemoveVotesFromMasternode(it->first);
+                UpdateVoteTally(it->second, -1);
                 mapCurrentMNVotes.erase(it++);
             }
         } else {
@@ -284,6 +308,7 @@ std::set<uint256> CGovernanceObject::RemoveInvalidVotes(const COutPoint& mnOutpo
         nBlockHeight = (int)chainActive.Height();
     }
 
+    LoadPagedVotes();
     auto removedVotes = fileVotes.RemoveInvalidVotes(mnOutpoint, nObjectType == GOVERNANCE_OBJECT_PROPOSAL);
 
     if (nObjectType == GOVERNANCE_OBJECT_RECORD && (nBlockHeight < this->GetCollateralNextSuperBlock())) {
@@ -302,6 +327,7 @@ std::set<uint256> CGovernanceObject::RemoveInvalidVotes(const COutPoint& mnOutpo
         CGovernanceVote tmpVote(mnOutpoint, nParentHash, (vote_signal_enum_t)jt->first, jt->second.eOutcome);
         tmpVote.SetTime(jt->second.nCreationTime);
         if (removedVotes.count(tmpVote.GetHash())) {
+            UpdateVoteTally(jt->first, jt->second.eOutcome, -1);
             jt = it->second.mapInstances.erase(jt);
         } else {
             ++jt;
@@ -346,7 +372,18 @@ uint256 CGovernanceObject::GetHash() const
     ss << nHashParent;
     ss << nRevision;
     ss << nTime;
-    ss << GetDataAsHexString();
+    // same as ss << GetDataAsHexString(), but without building the string, which is twice as large as the data
+    static const char hexmap[] = "0123456789abcdef";
+    char buf[256];
+    WriteCompactSize(ss, vchData.size() * 2);
+    for (size_t i = 0; i < vchData.size(); ) {
+        size_t n = 0;
+        for (; i < vchData.size() && n < sizeof(buf); i++) {
+            buf[n++] = hexmap[vchData[i] >> 4];
+            buf[n++] = hexmap[vchData[i] & 15];
+        }
+        ss.write(buf, n);
+    }
     ss << masternodeOutpoint << uint8_t{} << 0xffffffff; // adding dummy values here to match old hashing
     ss << vchSig;
     // fee_tx is left out on purpose
@@ -392,23 +429,20 @@ bool CGovernanceObject::CheckSignature(const CBLSPublicKey& pubKey) const
  */
 UniValue CGovernanceObject::GetJSONObject()
 {
-    UniValue obj(UniValue::VOBJ);
-    if (vchData.empty()) {
-        return obj;
+    CGovernanceObjectPayloadPtr pPayloadTmp = GetPayload();
+    if (pPayloadTmp->nDataSize != 0 && !pPayloadTmp->fValid) {
+        throw std::runtime_error(pPayloadTmp->strError);
     }
+    return pPayloadTmp->obj;
+}
 
-    UniValue objResult(UniValue::VOBJ);
-    GetData(objResult);
-
-    if (objResult.isObject()) {
-        obj = objResult;
-    } else {
-        std::vector<UniValue> arr1 = objResult.getValues();
-        std::vector<UniValue> arr2 = arr1.at(0).getValues();
-        obj = arr2.at(1);
+CGovernanceObjectPayloadPtr CGovernanceObject::GetPayload() const
+{
+    LOCK(cs);
+    if (!pPayload) {
+        pPayload = std::make_shared<const CGovernanceObjectPayload>(vchData);
     }
-
-    return obj;
+    return pPayload;
 }
 
 /**
@@ -427,8 +461,6 @@ void CGovernanceObject::LoadData()
 
     try {
         // ATTEMPT TO LOAD JSON STRING FROM VCHDATA
-        UniValue objResult(UniValue::VOBJ);
-        GetData(objResult);
         LogPrint("gobject", "CGovernanceObject::LoadData -- GetDataAsPlainString = %s\n", GetDataAsPlainString());
         UniValue obj = GetJSONObject();
         nObjectType = obj["type"].get_int();
@@ -448,22 +480,6 @@ void CGovernanceObject::LoadData()
     }
 }
 
-/**
-*   GetData - Example usage:
-*   --------------------------------------------------------
-*
-*   Decode governance object data into UniValue(VOBJ)
-*
-*/
-
-void CGovernanceObject::GetData(UniValue& objResult)
-{
-    UniValue o(UniValue::VOBJ);
-    std::string s = GetDataAsPlainString();
-    o.read(s);
-    objResult = o;
-}
-
 /**
 *   GetData - As
 *   --------------------------------------------------------
@@ -508,7 +524,7 @@ bool CGovernanceObject::IsValidLocally(std::string& strError, bool& fMissingMast
 
     switch (nObjectType) {
     case GOVERNANCE_OBJECT_PROPOSAL: {
-        CProposalValidator validator(GetDataAsHexString(), true);
+        CProposalValidator validator(*GetPayload(), true);
         // Note: It's ok to have expired proposals
         // they are going to be cleared by CGovernanceManager::UpdateCachesAndClean()
         // TODO: should they be tagged as "expired" to skip vote downloading?
@@ -523,7 +539,7 @@ bool CGovernanceObject::IsValidLocally(std::string& strError, bool& fMissingMast
         return true;
     }
     case GOVERNANCE_OBJECT_RECORD: {
-        CProposalValidator validator(GetDataAsHexString(), true);
+        CProposalValidator validator(*GetPayload(), true);
         // Note: It's ok to have expired records
         // they are going to be cleared by CGovernanceManager::UpdateCachesAndClean()
         // TODO: should they be tagged as "expired" to skip vote downloading?
@@ -583,7 +599,7 @@ CAmount CGovernanceObject::GetMinCollateralFee() const
     }
 }
 
-bool CGovernanceObject::IsCollateralValid(std::string& strError, bool& fMissingConfirmations) const
+bool CGovernanceObject::IsCollateralValid(std::string& strError, bool& fMissingConfirmations, int* pnConfirmationsRet) const
 {
     strError = "";
     fMissingConfirmations = false;
@@ -595,7 +611,7 @@ bool CGovernanceObject::IsCollateralValid(std::string& strError, bool& fMissingC
 
     // RETRIEVE TRANSACTION IN QUESTION
 
-    if (!GetTransaction(nCollateralHash, txCollateral, Params().GetConsensus(), nBlockHash, true)) {
+    if (!GetGovernanceCollateral(nCollateralHash, txCollateral, nBlockHash)) {
         strError = strprintf("Can't find collateral tx %s", nCollateralHash.ToString());
         LogPrintf("CGovernanceObject::IsCollateralValid -- %s\n", strError);
         return false;
@@ -655,6 +671,9 @@ bool CGovernanceObject::IsCollateralValid(std::string& strError, bool& fMissingC
             }
         }
     }
+    if (pnConfirmationsRet) {
+        *pnConfirmationsRet = nConfirmationsIn;
+    }
 
     if ((nConfirmationsIn < GOVERNANCE_FEE_CONFIRMATIONS)) {
         strError = strprintf("Collateral requires at least %d confirmations to be relayed throughout the network (it has only %d)", GOVERNANCE_FEE_CONFIRMATIONS, nConfirmationsIn);
@@ -677,15 +696,44 @@ int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote
 {
     LOCK(cs);
 
-    int nCount = 0;
+    if (eVoteSignalIn < 0 || eVoteSignalIn > MAX_SUPPORTED_VOTE_SIGNAL || eVoteOutcomeIn < 0 || eVoteOutcomeIn > VOTE_OUTCOME_ABSTAIN) {
+        return 0;
+    }
+    return nVoteTally[eVoteSignalIn][eVoteOutcomeIn];
+}
+
+uint64_t CGovernanceObject::GetVoteTallyVersion() const
+{
+    LOCK(cs);
+    return nVoteTallyVersion;
+}
+
+void CGovernanceObject::UpdateVoteTally(int nSignal, vote_outcome_enum_t eOutcome, int nDelta)
+{
+    // VOTE_OUTCOME_NONE is what an instance holds before its first accepted vote
+    if (nSignal <= VOTE_SIGNAL_NONE || nSignal > MAX_SUPPORTED_VOTE_SIGNAL || eOutcome <= VOTE_OUTCOME_NONE || eOutcome > VOTE_OUTCOME_ABSTAIN) {
+        return;
+    }
+    nVoteTally[nSignal][eOutcome] += nDelta;
+    nVoteTallyVersion = ++nLastVoteTallyVersion;
+}
+
+void CGovernanceObject::UpdateVoteTally(const vote_rec_t& voteRecord, int nDelta)
+{
+    for (const auto& instancePair : voteRecord.mapInstances) {
+        UpdateVoteTally(instancePair.first, instancePair.second.eOutcome, nDelta);
+    }
+}
+
+void CGovernanceObject::RebuildVoteTally()
+{
+    for (auto& tally : nVoteTally) {
+        tally.fill(0);
+    }
     for (const auto& votepair : mapCurrentMNVotes) {
-        const vote_rec_t& recVote = votepair.second;
-        vote_instance_m_cit it2 = recVote.mapInstances.find(eVoteSignalIn);
-        if (it2 != recVote.mapInstances.end() && it2->second.eOutcome == eVoteOutcomeIn) {
-            ++nCount;
-        }
+        UpdateVoteTally(votepair.second, 1);
     }
-    return nCount;
+    nVoteTallyVersion = ++nLastVoteTallyVersion;
 }
 
 /**
@@ -717,6 +765,89 @@ int CGovernanceObject::GetAbstainCount(vote_signal_enum_t eVoteSignalIn) const
     return CountMatchingVotes(eVoteSignalIn, VOTE_OUTCOME_ABSTAIN);
 }
 
+bool CGovernanceObject::HasVote(const uint256& nHash) const
+{
+    LOCK(cs);
+    LoadPagedVotes();
+    return fileVotes.HasVote(nHash);
+}
+
+bool CGovernanceObject::SerializeVoteToStream(const uint256& nHash, CVectorWriter& ss) const
+{
+    LOCK(cs);
+    LoadPagedVotes();
+    return fileVotes.SerializeVoteToStream(nHash, ss);
+}
+
+CGovernanceVoteDigest CGovernanceObject::GetVoteDigest() const
+{
+    LOCK(cs);
+    // sent for every object on each sync, don't page in for that
+    if (fVotesPagedOut) {
+        return pagedVoteDigest;
+    }
+    return fileVotes.GetVoteDigest();
+}
+
+const CGovernanceObjectVoteFile& CGovernanceObject::GetVoteFile() const
+{
+    LOCK(cs);
+    LoadPagedVotes();
+    return fileVotes;
+}
+
+bool CGovernanceObject::IsVoteFilePagedOut() const
+{
+    LOCK(cs);
+    return fVotesPagedOut;
+}
+
+std::vector<uint256> CGovernanceObject::GetVoteHashes() const
+{
+    LOCK(cs);
+    if (!fVotesPagedOut) {
+        return fileVotes.GetVoteHashes();
+    }
+    if (vecPagedVoteHashes.size() == pagedVoteDigest.nCount) {
+        return vecPagedVoteHashes;
+    }
+    // read the vote file without keeping it in memory
+    CGovernanceObjectVoteFile fileVotesTmp;
+    std::shared_ptr<CGovernanceDB> db = pagedVotesDB.lock();
+    if (!db || !db->ReadVoteFile(GetHash(), fileVotesTmp)) {
+        LogPrintf("CGovernanceObject::%s -- failed to read the votes of %s\n", __func__, GetHash().ToString());
+    }
+    return fileVotesTmp.GetVoteHashes();
+}
+
+void CGovernanceObject::PageOutVotes(const std::shared_ptr<CGovernanceDB>& db)
+{
+    LOCK(cs);
+    // objects read from a governance snapshot are paged out already, but don't know their db yet
+    pagedVotesDB = db;
+    if (fVotesPagedOut) {
+        return;
+    }
+    pagedVoteDigest = fileVotes.GetVoteDigest();
+    fileVotes = CGovernanceObjectVoteFile();
+    fVotesPagedOut = true;
+}
+
+void CGovernanceObject::LoadPagedVotes() const
+{
+    AssertLockHeld(cs);
+    if (!fVotesPagedOut) {
+        return;
+    }
+    fVotesPagedOut = false;
+    vecPagedVoteHashes.clear();
+    std::shared_ptr<CGovernanceDB> db = pagedVotesDB.lock();
+    pagedVotesDB.reset();
+    if (!db || !db->ReadVoteFile(GetHash(), fileVotes)) {
+        LogPrintf("CGovernanceObject::%s -- failed to read the votes of %s\n", __func__, GetHash().ToString());
+    }
+}
+
 bool CGovernanceObject::GetCurrentMNVotes(const COutPoint& mnCollateralOutpoint, vote_rec_t& voteRecord) const
 {
     LOCK(cs);
@@ -861,7 +992,7 @@ int CGovernanceObject::GetCollateralBlockHeight()
     
     CTransactionRef txCollateral;
     uint256 nBlockHash;
-    GetTransaction(nCollateralHash, txCollateral, Params().GetConsensus(), nBlockHash, true);
+    GetGovernanceCollateral(nCollateralHash, txCollateral, nBlockHash);
     
     if (!nBlockHash.IsNull()) {
         BlockMap::iterator mi = mapBlockIndex.find(nBlockHash);
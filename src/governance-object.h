@@ -7,9 +7,11 @@
 
 #include "cachemultimap.h"
 #include "governance-exceptions.h"
+#include "governance-payload.h"
 #include "governance-vote.h"
 #include "governance-votedb.h"
 #include "key.h"
+#include "lzcompress.h"
 #include "net.h"
 #include "sync.h"
 #include "util.h"
@@ -18,6 +20,9 @@
 
 #include <univalue.h>
 
+#include <array>
+#include <memory>
+
 class CGovernanceManager;
 class CGovernanceTriggerManager;
 class CGovernanceObject;
@@ -25,7 +30,10 @@ class CGovernanceVote;
 
 static const int MIN_GOVERNANCE_PEER_PROTO_VERSION = 70213;
 static const int GOVERNANCE_FILTER_PROTO_VERSION = 70206;
+static const int GOVERNANCE_VOTE_DIGEST_PROTO_VERSION = 70216;
 static const int GOVERNANCE_POSE_BANNED_VOTES_VERSION = 70215;
+// peers from this version on get objects with their data compressed (govobjz)
+static const int GOVERNANCE_COMPRESSION_PROTO_VERSION = 70217;
 
 static const double GOVERNANCE_FILTER_FP_RATE = 0.001;
 
@@ -107,6 +115,8 @@ struct vote_rec_t {
 *
 */
 
+class CGovernanceDB;
+
 class CGovernanceObject
 {
     friend class CGovernanceManager;
@@ -122,6 +132,8 @@ public: // Types
 
     typedef CacheMultiMap<COutPoint, vote_time_pair_t> vote_cmm_t;
 
+    typedef std::array<std::array<int, VOTE_OUTCOME_ABSTAIN + 1>, MAX_SUPPORTED_VOTE_SIGNAL + 1> vote_tally_t;
+
 private:
     /// critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -153,6 +165,9 @@ private:
     /// Data field - can be used for anything
     std::vector<unsigned char> vchData;
 
+    /// Memory only, vchData parsed on first use
+    mutable CGovernanceObjectPayloadPtr pPayload;
+
     /// Masternode info for signed objects
     COutPoint masternodeOutpoint;
     std::vector<unsigned char> vchSig;
@@ -196,7 +211,21 @@ private:
     /// Limited map of votes orphaned by MN
     vote_cmm_t cmmapOrphanVotes;
 
-    CGovernanceObjectVoteFile fileVotes;
+    /// Empty while paged out, protected by cs
+    mutable CGovernanceObjectVoteFile fileVotes;
+
+    /// Memory only, set while fileVotes is paged out to the governance database and loaded on first use
+    mutable bool fVotesPagedOut;
+    mutable std::weak_ptr<CGovernanceDB> pagedVotesDB;
+    /// Memory only, digest of the paged out vote file
+    CGovernanceVoteDigest pagedVoteDigest;
+    /// Memory only, vote hashes of a vote file paged out since it was read from a governance snapshot
+    mutable std::vector<uint256> vecPagedVoteHashes;
+
+    /// Memory only, number of current masternode votes per signal and outcome, follows mapCurrentMNVotes
+    vote_tally_t nVoteTally;
+    /// Memory only, changes whenever nVoteTally changes, unique across all objects
+    uint64_t nVoteTallyVersion;
 
 public:
     CGovernanceObject();
@@ -276,10 +305,16 @@ public:
         return fExpired;
     }
 
-    const CGovernanceObjectVoteFile& GetVoteFile() const
-    {
-        return fileVotes;
-    }
+    /// Loads the vote file if it was paged out
+    const CGovernanceObjectVoteFile& GetVoteFile() const;
+
+    bool IsVoteFilePagedOut() const;
+
+    // Vote file accessors which only need this object's cs, not the governance manager's
+    bool HasVote(const uint256& nHash) const;
+    bool SerializeVoteToStream(const uint256& nHash, CVectorWriter& ss) const;
+    CGovernanceVoteDigest GetVoteDigest() const;
+    std::vector<uint256> GetVoteHashes() const;
 
     // Signature related functions
 
@@ -296,8 +331,8 @@ public:
 
     bool IsValidLocally(std::string& strError, bool& fMissingMasternode, bool& fMissingConfirmations, bool fCheckCollateral) const;
 
-    /// Check the collateral transaction for the budget proposal/finalized budget
-    bool IsCollateralValid(std::string& strError, bool& fMissingConfirmations) const;
+    /// Check the collateral transaction for the budget proposal/finalized budget, optionally returns its confirmations
+    bool IsCollateralValid(std::string& strError, bool& fMissingConfirmations, int* pnConfirmationsRet = nullptr) const;
 
     void UpdateLocalValidity();
 
@@ -307,6 +342,9 @@ public:
 
     UniValue GetJSONObject();
 
+    /// Parsed vchData, shared by all copies of this object
+    CGovernanceObjectPayloadPtr GetPayload() const;
+
     void Relay(CConnman& connman);
 
     uint256 GetHash() const;
@@ -318,6 +356,8 @@ public:
     // GET VOTE COUNT FOR SIGNAL
 
     int CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const;
+    /// Results derived from the vote counts can be reused as long as this doesn't change
+    uint64_t GetVoteTallyVersion() const;
 
     int GetAbsoluteYesCount(vote_signal_enum_t eVoteSignalIn) const;
     int GetAbsoluteNoCount(vote_signal_enum_t eVoteSignalIn) const;
@@ -338,14 +378,22 @@ public:
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action)
+    inline void SerializationOp(Stream& s, Operation ser_action, bool fCompressData = false, bool fVoteFile = true)
     {
         // SERIALIZE DATA FOR SAVING/LOADING OR NETWORK FUNCTIONS
         READWRITE(nHashParent);
         READWRITE(nRevision);
         READWRITE(nTime);
         READWRITE(nCollateralHash);
-        READWRITE(vchData);
+        if (fCompressData) {
+            // nothing larger could have been relayed uncompressed
+            READWRITE(REF(CLZCompressedBytes(vchData, MAX_PROTOCOL_MESSAGE_LENGTH)));
+        } else {
+            READWRITE(vchData);
+        }
+        if (ser_action.ForRead()) {
+            pPayload.reset();
+        }
         READWRITE(nObjectType);
         READWRITE(masternodeOutpoint);
         if (!(s.GetType() & SER_GETHASH)) {
@@ -357,8 +405,34 @@ public:
             READWRITE(nDeletionTime);
             READWRITE(fExpired);
             READWRITE(mapCurrentMNVotes);
-            READWRITE(fileVotes);
-            LogPrint("gobject", "CGovernanceObject::SerializationOp hash = %s, vote count = %d\n", GetHash().ToString(), fileVotes.GetVoteCount());
+            if (ser_action.ForRead()) {
+                RebuildVoteTally();
+            }
+            if (fVoteFile) {
+                if (!ser_action.ForRead()) {
+                    LOCK(cs);
+                    LoadPagedVotes();
+                }
+                READWRITE(fileVotes);
+                LogPrint("gobject", "CGovernanceObject::SerializationOp hash = %s, vote count = %d\n", GetHash().ToString(), fileVotes.GetVoteCount());
+            } else {
+                // without the vote file, which stays paged out until it's loaded from the governance db
+                CGovernanceVoteDigest digest;
+                std::vector<uint256> vecVoteHashes;
+                if (!ser_action.ForRead()) {
+                    digest = GetVoteDigest();
+                    vecVoteHashes = GetVoteHashes();
+                }
+                READWRITE(digest);
+                READWRITE(vecVoteHashes);
+                if (ser_action.ForRead()) {
+                    LOCK(cs);
+                    fileVotes = CGovernanceObjectVoteFile();
+                    pagedVoteDigest = digest;
+                    vecPagedVoteHashes = std::move(vecVoteHashes);
+                    fVotesPagedOut = true;
+                }
+            }
         }
 
         // AFTER DESERIALIZATION OCCURS, CACHED VARIABLES MUST BE CALCULATED MANUALLY
@@ -367,12 +441,29 @@ public:
 private:
     // FUNCTIONS FOR DEALING WITH DATA STRING
     void LoadData();
+
+    /**
+     * Drops the vote file from memory, it's read from db again when needed. Only for objects which
+     * are stored in db unchanged.
+     */
+    void PageOutVotes(const std::shared_ptr<CGovernanceDB>& db);
+    /// Brings back a paged out vote file, cs must be held
+    void LoadPagedVotes() const;
+
+    // FUNCTIONS FOR KEEPING nVoteTally IN SYNC WITH mapCurrentMNVotes
+    void UpdateVoteTally(int nSignal, vote_outcome_enum_t eOutcome, int nDelta);
+    void UpdateVoteTally(const vote_rec_t& voteRecord, int nDelta);
+    void RebuildVoteTally();
     void GetData(UniValue& objResult);
 
     bool ProcessVote(CNode* pfrom,
         const CGovernanceVote& vote,
         CGovernanceException& exception,
-        CConnman& connman);
+        CConnman& connman,
+        bool fSignatureChecked = false);
+
+    /// True if votes with this signal must be signed with the voting key instead of the operator key
+    bool IsVotingKeySignal(vote_signal_enum_t eSignal) const;
 
     /// Called when MN's which have voted on this object have been removed
     void ClearMasternodeVotes();
@@ -386,5 +477,32 @@ private:
     void CheckOrphanVotes(CConnman& connman);
 };
 
+/**
+ * Serializes a governance object like CGovernanceObject does, but with its data LZ compressed.
+ * Used on disk and for peers from GOVERNANCE_COMPRESSION_PROTO_VERSION on, the hashes are
+ * always computed over the plain serialization. Governance snapshots leave out the vote file
+ * (fVoteFile = false), objects read that way have it paged out.
+ */
+class CGovernanceObjectCompressor
+{
+private:
+    CGovernanceObject& govobj;
+    bool fVoteFile;
+
+public:
+    explicit CGovernanceObjectCompressor(CGovernanceObject& govobjIn, bool fVoteFileIn = true) : govobj(govobjIn), fVoteFile(fVoteFileIn) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        govobj.SerializationOp(s, CSerActionSerialize(), true, fVoteFile);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        govobj.SerializationOp(s, CSerActionUnserialize(), true, fVoteFile);
+    }
+};
 
 #endif
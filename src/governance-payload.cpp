@@ -0,0 +1,85 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-payload.h"
+#include "governance-object.h"
+#include "governance-validators.h"
+
+static std::string GetStr(const UniValue& obj, const std::string& strKey)
+{
+    const UniValue& value = find_value(obj, strKey);
+    return value.isStr() ? value.get_str() : std::string();
+}
+
+static int64_t GetInt64(const UniValue& obj, const std::string& strKey)
+{
+    const UniValue& value = find_value(obj, strKey);
+    return value.isNum() ? value.get_int64() : 0;
+}
+
+CGovernanceObjectPayload::CGovernanceObjectPayload(const std::vector<unsigned char>& vchData) :
+    nDataSize(vchData.size()),
+    fValid(false),
+    fLegacyFormat(false),
+    strError(),
+    obj(UniValue::VOBJ),
+    nObjectType(0),
+    nStartEpoch(0),
+    nEndEpoch(0),
+    dPaymentAmount(0)
+{
+    if (vchData.empty()) {
+        return;
+    }
+
+    try {
+        UniValue objData(UniValue::VOBJ);
+        objData.read(std::string(vchData.begin(), vchData.end()));
+
+        if (objData.isObject()) {
+            obj = objData;
+        } else {
+            std::vector<UniValue> arr1 = objData.getValues();
+            std::vector<UniValue> arr2 = arr1.at(0).getValues();
+            obj = arr2.at(1);
+            fLegacyFormat = true;
+        }
+        fValid = true;
+    } catch (const std::exception& e) {
+        strError = e.what();
+        obj = UniValue(UniValue::VOBJ);
+        return;
+    }
+
+    if (!obj.isObject()) {
+        return;
+    }
+
+    // out of range numbers are treated as missing
+    try {
+        const UniValue& type = find_value(obj, "type");
+        if (type.isNum()) {
+            nObjectType = type.get_int();
+        }
+        strName = GetStr(obj, "name");
+        strIPFSCID = GetStr(obj, "ipfscid");
+        nStartEpoch = GetInt64(obj, "start_epoch");
+        nEndEpoch = GetInt64(obj, "end_epoch");
+        const UniValue& amount = find_value(obj, "payment_amount");
+        if (amount.isNum()) {
+            dPaymentAmount = amount.get_real();
+        }
+
+        const UniValue& summary = find_value(obj, "summary");
+        if (summary.isObject()) {
+            strSummaryName = GetStr(summary, "name");
+            strSummaryDescription = GetStr(summary, "description");
+        }
+    } catch (const std::exception& e) {
+    }
+
+    if (nObjectType == GOVERNANCE_OBJECT_PROPOSAL || nObjectType == GOVERNANCE_OBJECT_RECORD) {
+        pDataChecks = CProposalValidator::CheckData(obj);
+    }
+}
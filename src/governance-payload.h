@@ -0,0 +1,53 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef GOVERNANCE_PAYLOAD_H
+#define GOVERNANCE_PAYLOAD_H
+
+#include <univalue.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+struct CProposalDataChecks;
+
+/**
+ * Parsed view of a governance object's data field, either a JSON object or
+ * the legacy [["type", {...}]] array form. Built once per object by
+ * CGovernanceObject::GetPayload() and never modified afterwards, so it can be
+ * shared between threads without locking.
+ */
+class CGovernanceObjectPayload
+{
+public:
+    /// Size of the raw data
+    size_t nDataSize;
+
+    /// The data could be parsed, obj holds the inner JSON object
+    bool fValid;
+    bool fLegacyFormat;
+    std::string strError;
+
+    UniValue obj;
+
+    // Commonly used fields, empty/zero when missing or of the wrong type
+    int nObjectType;
+    std::string strName;
+    std::string strSummaryName;
+    std::string strSummaryDescription;
+    std::string strIPFSCID;
+    int64_t nStartEpoch;
+    int64_t nEndEpoch;
+    double dPaymentAmount;
+
+    /// Data checks of CProposalValidator, only computed for proposals and records
+    std::shared_ptr<const CProposalDataChecks> pDataChecks;
+
+    explicit CGovernanceObjectPayload(const std::vector<unsigned char>& vchData);
+};
+
+typedef std::shared_ptr<const CGovernanceObjectPayload> CGovernanceObjectPayloadPtr;
+
+#endif
@@ -0,0 +1,138 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-search.h"
+
+#include <algorithm>
+#include <limits>
+
+std::vector<std::string> CGovernanceSearchIndex::Tokenize(const std::string& strText, size_t nMinLength)
+{
+    std::vector<std::string> vecTokens;
+    std::string strToken;
+    auto finishToken = [&]() {
+        if (strToken.size() >= nMinLength) {
+            vecTokens.push_back(strToken.substr(0, MAX_TOKEN_LENGTH));
+        }
+        strToken.clear();
+    };
+    for (char c : strText) {
+        unsigned char uc = (unsigned char)c;
+        if (uc >= 'A' && uc <= 'Z') {
+            strToken += (char)(uc - 'A' + 'a');
+        } else if ((uc >= 'a' && uc <= 'z') || (uc >= '0' && uc <= '9') || uc >= 0x80) {
+            strToken += c;
+        } else {
+            finishToken();
+        }
+    }
+    finishToken();
+    return vecTokens;
+}
+
+bool CGovernanceSearchIndex::HasTokenWithPrefix(const std::vector<std::string>& vecTokens, const std::string& strPrefix)
+{
+    auto it = std::lower_bound(vecTokens.begin(), vecTokens.end(), strPrefix);
+    return it != vecTokens.end() && it->compare(0, strPrefix.size(), strPrefix) == 0;
+}
+
+size_t CGovernanceSearchIndex::CountPostings(const std::string& strPrefix) const
+{
+    size_t nCount = 0;
+    for (auto it = mapTokens.lower_bound(strPrefix); it != mapTokens.end() && it->first.compare(0, strPrefix.size(), strPrefix) == 0; ++it) {
+        nCount += it->second.size();
+    }
+    return nCount;
+}
+
+void CGovernanceSearchIndex::Add(const uint256& nHash, int nObjectType, int64_t nCreationTime, const std::vector<std::string>& vecFields)
+{
+    Remove(nHash);
+
+    CEntry entry;
+    entry.nObjectType = nObjectType;
+    entry.nCreationTime = nCreationTime;
+    for (const auto& strField : vecFields) {
+        std::vector<std::string> vecFieldTokens = Tokenize(strField);
+        entry.vecTokens.insert(entry.vecTokens.end(), vecFieldTokens.begin(), vecFieldTokens.end());
+    }
+    std::sort(entry.vecTokens.begin(), entry.vecTokens.end());
+    entry.vecTokens.erase(std::unique(entry.vecTokens.begin(), entry.vecTokens.end()), entry.vecTokens.end());
+
+    for (const auto& strToken : entry.vecTokens) {
+        mapTokens[strToken].insert(nHash);
+    }
+    mapEntries.emplace(nHash, std::move(entry));
+}
+
+void CGovernanceSearchIndex::Remove(const uint256& nHash)
+{
+    auto it = mapEntries.find(nHash);
+    if (it == mapEntries.end()) {
+        return;
+    }
+    for (const auto& strToken : it->second.vecTokens) {
+        auto itToken = mapTokens.find(strToken);
+        if (itToken == mapTokens.end()) {
+            continue;
+        }
+        itToken->second.erase(nHash);
+        if (itToken->second.empty()) {
+            mapTokens.erase(itToken);
+        }
+    }
+    mapEntries.erase(it);
+}
+
+void CGovernanceSearchIndex::Clear()
+{
+    mapEntries.clear();
+    mapTokens.clear();
+}
+
+std::vector<CGovernanceSearchIndex::time_hash_t> CGovernanceSearchIndex::Search(const std::string& strQuery, int nObjectType) const
+{
+    std::vector<time_hash_t> vecResult;
+
+    std::vector<std::string> vecTerms = Tokenize(strQuery, 1);
+    if (vecTerms.empty()) {
+        return vecResult;
+    }
+
+    // collect the candidates from the term with the fewest postings and check the other terms against their tokens
+    size_t nBestTerm = 0;
+    size_t nBestCount = std::numeric_limits<size_t>::max();
+    for (size_t i = 0; i < vecTerms.size(); i++) {
+        size_t nCount = CountPostings(vecTerms[i]);
+        if (nCount < nBestCount) {
+            nBestTerm = i;
+            nBestCount = nCount;
+        }
+    }
+    if (nBestCount == 0) {
+        return vecResult;
+    }
+
+    const std::string& strBestTerm = vecTerms[nBestTerm];
+    std::set<uint256> setCandidates;
+    for (auto it = mapTokens.lower_bound(strBestTerm); it != mapTokens.end() && it->first.compare(0, strBestTerm.size(), strBestTerm) == 0; ++it) {
+        setCandidates.insert(it->second.begin(), it->second.end());
+    }
+
+    for (const auto& nHash : setCandidates) {
+        const CEntry& entry = mapEntries.at(nHash);
+        if (nObjectType != 0 && entry.nObjectType != nObjectType) {
+            continue;
+        }
+        bool fMatch = true;
+        for (size_t i = 0; i < vecTerms.size() && fMatch; i++) {
+            fMatch = i == nBestTerm || HasTokenWithPrefix(entry.vecTokens, vecTerms[i]);
+        }
+        if (fMatch) {
+            vecResult.emplace_back(entry.nCreationTime, nHash);
+        }
+    }
+    std::sort(vecResult.begin(), vecResult.end());
+    return vecResult;
+}
@@ -0,0 +1,67 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef GOVERNANCE_SEARCH_H
+#define GOVERNANCE_SEARCH_H
+
+#include "uint256.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+static const bool DEFAULT_GOVERNANCE_SEARCH_INDEX = false;
+
+/**
+ * Inverted index over the text fields of governance objects, maintained by
+ * CGovernanceManager when -govsearchindex is set.
+ *
+ * Fields are split into lower-cased tokens of ASCII letters, digits and any
+ * non-ASCII bytes. A query matches the objects which have, for every term of
+ * the query, a token starting with that term.
+ */
+class CGovernanceSearchIndex
+{
+public:
+    // shorter tokens are not indexed, they still match as prefixes of longer ones
+    static const size_t MIN_TOKEN_LENGTH = 2;
+    // longer tokens and query terms are cut to this length
+    static const size_t MAX_TOKEN_LENGTH = 32;
+
+    typedef std::pair<int64_t, uint256> time_hash_t;
+
+private:
+    struct CEntry {
+        int nObjectType;
+        int64_t nCreationTime;
+        // sorted and unique
+        std::vector<std::string> vecTokens;
+    };
+
+    std::map<uint256, CEntry> mapEntries;
+    // sorted, so all tokens with a given prefix are a range of the map
+    std::map<std::string, std::set<uint256> > mapTokens;
+
+    static bool HasTokenWithPrefix(const std::vector<std::string>& vecTokens, const std::string& strPrefix);
+    size_t CountPostings(const std::string& strPrefix) const;
+
+public:
+    static std::vector<std::string> Tokenize(const std::string& strText, size_t nMinLength = MIN_TOKEN_LENGTH);
+
+    // Index an object, replacing what was indexed for it before
+    void Add(const uint256& nHash, int nObjectType, int64_t nCreationTime, const std::vector<std::string>& vecFields);
+    void Remove(const uint256& nHash);
+    void Clear();
+
+    // Creation time and hash of the matching objects of the given type (any type for 0), sorted.
+    // A query without any terms matches nothing.
+    std::vector<time_hash_t> Search(const std::string& strQuery, int nObjectType) const;
+
+    size_t GetObjectCount() const { return mapEntries.size(); }
+    size_t GetTokenCount() const { return mapTokens.size(); }
+};
+
+#endif
@@ -0,0 +1,131 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-snapshot.h"
+
+#include "clientversion.h"
+#include "governance-object.h"
+#include "streams.h"
+
+static const std::string SNAPSHOT_MAGIC = "govsnapshot";
+static const int SNAPSHOT_FORMAT_VERSION = 1;
+// serialized size of an index entry
+static const size_t INDEX_ENTRY_SIZE = 32 + 8 + 4;
+
+boost::filesystem::path CGovernanceSnapshot::GetDefaultPath()
+{
+    return GetDataDir() / "govsnapshot.dat";
+}
+
+bool CGovernanceSnapshot::Write(const boost::filesystem::path& path, const uint256& nIdIn, const std::string& strVersion,
+                                const std::map<uint256, CGovernanceObject>& mapObjects)
+{
+    CDataStream ssHeader(SER_DISK, CLIENT_VERSION);
+    ssHeader << SNAPSHOT_MAGIC << SNAPSHOT_FORMAT_VERSION << strVersion << nIdIn << (uint64_t)mapObjects.size();
+
+    // records follow the index, mapObjects is already sorted by hash
+    uint64_t nOffset = ssHeader.size() + mapObjects.size() * INDEX_ENTRY_SIZE;
+    CDataStream ssIndex(SER_DISK, CLIENT_VERSION);
+    CDataStream ssRecords(SER_DISK, CLIENT_VERSION);
+    try {
+        for (const auto& objPair : mapObjects) {
+            size_t nStart = ssRecords.size();
+            ssRecords << CGovernanceObjectCompressor(REF(objPair.second), false);
+            uint32_t nSize = ssRecords.size() - nStart;
+            ssIndex << objPair.first << nOffset << nSize;
+            nOffset += nSize;
+        }
+    } catch (const std::exception& e) {
+        return error("%s: Serialize error - %s", __func__, e.what());
+    }
+
+    boost::filesystem::path pathTmp = path;
+    pathTmp += ".new";
+    FILE* file = fopen(pathTmp.string().c_str(), "wb");
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull()) {
+        return error("%s: Failed to open file %s", __func__, pathTmp.string());
+    }
+    try {
+        fileout << ssHeader << ssIndex << ssRecords;
+    } catch (const std::exception& e) {
+        return error("%s: I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout.Get());
+    fileout.fclose();
+
+    if (!RenameOver(pathTmp, path)) {
+        return error("%s: Rename-into-place failed", __func__);
+    }
+    return true;
+}
+
+bool CGovernanceSnapshot::Open(const boost::filesystem::path& path, const std::string& strVersion)
+{
+    file.reset(new CMappedFile(path));
+    if (file->IsNull()) {
+        file.reset();
+        return false;
+    }
+
+    try {
+        CSpanReader s(SER_DISK, CLIENT_VERSION, file->data(), file->size());
+        std::string strMagic;
+        int nFormatVersion;
+        std::string strFileVersion;
+        s >> strMagic >> nFormatVersion >> strFileVersion >> nId >> nObjects;
+        if (strMagic != SNAPSHOT_MAGIC || nFormatVersion != SNAPSHOT_FORMAT_VERSION || strFileVersion != strVersion) {
+            LogPrintf("CGovernanceSnapshot::%s -- %s is of another version\n", __func__, path.string());
+            file.reset();
+            return false;
+        }
+        nIndexOffset = file->size() - s.size();
+        if (nObjects > s.size() / INDEX_ENTRY_SIZE) {
+            throw std::ios_base::failure("index out of bounds");
+        }
+        uint64_t nRecordsOffset = nIndexOffset + nObjects * INDEX_ENTRY_SIZE;
+        for (uint64_t i = 0; i < nObjects; i++) {
+            uint256 nHash;
+            uint64_t nOffset;
+            uint32_t nSize;
+            s >> nHash >> nOffset >> nSize;
+            if (nOffset < nRecordsOffset || nOffset > file->size() || nSize > file->size() - nOffset) {
+                throw std::ios_base::failure("record out of bounds");
+            }
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("CGovernanceSnapshot::%s -- %s is invalid: %s\n", __func__, path.string(), e.what());
+        file.reset();
+        return false;
+    }
+    return true;
+}
+
+bool CGovernanceSnapshot::ReadObject(size_t i, CGovernanceObject& govobjRet) const
+{
+    if (!file || i >= nObjects) {
+        return false;
+    }
+    uint256 nHash;
+    try {
+        CSpanReader sIndex(SER_DISK, CLIENT_VERSION, file->data() + nIndexOffset + i * INDEX_ENTRY_SIZE, INDEX_ENTRY_SIZE);
+        uint64_t nOffset;
+        uint32_t nSize;
+        sIndex >> nHash >> nOffset >> nSize;
+
+        CSpanReader s(SER_DISK, CLIENT_VERSION, file->data() + nOffset, nSize);
+        s >> REF(CGovernanceObjectCompressor(govobjRet, false));
+        if (!s.empty()) {
+            throw std::ios_base::failure("data after the record");
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("CGovernanceSnapshot::%s -- failed to read object %d: %s\n", __func__, i, e.what());
+        return false;
+    }
+    if (govobjRet.GetHash() != nHash) {
+        LogPrintf("CGovernanceSnapshot::%s -- object %s doesn't match its record\n", __func__, nHash.ToString());
+        return false;
+    }
+    return true;
+}
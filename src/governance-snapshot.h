@@ -0,0 +1,65 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef GOVERNANCE_SNAPSHOT_H
+#define GOVERNANCE_SNAPSHOT_H
+
+#include "uint256.h"
+#include "util.h"
+
+#include <boost/filesystem/path.hpp>
+
+#include <map>
+#include <memory>
+#include <string>
+
+class CGovernanceObject;
+
+#ifdef WIN32
+// snapshots can't be memory mapped there
+static const bool DEFAULT_GOVERNANCE_SNAPSHOT = false;
+#else
+static const bool DEFAULT_GOVERNANCE_SNAPSHOT = true;
+#endif
+
+/**
+ * Read-only snapshot of the governance objects, written on shutdown and memory mapped on
+ * startup so the objects are deserialized in place instead of being read from the
+ * governance database one by one.
+ *
+ * Records don't include the vote files, only their digests and vote hashes. Objects read
+ * from a snapshot have their vote files paged out to the governance database, which loads
+ * them on first use. A snapshot is only used when its id matches the one the database
+ * stored with it, any later flush of the database drops that id.
+ *
+ * Format: magic, format version, governance serialization version, id, object count,
+ * an index of (hash, offset, size) entries sorted by hash and the records.
+ */
+class CGovernanceSnapshot
+{
+private:
+    std::unique_ptr<CMappedFile> file;
+    uint256 nId;
+    uint64_t nObjects;
+    size_t nIndexOffset;
+
+public:
+    CGovernanceSnapshot() : nObjects(0), nIndexOffset(0) {}
+
+    static boost::filesystem::path GetDefaultPath();
+
+    static bool Write(const boost::filesystem::path& path, const uint256& nIdIn, const std::string& strVersion,
+                      const std::map<uint256, CGovernanceObject>& mapObjects);
+
+    /// Map a snapshot and check its header and index, false if it's missing, invalid or of another version
+    bool Open(const boost::filesystem::path& path, const std::string& strVersion);
+
+    const uint256& GetId() const { return nId; }
+    size_t GetObjectCount() const { return nObjects; }
+
+    /// Deserialize the i-th object straight from the mapping, false if its record is invalid
+    bool ReadObject(size_t i, CGovernanceObject& govobjRet) const;
+};
+
+#endif
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "governance-validators.h"
+#include "governance-payload.h"
 
 #include "base58.h"
 #include "timedata.h"
@@ -13,6 +14,7 @@
 #include "masternode-meta.h"
 #include "ipfs-utils.h"
 #include <algorithm>
+#include <functional>
 
 const size_t MAX_DATA_SIZE = 768;
 const size_t MAX_NAME_SIZE = 40;
@@ -29,6 +31,33 @@ CProposalValidator::CProposalValidator(const std::string& strHexData, bool fAllo
     }
 }
 
+CProposalValidator::CProposalValidator(const CGovernanceObjectPayload& payload, bool fAllowLegacyFormat) :
+    objJSON(UniValue::VOBJ),
+    fJSONValid(false),
+    fAllowLegacyFormat(fAllowLegacyFormat),
+    strErrorMessages()
+{
+    // same checks as ParseStrHexData() and ParseJSONData()
+    if (payload.nDataSize == 0) {
+        return;
+    }
+    if (payload.nDataSize > MAX_DATA_SIZE) {
+        strErrorMessages = strprintf("data exceeds %lu characters;", MAX_DATA_SIZE);
+        return;
+    }
+    if (!payload.fValid) {
+        strErrorMessages += payload.strError + std::string(";");
+        return;
+    }
+    if (payload.fLegacyFormat && !fAllowLegacyFormat) {
+        strErrorMessages += "Legacy proposal serialization format not allowed;";
+        return;
+    }
+    objJSON = payload.obj;
+    fJSONValid = true;
+    pDataChecks = payload.pDataChecks;
+}
+
 void CProposalValidator::ParseStrHexData(const std::string& strHexData)
 {
     std::vector<unsigned char> v = ParseHex(strHexData);
@@ -41,74 +70,84 @@ void CProposalValidator::ParseStrHexData(const std::string& strHexData)
 
 bool CProposalValidator::Validate(bool fCheckExpiration)
 {
-    if (!fJSONValid) {
-        strErrorMessages += "JSON parsing error;";
-        return false;
-    }
-    if (!ValidateName()) {
-        strErrorMessages += "Invalid name;";
-        return false;
-    }
-    if (!ValidateStartEndEpoch(fCheckExpiration)) {
-        strErrorMessages += "Invalid start:end range;";
-        return false;
-    }
-    if (!ValidatePaymentAmount()) {
-        strErrorMessages += "Invalid payment amount;";
-        return false;
-    }
-    if (!ValidatePaymentAddress()) {
-        strErrorMessages += "Invalid payment address;";
-        return false;
-    }
-    if (!ValidateIpfsCID()) {
-	    strErrorMessages += "Invalid IPFS CID;";
-	    return false;
-    }
-    if (!ValidateIpfsPID()) {
-        strErrorMessages += "Invalid IPFS PID;";
+    return Validate(fCheckExpiration, false);
+}
+
+bool CProposalValidator::ValidateRecord(bool fCheckExpiration)
+{
+    return Validate(fCheckExpiration, true);
+}
+
+std::shared_ptr<const CProposalDataChecks> CProposalValidator::CheckData(const UniValue& obj)
+{
+    CProposalValidator validator;
+    validator.objJSON = obj;
+    validator.fJSONValid = true;
+
+    auto checks = std::make_shared<CProposalDataChecks>();
+    auto run = [&](CProposalDataChecks::Result& result, const std::function<bool()>& check) {
+        validator.strErrorMessages.clear();
+        result.fValid = check();
+        result.strErrors = std::move(validator.strErrorMessages);
+    };
+    run(checks->name, [&]() { return validator.ValidateName(); });
+    run(checks->epochRange, [&]() { return validator.ValidateEpochRange(checks->nEndEpoch); });
+    run(checks->paymentAmount, [&]() { return validator.ValidatePaymentAmount(); });
+    run(checks->paymentAddress, [&]() { return validator.ValidatePaymentAddress(); });
+    run(checks->ipfsCID, [&]() { return validator.ValidateIpfsCID(); });
+    run(checks->ipfsPID, [&]() { return validator.ValidateIpfsPID(); });
+    run(checks->summary, [&]() { return validator.ValidateSummary(); });
+    return checks;
+}
+
+bool CProposalValidator::CheckResult(const CProposalDataChecks::Result& result, const char* strFailure)
+{
+    strErrorMessages += result.strErrors;
+    if (!result.fValid) {
+        strErrorMessages += strFailure;
         return false;
     }
-    if (!ValidateSummary()) {
-	    strErrorMessages += "Invalid format of Summary;";
-	    return false;
-    }
-    
     return true;
 }
 
-bool CProposalValidator::ValidateRecord(bool fCheckExpiration)
+bool CProposalValidator::Validate(bool fCheckExpiration, bool fRecord)
 {
     if (!fJSONValid) {
         strErrorMessages += "JSON parsing error;";
         return false;
     }
-    if (!ValidateName()) {
-        strErrorMessages += "Invalid name;";
+    if (!pDataChecks) {
+        pDataChecks = CheckData(objJSON);
+    }
+    const CProposalDataChecks& checks = *pDataChecks;
+
+    if (!CheckResult(checks.name, "Invalid name;")) {
+        return false;
+    }
+    if (!CheckResult(checks.epochRange, "Invalid start:end range;")) {
+        return false;
+    }
+    if (fCheckExpiration && checks.nEndEpoch <= GetAdjustedTime()) {
+        strErrorMessages += "expired;Invalid start:end range;";
         return false;
     }
-    if (!ValidateStartEndEpochRecord(fCheckExpiration)) {
-        strErrorMessages += "Invalid start:end range;";
+    if (fRecord && checks.nEndEpoch >= GetAdjustedTime() + 5184000) {
+        strErrorMessages += "end_epoch greater than 60 days in the future;Invalid start:end range;";
         return false;
     }
-    if (!ValidatePaymentAmount()) {
-        strErrorMessages += "Invalid payment amount;";
+    if (!CheckResult(checks.paymentAmount, "Invalid payment amount;")) {
         return false;
     }
-    if (!ValidatePaymentAddress()) {
-        strErrorMessages += "Invalid payment address;";
+    if (!CheckResult(checks.paymentAddress, "Invalid payment address;")) {
         return false;
     }
-    if (!ValidateIpfsCID()) {
-        strErrorMessages += "Invalid IPFS CID;";
+    if (!CheckResult(checks.ipfsCID, "Invalid IPFS CID;")) {
         return false;
     }
-    if (!ValidateIpfsPID()) {
-        strErrorMessages += "Invalid IPFS PID;";
+    if (!CheckResult(checks.ipfsPID, "Invalid IPFS PID;")) {
         return false;
     }
-    if (!ValidateSummary()) {
-        strErrorMessages += "Invalid format of Summary;";
+    if (!CheckResult(checks.summary, "Invalid format of Summary;")) {
         return false;
     }
 
@@ -140,7 +179,7 @@ bool CProposalValidator::ValidateName()
     return true;
 }
 
-bool CProposalValidator::ValidateStartEndEpoch(bool fCheckExpiration)
+bool CProposalValidator::ValidateEpochRange(int64_t& nEndEpochRet)
 {
     int64_t nStartEpoch = 0;
     int64_t nEndEpoch = 0;
@@ -160,44 +199,7 @@ bool CProposalValidator::ValidateStartEndEpoch(bool fCheckExpiration)
         return false;
     }
 
-    if (fCheckExpiration && nEndEpoch <= GetAdjustedTime()) {
-        strErrorMessages += "expired;";
-        return false;
-    }
-
-    return true;
-}
-
-bool CProposalValidator::ValidateStartEndEpochRecord(bool fCheckExpiration)
-{
-    int64_t nStartEpoch = 0;
-    int64_t nEndEpoch = 0;
-
-    if (!GetDataValue("start_epoch", nStartEpoch)) {
-        strErrorMessages += "start_epoch field not found;";
-        return false;
-    }
-
-    if (!GetDataValue("end_epoch", nEndEpoch)) {
-        strErrorMessages += "end_epoch field not found;";
-        return false;
-    }
-
-    if (nEndEpoch <= nStartEpoch) {
-        strErrorMessages += "end_epoch <= start_epoch;";
-        return false;
-    }
-
-    if (fCheckExpiration && nEndEpoch <= GetAdjustedTime()) {
-        strErrorMessages += "expired;";
-        return false;
-    }
-
-    if (nEndEpoch >= GetAdjustedTime() + 5184000) {
-        strErrorMessages += "end_epoch greater than 60 days in the future;";
-        return false;
-    }
-
+    nEndEpochRet = nEndEpoch;
     return true;
 }
 
@@ -5,9 +5,37 @@
 #ifndef GOVERNANCE_VALIDATORS_H
 #define GOVERNANCE_VALIDATORS_H
 
+#include <memory>
 #include <string>
 #include <univalue.h>
 
+class CGovernanceObjectPayload;
+
+/**
+ * Outcome of the checks of a proposal or record which only depend on its data, together with the error messages
+ * each of them produced. Computed once per payload, so validating the same object again only has to repeat the
+ * time dependent epoch checks.
+ */
+struct CProposalDataChecks
+{
+    struct Result
+    {
+        bool fValid{false};
+        std::string strErrors;
+    };
+
+    Result name;
+    // start_epoch and end_epoch exist and are ordered
+    Result epochRange;
+    Result paymentAmount;
+    Result paymentAddress;
+    Result ipfsCID;
+    Result ipfsPID;
+    Result summary;
+
+    int64_t nEndEpoch{0};
+};
+
 class CProposalValidator
 {
 private:
@@ -15,19 +43,29 @@ private:
     bool fJSONValid;
     bool fAllowLegacyFormat;
     std::string strErrorMessages;
+    std::shared_ptr<const CProposalDataChecks> pDataChecks;
 
 public:
     CProposalValidator(const std::string& strDataHexIn = std::string(), bool fAllowLegacyFormat = true);
+    /// Use data which was already parsed instead of decoding it again
+    CProposalValidator(const CGovernanceObjectPayload& payload, bool fAllowLegacyFormat = true);
 
     bool Validate(bool fCheckExpiration = true);
     bool ValidateRecord(bool fCheckExpiration = true);
     bool IsIpfsCIDDuplicate();
+
+    /// Run the checks which don't depend on the time on an already parsed object
+    static std::shared_ptr<const CProposalDataChecks> CheckData(const UniValue& obj);
+
     const std::string& GetErrorMessages()
     {
         return strErrorMessages;
     }
 
 private:
+    bool Validate(bool fCheckExpiration, bool fRecord);
+    bool CheckResult(const CProposalDataChecks::Result& result, const char* strFailure);
+
     void ParseStrHexData(const std::string& strHexData);
     void ParseJSONData(const std::string& strJSONData);
 
@@ -36,8 +74,7 @@ private:
     bool GetDataValue(const std::string& strKey, double& dValueRet);
 
     bool ValidateName();
-    bool ValidateStartEndEpoch(bool fCheckExpiration = true);
-    bool ValidateStartEndEpochRecord(bool fCheckExpiration = true);
+    bool ValidateEpochRange(int64_t& nEndEpochRet);
     bool ValidatePaymentAmount();
     bool ValidatePaymentAddress();
     bool ValidateURL();
@@ -139,6 +139,34 @@ void CGovernanceVote::Relay(CConnman& connman) const
     connman.RelayInv(inv, minVersion);
 }
 
+void CGovernanceVote::Relay(const std::vector<CGovernanceVote>& votes, CConnman& connman)
+{
+    // Do not relay until fully synced
+    if (!masternodeSync.IsSynced()) {
+        LogPrint("gobject", "CGovernanceVote::Relay -- won't relay until fully synced\n");
+        return;
+    }
+
+    auto mnList = deterministicMNManager->GetListAtChainTip();
+
+    // votes of non-valid (PoSe banned) MNs are only announced to v0.14.0.1 nodes, see above
+    std::vector<CInv> vInvValid, vInvBanned;
+    for (const auto& vote : votes) {
+        auto dmn = mnList.GetMNByCollateral(vote.masternodeOutpoint);
+        if (!dmn) {
+            continue;
+        }
+        CInv inv(MSG_GOVERNANCE_OBJECT_VOTE, vote.GetHash());
+        if (mnList.IsMNValid(dmn)) {
+            vInvValid.emplace_back(inv);
+        } else {
+            vInvBanned.emplace_back(inv);
+        }
+    }
+    connman.RelayInvs(vInvValid, MIN_GOVERNANCE_PEER_PROTO_VERSION);
+    connman.RelayInvs(vInvBanned, GOVERNANCE_POSE_BANNED_VOTES_VERSION);
+}
+
 void CGovernanceVote::UpdateHash() const
 {
     // Note: doesn't match serialization
@@ -254,7 +282,7 @@ bool CGovernanceVote::CheckSignature(const CBLSPublicKey& pubKey) const
     return true;
 }
 
-bool CGovernanceVote::IsValid(bool useVotingKey) const
+bool CGovernanceVote::IsValid(bool useVotingKey, bool fCheckSignature) const
 {
     if (nTime > GetAdjustedTime() + (60 * 60)) {
         LogPrint("gobject", "CGovernanceVote::IsValid -- vote is too far ahead of current time - %s - nTime %lli - Max Time %lli\n", GetHash().ToString(), nTime, GetAdjustedTime() + (60 * 60));
@@ -279,6 +307,10 @@ bool CGovernanceVote::IsValid(bool useVotingKey) const
         return false;
     }
 
+    if (!fCheckSignature) {
+        return true;
+    }
+
     if (useVotingKey) {
         return CheckSignature(dmn->pdmnState->keyIDVoting);
     } else {
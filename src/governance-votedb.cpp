@@ -3,126 +3,335 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "governance-votedb.h"
+#include "version.h"
 
-CGovernanceObjectVoteFile::CGovernanceObjectVoteFile() :
-    nMemoryVotes(0),
-    listVotes(),
-    mapVoteIndex()
+static const size_t MIN_INDEX_SIZE = 16;
+
+static uint64_t GetOutpointHash(const COutPoint& outpoint)
 {
+    return outpoint.hash.GetCheapHash() ^ (outpoint.n * 0x9E3779B97F4A7C15ULL);
+}
+
+// Put nPos in the first free slot starting at the key's home slot
+static void InsertIntoIndex(std::vector<uint32_t>& vecIndex, uint64_t nKeyHash, uint32_t nPos)
+{
+    size_t nMask = vecIndex.size() - 1;
+    size_t i = nKeyHash & nMask;
+    while (vecIndex[i] != 0) {
+        i = (i + 1) & nMask;
+    }
+    vecIndex[i] = nPos + 1;
 }
 
-CGovernanceObjectVoteFile::CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other) :
-    nMemoryVotes(other.nMemoryVotes),
-    listVotes(other.listVotes),
-    mapVoteIndex()
+// Power of two with a load factor of at most 1/2
+static size_t GetIndexSize(size_t nEntries)
+{
+    size_t nSize = MIN_INDEX_SIZE;
+    while (nSize < nEntries * 2) {
+        nSize *= 2;
+    }
+    return nSize;
+}
+
+CGovernanceObjectVoteFile::CGovernanceObjectVoteFile() :
+    nMemoryVotes(0),
+    nParentHash(),
+    vecVotes(),
+    vecOutpoints(),
+    vchSigArena(),
+    nSigArenaWaste(0),
+    vecVoteIndex(),
+    vecOutpointIndex(),
+    nVoteHashXor()
 {
-    RebuildIndex();
 }
 
 void CGovernanceObjectVoteFile::AddVote(const CGovernanceVote& vote)
 {
-    uint256 nHash = vote.GetHash();
+    bool fNewOutpoint = false;
     // make sure to never add/update already known votes
-    if (HasVote(nHash))
+    if (!InsertVote(vote, &fNewOutpoint))
         return;
-    listVotes.push_front(vote);
-    mapVoteIndex.emplace(nHash, listVotes.begin());
     ++nMemoryVotes;
-    RemoveOldVotes(vote);
+    // nothing to replace for a masternode we had no votes from
+    if (!fNewOutpoint) {
+        vote_rec_t rec = vecVotes.back();
+        RemoveOldVotes(rec);
+    }
 }
 
 bool CGovernanceObjectVoteFile::HasVote(const uint256& nHash) const
 {
-    return mapVoteIndex.find(nHash) != mapVoteIndex.end();
+    return FindVote(nHash) != -1;
 }
 
-bool CGovernanceObjectVoteFile::SerializeVoteToStream(const uint256& nHash, CDataStream& ss) const
+bool CGovernanceObjectVoteFile::SerializeVoteToStream(const uint256& nHash, CVectorWriter& ss) const
 {
-    vote_m_cit it = mapVoteIndex.find(nHash);
-    if (it == mapVoteIndex.end()) {
+    int nPos = FindVote(nHash);
+    if (nPos == -1) {
         return false;
     }
-    ss << *(it->second);
+    SerializeVote(ss, vecVotes[nPos]);
     return true;
 }
 
 std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotes() const
 {
     std::vector<CGovernanceVote> vecResult;
-    for (vote_l_cit it = listVotes.begin(); it != listVotes.end(); ++it) {
-        vecResult.push_back(*it);
+    vecResult.reserve(vecVotes.size());
+    CDataStream ssTmp(SER_NETWORK, PROTOCOL_VERSION);
+    for (const auto& rec : vecVotes) {
+        vecResult.push_back(GetVote(rec, ssTmp));
+    }
+    return vecResult;
+}
+
+std::vector<uint256> CGovernanceObjectVoteFile::GetVoteHashes() const
+{
+    std::vector<uint256> vecResult;
+    vecResult.reserve(vecVotes.size());
+    for (const auto& rec : vecVotes) {
+        vecResult.push_back(rec.nHash);
     }
     return vecResult;
 }
 
+CGovernanceVoteDigest CGovernanceObjectVoteFile::GetVoteDigest() const
+{
+    CGovernanceVoteDigest digest;
+    digest.nCount = vecVotes.size();
+    digest.nHash = ArithToUint256(nVoteHashXor);
+    return digest;
+}
+
 void CGovernanceObjectVoteFile::RemoveVotesFromMasternode(const COutPoint& outpointMasternode)
 {
-    vote_l_it it = listVotes.begin();
-    while (it != listVotes.end()) {
-        if (it->GetMasternodeOutpoint() == outpointMasternode) {
-            --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
-            listVotes.erase(it++);
-        } else {
-            ++it;
-        }
+    int nOutpoint = FindOutpoint(outpointMasternode);
+    if (nOutpoint == -1) {
+        return;
+    }
+
+    std::vector<bool> vErase(vecVotes.size(), false);
+    for (size_t i = 0; i < vecVotes.size(); i++) {
+        vErase[i] = vecVotes[i].nOutpoint == (uint32_t)nOutpoint;
     }
+    EraseVotes(vErase);
 }
 
 std::set<uint256> CGovernanceObjectVoteFile::RemoveInvalidVotes(const COutPoint& outpointMasternode, bool fProposal)
 {
     std::set<uint256> removedVotes;
 
-    vote_l_it it = listVotes.begin();
-    while (it != listVotes.end()) {
-        if (it->GetMasternodeOutpoint() == outpointMasternode) {
-            bool useVotingKey = fProposal && (it->GetSignal() == VOTE_SIGNAL_FUNDING);
-            if (!it->IsValid(useVotingKey)) {
-                removedVotes.emplace(it->GetHash());
-                --nMemoryVotes;
-                mapVoteIndex.erase(it->GetHash());
-                listVotes.erase(it++);
-                continue;
-            }
+    int nOutpoint = FindOutpoint(outpointMasternode);
+    if (nOutpoint == -1) {
+        return removedVotes;
+    }
+
+    std::vector<bool> vErase(vecVotes.size(), false);
+    CDataStream ssTmp(SER_NETWORK, PROTOCOL_VERSION);
+    for (size_t i = 0; i < vecVotes.size(); i++) {
+        const vote_rec_t& rec = vecVotes[i];
+        if (rec.nOutpoint != (uint32_t)nOutpoint) {
+            continue;
         }
-        ++it;
+        bool useVotingKey = fProposal && (rec.nVoteSignal == VOTE_SIGNAL_FUNDING);
+        if (!GetVote(rec, ssTmp).IsValid(useVotingKey)) {
+            removedVotes.emplace(rec.nHash);
+            vErase[i] = true;
+        }
+    }
+    if (!removedVotes.empty()) {
+        EraseVotes(vErase);
     }
 
     return removedVotes;
 }
 
-void CGovernanceObjectVoteFile::RemoveOldVotes(const CGovernanceVote& vote)
+CGovernanceVote CGovernanceObjectVoteFile::GetVote(const vote_rec_t& rec, CDataStream& ssTmp) const
 {
-    vote_l_it it = listVotes.begin();
-    while (it != listVotes.end()) {
-        if (it->GetMasternodeOutpoint() == vote.GetMasternodeOutpoint() // same masternode
-            && it->GetParentHash() == vote.GetParentHash() // same governance object (e.g. same proposal)
-            && it->GetSignal() == vote.GetSignal() // same signal (e.g. "funding", "delete", etc.)
-            && it->GetTimestamp() < vote.GetTimestamp()) // older than new vote
-        {
-            --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
-            listVotes.erase(it++);
-        } else {
-            ++it;
+    CGovernanceVote vote;
+    ssTmp.clear();
+    SerializeVote(ssTmp, rec);
+    ssTmp >> vote;
+    return vote;
+}
+
+void CGovernanceObjectVoteFile::Clear()
+{
+    nMemoryVotes = 0;
+    nParentHash.SetNull();
+    vecVotes.clear();
+    vecOutpoints.clear();
+    vchSigArena.clear();
+    nSigArenaWaste = 0;
+    vecVoteIndex.clear();
+    vecOutpointIndex.clear();
+    nVoteHashXor = 0;
+}
+
+int CGovernanceObjectVoteFile::FindVote(const uint256& nHash) const
+{
+    if (vecVoteIndex.empty()) {
+        return -1;
+    }
+    size_t nMask = vecVoteIndex.size() - 1;
+    for (size_t i = nHash.GetCheapHash() & nMask; vecVoteIndex[i] != 0; i = (i + 1) & nMask) {
+        uint32_t nPos = vecVoteIndex[i] - 1;
+        if (vecVotes[nPos].nHash == nHash) {
+            return nPos;
         }
     }
+    return -1;
 }
 
-void CGovernanceObjectVoteFile::RebuildIndex()
+int CGovernanceObjectVoteFile::FindOutpoint(const COutPoint& outpoint) const
 {
-    mapVoteIndex.clear();
-    nMemoryVotes = 0;
-    vote_l_it it = listVotes.begin();
-    while (it != listVotes.end()) {
-        CGovernanceVote& vote = *it;
-        uint256 nHash = vote.GetHash();
-        if (mapVoteIndex.find(nHash) == mapVoteIndex.end()) {
-            mapVoteIndex[nHash] = it;
-            ++nMemoryVotes;
-            ++it;
+    if (vecOutpointIndex.empty()) {
+        return -1;
+    }
+    size_t nMask = vecOutpointIndex.size() - 1;
+    for (size_t i = GetOutpointHash(outpoint) & nMask; vecOutpointIndex[i] != 0; i = (i + 1) & nMask) {
+        uint32_t nPos = vecOutpointIndex[i] - 1;
+        if (vecOutpoints[nPos] == outpoint) {
+            return nPos;
+        }
+    }
+    return -1;
+}
+
+bool CGovernanceObjectVoteFile::InsertVote(const CGovernanceVote& vote, bool* fNewOutpointRet)
+{
+    uint256 nHash = vote.GetHash();
+    if (HasVote(nHash)) {
+        return false;
+    }
+
+    if (vecVotes.empty() && vecOutpoints.empty()) {
+        nParentHash = vote.GetParentHash();
+    } else if (vote.GetParentHash() != nParentHash) {
+        // votes are always routed to the file of their parent object
+        return false;
+    }
+
+    int nOutpoint = FindOutpoint(vote.GetMasternodeOutpoint());
+    if (fNewOutpointRet) {
+        *fNewOutpointRet = nOutpoint == -1;
+    }
+    if (nOutpoint == -1) {
+        nOutpoint = vecOutpoints.size();
+        vecOutpoints.push_back(vote.GetMasternodeOutpoint());
+        if (vecOutpoints.size() * 2 > vecOutpointIndex.size()) {
+            RebuildOutpointIndex();
         } else {
-            listVotes.erase(it++);
+            InsertIntoIndex(vecOutpointIndex, GetOutpointHash(vote.GetMasternodeOutpoint()), nOutpoint);
         }
     }
+
+    const std::vector<unsigned char>& vchSig = vote.GetSignature();
+
+    vote_rec_t rec;
+    rec.nHash = nHash;
+    rec.nOutpoint = nOutpoint;
+    rec.nVoteSignal = vote.GetSignal();
+    rec.nVoteOutcome = vote.GetOutcome();
+    rec.nTime = vote.GetTimestamp();
+    rec.nSigOffset = vchSigArena.size();
+    rec.nSigSize = vchSig.size();
+    vchSigArena.insert(vchSigArena.end(), vchSig.begin(), vchSig.end());
+    vecVotes.push_back(rec);
+    nVoteHashXor ^= UintToArith256(nHash);
+
+    if (vecVotes.size() * 2 > vecVoteIndex.size()) {
+        RebuildVoteIndex();
+    } else {
+        InsertIntoIndex(vecVoteIndex, nHash.GetCheapHash(), vecVotes.size() - 1);
+    }
+    return true;
+}
+
+void CGovernanceObjectVoteFile::EraseVotes(const std::vector<bool>& vErase)
+{
+    size_t nKept = 0;
+    for (size_t i = 0; i < vecVotes.size(); i++) {
+        if (vErase[i]) {
+            nSigArenaWaste += vecVotes[i].nSigSize;
+            nVoteHashXor ^= UintToArith256(vecVotes[i].nHash);
+            --nMemoryVotes;
+            continue;
+        }
+        if (nKept != i) {
+            vecVotes[nKept] = vecVotes[i];
+        }
+        ++nKept;
+    }
+    if (nKept == vecVotes.size()) {
+        return;
+    }
+    vecVotes.resize(nKept);
+
+    if (nSigArenaWaste * 2 > vchSigArena.size()) {
+        CompactArena();
+    }
+    RebuildVoteIndex();
+}
+
+void CGovernanceObjectVoteFile::RemoveOldVotes(const vote_rec_t& rec)
+{
+    // every vote in this file shares the same governance object (e.g. same proposal)
+    std::vector<bool> vErase(vecVotes.size(), false);
+    bool fFound = false;
+    for (size_t i = 0; i < vecVotes.size(); i++) {
+        const vote_rec_t& other = vecVotes[i];
+        if (other.nOutpoint == rec.nOutpoint // same masternode
+            && other.nVoteSignal == rec.nVoteSignal // same signal (e.g. "funding", "delete", etc.)
+            && other.nTime < rec.nTime) // older than new vote
+        {
+            vErase[i] = true;
+            fFound = true;
+        }
+    }
+    if (fFound) {
+        EraseVotes(vErase);
+    }
+}
+
+void CGovernanceObjectVoteFile::CompactArena()
+{
+    std::vector<unsigned char> vchNewArena;
+    vchNewArena.reserve(vchSigArena.size() - nSigArenaWaste);
+    std::vector<COutPoint> vecNewOutpoints;
+    std::vector<int> vNewPos(vecOutpoints.size(), -1);
+
+    for (auto& rec : vecVotes) {
+        uint32_t nNewOffset = vchNewArena.size();
+        vchNewArena.insert(vchNewArena.end(), vchSigArena.begin() + rec.nSigOffset, vchSigArena.begin() + rec.nSigOffset + rec.nSigSize);
+        rec.nSigOffset = nNewOffset;
+
+        if (vNewPos[rec.nOutpoint] == -1) {
+            vNewPos[rec.nOutpoint] = vecNewOutpoints.size();
+            vecNewOutpoints.push_back(vecOutpoints[rec.nOutpoint]);
+        }
+        rec.nOutpoint = vNewPos[rec.nOutpoint];
+    }
+
+    vchSigArena.swap(vchNewArena);
+    vecOutpoints.swap(vecNewOutpoints);
+    nSigArenaWaste = 0;
+    RebuildOutpointIndex();
+}
+
+void CGovernanceObjectVoteFile::RebuildVoteIndex()
+{
+    vecVoteIndex.assign(GetIndexSize(vecVotes.size()), 0);
+    for (size_t i = 0; i < vecVotes.size(); i++) {
+        InsertIntoIndex(vecVoteIndex, vecVotes[i].nHash.GetCheapHash(), i);
+    }
+}
+
+void CGovernanceObjectVoteFile::RebuildOutpointIndex()
+{
+    vecOutpointIndex.assign(GetIndexSize(vecOutpoints.size()), 0);
+    for (size_t i = 0; i < vecOutpoints.size(); i++) {
+        InsertIntoIndex(vecOutpointIndex, GetOutpointHash(vecOutpoints[i]), i);
+    }
 }
@@ -5,51 +5,108 @@
 #ifndef GOVERNANCE_VOTEDB_H
 #define GOVERNANCE_VOTEDB_H
 
-#include <list>
-#include <map>
+#include <set>
+#include <vector>
 
+#include "arith_uint256.h"
 #include "governance-vote.h"
 #include "serialize.h"
 #include "streams.h"
 #include "uint256.h"
 
+/**
+ * Summary of the votes held for one governance object: the number of votes and the
+ * xor of their hashes. Peers exchange these during sync and only ask for the votes
+ * of objects whose digests differ.
+ */
+class CGovernanceVoteDigest
+{
+public:
+    uint32_t nCount;
+    uint256 nHash;
+
+    CGovernanceVoteDigest() :
+        nCount(0),
+        nHash()
+    {
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(nCount);
+        READWRITE(nHash);
+    }
+
+    bool operator==(const CGovernanceVoteDigest& other) const
+    {
+        return nCount == other.nCount && nHash == other.nHash;
+    }
+
+    bool operator!=(const CGovernanceVoteDigest& other) const
+    {
+        return !(*this == other);
+    }
+};
+
 /**
  * Represents the collection of votes associated with a given CGovernanceObject
  * Recently received votes are held in memory until a maximum size is reached after
  * which older votes a flushed to a disk file.
  *
+ * Votes are kept as fixed size records in a contiguous table. The parent hash is
+ * stored once per file, masternode outpoints are stored once per masternode and
+ * all signatures share a single arena. Full CGovernanceVote objects are only
+ * rebuilt on request. Lookups by vote hash and by outpoint go through small
+ * open-addressing (linear probing) indexes holding positions in those tables.
+ *
  * Note: This is a stub implementation that doesn't limit the number of votes held
  * in memory and doesn't flush to disk.
  */
 class CGovernanceObjectVoteFile
 {
-public: // Types
-    typedef std::list<CGovernanceVote> vote_l_t;
+private: // Types
+    struct vote_rec_t {
+        uint256 nHash;
+        uint32_t nOutpoint; // position in vecOutpoints
+        int32_t nVoteSignal;
+        int32_t nVoteOutcome;
+        int64_t nTime;
+        uint32_t nSigOffset; // position in vchSigArena
+        uint32_t nSigSize;
+    };
+
+    typedef std::vector<vote_rec_t> vote_v_t;
 
-    typedef vote_l_t::iterator vote_l_it;
+private:
+    static const int MAX_MEMORY_VOTES = -1;
 
-    typedef vote_l_t::const_iterator vote_l_cit;
+    int nMemoryVotes;
 
-    typedef std::map<uint256, vote_l_it> vote_m_t;
+    /// Parent hash shared by every vote in this file
+    uint256 nParentHash;
 
-    typedef vote_m_t::iterator vote_m_it;
+    vote_v_t vecVotes;
 
-    typedef vote_m_t::const_iterator vote_m_cit;
+    std::vector<COutPoint> vecOutpoints;
 
-private:
-    static const int MAX_MEMORY_VOTES = -1;
+    std::vector<unsigned char> vchSigArena;
 
-    int nMemoryVotes;
+    /// Bytes in vchSigArena no longer referenced by any vote
+    size_t nSigArenaWaste;
 
-    vote_l_t listVotes;
+    /// Open-addressing indexes, slots hold position + 1 and 0 marks an empty slot
+    std::vector<uint32_t> vecVoteIndex;
+    std::vector<uint32_t> vecOutpointIndex;
 
-    vote_m_t mapVoteIndex;
+    /// Xor of the hashes of all votes in vecVotes, updated on every insert and erase
+    arith_uint256 nVoteHashXor;
 
 public:
     CGovernanceObjectVoteFile();
 
-    CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other);
-
     /**
      * Add a vote to the file
      */
@@ -61,9 +118,9 @@ public:
     bool HasVote(const uint256& nHash) const;
 
     /**
-     * Retrieve a vote cached in memory
+     * Retrieve a vote cached in memory, serialized straight into e.g. the payload of a network message
      */
-    bool SerializeVoteToStream(const uint256& nHash, CDataStream& ss) const;
+    bool SerializeVoteToStream(const uint256& nHash, CVectorWriter& ss) const;
 
     int GetVoteCount()
     {
@@ -72,26 +129,82 @@ public:
 
     std::vector<CGovernanceVote> GetVotes() const;
 
+    /// Hashes of all votes, without rebuilding the votes
+    std::vector<uint256> GetVoteHashes() const;
+
+    CGovernanceVoteDigest GetVoteDigest() const;
+
     void RemoveVotesFromMasternode(const COutPoint& outpointMasternode);
     std::set<uint256> RemoveInvalidVotes(const COutPoint& outpointMasternode, bool fProposal);
 
-    ADD_SERIALIZE_METHODS;
+    // Same format as the former std::list<CGovernanceVote> based file
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s << nMemoryVotes;
+        WriteCompactSize(s, vecVotes.size());
+        for (const auto& rec : vecVotes) {
+            SerializeVote(s, rec);
+        }
+    }
 
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action)
+    template <typename Stream>
+    void Unserialize(Stream& s)
     {
-        READWRITE(nMemoryVotes);
-        READWRITE(listVotes);
-        if (ser_action.ForRead()) {
-            RebuildIndex();
+        Clear();
+        s >> nMemoryVotes;
+        uint64_t nCount = ReadCompactSize(s);
+        for (uint64_t i = 0; i < nCount; i++) {
+            CGovernanceVote vote;
+            s >> vote;
+            // duplicates are dropped, just like the old index rebuild did
+            InsertVote(vote);
         }
+        nMemoryVotes = vecVotes.size();
     }
 
 private:
+    template <typename Stream>
+    void SerializeVote(Stream& s, const vote_rec_t& rec) const
+    {
+        // must match CGovernanceVote::SerializationOp
+        s << vecOutpoints[rec.nOutpoint];
+        s << nParentHash;
+        s << rec.nVoteOutcome;
+        s << rec.nVoteSignal;
+        s << rec.nTime;
+        if (!(s.GetType() & SER_GETHASH)) {
+            WriteCompactSize(s, rec.nSigSize);
+            if (rec.nSigSize) {
+                s.write((const char*)&vchSigArena[rec.nSigOffset], rec.nSigSize);
+            }
+        }
+    }
+
+    CGovernanceVote GetVote(const vote_rec_t& rec, CDataStream& ssTmp) const;
+
+    void Clear();
+
+    int FindVote(const uint256& nHash) const;
+    int FindOutpoint(const COutPoint& outpoint) const;
+
+    /**
+     * Store a vote unless it is already known or belongs to a different object,
+     * fNewOutpointRet is set when this is the first vote of its masternode
+     */
+    bool InsertVote(const CGovernanceVote& vote, bool* fNewOutpointRet = nullptr);
+
+    /// Remove the votes at the flagged positions, keeping the order of the others
+    void EraseVotes(const std::vector<bool>& vErase);
+
     // Drop older votes for the same gobject from the same masternode
-    void RemoveOldVotes(const CGovernanceVote& vote);
+    void RemoveOldVotes(const vote_rec_t& rec);
+
+    /// Drop unreferenced signatures and outpoints
+    void CompactArena();
 
-    void RebuildIndex();
+    void RebuildVoteIndex();
+    void RebuildOutpointIndex();
 };
 
 #endif
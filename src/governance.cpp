@@ -6,10 +6,13 @@
 #include "client.h"
 #include "consensus/validation.h"
 #include "governance-classes.h"
+#include "governance-collateral.h"
 #include "governance-object.h"
+#include "governance-snapshot.h"
 #include "governance-validators.h"
 #include "governance-vote.h"
 #include "init.h"
+#include "ipfs-pinning.h"
 #include "masternode-meta.h"
 #include "masternode-sync.h"
 #include "messagesigner.h"
@@ -17,17 +20,25 @@
 #include "netfulfilledman.h"
 #include "netmessagemaker.h"
 #include "spork.h"
+#include "trace.h"
+#include "ui_interface.h"
 #include "util.h"
 #include "validation.h"
 #include "validationinterface.h"
+#include "workerpool.h"
+
+#include "bls/bls_batchverifier.h"
+
+#include <unordered_set>
 
 CGovernanceManager governance;
 
 int nSubmittedFinalBudget;
 
-const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-15";
+const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-16";
 const int CGovernanceManager::MAX_TIME_FUTURE_DEVIATION = 60 * 60;
 const int CGovernanceManager::RELIABLE_PROPAGATION_TIME = 60;
+const double CGovernanceManager::REJECTED_FILTER_FP_RATE = 0.000001;
 
 CGovernanceManager::CGovernanceManager() :
     nTimeLastDiff(0),
@@ -39,7 +50,12 @@ CGovernanceManager::CGovernanceManager() :
     cmapInvalidVotes(MAX_CACHE_SIZE),
     cmmapOrphanVotes(MAX_CACHE_SIZE),
     mapLastMasternodeObject(),
-    setRequestedObjects(),
+    cmapRequestedObjects(MAX_REQUESTED_CACHE_SIZE),
+    cmapRequestedVotes(MAX_REQUESTED_CACHE_SIZE),
+    filterRejectedObjects(REJECTED_FILTER_ELEMENTS, REJECTED_FILTER_FP_RATE),
+    filterRejectedVotes(REJECTED_FILTER_ELEMENTS, REJECTED_FILTER_FP_RATE),
+    fSearchIndex(false),
+    fVoteVerifyActive(false),
     fRateChecksEnabled(true),
     cs()
 {
@@ -48,64 +64,77 @@ CGovernanceManager::CGovernanceManager() :
 // Accessors for thread-safe access to maps
 bool CGovernanceManager::HaveObjectForHash(const uint256& nHash) const
 {
-    LOCK(cs);
+    boost::shared_lock<boost::shared_mutex> lock(cs_inventory);
     return (mapObjects.count(nHash) == 1 || mapPostponedObjects.count(nHash) == 1);
 }
 
-bool CGovernanceManager::SerializeObjectForHash(const uint256& nHash, CDataStream& ss) const
+bool CGovernanceManager::SerializeObjectForHash(const uint256& nHash, CVectorWriter& ss, bool fCompressed) const
 {
-    LOCK(cs);
+    // the fields serialized for the network never change once an object is stored
+    boost::shared_lock<boost::shared_mutex> lock(cs_inventory);
     object_m_cit it = mapObjects.find(nHash);
     if (it == mapObjects.end()) {
         it = mapPostponedObjects.find(nHash);
         if (it == mapPostponedObjects.end())
             return false;
     }
-    ipfs::Client ipfsclient("localhost", 5001);
-    ss << it->second;
+    if (fCompressed) {
+        ss << CGovernanceObjectCompressor(REF(it->second));
+    } else {
+        ss << it->second;
+    }
     return true;
 }
 
 bool CGovernanceManager::HaveVoteForHash(const uint256& nHash) const
 {
-    LOCK(cs);
+    {
+        LOCK(cs_pendingVotes);
+        if (mapPendingVotes.count(nHash)) {
+            return true;
+        }
+    }
+
+    boost::shared_lock<boost::shared_mutex> lock(cs_inventory);
 
     CGovernanceObject* pGovobj = nullptr;
-    return cmapVoteToObject.Get(nHash, pGovobj) && pGovobj->GetVoteFile().HasVote(nHash);
+    return cmapVoteToObject.Get(nHash, pGovobj) && pGovobj->HasVote(nHash);
 }
 
-int CGovernanceManager::GetVoteCount() const
+bool CGovernanceManager::HaveObjectForIPFSCID(const std::string& strCID) const
 {
     LOCK(cs);
-    return (int)cmapVoteToObject.GetSize();
+    return mapIPFSCIDToObject.count(strCID) == 1;
 }
 
-bool CGovernanceManager::SerializeVoteForHash(const uint256& nHash, CDataStream& ss) const
+CGovernanceManager::cid_hash_m_t CGovernanceManager::GetIPFSCIDIndex() const
 {
     LOCK(cs);
-
-    CGovernanceObject* pGovobj = nullptr;
-    return cmapVoteToObject.Get(nHash, pGovobj) && pGovobj->GetVoteFile().SerializeVoteToStream(nHash, ss);
+    return mapIPFSCIDToObject;
 }
 
-template<class UnaryFunction>
-void CGovernanceManager::RecursiveIPFSIterate(const json& j, UnaryFunction f)
+int CGovernanceManager::GetVoteCount() const
 {
-	for (auto it = j.begin(); it != j.end(); ++it)
-	{
-		if (it->is_structured())
-		{
-			RecursiveIPFSIterate(*it, f);
-		}
-		else
-		{
-			f(it);
-		}
-	}
+    boost::shared_lock<boost::shared_mutex> lock(cs_inventory);
+    return (int)cmapVoteToObject.GetSize();
 }
 
+bool CGovernanceManager::SerializeVoteForHash(const uint256& nHash, CVectorWriter& ss) const
+{
+    boost::shared_lock<boost::shared_mutex> lock(cs_inventory);
+
+    CGovernanceObject* pGovobj = nullptr;
+    return cmapVoteToObject.Get(nHash, pGovobj) && pGovobj->SerializeVoteToStream(nHash, ss);
+}
 
 void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)
+{
+    TRACE_TIME_START(nTraceStart);
+    ProcessMessageInternal(pfrom, strCommand, vRecv, connman);
+    TRACE4(governance, process_message, pfrom->id, strCommand.c_str(), vRecv.size(), TRACE_TIME_ELAPSED(nTraceStart));
+}
+
+void CGovernanceManager::ProcessMessageInternal(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)
 {
     // lite mode is not supported
     if (fLiteMode) return;
@@ -144,12 +173,42 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strComm
         LogPrint("gobject", "MNGOVERNANCESYNC -- syncing governance objects to our peer at %s\n", pfrom->addr.ToString());
     }
 
+    // VOTE DIGESTS FOR THE OBJECTS A PEER JUST SENT US
+    else if (strCommand == NetMsgType::MNGOVERNANCEVOTEDIGESTS) {
+        std::vector<std::pair<uint256, CGovernanceVoteDigest> > vecDigests;
+        vRecv >> vecDigests;
+
+        // only accept these from peers we asked for the object list
+        if (!netfulfilledman.HasFulfilledRequest(pfrom->addr, "governance-sync")) {
+            LogPrint("gobject", "MNGOVERNANCEVOTEDIGESTS -- unrequested digests, peer=%d\n", pfrom->id);
+            return;
+        }
+
+        if (vecDigests.size() > MAX_GOVERNANCE_VOTE_DIGESTS) {
+            LOCK(cs_main);
+            LogPrint("gobject", "MNGOVERNANCEVOTEDIGESTS -- too many digests (%d), peer=%d\n", vecDigests.size(), pfrom->id);
+            Misbehaving(pfrom->GetId(), 20);
+            return;
+        }
+
+        LOCK(cs);
+        auto& peerDigests = mapPeerVoteDigests[pfrom->GetId()];
+        peerDigests.first = GetTime();
+        peerDigests.second.clear();
+        peerDigests.second.insert(vecDigests.begin(), vecDigests.end());
+        LogPrint("gobject", "MNGOVERNANCEVOTEDIGESTS -- received %d digests, peer=%d\n", vecDigests.size(), pfrom->id);
+    }
+
     // A NEW GOVERNANCE OBJECT HAS ARRIVED
-    else if (strCommand == NetMsgType::MNGOVERNANCEOBJECT) {
+    else if (strCommand == NetMsgType::MNGOVERNANCEOBJECT || strCommand == NetMsgType::MNGOVERNANCEOBJECTCOMPRESSED) {
         // MAKE SURE WE HAVE A VALID REFERENCE TO THE TIP BEFORE CONTINUING
 
         CGovernanceObject govobj;
-        vRecv >> govobj;
+        if (strCommand == NetMsgType::MNGOVERNANCEOBJECTCOMPRESSED) {
+            vRecv >> REF(CGovernanceObjectCompressor(govobj));
+        } else {
+            vRecv >> govobj;
+        }
 
         uint256 nHash = govobj.GetHash();
 
@@ -174,7 +233,7 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strComm
         LogPrint("gobject", "MNGOVERNANCEOBJECT -- Received object: %s\n", strHash);
 
         if (!AcceptObjectMessage(nHash)) {
-            LogPrintf("MNGOVERNANCEOBJECT -- Received unrequested object: %s\n", strHash);
+            LogPrintLimited("gobject", "MNGOVERNANCEOBJECT -- Received unrequested object: %s\n", strHash);
             return;
         }
 
@@ -189,7 +248,7 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strComm
 
         bool fRateCheckBypassed = false;
         if (!MasternodeRateCheck(govobj, true, false, fRateCheckBypassed)) {
-            LogPrintf("MNGOVERNANCEOBJECT -- masternode rate check failed - %s - (current block height %d) \n", strHash, nCachedBlockHeight);
+            LogPrintLimited("gobject", "MNGOVERNANCEOBJECT -- masternode rate check failed - %s - (current block height %d) \n", strHash, nCachedBlockHeight);
             return;
         }
 
@@ -202,7 +261,7 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strComm
 
         if (fRateCheckBypassed && (fIsValid || fMasternodeMissing)) {
             if (!MasternodeRateCheck(govobj, true)) {
-                LogPrintf("MNGOVERNANCEOBJECT -- masternode rate check failed (after signature verification) - %s - (current block height %d)\n", strHash, nCachedBlockHeight);
+                LogPrintLimited("gobject", "MNGOVERNANCEOBJECT -- masternode rate check failed (after signature verification) - %s - (current block height %d)\n", strHash, nCachedBlockHeight);
                 return;
             }
         }
@@ -221,24 +280,25 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strComm
                 count++;
                 ExpirationInfo info(pfrom->GetId(), GetAdjustedTime() + GOVERNANCE_ORPHAN_EXPIRATION_TIME);
                 mapMasternodeOrphanObjects.insert(std::make_pair(nHash, object_info_pair_t(govobj, info)));
-                LogPrintf("MNGOVERNANCEOBJECT -- Missing masternode for: %s, strError = %s\n", strHash, strError);
+                LogPrintLimited("gobject", "MNGOVERNANCEOBJECT -- Missing masternode for: %s, strError = %s\n", strHash, strError);
             } else if (fMissingConfirmations) {
                 if (govobj.GetObjectType() != GOVERNANCE_OBJECT_RECORD || govobj.GetObjectType() != GOVERNANCE_OBJECT_PROPOSAL) {
                     AddPostponedObject(govobj);
-                    LogPrintf("MNGOVERNANCEOBJECT -- Not enough fee confirmations for: %s, strError = %s\n", strHash, strError);
+                    LogPrintLimited("gobject", "MNGOVERNANCEOBJECT -- Not enough fee confirmations for: %s, strError = %s\n", strHash, strError);
                 } else {
                     if (ValidIPFSHash(govobj))
                     {
                         AddPostponedObject(govobj);
                         AddIPFSHash(govobj);
-                        LogPrintf("MNGOVERNANCEOBJECT -- Not enough fee confirmations for record: %s, strError = %s\n", strHash, strError);
+                        LogPrintLimited("gobject", "MNGOVERNANCEOBJECT -- Not enough fee confirmations for record: %s, strError = %s\n", strHash, strError);
                     } else {
-                        LogPrintf("MNGOVERNANCEOBJECT -- IPFS hash NOT valid\n");
+                        LogPrintLimited("gobject", "MNGOVERNANCEOBJECT -- IPFS hash NOT valid\n");
                         return;
                     }
                 }
             } else {
-                LogPrintf("MNGOVERNANCEOBJECT -- Governance object is invalid - %s\n", strError);
+                LogPrintLimited("gobject", "MNGOVERNANCEOBJECT -- Governance object is invalid - %s\n", strError);
+                AddRejectedObject(nHash);
                 // apply node's ban score
                 Misbehaving(pfrom->GetId(), 20);
             }
@@ -252,7 +312,7 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strComm
                 AddIPFSHash(govobj);
                 AddGovernanceObject(govobj, connman, pfrom);
             } else {
-                LogPrintf("MNGOVERNANCEOBJECT -- IPFS hash NOT valid\n");
+                LogPrintLimited("gobject", "MNGOVERNANCEOBJECT -- IPFS hash NOT valid\n");
                 return;
             }
         }
@@ -291,24 +351,54 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strComm
             return;
         }
 
-        CGovernanceException exception;
-        if (ProcessVote(pfrom, vote, exception, connman)) {
-            LogPrint("gobject", "MNGOVERNANCEOBJECTVOTE -- %s new\n", strHash);
-            masternodeSync.BumpAssetLastTime("MNGOVERNANCEOBJECTVOTE");
-            vote.Relay(connman);
-        } else {
-            LogPrint("gobject", "MNGOVERNANCEOBJECTVOTE -- Rejected vote, error = %s\n", exception.what());
-            if ((exception.GetNodePenalty() != 0) && masternodeSync.IsSynced()) {
-                LOCK(cs_main);
-                Misbehaving(pfrom->GetId(), exception.GetNodePenalty());
-            }
+        // signatures are checked in batches by the vote verification thread
+        if (QueuePendingVote(pfrom->GetId(), vote)) {
             return;
         }
-        // SEND NOTIFICATION TO SCRIPT/ZMQ
-        GetMainSignals().NotifyGovernanceVote(vote);
+
+        ProcessPeerVote(pfrom, pfrom->GetId(), vote, connman);
     }
 }
 
+void CGovernanceManager::ProcessPeerVote(CNode* pfrom, NodeId nodeId, const CGovernanceVote& vote, CConnman& connman, bool fSignatureChecked)
+{
+    std::string strHash = vote.GetHash().ToString();
+
+    CGovernanceException exception;
+    if (ProcessVote(pfrom, vote, exception, connman, fSignatureChecked)) {
+        LogPrint("gobject", "MNGOVERNANCEOBJECTVOTE -- %s new\n", strHash);
+        masternodeSync.BumpAssetLastTime("MNGOVERNANCEOBJECTVOTE");
+        vote.Relay(connman);
+    } else {
+        LogPrint("gobject", "MNGOVERNANCEOBJECTVOTE -- Rejected vote, error = %s\n", exception.what());
+        if ((exception.GetNodePenalty() != 0) && masternodeSync.IsSynced()) {
+            LOCK(cs_main);
+            Misbehaving(nodeId, exception.GetNodePenalty());
+        }
+        return;
+    }
+    // SEND NOTIFICATION TO SCRIPT/ZMQ
+    GetMainSignals().NotifyGovernanceVote(vote);
+}
+
+std::vector<bool> CGovernanceManager::ProcessLocalVotesAndRelay(const std::vector<CGovernanceVote>& votes, std::vector<CGovernanceException>& exceptionsRet, CConnman& connman)
+{
+    std::vector<bool> vecAccepted(votes.size(), false);
+    exceptionsRet.assign(votes.size(), CGovernanceException());
+
+    std::vector<CGovernanceVote> vecRelay;
+    vecRelay.reserve(votes.size());
+    for (size_t i = 0; i < votes.size(); i++) {
+        if (ProcessVote(nullptr, votes[i], exceptionsRet[i], connman, true)) {
+            vecAccepted[i] = true;
+            vecRelay.emplace_back(votes[i]);
+        }
+    }
+
+    CGovernanceVote::Relay(vecRelay, connman);
+    return vecAccepted;
+}
+
 void CGovernanceManager::CheckOrphanVotes(CGovernanceObject& govobj, CGovernanceException& exception, CConnman& connman)
 {
     uint256 nHash = govobj.GetHash();
@@ -325,6 +415,7 @@ void CGovernanceManager::CheckOrphanVotes(CGovernanceObject& govobj, CGovernance
         if (pairVote.second < nNow) {
             fRemove = true;
         } else if (govobj.ProcessVote(nullptr, vote, exception, connman)) {
+            setDirtyObjects.insert(nHash);
             vote.Relay(connman);
             fRemove = true;
         }
@@ -337,61 +428,20 @@ void CGovernanceManager::CheckOrphanVotes(CGovernanceObject& govobj, CGovernance
 void CGovernanceManager::AddIPFSHash(CGovernanceObject& govobj)
 {
     if (fMasternodeMode) {
-        LogPrintf("MNGOVERNANCEOBJECT::AddIPFShash -- Record Or Proposal Check\n");
+        LogPrintLimited("gobject", "MNGOVERNANCEOBJECT::AddIPFShash -- Record Or Proposal Check\n");
         if (govobj.GetObjectType() == GOVERNANCE_OBJECT_RECORD || govobj.GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL) {
-            LogPrintf("MNGOVERNANCEOBJECT::AddIPFShash -- Record Or Proposal -- PASS\n");
-            ipfs::Client ipfsclient("localhost", 5001);
-            std::string ipfsHash = "empty";
-            try {
-                UniValue Jobj = govobj.GetJSONObject();
-                ipfsHash = "/ipfs/" + Jobj["ipfscid"].get_str();
-            } catch (std::exception& e) {
-                LogPrintf("MNGOVERNANCEOBJECT::AddIPFShash -- Could not get IPFS Hash: %s\n", ipfsHash);
-            }
-            //  if ((!govobj.IsSetCachedDelete() || !govobj.IsSetExpired()) && govobj.IsSetRecordLocked()) {
-            LogPrintf("MNGOVERNANCEOBJECT::AddIPFShash -- NameHash: %s\n", ipfsHash);
-
-            bool IPFSSizeCheck = false;
-            bool IPFSDaemonCheck = false;
-            //PIN IPFS HASH
-            try {
-                ipfs::Json ls_result;
-                ipfsclient.FilesLs(ipfsHash, &ls_result);
-                IPFSDaemonCheck = true;
-                int IPFSTempSize = 0;
-                long long IPFSSize = 0;
-                RecursiveIPFSIterate(ls_result,
-                    [&IPFSTempSize, &IPFSSize](json::const_iterator it) {
-                        if (it.key() == "Size") {
-                            LogPrintf("MNGOVERNANCEOBJECT::AddIPFShash::IPFSFileSizeCheck: %s %s\n", it.key(), it.value());
-                            IPFSTempSize = it.value();
-                            IPFSSize += IPFSTempSize;
-                        }
-                    });
-
-                if (IPFSSize <= SPORK_102_IPFS_OBJECT_SIZE) {
-                    IPFSSizeCheck = true;
-                    LogPrintf("MNGOVERNANCEOBJECT::AddIPFShash::IPFSFileSizeCheck -- Maxium Size: %s bytes, Pass Size: %d bytes\n", SPORK_102_IPFS_OBJECT_SIZE, IPFSSize);
-                } else {
-                    IPFSSizeCheck = false;
-                    LogPrintf("MNGOVERNANCEOBJECT::AddIPFShash::IPFSFileSizeCheck -- -- Maxium Size: %s bytes, Fail Size Too Big: %d bytes\n", SPORK_102_IPFS_OBJECT_SIZE, IPFSSize);
-                }
-            } catch (std::exception& e) {
-                LogPrintf("MNGOVERNANCEOBJECT::AddIPFShash::PinHash -- IPFS Hash: %s Is Not Valid IPFS object directory OR this masternode does not require IPFS pinning\n", ipfsHash);
-            }
-
-            // Weird error with IPFS daemon, exception is thrown even though IPFS hash has been or is pinning properly pinned. This is ugly work around.
-            try {
-                if (IPFSSizeCheck && IPFSDaemonCheck) {
-                    LogPrintf("MNGOVERNANCEOBJECT::AddIPFShash::PinHash -- IPFS Hash: %s Pin Attempt\n", ipfsHash);
-                    ipfsclient.PinAdd(ipfsHash);
-                }
-            } catch (std::exception& e) {
-                LogPrintf("MNGOVERNANCEOBJECT::AddIPFShash::PinHash -- IPFS Pin Hash: %s Success, check on console by running 'ipfs pin ls %s'\n", ipfsHash, ipfsHash);
+            LogPrintLimited("gobject", "MNGOVERNANCEOBJECT::AddIPFShash -- Record Or Proposal -- PASS\n");
+            std::string ipfsHash = govobj.GetPayload()->strIPFSCID;
+            if (ipfsHash.empty()) {
+                LogPrintLimited("gobject", "MNGOVERNANCEOBJECT::AddIPFShash -- Could not get IPFS Hash: %s\n", "empty");
+                return;
             }
+            LogPrintLimited("gobject", "MNGOVERNANCEOBJECT::AddIPFShash -- NameHash: %s\n", ipfsHash);
 
+            // Size check and pinning talk to the IPFS daemon, leave that to the pinning workers
+            ipfsPinManager.QueuePin(govobj.GetHash(), ipfsHash, CIPFSPinManager::GetMasternodeSwarmAddress(govobj.GetMasternodeOutpoint()));
         } else {
-            LogPrintf("MNGOVERNANCEOBJECT::AddIPFShash -- RecordCheck -- FAIL: Not a record or proposal, ObjectType: %d \n", govobj.GetObjectType());
+            LogPrintLimited("gobject", "MNGOVERNANCEOBJECT::AddIPFShash -- RecordCheck -- FAIL: Not a record or proposal, ObjectType: %d \n", govobj.GetObjectType());
         }
     }
 }
@@ -419,13 +469,23 @@ void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman
 
     // INSERT INTO OUR GOVERNANCE OBJECT MEMORY
     // IF WE HAVE THIS OBJECT ALREADY, WE DON'T WANT ANOTHER COPY
-    auto objpair = mapObjects.emplace(nHash, govobj);
+    std::pair<object_m_it, bool> objpair;
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_inventory);
+        objpair = mapObjects.emplace(nHash, govobj);
+    }
+    if (objpair.second) {
+        setDirtyObjects.insert(nHash);
+    }
 
     if (!objpair.second) {
         LogPrintf("CGovernanceManager::AddGovernanceObject -- already have governance object %s\n", nHash.ToString());
         return;
     }
 
+    AddIPFSCIDIndex(objpair.first->second);
+    AddObjectIndexes(objpair.first->second);
+
     // SHOULD WE ADD THIS OBJECT TO ANY OTHER MANANGERS?
 
     LogPrint("gobject", "CGovernanceManager::AddGovernanceObject -- Before trigger block, GetDataAsPlainString = %s, nObjectType = %d\n",
@@ -458,6 +518,7 @@ void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman
 
     // SEND NOTIFICATION TO SCRIPT/ZMQ
     GetMainSignals().NotifyGovernanceObject(govobj);
+    uiInterface.NotifyGovernanceObjectChanged(nHash);
 }
 
 void CGovernanceManager::UpdateCachesAndClean()
@@ -498,11 +559,15 @@ void CGovernanceManager::UpdateCachesAndClean()
 
         // IF CACHE IS NOT DIRTY, WHY DO THIS?
         if (pObj->IsSetDirtyCache()) {
+            setDirtyObjects.insert(nHash);
+
             // UPDATE LOCAL VALIDITY AGAINST CRYPTO DATA
             pObj->UpdateLocalValidity();
 
             // UPDATE SENTINEL SIGNALING VARIABLES
             pObj->UpdateSentinelVariables();
+            UpdateFundingIndex(*pObj);
+            uiInterface.NotifyGovernanceObjectChanged(nHash);
         }
 
         // IF DELETE=TRUE, THEN CLEAN THE MESS UP!
@@ -515,25 +580,18 @@ void CGovernanceManager::UpdateCachesAndClean()
         if ((pObj->IsSetCachedDelete() || pObj->IsSetExpired()) && (!pObj->IsSetPermLocked() || !pObj->IsSetRecordLocked()) &&          
            (nTimeSinceDeletion >= GOVERNANCE_DELETION_DELAY)) {
             LogPrintf("CGovernanceManager::UpdateCachesAndClean -- erase obj %s\n", (*it).first.ToString());
+            uiInterface.NotifyGovernanceObjectChanged(nHash);
             mmetaman.RemoveGovernanceObject(pObj->GetHash());
+            RemoveIPFSCIDIndex(*pObj);
 
             //REMOVE IPFS HASH
-            if(pObj->nObjectType == GOVERNANCE_OBJECT_RECORD){
-                UniValue Jobj = pObj->GetJSONObject();
-                std::string ipfsHash = Jobj["ipfscid"].get_str();
-                try
-                {		
-                    ipfs::Client ipfsclient("localhost", 5001);
-                    if ((pObj->IsSetCachedDelete() || pObj->IsSetExpired()) && (!pObj->IsSetRecordLocked() || !pObj->IsSetPermLocked())) {
-                        //Remove IPFS PIN
-                        ipfsclient.PinRm(ipfsHash, ipfs::Client::PinRmOptions::RECURSIVE);
-                        LogPrintf("CGovernanceManager::RemoveIPFShash -- IPFS Hash: %s\n", ipfsHash);
-                    }
-                 }
-                 catch(std::exception& e)
-                 {
-                    LogPrintf("MNGOVERNANCEOBJECT::RemoveIPFShash::PinHash -- IPFS Hash: %s Is Not Valid IPFS object directory\n", ipfsHash);
-                 }
+            if (pObj->nObjectType == GOVERNANCE_OBJECT_RECORD) {
+                // Don't talk to the IPFS daemon while holding cs_main, the pinning workers unpin it later
+                std::string ipfsHash = GetObjectIPFSCID(*pObj);
+                if (!ipfsHash.empty() && !mapIPFSCIDToObject.count(ipfsHash)) {
+                    ipfsPinManager.QueueUnpin(ipfsHash);
+                    LogPrintf("CGovernanceManager::RemoveIPFShash -- IPFS Hash: %s\n", ipfsHash);
+                }
             }
 
             // Remove vote references
@@ -543,6 +601,7 @@ void CGovernanceManager::UpdateCachesAndClean()
                 if (lit->value == pObj) {
                     uint256 nKey = lit->key;
                     ++lit;
+                    boost::unique_lock<boost::shared_mutex> lock(cs_inventory);
                     cmapVoteToObject.Erase(nKey);
                 } else {
                     ++lit;
@@ -560,11 +619,14 @@ void CGovernanceManager::UpdateCachesAndClean()
             }
 
             mapErasedGovernanceObjects.insert(std::make_pair(nHash, nTimeExpired));
+            setDirtyObjects.insert(nHash);
+            RemoveObjectIndexes(*pObj);
+            boost::unique_lock<boost::shared_mutex> lock(cs_inventory);
             mapObjects.erase(it++);
         } else {
             // NOTE: triggers are handled via triggerman
             if (pObj->GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL || (pObj->GetObjectType() == GOVERNANCE_OBJECT_RECORD && (!pObj->IsSetRecordLocked() || !pObj->IsSetPermLocked()))) {
-                CProposalValidator validator(pObj->GetDataAsHexString(), true);
+                CProposalValidator validator(*pObj->GetPayload(), true);
                 if (!validator.Validate()) {
                     LogPrintf("CGovernanceManager::UpdateCachesAndClean -- set for deletion expired obj %s\n", strHash);
                     pObj->fCachedDelete = true;
@@ -587,6 +649,8 @@ void CGovernanceManager::UpdateCachesAndClean()
         }
     }
 
+    PageOutVoteFiles();
+
     LogPrintf("CGovernanceManager::UpdateCachesAndClean -- %s\n", ToString());
 }
 
@@ -643,21 +707,174 @@ std::vector<CGovernanceVote> CGovernanceManager::GetCurrentVotes(const uint256&
     return vecResult;
 }
 
-std::vector<const CGovernanceObject*> CGovernanceManager::GetAllNewerThan(int64_t nMoreThanTime) const
+std::vector<const CGovernanceObject*> CGovernanceManager::GetAllNewerThan(int64_t nMoreThanTime, int nObjectType, bool fFundedOnly) const
 {
     LOCK(cs);
 
     std::vector<const CGovernanceObject*> vGovObjs;
 
-    for (const auto& objPair : mapObjects) {
-        // IF THIS OBJECT IS OLDER THAN TIME, CONTINUE
-        if (objPair.second.GetCreationTime() < nMoreThanTime) {
-            continue;
+    if (fFundedOnly) {
+        for (const auto& nHash : setFundedObjects) {
+            const CGovernanceObject& govobj = mapObjects.at(nHash);
+            if (govobj.GetCreationTime() < nMoreThanTime) {
+                continue;
+            }
+            if (nObjectType != GOVERNANCE_OBJECT_UNKNOWN && govobj.GetObjectType() != nObjectType) {
+                continue;
+            }
+            vGovObjs.push_back(&govobj);
         }
+        std::sort(vGovObjs.begin(), vGovObjs.end(), [](const CGovernanceObject* a, const CGovernanceObject* b) {
+            return a->GetCreationTime() < b->GetCreationTime();
+        });
+        return vGovObjs;
+    }
 
+    const time_hash_s_t* pIndex = &setObjectsByTime;
+    if (nObjectType != GOVERNANCE_OBJECT_UNKNOWN) {
+        auto it = mapObjectsByTypeAndTime.find(nObjectType);
+        if (it == mapObjectsByTypeAndTime.end()) {
+            return vGovObjs;
+        }
+        pIndex = &it->second;
+    }
+
+    // SKIP OBJECTS OLDER THAN TIME
+    for (auto it = pIndex->lower_bound(std::make_pair(nMoreThanTime, uint256())); it != pIndex->end(); ++it) {
         // ADD GOVERNANCE OBJECT TO LIST
-        const CGovernanceObject* pGovObj = &(objPair.second);
-        vGovObjs.push_back(pGovObj);
+        vGovObjs.push_back(&mapObjects.at(it->second));
+    }
+
+    return vGovObjs;
+}
+
+std::vector<const CGovernanceObject*> CGovernanceManager::GetPageNewerThan(int64_t nCursorTime, const uint256& nCursorHash, size_t nMaxCount, int nObjectType, bool fFundedOnly,
+                                                                           const std::function<bool(const CGovernanceObject&)>& filter, bool& fMoreRet) const
+{
+    AssertLockHeld(cs);
+
+    std::vector<const CGovernanceObject*> vGovObjs;
+    fMoreRet = false;
+
+    time_hash_s_t setFundedByTime;
+    const time_hash_s_t* pIndex = &setObjectsByTime;
+    if (fFundedOnly) {
+        for (const auto& nHash : setFundedObjects) {
+            const CGovernanceObject& govobj = mapObjects.at(nHash);
+            if (nObjectType != GOVERNANCE_OBJECT_UNKNOWN && govobj.GetObjectType() != nObjectType) {
+                continue;
+            }
+            setFundedByTime.emplace(govobj.GetCreationTime(), nHash);
+        }
+        pIndex = &setFundedByTime;
+    } else if (nObjectType != GOVERNANCE_OBJECT_UNKNOWN) {
+        auto it = mapObjectsByTypeAndTime.find(nObjectType);
+        if (it == mapObjectsByTypeAndTime.end()) {
+            return vGovObjs;
+        }
+        pIndex = &it->second;
+    }
+
+    auto cursor = std::make_pair(nCursorTime, nCursorHash);
+    for (auto it = pIndex->lower_bound(cursor); it != pIndex->end(); ++it) {
+        if (*it == cursor) {
+            continue;
+        }
+        const CGovernanceObject& govobj = mapObjects.at(it->second);
+        if (!filter(govobj)) {
+            continue;
+        }
+        if (vGovObjs.size() == nMaxCount) {
+            fMoreRet = true;
+            break;
+        }
+        vGovObjs.push_back(&govobj);
+    }
+
+    return vGovObjs;
+}
+
+void CGovernanceManager::UpdateFundingIndex(const CGovernanceObject& govobj)
+{
+    AssertLockHeld(cs);
+
+    uint256 nHash = govobj.GetHash();
+    if (govobj.IsSetCachedFunding() && mapObjects.count(nHash)) {
+        setFundedObjects.insert(nHash);
+    } else {
+        setFundedObjects.erase(nHash);
+    }
+}
+
+void CGovernanceManager::AddObjectIndexes(const CGovernanceObject& govobj)
+{
+    auto key = std::make_pair(govobj.GetCreationTime(), govobj.GetHash());
+    setObjectsByTime.insert(key);
+    mapObjectsByTypeAndTime[govobj.GetObjectType()].insert(key);
+    UpdateFundingIndex(govobj);
+    AddSearchIndex(govobj);
+}
+
+void CGovernanceManager::RemoveObjectIndexes(const CGovernanceObject& govobj)
+{
+    auto key = std::make_pair(govobj.GetCreationTime(), govobj.GetHash());
+    setObjectsByTime.erase(key);
+    auto it = mapObjectsByTypeAndTime.find(govobj.GetObjectType());
+    if (it != mapObjectsByTypeAndTime.end()) {
+        it->second.erase(key);
+        if (it->second.empty()) {
+            mapObjectsByTypeAndTime.erase(it);
+        }
+    }
+    setFundedObjects.erase(govobj.GetHash());
+    searchIndex.Remove(govobj.GetHash());
+}
+
+void CGovernanceManager::AddSearchIndex(const CGovernanceObject& govobj)
+{
+    if (!fSearchIndex) {
+        return;
+    }
+    if (govobj.GetObjectType() != GOVERNANCE_OBJECT_RECORD && govobj.GetObjectType() != GOVERNANCE_OBJECT_PROPOSAL) {
+        return;
+    }
+    CGovernanceObjectPayloadPtr payload = govobj.GetPayload();
+    searchIndex.Add(govobj.GetHash(), govobj.GetObjectType(), govobj.GetCreationTime(),
+                    {payload->strName, payload->strSummaryName, payload->strSummaryDescription});
+}
+
+void CGovernanceManager::EnableSearchIndex()
+{
+    LOCK(cs);
+
+    if (fSearchIndex) {
+        return;
+    }
+    fSearchIndex = true;
+    for (const auto& objPair : mapObjects) {
+        AddSearchIndex(objPair.second);
+    }
+}
+
+std::vector<const CGovernanceObject*> CGovernanceManager::SearchPage(const std::string& strQuery, int nObjectType, int64_t nCursorTime, const uint256& nCursorHash, size_t nMaxCount,
+                                                                     const std::function<bool(const CGovernanceObject&)>& filter, bool& fMoreRet) const
+{
+    AssertLockHeld(cs);
+
+    std::vector<const CGovernanceObject*> vGovObjs;
+    fMoreRet = false;
+
+    std::vector<CGovernanceSearchIndex::time_hash_t> vecMatches = searchIndex.Search(strQuery, nObjectType);
+    for (auto it = std::upper_bound(vecMatches.begin(), vecMatches.end(), std::make_pair(nCursorTime, nCursorHash)); it != vecMatches.end(); ++it) {
+        const CGovernanceObject& govobj = mapObjects.at(it->second);
+        if (!filter(govobj)) {
+            continue;
+        }
+        if (vGovObjs.size() == nMaxCount) {
+            fMoreRet = true;
+            break;
+        }
+        vGovObjs.push_back(&govobj);
     }
 
     return vGovObjs;
@@ -694,10 +911,10 @@ bool CGovernanceManager::ConfirmInventoryRequest(const CInv& inv)
     // do not request objects until it's time to sync
     if (!masternodeSync.IsBlockchainSynced()) return false;
 
-    LOCK(cs);
-
     LogPrint("gobject", "CGovernanceManager::ConfirmInventoryRequest inv = %s\n", inv.ToString());
 
+    boost::shared_lock<boost::shared_mutex> lock(cs_inventory);
+
     // First check if we've already recorded this object
     switch (inv.type) {
     case MSG_GOVERNANCE_OBJECT: {
@@ -720,21 +937,31 @@ bool CGovernanceManager::ConfirmInventoryRequest(const CInv& inv)
     }
 
 
-    hash_s_t* setHash = nullptr;
+    lock.unlock();
+
+    LOCK(cs_requested);
+
+    hash_cm_t* cmapHash = nullptr;
     switch (inv.type) {
     case MSG_GOVERNANCE_OBJECT:
-        setHash = &setRequestedObjects;
+        if (filterRejectedObjects.contains(inv.hash)) {
+            LogPrint("gobject", "CGovernanceManager::ConfirmInventoryRequest recently rejected governance object, returning false\n");
+            return false;
+        }
+        cmapHash = &cmapRequestedObjects;
         break;
     case MSG_GOVERNANCE_OBJECT_VOTE:
-        setHash = &setRequestedVotes;
+        if (filterRejectedVotes.contains(inv.hash)) {
+            LogPrint("gobject", "CGovernanceManager::ConfirmInventoryRequest recently rejected governance vote, returning false\n");
+            return false;
+        }
+        cmapHash = &cmapRequestedVotes;
         break;
     default:
         return false;
     }
 
-    hash_s_cit it = setHash->find(inv.hash);
-    if (it == setHash->end()) {
-        setHash->insert(inv.hash);
+    if (cmapHash->Insert(inv.hash, true)) {
         LogPrint("gobject", "CGovernanceManager::ConfirmInventoryRequest added inv to requested set\n");
     }
 
@@ -772,7 +999,7 @@ void CGovernanceManager::SyncSingleObjVotes(CNode* pnode, const uint256& nProp,
         return;
     }
 
-    auto fileVotes = govobj.GetVoteFile();
+    const auto& fileVotes = govobj.GetVoteFile();
 
     for (const auto& vote : fileVotes.GetVotes()) {
         uint256 nVoteHash = vote.GetHash();
@@ -818,6 +1045,10 @@ void CGovernanceManager::SyncObjects(CNode* pnode, CConnman& connman) const
 
     LOCK2(cs_main, cs);
 
+    // peers that understand digests only ask us for votes they are missing
+    bool fSendDigests = pnode->nVersion >= GOVERNANCE_VOTE_DIGEST_PROTO_VERSION;
+    std::vector<std::pair<uint256, CGovernanceVoteDigest> > vecDigests;
+
     // all valid objects, no votes
     for (const auto& objPair : mapObjects) {
         uint256 nHash = objPair.first;
@@ -836,9 +1067,16 @@ void CGovernanceManager::SyncObjects(CNode* pnode, CConnman& connman) const
         LogPrint("gobject", "CGovernanceManager::%s -- syncing govobj: %s, peer=%d\n", __func__, strHash, pnode->id);
         pnode->PushInventory(CInv(MSG_GOVERNANCE_OBJECT, nHash));
         ++nObjCount;
+
+        if (fSendDigests) {
+            vecDigests.emplace_back(nHash, govobj.GetVoteDigest());
+        }
     }
 
     CNetMsgMaker msgMaker(pnode->GetSendVersion());
+    if (fSendDigests) {
+        connman.PushMessage(pnode, msgMaker.Make(NetMsgType::MNGOVERNANCEVOTEDIGESTS, vecDigests));
+    }
     connman.PushMessage(pnode, msgMaker.Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_GOVOBJ, nObjCount));
     LogPrintf("CGovernanceManager::%s -- sent %d objects to peer=%d\n", __func__, nObjCount, pnode->id);
 }
@@ -935,7 +1173,15 @@ bool CGovernanceManager::MasternodeRateCheck(const CGovernanceObject& govobj, bo
     return false;
 }
 
-bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman& connman)
+bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman& connman, bool fSignatureChecked)
+{
+    TRACE_TIME_START(nTraceStart);
+    bool fOk = ProcessVoteInternal(pfrom, vote, exception, connman, fSignatureChecked);
+    TRACE6(governance, process_vote, vote.GetHash().begin(), vote.GetParentHash().begin(), pfrom ? pfrom->id : -1, fOk, (int)exception.GetType(), TRACE_TIME_ELAPSED(nTraceStart));
+    return fOk;
+}
+
+bool CGovernanceManager::ProcessVoteInternal(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman& connman, bool fSignatureChecked)
 {
     ENTER_CRITICAL_SECTION(cs);
     uint256 nHashVote = vote.GetHash();
@@ -1007,11 +1253,194 @@ bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote,
         }
     }
 
-    bool fOk = govobj.ProcessVote(pfrom, vote, exception, connman) && cmapVoteToObject.Insert(nHashVote, &govobj);
+    bool fOk = govobj.ProcessVote(pfrom, vote, exception, connman, fSignatureChecked);
+    if (fOk) {
+        boost::unique_lock<boost::shared_mutex> lock(cs_inventory);
+        fOk = cmapVoteToObject.Insert(nHashVote, &govobj);
+    }
+    if (fOk) {
+        setDirtyObjects.insert(nHashGovobj);
+    }
     LEAVE_CRITICAL_SECTION(cs);
+    if (fOk) {
+        uiInterface.NotifyGovernanceObjectChanged(nHashGovobj);
+    }
     return fOk;
 }
 
+bool CGovernanceManager::QueuePendingVote(NodeId nodeId, const CGovernanceVote& vote)
+{
+    if (!fVoteVerifyActive) {
+        return false;
+    }
+
+    LOCK(cs_pendingVotes);
+    if (mapPendingVotes.size() >= MAX_PENDING_GOVERNANCE_VOTES) {
+        return false;
+    }
+    mapPendingVotes.emplace(vote.GetHash(), std::make_pair(nodeId, vote));
+    return true;
+}
+
+bool CGovernanceManager::ProcessPendingVotes(CConnman& connman)
+{
+    decltype(mapPendingVotes) pend;
+
+    {
+        LOCK(cs_pendingVotes);
+        pend.swap(mapPendingVotes);
+    }
+
+    if (pend.empty()) {
+        return false;
+    }
+
+    auto mnList = deterministicMNManager->GetListAtChainTip();
+
+    // Votes for unknown objects or from unknown masternodes are not checked here,
+    // ProcessVote turns them into orphans as usual
+    std::unordered_set<uint256> setBadSig;
+    std::unordered_set<uint256> setOperatorSigned;
+    std::vector<std::pair<uint256, std::future<bool>>> vecVotingKeyChecks;
+    CBLSBatchVerifier<NodeId, uint256> batchVerifier(true, true, GOVERNANCE_VOTE_BATCH_SIZE);
+
+    for (const auto& p : pend) {
+        const uint256& nHash = p.first;
+        NodeId nodeId = p.second.first;
+        const CGovernanceVote& vote = p.second.second;
+
+        bool fUseVotingKey;
+        {
+            LOCK(cs);
+            object_m_cit it = mapObjects.find(vote.GetParentHash());
+            if (it == mapObjects.end()) {
+                continue;
+            }
+            fUseVotingKey = it->second.IsVotingKeySignal(vote.GetSignal());
+        }
+
+        auto dmn = mnList.GetMNByCollateral(vote.GetMasternodeOutpoint());
+        if (!dmn) {
+            continue;
+        }
+
+        if (fUseVotingKey) {
+            CKeyID keyIDVoting = dmn->pdmnState->keyIDVoting;
+            vecVotingKeyChecks.emplace_back(nHash, g_workerPool.Push([&vote, keyIDVoting](int) {
+                return vote.CheckSignature(keyIDVoting);
+            }, CWorkerPool::PRIORITY_LOW));
+            continue;
+        }
+
+        CBLSSignature sig;
+        sig.SetBuf(vote.GetSignature());
+        CBLSPublicKey pubKeyOperator = dmn->pdmnState->pubKeyOperator.Get();
+        if (!sig.IsValid() || !pubKeyOperator.IsValid()) {
+            setBadSig.emplace(nHash);
+            continue;
+        }
+        batchVerifier.PushMessage(nodeId, nHash, vote.GetSignatureHash(), sig, pubKeyOperator);
+        setOperatorSigned.emplace(nHash);
+    }
+
+    batchVerifier.Verify();
+
+    for (const auto& hash : batchVerifier.badMessages) {
+        setBadSig.emplace(hash);
+    }
+
+    std::unordered_set<uint256> setVerified;
+    for (auto& check : vecVotingKeyChecks) {
+        if (check.second.get()) {
+            setVerified.emplace(check.first);
+        } else {
+            setBadSig.emplace(check.first);
+        }
+    }
+    for (const auto& hash : setOperatorSigned) {
+        if (!setBadSig.count(hash)) {
+            setVerified.emplace(hash);
+        }
+    }
+
+    for (const auto& p : pend) {
+        const uint256& nHash = p.first;
+        NodeId nodeId = p.second.first;
+        const CGovernanceVote& vote = p.second.second;
+
+        if (setBadSig.count(nHash)) {
+            LogPrintf("CGovernanceManager::%s -- Invalid vote signature, MN outpoint = %s, governance object hash = %s, vote hash = %s, peer=%d\n",
+                __func__, vote.GetMasternodeOutpoint().ToStringShort(), vote.GetParentHash().ToString(), nHash.ToString(), nodeId);
+            {
+                LOCK(cs);
+                AddInvalidVote(vote);
+            }
+            if (masternodeSync.IsSynced()) {
+                LOCK(cs_main);
+                Misbehaving(nodeId, 20);
+            }
+            continue;
+        }
+
+        CNode* pfrom = nullptr;
+        connman.ForNode(nodeId, [&pfrom](CNode* pnode) {
+            pfrom = pnode->AddRef();
+            return true;
+        });
+
+        try {
+            ProcessPeerVote(pfrom, nodeId, vote, connman, setVerified.count(nHash) != 0);
+        } catch (const std::exception& e) {
+            LogPrint("gobject", "CGovernanceManager::%s -- vote %s: %s\n", __func__, nHash.ToString(), e.what());
+        }
+
+        if (pfrom) {
+            pfrom->Release();
+        }
+    }
+
+    return true;
+}
+
+void CGovernanceManager::VoteVerifyThreadMain(CConnman& connman)
+{
+    while (!voteVerifyInterrupt) {
+        if (!ProcessPendingVotes(connman)) {
+            if (!voteVerifyInterrupt.sleep_for(std::chrono::milliseconds(100))) {
+                return;
+            }
+        }
+    }
+}
+
+void CGovernanceManager::StartVoteVerifyThread(CConnman& connman)
+{
+    // can't start new thread if we have one running already
+    if (voteVerifyThread.joinable()) {
+        assert(false);
+    }
+
+    voteVerifyInterrupt.reset();
+    voteVerifyThread = std::thread(&TraceThread<std::function<void()> >, "govvote", std::function<void()>(std::bind(&CGovernanceManager::VoteVerifyThreadMain, this, std::ref(connman))));
+    fVoteVerifyActive = true;
+}
+
+void CGovernanceManager::InterruptVoteVerifyThread()
+{
+    fVoteVerifyActive = false;
+    voteVerifyInterrupt();
+}
+
+void CGovernanceManager::StopVoteVerifyThread()
+{
+    if (voteVerifyThread.joinable()) {
+        voteVerifyThread.join();
+    }
+
+    LOCK(cs_pendingVotes);
+    mapPendingVotes.clear();
+}
+
 void CGovernanceManager::CheckMasternodeOrphanVotes(CConnman& connman)
 {
     LOCK2(cs_main, cs);
@@ -1059,12 +1488,26 @@ void CGovernanceManager::CheckMasternodeOrphanObjects(CConnman& connman)
     }
 }
 
+void CGovernanceManager::AddPostponedObject(const CGovernanceObject& govobj)
+{
+    LOCK(cs);
+    boost::unique_lock<boost::shared_mutex> lock(cs_inventory);
+    if (!mapPostponedObjects.insert(std::make_pair(govobj.GetHash(), govobj)).second) {
+        return;
+    }
+    // the height is learned by the next CheckPostponedObjects
+    LOCK(cs_collaterals);
+    mapPostponedCollaterals[govobj.GetCollateralHash()].nObjects++;
+}
+
 void CGovernanceManager::CheckPostponedObjects(CConnman& connman)
 {
     if (!masternodeSync.IsSynced()) return;
 
     LOCK2(cs_main, cs);
 
+    int nTipHeight = chainActive.Height();
+
     // Check postponed proposals
     for (object_m_it it = mapPostponedObjects.begin(); it != mapPostponedObjects.end();) {
         const uint256& nHash = it->first;
@@ -1072,9 +1515,20 @@ void CGovernanceManager::CheckPostponedObjects(CConnman& connman)
 
         assert(govobj.GetObjectType() != GOVERNANCE_OBJECT_TRIGGER);
 
+        {
+            LOCK(cs_collaterals);
+            const PostponedCollateral& collateral = mapPostponedCollaterals[govobj.GetCollateralHash()];
+            if (collateral.nHeight != -1 && nTipHeight - collateral.nHeight + 1 < GOVERNANCE_FEE_CONFIRMATIONS) {
+                // still mined and not enough confirmations yet, no need to look up the collateral
+                ++it;
+                continue;
+            }
+        }
+
         std::string strError;
         bool fMissingConfirmations;
-        if (govobj.IsCollateralValid(strError, fMissingConfirmations)) {
+        int nConfirmations = 0;
+        if (govobj.IsCollateralValid(strError, fMissingConfirmations, &nConfirmations)) {
             if (govobj.IsValidLocally(strError, false)) {
                 AddGovernanceObject(govobj, connman);
                 AddIPFSHash(govobj);
@@ -1083,12 +1537,23 @@ void CGovernanceManager::CheckPostponedObjects(CConnman& connman)
             }
 
         } else if (fMissingConfirmations) {
-            // wait for more confirmations
+            // wait for more confirmations, SyncTransaction keeps the height up to date from now on
+            LOCK(cs_collaterals);
+            mapPostponedCollaterals[govobj.GetCollateralHash()].nHeight = nTipHeight - nConfirmations + 1;
             ++it;
             continue;
         }
 
+        {
+            LOCK(cs_collaterals);
+            auto itCollateral = mapPostponedCollaterals.find(govobj.GetCollateralHash());
+            if (itCollateral != mapPostponedCollaterals.end() && --itCollateral->second.nObjects <= 0) {
+                mapPostponedCollaterals.erase(itCollateral);
+            }
+        }
+
         // remove processed or invalid object from the queue
+        boost::unique_lock<boost::shared_mutex> lock(cs_inventory);
         mapPostponedObjects.erase(it++);
     }
 
@@ -1162,6 +1627,36 @@ void CGovernanceManager::RequestGovernanceObject(CNode* pfrom, const uint256& nH
     connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MNGOVERNANCESYNC, nHash, filter));
 }
 
+bool CGovernanceManager::HasMatchingVoteDigest(NodeId nodeId, const uint256& nHash)
+{
+    LOCK(cs);
+
+    auto itPeer = mapPeerVoteDigests.find(nodeId);
+    if (itPeer == mapPeerVoteDigests.end()) {
+        // no digests from this peer, ask for the votes with a filter as usual
+        return false;
+    }
+
+    digest_m_t& mapDigests = itPeer->second.second;
+    auto itDigest = mapDigests.find(nHash);
+    if (itDigest == mapDigests.end()) {
+        // the peer didn't list the object so it won't send us any votes for it either
+        return true;
+    }
+
+    bool fMatch = false;
+    object_m_it itObj = mapObjects.find(nHash);
+    if (itObj != mapObjects.end()) {
+        fMatch = itObj->second.GetVoteDigest() == itDigest->second;
+    }
+
+    mapDigests.erase(itDigest);
+    if (mapDigests.empty()) {
+        mapPeerVoteDigests.erase(itPeer);
+    }
+    return fMatch;
+}
+
 int CGovernanceManager::RequestGovernanceObjectVotes(CNode* pnode, CConnman& connman)
 {
     if (pnode->nVersion < MIN_GOVERNANCE_PEER_PROTO_VERSION) return -3;
@@ -1199,6 +1694,15 @@ int CGovernanceManager::RequestGovernanceObjectVotes(const std::vector<CNode*>&
 
         if (mapObjects.empty()) return -2;
 
+        // forget digests we didn't get to use in time, they are outdated by now
+        for (auto it = mapPeerVoteDigests.begin(); it != mapPeerVoteDigests.end(); ) {
+            if (it->second.first + nTimeout < nNow) {
+                mapPeerVoteDigests.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+
         for (const auto& objPair : mapObjects) {
             uint256 nHash = objPair.first;
             if (mapAskedRecently.count(nHash)) {
@@ -1248,15 +1752,20 @@ int CGovernanceManager::RequestGovernanceObjectVotes(const std::vector<CNode*>&
             // only use up to date peers
             if (pnode->nVersion < MIN_GOVERNANCE_PEER_PROTO_VERSION) continue;
             // stop early to prevent setAskFor overflow
-            {
-                LOCK(cs_main);
-                size_t nProjectedSize = pnode->setAskFor.size() + nProjectedVotes;
-                if (nProjectedSize > SETASKFOR_MAX_SZ / 2) continue;
-                // to early to ask the same node
-                if (mapAskedRecently[nHashGovobj].count(pnode->addr)) continue;
+            size_t nProjectedSize = pnode->GetAskForSize() + nProjectedVotes;
+            if (nProjectedSize > SETASKFOR_MAX_SZ / 2) continue;
+            // to early to ask the same node
+            if (mapAskedRecently[nHashGovobj].count(pnode->addr)) continue;
+
+            // nothing to gain from asking a peer holding exactly the votes we have
+            if (HasMatchingVoteDigest(pnode->GetId(), nHashGovobj)) {
+                LogPrint("gobject", "CGovernanceManager::RequestGovernanceObjectVotes -- votes for %s are in sync with peer=%d\n", nHashGovobj.ToString(), pnode->id);
+                mapAskedRecently[nHashGovobj][pnode->addr] = nNow + nTimeout;
+                continue;
             }
 
             RequestGovernanceObject(pnode, nHashGovobj, connman, true);
+            masternodeSync.GovernanceVotesRequested(pnode->GetId());
             mapAskedRecently[nHashGovobj][pnode->addr] = nNow + nTimeout;
             fAsked = true;
             // stop loop if max number of peers per obj was asked
@@ -1278,39 +1787,96 @@ int CGovernanceManager::RequestGovernanceObjectVotes(const std::vector<CNode*>&
 
 bool CGovernanceManager::AcceptObjectMessage(const uint256& nHash)
 {
-    LOCK(cs);
-    return AcceptMessage(nHash, setRequestedObjects);
+    LOCK(cs_requested);
+    return AcceptMessage(nHash, cmapRequestedObjects);
 }
 
 bool CGovernanceManager::AcceptVoteMessage(const uint256& nHash)
 {
-    LOCK(cs);
-    return AcceptMessage(nHash, setRequestedVotes);
+    LOCK(cs_requested);
+    return AcceptMessage(nHash, cmapRequestedVotes);
 }
 
-bool CGovernanceManager::AcceptMessage(const uint256& nHash, hash_s_t& setHash)
+bool CGovernanceManager::AcceptMessage(const uint256& nHash, hash_cm_t& cmapHash)
 {
-    hash_s_it it = setHash.find(nHash);
-    if (it == setHash.end()) {
-        // We never requested this
+    if (!cmapHash.HasKey(nHash)) {
+        // We never requested this (or the request was pruned)
         return false;
     }
     // Only accept one response
-    setHash.erase(it);
+    cmapHash.Erase(nHash);
     return true;
 }
 
-void CGovernanceManager::RebuildIndexes()
+void CGovernanceManager::PageOutVoteFiles()
 {
     LOCK(cs);
 
-    cmapVoteToObject.Clear();
+    if (!pGovernanceDB) {
+        return;
+    }
+
+    int nPagedOut = 0;
     for (auto& objPair : mapObjects) {
         CGovernanceObject& govobj = objPair.second;
-        std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
-        for (size_t i = 0; i < vecVotes.size(); ++i) {
-            cmapVoteToObject.Insert(vecVotes[i].GetHash(), &govobj);
+        // only records kept forever because they are locked, all others are either active or erased soon
+        if (govobj.GetObjectType() != GOVERNANCE_OBJECT_RECORD || !govobj.IsSetRecordLocked() || !govobj.IsSetPermLocked()) {
+            continue;
+        }
+        if (!govobj.IsSetExpired() && !govobj.IsSetCachedDelete() && !govobj.IsSetRecordPastSuperBlock()) {
+            continue;
         }
+        // db must have the current votes
+        if (setDirtyObjects.count(objPair.first) || govobj.IsVoteFilePagedOut()) {
+            continue;
+        }
+        govobj.PageOutVotes(pGovernanceDB);
+        nPagedOut++;
+    }
+
+    if (nPagedOut) {
+        LogPrint("gobject", "CGovernanceManager::%s -- paged out the vote files of %d objects\n", __func__, nPagedOut);
+    }
+}
+
+void CGovernanceManager::RebuildIndexes()
+{
+    LOCK(cs);
+
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_inventory);
+        cmapVoteToObject.Clear();
+        for (auto& objPair : mapObjects) {
+            CGovernanceObject& govobj = objPair.second;
+            for (const auto& nVoteHash : govobj.GetVoteHashes()) {
+                cmapVoteToObject.Insert(nVoteHash, &govobj);
+            }
+        }
+    }
+
+    // The CID index is stored with the cache, only fix up entries which went out of sync
+    hash_s_t setIndexedObjects;
+    auto it = mapIPFSCIDToObject.begin();
+    while (it != mapIPFSCIDToObject.end()) {
+        if (mapObjects.count(it->second)) {
+            setIndexedObjects.insert(it->second);
+            ++it;
+        } else {
+            mapIPFSCIDToObject.erase(it++);
+        }
+    }
+    for (auto& objPair : mapObjects) {
+        if (!setIndexedObjects.count(objPair.first)) {
+            AddIPFSCIDIndex(objPair.second);
+        }
+    }
+
+    setObjectsByTime.clear();
+    mapObjectsByTypeAndTime.clear();
+    setFundedObjects.clear();
+    searchIndex.Clear();
+    for (const auto& objPair : mapObjects) {
+        AddObjectIndexes(objPair.second);
     }
 }
 
@@ -1341,10 +1907,161 @@ void CGovernanceManager::InitOnLoad()
     LogPrintf("Preparing masternode indexes and governance triggers...\n");
     RebuildIndexes();
     AddCachedTriggers();
+    PageOutVoteFiles();
     LogPrintf("Masternode indexes and governance triggers prepared  %dms\n", GetTimeMillis() - nStart);
     LogPrintf("     %s\n", ToString());
 }
 
+void CGovernanceManager::InitDB(bool fWipe)
+{
+    LOCK(cs);
+    pGovernanceDB.reset(new CGovernanceDB(DEFAULT_GOVERNANCE_DB_CACHE, false, fWipe));
+}
+
+void CGovernanceManager::CloseDB()
+{
+    LOCK(cs);
+    pGovernanceDB.reset();
+}
+
+bool CGovernanceManager::LoadFromDB()
+{
+    LOCK(cs);
+
+    if (!pGovernanceDB) {
+        return false;
+    }
+
+    std::string strVersion;
+    std::vector<unsigned char> vchState;
+    if (!pGovernanceDB->ReadVersion(strVersion) || strVersion != SERIALIZATION_VERSION_STRING ||
+        !pGovernanceDB->ReadState(vchState)) {
+        return false;
+    }
+
+    Clear();
+
+    try {
+        CDataStream ss(vchState, SER_DISK, CLIENT_VERSION);
+        UnserializeState(ss);
+    } catch (const std::exception& e) {
+        LogPrintf("CGovernanceManager::%s -- failed to read state: %s\n", __func__, e.what());
+        Clear();
+        return false;
+    }
+
+    // the objects of a snapshot that matches the db are read in place, their vote files stay in the db until needed
+    uint256 nSnapshotId;
+    CGovernanceSnapshot snapshot;
+    bool fFromSnapshot = pGovernanceDB->ReadSnapshotId(nSnapshotId) &&
+                         snapshot.Open(CGovernanceSnapshot::GetDefaultPath(), SERIALIZATION_VERSION_STRING) &&
+                         snapshot.GetId() == nSnapshotId;
+    if (fFromSnapshot) {
+        boost::unique_lock<boost::shared_mutex> lock(cs_inventory);
+        for (size_t i = 0; i < snapshot.GetObjectCount() && fFromSnapshot; i++) {
+            CGovernanceObject govobj;
+            fFromSnapshot = snapshot.ReadObject(i, govobj);
+            if (fFromSnapshot) {
+                govobj.PageOutVotes(pGovernanceDB);
+                mapObjects.emplace(govobj.GetHash(), govobj);
+            }
+        }
+        if (!fFromSnapshot) {
+            mapObjects.clear();
+        }
+    }
+
+    hash_s_t setUncompressed;
+    bool fOk = fFromSnapshot || pGovernanceDB->ForEachObject([&](CGovernanceObject& govobj, bool fUncompressed) {
+        uint256 nHash = govobj.GetHash();
+        if (fUncompressed) {
+            setUncompressed.insert(nHash);
+        }
+        boost::unique_lock<boost::shared_mutex> lock(cs_inventory);
+        mapObjects.emplace(nHash, govobj);
+    });
+    if (!fOk) {
+        Clear();
+        return false;
+    }
+    // objects stored by older versions are written again compressed with the next flush
+    setDirtyObjects = setUncompressed;
+
+    LogPrintf("CGovernanceManager::%s -- loaded %d objects%s\n", __func__, (int)mapObjects.size(), fFromSnapshot ? " from snapshot" : "");
+    return true;
+}
+
+void CGovernanceManager::FlushToDB(bool fFull)
+{
+    LOCK(cs);
+
+    if (!pGovernanceDB) {
+        return;
+    }
+
+    int64_t nTimeStart = GetTimeMillis();
+    CDBBatch batch(pGovernanceDB->GetRawDB());
+    int nWritten = 0;
+    int nErased = 0;
+
+    if (fFull) {
+        for (const auto& objpair : mapObjects) {
+            // paged out vote files are only read from db, which still has the object
+            if (objpair.second.IsVoteFilePagedOut() && !setDirtyObjects.count(objpair.first)) {
+                continue;
+            }
+            CGovernanceDB::WriteObject(batch, objpair.second);
+            nWritten++;
+        }
+    }
+    for (const auto& nHash : setDirtyObjects) {
+        auto it = mapObjects.find(nHash);
+        if (it == mapObjects.end()) {
+            CGovernanceDB::EraseObject(batch, nHash);
+            nErased++;
+        } else if (!fFull) {
+            CGovernanceDB::WriteObject(batch, it->second);
+            nWritten++;
+        }
+    }
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    SerializeState(ss);
+    CGovernanceDB::WriteState(batch, std::vector<unsigned char>(ss.begin(), ss.end()));
+    CGovernanceDB::WriteVersion(batch, SERIALIZATION_VERSION_STRING);
+    // the snapshot no longer matches
+    CGovernanceDB::EraseSnapshotId(batch);
+
+    pGovernanceDB->GetRawDB().WriteBatch(batch, true);
+    setDirtyObjects.clear();
+
+    LogPrint("gobject", "CGovernanceManager::%s -- wrote %d objects, erased %d in %dms\n", __func__, nWritten, nErased, GetTimeMillis() - nTimeStart);
+}
+
+bool CGovernanceManager::WriteSnapshot()
+{
+    LOCK(cs);
+
+    if (!pGovernanceDB) {
+        return false;
+    }
+
+    int64_t nTimeStart = GetTimeMillis();
+    // the snapshot's vote files are read from db
+    FlushToDB();
+
+    uint256 nId = GetRandHash();
+    if (!CGovernanceSnapshot::Write(CGovernanceSnapshot::GetDefaultPath(), nId, SERIALIZATION_VERSION_STRING, mapObjects)) {
+        return false;
+    }
+    CDBBatch batch(pGovernanceDB->GetRawDB());
+    CGovernanceDB::WriteSnapshotId(batch, nId);
+    pGovernanceDB->GetRawDB().WriteBatch(batch, true);
+
+    LogPrintf("CGovernanceManager::%s -- wrote %d objects in %dms\n", __func__, (int)mapObjects.size(), GetTimeMillis() - nTimeStart);
+    return true;
+}
+
 std::string CGovernanceManager::ToString() const
 {
     LOCK(cs);
@@ -1428,6 +2145,13 @@ void CGovernanceManager::UpdatedBlockTip(const CBlockIndex* pindex, CConnman& co
     nCachedBlockHeight = pindex->nHeight;
     LogPrint("gobject", "CGovernanceManager::UpdatedBlockTip -- nCachedBlockHeight: %d\n", nCachedBlockHeight);
 
+    {
+        // objects and votes might have become valid with this block
+        LOCK(cs_requested);
+        filterRejectedObjects.reset();
+        filterRejectedVotes.reset();
+    }
+
     if (deterministicMNManager->IsDIP3Enforced(pindex->nHeight)) {
         RemoveInvalidVotes();
     }
@@ -1437,6 +2161,20 @@ void CGovernanceManager::UpdatedBlockTip(const CBlockIndex* pindex, CConnman& co
     CSuperblockManager::ExecuteBestSuperblock(pindex->nHeight);
 }
 
+void CGovernanceManager::SyncTransaction(const CTransaction& tx, const CBlockIndex* pindex, int posInBlock)
+{
+    if (tx.IsCoinBase()) return;
+
+    LOCK(cs_collaterals);
+
+    auto it = mapPostponedCollaterals.find(tx.GetHash());
+    if (it == mapPostponedCollaterals.end()) return;
+
+    // When tx is 0-confirmed or conflicted, posInBlock is SYNC_TRANSACTION_NOT_IN_BLOCK and the height should be set to -1
+    it->second.nHeight = posInBlock == CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK ? -1 : pindex->nHeight;
+    LogPrint("gobject", "CGovernanceManager::SyncTransaction -- collateral txid=%s, height=%d\n", tx.GetHash().ToString(), it->second.nHeight);
+}
+
 void CGovernanceManager::RequestOrphanObjects(CConnman& connman)
 {
     std::vector<CNode*> vNodesCopy = connman.CopyNodeVector(CConnman::FullyConnectedOnly);
@@ -1521,22 +2259,32 @@ void CGovernanceManager::RemoveInvalidVotes()
                 if (removed.empty()) {
                     continue;
                 }
+                setDirtyObjects.insert(p.first);
                 for (auto& voteHash : removed) {
-                    cmapVoteToObject.Erase(voteHash);
+                    {
+                        boost::unique_lock<boost::shared_mutex> lock(cs_inventory);
+                        cmapVoteToObject.Erase(voteHash);
+                    }
                     cmapInvalidVotes.Erase(voteHash);
                     cmmapOrphanVotes.Erase(voteHash);
-                    setRequestedVotes.erase(voteHash);
+                    LOCK(cs_requested);
+                    cmapRequestedVotes.Erase(voteHash);
                 }
             } else if (p.second.GetObjectType() != GOVERNANCE_OBJECT_RECORD) {
                 auto removed = p.second.RemoveInvalidVotes(outpoint);
                 if (removed.empty()) {
                     continue;
                 }
+                setDirtyObjects.insert(p.first);
                 for (auto& voteHash : removed) {
-                    cmapVoteToObject.Erase(voteHash);
+                    {
+                        boost::unique_lock<boost::shared_mutex> lock(cs_inventory);
+                        cmapVoteToObject.Erase(voteHash);
+                    }
                     cmapInvalidVotes.Erase(voteHash);
                     cmmapOrphanVotes.Erase(voteHash);
-                    setRequestedVotes.erase(voteHash);
+                    LOCK(cs_requested);
+                    cmapRequestedVotes.Erase(voteHash);
                 }
                 
             }            
@@ -1547,25 +2295,54 @@ void CGovernanceManager::RemoveInvalidVotes()
     lastMNListForVotingKeys = curMNList;
 }
 
+std::string CGovernanceManager::GetObjectIPFSCID(CGovernanceObject& govobj)
+{
+    if (govobj.GetObjectType() != GOVERNANCE_OBJECT_RECORD && govobj.GetObjectType() != GOVERNANCE_OBJECT_PROPOSAL) {
+        return "";
+    }
+
+    return govobj.GetPayload()->strIPFSCID;
+}
+
+void CGovernanceManager::AddIPFSCIDIndex(CGovernanceObject& govobj)
+{
+    AssertLockHeld(cs);
+
+    std::string strCID = GetObjectIPFSCID(govobj);
+    if (strCID.empty()) {
+        return;
+    }
+    mapIPFSCIDToObject.emplace(strCID, govobj.GetHash());
+}
+
+void CGovernanceManager::RemoveIPFSCIDIndex(CGovernanceObject& govobj)
+{
+    AssertLockHeld(cs);
+
+    std::string strCID = GetObjectIPFSCID(govobj);
+    if (strCID.empty()) {
+        return;
+    }
+    auto it = mapIPFSCIDToObject.find(strCID);
+    if (it != mapIPFSCIDToObject.end() && it->second == govobj.GetHash()) {
+        mapIPFSCIDToObject.erase(it);
+    }
+}
+
 bool CGovernanceManager::ValidIPFSHash(CGovernanceObject& govobj)
 {
-    ipfs::Client ipfsclient("localhost", 5001);
-    std::string ipfsHash = "empty";
-    try {
-        UniValue Jobj = govobj.GetJSONObject();
-        ipfsHash = Jobj["ipfscid"].get_str();
-        if (ipfsHash.length() < 50) {
-            LogPrintf("MNGOVERNANCEOBJECT::ValidIPFSHash -- Valid IPFS hash\n");
-            return true;
-        } else {
-            LogPrintf("MNGOVERNANCEOBJECT::ValidIPFSHash -- IPFS hash NOT valid\n");
-            return false;
-        }
-    } catch (std::exception& e) {
-        LogPrintf("MNGOVERNANCEOBJECT::ValidIPFSHash -- Could not get IPFS Hash: %s\n", ipfsHash);
+    std::string ipfsHash = govobj.GetPayload()->strIPFSCID;
+    if (ipfsHash.empty()) {
+        LogPrintLimited("gobject", "MNGOVERNANCEOBJECT::ValidIPFSHash -- Could not get IPFS Hash: %s\n", "empty");
+        return false;
+    }
+    if (ipfsHash.length() < 50) {
+        LogPrintLimited("gobject", "MNGOVERNANCEOBJECT::ValidIPFSHash -- Valid IPFS hash\n");
+        return true;
+    } else {
+        LogPrintLimited("gobject", "MNGOVERNANCEOBJECT::ValidIPFSHash -- IPFS hash NOT valid\n");
         return false;
     }
-        
 }
 
 
@@ -1574,7 +2351,7 @@ uint256 CGovernanceManager::CollateralHashBlock(const uint256& nCollateralHash)
     CTransactionRef tx;
     uint256 hashBlock = uint256();
 
-    if (!GetTransaction(nCollateralHash, tx, Params().GetConsensus(), hashBlock, true)) {
+    if (!GetGovernanceCollateral(nCollateralHash, tx, hashBlock)) {
         LogPrintf("CGovernanceManager::CollateralHashBlock -- Can't get transaction\n");
     } else {
         LogPrintf("CGovernanceManager::CollateralHashBlock hashblock: %s\n", hashBlock.ToString());
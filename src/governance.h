@@ -10,11 +10,14 @@
 #include "cachemultimap.h"
 #include "chain.h"
 #include "client.h"
+#include "governance-db.h"
 #include "governance-exceptions.h"
 #include "governance-object.h"
+#include "governance-search.h"
 #include "governance-vote.h"
 #include "net.h"
 #include "sync.h"
+#include "threadinterrupt.h"
 #include "timedata.h"
 #include "util.h"
 
@@ -22,6 +25,13 @@
 
 #include <univalue.h>
 
+#include <boost/thread/shared_mutex.hpp>
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+
 class CGovernanceManager;
 class CGovernanceTriggerManager;
 class CGovernanceObject;
@@ -41,6 +51,11 @@ typedef std::pair<CGovernanceObject, ExpirationInfo> object_info_pair_t;
 
 static const int RATE_BUFFER_SIZE = 5;
 
+/** Number of operator signatures aggregated into one BLS verification */
+static const size_t GOVERNANCE_VOTE_BATCH_SIZE = 32;
+/** Votes queued for signature checks, further votes are processed inline */
+static const size_t MAX_PENDING_GOVERNANCE_VOTES = 10000;
+
 class CRateCheckBuffer
 {
 private:
@@ -209,6 +224,8 @@ public: // Types
 
     typedef hash_s_t::const_iterator hash_s_cit;
 
+    typedef CacheMap<uint256, bool> hash_cm_t;
+
     typedef std::map<uint256, object_info_pair_t> object_info_m_t;
 
     typedef object_info_m_t::iterator object_info_m_it;
@@ -221,9 +238,29 @@ public: // Types
 
     typedef hash_time_m_t::const_iterator hash_time_m_cit;
 
+    typedef std::map<std::string, uint256> cid_hash_m_t;
+
+    typedef std::set<std::pair<int64_t, uint256>> time_hash_s_t;
+
+    typedef std::map<int, time_hash_s_t> type_time_m_t;
+
+    typedef std::map<uint256, CGovernanceVoteDigest> digest_m_t;
+
+    // time received and the per-object vote digests sent by a peer
+    typedef std::map<NodeId, std::pair<int64_t, digest_m_t>> peer_digest_m_t;
+
 private:
     static const int MAX_CACHE_SIZE = 1000000;
 
+    // bound of the requested objects and votes, responses to older requests are dropped as unrequested
+    static const int MAX_REQUESTED_CACHE_SIZE = 100000;
+
+    // size and false positive rate of the filters of recently rejected objects and votes
+    static const int REJECTED_FILTER_ELEMENTS = 50000;
+    static const double REJECTED_FILTER_FP_RATE;
+
+    static const size_t MAX_GOVERNANCE_VOTE_DIGESTS = 100000;
+
     static const std::string SERIALIZATION_VERSION_STRING;
 
     static const int MAX_TIME_FUTURE_DEVIATION;
@@ -248,6 +285,17 @@ private:
     object_m_t mapPostponedObjects;
     hash_s_t setAdditionalRelayObjects;
 
+    struct PostponedCollateral {
+        // height of the block which mined the collateral, -1 while unknown or not mined
+        int nHeight{-1};
+        int nObjects{0};
+    };
+    // collaterals of mapPostponedObjects, their heights are kept up to date by SyncTransaction so that
+    // CheckPostponedObjects only looks up collaterals which have enough confirmations.
+    // Protected by cs_collaterals, which may be taken while holding cs but not the other way around.
+    mutable CCriticalSection cs_collaterals;
+    std::map<uint256, PostponedCollateral> mapPostponedCollaterals;
+
     object_ref_cm_t cmapVoteToObject;
 
     vote_cm_t cmapInvalidVotes;
@@ -256,9 +304,49 @@ private:
 
     txout_m_t mapLastMasternodeObject;
 
-    hash_s_t setRequestedObjects;
+    // protects the requested and rejected objects and votes, never lock cs while holding it
+    mutable CCriticalSection cs_requested;
+
+    hash_cm_t cmapRequestedObjects;
+
+    hash_cm_t cmapRequestedVotes;
+
+    // objects and votes rejected as invalid since the last block, they are not requested again from other peers.
+    // Their validity depends on the chain, so the filters are reset on every new tip. The exact invalid votes
+    // are still kept in cmapInvalidVotes.
+    CRollingBloomFilter filterRejectedObjects;
+
+    CRollingBloomFilter filterRejectedVotes;
+
+    // IPFS CIDs of records and proposals in mapObjects, used for duplicate checks
+    cid_hash_m_t mapIPFSCIDToObject;
 
-    hash_s_t setRequestedVotes;
+    // mapObjects by creation time, by object type and creation time and the objects with fCachedFunding set
+    time_hash_s_t setObjectsByTime;
+    type_time_m_t mapObjectsByTypeAndTime;
+    hash_s_t setFundedObjects;
+
+    // names and descriptions of the proposals and records in mapObjects, only maintained with -govsearchindex
+    bool fSearchIndex;
+    CGovernanceSearchIndex searchIndex;
+
+    // vote digests from the peers we synced the object list from, an entry is
+    // dropped once we decided whether to ask that peer for the object's votes
+    peer_digest_m_t mapPeerVoteDigests;
+
+    // objects added, changed or erased since the last FlushToDB()
+    hash_s_t setDirtyObjects;
+
+    // shared with the objects whose vote files are paged out
+    std::shared_ptr<CGovernanceDB> pGovernanceDB;
+
+    // votes from peers waiting for their signatures to be checked by the vote verification thread
+    mutable CCriticalSection cs_pendingVotes;
+    std::unordered_map<uint256, std::pair<NodeId, CGovernanceVote>> mapPendingVotes;
+
+    std::thread voteVerifyThread;
+    CThreadInterrupt voteVerifyInterrupt;
+    std::atomic<bool> fVoteVerifyActive;
 
     bool fRateChecksEnabled;
 
@@ -289,6 +377,12 @@ public:
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
 
+    // mapObjects, mapPostponedObjects and cmapVoteToObject are only modified while holding
+    // cs and this lock exclusively, so the inventory accessors (HaveObjectForHash,
+    // SerializeVoteForHash etc.) only need a shared lock and don't contend with cs.
+    // Must be taken after cs and never while holding an object's cs.
+    mutable boost::shared_mutex cs_inventory;
+
     CGovernanceManager();
 
     virtual ~CGovernanceManager() {}
@@ -307,11 +401,44 @@ public:
 
     void DoMaintenance(CConnman& connman);
 
+    void StartVoteVerifyThread(CConnman& connman);
+    void InterruptVoteVerifyThread();
+    void StopVoteVerifyThread();
+
     CGovernanceObject* FindGovernanceObject(const uint256& nHash);
 
     // These commands are only used in RPC
     std::vector<CGovernanceVote> GetCurrentVotes(const uint256& nParentHash, const COutPoint& mnCollateralOutpointFilter) const;
-    std::vector<const CGovernanceObject*> GetAllNewerThan(int64_t nMoreThanTime) const;
+    /**
+     * Objects created at or after nMoreThanTime, optionally only those of one type
+     * (GOVERNANCE_OBJECT_UNKNOWN for all types) and only those with fCachedFunding set.
+     * Ordered by creation time.
+     */
+    std::vector<const CGovernanceObject*> GetAllNewerThan(int64_t nMoreThanTime, int nObjectType = GOVERNANCE_OBJECT_UNKNOWN, bool fFundedOnly = false) const;
+
+    /**
+     * Same selection as GetAllNewerThan but starting right after the (creation time, hash)
+     * cursor and returning at most nMaxCount objects accepted by filter.
+     * fMoreRet is set if further matching objects exist after the last one returned.
+     * cs must be held for as long as the returned pointers are used.
+     */
+    std::vector<const CGovernanceObject*> GetPageNewerThan(int64_t nCursorTime, const uint256& nCursorHash, size_t nMaxCount, int nObjectType, bool fFundedOnly,
+                                                           const std::function<bool(const CGovernanceObject&)>& filter, bool& fMoreRet) const;
+
+    /// Start maintaining the search index, indexing the objects known so far
+    void EnableSearchIndex();
+    bool IsSearchIndexEnabled() const { return fSearchIndex; }
+
+    /**
+     * Page through the objects of one type (GOVERNANCE_OBJECT_UNKNOWN for all types) whose names
+     * and descriptions have a word starting with each term of strQuery, like GetPageNewerThan.
+     * Requires the search index to be enabled.
+     */
+    std::vector<const CGovernanceObject*> SearchPage(const std::string& strQuery, int nObjectType, int64_t nCursorTime, const uint256& nCursorHash, size_t nMaxCount,
+                                                     const std::function<bool(const CGovernanceObject&)>& filter, bool& fMoreRet) const;
+
+    /// Called after the object's sentinel variables were updated, cs must be held
+    void UpdateFundingIndex(const CGovernanceObject& govobj);
 
     void AddGovernanceObject(CGovernanceObject& govobj, CConnman& connman, CNode* pfrom = nullptr);
     
@@ -328,17 +455,36 @@ public:
         LOCK(cs);
 
         LogPrint("gobject", "Governance object manager was cleared\n");
-        mapObjects.clear();
+        {
+            boost::unique_lock<boost::shared_mutex> lock(cs_inventory);
+            mapObjects.clear();
+            cmapVoteToObject.Clear();
+        }
         mapErasedGovernanceObjects.clear();
-        cmapVoteToObject.Clear();
         cmapInvalidVotes.Clear();
         cmmapOrphanVotes.Clear();
         mapLastMasternodeObject.clear();
+        mapIPFSCIDToObject.clear();
+        setObjectsByTime.clear();
+        mapObjectsByTypeAndTime.clear();
+        setFundedObjects.clear();
+        searchIndex.Clear();
+        mapPeerVoteDigests.clear();
     }
 
     std::string ToString() const;
     UniValue ToJson() const;
 
+    /// Open the governance database, wiping it if the cache must not be used
+    void InitDB(bool fWipe);
+    void CloseDB();
+    /// Load everything from the governance database, returns false if it's empty or outdated
+    bool LoadFromDB();
+    /// Write objects changed since the last flush (or all of them if fFull) and the rest of the state
+    void FlushToDB(bool fFull = false);
+    /// Write a governance snapshot of the objects in the database, which LoadFromDB() uses until the next flush
+    bool WriteSnapshot();
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
@@ -360,12 +506,20 @@ public:
         READWRITE(mapErasedGovernanceObjects);
         READWRITE(cmapInvalidVotes);
         READWRITE(cmmapOrphanVotes);
-        READWRITE(mapObjects);
+        {
+            boost::unique_lock<boost::shared_mutex> lock(cs_inventory, boost::defer_lock);
+            if (ser_action.ForRead()) {
+                lock.lock();
+            }
+            READWRITE(mapObjects);
+        }
         READWRITE(mapLastMasternodeObject);
         READWRITE(lastMNListForVotingKeys);
+        READWRITE(mapIPFSCIDToObject);
     }
 
     void UpdatedBlockTip(const CBlockIndex* pindex, CConnman& connman);
+    void SyncTransaction(const CTransaction& tx, const CBlockIndex* pindex, int posInBlock);
     int64_t GetLastDiffTime() const { return nTimeLastDiff; }
     void UpdateLastDiffTime(int64_t nTimeIn) { nTimeLastDiff = nTimeIn; }
 
@@ -376,21 +530,18 @@ public:
 
     bool HaveVoteForHash(const uint256& nHash) const;
 
-    int GetVoteCount() const;
+    bool HaveObjectForIPFSCID(const std::string& strCID) const;
 
-    bool SerializeObjectForHash(const uint256& nHash, CDataStream& ss) const;
+    cid_hash_m_t GetIPFSCIDIndex() const;
 
-    bool SerializeVoteForHash(const uint256& nHash, CDataStream& ss) const;
+    int GetVoteCount() const;
 
-    using json = nlohmann::json;
-    template<class UnaryFunction>
-    void RecursiveIPFSIterate(const json& j, UnaryFunction f);
+    // Serialize straight into the payload of a network message, see ProcessGetData
+    bool SerializeObjectForHash(const uint256& nHash, CVectorWriter& ss, bool fCompressed = false) const;
 
-    void AddPostponedObject(const CGovernanceObject& govobj)
-    {
-        LOCK(cs);
-        mapPostponedObjects.insert(std::make_pair(govobj.GetHash(), govobj));
-    }
+    bool SerializeVoteForHash(const uint256& nHash, CVectorWriter& ss) const;
+
+    void AddPostponedObject(const CGovernanceObject& govobj);
 
     void AddSeenGovernanceObject(const uint256& nHash, int status);
 
@@ -411,6 +562,13 @@ public:
         return fOK;
     }
 
+    /**
+     * Process votes which were signed by this node (e.g. gobject vote-many) and relay the accepted ones together.
+     * Their signatures must have been checked already. Returns whether each vote was accepted, exceptionsRet
+     * receives the errors of the others.
+     */
+    std::vector<bool> ProcessLocalVotesAndRelay(const std::vector<CGovernanceVote>& votes, std::vector<CGovernanceException>& exceptionsRet, CConnman& connman);
+
     void CheckMasternodeOrphanVotes(CConnman& connman);
 
     void CheckMasternodeOrphanObjects(CConnman& connman);
@@ -431,9 +589,20 @@ public:
 private:
     void RequestGovernanceObject(CNode* pfrom, const uint256& nHash, CConnman& connman, bool fUseFilter = false);
 
+    /// True if the peer's vote digest for this object shows it has no votes we are missing
+    bool HasMatchingVoteDigest(NodeId nodeId, const uint256& nHash);
+
     void AddInvalidVote(const CGovernanceVote& vote)
     {
         cmapInvalidVotes.Insert(vote.GetHash(), vote);
+        LOCK(cs_requested);
+        filterRejectedVotes.insert(vote.GetHash());
+    }
+
+    void AddRejectedObject(const uint256& nHash)
+    {
+        LOCK(cs_requested);
+        filterRejectedObjects.insert(nHash);
     }
 
     void AddOrphanVote(const CGovernanceVote& vote)
@@ -441,7 +610,21 @@ private:
         cmmapOrphanVotes.Insert(vote.GetHash(), vote_time_pair_t(vote, GetAdjustedTime() + GOVERNANCE_ORPHAN_EXPIRATION_TIME));
     }
 
-    bool ProcessVote(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman& connman);
+    bool ProcessVote(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman& connman, bool fSignatureChecked = false);
+    bool ProcessVoteInternal(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman& connman, bool fSignatureChecked);
+
+    void ProcessMessageInternal(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
+
+    /// Process a vote received from a peer, relay it if it's new and punish the peer if it's invalid
+    void ProcessPeerVote(CNode* pfrom, NodeId nodeId, const CGovernanceVote& vote, CConnman& connman, bool fSignatureChecked = false);
+
+    /// Queue a peer's vote for batched signature verification, false if it must be processed right away
+    bool QueuePendingVote(NodeId nodeId, const CGovernanceVote& vote);
+
+    /// Verify the signatures of all queued votes in batches and process them
+    bool ProcessPendingVotes(CConnman& connman);
+
+    void VoteVerifyThreadMain(CConnman& connman);
 
     /// Called to indicate a requested object has been received
     bool AcceptObjectMessage(const uint256& nHash);
@@ -449,12 +632,15 @@ private:
     /// Called to indicate a requested vote has been received
     bool AcceptVoteMessage(const uint256& nHash);
 
-    static bool AcceptMessage(const uint256& nHash, hash_s_t& setHash);
+    static bool AcceptMessage(const uint256& nHash, hash_cm_t& cmapHash);
 
     void CheckOrphanVotes(CGovernanceObject& govobj, CGovernanceException& exception, CConnman& connman);
 
     void RebuildIndexes();
 
+    /// Pages the vote files of locked records which are no longer active out to db
+    void PageOutVoteFiles();
+
     void AddCachedTriggers();
 
     void RequestOrphanObjects(CConnman& connman);
@@ -462,6 +648,32 @@ private:
     void CleanOrphanObjects();
 
     void RemoveInvalidVotes();
+
+    static std::string GetObjectIPFSCID(CGovernanceObject& govobj);
+
+    void AddIPFSCIDIndex(CGovernanceObject& govobj);
+
+    void AddObjectIndexes(const CGovernanceObject& govobj);
+
+    void RemoveObjectIndexes(const CGovernanceObject& govobj);
+
+    void AddSearchIndex(const CGovernanceObject& govobj);
+
+    template <typename Stream>
+    void SerializeState(Stream& s) const
+    {
+        s << mapErasedGovernanceObjects << cmapInvalidVotes << cmmapOrphanVotes
+          << mapLastMasternodeObject << lastMNListForVotingKeys << mapIPFSCIDToObject;
+    }
+
+    template <typename Stream>
+    void UnserializeState(Stream& s)
+    {
+        s >> mapErasedGovernanceObjects >> cmapInvalidVotes >> cmmapOrphanVotes
+          >> mapLastMasternodeObject >> lastMNListForVotingKeys >> mapIPFSCIDToObject;
+    }
+
+    void RemoveIPFSCIDIndex(CGovernanceObject& govobj);
     
     uint256 CollateralHashBlock(const uint256& nCollateralHash);
 };
@@ -110,6 +110,8 @@ public:
     uint256 GetID() const { return id; }
 
     uint256 GetSeedHash();
+    /* Derive the key of the external or internal chain of an account, i.e. m/purpose'/coin_type'/account'/change */
+    void DeriveChainExtKey(uint32_t nAccountIndex, bool fInternal, CExtKey& extKeyRet);
     void DeriveChildExtKey(uint32_t nAccountIndex, bool fInternal, uint32_t nChildIndex, CExtKey& extKeyRet);
 
     void AddAccount();
@@ -17,6 +17,8 @@
 #include "utilstrencodings.h"
 
 #include <boost/filesystem/operations.hpp>
+#include <map>
+#include <sstream>
 #include <stdio.h>
 
 #include <event2/buffer.h>
@@ -28,6 +30,8 @@
 static const char DEFAULT_RPCCONNECT[] = "127.0.0.1";
 static const int DEFAULT_HTTP_CLIENT_TIMEOUT=900;
 static const bool DEFAULT_NAMED=false;
+static const bool DEFAULT_BATCH=false;
+static const int DEFAULT_BATCH_SIZE=100;
 static const int CONTINUE_EXECUTION=-1;
 
 std::string HelpMessageCli()
@@ -46,6 +50,9 @@ std::string HelpMessageCli()
     strUsage += HelpMessageOpt("-rpcpassword=<pw>", _("Password for JSON-RPC connections"));
     strUsage += HelpMessageOpt("-rpcclienttimeout=<n>", strprintf(_("Timeout in seconds during HTTP requests, or 0 for no timeout. (default: %d)"), DEFAULT_HTTP_CLIENT_TIMEOUT));
     strUsage += HelpMessageOpt("-stdin", _("Read extra arguments from standard input, one per line until EOF/Ctrl-D (recommended for sensitive information such as passphrases)"));
+    strUsage += HelpMessageOpt("-batch", strprintf(_("Read commands from standard input, one per line until EOF/Ctrl-D, as the command and its arguments separated by spaces or as a JSON array of strings. "
+        "They are sent over a single connection and the reply to each is printed as a JSON object on its own line (default: %u)"), DEFAULT_BATCH));
+    strUsage += HelpMessageOpt("-batchsize=<n>", strprintf(_("Send up to <n> commands of -batch in one JSON-RPC batch request (default: %d)"), DEFAULT_BATCH_SIZE));
 
     return strUsage;
 }
@@ -86,7 +93,8 @@ static int AppInitRPC(int argc, char* argv[])
                   "  historia-cli [options] <command> [params]  " + strprintf(_("Send command to %s"), _(PACKAGE_NAME)) + "\n" +
                   "  historia-cli [options] -named <command> [name=value] ... " + strprintf(_("Send command to %s (with named arguments)"), _(PACKAGE_NAME)) + "\n" +
                   "  historia-cli [options] help                " + _("List commands") + "\n" +
-                  "  historia-cli [options] help <command>      " + _("Get help for a command") + "\n";
+                  "  historia-cli [options] help <command>      " + _("Get help for a command") + "\n" +
+                  "  historia-cli [options] -batch              " + _("Send the commands read from standard input") + "\n";
 
             strUsage += "\n" + HelpMessageCli();
         }
@@ -194,73 +202,98 @@ static void http_error_cb(enum evhttp_request_error err, void *ctx)
 }
 #endif
 
-UniValue CallRPC(const std::string& strMethod, const UniValue& params)
+/**
+ * An authenticated HTTP connection to the RPC server. With fKeepAlive the connection is kept open between calls
+ * (libevent reconnects if the server closed it), otherwise the server is asked to close it after the reply
+ */
+class CRPCConnection
 {
-    std::string host = GetArg("-rpcconnect", DEFAULT_RPCCONNECT);
-    int port = GetArg("-rpcport", BaseParams().RPCPort());
+private:
+    const std::string host;
+    const bool fKeepAlive;
+    std::string strRPCUserColonPass;
+    raii_event_base base;
+    raii_evhttp_connection evcon;
+
+public:
+    explicit CRPCConnection(bool fKeepAliveIn) :
+        host(GetArg("-rpcconnect", DEFAULT_RPCCONNECT)),
+        fKeepAlive(fKeepAliveIn)
+    {
+        int port = GetArg("-rpcport", BaseParams().RPCPort());
+
+        // Get credentials
+        if (GetArg("-rpcpassword", "") == "") {
+            // Try fall back to cookie-based authentication if no password is provided
+            if (!GetAuthCookie(&strRPCUserColonPass)) {
+                throw std::runtime_error(strprintf(
+                    _("Could not locate RPC credentials. No authentication cookie could be found, and no rpcpassword is set in the configuration file (%s)"),
+                        GetConfigFile(GetArg("-conf", BITCOIN_CONF_FILENAME)).string().c_str()));
 
-    // Obtain event base
-    raii_event_base base = obtain_event_base();
+            }
+        } else {
+            strRPCUserColonPass = GetArg("-rpcuser", "") + ":" + GetArg("-rpcpassword", "");
+        }
 
-    // Synchronously look up hostname
-    raii_evhttp_connection evcon = obtain_evhttp_connection_base(base.get(), host, port);
-    evhttp_connection_set_timeout(evcon.get(), GetArg("-rpcclienttimeout", DEFAULT_HTTP_CLIENT_TIMEOUT));
+        // Obtain event base
+        base = obtain_event_base();
 
-    HTTPReply response;
-    raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
-    if (req == NULL)
-        throw std::runtime_error("create http request failed");
+        // Synchronously look up hostname
+        evcon = obtain_evhttp_connection_base(base.get(), host, port);
+        evhttp_connection_set_timeout(evcon.get(), GetArg("-rpcclienttimeout", DEFAULT_HTTP_CLIENT_TIMEOUT));
+    }
+
+    /** Sends a serialized JSON-RPC request or batch and returns the parsed reply */
+    UniValue Call(const std::string& strRequest)
+    {
+        HTTPReply response;
+        raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
+        if (req == NULL)
+            throw std::runtime_error("create http request failed");
 #if LIBEVENT_VERSION_NUMBER >= 0x02010300
-    evhttp_request_set_error_cb(req.get(), http_error_cb);
+        evhttp_request_set_error_cb(req.get(), http_error_cb);
 #endif
 
-    // Get credentials
-    std::string strRPCUserColonPass;
-    if (GetArg("-rpcpassword", "") == "") {
-        // Try fall back to cookie-based authentication if no password is provided
-        if (!GetAuthCookie(&strRPCUserColonPass)) {
-            throw std::runtime_error(strprintf(
-                _("Could not locate RPC credentials. No authentication cookie could be found, and no rpcpassword is set in the configuration file (%s)"),
-                    GetConfigFile(GetArg("-conf", BITCOIN_CONF_FILENAME)).string().c_str()));
-
+        struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
+        assert(output_headers);
+        evhttp_add_header(output_headers, "Host", host.c_str());
+        evhttp_add_header(output_headers, "Connection", fKeepAlive ? "keep-alive" : "close");
+        evhttp_add_header(output_headers, "Authorization", (std::string("Basic ") + EncodeBase64(strRPCUserColonPass)).c_str());
+
+        // Attach request data
+        struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
+        assert(output_buffer);
+        evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
+
+        int r = evhttp_make_request(evcon.get(), req.get(), EVHTTP_REQ_POST, "/");
+        req.release(); // ownership moved to evcon in above call
+        if (r != 0) {
+            throw CConnectionFailed("send http request failed");
         }
-    } else {
-        strRPCUserColonPass = GetArg("-rpcuser", "") + ":" + GetArg("-rpcpassword", "");
-    }
 
-    struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
-    assert(output_headers);
-    evhttp_add_header(output_headers, "Host", host.c_str());
-    evhttp_add_header(output_headers, "Connection", "close");
-    evhttp_add_header(output_headers, "Authorization", (std::string("Basic ") + EncodeBase64(strRPCUserColonPass)).c_str());
-
-    // Attach request data
-    std::string strRequest = JSONRPCRequestObj(strMethod, params, 1).write() + "\n";
-    struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
-    assert(output_buffer);
-    evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
-
-    int r = evhttp_make_request(evcon.get(), req.get(), EVHTTP_REQ_POST, "/");
-    req.release(); // ownership moved to evcon in above call
-    if (r != 0) {
-        throw CConnectionFailed("send http request failed");
+        event_base_dispatch(base.get());
+
+        if (response.status == 0)
+            throw CConnectionFailed(strprintf("couldn't connect to server: %s (code %d)\n(make sure server is running and you are connecting to the correct RPC port)", http_errorstring(response.error), response.error));
+        else if (response.status == HTTP_UNAUTHORIZED)
+            throw std::runtime_error("incorrect rpcuser or rpcpassword (authorization failed)");
+        else if (response.status >= 400 && response.status != HTTP_BAD_REQUEST && response.status != HTTP_NOT_FOUND && response.status != HTTP_INTERNAL_SERVER_ERROR)
+            throw std::runtime_error(strprintf("server returned HTTP error %d", response.status));
+        else if (response.body.empty())
+            throw std::runtime_error("no response from server");
+
+        // Parse reply
+        UniValue valReply(UniValue::VSTR);
+        if (!valReply.read(response.body))
+            throw std::runtime_error("couldn't parse reply from server");
+        return valReply;
     }
+};
 
-    event_base_dispatch(base.get());
-
-    if (response.status == 0)
-        throw CConnectionFailed(strprintf("couldn't connect to server: %s (code %d)\n(make sure server is running and you are connecting to the correct RPC port)", http_errorstring(response.error), response.error));
-    else if (response.status == HTTP_UNAUTHORIZED)
-        throw std::runtime_error("incorrect rpcuser or rpcpassword (authorization failed)");
-    else if (response.status >= 400 && response.status != HTTP_BAD_REQUEST && response.status != HTTP_NOT_FOUND && response.status != HTTP_INTERNAL_SERVER_ERROR)
-        throw std::runtime_error(strprintf("server returned HTTP error %d", response.status));
-    else if (response.body.empty())
-        throw std::runtime_error("no response from server");
-
-    // Parse reply
-    UniValue valReply(UniValue::VSTR);
-    if (!valReply.read(response.body))
-        throw std::runtime_error("couldn't parse reply from server");
+UniValue CallRPC(const std::string& strMethod, const UniValue& params)
+{
+    CRPCConnection connection(false);
+    const UniValue valReply = connection.Call(JSONRPCRequestObj(strMethod, params, 1).write() + "\n");
     const UniValue& reply = valReply.get_obj();
     if (reply.empty())
         throw std::runtime_error("expected reply to have result, error and id properties");
@@ -268,6 +301,119 @@ UniValue CallRPC(const std::string& strMethod, const UniValue& params)
     return reply;
 }
 
+/** Splits a -batch line into the command and its arguments, returns false for empty lines */
+static bool ParseBatchLine(const std::string& line, std::vector<std::string>& args)
+{
+    args.clear();
+    size_t nStart = line.find_first_not_of(" \t\r");
+    if (nStart == std::string::npos) {
+        return false;
+    }
+    if (line[nStart] == '[') {
+        // arguments with spaces need the JSON array form
+        UniValue valArgs;
+        if (!valArgs.read(line) || !valArgs.isArray())
+            throw std::runtime_error("couldn't parse command as a JSON array");
+        for (size_t i = 0; i < valArgs.size(); i++) {
+            if (!valArgs[i].isStr())
+                throw std::runtime_error("command and arguments must be strings");
+            args.push_back(valArgs[i].get_str());
+        }
+    } else {
+        std::istringstream stream(line);
+        std::string arg;
+        while (stream >> arg)
+            args.push_back(arg);
+    }
+    if (args.empty())
+        throw std::runtime_error("too few parameters (need at least command)");
+    return true;
+}
+
+/**
+ * Reads commands from stdin and sends them in JSON-RPC batches of up to -batchsize over one connection. The replies
+ * are printed in the order of the commands, with the line number of the command as id. Returns EXIT_FAILURE if any
+ * of the commands failed
+ */
+static int BatchRPC()
+{
+    const bool fNamed = GetBoolArg("-named", DEFAULT_NAMED);
+    const bool fWait = GetBoolArg("-rpcwait", false);
+    const size_t nBatchSize = std::max<int64_t>(GetArg("-batchsize", DEFAULT_BATCH_SIZE), 1);
+
+    CRPCConnection connection(true);
+    int nRet = 0;
+    int64_t nLine = 0;
+    bool fEOF = false;
+    while (!fEOF) {
+        // replies for the lines which couldn't be turned into requests, by id
+        std::map<int64_t, UniValue> mapReplies;
+        std::vector<int64_t> vIds;
+        UniValue batch(UniValue::VARR);
+        std::string line;
+        while (batch.size() < nBatchSize) {
+            if (!std::getline(std::cin, line)) {
+                fEOF = true;
+                break;
+            }
+            nLine++;
+            try {
+                std::vector<std::string> args;
+                if (!ParseBatchLine(line, args))
+                    continue;
+                std::string strMethod = args[0];
+                args.erase(args.begin());
+                UniValue params = fNamed ? RPCConvertNamedValues(strMethod, args) : RPCConvertValues(strMethod, args);
+                batch.push_back(JSONRPCRequestObj(strMethod, params, nLine));
+            } catch (const std::exception& e) {
+                mapReplies.emplace(nLine, JSONRPCReplyObj(NullUniValue, JSONRPCError(RPC_INVALID_PARAMETER, e.what()), nLine));
+            }
+            vIds.push_back(nLine);
+        }
+        if (vIds.empty())
+            continue;
+
+        if (!batch.empty()) {
+            UniValue valReplies;
+            while (true) {
+                try {
+                    valReplies = connection.Call(batch.write() + "\n");
+                } catch (const CConnectionFailed&) {
+                    if (!fWait)
+                        throw;
+                    MilliSleep(1000);
+                    continue;
+                }
+                if (!valReplies.isArray())
+                    throw std::runtime_error("expected reply to be an array of replies");
+                bool fWarmup = false;
+                for (size_t i = 0; i < valReplies.size(); i++) {
+                    const UniValue& error = find_value(valReplies[i], "error");
+                    fWarmup |= error.isObject() && find_value(error, "code").isNum() && find_value(error, "code").get_int() == RPC_IN_WARMUP;
+                }
+                if (!fWait || !fWarmup)
+                    break;
+                MilliSleep(1000);
+            }
+            for (size_t i = 0; i < valReplies.size(); i++) {
+                const UniValue& id = find_value(valReplies[i], "id");
+                if (id.isNum())
+                    mapReplies.emplace(id.get_int64(), valReplies[i]);
+            }
+        }
+
+        for (int64_t nId : vIds) {
+            auto it = mapReplies.find(nId);
+            const UniValue reply = it != mapReplies.end() ? it->second : JSONRPCReplyObj(NullUniValue, JSONRPCError(RPC_MISC_ERROR, "no reply from server"), nId);
+            if (!find_value(reply, "error").isNull())
+                nRet = EXIT_FAILURE;
+            fprintf(stdout, "%s\n", reply.write().c_str());
+        }
+        fflush(stdout);
+    }
+    return nRet;
+}
+
 int CommandLineRPC(int argc, char *argv[])
 {
     std::string strPrint;
@@ -279,6 +425,13 @@ int CommandLineRPC(int argc, char *argv[])
             argv++;
         }
         std::vector<std::string> args = std::vector<std::string>(&argv[1], &argv[argc]);
+        if (GetBoolArg("-batch", DEFAULT_BATCH)) {
+            if (!args.empty())
+                throw std::runtime_error("-batch reads the commands from standard input, none can be passed as parameters");
+            if (GetBoolArg("-stdin", false))
+                throw std::runtime_error("-batch and -stdin can't be used together");
+            return BatchRPC();
+        }
         if (GetBoolArg("-stdin", false)) {
             // Read one arg per line from stdin and append
             std::string line;
@@ -77,10 +77,10 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
     else if (code == RPC_METHOD_NOT_FOUND)
         nStatus = HTTP_NOT_FOUND;
 
-    std::string strReply = JSONRPCReply(NullUniValue, objError, id);
+    UniValue reply = JSONRPCReplyObj(NullUniValue, objError, id);
 
     req->WriteHeader("Content-Type", "application/json");
-    req->WriteReply(nStatus, strReply);
+    req->WriteJSONReply(nStatus, reply);
 }
 
 //This function checks username and password against -rpcauth
@@ -185,7 +185,7 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         // Set the URI
         jreq.URI = req->GetURI();
 
-        std::string strReply;
+        UniValue reply;
         // singleton request
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
@@ -193,16 +193,16 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
             UniValue result = tableRPC.execute(jreq);
 
             // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            reply = JSONRPCReplyObj(result, NullUniValue, jreq.id);
 
         // array of requests
         } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(valRequest.get_array());
+            reply = JSONRPCExecBatch(valRequest.get_array());
         else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
 
         req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strReply);
+        req->WriteJSONReply(HTTP_OK, reply);
     } catch (const UniValue& objError) {
         JSONErrorReply(req, objError, jreq.id);
         return false;
@@ -231,13 +231,70 @@ static bool InitRPCAuthentication()
     return true;
 }
 
+/** Find the method of a single JSON-RPC request without parsing the whole request. Batches aren't looked into. */
+static bool PeekJSONRPCMethod(const char* data, size_t size, std::string& strMethodRet)
+{
+    static const std::string strKey = "\"method\"";
+    const char* end = data + size;
+    const char* p = data;
+    while (p != end && isspace(*p))
+        p++;
+    if (p == end || *p != '{')
+        return false;
+
+    // a string which is "method" and followed by a colon can only be the key
+    while ((p = std::search(p, end, strKey.begin(), strKey.end())) != end) {
+        p += strKey.size();
+        while (p != end && isspace(*p))
+            p++;
+        if (p == end || *p != ':')
+            continue;
+        p++;
+        while (p != end && isspace(*p))
+            p++;
+        if (p == end || *p != '"')
+            return false;
+        const char* begin = ++p;
+        while (p != end && *p != '"' && *p != '\\')
+            p++;
+        if (p == end || *p != '"')
+            return false;
+        strMethodRet.assign(begin, p);
+        return true;
+    }
+    return false;
+}
+
+static HTTPWorkClass HTTPReq_JSONRPCClass(HTTPRequest* req)
+{
+    const char* data;
+    size_t size;
+    std::string strMethod;
+    if (!req->PeekBody(data, size) || !PeekJSONRPCMethod(data, size, strMethod))
+        return HTTP_WORK_DEFAULT;
+
+    const CRPCCommand* pcmd = tableRPC[strMethod];
+    if (!pcmd)
+        return HTTP_WORK_DEFAULT;
+    const std::string& category = pcmd->category;
+    if (category == "mining" || category == "generating")
+        return HTTP_WORK_MINING;
+    if (category == "wallet")
+        return HTTP_WORK_WALLET;
+    if (category == "historia")
+        return HTTP_WORK_GOVERNANCE;
+    if (category == "addressindex" || category == "evo")
+        return HTTP_WORK_INDEX;
+    return HTTP_WORK_DEFAULT;
+}
+
 bool StartHTTPRPC()
 {
     LogPrint("rpc", "Starting HTTP RPC server\n");
     if (!InitRPCAuthentication())
         return false;
 
-    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC, HTTPReq_JSONRPCClass);
 
     assert(EventBase());
     httpRPCTimerInterface = new HTTPRPCTimerInterface(EventBase());
@@ -10,6 +10,9 @@
 
 class HTTPRequest;
 
+/** Default maximum number of outpoints of a /rest/getutxos request, see -restmaxgetutxos */
+static const size_t DEFAULT_REST_MAX_GETUTXOS = 15;
+
 /** Start HTTP RPC subsystem.
  * Precondition; HTTP and RPC has been started.
  */
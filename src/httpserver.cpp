@@ -11,6 +11,9 @@
 #include "rpc/protocol.h" // For HTTP status codes
 #include "sync.h"
 #include "ui_interface.h"
+#include "utilstrencodings.h"
+
+#include <univalue.h>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -21,6 +24,8 @@
 #include <signal.h>
 #include <future>
 
+#include <boost/algorithm/string.hpp>
+
 #include <event2/event.h>
 #include <event2/http.h>
 #include <event2/thread.h>
@@ -58,19 +63,46 @@ private:
     HTTPRequestHandler func;
 };
 
-/** Simple work queue for distributing work over multiple threads.
- * Work items are simply callable objects.
+/** Work queue for distributing work over multiple threads.
+ * Work items are simply callable objects. Items are queued per work class,
+ * each class has its own maximum depth and a limit of threads which may run
+ * its items at the same time. Idle threads pick the oldest item of the class
+ * with the highest priority (lowest index) that is below its limit.
  */
 template <typename WorkItem>
 class WorkQueue
 {
+public:
+    struct ClassStats
+    {
+        size_t maxDepth{0};
+        int maxRunning{0};
+        size_t depth{0};
+        int running{0};
+        uint64_t processed{0};
+        uint64_t rejected{0};
+        int64_t totalWaitMicros{0};
+        int64_t maxWaitMicros{0};
+    };
+
 private:
+    struct QueuedItem
+    {
+        std::unique_ptr<WorkItem> item;
+        int64_t nTimeQueued;
+    };
+
+    struct WorkClass
+    {
+        std::deque<QueuedItem> queue;
+        ClassStats stats;
+    };
+
     /** Mutex protects entire object */
     std::mutex cs;
     std::condition_variable cond;
-    std::deque<std::unique_ptr<WorkItem>> queue;
+    std::vector<WorkClass> classes;
     bool running;
-    size_t maxDepth;
     int numThreads;
 
     /** RAII object to keep track of number of running worker threads */
@@ -91,10 +123,21 @@ private:
         }
     };
 
+    /** Highest priority class with runnable work, -1 if there is none. cs must be held */
+    int NextClass() const
+    {
+        for (size_t c = 0; c < classes.size(); c++) {
+            if (!classes[c].queue.empty() && classes[c].stats.running < classes[c].stats.maxRunning) {
+                return (int)c;
+            }
+        }
+        return -1;
+    }
+
 public:
-    WorkQueue(size_t _maxDepth) : running(true),
-                                 maxDepth(_maxDepth),
-                                 numThreads(0)
+    WorkQueue(size_t numClasses) : classes(numClasses),
+                                   running(true),
+                                   numThreads(0)
     {
     }
     /** Precondition: worker threads have all stopped
@@ -103,15 +146,25 @@ public:
     ~WorkQueue()
     {
     }
+    /** Set the limits of a work class */
+    void SetLimits(size_t c, size_t maxDepth, int maxRunning)
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        classes.at(c).stats.maxDepth = maxDepth;
+        classes.at(c).stats.maxRunning = maxRunning;
+    }
     /** Enqueue a work item */
-    bool Enqueue(WorkItem* item)
+    bool Enqueue(WorkItem* item, size_t c)
     {
         std::unique_lock<std::mutex> lock(cs);
-        if (queue.size() >= maxDepth) {
+        WorkClass& wc = classes.at(c);
+        if (wc.queue.size() >= wc.stats.maxDepth) {
+            wc.stats.rejected++;
             return false;
         }
-        queue.emplace_back(std::unique_ptr<WorkItem>(item));
-        cond.notify_one();
+        wc.queue.emplace_back(QueuedItem{std::unique_ptr<WorkItem>(item), GetTimeMicros()});
+        // other threads might be waiting only because their class is at its limit
+        cond.notify_all();
         return true;
     }
     /** Thread function */
@@ -120,16 +173,28 @@ public:
         ThreadCounter count(*this);
         while (true) {
             std::unique_ptr<WorkItem> i;
+            int c;
             {
                 std::unique_lock<std::mutex> lock(cs);
-                while (running && queue.empty())
+                while (running && (c = NextClass()) < 0)
                     cond.wait(lock);
                 if (!running)
                     break;
-                i = std::move(queue.front());
-                queue.pop_front();
+                WorkClass& wc = classes[c];
+                i = std::move(wc.queue.front().item);
+                int64_t nWait = GetTimeMicros() - wc.queue.front().nTimeQueued;
+                wc.queue.pop_front();
+                wc.stats.running++;
+                wc.stats.processed++;
+                wc.stats.totalWaitMicros += nWait;
+                wc.stats.maxWaitMicros = std::max(wc.stats.maxWaitMicros, nWait);
             }
             (*i)();
+            {
+                std::unique_lock<std::mutex> lock(cs);
+                classes[c].stats.running--;
+                cond.notify_all();
+            }
         }
     }
     /** Interrupt and exit loops */
@@ -152,20 +217,44 @@ public:
     size_t Depth()
     {
         std::unique_lock<std::mutex> lock(cs);
-        return queue.size();
+        size_t depth = 0;
+        for (const WorkClass& wc : classes) {
+            depth += wc.queue.size();
+        }
+        return depth;
+    }
+
+    std::vector<ClassStats> GetStats()
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        std::vector<ClassStats> vStats;
+        for (const WorkClass& wc : classes) {
+            vStats.emplace_back(wc.stats);
+            vStats.back().depth = wc.queue.size();
+        }
+        return vStats;
     }
 };
 
 struct HTTPPathHandler
 {
     HTTPPathHandler() {}
-    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler):
-        prefix(_prefix), exactMatch(_exactMatch), handler(_handler)
+    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler, HTTPWorkClassifier _classifier):
+        prefix(_prefix), exactMatch(_exactMatch), handler(_handler), classifier(_classifier)
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    HTTPWorkClassifier classifier;
+};
+
+static const char* httpWorkClassNames[HTTP_WORK_CLASS_COUNT] = {
+    "mining",
+    "default",
+    "wallet",
+    "governance",
+    "index",
 };
 
 /** HTTP module state */
@@ -178,6 +267,8 @@ struct evhttp* eventHTTP = 0;
 static std::vector<CSubNet> rpc_allow_subnets;
 //! Work queue for handling longer requests off the event loop thread
 static WorkQueue<HTTPClosure>* workQueue = 0;
+//! Number of worker threads, shared by all work classes
+static int rpcThreads = 0;
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
@@ -285,12 +376,14 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
+        HTTPWorkClass workClass = i->classifier ? i->classifier(hreq.get()) : HTTP_WORK_DEFAULT;
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
         assert(workQueue);
-        if (workQueue->Enqueue(item.get()))
+        if (workQueue->Enqueue(item.get(), workClass))
             item.release(); /* if true, queue took ownership */
         else {
-            LogPrintf("WARNING: request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n");
+            LogPrintf("WARNING: request rejected because http work queue depth of class %s exceeded, it can be increased with the -rpcworkqueue= or -rpcworkclass= setting\n",
+                      httpWorkClassNames[workClass]);
             item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
         }
     } else {
@@ -376,6 +469,47 @@ static void libevent_log_cb(int severity, const char *msg)
     //    LogPrint("libevent", "libevent: %s\n", msg);
 }
 
+/** Create the work queue and apply the limits of the work classes, see -rpcworkclass */
+static bool InitHTTPWorkQueue()
+{
+    rpcThreads = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
+    int workQueueDepth = std::max((long)GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
+
+    // slow queries may only occupy a part of the threads by default, so they can't starve the other classes
+    std::vector<std::pair<int, int>> vLimits(HTTP_WORK_CLASS_COUNT, std::make_pair(rpcThreads, workQueueDepth));
+    vLimits[HTTP_WORK_GOVERNANCE].first = std::max(rpcThreads / 4, 1);
+    vLimits[HTTP_WORK_INDEX].first = std::max(rpcThreads / 4, 1);
+
+    if (mapMultiArgs.count("-rpcworkclass")) {
+        for (const std::string& strClass : mapMultiArgs.at("-rpcworkclass")) {
+            std::vector<std::string> vParts;
+            boost::split(vParts, strClass, boost::is_any_of(":"));
+            int c = 0;
+            while (c < HTTP_WORK_CLASS_COUNT && vParts[0] != httpWorkClassNames[c]) {
+                c++;
+            }
+            int nThreads, nDepth;
+            if (c == HTTP_WORK_CLASS_COUNT || vParts.size() < 2 || vParts.size() > 3 ||
+                !ParseInt32(vParts[1], &nThreads) || nThreads < 1 ||
+                (vParts.size() == 3 && (!ParseInt32(vParts[2], &nDepth) || nDepth < 1))) {
+                LogPrintf("Invalid -rpcworkclass=%s\n", strClass);
+                return false;
+            }
+            vLimits[c].first = std::min(nThreads, rpcThreads);
+            if (vParts.size() == 3) {
+                vLimits[c].second = nDepth;
+            }
+        }
+    }
+
+    workQueue = new WorkQueue<HTTPClosure>(HTTP_WORK_CLASS_COUNT);
+    for (int c = 0; c < HTTP_WORK_CLASS_COUNT; c++) {
+        LogPrintf("HTTP: work class %s uses up to %d threads and a queue of depth %d\n", httpWorkClassNames[c], vLimits[c].first, vLimits[c].second);
+        workQueue->SetLimits(c, vLimits[c].second, vLimits[c].first);
+    }
+    return true;
+}
+
 bool InitHTTPServer()
 {
     struct evhttp* http = 0;
@@ -434,10 +568,12 @@ bool InitHTTPServer()
     }
 
     LogPrint("http", "Initialized HTTP server\n");
-    int workQueueDepth = std::max((long)GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
-    LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
+    if (!InitHTTPWorkQueue()) {
+        evhttp_free(http);
+        event_base_free(base);
+        return false;
+    }
 
-    workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
     eventBase = base;
     eventHTTP = http;
     return true;
@@ -449,7 +585,6 @@ std::future<bool> threadResult;
 bool StartHTTPServer()
 {
     LogPrint("http", "Starting HTTP server\n");
-    int rpcThreads = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
     LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
     std::packaged_task<bool(event_base*, evhttp*)> task(ThreadHTTP);
     threadResult = task.get_future();
@@ -571,6 +706,17 @@ std::pair<bool, std::string> HTTPRequest::GetHeader(const std::string& hdr)
         return std::make_pair(false, "");
 }
 
+bool HTTPRequest::PeekBody(const char*& dataRet, size_t& sizeRet)
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return false;
+    sizeRet = evbuffer_get_length(buf);
+    // linearizes the buffer, ReadBody has to do this anyway
+    dataRet = (const char*)evbuffer_pullup(buf, sizeRet);
+    return dataRet != NULL;
+}
+
 std::string HTTPRequest::ReadBody()
 {
     struct evbuffer* buf = evhttp_request_get_input_buffer(req);
@@ -606,10 +752,30 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
 void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
 {
     assert(!replySent && req);
-    // Send event to main http thread to send reply message
     struct evbuffer* evb = evhttp_request_get_output_buffer(req);
     assert(evb);
     evbuffer_add(evb, strReply.data(), strReply.size());
+    SendReply(nStatus);
+}
+
+void HTTPRequest::WriteJSONReply(int nStatus, const UniValue& reply)
+{
+    assert(!replySent && req);
+    struct evbuffer* evb = evhttp_request_get_output_buffer(req);
+    assert(evb);
+    std::string strChunk;
+    strChunk.reserve(REPLY_CHUNK_SIZE + 1024);
+    reply.write(strChunk, [evb](const std::string& s) {
+        evbuffer_add(evb, s.data(), s.size());
+    }, REPLY_CHUNK_SIZE);
+    strChunk += "\n";
+    evbuffer_add(evb, strChunk.data(), strChunk.size());
+    SendReply(nStatus);
+}
+
+void HTTPRequest::SendReply(int nStatus)
+{
+    // Send event to main http thread to send reply message
     HTTPEvent* ev = new HTTPEvent(eventBase, true,
         std::bind(evhttp_send_reply, req, nStatus, (const char*)NULL, (struct evbuffer *)NULL));
     ev->trigger(0);
@@ -657,10 +823,33 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod()
     }
 }
 
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPWorkClassifier &classifier)
 {
     LogPrint("http", "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
-    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
+    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler, classifier));
+}
+
+std::vector<HTTPWorkClassStats> GetHTTPWorkClassStats()
+{
+    std::vector<HTTPWorkClassStats> vRet;
+    if (!workQueue) {
+        return vRet;
+    }
+    std::vector<WorkQueue<HTTPClosure>::ClassStats> vStats = workQueue->GetStats();
+    for (size_t c = 0; c < vStats.size(); c++) {
+        HTTPWorkClassStats stats;
+        stats.name = httpWorkClassNames[c];
+        stats.maxThreads = vStats[c].maxRunning;
+        stats.maxDepth = vStats[c].maxDepth;
+        stats.depth = vStats[c].depth;
+        stats.running = vStats[c].running;
+        stats.processed = vStats[c].processed;
+        stats.rejected = vStats[c].rejected;
+        stats.totalWaitMicros = vStats[c].totalWaitMicros;
+        stats.maxWaitMicros = vStats[c].maxWaitMicros;
+        vRet.emplace_back(stats);
+    }
+    return vRet;
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
@@ -8,6 +8,7 @@
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <vector>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
@@ -17,6 +18,7 @@ struct evhttp_request;
 struct event_base;
 class CService;
 class HTTPRequest;
+class UniValue;
 
 /** Initialize HTTP server.
  * Call this before RegisterHTTPHandler or EventBase().
@@ -32,16 +34,47 @@ void InterruptHTTPServer();
 /** Stop HTTP server */
 void StopHTTPServer();
 
+/** Classes of work, in order of priority. Requests of each class are queued
+ * separately and may only use a limited number of the worker threads.
+ */
+enum HTTPWorkClass {
+    HTTP_WORK_MINING,
+    HTTP_WORK_DEFAULT,
+    HTTP_WORK_WALLET,
+    HTTP_WORK_GOVERNANCE,
+    HTTP_WORK_INDEX,
+    HTTP_WORK_CLASS_COUNT
+};
+
 /** Handler for requests to a certain HTTP path */
 typedef std::function<bool(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
+/** Picks the work class of a request, called on the event loop thread before the request is queued */
+typedef std::function<HTTPWorkClass(HTTPRequest* req)> HTTPWorkClassifier;
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
- * be invoked.
+ * be invoked. Requests are queued as HTTP_WORK_DEFAULT if there is no classifier.
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPWorkClassifier &classifier = nullptr);
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
+struct HTTPWorkClassStats
+{
+    std::string name;
+    int maxThreads;
+    size_t maxDepth;
+    size_t depth;
+    int running;
+    uint64_t processed;
+    uint64_t rejected;
+    /** Time requests spent in the queue before a thread picked them up */
+    int64_t totalWaitMicros;
+    int64_t maxWaitMicros;
+};
+
+/** Return the limits and queue statistics of all work classes */
+std::vector<HTTPWorkClassStats> GetHTTPWorkClassStats();
+
 /** Return evhttp event base. This can be used by submodules to
  * queue timers or custom events.
  */
@@ -53,9 +86,14 @@ struct event_base* EventBase();
 class HTTPRequest
 {
 private:
+    /** Size of the pieces JSON replies are added to the output buffer in */
+    static const size_t REPLY_CHUNK_SIZE = 64 * 1024;
+
     struct evhttp_request* req;
     bool replySent;
 
+    void SendReply(int nStatus);
+
 public:
     HTTPRequest(struct evhttp_request* req);
     ~HTTPRequest();
@@ -86,6 +124,12 @@ public:
      */
     std::pair<bool, std::string> GetHeader(const std::string& hdr);
 
+    /**
+     * Get the request body without consuming it, for HTTPWorkClassifier.
+     * Returns false if there is none.
+     */
+    bool PeekBody(const char*& dataRet, size_t& sizeRet);
+
     /**
      * Read request body.
      *
@@ -110,6 +154,14 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Write a JSON reply followed by a newline. The reply is serialized into
+     * the output buffer in chunks, without building the whole string first.
+     *
+     * @note Same restrictions as WriteReply.
+     */
+    void WriteJSONReply(int nStatus, const UniValue& reply);
 };
 
 /** Event handler closure.
@@ -18,6 +18,7 @@
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "compat/sanity.h"
+#include "crypto/sha256.h"
 #include "consensus/validation.h"
 #include "httpserver.h"
 #include "httprpc.h"
@@ -36,11 +37,13 @@
 #include "timedata.h"
 #include "txdb.h"
 #include "txmempool.h"
+#include "txvalidationcache.h"
 #include "torcontrol.h"
 #include "ui_interface.h"
 #include "util.h"
 #include "utilmoneystr.h"
 #include "validationinterface.h"
+#include "workerpool.h"
 #ifdef ENABLE_WALLET
 #include "wallet/wallet.h"
 #endif
@@ -49,7 +52,12 @@
 #include "dsnotificationinterface.h"
 #include "flat-database.h"
 #include "governance.h"
+#include "governance-collateral.h"
+#include "governance-snapshot.h"
 #include "instantx.h"
+#include "ipfs-clientpool.h"
+#include "ipfs-health.h"
+#include "ipfs-pinning.h"
 #ifdef ENABLE_WALLET
 #include "keepass.h"
 #endif
@@ -67,15 +75,20 @@
 #include "warnings.h"
 
 #include "evo/deterministicmns.h"
+#include "evo/protxsigcache.h"
 #include "llmq/quorums_init.h"
+#include "llmq/quorums_signing.h"
+#include "llmq/quorums_signing_shares.h"
 
 #include "llmq/quorums_init.h"
 
 #include <stdint.h>
 #include <stdio.h>
+#include <future>
 #include <memory>
 
 #include "bls/bls.h"
+#include "bls/bls_sigcache.h"
 
 #ifndef WIN32
 #include <signal.h>
@@ -93,6 +106,7 @@
 #include <openssl/crypto.h>
 
 #if ENABLE_ZMQ
+#include "zmq/zmqabstractnotifier.h"
 #include "zmq/zmqnotificationinterface.h"
 #endif
 
@@ -202,6 +216,8 @@ public:
 };
 
 static CCoinsViewErrorCatcher *pcoinscatcher = NULL;
+static int nWorkerThreads = 0;
+static int nSchedulerThreads = DEFAULT_SCHEDULER_THREADS;
 static std::unique_ptr<ECCVerifyHandle> globalVerifyHandle;
 
 void Interrupt(boost::thread_group& threadGroup)
@@ -212,6 +228,10 @@ void Interrupt(boost::thread_group& threadGroup)
     InterruptREST();
     InterruptTorControl();
     llmq::InterruptLLMQSystem();
+    ipfsPinManager.InterruptWorkerThreads();
+    ipfsHealthMonitor.InterruptWorkerThread();
+    ipfsClientPool.Interrupt();
+    governance.InterruptVoteVerifyThread();
     if (g_connman)
         g_connman->Interrupt();
     threadGroup.interrupt_all();
@@ -236,7 +256,16 @@ void PrepareShutdown()
     StopREST();
     StopRPC();
     StopHTTPServer();
+    g_scheduler = nullptr;
     llmq::StopLLMQSystem();
+    ipfsPinManager.StopWorkerThreads();
+    ipfsPinManager.CloseDB();
+    ipfsHealthMonitor.StopWorkerThread();
+    ipfsClientPool.Stop();
+    governance.StopVoteVerifyThread();
+    proTxSigCache.Stop();
+    // after all subsystems which wait for jobs of the pool are stopped
+    g_workerPool.Stop();
 
     // fRPCInWarmup should be `false` if we completed the loading sequence
     // before a shutdown request was received
@@ -255,6 +284,7 @@ void PrepareShutdown()
     MapPort(false);
     UnregisterValidationInterface(peerLogic.get());
     peerLogic.reset();
+    StopMessageLaneThreads();
     if (g_connman) {
         // make sure to stop all threads before g_connman is reset to nullptr as these threads might still be accessing it
         g_connman->Stop();
@@ -265,8 +295,14 @@ void PrepareShutdown()
         // STORE DATA CACHES INTO SERIALIZED DAT FILES
         CFlatDB<CMasternodeMetaMan> flatdb1("mncache.dat", "magicMasternodeCache");
         flatdb1.Dump(mmetaman);
-        CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
-        flatdb3.Dump(governance);
+        governance.FlushToDB(true);
+        if (GetBoolArg("-govsnapshot", DEFAULT_GOVERNANCE_SNAPSHOT)) {
+            governance.WriteSnapshot();
+        } else {
+            boost::system::error_code ec;
+            boost::filesystem::remove(CGovernanceSnapshot::GetDefaultPath(), ec);
+        }
+        governance.CloseDB();
         CFlatDB<CNetFulfilledRequestManager> flatdb4("netfulfilled.dat", "magicFulfilledCache");
         flatdb4.Dump(netfulfilledman);
         if(fEnableInstantSend)
@@ -293,19 +329,33 @@ void PrepareShutdown()
         fFeeEstimatesInitialized = false;
     }
 
+    StopIndexBuilderThread();
+
     {
         LOCK(cs_main);
         if (pcoinsTip != NULL) {
             FlushStateToDisk();
         }
+        StopIndexWriterThread();
         delete pcoinsTip;
         pcoinsTip = NULL;
         delete pcoinscatcher;
         pcoinscatcher = NULL;
+        // waits for a flush which might still be in progress
+        delete pcoinsdbflusher;
+        pcoinsdbflusher = NULL;
         delete pcoinsdbview;
         pcoinsdbview = NULL;
         delete pblocktree;
         pblocktree = NULL;
+        delete paddressindexdb;
+        paddressindexdb = NULL;
+        delete pspentindexdb;
+        pspentindexdb = NULL;
+        delete ptimestampindexdb;
+        ptimestampindexdb = NULL;
+        delete pblockfilterindexdb;
+        pblockfilterindexdb = NULL;
         llmq::DestroyLLMQSystem();
         delete deterministicMNManager;
         deterministicMNManager = NULL;
@@ -372,6 +422,7 @@ void Shutdown()
     globalVerifyHandle.reset();
     ECC_Stop();
     LogPrintf("%s: done\n", __func__);
+    StopLogWriterThread();
 }
 
 /**
@@ -435,6 +486,7 @@ std::string HelpMessage(HelpMessageMode mode)
     if (showDebug)
         strUsage += HelpMessageOpt("-blocksonly", strprintf(_("Whether to operate in a blocks only mode (default: %u)"), DEFAULT_BLOCKSONLY));
     strUsage +=HelpMessageOpt("-assumevalid=<hex>", strprintf(_("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)"), Params(CBaseChainParams::MAIN).GetConsensus().defaultAssumeValid.GetHex(), Params(CBaseChainParams::TESTNET).GetConsensus().defaultAssumeValid.GetHex()));
+    strUsage += HelpMessageOpt("-chainlockassumevalid", strprintf(_("Skip the script verification of blocks which are ancestors of a verified ChainLock (default: %u)"), DEFAULT_CHAINLOCK_ASSUMEVALID));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file (default: %s)"), BITCOIN_CONF_FILENAME));
     if (mode == HMM_BITCOIND)
     {
@@ -443,7 +495,11 @@ std::string HelpMessage(HelpMessageMode mode)
 #endif
     }
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
+    strUsage += HelpMessageOpt("-blockfilemmap", strprintf(_("Read blocks and undo data through memory mapped block files, not supported on Windows (default: %u)"), DEFAULT_BLOCKFILE_MMAP));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-dbprofile=<name>:<key>=<value>", _("Tune the LevelDB database <name> (chainstate, blockindex, evodb, llmq, governance, addressindex, spentindex, timestampindex, blockfilterindex), <key> is one of blockcache (percentage of its cache), filterbits (bloom filter bits per key, 0 for none), compression (0 or 1) and blocksize (in kilobytes). Can be specified multiple times"));
+    strUsage += HelpMessageOpt("-dmncachemb=<n>", strprintf(_("Set the memory limit for cached masternode lists of older blocks in megabytes, see getmemoryinfo (default: %u)"), DEFAULT_DMN_CACHE_MB));
+    strUsage += HelpMessageOpt("-dmnlistcachedepth=<n>", strprintf(_("Keep the masternode lists of the last <n> blocks in memory (default: %u)"), DEFAULT_DMN_LIST_CACHE_DEPTH));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file on startup"));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-maxmempool=<n>", strprintf(_("Keep the transaction memory pool below <n> megabytes (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE));
@@ -451,10 +507,16 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-blockreconstructionextratxn=<n>", strprintf(_("Extra transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-batchsigverify", strprintf(_("Verify the signatures of parallel pay-to-pubkey(-hash) script checks in batches (default: %u)"), DEFAULT_BATCH_SIG_VERIFY));
+    strUsage += HelpMessageOpt("-mempoolparallelinputs=<n>", strprintf(_("Check the scripts of transactions with at least <n> inputs on the script verification threads when adding them to the mempool (0 = never, default: %u)"), DEFAULT_MEMPOOL_PARALLEL_INPUTS));
+    strUsage += HelpMessageOpt("-workerthreads=<n>", strprintf(_("Set the number of threads shared by BLS, LLMQ, governance and ProTx signature jobs (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+        -GetNumCores(), MAX_WORKER_THREADS, DEFAULT_WORKER_THREADS));
+    strUsage += HelpMessageOpt("-schedulerthreads=<n>", strprintf(_("Set the number of task scheduler threads, all but the first one only run time critical tasks like chainlock processing (1 to %d, default: %d)"),
+        MAX_SCHEDULER_THREADS, DEFAULT_SCHEDULER_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), BITCOIN_PID_FILENAME));
 #endif
-    strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
+    strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan, governance collaterals are kept in their own index instead. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >%u = automatically prune block files to stay under the specified target size in MiB)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
     strUsage += HelpMessageOpt("-reindex-chainstate", _("Rebuild chain state from the currently indexed blocks"));
@@ -463,10 +525,13 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
     strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), DEFAULT_TXINDEX));
+    strUsage += HelpMessageOpt("-govsearchindex", strprintf(_("Maintain a search index over the names and descriptions of governance proposals and records, used by the gobject search rpc call (default: %u)"), DEFAULT_GOVERNANCE_SEARCH_INDEX));
+    strUsage += HelpMessageOpt("-govsnapshot", strprintf(_("Write a memory mapped snapshot of the governance objects on shutdown to speed up the next start (default: %u)"), DEFAULT_GOVERNANCE_SNAPSHOT));
 
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
     strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
+    strUsage += HelpMessageOpt("-blockfilterindex", strprintf(_("Maintain the BIP158 basic block filters, used by the getblockfilter rpc call and -peerblockfilters (default: %u)"), DEFAULT_BLOCKFILTERINDEX));
 
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open"));
@@ -486,17 +551,25 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXRECEIVEBUFFER));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXSENDBUFFER));
     strUsage += HelpMessageOpt("-maxtimeadjustment", strprintf(_("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by peers forward or backward by this amount. (default: %u seconds)"), DEFAULT_MAX_TIME_ADJUSTMENT));
+    strUsage += HelpMessageOpt("-mnpushrelay", strprintf(_("When running as a masternode, push blocks, ISLOCKs and CLSIGs to MNAUTH verified masternode peers instead of announcing them (default: %u)"), DEFAULT_MASTERNODE_PUSH_RELAY));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), DEFAULT_PERMIT_BAREMULTISIG));
     strUsage += HelpMessageOpt("-peerbloomfilters", strprintf(_("Support filtering of blocks and transaction with bloom filters (default: %u)"), DEFAULT_PEERBLOOMFILTERS));
+    strUsage += HelpMessageOpt("-peerblockfilters", strprintf(_("Serve compact block filters to peers as described in BIP157, requires -blockfilterindex (default: %u)"), DEFAULT_PEERBLOCKFILTERS));
     strUsage += HelpMessageOpt("-port=<port>", strprintf(_("Listen for connections on <port> (default: %u or testnet: %u)"), Params(CBaseChainParams::MAIN).GetDefaultPort(), Params(CBaseChainParams::TESTNET).GetDefaultPort()));
     strUsage += HelpMessageOpt("-proxy=<ip:port>", _("Connect through SOCKS5 proxy"));
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf(_("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)"), DEFAULT_PROXYRANDOMIZE));
     strUsage += HelpMessageOpt("-seednode=<ip>", _("Connect to a node to retrieve peer addresses, and disconnect"));
+#ifdef HAVE_SYS_EPOLL_H
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("Socket events mode, which must be one of: %s (default: %s)"), "select, epoll", DEFAULT_SOCKETEVENTS));
+#else
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("Socket events mode, which must be one of: %s (default: %s)"), "select", DEFAULT_SOCKETEVENTS));
+#endif
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf(_("Tor control port to use if onion listening enabled (default: %s)"), DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", _("Tor control port password (default: empty)"));
+    strUsage += HelpMessageOpt("-txreconciliation", strprintf(_("Announce transactions and governance votes by set reconciliation to peers supporting it (default: %u)"), DEFAULT_TXRECONCILIATION));
 #ifdef USE_UPNP
 #if USE_UPNP
     strUsage += HelpMessageOpt("-upnp", _("Use UPnP to map the listening port (default: 1 when listening and no -proxy)"));
@@ -529,6 +602,12 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtxlock=<address>", _("Enable publish raw transaction (locked via InstantSend) in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawinstantsenddoublespend=<address>", _("Enable publish raw transactions of attempted InstantSend double spend in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubrawmnlistdiff=<address>", _("Enable publish the masternode list changes of each block in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubrawipfspin=<address>", _("Enable publish IPFS CIDs of governance objects after they were pinned in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubrawipfsunpin=<address>", _("Enable publish IPFS CIDs after they were unpinned in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubrawipfspinfailure=<address>", _("Enable publish IPFS CIDs which could not be pinned in <address>"));
+    strUsage += HelpMessageOpt("-zmqpub<type>hwm=<n>", strprintf(_("Set the outbound message high water mark of the <type> topic, which also limits the messages waiting to be sent (0 = unlimited, default: %d)"), DEFAULT_ZMQ_SNDHWM));
+    strUsage += HelpMessageOpt("-zmqpub<type>droppolicy=<policy>", _("Messages of the <type> topic to drop when its high water mark is reached, <policy> is newest or oldest (default: newest)"));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
@@ -550,10 +629,12 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-limitdescendantcount=<n>", strprintf("Do not accept transactions if any ancestor would have <n> or more in-mempool descendants (default: %u)", DEFAULT_DESCENDANT_LIMIT));
         strUsage += HelpMessageOpt("-limitdescendantsize=<n>", strprintf("Do not accept transactions if any ancestor would have more than <n> kilobytes of in-mempool descendants (default: %u).", DEFAULT_DESCENDANT_SIZE_LIMIT));
         strUsage += HelpMessageOpt("-bip9params=<deployment>:<start>:<end>(:<window>:<threshold>)", "Use given start/end times for specified BIP9 deployment (regtest-only). Specifying window and threshold is optional.");
+        strUsage += HelpMessageOpt("-llmqsigsharefanout=<n>", strprintf("Announce every LLMQ sig share to at most <n> intra-quorum connections, chosen per share, 0 for all (default: %u)", llmq::DEFAULT_SIGSHARES_FANOUT));
         strUsage += HelpMessageOpt("-watchquorums=<n>", strprintf("Watch and validate quorum communication (default: %u)", llmq::DEFAULT_WATCH_QUORUMS));
+        strUsage += HelpMessageOpt("-recsigscachesize=<n>", strprintf("Minimum number of entries in each of the recovered signature caches (default: %u)", llmq::DEFAULT_RECOVERED_SIGS_CACHE_SIZE));
     }
     std::string debugCategories = "addrman, alert, bench, cmpctblock, coindb, db, http, leveldb, libevent, lock, mempool, mempoolrej, net, proxy, prune, rand, reindex, rpc, selectcoins, tor, zmq, "
-                                  "historia (or specifically: chainlocks, gobject, instantsend, keepass, llmq, llmq-dkg, llmq-sigs, masternode, mnpayments, mnsync, privatesend, spork)"; // Don't translate these and qt below
+                                  "historia (or specifically: chainlocks, gobject, instantsend, ipfs, keepass, llmq, llmq-dkg, llmq-sigs, masternode, mnpayments, mnsync, privatesend, spork)"; // Don't translate these and qt below
     if (mode == HMM_BITCOIN_QT)
         debugCategories += ", qt";
     strUsage += HelpMessageOpt("-debug=<category>", strprintf(_("Output debugging information (default: %u, supplying <category> is optional)"), 0) + ". " +
@@ -563,12 +644,16 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-help-debug", _("Show all debugging options (usage: --help -help-debug)"));
     strUsage += HelpMessageOpt("-logips", strprintf(_("Include IP addresses in debug output (default: %u)"), DEFAULT_LOGIPS));
     strUsage += HelpMessageOpt("-logtimestamps", strprintf(_("Prepend debug output with timestamp (default: %u)"), DEFAULT_LOGTIMESTAMPS));
+    if (showDebug)
+        strUsage += HelpMessageOpt("-logasync", strprintf("Write debug.log from a background thread (default: %u)", DEFAULT_LOGASYNC));
     if (showDebug)
     {
         strUsage += HelpMessageOpt("-logtimemicros", strprintf("Add microsecond precision to debug timestamps (default: %u)", DEFAULT_LOGTIMEMICROS));
         strUsage += HelpMessageOpt("-logthreadnames", strprintf("Add thread names to debug messages (default: %u)", DEFAULT_LOGTHREADNAMES));
         strUsage += HelpMessageOpt("-mocktime=<n>", "Replace actual time with <n> seconds since epoch (default: 0)");
         strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-blssigcachesize=<n>", strprintf("Limit size of BLS signature cache to <n> MiB (default: %u)", DEFAULT_MAX_BLS_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-txvalidationcachesize=<n>", strprintf("Limit size of the cache of transactions validated in the mempool to <n> MiB (default: %u)", DEFAULT_MAX_TX_VALIDATION_CACHE_SIZE));
         strUsage += HelpMessageOpt("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE));
     }
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf(_("Fees (in %s/kB) smaller than this are considered zero fee for relaying, mining and transaction creation (default: %s)"),
@@ -591,6 +676,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-masternode", strprintf(_("Enable the client to act as a masternode (0-1, default: %u)"), 0));
     strUsage += HelpMessageOpt("-masternodeblsprivkey=<hex>", _("Set the masternode BLS private key"));
     strUsage += HelpMessageOpt("-masternodecollateral=<n>", _("Set the masternode collateral type (100 or 5000)"));
+    strUsage += HelpMessageOpt("-ipfsapi=<host:port>", strprintf(_("Connect to the IPFS daemon API at <host:port> (default: %s)"), DEFAULT_IPFS_API));
+    strUsage += HelpMessageOpt("-ipfspinthreads=<n>", strprintf(_("Set the number of threads used to pin governance IPFS content (1-%d, default: %d)"), MAX_IPFS_PIN_THREADS, DEFAULT_IPFS_PIN_THREADS));
+    strUsage += HelpMessageOpt("-ipfsreplicas=<n>", strprintf(_("Only pin the governance IPFS content assigned to this masternode, each CID is pinned by <n> high-collateral masternodes (0 = pin everything, default: %d)"), DEFAULT_IPFS_REPLICAS));
 
 #ifdef ENABLE_WALLET
     strUsage += HelpMessageGroup(_("PrivateSend options:"));
@@ -624,10 +712,12 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-blockmintxfee=<amt>", strprintf(_("Set lowest fee rate (in %s/kB) for transactions to be included in block creation. (default: %s)"), CURRENCY_UNIT, FormatMoney(DEFAULT_BLOCK_MIN_TX_FEE)));
     if (showDebug)
         strUsage += HelpMessageOpt("-blockversion=<n>", "Override block version to test forking scenarios");
+    strUsage += HelpMessageOpt("-genproclimit=<n>", strprintf(_("Set the number of threads generate hashes with, <= 0 uses one per core (default: %d)"), DEFAULT_GENERATE_THREADS));
 
     strUsage += HelpMessageGroup(_("RPC server options:"));
     strUsage += HelpMessageOpt("-server", _("Accept command line and JSON-RPC commands"));
     strUsage += HelpMessageOpt("-rest", strprintf(_("Accept public REST requests (default: %u)"), DEFAULT_REST_ENABLE));
+    strUsage += HelpMessageOpt("-restmaxgetutxos=<n>", strprintf(_("Maximum number of outpoints of a REST getutxos request (default: %u)"), DEFAULT_REST_MAX_GETUTXOS));
     strUsage += HelpMessageOpt("-rpcbind=<addr>[:port]", _("Bind to given address to listen for JSON-RPC connections. This option is ignored unless -rpcallowip is also passed. Port is optional and overrides -rpcport. Use [host]:port notation for IPv6. This option can be specified multiple times (default: 127.0.0.1 and ::1 i.e., localhost, or if -rpcallowip has been specified, 0.0.0.0 and :: i.e., all addresses)"));
     strUsage += HelpMessageOpt("-rpccookiefile=<loc>", _("Location of the auth cookie (default: data dir)"));
     strUsage += HelpMessageOpt("-rpcuser=<user>", _("Username for JSON-RPC connections"));
@@ -636,8 +726,10 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf(_("Listen for JSON-RPC connections on <port> (default: %u or testnet: %u)"), BaseParams(CBaseChainParams::MAIN).RPCPort(), BaseParams(CBaseChainParams::TESTNET).RPCPort()));
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
+    strUsage += HelpMessageOpt("-rpcbatchtimebudget=<n>", strprintf(_("Fail the calls of a JSON-RPC batch which didn't start within <n> milliseconds, 0 for no limit (default: %d)"), DEFAULT_RPC_BATCH_TIME_BUDGET));
+    strUsage += HelpMessageOpt("-rpcworkclass=<class>:<threads>[:<depth>]", _("Limit the number of threads RPC calls of a class may use at the same time and optionally the depth of its work queue. Classes in order of priority are mining, default, wallet, governance and index, the last two use a quarter of the threads by default. This option can be specified multiple times"));
     if (showDebug) {
-        strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
+        strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue of each class of RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
     }
 
@@ -1014,6 +1106,7 @@ ServiceFlags nRelevantServices = NODE_NETWORK;
 int nMaxConnections;
 int nUserMaxConnections;
 int nFD;
+CConnman::SocketEventsMode socketEventsMode = CConnman::SOCKETEVENTS_SELECT;
 ServiceFlags nLocalServices = NODE_NETWORK;
 
 }
@@ -1122,8 +1215,21 @@ bool AppInitParameterInteraction()
     nUserMaxConnections = GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     nMaxConnections = std::max(nUserMaxConnections, 0);
 
-    // Trim requested connection counts, to fit into system limitations
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS)), 0);
+    std::string strSocketEventsMode = GetArg("-socketevents", DEFAULT_SOCKETEVENTS);
+    if (strSocketEventsMode == "select") {
+        socketEventsMode = CConnman::SOCKETEVENTS_SELECT;
+#ifdef HAVE_SYS_EPOLL_H
+    } else if (strSocketEventsMode == "epoll") {
+        socketEventsMode = CConnman::SOCKETEVENTS_EPOLL;
+#endif
+    } else {
+        return InitError(strprintf(_("Invalid -socketevents ('%s') specified."), strSocketEventsMode));
+    }
+
+    // Trim requested connection counts, to fit into system limitations, select() can't handle more than FD_SETSIZE descriptors
+    if (socketEventsMode == CConnman::SOCKETEVENTS_SELECT) {
+        nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS)), 0);
+    }
     nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS + MAX_ADDNODE_CONNECTIONS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -1167,6 +1273,9 @@ bool AppInitParameterInteraction()
         mempool.setSanityCheck(1.0 / ratio);
     }
     fCheckBlockIndex = GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
+    fBlockFileMmap = GetBoolArg("-blockfilemmap", DEFAULT_BLOCKFILE_MMAP);
+    fBatchSigVerify = GetBoolArg("-batchsigverify", DEFAULT_BATCH_SIG_VERIFY);
+    nMempoolParallelInputs = std::max<int64_t>(GetArg("-mempoolparallelinputs", DEFAULT_MEMPOOL_PARALLEL_INPUTS), 0);
     fCheckpointsEnabled = GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
 
     hashAssumeValid = uint256S(GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
@@ -1174,6 +1283,9 @@ bool AppInitParameterInteraction()
         LogPrintf("Assuming ancestors of block %s have valid signatures.\n", hashAssumeValid.GetHex());
     else
         LogPrintf("Validating signatures for all blocks.\n");
+    fChainLockAssumeValid = GetBoolArg("-chainlockassumevalid", DEFAULT_CHAINLOCK_ASSUMEVALID);
+    if (fChainLockAssumeValid)
+        LogPrintf("Assuming ancestors of ChainLocked blocks have valid signatures.\n");
 
     // mempool limits
     int64_t nMempoolSizeMax = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
@@ -1199,6 +1311,14 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    // unlike -par, the shared worker pool always has at least one thread as some jobs can't run inline
+    nWorkerThreads = GetArg("-workerthreads", DEFAULT_WORKER_THREADS);
+    if (nWorkerThreads <= 0)
+        nWorkerThreads += GetNumCores();
+    nWorkerThreads = std::max(1, std::min(nWorkerThreads, MAX_WORKER_THREADS));
+
+    nSchedulerThreads = std::max(1, std::min((int)GetArg("-schedulerthreads", DEFAULT_SCHEDULER_THREADS), MAX_SCHEDULER_THREADS));
+
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg = GetArg("-prune", 0);
     if (nPruneArg < 0) {
@@ -1287,6 +1407,12 @@ bool AppInitParameterInteraction()
     if (GetBoolArg("-peerbloomfilters", DEFAULT_PEERBLOOMFILTERS))
         nLocalServices = ServiceFlags(nLocalServices | NODE_BLOOM);
 
+    if (GetBoolArg("-peerblockfilters", DEFAULT_PEERBLOCKFILTERS)) {
+        if (!GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX))
+            return InitError(_("Cannot set -peerblockfilters without -blockfilterindex."));
+        nLocalServices = ServiceFlags(nLocalServices | NODE_COMPACT_FILTERS);
+    }
+
     nMaxTipAge = GetArg("-maxtipage", DEFAULT_MAX_TIP_AGE);
 
     if (mapMultiArgs.count("-bip9params")) {
@@ -1434,6 +1560,9 @@ bool AppInitSanityChecks()
 {
     // ********************************************************* Step 4: sanity checks
 
+    std::string sha256_algo = SHA256AutoDetect();
+    LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+
     // Initialize elliptic curve code
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1446,6 +1575,34 @@ bool AppInitSanityChecks()
     return LockDataDirectory(true);
 }
 
+/** Reads a cache file without cleaning it up, the cleanup needs the chain and is done in step 10c */
+template<typename T>
+static bool ReadCacheFile(const std::string& strDBName, const std::string& strMagicMessage, T& objToLoad)
+{
+    int64_t nStart = GetTimeMillis();
+    CFlatDB<T> flatdb(strDBName, strMagicMessage);
+    bool fOk = flatdb.Load(objToLoad, false);
+    LogPrintf("%s: read %s in %dms\n", __func__, strDBName, GetTimeMillis() - nStart);
+    return fOk;
+}
+
+static bool ReadGovernanceCache(bool& fMigratedRet)
+{
+    int64_t nStart = GetTimeMillis();
+    fMigratedRet = false;
+    governance.InitDB(false);
+    if (!governance.LoadFromDB()) {
+        // nothing usable in the governance database yet, migrate from the flat file
+        governance.InitDB(true);
+        if (!ReadCacheFile("governance.dat", "magicGovernanceCache", governance)) {
+            return false;
+        }
+        fMigratedRet = true;
+    }
+    LogPrintf("%s: read governance cache in %dms\n", __func__, GetTimeMillis() - nStart);
+    return true;
+}
+
 bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 {
     const CChainParams& chainparams = Params();
@@ -1467,8 +1624,11 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         ShrinkDebugFile();
     }
 
-    if (fPrintToDebugLog)
+    if (fPrintToDebugLog) {
         OpenDebugLog();
+        if (GetBoolArg("-logasync", DEFAULT_LOGASYNC))
+            StartLogWriterThread();
+    }
 
     if (!fLogTimestamps)
         LogPrintf("Startup time: %s\n", DateTimeStrFormat("%Y-%m-%d %H:%M:%S", GetTime()));
@@ -1478,13 +1638,21 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("Using at most %i automatic connections (%i file descriptors available)\n", nMaxConnections, nFD);
 
     InitSignatureCache();
+    InitBLSSignatureCache();
+    InitTxValidationCache();
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadParallelCheck);
+        proTxSigCache.Start();
     }
 
+    LogPrintf("Using %u threads for the shared worker pool\n", nWorkerThreads);
+    g_workerPool.Start(nWorkerThreads, "historia-worker");
+
     std::vector<std::string> vSporkAddresses;
     if (mapMultiArgs.count("-sporkaddr")) {
         vSporkAddresses = mapMultiArgs.at("-sporkaddr");
@@ -1509,9 +1677,15 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         }
     }
 
-    // Start the lightweight task scheduler thread
+    // Start the lightweight task scheduler thread, the additional ones keep time critical tasks
+    // from waiting for maintenance tasks
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    for (int i = 1; i < nSchedulerThreads; i++) {
+        CScheduler::Function highServiceLoop = boost::bind(&CScheduler::servicePriorityQueue, &scheduler, CScheduler::PRIORITY_HIGH);
+        threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "schedhigh", highServiceLoop));
+    }
+    g_scheduler = &scheduler;
 
     /* Start the RPC server already.  It will be started in "warmup" mode
      * and not really process calls already (but it will signify connections
@@ -1549,6 +1723,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     peerLogic.reset(new PeerLogicValidation(&connman));
     RegisterValidationInterface(peerLogic.get());
     RegisterNodeSignals(GetNodeSignals());
+    StartMessageLaneThreads(connman);
 
     // sanitize comments per BIP-0014, format user agent and check total size
     std::vector<std::string> uacomments;
@@ -1696,7 +1871,8 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     pzmqNotificationInterface = CZMQNotificationInterface::Create();
 
     if (pzmqNotificationInterface) {
-        RegisterValidationInterface(pzmqNotificationInterface);
+        // publishing doesn't need to happen before validation continues
+        RegisterQueuedValidationInterface(pzmqNotificationInterface, &scheduler, "zmq");
     }
 #endif
 
@@ -1720,9 +1896,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         InitWarning(_("You are starting in lite mode, all Historia-specific functionality is disabled."));
     }
 
-    if((!fLiteMode && fTxIndex == false)
-       && chainparams.NetworkIDString() != CBaseChainParams::REGTEST) { // TODO remove this when pruning is fixed. See https://github.com/HistoriaOffical/historia/pull/1817 and https://github.com/HistoriaOffical/historia/pull/1743
-        return InitError(_("Transaction index can't be disabled in full mode. Either start with -litemode command line switch or enable transaction index."));
+    // pruned nodes look up governance collaterals in their own index, see governance-collateral.h
+    if((!fLiteMode && fTxIndex == false && !fPruneMode)
+       && chainparams.NetworkIDString() != CBaseChainParams::REGTEST) {
+        return InitError(_("Transaction index can't be disabled in full mode unless pruning. Either start with -litemode or -prune command line switch or enable transaction index."));
     }
 
     if (!fLiteMode) {
@@ -1738,6 +1915,29 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     fReindex = GetBoolArg("-reindex", false);
     bool fReindexChainState = GetBoolArg("-reindex-chainstate", false);
 
+    // Read the cache files while the block index is loaded and verified, they are joined in step 10c.
+    // Nothing touches these managers before that, the futures wait for the reads if we bail out early.
+    bool fGovernanceMigrated = false;
+    std::future<bool> futureMasternodeCache, futureGovernanceCache, futureFulfilledCache;
+    if (!fLiteMode && GetBoolArg("-govsearchindex", DEFAULT_GOVERNANCE_SEARCH_INDEX)) {
+        // the objects read from the cache are indexed once it is joined
+        governance.EnableSearchIndex();
+    }
+    if (!fLiteMode && !fReindex && !fReindexChainState) {
+        futureMasternodeCache = std::async(std::launch::async, [] {
+            RenameThread("historia-loadcache");
+            return ReadCacheFile("mncache.dat", "magicMasternodeCache", mmetaman);
+        });
+        futureGovernanceCache = std::async(std::launch::async, [&fGovernanceMigrated] {
+            RenameThread("historia-loadgov");
+            return ReadGovernanceCache(fGovernanceMigrated);
+        });
+        futureFulfilledCache = std::async(std::launch::async, [] {
+            RenameThread("historia-loadcache");
+            return ReadCacheFile("netfulfilled.dat", "magicFulfilledCache", netfulfilledman);
+        });
+    }
+
     boost::filesystem::create_directories(GetDataDir() / "blocks");
 
     // cache size calculations
@@ -1747,6 +1947,13 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     int64_t nBlockTreeDBCache = nTotalCache / 8;
     nBlockTreeDBCache = std::min(nBlockTreeDBCache, (GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxBlockDBAndTxIndexCache : nMaxBlockDBCache) << 20);
     nTotalCache -= nBlockTreeDBCache;
+    // every enabled optional index gets its own cache, disabled ones only need enough to open the DB
+    const int64_t nIndexDBCacheMax = std::min(nTotalCache / 16, nMaxIndexDBCache << 20);
+    int64_t nAddressIndexDBCache = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) ? nIndexDBCacheMax : (1 << 20);
+    int64_t nSpentIndexDBCache = GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) ? nIndexDBCacheMax : (1 << 20);
+    int64_t nTimestampIndexDBCache = GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX) ? nIndexDBCacheMax : (1 << 20);
+    int64_t nBlockFilterIndexDBCache = GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX) ? nIndexDBCacheMax : (1 << 20);
+    nTotalCache -= nAddressIndexDBCache + nSpentIndexDBCache + nTimestampIndexDBCache + nBlockFilterIndexDBCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
@@ -1755,6 +1962,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     int64_t nEvoDbCache = 1024 * 1024 * 16; // TODO
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1fMiB/%.1fMiB/%.1fMiB/%.1fMiB for address/spent/timestamp/block filter index databases\n",
+              nAddressIndexDBCache * (1.0 / 1024 / 1024), nSpentIndexDBCache * (1.0 / 1024 / 1024), nTimestampIndexDBCache * (1.0 / 1024 / 1024),
+              nBlockFilterIndexDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
@@ -1772,9 +1982,14 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
             try {
                 UnloadBlockIndex();
                 delete pcoinsTip;
-                delete pcoinsdbview;
                 delete pcoinscatcher;
+                delete pcoinsdbflusher;
+                delete pcoinsdbview;
                 delete pblocktree;
+                delete paddressindexdb;
+                delete pspentindexdb;
+                delete ptimestampindexdb;
+                delete pblockfilterindexdb;
                 llmq::DestroyLLMQSystem();
                 delete deterministicMNManager;
                 delete evoDb;
@@ -1782,8 +1997,13 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 evoDb = new CEvoDB(nEvoDbCache, false, fReindex || fReindexChainState);
                 deterministicMNManager = new CDeterministicMNManager(*evoDb);
                 pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex);
+                paddressindexdb = new CAddressIndexDB(nAddressIndexDBCache, false, fReindex);
+                pspentindexdb = new CSpentIndexDB(nSpentIndexDBCache, false, fReindex);
+                ptimestampindexdb = new CTimestampIndexDB(nTimestampIndexDBCache, false, fReindex);
+                pblockfilterindexdb = new CBlockFilterIndexDB(nBlockFilterIndexDBCache, false, fReindex);
                 pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex || fReindexChainState);
-                pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
+                pcoinsdbflusher = new CCoinsViewDBFlusher(pcoinsdbview);
+                pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbflusher);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
                 llmq::InitLLMQSystem(*evoDb, &scheduler, false, fReindex || fReindexChainState);
 
@@ -1798,6 +2018,14 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                         strLoadError = _("Error upgrading chainstate database");
                         break;
                     }
+                    if (!pblocktree->MoveIndexesTo(*paddressindexdb, *pspentindexdb, *ptimestampindexdb)) {
+                        strLoadError = _("Error upgrading block index database");
+                        break;
+                    }
+                }
+                if (!paddressindexdb->UpgradeAddressBalances()) {
+                    strLoadError = _("Error upgrading address index database");
+                    break;
                 }
                 if (fRequestShutdown) break;
 
@@ -1834,6 +2062,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 }
 
                 deterministicMNManager->UpgradeDBIfNeeded();
+                if (!fLiteMode) {
+                    UpgradeGovernanceCollateralIndex();
+                }
 
                 uiInterface.InitMessage(_("Verifying blocks..."));
                 if (fHavePruned && GetArg("-checkblocks", DEFAULT_CHECKBLOCKS) > MIN_BLOCKS_TO_KEEP) {
@@ -1897,6 +2128,42 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     }
     LogPrintf(" block index %15dms\n", GetTimeMillis() - nStart);
 
+    // from now on, address/spent/timestamp/block filter index entries are written in the background
+    StartIndexWriterThread();
+
+    // Optional indexes which were enabled after the chain was synced are built in the background
+    bool fBuildAddressIndex = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) && !fAddressIndex;
+    bool fBuildSpentIndex = GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) && !fSpentIndex;
+    bool fBuildTimestampIndex = GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX) && !fTimestampIndex;
+    bool fBuildBlockFilterIndex = GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX) && !fBlockFilterIndex;
+    if ((fBuildAddressIndex || fBuildSpentIndex || fBuildBlockFilterIndex) && fHavePruned) {
+        return InitError(_("You need to rebuild the database using -reindex to enable -addressindex, -spentindex or -blockfilterindex on a pruned node"));
+    }
+    {
+        // start from scratch, an index which was disabled before may contain outdated entries
+        uint256 hashBuildTip;
+        if (fBuildAddressIndex && !paddressindexdb->ReadBuildTip(hashBuildTip)) {
+            delete paddressindexdb;
+            paddressindexdb = new CAddressIndexDB(nAddressIndexDBCache, false, true);
+            if (!paddressindexdb->UpgradeAddressBalances()) {
+                return InitError(_("Error upgrading address index database"));
+            }
+        }
+        if (fBuildSpentIndex && !pspentindexdb->ReadBuildTip(hashBuildTip)) {
+            delete pspentindexdb;
+            pspentindexdb = new CSpentIndexDB(nSpentIndexDBCache, false, true);
+        }
+        if (fBuildTimestampIndex && !ptimestampindexdb->ReadBuildTip(hashBuildTip)) {
+            delete ptimestampindexdb;
+            ptimestampindexdb = new CTimestampIndexDB(nTimestampIndexDBCache, false, true);
+        }
+        if (fBuildBlockFilterIndex && !pblockfilterindexdb->ReadBuildTip(hashBuildTip)) {
+            delete pblockfilterindexdb;
+            pblockfilterindexdb = new CBlockFilterIndexDB(nBlockFilterIndexDBCache, false, true);
+        }
+    }
+    StartIndexBuilderThread(fBuildAddressIndex, fBuildSpentIndex, fBuildTimestampIndex, fBuildBlockFilterIndex);
+
     boost::filesystem::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
     CAutoFile est_filein(fopen(est_path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
     // Allowed to fail as this file IS missing on first startup.
@@ -1927,6 +2194,16 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     // ********************************************************* Step 10a: Prepare Masternode related stuff
     fMasternodeMode = GetBoolArg("-masternode", false);
+
+    {
+        int nIPFSPort = DEFAULT_IPFS_API_PORT;
+        std::string strIPFSHost;
+        SplitHostPort(GetArg("-ipfsapi", DEFAULT_IPFS_API), nIPFSPort, strIPFSHost);
+        if (strIPFSHost.empty() || nIPFSPort <= 0 || nIPFSPort > 65535) {
+            return InitError(strprintf(_("Invalid -ipfsapi address: '%s'"), GetArg("-ipfsapi", DEFAULT_IPFS_API)));
+        }
+        ipfsClientPool.SetEndpoint(strIPFSHost, nIPFSPort);
+    }
     // TODO: masternode should have no wallet
 
     if(fLiteMode && fMasternodeMode) {
@@ -1936,6 +2213,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     if(fMasternodeMode) {
         LogPrintf("MASTERNODE:\n");
 
+        // before governance is loaded and cleaned up, which may queue unpins
+        ipfsPinManager.InitDB();
+        ipfsPinManager.SetReplicas(GetArg("-ipfsreplicas", DEFAULT_IPFS_REPLICAS));
+
         std::string strMasterNodeBLSPrivKey = GetArg("-masternodeblsprivkey", "");
         if(!strMasterNodeBLSPrivKey.empty()) {
             auto binKey = ParseHex(strMasterNodeBLSPrivKey);
@@ -1963,13 +2244,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
             }
 	
             if (std::stoi(strMasterNodeCollateral) == 5000) {
-                try {
-                    ipfs::Client ipfsclient("localhost", 5001);
-                    std::stringstream contents;
-                    ipfsclient.FilesGet("/ipfs/QmXgqKTbzdh83pQtKFb19SpMCpDDcKR2ujqk3pKph9aCNF", &contents);
-                } catch (std::exception& e) {
+                if (!ipfsHealthMonitor.Probe()) {
                     return InitError(_("You must have IPFS daemon running before you start a Masternode. Please see documentation for help."));
                 }
+                ipfsHealthMonitor.StartWorkerThread();
 	    }
 
         } else {
@@ -2023,31 +2301,52 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     // LOAD SERIALIZED DAT FILES INTO DATA CACHES FOR INTERNAL USE
 
     bool fIgnoreCacheFiles = fLiteMode || fReindex || fReindexChainState;
-    if (!fIgnoreCacheFiles) {
+    bool fCacheFilesRead = futureMasternodeCache.valid();
+    if (fCacheFilesRead && fIgnoreCacheFiles) {
+        // a reindex was requested while loading the block index, drop what was read
+        futureMasternodeCache.wait();
+        futureGovernanceCache.wait();
+        futureFulfilledCache.wait();
+        mmetaman.Clear();
+        governance.Clear();
+        netfulfilledman.Clear();
+        fCacheFilesRead = false;
+    }
+    if (!fLiteMode && !fCacheFilesRead) {
+        governance.InitDB(fIgnoreCacheFiles);
+    }
+    if (fCacheFilesRead) {
         boost::filesystem::path pathDB = GetDataDir();
         std::string strDBName;
+        int64_t nStart;
 
-        strDBName = "mncache.dat";
         uiInterface.InitMessage(_("Loading masternode cache..."));
-        CFlatDB<CMasternodeMetaMan> flatdb1(strDBName, "magicMasternodeCache");
-        if(!flatdb1.Load(mmetaman)) {
-            return InitError(_("Failed to load masternode cache from") + "\n" + (pathDB / strDBName).string());
+        if (!futureMasternodeCache.get()) {
+            return InitError(_("Failed to load masternode cache from") + "\n" + (pathDB / "mncache.dat").string());
         }
+        nStart = GetTimeMillis();
+        mmetaman.CheckAndRemove();
+        LogPrintf("Cleaned up masternode cache  %dms\n", GetTimeMillis() - nStart);
 
-        strDBName = "governance.dat";
         uiInterface.InitMessage(_("Loading governance cache..."));
-        CFlatDB<CGovernanceManager> flatdb3(strDBName, "magicGovernanceCache");
-        if(!flatdb3.Load(governance)) {
-            return InitError(_("Failed to load governance cache from") + "\n" + (pathDB / strDBName).string());
+        if (!futureGovernanceCache.get()) {
+            return InitError(_("Failed to load governance cache from") + "\n" + (pathDB / "governance.dat").string());
+        }
+        if (fGovernanceMigrated) {
+            nStart = GetTimeMillis();
+            governance.CheckAndRemove();
+            LogPrintf("Cleaned up governance cache  %dms\n", GetTimeMillis() - nStart);
+            governance.FlushToDB(true);
         }
         governance.InitOnLoad();
 
-        strDBName = "netfulfilled.dat";
         uiInterface.InitMessage(_("Loading fulfilled requests cache..."));
-        CFlatDB<CNetFulfilledRequestManager> flatdb4(strDBName, "magicFulfilledCache");
-        if(!flatdb4.Load(netfulfilledman)) {
-            return InitError(_("Failed to load fulfilled requests cache from") + "\n" + (pathDB / strDBName).string());
+        if (!futureFulfilledCache.get()) {
+            return InitError(_("Failed to load fulfilled requests cache from") + "\n" + (pathDB / "netfulfilled.dat").string());
         }
+        nStart = GetTimeMillis();
+        netfulfilledman.CheckAndRemove();
+        LogPrintf("Cleaned up fulfilled requests cache  %dms\n", GetTimeMillis() - nStart);
 
         if(fEnableInstantSend)
         {
@@ -2063,24 +2362,40 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     // ********************************************************* Step 10d: schedule Historia-specific tasks
 
     if (!fLiteMode) {
-        scheduler.scheduleEvery(boost::bind(&CNetFulfilledRequestManager::DoMaintenance, boost::ref(netfulfilledman)), 60 * 1000);
-        scheduler.scheduleEvery(boost::bind(&CMasternodeSync::DoMaintenance, boost::ref(masternodeSync), boost::ref(*g_connman)), 1 * 1000);
-        scheduler.scheduleEvery(boost::bind(&CMasternodeUtils::DoMaintenance, boost::ref(*g_connman)), 1 * 1000);
-
-        scheduler.scheduleEvery(boost::bind(&CGovernanceManager::DoMaintenance, boost::ref(governance), boost::ref(*g_connman)), 60 * 5 * 1000);
-
-        scheduler.scheduleEvery(boost::bind(&CInstantSend::DoMaintenance, boost::ref(instantsend)), 60 * 1000);
+        scheduler.scheduleEvery(boost::bind(&CNetFulfilledRequestManager::DoMaintenance, boost::ref(netfulfilledman)), 60 * 1000,
+                                CScheduler::PRIORITY_LOW, "netfulfilled");
+        scheduler.scheduleEvery(boost::bind(&CMasternodeSync::DoMaintenance, boost::ref(masternodeSync), boost::ref(*g_connman)), 1 * 1000,
+                                CScheduler::PRIORITY_NORMAL, "mnsync");
+        scheduler.scheduleEvery(boost::bind(&CMasternodeUtils::DoMaintenance, boost::ref(*g_connman)), 1 * 1000,
+                                CScheduler::PRIORITY_NORMAL, "mnutils");
+
+        scheduler.scheduleEvery(boost::bind(&CGovernanceManager::DoMaintenance, boost::ref(governance), boost::ref(*g_connman)), 60 * 5 * 1000,
+                                CScheduler::PRIORITY_LOW, "governance");
+        scheduler.scheduleEvery(boost::bind(&CGovernanceManager::FlushToDB, boost::ref(governance), false), 60 * 1000,
+                                CScheduler::PRIORITY_LOW, "governanceflush");
+        governance.StartVoteVerifyThread(*g_connman);
+        scheduler.scheduleEvery(boost::bind(&CIPFSPinManager::DoMaintenance, boost::ref(ipfsPinManager)), 60 * 1000,
+                                CScheduler::PRIORITY_LOW, "ipfspin");
+
+        scheduler.scheduleEvery(boost::bind(&CInstantSend::DoMaintenance, boost::ref(instantsend)), 60 * 1000,
+                                CScheduler::PRIORITY_LOW, "instantsend");
 
         if (fMasternodeMode)
-            scheduler.scheduleEvery(boost::bind(&CPrivateSendServer::DoMaintenance, boost::ref(privateSendServer), boost::ref(*g_connman)), 1 * 1000);
+            scheduler.scheduleEvery(boost::bind(&CPrivateSendServer::DoMaintenance, boost::ref(privateSendServer), boost::ref(*g_connman)), 1 * 1000,
+                                    CScheduler::PRIORITY_NORMAL, "privatesend");
 #ifdef ENABLE_WALLET
         else
-            scheduler.scheduleEvery(boost::bind(&CPrivateSendClientManager::DoMaintenance, boost::ref(privateSendClient), boost::ref(*g_connman)), 1 * 1000);
+            scheduler.scheduleEvery(boost::bind(&CPrivateSendClientManager::DoMaintenance, boost::ref(privateSendClient), boost::ref(*g_connman)), 1 * 1000,
+                                    CScheduler::PRIORITY_NORMAL, "privatesend");
 #endif // ENABLE_WALLET
     }
 
     llmq::StartLLMQSystem();
 
+    if (fMasternodeMode) {
+        ipfsPinManager.StartWorkerThreads(GetArg("-ipfspinthreads", DEFAULT_IPFS_PIN_THREADS));
+    }
+
     // ********************************************************* Step 11: import blocks
 
     if (!CheckDiskSpace())
@@ -2143,6 +2458,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
+    connOptions.socketEventsMode = socketEventsMode;
 
     if (!connman.Start(scheduler, strNodeError, connOptions))
         return InitError(strNodeError);
@@ -85,8 +85,7 @@ void CInstantSend::ProcessMessage(CNode* pfrom, const std::string& strCommand, C
 
         {
             LOCK(cs_instantsend);
-            auto ret = mapTxLockVotes.emplace(nVoteHash, vote);
-            if (!ret.second) return;
+            if (!InsertTxLockVote(nVoteHash, vote)) return;
         }
 
         ProcessNewTxLockVote(pfrom, vote, connman);
@@ -107,7 +106,7 @@ bool CInstantSend::ProcessTxLockRequest(const CTxLockRequest& txLockRequest, CCo
 
     // Check to see if we conflict with existing completed lock
     for (const auto& txin : txLockRequest.tx->vin) {
-        std::map<COutPoint, uint256>::iterator it = mapLockedOutpoints.find(txin.prevout);
+        auto it = mapLockedOutpoints.find(txin.prevout);
         if (it != mapLockedOutpoints.end() && it->second != txLockRequest.GetHash()) {
             // Conflicting with complete lock, proceed to see if we should cancel them both
             LogPrintf("CInstantSend::ProcessTxLockRequest -- WARNING: Found conflicting completed Transaction Lock, txid=%s, completed lock txid=%s\n",
@@ -118,7 +117,7 @@ bool CInstantSend::ProcessTxLockRequest(const CTxLockRequest& txLockRequest, CCo
     // Check to see if there are votes for conflicting request,
     // if so - do not fail, just warn user
     for (const auto& txin : txLockRequest.tx->vin) {
-        std::map<COutPoint, std::set<uint256> >::iterator it = mapVotedOutpoints.find(txin.prevout);
+        auto it = mapVotedOutpoints.find(txin.prevout);
         if (it != mapVotedOutpoints.end()) {
             for (const auto& hash : it->second) {
                 if (hash != txLockRequest.GetHash()) {
@@ -147,7 +146,7 @@ bool CInstantSend::ProcessTxLockRequest(const CTxLockRequest& txLockRequest, CCo
     // If this just happened - process orphan votes, lock inputs, resolve conflicting locks,
     // update transaction status forcing external script/zmq notifications.
     ProcessOrphanTxLockVotes();
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    auto itLockCandidate = mapTxLockCandidates.find(txHash);
     TryToFinalizeLockCandidate(itLockCandidate->second);
 
     return true;
@@ -161,7 +160,7 @@ bool CInstantSend::CreateTxLockCandidate(const CTxLockRequest& txLockRequest)
 
     uint256 txHash = txLockRequest.GetHash();
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    auto itLockCandidate = mapTxLockCandidates.find(txHash);
     if (itLockCandidate == mapTxLockCandidates.end()) {
         LogPrintf("CInstantSend::CreateTxLockCandidate -- new, txid=%s\n", txHash.ToString());
 
@@ -259,14 +258,14 @@ void CInstantSend::Vote(CTxLockCandidate& txLockCandidate, CConnman& connman)
 
         LogPrint("instantsend", "CInstantSend::Vote -- In the top %d (%d)\n", nSignaturesTotal, nRank);
 
-        std::map<COutPoint, std::set<uint256> >::iterator itVoted = mapVotedOutpoints.find(outpointLockPair.first);
+        auto itVoted = mapVotedOutpoints.find(outpointLockPair.first);
 
         // Check to see if we already voted for this outpoint,
         // refuse to vote twice or to include the same outpoint in another tx
         bool fAlreadyVoted = false;
         if (itVoted != mapVotedOutpoints.end()) {
             for (const auto& hash : itVoted->second) {
-                std::map<uint256, CTxLockCandidate>::iterator it2 = mapTxLockCandidates.find(hash);
+                auto it2 = mapTxLockCandidates.find(hash);
                 if (it2->second.HasMasternodeVoted(outpointLockPair.first, activeMasternodeInfo.outpoint)) {
                     // we already voted for this outpoint to be included either in the same tx or in a competing one,
                     // skip it anyway
@@ -296,7 +295,7 @@ void CInstantSend::Vote(CTxLockCandidate& txLockCandidate, CConnman& connman)
 
         // vote constructed sucessfully, let's store and relay it
         uint256 nVoteHash = vote.GetHash();
-        mapTxLockVotes.insert(std::make_pair(nVoteHash, vote));
+        InsertTxLockVote(nVoteHash, vote);
         if (outpointLockPair.second.AddVote(vote)) {
             LogPrintf("CInstantSend::Vote -- Vote created successfully, relaying: txHash=%s, outpoint=%s, vote=%s\n",
                     txHash.ToString(), outpointLockPair.first.ToStringShort(), nVoteHash.ToString());
@@ -342,7 +341,7 @@ bool CInstantSend::ProcessNewTxLockVote(CNode* pfrom, const CTxLockVote& vote, C
     // Masternodes will sometimes propagate votes before the transaction is known to the client,
     // will actually process only after the lock request itself has arrived
 
-    std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
+    auto it = mapTxLockCandidates.find(txHash);
     if (it == mapTxLockCandidates.end() || !it->second.txLockRequest) {
         // no or empty tx lock candidate
         if (it == mapTxLockCandidates.end()) {
@@ -414,7 +413,7 @@ bool CInstantSend::ProcessOrphanTxLockVote(const CTxLockVote& vote)
     uint256 txHash = vote.GetTxHash();
 
     // We shouldn't process orphan votes without a valid tx lock candidate
-    std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
+    auto it = mapTxLockCandidates.find(txHash);
     if (it == mapTxLockCandidates.end() || !it->second.txLockRequest)
         return false; // this shouldn never happen
 
@@ -448,14 +447,14 @@ void CInstantSend::UpdateVotedOutpoints(const CTxLockVote& vote, CTxLockCandidat
 
     uint256 txHash = vote.GetTxHash();
 
-    std::map<COutPoint, std::set<uint256> >::iterator it1 = mapVotedOutpoints.find(vote.GetOutpoint());
+    auto it1 = mapVotedOutpoints.find(vote.GetOutpoint());
     if (it1 != mapVotedOutpoints.end()) {
         for (const auto& hash : it1->second) {
             if (hash != txHash) {
                 // same outpoint was already voted to be locked by another tx lock request,
                 // let's see if it was the same masternode who voted on this outpoint
                 // for another tx lock request
-                std::map<uint256, CTxLockCandidate>::iterator it2 = mapTxLockCandidates.find(hash);
+                auto it2 = mapTxLockCandidates.find(hash);
                 if (it2 !=mapTxLockCandidates.end() && it2->second.HasMasternodeVoted(vote.GetOutpoint(), vote.GetMasternodeOutpoint())) {
                     // yes, it was the same masternode
                     LogPrintf("CInstantSend::%s -- masternode sent conflicting votes! %s\n", __func__, vote.GetMasternodeOutpoint().ToStringShort());
@@ -563,7 +562,7 @@ void CInstantSend::LockTransactionInputs(const CTxLockCandidate& txLockCandidate
 bool CInstantSend::GetLockedOutPointTxHash(const COutPoint& outpoint, uint256& hashRet)
 {
     LOCK(cs_instantsend);
-    std::map<COutPoint, uint256>::iterator it = mapLockedOutpoints.find(outpoint);
+    auto it = mapLockedOutpoints.find(outpoint);
     if (it == mapLockedOutpoints.end()) return false;
     hashRet = it->second;
     return true;
@@ -586,8 +585,8 @@ bool CInstantSend::ResolveConflicts(const CTxLockCandidate& txLockCandidate)
         if (GetLockedOutPointTxHash(txin.prevout, hashConflicting) && txHash != hashConflicting) {
             // completed lock which conflicts with another completed one?
             // this means that majority of MNs in the quorum for this specific tx input are malicious!
-            std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
-            std::map<uint256, CTxLockCandidate>::iterator itLockCandidateConflicting = mapTxLockCandidates.find(hashConflicting);
+            auto itLockCandidate = mapTxLockCandidates.find(txHash);
+            auto itLockCandidateConflicting = mapTxLockCandidates.find(hashConflicting);
             if (itLockCandidate == mapTxLockCandidates.end() || itLockCandidateConflicting == mapTxLockCandidates.end()) {
                 // safety check, should never really happen
                 LogPrintf("CInstantSend::ResolveConflicts -- ERROR: Found conflicting completed Transaction Lock, but one of txLockCandidate-s is missing, txid=%s, conflicting txid=%s\n",
@@ -598,8 +597,8 @@ bool CInstantSend::ResolveConflicts(const CTxLockCandidate& txLockCandidate)
                     txHash.ToString(), hashConflicting.ToString());
             CTxLockRequest txLockRequest = itLockCandidate->second.txLockRequest;
             CTxLockRequest txLockRequestConflicting = itLockCandidateConflicting->second.txLockRequest;
-            itLockCandidate->second.SetConfirmedHeight(0); // expired
-            itLockCandidateConflicting->second.SetConfirmedHeight(0); // expired
+            SetCandidateConfirmedHeight(itLockCandidate->second, 0); // expired
+            SetCandidateConfirmedHeight(itLockCandidateConflicting->second, 0); // expired
             CheckAndRemove(); // clean up
             // AlreadyHave should still return "true" for both of them
             mapLockRequestRejected.insert(std::make_pair(txHash, txLockRequest));
@@ -665,37 +664,41 @@ void CInstantSend::CheckAndRemove()
 
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.begin();
+    int nKeepLock = Params().GetConsensus().nInstantSendKeepLock;
 
     // remove expired candidates
-    while (itLockCandidate != mapTxLockCandidates.end()) {
-        CTxLockCandidate &txLockCandidate = itLockCandidate->second;
-        uint256 txHash = txLockCandidate.GetHash();
-        if (txLockCandidate.IsExpired(nCachedBlockHeight)) {
+    while (!mapCandidatesByConfirmedHeight.empty() && nCachedBlockHeight - mapCandidatesByConfirmedHeight.begin()->first > nKeepLock) {
+        for (const auto& txHash : mapCandidatesByConfirmedHeight.begin()->second) {
+            auto itLockCandidate = mapTxLockCandidates.find(txHash);
+            // confirmed again at another height or no longer confirmed
+            if (itLockCandidate == mapTxLockCandidates.end() || !itLockCandidate->second.IsExpired(nCachedBlockHeight)) {
+                continue;
+            }
             LogPrintf("CInstantSend::CheckAndRemove -- Removing expired Transaction Lock Candidate: txid=%s\n", txHash.ToString());
 
-            for (const auto& pair : txLockCandidate.mapOutPointLocks) {
+            for (const auto& pair : itLockCandidate->second.mapOutPointLocks) {
                 mapLockedOutpoints.erase(pair.first);
                 mapVotedOutpoints.erase(pair.first);
             }
             mapLockRequestAccepted.erase(txHash);
             mapLockRequestRejected.erase(txHash);
-            mapTxLockCandidates.erase(itLockCandidate++);
-        } else {
-            ++itLockCandidate;
+            mapTxLockCandidates.erase(itLockCandidate);
         }
+        mapCandidatesByConfirmedHeight.erase(mapCandidatesByConfirmedHeight.begin());
     }
 
     // remove expired votes
-    std::map<uint256, CTxLockVote>::iterator itVote = mapTxLockVotes.begin();
-    while (itVote != mapTxLockVotes.end()) {
-        if (itVote->second.IsExpired(nCachedBlockHeight)) {
+    while (!mapVotesByConfirmedHeight.empty() && nCachedBlockHeight - mapVotesByConfirmedHeight.begin()->first > nKeepLock) {
+        for (const auto& nVoteHash : mapVotesByConfirmedHeight.begin()->second) {
+            auto itVote = mapTxLockVotes.find(nVoteHash);
+            if (itVote == mapTxLockVotes.end() || !itVote->second.IsExpired(nCachedBlockHeight)) {
+                continue;
+            }
             LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing expired vote: txid=%s  masternode=%s\n",
                     itVote->second.GetTxHash().ToString(), itVote->second.GetMasternodeOutpoint().ToStringShort());
-            mapTxLockVotes.erase(itVote++);
-        } else {
-            ++itVote;
+            mapTxLockVotes.erase(itVote);
         }
+        mapVotesByConfirmedHeight.erase(mapVotesByConfirmedHeight.begin());
     }
 
     // remove timed out orphan votes
@@ -711,15 +714,22 @@ void CInstantSend::CheckAndRemove()
         }
     }
 
-    // remove invalid votes and votes for failed lock attempts
-    itVote = mapTxLockVotes.begin();
-    while (itVote != mapTxLockVotes.end()) {
+    // remove invalid votes and votes for failed lock attempts, votes of locked transactions are checked again later
+    int64_t nNow = GetTime();
+    size_t nVotesToCheck = dequeVotesToCheck.size();
+    for (size_t i = 0; i < nVotesToCheck && dequeVotesToCheck.front().first < nNow; i++) {
+        uint256 nVoteHash = dequeVotesToCheck.front().second;
+        dequeVotesToCheck.pop_front();
+        auto itVote = mapTxLockVotes.find(nVoteHash);
+        if (itVote == mapTxLockVotes.end()) {
+            continue;
+        }
         if (itVote->second.IsFailed()) {
             LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing vote for failed lock attempt: txid=%s  masternode=%s\n",
                     itVote->second.GetTxHash().ToString(), itVote->second.GetMasternodeOutpoint().ToStringShort());
-            mapTxLockVotes.erase(itVote++);
+            mapTxLockVotes.erase(itVote);
         } else {
-            ++itVote;
+            dequeVotesToCheck.emplace_back(nNow + INSTANTSEND_FAILED_TIMEOUT_SECONDS, nVoteHash);
         }
     }
 
@@ -775,7 +785,7 @@ bool CInstantSend::GetTxLockRequest(const uint256& txHash, CTxLockRequest& txLoc
 
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
+    auto it = mapTxLockCandidates.find(txHash);
     if (it == mapTxLockCandidates.end() || !it->second.txLockRequest) return false;
     txLockRequestRet = it->second.txLockRequest;
 
@@ -790,7 +800,7 @@ bool CInstantSend::GetTxLockVote(const uint256& hash, CTxLockVote& txLockVoteRet
 
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockVote>::iterator it = mapTxLockVotes.find(hash);
+    auto it = mapTxLockVotes.find(hash);
     if (it == mapTxLockVotes.end()) return false;
     txLockVoteRet = it->second;
 
@@ -809,9 +819,60 @@ void CInstantSend::Clear()
     mapVotedOutpoints.clear();
     mapLockedOutpoints.clear();
     mapMasternodeOrphanVotes.clear();
+    mapCandidatesByConfirmedHeight.clear();
+    mapVotesByConfirmedHeight.clear();
+    dequeVotesToCheck.clear();
     nCachedBlockHeight = 0;
 }
 
+bool CInstantSend::InsertTxLockVote(const uint256& nVoteHash, const CTxLockVote& vote)
+{
+    AssertLockHeld(cs_instantsend);
+
+    if (!mapTxLockVotes.emplace(nVoteHash, vote).second) {
+        return false;
+    }
+    dequeVotesToCheck.emplace_back(GetTime() + INSTANTSEND_FAILED_TIMEOUT_SECONDS, nVoteHash);
+    return true;
+}
+
+void CInstantSend::SetCandidateConfirmedHeight(CTxLockCandidate& txLockCandidate, int nHeight)
+{
+    AssertLockHeld(cs_instantsend);
+
+    txLockCandidate.SetConfirmedHeight(nHeight);
+    if (nHeight != -1) {
+        mapCandidatesByConfirmedHeight[nHeight].push_back(txLockCandidate.GetHash());
+    }
+}
+
+void CInstantSend::SetVoteConfirmedHeight(const uint256& nVoteHash, CTxLockVote& vote, int nHeight)
+{
+    AssertLockHeld(cs_instantsend);
+
+    vote.SetConfirmedHeight(nHeight);
+    if (nHeight != -1) {
+        mapVotesByConfirmedHeight[nHeight].push_back(nVoteHash);
+    }
+}
+
+void CInstantSend::RebuildExpiryIndexes()
+{
+    LOCK(cs_instantsend);
+
+    mapCandidatesByConfirmedHeight.clear();
+    mapVotesByConfirmedHeight.clear();
+    dequeVotesToCheck.clear();
+    for (auto& pair : mapTxLockCandidates) {
+        SetCandidateConfirmedHeight(pair.second, pair.second.GetConfirmedHeight());
+    }
+    // confirmed heights of votes aren't stored, SyncTransaction sets them again
+    int64_t nCheckTime = GetTime() + INSTANTSEND_FAILED_TIMEOUT_SECONDS;
+    for (const auto& pair : mapTxLockVotes) {
+        dequeVotesToCheck.emplace_back(nCheckTime, pair.first);
+    }
+}
+
 bool CInstantSend::IsLockedInstantSendTransaction(const uint256& txHash)
 {
     if (!fEnableInstantSend || GetfLargeWorkForkFound() || GetfLargeWorkInvalidChainFound() ||
@@ -820,7 +881,7 @@ bool CInstantSend::IsLockedInstantSendTransaction(const uint256& txHash)
     LOCK(cs_instantsend);
 
     // there must be a lock candidate
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    auto itLockCandidate = mapTxLockCandidates.find(txHash);
     if (itLockCandidate == mapTxLockCandidates.end()) return false;
 
     // which should have outpoints
@@ -843,7 +904,7 @@ int CInstantSend::GetTransactionLockSignatures(const uint256& txHash)
 
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    auto itLockCandidate = mapTxLockCandidates.find(txHash);
     if (itLockCandidate != mapTxLockCandidates.end()) {
         return itLockCandidate->second.CountVotes();
     }
@@ -857,7 +918,7 @@ bool CInstantSend::IsTxLockCandidateTimedOut(const uint256& txHash)
 
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    auto itLockCandidate = mapTxLockCandidates.find(txHash);
     if (itLockCandidate != mapTxLockCandidates.end()) {
         return !itLockCandidate->second.IsAllOutPointsReady() &&
                 itLockCandidate->second.IsTimedOut();
@@ -870,7 +931,7 @@ void CInstantSend::Relay(const uint256& txHash, CConnman& connman)
 {
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::const_iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    auto itLockCandidate = mapTxLockCandidates.find(txHash);
     if (itLockCandidate != mapTxLockCandidates.end()) {
         itLockCandidate->second.Relay(connman);
     }
@@ -898,11 +959,11 @@ void CInstantSend::SyncTransaction(const CTransaction& tx, const CBlockIndex *pi
     LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d\n", txHash.ToString(), nHeightNew);
 
     // Check lock candidates
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    auto itLockCandidate = mapTxLockCandidates.find(txHash);
     if (itLockCandidate != mapTxLockCandidates.end()) {
         LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d lock candidate updated\n",
                 txHash.ToString(), nHeightNew);
-        itLockCandidate->second.SetConfirmedHeight(nHeightNew);
+        SetCandidateConfirmedHeight(itLockCandidate->second, nHeightNew);
         // Loop through outpoint locks
         for (const auto& pair : itLockCandidate->second.mapOutPointLocks) {
             // Check corresponding lock votes
@@ -912,7 +973,7 @@ void CInstantSend::SyncTransaction(const CTransaction& tx, const CBlockIndex *pi
                         txHash.ToString(), nHeightNew, nVoteHash.ToString());
                 const auto& it = mapTxLockVotes.find(nVoteHash);
                 if (it != mapTxLockVotes.end()) {
-                    it->second.SetConfirmedHeight(nHeightNew);
+                    SetVoteConfirmedHeight(nVoteHash, it->second, nHeightNew);
                 }
             }
         }
@@ -923,7 +984,7 @@ void CInstantSend::SyncTransaction(const CTransaction& tx, const CBlockIndex *pi
         if (pair.second.GetTxHash() == txHash) {
             LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d vote %s updated\n",
                     txHash.ToString(), nHeightNew, pair.first.ToString());
-            mapTxLockVotes[pair.first].SetConfirmedHeight(nHeightNew);
+            SetVoteConfirmedHeight(pair.first, mapTxLockVotes[pair.first], nHeightNew);
         }
     }
 }
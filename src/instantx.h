@@ -7,9 +7,12 @@
 #include "chain.h"
 #include "net.h"
 #include "primitives/transaction.h"
+#include "saltedhasher.h"
 
 #include "evo/deterministicmns.h"
 
+#include <deque>
+
 class CTxLockVote;
 class COutPointLock;
 class CTxLockRequest;
@@ -57,17 +60,24 @@ private:
     // maps for AlreadyHave
     std::map<uint256, CTxLockRequest> mapLockRequestAccepted; ///< Tx hash - Tx
     std::map<uint256, CTxLockRequest> mapLockRequestRejected; ///< Tx hash - Tx
-    std::map<uint256, CTxLockVote> mapTxLockVotes; ///< Vote hash - Vote
+    std::unordered_map<uint256, CTxLockVote, StaticSaltedHasher> mapTxLockVotes; ///< Vote hash - Vote
     std::map<uint256, CTxLockVote> mapTxLockVotesOrphan; ///< Vote hash - Vote
 
-    std::map<uint256, CTxLockCandidate> mapTxLockCandidates; ///< Tx hash - Lock candidate
+    std::unordered_map<uint256, CTxLockCandidate, StaticSaltedHasher> mapTxLockCandidates; ///< Tx hash - Lock candidate
 
-    std::map<COutPoint, std::set<uint256> > mapVotedOutpoints; ///< UTXO - Tx hash set
-    std::map<COutPoint, uint256> mapLockedOutpoints; ///< UTXO - Tx hash
+    std::unordered_map<COutPoint, std::set<uint256>, StaticSaltedHasher> mapVotedOutpoints; ///< UTXO - Tx hash set
+    std::unordered_map<COutPoint, uint256, StaticSaltedHasher> mapLockedOutpoints; ///< UTXO - Tx hash
 
     /// Track masternodes who voted with no txlockrequest (for DOS protection)
     std::map<COutPoint, int64_t> mapMasternodeOrphanVotes; ///< MN outpoint - Time
 
+    /// Memory only, candidates and votes by the height they were confirmed at, so CheckAndRemove()
+    /// only visits the ones which can be expired. Entries can be outdated and are checked again.
+    std::map<int, std::vector<uint256> > mapCandidatesByConfirmedHeight; ///< Height - Tx hashes
+    std::map<int, std::vector<uint256> > mapVotesByConfirmedHeight; ///< Height - Vote hashes
+    /// Memory only, votes in the order they can fail in, see CTxLockVote::IsFailed()
+    std::deque<std::pair<int64_t, uint256> > dequeVotesToCheck; ///< Time to check - Vote hash
+
     bool CreateTxLockCandidate(const CTxLockRequest& txLockRequest);
     void CreateEmptyTxLockCandidate(const uint256& txHash);
     void Vote(CTxLockCandidate& txLockCandidate, CConnman& connman);
@@ -86,6 +96,12 @@ private:
     void UpdateLockedTransaction(const CTxLockCandidate& txLockCandidate);
     bool ResolveConflicts(const CTxLockCandidate& txLockCandidate);
 
+    /// Store a vote in mapTxLockVotes and schedule it for the failure check, false if it's known already
+    bool InsertTxLockVote(const uint256& nVoteHash, const CTxLockVote& vote);
+    void SetCandidateConfirmedHeight(CTxLockCandidate& txLockCandidate, int nHeight);
+    void SetVoteConfirmedHeight(const uint256& nVoteHash, CTxLockVote& vote, int nHeight);
+    void RebuildExpiryIndexes();
+
 public:
     mutable CCriticalSection cs_instantsend;
 
@@ -115,6 +131,9 @@ public:
         if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
             Clear();
         }
+        if (ser_action.ForRead()) {
+            RebuildExpiryIndexes();
+        }
     }
 
     void Clear();
@@ -383,6 +402,7 @@ public:
     int CountVotes() const;
 
     void SetConfirmedHeight(int nConfirmedHeightIn) { nConfirmedHeight = nConfirmedHeightIn; }
+    int GetConfirmedHeight() const { return nConfirmedHeight; }
     bool IsExpired(int nHeight) const;
     bool IsTimedOut() const;
 
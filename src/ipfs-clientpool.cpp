@@ -0,0 +1,126 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "ipfs-clientpool.h"
+#include "tinyformat.h"
+#include "util.h"
+
+CIPFSClientPool ipfsClientPool;
+
+CIPFSClientPool::CIPFSClientPool() :
+    strHost("localhost"),
+    nPort(DEFAULT_IPFS_API_PORT),
+    nGeneration(0)
+{
+}
+
+void CIPFSClientPool::SetEndpoint(const std::string& strHostIn, int nPortIn)
+{
+    LOCK(cs);
+    if (strHostIn == strHost && nPortIn == nPort) {
+        return;
+    }
+    strHost = strHostIn;
+    nPort = nPortIn;
+    nGeneration++;
+    vecIdleClients.clear();
+    LogPrintf("CIPFSClientPool::%s -- using IPFS API at %s:%d\n", __func__, strHost, nPort);
+}
+
+std::string CIPFSClientPool::GetEndpoint() const
+{
+    LOCK(cs);
+    return strprintf("%s:%d", strHost, nPort);
+}
+
+CIPFSClientPool::ClientPtr CIPFSClientPool::Acquire()
+{
+    LOCK(cs);
+
+    std::unique_ptr<ipfs::Client> pclient;
+    if (!vecIdleClients.empty()) {
+        pclient = std::move(vecIdleClients.back());
+        vecIdleClients.pop_back();
+    } else {
+        pclient.reset(new ipfs::Client(strHost, nPort, new ipfs::http::TransportCurlMultiAdapter(GetTransport(), IPFS_REQUEST_TIMEOUT_MS)));
+    }
+
+    uint64_t nClientGeneration = nGeneration;
+    return ClientPtr(pclient.release(), [this, nClientGeneration](ipfs::Client* p) {
+        Release(p, nClientGeneration);
+    });
+}
+
+std::future<std::string> CIPFSClientPool::FetchAsync(const std::string& strMethod, long nTimeoutMs)
+{
+    std::string strUrl;
+    std::shared_ptr<ipfs::http::TransportCurlMulti> transportCopy;
+    {
+        LOCK(cs);
+        strUrl = strprintf("http://%s:%d/api/v0/%s", strHost, nPort, strMethod);
+        transportCopy = GetTransport();
+    }
+    return transportCopy->FetchAsync(strUrl, {}, nTimeoutMs);
+}
+
+std::shared_ptr<ipfs::http::TransportCurlMulti> CIPFSClientPool::GetTransport()
+{
+    AssertLockHeld(cs);
+    if (!transport) {
+        transport = std::make_shared<ipfs::http::TransportCurlMulti>();
+    }
+    return transport;
+}
+
+void CIPFSClientPool::Release(ipfs::Client* pclient, uint64_t nClientGeneration)
+{
+    std::unique_ptr<ipfs::Client> ptr(pclient);
+
+    LOCK(cs);
+    if (nClientGeneration == nGeneration && vecIdleClients.size() < MAX_IPFS_IDLE_CLIENTS) {
+        vecIdleClients.emplace_back(std::move(ptr));
+    }
+}
+
+size_t CIPFSClientPool::GetIdleCount() const
+{
+    LOCK(cs);
+    return vecIdleClients.size();
+}
+
+size_t CIPFSClientPool::GetInFlightCount() const
+{
+    LOCK(cs);
+    return transport ? transport->GetInFlightCount() : 0;
+}
+
+void CIPFSClientPool::Clear()
+{
+    LOCK(cs);
+    nGeneration++;
+    vecIdleClients.clear();
+}
+
+void CIPFSClientPool::Interrupt()
+{
+    LOCK(cs);
+    if (transport) {
+        transport->Interrupt();
+    }
+}
+
+void CIPFSClientPool::Stop()
+{
+    std::shared_ptr<ipfs::http::TransportCurlMulti> transportCopy;
+    {
+        LOCK(cs);
+        nGeneration++;
+        vecIdleClients.clear();
+        transportCopy.swap(transport);
+    }
+    if (transportCopy) {
+        // clients still out there keep the transport alive, but fail right away
+        transportCopy->Shutdown();
+    }
+}
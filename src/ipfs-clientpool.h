@@ -0,0 +1,79 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef IPFS_CLIENTPOOL_H
+#define IPFS_CLIENTPOOL_H
+
+#include "client.h"
+#include "sync.h"
+#include "transport-curl-multi.h"
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CIPFSClientPool;
+extern CIPFSClientPool ipfsClientPool;
+
+static const char* const DEFAULT_IPFS_API = "localhost:5001";
+static const int DEFAULT_IPFS_API_PORT = 5001;
+// Number of idle clients we hold on to
+static const size_t MAX_IPFS_IDLE_CLIENTS = 8;
+// No call to the IPFS daemon takes longer than this
+static const long IPFS_REQUEST_TIMEOUT_MS = 30 * 1000;
+
+/**
+ * Process-wide pool of ipfs::Client instances talking to the local IPFS daemon.
+ *
+ * All clients run their requests on one shared curl multi transport, whose event
+ * thread drives every transfer and keeps the connections to the daemon alive
+ * between requests. A client is used by one thread at a time and goes back to the
+ * pool when the returned pointer is destroyed. Its calls block, but never longer
+ * than IPFS_REQUEST_TIMEOUT_MS, and Interrupt() aborts all of them at once.
+ * Callers which don't want to block a thread use FetchAsync().
+ */
+class CIPFSClientPool
+{
+public:
+    typedef std::unique_ptr<ipfs::Client, std::function<void(ipfs::Client*)> > ClientPtr;
+
+private:
+    mutable CCriticalSection cs;
+
+    std::string strHost;
+    int nPort;
+    // bumped whenever the endpoint changes so that clients for the old one are dropped
+    uint64_t nGeneration;
+    std::vector<std::unique_ptr<ipfs::Client> > vecIdleClients;
+    // created on first use, so that no thread is started for nodes which never talk to IPFS
+    std::shared_ptr<ipfs::http::TransportCurlMulti> transport;
+
+public:
+    CIPFSClientPool();
+
+    void SetEndpoint(const std::string& strHostIn, int nPortIn);
+    std::string GetEndpoint() const;
+
+    ClientPtr Acquire();
+
+    /// Call an API method (e.g. "version") without blocking the caller
+    std::future<std::string> FetchAsync(const std::string& strMethod, long nTimeoutMs = IPFS_REQUEST_TIMEOUT_MS);
+
+    size_t GetIdleCount() const;
+    size_t GetInFlightCount() const;
+    void Clear();
+
+    /// Abort all requests in flight and fail the ones made from now on
+    void Interrupt();
+    /// Stop the transport, call Interrupt() and stop all users of the pool first
+    void Stop();
+
+private:
+    void Release(ipfs::Client* pclient, uint64_t nClientGeneration);
+    std::shared_ptr<ipfs::http::TransportCurlMulti> GetTransport();
+};
+
+#endif
@@ -0,0 +1,109 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "ipfs-health.h"
+#include "ipfs-clientpool.h"
+#include "util.h"
+#include "utiltime.h"
+
+CIPFSHealthMonitor ipfsHealthMonitor;
+
+CIPFSHealthMonitor::CIPFSHealthMonitor()
+{
+    workInterrupt.reset();
+}
+
+CIPFSHealthMonitor::~CIPFSHealthMonitor()
+{
+}
+
+void CIPFSHealthMonitor::StartWorkerThread()
+{
+    // can't start new thread if we have one running already
+    if (workThread.joinable()) {
+        assert(false);
+    }
+
+    workThread = std::thread(&TraceThread<std::function<void()> >,
+        "ipfshealth",
+        std::function<void()>(std::bind(&CIPFSHealthMonitor::WorkThreadMain, this)));
+}
+
+void CIPFSHealthMonitor::StopWorkerThread()
+{
+    if (!workThread.joinable()) {
+        return;
+    }
+
+    // make sure to call InterruptWorkerThread() first
+    if (!workInterrupt) {
+        assert(false);
+    }
+
+    workThread.join();
+}
+
+void CIPFSHealthMonitor::InterruptWorkerThread()
+{
+    workInterrupt();
+}
+
+bool CIPFSHealthMonitor::Probe()
+{
+    int64_t nStart = GetTimeMillis();
+    bool fOk = false;
+
+    try {
+        // never wait for an unresponsive daemon longer than until the next check
+        std::future<std::string> version = ipfsClientPool.FetchAsync("version", IPFS_HEALTH_CHECK_TIMEOUT * 1000);
+        while (version.wait_for(std::chrono::milliseconds(100)) != std::future_status::ready) {
+            if (workInterrupt) {
+                return false;
+            }
+        }
+        ipfs::Json::parse(version.get());
+        fOk = true;
+    } catch (const std::exception& e) {
+        LogPrint("ipfs", "CIPFSHealthMonitor::%s -- IPFS daemon at %s is not reachable: %s\n", __func__, ipfsClientPool.GetEndpoint(), e.what());
+    }
+
+    int64_t nNow = GetTimeMillis();
+    nLastCheckTime = nNow / 1000;
+
+    if (fOk) {
+        nLastLatencyMs = nNow - nStart;
+        nLastSeenTime = nNow / 1000;
+        nFailures = 0;
+    } else {
+        nFailures++;
+    }
+
+    if (fActive.exchange(fOk) != fOk) {
+        LogPrintf("CIPFSHealthMonitor::%s -- IPFS daemon at %s is %s\n", __func__, ipfsClientPool.GetEndpoint(), fOk ? "ENABLED" : "not ENABLED");
+    }
+
+    return fOk;
+}
+
+void CIPFSHealthMonitor::WorkThreadMain()
+{
+    while (!workInterrupt) {
+        Probe();
+        if (!workInterrupt.sleep_for(std::chrono::seconds(IPFS_HEALTH_CHECK_INTERVAL))) {
+            return;
+        }
+    }
+}
+
+UniValue CIPFSHealthMonitor::ToJson() const
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("endpoint", ipfsClientPool.GetEndpoint()));
+    obj.push_back(Pair("active", IsActive()));
+    obj.push_back(Pair("lastCheck", (int64_t)nLastCheckTime));
+    obj.push_back(Pair("lastSeen", GetLastSeenTime()));
+    obj.push_back(Pair("latencyMs", GetLastLatencyMs()));
+    obj.push_back(Pair("failures", (int)nFailures));
+    return obj;
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef IPFS_HEALTH_H
+#define IPFS_HEALTH_H
+
+#include "threadinterrupt.h"
+
+#include <univalue.h>
+
+#include <atomic>
+#include <thread>
+
+class CIPFSHealthMonitor;
+extern CIPFSHealthMonitor ipfsHealthMonitor;
+
+// How often the local IPFS daemon is probed
+static const int IPFS_HEALTH_CHECK_INTERVAL = 30;
+// A probe fails when the daemon didn't answer within this many seconds
+static const int IPFS_HEALTH_CHECK_TIMEOUT = 10;
+
+/**
+ * Keeps track of whether the local IPFS daemon is reachable.
+ *
+ * A worker thread asks the daemon for its version every IPFS_HEALTH_CHECK_INTERVAL
+ * seconds and publishes the result. Readers (e.g. CActiveMasternodeManager state
+ * transitions) only look at the cached values and never wait for the daemon.
+ */
+class CIPFSHealthMonitor
+{
+private:
+    std::atomic<bool> fActive{false};
+    std::atomic<int64_t> nLastCheckTime{0};
+    std::atomic<int64_t> nLastSeenTime{0};
+    std::atomic<int64_t> nLastLatencyMs{-1};
+    std::atomic<int> nFailures{0};
+
+    std::thread workThread;
+    CThreadInterrupt workInterrupt;
+
+public:
+    CIPFSHealthMonitor();
+    ~CIPFSHealthMonitor();
+
+    void StartWorkerThread();
+    void StopWorkerThread();
+    void InterruptWorkerThread();
+
+    /// Probe the daemon right now (blocking) and update the cached status
+    bool Probe();
+
+    bool IsActive() const { return fActive; }
+    int64_t GetLastSeenTime() const { return nLastSeenTime; }
+    int64_t GetLastLatencyMs() const { return nLastLatencyMs; }
+
+    UniValue ToJson() const;
+
+private:
+    void WorkThreadMain();
+};
+
+#endif
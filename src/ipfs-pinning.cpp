@@ -0,0 +1,951 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "ipfs-pinning.h"
+#include "activemasternode.h"
+#include "governance.h"
+#include "hash.h"
+#include "init.h"
+#include "ipfs-clientpool.h"
+#include "ipfs-utils.h"
+#include "masternode-meta.h"
+#include "masternode-sync.h"
+#include "spork.h"
+#include "trace.h"
+#include "util.h"
+#include "utiltime.h"
+#include "validationinterface.h"
+
+#include "evo/deterministicmns.h"
+
+#include "json.hpp"
+
+#include <algorithm>
+
+CIPFSPinManager ipfsPinManager;
+
+static const std::string DB_UNPIN = "u";
+
+using json = nlohmann::json;
+
+// Walks all leaves of j, stops as soon as f returns false
+template <class UnaryFunction>
+static bool RecursiveIPFSIterate(const json& j, UnaryFunction f)
+{
+    for (auto it = j.begin(); it != j.end(); ++it) {
+        if (it->is_structured()) {
+            if (!RecursiveIPFSIterate(*it, f)) {
+                return false;
+            }
+        } else if (!f(it)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Run a call of the IPFS client, the ipfs:call tracepoint reports its latency and whether it succeeded
+template <typename Callable>
+static void TracedIPFSCall(const char* pszCall, const std::string& strPath, Callable&& call)
+{
+    TRACE_TIME_START(nTraceStart);
+    try {
+        call();
+    } catch (...) {
+        TRACE4(ipfs, call, pszCall, strPath.c_str(), false, TRACE_TIME_ELAPSED(nTraceStart));
+        throw;
+    }
+    TRACE4(ipfs, call, pszCall, strPath.c_str(), true, TRACE_TIME_ELAPSED(nTraceStart));
+}
+
+/**
+ * Determine the size of the content behind strPath, giving up as soon as it is known to be above nMaxSize.
+ * object/stat returns the cumulative size of the whole DAG in a single small response, so the directory
+ * listing is only fetched and summed up when the daemon doesn't report it.
+ * Returns false when nSizeRet is only a lower bound which already exceeds nMaxSize.
+ */
+static bool GetIPFSObjectSize(ipfs::Client& ipfsclient, const std::string& strPath, int64_t nMaxSize, int64_t& nSizeRet)
+{
+    nSizeRet = 0;
+
+    ipfs::Json stat;
+    TracedIPFSCall("object_stat", strPath, [&] { ipfsclient.ObjectStat(strPath, &stat); });
+    auto itSize = stat.find("CumulativeSize");
+    if (itSize != stat.end() && itSize->is_number()) {
+        nSizeRet = itSize->get<int64_t>();
+        return nSizeRet <= nMaxSize;
+    }
+
+    ipfs::Json ls_result;
+    TracedIPFSCall("files_ls", strPath, [&] { ipfsclient.FilesLs(strPath, &ls_result); });
+    return RecursiveIPFSIterate(ls_result, [&nSizeRet, nMaxSize](json::const_iterator it) {
+        if (it.key() == "Size" && it.value().is_number()) {
+            nSizeRet += it.value().get<int64_t>();
+        }
+        return nSizeRet <= nMaxSize;
+    });
+}
+
+UniValue CIPFSPinEntry::ToJson() const
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("objectHash", nObjectHash.ToString()));
+    obj.push_back(Pair("status", CIPFSPinManager::StatusToString(status)));
+    obj.push_back(Pair("attempts", nAttempts));
+    obj.push_back(Pair("size", nSize));
+    obj.push_back(Pair("lastUpdate", nLastUpdateTime));
+    if (!IsFinished()) {
+        obj.push_back(Pair("nextAttempt", nNextAttemptTime));
+    }
+    if (!strLastError.empty()) {
+        obj.push_back(Pair("lastError", strLastError));
+    }
+    if (!strHintPeer.empty()) {
+        obj.push_back(Pair("hintPeer", strHintPeer));
+    }
+    return obj;
+}
+
+CIPFSPinAssignment::CIPFSPinAssignment(int nReplicasIn, const std::vector<std::string>& vecPeerIDsIn, const std::string& strLocalPeerID) :
+    nReplicas(nReplicasIn),
+    vecPeerIDs(vecPeerIDsIn)
+{
+    assert(nReplicas > 0);
+
+    std::sort(vecPeerIDs.begin(), vecPeerIDs.end());
+    vecPeerIDs.erase(std::unique(vecPeerIDs.begin(), vecPeerIDs.end()), vecPeerIDs.end());
+
+    vecPeerKeys.reserve(vecPeerIDs.size());
+    for (size_t i = 0; i < vecPeerIDs.size(); i++) {
+        vecPeerKeys.push_back(Hash(vecPeerIDs[i].begin(), vecPeerIDs[i].end()).GetUint64(0));
+        if (vecPeerIDs[i] == strLocalPeerID) {
+            nLocalPeer = i;
+        }
+    }
+}
+
+uint64_t CIPFSPinAssignment::GetScore(size_t nPeer, const std::string& strCID) const
+{
+    return CSipHasher(vecPeerKeys[nPeer], 0).Write((const unsigned char*)strCID.data(), strCID.size()).Finalize();
+}
+
+std::vector<std::string> CIPFSPinAssignment::GetResponsiblePeers(const std::string& strCID) const
+{
+    // highest score first, ties go to the lower index
+    std::vector<std::pair<uint64_t, size_t> > vecScores;
+    vecScores.reserve(vecPeerIDs.size());
+    for (size_t i = 0; i < vecPeerIDs.size(); i++) {
+        vecScores.emplace_back(~GetScore(i, strCID), i);
+    }
+    size_t nCount = std::min(vecScores.size(), (size_t)nReplicas);
+    std::partial_sort(vecScores.begin(), vecScores.begin() + nCount, vecScores.end());
+
+    std::vector<std::string> vecResult;
+    for (size_t i = 0; i < nCount; i++) {
+        vecResult.push_back(vecPeerIDs[vecScores[i].second]);
+    }
+    return vecResult;
+}
+
+bool CIPFSPinAssignment::IsLocalResponsible(const std::string& strCID) const
+{
+    if (nLocalPeer < 0) {
+        return false;
+    }
+    if ((size_t)nReplicas >= vecPeerIDs.size()) {
+        return true;
+    }
+
+    uint64_t nLocalScore = GetScore(nLocalPeer, strCID);
+    int nAhead = 0;
+    for (size_t i = 0; i < vecPeerIDs.size(); i++) {
+        uint64_t nScore = GetScore(i, strCID);
+        if (nScore > nLocalScore || (nScore == nLocalScore && (int)i < nLocalPeer)) {
+            if (++nAhead >= nReplicas) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+CIPFSPinManager::CIPFSPinManager()
+{
+    workInterrupt.reset();
+}
+
+CIPFSPinManager::~CIPFSPinManager()
+{
+}
+
+void CIPFSPinManager::StartWorkerThreads(int nThreads)
+{
+    // can't start new threads if we have some running already
+    if (!workThreads.empty()) {
+        assert(false);
+    }
+
+    nThreads = std::max(1, std::min(nThreads, MAX_IPFS_PIN_THREADS));
+    for (int i = 0; i < nThreads; i++) {
+        workThreads.emplace_back(&TraceThread<std::function<void()> >,
+            "ipfspin",
+            std::function<void()>(std::bind(&CIPFSPinManager::WorkThreadMain, this)));
+    }
+    LogPrintf("CIPFSPinManager::%s -- started %d worker threads\n", __func__, nThreads);
+}
+
+void CIPFSPinManager::StopWorkerThreads()
+{
+    if (workThreads.empty()) {
+        return;
+    }
+
+    // make sure to call InterruptWorkerThreads() first
+    if (!workInterrupt) {
+        assert(false);
+    }
+
+    for (auto& t : workThreads) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+    workThreads.clear();
+}
+
+void CIPFSPinManager::InterruptWorkerThreads()
+{
+    workInterrupt();
+}
+
+bool CIPFSPinManager::QueuePin(const uint256& nObjectHash, const std::string& strCID, const std::string& strHintPeer)
+{
+    LOCK(cs);
+
+    if (!IsResponsible(strCID)) {
+        LogPrint("ipfs", "CIPFSPinManager::%s -- CID %s is pinned by other masternodes\n", __func__, strCID);
+        return false;
+    }
+
+    // the CID is referenced again, make sure it doesn't get unpinned
+    if (mapPendingUnpins.erase(strCID)) {
+        LogPrint("ipfs", "CIPFSPinManager::%s -- canceled unpin of CID %s\n", __func__, strCID);
+        if (pdb) {
+            pdb->Erase(std::make_pair(DB_UNPIN, strCID), true);
+        }
+    }
+
+    auto it = mapEntries.find(strCID);
+    if (it != mapEntries.end() && it->second.status != IPFS_PIN_FAILED) {
+        LogPrint("ipfs", "CIPFSPinManager::%s -- CID %s already known, status=%s\n", __func__, strCID, StatusToString(it->second.status));
+        return false;
+    }
+
+    if (setScheduled.size() >= MAX_IPFS_PIN_QUEUE_SIZE) {
+        LogPrintf("CIPFSPinManager::%s -- queue is full, dropping CID %s\n", __func__, strCID);
+        return false;
+    }
+
+    int64_t nNow = GetTime();
+
+    CIPFSPinEntry& entry = mapEntries[strCID];
+    entry = CIPFSPinEntry();
+    entry.nObjectHash = nObjectHash;
+    entry.strHintPeer = strHintPeer;
+    entry.nNextAttemptTime = nNow;
+    entry.nLastUpdateTime = nNow;
+    setScheduled.emplace(nNow, strCID);
+
+    LogPrint("ipfs", "CIPFSPinManager::%s -- queued CID %s for object %s\n", __func__, strCID, nObjectHash.ToString());
+    return true;
+}
+
+bool CIPFSPinManager::GetEntry(const std::string& strCID, CIPFSPinEntry& entryRet) const
+{
+    LOCK(cs);
+    auto it = mapEntries.find(strCID);
+    if (it == mapEntries.end()) {
+        return false;
+    }
+    entryRet = it->second;
+    return true;
+}
+
+size_t CIPFSPinManager::GetQueueSize() const
+{
+    LOCK(cs);
+    return setScheduled.size();
+}
+
+bool CIPFSPinManager::PopScheduled(std::string& strCIDRet)
+{
+    LOCK(cs);
+
+    if (setScheduled.empty() || setScheduled.begin()->first > GetTime()) {
+        return false;
+    }
+
+    strCIDRet = setScheduled.begin()->second;
+    setScheduled.erase(setScheduled.begin());
+
+    auto& entry = mapEntries[strCIDRet];
+    entry.status = IPFS_PIN_IN_PROGRESS;
+    entry.nAttempts++;
+    entry.nLastUpdateTime = GetTime();
+    return true;
+}
+
+void CIPFSPinManager::StartReconciliation(const std::map<std::string, uint256>& mapCIDs)
+{
+    LOCK(cs);
+
+    mapReconcileRequest = mapCIDs;
+    fReconcileRequested = true;
+    fReconciling = true;
+    vecReconcileMissing.clear();
+    setReconcileInFlight.clear();
+    nReconcileTotal = 0;
+    nReconcileDone = 0;
+
+    LogPrintf("CIPFSPinManager::%s -- reconciling %d CIDs\n", __func__, (int)mapCIDs.size());
+}
+
+bool CIPFSPinManager::IsReconciling() const
+{
+    LOCK(cs);
+    return fReconciling;
+}
+
+void CIPFSPinManager::GetReconcileProgress(int& nDoneRet, int& nTotalRet) const
+{
+    LOCK(cs);
+    nDoneRet = nReconcileDone;
+    nTotalRet = nReconcileTotal;
+}
+
+bool CIPFSPinManager::TakeReconcileRequest(std::map<std::string, uint256>& mapCIDsRet)
+{
+    LOCK(cs);
+
+    if (!fReconcileRequested) {
+        return false;
+    }
+    fReconcileRequested = false;
+    mapCIDsRet.swap(mapReconcileRequest);
+    mapReconcileRequest.clear();
+    return true;
+}
+
+void CIPFSPinManager::Reconcile(const std::map<std::string, uint256>& mapCIDs)
+{
+    ipfs::Json pinned;
+    try {
+        auto ipfsclient = ipfsClientPool.Acquire();
+        ipfsclient->PinLs(&pinned);
+    } catch (const std::exception& e) {
+        // nothing we can do about it here, objects are still pinned one by one when they are (re)added
+        LogPrintf("CIPFSPinManager::%s -- failed to list pins: %s\n", __func__, e.what());
+        LOCK(cs);
+        fReconciling = false;
+        return;
+    }
+
+    auto itKeys = pinned.find("Keys");
+    bool fHaveKeys = itKeys != pinned.end() && itKeys->is_object();
+
+    LOCK(cs);
+
+    int64_t nNow = GetTime();
+    for (const auto& p : mapCIDs) {
+        if (fHaveKeys && itKeys->count(p.first)) {
+            if (IsAssignedElsewhere(p.first)) {
+                QueueUnpin(p.first, IPFS_PIN_HANDOVER_DELAY);
+                continue;
+            }
+            CIPFSPinEntry& entry = mapEntries[p.first];
+            if (!entry.IsFinished() && entry.status != IPFS_PIN_QUEUED) {
+                // a worker is already on it
+                continue;
+            }
+            if (entry.status == IPFS_PIN_QUEUED) {
+                // already pinned, don't let the queued attempt block rescheduling it later
+                setScheduled.erase(std::make_pair(entry.nNextAttemptTime, p.first));
+            }
+            entry.nObjectHash = p.second;
+            entry.status = IPFS_PIN_PINNED;
+            entry.nLastUpdateTime = nNow;
+            continue;
+        }
+        if (!IsResponsible(p.first)) {
+            continue;
+        }
+        vecReconcileMissing.emplace_back(p.first, p.second);
+    }
+    nReconcileTotal = vecReconcileMissing.size();
+
+    LogPrintf("CIPFSPinManager::%s -- %d of %d CIDs are not pinned yet\n", __func__, nReconcileTotal, (int)mapCIDs.size());
+
+    FeedReconcileBatch();
+}
+
+void CIPFSPinManager::FeedReconcileBatch()
+{
+    LOCK(cs);
+
+    if (!fReconciling || fReconcileRequested) {
+        return;
+    }
+
+    auto it = setReconcileInFlight.begin();
+    while (it != setReconcileInFlight.end()) {
+        auto itEntry = mapEntries.find(*it);
+        if (itEntry == mapEntries.end() || itEntry->second.IsFinished()) {
+            nReconcileDone++;
+            setReconcileInFlight.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+
+    while (setReconcileInFlight.size() < IPFS_RECONCILE_BATCH_SIZE && !vecReconcileMissing.empty()) {
+        const auto& p = vecReconcileMissing.back();
+        if (QueuePin(p.second, p.first) || mapEntries.count(p.first)) {
+            setReconcileInFlight.emplace(p.first);
+        } else {
+            // queue is full or we failed for some other reason, count it as done to not stall
+            nReconcileDone++;
+        }
+        vecReconcileMissing.pop_back();
+    }
+
+    if (vecReconcileMissing.empty() && setReconcileInFlight.empty()) {
+        LogPrintf("CIPFSPinManager::%s -- reconciliation finished, %d pins processed\n", __func__, nReconcileDone);
+        fReconciling = false;
+    }
+}
+
+void CIPFSPinManager::InitDB()
+{
+    LOCK(cs);
+
+    pdb.reset(new CDBWrapper(GetDataDir() / "ipfs", 1 << 20));
+
+    std::unique_ptr<CDBIterator> pcursor(pdb->NewIterator());
+    auto start = std::make_pair(DB_UNPIN, std::string());
+    pcursor->Seek(start);
+
+    int64_t nNow = GetTime();
+    while (pcursor->Valid()) {
+        std::pair<std::string, std::string> key;
+        if (!pcursor->GetKey(key) || key.first != DB_UNPIN) {
+            break;
+        }
+        mapPendingUnpins.emplace(key.second, nNow);
+        pcursor->Next();
+    }
+
+    LogPrintf("CIPFSPinManager::%s -- %d pending unpins\n", __func__, (int)mapPendingUnpins.size());
+}
+
+void CIPFSPinManager::CloseDB()
+{
+    LOCK(cs);
+    pdb.reset();
+}
+
+void CIPFSPinManager::QueueUnpin(const std::string& strCID, int64_t nDelay)
+{
+    LOCK(cs);
+
+    if (!pdb) {
+        // not pinning anything either
+        return;
+    }
+
+    // don't keep the old pin status around, the CID must be pinned again if it shows up again
+    auto it = mapEntries.find(strCID);
+    if (it != mapEntries.end() && it->second.IsFinished()) {
+        mapEntries.erase(it);
+    }
+
+    if (mapPendingUnpins.emplace(strCID, GetTime() + nDelay).second) {
+        pdb->Write(std::make_pair(DB_UNPIN, strCID), (uint8_t)1, true);
+        LogPrint("ipfs", "CIPFSPinManager::%s -- queued unpin of CID %s\n", __func__, strCID);
+    }
+}
+
+size_t CIPFSPinManager::GetPendingUnpinCount() const
+{
+    LOCK(cs);
+    return mapPendingUnpins.size();
+}
+
+bool CIPFSPinManager::PopUnpin(std::string& strCIDRet)
+{
+    LOCK(cs);
+
+    int64_t nNow = GetTime();
+    for (const auto& p : mapPendingUnpins) {
+        if (p.second > nNow || setUnpinsInFlight.count(p.first)) {
+            continue;
+        }
+        auto it = mapEntries.find(p.first);
+        if (it != mapEntries.end() && !it->second.IsFinished()) {
+            // wait for the pin attempt to finish, unpinning first would leak the pin
+            continue;
+        }
+        strCIDRet = p.first;
+        setUnpinsInFlight.emplace(strCIDRet);
+        return true;
+    }
+    return false;
+}
+
+void CIPFSPinManager::ProcessUnpin(const std::string& strCID)
+{
+    if (governance.HaveObjectForIPFSCID(strCID) && !IsAssignedElsewhere(strCID)) {
+        // got re-added in the meantime
+        FinishUnpin(strCID, true);
+        return;
+    }
+
+    try {
+        auto ipfsclient = ipfsClientPool.Acquire();
+        TracedIPFSCall("pin_rm", strCID, [&] { ipfsclient->PinRm(strCID, ipfs::Client::PinRmOptions::RECURSIVE); });
+        LogPrintf("CIPFSPinManager::%s -- unpinned CID %s\n", __func__, strCID);
+    } catch (const std::exception& e) {
+        std::string strError = e.what();
+        if (strError.find("not pinned") == std::string::npos) {
+            LogPrint("ipfs", "CIPFSPinManager::%s -- failed to unpin CID %s: %s\n", __func__, strCID, strError);
+            FinishUnpin(strCID, false);
+            return;
+        }
+    }
+    FinishUnpin(strCID, true);
+
+    CIPFSPinEvent event;
+    event.type = CIPFSPinEvent::UNPINNED;
+    event.strCID = strCID;
+    GetMainSignals().NotifyIPFSPinEvent(event);
+}
+
+void CIPFSPinManager::FinishUnpin(const std::string& strCID, bool fDone)
+{
+    LOCK(cs);
+
+    setUnpinsInFlight.erase(strCID);
+    auto it = mapPendingUnpins.find(strCID);
+    if (it == mapPendingUnpins.end()) {
+        // canceled by QueuePin() while we were at it
+        return;
+    }
+    if (!fDone) {
+        it->second = GetTime() + IPFS_PIN_RETRY_BASE;
+        return;
+    }
+    mapPendingUnpins.erase(it);
+    if (pdb) {
+        pdb->Erase(std::make_pair(DB_UNPIN, strCID), true);
+    }
+}
+
+void CIPFSPinManager::SetReplicas(int nReplicasIn)
+{
+    LOCK(cs);
+    nReplicas = std::max(0, nReplicasIn);
+    assignment = CIPFSPinAssignment();
+    assignmentApplied = CIPFSPinAssignment();
+}
+
+int CIPFSPinManager::GetReplicas() const
+{
+    LOCK(cs);
+    return nReplicas;
+}
+
+bool CIPFSPinManager::IsResponsible(const std::string& strCID) const
+{
+    LOCK(cs);
+    if (nReplicas == 0) {
+        return true;
+    }
+    return !assignment.IsNull() && assignment.IsLocalResponsible(strCID);
+}
+
+bool CIPFSPinManager::IsAssignedElsewhere(const std::string& strCID) const
+{
+    LOCK(cs);
+    return nReplicas != 0 && !assignment.IsNull() && !assignment.IsLocalResponsible(strCID);
+}
+
+static std::string MakeSwarmAddress(const CService& addr, const std::string& strPeerID)
+{
+    if (!addr.IsValid() || (!addr.IsIPv4() && !addr.IsIPv6())) {
+        return "";
+    }
+    return strprintf("/%s/%s/tcp/%d/ipfs/%s", addr.IsIPv4() ? "ip4" : "ip6", addr.ToStringIP(), DEFAULT_IPFS_SWARM_PORT, strPeerID);
+}
+
+static bool IsPinningMasternode(const CDeterministicMNCPtr& dmn)
+{
+    return IsIpfsPeerIdValid(dmn->pdmnState->IPFSPeerID, 5000 * COIN) &&
+           CMasternodeMetaMan::CheckCollateralType(dmn->collateralOutpoint) == CMasternodeMetaMan::COLLATERAL_HIGH_OK;
+}
+
+std::string CIPFSPinManager::GetMasternodeSwarmAddress(const COutPoint& collateralOutpoint)
+{
+    auto dmn = deterministicMNManager->GetListAtChainTip().GetValidMNByCollateral(collateralOutpoint);
+    if (!dmn || !IsPinningMasternode(dmn)) {
+        return "";
+    }
+    return MakeSwarmAddress(dmn->pdmnState->addr, dmn->pdmnState->IPFSPeerID);
+}
+
+void CIPFSPinManager::UpdateMasternodePeers()
+{
+    std::vector<std::string> vecPeerIDs;
+    std::vector<std::string> vecAddresses;
+    std::string strLocalPeerID;
+    auto mnList = deterministicMNManager->GetListAtChainTip();
+    mnList.ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
+        if (!IsPinningMasternode(dmn)) {
+            return;
+        }
+        const std::string& strPeerID = dmn->pdmnState->IPFSPeerID;
+        vecPeerIDs.push_back(strPeerID);
+        if (dmn->proTxHash == activeMasternodeInfo.proTxHash) {
+            strLocalPeerID = strPeerID;
+            return;
+        }
+        std::string strAddress = MakeSwarmAddress(dmn->pdmnState->addr, strPeerID);
+        if (!strAddress.empty()) {
+            vecAddresses.push_back(strAddress);
+        }
+    });
+    std::sort(vecAddresses.begin(), vecAddresses.end());
+
+    LOCK(cs);
+
+    vecSwarmPeers.swap(vecAddresses);
+
+    if (nReplicas == 0) {
+        return;
+    }
+    CIPFSPinAssignment newAssignment(nReplicas, vecPeerIDs, strLocalPeerID);
+    if (newAssignment == assignment) {
+        return;
+    }
+    assignment = newAssignment;
+    LogPrintf("CIPFSPinManager::%s -- masternode list changed, %d pinning masternodes\n", __func__, (int)vecPeerIDs.size());
+}
+
+bool CIPFSPinManager::IsRebalanceNeeded() const
+{
+    LOCK(cs);
+    return nReplicas != 0 && assignment != assignmentApplied;
+}
+
+void CIPFSPinManager::Rebalance(const std::map<std::string, uint256>& mapCIDs)
+{
+    LOCK(cs);
+
+    if (nReplicas == 0 || assignment.IsNull()) {
+        return;
+    }
+
+    bool fComplete = true;
+    int nPins = 0;
+    int nUnpins = 0;
+    for (const auto& p : mapCIDs) {
+        const std::string& strCID = p.first;
+        bool fResponsible = assignment.IsLocalResponsible(strCID);
+        bool fWasResponsible = !assignmentApplied.IsNull() && assignmentApplied.IsLocalResponsible(strCID);
+        if (fResponsible == fWasResponsible && !assignmentApplied.IsNull()) {
+            continue;
+        }
+
+        auto it = mapEntries.find(strCID);
+        if (fResponsible) {
+            // the previous holder dropped out or the list grew, pin our replica
+            if (it != mapEntries.end() && it->second.status != IPFS_PIN_FAILED) {
+                continue;
+            }
+            if (QueuePin(p.second, strCID)) {
+                nPins++;
+            } else if (setScheduled.size() >= MAX_IPFS_PIN_QUEUE_SIZE) {
+                fComplete = false;
+            }
+            continue;
+        }
+
+        if (it != mapEntries.end() && (it->second.status == IPFS_PIN_QUEUED || it->second.status == IPFS_PIN_RETRY)) {
+            // not pinned yet, no need to unpin a QUEUED one
+            bool fMaybePinned = it->second.status == IPFS_PIN_RETRY;
+            setScheduled.erase(std::make_pair(it->second.nNextAttemptTime, strCID));
+            mapEntries.erase(it);
+            if (!fMaybePinned) {
+                continue;
+            }
+        } else if (it != mapEntries.end() ? it->second.status == IPFS_PIN_TOO_BIG || it->second.status == IPFS_PIN_FAILED : !fWasResponsible) {
+            continue;
+        }
+        QueueUnpin(strCID, IPFS_PIN_HANDOVER_DELAY);
+        nUnpins++;
+    }
+
+    if (fComplete) {
+        assignmentApplied = assignment;
+    }
+    LogPrintf("CIPFSPinManager::%s -- %d CIDs, %d pins queued, %d unpins queued%s\n", __func__,
+        (int)mapCIDs.size(), nPins, nUnpins, fComplete ? "" : ", queue is full");
+}
+
+void CIPFSPinManager::WorkThreadMain()
+{
+    while (!workInterrupt) {
+        std::map<std::string, uint256> mapCIDs;
+        if (TakeReconcileRequest(mapCIDs)) {
+            Reconcile(mapCIDs);
+            continue;
+        }
+        FeedReconcileBatch();
+
+        std::string strCID;
+        if (!PopScheduled(strCID)) {
+            if (PopUnpin(strCID)) {
+                ProcessUnpin(strCID);
+                continue;
+            }
+            if (!workInterrupt.sleep_for(std::chrono::milliseconds(100))) {
+                return;
+            }
+            continue;
+        }
+        ProcessEntry(strCID);
+    }
+}
+
+void CIPFSPinManager::ConnectSwarmPeers(ipfs::Client& ipfsclient, const std::string& strCID)
+{
+    std::vector<std::string> vecConnect;
+    {
+        LOCK(cs);
+
+        auto it = mapEntries.find(strCID);
+        if (it != mapEntries.end() && !it->second.strHintPeer.empty()) {
+            vecConnect.push_back(it->second.strHintPeer);
+        }
+
+        int64_t nNow = GetTime();
+        if (!vecSwarmPeers.empty() && nNow - nLastSwarmConnectTime >= IPFS_SWARM_CONNECT_INTERVAL) {
+            nLastSwarmConnectTime = nNow;
+            for (size_t i = 0; i < std::min(IPFS_SWARM_CONNECT_PEERS, vecSwarmPeers.size()); i++) {
+                vecConnect.push_back(vecSwarmPeers[nSwarmRotation++ % vecSwarmPeers.size()]);
+            }
+        }
+    }
+
+    // only speeds up finding providers, the pin attempt goes ahead either way
+    for (const auto& strAddress : vecConnect) {
+        try {
+            ipfsclient.SwarmConnect(strAddress);
+            LogPrint("ipfs", "CIPFSPinManager::%s -- connected to %s\n", __func__, strAddress);
+        } catch (const std::exception& e) {
+            LogPrint("ipfs", "CIPFSPinManager::%s -- failed to connect to %s: %s\n", __func__, strAddress, e.what());
+        }
+    }
+}
+
+void CIPFSPinManager::ProcessEntry(const std::string& strCID)
+{
+    std::string strPath = "/ipfs/" + strCID;
+    int64_t nMaxSize = sporkManager.GetSporkValue(SPORK_102_IPFS_OBJECT_SIZE);
+    int64_t nSize = 0;
+    bool fSizeOk;
+
+    auto ipfsclient = ipfsClientPool.Acquire();
+    ConnectSwarmPeers(*ipfsclient, strCID);
+
+    try {
+        fSizeOk = GetIPFSObjectSize(*ipfsclient, strPath, nMaxSize, nSize);
+    } catch (const std::exception& e) {
+        ScheduleRetry(strCID, e.what());
+        return;
+    }
+
+    {
+        LOCK(cs);
+        mapEntries[strCID].nSize = nSize;
+    }
+
+    if (!fSizeOk) {
+        LogPrintf("CIPFSPinManager::%s -- CID %s too big, size>=%d, max=%d\n", __func__, strCID, nSize, nMaxSize);
+        SetFinished(strCID, IPFS_PIN_TOO_BIG, "");
+        return;
+    }
+
+    try {
+        TracedIPFSCall("pin_add", strPath, [&] { ipfsclient->PinAdd(strPath); });
+    } catch (const std::exception& e) {
+        // The daemon sometimes reports an error even though the pin went through,
+        // so ask it directly before deciding to retry.
+        try {
+            ipfs::Json pinned;
+            ipfsclient->PinLs(strPath, &pinned);
+        } catch (const std::exception& e2) {
+            ScheduleRetry(strCID, e.what());
+            return;
+        }
+    }
+
+    LogPrintf("CIPFSPinManager::%s -- pinned CID %s, size=%d\n", __func__, strCID, nSize);
+    SetFinished(strCID, IPFS_PIN_PINNED, "");
+}
+
+void CIPFSPinManager::ScheduleRetry(const std::string& strCID, const std::string& strError)
+{
+    {
+        LOCK(cs);
+
+        auto it = mapEntries.find(strCID);
+        if (it == mapEntries.end()) {
+            return;
+        }
+        CIPFSPinEntry& entry = it->second;
+
+        if (entry.nAttempts < IPFS_PIN_MAX_ATTEMPTS) {
+            int64_t nDelay = std::min(IPFS_PIN_RETRY_BASE << std::min(entry.nAttempts - 1, 16), IPFS_PIN_RETRY_MAX);
+            int64_t nNow = GetTime();
+
+            entry.status = IPFS_PIN_RETRY;
+            entry.strLastError = strError;
+            entry.nLastUpdateTime = nNow;
+            entry.nNextAttemptTime = nNow + nDelay;
+            setScheduled.emplace(entry.nNextAttemptTime, strCID);
+
+            LogPrint("ipfs", "CIPFSPinManager::%s -- attempt %d for CID %s failed, retrying in %ds: %s\n", __func__, entry.nAttempts, strCID, nDelay, strError);
+            return;
+        }
+
+        LogPrintf("CIPFSPinManager::%s -- giving up on CID %s after %d attempts: %s\n", __func__, strCID, entry.nAttempts, strError);
+    }
+    SetFinished(strCID, IPFS_PIN_FAILED, strError);
+}
+
+void CIPFSPinManager::SetFinished(const std::string& strCID, ipfs_pin_status_enum_t status, const std::string& strError)
+{
+    CIPFSPinEvent event;
+    {
+        LOCK(cs);
+
+        auto it = mapEntries.find(strCID);
+        if (it == mapEntries.end()) {
+            return;
+        }
+        it->second.status = status;
+        it->second.strLastError = strError;
+        it->second.nLastUpdateTime = GetTime();
+
+        event.type = status == IPFS_PIN_PINNED ? CIPFSPinEvent::PINNED : CIPFSPinEvent::FAILED;
+        event.nObjectHash = it->second.nObjectHash;
+        event.strCID = strCID;
+        event.nSize = it->second.nSize;
+        event.strError = status == IPFS_PIN_TOO_BIG ? "too big" : strError;
+    }
+
+    // listeners must not be called while holding cs
+    GetMainSignals().NotifyIPFSPinEvent(event);
+}
+
+void CIPFSPinManager::CheckAndRemove()
+{
+    LOCK(cs);
+
+    int64_t nNow = GetTime();
+    auto it = mapEntries.begin();
+    while (it != mapEntries.end()) {
+        if (it->second.IsFinished() && nNow - it->second.nLastUpdateTime > IPFS_PIN_STATUS_EXPIRATION_TIME) {
+            mapEntries.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CIPFSPinManager::Clear()
+{
+    LOCK(cs);
+    mapEntries.clear();
+    setScheduled.clear();
+    mapReconcileRequest.clear();
+    fReconcileRequested = false;
+    fReconciling = false;
+    vecReconcileMissing.clear();
+    setReconcileInFlight.clear();
+    nReconcileTotal = 0;
+    nReconcileDone = 0;
+}
+
+std::string CIPFSPinManager::ToString() const
+{
+    LOCK(cs);
+
+    int nPinned = 0;
+    int nFailed = 0;
+    for (const auto& p : mapEntries) {
+        if (p.second.status == IPFS_PIN_PINNED) {
+            nPinned++;
+        } else if (p.second.status == IPFS_PIN_FAILED || p.second.status == IPFS_PIN_TOO_BIG) {
+            nFailed++;
+        }
+    }
+
+    return strprintf("IPFS pins: %d (queued: %d, pinned: %d, failed: %d), pending unpins: %d",
+        (int)mapEntries.size(), (int)setScheduled.size(), nPinned, nFailed, (int)mapPendingUnpins.size());
+}
+
+UniValue CIPFSPinManager::ToJson() const
+{
+    LOCK(cs);
+
+    UniValue obj(UniValue::VOBJ);
+    for (const auto& p : mapEntries) {
+        obj.push_back(Pair(p.first, p.second.ToJson()));
+    }
+    return obj;
+}
+
+void CIPFSPinManager::DoMaintenance()
+{
+    if (ShutdownRequested()) return;
+
+    CheckAndRemove();
+
+    // don't rebalance for every block of the initial sync
+    if (!fMasternodeMode || !masternodeSync.IsSynced()) return;
+
+    UpdateMasternodePeers();
+    if (IsRebalanceNeeded()) {
+        Rebalance(governance.GetIPFSCIDIndex());
+    }
+}
+
+std::string CIPFSPinManager::StatusToString(ipfs_pin_status_enum_t status)
+{
+    switch (status) {
+    case IPFS_PIN_QUEUED:
+        return "QUEUED";
+    case IPFS_PIN_IN_PROGRESS:
+        return "IN_PROGRESS";
+    case IPFS_PIN_RETRY:
+        return "RETRY";
+    case IPFS_PIN_PINNED:
+        return "PINNED";
+    case IPFS_PIN_TOO_BIG:
+        return "TOO_BIG";
+    case IPFS_PIN_FAILED:
+        return "FAILED";
+    }
+    return "UNKNOWN";
+}
@@ -0,0 +1,276 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef IPFS_PINNING_H
+#define IPFS_PINNING_H
+
+#include "dbwrapper.h"
+#include "sync.h"
+#include "threadinterrupt.h"
+#include "uint256.h"
+
+#include <univalue.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+class COutPoint;
+class CIPFSPinManager;
+extern CIPFSPinManager ipfsPinManager;
+
+namespace ipfs {
+class Client;
+}
+
+static const int DEFAULT_IPFS_PIN_THREADS = 2;
+static const int MAX_IPFS_PIN_THREADS = 16;
+
+// Maximum number of CIDs waiting to be checked/pinned at any time
+static const size_t MAX_IPFS_PIN_QUEUE_SIZE = 10000;
+// Failed attempts are retried with exponential backoff, starting at
+// IPFS_PIN_RETRY_BASE seconds and capped at IPFS_PIN_RETRY_MAX seconds
+static const int64_t IPFS_PIN_RETRY_BASE = 30;
+static const int64_t IPFS_PIN_RETRY_MAX = 60 * 60;
+static const int IPFS_PIN_MAX_ATTEMPTS = 8;
+// Finished (pinned, rejected or failed) entries are forgotten after this time
+static const int64_t IPFS_PIN_STATUS_EXPIRATION_TIME = 24 * 60 * 60;
+// Number of missing pins the startup reconciliation keeps in the queue at once
+static const size_t IPFS_RECONCILE_BATCH_SIZE = 64;
+// Number of high-collateral masternodes pinning each CID, 0 pins everything on every node
+static const int DEFAULT_IPFS_REPLICAS = 0;
+// CIDs which moved to other masternodes are only unpinned after this time, so they can pin them first
+static const int64_t IPFS_PIN_HANDOVER_DELAY = 60 * 60;
+// Swarm port masternodes are expected to run their IPFS daemon on
+static const int DEFAULT_IPFS_SWARM_PORT = 4001;
+// Number of masternode IPFS peers the daemon is connected to whenever the rotation moves on
+static const size_t IPFS_SWARM_CONNECT_PEERS = 4;
+static const int64_t IPFS_SWARM_CONNECT_INTERVAL = 5 * 60;
+
+enum ipfs_pin_status_enum_t {
+    IPFS_PIN_QUEUED = 0,
+    IPFS_PIN_IN_PROGRESS = 1,
+    IPFS_PIN_RETRY = 2,
+    IPFS_PIN_PINNED = 3,
+    IPFS_PIN_TOO_BIG = 4,
+    IPFS_PIN_FAILED = 5,
+};
+
+struct CIPFSPinEntry {
+    uint256 nObjectHash;
+    ipfs_pin_status_enum_t status{IPFS_PIN_QUEUED};
+    int nAttempts{0};
+    int64_t nNextAttemptTime{0};
+    int64_t nLastUpdateTime{0};
+    int64_t nSize{-1};
+    std::string strLastError;
+    // swarm address of the masternode which submitted the object, likely the first provider
+    std::string strHintPeer;
+
+    bool IsFinished() const
+    {
+        return status == IPFS_PIN_PINNED || status == IPFS_PIN_TOO_BIG || status == IPFS_PIN_FAILED;
+    }
+
+    UniValue ToJson() const;
+};
+
+/** Outcome of pinning or unpinning a CID, published to the validation interface */
+struct CIPFSPinEvent {
+    enum Type {
+        PINNED,
+        UNPINNED,
+        FAILED,
+    };
+
+    Type type;
+    uint256 nObjectHash; // null for unpins, the object is gone by then
+    std::string strCID;
+    int64_t nSize{-1};
+    std::string strError;
+
+    ADD_SERIALIZE_METHODS
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(nObjectHash);
+        READWRITE(strCID);
+        READWRITE(nSize);
+        READWRITE(strError);
+    }
+};
+
+/**
+ * Assigns every CID to nReplicas high-collateral masternodes by rendezvous hashing.
+ *
+ * Each peer scores a CID with SipHash keyed by its IPFS peer ID and the CID goes to the
+ * nReplicas peers with the highest scores. All nodes agree on the assignment as long as
+ * they see the same masternode list, and when a peer leaves or joins only the CIDs it is
+ * ranked in the top nReplicas for move, each to the next peer in its ranking.
+ */
+class CIPFSPinAssignment
+{
+private:
+    int nReplicas{0};
+    // sorted, vecPeerKeys holds the SipHash keys of the same peers
+    std::vector<std::string> vecPeerIDs;
+    std::vector<uint64_t> vecPeerKeys;
+    int nLocalPeer{-1};
+
+    uint64_t GetScore(size_t nPeer, const std::string& strCID) const;
+
+public:
+    CIPFSPinAssignment() {}
+    CIPFSPinAssignment(int nReplicasIn, const std::vector<std::string>& vecPeerIDsIn, const std::string& strLocalPeerID);
+
+    /// No assignment known yet
+    bool IsNull() const { return nReplicas == 0; }
+
+    std::vector<std::string> GetResponsiblePeers(const std::string& strCID) const;
+    /// Whether the local peer is one of the peers responsible for strCID
+    bool IsLocalResponsible(const std::string& strCID) const;
+
+    bool operator==(const CIPFSPinAssignment& other) const
+    {
+        return nReplicas == other.nReplicas && vecPeerIDs == other.vecPeerIDs && nLocalPeer == other.nLocalPeer;
+    }
+    bool operator!=(const CIPFSPinAssignment& other) const { return !(*this == other); }
+};
+
+/**
+ * Pins the IPFS content referenced by governance records and proposals.
+ *
+ * Talking to the local IPFS daemon is done over HTTP and may take a long time,
+ * so CGovernanceManager only queues CIDs here. A bounded set of worker threads
+ * checks the object size against SPORK_102_IPFS_OBJECT_SIZE and pins it,
+ * retrying with exponential backoff when the daemon is unreachable.
+ *
+ * After a restart StartReconciliation() compares the daemon's pin set against
+ * all CIDs known to governance in a single request and only queues the ones
+ * which are missing, IPFS_RECONCILE_BATCH_SIZE at a time.
+ *
+ * Unpinning content of deleted governance objects is deferred to the same
+ * workers. Pending unpins are kept in a small database in the data directory
+ * until the daemon confirms them, so they are not lost on an unclean exit.
+ *
+ * With -ipfsreplicas=<n> every CID is only pinned by the n high-collateral masternodes
+ * CIPFSPinAssignment assigns it to. The assignment is recomputed when the masternode
+ * list changes and the pin set is rebalanced: CIDs the node became responsible for are
+ * pinned, which also repairs the replicas of masternodes which dropped out, and the ones
+ * it lost are unpinned after IPFS_PIN_HANDOVER_DELAY.
+ *
+ * Fresh content is slow to find through the DHT, so before a pin attempt the daemon
+ * is connected to the swarm address of the masternode which submitted the object and,
+ * every IPFS_SWARM_CONNECT_INTERVAL, to the next IPFS_SWARM_CONNECT_PEERS addresses of
+ * a rotation over all high-collateral masternodes.
+ */
+class CIPFSPinManager
+{
+private:
+    mutable CCriticalSection cs;
+
+    std::map<std::string, CIPFSPinEntry> mapEntries;
+    // (next attempt time, CID) of all entries waiting for a worker
+    std::set<std::pair<int64_t, std::string> > setScheduled;
+
+    std::vector<std::thread> workThreads;
+    CThreadInterrupt workInterrupt;
+
+    // CIDs handed to StartReconciliation(), waiting for a worker to fetch the pin set
+    std::map<std::string, uint256> mapReconcileRequest;
+    bool fReconcileRequested{false};
+    bool fReconciling{false};
+    // missing pins which were not queued yet and the ones currently queued
+    std::vector<std::pair<std::string, uint256> > vecReconcileMissing;
+    std::set<std::string> setReconcileInFlight;
+    int nReconcileTotal{0};
+    int nReconcileDone{0};
+
+    // CID -> time of the next unpin attempt, every entry is mirrored in pdb
+    std::map<std::string, int64_t> mapPendingUnpins;
+    std::set<std::string> setUnpinsInFlight;
+    std::unique_ptr<CDBWrapper> pdb;
+
+    int nReplicas{DEFAULT_IPFS_REPLICAS};
+    // the assignment of the current masternode list and the one the pin set was rebalanced to
+    CIPFSPinAssignment assignment;
+    CIPFSPinAssignment assignmentApplied;
+
+    // swarm addresses of the other high-collateral masternodes, sorted
+    std::vector<std::string> vecSwarmPeers;
+    size_t nSwarmRotation{0};
+    int64_t nLastSwarmConnectTime{0};
+
+public:
+    CIPFSPinManager();
+    ~CIPFSPinManager();
+
+    void StartWorkerThreads(int nThreads);
+    void StopWorkerThreads();
+    void InterruptWorkerThreads();
+    bool HasWorkerThreads() const { return !workThreads.empty(); }
+
+    /// Queue a CID for pinning, returns false if it is already known, assigned to other masternodes or the queue is full
+    bool QueuePin(const uint256& nObjectHash, const std::string& strCID, const std::string& strHintPeer = "");
+
+    bool GetEntry(const std::string& strCID, CIPFSPinEntry& entryRet) const;
+    size_t GetQueueSize() const;
+
+    /// Make sure all CIDs in mapCIDs (CID -> object hash) are pinned, the work is done by the worker threads
+    void StartReconciliation(const std::map<std::string, uint256>& mapCIDs);
+    bool IsReconciling() const;
+    void GetReconcileProgress(int& nDoneRet, int& nTotalRet) const;
+
+    /// Open the database of pending unpins, unpins are not tracked until this is done
+    void InitDB();
+    void CloseDB();
+
+    /// Unpin a CID which is no longer referenced by any governance object or assigned to other masternodes
+    void QueueUnpin(const std::string& strCID, int64_t nDelay = 0);
+    size_t GetPendingUnpinCount() const;
+
+    void SetReplicas(int nReplicasIn);
+    int GetReplicas() const;
+    /// Whether this node pins strCID, always true without replication and false as long as the assignment is unknown
+    bool IsResponsible(const std::string& strCID) const;
+    /// Recompute the assignment and the swarm peers from the masternode list at the chain tip
+    void UpdateMasternodePeers();
+    bool IsRebalanceNeeded() const;
+    /// Pin and unpin the CIDs in mapCIDs (CID -> object hash) according to the current assignment
+    void Rebalance(const std::map<std::string, uint256>& mapCIDs);
+
+    void CheckAndRemove();
+    void Clear();
+
+    std::string ToString() const;
+    UniValue ToJson() const;
+
+    void DoMaintenance();
+
+    static std::string StatusToString(ipfs_pin_status_enum_t status);
+    /// Swarm address of the IPFS daemon of the masternode with the given collateral, empty if it is unknown
+    static std::string GetMasternodeSwarmAddress(const COutPoint& collateralOutpoint);
+
+private:
+    void WorkThreadMain();
+
+    bool PopScheduled(std::string& strCIDRet);
+    bool TakeReconcileRequest(std::map<std::string, uint256>& mapCIDsRet);
+    void Reconcile(const std::map<std::string, uint256>& mapCIDs);
+    void FeedReconcileBatch();
+    bool PopUnpin(std::string& strCIDRet);
+    void ProcessUnpin(const std::string& strCID);
+    void FinishUnpin(const std::string& strCID, bool fDone);
+    bool IsAssignedElsewhere(const std::string& strCID) const;
+    void ConnectSwarmPeers(ipfs::Client& ipfsclient, const std::string& strCID);
+    void ProcessEntry(const std::string& strCID);
+    void ScheduleRetry(const std::string& strCID, const std::string& strError);
+    void SetFinished(const std::string& strCID, ipfs_pin_status_enum_t status, const std::string& strError);
+};
+
+#endif
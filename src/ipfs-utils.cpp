@@ -2,8 +2,6 @@
 #include "governance.h"
 #include "governance-validators.h"
 
-#include "json.hpp"
-
 bool IsIpfsPeerIdValid(const std::string& ipfsId, CAmount collateralAmount)
 {
     /** All alphanumeric characters except for "0", "I", "O", and "l" */
@@ -48,18 +46,7 @@ bool IsIpfsIdValid(const std::string& ipfsId)
 
 bool IsIpfsIdDuplicate(const std::string& ipfsId)
 {
-    std::vector<const CGovernanceObject*> objs = governance.GetAllNewerThan(0);
-    std::string ipfsCid;
-
-    for (auto& pGovObj : objs) {
-        std::string const plainData = pGovObj->GetDataAsPlainString();
-        nlohmann::json jsonData = nlohmann::json::parse(plainData);
-        nlohmann::json ipfsCid = jsonData["ipfscid"];
-        if (ipfsCid == ipfsId) {
-            return true;
-        }
-    }
-    return false;
+    return governance.HaveObjectForIPFSCID(ipfsId);
 }
 
 
@@ -69,13 +56,8 @@ bool IsIdentityValid(std::string identity, CAmount CollateralAmount)
     if (identity.size() == 0 || identity.size() > 255 || identity == "" || identity == "0")
         return false;
 
-    auto mnList = deterministicMNManager->GetListAtChainTip();
-    auto identities = mnList.GetIdentitiesInUse();
-    for (const auto& p : identities) {
-        if (p.c_str() == identity) {
-            valid = false;
-            return valid;
-        }
+    if (deterministicMNManager->GetListAtChainTip().IsIdentityInUse(identity)) {
+        return false;
     }
 
     switch (CollateralAmount) {
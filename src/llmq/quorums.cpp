@@ -26,6 +26,7 @@ namespace llmq
 
 static const std::string DB_QUORUM_SK_SHARE = "q_Qsk";
 static const std::string DB_QUORUM_QUORUM_VVEC = "q_Qqvvec";
+static const std::string DB_QUORUM_PUBKEY_SHARES = "q_Qpkshares";
 
 CQuorumManager* quorumManager;
 
@@ -55,26 +56,30 @@ void CQuorum::Init(const CFinalCommitment& _qc, const CBlockIndex* _pindexQuorum
     pindexQuorum = _pindexQuorum;
     members = _members;
     minedBlockHash = _minedBlockHash;
+
+    memberIndexes.clear();
+    memberIndexes.reserve(members.size());
+    for (size_t i = 0; i < members.size(); i++) {
+        memberIndexes.emplace(members[i]->proTxHash, i);
+    }
+
+    LOCK(pubKeySharesCs);
+    pubKeyShares.assign(members.size(), CBLSPublicKey());
+    fPubKeySharesComplete = false;
 }
 
 bool CQuorum::IsMember(const uint256& proTxHash) const
 {
-    for (auto& dmn : members) {
-        if (dmn->proTxHash == proTxHash) {
-            return true;
-        }
-    }
-    return false;
+    return memberIndexes.count(proTxHash) != 0;
 }
 
 bool CQuorum::IsValidMember(const uint256& proTxHash) const
 {
-    for (size_t i = 0; i < members.size(); i++) {
-        if (members[i]->proTxHash == proTxHash) {
-            return qc.validMembers[i];
-        }
+    int memberIdx = GetMemberIndex(proTxHash);
+    if (memberIdx == -1) {
+        return false;
     }
-    return false;
+    return qc.validMembers[memberIdx];
 }
 
 CBLSPublicKey CQuorum::GetPubKeyShare(size_t memberIdx) const
@@ -82,8 +87,25 @@ CBLSPublicKey CQuorum::GetPubKeyShare(size_t memberIdx) const
     if (quorumVvec == nullptr || memberIdx >= members.size() || !qc.validMembers[memberIdx]) {
         return CBLSPublicKey();
     }
+    if (fPubKeySharesComplete) {
+        return pubKeyShares[memberIdx];
+    }
+    {
+        LOCK(pubKeySharesCs);
+        if (pubKeyShares[memberIdx].IsValid()) {
+            return pubKeyShares[memberIdx];
+        }
+    }
+
+    // not populated yet, build it now (or wait for the populator thread if it's currently building it)
     auto& m = members[memberIdx];
-    return blsCache.BuildPubKeyShare(m->proTxHash, quorumVvec, CBLSId::FromHash(m->proTxHash));
+    auto pubKeyShare = blsCache.BuildPubKeyShare(m->proTxHash, quorumVvec, CBLSId::FromHash(m->proTxHash));
+
+    LOCK(pubKeySharesCs);
+    if (!fPubKeySharesComplete) {
+        pubKeyShares[memberIdx] = pubKeyShare;
+    }
+    return pubKeyShare;
 }
 
 CBLSSecretKey CQuorum::GetSkShare() const
@@ -93,12 +115,11 @@ CBLSSecretKey CQuorum::GetSkShare() const
 
 int CQuorum::GetMemberIndex(const uint256& proTxHash) const
 {
-    for (size_t i = 0; i < members.size(); i++) {
-        if (members[i]->proTxHash == proTxHash) {
-            return (int)i;
-        }
+    auto it = memberIndexes.find(proTxHash);
+    if (it == memberIndexes.end()) {
+        return -1;
     }
-    return -1;
+    return (int)it->second;
 }
 
 void CQuorum::WriteContributions(CEvoDB& evoDb)
@@ -128,12 +149,20 @@ bool CQuorum::ReadContributions(CEvoDB& evoDb)
     // member of the quorum but observed the whole DKG process to have the quorum verification vector.
     evoDb.Read(std::make_pair(DB_QUORUM_SK_SHARE, dbKey), skShare);
 
+    // Same here, the public key shares are only persisted after the populator thread finished
+    std::vector<CBLSPublicKey> pks;
+    if (evoDb.Read(std::make_pair(DB_QUORUM_PUBKEY_SHARES, dbKey), pks) && pks.size() == members.size()) {
+        LOCK(pubKeySharesCs);
+        pubKeyShares = std::move(pks);
+        fPubKeySharesComplete = true;
+    }
+
     return true;
 }
 
-void CQuorum::StartCachePopulatorThread(std::shared_ptr<CQuorum> _this)
+void CQuorum::StartCachePopulatorThread(std::shared_ptr<CQuorum> _this, CEvoDB& evoDb)
 {
-    if (_this->quorumVvec == nullptr) {
+    if (_this->quorumVvec == nullptr || _this->fPubKeySharesComplete) {
         return;
     }
 
@@ -142,13 +171,19 @@ void CQuorum::StartCachePopulatorThread(std::shared_ptr<CQuorum> _this)
 
     // this thread will exit after some time
     // when then later some other thread tries to get keys, it will be much faster
-    _this->cachePopulatorThread = std::thread([_this, t]() {
+    _this->cachePopulatorThread = std::thread([_this, t, &evoDb]() {
         RenameThread("historia-q-cachepop");
-        for (size_t i = 0; i < _this->members.size() && !_this->stopCachePopulatorThread && !ShutdownRequested(); i++) {
+        size_t i = 0;
+        for (; i < _this->members.size() && !_this->stopCachePopulatorThread && !ShutdownRequested(); i++) {
             if (_this->qc.validMembers[i]) {
                 _this->GetPubKeyShare(i);
             }
         }
+        if (i == _this->members.size()) {
+            LOCK(_this->pubKeySharesCs);
+            _this->fPubKeySharesComplete = true;
+            evoDb.GetRawDB().Write(std::make_pair(DB_QUORUM_PUBKEY_SHARES, MakeQuorumKey(*_this)), _this->pubKeyShares);
+        }
         LogPrint("llmq", "CQuorum::StartCachePopulatorThread -- done. time=%d\n", t.count());
     });
 }
@@ -162,6 +197,10 @@ CQuorumManager::CQuorumManager(CEvoDB& _evoDb, CBLSWorker& _blsWorker, CDKGSessi
 
 void CQuorumManager::UpdatedBlockTip(const CBlockIndex* pindexNew, bool fInitialDownload)
 {
+    if (!fInitialDownload && !fActiveQuorumsLoaded) {
+        LoadActiveQuorums(pindexNew);
+    }
+
     if (!masternodeSync.IsBlockchainSynced()) {
         return;
     }
@@ -171,6 +210,20 @@ void CQuorumManager::UpdatedBlockTip(const CBlockIndex* pindexNew, bool fInitial
     }
 }
 
+void CQuorumManager::LoadActiveQuorums(const CBlockIndex* pindexNew)
+{
+    // Build the quorums which can currently sign from their persisted vvecs, skShares and public key shares, so the
+    // first islock or chainlock after startup doesn't have to wait for them. Quorums without persisted data are
+    // rebuilt from the DKG contributions and persisted, and their public key shares are populated in the background
+    cxxtimer::Timer t(true);
+    size_t count = 0;
+    for (auto& p : Params().GetConsensus().llmqs) {
+        count += ScanQuorums(p.first, pindexNew, (size_t)p.second.signingActiveQuorumCount).size();
+    }
+    fActiveQuorumsLoaded = true;
+    LogPrint("llmq", "CQuorumManager::%s -- loaded %d quorums. time=%d\n", __func__, count, t.count());
+}
+
 void CQuorumManager::EnsureQuorumConnections(Consensus::LLMQType llmqType, const CBlockIndex* pindexNew)
 {
     const auto& params = Params().GetConsensus().llmqs.at(llmqType);
@@ -251,7 +304,7 @@ bool CQuorumManager::BuildQuorumFromCommitment(const CFinalCommitment& qc, const
         // pre-populate caches in the background
         // recovering public key shares is quite expensive and would result in serious lags for the first few signing
         // sessions if the shares would be calculated on-demand
-        CQuorum::StartCachePopulatorThread(quorum);
+        CQuorum::StartCachePopulatorThread(quorum, evoDb);
     }
 
     return true;
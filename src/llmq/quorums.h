@@ -52,6 +52,15 @@ private:
     std::atomic<bool> stopCachePopulatorThread;
     std::thread cachePopulatorThread;
 
+    // Public key shares of all members, indexed like members. Once fPubKeySharesComplete is set, the vector is not
+    // modified anymore and can be read without locking. The complete set is persisted together with the vvec
+    mutable CCriticalSection pubKeySharesCs;
+    mutable std::vector<CBLSPublicKey> pubKeyShares;
+    std::atomic<bool> fPubKeySharesComplete{false};
+
+    // indexes of members by proTxHash
+    std::unordered_map<uint256, size_t, StaticSaltedHasher> memberIndexes;
+
 public:
     CQuorum(const Consensus::LLMQParams& _params, CBLSWorker& _blsWorker) : params(_params), blsCache(_blsWorker), stopCachePopulatorThread(false) {}
     ~CQuorum();
@@ -67,7 +76,7 @@ public:
 private:
     void WriteContributions(CEvoDB& evoDb);
     bool ReadContributions(CEvoDB& evoDb);
-    static void StartCachePopulatorThread(std::shared_ptr<CQuorum> _this);
+    static void StartCachePopulatorThread(std::shared_ptr<CQuorum> _this, CEvoDB& evoDb);
 };
 typedef std::shared_ptr<CQuorum> CQuorumPtr;
 typedef std::shared_ptr<const CQuorum> CQuorumCPtr;
@@ -89,6 +98,9 @@ private:
     std::map<std::pair<Consensus::LLMQType, uint256>, CQuorumPtr> quorumsCache;
     unordered_lru_cache<std::pair<Consensus::LLMQType, uint256>, std::vector<CQuorumCPtr>, StaticSaltedHasher, 32> scanQuorumsCache;
 
+    // set once the active quorums were loaded after startup
+    std::atomic<bool> fActiveQuorumsLoaded{false};
+
 public:
     CQuorumManager(CEvoDB& _evoDb, CBLSWorker& _blsWorker, CDKGSessionManager& _dkgManager);
 
@@ -107,6 +119,7 @@ public:
 private:
     // all private methods here are cs_main-free
     void EnsureQuorumConnections(Consensus::LLMQType llmqType, const CBlockIndex *pindexNew);
+    void LoadActiveQuorums(const CBlockIndex* pindexNew);
 
     bool BuildQuorumFromCommitment(const CFinalCommitment& qc, const CBlockIndex* pindexQuorum, const uint256& minedBlockHash, std::shared_ptr<CQuorum>& quorum) const;
     bool BuildQuorumContributions(const CFinalCommitment& fqc, std::shared_ptr<CQuorum>& quorum) const;
@@ -116,7 +116,7 @@ void CQuorumBlockProcessor::ProcessMessage(CNode* pfrom, const std::string& strC
     }
 }
 
-bool CQuorumBlockProcessor::ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state)
+bool CQuorumBlockProcessor::ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck)
 {
     AssertLockHeld(cs_main);
 
@@ -162,6 +162,10 @@ bool CQuorumBlockProcessor::ProcessBlock(const CBlock& block, const CBlockIndex*
         }
     }
 
+    if (!fJustCheck) {
+        UpdateMinedCommitmentsLists(pindex, qcs);
+    }
+
     evoDb.Write(DB_BEST_BLOCK_UPGRADE, blockHash);
 
     return true;
@@ -218,10 +222,12 @@ bool CQuorumBlockProcessor::ProcessCommitment(int nHeight, const uint256& blockH
     {
         LOCK(minableCommitmentsCs);
         hasMinedCommitmentCache.erase(std::make_pair(params.type, quorumHash));
+        minedCommitmentCache.erase(std::make_pair(params.type, quorumHash));
+        minedCommitmentHashCache.erase(std::make_pair(params.type, quorumHash));
     }
 
     LogPrint("llmq", "CQuorumBlockProcessor::%s -- processed commitment from block. type=%d, quorumHash=%s, signers=%s, validMembers=%d, quorumPublicKey=%s\n", __func__,
-              qc.llmqType, quorumHash.ToString(), qc.CountSigners(), qc.CountValidMembers(), qc.quorumPublicKey.ToString());
+              qc.llmqType, quorumHash.ToString(), qc.CountSigners(), qc.CountValidMembers(), qc.quorumPublicKey.Get().ToString());
 
     return true;
 }
@@ -247,12 +253,16 @@ bool CQuorumBlockProcessor::UndoBlock(const CBlock& block, const CBlockIndex* pi
         {
             LOCK(minableCommitmentsCs);
             hasMinedCommitmentCache.erase(std::make_pair((Consensus::LLMQType)qc.llmqType, qc.quorumHash));
+            minedCommitmentCache.erase(std::make_pair((Consensus::LLMQType)qc.llmqType, qc.quorumHash));
+            minedCommitmentHashCache.erase(std::make_pair((Consensus::LLMQType)qc.llmqType, qc.quorumHash));
         }
 
         // if a reorg happened, we should allow to mine this commitment later
         AddMinableCommitment(qc);
     }
 
+    UndoMinedCommitmentsLists(pindex);
+
     evoDb.Write(DB_BEST_BLOCK_UPGRADE, pindex->pprev->GetBlockHash());
 
     return true;
@@ -272,6 +282,13 @@ void CQuorumBlockProcessor::UpgradeDB()
     if (chainActive.Height() >= Params().GetConsensus().DIP0003EnforcementHeight) {
         auto pindex = chainActive[Params().GetConsensus().DIP0003EnforcementHeight];
         while (pindex) {
+            if (fHavePruned && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+                // commitments of pruned blocks were stored when the blocks were connected
+                evoDb.GetRawDB().Write(DB_BEST_BLOCK_UPGRADE, pindex->GetBlockHash());
+                pindex = chainActive.Next(pindex);
+                continue;
+            }
+
             CBlock block;
             bool r = ReadBlockFromDisk(block, pindex, Params().GetConsensus());
             assert(r);
@@ -392,17 +409,71 @@ bool CQuorumBlockProcessor::HasMinedCommitment(Consensus::LLMQType llmqType, con
 
 bool CQuorumBlockProcessor::GetMinedCommitment(Consensus::LLMQType llmqType, const uint256& quorumHash, CFinalCommitment& retQc, uint256& retMinedBlockHash)
 {
-    auto key = std::make_pair(DB_MINED_COMMITMENT, std::make_pair((uint8_t)llmqType, quorumHash));
+    auto cacheKey = std::make_pair(llmqType, quorumHash);
     std::pair<CFinalCommitment, uint256> p;
+    {
+        LOCK(minableCommitmentsCs);
+        if (minedCommitmentCache.get(cacheKey, p)) {
+            retQc = std::move(p.first);
+            retMinedBlockHash = p.second;
+            return true;
+        }
+    }
+
+    auto key = std::make_pair(DB_MINED_COMMITMENT, std::make_pair((uint8_t)llmqType, quorumHash));
     if (!evoDb.Read(key, p)) {
         return false;
     }
+
+    {
+        LOCK(minableCommitmentsCs);
+        minedCommitmentCache.insert(cacheKey, p);
+    }
     retQc = std::move(p.first);
     retMinedBlockHash = p.second;
     return true;
 }
 
+bool CQuorumBlockProcessor::GetMinedCommitmentHash(Consensus::LLMQType llmqType, const uint256& quorumHash, uint256& retQcHash)
+{
+    auto cacheKey = std::make_pair(llmqType, quorumHash);
+    {
+        LOCK(minableCommitmentsCs);
+        if (minedCommitmentHashCache.get(cacheKey, retQcHash)) {
+            return true;
+        }
+    }
+
+    CFinalCommitment qc;
+    uint256 minedBlockHash;
+    if (!GetMinedCommitment(llmqType, quorumHash, qc, minedBlockHash)) {
+        return false;
+    }
+    retQcHash = ::SerializeHash(qc);
+
+    LOCK(minableCommitmentsCs);
+    minedCommitmentHashCache.insert(cacheKey, retQcHash);
+    return true;
+}
+
 std::vector<const CBlockIndex*> CQuorumBlockProcessor::GetMinedCommitmentsUntilBlock(Consensus::LLMQType llmqType, const CBlockIndex* pindex, size_t maxCount)
+{
+    std::vector<const CBlockIndex*> ret;
+    if (GetMinedCommitmentsFromList(llmqType, pindex, maxCount, ret)) {
+        return ret;
+    }
+
+    auto commitments = ReadMinedCommitmentsUntilBlock(llmqType, pindex, maxCount);
+    ret.clear();
+    ret.reserve(commitments.size());
+    for (auto& p : commitments) {
+        ret.emplace_back(p.second);
+    }
+    return ret;
+}
+
+// Returns <minedHeight, quorumIndex> pairs
+std::vector<std::pair<int, const CBlockIndex*>> CQuorumBlockProcessor::ReadMinedCommitmentsUntilBlock(Consensus::LLMQType llmqType, const CBlockIndex* pindex, size_t maxCount)
 {
     auto dbIt = evoDb.GetCurTransaction().NewIteratorUniquePtr();
 
@@ -411,7 +482,7 @@ std::vector<const CBlockIndex*> CQuorumBlockProcessor::GetMinedCommitmentsUntilB
 
     dbIt->Seek(firstKey);
 
-    std::vector<const CBlockIndex*> ret;
+    std::vector<std::pair<int, const CBlockIndex*>> ret;
     ret.reserve(maxCount);
 
     while (dbIt->Valid() && ret.size() < maxCount) {
@@ -435,7 +506,7 @@ std::vector<const CBlockIndex*> CQuorumBlockProcessor::GetMinedCommitmentsUntilB
 
         auto quorumIndex = pindex->GetAncestor(quorumHeight);
         assert(quorumIndex);
-        ret.emplace_back(quorumIndex);
+        ret.emplace_back(nMinedHeight, quorumIndex);
 
         dbIt->Next();
     }
@@ -443,6 +514,101 @@ std::vector<const CBlockIndex*> CQuorumBlockProcessor::GetMinedCommitmentsUntilB
     return ret;
 }
 
+// Serves the request from the in-memory lists if pindex is part of the chain the lists were built for
+bool CQuorumBlockProcessor::GetMinedCommitmentsFromList(Consensus::LLMQType llmqType, const CBlockIndex* pindex, size_t maxCount, std::vector<const CBlockIndex*>& ret)
+{
+    LOCK(minedCommitmentsCs);
+
+    auto it = minedCommitmentsLists.find(llmqType);
+    if (it == minedCommitmentsLists.end() || !pindexMinedCommitmentsTip) {
+        return false;
+    }
+    if (pindexMinedCommitmentsTip->GetAncestor(pindex->nHeight) != pindex) {
+        return false;
+    }
+
+    auto& list = it->second;
+    ret.clear();
+    ret.reserve(std::min(maxCount, list.entries.size()));
+    for (auto& e : list.entries) {
+        if (ret.size() >= maxCount) {
+            break;
+        }
+        if (e.first > pindex->nHeight) {
+            continue;
+        }
+        ret.emplace_back(pindex->GetAncestor(e.second));
+    }
+
+    return ret.size() >= maxCount || list.fComplete;
+}
+
+void CQuorumBlockProcessor::LoadMinedCommitmentsLists(const CBlockIndex* pindexTip)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(minedCommitmentsCs);
+
+    minedCommitmentsLists.clear();
+    pindexMinedCommitmentsTip = pindexTip;
+
+    for (const auto& p : Params().GetConsensus().llmqs) {
+        auto& list = minedCommitmentsLists[p.first];
+        for (auto& c : ReadMinedCommitmentsUntilBlock(p.first, pindexTip, MINED_COMMITMENTS_LIST_SIZE)) {
+            list.entries.emplace_back(c.first, c.second->nHeight);
+        }
+        list.fComplete = list.entries.size() < MINED_COMMITMENTS_LIST_SIZE;
+    }
+}
+
+void CQuorumBlockProcessor::UpdateMinedCommitmentsLists(const CBlockIndex* pindex, const std::map<Consensus::LLMQType, CFinalCommitment>& qcs)
+{
+    AssertLockHeld(cs_main);
+    LOCK(minedCommitmentsCs);
+
+    if (pindexMinedCommitmentsTip != pindex->pprev) {
+        // first block after startup, or the previous block failed to connect after it was processed here. The DB
+        // reflects pindex->pprev at this point
+        LoadMinedCommitmentsLists(pindex->pprev);
+    }
+
+    for (auto& p : qcs) {
+        auto& qc = p.second;
+        if (qc.IsNull()) {
+            continue;
+        }
+        auto& list = minedCommitmentsLists[p.first];
+        list.entries.emplace_front(pindex->nHeight, mapBlockIndex.at(qc.quorumHash)->nHeight);
+        if (list.entries.size() > MINED_COMMITMENTS_LIST_SIZE) {
+            list.entries.pop_back();
+            list.fComplete = false;
+        }
+    }
+
+    pindexMinedCommitmentsTip = pindex;
+}
+
+void CQuorumBlockProcessor::UndoMinedCommitmentsLists(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    LOCK(minedCommitmentsCs);
+
+    if (pindexMinedCommitmentsTip != pindex) {
+        // we don't know what the lists contain, let the next connected block rebuild them
+        minedCommitmentsLists.clear();
+        pindexMinedCommitmentsTip = nullptr;
+        return;
+    }
+
+    for (auto& p : minedCommitmentsLists) {
+        auto& entries = p.second.entries;
+        while (!entries.empty() && entries.front().first >= pindex->nHeight) {
+            entries.pop_front();
+        }
+    }
+
+    pindexMinedCommitmentsTip = pindex->pprev;
+}
+
 std::map<Consensus::LLMQType, std::vector<const CBlockIndex*>> CQuorumBlockProcessor::GetMinedAndActiveCommitmentsUntilBlock(const CBlockIndex* pindex)
 {
     std::map<Consensus::LLMQType, std::vector<const CBlockIndex*>> ret;
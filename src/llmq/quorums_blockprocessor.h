@@ -12,7 +12,9 @@
 #include "primitives/transaction.h"
 #include "saltedhasher.h"
 #include "sync.h"
+#include "unordered_lru_cache.h"
 
+#include <deque>
 #include <map>
 #include <unordered_map>
 
@@ -33,6 +35,22 @@ private:
     std::map<uint256, CFinalCommitment> minableCommitments;
 
     std::unordered_map<std::pair<Consensus::LLMQType, uint256>, bool, StaticSaltedHasher> hasMinedCommitmentCache;
+    // <commitment, minedBlockHash> of recently requested mined commitments, protected by minableCommitmentsCs
+    unordered_lru_cache<std::pair<Consensus::LLMQType, uint256>, std::pair<CFinalCommitment, uint256>, StaticSaltedHasher, 128> minedCommitmentCache;
+    // hashes of mined commitments, as used for merkleRootQuorums, protected by minableCommitmentsCs
+    unordered_lru_cache<std::pair<Consensus::LLMQType, uint256>, uint256, StaticSaltedHasher, 128> minedCommitmentHashCache;
+
+    // The most recent mined commitments of the active chain, per LLMQ type
+    static const size_t MINED_COMMITMENTS_LIST_SIZE = 64;
+    struct MinedCommitmentsList {
+        // <minedHeight, quorumHeight>, newest first
+        std::deque<std::pair<int, int>> entries;
+        // true if all commitments mined up to pindexTip are in entries
+        bool fComplete{false};
+    };
+    CCriticalSection minedCommitmentsCs;
+    const CBlockIndex* pindexMinedCommitmentsTip{nullptr};
+    std::map<Consensus::LLMQType, MinedCommitmentsList> minedCommitmentsLists;
 
 public:
     CQuorumBlockProcessor(CEvoDB& _evoDb) : evoDb(_evoDb) {}
@@ -41,7 +59,7 @@ public:
 
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
 
-    bool ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state);
+    bool ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck);
     bool UndoBlock(const CBlock& block, const CBlockIndex* pindex);
 
     void AddMinableCommitment(const CFinalCommitment& fqc);
@@ -52,6 +70,7 @@ public:
 
     bool HasMinedCommitment(Consensus::LLMQType llmqType, const uint256& quorumHash);
     bool GetMinedCommitment(Consensus::LLMQType llmqType, const uint256& quorumHash, CFinalCommitment& ret, uint256& retMinedBlockHash);
+    bool GetMinedCommitmentHash(Consensus::LLMQType llmqType, const uint256& quorumHash, uint256& retQcHash);
 
     std::vector<const CBlockIndex*> GetMinedCommitmentsUntilBlock(Consensus::LLMQType llmqType, const CBlockIndex* pindex, size_t maxCount);
     std::map<Consensus::LLMQType, std::vector<const CBlockIndex*>> GetMinedAndActiveCommitmentsUntilBlock(const CBlockIndex* pindex);
@@ -62,6 +81,12 @@ private:
     bool IsMiningPhase(Consensus::LLMQType llmqType, int nHeight);
     bool IsCommitmentRequired(Consensus::LLMQType llmqType, int nHeight);
     uint256 GetQuorumBlockHash(Consensus::LLMQType llmqType, int nHeight);
+
+    std::vector<std::pair<int, const CBlockIndex*>> ReadMinedCommitmentsUntilBlock(Consensus::LLMQType llmqType, const CBlockIndex* pindex, size_t maxCount);
+    bool GetMinedCommitmentsFromList(Consensus::LLMQType llmqType, const CBlockIndex* pindex, size_t maxCount, std::vector<const CBlockIndex*>& ret);
+    void LoadMinedCommitmentsLists(const CBlockIndex* pindexTip);
+    void UpdateMinedCommitmentsLists(const CBlockIndex* pindex, const std::map<Consensus::LLMQType, CFinalCommitment>& qcs);
+    void UndoMinedCommitmentsLists(const CBlockIndex* pindex);
 };
 
 extern CQuorumBlockProcessor* quorumBlockProcessor;
@@ -13,6 +13,7 @@
 #include "net_processing.h"
 #include "scheduler.h"
 #include "spork.h"
+#include "trace.h"
 #include "txmempool.h"
 #include "validation.h"
 
@@ -45,7 +46,7 @@ void CChainLocksHandler::Start()
         EnforceBestChainLock();
         // regularly retry signing the current chaintip as it might have failed before due to missing ixlocks
         TrySignChainTip();
-    }, 5000);
+    }, 5000, CScheduler::PRIORITY_HIGH, "chainlocks");
 }
 
 void CChainLocksHandler::Stop()
@@ -83,6 +84,8 @@ void CChainLocksHandler::ProcessMessage(CNode* pfrom, const std::string& strComm
         vRecv >> clsig;
 
         auto hash = ::SerializeHash(clsig);
+        // it might have been pushed to us, don't announce it back
+        pfrom->AddInventoryKnown(hash);
 
         ProcessNewChainLock(pfrom->id, clsig, hash);
     }
@@ -109,7 +112,7 @@ void CChainLocksHandler::ProcessNewChainLock(NodeId from, const llmq::CChainLock
 
     uint256 requestId = ::SerializeHash(std::make_pair(CLSIG_REQUESTID_PREFIX, clsig.nHeight));
     uint256 msgHash = clsig.blockHash;
-    if (!quorumSigningManager->VerifyRecoveredSig(Params().GetConsensus().llmqChainLocks, clsig.nHeight, requestId, msgHash, clsig.sig)) {
+    if (!quorumSigningManager->VerifyRecoveredSig(Params().GetConsensus().llmqChainLocks, clsig.nHeight, requestId, msgHash, clsig.sig.Get())) {
         LogPrintf("CChainLocksHandler::%s -- invalid CLSIG (%s), peer=%d\n", __func__, clsig.ToString(), from);
         if (from != -1) {
             LOCK(cs_main);
@@ -133,6 +136,7 @@ void CChainLocksHandler::ProcessNewChainLock(NodeId from, const llmq::CChainLock
         bestChainLock = clsig;
 
         CInv inv(MSG_CLSIG, hash);
+        PushToMasternodePeers(*g_connman, inv, NetMsgType::CLSIG, clsig, LLMQS_PROTO_VERSION);
         g_connman->RelayInv(inv, LLMQS_PROTO_VERSION);
 
         auto blockIt = mapBlockIndex.find(clsig.blockHash);
@@ -157,7 +161,7 @@ void CChainLocksHandler::ProcessNewChainLock(NodeId from, const llmq::CChainLock
     scheduler->scheduleFromNow([&]() {
         CheckActiveState();
         EnforceBestChainLock();
-    }, 0);
+    }, 0, CScheduler::PRIORITY_HIGH, "chainlocks");
 
     LogPrint("chainlocks", "CChainLocksHandler::%s -- processed new CLSIG (%s), peer=%d\n",
               __func__, clsig.ToString(), from);
@@ -186,6 +190,24 @@ void CChainLocksHandler::AcceptedBlockHeader(const CBlockIndex* pindexNew)
 }
 
 void CChainLocksHandler::UpdatedBlockTip(const CBlockIndex* pindexNew)
+{
+    ScheduleTrySignChainTip();
+}
+
+void CChainLocksHandler::NotifyTxLocked(const uint256& txid)
+{
+    {
+        LOCK(cs);
+        if (!txsBlockingTip.erase(txid) || !txsBlockingTip.empty()) {
+            return;
+        }
+    }
+
+    LogPrint("chainlocks", "CChainLocksHandler::%s -- txid=%s: last TX blocking the tip got ixlocked\n", __func__, txid.ToString());
+    ScheduleTrySignChainTip();
+}
+
+void CChainLocksHandler::ScheduleTrySignChainTip()
 {
     // don't call TrySignChainTip directly but instead let the scheduler call it. This way we ensure that cs_main is
     // never locked and TrySignChainTip is not called twice in parallel. Also avoids recursive calls due to
@@ -201,7 +223,7 @@ void CChainLocksHandler::UpdatedBlockTip(const CBlockIndex* pindexNew)
         TrySignChainTip();
         LOCK(cs);
         tryLockChainTipScheduled = false;
-    }, 0);
+    }, 0, CScheduler::PRIORITY_HIGH, "chainlocks");
 }
 
 void CChainLocksHandler::CheckActiveState()
@@ -286,6 +308,8 @@ void CChainLocksHandler::TrySignChainTip()
     // considered safe when it is ixlocked or at least known since 10 minutes (from mempool or block). These checks are
     // performed for the tip (which we try to sign) and the previous 5 blocks. If a ChainLocked block is found on the
     // way down, we consider all TXs to be safe.
+    // All unsafe TXs are remembered, so that NotifyTxLocked can retry signing as soon as the last one gets ixlocked.
+    std::unordered_set<uint256, StaticSaltedHasher> blockingTxs;
     if (IsNewInstantSendEnabled() && sporkManager.IsSporkActive(SPORK_3_INSTANTSEND_BLOCK_FILTERING)) {
         auto pindexWalk = pindex;
         while (pindexWalk) {
@@ -320,7 +344,7 @@ void CChainLocksHandler::TrySignChainTip()
                 if (txAge < WAIT_FOR_ISLOCK_TIMEOUT && !quorumInstantSendManager->IsLocked(txid)) {
                     LogPrint("chainlocks", "CChainLocksHandler::%s -- not signing block %s due to TX %s not being ixlocked and not old enough. age=%d\n", __func__,
                               pindexWalk->GetBlockHash().ToString(), txid.ToString(), txAge);
-                    return;
+                    blockingTxs.emplace(txid);
                 }
             }
 
@@ -328,6 +352,27 @@ void CChainLocksHandler::TrySignChainTip()
         }
     }
 
+    {
+        LOCK(cs);
+        txsBlockingTip = blockingTxs;
+    }
+    if (!blockingTxs.empty()) {
+        // a TX might have been ixlocked while we were checking, so check again to not miss the notification
+        bool allLocked = true;
+        for (auto& txid : blockingTxs) {
+            if (!quorumInstantSendManager->IsLocked(txid)) {
+                allLocked = false;
+                break;
+            }
+        }
+        if (!allLocked) {
+            TRACE3(llmq, chainlock_blocked, pindex->GetBlockHash().begin(), pindex->nHeight, blockingTxs.size());
+            return;
+        }
+        LOCK(cs);
+        txsBlockingTip.clear();
+    }
+
     uint256 requestId = ::SerializeHash(std::make_pair(CLSIG_REQUESTID_PREFIX, pindex->nHeight));
     uint256 msgHash = pindex->GetBlockHash();
 
@@ -342,6 +387,7 @@ void CChainLocksHandler::TrySignChainTip()
         lastSignedMsgHash = msgHash;
     }
 
+    TRACE2(llmq, chainlock_sign, msgHash.begin(), pindex->nHeight);
     quorumSigningManager->AsyncSignIfMember(Params().GetConsensus().llmqChainLocks, requestId, msgHash);
 }
 
@@ -551,8 +597,9 @@ void CChainLocksHandler::HandleNewRecoveredSig(const llmq::CRecoveredSig& recove
 
         clsig.nHeight = lastSignedHeight;
         clsig.blockHash = lastSignedMsgHash;
-        clsig.sig = recoveredSig.sig.Get();
+        clsig.sig = recoveredSig.sig;
     }
+    TRACE2(llmq, chainlock_signed, clsig.blockHash.begin(), clsig.nHeight);
     ProcessNewChainLock(-1, clsig, ::SerializeHash(clsig));
 }
 
@@ -25,7 +25,7 @@ class CChainLockSig
 public:
     int32_t nHeight{-1};
     uint256 blockHash;
-    CBLSSignature sig;
+    CBLSLazySignature sig;
 
 public:
     ADD_SERIALIZE_METHODS
@@ -72,6 +72,9 @@ private:
     BlockTxs blockTxs;
     std::unordered_map<uint256, int64_t> txFirstSeenTime;
 
+    // TXs which prevented us from signing the current tip. Once the last one gets ixlocked, we retry signing
+    std::unordered_set<uint256, StaticSaltedHasher> txsBlockingTip;
+
     std::map<uint256, int64_t> seenChainLocks;
 
     int64_t lastCleanupTime{0};
@@ -91,6 +94,7 @@ public:
     void AcceptedBlockHeader(const CBlockIndex* pindexNew);
     void UpdatedBlockTip(const CBlockIndex* pindexNew);
     void SyncTransaction(const CTransaction &tx, const CBlockIndex *pindex, int posInBlock);
+    void NotifyTxLocked(const uint256& txid);
     void CheckActiveState();
     void TrySignChainTip();
     void EnforceBestChainLock();
@@ -107,6 +111,7 @@ private:
     bool InternalHasConflictingChainLock(int nHeight, const uint256& blockHash);
 
     void DoInvalidateBlock(const CBlockIndex* pindex, bool activateBestChain);
+    void ScheduleTrySignChainTip();
 
     BlockTxs::mapped_type GetBlockTxs(const uint256& blockHash);
 
@@ -8,6 +8,8 @@
 #include "chainparams.h"
 #include "validation.h"
 
+#include "bls/bls_sigcache.h"
+
 #include "evo/specialtx.h"
 
 #include <univalue.h>
@@ -51,7 +53,7 @@ bool CFinalCommitment::Verify(const std::vector<CDeterministicMNCPtr>& members,
         LogPrintfFinalCommitment("invalid signers count. signersCount=%d\n", CountSigners());
         return false;
     }
-    if (!quorumPublicKey.IsValid()) {
+    if (!quorumPublicKey.Get().IsValid()) {
         LogPrintfFinalCommitment("invalid quorumPublicKey\n");
         return false;
     }
@@ -59,11 +61,11 @@ bool CFinalCommitment::Verify(const std::vector<CDeterministicMNCPtr>& members,
         LogPrintfFinalCommitment("invalid quorumVvecHash\n");
         return false;
     }
-    if (!membersSig.IsValid()) {
+    if (!membersSig.Get().IsValid()) {
         LogPrintfFinalCommitment("invalid membersSig\n");
         return false;
     }
-    if (!quorumSig.IsValid()) {
+    if (!quorumSig.Get().IsValid()) {
         LogPrintfFinalCommitment("invalid vvecSig\n");
         return false;
     }
@@ -81,7 +83,7 @@ bool CFinalCommitment::Verify(const std::vector<CDeterministicMNCPtr>& members,
 
     // sigs are only checked when the block is processed
     if (checkSigs) {
-        uint256 commitmentHash = CLLMQUtils::BuildCommitmentHash((uint8_t)params.type, quorumHash, validMembers, quorumPublicKey, quorumVvecHash);
+        uint256 commitmentHash = CLLMQUtils::BuildCommitmentHash((uint8_t)params.type, quorumHash, validMembers, quorumPublicKey.Get(), quorumVvecHash);
 
         std::vector<CBLSPublicKey> memberPubKeys;
         for (size_t i = 0; i < members.size(); i++) {
@@ -91,12 +93,12 @@ bool CFinalCommitment::Verify(const std::vector<CDeterministicMNCPtr>& members,
             memberPubKeys.emplace_back(members[i]->pdmnState->pubKeyOperator.Get());
         }
 
-        if (!membersSig.VerifySecureAggregated(memberPubKeys, commitmentHash)) {
+        if (!VerifyBLSSigSecureAggregatedCached(membersSig.Get(), memberPubKeys, commitmentHash)) {
             LogPrintfFinalCommitment("invalid aggregated members signature\n");
             return false;
         }
 
-        if (!quorumSig.VerifyInsecure(quorumPublicKey, commitmentHash)) {
+        if (!VerifyBLSSigCached(quorumSig.Get(), quorumPublicKey.Get(), commitmentHash)) {
             LogPrintfFinalCommitment("invalid quorum signature\n");
             return false;
         }
@@ -141,7 +143,7 @@ void CFinalCommitment::ToJson(UniValue& obj) const
     obj.push_back(Pair("quorumHash", quorumHash.ToString()));
     obj.push_back(Pair("signersCount", CountSigners()));
     obj.push_back(Pair("validMembersCount", CountValidMembers()));
-    obj.push_back(Pair("quorumPublicKey", quorumPublicKey.ToString()));
+    obj.push_back(Pair("quorumPublicKey", quorumPublicKey.Get().ToString()));
 }
 
 void CFinalCommitmentTxPayload::ToJson(UniValue& obj) const
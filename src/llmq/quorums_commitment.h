@@ -29,11 +29,12 @@ public:
     std::vector<bool> signers;
     std::vector<bool> validMembers;
 
-    CBLSPublicKey quorumPublicKey;
+    // commitments are read from blocks and the DB far more often than their keys and sigs are needed
+    CBLSLazyPublicKey quorumPublicKey;
     uint256 quorumVvecHash;
 
-    CBLSSignature quorumSig; // recovered threshold sig of blockHash+validMembers+pubKeyHash+vvecHash
-    CBLSSignature membersSig; // aggregated member sig of blockHash+validMembers+pubKeyHash+vvecHash
+    CBLSLazySignature quorumSig; // recovered threshold sig of blockHash+validMembers+pubKeyHash+vvecHash
+    CBLSLazySignature membersSig; // aggregated member sig of blockHash+validMembers+pubKeyHash+vvecHash
 
 public:
     CFinalCommitment() {}
@@ -78,10 +79,10 @@ public:
             std::count(validMembers.begin(), validMembers.end(), true)) {
             return false;
         }
-        if (quorumPublicKey.IsValid() ||
+        if (quorumPublicKey.Get().IsValid() ||
             !quorumVvecHash.IsNull() ||
-            membersSig.IsValid() ||
-            quorumSig.IsValid()) {
+            membersSig.Get().IsValid() ||
+            quorumSig.Get().IsValid()) {
             return false;
         }
         return true;
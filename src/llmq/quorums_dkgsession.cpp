@@ -174,22 +174,23 @@ void CDKGSession::SendContributions(CDKGPendingMessages& pendingMessages)
     qc.vvec = vvecContribution;
 
     cxxtimer::Timer t1(true);
-    qc.contributions = std::make_shared<CBLSIESMultiRecipientObjects<CBLSSecretKey>>();
-    qc.contributions->InitEncrypt(members.size());
-
+    BLSPublicKeyVector recipients;
+    BLSSecretKeyVector skContribs = skContributions;
+    recipients.reserve(members.size());
     for (size_t i = 0; i < members.size(); i++) {
         auto& m = members[i];
-        CBLSSecretKey skContrib = skContributions[i];
+        recipients.emplace_back(m->dmn->pdmnState->pubKeyOperator.Get());
 
         if (i != myIdx && ShouldSimulateError("contribution-lie")) {
             logger.Batch("lying for %s", m->dmn->proTxHash.ToString());
-            skContrib.MakeNewKey();
+            skContribs[i].MakeNewKey();
         }
+    }
 
-        if (!qc.contributions->Encrypt(i, m->dmn->pdmnState->pubKeyOperator.Get(), skContrib, PROTOCOL_VERSION)) {
-            logger.Batch("failed to encrypt contribution for %s", m->dmn->proTxHash.ToString());
-            return;
-        }
+    qc.contributions = std::make_shared<CBLSIESMultiRecipientObjects<CBLSSecretKey>>();
+    if (!blsWorker.EncryptContributions(recipients, skContribs, *qc.contributions, PROTOCOL_VERSION)) {
+        logger.Batch("failed to encrypt contributions");
+        return;
     }
 
     logger.Batch("encrypted contributions. time=%d", t1.count());
@@ -255,6 +256,21 @@ bool CDKGSession::PreVerifyMessage(const uint256& hash, const CDKGContribution&
     return true;
 }
 
+void CDKGSession::DecryptContributions(const std::vector<uint256>& hashes, const std::vector<std::shared_ptr<CBLSIESMultiRecipientObjects<CBLSSecretKey>>>& contributions)
+{
+    // shares of the previous batch which ReceiveMessage didn't pick up are not needed anymore
+    decryptedSkContributions.clear();
+
+    if (!AreWeMember() || contributions.empty()) {
+        return;
+    }
+
+    auto skShares = blsWorker.DecryptContributionShares(contributions, myIdx, *activeMasternodeInfo.blsKeyOperator, PROTOCOL_VERSION);
+    for (size_t i = 0; i < hashes.size(); i++) {
+        decryptedSkContributions.emplace(hashes[i], skShares[i]);
+    }
+}
+
 void CDKGSession::ReceiveMessage(const uint256& hash, const CDKGContribution& qc, bool& retBan)
 {
     CDKGLogger logger(*this, __func__);
@@ -319,7 +335,16 @@ void CDKGSession::ReceiveMessage(const uint256& hash, const CDKGContribution& qc
 
     bool complain = false;
     CBLSSecretKey skContribution;
-    if (!qc.contributions->Decrypt(myIdx, *activeMasternodeInfo.blsKeyOperator, skContribution, PROTOCOL_VERSION)) {
+    bool decrypted;
+    auto itDecrypted = decryptedSkContributions.find(hash);
+    if (itDecrypted != decryptedSkContributions.end()) {
+        skContribution = itDecrypted->second;
+        decryptedSkContributions.erase(itDecrypted);
+        decrypted = skContribution.IsValid();
+    } else {
+        decrypted = qc.contributions->Decrypt(myIdx, *activeMasternodeInfo.blsKeyOperator, skContribution, PROTOCOL_VERSION);
+    }
+    if (!decrypted) {
         logger.Batch("contribution from %s could not be decrypted", member->dmn->proTxHash.ToString());
         complain = true;
     } else if (member->idx != myIdx && ShouldSimulateError("complain-lie")) {
@@ -1195,10 +1220,10 @@ std::vector<CFinalCommitment> CDKGSession::FinalizeCommitments()
 
         CFinalCommitment fqc(params, first.quorumHash);
         fqc.validMembers = first.validMembers;
-        fqc.quorumPublicKey = first.quorumPublicKey;
+        fqc.quorumPublicKey.Set(first.quorumPublicKey);
         fqc.quorumVvecHash = first.quorumVvecHash;
 
-        uint256 commitmentHash = CLLMQUtils::BuildCommitmentHash(fqc.llmqType, fqc.quorumHash, fqc.validMembers, fqc.quorumPublicKey, fqc.quorumVvecHash);
+        uint256 commitmentHash = CLLMQUtils::BuildCommitmentHash(fqc.llmqType, fqc.quorumHash, fqc.validMembers, first.quorumPublicKey, fqc.quorumVvecHash);
 
         std::vector<CBLSSignature> aggSigs;
         std::vector<CBLSPublicKey> aggPks;
@@ -1225,20 +1250,22 @@ std::vector<CFinalCommitment> CDKGSession::FinalizeCommitments()
         }
 
         cxxtimer::Timer t1(true);
-        fqc.membersSig = CBLSSignature::AggregateSecure(aggSigs, aggPks, commitmentHash);
+        fqc.membersSig.Set(CBLSSignature::AggregateSecure(aggSigs, aggPks, commitmentHash));
         t1.stop();
 
         cxxtimer::Timer t2(true);
-        if (!fqc.quorumSig.Recover(thresholdSigs, signerIds)) {
+        CBLSSignature quorumSig;
+        if (!quorumSig.Recover(thresholdSigs, signerIds)) {
             logger.Batch("failed to recover quorum sig");
             continue;
         }
+        fqc.quorumSig.Set(quorumSig);
         t2.stop();
 
         finalCommitments.emplace_back(fqc);
 
         logger.Batch("final commitment: validMembers=%d, signers=%d, quorumPublicKey=%s, time1=%d, time2=%d",
-                        fqc.CountValidMembers(), fqc.CountSigners(), fqc.quorumPublicKey.ToString(),
+                        fqc.CountValidMembers(), fqc.CountSigners(), first.quorumPublicKey.ToString(),
                         t1.count(), t2.count());
     }
 
@@ -261,6 +261,8 @@ private:
     std::vector<BLSVerificationVectorPtr> receivedVvecs;
     // these are not necessarily verified yet. Only trust in what was written to the DB
     BLSSecretKeyVector receivedSkContributions;
+    // our shares of the current batch of contributions, decrypted in parallel by DecryptContributions. Indexed by msg hash
+    std::map<uint256, CBLSSecretKey> decryptedSkContributions;
 
     uint256 myProTxHash;
     CBLSId myId;
@@ -307,6 +309,7 @@ public:
     void Contribute(CDKGPendingMessages& pendingMessages);
     void SendContributions(CDKGPendingMessages& pendingMessages);
     bool PreVerifyMessage(const uint256& hash, const CDKGContribution& qc, bool& retBan) const;
+    void DecryptContributions(const std::vector<uint256>& hashes, const std::vector<std::shared_ptr<CBLSIESMultiRecipientObjects<CBLSSecretKey>>>& contributions);
     void ReceiveMessage(const uint256& hash, const CDKGContribution& qc, bool& retBan);
     void VerifyPendingContributions();
 
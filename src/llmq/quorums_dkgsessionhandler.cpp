@@ -54,11 +54,12 @@ void CDKGPendingMessages::PushPendingMessage(NodeId from, CDataStream& vRecv)
     pendingMessages.emplace_back(std::make_pair(from, std::move(pm)));
 }
 
-std::list<CDKGPendingMessages::BinaryMessage> CDKGPendingMessages::PopPendingMessages(size_t maxCount)
+std::vector<CDKGPendingMessages::BinaryMessage> CDKGPendingMessages::PopPendingMessages(size_t maxCount)
 {
     LOCK(cs);
 
-    std::list<BinaryMessage> ret;
+    std::vector<BinaryMessage> ret;
+    ret.reserve(std::min(maxCount, pendingMessages.size()));
     while (!pendingMessages.empty() && ret.size() < maxCount) {
         ret.emplace_back(std::move(pendingMessages.front()));
         pendingMessages.pop_front();
@@ -83,9 +84,8 @@ void CDKGPendingMessages::Clear()
 
 //////
 
-CDKGSessionHandler::CDKGSessionHandler(const Consensus::LLMQParams& _params, ctpl::thread_pool& _messageHandlerPool, CBLSWorker& _blsWorker, CDKGSessionManager& _dkgManager) :
+CDKGSessionHandler::CDKGSessionHandler(const Consensus::LLMQParams& _params, CBLSWorker& _blsWorker, CDKGSessionManager& _dkgManager) :
     params(_params),
-    messageHandlerPool(_messageHandlerPool),
     blsWorker(_blsWorker),
     dkgManager(_dkgManager),
     curSession(std::make_shared<CDKGSession>(_params, _blsWorker, _dkgManager)),
@@ -361,6 +361,28 @@ std::set<NodeId> BatchVerifyMessageSigs(CDKGSession& session, const std::vector<
     return ret;
 }
 
+// Lets the session do the CPU intensive parts of ReceiveMessage for a whole batch in parallel. Only contributions need this
+template<typename Message>
+void PrepareReceiveMessages(CDKGSession& session, const std::vector<uint256>& hashes, const std::vector<std::pair<NodeId, std::shared_ptr<Message>>>& messages, const std::set<NodeId>& badNodes)
+{
+}
+
+void PrepareReceiveMessages(CDKGSession& session, const std::vector<uint256>& hashes, const std::vector<std::pair<NodeId, std::shared_ptr<CDKGContribution>>>& messages, const std::set<NodeId>& badNodes)
+{
+    std::vector<uint256> contributionHashes;
+    std::vector<std::shared_ptr<CBLSIESMultiRecipientObjects<CBLSSecretKey>>> contributions;
+    contributionHashes.reserve(messages.size());
+    contributions.reserve(messages.size());
+    for (size_t i = 0; i < messages.size(); i++) {
+        if (badNodes.count(messages[i].first)) {
+            continue;
+        }
+        contributionHashes.emplace_back(hashes[i]);
+        contributions.emplace_back(messages[i].second->contributions);
+    }
+    session.DecryptContributions(contributionHashes, contributions);
+}
+
 template<typename Message>
 bool ProcessPendingMessageBatch(CDKGSession& session, CDKGPendingMessages& pendingMessages, size_t maxCount)
 {
@@ -419,6 +441,8 @@ bool ProcessPendingMessageBatch(CDKGSession& session, CDKGPendingMessages& pendi
         }
     }
 
+    PrepareReceiveMessages(session, hashes, preverifiedMessages, badNodes);
+
     for (size_t i = 0; i < preverifiedMessages.size(); i++) {
         NodeId nodeId = preverifiedMessages[i].first;
         if (badNodes.count(nodeId)) {
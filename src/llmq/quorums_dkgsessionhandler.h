@@ -7,9 +7,12 @@
 
 #include "llmq/quorums_dkgsession.h"
 
+#include "saltedhasher.h"
 #include "validation.h"
 
-#include "ctpl.h"
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace llmq
 {
@@ -31,7 +34,8 @@ enum QuorumPhase {
  * main handler thread, we push them into a CDKGPendingMessages object and later pop+deserialize them in the DKG phase
  * handler thread.
  *
- * Each message type has it's own instance of this class.
+ * Each message type has it's own instance of this class, so popped batches always hold messages of a single type.
+ * Queued messages share the buffer they were received in, it's moved into the queue and never copied.
  */
 class CDKGPendingMessages
 {
@@ -41,15 +45,15 @@ public:
 private:
     mutable CCriticalSection cs;
     size_t maxMessagesPerNode;
-    std::list<BinaryMessage> pendingMessages;
-    std::map<NodeId, size_t> messagesPerNode;
-    std::set<uint256> seenMessages;
+    std::deque<BinaryMessage> pendingMessages;
+    std::unordered_map<NodeId, size_t, StaticSaltedHasher> messagesPerNode;
+    std::unordered_set<uint256, StaticSaltedHasher> seenMessages;
 
 public:
     CDKGPendingMessages(size_t _maxMessagesPerNode);
 
     void PushPendingMessage(NodeId from, CDataStream& vRecv);
-    std::list<BinaryMessage> PopPendingMessages(size_t maxCount);
+    std::vector<BinaryMessage> PopPendingMessages(size_t maxCount);
     bool HasSeen(const uint256& hash) const;
     void Clear();
 
@@ -102,7 +106,6 @@ private:
     std::atomic<bool> stopRequested{false};
 
     const Consensus::LLMQParams& params;
-    ctpl::thread_pool& messageHandlerPool;
     CBLSWorker& blsWorker;
     CDKGSessionManager& dkgManager;
 
@@ -118,7 +121,7 @@ private:
     CDKGPendingMessages pendingPrematureCommitments;
 
 public:
-    CDKGSessionHandler(const Consensus::LLMQParams& _params, ctpl::thread_pool& _messageHandlerPool, CBLSWorker& blsWorker, CDKGSessionManager& _dkgManager);
+    CDKGSessionHandler(const Consensus::LLMQParams& _params, CBLSWorker& blsWorker, CDKGSessionManager& _dkgManager);
     ~CDKGSessionHandler();
 
     void UpdatedBlockTip(const CBlockIndex *pindexNew);
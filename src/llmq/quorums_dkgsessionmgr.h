@@ -9,8 +9,6 @@
 
 #include "validation.h"
 
-#include "ctpl.h"
-
 class UniValue;
 
 namespace llmq
@@ -23,7 +21,6 @@ class CDKGSessionManager
 private:
     CDBWrapper& llmqDb;
     CBLSWorker& blsWorker;
-    ctpl::thread_pool messageHandlerPool;
 
     std::map<Consensus::LLMQType, CDKGSessionHandler> dkgSessionHandlers;
 
@@ -50,8 +47,7 @@ public:
     CDKGSessionManager(CDBWrapper& _llmqDb, CBLSWorker& _blsWorker);
     ~CDKGSessionManager();
 
-    void StartMessageHandlerPool();
-    void StopMessageHandlerPool();
+    void StartSessionHandlers();
 
     void UpdatedBlockTip(const CBlockIndex *pindexNew, bool fInitialDownload);
 
@@ -4,6 +4,7 @@
 
 #include "quorums_chainlocks.h"
 #include "quorums_instantsend.h"
+#include "quorums_stats.h"
 #include "quorums_utils.h"
 
 #include "bls/bls_batchverifier.h"
@@ -13,7 +14,9 @@
 #include "masternode-sync.h"
 #include "net_processing.h"
 #include "spork.h"
+#include "trace.h"
 #include "validation.h"
+#include "workerpool.h"
 
 #ifdef ENABLE_WALLET
 #include "wallet/wallet.h"
@@ -43,22 +46,71 @@ uint256 CInstantSendLock::GetRequestId() const
 
 ////////////////
 
-void CInstantSendDb::WriteNewInstantSendLock(const uint256& hash, const CInstantSendLock& islock)
+CInstantSendDb::CInstantSendDb(CDBWrapper& _db) :
+    db(_db),
+    pendingWrites(_db)
 {
-    CDBBatch batch(db);
-    batch.Write(std::make_tuple(std::string("is_i"), hash), islock);
-    batch.Write(std::make_tuple(std::string("is_tx"), islock.txid), hash);
-    for (auto& in : islock.inputs) {
-        batch.Write(std::make_tuple(std::string("is_in"), in), hash);
+    auto it = std::unique_ptr<CDBIterator>(db.NewIterator());
+    auto firstKey = std::make_tuple(std::string("is_i"), uint256());
+
+    it->Seek(firstKey);
+
+    while (it->Valid()) {
+        decltype(firstKey) curKey;
+        if (!it->GetKey(curKey) || std::get<0>(curKey) != "is_i") {
+            break;
+        }
+
+        auto islock = std::make_shared<CInstantSendLock>();
+        if (it->GetValue(*islock)) {
+            AddToIndex(std::get<1>(curKey), islock);
+        }
+
+        it->Next();
     }
-    db.WriteBatch(batch);
 
-    auto p = std::make_shared<CInstantSendLock>(islock);
-    islockCache.insert(hash, p);
-    txidCache.insert(islock.txid, hash);
+    nLastFlushTime = GetTimeMillis();
+}
+
+CInstantSendDb::~CInstantSendDb()
+{
+    FlushPendingWrites();
+}
+
+void CInstantSendDb::FlushPendingWrites(bool fForce)
+{
+    if (pendingWrites.SizeEstimate() == 0) {
+        return;
+    }
+    if (!fForce && pendingWrites.SizeEstimate() < MAX_PENDING_WRITES_SIZE && GetTimeMillis() - nLastFlushTime < MAX_PENDING_WRITES_TIME) {
+        return;
+    }
+
+    db.WriteBatch(pendingWrites);
+    pendingWrites.Clear();
+    nLastFlushTime = GetTimeMillis();
+}
+
+void CInstantSendDb::AddToIndex(const uint256& hash, const CInstantSendLockPtr& islock)
+{
+    islocksByHash.emplace(hash, islock);
+    islocksByTxid.emplace(islock->txid, hash);
+    for (auto& in : islock->inputs) {
+        islocksByInput.emplace(in, hash);
+    }
+}
+
+void CInstantSendDb::WriteNewInstantSendLock(const uint256& hash, const CInstantSendLock& islock)
+{
+    pendingWrites.Write(std::make_tuple(std::string("is_i"), hash), islock);
+    pendingWrites.Write(std::make_tuple(std::string("is_tx"), islock.txid), hash);
     for (auto& in : islock.inputs) {
-        outpointCache.insert(in, hash);
+        pendingWrites.Write(std::make_tuple(std::string("is_in"), in), hash);
     }
+
+    AddToIndex(hash, std::make_shared<CInstantSendLock>(islock));
+
+    FlushPendingWrites(false);
 }
 
 void CInstantSendDb::RemoveInstantSendLock(CDBBatch& batch, const uint256& hash, CInstantSendLockPtr islock)
@@ -76,10 +128,16 @@ void CInstantSendDb::RemoveInstantSendLock(CDBBatch& batch, const uint256& hash,
         batch.Erase(std::make_tuple(std::string("is_in"), in));
     }
 
-    islockCache.erase(hash);
-    txidCache.erase(islock->txid);
+    islocksByHash.erase(hash);
+    auto txidIt = islocksByTxid.find(islock->txid);
+    if (txidIt != islocksByTxid.end() && txidIt->second == hash) {
+        islocksByTxid.erase(txidIt);
+    }
     for (auto& in : islock->inputs) {
-        outpointCache.erase(in);
+        auto inputIt = islocksByInput.find(in);
+        if (inputIt != islocksByInput.end() && inputIt->second == hash) {
+            islocksByInput.erase(inputIt);
+        }
     }
 }
 
@@ -106,6 +164,8 @@ void CInstantSendDb::WriteInstantSendLockArchived(CDBBatch& batch, const uint256
 
 std::unordered_map<uint256, CInstantSendLockPtr> CInstantSendDb::RemoveConfirmedInstantSendLocks(int nUntilHeight)
 {
+    FlushPendingWrites();
+
     auto it = std::unique_ptr<CDBIterator>(db.NewIterator());
 
     auto firstKey = BuildInversedISLockKey("is_m", nUntilHeight, uint256());
@@ -180,60 +240,25 @@ bool CInstantSendDb::HasArchivedInstantSendLock(const uint256& islockHash)
 
 size_t CInstantSendDb::GetInstantSendLockCount()
 {
-    auto it = std::unique_ptr<CDBIterator>(db.NewIterator());
-    auto firstKey = std::make_tuple(std::string("is_i"), uint256());
-
-    it->Seek(firstKey);
-
-    size_t cnt = 0;
-    while (it->Valid()) {
-        decltype(firstKey) curKey;
-        if (!it->GetKey(curKey) || std::get<0>(curKey) != "is_i") {
-            break;
-        }
-
-        cnt++;
-
-        it->Next();
-    }
-
-    return cnt;
+    return islocksByHash.size();
 }
 
 CInstantSendLockPtr CInstantSendDb::GetInstantSendLockByHash(const uint256& hash)
 {
-    CInstantSendLockPtr ret;
-    if (islockCache.get(hash, ret)) {
-        return ret;
-    }
-
-    ret = std::make_shared<CInstantSendLock>();
-    bool exists = db.Read(std::make_tuple(std::string("is_i"), hash), *ret);
-    if (!exists) {
-        ret = nullptr;
+    auto it = islocksByHash.find(hash);
+    if (it == islocksByHash.end()) {
+        return nullptr;
     }
-    islockCache.insert(hash, ret);
-    return ret;
+    return it->second;
 }
 
 uint256 CInstantSendDb::GetInstantSendLockHashByTxid(const uint256& txid)
 {
-    uint256 islockHash;
-
-    bool found = txidCache.get(txid, islockHash);
-    if (found && islockHash.IsNull()) {
-        return uint256();
-    }
-
-    if (!found) {
-        found = db.Read(std::make_tuple(std::string("is_tx"), txid), islockHash);
-        txidCache.insert(txid, islockHash);
-    }
-
-    if (!found) {
+    auto it = islocksByTxid.find(txid);
+    if (it == islocksByTxid.end()) {
         return uint256();
     }
-    return islockHash;
+    return it->second;
 }
 
 CInstantSendLockPtr CInstantSendDb::GetInstantSendLockByTxid(const uint256& txid)
@@ -247,25 +272,18 @@ CInstantSendLockPtr CInstantSendDb::GetInstantSendLockByTxid(const uint256& txid
 
 CInstantSendLockPtr CInstantSendDb::GetInstantSendLockByInput(const COutPoint& outpoint)
 {
-    uint256 islockHash;
-    bool found = outpointCache.get(outpoint, islockHash);
-    if (found && islockHash.IsNull()) {
-        return nullptr;
-    }
-
-    if (!found) {
-        found = db.Read(std::make_tuple(std::string("is_in"), outpoint), islockHash);
-        outpointCache.insert(outpoint, islockHash);
-    }
-
-    if (!found) {
+    auto it = islocksByInput.find(outpoint);
+    if (it == islocksByInput.end()) {
         return nullptr;
     }
-    return GetInstantSendLockByHash(islockHash);
+    return GetInstantSendLockByHash(it->second);
 }
 
 std::vector<uint256> CInstantSendDb::GetInstantSendLocksByParent(const uint256& parent)
 {
+    // the in-memory index is not ordered by input, so we rely on the DB for this one
+    FlushPendingWrites();
+
     auto it = std::unique_ptr<CDBIterator>(db.NewIterator());
     auto firstKey = std::make_tuple(std::string("is_in"), COutPoint(parent, 0));
     it->Seek(firstKey);
@@ -301,6 +319,8 @@ std::vector<uint256> CInstantSendDb::RemoveChainedInstantSendLocks(const uint256
     std::unordered_set<uint256, StaticSaltedHasher> added;
     stack.emplace_back(txid);
 
+    FlushPendingWrites();
+
     CDBBatch batch(db);
     while (!stack.empty()) {
         auto children = GetInstantSendLocksByParent(stack.back());
@@ -367,11 +387,15 @@ void CInstantSendManager::Stop()
     if (workThread.joinable()) {
         workThread.join();
     }
+
+    LOCK(cs);
+    db.FlushPendingWrites();
 }
 
 void CInstantSendManager::InterruptWorkerThread()
 {
     workInterrupt();
+    WakeupWorkerThread();
 }
 
 bool CInstantSendManager::ProcessTx(const CTransaction& tx, const Consensus::Params& params)
@@ -440,19 +464,33 @@ bool CInstantSendManager::ProcessTx(const CTransaction& tx, const Consensus::Par
         return true;
     }
 
+    {
+        LOCK(cs);
+        auto& pendingIds = pendingInputLocks[tx.GetHash()];
+        pendingIds.clear();
+        for (auto& id : ids) {
+            inputRequestIds.emplace(id);
+            pendingIds.emplace(id);
+        }
+    }
+
+    // All signing requests are queued first, so that the sig shares of all inputs end up in the same batches
     for (size_t i = 0; i < tx.vin.size(); i++) {
         auto& in = tx.vin[i];
         auto& id = ids[i];
-        inputRequestIds.emplace(id);
         if (quorumSigningManager->AsyncSignIfMember(llmqType, id, tx.GetHash())) {
             LogPrintf("CInstantSendManager::%s -- txid=%s: voted on input %s with id %s\n", __func__,
                       tx.GetHash().ToString(), in.prevout.ToStringShort(), id.ToString());
         }
     }
 
-    // We might have received all input locks before we got the corresponding TX. In this case, we have to sign the
-    // islock now instead of waiting for the input locks.
-    TrySignInstantSendLock(tx);
+    // We might have received some or all input locks before we got the corresponding TX. These won't be announced
+    // through HandleNewRecoveredSig again. If all are there already, the islock is created by the worker thread.
+    for (auto& id : ids) {
+        if (quorumSigningManager->HasRecoveredSig(llmqType, id, tx.GetHash())) {
+            RemovePendingInputLock(tx.GetHash(), id);
+        }
+    }
 
     return true;
 }
@@ -579,26 +617,50 @@ void CInstantSendManager::HandleNewRecoveredSig(const CRecoveredSig& recoveredSi
 
 void CInstantSendManager::HandleNewInputLockRecoveredSig(const CRecoveredSig& recoveredSig, const uint256& txid)
 {
-    auto llmqType = Params().GetConsensus().llmqForInstantSend;
+    LogPrint("instantsend", "CInstantSendManager::%s -- txid=%s: got recovered sig for input with id %s\n", __func__,
+             txid.ToString(), recoveredSig.id.ToString());
 
-    CTransactionRef tx;
-    uint256 hashBlock;
-    if (!GetTransaction(txid, tx, Params().GetConsensus(), hashBlock, true)) {
-        return;
-    }
+    RemovePendingInputLock(txid, recoveredSig.id);
+}
 
-    if (LogAcceptCategory("instantsend")) {
-        for (auto& in : tx->vin) {
-            auto id = ::SerializeHash(std::make_pair(INPUTLOCK_REQUESTID_PREFIX, in.prevout));
-            if (id == recoveredSig.id) {
-                LogPrint("instantsend", "CInstantSendManager::%s -- txid=%s: got recovered sig for input %s\n", __func__,
-                         txid.ToString(), in.prevout.ToStringShort());
-                break;
+void CInstantSendManager::RemovePendingInputLock(const uint256& txid, const uint256& inputRequestId)
+{
+    {
+        LOCK(cs);
+        auto it = pendingInputLocks.find(txid);
+        if (it != pendingInputLocks.end()) {
+            it->second.erase(inputRequestId);
+            if (!it->second.empty()) {
+                return;
             }
+            pendingInputLocks.erase(it);
+        }
+        // if we don't know about the TX (e.g. after a restart), let TrySignInstantSendLock figure out if all inputs
+        // are locked
+        pendingInputLockedTxs.emplace(txid);
+    }
+    WakeupWorkerThread();
+}
+
+bool CInstantSendManager::ProcessPendingInputLockedTxs()
+{
+    decltype(pendingInputLockedTxs) txids;
+    {
+        LOCK(cs);
+        txids = std::move(pendingInputLockedTxs);
+        pendingInputLockedTxs.clear();
+    }
+
+    for (auto& txid : txids) {
+        CTransactionRef tx;
+        uint256 hashBlock;
+        if (!GetTransaction(txid, tx, Params().GetConsensus(), hashBlock, true)) {
+            continue;
         }
+        TrySignInstantSendLock(*tx);
     }
 
-    TrySignInstantSendLock(*tx);
+    return !txids.empty();
 }
 
 void CInstantSendManager::TrySignInstantSendLock(const CTransaction& tx)
@@ -662,7 +724,10 @@ void CInstantSendManager::HandleNewInstantSendLockRecoveredSig(const llmq::CReco
     }
 
     islock.sig = recoveredSig.sig;
-    ProcessInstantSendLock(-1, ::SerializeHash(islock), islock);
+    uint256 hash = ::SerializeHash(islock);
+    TRACE_TIME_START(nTraceStart);
+    ProcessInstantSendLock(-1, hash, islock);
+    TRACE4(llmq, process_islock, hash.begin(), islock.txid.begin(), -1, TRACE_TIME_ELAPSED(nTraceStart));
 }
 
 void CInstantSendManager::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)
@@ -690,6 +755,8 @@ void CInstantSendManager::ProcessMessageInstantSendLock(CNode* pfrom, const llmq
     }
 
     auto hash = ::SerializeHash(islock);
+    // it might have been pushed to us, don't announce it back
+    pfrom->AddInventoryKnown(hash);
 
     LOCK(cs);
     if (db.GetInstantSendLockByHash(hash) != nullptr) {
@@ -760,7 +827,7 @@ bool CInstantSendManager::ProcessPendingInstantSendLocks()
 
     if (quorumsRotated) {
         // first check against the current active set and don't ban
-        auto badISLocks = ProcessPendingInstantSendLocks(tipHeight, pend, false);
+        auto badISLocks = ProcessPendingInstantSendLocks(quorums1, pend, false);
         if (!badISLocks.empty()) {
             LogPrintf("CInstantSendManager::%s -- detected LLMQ active set rotation, redoing verification on old active set\n", __func__);
 
@@ -773,36 +840,58 @@ bool CInstantSendManager::ProcessPendingInstantSendLocks()
                 }
             }
             // now check against the previous active set and perform banning if this fails
-            ProcessPendingInstantSendLocks(tipHeight - 1, pend, true);
+            ProcessPendingInstantSendLocks(quorums2, pend, true);
         }
     } else {
-        ProcessPendingInstantSendLocks(tipHeight, pend, true);
+        ProcessPendingInstantSendLocks(quorums1, pend, true);
     }
 
     return true;
 }
 
-std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(int signHeight, const std::unordered_map<uint256, std::pair<NodeId, CInstantSendLock>>& pend, bool ban)
+std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(const std::vector<CQuorumCPtr>& quorums, const std::unordered_map<uint256, std::pair<NodeId, CInstantSendLock>>& pend, bool ban)
 {
     auto llmqType = Params().GetConsensus().llmqForInstantSend;
 
-    CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, true, 8);
-    std::unordered_map<uint256, std::pair<CQuorumCPtr, CRecoveredSig>> recSigs;
+    if (quorums.empty()) {
+        // should not happen, but without an active quorum set, all islocks would fail to verify
+        return {};
+    }
+
+    typedef std::unordered_map<uint256, std::pair<NodeId, CInstantSendLock>>::const_iterator PendingIterator;
+    struct VerifyBatch {
+        CBLSBatchVerifier<NodeId, uint256> batchVerifier{false, true, 0, true};
+        std::vector<PendingIterator> islocks;
+        std::unordered_map<uint256, std::pair<CQuorumCPtr, CRecoveredSig>> recSigs;
+    };
 
-    for (const auto& p : pend) {
-        auto& hash = p.first;
-        auto nodeId = p.second.first;
-        auto& islock = p.second.second;
+    // nodes which sent us an islock with an invalid sig. We don't process any other islocks from these
+    std::set<NodeId> badSources;
+    std::unordered_set<uint256> badISLocks;
+
+    std::vector<std::unique_ptr<VerifyBatch>> batches;
+    for (auto it = pend.begin(); it != pend.end(); ++it) {
+        auto& hash = it->first;
+        auto nodeId = it->second.first;
+        auto& islock = it->second.second;
 
-        if (batchVerifier.badSources.count(nodeId)) {
+        if (badSources.count(nodeId)) {
+            badISLocks.emplace(hash);
             continue;
         }
 
         if (!islock.sig.Get().IsValid()) {
-            batchVerifier.badSources.emplace(nodeId);
+            badSources.emplace(nodeId);
+            badISLocks.emplace(hash);
             continue;
         }
 
+        if (batches.empty() || batches.back()->islocks.size() >= ISLOCK_VERIFY_BATCH_SIZE) {
+            batches.emplace_back(new VerifyBatch());
+        }
+        auto& batch = *batches.back();
+        batch.islocks.emplace_back(it);
+
         auto id = islock.GetRequestId();
 
         // no need to verify an ISLOCK if we already have verified the recovered sig that belongs to it
@@ -810,13 +899,9 @@ std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(
             continue;
         }
 
-        auto quorum = quorumSigningManager->SelectQuorumForSigning(llmqType, signHeight, id);
-        if (!quorum) {
-            // should not happen, but if one fails to select, all others will also fail to select
-            return {};
-        }
+        auto quorum = CSigningManager::SelectQuorumForSigning(llmqType, quorums, id);
         uint256 signHash = CLLMQUtils::BuildSignHash(llmqType, quorum->qc.quorumHash, id, islock.txid);
-        batchVerifier.PushMessage(nodeId, hash, signHash, islock.sig.Get(), quorum->qc.quorumPublicKey);
+        batch.batchVerifier.PushMessage(nodeId, hash, signHash, islock.sig.Get(), quorum->qc.quorumPublicKey.Get());
 
         // We can reconstruct the CRecoveredSig objects from the islock and pass it to the signing manager, which
         // avoids unnecessary double-verification of the signature. We however only do this when verification here
@@ -828,50 +913,88 @@ std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(
             recSig.id = id;
             recSig.msgHash = islock.txid;
             recSig.sig = islock.sig;
-            recSigs.emplace(std::piecewise_construct,
+            batch.recSigs.emplace(std::piecewise_construct,
                     std::forward_as_tuple(hash),
                     std::forward_as_tuple(std::move(quorum), std::move(recSig)));
         }
     }
 
-    batchVerifier.Verify();
-
-    std::unordered_set<uint256> badISLocks;
-
-    if (ban && !batchVerifier.badSources.empty()) {
-        LOCK(cs_main);
-        for (auto& nodeId : batchVerifier.badSources) {
-            // Let's not be too harsh, as the peer might simply be unlucky and might have sent us an old lock which
-            // does not validate anymore due to changed quorums
-            Misbehaving(nodeId, 20);
+    // the next batch is verified on the shared pool while the previous one is processed and written to the DB
+    auto verify = [llmqType](VerifyBatch* batch) {
+        int64_t nStartTime = GetTimeMicros();
+        batch->batchVerifier.Verify();
+        quorumStats.Record(llmqType, CLLMQStats::METRIC_ISLOCKS_VERIFY, GetTimeMicros() - nStartTime, batch->islocks.size());
+        TRACE3(llmq, verify_islocks, batch->islocks.size(), batch->batchVerifier.badMessages.size(), GetTimeMicros() - nStartTime);
+    };
+    auto verifyAsync = [&](VerifyBatch* batch) {
+        if (g_workerPool.Size() == 0) {
+            verify(batch);
+            std::promise<void> p;
+            p.set_value();
+            return p.get_future();
         }
+        return g_workerPool.Push([verify, batch](int threadId) {
+            verify(batch);
+        }, CWorkerPool::PRIORITY_HIGH);
+    };
+
+    std::future<void> verifyFuture;
+    if (!batches.empty()) {
+        verifyFuture = verifyAsync(batches[0].get());
     }
-    for (const auto& p : pend) {
-        auto& hash = p.first;
-        auto nodeId = p.second.first;
-        auto& islock = p.second.second;
+    for (size_t i = 0; i < batches.size(); i++) {
+        auto& batch = *batches[i];
+        verifyFuture.get();
 
-        if (batchVerifier.badMessages.count(hash)) {
-            LogPrintf("CInstantSendManager::%s -- txid=%s, islock=%s: invalid sig in islock, peer=%d\n", __func__,
-                     islock.txid.ToString(), hash.ToString(), nodeId);
-            badISLocks.emplace(hash);
-            continue;
+        // the following processing writes to the DB, so let's verify the next batch in the meantime
+        if (i + 1 < batches.size()) {
+            verifyFuture = verifyAsync(batches[i + 1].get());
         }
 
-        ProcessInstantSendLock(nodeId, hash, islock);
+        badSources.insert(batch.batchVerifier.badSources.begin(), batch.batchVerifier.badSources.end());
+
+        for (auto& it : batch.islocks) {
+            auto& hash = it->first;
+            auto nodeId = it->second.first;
+            auto& islock = it->second.second;
 
-        // See comment further on top. We pass a reconstructed recovered sig to the signing manager to avoid
-        // double-verification of the sig.
-        auto it = recSigs.find(hash);
-        if (it != recSigs.end()) {
-            auto& quorum = it->second.first;
-            auto& recSig = it->second.second;
-            if (!quorumSigningManager->HasRecoveredSigForId(llmqType, recSig.id)) {
-                recSig.UpdateHash();
-                LogPrint("instantsend", "CInstantSendManager::%s -- txid=%s, islock=%s: passing reconstructed recSig to signing mgr, peer=%d\n", __func__,
+            if (batch.batchVerifier.badMessages.count(hash)) {
+                LogPrintf("CInstantSendManager::%s -- txid=%s, islock=%s: invalid sig in islock, peer=%d\n", __func__,
                          islock.txid.ToString(), hash.ToString(), nodeId);
-                quorumSigningManager->PushReconstructedRecoveredSig(recSig, quorum);
+                badISLocks.emplace(hash);
+                continue;
+            }
+            if (badSources.count(nodeId)) {
+                badISLocks.emplace(hash);
+                continue;
             }
+
+            TRACE_TIME_START(nTraceStart);
+            ProcessInstantSendLock(nodeId, hash, islock);
+            TRACE4(llmq, process_islock, hash.begin(), islock.txid.begin(), nodeId, TRACE_TIME_ELAPSED(nTraceStart));
+
+            // See comment further on top. We pass a reconstructed recovered sig to the signing manager to avoid
+            // double-verification of the sig.
+            auto recSigIt = batch.recSigs.find(hash);
+            if (recSigIt != batch.recSigs.end()) {
+                auto& quorum = recSigIt->second.first;
+                auto& recSig = recSigIt->second.second;
+                if (!quorumSigningManager->HasRecoveredSigForId(llmqType, recSig.id)) {
+                    recSig.UpdateHash();
+                    LogPrint("instantsend", "CInstantSendManager::%s -- txid=%s, islock=%s: passing reconstructed recSig to signing mgr, peer=%d\n", __func__,
+                             islock.txid.ToString(), hash.ToString(), nodeId);
+                    quorumSigningManager->PushReconstructedRecoveredSig(recSig, quorum);
+                }
+            }
+        }
+    }
+
+    if (ban && !badSources.empty()) {
+        LOCK(cs_main);
+        for (auto& nodeId : badSources) {
+            // Let's not be too harsh, as the peer might simply be unlucky and might have sent us an old lock which
+            // does not validate anymore due to changed quorums
+            Misbehaving(nodeId, 20);
         }
     }
 
@@ -914,6 +1037,7 @@ void CInstantSendManager::ProcessInstantSendLock(NodeId from, const uint256& has
 
         creatingInstantSendLocks.erase(islock.GetRequestId());
         txToCreatingInstantSendLocks.erase(islock.txid);
+        pendingInputLocks.erase(islock.txid);
 
         CInstantSendLockPtr otherIsLock;
         if (db.GetInstantSendLockByHash(hash)) {
@@ -942,8 +1066,11 @@ void CInstantSendManager::ProcessInstantSendLock(NodeId from, const uint256& has
     }
 
     CInv inv(MSG_ISLOCK, hash);
-    if (tx != nullptr) {
-        g_connman->RelayInvFiltered(inv, *tx, LLMQS_PROTO_VERSION);
+    PushToMasternodePeers(*g_connman, inv, NetMsgType::ISLOCK, islock, LLMQS_PROTO_VERSION);
+    // islocks often arrive before the TX's parents, the orphan pool may have the TX then
+    CTransactionRef txFilter = tx != nullptr ? tx : GetOrphanTx(islock.txid);
+    if (txFilter != nullptr) {
+        g_connman->RelayInvFiltered(inv, *txFilter, LLMQS_PROTO_VERSION);
     } else {
         // we don't have the TX yet, so we only filter based on txid. Later when that TX arrives, we will re-announce
         // with the TX taken into account.
@@ -953,6 +1080,8 @@ void CInstantSendManager::ProcessInstantSendLock(NodeId from, const uint256& has
     RemoveMempoolConflictsForLock(hash, islock);
     ResolveBlockConflicts(hash, islock);
     UpdateWalletTransaction(islock.txid, tx);
+
+    chainLocksHandler->NotifyTxLocked(islock.txid);
 }
 
 void CInstantSendManager::UpdateWalletTransaction(const uint256& txid, const CTransactionRef& tx)
@@ -1064,6 +1193,8 @@ void CInstantSendManager::RemoveNonLockedTx(const uint256& txid, bool retryChild
 {
     AssertLockHeld(cs);
 
+    pendingInputLocks.erase(txid);
+
     auto it = nonLockedTxs.find(txid);
     if (it == nonLockedTxs.end()) {
         return;
@@ -1480,16 +1611,49 @@ size_t CInstantSendManager::GetInstantSendLockCount()
     return db.GetInstantSendLockCount();
 }
 
+void CInstantSendManager::GetPendingCounts(size_t& retISLocks, size_t& retInputLockedTxs)
+{
+    LOCK(cs);
+    retISLocks = pendingInstantSendLocks.size();
+    retInputLockedTxs = pendingInputLockedTxs.size();
+}
+
+void CInstantSendManager::WakeupWorkerThread()
+{
+    {
+        std::lock_guard<std::mutex> l(workMutex);
+        fWorkPending = true;
+    }
+    workCond.notify_one();
+}
+
+// Returns false when the thread got interrupted
+bool CInstantSendManager::WaitForWork(int64_t nTimeout)
+{
+    std::unique_lock<std::mutex> l(workMutex);
+    workCond.wait_for(l, std::chrono::milliseconds(nTimeout), [this] {
+        return fWorkPending || (bool)workInterrupt;
+    });
+    fWorkPending = false;
+    return !workInterrupt;
+}
+
 void CInstantSendManager::WorkThreadMain()
 {
     while (!workInterrupt) {
         bool didWork = false;
 
+        didWork |= ProcessPendingInputLockedTxs();
         didWork |= ProcessPendingInstantSendLocks();
         didWork |= ProcessPendingRetryLockTxs();
 
+        {
+            LOCK(cs);
+            db.FlushPendingWrites(false);
+        }
+
         if (!didWork) {
-            if (!workInterrupt.sleep_for(std::chrono::milliseconds(100))) {
+            if (!WaitForWork(100)) {
                 return;
             }
         }
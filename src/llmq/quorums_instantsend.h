@@ -8,9 +8,10 @@
 #include "quorums_signing.h"
 
 #include "coins.h"
-#include "unordered_lru_cache.h"
 #include "primitives/transaction.h"
 
+#include <condition_variable>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -40,17 +41,32 @@ public:
 
 typedef std::shared_ptr<CInstantSendLock> CInstantSendLockPtr;
 
+/**
+ * All islocks which are not fully confirmed yet are kept in memory, indexed by hash, txid and inputs. This index is
+ * authoritative, so lookups never have to touch the DB. New islocks are written to the DB in batches. Pending writes
+ * are flushed before anything else is written, so that the DB never sees writes and erases out of order.
+ */
 class CInstantSendDb
 {
 private:
+    static const size_t MAX_PENDING_WRITES_SIZE = 1 << 20;
+    static const int64_t MAX_PENDING_WRITES_TIME = 1000;
+
     CDBWrapper& db;
 
-    unordered_lru_cache<uint256, CInstantSendLockPtr, StaticSaltedHasher, 10000> islockCache;
-    unordered_lru_cache<uint256, uint256, StaticSaltedHasher, 10000> txidCache;
-    unordered_lru_cache<COutPoint, uint256, SaltedOutpointHasher, 10000> outpointCache;
+    std::unordered_map<uint256, CInstantSendLockPtr, StaticSaltedHasher> islocksByHash;
+    std::unordered_map<uint256, uint256, StaticSaltedHasher> islocksByTxid;
+    std::unordered_map<COutPoint, uint256, SaltedOutpointHasher> islocksByInput;
+
+    CDBBatch pendingWrites;
+    int64_t nLastFlushTime{0};
 
 public:
-    CInstantSendDb(CDBWrapper& _db) : db(_db) {}
+    CInstantSendDb(CDBWrapper& _db);
+    ~CInstantSendDb();
+
+    // writes all pending islocks to the DB if enough changes accumulated or fForce is set
+    void FlushPendingWrites(bool fForce = true);
 
     void WriteNewInstantSendLock(const uint256& hash, const CInstantSendLock& islock);
     void RemoveInstantSendLock(CDBBatch& batch, const uint256& hash, CInstantSendLockPtr islock);
@@ -70,23 +86,42 @@ public:
 
     std::vector<uint256> GetInstantSendLocksByParent(const uint256& parent);
     std::vector<uint256> RemoveChainedInstantSendLocks(const uint256& islockHash, const uint256& txid, int nHeight);
+
+private:
+    void AddToIndex(const uint256& hash, const CInstantSendLockPtr& islock);
 };
 
 class CInstantSendManager : public CRecoveredSigsListener
 {
 private:
+    // number of incoming islocks verified at once
+    static const size_t ISLOCK_VERIFY_BATCH_SIZE = 16;
+
     CCriticalSection cs;
     CInstantSendDb db;
 
     std::thread workThread;
     CThreadInterrupt workInterrupt;
 
+    // signals the worker thread that TXs got all their input locks
+    std::mutex workMutex;
+    std::condition_variable workCond;
+    bool fWorkPending{false};
+
     /**
      * Request ids of inputs that we signed. Used to determine if a recovered signature belongs to an
      * in-progress input lock.
      */
     std::unordered_set<uint256, StaticSaltedHasher> inputRequestIds;
 
+    /**
+     * TXs for which we requested input locks, mapped to the request ids of the inputs that are still missing a
+     * recovered sig. When the last one arrives, the TX is moved to pendingInputLockedTxs and the worker thread
+     * creates the islock, so that the thread handling recovered sigs is not blocked by TX lookups.
+     */
+    std::unordered_map<uint256, std::unordered_set<uint256, StaticSaltedHasher>, StaticSaltedHasher> pendingInputLocks;
+    std::unordered_set<uint256, StaticSaltedHasher> pendingInputLockedTxs;
+
     /**
      * These are the islocks that are currently in the middle of being created. Entries are created when we observed
      * recovered signatures for all inputs of a TX. At the same time, we initiate signing of our sigshare for the islock.
@@ -132,12 +167,14 @@ public:
     void HandleNewInstantSendLockRecoveredSig(const CRecoveredSig& recoveredSig);
 
     void TrySignInstantSendLock(const CTransaction& tx);
+    void RemovePendingInputLock(const uint256& txid, const uint256& inputRequestId);
+    bool ProcessPendingInputLockedTxs();
 
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
     void ProcessMessageInstantSendLock(CNode* pfrom, const CInstantSendLock& islock, CConnman& connman);
     bool PreVerifyInstantSendLock(NodeId nodeId, const CInstantSendLock& islock, bool& retBan);
     bool ProcessPendingInstantSendLocks();
-    std::unordered_set<uint256> ProcessPendingInstantSendLocks(int signHeight, const std::unordered_map<uint256, std::pair<NodeId, CInstantSendLock>>& pend, bool ban);
+    std::unordered_set<uint256> ProcessPendingInstantSendLocks(const std::vector<CQuorumCPtr>& quorums, const std::unordered_map<uint256, std::pair<NodeId, CInstantSendLock>>& pend, bool ban);
     void ProcessInstantSendLock(NodeId from, const uint256& hash, const CInstantSendLock& islock);
     void UpdateWalletTransaction(const uint256& txid, const CTransactionRef& tx);
 
@@ -161,7 +198,11 @@ public:
     bool GetInstantSendLockByHash(const uint256& hash, CInstantSendLock& ret);
 
     size_t GetInstantSendLockCount();
+    // number of incoming ISLOCKs which wait for verification and of TXs which wait for their input locks
+    void GetPendingCounts(size_t& retISLocks, size_t& retInputLockedTxs);
 
+    void WakeupWorkerThread();
+    bool WaitForWork(int64_t nTimeout);
     void WorkThreadMain();
 };
 
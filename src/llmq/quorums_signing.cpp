@@ -5,9 +5,11 @@
 #include "quorums_signing.h"
 #include "quorums_utils.h"
 #include "quorums_signing_shares.h"
+#include "quorums_stats.h"
 
 #include "activemasternode.h"
 #include "bls/bls_batchverifier.h"
+#include "bls/bls_sigcache.h"
 #include "cxxtimer.hpp"
 #include "init.h"
 #include "net_processing.h"
@@ -36,8 +38,12 @@ UniValue CRecoveredSig::ToJson() const
     return ret;
 }
 
-CRecoveredSigsDb::CRecoveredSigsDb(CDBWrapper& _db) :
-    db(_db)
+CRecoveredSigsDb::CRecoveredSigsDb(CDBWrapper& _db, size_t _minCacheSize) :
+    db(_db),
+    minCacheSize(_minCacheSize),
+    hasSigForIdCache(_minCacheSize),
+    hasSigForSessionCache(_minCacheSize),
+    hasSigForHashCache(_minCacheSize)
 {
     if (Params().NetworkIDString() == CBaseChainParams::TESTNET) {
         // TODO this can be completely removed after some time (when we're pretty sure the conversion has been run on most testnet MNs)
@@ -250,12 +256,11 @@ void CRecoveredSigsDb::WriteRecoveredSig(const llmq::CRecoveredSig& recSig)
     db.WriteBatch(batch);
 
     {
-        int64_t t = GetTimeMillis();
-
         LOCK(cs);
         hasSigForIdCache.insert(std::make_pair((Consensus::LLMQType)recSig.llmqType, recSig.id), true);
         hasSigForSessionCache.insert(signHash, true);
         hasSigForHashCache.insert(recSig.GetHash(), true);
+        writtenSinceCleanup++;
     }
 }
 
@@ -305,10 +310,20 @@ void CRecoveredSigsDb::RemoveRecoveredSig(Consensus::LLMQType llmqType, const ui
 
 void CRecoveredSigsDb::CleanupOldRecoveredSigs(int64_t maxAge)
 {
+    // Only whole buckets are removed, so that we don't touch the DB every few seconds for a handful of entries and
+    // the deletes of a bucket end up in a single contiguous range of "rs_t" keys
+    uint32_t endTime = (uint32_t)(GetAdjustedTime() - maxAge);
+    endTime -= endTime % CLEANUP_BUCKET_TIME;
+    {
+        LOCK(cs);
+        if (endTime <= cleanupEndTime) {
+            return;
+        }
+    }
+
     std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
 
     auto start = std::make_tuple(std::string("rs_t"), (uint32_t)0, (uint8_t)0, uint256());
-    uint32_t endTime = (uint32_t)(GetAdjustedTime() - maxAge);
     pcursor->Seek(start);
 
     std::vector<std::pair<Consensus::LLMQType, uint256>> toDelete;
@@ -331,6 +346,12 @@ void CRecoveredSigsDb::CleanupOldRecoveredSigs(int64_t maxAge)
     }
     pcursor.reset();
 
+    {
+        LOCK(cs);
+        cleanupEndTime = endTime;
+        UpdateCacheSizes();
+    }
+
     if (toDelete.empty()) {
         return;
     }
@@ -357,6 +378,18 @@ void CRecoveredSigsDb::CleanupOldRecoveredSigs(int64_t maxAge)
     LogPrint("llmq", "CRecoveredSigsDb::%d -- deleted %d entries\n", __func__, toDelete.size());
 }
 
+// The caches should be able to hold all recovered sigs of a bucket, as these are the ones most likely to be asked for
+void CRecoveredSigsDb::UpdateCacheSizes()
+{
+    AssertLockHeld(cs);
+
+    size_t cacheSize = std::min(std::max(writtenSinceCleanup, minCacheSize), std::max(MAX_CACHE_SIZE, minCacheSize));
+    hasSigForIdCache.set_max_size(cacheSize);
+    hasSigForSessionCache.set_max_size(cacheSize);
+    hasSigForHashCache.set_max_size(cacheSize);
+    writtenSinceCleanup = 0;
+}
+
 bool CRecoveredSigsDb::HasVotedOnId(Consensus::LLMQType llmqType, const uint256& id)
 {
     auto k = std::make_tuple(std::string("rs_v"), (uint8_t)llmqType, id);
@@ -424,8 +457,9 @@ void CRecoveredSigsDb::CleanupOldVotes(int64_t maxAge)
 
 //////////////////
 
-CSigningManager::CSigningManager(CDBWrapper& llmqDb, bool fMemory) :
-    db(llmqDb)
+CSigningManager::CSigningManager(CDBWrapper& llmqDb, CScheduler* _scheduler, bool fMemory) :
+    db(llmqDb, (size_t)std::max<int64_t>(GetArg("-recsigscachesize", DEFAULT_RECOVERED_SIGS_CACHE_SIZE), 1)),
+    scheduler(_scheduler)
 {
 }
 
@@ -475,8 +509,11 @@ void CSigningManager::ProcessMessageRecoveredSig(CNode* pfrom, const CRecoveredS
 
     LogPrint("llmq", "CSigningManager::%s -- signHash=%s, node=%d\n", __func__, CLLMQUtils::BuildSignHash(recoveredSig).ToString(), pfrom->id);
 
-    LOCK(cs);
-    pendingRecoveredSigs[pfrom->id].emplace_back(recoveredSig);
+    {
+        LOCK(cs);
+        pendingRecoveredSigs[pfrom->id].emplace_back(recoveredSig);
+    }
+    quorumSigSharesManager->WakeupWorkerThread();
 }
 
 bool CSigningManager::PreVerifyRecoveredSig(NodeId nodeId, const CRecoveredSig& recoveredSig, bool& retBan)
@@ -595,7 +632,7 @@ bool CSigningManager::ProcessPendingRecoveredSigs(CConnman& connman)
 
     // It's ok to perform insecure batched verification here as we verify against the quorum public keys, which are not
     // craftable by individual entities, making the rogue public key attack impossible
-    CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, false);
+    CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, false, 0, true);
 
     size_t verifyCount = 0;
     for (auto& p : recSigsByNode) {
@@ -610,7 +647,7 @@ bool CSigningManager::ProcessPendingRecoveredSigs(CConnman& connman)
             }
 
             const auto& quorum = quorums.at(std::make_pair((Consensus::LLMQType)recSig.llmqType, recSig.quorumHash));
-            batchVerifier.PushMessage(nodeId, recSig.GetHash(), CLLMQUtils::BuildSignHash(recSig), recSig.sig.Get(), quorum->qc.quorumPublicKey);
+            batchVerifier.PushMessage(nodeId, recSig.GetHash(), CLLMQUtils::BuildSignHash(recSig), recSig.sig.Get(), quorum->qc.quorumPublicKey.Get());
             verifyCount++;
         }
     }
@@ -619,6 +656,17 @@ bool CSigningManager::ProcessPendingRecoveredSigs(CConnman& connman)
     batchVerifier.Verify();
     verifyTimer.stop();
 
+    // all recovered sigs of a batch are verified at once, so each LLMQ type is accounted with the whole duration
+    std::map<Consensus::LLMQType, size_t> countsByType;
+    for (auto& p : recSigsByNode) {
+        for (auto& recSig : p.second) {
+            countsByType[(Consensus::LLMQType)recSig.llmqType]++;
+        }
+    }
+    for (auto& p : countsByType) {
+        quorumStats.Record(p.first, CLLMQStats::METRIC_RECSIGS_VERIFY, verifyTimer.count<std::chrono::microseconds>(), p.second);
+    }
+
     LogPrint("llmq", "CSigningManager::%s -- verified recovered sig(s). count=%d, vt=%d, nodes=%d\n", __func__, verifyCount, verifyTimer.count(), recSigsByNode.size());
 
     std::unordered_set<uint256, StaticSaltedHasher> processed;
@@ -656,7 +704,7 @@ void CSigningManager::ProcessRecoveredSig(NodeId nodeId, const CRecoveredSig& re
         connman.RemoveAskFor(recoveredSig.GetHash());
     }
 
-    std::vector<CRecoveredSigsListener*> listeners;
+    std::vector<ListenerQueuePtr> listeners;
     {
         LOCK(cs);
         listeners = recoveredSigsListeners;
@@ -691,6 +739,8 @@ void CSigningManager::ProcessRecoveredSig(NodeId nodeId, const CRecoveredSig& re
         db.WriteRecoveredSig(recoveredSig);
     }
 
+    quorumStats.RecoveredSig(llmqType, recoveredSig.id);
+
     CInv inv(MSG_QUORUM_RECOVERED_SIG, recoveredSig.GetHash());
     g_connman->ForEachNode([&](CNode* pnode) {
         if (pnode->nVersion >= LLMQS_PROTO_VERSION && pnode->fSendRecSigs) {
@@ -699,7 +749,50 @@ void CSigningManager::ProcessRecoveredSig(NodeId nodeId, const CRecoveredSig& re
     });
 
     for (auto& l : listeners) {
-        l->HandleNewRecoveredSig(recoveredSig);
+        DispatchRecoveredSig(l, recoveredSig);
+    }
+}
+
+void CSigningManager::DispatchRecoveredSig(const ListenerQueuePtr& listenerQueue, const CRecoveredSig& recoveredSig)
+{
+    {
+        LOCK(listenerQueue->cs);
+        if (listenerQueue->fRemoved) {
+            return;
+        }
+        listenerQueue->queue.emplace_back(recoveredSig);
+        if (listenerQueue->fScheduled) {
+            // the running task picks this one up as well
+            return;
+        }
+        listenerQueue->fScheduled = true;
+    }
+
+    if (!scheduler) {
+        ProcessListenerQueue(listenerQueue);
+        return;
+    }
+    scheduler->scheduleFromNow([listenerQueue]() {
+        ProcessListenerQueue(listenerQueue);
+    }, 0, CScheduler::PRIORITY_HIGH, "recsigs");
+}
+
+void CSigningManager::ProcessListenerQueue(const ListenerQueuePtr& listenerQueue)
+{
+    std::lock_guard<std::mutex> runLock(listenerQueue->runMutex);
+    while (true) {
+        CRecoveredSig recoveredSig;
+        {
+            LOCK(listenerQueue->cs);
+            if (listenerQueue->fRemoved || listenerQueue->queue.empty()) {
+                listenerQueue->queue.clear();
+                listenerQueue->fScheduled = false;
+                return;
+            }
+            recoveredSig = std::move(listenerQueue->queue.front());
+            listenerQueue->queue.pop_front();
+        }
+        listenerQueue->listener->HandleNewRecoveredSig(recoveredSig);
     }
 }
 
@@ -709,6 +802,16 @@ void CSigningManager::PushReconstructedRecoveredSig(const llmq::CRecoveredSig& r
     pendingReconstructedRecoveredSigs.emplace_back(recoveredSig, quorum);
 }
 
+size_t CSigningManager::GetPendingRecoveredSigsCount()
+{
+    LOCK(cs);
+    size_t nCount = pendingReconstructedRecoveredSigs.size();
+    for (auto& p : pendingRecoveredSigs) {
+        nCount += p.second.size();
+    }
+    return nCount;
+}
+
 void CSigningManager::RemoveRecoveredSig(Consensus::LLMQType llmqType, const uint256& id)
 {
     db.RemoveRecoveredSig(llmqType, id);
@@ -732,14 +835,29 @@ void CSigningManager::Cleanup()
 void CSigningManager::RegisterRecoveredSigsListener(CRecoveredSigsListener* l)
 {
     LOCK(cs);
-    recoveredSigsListeners.emplace_back(l);
+    recoveredSigsListeners.emplace_back(std::make_shared<ListenerQueue>(l));
 }
 
 void CSigningManager::UnregisterRecoveredSigsListener(CRecoveredSigsListener* l)
 {
-    LOCK(cs);
-    auto itRem = std::remove(recoveredSigsListeners.begin(), recoveredSigsListeners.end(), l);
-    recoveredSigsListeners.erase(itRem, recoveredSigsListeners.end());
+    std::vector<ListenerQueuePtr> removed;
+    {
+        LOCK(cs);
+        auto itRem = std::stable_partition(recoveredSigsListeners.begin(), recoveredSigsListeners.end(), [&](const ListenerQueuePtr& listenerQueue) {
+            return listenerQueue->listener != l;
+        });
+        removed.assign(itRem, recoveredSigsListeners.end());
+        recoveredSigsListeners.erase(itRem, recoveredSigsListeners.end());
+    }
+
+    for (auto& listenerQueue : removed) {
+        {
+            LOCK(listenerQueue->cs);
+            listenerQueue->fRemoved = true;
+        }
+        // wait for a call which is still running, the listener might be deleted right after this
+        std::lock_guard<std::mutex> runLock(listenerQueue->runMutex);
+    }
 }
 
 bool CSigningManager::AsyncSignIfMember(Consensus::LLMQType llmqType, const uint256& id, const uint256& msgHash)
@@ -795,6 +913,7 @@ bool CSigningManager::AsyncSignIfMember(Consensus::LLMQType llmqType, const uint
         return false;
     }
 
+    quorumStats.SignRequested(llmqType, id);
     quorumSigSharesManager->AsyncSign(quorum, id, msgHash);
 
     return true;
@@ -869,7 +988,11 @@ std::vector<CQuorumCPtr> CSigningManager::GetActiveQuorumSet(Consensus::LLMQType
 
 CQuorumCPtr CSigningManager::SelectQuorumForSigning(Consensus::LLMQType llmqType, int signHeight, const uint256& selectionHash)
 {
-    auto quorums = GetActiveQuorumSet(llmqType, signHeight);
+    return SelectQuorumForSigning(llmqType, GetActiveQuorumSet(llmqType, signHeight), selectionHash);
+}
+
+CQuorumCPtr CSigningManager::SelectQuorumForSigning(Consensus::LLMQType llmqType, const std::vector<CQuorumCPtr>& quorums, const uint256& selectionHash)
+{
     if (quorums.empty()) {
         return nullptr;
     }
@@ -897,7 +1020,7 @@ bool CSigningManager::VerifyRecoveredSig(Consensus::LLMQType llmqType, int signe
     }
 
     uint256 signHash = CLLMQUtils::BuildSignHash(llmqParams.type, quorum->qc.quorumHash, id, msgHash);
-    return sig.VerifyInsecure(quorum->qc.quorumPublicKey, signHash);
+    return VerifyBLSSigCached(sig, quorum->qc.quorumPublicKey.Get(), signHash);
 }
 
 }
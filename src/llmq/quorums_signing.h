@@ -13,8 +13,13 @@
 #include "univalue.h"
 #include "unordered_lru_cache.h"
 
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 
+class CScheduler;
+
 namespace llmq
 {
 
@@ -61,18 +66,31 @@ public:
     UniValue ToJson() const;
 };
 
+// minimum size of the hasSigFor* caches, they grow when more recovered sigs are seen in a cleanup bucket
+static const size_t DEFAULT_RECOVERED_SIGS_CACHE_SIZE = 30000;
+
 class CRecoveredSigsDb
 {
 private:
+    // old recovered sigs are removed one bucket of this many seconds at a time
+    static const uint32_t CLEANUP_BUCKET_TIME = 60 * 60;
+    static const size_t MAX_CACHE_SIZE = DEFAULT_RECOVERED_SIGS_CACHE_SIZE * 10;
+
     CDBWrapper& db;
 
     CCriticalSection cs;
-    unordered_lru_cache<std::pair<Consensus::LLMQType, uint256>, bool, StaticSaltedHasher, 30000> hasSigForIdCache;
-    unordered_lru_cache<uint256, bool, StaticSaltedHasher, 30000> hasSigForSessionCache;
-    unordered_lru_cache<uint256, bool, StaticSaltedHasher, 30000> hasSigForHashCache;
+    size_t minCacheSize;
+    unordered_lru_cache<std::pair<Consensus::LLMQType, uint256>, bool, StaticSaltedHasher> hasSigForIdCache;
+    unordered_lru_cache<uint256, bool, StaticSaltedHasher> hasSigForSessionCache;
+    unordered_lru_cache<uint256, bool, StaticSaltedHasher> hasSigForHashCache;
+
+    // number of recovered sigs written since the last bucket was removed
+    size_t writtenSinceCleanup{0};
+    // all "rs_t" entries below this time have been removed
+    uint32_t cleanupEndTime{0};
 
 public:
-    CRecoveredSigsDb(CDBWrapper& _db);
+    CRecoveredSigsDb(CDBWrapper& _db, size_t _minCacheSize = DEFAULT_RECOVERED_SIGS_CACHE_SIZE);
 
     void ConvertInvalidTimeKeys();
     void AddVoteTimeKeys();
@@ -98,6 +116,7 @@ public:
 private:
     bool ReadRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, CRecoveredSig& ret);
     void RemoveRecoveredSig(CDBBatch& batch, Consensus::LLMQType llmqType, const uint256& id, bool deleteTimeKey);
+    void UpdateCacheSizes();
 };
 
 class CRecoveredSigsListener
@@ -132,10 +151,29 @@ private:
 
     int64_t lastCleanupTime{0};
 
-    std::vector<CRecoveredSigsListener*> recoveredSigsListeners;
+    // Every listener gets the recovered sigs through its own queue, which is drained by at most one scheduler task at
+    // a time. This keeps the order per listener while slow listeners don't hold up the recovery of further sigs.
+    struct ListenerQueue {
+        CRecoveredSigsListener* listener;
+
+        CCriticalSection cs;
+        std::deque<CRecoveredSig> queue;
+        bool fScheduled{false};
+        bool fRemoved{false};
+
+        // held while the listener is called, so that unregistering can wait for a running call
+        std::mutex runMutex;
+
+        explicit ListenerQueue(CRecoveredSigsListener* _listener) : listener(_listener) {}
+    };
+    typedef std::shared_ptr<ListenerQueue> ListenerQueuePtr;
+
+    // listeners are called synchronously without a scheduler, e.g. in unit tests
+    CScheduler* scheduler;
+    std::vector<ListenerQueuePtr> recoveredSigsListeners;
 
 public:
-    CSigningManager(CDBWrapper& llmqDb, bool fMemory);
+    CSigningManager(CDBWrapper& llmqDb, CScheduler* _scheduler, bool fMemory);
 
     bool AlreadyHave(const CInv& inv);
     bool GetRecoveredSigForGetData(const uint256& hash, CRecoveredSig& ret);
@@ -150,6 +188,9 @@ public:
     // mechanism prevents possible conflicts. As an example, ChainLocks prevent conflicts in confirmed TXs InstantSend votes
     void RemoveRecoveredSig(Consensus::LLMQType llmqType, const uint256& id);
 
+    // number of incoming recovered sigs which wait for verification
+    size_t GetPendingRecoveredSigsCount();
+
 private:
     void ProcessMessageRecoveredSig(CNode* pfrom, const CRecoveredSig& recoveredSig, CConnman& connman);
     bool PreVerifyRecoveredSig(NodeId nodeId, const CRecoveredSig& recoveredSig, bool& retBan);
@@ -162,6 +203,9 @@ private:
     void ProcessRecoveredSig(NodeId nodeId, const CRecoveredSig& recoveredSig, const CQuorumCPtr& quorum, CConnman& connman);
     void Cleanup(); // called from the worker thread of CSigSharesManager
 
+    void DispatchRecoveredSig(const ListenerQueuePtr& listenerQueue, const CRecoveredSig& recoveredSig);
+    static void ProcessListenerQueue(const ListenerQueuePtr& listenerQueue);
+
 public:
     // public interface
     void RegisterRecoveredSigsListener(CRecoveredSigsListener* l);
@@ -179,6 +223,8 @@ public:
 
     std::vector<CQuorumCPtr> GetActiveQuorumSet(Consensus::LLMQType llmqType, int signHeight);
     CQuorumCPtr SelectQuorumForSigning(Consensus::LLMQType llmqType, int signHeight, const uint256& selectionHash);
+    // same as above, but selects from an already retrieved active quorum set
+    static CQuorumCPtr SelectQuorumForSigning(Consensus::LLMQType llmqType, const std::vector<CQuorumCPtr>& quorums, const uint256& selectionHash);
 
     // Verifies a recovered sig that was signed while the chain tip was at signedAtTip
     bool VerifyRecoveredSig(Consensus::LLMQType llmqType, int signedAtHeight, const uint256& id, const uint256& msgHash, const CBLSSignature& sig);
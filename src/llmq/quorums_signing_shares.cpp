@@ -4,6 +4,7 @@
 
 #include "quorums_signing.h"
 #include "quorums_signing_shares.h"
+#include "quorums_stats.h"
 #include "quorums_utils.h"
 
 #include "activemasternode.h"
@@ -11,7 +12,9 @@
 #include "init.h"
 #include "net_processing.h"
 #include "netmessagemaker.h"
+#include "trace.h"
 #include "validation.h"
+#include "workerpool.h"
 
 #include "cxxtimer.hpp"
 
@@ -178,6 +181,7 @@ void CSigSharesNodeState::RemoveSession(const uint256& signHash)
 CSigSharesManager::CSigSharesManager()
 {
     workInterrupt.reset();
+    nFanOut = (size_t)std::max<int64_t>(0, GetArg("-llmqsigsharefanout", DEFAULT_SIGSHARES_FANOUT));
 }
 
 CSigSharesManager::~CSigSharesManager()
@@ -221,6 +225,27 @@ void CSigSharesManager::UnregisterAsRecoveredSigsListener()
 void CSigSharesManager::InterruptWorkerThread()
 {
     workInterrupt();
+    WakeupWorkerThread();
+}
+
+void CSigSharesManager::WakeupWorkerThread()
+{
+    {
+        std::lock_guard<std::mutex> l(workMutex);
+        fWorkPending = true;
+    }
+    workCond.notify_one();
+}
+
+// Returns false when the thread got interrupted
+bool CSigSharesManager::WaitForWork(int64_t nTimeout)
+{
+    std::unique_lock<std::mutex> l(workMutex);
+    workCond.wait_for(l, std::chrono::milliseconds(nTimeout), [this] {
+        return fWorkPending || (bool)workInterrupt;
+    });
+    fWorkPending = false;
+    return !workInterrupt;
 }
 
 void CSigSharesManager::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)
@@ -290,7 +315,11 @@ void CSigSharesManager::ProcessMessage(CNode* pfrom, const std::string& strComma
                 return;
             }
         }
+    } else {
+        return;
     }
+
+    WakeupWorkerThread();
 }
 
 bool CSigSharesManager::ProcessMessageSigSesAnn(CNode* pfrom, const CSigSesAnn& ann, CConnman& connman)
@@ -573,9 +602,8 @@ bool CSigSharesManager::ProcessPendingSigShares(CConnman& connman)
         return false;
     }
 
-    // It's ok to perform insecure batched verification here as we verify against the quorum public key shares,
-    // which are not craftable by individual entities, making the rogue public key attack impossible
-    CBLSBatchVerifier<NodeId, SigShareKey> batchVerifier(false, true);
+    // <nodeId, sigShare, pubKeyShare> per session
+    std::unordered_map<uint256, std::vector<std::tuple<NodeId, const CSigShare*, CBLSPublicKey>>, StaticSaltedHasher> sigSharesBySession;
 
     size_t verifyCount = 0;
     for (auto& p : sigSharesByNodes) {
@@ -605,22 +633,72 @@ bool CSigSharesManager::ProcessPendingSigShares(CConnman& connman)
                 assert(false);
             }
 
-            batchVerifier.PushMessage(nodeId, sigShare.GetKey(), sigShare.GetSignHash(), sigShare.sigShare.Get(), pubKeyShare);
+            sigSharesBySession[sigShare.GetSignHash()].emplace_back(nodeId, &sigShare, pubKeyShare);
             verifyCount++;
         }
     }
 
+    // Split the shares into one batch per verification thread. All shares of a session go into the same batch, so that
+    // identical shares received from multiple nodes are handled the same way as when everything is verified at once.
+    // It's ok to perform insecure batched verification here as we verify against the quorum public key shares,
+    // which are not craftable by individual entities, making the rogue public key attack impossible
+    typedef CBLSBatchVerifier<NodeId, SigShareKey> SigShareBatchVerifier;
+    // the worker thread verifies one of the batches itself, the others run on the shared pool
+    size_t batchCount = std::min(sigSharesBySession.size(), (size_t)g_workerPool.Size() + 1);
+    std::vector<SigShareBatchVerifier> batchVerifiers;
+    std::vector<size_t> batchSizes(batchCount, 0);
+    batchVerifiers.reserve(batchCount);
+    for (size_t i = 0; i < batchCount; i++) {
+        batchVerifiers.emplace_back(false, true);
+    }
+    for (auto& p : sigSharesBySession) {
+        size_t idx = std::min_element(batchSizes.begin(), batchSizes.end()) - batchSizes.begin();
+        for (auto& t : p.second) {
+            auto& sigShare = *std::get<1>(t);
+            batchVerifiers[idx].PushMessage(std::get<0>(t), sigShare.GetKey(), sigShare.GetSignHash(), sigShare.sigShare.Get(), std::get<2>(t));
+        }
+        batchSizes[idx] += p.second.size();
+    }
+
     cxxtimer::Timer verifyTimer(true);
-    batchVerifier.Verify();
+    std::vector<std::future<void>> futures;
+    futures.reserve(batchCount);
+    for (size_t i = 1; i < batchCount; i++) {
+        auto& batchVerifier = batchVerifiers[i];
+        futures.emplace_back(g_workerPool.Push([&batchVerifier](int threadId) {
+            batchVerifier.Verify();
+        }, CWorkerPool::PRIORITY_HIGH));
+    }
+    if (batchCount != 0) {
+        batchVerifiers[0].Verify();
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
     verifyTimer.stop();
 
-    LogPrint("llmq-sigs", "CSigSharesManager::%s -- verified sig shares. count=%d, vt=%d, nodes=%d\n", __func__, verifyCount, verifyTimer.count(), sigSharesByNodes.size());
+    // the batches run in parallel, so each LLMQ type is accounted with the duration of the whole verification
+    std::map<Consensus::LLMQType, size_t> countsByType;
+    for (auto& p : sigSharesBySession) {
+        countsByType[(Consensus::LLMQType)std::get<1>(p.second.front())->llmqType] += p.second.size();
+    }
+    for (auto& p : countsByType) {
+        quorumStats.Record(p.first, CLLMQStats::METRIC_SIGSHARES_VERIFY, verifyTimer.count<std::chrono::microseconds>(), p.second);
+    }
+
+    std::set<NodeId> badSources;
+    for (auto& batchVerifier : batchVerifiers) {
+        badSources.insert(batchVerifier.badSources.begin(), batchVerifier.badSources.end());
+    }
+
+    LogPrint("llmq-sigs", "CSigSharesManager::%s -- verified sig shares. count=%d, vt=%d, nodes=%d, batches=%d\n", __func__, verifyCount, verifyTimer.count(), sigSharesByNodes.size(), batchCount);
+    TRACE5(llmq, verify_sigshares, verifyCount, sigSharesByNodes.size(), batchCount, badSources.size(), verifyTimer.count<std::chrono::microseconds>());
 
     for (auto& p : sigSharesByNodes) {
         auto nodeId = p.first;
         auto& v = p.second;
 
-        if (batchVerifier.badSources.count(nodeId)) {
+        if (badSources.count(nodeId)) {
             LogPrintf("CSigSharesManager::%s -- invalid sig shares from other node, banning peer=%d\n",
                      __func__, nodeId);
             // this will also cause re-requesting of the shares that were sent by this node
@@ -756,6 +834,7 @@ void CSigSharesManager::TryRecoverSig(const CQuorumCPtr& quorum, const uint256&
 
     LogPrint("llmq-sigs", "CSigSharesManager::%s -- recovered signature. id=%s, msgHash=%s, time=%d\n", __func__,
               id.ToString(), msgHash.ToString(), t.count());
+    quorumStats.Record(quorum->params.type, CLLMQStats::METRIC_SIG_RECOVERY, t.count<std::chrono::microseconds>(), sigSharesForRecovery.size());
 
     CRecoveredSig rs;
     rs.llmqType = quorum->params.type;
@@ -770,7 +849,7 @@ void CSigSharesManager::TryRecoverSig(const CQuorumCPtr& quorum, const uint256&
     // verification because this is unbatched and thus slow verification that happens here.
     if (((recoveredSigsCounter++) % 100) == 0) {
         auto signHash = CLLMQUtils::BuildSignHash(rs);
-        bool valid = recoveredSig.VerifyInsecure(quorum->qc.quorumPublicKey, signHash);
+        bool valid = recoveredSig.VerifyInsecure(quorum->qc.quorumPublicKey.Get(), signHash);
         if (!valid) {
             // this should really not happen as we have verified all signature shares before
             LogPrintf("CSigSharesManager::%s -- own recovered signature is invalid. id=%s, msgHash=%s\n", __func__,
@@ -935,6 +1014,10 @@ void CSigSharesManager::CollectSigSharesToAnnounce(std::unordered_map<NodeId, st
     AssertLockHeld(cs);
 
     std::unordered_map<std::pair<Consensus::LLMQType, uint256>, std::unordered_set<NodeId>, StaticSaltedHasher> quorumNodesMap;
+    // proTxHashes of the quorum nodes, null for watchers which always get everything
+    std::unordered_map<NodeId, uint256> nodeProTxHashes;
+    std::vector<std::pair<uint64_t, NodeId>> scores;
+    std::unordered_set<NodeId> fanOutNodes;
 
     this->sigSharesToAnnounce.ForEach([&](const SigShareKey& sigShareKey, bool) {
         auto& signHash = sigShareKey.first;
@@ -950,11 +1033,50 @@ void CSigSharesManager::CollectSigSharesToAnnounce(std::unordered_map<NodeId, st
         if (it == quorumNodesMap.end()) {
             auto nodeIds = g_connman->GetMasternodeQuorumNodes(quorumKey.first, quorumKey.second);
             it = quorumNodesMap.emplace(std::piecewise_construct, std::forward_as_tuple(quorumKey), std::forward_as_tuple(nodeIds.begin(), nodeIds.end())).first;
+            if (nFanOut != 0) {
+                for (NodeId nodeId : nodeIds) {
+                    g_connman->ForNode(nodeId, [&](CNode* pnode) {
+                        LOCK(pnode->cs_mnauth);
+                        nodeProTxHashes[nodeId] = pnode->qwatch ? uint256() : pnode->verifiedProRegTxHash;
+                        return true;
+                    });
+                }
+            }
         }
 
         auto& quorumNodes = it->second;
 
+        // Gossip the share to a subset of the quorum connections only. The subset is derived from the share, our
+        // proTxHash and the peer's, so every member forwards it to different peers and it still reaches all of them
+        // after a few hops. The recovered sig is relayed to everyone anyway.
+        bool fFanOut = nFanOut != 0 && quorumNodes.size() > nFanOut;
+        if (fFanOut) {
+            scores.clear();
+            fanOutNodes.clear();
+            for (NodeId nodeId : quorumNodes) {
+                const uint256& proTxHash = nodeProTxHashes[nodeId];
+                if (proTxHash.IsNull()) {
+                    fanOutNodes.emplace(nodeId);
+                    continue;
+                }
+                uint64_t nScore = CSipHasher(signHash.GetUint64(0), signHash.GetUint64(1))
+                        .Write(quorumMember)
+                        .Write(activeMasternodeInfo.proTxHash.begin(), activeMasternodeInfo.proTxHash.size())
+                        .Write(proTxHash.begin(), proTxHash.size())
+                        .Finalize();
+                scores.emplace_back(nScore, nodeId);
+            }
+            size_t nSelect = std::min(nFanOut, scores.size());
+            std::partial_sort(scores.begin(), scores.begin() + nSelect, scores.end());
+            for (size_t i = 0; i < nSelect; i++) {
+                fanOutNodes.emplace(scores[i].second);
+            }
+        }
+
         for (auto& nodeId : quorumNodes) {
+            if (fFanOut && !fanOutNodes.count(nodeId)) {
+                continue;
+            }
             auto& nodeState = nodeStates[nodeId];
 
             if (nodeState.banned) {
@@ -1340,6 +1462,7 @@ void CSigSharesManager::BanNode(NodeId nodeId)
 void CSigSharesManager::WorkThreadMain()
 {
     int64_t lastSendTime = 0;
+    bool fSendPending = false;
 
     while (!workInterrupt) {
         if (!quorumSigningManager || !g_connman) {
@@ -1356,27 +1479,39 @@ void CSigSharesManager::WorkThreadMain()
         didWork |= ProcessPendingSigShares(*g_connman);
         didWork |= SignPendingSigShares();
 
-        if (GetTimeMillis() - lastSendTime > 100) {
+        fSendPending |= didWork;
+
+        // new work is answered after a short delay to batch up bursts, the rest is handled periodically
+        int64_t nSendDelay = fSendPending ? SEND_COALESCE_TIME : SEND_INTERVAL;
+        int64_t nSinceLastSend = GetTimeMillis() - lastSendTime;
+        if (nSinceLastSend >= nSendDelay) {
             SendMessages();
             lastSendTime = GetTimeMillis();
+            fSendPending = false;
+            nSinceLastSend = 0;
+            nSendDelay = SEND_INTERVAL;
         }
 
         Cleanup();
         quorumSigningManager->Cleanup();
 
-        // TODO Wakeup when pending signing is needed?
         if (!didWork) {
-            if (!workInterrupt.sleep_for(std::chrono::milliseconds(100))) {
+            if (!WaitForWork(std::max<int64_t>(nSendDelay - nSinceLastSend, 1))) {
                 return;
             }
+            // whatever woke us up will most likely result in messages to send
+            fSendPending = true;
         }
     }
 }
 
 void CSigSharesManager::AsyncSign(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash)
 {
-    LOCK(cs);
-    pendingSigns.emplace_back(quorum, id, msgHash);
+    {
+        LOCK(cs);
+        pendingSigns.emplace_back(quorum, id, msgHash);
+    }
+    WakeupWorkerThread();
 }
 
 bool CSigSharesManager::SignPendingSigShares()
@@ -1442,4 +1577,14 @@ void CSigSharesManager::HandleNewRecoveredSig(const llmq::CRecoveredSig& recover
     RemoveSigSharesForSession(CLLMQUtils::BuildSignHash(recoveredSig));
 }
 
+void CSigSharesManager::GetPendingCounts(size_t& retSigShares, size_t& retSigns)
+{
+    LOCK(cs);
+    retSigShares = 0;
+    for (auto& p : nodeStates) {
+        retSigShares += p.second.pendingIncomingSigShares.Size();
+    }
+    retSigns = pendingSigns.size();
+}
+
 }
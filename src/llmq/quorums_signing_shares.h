@@ -17,6 +17,7 @@
 
 #include "llmq/quorums.h"
 
+#include <condition_variable>
 #include <thread>
 #include <mutex>
 #include <unordered_map>
@@ -27,6 +28,9 @@ class CScheduler;
 
 namespace llmq
 {
+// 0 announces every sig share to all intra-quorum connections
+static const unsigned int DEFAULT_SIGSHARES_FANOUT = 0;
+
 // <signHash, quorumMember>
 typedef std::pair<uint256, uint16_t> SigShareKey;
 
@@ -333,6 +337,11 @@ class CSigSharesManager : public CRecoveredSigsListener
     static const int64_t SESSION_TOTAL_TIMEOUT = 5 * 60 * 1000;
     static const int64_t SIG_SHARE_REQUEST_TIMEOUT = 5 * 1000;
 
+    // messages caused by new work are sent after this delay, so that work arriving in bursts is batched
+    static const int64_t SEND_COALESCE_TIME = 10;
+    // everything else (re-requests, re-announcements, timeouts) is handled in this interval
+    static const int64_t SEND_INTERVAL = 100;
+
     // we try to keep total message size below 10k
     const size_t MAX_MSGS_CNT_QSIGSESANN = 100;
     const size_t MAX_MSGS_CNT_QGETSIGSHARES = 200;
@@ -346,6 +355,11 @@ private:
     std::thread workThread;
     CThreadInterrupt workInterrupt;
 
+    // signals the worker thread that new sig shares, announcements or sign requests are pending
+    std::mutex workMutex;
+    std::condition_variable workCond;
+    bool fWorkPending{false};
+
     SigShareMap<CSigShare> sigShares;
 
     // stores time of first and last receivedSigShare. Used to detect timeouts
@@ -363,6 +377,9 @@ private:
     int64_t lastCleanupTime{0};
     std::atomic<uint32_t> recoveredSigsCounter{0};
 
+    // -llmqsigsharefanout, the number of quorum connections every sig share is announced to
+    size_t nFanOut;
+
 public:
     CSigSharesManager();
     ~CSigSharesManager();
@@ -372,6 +389,7 @@ public:
     void RegisterAsRecoveredSigsListener();
     void UnregisterAsRecoveredSigsListener();
     void InterruptWorkerThread();
+    void WakeupWorkerThread();
 
 public:
     void ProcessMessage(CNode* pnode, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
@@ -381,6 +399,9 @@ public:
 
     void HandleNewRecoveredSig(const CRecoveredSig& recoveredSig);
 
+    // number of incoming sig shares which wait for verification and of our own shares which wait to be signed
+    void GetPendingCounts(size_t& retSigShares, size_t& retSigns);
+
 private:
     // all of these return false when the currently processed message should be aborted (as each message actually contains multiple messages)
     bool ProcessMessageSigSesAnn(CNode* pfrom, const CSigSesAnn& ann, CConnman& connman);
@@ -414,6 +435,8 @@ private:
 
     void BanNode(NodeId nodeId);
 
+    bool WaitForWork(int64_t nTimeout);
+
     bool SendMessages();
     void CollectSigSharesToRequest(std::unordered_map<NodeId, std::unordered_map<uint256, CSigSharesInv, StaticSaltedHasher>>& sigSharesToRequest);
     void CollectSigSharesToSend(std::unordered_map<NodeId, std::unordered_map<uint256, CBatchedSigShares, StaticSaltedHasher>>& sigSharesToSend);
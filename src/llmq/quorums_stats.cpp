@@ -0,0 +1,74 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "quorums_stats.h"
+
+#include "utiltime.h"
+
+#include <algorithm>
+
+namespace llmq
+{
+
+CLLMQStats quorumStats;
+
+const char* const CLLMQStats::metricNames[CLLMQStats::METRIC_COUNT] = {
+    "signtorecsig",
+    "sigsharesverify",
+    "sigrecovery",
+    "recsigsverify",
+    "islocksverify",
+};
+
+// 1ms, 10ms, 100ms, 1s and 10s
+const int64_t CLLMQStats::histogramBounds[CLLMQStats::HISTOGRAM_BUCKETS - 1] = {1000, 10000, 100000, 1000000, 10000000};
+
+static int HistogramBucket(int64_t nMicros)
+{
+    int i = 0;
+    while (i < CLLMQStats::HISTOGRAM_BUCKETS - 1 && nMicros >= CLLMQStats::histogramBounds[i]) {
+        i++;
+    }
+    return i;
+}
+
+void CLLMQStats::Record(Consensus::LLMQType llmqType, Metric metric, int64_t nMicros, size_t nItems)
+{
+    LOCK(cs);
+    Stats& stats = mapStats[llmqType][metric];
+    stats.nCount++;
+    stats.nTotalMicros += nMicros;
+    stats.nMaxMicros = std::max(stats.nMaxMicros, nMicros);
+    stats.nTotalItems += nItems;
+    stats.nMaxItems = std::max(stats.nMaxItems, (uint64_t)nItems);
+    stats.vHistogram[HistogramBucket(nMicros)]++;
+}
+
+void CLLMQStats::SignRequested(Consensus::LLMQType llmqType, const uint256& id)
+{
+    LOCK(cs);
+    signStartTimes.insert(std::make_pair(llmqType, id), GetTimeMicros());
+}
+
+void CLLMQStats::RecoveredSig(Consensus::LLMQType llmqType, const uint256& id)
+{
+    auto key = std::make_pair(llmqType, id);
+    int64_t nStartTime;
+    {
+        LOCK(cs);
+        if (!signStartTimes.get(key, nStartTime)) {
+            return;
+        }
+        signStartTimes.erase(key);
+    }
+    Record(llmqType, METRIC_SIGN_TO_RECSIG, GetTimeMicros() - nStartTime);
+}
+
+CLLMQStats::StatsMap CLLMQStats::GetStats() const
+{
+    LOCK(cs);
+    return mapStats;
+}
+
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef HTA_QUORUMS_STATS_H
+#define HTA_QUORUMS_STATS_H
+
+#include "consensus/params.h"
+#include "saltedhasher.h"
+#include "sync.h"
+#include "uint256.h"
+#include "unordered_lru_cache.h"
+
+#include <array>
+#include <map>
+
+namespace llmq
+{
+
+/**
+ * Latency statistics of the signing pipeline, per LLMQ type. Only meant for
+ * monitoring, see the "quorum stats" RPC.
+ */
+class CLLMQStats
+{
+public:
+    enum Metric {
+        /** From our own sign request (AsyncSignIfMember) to the recovered sig */
+        METRIC_SIGN_TO_RECSIG = 0,
+        /** Batched verification of incoming sig shares */
+        METRIC_SIGSHARES_VERIFY = 1,
+        /** Recovery of the final signature out of the sig shares */
+        METRIC_SIG_RECOVERY = 2,
+        /** Batched verification of incoming recovered sigs */
+        METRIC_RECSIGS_VERIFY = 3,
+        /** Batched verification of incoming ISLOCKs */
+        METRIC_ISLOCKS_VERIFY = 4,
+    };
+    static const int METRIC_COUNT = 5;
+    static const char* const metricNames[METRIC_COUNT];
+
+    // Upper bounds of the histogram buckets in microseconds, the last bucket has no bound
+    static const int HISTOGRAM_BUCKETS = 6;
+    static const int64_t histogramBounds[HISTOGRAM_BUCKETS - 1];
+
+    struct Stats {
+        uint64_t nCount{0};
+        int64_t nTotalMicros{0};
+        int64_t nMaxMicros{0};
+        // number of items (e.g. sig shares) handled, for the batch metrics
+        uint64_t nTotalItems{0};
+        uint64_t nMaxItems{0};
+        uint64_t vHistogram[HISTOGRAM_BUCKETS]{};
+    };
+    typedef std::map<Consensus::LLMQType, std::array<Stats, METRIC_COUNT>> StatsMap;
+
+private:
+    mutable CCriticalSection cs;
+    StatsMap mapStats;
+    // start times of our own sign requests, requests which never recover drop out of the cache
+    unordered_lru_cache<std::pair<Consensus::LLMQType, uint256>, int64_t, StaticSaltedHasher, 10000> signStartTimes;
+
+public:
+    void Record(Consensus::LLMQType llmqType, Metric metric, int64_t nMicros, size_t nItems = 1);
+
+    void SignRequested(Consensus::LLMQType llmqType, const uint256& id);
+    void RecoveredSig(Consensus::LLMQType llmqType, const uint256& id);
+
+    StatsMap GetStats() const;
+};
+
+extern CLLMQStats quorumStats;
+
+}
+
+#endif //HTA_QUORUMS_STATS_H
@@ -7,17 +7,57 @@
 
 #include "chainparams.h"
 #include "random.h"
+#include "unordered_lru_cache.h"
 #include "validation.h"
 
 namespace llmq
 {
 
+// membership only depends on the quorum block, so entries never become stale
+static CCriticalSection cs_quorumMembersCache;
+static unordered_lru_cache<std::pair<Consensus::LLMQType, uint256>, CQuorumMembersCPtr, StaticSaltedHasher, 64> quorumMembersCache;
+
+int CQuorumMembers::GetMemberIndex(const uint256& proTxHash) const
+{
+    auto it = memberIndexes.find(proTxHash);
+    if (it == memberIndexes.end()) {
+        return -1;
+    }
+    return (int)it->second;
+}
+
 std::vector<CDeterministicMNCPtr> CLLMQUtils::GetAllQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum)
 {
+    return GetQuorumMembers(llmqType, pindexQuorum)->members;
+}
+
+CQuorumMembersCPtr CLLMQUtils::GetQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum)
+{
+    auto cacheKey = std::make_pair(llmqType, pindexQuorum->GetBlockHash());
+    CQuorumMembersCPtr result;
+    {
+        LOCK(cs_quorumMembersCache);
+        if (quorumMembersCache.get(cacheKey, result)) {
+            return result;
+        }
+    }
+
+    // calculate outside of the lock, this needs the MN list and scores every valid masternode
     auto& params = Params().GetConsensus().llmqs.at(llmqType);
     auto allMns = deterministicMNManager->GetListForBlock(pindexQuorum);
     auto modifier = ::SerializeHash(std::make_pair((uint8_t) llmqType, pindexQuorum->GetBlockHash()));
-    return allMns.CalculateQuorum(params.size, modifier);
+
+    auto quorumMembers = std::make_shared<CQuorumMembers>();
+    quorumMembers->members = allMns.CalculateQuorum(params.size, modifier);
+    quorumMembers->memberIndexes.reserve(quorumMembers->members.size());
+    for (size_t i = 0; i < quorumMembers->members.size(); i++) {
+        quorumMembers->memberIndexes.emplace(quorumMembers->members[i]->proTxHash, i);
+    }
+    result = quorumMembers;
+
+    LOCK(cs_quorumMembersCache);
+    quorumMembersCache.insert(cacheKey, result);
+    return result;
 }
 
 uint256 CLLMQUtils::BuildCommitmentHash(uint8_t llmqType, const uint256& blockHash, const std::vector<bool>& validMembers, const CBLSPublicKey& pubKey, const uint256& vvecHash)
@@ -45,30 +85,31 @@ std::set<uint256> CLLMQUtils::GetQuorumConnections(Consensus::LLMQType llmqType,
 {
     auto& params = Params().GetConsensus().llmqs.at(llmqType);
 
-    auto mns = GetAllQuorumMembers(llmqType, pindexQuorum);
+    auto quorumMembers = GetQuorumMembers(llmqType, pindexQuorum);
+    auto& mns = quorumMembers->members;
     std::set<uint256> result;
-    for (size_t i = 0; i < mns.size(); i++) {
-        auto& dmn = mns[i];
-        if (dmn->proTxHash == forMember) {
-            // Connect to nodes at indexes (i+2^k)%n, where
-            //   k: 0..max(1, floor(log2(n-1))-1)
-            //   n: size of the quorum/ring
-            int gap = 1;
-            int gap_max = (int)mns.size() - 1;
-            int k = 0;
-            while ((gap_max >>= 1) || k <= 1) {
-                size_t idx = (i + gap) % mns.size();
-                auto& otherDmn = mns[idx];
-                if (otherDmn == dmn) {
-                    continue;
-                }
-                result.emplace(otherDmn->proTxHash);
-                gap <<= 1;
-                k++;
-            }
-            // there can be no two members with the same proTxHash, so return early
-            break;
+    int memberIdx = quorumMembers->GetMemberIndex(forMember);
+    if (memberIdx == -1) {
+        return result;
+    }
+
+    size_t i = (size_t)memberIdx;
+    auto& dmn = mns[i];
+    // Connect to nodes at indexes (i+2^k)%n, where
+    //   k: 0..max(1, floor(log2(n-1))-1)
+    //   n: size of the quorum/ring
+    int gap = 1;
+    int gap_max = (int)mns.size() - 1;
+    int k = 0;
+    while ((gap_max >>= 1) || k <= 1) {
+        size_t idx = (i + gap) % mns.size();
+        auto& otherDmn = mns[idx];
+        if (otherDmn == dmn) {
+            continue;
         }
+        result.emplace(otherDmn->proTxHash);
+        gap <<= 1;
+        k++;
     }
     return result;
 }
@@ -7,19 +7,34 @@
 
 #include "consensus/params.h"
 #include "net.h"
+#include "saltedhasher.h"
 
 #include "evo/deterministicmns.h"
 
+#include <unordered_map>
 #include <vector>
 
 namespace llmq
 {
 
+// Members of a quorum in quorum order, together with their indexes by proTxHash
+struct CQuorumMembers
+{
+    std::vector<CDeterministicMNCPtr> members;
+    std::unordered_map<uint256, size_t, StaticSaltedHasher> memberIndexes;
+
+    // -1 if proTxHash is not a member
+    int GetMemberIndex(const uint256& proTxHash) const;
+};
+typedef std::shared_ptr<const CQuorumMembers> CQuorumMembersCPtr;
+
 class CLLMQUtils
 {
 public:
     // includes members which failed DKG
     static std::vector<CDeterministicMNCPtr> GetAllQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum);
+    // same as above, calculated once per quorum and then served from a cache
+    static CQuorumMembersCPtr GetQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum);
 
     static uint256 BuildCommitmentHash(uint8_t llmqType, const uint256& blockHash, const std::vector<bool>& validMembers, const CBLSPublicKey& pubKey, const uint256& vvecHash);
     static uint256 BuildSignHash(Consensus::LLMQType llmqType, const uint256& quorumHash, const uint256& id, const uint256& msgHash);
@@ -0,0 +1,154 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "lzcompress.h"
+
+#include "crypto/common.h"
+
+#include <algorithm>
+
+// Block format constants, kept as in LZ4 so other decoders accept the output
+static const size_t LZ_MIN_MATCH = 4;
+// no match may start in the last 12 bytes and the last 5 bytes are always literals
+static const size_t LZ_MATCH_START_LIMIT = 12;
+static const size_t LZ_LAST_LITERALS = 5;
+static const size_t LZ_MAX_OFFSET = 65535;
+static const int LZ_HASH_BITS = 12;
+
+static void WriteLength(std::vector<unsigned char>& vchOut, size_t nLength)
+{
+    for (; nLength >= 255; nLength -= 255) {
+        vchOut.push_back(255);
+    }
+    vchOut.push_back((unsigned char)nLength);
+}
+
+static void WriteSequence(std::vector<unsigned char>& vchOut, const unsigned char* pLiterals, size_t nLiterals, size_t nOffset, size_t nMatch)
+{
+    size_t nMatchCode = nMatch ? nMatch - LZ_MIN_MATCH : 0;
+    vchOut.push_back((unsigned char)((std::min<size_t>(nLiterals, 15) << 4) | std::min<size_t>(nMatchCode, 15)));
+    if (nLiterals >= 15) {
+        WriteLength(vchOut, nLiterals - 15);
+    }
+    vchOut.insert(vchOut.end(), pLiterals, pLiterals + nLiterals);
+    if (!nMatch) {
+        // the last sequence has no match
+        return;
+    }
+    vchOut.push_back((unsigned char)(nOffset & 0xff));
+    vchOut.push_back((unsigned char)(nOffset >> 8));
+    if (nMatchCode >= 15) {
+        WriteLength(vchOut, nMatchCode - 15);
+    }
+}
+
+// Read an extended length, false if it runs past the input or beyond nMax
+static bool ReadLength(const std::vector<unsigned char>& vchIn, size_t& nPos, size_t& nLength, size_t nMax)
+{
+    unsigned char b;
+    do {
+        if (nPos >= vchIn.size()) {
+            return false;
+        }
+        b = vchIn[nPos++];
+        nLength += b;
+        if (nLength > nMax) {
+            return false;
+        }
+    } while (b == 255);
+    return true;
+}
+
+void LZCompress(const std::vector<unsigned char>& vchIn, std::vector<unsigned char>& vchOut)
+{
+    vchOut.clear();
+    vchOut.reserve(vchIn.size() / 2 + 16);
+
+    const unsigned char* pIn = vchIn.data();
+    size_t nSize = vchIn.size();
+    size_t nAnchor = 0;
+
+    if (nSize > LZ_MATCH_START_LIMIT) {
+        // last position seen for each hash of 4 bytes, plus one so 0 means none
+        std::vector<uint32_t> vecTable(1 << LZ_HASH_BITS, 0);
+        size_t nMatchLimit = nSize - LZ_LAST_LITERALS;
+        size_t nStartLimit = nSize - LZ_MATCH_START_LIMIT;
+        size_t nPos = 0;
+        while (nPos < nStartLimit) {
+            uint32_t nSeq = ReadLE32(pIn + nPos);
+            uint32_t nHash = (nSeq * 2654435761U) >> (32 - LZ_HASH_BITS);
+            size_t nRef = vecTable[nHash];
+            vecTable[nHash] = (uint32_t)(nPos + 1);
+            if (nRef == 0 || nPos - (nRef - 1) > LZ_MAX_OFFSET || ReadLE32(pIn + nRef - 1) != nSeq) {
+                nPos++;
+                continue;
+            }
+            nRef--;
+
+            size_t nMatch = LZ_MIN_MATCH;
+            while (nPos + nMatch < nMatchLimit && pIn[nRef + nMatch] == pIn[nPos + nMatch]) {
+                nMatch++;
+            }
+            WriteSequence(vchOut, pIn + nAnchor, nPos - nAnchor, nPos - nRef, nMatch);
+            nPos += nMatch;
+            nAnchor = nPos;
+        }
+    }
+
+    WriteSequence(vchOut, pIn + nAnchor, nSize - nAnchor, 0, 0);
+}
+
+bool LZDecompress(const std::vector<unsigned char>& vchIn, size_t nRawSize, std::vector<unsigned char>& vchOut)
+{
+    vchOut.clear();
+    vchOut.reserve(nRawSize);
+
+    size_t nPos = 0;
+    while (true) {
+        if (nPos >= vchIn.size()) {
+            return false;
+        }
+        unsigned char nToken = vchIn[nPos++];
+
+        size_t nLiterals = nToken >> 4;
+        if (nLiterals == 15 && !ReadLength(vchIn, nPos, nLiterals, nRawSize)) {
+            return false;
+        }
+        if (nLiterals > vchIn.size() - nPos || nLiterals > nRawSize - vchOut.size()) {
+            return false;
+        }
+        vchOut.insert(vchOut.end(), vchIn.begin() + nPos, vchIn.begin() + nPos + nLiterals);
+        nPos += nLiterals;
+
+        if (nPos == vchIn.size()) {
+            // the last sequence ends after its literals
+            break;
+        }
+
+        if (vchIn.size() - nPos < 2) {
+            return false;
+        }
+        size_t nOffset = vchIn[nPos] | ((size_t)vchIn[nPos + 1] << 8);
+        nPos += 2;
+        if (nOffset == 0 || nOffset > vchOut.size()) {
+            return false;
+        }
+        size_t nMatch = nToken & 15;
+        if (nMatch == 15 && !ReadLength(vchIn, nPos, nMatch, nRawSize)) {
+            return false;
+        }
+        nMatch += LZ_MIN_MATCH;
+        if (nMatch > nRawSize - vchOut.size()) {
+            return false;
+        }
+        // matches may overlap the bytes they produce, so copy byte by byte
+        size_t nStart = vchOut.size() - nOffset;
+        for (size_t i = 0; i < nMatch; i++) {
+            unsigned char c = vchOut[nStart + i];
+            vchOut.push_back(c);
+        }
+    }
+
+    return vchOut.size() == nRawSize;
+}
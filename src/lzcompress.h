@@ -0,0 +1,80 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef LZCOMPRESS_H
+#define LZCOMPRESS_H
+
+#include "serialize.h"
+
+#include <ios>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Byte oriented LZ77 compression in the LZ4 block format. Only meant for small
+ * payloads like the JSON data of governance objects, it has no dependencies and
+ * decompression never writes more than the expected size.
+ */
+void LZCompress(const std::vector<unsigned char>& vchIn, std::vector<unsigned char>& vchOut);
+
+/** Decompress vchIn, false unless it decompresses to exactly nRawSize bytes */
+bool LZDecompress(const std::vector<unsigned char>& vchIn, size_t nRawSize, std::vector<unsigned char>& vchOut);
+
+/**
+ * Wrapper for a byte vector which serializes it LZ compressed, or as is when
+ * compression doesn't make it smaller.
+ *
+ * Format: VARINT(raw size * 2 + compressed flag) followed by the raw bytes or
+ * by the compressed bytes with their compact size.
+ */
+class CLZCompressedBytes
+{
+private:
+    std::vector<unsigned char>& vch;
+    // larger data is rejected on deserialization
+    uint64_t nMaxSize;
+
+public:
+    CLZCompressedBytes(std::vector<unsigned char>& vchIn, uint64_t nMaxSizeIn) : vch(vchIn), nMaxSize(nMaxSizeIn) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        std::vector<unsigned char> vchCompressed;
+        LZCompress(vch, vchCompressed);
+        bool fCompressed = vchCompressed.size() < vch.size();
+        uint64_t nHeader = (uint64_t)vch.size() * 2 + (fCompressed ? 1 : 0);
+        s << VARINT(nHeader);
+        if (fCompressed) {
+            s << vchCompressed;
+        } else if (!vch.empty()) {
+            s.write((const char*)vch.data(), vch.size());
+        }
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        uint64_t nHeader = 0;
+        s >> VARINT(nHeader);
+        uint64_t nRawSize = nHeader / 2;
+        if (nRawSize > nMaxSize) {
+            throw std::ios_base::failure("CLZCompressedBytes::Unserialize: data too large");
+        }
+        if (nHeader & 1) {
+            std::vector<unsigned char> vchCompressed;
+            s >> vchCompressed;
+            if (!LZDecompress(vchCompressed, nRawSize, vch)) {
+                throw std::ios_base::failure("CLZCompressedBytes::Unserialize: invalid compressed data");
+            }
+        } else {
+            vch.resize(nRawSize);
+            if (nRawSize) {
+                s.read((char*)vch.data(), nRawSize);
+            }
+        }
+    }
+};
+
+#endif // LZCOMPRESS_H
@@ -5,6 +5,7 @@
 #include "masternode-meta.h"
 #include "masternode-utils.h"
 #include "client.h"
+#include "ipfs-health.h"
 #include "init.h"
 #include "masternode-sync.h"
 #ifdef ENABLE_WALLET
@@ -134,26 +135,15 @@ std::string CMasternodeMetaMan::ToString() const
 
 bool CMasternodeMetaMan::IsIPFSActiveLocal(const COutPoint& outpoint)
 {
-    //LOCK(cs);
     // Check if our masternode has IPFS running, otherwise return false
-
-    int i = 0;
-
+    // The daemon is probed in the background by ipfsHealthMonitor, only look at the cached status here
     if (CheckCollateralType(outpoint) == CMasternodeMetaMan::COLLATERAL_HIGH_OK) {
-        do {
-            try {
-                ipfs::Client ipfsclient("localhost", 5001);
-                std::stringstream contents;
-                ipfsclient.FilesGet("/ipfs/QmXgqKTbzdh83pQtKFb19SpMCpDDcKR2ujqk3pKph9aCNF", &contents);
-                LogPrint("masternode", "CMasternodeMetaMan::IsIPFSActiveLocal -- Local High Collateral Masternode IPFS daemon is ENABLED\n");
-                i = 0;
-            } catch (std::exception& e) {
-                LogPrint("masternode", "CMasternodeMetaMan::IsIPFSActiveLocal -- Local High Collateral Masternode IPFS daemon is not ENABLED\n");
-                i = 1;
-            }
-
-        } while (i == 1);
-        return true;
+        if (ipfsHealthMonitor.IsActive()) {
+            LogPrint("masternode", "CMasternodeMetaMan::IsIPFSActiveLocal -- Local High Collateral Masternode IPFS daemon is ENABLED\n");
+            return true;
+        }
+        LogPrint("masternode", "CMasternodeMetaMan::IsIPFSActiveLocal -- Local High Collateral Masternode IPFS daemon is not ENABLED\n");
+        return false;
     } else {
         LogPrint("masternode", "CMasternodeMetaMan::IsIPFSActiveLocal -- Voting Node Found\n");
         return true;
@@ -164,21 +154,45 @@ bool CMasternodeMetaMan::IsIPFSActiveLocal(const COutPoint& outpoint)
 
 int CMasternodeMetaMan::CheckCollateralType(const COutPoint& outpoint)
 {
+    {
+        LOCK(mmetaman.cs_collateralTypes);
+        auto it = mmetaman.mapCollateralTypes.find(outpoint);
+        if (it != mmetaman.mapCollateralTypes.end()) {
+            return it->second;
+        }
+    }
 
     Coin coin;
     if (!GetUTXOCoin(outpoint, coin)) {
-        //LogPrintf("CMasternodeMetaMan::CheckCollateralType -- Masternode Collateral Type Not Found:%d\n", 999);
-        return 999;
+        return COLLATERAL_UTXO_NOT_FOUND;
     }
 
+    int nType = COLLATERAL_INVALID_AMOUNT;
     if (coin.out.nValue == 100 * COIN) {
-        //LogPrintf("CMasternodeMetaMan::CheckCollateralType -- Masternode Collateral Type:%d\n", 100);
-        return 0;
+        nType = COLLATERAL_OK;
+    } else if (coin.out.nValue == 5000 * COIN) {
+        nType = COLLATERAL_HIGH_OK;
     }
 
-    if (coin.out.nValue == 5000 * COIN) {
-       //LogPrintf("CMasternodeMetaMan::CheckCollateralType -- Masternode Collateral Type:%d\n", 5000);
-        return 1;
+    LOCK(mmetaman.cs_collateralTypes);
+    if (mmetaman.mapCollateralTypes.size() >= MAX_COLLATERAL_TYPES) {
+        mmetaman.mapCollateralTypes.clear();
     }
+    mmetaman.mapCollateralTypes.emplace(outpoint, nType);
+    return nType;
+}
 
-}
\ No newline at end of file
+void CMasternodeMetaMan::SyncTransaction(const CTransaction& tx, const CBlockIndex* pindex, int posInBlock)
+{
+    LOCK(cs_collateralTypes);
+    if (mapCollateralTypes.empty()) {
+        return;
+    }
+    for (const auto& in : tx.vin) {
+        mapCollateralTypes.erase(in.prevout);
+    }
+    // outputs vanish when the transaction is disconnected
+    for (uint32_t i = 0; i < tx.vout.size(); i++) {
+        mapCollateralTypes.erase(COutPoint(tx.GetHash(), i));
+    }
+}
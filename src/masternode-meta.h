@@ -5,11 +5,13 @@
 #ifndef MASTERNODE_META_H
 #define MASTERNODE_META_H
 
+#include "coins.h"
 #include "serialize.h"
 
 #include "evo/deterministicmns.h"
 
 #include <memory>
+#include <unordered_map>
 
 class CConnman;
 
@@ -90,6 +92,13 @@ private:
     // keep track of dsq count to prevent masternodes from gaming privatesend queue
     int64_t nDsqCount = 0;
 
+    // collateral types of outpoints found in the UTXO set. Only found outpoints are cached, as their amount can't
+    // change anymore, and they are removed as soon as a transaction spending (or, when disconnected, creating) them
+    // is seen
+    static const size_t MAX_COLLATERAL_TYPES = 100000;
+    CCriticalSection cs_collateralTypes;
+    std::unordered_map<COutPoint, int, SaltedOutpointHasher> mapCollateralTypes;
+
 public:
     ADD_SERIALIZE_METHODS
 
@@ -148,7 +157,9 @@ public:
     void AddDirtyGovernanceObjectHash(const uint256& nHash);
     std::vector<uint256> GetAndClearDirtyGovernanceObjectHashes();
 
+    // One of CollateralStatus
     static int CheckCollateralType(const COutPoint& outpoint);
+    void SyncTransaction(const CTransaction& tx, const CBlockIndex* pindex, int posInBlock);
 
     void Clear();
     void CheckAndRemove();
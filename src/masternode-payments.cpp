@@ -272,7 +272,7 @@ std::map<int, std::string> GetRequiredPaymentsStrings(int nStartHeight, int nEnd
     bool doProjection = false;
     for(int h = nStartHeight; h < nEndHeight; h++) {
         if (h <= nChainTipHeight) {
-            auto payee = deterministicMNManager->GetListForBlock(chainActive[h - 1]).GetMNPayee();
+            auto payee = mnpayments.GetPayee(chainActive[h - 1]);
             mapPayments.emplace(h, GetRequiredPaymentsString(h, payee));
         } else {
             doProjection = true;
@@ -318,22 +318,38 @@ bool CMasternodePayments::GetMasternodeTxOuts(int nBlockHeight, CAmount blockRew
     return true;
 }
 
-bool CMasternodePayments::GetBlockTxOuts(int nBlockHeight, CAmount blockReward, std::vector<CTxOut>& voutMasternodePaymentsRet) const
+CDeterministicMNCPtr CMasternodePayments::GetPayee(const CBlockIndex* pindexPrev) const
 {
-    voutMasternodePaymentsRet.clear();
-
-    CAmount masternodeReward = GetMasternodePayment(nBlockHeight, blockReward);
+    if (!pindexPrev) {
+        return nullptr;
+    }
 
-    const CBlockIndex* pindex;
+    int nBlockHeight = pindexPrev->nHeight + 1;
     {
-        LOCK(cs_main);
-        pindex = chainActive[nBlockHeight - 1];
+        LOCK(cs_payees);
+        auto it = mapPayees.find(nBlockHeight);
+        if (it != mapPayees.end() && it->second.prevBlockHash == pindexPrev->GetBlockHash()) {
+            return it->second.dmnPayee;
+        }
     }
-    uint256 proTxHash;
-    auto dmnPayee = deterministicMNManager->GetListForBlock(pindex).GetMNPayee();
-    if (!dmnPayee) {
-        return false;
+
+    // don't hold cs_payees while the list is built, it may have to be read from disk
+    auto dmnPayee = deterministicMNManager->GetListForBlock(pindexPrev).GetMNPayee();
+
+    LOCK(cs_payees);
+    mapPayees[nBlockHeight] = CachedPayee{pindexPrev->GetBlockHash(), dmnPayee};
+    while (mapPayees.size() > PAYEE_CACHE_SIZE) {
+        // drop the lowest heights, they are the least likely to be asked for again
+        mapPayees.erase(mapPayees.begin());
     }
+    return dmnPayee;
+}
+
+void CMasternodePayments::GetPayeeTxOuts(const CDeterministicMNCPtr& dmnPayee, int nBlockHeight, CAmount blockReward, std::vector<CTxOut>& voutMasternodePaymentsRet)
+{
+    voutMasternodePaymentsRet.clear();
+
+    CAmount masternodeReward = GetMasternodePayment(nBlockHeight, blockReward);
 
     CAmount operatorReward = 0;
     if (dmnPayee->nOperatorReward != 0 && dmnPayee->pdmnState->scriptOperatorPayout != CScript()) {
@@ -349,7 +365,29 @@ bool CMasternodePayments::GetBlockTxOuts(int nBlockHeight, CAmount blockReward,
     if (operatorReward > 0) {
         voutMasternodePaymentsRet.emplace_back(operatorReward, dmnPayee->pdmnState->scriptOperatorPayout);
     }
+}
+
+void CMasternodePayments::UpdatedBlockTip(const CBlockIndex* pindexNew)
+{
+    // the list was just built, remember the payee of the next block while it's at hand
+    GetPayee(pindexNew);
+}
+
+bool CMasternodePayments::GetBlockTxOuts(int nBlockHeight, CAmount blockReward, std::vector<CTxOut>& voutMasternodePaymentsRet) const
+{
+    voutMasternodePaymentsRet.clear();
+
+    const CBlockIndex* pindex;
+    {
+        LOCK(cs_main);
+        pindex = chainActive[nBlockHeight - 1];
+    }
+    auto dmnPayee = GetPayee(pindex);
+    if (!dmnPayee) {
+        return false;
+    }
 
+    GetPayeeTxOuts(dmnPayee, nBlockHeight, blockReward, voutMasternodePaymentsRet);
     return true;
 }
 
@@ -30,7 +30,28 @@ extern CMasternodePayments mnpayments;
 
 class CMasternodePayments
 {
+private:
+    // number of recent heights the payee cache keeps
+    static const int PAYEE_CACHE_SIZE = 1000;
+
+    struct CachedPayee {
+        // the block the payee was computed on top of, catches reorgs
+        uint256 prevBlockHash;
+        CDeterministicMNCPtr dmnPayee;
+    };
+
+    mutable CCriticalSection cs_payees;
+    // expected payee by block height, shared by the miner, block validation and RPC
+    mutable std::map<int, CachedPayee> mapPayees;
+
 public:
+    /// Expected masternode payee of the block after pindexPrev, nullptr if the list is empty
+    CDeterministicMNCPtr GetPayee(const CBlockIndex* pindexPrev) const;
+    /// Split the masternode reward of nBlockHeight between the payee and its operator
+    static void GetPayeeTxOuts(const CDeterministicMNCPtr& dmnPayee, int nBlockHeight, CAmount blockReward, std::vector<CTxOut>& voutMasternodePaymentsRet);
+
+    void UpdatedBlockTip(const CBlockIndex* pindexNew);
+
     bool GetBlockTxOuts(int nBlockHeight, CAmount blockReward, std::vector<CTxOut>& voutMasternodePaymentsRet) const;
     bool IsTransactionValid(const CTransaction& txNew, int nBlockHeight, CAmount blockReward) const;
     bool IsScheduled(const CDeterministicMNCPtr& dmn, int nNotBlockHeight) const;
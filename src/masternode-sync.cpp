@@ -5,6 +5,7 @@
 #include "activemasternode.h"
 #include "governance.h"
 #include "init.h"
+#include "ipfs-pinning.h"
 #include "validation.h"
 #include "masternode-payments.h"
 #include "masternode-sync.h"
@@ -29,6 +30,14 @@ void CMasternodeSync::Reset()
     nTimeAssetSyncStarted = GetTime();
     nTimeLastBumped = GetTime();
     nTimeLastFailure = 0;
+    ResetGovernancePeers();
+}
+
+void CMasternodeSync::ResetGovernancePeers()
+{
+    LOCK(cs);
+    mapGovernancePeers.clear();
+    fGovernanceAllAsked = false;
 }
 
 void CMasternodeSync::BumpAssetLastTime(const std::string& strFuncName)
@@ -45,6 +54,7 @@ std::string CMasternodeSync::GetAssetName()
         case(MASTERNODE_SYNC_INITIAL):      return "MASTERNODE_SYNC_INITIAL";
         case(MASTERNODE_SYNC_WAITING):      return "MASTERNODE_SYNC_WAITING";
         case(MASTERNODE_SYNC_GOVERNANCE):   return "MASTERNODE_SYNC_GOVERNANCE";
+        case(MASTERNODE_SYNC_IPFS):         return "MASTERNODE_SYNC_IPFS";
         case(MASTERNODE_SYNC_FAILED):       return "MASTERNODE_SYNC_FAILED";
         case MASTERNODE_SYNC_FINISHED:      return "MASTERNODE_SYNC_FINISHED";
         default:                            return "UNKNOWN";
@@ -69,27 +79,48 @@ void CMasternodeSync::SwitchToNextAsset(CConnman& connman)
             break;
         case(MASTERNODE_SYNC_GOVERNANCE):
             LogPrintf("CMasternodeSync::SwitchToNextAsset -- Completed %s in %llds\n", GetAssetName(), GetTime() - nTimeAssetSyncStarted);
-            nCurrentAsset = MASTERNODE_SYNC_FINISHED;
-            uiInterface.NotifyAdditionalDataSyncProgressChanged(1);
-
-            connman.ForEachNode(CConnman::AllNodes, [](CNode* pnode) {
-                netfulfilledman.AddFulfilledRequest(pnode->addr, "full-sync");
-            });
-            LogPrintf("CMasternodeSync::SwitchToNextAsset -- Sync has finished\n");
-
+            if (!ipfsPinManager.HasWorkerThreads()) {
+                // not pinning anything, nothing to reconcile
+                Finish(connman);
+                break;
+            }
+            nCurrentAsset = MASTERNODE_SYNC_IPFS;
+            LogPrintf("CMasternodeSync::SwitchToNextAsset -- Starting %s\n", GetAssetName());
+            ipfsPinManager.StartReconciliation(governance.GetIPFSCIDIndex());
+            break;
+        case(MASTERNODE_SYNC_IPFS):
+            LogPrintf("CMasternodeSync::SwitchToNextAsset -- Completed %s in %llds\n", GetAssetName(), GetTime() - nTimeAssetSyncStarted);
+            Finish(connman);
             break;
     }
     nTriedPeerCount = 0;
     nTimeAssetSyncStarted = GetTime();
+    ResetGovernancePeers();
     BumpAssetLastTime("CMasternodeSync::SwitchToNextAsset");
 }
 
+void CMasternodeSync::Finish(CConnman& connman)
+{
+    nCurrentAsset = MASTERNODE_SYNC_FINISHED;
+    uiInterface.NotifyAdditionalDataSyncProgressChanged(1);
+
+    connman.ForEachNode(CConnman::AllNodes, [](CNode* pnode) {
+        netfulfilledman.AddFulfilledRequest(pnode->addr, "full-sync");
+    });
+    LogPrintf("CMasternodeSync::SwitchToNextAsset -- Sync has finished\n");
+}
+
 std::string CMasternodeSync::GetSyncStatus()
 {
     switch (masternodeSync.nCurrentAsset) {
         case MASTERNODE_SYNC_INITIAL:       return _("Synchronizing blockchain...");
         case MASTERNODE_SYNC_WAITING:       return _("Synchronization pending...");
         case MASTERNODE_SYNC_GOVERNANCE:    return _("Synchronizing governance objects...");
+        case MASTERNODE_SYNC_IPFS: {
+            int nDone, nTotal;
+            ipfsPinManager.GetReconcileProgress(nDone, nTotal);
+            return strprintf(_("Pinning IPFS objects... (%d/%d)"), nDone, nTotal);
+        }
         case MASTERNODE_SYNC_FAILED:        return _("Synchronization failed");
         case MASTERNODE_SYNC_FINISHED:      return _("Synchronization finished");
         default:                            return "";
@@ -108,9 +139,55 @@ void CMasternodeSync::ProcessMessage(CNode* pfrom, const std::string& strCommand
         vRecv >> nItemID >> nCount;
 
         LogPrintf("SYNCSTATUSCOUNT -- got inventory count: nItemID=%d  nCount=%d  peer=%d\n", nItemID, nCount, pfrom->id);
+
+        if (nItemID == MASTERNODE_SYNC_GOVOBJ || nItemID == MASTERNODE_SYNC_GOVOBJ_VOTE) {
+            LOCK(cs);
+            auto it = mapGovernancePeers.find(pfrom->GetId());
+            if (it != mapGovernancePeers.end()) {
+                if (nItemID == MASTERNODE_SYNC_GOVOBJ) {
+                    it->second.fObjectsAnswered = true;
+                } else if (it->second.nVoteSyncsPending > 0) {
+                    it->second.nVoteSyncsPending--;
+                }
+            }
+        }
+        // this answer might be the last one the current asset waits for
+        fTickPending = true;
     }
 }
 
+void CMasternodeSync::GovernanceVotesRequested(NodeId nodeId)
+{
+    if (nCurrentAsset != MASTERNODE_SYNC_GOVERNANCE) return;
+
+    LOCK(cs);
+    auto& state = mapGovernancePeers[nodeId];
+    state.nVoteSyncsPending++;
+    state.nTimeLastVoteSync = GetTime();
+}
+
+bool CMasternodeSync::IsGovernanceSyncComplete(const std::vector<CNode*>& vNodesCopy)
+{
+    int64_t nNow = GetTime();
+    // objects or votes are still coming in
+    if (nNow - nTimeLastBumped < MASTERNODE_SYNC_QUIET_SECONDS) return false;
+
+    LOCK(cs);
+    if (!fGovernanceAllAsked) return false;
+
+    bool fObjectsAnswered = false;
+    for (const auto& pnode : vNodesCopy) {
+        auto it = mapGovernancePeers.find(pnode->GetId());
+        if (it == mapGovernancePeers.end()) continue;
+        const GovernancePeerState& state = it->second;
+        fObjectsAnswered |= state.fObjectsAnswered;
+        // peers which don't answer at all are left to the timeout
+        if (nNow - std::max(state.nTimeObjectsRequested, state.nTimeLastVoteSync) > MASTERNODE_SYNC_TIMEOUT_SECONDS) continue;
+        if ((state.nTimeObjectsRequested != 0 && !state.fObjectsAnswered) || state.nVoteSyncsPending > 0) return false;
+    }
+    return fObjectsAnswered;
+}
+
 void CMasternodeSync::ProcessTick(CConnman& connman)
 {
     static int nTick = 0;
@@ -126,12 +203,13 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
         return;
     }
 
-    if(GetTime() - nTimeLastProcess < MASTERNODE_SYNC_TICK_SECONDS) {
+    if(GetTime() - nTimeLastProcess < MASTERNODE_SYNC_TICK_SECONDS && !fTickPending) {
         // too early, nothing to do here
         return;
     }
 
     nTimeLastProcess = GetTime();
+    fTickPending = false;
 
     // reset sync status in case of any other sync failure
     if(IsFailed()) {
@@ -151,12 +229,37 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
         return;
     }
 
+    // IPFS : WAIT FOR THE PIN RECONCILIATION, NO PEERS NEEDED
+
+    if(nCurrentAsset == MASTERNODE_SYNC_IPFS) {
+        static int nLastDone = -1;
+        int nDone, nTotal;
+        ipfsPinManager.GetReconcileProgress(nDone, nTotal);
+        if(nDone != nLastDone) {
+            nLastDone = nDone;
+            BumpAssetLastTime("CMasternodeSync::ProcessTick -- IPFS pin progress");
+        }
+        LogPrint("mnsync", "CMasternodeSync::ProcessTick -- nTick %d nCurrentAsset %d -- pinned %d of %d\n", nTick, nCurrentAsset, nDone, nTotal);
+        if(!ipfsPinManager.IsReconciling()) {
+            nLastDone = -1;
+            SwitchToNextAsset(connman);
+        } else if(GetTime() - nTimeLastBumped > MASTERNODE_SYNC_IPFS_TIMEOUT_SECONDS) {
+            // pins keep going in the background, just don't hold the sync back any longer
+            LogPrintf("CMasternodeSync::ProcessTick -- nTick %d nCurrentAsset %d -- timeout\n", nTick, nCurrentAsset);
+            nLastDone = -1;
+            SwitchToNextAsset(connman);
+        }
+        return;
+    }
+
     // Calculate "progress" for LOG reporting / GUI notification
     double nSyncProgress = double(nTriedPeerCount + (nCurrentAsset - 1) * 8) / (8*4);
     LogPrintf("CMasternodeSync::ProcessTick -- nTick %d nCurrentAsset %d nTriedPeerCount %d nSyncProgress %f\n", nTick, nCurrentAsset, nTriedPeerCount, nSyncProgress);
     uiInterface.NotifyAdditionalDataSyncProgressChanged(nSyncProgress);
 
     std::vector<CNode*> vNodesCopy = connman.CopyNodeVector(CConnman::FullyConnectedOnly);
+    int nGovernanceRequests = 0;
+    bool fGovernanceAllAskedNew = true;
 
     for (auto& pnode : vNodesCopy)
     {
@@ -238,6 +341,8 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
                 // only request obj sync once from each peer, then request votes on per-obj basis
                 if(netfulfilledman.HasFulfilledRequest(pnode->addr, "governance-sync")) {
                     int nObjsLeftToAsk = governance.RequestGovernanceObjectVotes(pnode, connman);
+                    // -2 means there are no objects at all
+                    if(nObjsLeftToAsk > 0 || nObjsLeftToAsk == -1) fGovernanceAllAskedNew = false;
                     static int64_t nTimeNoObjectsLeft = 0;
                     // check for data
                     if(nObjsLeftToAsk == 0) {
@@ -273,13 +378,33 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
                 if (pnode->nVersion < MIN_GOVERNANCE_PEER_PROTO_VERSION) continue;
                 nTriedPeerCount++;
 
+                {
+                    LOCK(cs);
+                    mapGovernancePeers[pnode->GetId()].nTimeObjectsRequested = GetTime();
+                }
                 SendGovernanceSyncRequest(pnode, connman);
+                fGovernanceAllAskedNew = false;
 
+                // ask a few peers in parallel, the others are asked on the next ticks
+                if(++nGovernanceRequests < MASTERNODE_SYNC_GOVERNANCE_PEERS) continue;
                 connman.ReleaseNodeVector(vNodesCopy);
-                return; //this will cause each peer to get one request each six seconds for the various assets we need
+                return;
             }
         }
     }
+
+    if(nCurrentAsset == MASTERNODE_SYNC_GOVERNANCE) {
+        {
+            LOCK(cs);
+            fGovernanceAllAsked = fGovernanceAllAskedNew;
+        }
+        // don't wait for the timeout when the peers told us they sent everything and it all arrived
+        if(IsGovernanceSyncComplete(vNodesCopy)) {
+            LogPrintf("CMasternodeSync::ProcessTick -- nTick %d nCurrentAsset %d -- all governance requests answered\n", nTick, nCurrentAsset);
+            SwitchToNextAsset(connman);
+        }
+    }
+
     // looped through all nodes, release them
     connman.ReleaseNodeVector(vNodesCopy);
 }
@@ -378,5 +503,12 @@ void CMasternodeSync::DoMaintenance(CConnman &connman)
 {
     if (ShutdownRequested()) return;
 
+    // governance data might have stopped coming in since the last tick
+    if (nCurrentAsset == MASTERNODE_SYNC_GOVERNANCE && nTimeLastBumped != nTimeQuietChecked &&
+        GetTime() - nTimeLastBumped >= MASTERNODE_SYNC_QUIET_SECONDS) {
+        nTimeQuietChecked = nTimeLastBumped;
+        fTickPending = true;
+    }
+
     ProcessTick(connman);
 }
@@ -6,6 +6,10 @@
 
 #include "chain.h"
 #include "net.h"
+#include "sync.h"
+
+#include <atomic>
+#include <map>
 
 class CMasternodeSync;
 
@@ -15,10 +19,14 @@ static const int MASTERNODE_SYNC_WAITING         = 1; // waiting after initial t
 static const int MASTERNODE_SYNC_GOVERNANCE      = 4;
 static const int MASTERNODE_SYNC_GOVOBJ          = 10;
 static const int MASTERNODE_SYNC_GOVOBJ_VOTE     = 11;
+static const int MASTERNODE_SYNC_IPFS            = 12; // high collateral masternodes only, make sure all governance CIDs are pinned
 static const int MASTERNODE_SYNC_FINISHED        = 999;
 
 static const int MASTERNODE_SYNC_TICK_SECONDS    = 6;
 static const int MASTERNODE_SYNC_TIMEOUT_SECONDS = 30; // our blocks are 2.5 minutes so 30 seconds should be fine
+static const int MASTERNODE_SYNC_QUIET_SECONDS   = 2; // all requests answered and no governance data for this long, we're done
+static const int MASTERNODE_SYNC_GOVERNANCE_PEERS = 3; // peers asked for governance objects per tick
+static const int MASTERNODE_SYNC_IPFS_TIMEOUT_SECONDS = 5 * 60; // pinning large objects takes a while, give up if no pin finished for this long
 
 extern CMasternodeSync masternodeSync;
 
@@ -41,7 +49,30 @@ private:
     // ... or failed
     int64_t nTimeLastFailure;
 
+    // Set by completion events, makes the next DoMaintenance run a tick right away instead of waiting for it
+    std::atomic<bool> fTickPending{false};
+
+    struct GovernancePeerState {
+        // when we asked the peer for all objects, 0 if we didn't in this sync
+        int64_t nTimeObjectsRequested{0};
+        bool fObjectsAnswered{false};
+        // vote requests the peer didn't answer yet
+        int nVoteSyncsPending{0};
+        int64_t nTimeLastVoteSync{0};
+    };
+    CCriticalSection cs;
+    // peers we requested governance data from during the current governance asset, protected by cs
+    std::map<NodeId, GovernancePeerState> mapGovernancePeers;
+    // whether the last tick found no objects left to ask votes for
+    bool fGovernanceAllAsked{false};
+    // nTimeLastBumped the quiet period was last checked for
+    int64_t nTimeQuietChecked{0};
+
     void Fail();
+    void Finish(CConnman& connman);
+    void ResetGovernancePeers();
+    /** Whether all peers answered our governance requests and the data stopped coming in */
+    bool IsGovernanceSyncComplete(const std::vector<CNode*>& vNodesCopy);
 
 public:
     CMasternodeSync() { Reset(); }
@@ -65,6 +96,8 @@ public:
 
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv);
     void ProcessTick(CConnman& connman);
+    /** Called when the votes of an object were requested from a peer, it answers with a SYNCSTATUSCOUNT */
+    void GovernanceVotesRequested(NodeId nodeId);
 
     void AcceptedBlockHeader(const CBlockIndex *pindexNew);
     void NotifyHeaderTip(const CBlockIndex *pindexNew, bool fInitialDownload, CConnman& connman);
@@ -113,13 +113,8 @@ bool CMasternodeUtils::IsIdentityValid(std::string identity, CAmount CollateralA
     if (identity.size() == 0 || identity.size() > 255 || identity == "" || identity == "0")
 	return false;
 
-    auto mnList = deterministicMNManager->GetListAtChainTip();
-    auto identities = mnList.GetIdentitiesInUse();
-    for (const auto& p : identities) {
-        if (p.c_str() == identity) {
-            valid = false;
-            return valid;
-        }
+    if (deterministicMNManager->GetListAtChainTip().IsIdentityInUse(identity)) {
+        return false;
     }
 
     switch(CollateralAmount) {
@@ -140,12 +135,8 @@ bool CMasternodeUtils::IsIdentityValid(std::string identity, CAmount CollateralA
 bool CMasternodeUtils::IsIpfsIdValidWithCollateral(const std::string& ipfsId, CAmount collateralAmount)
 {
     //Check for in use IPFS Peer ID
-    auto mnList = deterministicMNManager->GetListAtChainTip();
-    auto ipfspeerids = mnList.GetIPFSPeerIdInUse();
-    for (const auto& p : ipfspeerids) {
-        if (p.c_str() == ipfsId && ipfsId != "0" && ipfsId != "") {
-            return false;
-        }
+    if (ipfsId != "0" && ipfsId != "" && deterministicMNManager->GetListAtChainTip().IsIPFSPeerIdInUse(ipfsId)) {
+        return false;
     }
     /** All alphanumeric characters except for "0", "I", "O", and "l" */
     std::string base58chars =
@@ -169,12 +160,8 @@ bool CMasternodeUtils::IsIpfsIdValidWithCollateral(const std::string& ipfsId, CA
 
 bool CMasternodeUtils::IsIpfsIdValidWithoutCollateral(const std::string& ipfsId)
 {
-    auto mnList = deterministicMNManager->GetListAtChainTip();
-    auto ipfspeerids = mnList.GetIPFSPeerIdInUse();
-    for (const auto& p : ipfspeerids) {
-        if (p.c_str() == ipfsId && ipfsId != "0" && ipfsId != "") {
-            return false;
-        }
+    if (ipfsId != "0" && ipfsId != "" && deterministicMNManager->GetListAtChainTip().IsIPFSPeerIdInUse(ipfsId)) {
+        return false;
     }
     /** All alphanumeric characters except for "0", "I", "O", and "l" */
     std::string base58chars =
@@ -6,6 +6,7 @@
 
 #include "miner.h"
 
+#include "algo/hash_algos.h"
 #include "amount.h"
 #include "chain.h"
 #include "chainparams.h"
@@ -37,9 +38,11 @@
 #include "llmq/quorums_chainlocks.h"
 
 #include <algorithm>
+#include <atomic>
 #include <boost/thread.hpp>
 #include <boost/tuple/tuple.hpp>
 #include <queue>
+#include <thread>
 #include <utility>
 
 //////////////////////////////////////////////////////////////////////////////
@@ -56,6 +59,56 @@
 uint64_t nLastBlockTx = 0;
 uint64_t nLastBlockSize = 0;
 
+/**
+ * The parts of the last block template which are reused by the next one on the same tip. As long as the last block
+ * wasn't full and none of its txs left the mempool, a new template contains the same txs plus the best of the txs
+ * that arrived in between, so package selection only has to look at the new ones. Protected by cs_main.
+ */
+struct CBlockTemplateCache
+{
+    uint256 hashPrevBlock;
+    unsigned int nBlockMaxSize{0};
+    CFeeRate blockMinFeeRate;
+    // mempool txs of the last template, in block order
+    std::vector<uint256> vTxHashes;
+
+    // CbTx merkle roots and the special txs and collateral spends they were calculated for
+    uint256 hashCbTxInputs;
+    uint256 merkleRootMNList;
+    uint256 merkleRootQuorums;
+    bool fHaveMerkleRootQuorums{false};
+};
+static CBlockTemplateCache templateCache;
+
+/**
+ * Everything in a block the CbTx merkle roots depend on. Returns false if the roots can't be cached, which is the
+ * case for blocks with ProRegTxs, as their collaterals could be spent by other txs of the same block.
+ */
+static bool GetCbTxInputsHash(const CBlock& block, const CBlockIndex* pindexPrev, uint256& hashRet)
+{
+    auto mnList = deterministicMNManager->GetListForBlock(pindexPrev);
+
+    CHashWriter hw(SER_GETHASH, 0);
+    hw << pindexPrev->GetBlockHash();
+    // skip the coinbase
+    for (size_t i = 1; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        if (tx.nVersion == 3 && tx.nType != TRANSACTION_NORMAL) {
+            if (tx.nType == TRANSACTION_PROVIDER_REGISTER) {
+                return false;
+            }
+            hw << tx.GetHash();
+        }
+        for (const auto& in : tx.vin) {
+            if (mnList.HasMNByCollateral(in.prevout)) {
+                hw << in.prevout;
+            }
+        }
+    }
+    hashRet = hw.GetHash();
+    return true;
+}
+
 class ScoreCompare
 {
 public:
@@ -117,6 +170,7 @@ BlockAssembler::BlockAssembler(const CChainParams& params) : BlockAssembler(para
 void BlockAssembler::resetBlock()
 {
     inBlock.clear();
+    fPackageRejected = false;
 
     // Reserve space for coinbase tx
     nBlockSize = 1000;
@@ -180,8 +234,32 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
 
     int nPackagesSelected = 0;
     int nDescendantsUpdated = 0;
+
+    bool fUseCache = templateCache.hashPrevBlock == pindexPrev->GetBlockHash() &&
+                     templateCache.nBlockMaxSize == nBlockMaxSize &&
+                     templateCache.blockMinFeeRate == blockMinFeeRate;
+    // forget the txs of the last template until this one is known to be valid
+    templateCache.hashPrevBlock.SetNull();
+    templateCache.vTxHashes.clear();
+
+    const size_t nCommitmentTxs = pblock->vtx.size();
+    const uint64_t nCommitmentsSize = nBlockSize;
+    const uint64_t nCommitmentsTx = nBlockTx;
+    bool fUsedCachedTxs = fUseCache && addCachedTxs();
     addPackageTxs(nPackagesSelected, nDescendantsUpdated);
 
+    if (fUsedCachedTxs && fPackageRejected) {
+        // the block is full now, so the txs of the last template might not be the best ones anymore
+        resetBlock();
+        pblock->vtx.resize(nCommitmentTxs);
+        pblocktemplate->vTxFees.resize(nCommitmentTxs);
+        pblocktemplate->vTxSigOps.resize(nCommitmentTxs);
+        nBlockSize = nCommitmentsSize;
+        nBlockTx = nCommitmentsTx;
+        fUsedCachedTxs = false;
+        addPackageTxs(nPackagesSelected, nDescendantsUpdated);
+    }
+
     int64_t nTime1 = GetTimeMicros();
 
     nLastBlockTx = nBlockTx;
@@ -219,13 +297,30 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
 
         cbTx.nHeight = nHeight;
 
-        CValidationState state;
-        if (!CalcCbTxMerkleRootMNList(*pblock, pindexPrev, cbTx.merkleRootMNList, state)) {
-            throw std::runtime_error(strprintf("%s: CalcCbTxMerkleRootMNList failed: %s", __func__, FormatStateMessage(state)));
-        }
-        if (fDIP0008Active_context) {
-            if (!CalcCbTxMerkleRootQuorums(*pblock, pindexPrev, cbTx.merkleRootQuorums, state)) {
-                throw std::runtime_error(strprintf("%s: CalcCbTxMerkleRootQuorums failed: %s", __func__, FormatStateMessage(state)));
+        uint256 hashCbTxInputs;
+        bool fCacheCbTx = GetCbTxInputsHash(*pblock, pindexPrev, hashCbTxInputs);
+        if (fCacheCbTx && hashCbTxInputs == templateCache.hashCbTxInputs &&
+            (!fDIP0008Active_context || templateCache.fHaveMerkleRootQuorums)) {
+            cbTx.merkleRootMNList = templateCache.merkleRootMNList;
+            cbTx.merkleRootQuorums = templateCache.merkleRootQuorums;
+        } else {
+            templateCache.hashCbTxInputs.SetNull();
+
+            CValidationState state;
+            if (!CalcCbTxMerkleRootMNList(*pblock, pindexPrev, cbTx.merkleRootMNList, state)) {
+                throw std::runtime_error(strprintf("%s: CalcCbTxMerkleRootMNList failed: %s", __func__, FormatStateMessage(state)));
+            }
+            if (fDIP0008Active_context) {
+                if (!CalcCbTxMerkleRootQuorums(*pblock, pindexPrev, cbTx.merkleRootQuorums, state)) {
+                    throw std::runtime_error(strprintf("%s: CalcCbTxMerkleRootQuorums failed: %s", __func__, FormatStateMessage(state)));
+                }
+            }
+
+            if (fCacheCbTx) {
+                templateCache.hashCbTxInputs = hashCbTxInputs;
+                templateCache.merkleRootMNList = cbTx.merkleRootMNList;
+                templateCache.merkleRootQuorums = cbTx.merkleRootQuorums;
+                templateCache.fHaveMerkleRootQuorums = fDIP0008Active_context;
             }
         }
 
@@ -251,11 +346,24 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
 
     CValidationState state;
     if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false)) {
+        templateCache.hashCbTxInputs.SetNull();
         throw std::runtime_error(strprintf("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state)));
     }
     int64_t nTime2 = GetTimeMicros();
 
-    LogPrint("bench", "CreateNewBlock() packages: %.2fms (%d packages, %d updated descendants), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
+    templateCache.hashPrevBlock = pindexPrev->GetBlockHash();
+    templateCache.nBlockMaxSize = nBlockMaxSize;
+    templateCache.blockMinFeeRate = blockMinFeeRate;
+    if (!fPackageRejected) {
+        for (size_t i = nCommitmentTxs; i < pblock->vtx.size(); i++) {
+            templateCache.vTxHashes.emplace_back(pblock->vtx[i]->GetHash());
+        }
+    } else {
+        // a full block is built from scratch next time
+        templateCache.hashPrevBlock.SetNull();
+    }
+
+    LogPrint("bench", "CreateNewBlock() packages: %.2fms (%d packages, %d updated descendants%s), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, fUsedCachedTxs ? ", incremental" : "", 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
 
     return std::move(pblocktemplate);
 }
@@ -275,10 +383,11 @@ void BlockAssembler::onlyUnconfirmed(CTxMemPool::setEntries& testSet)
 
 bool BlockAssembler::TestPackage(uint64_t packageSize, unsigned int packageSigOps)
 {
-    if (nBlockSize + packageSize >= nBlockMaxSize)
-        return false;
-    if (nBlockSigOps + packageSigOps >= MaxBlockSigOps(fDIP0001ActiveAtTip))
+    if (nBlockSize + packageSize >= nBlockMaxSize ||
+        nBlockSigOps + packageSigOps >= MaxBlockSigOps(fDIP0001ActiveAtTip)) {
+        fPackageRejected = true;
         return false;
+    }
     return true;
 }
 
@@ -316,6 +425,38 @@ void BlockAssembler::AddToBlock(CTxMemPool::txiter iter)
     }
 }
 
+bool BlockAssembler::addCachedTxs()
+{
+    std::vector<CTxMemPool::txiter> vEntries;
+    vEntries.reserve(templateCache.vTxHashes.size());
+    CTxMemPool::setEntries setEntries;
+    uint64_t nSize = 0;
+    unsigned int nSigOps = 0;
+    for (const auto& hash : templateCache.vTxHashes) {
+        auto it = mempool.mapTx.find(hash);
+        if (it == mempool.mapTx.end()) {
+            return false;
+        }
+        vEntries.emplace_back(it);
+        setEntries.emplace(it);
+        nSize += it->GetTxSize();
+        nSigOps += it->GetSigOpCount();
+    }
+    // the quorum commitments in front of them might have changed
+    if (nBlockSize + nSize >= nBlockMaxSize || nBlockSigOps + nSigOps >= MaxBlockSigOps(fDIP0001ActiveAtTip)) {
+        return false;
+    }
+    if (!TestPackageTransactions(setEntries)) {
+        return false;
+    }
+
+    // the txs are in block order already
+    for (const auto& it : vEntries) {
+        AddToBlock(it);
+    }
+    return true;
+}
+
 int BlockAssembler::UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded,
         indexed_modified_transaction_set &mapModifiedTx)
 {
@@ -528,3 +669,75 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
     pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
     pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
 }
+
+/** Number of nonces a mining thread takes at once */
+static const uint32_t MINER_NONCE_CHUNK_SIZE = 1024;
+
+static std::atomic<double> dMinerHashesPerSec(0);
+
+bool ScanNonces(CBlockHeader& block, uint32_t nNonceBegin, uint32_t nNonceEnd, int nThreads, uint64_t& nHashesDoneRet)
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    int64_t nTimeStart = GetTimeMicros();
+
+    std::atomic<uint64_t> nNextNonce(nNonceBegin);
+    std::atomic<uint64_t> nHashesDone(0);
+    std::atomic<bool> fFound(false);
+    uint32_t nNonceFound = 0;
+
+    auto scan = [&]() {
+        // only the nonce changes, so every thread shares the same first hashing round but needs its own contexts
+        CX16RHasher hasher(BEGIN(block.nVersion), END(block.nNonce), block.hashPrevBlock, block.IsX16RV2());
+        uint64_t nHashes = 0;
+        while (!fFound) {
+            uint64_t nBegin = nNextNonce.fetch_add(MINER_NONCE_CHUNK_SIZE);
+            if (nBegin >= nNonceEnd) {
+                break;
+            }
+            uint64_t nEnd = std::min<uint64_t>(nBegin + MINER_NONCE_CHUNK_SIZE, nNonceEnd);
+            for (uint64_t nNonce = nBegin; nNonce < nEnd && !fFound; nNonce++) {
+                nHashes++;
+                if (CheckProofOfWork(hasher.Hash((uint32_t)nNonce), block.nBits, consensusParams)) {
+                    bool fExpected = false;
+                    if (fFound.compare_exchange_strong(fExpected, true)) {
+                        nNonceFound = (uint32_t)nNonce;
+                    }
+                    break;
+                }
+            }
+        }
+        nHashesDone += nHashes;
+    };
+
+    if (nThreads <= 1) {
+        scan();
+    } else {
+        std::vector<std::thread> vThreads;
+        vThreads.reserve(nThreads);
+        for (int i = 0; i < nThreads; i++) {
+            vThreads.emplace_back([&]() {
+                RenameThread("historia-miner");
+                scan();
+            });
+        }
+        for (auto& t : vThreads) {
+            t.join();
+        }
+    }
+
+    int64_t nTimeElapsed = GetTimeMicros() - nTimeStart;
+    if (nTimeElapsed > 0) {
+        dMinerHashesPerSec = nHashesDone * 1000000.0 / nTimeElapsed;
+    }
+
+    nHashesDoneRet = nHashesDone;
+    if (fFound) {
+        block.nNonce = nNonceFound;
+    }
+    return fFound;
+}
+
+double GetMinerHashesPerSec()
+{
+    return dMinerHashesPerSec;
+}
@@ -24,6 +24,8 @@ class CWallet;
 namespace Consensus { struct Params; };
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Default number of threads generate hashes with, <= 0 means one per core */
+static const int DEFAULT_GENERATE_THREADS = 0;
 
 struct CBlockTemplate
 {
@@ -152,6 +154,8 @@ private:
     unsigned int nBlockSigOps;
     CAmount nFees;
     CTxMemPool::setEntries inBlock;
+    // Whether a package didn't fit into the block anymore
+    bool fPackageRejected;
 
     // Chain context for the block
     int nHeight;
@@ -177,6 +181,8 @@ private:
     void resetBlock();
     /** Add a tx to the block */
     void AddToBlock(CTxMemPool::txiter iter);
+    /** Add the mempool txs of the last template built on the same tip, returns false if any of them can't be used */
+    bool addCachedTxs();
 
     // Methods for how to add transactions to a block.
     /** Add transactions based on feerate including unconfirmed ancestors
@@ -209,4 +215,13 @@ private:
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
 
+/**
+ * Search the nonces [nNonceBegin, nNonceEnd) of the header for a valid proof of work on nThreads threads, each
+ * with its own hasher and taking chunks of the range. Sets the nonce of the header and returns true if one was
+ * found, nHashesDoneRet is the number of nonces tried.
+ */
+bool ScanNonces(CBlockHeader& block, uint32_t nNonceBegin, uint32_t nNonceEnd, int nThreads, uint64_t& nHashesDoneRet);
+/** Hash rate of the last ScanNonces call */
+double GetMinerHashesPerSec();
+
 #endif // BITCOIN_MINER_H
@@ -34,6 +34,11 @@
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <sys/uio.h>
+#endif
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
 #endif
 
 #ifdef USE_UPNP
@@ -74,6 +79,13 @@ constexpr const CConnman::CAllNodes CConnman::AllNodes;
 
 static const uint64_t RANDOMIZER_ID_NETGROUP = 0x6c0edd8036ef4036ULL; // SHA256("netgroup")[0:8]
 static const uint64_t RANDOMIZER_ID_LOCALHOSTNONCE = 0xd93e69e2bbfa5735ULL; // SHA256("localhostnonce")[0:8]
+
+/** Maximum time to wait for socket events, sockets with pending sends are polled at this frequency without a wakeup */
+static const int SELECT_TIMEOUT_MILLISECONDS = 50;
+/** Maximum number of events returned by one epoll_wait() call */
+static const int MAX_EPOLL_EVENTS = 64;
+/** Maximum number of queued messages passed to one sendmsg() call */
+static const size_t MAX_SEND_IOVECS = 64;
 //
 // Global state variables
 //
@@ -85,7 +97,7 @@ std::map<CNetAddr, LocalServiceInfo> mapLocalHost;
 static bool vfLimited[NET_MAX] = {};
 std::string strSubVersion;
 
-unordered_limitedmap<uint256, int64_t, StaticSaltedHasher> mapAlreadyAskedFor(MAX_INV_SZ, MAX_INV_SZ * 2);
+CRequestTracker requestTracker;
 
 // Signals for message handling
 static CNodeSignals g_signals;
@@ -374,7 +386,7 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCo
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed))
     {
-        if (!IsSelectableSocket(hSocket)) {
+        if (socketEventsMode == SOCKETEVENTS_SELECT && !IsSelectableSocket(hSocket)) {
             LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
             return NULL;
@@ -636,6 +648,12 @@ void CNode::SetAddrLocal(const CService& addrLocalIn) {
     }
 }
 
+void CNode::AddProcessingStats(const std::string& strCommand, uint64_t nBytes, int64_t nTimeMicros, int64_t nQueueDelayMicros)
+{
+    LOCK(cs_processingStats);
+    mapProcessingStatsPerMsgCmd[strCommand].Add(nBytes, nTimeMicros, nQueueDelayMicros);
+}
+
 #undef X
 #define X(name) stats.name = name
 void CNode::copyStats(CNodeStats &stats)
@@ -670,6 +688,15 @@ void CNode::copyStats(CNodeStats &stats)
         X(mapRecvBytesPerMsgCmd);
         X(nRecvBytes);
     }
+    {
+        LOCK(cs_processingStats);
+        X(mapProcessingStatsPerMsgCmd);
+    }
+    {
+        LOCK(cs_vProcessMsg);
+        stats.nProcessQueueMsgs = vProcessMsg.size();
+        X(nProcessQueueSize);
+    }
     X(fWhitelisted);
 
     // It is common for nodes with good ping times to suddenly become lagged,
@@ -863,26 +890,49 @@ size_t CConnman::SocketSendData(CNode *pnode) const
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
-        assert(data.size() > pnode->nSendOffset);
+        assert((*it)->size() > pnode->nSendOffset);
         int nBytes = 0;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
+#ifndef WIN32
+            // hand as many queued messages as possible to the kernel at once
+            struct iovec vecs[MAX_SEND_IOVECS];
+            size_t nVecs = 0;
+            size_t nOffset = pnode->nSendOffset;
+            for (auto it2 = it; it2 != pnode->vSendMsg.end() && nVecs < MAX_SEND_IOVECS; ++it2, nVecs++) {
+                vecs[nVecs].iov_base = const_cast<unsigned char*>((*it2)->data()) + nOffset;
+                vecs[nVecs].iov_len = (*it2)->size() - nOffset;
+                nOffset = 0;
+            }
+            struct msghdr msgh = {};
+            msgh.msg_iov = vecs;
+            msgh.msg_iovlen = nVecs;
+            nBytes = sendmsg(pnode->hSocket, &msgh, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+            const auto &data = **it;
             nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         }
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            size_t nLeft = nBytes;
+            while (nLeft > 0) {
+                size_t nRemaining = (*it)->size() - pnode->nSendOffset;
+                if (nLeft < nRemaining) {
+                    pnode->nSendOffset += nLeft;
+                    break;
+                }
+                nLeft -= nRemaining;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+                pnode->nSendSize -= (*it)->size();
                 it++;
-            } else {
+            }
+            pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+            if (pnode->nSendOffset != 0) {
                 // could not send full message; stop sending more
                 break;
             }
@@ -989,6 +1039,13 @@ bool CConnman::AttemptToEvictConnection()
                 if (!node->verifiedProRegTxHash.IsNull()) {
                     isProtected = true;
                 }
+                // same while its MNAUTH waits for the batched verification
+                {
+                    LOCK(node->cs_mnauth);
+                    if (node->fMNAuthPending) {
+                        isProtected = true;
+                    }
+                }
                 if (isProtected) {
                     continue;
                 }
@@ -1115,7 +1172,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    if (socketEventsMode == SOCKETEVENTS_SELECT && !IsSelectableSocket(hSocket))
     {
         LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
@@ -1177,6 +1234,183 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     }
 }
 
+void CConnman::SocketEventsSelect(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set)
+{
+    struct timeval timeout;
+    timeout.tv_sec  = 0;
+    timeout.tv_usec = SELECT_TIMEOUT_MILLISECONDS * 1000; // frequency to poll pnode->vSend
+
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    bool have_fds = false;
+    std::vector<SOCKET> vSockets;
+
+#ifndef WIN32
+    // We add a pipe to the read set so that the select() call can be woken up from the outside
+    // This is done when data is available for sending and at the same time optimistic sending was disabled
+    // when pushing the data.
+    // This is currently only implemented for POSIX compliant systems. This means that Windows will fall back to
+    // timing out after 50ms and then trying to send. This is ok as we assume that heavy-load daemons are usually
+    // run on Linux and friends.
+    FD_SET(wakeupPipe[0], &fdsetRecv);
+    hSocketMax = std::max(hSocketMax, (SOCKET)wakeupPipe[0]);
+    have_fds = true;
+    vSockets.push_back(wakeupPipe[0]);
+#endif
+
+    BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
+        FD_SET(hListenSocket.socket, &fdsetRecv);
+        hSocketMax = std::max(hSocketMax, hListenSocket.socket);
+        have_fds = true;
+        vSockets.push_back(hListenSocket.socket);
+    }
+
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodes)
+        {
+            // Implement the following logic:
+            // * If there is data to send, select() for sending data. As this only
+            //   happens when optimistic write failed, we choose to first drain the
+            //   write buffer in this case before receiving more. This avoids
+            //   needlessly queueing received data, if the remote peer is not themselves
+            //   receiving data. This means properly utilizing TCP flow control signalling.
+            // * Otherwise, if there is space left in the receive buffer, select() for
+            //   receiving data.
+            // * Hand off all complete messages to the processor, to be handled without
+            //   blocking here.
+
+            bool select_recv = !pnode->fPauseRecv;
+            bool select_send;
+            {
+                LOCK(pnode->cs_vSend);
+                select_send = !pnode->vSendMsg.empty();
+            }
+
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+
+            FD_SET(pnode->hSocket, &fdsetError);
+            hSocketMax = std::max(hSocketMax, pnode->hSocket);
+            have_fds = true;
+            vSockets.push_back(pnode->hSocket);
+
+            if (select_send) {
+                FD_SET(pnode->hSocket, &fdsetSend);
+                continue;
+            }
+            if (select_recv) {
+                FD_SET(pnode->hSocket, &fdsetRecv);
+            }
+        }
+    }
+
+    wakeupSelectNeeded = true;
+    int nSelect = select(have_fds ? hSocketMax + 1 : 0,
+                         &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    wakeupSelectNeeded = false;
+    if (interruptNet)
+        return;
+
+    if (nSelect == SOCKET_ERROR)
+    {
+        if (have_fds)
+        {
+            int nErr = WSAGetLastError();
+            LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+            recv_set.insert(vSockets.begin(), vSockets.end());
+        }
+        interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        return;
+    }
+
+    for (SOCKET hSocket : vSockets) {
+        if (FD_ISSET(hSocket, &fdsetRecv)) {
+            recv_set.insert(hSocket);
+        }
+        if (FD_ISSET(hSocket, &fdsetSend)) {
+            send_set.insert(hSocket);
+        }
+        if (FD_ISSET(hSocket, &fdsetError)) {
+            error_set.insert(hSocket);
+        }
+    }
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+void CConnman::SocketEventsEpoll(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set)
+{
+    // Reads are edge-triggered, nodes which still have data in their socket are serviced without waiting for
+    // events. Write readiness is only asked for while the send queue is not empty, as in the select() case.
+    bool fRecvPending = false;
+    {
+        LOCK(cs_vNodes);
+        for (CNode* pnode : vNodes) {
+            bool fWantSend;
+            {
+                LOCK(pnode->cs_vSend);
+                fWantSend = !pnode->vSendMsg.empty();
+            }
+
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+
+            if (!pnode->fSocketRegistered || pnode->fSocketWantSend != fWantSend) {
+                struct epoll_event event = {};
+                event.events = EPOLLIN | EPOLLET | (fWantSend ? EPOLLOUT : 0);
+                event.data.fd = pnode->hSocket;
+                if (epoll_ctl(epollFd, pnode->fSocketRegistered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, pnode->hSocket, &event) == 0) {
+                    pnode->fSocketRegistered = true;
+                    pnode->fSocketWantSend = fWantSend;
+                } else {
+                    LogPrintf("epoll_ctl failed for peer=%d: %s\n", pnode->id, NetworkErrorString(errno));
+                }
+            }
+
+            if (pnode->fSocketRecvReady && !pnode->fPauseRecv) {
+                recv_set.insert(pnode->hSocket);
+                fRecvPending = true;
+            }
+        }
+    }
+
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    wakeupSelectNeeded = true;
+    int nEvents = epoll_wait(epollFd, events, MAX_EPOLL_EVENTS, fRecvPending ? 0 : SELECT_TIMEOUT_MILLISECONDS);
+    wakeupSelectNeeded = false;
+    if (interruptNet)
+        return;
+
+    if (nEvents < 0) {
+        if (errno != EINTR) {
+            LogPrintf("epoll_wait error %s\n", NetworkErrorString(errno));
+            interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        }
+        return;
+    }
+
+    for (int i = 0; i < nEvents; i++) {
+        SOCKET hSocket = events[i].data.fd;
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+            error_set.insert(hSocket);
+        }
+        if (events[i].events & EPOLLIN) {
+            recv_set.insert(hSocket);
+        }
+        if (events[i].events & EPOLLOUT) {
+            send_set.insert(hSocket);
+        }
+    }
+}
+#endif
+
 void CConnman::ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
@@ -1250,102 +1484,23 @@ void CConnman::ThreadSocketHandler()
         //
         // Find which sockets have data to receive
         //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
-
-#ifndef WIN32
-        // We add a pipe to the read set so that the select() call can be woken up from the outside
-        // This is done when data is available for sending and at the same time optimistic sending was disabled
-        // when pushing the data.
-        // This is currently only implemented for POSIX compliant systems. This means that Windows will fall back to
-        // timing out after 50ms and then trying to send. This is ok as we assume that heavy-load daemons are usually
-        // run on Linux and friends.
-        FD_SET(wakeupPipe[0], &fdsetRecv);
-        hSocketMax = std::max(hSocketMax, (SOCKET)wakeupPipe[0]);
-        have_fds = true;
+        std::set<SOCKET> recv_set;
+        std::set<SOCKET> send_set;
+        std::set<SOCKET> error_set;
+#ifdef HAVE_SYS_EPOLL_H
+        if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+            SocketEventsEpoll(recv_set, send_set, error_set);
+        } else
 #endif
-
-        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = std::max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
-
         {
-            LOCK(cs_vNodes);
-            BOOST_FOREACH(CNode* pnode, vNodes)
-            {
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is space left in the receive buffer, select() for
-                //   receiving data.
-                // * Hand off all complete messages to the processor, to be handled without
-                //   blocking here.
-
-                bool select_recv = !pnode->fPauseRecv;
-                bool select_send;
-                {
-                    LOCK(pnode->cs_vSend);
-                    select_send = !pnode->vSendMsg.empty();
-                }
-
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = std::max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
-                if (select_send) {
-                    FD_SET(pnode->hSocket, &fdsetSend);
-                    continue;
-                }
-                if (select_recv) {
-                    FD_SET(pnode->hSocket, &fdsetRecv);
-                }
-            }
+            SocketEventsSelect(recv_set, send_set, error_set);
         }
-
-        wakeupSelectNeeded = true;
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
-        wakeupSelectNeeded = false;
         if (interruptNet)
             return;
 
-        if (nSelect == SOCKET_ERROR)
-        {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
-                return;
-        }
-
 #ifndef WIN32
         // drain the wakeup pipe
-        if (FD_ISSET(wakeupPipe[0], &fdsetRecv)) {
+        if (recv_set.count(wakeupPipe[0])) {
             LogPrint("net", "woke up select()\n");
             char buf[128];
             while (true) {
@@ -1362,7 +1517,7 @@ void CConnman::ThreadSocketHandler()
         //
         BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            if (hListenSocket.socket != INVALID_SOCKET && recv_set.count(hListenSocket.socket))
             {
                 AcceptConnection(hListenSocket);
             }
@@ -1387,9 +1542,14 @@ void CConnman::ThreadSocketHandler()
                 LOCK(pnode->cs_hSocket);
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
-                recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
-                sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
-                errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
+                recvSet = recv_set.count(pnode->hSocket);
+                sendSet = send_set.count(pnode->hSocket);
+                errorSet = error_set.count(pnode->hSocket);
+            }
+            if (socketEventsMode == SOCKETEVENTS_EPOLL && recvSet) {
+                // remember the edge, the data is read once receiving isn't paused anymore
+                pnode->fSocketRecvReady = true;
+                recvSet = !pnode->fPauseRecv;
             }
             if (recvSet || errorSet)
             {
@@ -1404,6 +1564,8 @@ void CConnman::ThreadSocketHandler()
                                 continue;
                             nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
                         }
+                        // a full buffer might have left more data in the socket
+                        pnode->fSocketRecvReady = nBytes == (int)sizeof(pchBuf);
                         if (nBytes > 0)
                         {
                             bool notify = false;
@@ -2050,10 +2212,13 @@ void CConnman::ThreadOpenMasternodeConnections()
     if (IsArgSet("-connect") && mapMultiArgs.at("-connect").size() > 0)
         return;
 
+    bool fMorePending = false;
     while (!interruptNet)
     {
-        if (!interruptNet.sleep_for(std::chrono::milliseconds(1000)))
+        // while quorum connections are outstanding, open them back to back instead of one per second
+        if (!fMorePending && !interruptNet.sleep_for(std::chrono::milliseconds(1000)))
             return;
+        fMorePending = false;
 
         std::set<CService> connectedNodes;
         std::set<uint256> connectedProRegTxHashes;
@@ -2079,21 +2244,21 @@ void CConnman::ThreadOpenMasternodeConnections()
             LOCK2(cs_vNodes, cs_vPendingMasternodes);
 
             std::vector<CService> pending;
-            for (const auto& group : masternodeQuorumNodes) {
-                for (const auto& proRegTxHash : group.second) {
-                    auto dmn = mnList.GetMN(proRegTxHash);
-                    if (!dmn) {
+            // the wanted masternodes of all quorums, each one only once even if it's wanted by multiple quorums
+            for (const auto& p : masternodeQuorumNodeRefs) {
+                const auto& proRegTxHash = p.first;
+                auto dmn = mnList.GetMN(proRegTxHash);
+                if (!dmn) {
+                    continue;
+                }
+                const auto& addr2 = dmn->pdmnState->addr;
+                if (!connectedNodes.count(addr2) && !IsMasternodeOrDisconnectRequested(addr2) && !connectedProRegTxHashes.count(proRegTxHash)) {
+                    auto addrInfo = addrman.GetAddressInfo(addr2);
+                    // back off trying connecting to an address if we already tried recently
+                    if (addrInfo.IsValid() && nANow - addrInfo.nLastTry < 60) {
                         continue;
                     }
-                    const auto& addr2 = dmn->pdmnState->addr;
-                    if (!connectedNodes.count(addr2) && !IsMasternodeOrDisconnectRequested(addr2) && !connectedProRegTxHashes.count(proRegTxHash)) {
-                        auto addrInfo = addrman.GetAddressInfo(addr2);
-                        // back off trying connecting to an address if we already tried recently
-                        if (addrInfo.IsValid() && nANow - addrInfo.nLastTry < 60) {
-                            continue;
-                        }
-                        pending.emplace_back(addr2);
-                    }
+                    pending.emplace_back(addr2);
                 }
             }
 
@@ -2112,17 +2277,20 @@ void CConnman::ThreadOpenMasternodeConnections()
 
             std::random_shuffle(pending.begin(), pending.end());
             addr = pending.front();
+            fMorePending = pending.size() > 1;
         }
 
         OpenMasternodeConnection(CAddress(addr, NODE_NETWORK));
         // should be in the list now if connection was opened
-        ForNode(addr, CConnman::AllNodes, [&](CNode* pnode) {
+        bool fConnected = ForNode(addr, CConnman::AllNodes, [&](CNode* pnode) {
             if (pnode->fDisconnect) {
                 return false;
             }
             grant.MoveTo(pnode->grantMasternodeOutbound);
             return true;
         });
+        // failed attempts wait for the next round, so unreachable masternodes don't make this spin
+        fMorePending = fMorePending && fConnected;
     }
 }
 
@@ -2411,6 +2579,7 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) :
     nMaxOutbound = 0;
     nMaxAddnode = 0;
     nBestHeight = 0;
+    socketEventsMode = SOCKETEVENTS_SELECT;
     clientInterface = NULL;
     flagInterruptMsgProc = false;
 }
@@ -2440,6 +2609,8 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     nMaxOutboundLimit = connOptions.nMaxOutboundLimit;
     nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
 
+    socketEventsMode = connOptions.socketEventsMode;
+
     SetBestHeight(connOptions.nBestHeight);
 
     clientInterface = connOptions.uiInterface;
@@ -2523,6 +2694,35 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     }
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd == -1) {
+            strNodeError = strprintf("epoll_create1 failed: %s", NetworkErrorString(errno));
+            return false;
+        }
+        // the wakeup pipe and the listening sockets are level-triggered
+        std::vector<SOCKET> vSockets;
+#ifndef WIN32
+        if (wakeupPipe[0] != -1) {
+            vSockets.push_back(wakeupPipe[0]);
+        }
+#endif
+        for (const ListenSocket& hListenSocket : vhListenSocket) {
+            vSockets.push_back(hListenSocket.socket);
+        }
+        for (SOCKET hSocket : vSockets) {
+            struct epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.fd = hSocket;
+            if (epoll_ctl(epollFd, EPOLL_CTL_ADD, hSocket, &event) != 0) {
+                strNodeError = strprintf("epoll_ctl failed: %s", NetworkErrorString(errno));
+                return false;
+            }
+        }
+    }
+#endif
+
     // Send and receive from sockets, accept connections
     threadSocketHandler = std::thread(&TraceThread<std::function<void()> >, "net", std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
 
@@ -2545,7 +2745,8 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
 
     // Dump network addresses
-    scheduler.scheduleEvery(std::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL * 1000);
+    scheduler.scheduleEvery(std::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL * 1000,
+                            CScheduler::PRIORITY_LOW, "dumpdata");
 
     return true;
 }
@@ -2655,6 +2856,10 @@ void CConnman::Stop()
     if (wakeupPipe[1] != -1) close(wakeupPipe[1]);
     wakeupPipe[0] = wakeupPipe[1] = -1;
 #endif
+#ifdef HAVE_SYS_EPOLL_H
+    if (epollFd != -1) close(epollFd);
+    epollFd = -1;
+#endif
 }
 
 void CConnman::DeleteNode(CNode* pnode)
@@ -2747,6 +2952,9 @@ bool CConnman::AddMasternodeQuorumNodes(Consensus::LLMQType llmqType, const uint
         return false;
     }
     masternodeQuorumNodes.emplace(std::make_pair(llmqType, quorumHash), proTxHashes);
+    for (const auto& proTxHash : proTxHashes) {
+        masternodeQuorumNodeRefs[proTxHash]++;
+    }
     return true;
 }
 
@@ -2794,7 +3002,18 @@ std::set<NodeId> CConnman::GetMasternodeQuorumNodes(Consensus::LLMQType llmqType
 void CConnman::RemoveMasternodeQuorumNodes(Consensus::LLMQType llmqType, const uint256& quorumHash)
 {
     LOCK(cs_vPendingMasternodes);
-    masternodeQuorumNodes.erase(std::make_pair(llmqType, quorumHash));
+    auto it = masternodeQuorumNodes.find(std::make_pair(llmqType, quorumHash));
+    if (it == masternodeQuorumNodes.end()) {
+        return;
+    }
+    for (const auto& proTxHash : it->second) {
+        auto itRefs = masternodeQuorumNodeRefs.find(proTxHash);
+        if (--itRefs->second == 0) {
+            masternodeQuorumNodeRefs.erase(itRefs);
+        }
+    }
+    // connections which are not wanted anymore are not dropped here, they just lose their protection from eviction
+    masternodeQuorumNodes.erase(it);
 }
 
 bool CConnman::IsMasternodeQuorumNode(const CNode* pnode)
@@ -2813,16 +3032,10 @@ bool CConnman::IsMasternodeQuorumNode(const CNode* pnode)
     }
 
     LOCK(cs_vPendingMasternodes);
-    for (const auto& p : masternodeQuorumNodes) {
-        if (!pnode->verifiedProRegTxHash.IsNull()) {
-            if (p.second.count(pnode->verifiedProRegTxHash)) {
-                return true;
-            }
-        } else if (!assumedProTxHash.IsNull()) {
-            if (p.second.count(assumedProTxHash)) {
-                return true;
-            }
-        }
+    if (!pnode->verifiedProRegTxHash.IsNull()) {
+        return masternodeQuorumNodeRefs.count(pnode->verifiedProRegTxHash) != 0;
+    } else if (!assumedProTxHash.IsNull()) {
+        return masternodeQuorumNodeRefs.count(assumedProTxHash) != 0;
     }
     return false;
 }
@@ -2878,7 +3091,7 @@ void CConnman::RelayTransaction(const CTransaction& tx)
 {
     uint256 hash = tx.GetHash();
     int nInv = MSG_TX;
-    if (CPrivateSend::GetDSTX(hash)) {
+    if (CPrivateSend::HasDSTX(hash)) {
         nInv = MSG_DSTX;
     } else if (llmq::IsOldInstantSendEnabled() && instantsend.HasTxLockRequest(hash)) {
         nInv = MSG_TXLOCK_REQUEST;
@@ -2906,6 +3119,21 @@ void CConnman::RelayInv(CInv &inv, const int minProtoVersion) {
             pnode->PushInventory(inv);
 }
 
+void CConnman::RelayInvs(const std::vector<CInv>& vInv, const int minProtoVersion)
+{
+    if (vInv.empty()) {
+        return;
+    }
+    LOCK(cs_vNodes);
+    for (const auto& pnode : vNodes) {
+        if (pnode->nVersion < minProtoVersion)
+            continue;
+        for (const auto& inv : vInv) {
+            pnode->PushInventory(inv);
+        }
+    }
+}
+
 void CConnman::RelayInvFiltered(CInv &inv, const CTransaction& relatedTx, const int minProtoVersion)
 {
     LOCK(cs_vNodes);
@@ -2936,7 +3164,7 @@ void CConnman::RelayInvFiltered(CInv &inv, const uint256& relatedTxHash, const i
 
 void CConnman::RemoveAskFor(const uint256& hash)
 {
-    mapAlreadyAskedFor.erase(hash);
+    requestTracker.Remove(hash);
 
     LOCK(cs_vNodes);
     for (const auto& pnode : vNodes) {
@@ -3040,6 +3268,12 @@ uint64_t CConnman::GetOutboundTargetBytesLeft()
     return (nMaxOutboundTotalBytesSentInCycle >= nMaxOutboundLimit) ? 0 : nMaxOutboundLimit - nMaxOutboundTotalBytesSentInCycle;
 }
 
+mapMsgCmdSize CConnman::GetTotalBytesSentPerMsgCmd()
+{
+    LOCK(cs_totalBytesSent);
+    return mapTotalBytesSentPerMsgCmd;
+}
+
 uint64_t CConnman::GetTotalBytesRecv()
 {
     LOCK(cs_totalBytesRecv);
@@ -3151,8 +3385,47 @@ CNode::~CNode()
         delete pfilter;
 }
 
+int64_t CRequestTracker::ScheduleRequest(const uint256& hash, int64_t nRetryDelay)
+{
+    // Make sure not to reuse time indexes to keep things in the same order
+    int64_t nNow = GetTimeMicros() - 1000000;
+    int64_t nLast = nLastTime.load();
+    int64_t nTime;
+    do {
+        nTime = std::max(nNow, nLast + 1);
+    } while (!nLastTime.compare_exchange_weak(nLast, nTime));
+
+    Shard& shard = GetShard(hash);
+    LOCK(shard.cs);
+    auto it = shard.mapRequestTime.find(hash);
+    int64_t nRequestTime = it != shard.mapRequestTime.end() ? it->second : 0;
+
+    // Each retry is nRetryDelay after the last
+    nRequestTime = std::max(nRequestTime + nRetryDelay, nTime);
+    if (it != shard.mapRequestTime.end())
+        shard.mapRequestTime.update(it, nRequestTime);
+    else
+        shard.mapRequestTime.insert(std::make_pair(hash, nRequestTime));
+    return nRequestTime;
+}
+
+void CRequestTracker::Remove(const uint256& hash)
+{
+    Shard& shard = GetShard(hash);
+    LOCK(shard.cs);
+    shard.mapRequestTime.erase(hash);
+}
+
+bool CRequestTracker::IsScheduled(const uint256& hash)
+{
+    Shard& shard = GetShard(hash);
+    LOCK(shard.cs);
+    return shard.mapRequestTime.count(hash) != 0;
+}
+
 void CNode::AskFor(const CInv& inv, int64_t doubleRequestDelay)
 {
+    LOCK(cs_askFor);
     if (vecAskFor.size() > MAPASKFOR_MAX_SZ || setAskFor.size() > SETASKFOR_MAX_SZ) {
         int64_t nNow = GetTime();
         if(nNow - nLastWarningTime > WARNING_INTERVAL) {
@@ -3172,59 +3445,103 @@ void CNode::AskFor(const CInv& inv, int64_t doubleRequestDelay)
 
     // We're using vecAskFor as a priority queue,
     // the key is the earliest time the request can be sent
-    int64_t nRequestTime;
-    auto it = mapAlreadyAskedFor.find(inv.hash);
-    if (it != mapAlreadyAskedFor.end())
-        nRequestTime = it->second;
-    else
-        nRequestTime = 0;
+    int64_t nRequestTime = requestTracker.ScheduleRequest(inv.hash, doubleRequestDelay);
 
     LogPrint("net", "askfor %s  %d (%s) peer=%d\n", inv.ToString(), nRequestTime, DateTimeStrFormat("%H:%M:%S", nRequestTime/1000000), id);
 
-    // Make sure not to reuse time indexes to keep things in the same order
-    int64_t nNow = GetTimeMicros() - 1000000;
-    static int64_t nLastTime;
-    ++nLastTime;
-    nNow = std::max(nNow, nLastTime);
-    nLastTime = nNow;
-
-    // Each retry is 2 minutes after the last
-    nRequestTime = std::max(nRequestTime + doubleRequestDelay, nNow);
-    if (it != mapAlreadyAskedFor.end())
-        mapAlreadyAskedFor.update(it, nRequestTime);
-    else
-        mapAlreadyAskedFor.insert(std::make_pair(inv.hash, nRequestTime));
     vecAskFor.emplace_back(nRequestTime, inv);
 }
 
 void CNode::RemoveAskFor(const uint256& hash)
 {
+    LOCK(cs_askFor);
     if (setAskFor.erase(hash)) {
+        mapAskForInFlight.erase(hash);
         vecAskFor.erase(std::remove_if(vecAskFor.begin(), vecAskFor.end(), [&](const std::pair<int64_t, CInv>& item) {
             return item.second.hash == hash;
         }), vecAskFor.end());
     }
 }
 
+size_t CNode::GetAskForSize()
+{
+    LOCK(cs_askFor);
+    return setAskFor.size();
+}
+
+void CNode::PopAskFor(int64_t nNow, std::vector<CInv>& vInvRet)
+{
+    LOCK(cs_askFor);
+
+    // Forget requests the peer didn't answer, so that it can announce the items again
+    while (!dequeAskForInFlight.empty() && dequeAskForInFlight.front().first <= nNow) {
+        const uint256& hash = dequeAskForInFlight.front().second;
+        auto it = mapAskForInFlight.find(hash);
+        // a later request of the same item has its own entry
+        if (it != mapAskForInFlight.end() && it->second == dequeAskForInFlight.front().first) {
+            LogPrint("net", "CNode::PopAskFor -- request of %s timed out, peer=%d\n", hash.ToString(), id);
+            mapAskForInFlight.erase(it);
+            setAskFor.erase(hash);
+        }
+        dequeAskForInFlight.pop_front();
+    }
+
+    std::sort(vecAskFor.begin(), vecAskFor.end());
+    auto it = vecAskFor.begin();
+    while (it != vecAskFor.end() && it->first <= nNow && mapAskForInFlight.size() + vInvRet.size() < MAX_ASKFOR_IN_FLIGHT) {
+        vInvRet.emplace_back(it->second);
+        ++it;
+    }
+    vecAskFor.erase(vecAskFor.begin(), it);
+}
+
+void CNode::MarkAskedFor(const CInv& inv, int64_t nNow, bool fRequested)
+{
+    LOCK(cs_askFor);
+    if (!fRequested) {
+        setAskFor.erase(inv.hash);
+        return;
+    }
+    int64_t nTimeout = nNow + ASKFOR_IN_FLIGHT_TIMEOUT;
+    mapAskForInFlight[inv.hash] = nTimeout;
+    dequeAskForInFlight.emplace_back(nTimeout, inv.hash);
+}
+
 bool CConnman::NodeFullyConnected(const CNode* pnode)
 {
     return pnode && pnode->fSuccessfullyConnected && !pnode->fDisconnect;
 }
 
-void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg, bool allowOptimisticSend)
+CSharedNetMsg::CSharedNetMsg(CSerializedNetMsg&& msg) : command(std::move(msg.command))
 {
-    size_t nMessageSize = msg.data.size();
-    size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
-    LogPrint("net", "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->id);
-
     std::vector<unsigned char> serializedHeader;
     serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
-    uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
-    CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), nMessageSize);
+    uint256 hash = Hash(msg.data.data(), msg.data.data() + msg.data.size());
+    CMessageHeader hdr(Params().MessageStart(), command.c_str(), msg.data.size());
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
     CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
 
+    header = std::make_shared<const std::vector<unsigned char>>(std::move(serializedHeader));
+    data = std::make_shared<const std::vector<unsigned char>>(std::move(msg.data));
+}
+
+void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg, bool allowOptimisticSend)
+{
+    PushMessage(pnode, CSharedNetMsg(std::move(msg)), allowOptimisticSend);
+}
+
+void CConnman::PushMessage(CNode* pnode, const CSharedNetMsg& msg, bool allowOptimisticSend)
+{
+    size_t nMessageSize = msg.data->size();
+    size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
+    LogPrint("net", "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->id);
+
+    {
+        LOCK(cs_totalBytesSent);
+        mapTotalBytesSentPerMsgCmd[msg.command] += nTotalSize;
+    }
+
     size_t nBytesSent = 0;
     {
         LOCK(pnode->cs_vSend);
@@ -3237,9 +3554,9 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg, bool allowOpti
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
+        pnode->vSendMsg.push_back(msg.header);
         if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+            pnode->vSendMsg.push_back(msg.data);
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
@@ -15,6 +15,7 @@
 #include "netaddress.h"
 #include "protocol.h"
 #include "random.h"
+#include "reconciliation.h"
 #include "saltedhasher.h"
 #include "streams.h"
 #include "sync.h"
@@ -23,12 +24,14 @@
 #include "threadinterrupt.h"
 #include "consensus/params.h"
 
+#include <array>
 #include <atomic>
 #include <deque>
 #include <stdint.h>
 #include <thread>
 #include <memory>
 #include <condition_variable>
+#include <unordered_map>
 #include <unordered_set>
 
 #ifndef WIN32
@@ -97,6 +100,10 @@ static const bool DEFAULT_UPNP = false;
 static const size_t MAPASKFOR_MAX_SZ = MAX_INV_SZ;
 /** The maximum number of entries in setAskFor (larger due to getdata latency)*/
 static const size_t SETASKFOR_MAX_SZ = 2 * MAX_INV_SZ;
+/** The maximum number of getdata requests of non-block items a peer didn't answer yet */
+static const size_t MAX_ASKFOR_IN_FLIGHT = MAX_INV_SZ / 10;
+/** Time in microseconds after which an unanswered getdata request of a non-block item is forgotten */
+static const int64_t ASKFOR_IN_FLIGHT_TIMEOUT = 5 * 60 * 1000000;
 /** The maximum number of peer connections to maintain. */
 static const unsigned int DEFAULT_MAX_PEER_CONNECTIONS = 125;
 /** The default for -maxuploadtarget. 0 = Unlimited */
@@ -110,6 +117,13 @@ static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
 
+/** Default for -socketevents, the mechanism used to wait for socket events */
+#ifdef HAVE_SYS_EPOLL_H
+static const char* const DEFAULT_SOCKETEVENTS = "epoll";
+#else
+static const char* const DEFAULT_SOCKETEVENTS = "select";
+#endif
+
 static const ServiceFlags REQUIRED_SERVICES = NODE_NETWORK;
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
@@ -129,6 +143,47 @@ class CTransaction;
 class CNodeStats;
 class CClientUIInterface;
 
+typedef std::map<std::string, uint64_t> mapMsgCmdSize; //command, total bytes
+
+/** Processing statistics of the messages of one command */
+struct CMessageProcessingStats
+{
+    // histogram buckets are decades starting at 100us: <100us, <1ms, <10ms, <100ms, <1s, >=1s
+    static const int HISTOGRAM_BUCKETS = 6;
+
+    uint64_t nCount{0};
+    uint64_t nBytes{0};
+    int64_t nTimeMicros{0};
+    int64_t nMaxTimeMicros{0};
+    // time between receiving a message and starting to process it
+    int64_t nQueueDelayMicros{0};
+    int64_t nMaxQueueDelayMicros{0};
+    std::array<uint64_t, HISTOGRAM_BUCKETS> vTimeHistogram{};
+    std::array<uint64_t, HISTOGRAM_BUCKETS> vQueueDelayHistogram{};
+
+    static int GetHistogramBucket(int64_t nMicros)
+    {
+        int nBucket = 0;
+        for (int64_t nLimit = 100; nBucket < HISTOGRAM_BUCKETS - 1 && nMicros >= nLimit; nLimit *= 10) {
+            nBucket++;
+        }
+        return nBucket;
+    }
+
+    void Add(uint64_t nMessageBytes, int64_t nMessageTimeMicros, int64_t nMessageQueueDelayMicros)
+    {
+        nCount++;
+        nBytes += nMessageBytes;
+        nTimeMicros += nMessageTimeMicros;
+        nMaxTimeMicros = std::max(nMaxTimeMicros, nMessageTimeMicros);
+        nQueueDelayMicros += nMessageQueueDelayMicros;
+        nMaxQueueDelayMicros = std::max(nMaxQueueDelayMicros, nMessageQueueDelayMicros);
+        vTimeHistogram[GetHistogramBucket(nMessageTimeMicros)]++;
+        vQueueDelayHistogram[GetHistogramBucket(nMessageQueueDelayMicros)]++;
+    }
+};
+typedef std::map<std::string, CMessageProcessingStats> mapMsgCmdProcessingStats;
+
 struct CSerializedNetMsg
 {
     CSerializedNetMsg() = default;
@@ -142,6 +197,22 @@ struct CSerializedNetMsg
     std::string command;
 };
 
+/**
+ * A message with its header serialized once. Header and payload are immutable and shared by all send queues
+ * the message is pushed to, so the same message can be sent to many peers without serializing or copying it again.
+ */
+struct CSharedNetMsg
+{
+    CSharedNetMsg() = default;
+    explicit CSharedNetMsg(CSerializedNetMsg&& msg);
+
+    std::string command;
+    std::shared_ptr<const std::vector<unsigned char>> header;
+    std::shared_ptr<const std::vector<unsigned char>> data;
+
+    bool IsNull() const { return header == nullptr; }
+};
+
 
 class CConnman
 {
@@ -154,6 +225,11 @@ public:
         CONNECTIONS_ALL = (CONNECTIONS_IN | CONNECTIONS_OUT),
     };
 
+    enum SocketEventsMode {
+        SOCKETEVENTS_SELECT = 0,
+        SOCKETEVENTS_EPOLL = 1,
+    };
+
     struct Options
     {
         ServiceFlags nLocalServices = NODE_NONE;
@@ -168,6 +244,7 @@ public:
         unsigned int nReceiveFloodSize = 0;
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
+        SocketEventsMode socketEventsMode = SOCKETEVENTS_SELECT;
     };
     CConnman(uint64_t seed0, uint64_t seed1);
     ~CConnman();
@@ -220,6 +297,7 @@ public:
     bool IsMasternodeOrDisconnectRequested(const CService& addr);
 
     void PushMessage(CNode* pnode, CSerializedNetMsg&& msg, bool allowOptimisticSend = DEFAULT_ALLOW_OPTIMISTIC_SEND);
+    void PushMessage(CNode* pnode, const CSharedNetMsg& msg, bool allowOptimisticSend = DEFAULT_ALLOW_OPTIMISTIC_SEND);
 
     template<typename Condition, typename Callable>
     bool ForEachNodeContinueIf(const Condition& cond, Callable&& func)
@@ -327,6 +405,7 @@ public:
 
     void RelayTransaction(const CTransaction& tx);
     void RelayInv(CInv &inv, const int minProtoVersion = MIN_PEER_PROTO_VERSION);
+    void RelayInvs(const std::vector<CInv>& vInv, const int minProtoVersion = MIN_PEER_PROTO_VERSION);
     void RelayInvFiltered(CInv &inv, const CTransaction &relatedTx, const int minProtoVersion = MIN_PEER_PROTO_VERSION);
     // This overload will not update node filters,  so use it only for the cases when other messages will update related transaction data in filters
     void RelayInvFiltered(CInv &inv, const uint256 &relatedTxHash, const int minProtoVersion = MIN_PEER_PROTO_VERSION);
@@ -413,6 +492,8 @@ public:
 
     uint64_t GetTotalBytesRecv();
     uint64_t GetTotalBytesSent();
+    /** Bytes queued for sending to all peers, per command */
+    mapMsgCmdSize GetTotalBytesSentPerMsgCmd();
 
     void SetBestHeight(int height);
     int GetBestHeight() const;
@@ -438,6 +519,10 @@ private:
     void ThreadOpenConnections();
     void ThreadMessageHandler();
     void AcceptConnection(const ListenSocket& hListenSocket);
+    void SocketEventsSelect(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
+#ifdef HAVE_SYS_EPOLL_H
+    void SocketEventsEpoll(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
+#endif
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
     void ThreadOpenMasternodeConnections();
@@ -480,6 +565,7 @@ private:
     CCriticalSection cs_totalBytesSent;
     uint64_t nTotalBytesRecv;
     uint64_t nTotalBytesSent;
+    mapMsgCmdSize mapTotalBytesSentPerMsgCmd;
 
     // outbound limit & stats
     uint64_t nMaxOutboundTotalBytesSentInCycle;
@@ -508,6 +594,7 @@ private:
     CCriticalSection cs_vAddedNodes;
     std::vector<CService> vPendingMasternodes;
     std::map<std::pair<Consensus::LLMQType, uint256>, std::set<uint256>> masternodeQuorumNodes; // protected by cs_vPendingMasternodes
+    std::map<uint256, int> masternodeQuorumNodeRefs; // protected by cs_vPendingMasternodes, number of quorums in masternodeQuorumNodes which want each masternode
     mutable CCriticalSection cs_vPendingMasternodes;
     std::vector<CNode*> vNodes;
     std::list<CNode*> vNodesDisconnected;
@@ -545,6 +632,10 @@ private:
 #ifndef WIN32
     /** a pipe which is added to select() calls to wakeup before the timeout */
     int wakeupPipe[2]{-1,-1};
+#endif
+    SocketEventsMode socketEventsMode;
+#ifdef HAVE_SYS_EPOLL_H
+    int epollFd{-1};
 #endif
     std::atomic<bool> wakeupSelectNeeded{false};
 
@@ -620,7 +711,35 @@ extern bool fDiscover;
 extern bool fListen;
 extern bool fRelayTxes;
 
-extern unordered_limitedmap<uint256, int64_t, StaticSaltedHasher> mapAlreadyAskedFor;
+/**
+ * Keeps track of when inventory items may be requested next, shared by all peers. The first peer announcing an
+ * item is asked right away, each further one only after the request to the previous one timed out. The items are
+ * split over shards with their own locks, so this doesn't need cs_main and doesn't contend much.
+ */
+class CRequestTracker
+{
+private:
+    static const size_t SHARD_COUNT = 16;
+
+    struct Shard
+    {
+        CCriticalSection cs;
+        unordered_limitedmap<uint256, int64_t, StaticSaltedHasher> mapRequestTime{MAX_INV_SZ / SHARD_COUNT, MAX_INV_SZ * 2 / SHARD_COUNT};
+    };
+    std::array<Shard, SHARD_COUNT> shards;
+    std::atomic<int64_t> nLastTime{0};
+
+    Shard& GetShard(const uint256& hash) { return shards[StaticSaltedHasher()(hash) % SHARD_COUNT]; }
+
+public:
+    /** Schedule another request of an item, returns the time after which it may be requested from the peer */
+    int64_t ScheduleRequest(const uint256& hash, int64_t nRetryDelay);
+    /** Forget an item, it was received or isn't wanted anymore */
+    void Remove(const uint256& hash);
+    bool IsScheduled(const uint256& hash);
+};
+
+extern CRequestTracker requestTracker;
 
 /** Subversion as sent to the P2P network in `version` messages */
 extern std::string strSubVersion;
@@ -632,7 +751,6 @@ struct LocalServiceInfo {
 
 extern CCriticalSection cs_mapLocalHost;
 extern std::map<CNetAddr, LocalServiceInfo> mapLocalHost;
-typedef std::map<std::string, uint64_t> mapMsgCmdSize; //command, total bytes
 
 class CNodeStats
 {
@@ -654,6 +772,9 @@ public:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     uint64_t nRecvBytes;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
+    mapMsgCmdProcessingStats mapProcessingStatsPerMsgCmd;
+    size_t nProcessQueueMsgs;
+    size_t nProcessQueueSize;
     bool fWhitelisted;
     double dPingTime;
     double dPingWait;
@@ -721,7 +842,7 @@ public:
     size_t nSendSize; // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<std::vector<unsigned char>> vSendMsg;
+    std::deque<std::shared_ptr<const std::vector<unsigned char>>> vSendMsg;
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
     CCriticalSection cs_vRecv;
@@ -779,11 +900,20 @@ public:
 
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+
+    // Only used by the socket handler thread with -socketevents=epoll. Reads are edge-triggered, so data left
+    // in the socket (because the buffer was too small or receiving was paused) doesn't result in another event.
+    bool fSocketRegistered{false};
+    bool fSocketWantSend{false};
+    bool fSocketRecvReady{false};
 protected:
 
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
 
+    CCriticalSection cs_processingStats;
+    mapMsgCmdProcessingStats mapProcessingStatsPerMsgCmd;
+
 public:
     uint256 hashContinue;
     std::atomic<int> nStartingHeight;
@@ -808,14 +938,24 @@ public:
     // List of non-tx/non-block inventory items
     std::vector<CInv> vInventoryOtherToSend;
     CCriticalSection cs_inventory;
+    // Items to request from the peer, those which were requested but not received yet stay in setAskFor.
+    // All protected by cs_askFor
+    CCriticalSection cs_askFor;
     std::unordered_set<uint256, StaticSaltedHasher> setAskFor;
     std::vector<std::pair<int64_t, CInv>> vecAskFor;
+    std::unordered_map<uint256, int64_t, StaticSaltedHasher> mapAskForInFlight;
+    std::deque<std::pair<int64_t, uint256>> dequeAskForInFlight;
     int64_t nNextInvSend;
     // Used for headers announcements - unfiltered blocks to relay
     // Also protected by cs_inventory
     std::vector<uint256> vBlockHashesToAnnounce;
     // Used for BIP35 mempool sending, also protected by cs_inventory
     bool fSendMempool;
+    // Set reconciliation of tx and governance vote announcements, only used if both sides sent SENDRECON.
+    // Also protected by cs_inventory
+    std::unique_ptr<CReconciliationState> reconState;
+    // Salt we sent in SENDRECON, 0 if we didn't send it
+    std::atomic<uint64_t> nReconSalt{0};
 
     // Block and TXN accept times
     std::atomic<int64_t> nLastBlockTime;
@@ -844,6 +984,8 @@ public:
     uint256 receivedMNAuthChallenge;
     uint256 verifiedProRegTxHash;
     uint256 verifiedPubKeyHash;
+    // set while a received MNAUTH waits for its batched signature verification
+    bool fMNAuthPending{false};
 
     // If true, we will announce/send him plain recovered sigs (usually true for full nodes)
     std::atomic<bool> fSendRecSigs{false};
@@ -907,6 +1049,8 @@ public:
     //! May not be called more than once
     void SetAddrLocal(const CService& addrLocalIn);
 
+    void AddProcessingStats(const std::string& strCommand, uint64_t nBytes, int64_t nTimeMicros, int64_t nQueueDelayMicros);
+
     CNode* AddRef()
     {
         nRefCount++;
@@ -953,9 +1097,26 @@ public:
         }
     }
 
+    /** Like AddInventoryKnown, but returns false if the peer knew about the object already */
+    bool TryAddInventoryKnown(const uint256& hash)
+    {
+        LOCK(cs_inventory);
+        if (filterInventoryKnown.contains(hash)) {
+            return false;
+        }
+        filterInventoryKnown.insert(hash);
+        return true;
+    }
+
     void PushInventory(const CInv& inv)
     {
         LOCK(cs_inventory);
+        if (reconState && CReconciliationState::IsReconcilable(inv) && !filterInventoryKnown.contains(inv.hash)) {
+            if (reconState->Add(inv)) {
+                LogPrint("net", "PushInventory --  reconcile inv: %s peer=%d\n", inv.ToString(), id);
+                return;
+            }
+        }
         if (inv.type == MSG_TX) {
             if (!filterInventoryKnown.contains(inv.hash)) {
                 LogPrint("net", "PushInventory --  inv: %s peer=%d\n", inv.ToString(), id);
@@ -984,6 +1145,11 @@ public:
 
     void AskFor(const CInv& inv, int64_t doubleRequestDelay = 2 * 60 * 1000000);
     void RemoveAskFor(const uint256& hash);
+    size_t GetAskForSize();
+    /** Take the items which are due to be requested, timed out requests are forgotten */
+    void PopAskFor(int64_t nNow, std::vector<CInv>& vInvRet);
+    /** Remember a sent request, or forget the item if it isn't requested after all */
+    void MarkAskedFor(const CInv& inv, int64_t nNow, bool fRequested);
 
     void CloseSocketDisconnect();
 
@@ -9,6 +9,7 @@
 #include "addrman.h"
 #include "arith_uint256.h"
 #include "blockencodings.h"
+#include "blockfilter.h"
 #include "chainparams.h"
 #include "consensus/validation.h"
 #include "hash.h"
@@ -23,7 +24,9 @@
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "random.h"
+#include "saltedhasher.h"
 #include "tinyformat.h"
+#include "txdb.h"
 #include "txmempool.h"
 #include "ui_interface.h"
 #include "util.h"
@@ -54,6 +57,14 @@
 #include "llmq/quorums_signing.h"
 #include "llmq/quorums_signing_shares.h"
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
 #include <boost/thread.hpp>
 
 #if defined(NDEBUG)
@@ -76,10 +87,18 @@ struct COrphanTx {
     CTransactionRef tx;
     NodeId fromPeer;
     int64_t nTimeExpire;
+    size_t list_pos; // position in g_orphan_list
+    size_t peer_pos; // position in the orphans of fromPeer in mapOrphansByPeer
 };
+typedef std::unordered_map<uint256, COrphanTx, StaticSaltedHasher> OrphanMap;
+// unlike iterators, pointers to the entries stay valid when the map rehashes
+typedef OrphanMap::value_type* OrphanPtr;
 static CCriticalSection g_cs_orphans;
-std::map<uint256, COrphanTx> mapOrphanTransactions GUARDED_BY(g_cs_orphans);
-std::map<COutPoint, std::set<std::map<uint256, COrphanTx>::iterator, IteratorComparator>> mapOrphanTransactionsByPrev GUARDED_BY(g_cs_orphans);
+OrphanMap mapOrphanTransactions GUARDED_BY(g_cs_orphans);
+std::unordered_map<COutPoint, std::set<OrphanPtr, IteratorComparator>, StaticSaltedHasher> mapOrphanTransactionsByPrev GUARDED_BY(g_cs_orphans);
+// all orphans and the orphans of every peer in no particular order, for O(1) random eviction and peer cleanup
+static std::vector<OrphanPtr> g_orphan_list GUARDED_BY(g_cs_orphans);
+static std::map<NodeId, std::vector<OrphanPtr>> mapOrphansByPeer GUARDED_BY(g_cs_orphans);
 void EraseOrphansFor(NodeId peer);
 
 static size_t vExtraTxnForCompactIt GUARDED_BY(g_cs_orphans) = 0;
@@ -95,6 +114,12 @@ static const int STALE_RELAY_AGE_LIMIT = 30 * 24 * 60 * 60;
 /// limiting block relay. Set to one week, denominated in seconds.
 static const int HISTORICAL_BLOCK_AGE = 7 * 24 * 60 * 60;
 
+/// Maximum number of blocks in a getcfilters/getcfheaders request and the
+/// distance of the checkpoints in cfcheckpt, as BIP157 specifies.
+static const uint32_t MAX_GETCFILTERS_SIZE = 1000;
+static const uint32_t MAX_GETCFHEADERS_SIZE = 2000;
+static const int CFCHECKPT_INTERVAL = 1000;
+
 // Internal stuff
 namespace {
     /** Number of nodes with fSyncStarted. */
@@ -452,6 +477,10 @@ void MaybeSetPeerAsAnnouncingHeaderAndIDs(NodeId nodeid, CConnman& connman) {
             }
         }
         connman.ForNode(nodeid, [&connman](CNode* pfrom){
+            if (IsMasternodePushRelayEnabled() && IsVerifiedMasternodePeer(pfrom)) {
+                // masternode peers announce with compact blocks anyway (see CMNAuth), they don't take one of the 3 slots
+                return true;
+            }
             bool fAnnounceUsingCMPCTBLOCK = false;
             uint64_t nCMPCTBLOCKVersion = 1;
             if (lNodesAnnouncingHeaderAndIDs.size() >= 3) {
@@ -659,10 +688,14 @@ bool AddOrphanTx(const CTransactionRef& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRE
         return false;
     }
 
-    auto ret = mapOrphanTransactions.emplace(hash, COrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME});
+    std::vector<OrphanPtr>& vecPeerOrphans = mapOrphansByPeer[peer];
+    auto ret = mapOrphanTransactions.emplace(hash, COrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME, g_orphan_list.size(), vecPeerOrphans.size()});
     assert(ret.second);
+    OrphanPtr orphan = &(*ret.first);
+    g_orphan_list.push_back(orphan);
+    vecPeerOrphans.push_back(orphan);
     BOOST_FOREACH(const CTxIn& txin, tx->vin) {
-        mapOrphanTransactionsByPrev[txin.prevout].insert(ret.first);
+        mapOrphanTransactionsByPrev[txin.prevout].insert(orphan);
     }
 
     AddToCompactExtraTransactions(tx);
@@ -672,20 +705,42 @@ bool AddOrphanTx(const CTransactionRef& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRE
     return true;
 }
 
+// Remove the entry at pos of an unordered list of orphans by moving the last entry into its place
+template<typename Pos>
+static void EraseFromOrphanList(std::vector<OrphanPtr>& vec, size_t pos, Pos COrphanTx::* posMember)
+{
+    if (pos + 1 != vec.size()) {
+        OrphanPtr last = vec.back();
+        vec[pos] = last;
+        last->second.*posMember = pos;
+    }
+    vec.pop_back();
+}
+
 int static EraseOrphanTx(uint256 hash) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
 {
-    std::map<uint256, COrphanTx>::iterator it = mapOrphanTransactions.find(hash);
+    OrphanMap::iterator it = mapOrphanTransactions.find(hash);
     if (it == mapOrphanTransactions.end())
         return 0;
+    OrphanPtr orphan = &(*it);
     BOOST_FOREACH(const CTxIn& txin, it->second.tx->vin)
     {
         auto itPrev = mapOrphanTransactionsByPrev.find(txin.prevout);
         if (itPrev == mapOrphanTransactionsByPrev.end())
             continue;
-        itPrev->second.erase(it);
+        itPrev->second.erase(orphan);
         if (itPrev->second.empty())
             mapOrphanTransactionsByPrev.erase(itPrev);
     }
+
+    assert(g_orphan_list[it->second.list_pos] == orphan);
+    EraseFromOrphanList(g_orphan_list, it->second.list_pos, &COrphanTx::list_pos);
+    auto itPeer = mapOrphansByPeer.find(it->second.fromPeer);
+    assert(itPeer != mapOrphansByPeer.end() && itPeer->second[it->second.peer_pos] == orphan);
+    EraseFromOrphanList(itPeer->second, it->second.peer_pos, &COrphanTx::peer_pos);
+    if (itPeer->second.empty())
+        mapOrphansByPeer.erase(itPeer);
+
     mapOrphanTransactions.erase(it);
     return 1;
 }
@@ -694,18 +749,29 @@ void EraseOrphansFor(NodeId peer)
 {
     LOCK(g_cs_orphans);
     int nErased = 0;
-    std::map<uint256, COrphanTx>::iterator iter = mapOrphanTransactions.begin();
-    while (iter != mapOrphanTransactions.end())
+    auto itPeer = mapOrphansByPeer.find(peer);
+    if (itPeer != mapOrphansByPeer.end())
     {
-        std::map<uint256, COrphanTx>::iterator maybeErase = iter++; // increment to avoid iterator becoming invalid
-        if (maybeErase->second.fromPeer == peer)
-        {
-            nErased += EraseOrphanTx(maybeErase->second.tx->GetHash());
+        std::vector<uint256> vOrphanErase;
+        for (const OrphanPtr& orphan : itPeer->second) {
+            vOrphanErase.push_back(orphan->first);
+        }
+        for (const uint256& orphanHash : vOrphanErase) {
+            nErased += EraseOrphanTx(orphanHash);
         }
     }
     if (nErased > 0) LogPrint("mempool", "Erased %d orphan tx from peer=%d\n", nErased, peer);
 }
 
+CTransactionRef GetOrphanTx(const uint256& hash)
+{
+    LOCK(g_cs_orphans);
+    auto it = mapOrphanTransactions.find(hash);
+    if (it == mapOrphanTransactions.end())
+        return nullptr;
+    return it->second.tx;
+}
+
 
 unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans)
 {
@@ -718,10 +784,10 @@ unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans)
         // Sweep out expired orphan pool entries:
         int nErased = 0;
         int64_t nMinExpTime = nNow + ORPHAN_TX_EXPIRE_TIME - ORPHAN_TX_EXPIRE_INTERVAL;
-        std::map<uint256, COrphanTx>::iterator iter = mapOrphanTransactions.begin();
+        OrphanMap::iterator iter = mapOrphanTransactions.begin();
         while (iter != mapOrphanTransactions.end())
         {
-            std::map<uint256, COrphanTx>::iterator maybeErase = iter++;
+            OrphanMap::iterator maybeErase = iter++;
             if (maybeErase->second.nTimeExpire <= nNow) {
                 nErased += EraseOrphanTx(maybeErase->second.tx->GetHash());
             } else {
@@ -734,12 +800,15 @@ unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans)
     }
     while (mapOrphanTransactions.size() > nMaxOrphans)
     {
-        // Evict a random orphan:
-        uint256 randomhash = GetRandHash();
-        std::map<uint256, COrphanTx>::iterator it = mapOrphanTransactions.lower_bound(randomhash);
-        if (it == mapOrphanTransactions.end())
-            it = mapOrphanTransactions.begin();
-        EraseOrphanTx(it->first);
+        // Evict a random orphan of the peer with the most orphans, so a single peer flooding us with orphans
+        // only pushes out its own ones. A random orphan of anybody when every peer only has one
+        auto itPeer = std::max_element(mapOrphansByPeer.begin(), mapOrphansByPeer.end(),
+            [](const std::pair<const NodeId, std::vector<OrphanPtr>>& a, const std::pair<const NodeId, std::vector<OrphanPtr>>& b) {
+                return a.second.size() < b.second.size();
+            });
+        const std::vector<OrphanPtr>& vecCandidates = itPeer->second.size() > 1 ? itPeer->second : g_orphan_list;
+        uint256 hash = vecCandidates[GetRand(vecCandidates.size())]->first;
+        EraseOrphanTx(hash);
         ++nEvicted;
     }
     return nEvicted;
@@ -777,6 +846,17 @@ bool IsBanned(NodeId pnode)
     return false;
 }
 
+bool IsMasternodePushRelayEnabled()
+{
+    return fMasternodeMode && GetBoolArg("-mnpushrelay", DEFAULT_MASTERNODE_PUSH_RELAY);
+}
+
+bool IsVerifiedMasternodePeer(CNode* pnode)
+{
+    LOCK(pnode->cs_mnauth);
+    return !pnode->verifiedProRegTxHash.IsNull();
+}
+
 
 
 
@@ -838,10 +918,16 @@ static CCriticalSection cs_most_recent_block;
 static std::shared_ptr<const CBlock> most_recent_block;
 static std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_block;
 static uint256 most_recent_block_hash;
+// the block and compact block messages for most_recent_block, serialized once for all peers
+static CSharedNetMsg most_recent_block_msg;
+static CSharedNetMsg most_recent_compact_block_msg;
 
 void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) {
     std::shared_ptr<const CBlockHeaderAndShortTxIDs> pcmpctblock = std::make_shared<const CBlockHeaderAndShortTxIDs> (*pblock);
     const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    // block serialization doesn't depend on the peer's version, the same messages are sent to every peer
+    CSharedNetMsg blockMsg(msgMaker.Make(NetMsgType::BLOCK, *pblock));
+    CSharedNetMsg cmpctBlockMsg(msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
 
     LOCK(cs_main);
 
@@ -857,10 +943,11 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
         most_recent_block_hash = hashBlock;
         most_recent_block = pblock;
         most_recent_compact_block = pcmpctblock;
+        most_recent_block_msg = blockMsg;
+        most_recent_compact_block_msg = cmpctBlockMsg;
     }
 
-    connman->ForEachNode([this, &pcmpctblock, pindex, &msgMaker, &hashBlock](CNode* pnode) {
-        // TODO: Avoid the repeated-serialization here
+    connman->ForEachNode([this, &cmpctBlockMsg, pindex, &hashBlock](CNode* pnode) {
         if (pnode->fDisconnect)
             return;
         ProcessBlockAvailability(pnode->GetId());
@@ -872,7 +959,7 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
 
             LogPrint("net", "%s sending header-and-ids %s to peer=%d\n", "PeerLogicValidation::NewPoWValidBlock",
                     hashBlock.ToString(), pnode->id);
-            connman->PushMessage(pnode, msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+            connman->PushMessage(pnode, cmpctBlockMsg);
             state.pindexBestHeaderSent = pindex;
         }
     });
@@ -1001,7 +1088,7 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
         }
 
     case MSG_DSTX: {
-        return static_cast<bool>(CPrivateSend::GetDSTX(inv.hash));
+        return CPrivateSend::HasDSTX(inv.hash);
     }
 
     case MSG_GOVERNANCE_OBJECT:
@@ -1068,10 +1155,14 @@ void static ProcessGetBlockData(CNode* pfrom, const Consensus::Params& consensus
     bool send = false;
     std::shared_ptr<const CBlock> a_recent_block;
     std::shared_ptr<const CBlockHeaderAndShortTxIDs> a_recent_compact_block;
+    CSharedNetMsg a_recent_block_msg;
+    CSharedNetMsg a_recent_compact_block_msg;
     {
         LOCK(cs_most_recent_block);
         a_recent_block = most_recent_block;
         a_recent_compact_block = most_recent_compact_block;
+        a_recent_block_msg = most_recent_block_msg;
+        a_recent_compact_block_msg = most_recent_compact_block_msg;
     }
 
     bool need_activate_chain = false;
@@ -1129,7 +1220,10 @@ void static ProcessGetBlockData(CNode* pfrom, const Consensus::Params& consensus
                 assert(!"cannot load block from disk");
             pblock = pblockRead;
         }
-        if (inv.type == MSG_BLOCK)
+        bool fRecentBlock = pblock == a_recent_block && !a_recent_block_msg.IsNull();
+        if (inv.type == MSG_BLOCK && fRecentBlock)
+            connman.PushMessage(pfrom, a_recent_block_msg);
+        else if (inv.type == MSG_BLOCK)
             connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
         else if (inv.type == MSG_FILTERED_BLOCK)
         {
@@ -1165,11 +1259,13 @@ void static ProcessGetBlockData(CNode* pfrom, const Consensus::Params& consensus
             // instead we respond with the full, non-compact block.
             if (CanDirectFetch(consensusParams) && mi->second->nHeight >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH) {
                 if (a_recent_compact_block && a_recent_compact_block->header.GetHash() == mi->second->GetBlockHash()) {
-                    connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
+                    connman.PushMessage(pfrom, a_recent_compact_block_msg);
                 } else {
                     CBlockHeaderAndShortTxIDs cmpctblock(*pblock);
                     connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, cmpctblock));
                 }
+            } else if (fRecentBlock) {
+                connman.PushMessage(pfrom, a_recent_block_msg);
             } else {
                 connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
             }
@@ -1266,37 +1362,43 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
 
             if (!push && inv.type == MSG_GOVERNANCE_OBJECT) {
                 LogPrint("net", "ProcessGetData -- MSG_GOVERNANCE_OBJECT: inv = %s\n", inv.ToString());
-                CDataStream ss(SER_NETWORK, pfrom->GetSendVersion());
+                // serialized straight into the message, without a temporary stream that would be copied again
+                CSerializedNetMsg msg;
+                bool fCompressed = pfrom->nVersion >= GOVERNANCE_COMPRESSION_PROTO_VERSION;
+                msg.command = fCompressed ? NetMsgType::MNGOVERNANCEOBJECTCOMPRESSED : NetMsgType::MNGOVERNANCEOBJECT;
+                CVectorWriter vw(SER_NETWORK, pfrom->GetSendVersion(), msg.data, 0);
                 bool topush = false;
                 {
                     if(governance.HaveObjectForHash(inv.hash)) {
-                        ss.reserve(1000);
-                        if(governance.SerializeObjectForHash(inv.hash, ss)) {
+                        msg.data.reserve(1000);
+                        if(governance.SerializeObjectForHash(inv.hash, vw, fCompressed)) {
                             topush = true;
                         }
                     }
                 }
                 LogPrint("net", "ProcessGetData -- MSG_GOVERNANCE_OBJECT: topush = %d, inv = %s\n", topush, inv.ToString());
                 if(topush) {
-                    connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MNGOVERNANCEOBJECT, ss));
+                    connman.PushMessage(pfrom, std::move(msg));
                     push = true;
                 }
             }
 
             if (!push && inv.type == MSG_GOVERNANCE_OBJECT_VOTE) {
-                CDataStream ss(SER_NETWORK, pfrom->GetSendVersion());
+                CSerializedNetMsg msg;
+                msg.command = NetMsgType::MNGOVERNANCEOBJECTVOTE;
+                CVectorWriter vw(SER_NETWORK, pfrom->GetSendVersion(), msg.data, 0);
                 bool topush = false;
                 {
                     if(governance.HaveVoteForHash(inv.hash)) {
-                        ss.reserve(1000);
-                        if(governance.SerializeVoteForHash(inv.hash, ss)) {
+                        msg.data.reserve(256);
+                        if(governance.SerializeVoteForHash(inv.hash, vw)) {
                             topush = true;
                         }
                     }
                 }
                 if(topush) {
                     LogPrint("net", "ProcessGetData -- pushing: inv = %s\n", inv.ToString());
-                    connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MNGOVERNANCEOBJECTVOTE, ss));
+                    connman.PushMessage(pfrom, std::move(msg));
                     push = true;
                 }
             }
@@ -1407,6 +1509,410 @@ inline void static SendBlockTransactions(const CBlock& block, const BlockTransac
     connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCKTXN, resp));
 }
 
+/**
+ * Checks a BIP157 request and returns the blocks from nStartHeight up to the stop block. Peers asking for filters
+ * which we don't advertise or for a range which isn't in the active chain are disconnected. While the filter index
+ * is still being built, requests are ignored.
+ */
+static bool PrepareBlockFilterRequest(CNode* pfrom, uint8_t nFilterType, uint32_t nStartHeight, const uint256& stopHash,
+                                      uint32_t nMaxSize, std::vector<const CBlockIndex*>& vBlocksRet)
+{
+    if (!(pfrom->GetLocalServices() & NODE_COMPACT_FILTERS) || nFilterType != BLOCK_FILTER_BASIC) {
+        LogPrint("net", "peer %d requested unsupported block filters, disconnecting\n", pfrom->id);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+
+    LOCK(cs_main);
+    if (!fBlockFilterIndex) {
+        LogPrint("net", "ignoring block filter request from peer %d, the index is still being built\n", pfrom->id);
+        return false;
+    }
+    BlockMap::iterator it = mapBlockIndex.find(stopHash);
+    if (it == mapBlockIndex.end() || !chainActive.Contains(it->second)) {
+        LogPrint("net", "peer %d requested block filters up to unknown or stale block %s, disconnecting\n", pfrom->id, stopHash.ToString());
+        pfrom->fDisconnect = true;
+        return false;
+    }
+    const CBlockIndex* pindexStop = it->second;
+    if (nStartHeight > (uint32_t)pindexStop->nHeight || (uint32_t)pindexStop->nHeight - nStartHeight >= nMaxSize) {
+        LogPrint("net", "peer %d requested invalid block filter range %d-%d, disconnecting\n", pfrom->id, nStartHeight, pindexStop->nHeight);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+
+    vBlocksRet.resize(pindexStop->nHeight - nStartHeight + 1);
+    for (const CBlockIndex* pindex = pindexStop; pindex && pindex->nHeight >= (int)nStartHeight; pindex = pindex->pprev) {
+        vBlocksRet[pindex->nHeight - nStartHeight] = pindex;
+    }
+    return true;
+}
+
+static bool SendRejectsAndCheckIfBanned(CNode* pnode, CConnman& connman);
+
+namespace {
+    typedef std::function<void(CNode*, const std::string&, CDataStream&, CConnman&)> ExtensionMessageHandler;
+
+    /** Number of messages of a peer that may be queued in a lane before no more messages of the peer are taken */
+    static const size_t MAX_LANE_QUEUE_PER_PEER = 100;
+
+    /**
+     * Extension messages which don't need to be ordered with block and transaction relay are processed by worker
+     * threads, one per lane, so that slow governance objects or bursts of DKG messages don't delay the message
+     * handler thread. Messages of the same peer are processed in order within a lane.
+     */
+    enum MessageLane {
+        MSG_LANE_INLINE,
+        MSG_LANE_GOVERNANCE,
+        MSG_LANE_PRIVATESEND,
+        MSG_LANE_LLMQ,
+        MSG_LANE_COUNT,
+    };
+
+    struct ExtensionHandlers {
+        MessageLane lane{MSG_LANE_INLINE};
+        std::vector<ExtensionMessageHandler> vHandlers;
+    };
+    typedef std::unordered_map<std::string, ExtensionHandlers> ExtensionHandlerMap;
+
+    /**
+     * Maps the commands handled by the Dash/Historia specific managers to the managers which handle them, so that a
+     * message is only passed to the managers interested in it instead of all of them.
+     */
+    const ExtensionHandlerMap& GetExtensionHandlers()
+    {
+        static const ExtensionHandlerMap mapHandlers = []() {
+            ExtensionHandlerMap m;
+            auto reg = [&m](const std::vector<const char*>& vCommands, MessageLane lane, const ExtensionMessageHandler& handler) {
+                for (const char* strCommand : vCommands) {
+                    m[strCommand].lane = lane;
+                    m[strCommand].vHandlers.emplace_back(handler);
+                }
+            };
+
+#ifdef ENABLE_WALLET
+            reg({NetMsgType::DSQUEUE, NetMsgType::DSSTATUSUPDATE, NetMsgType::DSFINALTX, NetMsgType::DSCOMPLETE}, MSG_LANE_PRIVATESEND,
+                [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+                    privateSendClient.ProcessMessage(pfrom, strCommand, vRecv, connman);
+                });
+#endif // ENABLE_WALLET
+            reg({NetMsgType::DSACCEPT, NetMsgType::DSQUEUE, NetMsgType::DSVIN, NetMsgType::DSSIGNFINALTX}, MSG_LANE_PRIVATESEND,
+                [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+                    privateSendServer.ProcessMessage(pfrom, strCommand, vRecv, connman);
+                });
+            reg({NetMsgType::TXLOCKVOTE}, MSG_LANE_INLINE,
+                [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+                    instantsend.ProcessMessage(pfrom, strCommand, vRecv, connman);
+                });
+            reg({NetMsgType::SPORK, NetMsgType::GETSPORKS}, MSG_LANE_INLINE,
+                [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+                    sporkManager.ProcessSpork(pfrom, strCommand, vRecv, connman);
+                });
+            reg({NetMsgType::SYNCSTATUSCOUNT}, MSG_LANE_INLINE,
+                [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+                    masternodeSync.ProcessMessage(pfrom, strCommand, vRecv);
+                });
+            reg({NetMsgType::MNGOVERNANCESYNC, NetMsgType::MNGOVERNANCEVOTEDIGESTS, NetMsgType::MNGOVERNANCEOBJECT, NetMsgType::MNGOVERNANCEOBJECTCOMPRESSED, NetMsgType::MNGOVERNANCEOBJECTVOTE}, MSG_LANE_GOVERNANCE,
+                [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+                    governance.ProcessMessage(pfrom, strCommand, vRecv, connman);
+                });
+            // processed inline so that the MNAUTH checks and the queuing for the batched signature verification happen
+            // in order with the peer's other messages. The peer's LLMQ messages are held back by ProcessMessages until
+            // the verification finished, so that the masternode is verified before they are processed
+            reg({NetMsgType::MNAUTH}, MSG_LANE_INLINE,
+                [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+                    CMNAuth::ProcessMessage(pfrom, strCommand, vRecv, connman);
+                });
+            reg({NetMsgType::QFCOMMITMENT}, MSG_LANE_LLMQ,
+                [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+                    llmq::quorumBlockProcessor->ProcessMessage(pfrom, strCommand, vRecv, connman);
+                });
+            reg({NetMsgType::QCONTRIB, NetMsgType::QCOMPLAINT, NetMsgType::QJUSTIFICATION, NetMsgType::QPCOMMITMENT, NetMsgType::QWATCH}, MSG_LANE_LLMQ,
+                [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+                    llmq::quorumDKGSessionManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
+                });
+            reg({NetMsgType::QSIGSESANN, NetMsgType::QSIGSHARESINV, NetMsgType::QGETSIGSHARES, NetMsgType::QBSIGSHARES}, MSG_LANE_LLMQ,
+                [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+                    llmq::quorumSigSharesManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
+                });
+            reg({NetMsgType::QSIGREC}, MSG_LANE_LLMQ,
+                [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+                    llmq::quorumSigningManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
+                });
+            reg({NetMsgType::CLSIG}, MSG_LANE_LLMQ,
+                [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+                    llmq::chainLocksHandler->ProcessMessage(pfrom, strCommand, vRecv, connman);
+                });
+            reg({NetMsgType::ISLOCK}, MSG_LANE_LLMQ,
+                [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+                    llmq::quorumInstantSendManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
+                });
+            return m;
+        }();
+        return mapHandlers;
+    }
+
+    /** Processing statistics of all peers, protected by cs_msgProcessingStats */
+    CCriticalSection cs_msgProcessingStats;
+    mapMsgCmdProcessingStats mapMsgProcessingStats;
+
+    void AddMessageProcessingStats(CNode* pfrom, const std::string& strCommand, uint64_t nBytes, int64_t nTimeMicros, int64_t nQueueDelayMicros)
+    {
+        // only known commands, peers could otherwise make the map grow without bounds
+        static const std::unordered_set<std::string> setKnownCommands = []() {
+            const std::vector<std::string>& allMessages = getAllNetMessageTypes();
+            return std::unordered_set<std::string>(allMessages.begin(), allMessages.end());
+        }();
+        if (!setKnownCommands.count(strCommand)) {
+            return;
+        }
+
+        pfrom->AddProcessingStats(strCommand, nBytes, nTimeMicros, nQueueDelayMicros);
+        LOCK(cs_msgProcessingStats);
+        mapMsgProcessingStats[strCommand].Add(nBytes, nTimeMicros, nQueueDelayMicros);
+    }
+
+    /** Worker thread with per peer message queues which are processed round robin */
+    class CMessageLaneWorker
+    {
+    private:
+        struct QueuedMessage {
+            CNode* pnode;
+            std::string strCommand;
+            CDataStream vRecv;
+            int64_t nTimeReceived;
+            const ExtensionHandlers* handlers;
+        };
+
+        const std::string strName;
+        CConnman* connman{nullptr};
+
+        std::mutex cs;
+        std::condition_variable cond;
+        std::map<NodeId, std::deque<QueuedMessage>> mapQueues;
+        // peers with queued messages, in the order they are served
+        std::deque<NodeId> vPeerOrder;
+        bool fRunning{false};
+        std::thread thread;
+
+    public:
+        CMessageLaneWorker(const std::string& _strName) : strName(_strName) {}
+
+        void Start(CConnman& _connman)
+        {
+            std::unique_lock<std::mutex> l(cs);
+            connman = &_connman;
+            fRunning = true;
+            thread = std::thread(&TraceThread<std::function<void()> >, strName.c_str(), std::function<void()>(std::bind(&CMessageLaneWorker::ThreadMain, this)));
+        }
+
+        void Stop()
+        {
+            std::map<NodeId, std::deque<QueuedMessage>> mapDropped;
+            {
+                std::unique_lock<std::mutex> l(cs);
+                if (!fRunning) {
+                    return;
+                }
+                fRunning = false;
+                mapDropped.swap(mapQueues);
+                vPeerOrder.clear();
+            }
+            cond.notify_all();
+            thread.join();
+            for (auto& p : mapDropped) {
+                for (auto& msg : p.second) {
+                    msg.pnode->Release();
+                }
+            }
+        }
+
+        /** Returns false if the worker doesn't run, the message must be processed by the caller then */
+        bool Push(CNode* pnode, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const ExtensionHandlers* handlers)
+        {
+            {
+                std::unique_lock<std::mutex> l(cs);
+                if (!fRunning) {
+                    return false;
+                }
+                auto& queue = mapQueues[pnode->GetId()];
+                if (queue.empty()) {
+                    vPeerOrder.emplace_back(pnode->GetId());
+                }
+                queue.emplace_back(QueuedMessage{pnode->AddRef(), strCommand, std::move(vRecv), nTimeReceived, handlers});
+            }
+            cond.notify_one();
+            return true;
+        }
+
+        bool IsRunning()
+        {
+            std::unique_lock<std::mutex> l(cs);
+            return fRunning;
+        }
+
+        size_t GetQueueSize(NodeId nodeId)
+        {
+            std::unique_lock<std::mutex> l(cs);
+            auto it = mapQueues.find(nodeId);
+            return it != mapQueues.end() ? it->second.size() : 0;
+        }
+
+    private:
+        void ThreadMain()
+        {
+            while (true) {
+                QueuedMessage msg{nullptr, "", CDataStream(SER_NETWORK, PROTOCOL_VERSION), 0, nullptr};
+                bool fWake;
+                {
+                    std::unique_lock<std::mutex> l(cs);
+                    cond.wait(l, [this]() { return !fRunning || !vPeerOrder.empty(); });
+                    if (!fRunning) {
+                        return;
+                    }
+                    NodeId nodeId = vPeerOrder.front();
+                    vPeerOrder.pop_front();
+                    auto it = mapQueues.find(nodeId);
+                    msg = std::move(it->second.front());
+                    it->second.pop_front();
+                    // the message handler holds back the messages of a peer while its queue is full
+                    fWake = it->second.size() + 1 >= MAX_LANE_QUEUE_PER_PEER;
+                    if (it->second.empty()) {
+                        mapQueues.erase(it);
+                    } else {
+                        vPeerOrder.emplace_back(nodeId);
+                    }
+                }
+
+                if (!msg.pnode->fDisconnect) {
+                    ProcessQueuedMessage(msg);
+                }
+                msg.pnode->Release();
+                if (fWake) {
+                    connman->WakeMessageHandler();
+                }
+            }
+        }
+
+        void ProcessQueuedMessage(QueuedMessage& msg)
+        {
+            int64_t nTimeStart = GetTimeMicros();
+            uint64_t nBytes = msg.vRecv.size() + CMessageHeader::HEADER_SIZE;
+            try {
+                for (const auto& handler : msg.handlers->vHandlers) {
+                    handler(msg.pnode, msg.strCommand, msg.vRecv, *connman);
+                }
+            } catch (const std::ios_base::failure& e) {
+                connman->PushMessage(msg.pnode, CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::REJECT, msg.strCommand, REJECT_MALFORMED, std::string("error parsing message")));
+                LogPrintf("%s(%s, peer=%d): Exception '%s' caught\n", __func__, SanitizeString(msg.strCommand), msg.pnode->id, e.what());
+            } catch (...) {
+                PrintExceptionContinue(std::current_exception(), strName.c_str());
+            }
+            AddMessageProcessingStats(msg.pnode, msg.strCommand, nBytes, GetTimeMicros() - nTimeStart, nTimeStart - msg.nTimeReceived);
+
+            LOCK(cs_main);
+            SendRejectsAndCheckIfBanned(msg.pnode, *connman);
+        }
+    };
+
+    // there is no worker for MSG_LANE_INLINE
+    CMessageLaneWorker laneWorkers[MSG_LANE_COUNT] = {
+        {"msg-inline"},
+        {"msg-gov"},
+        {"msg-ps"},
+        {"msg-llmq"},
+    };
+} // anon namespace
+
+mapMsgCmdProcessingStats GetMessageProcessingStats()
+{
+    LOCK(cs_msgProcessingStats);
+    return mapMsgProcessingStats;
+}
+
+void StartMessageLaneThreads(CConnman& connman)
+{
+    for (int i = MSG_LANE_INLINE + 1; i < MSG_LANE_COUNT; i++) {
+        laneWorkers[i].Start(connman);
+    }
+}
+
+void StopMessageLaneThreads()
+{
+    for (int i = MSG_LANE_INLINE + 1; i < MSG_LANE_COUNT; i++) {
+        laneWorkers[i].Stop();
+    }
+}
+
+size_t GetLaneQueueSize(NodeId nodeId)
+{
+    size_t nSize = 0;
+    for (int i = MSG_LANE_INLINE + 1; i < MSG_LANE_COUNT; i++) {
+        nSize += laneWorkers[i].GetQueueSize(nodeId);
+    }
+    return nSize;
+}
+
+/** Returns true if messages with this command are processed by a lane worker, which also accounts for them */
+static bool IsQueuedToLane(const std::string& strCommand)
+{
+    const ExtensionHandlerMap& mapHandlers = GetExtensionHandlers();
+    auto it = mapHandlers.find(strCommand);
+    return it != mapHandlers.end() && it->second.lane != MSG_LANE_INLINE && laneWorkers[it->second.lane].IsRunning();
+}
+
+/** Returns true if the next message of the peer can't be taken yet as its lane has too many of the peer's messages queued */
+static bool IsLaneFull(CNode* pfrom, const CNetMessage& msg)
+{
+    const ExtensionHandlerMap& mapHandlers = GetExtensionHandlers();
+    auto it = mapHandlers.find(msg.hdr.GetCommand());
+    if (it == mapHandlers.end() || it->second.lane == MSG_LANE_INLINE) {
+        return false;
+    }
+    return laneWorkers[it->second.lane].GetQueueSize(pfrom->GetId()) >= MAX_LANE_QUEUE_PER_PEER;
+}
+
+/** Returns true if the next message of the peer is an LLMQ message which must wait for the peer's MNAUTH verification */
+static bool IsWaitingForMNAuth(CNode* pfrom, const CNetMessage& msg)
+{
+    const ExtensionHandlerMap& mapHandlers = GetExtensionHandlers();
+    auto it = mapHandlers.find(msg.hdr.GetCommand());
+    if (it == mapHandlers.end() || it->second.lane != MSG_LANE_LLMQ) {
+        return false;
+    }
+    LOCK(pfrom->cs_mnauth);
+    return pfrom->fMNAuthPending;
+}
+
+// Move items out of set reconciliation into the regular announcement queues, cs_inventory must be held
+static void AnnounceReconciled(CNode* pnode, const CInv& inv)
+{
+    AssertLockHeld(pnode->cs_inventory);
+    if (inv.type == MSG_TX) {
+        pnode->setInventoryTxToSend.insert(inv.hash);
+    } else {
+        pnode->vInventoryOtherToSend.push_back(inv);
+    }
+}
+
+static void AnnounceReconciled(CNode* pnode, CReconciliationState::InvMap& mapInv)
+{
+    for (const auto& p : mapInv) {
+        AnnounceReconciled(pnode, p.second);
+    }
+    mapInv.clear();
+}
+
+// Items both sides have are not announced at all, cs_inventory must be held
+static void ForgetReconciled(CNode* pnode, CReconciliationState::InvMap& mapInv)
+{
+    AssertLockHeld(pnode->cs_inventory);
+    for (const auto& p : mapInv) {
+        pnode->filterInventoryKnown.insert(p.second.hash);
+    }
+    mapInv.clear();
+}
+
 bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman& connman, const std::atomic<bool>& interruptMsgProc)
 {
     LogPrint("net", "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->id);
@@ -1696,6 +2202,13 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             pfrom->fSendDSQueue = true;
         }
 
+        if (GetBoolArg("-txreconciliation", DEFAULT_TXRECONCILIATION)) {
+            // Offer set reconciliation, it's only used if the peer offers it as well. Older nodes ignore the message
+            uint64_t nSalt = GetRand(std::numeric_limits<uint64_t>::max()) | 1;
+            pfrom->nReconSalt = nSalt;
+            connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDRECON, RECON_VERSION, nSalt));
+        }
+
         if (pfrom->nVersion >= LLMQS_PROTO_VERSION) {
             // Tell our peer that we're interested in plain LLMQ recovered signatures.
             // Otherwise the peer would only announce/send messages resulting from QRECSIG,
@@ -1794,6 +2307,138 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
     }
 
 
+    else if (strCommand == NetMsgType::SENDRECON)
+    {
+        uint32_t nReconVersion;
+        uint64_t nRemoteSalt;
+        vRecv >> nReconVersion >> nRemoteSalt;
+
+        bool fRelayTxes;
+        {
+            LOCK(pfrom->cs_filter);
+            fRelayTxes = pfrom->fRelayTxes && !pfrom->pfilter;
+        }
+        // we only reconcile with peers which want all transactions and only if we offered it ourselves
+        if (nReconVersion >= RECON_VERSION && pfrom->nReconSalt != 0 && fRelayTxes) {
+            LOCK(pfrom->cs_inventory);
+            if (!pfrom->reconState) {
+                // the outbound side of the connection initiates reconciliations
+                pfrom->reconState.reset(new CReconciliationState(!pfrom->fInbound, pfrom->nReconSalt, nRemoteSalt));
+                LogPrint("net", "SENDRECON -- using set reconciliation, initiator=%d peer=%d\n", pfrom->reconState->fInitiator, pfrom->id);
+            }
+        }
+    }
+
+
+    else if (strCommand == NetMsgType::REQRECON)
+    {
+        uint32_t nRemoteSize;
+        uint16_t nQ;
+        vRecv >> nRemoteSize >> nQ;
+
+        LOCK(pfrom->cs_inventory);
+        auto& reconState = pfrom->reconState;
+        if (!reconState || reconState->fInitiator) {
+            LogPrint("net", "REQRECON -- unexpected reconciliation request, peer=%d\n", pfrom->id);
+            return true;
+        }
+
+        // the initiator gave up on the previous reconciliation
+        AnnounceReconciled(pfrom, reconState->mapSketched);
+
+        uint32_t nLocalSize = reconState->mapSet.size();
+        size_t nCells = CReconciliationState::EstimateSketchCells(nLocalSize, nRemoteSize, nQ);
+        CInvSketch sketch;
+        if (reconState->mapSet.empty() || nCells > MAX_SKETCH_CELLS) {
+            // An empty sketch makes the initiator announce all its items, which is just right if we have none.
+            // Otherwise the difference is too large to be worth a sketch and both sides announce everything
+            AnnounceReconciled(pfrom, reconState->mapSet);
+        } else {
+            sketch = reconState->GetSketch(nCells);
+            reconState->mapSketched = std::move(reconState->mapSet);
+            reconState->mapSet.clear();
+        }
+        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::SKETCH, nLocalSize, sketch));
+    }
+
+
+    else if (strCommand == NetMsgType::SKETCH)
+    {
+        uint32_t nRemoteSize;
+        CInvSketch sketch;
+        vRecv >> nRemoteSize >> sketch;
+
+        if (sketch.GetCellCount() > MAX_SKETCH_CELLS) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 20);
+            return error("SKETCH -- sketch with %u cells too large, peer=%d", sketch.GetCellCount(), pfrom->id);
+        }
+
+        LOCK(pfrom->cs_inventory);
+        auto& reconState = pfrom->reconState;
+        if (!reconState || !reconState->fInitiator || !reconState->fRequested) {
+            LogPrint("net", "SKETCH -- unexpected sketch, peer=%d\n", pfrom->id);
+            return true;
+        }
+        reconState->fRequested = false;
+
+        if (sketch.IsEmpty()) {
+            AnnounceReconciled(pfrom, reconState->mapSet);
+            return true;
+        }
+
+        size_t nLocalSize = reconState->mapSet.size();
+        std::vector<uint64_t> vRemoteOnly;
+        std::vector<uint64_t> vLocalOnly;
+        bool fSuccess = sketch.Subtract(reconState->GetSketch(sketch.GetCellCount())) && sketch.Decode(vRemoteOnly, vLocalOnly);
+        if (fSuccess) {
+            for (uint64_t nShortId : vLocalOnly) {
+                auto it = reconState->mapSet.find(nShortId);
+                if (it != reconState->mapSet.end()) {
+                    AnnounceReconciled(pfrom, it->second);
+                    reconState->mapSet.erase(it);
+                }
+            }
+            ForgetReconciled(pfrom, reconState->mapSet);
+            reconState->UpdateQ(nLocalSize, nRemoteSize, vRemoteOnly.size() + vLocalOnly.size());
+        } else {
+            AnnounceReconciled(pfrom, reconState->mapSet);
+            vRemoteOnly.clear();
+        }
+        LogPrint("net", "SKETCH -- reconciled %d local and %d remote items, success=%d missing=%d/%d peer=%d\n",
+            nLocalSize, nRemoteSize, fSuccess, vLocalOnly.size(), vRemoteOnly.size(), pfrom->id);
+        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::RECONCILDIFF, fSuccess, vRemoteOnly));
+    }
+
+
+    else if (strCommand == NetMsgType::RECONCILDIFF)
+    {
+        bool fSuccess;
+        std::vector<uint64_t> vAskFor;
+        vRecv >> fSuccess >> vAskFor;
+
+        LOCK(pfrom->cs_inventory);
+        auto& reconState = pfrom->reconState;
+        if (!reconState || reconState->fInitiator) {
+            LogPrint("net", "RECONCILDIFF -- unexpected reconciliation result, peer=%d\n", pfrom->id);
+            return true;
+        }
+
+        if (fSuccess) {
+            for (uint64_t nShortId : vAskFor) {
+                auto it = reconState->mapSketched.find(nShortId);
+                if (it != reconState->mapSketched.end()) {
+                    AnnounceReconciled(pfrom, it->second);
+                    reconState->mapSketched.erase(it);
+                }
+            }
+            ForgetReconciled(pfrom, reconState->mapSketched);
+        } else {
+            AnnounceReconciled(pfrom, reconState->mapSketched);
+        }
+    }
+
+
     else if (strCommand == NetMsgType::QSENDRECSIGS) {
         bool b;
         vRecv >> b;
@@ -2034,6 +2679,87 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
     }
 
 
+    else if (strCommand == NetMsgType::GETCFILTERS || strCommand == NetMsgType::GETCFHEADERS)
+    {
+        uint8_t nFilterType;
+        uint32_t nStartHeight;
+        uint256 stopHash;
+        vRecv >> nFilterType >> nStartHeight >> stopHash;
+
+        bool fHeaders = strCommand == NetMsgType::GETCFHEADERS;
+        std::vector<const CBlockIndex*> vBlocks;
+        if (!PrepareBlockFilterRequest(pfrom, nFilterType, nStartHeight, stopHash, fHeaders ? MAX_GETCFHEADERS_SIZE : MAX_GETCFILTERS_SIZE, vBlocks)) {
+            return true;
+        }
+
+        // the index is written in the background and may lag a few blocks behind the tip, peers retry later
+        if (fHeaders) {
+            uint256 prevFilterHash, prevHeader, header;
+            std::vector<uint256> vFilterHashes(vBlocks.size());
+            if (vBlocks[0]->pprev && !pblockfilterindexdb->ReadFilterHeader(vBlocks[0]->pprev->GetBlockHash(), prevFilterHash, prevHeader)) {
+                LogPrint("net", "no filter header for block %s yet, ignoring request of peer %d\n", vBlocks[0]->pprev->GetBlockHash().ToString(), pfrom->id);
+                return true;
+            }
+            for (size_t i = 0; i < vBlocks.size(); i++) {
+                if (!pblockfilterindexdb->ReadFilterHeader(vBlocks[i]->GetBlockHash(), vFilterHashes[i], header)) {
+                    LogPrint("net", "no filter header for block %s yet, ignoring request of peer %d\n", vBlocks[i]->GetBlockHash().ToString(), pfrom->id);
+                    return true;
+                }
+            }
+            connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::CFHEADERS, nFilterType, stopHash, prevHeader, vFilterHashes));
+        } else {
+            for (const CBlockIndex* pindex : vBlocks) {
+                BlockFilter filter;
+                if (!pblockfilterindexdb->ReadFilter(pindex->GetBlockHash(), filter)) {
+                    LogPrint("net", "no filter for block %s yet, ignoring request of peer %d\n", pindex->GetBlockHash().ToString(), pfrom->id);
+                    return true;
+                }
+                connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::CFILTER, nFilterType, filter.GetBlockHash(), filter.GetEncodedFilter()));
+            }
+        }
+    }
+
+
+    else if (strCommand == NetMsgType::GETCFCHECKPT)
+    {
+        uint8_t nFilterType;
+        uint256 stopHash;
+        vRecv >> nFilterType >> stopHash;
+
+        // the checkpoints cover the chain up to the stop block, which is only looked up and checked here
+        std::vector<const CBlockIndex*> vBlocks;
+        uint32_t nStopHeight = std::numeric_limits<uint32_t>::max();
+        {
+            LOCK(cs_main);
+            BlockMap::iterator it = mapBlockIndex.find(stopHash);
+            if (it != mapBlockIndex.end()) {
+                nStopHeight = it->second->nHeight;
+            }
+        }
+        if (!PrepareBlockFilterRequest(pfrom, nFilterType, nStopHeight, stopHash, 1, vBlocks)) {
+            return true;
+        }
+
+        std::vector<uint256> vCheckpoints;
+        {
+            LOCK(cs_main);
+            for (int nHeight = CFCHECKPT_INTERVAL; nHeight <= vBlocks[0]->nHeight; nHeight += CFCHECKPT_INTERVAL) {
+                vCheckpoints.emplace_back(vBlocks[0]->GetAncestor(nHeight)->GetBlockHash());
+            }
+        }
+
+        std::vector<uint256> vHeaders(vCheckpoints.size());
+        for (size_t i = 0; i < vCheckpoints.size(); i++) {
+            uint256 filterHash;
+            if (!pblockfilterindexdb->ReadFilterHeader(vCheckpoints[i], filterHash, vHeaders[i])) {
+                LogPrint("net", "no filter header for block %s yet, ignoring request of peer %d\n", vCheckpoints[i].ToString(), pfrom->id);
+                return true;
+            }
+        }
+        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::CFCHECKPT, nFilterType, stopHash, vHeaders));
+    }
+
+
     else if (strCommand == NetMsgType::GETHEADERS)
     {
         CBlockLocator locator;
@@ -2156,7 +2882,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             }
         } else if (nInvType == MSG_DSTX) {
             uint256 hashTx = tx.GetHash();
-            if(CPrivateSend::GetDSTX(hashTx)) {
+            if(CPrivateSend::HasDSTX(hashTx)) {
                 LogPrint("privatesend", "DSTX -- Already have %s, skipping...\n", hashTx.ToString());
                 return true; // not an error
             }
@@ -3039,38 +3765,25 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
     }
 
     else {
-        bool found = false;
-        const std::vector<std::string> &allMessages = getAllNetMessageTypes();
-        BOOST_FOREACH(const std::string msg, allMessages) {
-            if(msg == strCommand) {
-                found = true;
-                break;
-            }
-        }
-
-        if (found)
+        const ExtensionHandlerMap& mapHandlers = GetExtensionHandlers();
+        auto it = mapHandlers.find(strCommand);
+        if (it != mapHandlers.end())
         {
-            //probably one the extensions
-#ifdef ENABLE_WALLET
-            privateSendClient.ProcessMessage(pfrom, strCommand, vRecv, connman);
-#endif // ENABLE_WALLET
-            privateSendServer.ProcessMessage(pfrom, strCommand, vRecv, connman);
-            instantsend.ProcessMessage(pfrom, strCommand, vRecv, connman);
-            sporkManager.ProcessSpork(pfrom, strCommand, vRecv, connman);
-            masternodeSync.ProcessMessage(pfrom, strCommand, vRecv);
-            governance.ProcessMessage(pfrom, strCommand, vRecv, connman);
-            CMNAuth::ProcessMessage(pfrom, strCommand, vRecv, connman);
-            llmq::quorumBlockProcessor->ProcessMessage(pfrom, strCommand, vRecv, connman);
-            llmq::quorumDKGSessionManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
-            llmq::quorumSigSharesManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
-            llmq::quorumSigningManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
-            llmq::chainLocksHandler->ProcessMessage(pfrom, strCommand, vRecv, connman);
-            llmq::quorumInstantSendManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
+            // one of the extensions, each handler is only called for the commands it registered for
+            const ExtensionHandlers& handlers = it->second;
+            if (handlers.lane == MSG_LANE_INLINE || !laneWorkers[handlers.lane].Push(pfrom, strCommand, vRecv, nTimeReceived, &handlers)) {
+                for (const auto& handler : handlers.vHandlers) {
+                    handler(pfrom, strCommand, vRecv, connman);
+                }
+            }
         }
         else
         {
-            // Ignore unknown commands for extensibility
-            LogPrint("net", "Unknown command \"%s\" from peer=%d\n", SanitizeString(strCommand), pfrom->id);
+            const std::vector<std::string> &allMessages = getAllNetMessageTypes();
+            if (std::find(allMessages.begin(), allMessages.end(), strCommand) == allMessages.end()) {
+                // Ignore unknown commands for extensibility
+                LogPrint("net", "Unknown command \"%s\" from peer=%d\n", SanitizeString(strCommand), pfrom->id);
+            }
         }
     }
 
@@ -3138,6 +3851,13 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
             LOCK(pfrom->cs_vProcessMsg);
             if (pfrom->vProcessMsg.empty())
                 return false;
+            // Leave the message where it is while the peer's queue in its lane is full, the receive buffer fills up
+            // and pauses receiving from the peer until the lane catches up
+            if (IsLaneFull(pfrom, pfrom->vProcessMsg.front()))
+                return false;
+            // LLMQ messages depend on verifiedProRegTxHash, CMNAuth wakes us up when the verification finished
+            if (IsWaitingForMNAuth(pfrom, pfrom->vProcessMsg.front()))
+                return false;
             // Just take one message
             msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
             pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
@@ -3182,7 +3902,12 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
         bool fRet = false;
         try
         {
+            int64_t nTimeStart = GetTimeMicros();
+            bool fQueued = IsQueuedToLane(strCommand);
             fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc);
+            if (!fQueued) {
+                AddMessageProcessingStats(pfrom, strCommand, nMessageSize + CMessageHeader::HEADER_SIZE, GetTimeMicros() - nTimeStart, nTimeStart - msg.nTime);
+            }
             if (interruptMsgProc)
                 return false;
             if (!pfrom->vRecvGetData.empty())
@@ -3445,7 +4170,7 @@ bool SendMessages(CNode* pto, CConnman& connman, const std::atomic<bool>& interr
                     {
                         LOCK(cs_most_recent_block);
                         if (most_recent_block_hash == pBestIndex->GetBlockHash()) {
-                            connman.PushMessage(pto, msgMaker.Make(NetMsgType::CMPCTBLOCK, *most_recent_compact_block));
+                            connman.PushMessage(pto, most_recent_compact_block_msg);
                             fGotBlockFromCache = true;
                         }
                     }
@@ -3519,6 +4244,22 @@ bool SendMessages(CNode* pto, CConnman& connman, const std::atomic<bool>& interr
             }
             pto->vInventoryBlockToSend.clear();
 
+            // Ask the peer for a sketch of its reconciliation set
+            auto& reconState = pto->reconState;
+            if (reconState && reconState->fInitiator) {
+                if (reconState->fRequested && reconState->nRequestTime + RECON_RESPONSE_TIMEOUT * 1000000 < nNow) {
+                    LogPrint("net", "SendMessages -- reconciliation request timed out, peer=%d\n", pto->id);
+                    reconState->fRequested = false;
+                    AnnounceReconciled(pto, reconState->mapSet);
+                }
+                if (!reconState->fRequested && reconState->nNextRequest < nNow) {
+                    connman.PushMessage(pto, msgMaker.Make(NetMsgType::REQRECON, (uint32_t)reconState->mapSet.size(), reconState->nQ));
+                    reconState->fRequested = true;
+                    reconState->nRequestTime = nNow;
+                    reconState->nNextRequest = nNow + RECON_REQUEST_INTERVAL * 1000000;
+                }
+            }
+
             // Check whether periodic sends should happen
             // Note: If this node is running in a Masternode mode, it makes no sense to delay outgoing txes
             // because we never produce any txes ourselves i.e. no privacy is lost in this case.
@@ -3721,15 +4462,15 @@ bool SendMessages(CNode* pto, CConnman& connman, const std::atomic<bool>& interr
         //
         // Message: getdata (non-blocks)
         //
-        std::sort(pto->vecAskFor.begin(), pto->vecAskFor.end());
-        auto it = pto->vecAskFor.begin();
-        while (it != pto->vecAskFor.end() && it->first <= nNow)
+        std::vector<CInv> vAskFor;
+        pto->PopAskFor(nNow, vAskFor);
+        for (const CInv& inv : vAskFor)
         {
-            const CInv& inv = it->second;
             if (!AlreadyHave(inv))
             {
                 LogPrint("net", "SendMessages -- GETDATA -- requesting inv = %s peer=%d\n", inv.ToString(), pto->id);
                 vGetData.push_back(inv);
+                pto->MarkAskedFor(inv, nNow, true);
                 if (vGetData.size() >= 1000)
                 {
                     connman.PushMessage(pto, msgMaker.Make(NetMsgType::GETDATA, vGetData));
@@ -3739,11 +4480,9 @@ bool SendMessages(CNode* pto, CConnman& connman, const std::atomic<bool>& interr
             } else {
                 //If we're not going to ask, don't expect a response.
                 LogPrint("net", "SendMessages -- GETDATA -- already have inv = %s peer=%d\n", inv.ToString(), pto->id);
-                pto->setAskFor.erase(inv.hash);
+                pto->MarkAskedFor(inv, nNow, false);
             }
-            ++it;
         }
-        pto->vecAskFor.erase(pto->vecAskFor.begin(), it);
         if (!vGetData.empty()) {
             connman.PushMessage(pto, msgMaker.Make(NetMsgType::GETDATA, vGetData));
             LogPrint("net", "SendMessages -- GETDATA -- pushed size = %lu peer=%d\n", vGetData.size(), pto->id);
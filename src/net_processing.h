@@ -7,6 +7,8 @@
 #define BITCOIN_NET_PROCESSING_H
 
 #include "net.h"
+#include "netmessagemaker.h"
+#include "util.h"
 #include "validationinterface.h"
 
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
@@ -23,6 +25,10 @@ static constexpr int64_t HEADERS_DOWNLOAD_TIMEOUT_PER_HEADER = 1000; // 1ms/head
 
 /** Default number of orphan+recently-replaced txn to keep around for block reconstruction */
 static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN = 100;
+/** Default for -txreconciliation */
+static const bool DEFAULT_TXRECONCILIATION = false;
+/** Default for -mnpushrelay */
+static const bool DEFAULT_MASTERNODE_PUSH_RELAY = true;
 
 /** Register with a network node to receive its signals */
 void RegisterNodeSignals(CNodeSignals& nodeSignals);
@@ -51,9 +57,48 @@ struct CNodeStateStats {
 
 /** Get statistics from node state */
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
+
+/** Get the processing statistics of all peers, per command */
+mapMsgCmdProcessingStats GetMessageProcessingStats();
 /** Increase a node's misbehavior score. */
 void Misbehaving(NodeId nodeid, int howmuch);
 bool IsBanned(NodeId nodeid);
+/** Get a tx from the orphan pool, nullptr if it isn't there */
+CTransactionRef GetOrphanTx(const uint256& hash);
+
+/** Whether we're a masternode pushing blocks, ISLOCKs and CLSIGs to our MNAUTH verified masternode peers */
+bool IsMasternodePushRelayEnabled();
+/** Whether the peer proved with MNAUTH that it's a masternode */
+bool IsVerifiedMasternodePeer(CNode* pnode);
+
+/**
+ * Push an object straight to our verified masternode peers instead of announcing it with an INV, which
+ * saves them the getdata round-trip. The object is marked as known to them, so neither a later INV nor
+ * a second push goes out for it. Peers which knew about it already are skipped.
+ */
+template <typename T>
+void PushToMasternodePeers(CConnman& connman, const CInv& inv, const std::string& strCommand, const T& obj, int minProtoVersion)
+{
+    if (!IsMasternodePushRelayEnabled()) {
+        return;
+    }
+    connman.ForEachNode([&](CNode* pnode) {
+        if (pnode->nVersion < minProtoVersion || !IsVerifiedMasternodePeer(pnode)) {
+            return;
+        }
+        if (!pnode->TryAddInventoryKnown(inv.hash)) {
+            return;
+        }
+        LogPrint("net", "%s -- push %s to masternode peer=%d\n", __func__, inv.ToString(), pnode->id);
+        connman.PushMessage(pnode, CNetMsgMaker(pnode->GetSendVersion()).Make(strCommand, obj));
+    });
+}
+
+/** Start/stop the threads which process the masternode, governance and LLMQ messages */
+void StartMessageLaneThreads(CConnman& connman);
+void StopMessageLaneThreads();
+/** Number of messages of the peer which are queued for the lane threads */
+size_t GetLaneQueueSize(NodeId nodeId);
 
 /** Process protocol messages received from a given node */
 bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& interrupt);
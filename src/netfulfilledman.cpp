@@ -7,35 +7,95 @@
 #include "netfulfilledman.h"
 #include "util.h"
 
+#include <algorithm>
+
 CNetFulfilledRequestManager netfulfilledman;
 
+CService CNetFulfilledRequestManager::SquashAddress(const CService& addr)
+{
+    return Params().AllowMultiplePorts() ? addr : CService(addr, 0);
+}
+
+void CNetFulfilledRequestManager::AddToWheel(const CService& addr, const std::string& strRequest, int64_t nExpireTime)
+{
+    vWheel[(nExpireTime / WHEEL_TICK) % WHEEL_SLOTS].push_back({addr, strRequest, nExpireTime});
+}
+
 void CNetFulfilledRequestManager::AddFulfilledRequest(const CService& addr, const std::string& strRequest)
 {
     LOCK(cs_mapFulfilledRequests);
-    CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
-    mapFulfilledRequests[addrSquashed][strRequest] = GetTime() + Params().FulfilledRequestExpireTime();
+    CService addrSquashed = SquashAddress(addr);
+    int64_t nExpireTime = GetTime() + Params().FulfilledRequestExpireTime();
+    fulfilledreqmapentry_t& entry = mapFulfilledRequests[addrSquashed];
+    auto it = std::find_if(entry.begin(), entry.end(), [&](const std::pair<std::string, int64_t>& request) {
+        return request.first == strRequest;
+    });
+    if (it != entry.end()) {
+        it->second = nExpireTime;
+    } else {
+        entry.emplace_back(strRequest, nExpireTime);
+        nRequests++;
+    }
+    AddToWheel(addrSquashed, strRequest, nExpireTime);
 }
 
 bool CNetFulfilledRequestManager::HasFulfilledRequest(const CService& addr, const std::string& strRequest)
 {
     LOCK(cs_mapFulfilledRequests);
-    CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addrSquashed);
-
-    return  it != mapFulfilledRequests.end() &&
-            it->second.find(strRequest) != it->second.end() &&
-            it->second[strRequest] > GetTime();
+    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(SquashAddress(addr));
+    if (it == mapFulfilledRequests.end()) {
+        return false;
+    }
+    for (const auto& request : it->second) {
+        if (request.first == strRequest) {
+            return request.second > GetTime();
+        }
+    }
+    return false;
 }
 
 void CNetFulfilledRequestManager::RemoveFulfilledRequest(const CService& addr, const std::string& strRequest)
 {
-    LOCK(cs_mapFulfilledRequests);
-    CService addrSquashed = Params().AllowMultiplePorts() ? addr : CService(addr, 0);
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addrSquashed);
+    AssertLockHeld(cs_mapFulfilledRequests);
+    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addr);
+    if (it == mapFulfilledRequests.end()) {
+        return;
+    }
+    fulfilledreqmapentry_t& entry = it->second;
+    for (size_t i = 0; i < entry.size(); i++) {
+        if (entry[i].first == strRequest) {
+            entry[i] = std::move(entry.back());
+            entry.pop_back();
+            nRequests--;
+            break;
+        }
+    }
+    if (entry.empty()) {
+        mapFulfilledRequests.erase(it);
+    }
+}
 
-    if (it != mapFulfilledRequests.end()) {
-        it->second.erase(strRequest);
+bool CNetFulfilledRequestManager::ExpireWheelEntry(const CWheelEntry& wheelEntry, int64_t nNow)
+{
+    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(wheelEntry.addr);
+    if (it == mapFulfilledRequests.end()) {
+        return true;
+    }
+    for (const auto& request : it->second) {
+        if (request.first == wheelEntry.strRequest) {
+            if (request.second != wheelEntry.nExpireTime) {
+                // fulfilled again since, a newer entry is queued for that
+                return true;
+            }
+            if (nNow > request.second) {
+                RemoveFulfilledRequest(wheelEntry.addr, wheelEntry.strRequest);
+                return true;
+            }
+            // not due yet, it is due on a later turn of the wheel or later in this tick
+            return false;
+        }
     }
+    return true;
 }
 
 void CNetFulfilledRequestManager::CheckAndRemove()
@@ -43,35 +103,39 @@ void CNetFulfilledRequestManager::CheckAndRemove()
     LOCK(cs_mapFulfilledRequests);
 
     int64_t now = GetTime();
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.begin();
-
-    while(it != mapFulfilledRequests.end()) {
-        fulfilledreqmapentry_t::iterator it_entry = it->second.begin();
-        while(it_entry != it->second.end()) {
-            if(now > it_entry->second) {
-                it->second.erase(it_entry++);
-            } else {
-                ++it_entry;
-            }
-        }
-        if(it->second.size() == 0) {
-            mapFulfilledRequests.erase(it++);
-        } else {
-            ++it;
-        }
+    int64_t nTick = now / WHEEL_TICK;
+
+    // Visit the slots of all ticks since the last call, and the one of the current tick, which may
+    // have been visited before but got more entries since. Each slot is visited at most once.
+    int64_t nFirstTick = nLastTick ? nLastTick : nTick - WHEEL_SLOTS + 1;
+    if (nTick - nFirstTick >= WHEEL_SLOTS) {
+        nFirstTick = nTick - WHEEL_SLOTS + 1;
     }
+    for (int64_t nVisitTick = nFirstTick; nVisitTick <= nTick; nVisitTick++) {
+        std::vector<CWheelEntry>& vSlot = vWheel[nVisitTick % WHEEL_SLOTS];
+        vSlot.erase(std::remove_if(vSlot.begin(), vSlot.end(), [&](const CWheelEntry& wheelEntry) {
+            return ExpireWheelEntry(wheelEntry, now);
+        }), vSlot.end());
+    }
+    nLastTick = nTick;
 }
 
 void CNetFulfilledRequestManager::Clear()
 {
     LOCK(cs_mapFulfilledRequests);
     mapFulfilledRequests.clear();
+    for (auto& vSlot : vWheel) {
+        vSlot.clear();
+    }
+    nRequests = 0;
+    nLastTick = 0;
 }
 
 std::string CNetFulfilledRequestManager::ToString() const
 {
+    LOCK(cs_mapFulfilledRequests);
     std::ostringstream info;
-    info << "Nodes with fulfilled requests: " << (int)mapFulfilledRequests.size();
+    info << "Nodes with fulfilled requests: " << (int)mapFulfilledRequests.size() << ", requests: " << (int)nRequests;
     return info.str();
 }
 
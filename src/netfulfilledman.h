@@ -6,35 +6,102 @@
 #define NETFULFILLEDMAN_H
 
 #include "netaddress.h"
+#include "saltedhasher.h"
 #include "serialize.h"
 #include "sync.h"
 
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 class CNetFulfilledRequestManager;
 extern CNetFulfilledRequestManager netfulfilledman;
 
 // Fulfilled requests are used to prevent nodes from asking for the same data on sync
 // and from being banned for doing so too often.
+//
+// Expiry is tracked with a hashed time wheel: every request is also queued in the slot
+// of the tick it expires in, and CheckAndRemove only visits the slots of the ticks
+// which passed since it ran last. Requests which are fulfilled again leave a stale
+// entry behind in their old slot, which is dropped once that slot is visited.
 class CNetFulfilledRequestManager
 {
 private:
-    typedef std::map<std::string, int64_t> fulfilledreqmapentry_t;
-    typedef std::map<CService, fulfilledreqmapentry_t> fulfilledreqmap_t;
+    // A node only ever has a handful of different requests, a vector beats a map for lookups
+    typedef std::vector<std::pair<std::string, int64_t> > fulfilledreqmapentry_t;
+    typedef std::unordered_map<CService, fulfilledreqmapentry_t, StaticSaltedHasher> fulfilledreqmap_t;
+
+    struct CWheelEntry {
+        CService addr;
+        std::string strRequest;
+        int64_t nExpireTime;
+    };
+
+    //! length of one tick of the time wheel, in seconds
+    static const int64_t WHEEL_TICK = 60;
+    //! number of slots of the time wheel, requests expiring later than this many ticks ahead are visited once per turn
+    static const int WHEEL_SLOTS = 64;
 
     //keep track of what node has/was asked for and when
     fulfilledreqmap_t mapFulfilledRequests;
-    CCriticalSection cs_mapFulfilledRequests;
+    mutable CCriticalSection cs_mapFulfilledRequests;
+
+    //! total number of requests in mapFulfilledRequests
+    size_t nRequests;
+
+    //! requests by the slot of the tick they expire in
+    std::vector<CWheelEntry> vWheel[WHEEL_SLOTS];
+    //! last tick CheckAndRemove visited the slot of, 0 if it never ran
+    int64_t nLastTick;
 
+    static CService SquashAddress(const CService& addr);
+
+    void AddToWheel(const CService& addr, const std::string& strRequest, int64_t nExpireTime);
     void RemoveFulfilledRequest(const CService& addr, const std::string& strRequest);
+    //! Remove the request an entry of a slot points to if it expired, return false if the entry is to be kept
+    bool ExpireWheelEntry(const CWheelEntry& entry, int64_t nNow);
 
 public:
-    CNetFulfilledRequestManager() {}
+    CNetFulfilledRequestManager() : nRequests(0), nLastTick(0) {}
+
+    // The serialized format is the one of a std::map<CService, std::map<std::string, int64_t>>,
+    // written straight from the hash map, without copying it into one first.
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        LOCK(cs_mapFulfilledRequests);
+        WriteCompactSize(s, mapFulfilledRequests.size());
+        for (const auto& pair : mapFulfilledRequests) {
+            s << pair.first;
+            WriteCompactSize(s, pair.second.size());
+            for (const auto& request : pair.second) {
+                s << request.first << request.second;
+            }
+        }
+    }
 
-    ADD_SERIALIZE_METHODS;
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        Clear();
 
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action) {
         LOCK(cs_mapFulfilledRequests);
-        READWRITE(mapFulfilledRequests);
+        size_t nAddresses = ReadCompactSize(s);
+        mapFulfilledRequests.reserve(nAddresses);
+        for (size_t i = 0; i < nAddresses; i++) {
+            CService addr;
+            s >> addr;
+            fulfilledreqmapentry_t& entry = mapFulfilledRequests[addr];
+            size_t nEntryRequests = ReadCompactSize(s);
+            for (size_t j = 0; j < nEntryRequests; j++) {
+                std::string strRequest;
+                int64_t nExpireTime;
+                s >> strRequest >> nExpireTime;
+                entry.emplace_back(strRequest, nExpireTime);
+                AddToWheel(addr, strRequest, nExpireTime);
+                nRequests++;
+            }
+        }
     }
 
     void AddFulfilledRequest(const CService& addr, const std::string& strRequest);
@@ -8,6 +8,7 @@
 #include "amount.h"
 #include "uint256.h"
 #include "random.h"
+#include "sync.h"
 
 #include <map>
 #include <string>
@@ -71,8 +72,11 @@ class TxConfirmStats
 {
 private:
     //Define the buckets we will group transactions into
-    std::vector<double> buckets;              // The upper-bound of the range for the bucket (inclusive)
-    std::map<double, unsigned int> bucketMap; // Map of bucket upper-bound to index into all vectors by bucket
+    std::vector<double> buckets;              // The upper-bound of the range for the bucket (inclusive), sorted
+    unsigned int maxConfirms;
+
+    // The per confirmation count stats are stored contiguously, row Y holds the values of all buckets
+    // for Y+1 confirmations, so the per block update walks each array once from front to back
 
     // For each bucket X:
     // Count the total # of txs in each bucket
@@ -83,9 +87,10 @@ private:
 
     // Count the total # of txs confirmed within Y blocks in each bucket
     // Track the historical moving average of theses totals over blocks
-    std::vector<std::vector<double> > confAvg; // confAvg[Y][X]
-    // and calculate the totals for the current block to update the moving averages
-    std::vector<std::vector<int> > curBlockConf; // curBlockConf[Y][X]
+    std::vector<double> confAvg; // confAvg[Y * buckets.size() + X]
+    // and count the txs confirmed in exactly Y blocks in the current block, which
+    // UpdateMovingAverages accumulates into the totals for within Y blocks
+    std::vector<int> curBlockConf; // curBlockConf[Y * buckets.size() + X]
 
     // Sum the total feerate of all tx's in each bucket
     // Track the historical moving average of this total over blocks
@@ -101,10 +106,12 @@ private:
     // Mempool counts of outstanding transactions
     // For each bucket X, track the number of transactions in the mempool
     // that are unconfirmed for each possible confirmation value Y
-    std::vector<std::vector<int> > unconfTxs;  //unconfTxs[Y][X]
+    std::vector<int> unconfTxs;  //unconfTxs[Y * buckets.size() + X]
     // transactions still unconfirmed after MAX_CONFIRMS for each bucket
     std::vector<int> oldUnconfTxs;
 
+    unsigned int FindBucketIndex(double val) const;
+
 public:
     /**
      * Initialize the data structures.  This is called by BlockPolicyEstimator's
@@ -152,7 +159,7 @@ public:
                              double minSuccess, bool requireGreater, unsigned int nBlockHeight);
 
     /** Return the max number of confirms we're tracking */
-    unsigned int GetMaxConfirms() { return confAvg.size(); }
+    unsigned int GetMaxConfirms() const { return maxConfirms; }
 
     /** Write state of estimation data to a file*/
     void Write(CAutoFile& fileout);
@@ -198,6 +205,10 @@ static const double FEE_SPACING = 1.1;
  *  We want to be able to estimate feerates that are needed on tx's to be included in
  * a certain number of blocks.  Every time a block is added to the best chain, this class records
  * stats on the transactions included in that block
+ *
+ * The estimator has its own lock, so estimates don't wait for mempool.cs. Estimates are cached
+ * until the stats change in a way that affects them, which is a new block or a tx leaving the
+ * mempool after being unconfirmed for a block or more.
  */
 class CBlockPolicyEstimator
 {
@@ -234,6 +245,8 @@ public:
     void Read(CAutoFile& filein, int nFileVersion);
 
 private:
+    mutable CCriticalSection cs_feeEstimator;
+
     CFeeRate minTrackedFee;    //!< Passed to constructor to avoid dependency on main
     unsigned int nBestSeenHeight;
     struct TxStatsInfo
@@ -251,5 +264,13 @@ private:
 
     unsigned int trackedTxs;
     unsigned int untrackedTxs;
+
+    // EstimateMedianVal result for each confirmation target, NO_CACHED_ESTIMATE if not computed yet
+    static constexpr double NO_CACHED_ESTIMATE = -2;
+    std::vector<double> vecEstimateCache;
+
+    /** EstimateMedianVal of feeStats for confTarget, from the cache if possible */
+    double EstimateMedianVal(int confTarget);
+    void ClearEstimateCache();
 };
 #endif /*BITCOIN_POLICYESTIMATOR_H */
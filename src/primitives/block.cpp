@@ -36,7 +36,7 @@ void BlockNetwork::SetNetwork(const std::string& net)
     }
 }
 
-uint256 CBlockHeader::GetHash() const
+bool CBlockHeader::IsX16RV2() const
 {
     uint32_t nTimeToUse = MAINNET_X16RV2ACTIVATIONTIME;
     if (bNetwork.fOnTestnet) {
@@ -44,11 +44,101 @@ uint256 CBlockHeader::GetHash() const
     } else if (bNetwork.fOnRegtest) {
         nTimeToUse = REGTEST_X16RV2ACTIVATIONTIME;
     }
-    if (nTime >= nTimeToUse) {
-        return HashX16RV2(BEGIN(nVersion), END(nNonce), hashPrevBlock);
+    return nTime >= nTimeToUse;
+}
+
+CBlockHeader& CBlockHeader::operator=(const CBlockHeader& other)
+{
+    if (this == &other) {
+        return *this;
     }
 
-    return HashX16R(BEGIN(nVersion), END(nNonce), hashPrevBlock);
+    nVersion = other.nVersion;
+    hashPrevBlock = other.hashPrevBlock;
+    hashMerkleRoot = other.hashMerkleRoot;
+    nTime = other.nTime;
+    nBits = other.nBits;
+    nNonce = other.nNonce;
+
+    if (other.nHashCacheState.load(std::memory_order_acquire) == HASH_CACHE_READY) {
+        fHashCacheX16RV2 = other.fHashCacheX16RV2;
+        memcpy(vchHashCacheKey, other.vchHashCacheKey, sizeof(vchHashCacheKey));
+        hashCache = other.hashCache;
+        nHashCacheState.store(HASH_CACHE_READY, std::memory_order_release);
+    } else {
+        nHashCacheState.store(HASH_CACHE_EMPTY, std::memory_order_release);
+    }
+    return *this;
+}
+
+bool CBlockHeader::ReadHashCache(bool fX16RV2, int& nStateRet, uint256& hashRet) const
+{
+    nStateRet = nHashCacheState.load(std::memory_order_acquire);
+    if (nStateRet == HASH_CACHE_READY && fHashCacheX16RV2 == fX16RV2 &&
+        memcmp(vchHashCacheKey, BEGIN(nVersion), HEADER_SIZE) == 0) {
+        hashRet = hashCache;
+        return true;
+    }
+    return false;
+}
+
+void CBlockHeader::WriteHashCache(bool fX16RV2, int nState, const uint256& hash) const
+{
+    // Concurrent callers on an unmodified header race to fill an empty cache, only one of them writes it.
+    // A filled cache only gets replaced after the fields were modified, which callers already must not do
+    // while other threads are reading the header.
+    if (nState == HASH_CACHE_READY || nHashCacheState.compare_exchange_strong(nState, HASH_CACHE_WRITING, std::memory_order_acquire)) {
+        nHashCacheState.store(HASH_CACHE_WRITING, std::memory_order_relaxed);
+        fHashCacheX16RV2 = fX16RV2;
+        memcpy(vchHashCacheKey, BEGIN(nVersion), HEADER_SIZE);
+        hashCache = hash;
+        nHashCacheState.store(HASH_CACHE_READY, std::memory_order_release);
+    }
+}
+
+uint256 CBlockHeader::GetHash() const
+{
+    static_assert(sizeof(nVersion) + sizeof(hashPrevBlock) + sizeof(hashMerkleRoot) + sizeof(nTime) + sizeof(nBits) + sizeof(nNonce) == HEADER_SIZE, "unexpected header size");
+
+    bool fX16RV2 = IsX16RV2();
+    int nState;
+    uint256 hash;
+    if (ReadHashCache(fX16RV2, nState, hash)) {
+        return hash;
+    }
+
+    hash = fX16RV2 ? HashX16RV2(BEGIN(nVersion), END(nNonce), hashPrevBlock)
+                   : HashX16R(BEGIN(nVersion), END(nNonce), hashPrevBlock);
+    WriteHashCache(fX16RV2, nState, hash);
+    return hash;
+}
+
+void CBlockHeader::CacheHashes(const CBlockHeader* pheaders, size_t nCount)
+{
+    std::vector<const CBlockHeader*> vHeaders;
+    std::vector<int> vStates;
+    std::vector<X16RBatchInput> vInputs;
+    vHeaders.reserve(nCount);
+    vStates.reserve(nCount);
+    vInputs.reserve(nCount);
+    for (size_t i = 0; i < nCount; i++) {
+        const CBlockHeader& header = pheaders[i];
+        bool fX16RV2 = header.IsX16RV2();
+        int nState;
+        uint256 hash;
+        if (header.ReadHashCache(fX16RV2, nState, hash)) {
+            continue;
+        }
+        vHeaders.push_back(&header);
+        vStates.push_back(nState);
+        vInputs.push_back(X16RBatchInput{(const unsigned char*)BEGIN(header.nVersion), HEADER_SIZE, header.hashPrevBlock, fX16RV2});
+    }
+
+    std::vector<uint256> vHashes(vInputs.size());
+    HashX16RBatch(vInputs.data(), vInputs.size(), vHashes.data());
+    for (size_t i = 0; i < vHeaders.size(); i++) {
+        vHeaders[i]->WriteHashCache(vInputs[i].fV2, vStates[i], vHashes[i]);
+    }
 }
 
 uint256 CBlockHeader::GetX16RHash() const
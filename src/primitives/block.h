@@ -8,8 +8,11 @@
 
 #include "primitives/transaction.h"
 #include "serialize.h"
+#include "support/allocators/monotonic.h"
 #include "uint256.h"
 
+#include <atomic>
+
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
  * requirements.  When they solve the proof-of-work, they broadcast the block
@@ -40,11 +43,38 @@ public:
     uint32_t nBits;
     uint32_t nNonce;
 
-    CBlockHeader()
+    // size of the fields above as they are laid out in memory and hashed
+    static const size_t HEADER_SIZE = 80;
+
+private:
+    // memory only: result of the last GetHash() and the header bytes it was computed from,
+    // a mismatch with the current fields means the header was modified since
+    enum {
+        HASH_CACHE_EMPTY = 0,
+        HASH_CACHE_WRITING = 1,
+        HASH_CACHE_READY = 2,
+    };
+    mutable std::atomic<int> nHashCacheState;
+    mutable bool fHashCacheX16RV2;
+    mutable unsigned char vchHashCacheKey[HEADER_SIZE];
+    mutable uint256 hashCache;
+
+    bool ReadHashCache(bool fX16RV2, int& nStateRet, uint256& hashRet) const;
+    void WriteHashCache(bool fX16RV2, int nState, const uint256& hash) const;
+
+public:
+    CBlockHeader() : nHashCacheState(HASH_CACHE_EMPTY)
     {
         SetNull();
     }
 
+    CBlockHeader(const CBlockHeader& other) : nHashCacheState(HASH_CACHE_EMPTY)
+    {
+        *this = other;
+    }
+
+    CBlockHeader& operator=(const CBlockHeader& other);
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
@@ -73,6 +103,14 @@ public:
     }
 
     uint256 GetHash() const;
+
+    /**
+     * Fills the hash caches of nCount headers with one HashX16RBatch call, so that GetHash() on them doesn't hash
+     * unless they are modified. Headers with a valid cached hash are skipped. Faster than calling GetHash()
+     * on each of them when there are many.
+     */
+    static void CacheHashes(const CBlockHeader* pheaders, size_t nCount);
+    bool IsX16RV2() const;
     uint256 GetX16RHash() const;
     uint256 GetX16RV2Hash() const;
 
@@ -108,12 +146,16 @@ public:
         *((CBlockHeader*)this) = header;
     }
 
-    ADD_SERIALIZE_METHODS;
+    template <typename Stream>
+    void Serialize(Stream& s) const {
+        ::Serialize(s, *(const CBlockHeader*)this);
+        ::Serialize(s, vtx);
+    }
 
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action) {
-        READWRITE(*(CBlockHeader*)this);
-        READWRITE(vtx);
+    template <typename Stream>
+    void Unserialize(Stream& s) {
+        ::Unserialize(s, *(CBlockHeader*)this);
+        UnserializeTransactions(s);
     }
 
     void SetNull()
@@ -136,6 +178,27 @@ public:
     }
 
     std::string ToString() const;
+
+private:
+    /**
+     * The transactions of a block are allocated from one CMonotonicBuffer instead of one allocation each, which keeps
+     * the allocator busy and the heap fragmented during IBD and reindex. The buffer is freed with the last of them,
+     * transactions which outlive their block for long (e.g. in the wallet) are copied out of it.
+     */
+    template <typename Stream>
+    void UnserializeTransactions(Stream& s) {
+        vtx.clear();
+        unsigned int nSize = ReadCompactSize(s);
+        // each transaction shares its allocation with the control block of its shared_ptr
+        const size_t nTxAllocSize = sizeof(CTransaction) + 64;
+        // don't let a bogus count allocate memory before the transactions are actually read
+        size_t nPrealloc = std::min<size_t>(nSize, 5000000 / nTxAllocSize);
+        monotonic_allocator<CTransaction> alloc(std::make_shared<CMonotonicBuffer>(nPrealloc * nTxAllocSize));
+        vtx.reserve(nPrealloc);
+        for (unsigned int i = 0; i < nSize; i++) {
+            vtx.emplace_back(std::allocate_shared<const CTransaction>(alloc, deserialize, s));
+        }
+    }
 };
 
 
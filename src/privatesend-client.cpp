@@ -50,11 +50,9 @@ void CPrivateSendClientManager::ProcessMessage(CNode* pfrom, const std::string&
             if (!lockRecv) return;
 
             // process every dsq only once
-            for (const auto& q : vecPrivateSendQueue) {
-                if (q == dsq) {
-                    // LogPrint("privatesend", "DSQUEUE -- %s seen\n", dsq.ToString());
-                    return;
-                }
+            if (HasQueue(dsq)) {
+                // LogPrint("privatesend", "DSQUEUE -- %s seen\n", dsq.ToString());
+                return;
             }
         } // cs_vecqueue
 
@@ -88,12 +86,10 @@ void CPrivateSendClientManager::ProcessMessage(CNode* pfrom, const std::string&
             TRY_LOCK(cs_vecqueue, lockRecv);
             if (!lockRecv) return;
 
-            for (const auto& q : vecPrivateSendQueue) {
-                if (q.masternodeOutpoint == dsq.masternodeOutpoint) {
-                    // no way same mn can send another "not yet ready" dsq this soon
-                    LogPrint("privatesend", "DSQUEUE -- Masternode %s is sending WAY too many dsq messages\n", dmn->pdmnState->ToString());
-                    return;
-                }
+            if (HasQueueFromMasternode(dsq.masternodeOutpoint)) {
+                // no way same mn can send another "not yet ready" dsq this soon
+                LogPrint("privatesend", "DSQUEUE -- Masternode %s is sending WAY too many dsq messages\n", dmn->pdmnState->ToString());
+                return;
             }
 
             int64_t nLastDsq = mmetaman.GetMetaInfo(dmn->proTxHash)->GetLastDsq();
@@ -114,7 +110,7 @@ void CPrivateSendClientManager::ProcessMessage(CNode* pfrom, const std::string&
                     dsq.fTried = true;
                 }
             }
-            vecPrivateSendQueue.push_back(dsq);
+            AddQueue(dsq);
             dsq.Relay(connman);
         }
 
@@ -250,6 +246,7 @@ void CPrivateSendClientManager::ResetPool()
     LOCK(cs_deqsessions);
     nCachedLastSuccessBlock = 0;
     vecMasternodesUsed.clear();
+    setMasternodesUsed.clear();
     for (auto& session : deqSessions) {
         session.ResetPool();
     }
@@ -1009,6 +1006,7 @@ bool CPrivateSendClientManager::DoAutomaticDenominating(CConnman& connman, bool
 
     if ((int)vecMasternodesUsed.size() > nThreshold_high) {
         vecMasternodesUsed.erase(vecMasternodesUsed.begin(), vecMasternodesUsed.begin() + vecMasternodesUsed.size() - nThreshold_low);
+        setMasternodesUsed = std::set<COutPoint>(vecMasternodesUsed.begin(), vecMasternodesUsed.end());
         LogPrint("privatesend", "  vecMasternodesUsed: new size: %d, threshold: %d\n", (int)vecMasternodesUsed.size(), nThreshold_high);
     }
 
@@ -1036,6 +1034,7 @@ bool CPrivateSendClientManager::DoAutomaticDenominating(CConnman& connman, bool
 void CPrivateSendClientManager::AddUsedMasternode(const COutPoint& outpointMn)
 {
     vecMasternodesUsed.push_back(outpointMn);
+    setMasternodesUsed.emplace(outpointMn);
 }
 
 CDeterministicMNCPtr CPrivateSendClientManager::GetRandomNotUsedMasternode()
@@ -1043,29 +1042,30 @@ CDeterministicMNCPtr CPrivateSendClientManager::GetRandomNotUsedMasternode()
     auto mnList = deterministicMNManager->GetListAtChainTip();
 
     int nCountEnabled = mnList.GetValidMNsCount();
-    int nCountNotExcluded = nCountEnabled - vecMasternodesUsed.size();
+    int nCountNotExcluded = nCountEnabled - setMasternodesUsed.size();
 
     LogPrintf("CPrivateSendClientManager::%s -- %d enabled masternodes, %d masternodes to choose from\n", __func__, nCountEnabled, nCountNotExcluded);
     if(nCountNotExcluded < 1) {
         return nullptr;
     }
 
-    // fill a vector
-    std::vector<CDeterministicMNCPtr> vpMasternodesShuffled;
-    vpMasternodesShuffled.reserve((size_t)nCountEnabled);
-    mnList.ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
-        vpMasternodesShuffled.emplace_back(dmn);
-    });
-
-    FastRandomContext insecure_rand;
-    // shuffle pointers
-    std::random_shuffle(vpMasternodesShuffled.begin(), vpMasternodesShuffled.end(), insecure_rand);
+    // fill and shuffle a vector once per list, used masternodes are skipped below
+    if (vecMasternodesShuffled.empty() || hashMasternodesShuffled != mnList.GetBlockHash()) {
+        vecMasternodesShuffled.clear();
+        vecMasternodesShuffled.reserve((size_t)nCountEnabled);
+        mnList.ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
+            vecMasternodesShuffled.emplace_back(dmn);
+        });
 
-    std::set<COutPoint> excludeSet(vecMasternodesUsed.begin(), vecMasternodesUsed.end());
+        FastRandomContext insecure_rand;
+        // shuffle pointers
+        std::random_shuffle(vecMasternodesShuffled.begin(), vecMasternodesShuffled.end(), insecure_rand);
+        hashMasternodesShuffled = mnList.GetBlockHash();
+    }
 
     // loop through
-    for (const auto& dmn : vpMasternodesShuffled) {
-        if (excludeSet.count(dmn->collateralOutpoint)) {
+    for (const auto& dmn : vecMasternodesShuffled) {
+        if (setMasternodesUsed.count(dmn->collateralOutpoint)) {
             continue;
         }
 
@@ -1084,9 +1084,15 @@ bool CPrivateSendClientSession::JoinExistingQueue(CAmount nBalanceNeedsAnonymize
     auto mnList = deterministicMNManager->GetListAtChainTip();
 
     std::vector<CAmount> vecStandardDenoms = CPrivateSend::GetStandardDenominations();
+    // Denominations our inputs couldn't be matched to, no need to select coins for them again
+    std::set<int> setFailedDenoms;
     // Look through the queues and see if anything matches
     CPrivateSendQueue dsq;
     while (privateSendClient.GetQueueItemAndTry(dsq)) {
+        if (setFailedDenoms.count(dsq.nDenom)) {
+            continue;
+        }
+
         auto dmn = mnList.GetValidMNByCollateral(dsq.masternodeOutpoint);
 
         if (!dmn) {
@@ -1119,6 +1125,7 @@ bool CPrivateSendClientSession::JoinExistingQueue(CAmount nBalanceNeedsAnonymize
         // Try to match their denominations if possible, select exact number of denominations
         if (!pwalletMain->SelectPSInOutPairsByDenominations(dsq.nDenom, nMinAmount, nMaxAmount, vecPSInOutPairsTmp)) {
             LogPrintf("CPrivateSendClientSession::JoinExistingQueue -- Couldn't match %d denominations %d (%s)\n", vecBits.front(), dsq.nDenom, CPrivateSend::GetDenominationsToString(dsq.nDenom));
+            setFailedDenoms.emplace(dsq.nDenom);
             continue;
         }
 
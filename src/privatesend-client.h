@@ -178,6 +178,11 @@ class CPrivateSendClientManager : public CPrivateSendBaseManager
 private:
     // Keep track of the used Masternodes
     std::vector<COutPoint> vecMasternodesUsed;
+    std::set<COutPoint> setMasternodesUsed;
+
+    // Valid masternodes in random order, shuffled again only when the list at the tip changes
+    std::vector<CDeterministicMNCPtr> vecMasternodesShuffled;
+    uint256 hashMasternodesShuffled;
 
     std::vector<CAmount> vecDenominationsSkipped;
 
@@ -211,6 +216,9 @@ public:
 
     CPrivateSendClientManager() :
         vecMasternodesUsed(),
+        setMasternodesUsed(),
+        vecMasternodesShuffled(),
+        hashMasternodesShuffled(),
         vecDenominationsSkipped(),
         deqSessions(),
         nCachedLastSuccessBlock(0),
@@ -60,13 +60,11 @@ void CPrivateSendServer::ProcessMessage(CNode* pfrom, const std::string& strComm
                 TRY_LOCK(cs_vecqueue, lockRecv);
                 if (!lockRecv) return;
 
-                for (const auto& q : vecPrivateSendQueue) {
-                    if (q.masternodeOutpoint == activeMasternodeInfo.outpoint) {
-                        // refuse to create another queue this often
-                        LogPrint("privatesend", "DSACCEPT -- last dsq is still in queue, refuse to mix\n");
-                        PushStatus(pfrom, STATUS_REJECTED, ERR_RECENT, connman);
-                        return;
-                    }
+                if (HasQueueFromMasternode(activeMasternodeInfo.outpoint)) {
+                    // refuse to create another queue this often
+                    LogPrint("privatesend", "DSACCEPT -- last dsq is still in queue, refuse to mix\n");
+                    PushStatus(pfrom, STATUS_REJECTED, ERR_RECENT, connman);
+                    return;
                 }
             }
 
@@ -106,11 +104,9 @@ void CPrivateSendServer::ProcessMessage(CNode* pfrom, const std::string& strComm
         vRecv >> dsq;
 
         // process every dsq only once
-        for (const auto& q : vecPrivateSendQueue) {
-            if (q == dsq) {
-                // LogPrint("privatesend", "DSQUEUE -- %s seen\n", dsq.ToString());
-                return;
-            }
+        if (HasQueue(dsq)) {
+            // LogPrint("privatesend", "DSQUEUE -- %s seen\n", dsq.ToString());
+            return;
         }
 
         LogPrint("privatesend", "DSQUEUE -- %s new\n", dsq.ToString());
@@ -128,12 +124,10 @@ void CPrivateSendServer::ProcessMessage(CNode* pfrom, const std::string& strComm
         }
 
         if (!dsq.fReady) {
-            for (const auto& q : vecPrivateSendQueue) {
-                if (q.masternodeOutpoint == dsq.masternodeOutpoint) {
-                    // no way same mn can send another "not yet ready" dsq this soon
-                    LogPrint("privatesend", "DSQUEUE -- Masternode %s is sending WAY too many dsq messages\n", dmn->pdmnState->addr.ToString());
-                    return;
-                }
+            if (HasQueueFromMasternode(dsq.masternodeOutpoint)) {
+                // no way same mn can send another "not yet ready" dsq this soon
+                LogPrint("privatesend", "DSQUEUE -- Masternode %s is sending WAY too many dsq messages\n", dmn->pdmnState->addr.ToString());
+                return;
             }
 
             int64_t nLastDsq = mmetaman.GetMetaInfo(dmn->proTxHash)->GetLastDsq();
@@ -147,7 +141,7 @@ void CPrivateSendServer::ProcessMessage(CNode* pfrom, const std::string& strComm
             mmetaman.AllowMixing(dmn->proTxHash);
 
             LogPrint("privatesend", "DSQUEUE -- new PrivateSend queue (%s) from masternode %s\n", dsq.ToString(), dmn->pdmnState->addr.ToString());
-            vecPrivateSendQueue.push_back(dsq);
+            AddQueue(dsq);
             dsq.Relay(connman);
         }
 
@@ -271,9 +265,16 @@ void CPrivateSendServer::ProcessMessage(CNode* pfrom, const std::string& strComm
         int nTxInIndex = 0;
         int nTxInsCount = (int)vecTxIn.size();
 
+        // verify all signatures of the message at once, AddScriptSig only adds them then
+        if (!IsInputScriptSigsValid(vecTxIn)) {
+            LogPrint("privatesend", "DSSIGNFINALTX -- IsInputScriptSigsValid() failed, session: %d\n", nSessionID);
+            RelayStatus(STATUS_REJECTED, connman);
+            return;
+        }
+
         for (const auto& txin : vecTxIn) {
             nTxInIndex++;
-            if (!AddScriptSig(txin)) {
+            if (!AddScriptSig(txin, false)) {
                 LogPrint("privatesend", "DSSIGNFINALTX -- AddScriptSig() failed at %d/%d, session: %d\n", nTxInIndex, nTxInsCount, nSessionID);
                 RelayStatus(STATUS_REJECTED, connman);
                 return;
@@ -371,7 +372,7 @@ void CPrivateSendServer::CommitFinalTransaction(CConnman& connman)
     LogPrintf("CPrivateSendServer::CommitFinalTransaction -- CREATING DSTX\n");
 
     // create and sign masternode dstx transaction
-    if (!CPrivateSend::GetDSTX(hashTx)) {
+    if (!CPrivateSend::HasDSTX(hashTx)) {
         CPrivateSendBroadcastTx dstxNew(finalTransaction, activeMasternodeInfo.outpoint, GetAdjustedTime());
         dstxNew.Sign();
         CPrivateSend::AddDSTX(dstxNew);
@@ -562,45 +563,52 @@ void CPrivateSendServer::CheckForCompleteQueue(CConnman& connman)
     }
 }
 
-// Check to make sure a given input matches an input in the pool and its scriptSig is valid
-bool CPrivateSendServer::IsInputScriptSigValid(const CTxIn& txin)
+// Check to make sure the given inputs match inputs in the pool and their scriptSigs are valid
+bool CPrivateSendServer::IsInputScriptSigsValid(const std::vector<CTxIn>& vecTxIn)
 {
     CMutableTransaction txNew;
     txNew.vin.clear();
     txNew.vout.clear();
 
-    int i = 0;
-    int nTxInIndex = -1;
-    CScript sigPubKey = CScript();
+    std::map<COutPoint, std::pair<int, CScript> > mapInputs;
 
     for (const auto& entry : vecEntries) {
         for (const auto& txout : entry.vecTxOut)
             txNew.vout.push_back(txout);
 
         for (const auto& txdsin : entry.vecTxDSIn) {
+            mapInputs.emplace(txdsin.prevout, std::make_pair((int)txNew.vin.size(), txdsin.prevPubKey));
             txNew.vin.push_back(txdsin);
-
-            if (txdsin.prevout == txin.prevout) {
-                nTxInIndex = i;
-                sigPubKey = txdsin.prevPubKey;
-            }
-            i++;
         }
     }
 
-    if (nTxInIndex >= 0) { //might have to do this one input at a time?
-        txNew.vin[nTxInIndex].scriptSig = txin.scriptSig;
-        LogPrint("privatesend", "CPrivateSendServer::IsInputScriptSigValid -- verifying scriptSig %s\n", ScriptToAsmStr(txin.scriptSig).substr(0, 24));
-        if (!VerifyScript(txNew.vin[nTxInIndex].scriptSig, sigPubKey, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC, MutableTransactionSignatureChecker(&txNew, nTxInIndex))) {
-            LogPrint("privatesend", "CPrivateSendServer::IsInputScriptSigValid -- VerifyScript() failed on input %d\n", nTxInIndex);
+    std::vector<std::pair<int, CScript> > vecToVerify;
+    vecToVerify.reserve(vecTxIn.size());
+    for (const auto& txin : vecTxIn) {
+        auto it = mapInputs.find(txin.prevout);
+        if (it == mapInputs.end()) {
+            LogPrint("privatesend", "CPrivateSendServer::IsInputScriptSigsValid -- Failed to find matching input in pool, %s\n", txin.ToString());
             return false;
         }
-    } else {
-        LogPrint("privatesend", "CPrivateSendServer::IsInputScriptSigValid -- Failed to find matching input in pool, %s\n", txin.ToString());
+        // inputs are signed with SIGHASH_ANYONECANPAY, the scriptSigs of the other inputs don't affect the signature hash
+        txNew.vin[it->second.first].scriptSig = txin.scriptSig;
+        vecToVerify.emplace_back(it->second);
+        LogPrint("privatesend", "CPrivateSendServer::IsInputScriptSigsValid -- verifying scriptSig %s\n", ScriptToAsmStr(txin.scriptSig).substr(0, 24));
+    }
+
+    // store the results in the signature cache, the final transaction is verified again when it's added to the mempool
+    const CTransaction tx(txNew);
+    std::vector<CScriptCheck> vChecks;
+    vChecks.reserve(vecToVerify.size());
+    for (const auto& p : vecToVerify) {
+        vChecks.emplace_back(p.second, 0, tx, p.first, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC, true);
+    }
+    if (!RunScriptChecks(vChecks)) {
+        LogPrint("privatesend", "CPrivateSendServer::IsInputScriptSigsValid -- VerifyScript() failed\n");
         return false;
     }
 
-    LogPrint("privatesend", "CPrivateSendServer::IsInputScriptSigValid -- Successfully validated input and scriptSig\n");
+    LogPrint("privatesend", "CPrivateSendServer::IsInputScriptSigsValid -- Successfully validated %d inputs and scriptSigs\n", vecTxIn.size());
     return true;
 }
 
@@ -652,7 +660,7 @@ bool CPrivateSendServer::AddEntry(const CPrivateSendEntry& entryNew, PoolMessage
     return true;
 }
 
-bool CPrivateSendServer::AddScriptSig(const CTxIn& txinNew)
+bool CPrivateSendServer::AddScriptSig(const CTxIn& txinNew, bool fVerify)
 {
     LogPrint("privatesend", "CPrivateSendServer::AddScriptSig -- scriptSig=%s\n", ScriptToAsmStr(txinNew.scriptSig).substr(0, 24));
 
@@ -665,7 +673,7 @@ bool CPrivateSendServer::AddScriptSig(const CTxIn& txinNew)
         }
     }
 
-    if (!IsInputScriptSigValid(txinNew)) {
+    if (fVerify && !IsInputScriptSigsValid(std::vector<CTxIn>{txinNew})) {
         LogPrint("privatesend", "CPrivateSendServer::AddScriptSig -- Invalid scriptSig\n");
         return false;
     }
@@ -763,7 +771,8 @@ bool CPrivateSendServer::CreateNewSession(const CPrivateSendAccept& dsa, PoolMes
         LogPrint("privatesend", "CPrivateSendServer::CreateNewSession -- signing and relaying new queue: %s\n", dsq.ToString());
         dsq.Sign();
         dsq.Relay(connman);
-        vecPrivateSendQueue.push_back(dsq);
+        LOCK(cs_vecqueue);
+        AddQueue(dsq);
     }
 
     vecSessionCollaterals.push_back(MakeTransactionRef(dsa.txCollateral));
@@ -29,8 +29,8 @@ private:
 
     /// Add a clients entry to the pool
     bool AddEntry(const CPrivateSendEntry& entryNew, PoolMessage& nMessageIDRet);
-    /// Add signature to a txin
-    bool AddScriptSig(const CTxIn& txin);
+    /// Add signature to a txin, fVerify can only be false if IsInputScriptSigsValid passed for it already
+    bool AddScriptSig(const CTxIn& txin, bool fVerify = true);
 
     /// Charge fees to bad actors (Charge clients a fee if they're abusive)
     void ChargeFees(CConnman& connman);
@@ -52,8 +52,8 @@ private:
 
     /// Check that all inputs are signed. (Are all inputs signed?)
     bool IsSignaturesComplete();
-    /// Check to make sure a given input matches an input in the pool and its scriptSig is valid
-    bool IsInputScriptSigValid(const CTxIn& txin);
+    /// Check to make sure the given inputs match inputs in the pool and their scriptSigs are valid
+    bool IsInputScriptSigsValid(const std::vector<CTxIn>& vecTxIn);
     /// Are these outputs compatible with other client in the pool?
     bool IsOutputsCompatibleWithSessionDenom(const std::vector<CTxOut>& vecTxOut);
 
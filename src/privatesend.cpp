@@ -119,7 +119,7 @@ bool CPrivateSendBroadcastTx::CheckSignature(const CBLSPublicKey& blsPubKey) con
 bool CPrivateSendBroadcastTx::IsExpired(int nHeight)
 {
     // expire confirmed DSTXes after ~1h since confirmation
-    return (nConfirmedHeight != -1) && (nHeight - nConfirmedHeight > 24);
+    return (nConfirmedHeight != -1) && (nHeight - nConfirmedHeight > PRIVATESEND_DSTX_EXPIRATION_BLOCKS);
 }
 
 void CPrivateSendBaseSession::SetNull()
@@ -139,6 +139,29 @@ void CPrivateSendBaseManager::SetNull()
 {
     LOCK(cs_vecqueue);
     vecPrivateSendQueue.clear();
+    mapQueueCountByMasternode.clear();
+    nFirstUntriedQueue = 0;
+}
+
+void CPrivateSendBaseManager::AddQueue(const CPrivateSendQueue& dsq)
+{
+    AssertLockHeld(cs_vecqueue);
+    vecPrivateSendQueue.push_back(dsq);
+    mapQueueCountByMasternode[dsq.masternodeOutpoint]++;
+}
+
+bool CPrivateSendBaseManager::HasQueue(const CPrivateSendQueue& dsq) const
+{
+    AssertLockHeld(cs_vecqueue);
+    if (!HasQueueFromMasternode(dsq.masternodeOutpoint)) {
+        return false;
+    }
+    for (const auto& q : vecPrivateSendQueue) {
+        if (q == dsq) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void CPrivateSendBaseManager::CheckQueue()
@@ -151,6 +174,13 @@ void CPrivateSendBaseManager::CheckQueue()
     while (it != vecPrivateSendQueue.end()) {
         if ((*it).IsExpired()) {
             LogPrint("privatesend", "CPrivateSendBaseManager::%s -- Removing expired queue (%s)\n", __func__, (*it).ToString());
+            auto itCount = mapQueueCountByMasternode.find(it->masternodeOutpoint);
+            if (itCount != mapQueueCountByMasternode.end() && --itCount->second <= 0) {
+                mapQueueCountByMasternode.erase(itCount);
+            }
+            if ((size_t)(it - vecPrivateSendQueue.begin()) < nFirstUntriedQueue) {
+                nFirstUntriedQueue--;
+            }
             it = vecPrivateSendQueue.erase(it);
         } else
             ++it;
@@ -162,11 +192,14 @@ bool CPrivateSendBaseManager::GetQueueItemAndTry(CPrivateSendQueue& dsqRet)
     TRY_LOCK(cs_vecqueue, lockDS);
     if (!lockDS) return false; // it's ok to fail here, we run this quite frequently
 
-    for (auto& dsq : vecPrivateSendQueue) {
+    // queues are only ever marked as tried, so the ones in front don't need to be looked at again
+    for (; nFirstUntriedQueue < vecPrivateSendQueue.size(); nFirstUntriedQueue++) {
+        auto& dsq = vecPrivateSendQueue[nFirstUntriedQueue];
         // only try each queue once
         if (dsq.fTried || dsq.IsExpired()) continue;
         dsq.fTried = true;
         dsqRet = dsq;
+        nFirstUntriedQueue++;
         return true;
     }
 
@@ -195,7 +228,8 @@ std::string CPrivateSendBaseSession::GetStateString() const
 
 // Definitions for static data members
 std::vector<CAmount> CPrivateSend::vecStandardDenominations;
-std::map<uint256, CPrivateSendBroadcastTx> CPrivateSend::mapDSTX;
+std::unordered_map<uint256, CPrivateSendBroadcastTx, StaticSaltedHasher> CPrivateSend::mapDSTX;
+std::map<int, std::unordered_set<uint256, StaticSaltedHasher>> CPrivateSend::mapDSTXByConfirmedHeight;
 CCriticalSection CPrivateSend::cs_mapdstx;
 
 void CPrivateSend::InitStandardDenominations()
@@ -463,16 +497,22 @@ CPrivateSendBroadcastTx CPrivateSend::GetDSTX(const uint256& hash)
     return (it == mapDSTX.end()) ? CPrivateSendBroadcastTx() : it->second;
 }
 
+bool CPrivateSend::HasDSTX(const uint256& hash)
+{
+    LOCK(cs_mapdstx);
+    return mapDSTX.count(hash) != 0;
+}
+
 void CPrivateSend::CheckDSTXes(int nHeight)
 {
     LOCK(cs_mapdstx);
-    std::map<uint256, CPrivateSendBroadcastTx>::iterator it = mapDSTX.begin();
-    while (it != mapDSTX.end()) {
-        if (it->second.IsExpired(nHeight)) {
-            mapDSTX.erase(it++);
-        } else {
-            ++it;
+    // unconfirmed DSTXes never expire, the confirmed ones expire in the order of their confirmed heights
+    auto it = mapDSTXByConfirmedHeight.begin();
+    while (it != mapDSTXByConfirmedHeight.end() && nHeight - it->first > PRIVATESEND_DSTX_EXPIRATION_BLOCKS) {
+        for (const auto& txHash : it->second) {
+            mapDSTX.erase(txHash);
         }
+        it = mapDSTXByConfirmedHeight.erase(it);
     }
     LogPrint("privatesend", "CPrivateSend::CheckDSTXes -- mapDSTX.size()=%llu\n", mapDSTX.size());
 }
@@ -488,12 +528,28 @@ void CPrivateSend::SyncTransaction(const CTransaction& tx, const CBlockIndex* pi
 {
     if (tx.IsCoinBase()) return;
 
-    LOCK2(cs_main, cs_mapdstx);
+    // pindex->nHeight never changes, so cs_main isn't needed
+    LOCK(cs_mapdstx);
 
     uint256 txHash = tx.GetHash();
-    if (!mapDSTX.count(txHash)) return;
+    auto it = mapDSTX.find(txHash);
+    if (it == mapDSTX.end()) return;
 
     // When tx is 0-confirmed or conflicted, posInBlock is SYNC_TRANSACTION_NOT_IN_BLOCK and nConfirmedHeight should be set to -1
-    mapDSTX[txHash].SetConfirmedHeight(posInBlock == CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK ? -1 : pindex->nHeight);
+    int nOldHeight = it->second.GetConfirmedHeight();
+    int nNewHeight = posInBlock == CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK ? -1 : pindex->nHeight;
+    if (nOldHeight != -1) {
+        auto itHeight = mapDSTXByConfirmedHeight.find(nOldHeight);
+        if (itHeight != mapDSTXByConfirmedHeight.end()) {
+            itHeight->second.erase(txHash);
+            if (itHeight->second.empty()) {
+                mapDSTXByConfirmedHeight.erase(itHeight);
+            }
+        }
+    }
+    if (nNewHeight != -1) {
+        mapDSTXByConfirmedHeight[nNewHeight].emplace(txHash);
+    }
+    it->second.SetConfirmedHeight(nNewHeight);
     LogPrint("privatesend", "CPrivateSend::SyncTransaction -- txid=%s\n", txHash.ToString());
 }
@@ -10,10 +10,15 @@
 #include "chainparams.h"
 #include "primitives/transaction.h"
 #include "pubkey.h"
+#include "saltedhasher.h"
 #include "sync.h"
 #include "timedata.h"
 #include "tinyformat.h"
 
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
 class CPrivateSend;
 class CConnman;
 
@@ -22,6 +27,8 @@ static const int PRIVATESEND_AUTO_TIMEOUT_MIN = 5;
 static const int PRIVATESEND_AUTO_TIMEOUT_MAX = 15;
 static const int PRIVATESEND_QUEUE_TIMEOUT = 30;
 static const int PRIVATESEND_SIGNING_TIMEOUT = 15;
+// confirmed DSTXes are forgotten after this many blocks (~1h)
+static const int PRIVATESEND_DSTX_EXPIRATION_BLOCKS = 24;
 
 //! minimum peer version accepted by mixing pool
 static const int MIN_PRIVATESEND_PEER_PROTO_VERSION = 70213;
@@ -309,6 +316,7 @@ public:
     bool CheckSignature(const CBLSPublicKey& blsPubKey) const;
 
     void SetConfirmedHeight(int nConfirmedHeightIn) { nConfirmedHeight = nConfirmedHeightIn; }
+    int GetConfirmedHeight() const { return nConfirmedHeight; }
     bool IsExpired(int nHeight);
 };
 
@@ -356,13 +364,26 @@ protected:
 
     // The current mixing sessions in progress on the network
     std::vector<CPrivateSendQueue> vecPrivateSendQueue;
+    // Number of queues in vecPrivateSendQueue of each masternode
+    std::map<COutPoint, int> mapQueueCountByMasternode;
+    // Queues in front of this one in vecPrivateSendQueue are all tried already
+    size_t nFirstUntriedQueue;
 
     void SetNull();
     void CheckQueue();
 
+    /// Add a queue, cs_vecqueue must be held
+    void AddQueue(const CPrivateSendQueue& dsq);
+    /// Check if the same queue is known already, cs_vecqueue must be held
+    bool HasQueue(const CPrivateSendQueue& dsq) const;
+    /// Check if there is a queue of the masternode, cs_vecqueue must be held
+    bool HasQueueFromMasternode(const COutPoint& outpointMn) const { return mapQueueCountByMasternode.count(outpointMn) != 0; }
+
 public:
     CPrivateSendBaseManager() :
-        vecPrivateSendQueue() {}
+        vecPrivateSendQueue(),
+        mapQueueCountByMasternode(),
+        nFirstUntriedQueue(0) {}
 
     int GetQueueSize() const { return vecPrivateSendQueue.size(); }
     bool GetQueueItemAndTry(CPrivateSendQueue& dsqRet);
@@ -380,7 +401,9 @@ private:
 
     // static members
     static std::vector<CAmount> vecStandardDenominations;
-    static std::map<uint256, CPrivateSendBroadcastTx> mapDSTX;
+    static std::unordered_map<uint256, CPrivateSendBroadcastTx, StaticSaltedHasher> mapDSTX;
+    // hashes of the confirmed DSTXes by their confirmed height, so that CheckDSTXes only visits the expiring ones
+    static std::map<int, std::unordered_set<uint256, StaticSaltedHasher>> mapDSTXByConfirmedHeight;
 
     static CCriticalSection cs_mapdstx;
 
@@ -418,6 +441,7 @@ public:
 
     static void AddDSTX(const CPrivateSendBroadcastTx& dstx);
     static CPrivateSendBroadcastTx GetDSTX(const uint256& hash);
+    static bool HasDSTX(const uint256& hash);
 
     static void UpdatedBlockTip(const CBlockIndex* pindex);
     static void SyncTransaction(const CTransaction& tx, const CBlockIndex* pindex, int posInBlock);
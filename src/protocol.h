@@ -242,6 +242,35 @@ extern const char *GETBLOCKTXN;
  * @since protocol version 70209 as described by BIP 152
  */
 extern const char *BLOCKTXN;
+/**
+ * getcfilters requests the compact filters of a range of blocks, the peer answers
+ * with one "cfilter" message per block.
+ * Only available with service bit NODE_COMPACT_FILTERS as described by BIP157.
+ */
+extern const char *GETCFILTERS;
+/**
+ * cfilter is the compact filter of one block, sent in response to "getcfilters".
+ */
+extern const char *CFILTER;
+/**
+ * getcfheaders requests the filter hashes of a range of blocks together with the
+ * filter header of the block before the range.
+ * Only available with service bit NODE_COMPACT_FILTERS as described by BIP157.
+ */
+extern const char *GETCFHEADERS;
+/**
+ * cfheaders is sent in response to "getcfheaders".
+ */
+extern const char *CFHEADERS;
+/**
+ * getcfcheckpt requests the filter headers of every 1000th block up to a stop hash.
+ * Only available with service bit NODE_COMPACT_FILTERS as described by BIP157.
+ */
+extern const char *GETCFCHECKPT;
+/**
+ * cfcheckpt is sent in response to "getcfcheckpt".
+ */
+extern const char *CFCHECKPT;
 
 // Historia message types
 // NOTE: do NOT declare non-implmented here, we don't want them to be exposed to the outside
@@ -259,10 +288,16 @@ extern const char *DSSTATUSUPDATE;
 extern const char *DSTX;
 extern const char *DSQUEUE;
 extern const char *SENDDSQUEUE;
+extern const char *SENDRECON;
+extern const char *REQRECON;
+extern const char *SKETCH;
+extern const char *RECONCILDIFF;
 extern const char *SYNCSTATUSCOUNT;
 extern const char *MNGOVERNANCESYNC;
 extern const char *MNGOVERNANCEOBJECT;
 extern const char *MNGOVERNANCEOBJECTVOTE;
+extern const char *MNGOVERNANCEVOTEDIGESTS;
+extern const char *MNGOVERNANCEOBJECTCOMPRESSED;
 extern const char *GETMNLISTDIFF;
 extern const char *MNLISTDIFF;
 extern const char *QSENDRECSIGS;
@@ -304,6 +339,9 @@ enum ServiceFlags : uint64_t {
     // NODE_XTHIN means the node supports Xtreme Thinblocks
     // If this is turned off then the node will not service nor make xthin requests
     NODE_XTHIN = (1 << 4),
+    // NODE_COMPACT_FILTERS means the node serves the basic block filters and filter headers
+    // of BIP157/BIP158, see -peerblockfilters
+    NODE_COMPACT_FILTERS = (1 << 6),
 
     // Bits 24-31 are reserved for temporary experiments. Just pick a bit that
     // isn't getting used, or one not being used much, and notify the
@@ -439,6 +439,12 @@ static void NotifyMasternodeListChanged(ClientModel *clientmodel, const CDetermi
     clientmodel->setMasternodeList(newList);
 }
 
+static void NotifyGovernanceObjectChanged(ClientModel *clientmodel, const uint256& nHash)
+{
+    QMetaObject::invokeMethod(clientmodel, "governanceObjectChanged", Qt::QueuedConnection,
+                              Q_ARG(QString, QString::fromStdString(nHash.ToString())));
+}
+
 static void NotifyAdditionalDataSyncProgressChanged(ClientModel *clientmodel, double nSyncProgress)
 {
     QMetaObject::invokeMethod(clientmodel, "additionalDataSyncProgressChanged", Qt::QueuedConnection,
@@ -456,6 +462,7 @@ void ClientModel::subscribeToCoreSignals()
     uiInterface.NotifyBlockTip.connect(boost::bind(BlockTipChanged, this, _1, _2, false));
     uiInterface.NotifyHeaderTip.connect(boost::bind(BlockTipChanged, this, _1, _2, true));
     uiInterface.NotifyMasternodeListChanged.connect(boost::bind(NotifyMasternodeListChanged, this, _1));
+    uiInterface.NotifyGovernanceObjectChanged.connect(boost::bind(NotifyGovernanceObjectChanged, this, _1));
     uiInterface.NotifyAdditionalDataSyncProgressChanged.connect(boost::bind(NotifyAdditionalDataSyncProgressChanged, this, _1));
 }
 
@@ -470,5 +477,6 @@ void ClientModel::unsubscribeFromCoreSignals()
     uiInterface.NotifyBlockTip.disconnect(boost::bind(BlockTipChanged, this, _1, _2, false));
     uiInterface.NotifyHeaderTip.disconnect(boost::bind(BlockTipChanged, this, _1, _2, true));
     uiInterface.NotifyMasternodeListChanged.disconnect(boost::bind(NotifyMasternodeListChanged, this, _1));
+    uiInterface.NotifyGovernanceObjectChanged.disconnect(boost::bind(NotifyGovernanceObjectChanged, this, _1));
     uiInterface.NotifyAdditionalDataSyncProgressChanged.disconnect(boost::bind(NotifyAdditionalDataSyncProgressChanged, this, _1));
 }
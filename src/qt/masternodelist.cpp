@@ -7,6 +7,7 @@
 #include "guiutil.h"
 #include "init.h"
 #include "masternode-sync.h"
+#include "masternodetablemodel.h"
 #include "netbase.h"
 #include "sync.h"
 #include "wallet/wallet.h"
@@ -34,13 +35,16 @@ MasternodeList::MasternodeList(const PlatformStyle* platformStyle, QWidget* pare
     ui(new Ui::MasternodeList),
     clientModel(0),
     walletModel(0),
-    fFilterUpdatedDIP3(true),
-    nTimeFilterUpdatedDIP3(0),
-    nTimeUpdatedDIP3(0),
-    mnListChanged(true)
+    nTimeUpdatedDIP3(0)
 {
     ui->setupUi(this);
 
+    mnTableModel = new MasternodeTableModel(this);
+    mnProxyModel = new MasternodeFilterProxyModel(this);
+    mnProxyModel->setSourceModel(mnTableModel);
+    ui->tableViewMasternodesDIP3->setModel(mnProxyModel);
+    ui->tableViewMasternodesDIP3->sortByColumn(MasternodeTableModel::Address, Qt::AscendingOrder);
+
     int columnAddressWidth = 200;
     int columnStatusWidth = 80;
     int columnPoSeScoreWidth = 80;
@@ -50,35 +54,33 @@ MasternodeList::MasternodeList(const PlatformStyle* platformStyle, QWidget* pare
     int columnPayeeWidth = 130;
     int columnOperatorRewardWidth = 130;
 
-    ui->tableWidgetMasternodesDIP3->setColumnWidth(0, columnAddressWidth);
-    ui->tableWidgetMasternodesDIP3->setColumnWidth(1, columnStatusWidth);
-    ui->tableWidgetMasternodesDIP3->setColumnWidth(2, columnPoSeScoreWidth);
-    ui->tableWidgetMasternodesDIP3->setColumnWidth(3, columnRegisteredWidth);
-    ui->tableWidgetMasternodesDIP3->setColumnWidth(4, columnLastPaidWidth);
-    ui->tableWidgetMasternodesDIP3->setColumnWidth(5, columnNextPaymentWidth);
-    ui->tableWidgetMasternodesDIP3->setColumnWidth(6, columnPayeeWidth);
-    ui->tableWidgetMasternodesDIP3->setColumnWidth(7, columnOperatorRewardWidth);
+    ui->tableViewMasternodesDIP3->setColumnWidth(MasternodeTableModel::Address, columnAddressWidth);
+    ui->tableViewMasternodesDIP3->setColumnWidth(MasternodeTableModel::Status, columnStatusWidth);
+    ui->tableViewMasternodesDIP3->setColumnWidth(MasternodeTableModel::PoSeScore, columnPoSeScoreWidth);
+    ui->tableViewMasternodesDIP3->setColumnWidth(MasternodeTableModel::Registered, columnRegisteredWidth);
+    ui->tableViewMasternodesDIP3->setColumnWidth(MasternodeTableModel::LastPaid, columnLastPaidWidth);
+    ui->tableViewMasternodesDIP3->setColumnWidth(MasternodeTableModel::NextPayment, columnNextPaymentWidth);
+    ui->tableViewMasternodesDIP3->setColumnWidth(MasternodeTableModel::Payee, columnPayeeWidth);
+    ui->tableViewMasternodesDIP3->setColumnWidth(MasternodeTableModel::OperatorReward, columnOperatorRewardWidth);
 
-    // dummy column for proTxHash
-    // TODO use a proper table model for the MN list
-    ui->tableWidgetMasternodesDIP3->insertColumn(8);
-    ui->tableWidgetMasternodesDIP3->setColumnHidden(8, true);
+    // the proTxHash is only used for filtering
+    ui->tableViewMasternodesDIP3->setColumnHidden(MasternodeTableModel::ProTxHash, true);
 
-    ui->tableWidgetMasternodesDIP3->setContextMenuPolicy(Qt::CustomContextMenu);
+    ui->tableViewMasternodesDIP3->setContextMenuPolicy(Qt::CustomContextMenu);
 
     QAction* copyProTxHashAction = new QAction(tr("Copy ProTx Hash"), this);
     QAction* copyCollateralOutpointAction = new QAction(tr("Copy Collateral Outpoint"), this);
     contextMenuDIP3 = new QMenu();
     contextMenuDIP3->addAction(copyProTxHashAction);
     contextMenuDIP3->addAction(copyCollateralOutpointAction);
-    connect(ui->tableWidgetMasternodesDIP3, SIGNAL(customContextMenuRequested(const QPoint&)), this, SLOT(showContextMenuDIP3(const QPoint&)));
-    connect(ui->tableWidgetMasternodesDIP3, SIGNAL(doubleClicked(QModelIndex)), this, SLOT(extraInfoDIP3_clicked()));
+    connect(ui->tableViewMasternodesDIP3, SIGNAL(customContextMenuRequested(const QPoint&)), this, SLOT(showContextMenuDIP3(const QPoint&)));
+    connect(ui->tableViewMasternodesDIP3, SIGNAL(doubleClicked(QModelIndex)), this, SLOT(extraInfoDIP3_clicked()));
     connect(copyProTxHashAction, SIGNAL(triggered()), this, SLOT(copyProTxHash_clicked()));
     connect(copyCollateralOutpointAction, SIGNAL(triggered()), this, SLOT(copyCollateralOutpoint_clicked()));
 
     timer = new QTimer(this);
+    timer->setSingleShot(true);
     connect(timer, SIGNAL(timeout()), this, SLOT(updateDIP3ListScheduled()));
-    timer->start(1000);
 }
 
 MasternodeList::~MasternodeList()
@@ -92,53 +94,34 @@ void MasternodeList::setClientModel(ClientModel* model)
     if (model) {
         // try to update list when masternode count changes
         connect(clientModel, SIGNAL(masternodeListChanged()), this, SLOT(handleMasternodeListChanged()));
+        updateDIP3List();
     }
 }
 
 void MasternodeList::setWalletModel(WalletModel* model)
 {
     this->walletModel = model;
+    mnTableModel->setWalletModel(model);
 }
 
 void MasternodeList::showContextMenuDIP3(const QPoint& point)
 {
-    QTableWidgetItem* item = ui->tableWidgetMasternodesDIP3->itemAt(point);
-    if (item) contextMenuDIP3->exec(QCursor::pos());
+    QModelIndex index = ui->tableViewMasternodesDIP3->indexAt(point);
+    if (index.isValid()) contextMenuDIP3->exec(QCursor::pos());
 }
 
 void MasternodeList::handleMasternodeListChanged()
 {
-    LOCK(cs_dip3list);
-    mnListChanged = true;
+    if (timer->isActive()) {
+        return;
+    }
+    int64_t nSecondsToWait = std::max<int64_t>(0, nTimeUpdatedDIP3 - GetTime() + MASTERNODELIST_UPDATE_SECONDS);
+    timer->start(nSecondsToWait * 1000);
 }
 
 void MasternodeList::updateDIP3ListScheduled()
 {
-    TRY_LOCK(cs_dip3list, fLockAcquired);
-    if (!fLockAcquired) return;
-
-    if (!clientModel || ShutdownRequested()) {
-        return;
-    }
-
-    // To prevent high cpu usage update only once in MASTERNODELIST_FILTER_COOLDOWN_SECONDS seconds
-    // after filter was last changed unless we want to force the update.
-    if (fFilterUpdatedDIP3) {
-        int64_t nSecondsToWait = nTimeFilterUpdatedDIP3 - GetTime() + MASTERNODELIST_FILTER_COOLDOWN_SECONDS;
-        ui->countLabelDIP3->setText(QString::fromStdString(strprintf("Please wait... %d", nSecondsToWait)));
-
-        if (nSecondsToWait <= 0) {
-            updateDIP3List();
-            fFilterUpdatedDIP3 = false;
-        }
-    } else if (mnListChanged) {
-        int64_t nSecondsToWait = nTimeUpdatedDIP3 - GetTime() + MASTERNODELIST_UPDATE_SECONDS;
-
-        if (nSecondsToWait <= 0) {
-            updateDIP3List();
-            mnListChanged = false;
-        }
-    }
+    updateDIP3List();
 }
 
 void MasternodeList::updateDIP3List()
@@ -147,149 +130,38 @@ void MasternodeList::updateDIP3List()
         return;
     }
 
-    LOCK(cs_dip3list);
-
-    QString strToFilter;
-    ui->countLabelDIP3->setText("Updating...");
-    ui->tableWidgetMasternodesDIP3->setSortingEnabled(false);
-    ui->tableWidgetMasternodesDIP3->clearContents();
-    ui->tableWidgetMasternodesDIP3->setRowCount(0);
-
-    auto mnList = clientModel->getMasternodeList();
+    // only the rows of masternodes which changed since the last update are touched
+    mnTableModel->setMasternodeList(clientModel->getMasternodeList());
     nTimeUpdatedDIP3 = GetTime();
 
-    auto projectedPayees = mnList.GetProjectedMNPayees(mnList.GetValidMNsCount());
-    std::map<uint256, int> nextPayments;
-    for (size_t i = 0; i < projectedPayees.size(); i++) {
-        const auto& dmn = projectedPayees[i];
-        nextPayments.emplace(dmn->proTxHash, mnList.GetHeight() + (int)i + 1);
-    }
-
-    std::set<COutPoint> setOutpts;
-    if (walletModel && ui->checkBoxMyMasternodesOnly->isChecked()) {
-        std::vector<COutPoint> vOutpts;
-        walletModel->listProTxCoins(vOutpts);
-        for (const auto& outpt : vOutpts) {
-            setOutpts.emplace(outpt);
-        }
-    }
+    updateCountLabel();
+}
 
-    mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
-        if (walletModel && ui->checkBoxMyMasternodesOnly->isChecked()) {
-            bool fMyMasternode = setOutpts.count(dmn->collateralOutpoint) ||
-                walletModel->havePrivKey(dmn->pdmnState->keyIDOwner) ||
-                walletModel->havePrivKey(dmn->pdmnState->keyIDVoting) ||
-                walletModel->havePrivKey(dmn->pdmnState->scriptPayout) ||
-                walletModel->havePrivKey(dmn->pdmnState->scriptOperatorPayout);
-            if (!fMyMasternode) return;
-        }
-        // populate list
-        // Address, Protocol, Status, Active Seconds, Last Seen, Pub Key
-        QTableWidgetItem* addressItem = new QTableWidgetItem(QString::fromStdString(dmn->pdmnState->addr.ToString()));
-        QTableWidgetItem* statusItem = new QTableWidgetItem(mnList.IsMNValid(dmn) ? ((mnList.IsVNValid(dmn->collateralOutpoint) ? tr("VOTER") : tr("ENABLED"))) : (mnList.IsMNPoSeBanned(dmn) ? tr("POSE_BANNED") : tr("UNKNOWN")));
-        QTableWidgetItem* PoSeScoreItem = new QTableWidgetItem(QString::number(dmn->pdmnState->nPoSePenalty));
-        QTableWidgetItem* registeredItem = new QTableWidgetItem(QString::number(dmn->pdmnState->nRegisteredHeight));
-        QTableWidgetItem* lastPaidItem = new QTableWidgetItem(QString::number(dmn->pdmnState->nLastPaidHeight));
-        QTableWidgetItem* nextPaymentItem = new QTableWidgetItem(nextPayments.count(dmn->proTxHash) ? QString::number(nextPayments[dmn->proTxHash]) : ((mnList.IsVNValid(dmn->collateralOutpoint) ? tr("VOTER") : tr("UNKNOWN"))));
-
-        CTxDestination payeeDest;
-        QString payeeStr;
-        if (ExtractDestination(dmn->pdmnState->scriptPayout, payeeDest)) {
-            payeeStr = QString::fromStdString(CBitcoinAddress(payeeDest).ToString());
-        } else {
-            payeeStr = tr("UNKNOWN");
-        }
-        QTableWidgetItem* payeeItem = new QTableWidgetItem(payeeStr);
-
-        QString operatorRewardStr;
-        if (dmn->nOperatorReward) {
-            operatorRewardStr += QString::number(dmn->nOperatorReward / 100.0, 'f', 2) + "% ";
-
-            if (dmn->pdmnState->scriptOperatorPayout != CScript()) {
-                CTxDestination operatorDest;
-                if (ExtractDestination(dmn->pdmnState->scriptOperatorPayout, operatorDest)) {
-                    operatorRewardStr += tr("to %1").arg(QString::fromStdString(CBitcoinAddress(operatorDest).ToString()));
-                } else {
-                    operatorRewardStr += tr("to UNKNOWN");
-                }
-            } else {
-                operatorRewardStr += tr("but not claimed");
-            }
-        } else {
-            operatorRewardStr = tr("NONE");
-        }
-        QTableWidgetItem* operatorRewardItem = new QTableWidgetItem(operatorRewardStr);
-        QTableWidgetItem* proTxHashItem = new QTableWidgetItem(QString::fromStdString(dmn->proTxHash.ToString()));
-
-        if (strCurrentFilterDIP3 != "") {
-            strToFilter = addressItem->text() + " " +
-                          statusItem->text() + " " +
-                          PoSeScoreItem->text() + " " +
-                          registeredItem->text() + " " +
-                          lastPaidItem->text() + " " +
-                          nextPaymentItem->text() + " " +
-                          payeeItem->text() + " " +
-                          operatorRewardItem->text() + " " +
-                          proTxHashItem->text();
-            if (!strToFilter.contains(strCurrentFilterDIP3)) return;
-        }
-
-        ui->tableWidgetMasternodesDIP3->insertRow(0);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 0, addressItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 1, statusItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 2, PoSeScoreItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 3, registeredItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 4, lastPaidItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 5, nextPaymentItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 6, payeeItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 7, operatorRewardItem);
-        ui->tableWidgetMasternodesDIP3->setItem(0, 8, proTxHashItem);
-    });
-
-    ui->countLabelDIP3->setText(QString::number(ui->tableWidgetMasternodesDIP3->rowCount()));
-    ui->tableWidgetMasternodesDIP3->setSortingEnabled(true);
+void MasternodeList::updateCountLabel()
+{
+    ui->countLabelDIP3->setText(QString::number(mnProxyModel->rowCount()));
 }
 
 void MasternodeList::on_filterLineEditDIP3_textChanged(const QString& strFilterIn)
 {
-    strCurrentFilterDIP3 = strFilterIn;
-    nTimeFilterUpdatedDIP3 = GetTime();
-    fFilterUpdatedDIP3 = true;
-    ui->countLabelDIP3->setText(QString::fromStdString(strprintf("Please wait... %d", MASTERNODELIST_FILTER_COOLDOWN_SECONDS)));
+    mnProxyModel->setFilterFixedString(strFilterIn);
+    updateCountLabel();
 }
 
 void MasternodeList::on_checkBoxMyMasternodesOnly_stateChanged(int state)
 {
-    // no cooldown
-    nTimeFilterUpdatedDIP3 = GetTime() - MASTERNODELIST_FILTER_COOLDOWN_SECONDS;
-    fFilterUpdatedDIP3 = true;
+    mnProxyModel->setMineOnly(walletModel && state == Qt::Checked);
+    updateCountLabel();
 }
 
 CDeterministicMNCPtr MasternodeList::GetSelectedDIP3MN()
 {
-    if (!clientModel) {
-        return nullptr;
-    }
-
-    std::string strProTxHash;
-    {
-        LOCK(cs_dip3list);
-
-        QItemSelectionModel* selectionModel = ui->tableWidgetMasternodesDIP3->selectionModel();
-        QModelIndexList selected = selectionModel->selectedRows();
-
-        if (selected.count() == 0) return nullptr;
-
-        QModelIndex index = selected.at(0);
-        int nSelectedRow = index.row();
-        strProTxHash = ui->tableWidgetMasternodesDIP3->item(nSelectedRow, 8)->text().toStdString();
-    }
+    QItemSelectionModel* selectionModel = ui->tableViewMasternodesDIP3->selectionModel();
+    QModelIndexList selected = selectionModel->selectedRows();
 
-    uint256 proTxHash;
-    proTxHash.SetHex(strProTxHash);
+    if (selected.count() == 0) return nullptr;
 
-    auto mnList = clientModel->getMasternodeList();
-    return mnList.GetMN(proTxHash);
+    return mnTableModel->getMN(mnProxyModel->mapToSource(selected.at(0)).row());
 }
 
 void MasternodeList::extraInfoDIP3_clicked()
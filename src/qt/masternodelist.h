@@ -13,7 +13,6 @@
 #include <QWidget>
 
 #define MASTERNODELIST_UPDATE_SECONDS 3
-#define MASTERNODELIST_FILTER_COOLDOWN_SECONDS 3
 
 namespace Ui
 {
@@ -21,6 +20,8 @@ class MasternodeList;
 }
 
 class ClientModel;
+class MasternodeFilterProxyModel;
+class MasternodeTableModel;
 class WalletModel;
 
 QT_BEGIN_NAMESPACE
@@ -41,25 +42,21 @@ public:
 
 private:
     QMenu* contextMenuDIP3;
-    int64_t nTimeFilterUpdatedDIP3;
     int64_t nTimeUpdatedDIP3;
-    bool fFilterUpdatedDIP3;
 
+    // coalesces list changes, the model is updated at most once per MASTERNODELIST_UPDATE_SECONDS
     QTimer* timer;
     Ui::MasternodeList* ui;
     ClientModel* clientModel;
     WalletModel* walletModel;
 
-    // Protects tableWidgetMasternodesDIP3
-    CCriticalSection cs_dip3list;
-
-    QString strCurrentFilterDIP3;
-
-    bool mnListChanged;
+    MasternodeTableModel* mnTableModel;
+    MasternodeFilterProxyModel* mnProxyModel;
 
     CDeterministicMNCPtr GetSelectedDIP3MN();
 
     void updateDIP3List();
+    void updateCountLabel();
 
 Q_SIGNALS:
     void doubleClicked(const QModelIndex&);
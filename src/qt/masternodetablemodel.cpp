@@ -0,0 +1,358 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternodetablemodel.h"
+
+#include "base58.h"
+#include "walletmodel.h"
+
+#include <algorithm>
+#include <limits>
+
+// Above this number of changed masternodes the whole model is reset instead of being updated row by row
+static const size_t MAX_INCREMENTAL_CHANGES = 1000;
+
+MasternodeTableModel::MasternodeTableModel(QObject* parent) :
+    QAbstractTableModel(parent),
+    walletModel(0)
+{
+    columns << tr("Address") << tr("Status") << tr("PoSe Score") << tr("Registered") << tr("Last Paid")
+            << tr("Next Payment") << tr("Payee") << tr("Operator Reward") << tr("ProTx Hash");
+}
+
+void MasternodeTableModel::setWalletModel(WalletModel* _walletModel)
+{
+    walletModel = _walletModel;
+    for (const auto& entry : entries) {
+        entry.nMine = -1;
+    }
+    fProTxCoinsLoaded = false;
+}
+
+void MasternodeTableModel::setMasternodeList(const CDeterministicMNList& newList)
+{
+    if (newList.GetBlockHash() == mnList.GetBlockHash()) {
+        return;
+    }
+
+    CDeterministicMNListDiff diff = mnList.BuildDiff(newList);
+    CDeterministicMNList oldList = mnList;
+    mnList = newList;
+
+    // keys may have been added to the wallet in the meantime
+    for (const auto& entry : entries) {
+        entry.nMine = -1;
+    }
+    fProTxCoinsLoaded = false;
+
+    if (entries.empty() || diff.addedMNs.size() + diff.updatedMNs.size() + diff.removedMns.size() > MAX_INCREMENTAL_CHANGES) {
+        beginResetModel();
+        resetEntries();
+        updateNextPayments();
+        endResetModel();
+        return;
+    }
+
+    std::vector<int> vecRemovedRows;
+    for (const auto& id : diff.removedMns) {
+        auto dmn = oldList.GetMNByInternalId(id);
+        if (!dmn) {
+            continue;
+        }
+        auto it = mapRows.find(dmn->proTxHash);
+        if (it != mapRows.end()) {
+            vecRemovedRows.emplace_back(it->second);
+        }
+    }
+    // from the last row to the first one so that the remaining row numbers stay valid
+    std::sort(vecRemovedRows.rbegin(), vecRemovedRows.rend());
+    for (int nRow : vecRemovedRows) {
+        beginRemoveRows(QModelIndex(), nRow, nRow);
+        entries.erase(entries.begin() + nRow);
+        endRemoveRows();
+    }
+    if (!vecRemovedRows.empty()) {
+        rebuildRowMap();
+    }
+
+    for (const auto& p : diff.updatedMNs) {
+        auto dmn = mnList.GetMNByInternalId(p.first);
+        if (!dmn) {
+            continue;
+        }
+        auto it = mapRows.find(dmn->proTxHash);
+        if (it == mapRows.end()) {
+            continue;
+        }
+        entries[it->second] = Entry(dmn);
+        Q_EMIT dataChanged(index(it->second, 0), index(it->second, columns.size() - 1));
+    }
+
+    if (!diff.addedMNs.empty()) {
+        int nFirst = entries.size();
+        beginInsertRows(QModelIndex(), nFirst, nFirst + diff.addedMNs.size() - 1);
+        for (const auto& dmn : diff.addedMNs) {
+            mapRows[dmn->proTxHash] = entries.size();
+            entries.emplace_back(dmn);
+        }
+        endInsertRows();
+    }
+
+    // the payment queue moves with every block, which changes the next payment of all rows and the status of some
+    updateNextPayments();
+    if (!entries.empty()) {
+        Q_EMIT dataChanged(index(0, Status), index(entries.size() - 1, NextPayment));
+    }
+}
+
+void MasternodeTableModel::resetEntries()
+{
+    entries.clear();
+    mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
+        entries.emplace_back(dmn);
+    });
+    rebuildRowMap();
+}
+
+void MasternodeTableModel::rebuildRowMap()
+{
+    mapRows.clear();
+    for (size_t i = 0; i < entries.size(); i++) {
+        mapRows.emplace(entries[i].dmn->proTxHash, (int)i);
+    }
+}
+
+void MasternodeTableModel::updateNextPayments()
+{
+    mapNextPayments.clear();
+    auto projectedPayees = mnList.GetProjectedMNPayees(mnList.GetValidMNsCount());
+    for (size_t i = 0; i < projectedPayees.size(); i++) {
+        mapNextPayments.emplace(projectedPayees[i]->proTxHash, mnList.GetHeight() + (int)i + 1);
+    }
+}
+
+CDeterministicMNCPtr MasternodeTableModel::getMN(int row) const
+{
+    if (row < 0 || row >= (int)entries.size()) {
+        return nullptr;
+    }
+    return entries[row].dmn;
+}
+
+int MasternodeTableModel::rowCount(const QModelIndex& parent) const
+{
+    Q_UNUSED(parent);
+    return entries.size();
+}
+
+int MasternodeTableModel::columnCount(const QModelIndex& parent) const
+{
+    Q_UNUSED(parent);
+    return columns.length();
+}
+
+void MasternodeTableModel::render(const Entry& entry) const
+{
+    if (entry.fRendered) {
+        return;
+    }
+    const auto& dmn = entry.dmn;
+
+    entry.strAddress = QString::fromStdString(dmn->pdmnState->addr.ToString());
+    entry.strProTxHash = QString::fromStdString(dmn->proTxHash.ToString());
+
+    CTxDestination payeeDest;
+    if (ExtractDestination(dmn->pdmnState->scriptPayout, payeeDest)) {
+        entry.strPayee = QString::fromStdString(CBitcoinAddress(payeeDest).ToString());
+    } else {
+        entry.strPayee = tr("UNKNOWN");
+    }
+
+    if (dmn->nOperatorReward) {
+        entry.strOperatorReward = QString::number(dmn->nOperatorReward / 100.0, 'f', 2) + "% ";
+
+        if (dmn->pdmnState->scriptOperatorPayout != CScript()) {
+            CTxDestination operatorDest;
+            if (ExtractDestination(dmn->pdmnState->scriptOperatorPayout, operatorDest)) {
+                entry.strOperatorReward += tr("to %1").arg(QString::fromStdString(CBitcoinAddress(operatorDest).ToString()));
+            } else {
+                entry.strOperatorReward += tr("to UNKNOWN");
+            }
+        } else {
+            entry.strOperatorReward += tr("but not claimed");
+        }
+    } else {
+        entry.strOperatorReward = tr("NONE");
+    }
+
+    entry.fRendered = true;
+}
+
+bool MasternodeTableModel::isVoter(const Entry& entry) const
+{
+    if (entry.nVoter == -1) {
+        entry.nVoter = mnList.IsVNValid(entry.dmn->collateralOutpoint) ? 1 : 0;
+    }
+    return entry.nVoter == 1;
+}
+
+bool MasternodeTableModel::isMine(const Entry& entry) const
+{
+    if (!walletModel) {
+        return false;
+    }
+    if (entry.nMine == -1) {
+        if (!fProTxCoinsLoaded) {
+            std::vector<COutPoint> vOutpts;
+            walletModel->listProTxCoins(vOutpts);
+            setProTxCoins = std::set<COutPoint>(vOutpts.begin(), vOutpts.end());
+            fProTxCoinsLoaded = true;
+        }
+        const auto& dmn = entry.dmn;
+        bool fMine = setProTxCoins.count(dmn->collateralOutpoint) ||
+            walletModel->havePrivKey(dmn->pdmnState->keyIDOwner) ||
+            walletModel->havePrivKey(dmn->pdmnState->keyIDVoting) ||
+            walletModel->havePrivKey(dmn->pdmnState->scriptPayout) ||
+            walletModel->havePrivKey(dmn->pdmnState->scriptOperatorPayout);
+        entry.nMine = fMine ? 1 : 0;
+    }
+    return entry.nMine == 1;
+}
+
+QString MasternodeTableModel::statusString(const Entry& entry) const
+{
+    if (mnList.IsMNValid(entry.dmn)) {
+        return isVoter(entry) ? tr("VOTER") : tr("ENABLED");
+    }
+    return mnList.IsMNPoSeBanned(entry.dmn) ? tr("POSE_BANNED") : tr("UNKNOWN");
+}
+
+QString MasternodeTableModel::nextPaymentString(const Entry& entry) const
+{
+    auto it = mapNextPayments.find(entry.dmn->proTxHash);
+    if (it != mapNextPayments.end()) {
+        return QString::number(it->second);
+    }
+    return isVoter(entry) ? tr("VOTER") : tr("UNKNOWN");
+}
+
+QString MasternodeTableModel::columnString(const Entry& entry, int column) const
+{
+    const auto& state = *entry.dmn->pdmnState;
+    switch (column) {
+    case Address:
+        render(entry);
+        return entry.strAddress;
+    case Status:
+        return statusString(entry);
+    case PoSeScore:
+        return QString::number(state.nPoSePenalty);
+    case Registered:
+        return QString::number(state.nRegisteredHeight);
+    case LastPaid:
+        return QString::number(state.nLastPaidHeight);
+    case NextPayment:
+        return nextPaymentString(entry);
+    case Payee:
+        render(entry);
+        return entry.strPayee;
+    case OperatorReward:
+        render(entry);
+        return entry.strOperatorReward;
+    case ProTxHash:
+        render(entry);
+        return entry.strProTxHash;
+    }
+    return QString();
+}
+
+QVariant MasternodeTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= (int)entries.size()) {
+        return QVariant();
+    }
+    const Entry& entry = entries[index.row()];
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return columnString(entry, index.column());
+    case SortRole: {
+        const auto& state = *entry.dmn->pdmnState;
+        switch (index.column()) {
+        case PoSeScore:
+            return state.nPoSePenalty;
+        case Registered:
+            return state.nRegisteredHeight;
+        case LastPaid:
+            return state.nLastPaidHeight;
+        case NextPayment: {
+            // masternodes without a projected payment go last
+            auto it = mapNextPayments.find(entry.dmn->proTxHash);
+            return it != mapNextPayments.end() ? it->second : std::numeric_limits<int>::max();
+        }
+        default:
+            return columnString(entry, index.column());
+        }
+    }
+    case FilterRole: {
+        QString strFilter;
+        for (int i = 0; i < columns.size(); i++) {
+            if (i != 0) {
+                strFilter += " ";
+            }
+            strFilter += columnString(entry, i);
+        }
+        return strFilter;
+    }
+    case MineRole:
+        return isMine(entry);
+    }
+    return QVariant();
+}
+
+QVariant MasternodeTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section < columns.size()) {
+        return columns[section];
+    }
+    return QVariant();
+}
+
+Qt::ItemFlags MasternodeTableModel::flags(const QModelIndex& index) const
+{
+    if (!index.isValid()) {
+        return 0;
+    }
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+}
+
+MasternodeFilterProxyModel::MasternodeFilterProxyModel(QObject* parent) :
+    QSortFilterProxyModel(parent)
+{
+    setSortRole(MasternodeTableModel::SortRole);
+    setFilterRole(MasternodeTableModel::FilterRole);
+    setFilterKeyColumn(0);
+    setDynamicSortFilter(true);
+}
+
+void MasternodeFilterProxyModel::setMineOnly(bool _fMineOnly)
+{
+    fMineOnly = _fMineOnly;
+    invalidateFilter();
+}
+
+bool MasternodeFilterProxyModel::filterAcceptsRow(int source_row, const QModelIndex& source_parent) const
+{
+    if (fMineOnly) {
+        QModelIndex index = sourceModel()->index(source_row, 0, source_parent);
+        if (!index.data(MasternodeTableModel::MineRole).toBool()) {
+            return false;
+        }
+    }
+    // only build the filter string if there is something to filter for
+    if (filterRegExp().isEmpty()) {
+        return true;
+    }
+    return QSortFilterProxyModel::filterAcceptsRow(source_row, source_parent);
+}
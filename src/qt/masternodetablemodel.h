@@ -0,0 +1,126 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef HTA_QT_MASTERNODETABLEMODEL_H
+#define HTA_QT_MASTERNODETABLEMODEL_H
+
+#include "evo/deterministicmns.h"
+
+#include <QAbstractTableModel>
+#include <QSortFilterProxyModel>
+#include <QStringList>
+
+#include <map>
+#include <set>
+#include <vector>
+
+class WalletModel;
+
+/**
+   Qt model of the deterministic masternode list. When the list changes, only the rows of masternodes
+   which were added, updated or removed are touched, and the strings of a row are built when the view
+   asks for them for the first time.
+ */
+class MasternodeTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit MasternodeTableModel(QObject* parent = 0);
+
+    enum ColumnIndex {
+        Address = 0,
+        Status = 1,
+        PoSeScore = 2,
+        Registered = 3,
+        LastPaid = 4,
+        NextPayment = 5,
+        Payee = 6,
+        OperatorReward = 7,
+        ProTxHash = 8
+    };
+
+    enum RoleIndex {
+        /** Numbers for the numeric columns, the display string for the others */
+        SortRole = Qt::UserRole,
+        /** All columns of the row joined by spaces */
+        FilterRole,
+        /** Whether the masternode is related to the wallet */
+        MineRole
+    };
+
+    void setWalletModel(WalletModel* walletModel);
+    /** Update the rows to mnList, using the diff to the list the model currently shows */
+    void setMasternodeList(const CDeterministicMNList& mnList);
+    CDeterministicMNCPtr getMN(int row) const;
+
+    /** @name Methods overridden from QAbstractTableModel
+        @{*/
+    int rowCount(const QModelIndex& parent) const;
+    int columnCount(const QModelIndex& parent) const;
+    QVariant data(const QModelIndex& index, int role) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const;
+    Qt::ItemFlags flags(const QModelIndex& index) const;
+    /*@}*/
+
+private:
+    struct Entry {
+        CDeterministicMNCPtr dmn;
+
+        // built on first use by data(), reset when the masternode is updated
+        mutable bool fRendered{false};
+        mutable QString strAddress;
+        mutable QString strPayee;
+        mutable QString strOperatorReward;
+        mutable QString strProTxHash;
+        // -1 if not looked up yet, the collateral amount doesn't change while the masternode exists
+        mutable int nVoter{-1};
+        mutable int nMine{-1};
+
+        explicit Entry(const CDeterministicMNCPtr& _dmn) : dmn(_dmn) {}
+    };
+
+    WalletModel* walletModel;
+    QStringList columns;
+
+    CDeterministicMNList mnList;
+    std::vector<Entry> entries;
+    // proTxHash -> row
+    std::map<uint256, int> mapRows;
+    // proTxHash -> height of the projected next payment
+    std::map<uint256, int> mapNextPayments;
+
+    mutable bool fProTxCoinsLoaded{false};
+    mutable std::set<COutPoint> setProTxCoins;
+
+    void resetEntries();
+    void updateNextPayments();
+    void rebuildRowMap();
+
+    void render(const Entry& entry) const;
+    bool isVoter(const Entry& entry) const;
+    bool isMine(const Entry& entry) const;
+    QString statusString(const Entry& entry) const;
+    QString nextPaymentString(const Entry& entry) const;
+    QString columnString(const Entry& entry, int column) const;
+};
+
+/** Sorts and filters the masternode list, optionally showing only the masternodes of the wallet */
+class MasternodeFilterProxyModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit MasternodeFilterProxyModel(QObject* parent = 0);
+
+    void setMineOnly(bool fMineOnly);
+
+protected:
+    bool filterAcceptsRow(int source_row, const QModelIndex& source_parent) const;
+
+private:
+    bool fMineOnly{false};
+};
+
+#endif // HTA_QT_MASTERNODETABLEMODEL_H
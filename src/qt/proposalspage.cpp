@@ -14,13 +14,17 @@
 #include "guiconstants.h"
 #include "guiutil.h"
 #include "init.h"
+#include "proposaltablemodel.h"
 #include "rpcconsole.h"
 #include "masternode-sync.h"
 #include "governance.h"
 
 #include <QAbstractItemDelegate>
+#include <QHeaderView>
+#include <QMouseEvent>
 #include <QPainter>
 #include <QSettings>
+#include <QStyledItemDelegate>
 #include <QTimer>
 #include <QObject>
 #include <QJsonDocument>
@@ -29,9 +33,10 @@
 #include <QStringListModel>
 #include <QDesktopServices>
 #include <QUrl>
+#include <algorithm>
 #include <ctime>
 #include <iomanip>
-#include <QTreeWidget>
+#include <QTreeView>
 #include <QStringList>
 
 #define ICON_OFFSET 16
@@ -39,6 +44,88 @@
 #define NUM_ITEMS 5
 #define NUM_ITEMS_ADV 7
 
+#define VOTE_ICON_SIZE 16
+#define VOTE_BUTTON_WIDTH 24
+
+/**
+ * Paints the yes / no / abstain buttons of the vote column and reports clicks on them, so the views don't need
+ * a widget for every row.
+ */
+class VoteButtonsDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+public:
+    explicit VoteButtonsDelegate(QObject* parent = 0) :
+        QStyledItemDelegate(parent)
+    {
+        QString theme = GUIUtil::getThemeName();
+        icons[VOTE_YES] = QIcon(":/icons/" + theme + "/vote-yes");
+        icons[VOTE_NO] = QIcon(":/icons/" + theme + "/vote-no");
+        icons[VOTE_ABSTAIN] = QIcon(":/icons/" + theme + "/vote-null");
+    }
+
+    void paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
+    {
+        QStyledItemDelegate::paint(painter, option, index);
+        if (index.parent().isValid()) {
+            return;
+        }
+        for (int i = VOTE_YES; i <= VOTE_ABSTAIN; i++) {
+            QIcon::Mode mode = isEnabled(index, (VoteButton)i) ? QIcon::Normal : QIcon::Disabled;
+            icons[i].paint(painter, buttonRect(option.rect, i), Qt::AlignCenter, mode);
+        }
+    }
+
+    bool editorEvent(QEvent* event, QAbstractItemModel* model, const QStyleOptionViewItem& option, const QModelIndex& index)
+    {
+        if (event->type() == QEvent::MouseButtonRelease && !index.parent().isValid()) {
+            QPoint pos = static_cast<QMouseEvent*>(event)->pos();
+            for (int i = VOTE_YES; i <= VOTE_ABSTAIN; i++) {
+                if (buttonRect(option.rect, i).contains(pos) && isEnabled(index, (VoteButton)i)) {
+                    Q_EMIT voteClicked((VoteButton)i, index);
+                    return true;
+                }
+            }
+        }
+        return QStyledItemDelegate::editorEvent(event, model, option, index);
+    }
+
+    QSize sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const
+    {
+        QSize size = QStyledItemDelegate::sizeHint(option, index);
+        return QSize(std::max(size.width(), 3 * VOTE_BUTTON_WIDTH), std::max(size.height(), VOTE_ICON_SIZE));
+    }
+
+Q_SIGNALS:
+    void voteClicked(VoteButton button, const QModelIndex& index);
+
+private:
+    QIcon icons[3];
+
+    static QRect buttonRect(const QRect& rect, int nButton)
+    {
+        return QRect(rect.left() + nButton * VOTE_BUTTON_WIDTH, rect.top() + (rect.height() - VOTE_ICON_SIZE) / 2,
+                     VOTE_BUTTON_WIDTH, VOTE_ICON_SIZE);
+    }
+
+    static bool isEnabled(const QModelIndex& index, VoteButton button)
+    {
+        if (!masternodeSync.IsSynced()) {
+            return false;
+        }
+        // the vote we cast last can't be cast again
+        switch (index.data(ProposalTableModel::OurVoteRole).toInt()) {
+        case VOTE_OUTCOME_YES:
+            return button != VOTE_YES;
+        case VOTE_OUTCOME_NO:
+            return button != VOTE_NO;
+        case VOTE_OUTCOME_ABSTAIN:
+            return button != VOTE_ABSTAIN;
+        }
+        return true;
+    }
+};
+
 #include "proposalspage.moc"
 
 ProposalsPage::ProposalsPage(const PlatformStyle* platformStyle, QWidget* parent) :
@@ -46,174 +133,64 @@ ProposalsPage::ProposalsPage(const PlatformStyle* platformStyle, QWidget* parent
 {
     ui->setupUi(this);
 
+    proposalModel = new ProposalTableModel(this);
+    proposalsProxy = new ProposalFilterProxyModel(ProposalRecord::PROPOSAL, this);
+    votingRecordsProxy = new ProposalFilterProxyModel(ProposalRecord::VOTING_RECORD, this);
+    approvedRecordsProxy = new ProposalFilterProxyModel(ProposalRecord::APPROVED_RECORD, this);
+
+    setupView(ui->treeViewProposals, proposalsProxy, true);
+    setupView(ui->treeViewVotingRecords, votingRecordsProxy, true);
+    setupView(ui->treeViewApprovedRecords, approvedRecordsProxy, false);
+
+    connect(proposalModel, SIGNAL(updated()), this, SLOT(updateSyncStatus()));
+    updateSyncStatus();
+}
+
+void ProposalsPage::setupView(QTreeView* view, ProposalFilterProxyModel* proxy, bool fVoting)
+{
     int columnNameWidth = 225;
     int columnDateWidth = 150;
     int columnIPFSCIDWidth = 300;
     int columnVoteRatioWidth = 200;
     int columnVoteWidth = 100;
 
-    ui->treeWidgetProposals->setColumnWidth(0, columnDateWidth);
-    ui->treeWidgetProposals->setColumnWidth(1, columnNameWidth);
-    ui->treeWidgetProposals->setColumnWidth(2, columnVoteRatioWidth);
-    ui->treeWidgetProposals->setColumnWidth(3, columnIPFSCIDWidth);
-    ui->treeWidgetProposals->setColumnWidth(4, columnVoteWidth);
-    ui->treeWidgetProposals->header()->setStretchLastSection(false);
-    ui->treeWidgetProposals->header()->setSectionResizeMode(0,QHeaderView::Stretch); 
-    ui->treeWidgetProposals->header()->setSectionResizeMode(1,QHeaderView::Stretch); 
-    ui->treeWidgetProposals->header()->setSectionResizeMode(2,QHeaderView::Stretch);
-    ui->treeWidgetProposals->header()->setSectionResizeMode(3,QHeaderView::ResizeToContents); 
-
-    ui->treeWidgetVotingRecords->setColumnWidth(0, columnDateWidth);
-    ui->treeWidgetVotingRecords->setColumnWidth(1, columnNameWidth);
-    ui->treeWidgetVotingRecords->setColumnWidth(2, columnVoteRatioWidth);
-    ui->treeWidgetVotingRecords->setColumnWidth(3, columnIPFSCIDWidth);
-    ui->treeWidgetVotingRecords->setColumnWidth(4, columnVoteWidth);
-    ui->treeWidgetVotingRecords->header()->setStretchLastSection(false);
-    ui->treeWidgetVotingRecords->header()->setSectionResizeMode(0, QHeaderView::Stretch); 
-    ui->treeWidgetVotingRecords->header()->setSectionResizeMode(1, QHeaderView::Stretch); 
-    ui->treeWidgetVotingRecords->header()->setSectionResizeMode(2, QHeaderView::Stretch); 
-    ui->treeWidgetVotingRecords->header()->setSectionResizeMode(3, QHeaderView::ResizeToContents); 
-
-    ui->treeWidgetApprovedRecords->setColumnWidth(0, columnDateWidth);
-    ui->treeWidgetApprovedRecords->setColumnWidth(1, columnNameWidth);
-    ui->treeWidgetApprovedRecords->setColumnWidth(2, columnVoteRatioWidth);
-    ui->treeWidgetApprovedRecords->setColumnWidth(3, columnIPFSCIDWidth);
-    ui->treeWidgetApprovedRecords->header()->setStretchLastSection(false);
-    ui->treeWidgetApprovedRecords->header()->setSectionResizeMode(0, QHeaderView::Stretch); 
-    ui->treeWidgetApprovedRecords->header()->setSectionResizeMode(1, QHeaderView::Stretch); 
-    ui->treeWidgetApprovedRecords->header()->setSectionResizeMode(2, QHeaderView::Stretch); 
-    ui->treeWidgetApprovedRecords->header()->setSectionResizeMode(3, QHeaderView::Stretch); 
-    
-    ui->treeWidgetProposals->setColumnCount(5);
-    ui->treeWidgetVotingRecords->setColumnCount(5);
-    ui->treeWidgetApprovedRecords->setColumnCount(4);
-    
-    QString rowTip = "Double click to open in your browser.";
-    ui->treeWidgetProposals->setToolTip(rowTip);
-    ui->treeWidgetVotingRecords->setToolTip(rowTip);
-    ui->treeWidgetApprovedRecords->setToolTip(rowTip);
-
-    ui->treeWidgetProposals->setStyleSheet("QTreeView::item { color: #000000; background-color: #ffffff; padding: 5px; height: 18px; line-height: 18px; min-height: 0px; max-height 18px; } QTreeWidget::item:has-children {color: #000000; background-color: #ffffff; padding: 0px; height: 16px; line-height: 16px; min-height: 0px; max-height 16px; }");
-    ui->treeWidgetVotingRecords->setStyleSheet("QTreeView::item { color: #000000; background-color: #ffffff;padding: 5px;  height: 18px; line-height: 18x; min-height: 0px; max-height 18px; } QTreeWidget::item:has-children {color: #000000; background-color: #ffffff;  padding: 0px; height: 16px; line-height: 16px; min-height: 0px; max-height 16px; } ");
-    ui->treeWidgetApprovedRecords->setStyleSheet("QTreeView::item { color: #000000; background-color: #ffffff; padding: 5px;  height: 18px; line-height: 18px; min-height: 0px;max-height 18px;  } QTreeWidget::item:has-children {color: #000000; background-color: #ffffff; padding: 0px; height: 16px; line-height: 16px; min-height: 0px; max-height 16px; }");
-    
+    proxy->setSourceModel(proposalModel);
+    view->setModel(proxy);
+    view->sortByColumn(ProposalTableModel::Date, Qt::AscendingOrder);
+
+    view->setColumnWidth(ProposalTableModel::Date, columnDateWidth);
+    view->setColumnWidth(ProposalTableModel::Name, columnNameWidth);
+    view->setColumnWidth(ProposalTableModel::Votes, columnVoteRatioWidth);
+    view->setColumnWidth(ProposalTableModel::IPFSCID, columnIPFSCIDWidth);
+    view->setColumnWidth(ProposalTableModel::Vote, columnVoteWidth);
+    view->header()->setStretchLastSection(false);
+    view->header()->setSectionResizeMode(ProposalTableModel::Date, QHeaderView::Stretch);
+    view->header()->setSectionResizeMode(ProposalTableModel::Name, QHeaderView::Stretch);
+    view->header()->setSectionResizeMode(ProposalTableModel::Votes, QHeaderView::Stretch);
+    view->header()->setSectionResizeMode(ProposalTableModel::IPFSCID, fVoting ? QHeaderView::ResizeToContents : QHeaderView::Stretch);
+    view->setColumnHidden(ProposalTableModel::Vote, !fVoting);
+    view->setUniformRowHeights(true);
+
+    view->setToolTip(tr("Double click to open in your browser."));
+    view->setStyleSheet("QTreeView::item { color: #000000; background-color: #ffffff; padding: 5px; height: 18px; line-height: 18px; min-height: 0px; max-height 18px; } QTreeView::item:has-children {color: #000000; background-color: #ffffff; padding: 0px; height: 16px; line-height: 16px; min-height: 0px; max-height 16px; }");
+
+    if (fVoting) {
+        VoteButtonsDelegate* delegate = new VoteButtonsDelegate(view);
+        view->setItemDelegateForColumn(ProposalTableModel::Vote, delegate);
+        connect(delegate, SIGNAL(voteClicked(VoteButton,QModelIndex)), this, SLOT(handleVoteButtonClicked(VoteButton,QModelIndex)));
+    }
 
-    QString theme = GUIUtil::getThemeName();
-    int govObjCount = 0;
-
-    std::vector<const CGovernanceObject*> objs = governance.GetAllNewerThan(0);
-    for (const auto& pGovObj : objs) {
-        if (pGovObj->GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL) {
-            govObjCount++;
-    	    QTreeWidgetItem* row1 = new QTreeWidgetItem(ui->treeWidgetProposals);
- 
-            time_t creationTime = pGovObj->GetCreationTime();
-            QString plainDataJson = QString::fromStdString(pGovObj->GetDataAsPlainString());
-            QJsonDocument jsonPlain = QJsonDocument::fromJson(plainDataJson.toUtf8());
-            QJsonObject jsonObj = jsonPlain.object();
-            QJsonValue jsonSubObj = jsonObj.value(QString("summary"));
-            QJsonObject item = jsonSubObj.toObject();
-            QJsonValue summaryName = item["name"];
-            QJsonValue summaryDesc = item["description"];
-            QJsonValue ipfscid = jsonObj["ipfscid"];
-
-            QString voteRatio = QString::number(pGovObj->GetYesCount(VOTE_SIGNAL_FUNDING)) + " / " + QString::number(pGovObj->GetNoCount(VOTE_SIGNAL_FUNDING)) + " / " + QString::number(pGovObj->GetAbstainCount(VOTE_SIGNAL_FUNDING));
-            std::string govobjHash = pGovObj->GetHash().ToString();
-	    
-            QWidget* votingButtons = new QWidget();
-            QHBoxLayout* hLayout = new QHBoxLayout();
-            votingButtons->setFixedHeight(16);
-            hLayout->setSpacing(0);
-            hLayout->setContentsMargins(0, 0, 0, 0);
-
-            QPushButton* YesButton = new QPushButton;
-            QPushButton* NoButton = new QPushButton;
-            QPushButton* AbstainButton = new QPushButton;
-            
-            YesButton->setIcon(QIcon(":/icons/" + theme + "/vote-yes"));
-            QString YesTip = "Send Yes Vote";
-            YesButton->setToolTip(YesTip);
-            YesButton->setStyleSheet("QPushButton { color: #000000; background-color: #ffffff; }");
-            YesButton->setIconSize(QSize(16, 16));
-
-	    NoButton->setIcon(QIcon(":/icons/" + theme + "/vote-no"));
-            QString NoTip = "Send No Vote";
-            NoButton->setToolTip(NoTip);
-            NoButton->setStyleSheet("QPushButton { color: #000000; background-color: #ffffff; }");
-            NoButton->setIconSize(QSize(16, 16));
-
-	    AbstainButton->setIcon(QIcon(":/icons/" + theme + "/vote-null"));
-            QString AbstainTip = "Send Abstain Vote";
-            AbstainButton->setToolTip(AbstainTip);
-            AbstainButton->setStyleSheet("QPushButton { color: #000000; background-color: #ffffff;}");
-            AbstainButton->setIconSize(QSize(16, 16));
-            // Use C++11 lambda expressions to pass parameters in
-	        // sendVote method.
-	    connect(YesButton, &QPushButton::clicked, this, [=]() { sendVote("yes", govobjHash, YesButton); });
-	    connect(NoButton, &QPushButton::clicked, this, [=]() { sendVote("no", govobjHash, NoButton); });
-	    connect(AbstainButton, &QPushButton::clicked, this, [=]() { sendVote("abstain", govobjHash, AbstainButton); });
-
-            if (masternodeSync.IsSynced()) {
-                YesButton->setDisabled(false);
-                NoButton->setDisabled(false);
-                AbstainButton->setDisabled(false);
-            } else {
-                YesButton->setDisabled(true);
-                NoButton->setDisabled(true);
-                AbstainButton->setDisabled(true);
-            }
-            vote_outcome_enum_t voteOutcome;
-            voteOutcome = findPreviousVote(govobjHash);
-         
-            switch (voteOutcome) {
-            case vote_outcome_enum_t::VOTE_OUTCOME_YES:
-                YesButton->setDisabled(true);
-                break;
-            case vote_outcome_enum_t::VOTE_OUTCOME_NO:
-                NoButton->setDisabled(true);
-                break;
-            case vote_outcome_enum_t::VOTE_OUTCOME_ABSTAIN:
-                AbstainButton->setDisabled(true);
-                break;
-            default:
-                break;
-	    }
-
-            hLayout->addWidget(YesButton);
-            hLayout->addWidget(NoButton);
-            hLayout->addWidget(AbstainButton);
-            votingButtons->setLayout(hLayout);
-
-            row1->setText(0, (QDateTime::fromTime_t(creationTime).toString("MMMM dd, yyyy"))); //Column 1 - creationTime
-            row1->setText(1, summaryName.toString());                                          //Column 2 - summaryName
-            row1->setText(2, voteRatio);                                                       //Column 3 - voteRatio
-            row1->setText(3, ipfscid.toString());                                              //Column 4 - ipfscid
-            ui->treeWidgetProposals->setItemWidget(row1, 4, votingButtons);
-
-            //Summary child row for Row1
-            QTreeWidgetItem* row1_child = new QTreeWidgetItem(row1);
-            row1_child->setText(0, summaryDesc.toString());
-            row1_child->setFirstColumnSpanned(true);
+    // descriptions span the whole row, the view remembers this per row even when rows are sorted
+    connect(proxy, &QAbstractItemModel::rowsInserted, view, [view, proxy](const QModelIndex& parent, int first, int last) {
+        if (parent.isValid()) {
+            return;
         }
-    }
-    if (govObjCount == 0) {
-        QTreeWidgetItem* row1 = new QTreeWidgetItem(ui->treeWidgetProposals);
-        if (masternodeSync.IsSynced()) {
-            row1->setText(0, QString("No proposals found."));
-        } else {
-            row1->setText(0, QString("Please wait until sync is complete."));
+        for (int i = first; i <= last; i++) {
+            view->setFirstColumnSpanned(0, proxy->index(i, 0), true);
         }
-        row1->setFirstColumnSpanned(true);
-    }
-
-    connect(ui->treeWidgetProposals, SIGNAL(doubleClicked(QModelIndex)), this, 
-        SLOT(handleProposalClicked(QModelIndex)));
-    connect(ui->treeWidgetVotingRecords, SIGNAL(doubleClicked(QModelIndex)), this,
-        SLOT(handleProposalClicked(QModelIndex)));
-    connect(ui->treeWidgetApprovedRecords, SIGNAL(doubleClicked(QModelIndex)), this,
-        SLOT(handleProposalClicked(QModelIndex)));
-    connect(ui->tabWidget, SIGNAL(currentChanged(int)), this, SLOT(tabSelected(int)));
+    });
 
+    connect(view, SIGNAL(doubleClicked(QModelIndex)), this, SLOT(handleProposalClicked(QModelIndex)));
 }
 
 ProposalsPage::~ProposalsPage()
@@ -225,19 +202,40 @@ ProposalsPage::~ProposalsPage()
 void ProposalsPage::setClientModel(ClientModel *model)
 {
     this->clientModel = model;
-
+    if (model) {
+        connect(model, SIGNAL(governanceObjectChanged(QString)), proposalModel, SLOT(refresh(QString)));
+        connect(model, SIGNAL(numBlocksChanged(int,QDateTime,double,bool)), this, SLOT(numBlocksChanged(int,QDateTime,double,bool)));
+        connect(model, SIGNAL(additionalDataSyncProgressChanged(double)), this, SLOT(updateSyncStatus()));
+    }
 }
 
-QStringList ProposalsPage::listProposals() {
-    QStringList List;
-    std::vector<const CGovernanceObject*> objs = governance.GetAllNewerThan(0);
+void ProposalsPage::numBlocksChanged(int count, const QDateTime& blockDate, double nVerificationProgress, bool header)
+{
+    // new blocks update flags of objects without notifying about them, e.g. when a record is past its superblock
+    if (!header && masternodeSync.IsBlockchainSynced()) {
+        proposalModel->refreshAll();
+    }
+}
 
-    for (const auto& pGovObj : objs) {
-        QString proposalHash = QString::fromStdString(pGovObj->GetDataAsPlainString());
-	    List << proposalHash;
+void ProposalsPage::updateEmptyLabel(QLabel* label, ProposalFilterProxyModel* proxy, const QString& strEmpty)
+{
+    if (proxy->rowCount() != 0) {
+        label->hide();
+        return;
     }
+    label->setText(masternodeSync.IsSynced() && proposalModel->isLoaded() ? strEmpty : tr("Please wait until sync is complete."));
+    label->show();
+}
+
+void ProposalsPage::updateSyncStatus()
+{
+    updateEmptyLabel(ui->labelProposalsEmpty, proposalsProxy, tr("No proposals found."));
+    updateEmptyLabel(ui->labelVotingRecordsEmpty, votingRecordsProxy, tr("No records found."));
+    updateEmptyLabel(ui->labelApprovedRecordsEmpty, approvedRecordsProxy, tr("No records found."));
 
-    return List;
+    // vote buttons are only enabled when synced
+    ui->treeViewProposals->viewport()->update();
+    ui->treeViewVotingRecords->viewport()->update();
 }
 
 void ProposalsPage::handleProposalClicked(const QModelIndex& index)
@@ -246,320 +244,32 @@ void ProposalsPage::handleProposalClicked(const QModelIndex& index)
         return;
     }
 
+    QString ipfscid = index.data(ProposalTableModel::IPFSCIDRole).toString();
+    if (ipfscid.isEmpty()) {
+        return;
+    }
+
     std::string addr = clientModel->getRandomValidMN();
-    std::string urltemp;
-
-    if (ui->tabWidget->currentIndex() == 0) {
-        QTreeWidgetItem* item = ui->treeWidgetProposals->currentItem();
-        QString ipfscid;
-        if (!item->text(3).isNull()) {
-            ipfscid = item->text(3);
-        } else {
-            ipfscid = item->parent()->text(3);
-        }
-        urltemp = "http://" + addr + "/ipfs/" + ipfscid.toUtf8().constData() + "/index.html";
-    } else if (ui->tabWidget->currentIndex() == 1) {
-        QTreeWidgetItem* item = ui->treeWidgetVotingRecords->currentItem();
-        QString ipfscid;
-        if (!item->text(3).isNull()) {
-            ipfscid = item->text(3);
-        } else {
-            ipfscid = item->parent()->text(3);
-        }
-        urltemp = "http://" + addr + "/ipfs/" + ipfscid.toUtf8().constData() + "/index.html";
-    } else if (ui->tabWidget->currentIndex() == 2) {
-        QTreeWidgetItem* item = ui->treeWidgetApprovedRecords->currentItem();
-        QString ipfscid;
-        if (!item->text(3).isNull()) {
-            ipfscid = item->text(3);
-        } else {
-            ipfscid = item->parent()->text(3);
-        }
-        urltemp = "http://" + addr + "/ipfs/" + ipfscid.toUtf8().constData() + "/index.html";
-    } 
-    
+    std::string urltemp = "http://" + addr + "/ipfs/" + ipfscid.toUtf8().constData() + "/index.html";
+
     QString url = QString::fromUtf8(urltemp.c_str());
     LogPrintf("ProposalsPage::handleProposalClicked %s\n", urltemp);
     QDesktopServices::openUrl(QUrl(url, QUrl::TolerantMode));
 
 }
 
-void ProposalsPage::tabSelected(int tabIndex)
-{
-    ui->treeWidgetProposals->clear();
-    ui->treeWidgetVotingRecords->clear();
-    ui->treeWidgetApprovedRecords->clear();
-    QString theme = GUIUtil::getThemeName();
-    if (tabIndex == 0) {
-        ui->treeWidgetProposals->setColumnCount(5);
-
-        std::vector<const CGovernanceObject*> objs = governance.GetAllNewerThan(0);
-
-        int govObjCount = 0;
-        for (const auto& pGovObj : objs) {
-            if (pGovObj->GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL) {
-                govObjCount++;
-                QTreeWidgetItem* row1 = new QTreeWidgetItem(ui->treeWidgetProposals);
-                time_t creationTime = pGovObj->GetCreationTime();
-                QString plainDataJson = QString::fromStdString(pGovObj->GetDataAsPlainString());
-                QJsonDocument jsonPlain = QJsonDocument::fromJson(plainDataJson.toUtf8());
-                QJsonObject jsonObj = jsonPlain.object();
-                QJsonValue jsonSubObj = jsonObj.value(QString("summary"));
-                QJsonObject item = jsonSubObj.toObject();
-                QJsonValue summaryName = item["name"];
-                QJsonValue summaryDesc = item["description"];
-                QJsonValue ipfscid = jsonObj["ipfscid"];
-
-                QString voteRatio = QString::number(pGovObj->GetYesCount(VOTE_SIGNAL_FUNDING)) + " / " + QString::number(pGovObj->GetNoCount(VOTE_SIGNAL_FUNDING)) + " / " + QString::number(pGovObj->GetAbstainCount(VOTE_SIGNAL_FUNDING));
-		        std::string govobjHash = pGovObj->GetHash().ToString();
-		
-                QWidget* votingButtons = new QWidget();
-                QHBoxLayout* hLayout = new QHBoxLayout();
-                votingButtons->setFixedHeight(16);
-                hLayout->setSpacing(0);
-                hLayout->setContentsMargins(0, 0, 0, 0);
-
-                QPushButton* YesButton = new QPushButton;
-                QPushButton* NoButton = new QPushButton;
-                QPushButton* AbstainButton = new QPushButton;
-            
-                YesButton->setIcon(QIcon(":/icons/" + theme + "/vote-yes"));
-                QString YesTip = "Send Yes Vote";
-                YesButton->setToolTip(YesTip);
-                YesButton->setStyleSheet("QPushButton { color: #000000; background-color: #ffffff; }");
-                YesButton->setIconSize(QSize(16, 16));
-
-                NoButton->setIcon(QIcon(":/icons/" + theme + "/vote-no"));
-                QString NoTip = "Send No Vote";
-                NoButton->setToolTip(NoTip);
-                NoButton->setStyleSheet("QPushButton { color: #000000; background-color: #ffffff; }");
-                NoButton->setIconSize(QSize(16, 16));
-
-                AbstainButton->setIcon(QIcon(":/icons/" + theme + "/vote-null"));
-                QString AbstainTip = "Send Abstain Vote";
-                AbstainButton->setToolTip(AbstainTip);
-                AbstainButton->setStyleSheet("QPushButton { color: #000000; background-color: #ffffff;}");
-                AbstainButton->setIconSize(QSize(16, 16));
-
-                connect(YesButton, &QPushButton::clicked, this, [=]() { sendVote("yes", govobjHash, YesButton); });
-                connect(NoButton, &QPushButton::clicked, this, [=]() { sendVote("no", govobjHash, NoButton); });
-                connect(AbstainButton, &QPushButton::clicked, this, [=](){ sendVote("abstain", govobjHash, AbstainButton); });
-                
-                if (masternodeSync.IsSynced()) {
-                    YesButton->setDisabled(false);
-                    NoButton->setDisabled(false);
-                    AbstainButton->setDisabled(false);
-                } else {
-                    YesButton->setDisabled(true);
-                    NoButton->setDisabled(true);
-                    AbstainButton->setDisabled(true);
-                }
-                        
-		vote_outcome_enum_t voteOutcome = findPreviousVote(govobjHash);
-		switch(voteOutcome) {
-		    case vote_outcome_enum_t::VOTE_OUTCOME_YES: YesButton->setDisabled(true); break;
-		    case vote_outcome_enum_t::VOTE_OUTCOME_NO: NoButton->setDisabled(true); break;
-		    case vote_outcome_enum_t::VOTE_OUTCOME_ABSTAIN: AbstainButton->setDisabled(true); break;
-		    default: break;
-		}
-		    
-                hLayout->addWidget(YesButton);
-                hLayout->addWidget(NoButton);
-                hLayout->addWidget(AbstainButton);
-                votingButtons->setLayout(hLayout);
-
-                row1->setText(0, (QDateTime::fromTime_t(creationTime).toString("MMMM dd, yyyy"))); //Column 1 - creationTime
-                row1->setText(1, summaryName.toString());                                          //Column 2 - summaryName
-                row1->setText(2, voteRatio);                                                       //Column 3 - voteRatio
-                row1->setText(3, ipfscid.toString());                                              //Column 4 - ipfscid
-                ui->treeWidgetProposals->setItemWidget(row1, 4, votingButtons);
-
-                //Summary child row for Row1
-                QTreeWidgetItem* row1_child = new QTreeWidgetItem(row1);
-                row1_child->setText(0, summaryDesc.toString());
-                row1_child->setFirstColumnSpanned(true);
-            }
-        }
-        if (govObjCount == 0) {
-            QTreeWidgetItem* row1 = new QTreeWidgetItem(ui->treeWidgetProposals);
-            if (masternodeSync.IsSynced()) {
-                row1->setText(0, QString("No proposals found."));
-            } else {
-                row1->setText(0, QString("Please wait until sync is complete."));
-            }
-            row1->setFirstColumnSpanned(true);
-        }
-        disconnect(ui->treeWidgetProposals, SIGNAL(doubleClicked(QModelIndex)), this,
-            SLOT(handleProposalClicked(QModelIndex)));
-        connect(ui->treeWidgetProposals, SIGNAL(doubleClicked(QModelIndex)), this,
-            SLOT(handleProposalClicked(QModelIndex)));
-         
-    } else if (tabIndex == 1) {
-        ui->treeWidgetVotingRecords->setColumnCount(5);
-        int govObjCount = 0;
-        std::vector<const CGovernanceObject*> objs = governance.GetAllNewerThan(0);
-
-        for (const auto& pGovObj : objs) {
-            if (pGovObj->GetObjectType() == GOVERNANCE_OBJECT_RECORD && !pGovObj->IsSetRecordPastSuperBlock()) {
-                govObjCount++;
-                QTreeWidgetItem* row1 = new QTreeWidgetItem(ui->treeWidgetVotingRecords);
-                time_t creationTime = pGovObj->GetCreationTime();
-                QString plainDataJson = QString::fromStdString(pGovObj->GetDataAsPlainString());
-                QJsonDocument jsonPlain = QJsonDocument::fromJson(plainDataJson.toUtf8());
-                QJsonObject jsonObj = jsonPlain.object();
-                QJsonValue jsonSubObj = jsonObj.value(QString("summary"));
-                QJsonObject item = jsonSubObj.toObject();
-                QJsonValue summaryName = item["name"];
-                QJsonValue summaryDesc = item["description"];
-                QJsonValue ipfscid = jsonObj["ipfscid"];
-
-                QString voteRatio = QString::number(pGovObj->GetYesCount(VOTE_SIGNAL_FUNDING)) + " / " + QString::number(pGovObj->GetNoCount(VOTE_SIGNAL_FUNDING)) + " / " + QString::number(pGovObj->GetAbstainCount(VOTE_SIGNAL_FUNDING));
-		std::string govobjHash = pGovObj->GetHash().ToString();
-		
-                QWidget* votingButtons = new QWidget();
-                QHBoxLayout* hLayout = new QHBoxLayout();
-                votingButtons->setFixedHeight(16);
-                hLayout->setSpacing(0);
-                hLayout->setContentsMargins(0, 0, 0, 0);
-
-                QPushButton* YesButton = new QPushButton;
-                QPushButton* NoButton = new QPushButton;
-                QPushButton* AbstainButton = new QPushButton;
-            
-                YesButton->setIcon(QIcon(":/icons/" + theme + "/vote-yes"));
-                QString YesTip = "Send Yes Vote";
-                YesButton->setToolTip(YesTip);
-                YesButton->setStyleSheet("QPushButton { color: #000000; background-color: #ffffff; }");
-                YesButton->setIconSize(QSize(16, 16));
-
-                NoButton->setIcon(QIcon(":/icons/" + theme + "/vote-no"));
-                QString NoTip = "Send No Vote";
-                NoButton->setToolTip(NoTip);
-                NoButton->setStyleSheet("QPushButton { color: #000000; background-color: #ffffff; }");
-                NoButton->setIconSize(QSize(16, 16));
-
-                AbstainButton->setIcon(QIcon(":/icons/" + theme + "/vote-null"));
-                QString AbstainTip = "Send Abstain Vote";
-                AbstainButton->setToolTip(AbstainTip);
-                AbstainButton->setStyleSheet("QPushButton { color: #000000; background-color: #ffffff;}");
-                AbstainButton->setIconSize(QSize(16, 16));
-
-                connect(YesButton, &QPushButton::clicked, this, [=]() { sendVote("yes", govobjHash, YesButton); });
-	        connect(NoButton, &QPushButton::clicked, this, [=]() { sendVote("no", govobjHash, NoButton); });
-	        connect(AbstainButton, &QPushButton::clicked, this, [=]() { sendVote("abstain", govobjHash, AbstainButton);	});
-                        
-                if (masternodeSync.IsSynced()) {
-                    YesButton->setDisabled(false);
-                    NoButton->setDisabled(false);
-                    AbstainButton->setDisabled(false);
-                } else {
-                    YesButton->setDisabled(true);
-                    NoButton->setDisabled(true);
-                    AbstainButton->setDisabled(true);
-                }
-                        
-		vote_outcome_enum_t voteOutcome = findPreviousVote(govobjHash);
-		switch(voteOutcome) {
-		    case vote_outcome_enum_t::VOTE_OUTCOME_YES: YesButton->setDisabled(true); break;
-		    case vote_outcome_enum_t::VOTE_OUTCOME_NO: NoButton->setDisabled(true); break;
-		    case vote_outcome_enum_t::VOTE_OUTCOME_ABSTAIN: AbstainButton->setDisabled(true); break;
-		    default: break;
-		}
-		    
-                hLayout->addWidget(YesButton);
-                hLayout->addWidget(NoButton);
-                hLayout->addWidget(AbstainButton);
-                votingButtons->setLayout(hLayout);
-
-                row1->setText(0, (QDateTime::fromTime_t(creationTime).toString("MMMM dd, yyyy"))); //Column 1 - creationTime
-                row1->setText(1, summaryName.toString());                                          //Column 2 - summaryName
-                row1->setText(2, voteRatio);                                                       //Column 3 - voteRatio
-                row1->setText(3, ipfscid.toString());                                              //Column 4 - ipfscid
-                ui->treeWidgetVotingRecords->setItemWidget(row1, 4, votingButtons);
-
-                //Summary child row for Row1
-                QTreeWidgetItem* row1_child = new QTreeWidgetItem(row1);
-                row1_child->setText(0, summaryDesc.toString());
-                row1_child->setFirstColumnSpanned(true);
-            }
-        }
-        if (govObjCount == 0) {
-            QTreeWidgetItem* row1 = new QTreeWidgetItem(ui->treeWidgetVotingRecords);
-            if (masternodeSync.IsSynced()) {
-                row1->setText(0, QString("No records found."));
-            } else {
-                row1->setText(0, QString("Please wait until sync is complete."));
-            }
-            row1->setFirstColumnSpanned(true);
-        }
-        disconnect(ui->treeWidgetVotingRecords, SIGNAL(doubelClicked(QModelIndex)), this,
-            SLOT(handleProposalClicked(QModelIndex)));
-        connect(ui->treeWidgetVotingRecords, SIGNAL(doubelClicked(QModelIndex)), this,
-            SLOT(handleProposalClicked(QModelIndex)));
-        
-    } else if (tabIndex == 2) {
-        
-        ui->treeWidgetApprovedRecords->setColumnCount(4);
-        int govObjCount = 0;
-        std::vector<const CGovernanceObject*> objs = governance.GetAllNewerThan(0);
-
-        for (const auto& pGovObj : objs) {
-            if (pGovObj->GetObjectType() == GOVERNANCE_OBJECT_RECORD && pGovObj->IsSetPermLocked() && !pGovObj->IsSetCachedFunding() && pGovObj->IsSetRecordPastSuperBlock() ) {
-                govObjCount++;
-                QTreeWidgetItem* row1 = new QTreeWidgetItem(ui->treeWidgetApprovedRecords);
-                time_t creationTime = pGovObj->GetCreationTime();
-
-                QString plainDataJson = QString::fromStdString(pGovObj->GetDataAsPlainString());
-                QJsonDocument jsonPlain = QJsonDocument::fromJson(plainDataJson.toUtf8());
-                QJsonObject jsonObj = jsonPlain.object();
-                QJsonValue jsonSubObj = jsonObj.value(QString("summary"));
-                QJsonObject item = jsonSubObj.toObject();
-                QJsonValue summaryName = item["name"];
-                QJsonValue summaryDesc = item["description"];
-                QJsonValue ipfscid = jsonObj["ipfscid"];
-  
-                QString voteRatio = QString::number(pGovObj->GetYesCount(VOTE_SIGNAL_FUNDING)) + " / " + QString::number(pGovObj->GetNoCount(VOTE_SIGNAL_FUNDING)) + " / " + QString::number(pGovObj->GetAbstainCount(VOTE_SIGNAL_FUNDING));
-		std::string govobjHash = pGovObj->GetHash().ToString();
-		
-                row1->setText(0, (QDateTime::fromTime_t(creationTime).toString("MMMM dd, yyyy"))); //Column 1 - creationTime
-                row1->setText(1, summaryName.toString());                                          //Column 2 - summaryName
-                row1->setText(2, voteRatio);                                                       //Column 3 - voteRatio
-                row1->setText(3, ipfscid.toString());                                              //Column 4 - ipfscid
-
-                //Summary child row for Row1
-                QTreeWidgetItem* row1_child = new QTreeWidgetItem(row1);
-                row1_child->setText(0, summaryDesc.toString());
-                row1_child->setFirstColumnSpanned(true);
-            }
-        }
-        if (govObjCount == 0) {
-            QTreeWidgetItem* row1 = new QTreeWidgetItem(ui->treeWidgetApprovedRecords);
-            if (masternodeSync.IsSynced()) {
-                row1->setText(0, QString("No records found."));
-            } else {
-                row1->setText(0, QString("Please wait until sync is complete."));
-            }
-            row1->setFirstColumnSpanned(true);
-        }
-        disconnect(ui->treeWidgetApprovedRecords, SIGNAL(doubleClicked(QModelIndex)), this,
-            SLOT(handleProposalClicked(QModelIndex)));
-        connect(ui->treeWidgetApprovedRecords, SIGNAL(doubleClicked(QModelIndex)), this,
-            SLOT(handleProposalClicked(QModelIndex)));
-     } 
-}
-
-void ProposalsPage::handleVoteButtonClicked(VoteButton outcome, const std::string &govobjHash, QPushButton *button)
+void ProposalsPage::handleVoteButtonClicked(VoteButton outcome, const QModelIndex& index)
 {
+    std::string govobjHash = index.data(ProposalTableModel::HashRole).toString().toStdString();
     switch (outcome) {
-        case VoteButton::VOTE_YES: sendVote("yes", govobjHash, button); break;
-        case VoteButton::VOTE_NO: sendVote("no", govobjHash, button); break;
-        case VoteButton::VOTE_ABSTAIN: sendVote("abstain", govobjHash, button);
+        case VoteButton::VOTE_YES: sendVote("yes", govobjHash); break;
+        case VoteButton::VOTE_NO: sendVote("no", govobjHash); break;
+        case VoteButton::VOTE_ABSTAIN: sendVote("abstain", govobjHash);
 	    break;
     }
 }
 
-void ProposalsPage::sendVote(std::string outcome, const std::string &govobjHash,
-			     QPushButton *button)
+void ProposalsPage::sendVote(std::string outcome, const std::string &govobjHash)
 {
     QMessageBox *msgBox = new QMessageBox(this);
 
@@ -589,7 +299,7 @@ void ProposalsPage::sendVote(std::string outcome, const std::string &govobjHash,
     try {
 	    RPCConsole::RPCExecuteCommandLine(result, command);
 	    msgBox->setIcon(QMessageBox::Information);
-	    button->setDisabled(true);
+	    proposalModel->refresh(QString::fromStdString(govobjHash));
     } catch (UniValue &e) {
 	    result =  find_value(e, "message").get_str();
 	    LogPrintf("ProposalsPage::sendVote %s\n", result);
@@ -612,49 +322,3 @@ void ProposalsPage::sendVote(std::string outcome, const std::string &govobjHash,
     msgBox->setText(showInfo);
     msgBox->exec();
 }
-
-vote_outcome_enum_t ProposalsPage::findPreviousVote(const std::string &govobjHash)
-{
-    std::string result, collateralIndex, collateralHash;
-    QJsonDocument qJsonDoc;
-    QJsonObject jsonResult;
-    std::string mnoutputs = "masternode outputs";
-    if (!fMasternodeMode) {
-        return vote_outcome_enum_t::VOTE_OUTCOME_NONE;
-    }
-    try {
-	RPCConsole::RPCExecuteCommandLine(result, mnoutputs);
-	qJsonDoc = QJsonDocument::fromJson(QString::fromStdString(result).toUtf8());
-	if (!qJsonDoc.isNull()) {
-	    QJsonObject jsonResult = qJsonDoc.object();
-	    QString qCollateralHash = jsonResult.keys()[0];
-	    collateralIndex = jsonResult[qCollateralHash].toString().toStdString();
-	    collateralHash = qCollateralHash.toStdString();
-	}
-    } catch (UniValue &e) {
-	return vote_outcome_enum_t::VOTE_OUTCOME_NONE;
-    }
-
-    COutPoint mnCollateralOutpoint;
-    uint256 txid, hash;
-    txid.SetHex(collateralHash);
-    hash.SetHex(govobjHash);
-    mnCollateralOutpoint = COutPoint(txid, (uint32_t)atoi(collateralIndex));
-
-    LOCK(governance.cs);
-
-    CGovernanceObject* pGovObj = governance.FindGovernanceObject(hash);
-    if (pGovObj == nullptr) {
-	    return vote_outcome_enum_t::VOTE_OUTCOME_NONE;
-    }
-    std::map<int64_t, vote_outcome_enum_t> nodeVotes;
-    std::vector<CGovernanceVote> vecVotes = governance.GetCurrentVotes(hash, mnCollateralOutpoint);
-    for (const auto& vote : vecVotes) {
-	vote_outcome_enum_t outcome = vote.GetOutcome();
-	int64_t timestamp = vote.GetTimestamp();
-	nodeVotes.insert({timestamp, outcome});
-    }
-
-    vote_outcome_enum_t recentVoteOutcome = nodeVotes.begin()->second;
-    return recentVoteOutcome;
-}
@@ -11,8 +11,6 @@
 
 #include <QWidget>
 #include <QStringListModel>
-#include <QStringListModel>
-#include <QPushButton>
 
 #include <memory>
 #include <map>
@@ -21,6 +19,8 @@ class ClientModel;
 class TransactionFilterProxy;
 class TxViewDelegate;
 class PlatformStyle;
+class ProposalFilterProxyModel;
+class ProposalTableModel;
 class WalletModel;
 
 namespace Ui {
@@ -28,7 +28,10 @@ namespace Ui {
 }
 
 QT_BEGIN_NAMESPACE
+class QDateTime;
+class QLabel;
 class QModelIndex;
+class QTreeView;
 QT_END_NAMESPACE
 
 enum VoteButton {
@@ -50,9 +53,7 @@ public:
     void setWalletModel(WalletModel *walletModel);
 
 public Q_SLOTS:
-    QStringList listProposals();
-    void tabSelected(int tabIndex);
-    void sendVote(std::string, const std::string&, QPushButton*);
+    void sendVote(std::string, const std::string&);
 
 private:
     QTimer *timer;
@@ -73,14 +74,22 @@ private:
     TxViewDelegate *txdelegate;
     std::map<int, std::string> proposalsRow;
 
+    ProposalTableModel *proposalModel;
+    ProposalFilterProxyModel *proposalsProxy;
+    ProposalFilterProxyModel *votingRecordsProxy;
+    ProposalFilterProxyModel *approvedRecordsProxy;
+
     void SetupTransactionList(int nNumItems);
     void DisablePrivateSendCompletely();
     void onProposalClicked();
-    vote_outcome_enum_t findPreviousVote(const std::string&);
     void updateVotingButtons(std::string &);
+    void setupView(QTreeView* view, ProposalFilterProxyModel* proxy, bool fVoting);
+    void updateEmptyLabel(QLabel* label, ProposalFilterProxyModel* proxy, const QString& strEmpty);
 private Q_SLOTS:
     void handleProposalClicked(const QModelIndex& index);
-    void handleVoteButtonClicked(VoteButton, const std::string&, QPushButton *);
+    void handleVoteButtonClicked(VoteButton, const QModelIndex&);
+    void numBlocksChanged(int count, const QDateTime& blockDate, double nVerificationProgress, bool header);
+    void updateSyncStatus();
 };
 
 #endif // BITCOIN_QT_PROPOSALSPAGE_H
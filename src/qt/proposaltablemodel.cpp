@@ -0,0 +1,430 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "proposaltablemodel.h"
+
+#include "rpcconsole.h"
+
+#include "governance.h"
+#include "governance-object.h"
+#include "init.h"
+#include "util.h"
+#include "validation.h"
+
+#include <univalue.h>
+
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+
+// Changes arriving within this many milliseconds are loaded together, votes come in bursts while syncing
+static const int PROPOSAL_LOAD_DELAY = 1000;
+
+bool ProposalRecord::operator==(const ProposalRecord& other) const
+{
+    return hash == other.hash &&
+           nCategories == other.nCategories &&
+           nCreationTime == other.nCreationTime &&
+           strName == other.strName &&
+           strDescription == other.strDescription &&
+           strIPFSCID == other.strIPFSCID &&
+           nYes == other.nYes &&
+           nNo == other.nNo &&
+           nAbstain == other.nAbstain &&
+           ourVote == other.ourVote;
+}
+
+// The collateral of the masternode which votes for this wallet, looked up once per load
+static COutPoint GetVotingCollateral()
+{
+    if (!fMasternodeMode) {
+        return COutPoint();
+    }
+    std::string result;
+    try {
+        RPCConsole::RPCExecuteCommandLine(result, "masternode outputs");
+    } catch (UniValue& e) {
+        return COutPoint();
+    } catch (std::exception& e) {
+        return COutPoint();
+    }
+    QJsonObject outputs = QJsonDocument::fromJson(QString::fromStdString(result).toUtf8()).object();
+    if (outputs.isEmpty()) {
+        return COutPoint();
+    }
+    QString strTxHash = outputs.keys()[0];
+    return COutPoint(uint256S(strTxHash.toStdString()), outputs[strTxHash].toString().toUInt());
+}
+
+static int GetCategories(const CGovernanceObject& govobj)
+{
+    switch (govobj.GetObjectType()) {
+    case GOVERNANCE_OBJECT_PROPOSAL:
+        return ProposalRecord::PROPOSAL;
+    case GOVERNANCE_OBJECT_RECORD:
+        if (!govobj.IsSetRecordPastSuperBlock()) {
+            return ProposalRecord::VOTING_RECORD;
+        }
+        if (govobj.IsSetPermLocked() && !govobj.IsSetCachedFunding()) {
+            return ProposalRecord::APPROVED_RECORD;
+        }
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+static vote_outcome_enum_t GetOurVote(const uint256& hash, const COutPoint& mnCollateralOutpoint)
+{
+    // a null outpoint would return the votes of all masternodes
+    if (mnCollateralOutpoint.IsNull()) {
+        return VOTE_OUTCOME_NONE;
+    }
+    vote_outcome_enum_t outcome = VOTE_OUTCOME_NONE;
+    int64_t nLatest = -1;
+    for (const auto& vote : governance.GetCurrentVotes(hash, mnCollateralOutpoint)) {
+        if (vote.GetSignal() == VOTE_SIGNAL_FUNDING && vote.GetTimestamp() > nLatest) {
+            nLatest = vote.GetTimestamp();
+            outcome = vote.GetOutcome();
+        }
+    }
+    return outcome;
+}
+
+// requires cs_main and governance.cs
+static bool MakeRecord(const CGovernanceObject& govobj, const COutPoint& mnCollateralOutpoint, ProposalRecord& recRet)
+{
+    recRet.nCategories = GetCategories(govobj);
+    if (recRet.nCategories == 0) {
+        return false;
+    }
+    recRet.hash = govobj.GetHash();
+    recRet.nCreationTime = govobj.GetCreationTime();
+    recRet.strDate = QDateTime::fromTime_t(recRet.nCreationTime).toString("MMMM dd, yyyy");
+
+    CGovernanceObjectPayloadPtr pPayload = govobj.GetPayload();
+    recRet.strName = QString::fromStdString(pPayload->strSummaryName);
+    recRet.strDescription = QString::fromStdString(pPayload->strSummaryDescription);
+    recRet.strIPFSCID = QString::fromStdString(pPayload->strIPFSCID);
+
+    recRet.nYes = govobj.GetYesCount(VOTE_SIGNAL_FUNDING);
+    recRet.nNo = govobj.GetNoCount(VOTE_SIGNAL_FUNDING);
+    recRet.nAbstain = govobj.GetAbstainCount(VOTE_SIGNAL_FUNDING);
+    recRet.ourVote = GetOurVote(recRet.hash, mnCollateralOutpoint);
+    return true;
+}
+
+void ProposalLoader::load(bool fAll, const QStringList& hashes)
+{
+    if (ShutdownRequested()) {
+        return;
+    }
+
+    COutPoint mnCollateralOutpoint = GetVotingCollateral();
+
+    ProposalRecordList records;
+    {
+        LOCK2(cs_main, governance.cs);
+        ProposalRecord rec;
+        if (fAll) {
+            for (const CGovernanceObject* pGovObj : governance.GetAllNewerThan(0)) {
+                if (MakeRecord(*pGovObj, mnCollateralOutpoint, rec)) {
+                    records.emplace_back(rec);
+                }
+            }
+        } else {
+            for (const QString& strHash : hashes) {
+                const CGovernanceObject* pGovObj = governance.FindGovernanceObject(uint256S(strHash.toStdString()));
+                if (pGovObj && MakeRecord(*pGovObj, mnCollateralOutpoint, rec)) {
+                    records.emplace_back(rec);
+                }
+            }
+        }
+    }
+
+    Q_EMIT loaded(fAll, hashes, records);
+}
+
+ProposalTableModel::ProposalTableModel(QObject* parent) :
+    QAbstractItemModel(parent),
+    loader(new ProposalLoader),
+    loadTimer(new QTimer(this))
+{
+    columns << tr("Date Added") << tr("Name") << tr("Vote Ratio (Yes/No/Abstain)") << tr("IPFS CID") << tr("Vote");
+
+    qRegisterMetaType<ProposalRecordList>("ProposalRecordList");
+
+    loadTimer->setSingleShot(true);
+    connect(loadTimer, SIGNAL(timeout()), this, SLOT(startLoad()));
+
+    loader->moveToThread(&thread);
+    connect(this, SIGNAL(requestLoad(bool,QStringList)), loader, SLOT(load(bool,QStringList)));
+    connect(loader, SIGNAL(loaded(bool,QStringList,ProposalRecordList)), this, SLOT(applyRecords(bool,QStringList,ProposalRecordList)));
+    connect(&thread, SIGNAL(finished()), loader, SLOT(deleteLater()), Qt::DirectConnection);
+    thread.start();
+
+    fPendingAll = true;
+    startLoad();
+}
+
+ProposalTableModel::~ProposalTableModel()
+{
+    thread.quit();
+    thread.wait();
+}
+
+void ProposalTableModel::refresh(const QString& hash)
+{
+    setPendingHashes.insert(hash);
+    scheduleLoad();
+}
+
+void ProposalTableModel::refreshAll()
+{
+    fPendingAll = true;
+    scheduleLoad();
+}
+
+void ProposalTableModel::scheduleLoad()
+{
+    // a running load schedules the next one when it's done
+    if (!fLoading && !loadTimer->isActive()) {
+        loadTimer->start(PROPOSAL_LOAD_DELAY);
+    }
+}
+
+void ProposalTableModel::startLoad()
+{
+    if (fLoading || (!fPendingAll && setPendingHashes.isEmpty())) {
+        return;
+    }
+    fLoading = true;
+    bool fAll = fPendingAll;
+    QStringList hashes = fAll ? QStringList() : setPendingHashes.toList();
+    fPendingAll = false;
+    setPendingHashes.clear();
+    Q_EMIT requestLoad(fAll, hashes);
+}
+
+void ProposalTableModel::applyRecords(bool fAll, const QStringList& hashes, const ProposalRecordList& records)
+{
+    fLoading = false;
+
+    std::map<uint256, const ProposalRecord*> mapLoaded;
+    for (const auto& rec : records) {
+        mapLoaded.emplace(rec.hash, &rec);
+    }
+
+    // objects which were deleted or are not shown on any tab anymore
+    std::vector<int> vecRemovedRows;
+    if (fAll) {
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (!mapLoaded.count(entries[i].rec.hash)) {
+                vecRemovedRows.emplace_back(i);
+            }
+        }
+    } else {
+        for (const QString& strHash : hashes) {
+            uint256 hash = uint256S(strHash.toStdString());
+            auto it = mapRows.find(hash);
+            if (it != mapRows.end() && !mapLoaded.count(hash)) {
+                vecRemovedRows.emplace_back(it->second);
+            }
+        }
+    }
+    // from the last row to the first one so that the remaining row numbers stay valid
+    std::sort(vecRemovedRows.rbegin(), vecRemovedRows.rend());
+    for (int nRow : vecRemovedRows) {
+        beginRemoveRows(QModelIndex(), nRow, nRow);
+        entries.erase(entries.begin() + nRow);
+        endRemoveRows();
+    }
+    if (!vecRemovedRows.empty()) {
+        rebuildRowMaps();
+    }
+
+    std::vector<const ProposalRecord*> vecAdded;
+    for (const auto& rec : records) {
+        auto it = mapRows.find(rec.hash);
+        if (it == mapRows.end()) {
+            vecAdded.emplace_back(&rec);
+            continue;
+        }
+        Entry& entry = entries[it->second];
+        if (entry.rec != rec) {
+            // the description is part of the object data and can't change
+            entry.rec = rec;
+            Q_EMIT dataChanged(index(it->second, 0), index(it->second, columns.size() - 1));
+        }
+    }
+
+    if (!vecAdded.empty()) {
+        int nFirst = entries.size();
+        beginInsertRows(QModelIndex(), nFirst, nFirst + vecAdded.size() - 1);
+        for (const ProposalRecord* pRec : vecAdded) {
+            mapRows[pRec->hash] = entries.size();
+            mapIdRows[nNextId] = entries.size();
+            entries.emplace_back(*pRec, nNextId++);
+        }
+        endInsertRows();
+    }
+
+    fLoaded = true;
+    Q_EMIT updated();
+
+    if (fPendingAll || !setPendingHashes.isEmpty()) {
+        scheduleLoad();
+    }
+}
+
+void ProposalTableModel::rebuildRowMaps()
+{
+    mapRows.clear();
+    mapIdRows.clear();
+    for (size_t i = 0; i < entries.size(); i++) {
+        mapRows.emplace(entries[i].rec.hash, (int)i);
+        mapIdRows.emplace(entries[i].nId, (int)i);
+    }
+}
+
+QModelIndex ProposalTableModel::index(int row, int column, const QModelIndex& parent) const
+{
+    if (!parent.isValid()) {
+        if (row < 0 || row >= (int)entries.size() || column < 0 || column >= columns.size()) {
+            return QModelIndex();
+        }
+        return createIndex(row, column, (quintptr)0);
+    }
+    // the description is the only child of an object row
+    if (parent.internalId() != 0 || parent.row() >= (int)entries.size() || row != 0 || column != 0) {
+        return QModelIndex();
+    }
+    return createIndex(0, 0, entries[parent.row()].nId);
+}
+
+QModelIndex ProposalTableModel::parent(const QModelIndex& child) const
+{
+    if (!child.isValid() || child.internalId() == 0) {
+        return QModelIndex();
+    }
+    auto it = mapIdRows.find(child.internalId());
+    if (it == mapIdRows.end()) {
+        return QModelIndex();
+    }
+    return createIndex(it->second, 0, (quintptr)0);
+}
+
+int ProposalTableModel::rowCount(const QModelIndex& parent) const
+{
+    if (!parent.isValid()) {
+        return entries.size();
+    }
+    return (parent.internalId() == 0 && parent.column() == 0) ? 1 : 0;
+}
+
+int ProposalTableModel::columnCount(const QModelIndex& parent) const
+{
+    Q_UNUSED(parent);
+    return columns.length();
+}
+
+QVariant ProposalTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    if (index.internalId() != 0) {
+        auto it = mapIdRows.find(index.internalId());
+        if (it == mapIdRows.end()) {
+            return QVariant();
+        }
+        const ProposalRecord& rec = entries[it->second].rec;
+        switch (role) {
+        case Qt::DisplayRole:
+            return rec.strDescription;
+        case HashRole:
+            return QString::fromStdString(rec.hash.ToString());
+        case IPFSCIDRole:
+            return rec.strIPFSCID;
+        }
+        return QVariant();
+    }
+
+    if (index.row() >= (int)entries.size()) {
+        return QVariant();
+    }
+    const ProposalRecord& rec = entries[index.row()].rec;
+
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case Date:
+            return rec.strDate;
+        case Name:
+            return rec.strName;
+        case Votes:
+            return QString("%1 / %2 / %3").arg(rec.nYes).arg(rec.nNo).arg(rec.nAbstain);
+        case IPFSCID:
+            return rec.strIPFSCID;
+        }
+        // the vote column is painted by the view
+        return QVariant();
+    case SortRole:
+        switch (index.column()) {
+        case Date:
+            return (qlonglong)rec.nCreationTime;
+        case Votes:
+            return rec.nYes - rec.nNo;
+        case Vote:
+            return (int)rec.ourVote;
+        }
+        return data(index, Qt::DisplayRole);
+    case CategoryRole:
+        return rec.nCategories;
+    case HashRole:
+        return QString::fromStdString(rec.hash.ToString());
+    case IPFSCIDRole:
+        return rec.strIPFSCID;
+    case OurVoteRole:
+        return (int)rec.ourVote;
+    }
+    return QVariant();
+}
+
+QVariant ProposalTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section < columns.size()) {
+        return columns[section];
+    }
+    return QVariant();
+}
+
+Qt::ItemFlags ProposalTableModel::flags(const QModelIndex& index) const
+{
+    if (!index.isValid()) {
+        return 0;
+    }
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+}
+
+ProposalFilterProxyModel::ProposalFilterProxyModel(int _nCategory, QObject* parent) :
+    QSortFilterProxyModel(parent),
+    nCategory(_nCategory)
+{
+    setSortRole(ProposalTableModel::SortRole);
+    setDynamicSortFilter(true);
+}
+
+bool ProposalFilterProxyModel::filterAcceptsRow(int source_row, const QModelIndex& source_parent) const
+{
+    // descriptions are shown with their object
+    if (source_parent.isValid()) {
+        return true;
+    }
+    QModelIndex index = sourceModel()->index(source_row, 0, source_parent);
+    return (index.data(ProposalTableModel::CategoryRole).toInt() & nCategory) != 0;
+}
@@ -0,0 +1,173 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef HTA_QT_PROPOSALTABLEMODEL_H
+#define HTA_QT_PROPOSALTABLEMODEL_H
+
+#include "governance-vote.h"
+#include "uint256.h"
+
+#include <QAbstractItemModel>
+#include <QSet>
+#include <QSortFilterProxyModel>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+
+#include <map>
+#include <vector>
+
+/** Fields of a governance object shown on the proposals page, copied out of the governance manager by ProposalLoader */
+struct ProposalRecord
+{
+    /** Tabs of the proposals page the object is listed on */
+    enum Category {
+        PROPOSAL = 1,
+        VOTING_RECORD = 2,
+        APPROVED_RECORD = 4
+    };
+
+    uint256 hash;
+    int nCategories{0};
+    int64_t nCreationTime{0};
+    QString strDate;
+    QString strName;
+    QString strDescription;
+    QString strIPFSCID;
+    int nYes{0};
+    int nNo{0};
+    int nAbstain{0};
+    // latest funding vote of the masternode of this wallet
+    vote_outcome_enum_t ourVote{VOTE_OUTCOME_NONE};
+
+    bool operator==(const ProposalRecord& other) const;
+    bool operator!=(const ProposalRecord& other) const { return !(*this == other); }
+};
+
+typedef std::vector<ProposalRecord> ProposalRecordList;
+Q_DECLARE_METATYPE(ProposalRecordList)
+
+/** Builds ProposalRecords on its own thread, so the GUI thread never waits for cs_main or governance.cs */
+class ProposalLoader : public QObject
+{
+    Q_OBJECT
+
+public Q_SLOTS:
+    /** Load the objects in hashes, or all objects if fAll is set */
+    void load(bool fAll, const QStringList& hashes);
+
+Q_SIGNALS:
+    /** Requested objects which are not in records don't exist anymore or are not shown on any tab */
+    void loaded(bool fAll, const QStringList& hashes, const ProposalRecordList& records);
+};
+
+/**
+   Qt model of the proposals and records of the governance manager. Every object is a top level row, with the
+   description as its only child row. Objects are loaded in the background when the governance manager reports
+   a change, and only the rows of changed objects are touched.
+ */
+class ProposalTableModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    explicit ProposalTableModel(QObject* parent = 0);
+    ~ProposalTableModel();
+
+    enum ColumnIndex {
+        Date = 0,
+        Name = 1,
+        Votes = 2,
+        IPFSCID = 3,
+        Vote = 4
+    };
+
+    enum RoleIndex {
+        /** Numbers for the date and votes columns, the display string for the others */
+        SortRole = Qt::UserRole,
+        /** ProposalRecord::Category flags of the object */
+        CategoryRole,
+        /** Hash of the object as hex string */
+        HashRole,
+        /** IPFS CID of the object, also for the description row */
+        IPFSCIDRole,
+        /** vote_outcome_enum_t of our latest funding vote */
+        OurVoteRole
+    };
+
+    /** Whether the first load is done */
+    bool isLoaded() const { return fLoaded; }
+
+    /** @name Methods overridden from QAbstractItemModel
+        @{*/
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const;
+    QModelIndex parent(const QModelIndex& child) const;
+    int rowCount(const QModelIndex& parent) const;
+    int columnCount(const QModelIndex& parent) const;
+    QVariant data(const QModelIndex& index, int role) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const;
+    Qt::ItemFlags flags(const QModelIndex& index) const;
+    /*@}*/
+
+public Q_SLOTS:
+    /** Reload a single object, requests are coalesced */
+    void refresh(const QString& hash);
+    /** Reload all objects, e.g. after a new block changed the cached flags of some of them */
+    void refreshAll();
+
+Q_SIGNALS:
+    void requestLoad(bool fAll, const QStringList& hashes);
+    /** Emitted after a load was applied to the rows */
+    void updated();
+
+private Q_SLOTS:
+    void startLoad();
+    void applyRecords(bool fAll, const QStringList& hashes, const ProposalRecordList& records);
+
+private:
+    struct Entry {
+        ProposalRecord rec;
+        // internal id of the description row, stays the same while rows move
+        quintptr nId;
+
+        Entry(const ProposalRecord& _rec, quintptr _nId) : rec(_rec), nId(_nId) {}
+    };
+
+    QStringList columns;
+
+    QThread thread;
+    ProposalLoader* loader;
+    QTimer* loadTimer;
+    bool fLoading{false};
+    bool fLoaded{false};
+    bool fPendingAll{false};
+    QSet<QString> setPendingHashes;
+
+    std::vector<Entry> entries;
+    // object hash -> row
+    std::map<uint256, int> mapRows;
+    // description row id -> row of its parent
+    std::map<quintptr, int> mapIdRows;
+    quintptr nNextId{1};
+
+    void scheduleLoad();
+    void rebuildRowMaps();
+};
+
+/** Shows the objects of a single tab of the proposals page */
+class ProposalFilterProxyModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    ProposalFilterProxyModel(int nCategory, QObject* parent = 0);
+
+protected:
+    bool filterAcceptsRow(int source_row, const QModelIndex& source_parent) const;
+
+private:
+    const int nCategory;
+};
+
+#endif // HTA_QT_PROPOSALTABLEMODEL_H
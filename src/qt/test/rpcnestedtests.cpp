@@ -52,6 +52,9 @@ void RPCNestedTests::rpcNestedTests()
     //mempool.setSanityCheck(1.0);
     evoDb = new CEvoDB(1 << 20, true, true);
     pblocktree = new CBlockTreeDB(1 << 20, true);
+    paddressindexdb = new CAddressIndexDB(1 << 20, true);
+    pspentindexdb = new CSpentIndexDB(1 << 20, true);
+    ptimestampindexdb = new CTimestampIndexDB(1 << 20, true);
     pcoinsdbview = new CCoinsViewDB(1 << 23, true);
     deterministicMNManager = new CDeterministicMNManager(*evoDb);
     llmq::InitLLMQSystem(*evoDb, nullptr, true);
@@ -160,6 +163,9 @@ void RPCNestedTests::rpcNestedTests()
     delete deterministicMNManager;
     delete pcoinsdbview;
     delete pblocktree;
+    delete paddressindexdb;
+    delete pspentindexdb;
+    delete ptimestampindexdb;
     delete evoDb;
 
     boost::filesystem::remove_all(boost::filesystem::path(path));
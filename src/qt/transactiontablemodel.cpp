@@ -25,6 +25,7 @@
 #include <QDebug>
 #include <QIcon>
 #include <QList>
+#include <QTimer>
 
 #include <boost/foreach.hpp>
 
@@ -56,6 +57,29 @@ struct TxLessThan
     }
 };
 
+// Batches of more notifications than this are applied with a single model reset, which also keeps them from
+// showing a balloon per transaction
+static const size_t MAX_INCREMENTAL_NOTIFICATIONS = 10;
+
+struct TransactionNotification
+{
+public:
+    TransactionNotification() {}
+    TransactionNotification(uint256 _hash, ChangeType _status, bool _showTransaction):
+        hash(_hash), status(_status), showTransaction(_showTransaction) {}
+
+    uint256 hash;
+    ChangeType status;
+    bool showTransaction;
+    /* Decomposed transaction, only set if it is to be shown */
+    QList<TransactionRecord> records;
+};
+
+// queue notifications so that they are applied in batches, and to show a non freezing progress dialog e.g. for rescan
+static CCriticalSection cs_queueNotifications;
+static bool fQueueNotifications = false;
+static std::vector< TransactionNotification > vQueueNotifications;
+
 // Private implementation
 class TransactionTablePriv
 {
@@ -94,9 +118,10 @@ public:
     /* Update our model of the wallet incrementally, to synchronize our model of the wallet
        with that of the core.
 
-       Call with transaction that was added, removed or changed.
+       Call with transaction that was added, removed or changed. If records is null, the
+       transaction is decomposed here if needed.
      */
-    void updateWallet(const uint256 &hash, int status, bool showTransaction)
+    void updateWallet(const uint256 &hash, int status, bool showTransaction, const QList<TransactionRecord> *records = nullptr)
     {
         qDebug() << "TransactionTablePriv::updateWallet: " + QString::fromStdString(hash.ToString()) + " " + QString::number(status);
 
@@ -131,17 +156,24 @@ public:
             }
             if(showTransaction)
             {
-                LOCK2(cs_main, wallet->cs_wallet);
-                // Find transaction in wallet
-                std::map<uint256, CWalletTx>::iterator mi = wallet->mapWallet.find(hash);
-                if(mi == wallet->mapWallet.end())
+                QList<TransactionRecord> toInsert;
+                if(records)
+                {
+                    toInsert = *records;
+                }
+                else
                 {
-                    qWarning() << "TransactionTablePriv::updateWallet: Warning: Got CT_NEW, but transaction is not in wallet";
-                    break;
+                    LOCK2(cs_main, wallet->cs_wallet);
+                    // Find transaction in wallet
+                    std::map<uint256, CWalletTx>::iterator mi = wallet->mapWallet.find(hash);
+                    if(mi == wallet->mapWallet.end())
+                    {
+                        qWarning() << "TransactionTablePriv::updateWallet: Warning: Got CT_NEW, but transaction is not in wallet";
+                        break;
+                    }
+                    toInsert = TransactionRecord::decomposeTransaction(wallet, mi->second);
                 }
                 // Added -- insert at the right position
-                QList<TransactionRecord> toInsert =
-                        TransactionRecord::decomposeTransaction(wallet, mi->second);
                 if(!toInsert.isEmpty()) /* only if something to insert */
                 {
                     parent->beginInsertRows(QModelIndex(), lowerIndex, lowerIndex+toInsert.size()-1);
@@ -173,6 +205,63 @@ public:
         }
     }
 
+    /* Apply a batch of notifications, in the order they were received. Small batches are applied
+       incrementally, larger ones are merged into a copy of the cache which then replaces the model.
+     */
+    void updateWallet(const std::vector<TransactionNotification>& vNotifications)
+    {
+        if (vNotifications.size() <= MAX_INCREMENTAL_NOTIFICATIONS)
+        {
+            for (const TransactionNotification& notification : vNotifications)
+                updateWallet(notification.hash, notification.status, notification.showTransaction, &notification.records);
+            return;
+        }
+
+        qDebug() << "TransactionTablePriv::updateWallet: merging " + QString::number(vNotifications.size()) + " notifications";
+
+        std::map<uint256, std::vector<const TransactionNotification*>> mapNotifications;
+        for (const TransactionNotification& notification : vNotifications)
+            mapNotifications[notification.hash].push_back(&notification);
+
+        QList<TransactionRecord> newWallet;
+        newWallet.reserve(cachedWallet.size() + vNotifications.size());
+        QList<TransactionRecord>::const_iterator it = cachedWallet.constBegin();
+        for (const auto& pair : mapNotifications)
+        {
+            while (it != cachedWallet.constEnd() && it->hash < pair.first)
+                newWallet.append(*it++);
+
+            QList<TransactionRecord> records;
+            while (it != cachedWallet.constEnd() && it->hash == pair.first)
+                records.append(*it++);
+
+            // same transitions as the incremental update
+            for (const TransactionNotification* notification : pair.second)
+            {
+                bool inModel = !records.isEmpty();
+                int status = notification->status;
+                if (status == CT_UPDATED)
+                {
+                    if (notification->showTransaction && !inModel)
+                        status = CT_NEW;
+                    if (!notification->showTransaction && inModel)
+                        status = CT_DELETED;
+                }
+                if (status == CT_NEW && !inModel && notification->showTransaction)
+                    records = notification->records;
+                else if (status == CT_DELETED)
+                    records.clear();
+            }
+            newWallet.append(records);
+        }
+        while (it != cachedWallet.constEnd())
+            newWallet.append(*it++);
+
+        parent->beginResetModel();
+        cachedWallet.swap(newWallet);
+        parent->endResetModel();
+    }
+
     int size()
     {
         return cachedWallet.size();
@@ -242,6 +331,7 @@ TransactionTableModel::TransactionTableModel(const PlatformStyle *_platformStyle
         walletModel(parent),
         priv(new TransactionTablePriv(_wallet, this)),
         fProcessingQueuedTransactions(false),
+        notificationTimer(new QTimer(this)),
         platformStyle(_platformStyle)
 {
     columns << QString() << QString() << QString() << tr("Date") << tr("Type") << tr("Address / Label") << BitcoinUnits::getAmountColumnTitle(walletModel->getOptionsModel()->getDisplayUnit());
@@ -249,6 +339,10 @@ TransactionTableModel::TransactionTableModel(const PlatformStyle *_platformStyle
 
     connect(walletModel->getOptionsModel(), SIGNAL(displayUnitChanged(int)), this, SLOT(updateDisplayUnit()));
 
+    notificationTimer->setSingleShot(true);
+    notificationTimer->setInterval(MODEL_UPDATE_DELAY);
+    connect(notificationTimer, SIGNAL(timeout()), this, SLOT(processQueuedNotifications()));
+
     subscribeToCoreSignals();
 }
 
@@ -273,6 +367,31 @@ void TransactionTableModel::updateTransaction(const QString &hash, int status, b
     priv->updateWallet(updated, status, showTransaction);
 }
 
+void TransactionTableModel::startNotificationTimer()
+{
+    if (!notificationTimer->isActive())
+        notificationTimer->start();
+}
+
+void TransactionTableModel::processQueuedNotifications()
+{
+    std::vector<TransactionNotification> vNotifications;
+    {
+        LOCK(cs_queueNotifications);
+        if (fQueueNotifications)
+            return;
+        vNotifications.swap(vQueueNotifications);
+    }
+    notificationTimer->stop();
+    if (vNotifications.empty())
+        return;
+
+    // a batch of more than MAX_INCREMENTAL_NOTIFICATIONS resets the model, which doesn't show balloons anyway
+    fProcessingQueuedTransactions = vNotifications.size() > MAX_INCREMENTAL_NOTIFICATIONS;
+    priv->updateWallet(vNotifications);
+    fProcessingQueuedTransactions = false;
+}
+
 void TransactionTableModel::updateConfirmations()
 {
     // Blocks came in since last poll.
@@ -779,32 +898,6 @@ void TransactionTableModel::updateDisplayUnit()
     Q_EMIT dataChanged(index(0, Amount), index(priv->size()-1, Amount));
 }
 
-// queue notifications to show a non freezing progress dialog e.g. for rescan
-struct TransactionNotification
-{
-public:
-    TransactionNotification() {}
-    TransactionNotification(uint256 _hash, ChangeType _status, bool _showTransaction):
-        hash(_hash), status(_status), showTransaction(_showTransaction) {}
-
-    void invoke(QObject *ttm)
-    {
-        QString strHash = QString::fromStdString(hash.GetHex());
-        qDebug() << "NotifyTransactionChanged: " + strHash + " status= " + QString::number(status);
-        QMetaObject::invokeMethod(ttm, "updateTransaction", Qt::QueuedConnection,
-                                  Q_ARG(QString, strHash),
-                                  Q_ARG(int, status),
-                                  Q_ARG(bool, showTransaction));
-    }
-private:
-    uint256 hash;
-    ChangeType status;
-    bool showTransaction;
-};
-
-static bool fQueueNotifications = false;
-static std::vector< TransactionNotification > vQueueNotifications;
-
 static void NotifyTransactionChanged(TransactionTableModel *ttm, CWallet *wallet, const uint256 &hash, ChangeType status)
 {
     // Find transaction in wallet
@@ -814,33 +907,33 @@ static void NotifyTransactionChanged(TransactionTableModel *ttm, CWallet *wallet
     bool showTransaction = (inWallet && TransactionRecord::showTransaction(mi->second));
 
     TransactionNotification notification(hash, status, showTransaction);
+    // decompose here as well, the wallet is locked already and the GUI thread only has to merge the records
+    if (showTransaction && status != CT_DELETED) {
+        notification.records = TransactionRecord::decomposeTransaction(wallet, mi->second);
+    }
 
-    if (fQueueNotifications)
+    bool fStartTimer;
     {
-        vQueueNotifications.push_back(notification);
-        return;
+        LOCK(cs_queueNotifications);
+        fStartTimer = vQueueNotifications.empty() && !fQueueNotifications;
+        vQueueNotifications.push_back(std::move(notification));
+    }
+    if (fStartTimer) {
+        QMetaObject::invokeMethod(ttm, "startNotificationTimer", Qt::QueuedConnection);
     }
-    notification.invoke(ttm);
 }
 
 static void ShowProgress(TransactionTableModel *ttm, const std::string &title, int nProgress)
 {
+    LOCK(cs_queueNotifications);
     if (nProgress == 0)
         fQueueNotifications = true;
 
     if (nProgress == 100)
     {
         fQueueNotifications = false;
-        if (vQueueNotifications.size() > 10) // prevent balloon spam, show maximum 10 balloons
-            QMetaObject::invokeMethod(ttm, "setProcessingQueuedTransactions", Qt::QueuedConnection, Q_ARG(bool, true));
-        for (unsigned int i = 0; i < vQueueNotifications.size(); ++i)
-        {
-            if (vQueueNotifications.size() - i <= 10)
-                QMetaObject::invokeMethod(ttm, "setProcessingQueuedTransactions", Qt::QueuedConnection, Q_ARG(bool, false));
-
-            vQueueNotifications[i].invoke(ttm);
-        }
-        std::vector<TransactionNotification >().swap(vQueueNotifications); // clear
+        // everything queued during the progress is applied at once
+        QMetaObject::invokeMethod(ttm, "processQueuedNotifications", Qt::QueuedConnection);
     }
 }
 
@@ -15,6 +15,8 @@ class TransactionRecord;
 class TransactionTablePriv;
 class WalletModel;
 
+class QTimer;
+
 class CWallet;
 
 /** UI model for the transaction table of a wallet.
@@ -96,6 +98,8 @@ private:
     QStringList columns;
     TransactionTablePriv *priv;
     bool fProcessingQueuedTransactions;
+    /* Collects the wallet notifications arriving within MODEL_UPDATE_DELAY into one batch */
+    QTimer *notificationTimer;
     const PlatformStyle *platformStyle;
     int cachedNumISLocks;
     int cachedChainLockHeight;
@@ -125,6 +129,10 @@ public Q_SLOTS:
     void updateAmountColumnTitle();
     /* Needed to update fProcessingQueuedTransactions through a QueuedConnection */
     void setProcessingQueuedTransactions(bool value) { fProcessingQueuedTransactions = value; }
+    /* Needed to start notificationTimer through a QueuedConnection */
+    void startNotificationTimer();
+    /* Apply the queued wallet notifications to the model */
+    void processQueuedNotifications();
 
     friend class TransactionTablePriv;
 };
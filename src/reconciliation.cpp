@@ -0,0 +1,166 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "reconciliation.h"
+
+#include "hash.h"
+
+#include <algorithm>
+
+static uint64_t MixKey(uint64_t x)
+{
+    // splitmix64 finalizer, short ids are already uniformly distributed but cells must be picked independently
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+CInvSketch::CInvSketch(size_t nCells)
+{
+    if (nCells != 0) {
+        vCells.resize(((nCells + HASH_COUNT - 1) / HASH_COUNT) * HASH_COUNT);
+    }
+}
+
+size_t CInvSketch::GetCellsForDifference(size_t nDiff)
+{
+    // Peeling with 4 hash functions needs ~1.3 cells per id for large differences. Small tables need some slack,
+    // mostly against pairs of ids ending up in the same cells. This fails for less than 1% of the differences
+    return ((nDiff * 3 / 2 + 20 + HASH_COUNT - 1) / HASH_COUNT) * HASH_COUNT;
+}
+
+size_t CInvSketch::GetCellIndex(uint64_t nKey, int nHash) const
+{
+    size_t nPartitionSize = vCells.size() / HASH_COUNT;
+    return nHash * nPartitionSize + MixKey(nKey + nHash) % nPartitionSize;
+}
+
+uint32_t CInvSketch::GetCheckSum(uint64_t nKey)
+{
+    return (uint32_t)MixKey(nKey ^ 0x5bd1e9955bd1e995ULL);
+}
+
+void CInvSketch::Update(uint64_t nKey, int32_t nDelta)
+{
+    if (vCells.empty()) {
+        return;
+    }
+    uint32_t nCheckSum = GetCheckSum(nKey);
+    for (int i = 0; i < HASH_COUNT; i++) {
+        Cell& cell = vCells[GetCellIndex(nKey, i)];
+        cell.nCount += nDelta;
+        cell.nKeySum ^= nKey;
+        cell.nCheckSum ^= nCheckSum;
+    }
+}
+
+bool CInvSketch::Subtract(const CInvSketch& other)
+{
+    if (vCells.size() != other.vCells.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < vCells.size(); i++) {
+        vCells[i].nCount -= other.vCells[i].nCount;
+        vCells[i].nKeySum ^= other.vCells[i].nKeySum;
+        vCells[i].nCheckSum ^= other.vCells[i].nCheckSum;
+    }
+    return true;
+}
+
+bool CInvSketch::Decode(std::vector<uint64_t>& vPositiveRet, std::vector<uint64_t>& vNegativeRet) const
+{
+    vPositiveRet.clear();
+    vNegativeRet.clear();
+
+    if (vCells.size() % HASH_COUNT != 0) {
+        return false;
+    }
+
+    CInvSketch work(*this);
+    // every peeled id empties at least one cell, so a valid sketch never needs more steps than it has cells
+    size_t nMaxPeels = vCells.size();
+    bool fProgress = true;
+    while (fProgress) {
+        fProgress = false;
+        for (const Cell& cell : work.vCells) {
+            if ((cell.nCount != 1 && cell.nCount != -1) || cell.nCheckSum != GetCheckSum(cell.nKeySum)) {
+                continue;
+            }
+            if (vPositiveRet.size() + vNegativeRet.size() >= nMaxPeels) {
+                return false;
+            }
+            uint64_t nKey = cell.nKeySum;
+            int32_t nCount = cell.nCount;
+            if (nCount == 1) {
+                vPositiveRet.emplace_back(nKey);
+            } else {
+                vNegativeRet.emplace_back(nKey);
+            }
+            // this changes the cell we're looking at, the loop only continues with the next one
+            work.Update(nKey, -nCount);
+            fProgress = true;
+        }
+    }
+
+    for (const Cell& cell : work.vCells) {
+        if (!cell.IsEmpty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CReconciliationState::CReconciliationState(bool _fInitiator, uint64_t nLocalSalt, uint64_t nRemoteSalt) :
+    fInitiator(_fInitiator)
+{
+    // both sides must use the same keys to compute the same short ids
+    CHashWriter hw(SER_GETHASH, 0);
+    hw << std::string("Historia set reconciliation") << std::min(nLocalSalt, nRemoteSalt) << std::max(nLocalSalt, nRemoteSalt);
+    uint256 hash = hw.GetHash();
+    k0 = hash.GetUint64(0);
+    k1 = hash.GetUint64(1);
+}
+
+uint64_t CReconciliationState::GetShortId(const CInv& inv) const
+{
+    return CSipHasher(k0, k1).Write((uint64_t)inv.type).Write(inv.hash.begin(), inv.hash.size()).Finalize();
+}
+
+bool CReconciliationState::Add(const CInv& inv)
+{
+    if (mapSet.size() >= MAX_RECON_SET_SIZE) {
+        return false;
+    }
+    mapSet.emplace(GetShortId(inv), inv);
+    return true;
+}
+
+CInvSketch CReconciliationState::GetSketch(size_t nCells) const
+{
+    CInvSketch sketch(nCells);
+    for (const auto& p : mapSet) {
+        sketch.Insert(p.first);
+    }
+    return sketch;
+}
+
+size_t CReconciliationState::EstimateSketchCells(size_t nLocalSize, size_t nRemoteSize, uint16_t nQ)
+{
+    size_t nMin = std::min(nLocalSize, nRemoteSize);
+    size_t nMax = std::max(nLocalSize, nRemoteSize);
+    size_t nDiff = (nMax - nMin) + nMin * std::min(nQ, RECON_Q_PRECISION) / RECON_Q_PRECISION + 1;
+    return CInvSketch::GetCellsForDifference(nDiff);
+}
+
+void CReconciliationState::UpdateQ(size_t nLocalSize, size_t nRemoteSize, size_t nDiff)
+{
+    size_t nMin = std::min(nLocalSize, nRemoteSize);
+    size_t nMax = std::max(nLocalSize, nRemoteSize);
+    if (nMin == 0) {
+        return;
+    }
+    size_t nExcess = nDiff > (nMax - nMin) ? nDiff - (nMax - nMin) : 0;
+    nQ = (uint16_t)std::min<size_t>(nExcess * RECON_Q_PRECISION / nMin, RECON_Q_PRECISION);
+}
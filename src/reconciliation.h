@@ -0,0 +1,150 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef HTA_RECONCILIATION_H
+#define HTA_RECONCILIATION_H
+
+#include "protocol.h"
+#include "serialize.h"
+
+#include <map>
+#include <vector>
+
+/** Version of the set reconciliation protocol announced in SENDRECON */
+static const uint32_t RECON_VERSION = 1;
+/** Seconds between reconciliation requests sent by the initiator */
+static const int64_t RECON_REQUEST_INTERVAL = 2;
+/** Seconds after which an unanswered reconciliation request is given up */
+static const int64_t RECON_RESPONSE_TIMEOUT = 30;
+/** Maximum number of items waiting for reconciliation with a single peer, further items are announced by INV */
+static const size_t MAX_RECON_SET_SIZE = 10000;
+/** Maximum number of cells of a sketch, larger differences are announced by INV */
+static const size_t MAX_SKETCH_CELLS = 3000;
+/** Fixed point precision of the q coefficient which estimates the set difference */
+static const uint16_t RECON_Q_PRECISION = (1 << 14) - 1;
+/** Initial q coefficient, 0.25 */
+static const uint16_t DEFAULT_RECON_Q = RECON_Q_PRECISION / 4;
+
+/**
+ * Invertible bloom lookup table over 64 bit short ids. Subtracting the sketch of one set from the sketch of another
+ * one gives a sketch of their symmetric difference, which can be decoded as long as the difference is small
+ * compared to the number of cells. The size of the sketch only depends on the expected difference, not on the size
+ * of the sets.
+ */
+class CInvSketch
+{
+public:
+    /** Number of cells each id is added to, cells are split into as many partitions */
+    static const int HASH_COUNT = 4;
+
+private:
+    struct Cell
+    {
+        int32_t nCount{0};
+        uint64_t nKeySum{0};
+        uint32_t nCheckSum{0};
+
+        bool IsEmpty() const { return nCount == 0 && nKeySum == 0 && nCheckSum == 0; }
+
+        ADD_SERIALIZE_METHODS
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action)
+        {
+            READWRITE(nCount);
+            READWRITE(nKeySum);
+            READWRITE(nCheckSum);
+        }
+    };
+
+    std::vector<Cell> vCells;
+
+    size_t GetCellIndex(uint64_t nKey, int nHash) const;
+    static uint32_t GetCheckSum(uint64_t nKey);
+    void Update(uint64_t nKey, int32_t nDelta);
+
+public:
+    CInvSketch() {}
+    explicit CInvSketch(size_t nCells);
+
+    /** Number of cells needed to decode a difference of nDiff ids with high probability */
+    static size_t GetCellsForDifference(size_t nDiff);
+
+    size_t GetCellCount() const { return vCells.size(); }
+    bool IsEmpty() const { return vCells.empty(); }
+
+    void Insert(uint64_t nKey) { Update(nKey, 1); }
+    void Erase(uint64_t nKey) { Update(nKey, -1); }
+
+    /** Subtract a sketch with the same number of cells, returns false if the sizes don't match */
+    bool Subtract(const CInvSketch& other);
+
+    /**
+     * Decode the ids of a sketch which is the result of Subtract, vPositiveRet gets the ids only present in the
+     * minuend and vNegativeRet the ids only present in the subtrahend. Returns false if decoding failed.
+     */
+    bool Decode(std::vector<uint64_t>& vPositiveRet, std::vector<uint64_t>& vNegativeRet) const;
+
+    ADD_SERIALIZE_METHODS
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(vCells);
+    }
+};
+
+/**
+ * State of the reconciliation of tx and governance vote announcements with a single peer. Instead of announcing
+ * these items by INV, they are collected into a set, and the outbound side of the connection (the initiator)
+ * periodically asks the other side for a sketch of its set. The initiator subtracts the sketch of its own set and
+ * decodes the difference, announces the items the peer is missing by INV and asks for the announcement of the
+ * items it is missing itself. Items known to both sides are never announced. If decoding fails, both sides fall
+ * back to announcing their whole set by INV.
+ *
+ * Protected by the cs_inventory lock of the node it belongs to.
+ */
+class CReconciliationState
+{
+public:
+    typedef std::map<uint64_t, CInv> InvMap;
+
+    const bool fInitiator;
+
+private:
+    uint64_t k0;
+    uint64_t k1;
+
+public:
+    // items which were not announced or reconciled yet
+    InvMap mapSet;
+    // responder only: the items of the last sketch sent, waiting for RECONCILDIFF
+    InvMap mapSketched;
+    // initiator only: whether we are waiting for a sketch and when it was requested
+    bool fRequested{false};
+    int64_t nRequestTime{0};
+    int64_t nNextRequest{0};
+    // initiator only: estimation coefficient for the set difference, updated after each reconciliation
+    uint16_t nQ{DEFAULT_RECON_Q};
+
+    CReconciliationState(bool _fInitiator, uint64_t nLocalSalt, uint64_t nRemoteSalt);
+
+    static bool IsReconcilable(const CInv& inv) { return inv.type == MSG_TX || inv.type == MSG_GOVERNANCE_OBJECT_VOTE; }
+
+    uint64_t GetShortId(const CInv& inv) const;
+
+    /** Add an item to the set, returns false if the set is full and the item has to be announced by INV */
+    bool Add(const CInv& inv);
+
+    /** Build a sketch of the current set */
+    CInvSketch GetSketch(size_t nCells) const;
+
+    /** Number of sketch cells the responder uses, based on both set sizes and the initiator's q coefficient */
+    static size_t EstimateSketchCells(size_t nLocalSize, size_t nRemoteSize, uint16_t nQ);
+
+    /** Update q after a successful reconciliation, nDiff being the size of the decoded difference */
+    void UpdateQ(size_t nLocalSize, size_t nRemoteSize, size_t nDiff);
+};
+
+#endif // HTA_RECONCILIATION_H
@@ -5,9 +5,13 @@
 
 #include "chain.h"
 #include "chainparams.h"
+#include "governance.h"
+#include "governance-object.h"
+#include "hash.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "validation.h"
+#include "httprpc.h"
 #include "httpserver.h"
 #include "rpc/server.h"
 #include "streams.h"
@@ -16,11 +20,15 @@
 #include "utilstrencodings.h"
 #include "version.h"
 
+#include "evo/deterministicmns.h"
+#include "evo/simplifiedmns.h"
+
 #include <boost/algorithm/string.hpp>
 
+#include <numeric>
+
 #include <univalue.h>
 
-static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
 
 enum RetFormat {
     RF_UNDEF,
@@ -118,6 +126,19 @@ static bool ParseHashStr(const std::string& strReq, uint256& v)
     return true;
 }
 
+/** Set the ETag of a reply, returns true if the client already has this version and a 304 reply was sent */
+static bool CheckETag(HTTPRequest* req, const uint256& hash, enum RetFormat rf)
+{
+    std::string strETag = strprintf("\"%s.%s\"", hash.ToString(), rf_names[rf].name);
+    std::pair<bool, std::string> ifNoneMatch = req->GetHeader("If-None-Match");
+    req->WriteHeader("ETag", strETag);
+    if (ifNoneMatch.first && ifNoneMatch.second == strETag) {
+        req->WriteReply(HTTP_NOT_MODIFIED);
+        return true;
+    }
+    return false;
+}
+
 static bool CheckWarmup(HTTPRequest* req)
 {
     std::string statusmessage;
@@ -186,9 +207,8 @@ static bool rest_headers(HTTPRequest* req,
         BOOST_FOREACH(const CBlockIndex *pindex, headers) {
             jsonHeaders.push_back(blockheaderToJSON(pindex));
         }
-        std::string strJSON = jsonHeaders.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        req->WriteJSONReply(HTTP_OK, jsonHeaders);
         return true;
     }
     default: {
@@ -248,9 +268,8 @@ static bool rest_block(HTTPRequest* req,
 
     case RF_JSON: {
         UniValue objBlock = blockToJSON(block, pblockindex, showTxDetails);
-        std::string strJSON = objBlock.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        req->WriteJSONReply(HTTP_OK, objBlock);
         return true;
     }
 
@@ -288,9 +307,8 @@ static bool rest_chaininfo(HTTPRequest* req, const std::string& strURIPart)
         JSONRPCRequest jsonRequest;
         jsonRequest.params = UniValue(UniValue::VARR);
         UniValue chainInfoObject = getblockchaininfo(jsonRequest);
-        std::string strJSON = chainInfoObject.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        req->WriteJSONReply(HTTP_OK, chainInfoObject);
         return true;
     }
     default: {
@@ -313,9 +331,8 @@ static bool rest_mempool_info(HTTPRequest* req, const std::string& strURIPart)
     case RF_JSON: {
         UniValue mempoolInfoObject = mempoolInfoToJSON();
 
-        std::string strJSON = mempoolInfoObject.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        req->WriteJSONReply(HTTP_OK, mempoolInfoObject);
         return true;
     }
     default: {
@@ -338,9 +355,8 @@ static bool rest_mempool_contents(HTTPRequest* req, const std::string& strURIPar
     case RF_JSON: {
         UniValue mempoolObject = mempoolToJSON(true);
 
-        std::string strJSON = mempoolObject.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        req->WriteJSONReply(HTTP_OK, mempoolObject);
         return true;
     }
     default: {
@@ -389,9 +405,8 @@ static bool rest_tx(HTTPRequest* req, const std::string& strURIPart)
     case RF_JSON: {
         UniValue objTx(UniValue::VOBJ);
         TxToJSON(*tx, hashBlock, objTx);
-        std::string strJSON = objTx.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        req->WriteJSONReply(HTTP_OK, objTx);
         return true;
     }
 
@@ -495,47 +510,65 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
     }
 
     // limit max outpoints
-    if (vOutPoints.size() > MAX_GETUTXOS_OUTPOINTS)
-        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Error: max outpoints exceeded (max: %d, tried: %d)", MAX_GETUTXOS_OUTPOINTS, vOutPoints.size()));
-
-    // check spentness and form a bitmap (as well as a JSON capable human-readable string representation)
-    std::vector<unsigned char> bitmap;
-    std::vector<CCoin> outs;
-    std::string bitmapStringRepresentation;
-    std::vector<bool> hits;
-    bitmap.resize((vOutPoints.size() + 7) / 8);
+    size_t nMaxOutPoints = std::max<int64_t>(GetArg("-restmaxgetutxos", DEFAULT_REST_MAX_GETUTXOS), 1);
+    if (vOutPoints.size() > nMaxOutPoints)
+        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Error: max outpoints exceeded (max: %d, tried: %d)", nMaxOutPoints, vOutPoints.size()));
+
+    // Look the outpoints up in sorted order, outputs of the same tx and neighbouring db keys are then fetched
+    // one after another and duplicates only once
+    std::vector<size_t> vOrder(vOutPoints.size());
+    std::iota(vOrder.begin(), vOrder.end(), 0);
+    std::sort(vOrder.begin(), vOrder.end(), [&](size_t a, size_t b) {
+        return vOutPoints[a] < vOutPoints[b];
+    });
+
+    std::vector<Coin> vCoins(vOutPoints.size());
+    std::vector<bool> hits(vOutPoints.size());
+    int nChainHeight;
+    uint256 hashChainTip;
     {
         LOCK2(cs_main, mempool.cs);
 
-        CCoinsView viewDummy;
-        CCoinsViewCache view(&viewDummy);
-
         CCoinsViewCache& viewChain = *pcoinsTip;
         CCoinsViewMemPool viewMempool(&viewChain, mempool);
-
-        if (fCheckMemPool)
-            view.SetBackend(viewMempool); // switch cache backend to db+mempool in case user likes to query mempool
-
-        for (size_t i = 0; i < vOutPoints.size(); i++) {
-            bool hit = false;
-            Coin coin;
-            if (view.GetCoin(vOutPoints[i], coin) && !mempool.isSpent(vOutPoints[i])) {
-                hit = true;
-                outs.emplace_back(std::move(coin));
+        // query the mempool too if the user likes to
+        CCoinsView& view = fCheckMemPool ? static_cast<CCoinsView&>(viewMempool) : static_cast<CCoinsView&>(viewChain);
+
+        for (size_t k = 0; k < vOrder.size(); k++) {
+            size_t i = vOrder[k];
+            if (k > 0 && vOutPoints[i] == vOutPoints[vOrder[k - 1]]) {
+                hits[i] = hits[vOrder[k - 1]];
+                vCoins[i] = vCoins[vOrder[k - 1]];
+                continue;
             }
+            hits[i] = view.GetCoin(vOutPoints[i], vCoins[i]) && !(fCheckMemPool && mempool.isSpent(vOutPoints[i]));
+        }
 
-            hits.push_back(hit);
-            bitmapStringRepresentation.append(hit ? "1" : "0"); // form a binary string representation (human-readable for json output)
-            bitmap[i / 8] |= ((uint8_t)hit) << (i % 8);
+        nChainHeight = chainActive.Height();
+        hashChainTip = chainActive.Tip()->GetBlockHash();
+    }
+
+    // check spentness and form a bitmap (as well as a JSON capable human-readable string representation)
+    std::vector<unsigned char> bitmap;
+    std::vector<CCoin> outs;
+    std::string bitmapStringRepresentation;
+    bitmap.resize((vOutPoints.size() + 7) / 8);
+    bitmapStringRepresentation.reserve(vOutPoints.size());
+    for (size_t i = 0; i < vOutPoints.size(); i++) {
+        if (hits[i]) {
+            outs.emplace_back(std::move(vCoins[i]));
         }
+        bitmapStringRepresentation.append(hits[i] ? "1" : "0"); // form a binary string representation (human-readable for json output)
+        bitmap[i / 8] |= ((uint8_t)hits[i]) << (i % 8);
     }
+    vCoins.clear();
 
     switch (rf) {
     case RF_BINARY: {
         // serialize data
         // use exact same output as mentioned in Bip64
         CDataStream ssGetUTXOResponse(SER_NETWORK, PROTOCOL_VERSION);
-        ssGetUTXOResponse << chainActive.Height() << chainActive.Tip()->GetBlockHash() << bitmap << outs;
+        ssGetUTXOResponse << nChainHeight << hashChainTip << bitmap << outs;
         std::string ssGetUTXOResponseString = ssGetUTXOResponse.str();
 
         req->WriteHeader("Content-Type", "application/octet-stream");
@@ -545,7 +578,7 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
 
     case RF_HEX: {
         CDataStream ssGetUTXOResponse(SER_NETWORK, PROTOCOL_VERSION);
-        ssGetUTXOResponse << chainActive.Height() << chainActive.Tip()->GetBlockHash() << bitmap << outs;
+        ssGetUTXOResponse << nChainHeight << hashChainTip << bitmap << outs;
         std::string strHex = HexStr(ssGetUTXOResponse.begin(), ssGetUTXOResponse.end()) + "\n";
 
         req->WriteHeader("Content-Type", "text/plain");
@@ -558,8 +591,8 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
 
         // pack in some essentials
         // use more or less the same output as mentioned in Bip64
-        objGetUTXOResponse.push_back(Pair("chainHeight", chainActive.Height()));
-        objGetUTXOResponse.push_back(Pair("chaintipHash", chainActive.Tip()->GetBlockHash().GetHex()));
+        objGetUTXOResponse.push_back(Pair("chainHeight", nChainHeight));
+        objGetUTXOResponse.push_back(Pair("chaintipHash", hashChainTip.GetHex()));
         objGetUTXOResponse.push_back(Pair("bitmap", bitmapStringRepresentation));
 
         UniValue utxos(UniValue::VARR);
@@ -577,9 +610,8 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
         objGetUTXOResponse.push_back(Pair("utxos", utxos));
 
         // return json string
-        std::string strJSON = objGetUTXOResponse.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        req->WriteJSONReply(HTTP_OK, objGetUTXOResponse);
         return true;
     }
     default: {
@@ -591,6 +623,167 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
     return true; // continue to process further HTTP reqs on this cxn
 }
 
+static bool rest_mnlist(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string hashStr;
+    const RetFormat rf = ParseDataFormat(hashStr, strURIPart);
+
+    uint256 hash;
+    if (!ParseHashStr(hashStr, hash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
+    if (rf == RF_UNDEF)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+
+    const CBlockIndex* pindex;
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator it = mapBlockIndex.find(hash);
+        if (it == mapBlockIndex.end())
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        pindex = it->second;
+    }
+
+    // the list of a block never changes
+    if (CheckETag(req, hash, rf))
+        return true;
+
+    CSimplifiedMNList sml(deterministicMNManager->GetListForBlock(pindex));
+
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        CDataStream ssList(SER_NETWORK, PROTOCOL_VERSION);
+        WriteCompactSize(ssList, sml.mnList.size());
+        for (const auto& entry : sml.mnList) {
+            ssList << *entry;
+        }
+        if (rf == RF_BINARY) {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, ssList.str());
+        } else {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(ssList.begin(), ssList.end()) + "\n");
+        }
+        return true;
+    }
+    case RF_JSON: {
+        UniValue jsonList(UniValue::VARR);
+        for (const auto& entry : sml.mnList) {
+            UniValue obj;
+            entry->ToJson(obj);
+            jsonList.push_back(obj);
+        }
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteJSONReply(HTTP_OK, jsonList);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+static bool rest_identity(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string strIdentity;
+    const RetFormat rf = ParseDataFormat(strIdentity, strURIPart);
+    if (strIdentity.empty())
+        return RESTERR(req, HTTP_BAD_REQUEST, "Use /rest/identity/<IDENTITY>.json");
+
+    switch (rf) {
+    case RF_JSON: {
+        // answered from the identity index, without taking cs_main
+        auto dmn = deterministicMNManager->ResolveIdentity(strIdentity);
+        if (!dmn)
+            return RESTERR(req, HTTP_NOT_FOUND, strIdentity + " not found");
+        UniValue obj(UniValue::VOBJ);
+        dmn->ToJson(obj);
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteJSONReply(HTTP_OK, obj);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+    }
+    }
+}
+
+static bool rest_gobjects(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    if (!param.empty())
+        return RESTERR(req, HTTP_BAD_REQUEST, "Use /rest/gobjects.<ext>");
+    if (rf == RF_UNDEF)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+
+    LOCK2(cs_main, governance.cs);
+
+    std::vector<const CGovernanceObject*> objs = governance.GetAllNewerThan(0);
+
+    // objects and votes change between blocks too, so the version is the tip together with the state of all objects
+    CHashWriter hw(SER_GETHASH, 0);
+    hw << (chainActive.Tip() ? chainActive.Tip()->GetBlockHash() : uint256());
+    for (const CGovernanceObject* pGovObj : objs) {
+        hw << pGovObj->GetHash() << pGovObj->GetVoteTallyVersion();
+        hw << pGovObj->IsSetCachedValid() << pGovObj->IsSetCachedFunding() << pGovObj->IsSetCachedDelete() << pGovObj->IsSetCachedEndorsed();
+    }
+    if (CheckETag(req, hw.GetHash(), rf))
+        return true;
+
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        // network serialization, without votes
+        CDataStream ssObjects(SER_NETWORK, PROTOCOL_VERSION);
+        WriteCompactSize(ssObjects, objs.size());
+        for (const CGovernanceObject* pGovObj : objs) {
+            ssObjects << *pGovObj;
+        }
+        if (rf == RF_BINARY) {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, ssObjects.str());
+        } else {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(ssObjects.begin(), ssObjects.end()) + "\n");
+        }
+        return true;
+    }
+    case RF_JSON: {
+        UniValue jsonObjects(UniValue::VARR);
+        for (const CGovernanceObject* pGovObj : objs) {
+            UniValue obj(UniValue::VOBJ);
+            obj.push_back(Pair("Hash", pGovObj->GetHash().ToString()));
+            obj.push_back(Pair("CollateralHash", pGovObj->GetCollateralHash().ToString()));
+            obj.push_back(Pair("ObjectType", pGovObj->GetObjectType()));
+            obj.push_back(Pair("CreationTime", pGovObj->GetCreationTime()));
+            obj.push_back(Pair("DataHex", pGovObj->GetDataAsHexString()));
+            obj.push_back(Pair("AbsoluteYesCount", pGovObj->GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING)));
+            obj.push_back(Pair("YesCount", pGovObj->GetYesCount(VOTE_SIGNAL_FUNDING)));
+            obj.push_back(Pair("NoCount", pGovObj->GetNoCount(VOTE_SIGNAL_FUNDING)));
+            obj.push_back(Pair("AbstainCount", pGovObj->GetAbstainCount(VOTE_SIGNAL_FUNDING)));
+            obj.push_back(Pair("fCachedValid", pGovObj->IsSetCachedValid()));
+            obj.push_back(Pair("fCachedFunding", pGovObj->IsSetCachedFunding()));
+            obj.push_back(Pair("fCachedDelete", pGovObj->IsSetCachedDelete()));
+            obj.push_back(Pair("fCachedEndorsed", pGovObj->IsSetCachedEndorsed()));
+            jsonObjects.push_back(obj);
+        }
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteJSONReply(HTTP_OK, jsonObjects);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -603,6 +796,9 @@ static const struct {
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
+      {"/rest/mnlist/", rest_mnlist},
+      {"/rest/identity/", rest_identity},
+      {"/rest/gobjects", rest_gobjects},
 };
 
 bool StartREST()
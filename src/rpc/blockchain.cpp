@@ -5,7 +5,9 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "amount.h"
+#include "blockfilter.h"
 #include "chain.h"
+#include "chainsnapshot.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "coins.h"
@@ -20,9 +22,11 @@
 #include "sync.h"
 #include "txdb.h"
 #include "txmempool.h"
+#include "unordered_lru_cache.h"
 #include "util.h"
 #include "utilstrencodings.h"
 #include "hash.h"
+#include "saltedhasher.h"
 
 #include "evo/specialtx.h"
 #include "evo/cbtx.h"
@@ -50,6 +54,8 @@ static std::condition_variable cond_blockchange;
 static CUpdatedBlock latestblock;
 
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
+extern void TxDetailsToJSON(const CTransaction& tx, UniValue& entry);
+extern void TxStateToJSON(const uint256& txid, const uint256& hashBlock, UniValue& entry);
 void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
 
 /**
@@ -119,15 +125,10 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     return result;
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+// The part of blockToJSON which only depends on the block, without the TxStateToJSON part of the txes
+static UniValue blockDetailsToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails)
 {
     UniValue result(UniValue::VOBJ);
-    result.push_back(Pair("hash", blockindex->GetBlockHash().GetHex()));
-    int confirmations = -1;
-    // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex))
-        confirmations = chainActive.Height() - blockindex->nHeight + 1;
-    result.push_back(Pair("confirmations", confirmations));
     result.push_back(Pair("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)));
     result.push_back(Pair("height", blockindex->nHeight));
     result.push_back(Pair("version", block.nVersion));
@@ -139,7 +140,7 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
         if(txDetails)
         {
             UniValue objTx(UniValue::VOBJ);
-            TxToJSON(*tx, uint256(), objTx);
+            TxDetailsToJSON(*tx, objTx);
             txs.push_back(objTx);
         }
         else
@@ -163,6 +164,37 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
 
     if (blockindex->pprev)
         result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
+
+    return result;
+}
+
+// Complete the result of blockDetailsToJSON with the fields depending on the active chain and the locks
+static UniValue blockToJSON(const CBlockIndex* blockindex, const UniValue& details, bool txDetails)
+{
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("hash", blockindex->GetBlockHash().GetHex()));
+    int confirmations = -1;
+    // Only report confirmations if the block is on the main chain
+    if (chainActive.Contains(blockindex))
+        confirmations = chainActive.Height() - blockindex->nHeight + 1;
+    result.push_back(Pair("confirmations", confirmations));
+
+    const std::vector<std::string>& keys = details.getKeys();
+    const std::vector<UniValue>& values = details.getValues();
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (txDetails && keys[i] == "tx") {
+            UniValue txs(UniValue::VARR);
+            for (const UniValue& detailsTx : values[i].getValues()) {
+                UniValue objTx(detailsTx);
+                TxStateToJSON(uint256S(find_value(detailsTx, "txid").get_str()), uint256(), objTx);
+                txs.push_back(objTx);
+            }
+            result.push_back(Pair("tx", txs));
+        } else {
+            result.push_back(Pair(keys[i], values[i]));
+        }
+    }
+
     CBlockIndex *pnext = chainActive.Next(blockindex);
     if (pnext)
         result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
@@ -172,6 +204,16 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     return result;
 }
 
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+{
+    return blockToJSON(blockindex, blockDetailsToJSON(block, blockindex, txDetails), txDetails);
+}
+
+// blockDetailsToJSON results by (block hash, verbosity), they don't depend on the active chain and stay valid
+// across reorgs. Details of txes are only cached without -spentindex. Protected by cs_main
+static unordered_lru_cache<uint256, std::shared_ptr<const UniValue>, StaticSaltedHasher, 128> blockDetailsCache;
+static unordered_lru_cache<uint256, std::shared_ptr<const UniValue>, StaticSaltedHasher, 8> blockTxDetailsCache;
+
 UniValue getblockcount(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0)
@@ -748,6 +790,44 @@ UniValue getblockheader(const JSONRPCRequest& request)
     return blockheaderToJSON(pblockindex);
 }
 
+UniValue getblockfilter(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "getblockfilter \"blockhash\"\n"
+            "\nReturns the BIP158 basic filter of a block and its filter header, requires -blockfilterindex.\n"
+            "\nArguments:\n"
+            "1. \"blockhash\"     (string, required) The block hash\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filter\" : \"hex\",   (string) The hex-encoded filter\n"
+            "  \"header\" : \"hash\"   (string) The filter header, which commits to the filters of the block and its ancestors\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
+            + HelpExampleRpc("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
+        );
+
+    uint256 hash = ParseHashV(request.params[0], "blockhash");
+    {
+        LOCK(cs_main);
+        if (mapBlockIndex.count(hash) == 0)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        if (!fBlockFilterIndex)
+            throw JSONRPCError(RPC_MISC_ERROR, "Block filters are not available, -blockfilterindex is disabled or the index is still being built");
+    }
+
+    BlockFilter filter;
+    uint256 filterHash, header;
+    if (!pblockfilterindexdb->ReadFilter(hash, filter) || !pblockfilterindexdb->ReadFilterHeader(hash, filterHash, header))
+        throw JSONRPCError(RPC_MISC_ERROR, "No filter for this block, it was never connected or isn't indexed yet");
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("filter", HexStr(filter.GetEncodedFilter())));
+    result.push_back(Pair("header", header.GetHex()));
+    return result;
+}
+
 UniValue getblockheaders(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 1 || request.params.size() > 3)
@@ -912,6 +992,13 @@ UniValue getblock(const JSONRPCRequest& request)
     if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
         throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
 
+    bool fTxDetails = verbosity >= 2;
+    bool fUseCache = verbosity > 0 && !(fTxDetails && fSpentIndex);
+    std::shared_ptr<const UniValue> details;
+    if (fUseCache && (fTxDetails ? blockTxDetailsCache.get(hash, details) : blockDetailsCache.get(hash, details))) {
+        return blockToJSON(pblockindex, *details, fTxDetails);
+    }
+
     if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
         // Block not found on disk. This could be because we have the block
         // header in our index but don't have the block (for example if a
@@ -928,7 +1015,15 @@ UniValue getblock(const JSONRPCRequest& request)
         return strHex;
     }
 
-    return blockToJSON(block, pblockindex, verbosity >= 2);
+    details = std::make_shared<const UniValue>(blockDetailsToJSON(block, pblockindex, fTxDetails));
+    if (fUseCache) {
+        if (fTxDetails) {
+            blockTxDetailsCache.insert(hash, details);
+        } else {
+            blockDetailsCache.insert(hash, details);
+        }
+    }
+    return blockToJSON(pblockindex, *details, fTxDetails);
 }
 
 struct CCoinsStats
@@ -1087,6 +1182,86 @@ UniValue gettxoutsetinfo(const JSONRPCRequest& request)
     return ret;
 }
 
+static UniValue SnapshotInfoToJson(const CChainStateSnapshotInfo& info)
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("blockhash", info.blockHash.GetHex()));
+    ret.push_back(Pair("height", info.nHeight));
+    ret.push_back(Pair("coins", (int64_t)info.nCoins));
+    ret.push_back(Pair("masternodes", (int64_t)info.nMasternodes));
+    ret.push_back(Pair("quorums", (int64_t)info.nQuorums));
+    ret.push_back(Pair("governance_size", (int64_t)info.nGovernanceSize));
+    ret.push_back(Pair("hash", info.hash.GetHex()));
+    return ret;
+}
+
+static const std::string SNAPSHOT_INFO_HELP =
+    "{\n"
+    "  \"blockhash\": \"hash\",    (string) The block the snapshot was taken at\n"
+    "  \"height\": n,             (numeric) The height of that block\n"
+    "  \"coins\": n,              (numeric) The number of unspent transaction outputs\n"
+    "  \"masternodes\": n,        (numeric) The number of masternodes in the deterministic list\n"
+    "  \"quorums\": n,            (numeric) The number of active quorum commitments\n"
+    "  \"governance_size\": n,    (numeric) The size of the governance store in bytes\n"
+    "  \"hash\": \"hash\"          (string) The hash of the snapshot\n"
+    "}\n";
+
+UniValue dumpsnapshot(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "dumpsnapshot \"path\"\n"
+            "\nWrite a bootstrap snapshot of the UTXO set, the deterministic masternode list, the active quorum\n"
+            "commitments and the governance store at the current tip. Relative paths are in the data directory.\n"
+            "Note this call may take some time.\n"
+            "\nArguments:\n"
+            "1. \"path\"     (string, required) The file to write the snapshot to\n"
+            "\nResult:\n"
+            + SNAPSHOT_INFO_HELP +
+            "\nExamples:\n"
+            + HelpExampleCli("dumpsnapshot", "\"snapshot.dat\"")
+            + HelpExampleRpc("dumpsnapshot", "\"snapshot.dat\"")
+        );
+
+    boost::filesystem::path path = boost::filesystem::absolute(request.params[0].get_str(), GetDataDir());
+    CChainStateSnapshotInfo info;
+    std::string strError;
+    if (!CChainStateSnapshot::Dump(path, info, strError)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to write snapshot: " + strError);
+    }
+    return SnapshotInfoToJson(info);
+}
+
+UniValue verifysnapshot(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "verifysnapshot \"path\" ( \"hash\" )\n"
+            "\nRead a snapshot written by dumpsnapshot, check that it's well formed and optionally that it\n"
+            "matches a trusted hash. Relative paths are in the data directory.\n"
+            "\nArguments:\n"
+            "1. \"path\"     (string, required) The snapshot file\n"
+            "2. \"hash\"     (string, optional) The hash the snapshot must have\n"
+            "\nResult:\n"
+            + SNAPSHOT_INFO_HELP +
+            "\nExamples:\n"
+            + HelpExampleCli("verifysnapshot", "\"snapshot.dat\" \"00000000000000000000000000000000000000000000000000000000000000ff\"")
+            + HelpExampleRpc("verifysnapshot", "\"snapshot.dat\", \"00000000000000000000000000000000000000000000000000000000000000ff\"")
+        );
+
+    boost::filesystem::path path = boost::filesystem::absolute(request.params[0].get_str(), GetDataDir());
+    uint256 expectedHash;
+    if (request.params.size() > 1) {
+        expectedHash = ParseHashV(request.params[1], "hash");
+    }
+    CChainStateSnapshotInfo info;
+    std::string strError;
+    if (!CChainStateSnapshot::Verify(path, expectedHash, info, strError)) {
+        throw JSONRPCError(RPC_VERIFY_ERROR, "Invalid snapshot: " + strError);
+    }
+    return SnapshotInfoToJson(info);
+}
+
 UniValue gettxout(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
@@ -1366,6 +1541,123 @@ struct CompareBlocksByHeight
     }
 };
 
+UniValue getindexinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getindexinfo\n"
+            "\nReturns the state of the optional address, spent, timestamp and block filter indexes.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"name\": {                (json object) One entry per index, e.g. \"addressindex\"\n"
+            "    \"enabled\": true|false,   (boolean) Whether the index is maintained or being built\n"
+            "    \"synced\": true|false,    (boolean) Whether the index is maintained on block connection\n"
+            "    \"best_block_height\": n   (numeric) The height of the last block included, only while being built\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getindexinfo", "")
+            + HelpExampleRpc("getindexinfo", "")
+        );
+
+    UniValue result(UniValue::VOBJ);
+    for (const auto& info : GetOptionalIndexInfo()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("enabled", info.fEnabled));
+        obj.push_back(Pair("synced", info.fEnabled && !info.fBuilding));
+        if (info.fBuilding) {
+            obj.push_back(Pair("best_block_height", info.nBuiltHeight));
+        }
+        result.push_back(Pair(info.strName, obj));
+    }
+    return result;
+}
+
+UniValue getblocktimings(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "getblocktimings ( count )\n"
+            "\nReturns the time spent in each stage of connecting the last blocks to the active chain, in microseconds.\n"
+            "Only blocks connected since startup are kept, up to " + std::to_string(MAX_BLOCK_CONNECT_TIMINGS) + ".\n"
+            "\nArguments:\n"
+            "1. count       (numeric, optional, default=1) The number of blocks to return, newest first\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"hash\": \"hash\",                 (string) The block hash\n"
+            "    \"height\": n,                    (numeric) The block height\n"
+            "    \"txs\": n,                       (numeric) The number of transactions\n"
+            "    \"inputs\": n,                    (numeric) The number of transaction inputs\n"
+            "    \"read_from_disk\": n,            (numeric) Reading the block from disk, 0 if it was passed in\n"
+            "    \"sanity_checks\": n,             (numeric) Checks before the transactions are connected\n"
+            "    \"fork_checks\": n,               (numeric) BIP30 and deployment checks\n"
+            "    \"coins_prefetch\": n,            (numeric) Reading the spent coins from disk ahead of time\n"
+            "    \"connect_txs\": n,               (numeric) Connecting the transactions to the UTXO set\n"
+            "    \"verify_scripts\": n,            (numeric) Waiting for the script checks to finish\n"
+            "    \"instantsend_filter\": n,        (numeric) Checking for conflicts with InstantSend locks\n"
+            "    \"subsidy\": n,                   (numeric) Calculating the block subsidy\n"
+            "    \"block_value\": n,               (numeric) Checking the block value, including superblocks\n"
+            "    \"block_payee\": n,               (numeric) Checking the masternode and superblock payments\n"
+            "    \"special_txs\": n,               (numeric) Checking and processing the special transactions\n"
+            "    \"quorum_block_processor\": n,    (numeric) Processing the mined quorum commitments\n"
+            "    \"deterministic_mns\": n,         (numeric) Building the new masternode list\n"
+            "    \"cbtx_merkle_roots\": n,         (numeric) Checking the merkle roots in the coinbase\n"
+            "    \"index_writing\": n,             (numeric) Writing undo data and indexes\n"
+            "    \"callbacks\": n,                 (numeric) Final callbacks when connecting the block\n"
+            "    \"flush\": n,                     (numeric) Flushing the coins view and evo DB transaction of the block\n"
+            "    \"write_chainstate\": n,          (numeric) Flushing the chainstate to disk, if needed\n"
+            "    \"post_connect\": n,              (numeric) Updating the mempool and the tip\n"
+            "    \"total\": n                      (numeric) Total time spent\n"
+            "  },\n"
+            "  ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblocktimings", "10")
+            + HelpExampleRpc("getblocktimings", "10")
+        );
+
+    int nCount = 1;
+    if (request.params.size() > 0) {
+        nCount = request.params[0].get_int();
+        if (nCount < 1) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid count");
+        }
+    }
+
+    UniValue result(UniValue::VARR);
+    for (const auto& t : GetBlockConnectTimings(nCount)) {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("hash", t.blockHash.GetHex()));
+        obj.push_back(Pair("height", t.nHeight));
+        obj.push_back(Pair("txs", (uint64_t)t.nTxs));
+        obj.push_back(Pair("inputs", t.nInputs));
+        obj.push_back(Pair("read_from_disk", t.nTimeReadFromDisk));
+        obj.push_back(Pair("sanity_checks", t.nTimeSanity));
+        obj.push_back(Pair("fork_checks", t.nTimeForks));
+        obj.push_back(Pair("coins_prefetch", t.nTimeCoinsPrefetch));
+        obj.push_back(Pair("connect_txs", t.nTimeConnectTxs));
+        obj.push_back(Pair("verify_scripts", t.nTimeVerifyScripts));
+        obj.push_back(Pair("instantsend_filter", t.nTimeISFilter));
+        obj.push_back(Pair("subsidy", t.nTimeSubsidy));
+        obj.push_back(Pair("block_value", t.nTimeBlockValue));
+        obj.push_back(Pair("block_payee", t.nTimeBlockPayee));
+        obj.push_back(Pair("special_txs", t.nTimeSpecialTxs));
+        obj.push_back(Pair("quorum_block_processor", t.nTimeQuorumBlockProcessor));
+        obj.push_back(Pair("deterministic_mns", t.nTimeDeterministicMNs));
+        obj.push_back(Pair("cbtx_merkle_roots", t.nTimeCbTxMerkleRoots));
+        obj.push_back(Pair("index_writing", t.nTimeIndex));
+        obj.push_back(Pair("callbacks", t.nTimeCallbacks));
+        obj.push_back(Pair("flush", t.nTimeFlush));
+        obj.push_back(Pair("write_chainstate", t.nTimeChainState));
+        obj.push_back(Pair("post_connect", t.nTimePostConnect));
+        obj.push_back(Pair("total", t.nTimeTotal));
+        result.push_back(obj);
+    }
+    return result;
+}
+
 UniValue getchaintips(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() > 2)
@@ -1758,12 +2050,15 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       true,  {} },
     { "blockchain",         "getblockcount",          &getblockcount,          true,  {} },
     { "blockchain",         "getblock",               &getblock,               true,  {"blockhash","verbosity|verbose"} },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         true,  {"blockhash"} },
     { "blockchain",         "getblockhashes",         &getblockhashes,         true,  {"high","low"} },
     { "blockchain",         "getblockhash",           &getblockhash,           true,  {"height"} },
     { "blockchain",         "getblockheader",         &getblockheader,         true,  {"blockhash","verbose"} },
     { "blockchain",         "getblockheaders",        &getblockheaders,        true,  {"blockhash","count","verbose"} },
+    { "blockchain",         "getblocktimings",        &getblocktimings,        true,  {"count"} },
     { "blockchain",         "getchaintips",           &getchaintips,           true,  {"count","branchlen"} },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true,  {} },
+    { "blockchain",         "getindexinfo",           &getindexinfo,           true,  {} },
     { "blockchain",         "getmempoolancestors",    &getmempoolancestors,    true,  {"txid","verbose"} },
     { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  true,  {"txid","verbose"} },
     { "blockchain",         "getmempoolentry",        &getmempoolentry,        true,  {"txid"} },
@@ -1772,8 +2067,10 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getspecialtxes",         &getspecialtxes,         true,  {"blockhash", "type", "count", "skip", "verbosity"} },
     { "blockchain",         "gettxout",               &gettxout,               true,  {"txid","n","include_mempool"} },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  {} },
+    { "blockchain",         "dumpsnapshot",           &dumpsnapshot,           true,  {"path"} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        true,  {"height"} },
     { "blockchain",         "verifychain",            &verifychain,            true,  {"checklevel","nblocks"} },
+    { "blockchain",         "verifysnapshot",         &verifysnapshot,         true,  {"path","hash"} },
 
     { "blockchain",         "preciousblock",          &preciousblock,          true,  {"blockhash"} },
 
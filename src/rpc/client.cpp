@@ -61,6 +61,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getbalance", 1, "minconf" },
     { "getbalance", 2, "addlockconf" },
     { "getbalance", 3, "include_watchonly" },
+    { "getblocktimings", 0, "count" },
     { "getchaintips", 0, "count" },
     { "getchaintips", 1, "branchlen" },
     { "getblockhash", 0, "height" },
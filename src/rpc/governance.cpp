@@ -9,6 +9,7 @@
 #include "governance-classes.h"
 #include "governance-validators.h"
 #include "init.h"
+#include "ipfs-pinning.h"
 #include "validation.h"
 #include "masternode-sync.h"
 #include "messagesigner.h"
@@ -16,6 +17,7 @@
 #include "rpc/server.h"
 #include "util.h"
 #include "utilmoneystr.h"
+#include "workerpool.h"
 #include "wallet/rpcwallet.h" 
 #ifdef ENABLE_WALLET
 #include "wallet/wallet.h"
@@ -504,41 +506,76 @@ UniValue VoteWithMasternodes(const std::map<uint256, CKey>& keys,
 
     UniValue resultsObj(UniValue::VOBJ);
 
+    std::vector<uint256> vecProTxHashes;
+    std::vector<const CKey*> vecKeys;
+    std::vector<CGovernanceVote> vecVotes;
     for (const auto& p : keys) {
         const auto& proTxHash = p.first;
-        const auto& key = p.second;
-
-        UniValue statusObj(UniValue::VOBJ);
 
         auto dmn = mnList.GetValidMN(proTxHash);
         if (!dmn) {
             nFailed++;
+            UniValue statusObj(UniValue::VOBJ);
             statusObj.push_back(Pair("result", "failed"));
             statusObj.push_back(Pair("errorMessage", "Can't find masternode by proTxHash"));
             resultsObj.push_back(Pair(proTxHash.ToString(), statusObj));
             continue;
         }
 
-        CGovernanceVote vote(dmn->collateralOutpoint, hash, eVoteSignal, eVoteOutcome);
-        if (!vote.Sign(key, key.GetPubKey().GetID())) {
+        vecProTxHashes.emplace_back(proTxHash);
+        vecKeys.emplace_back(&p.second);
+        vecVotes.emplace_back(dmn->collateralOutpoint, hash, eVoteSignal, eVoteOutcome);
+    }
+
+    // the votes are signed independently, so spread them over the worker pool. The current thread signs its share too
+    std::vector<char> vecSigned(vecVotes.size(), 0);
+    size_t nJobs = std::min(vecVotes.size(), (size_t)g_workerPool.Size() + 1);
+    auto signVotes = [&](size_t nStart) {
+        for (size_t i = nStart; i < vecVotes.size(); i += nJobs) {
+            vecSigned[i] = vecVotes[i].Sign(*vecKeys[i], vecKeys[i]->GetPubKey().GetID());
+        }
+    };
+    std::vector<std::future<void>> futures;
+    for (size_t i = 1; i < nJobs; i++) {
+        futures.emplace_back(g_workerPool.Push([&signVotes, i](int threadId) {
+            signVotes(i);
+        }));
+    }
+    if (nJobs != 0) {
+        signVotes(0);
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
+
+    std::vector<CGovernanceVote> vecSignedVotes;
+    std::vector<uint256> vecSignedProTxHashes;
+    for (size_t i = 0; i < vecVotes.size(); i++) {
+        if (!vecSigned[i]) {
             nFailed++;
+            UniValue statusObj(UniValue::VOBJ);
             statusObj.push_back(Pair("result", "failed"));
             statusObj.push_back(Pair("errorMessage", "Failure to sign."));
-            resultsObj.push_back(Pair(proTxHash.ToString(), statusObj));
+            resultsObj.push_back(Pair(vecProTxHashes[i].ToString(), statusObj));
             continue;
         }
+        vecSignedVotes.emplace_back(std::move(vecVotes[i]));
+        vecSignedProTxHashes.emplace_back(vecProTxHashes[i]);
+    }
 
-        CGovernanceException exception;
-        if (governance.ProcessVoteAndRelay(vote, exception, *g_connman)) {
+    std::vector<CGovernanceException> vecExceptions;
+    std::vector<bool> vecAccepted = governance.ProcessLocalVotesAndRelay(vecSignedVotes, vecExceptions, *g_connman);
+    for (size_t i = 0; i < vecSignedVotes.size(); i++) {
+        UniValue statusObj(UniValue::VOBJ);
+        if (vecAccepted[i]) {
             nSuccessful++;
             statusObj.push_back(Pair("result", "success"));
         } else {
             nFailed++;
             statusObj.push_back(Pair("result", "failed"));
-            statusObj.push_back(Pair("errorMessage", exception.GetMessage()));
+            statusObj.push_back(Pair("errorMessage", vecExceptions[i].GetMessage()));
         }
-
-        resultsObj.push_back(Pair(proTxHash.ToString(), statusObj));
+        resultsObj.push_back(Pair(vecSignedProTxHashes[i].ToString(), statusObj));
     }
 
     UniValue returnObj(UniValue::VOBJ);
@@ -672,79 +709,200 @@ UniValue gobject_vote_alias(const JSONRPCRequest& request)
 }
 #endif
 
-UniValue ListObjects(const std::string& strCachedSignal, const std::string& strType, int nStartTime)
+static const int DEFAULT_GOBJECT_LIST_PAGE_SIZE = 100;
+static const int MAX_GOBJECT_LIST_PAGE_SIZE = 1000;
+
+struct gobject_list_options_t {
+    bool fPaged = false;
+    int nCount = DEFAULT_GOBJECT_LIST_PAGE_SIZE;
+    int64_t nCursorTime = 0;
+    uint256 nCursorHash;
+    std::string strCID;
+    std::set<std::string> setFields;
+
+    bool HasField(const std::string& strField) const
+    {
+        return setFields.empty() || setFields.count(strField);
+    }
+};
+
+static std::string EncodeListCursor(const CGovernanceObject& govobj)
+{
+    return strprintf("%d-%s", govobj.GetCreationTime(), govobj.GetHash().ToString());
+}
+
+static gobject_list_options_t ParseListOptions(const UniValue& param)
+{
+    gobject_list_options_t options;
+    if (param.isNull()) {
+        return options;
+    }
+
+    UniValue obj(UniValue::VOBJ);
+    if (param.isStr()) {
+        // gobject subcommands get their arguments as strings from historia-cli
+        if (!obj.read(param.get_str()) || !obj.isObject()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid options, should be a JSON object");
+        }
+    } else {
+        obj = param.get_obj();
+    }
+    RPCTypeCheckObj(obj,
+        {
+            {"count", UniValueType(UniValue::VNUM)},
+            {"cursor", UniValueType(UniValue::VSTR)},
+            {"cid", UniValueType(UniValue::VSTR)},
+            {"fields", UniValueType(UniValue::VARR)},
+        },
+        true, true);
+
+    options.fPaged = true;
+    if (!obj["count"].isNull()) {
+        options.nCount = obj["count"].get_int();
+        if (options.nCount < 1 || options.nCount > MAX_GOBJECT_LIST_PAGE_SIZE) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Invalid count, should be between 1 and %d", MAX_GOBJECT_LIST_PAGE_SIZE));
+        }
+    }
+    if (!obj["cursor"].isNull()) {
+        const std::string& strCursor = obj["cursor"].get_str();
+        size_t nPos = strCursor.find('-');
+        std::string strHash = nPos == std::string::npos ? "" : strCursor.substr(nPos + 1);
+        if (nPos == std::string::npos || !ParseInt64(strCursor.substr(0, nPos), &options.nCursorTime) || strHash.size() != 64 || !IsHex(strHash)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        options.nCursorHash = uint256S(strHash);
+    }
+    if (!obj["cid"].isNull()) {
+        options.strCID = obj["cid"].get_str();
+    }
+    if (!obj["fields"].isNull()) {
+        for (const auto& field : obj["fields"].getValues()) {
+            options.setFields.insert(field.get_str());
+        }
+    }
+    return options;
+}
+
+static UniValue ListObjectEntry(const CGovernanceObject* pGovObj, const gobject_list_options_t& options)
+{
+    UniValue bObj(UniValue::VOBJ);
+    if (options.HasField("DataHex")) bObj.push_back(Pair("DataHex",  pGovObj->GetDataAsHexString()));
+    if (options.HasField("DataString")) bObj.push_back(Pair("DataString",  pGovObj->GetDataAsPlainString()));
+    if (options.HasField("Hash")) bObj.push_back(Pair("Hash",  pGovObj->GetHash().ToString()));
+    if (options.HasField("CollateralHash")) bObj.push_back(Pair("CollateralHash",  pGovObj->GetCollateralHash().ToString()));
+    if (options.HasField("ObjectType")) bObj.push_back(Pair("ObjectType", pGovObj->GetObjectType()));
+    if (options.HasField("CreationTime")) bObj.push_back(Pair("CreationTime", pGovObj->GetCreationTime()));
+    const COutPoint& masternodeOutpoint = pGovObj->GetMasternodeOutpoint();
+    if (masternodeOutpoint != COutPoint() && options.HasField("SigningMasternode")) {
+        bObj.push_back(Pair("SigningMasternode", masternodeOutpoint.ToStringShort()));
+    }
+
+    // REPORT STATUS FOR FUNDING VOTES SPECIFICALLY
+    if (options.HasField("AbsoluteYesCount")) bObj.push_back(Pair("AbsoluteYesCount",  pGovObj->GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING)));
+    if (options.HasField("YesCount")) bObj.push_back(Pair("YesCount",  pGovObj->GetYesCount(VOTE_SIGNAL_FUNDING)));
+    if (options.HasField("NoCount")) bObj.push_back(Pair("NoCount",  pGovObj->GetNoCount(VOTE_SIGNAL_FUNDING)));
+    if (options.HasField("AbstainCount")) bObj.push_back(Pair("AbstainCount",  pGovObj->GetAbstainCount(VOTE_SIGNAL_FUNDING)));
+
+    // REPORT VALIDITY AND CACHING FLAGS FOR VARIOUS SETTINGS
+    if (options.HasField("fBlockchainValidity") || options.HasField("IsValidReason")) {
+        std::string strError = "";
+        bool fValid = pGovObj->IsValidLocally(strError, false);
+        if (options.HasField("fBlockchainValidity")) bObj.push_back(Pair("fBlockchainValidity",  fValid));
+        if (options.HasField("IsValidReason")) bObj.push_back(Pair("IsValidReason",  strError.c_str()));
+    }
+    if (options.HasField("fCachedValid")) bObj.push_back(Pair("fCachedValid",  pGovObj->IsSetCachedValid()));
+    if (options.HasField("fCachedFunding")) bObj.push_back(Pair("fCachedFunding",  pGovObj->IsSetCachedFunding()));
+    if (options.HasField("fCachedLocked")) bObj.push_back(Pair("fCachedLocked",  pGovObj->IsSetRecordLocked()));
+    if (options.HasField("fPermLocked")) bObj.push_back(Pair("fPermLocked", pGovObj->IsSetPermLocked()));
+    if (options.HasField("fCachedDelete")) bObj.push_back(Pair("fCachedDelete",  pGovObj->IsSetCachedDelete()));
+    if (options.HasField("fCachedEndorsed")) bObj.push_back(Pair("fCachedEndorsed",  pGovObj->IsSetCachedEndorsed()));
+
+    return bObj;
+}
+
+UniValue ListObjects(const std::string& strCachedSignal, const std::string& strType, int nStartTime, const gobject_list_options_t& options = gobject_list_options_t())
 {
     UniValue objResult(UniValue::VOBJ);
 
     // GET MATCHING GOVERNANCE OBJECTS
 
+    // Only one page is built per call so governance.cs is never held for the whole list
     LOCK2(cs_main, governance.cs);
 
-    std::vector<const CGovernanceObject*> objs = governance.GetAllNewerThan(nStartTime);
-    governance.UpdateLastDiffTime(GetTime());
+    int nObjectType = GOVERNANCE_OBJECT_UNKNOWN;
+    if (strType == "proposals") nObjectType = GOVERNANCE_OBJECT_PROPOSAL;
+    if (strType == "records") nObjectType = GOVERNANCE_OBJECT_RECORD;
+    if (strType == "triggers") nObjectType = GOVERNANCE_OBJECT_TRIGGER;
+
+    auto filter = [&](const CGovernanceObject& govobj) {
+        if (strCachedSignal == "valid" && !govobj.IsSetCachedValid()) return false;
+        if (strCachedSignal == "locked" && !govobj.IsSetRecordLocked()) return false;
+        if (strCachedSignal == "delete" && !govobj.IsSetCachedDelete()) return false;
+        if (strCachedSignal == "endorsed" && !govobj.IsSetCachedEndorsed()) return false;
+        if (!options.strCID.empty() && govobj.GetPayload()->strIPFSCID != options.strCID) return false;
+        return true;
+    };
 
-    // CREATE RESULTS FOR USER
+    // Unpaged requests keep returning everything, as before
+    int64_t nCursorTime = options.nCursorHash.IsNull() ? nStartTime : std::max<int64_t>(nStartTime, options.nCursorTime);
+    size_t nMaxCount = options.fPaged ? options.nCount : std::numeric_limits<size_t>::max();
+    bool fMore = false;
+    std::vector<const CGovernanceObject*> objs = governance.GetPageNewerThan(nCursorTime, options.nCursorHash, nMaxCount, nObjectType, strCachedSignal == "funding", filter, fMore);
 
-    for (const auto& pGovObj : objs) {
-        if (strCachedSignal == "valid" && !pGovObj->IsSetCachedValid()) continue;
-        if (strCachedSignal == "funding" && !pGovObj->IsSetCachedFunding()) continue;
-        if (strCachedSignal == "locked" && !pGovObj->IsSetRecordLocked()) continue;
-        if (strCachedSignal == "delete" && !pGovObj->IsSetCachedDelete()) continue;
-        if (strCachedSignal == "endorsed" && !pGovObj->IsSetCachedEndorsed()) continue;
-
-        if (strType == "proposals" && pGovObj->GetObjectType() != GOVERNANCE_OBJECT_PROPOSAL) continue;
-        if (strType == "records" && pGovObj->GetObjectType() != GOVERNANCE_OBJECT_RECORD) continue;
-        if (strType == "triggers" && pGovObj->GetObjectType() != GOVERNANCE_OBJECT_TRIGGER) continue;
-
-        UniValue bObj(UniValue::VOBJ);
-        bObj.push_back(Pair("DataHex",  pGovObj->GetDataAsHexString()));
-        bObj.push_back(Pair("DataString",  pGovObj->GetDataAsPlainString()));
-        bObj.push_back(Pair("Hash",  pGovObj->GetHash().ToString()));
-        bObj.push_back(Pair("CollateralHash",  pGovObj->GetCollateralHash().ToString()));
-        bObj.push_back(Pair("ObjectType", pGovObj->GetObjectType()));
-        bObj.push_back(Pair("CreationTime", pGovObj->GetCreationTime()));
-        const COutPoint& masternodeOutpoint = pGovObj->GetMasternodeOutpoint();
-        if (masternodeOutpoint != COutPoint()) {
-            bObj.push_back(Pair("SigningMasternode", masternodeOutpoint.ToStringShort()));
-        }
+    // A diff is only complete once its last page was fetched
+    if (!fMore) {
+        governance.UpdateLastDiffTime(GetTime());
+    }
 
-        // REPORT STATUS FOR FUNDING VOTES SPECIFICALLY
-        bObj.push_back(Pair("AbsoluteYesCount",  pGovObj->GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING)));
-        bObj.push_back(Pair("YesCount",  pGovObj->GetYesCount(VOTE_SIGNAL_FUNDING)));
-        bObj.push_back(Pair("NoCount",  pGovObj->GetNoCount(VOTE_SIGNAL_FUNDING)));
-        bObj.push_back(Pair("AbstainCount",  pGovObj->GetAbstainCount(VOTE_SIGNAL_FUNDING)));
+    // CREATE RESULTS FOR USER
 
-        // REPORT VALIDITY AND CACHING FLAGS FOR VARIOUS SETTINGS
-        std::string strError = "";
-        bObj.push_back(Pair("fBlockchainValidity",  pGovObj->IsValidLocally(strError, false)));
-        bObj.push_back(Pair("IsValidReason",  strError.c_str()));
-        bObj.push_back(Pair("fCachedValid",  pGovObj->IsSetCachedValid()));
-        bObj.push_back(Pair("fCachedFunding",  pGovObj->IsSetCachedFunding()));
-        bObj.push_back(Pair("fCachedLocked",  pGovObj->IsSetRecordLocked()));
-        bObj.push_back(Pair("fPermLocked", pGovObj->IsSetPermLocked()));
-        bObj.push_back(Pair("fCachedDelete",  pGovObj->IsSetCachedDelete()));
-        bObj.push_back(Pair("fCachedEndorsed",  pGovObj->IsSetCachedEndorsed()));
+    for (const auto& pGovObj : objs) {
+        objResult.push_back(Pair(pGovObj->GetHash().ToString(), ListObjectEntry(pGovObj, options)));
+    }
 
-        objResult.push_back(Pair(pGovObj->GetHash().ToString(), bObj));
+    if (!options.fPaged) {
+        return objResult;
     }
 
-    return objResult;
+    UniValue pageResult(UniValue::VOBJ);
+    pageResult.push_back(Pair("objects", objResult));
+    if (fMore) {
+        pageResult.push_back(Pair("next", EncodeListCursor(*objs.back())));
+    } else {
+        pageResult.push_back(Pair("next", NullUniValue));
+    }
+    return pageResult;
 }
 
+static const std::string strListOptionsHelp =
+                "3. options  (json object, optional) return one page of objects instead of the full list\n"
+                "    {\n"
+                "      \"count\": n,             (numeric, optional, default=" + std::to_string(DEFAULT_GOBJECT_LIST_PAGE_SIZE) + ") maximum number of objects, at most " + std::to_string(MAX_GOBJECT_LIST_PAGE_SIZE) + "\n"
+                "      \"cursor\": \"str\",        (string, optional) value of \"next\" from the previous page\n"
+                "      \"cid\": \"str\",           (string, optional) only objects referencing this IPFS CID\n"
+                "      \"fields\": [\"str\",...]   (array, optional) only include these fields for each object\n"
+                "    }\n"
+                "\nResult with options:\n"
+                "{\n"
+                "  \"objects\": { ... },     (json object) matching objects keyed by hash, sorted by creation time\n"
+                "  \"next\": \"str\"           (string) cursor for the next page, null on the last page\n"
+                "}\n";
+
 void gobject_list_help()
 {
     throw std::runtime_error(
-                "gobject list ( <signal> <type> )\n"
+                "gobject list ( <signal> <type> <options> )\n"
                 "List governance objects (can be filtered by signal and/or object type)\n"
                 "\nArguments:\n"
                 "1. signal   (string, optional, default=valid) cached signal, possible values: [valid|funding|delete|endorsed|all]\n"
                 "2. type     (string, optional, default=all) object type, possible values: [proposals|triggers|all]\n"
+                + strListOptionsHelp
                 );
 }
 
 UniValue gobject_list(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() > 3)
+    if (request.fHelp || request.params.size() > 4)
         gobject_list_help();
 
     std::string strCachedSignal = "valid";
@@ -753,27 +911,30 @@ UniValue gobject_list(const JSONRPCRequest& request)
         return "Invalid signal, should be 'valid', 'funding', 'delete', 'endorsed' or 'all'";
 
     std::string strType = "all";
-    if (request.params.size() == 3) strType = request.params[2].get_str();
+    if (request.params.size() >= 3) strType = request.params[2].get_str();
     if (strType != "proposals" && strType != "records" && strType != "triggers" && strType != "all")
         return "Invalid type, should be 'proposals', 'triggers' or 'all'";
 
-    return ListObjects(strCachedSignal, strType, 0);
+    gobject_list_options_t options = ParseListOptions(request.params.size() == 4 ? request.params[3] : NullUniValue);
+
+    return ListObjects(strCachedSignal, strType, 0, options);
 }
 
 void gobject_diff_help()
 {
     throw std::runtime_error(
-                "gobject diff ( <signal> <type> )\n"
+                "gobject diff ( <signal> <type> <options> )\n"
                 "List differences since last diff or list\n"
                 "\nArguments:\n"
                 "1. signal   (string, optional, default=valid) cached signal, possible values: [valid|funding|delete|endorsed|all]\n"
                 "2. type     (string, optional, default=all) object type, possible values: [proposals|triggers|all]\n"
+                + strListOptionsHelp
                 );
 }
 
 UniValue gobject_diff(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() > 3)
+    if (request.fHelp || request.params.size() > 4)
         gobject_diff_help();
 
     std::string strCachedSignal = "valid";
@@ -782,11 +943,73 @@ UniValue gobject_diff(const JSONRPCRequest& request)
         return "Invalid signal, should be 'valid', 'funding', 'delete', 'endorsed' or 'all'";
 
     std::string strType = "all";
-    if (request.params.size() == 3) strType = request.params[2].get_str();
+    if (request.params.size() >= 3) strType = request.params[2].get_str();
     if (strType != "proposals" && strType != "triggers" && strType != "all")
         return "Invalid type, should be 'proposals', 'triggers' or 'all'";
 
-    return ListObjects(strCachedSignal, strType, governance.GetLastDiffTime());
+    gobject_list_options_t options = ParseListOptions(request.params.size() == 4 ? request.params[3] : NullUniValue);
+
+    return ListObjects(strCachedSignal, strType, governance.GetLastDiffTime(), options);
+}
+
+void gobject_search_help()
+{
+    throw std::runtime_error(
+                "gobject search \"query\" ( <type> <options> )\n"
+                "Search the names and descriptions of governance proposals and records, requires -govsearchindex\n"
+                "Objects match if they have, for every word of the query, a word starting with it, ignoring case.\n"
+                "\nArguments:\n"
+                "1. query    (string, required) words to search for\n"
+                "2. type     (string, optional, default=all) object type, possible values: [proposals|records|all]\n"
+                + strListOptionsHelp +
+                "\nWithout options the first page with the default count is returned.\n"
+                );
+}
+
+UniValue gobject_search(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 2 || request.params.size() > 4)
+        gobject_search_help();
+
+    if (!governance.IsSearchIndexEnabled())
+        throw JSONRPCError(RPC_MISC_ERROR, "The search index is disabled, restart with -govsearchindex");
+
+    std::string strQuery = request.params[1].get_str();
+
+    std::string strType = "all";
+    if (request.params.size() >= 3) strType = request.params[2].get_str();
+    if (strType != "proposals" && strType != "records" && strType != "all")
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid type, should be 'proposals', 'records' or 'all'");
+
+    int nObjectType = GOVERNANCE_OBJECT_UNKNOWN;
+    if (strType == "proposals") nObjectType = GOVERNANCE_OBJECT_PROPOSAL;
+    if (strType == "records") nObjectType = GOVERNANCE_OBJECT_RECORD;
+
+    gobject_list_options_t options = ParseListOptions(request.params.size() == 4 ? request.params[3] : NullUniValue);
+
+    auto filter = [&](const CGovernanceObject& govobj) {
+        return options.strCID.empty() || govobj.GetPayload()->strIPFSCID == options.strCID;
+    };
+
+    // fBlockchainValidity checks the collateral
+    LOCK2(cs_main, governance.cs);
+
+    bool fMore = false;
+    std::vector<const CGovernanceObject*> objs = governance.SearchPage(strQuery, nObjectType, options.nCursorTime, options.nCursorHash, options.nCount, filter, fMore);
+
+    UniValue objResult(UniValue::VOBJ);
+    for (const auto& pGovObj : objs) {
+        objResult.push_back(Pair(pGovObj->GetHash().ToString(), ListObjectEntry(pGovObj, options)));
+    }
+
+    UniValue pageResult(UniValue::VOBJ);
+    pageResult.push_back(Pair("objects", objResult));
+    if (fMore) {
+        pageResult.push_back(Pair("next", EncodeListCursor(*objs.back())));
+    } else {
+        pageResult.push_back(Pair("next", NullUniValue));
+    }
+    return pageResult;
 }
 
 void gobject_get_help()
@@ -928,6 +1151,33 @@ UniValue gobject_getcurrentvotes(const JSONRPCRequest& request)
     return bResult;
 }
 
+void gobject_pinstatus_help()
+{
+    throw std::runtime_error(
+                "gobject pinstatus ( \"ipfscid\" )\n"
+                "Show the IPFS pinning status of governance records and proposals (masternode only)\n"
+                "\nArguments:\n"
+                "1. \"ipfscid\"   (string, optional) Only show the status of this IPFS CID\n"
+                );
+}
+
+UniValue gobject_pinstatus(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 2)
+        gobject_pinstatus_help();
+
+    if (request.params.size() == 1) {
+        return ipfsPinManager.ToJson();
+    }
+
+    std::string strCID = request.params[1].get_str();
+    CIPFSPinEntry entry;
+    if (!ipfsPinManager.GetEntry(strCID, entry)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown IPFS CID");
+    }
+    return entry.ToJson();
+}
+
 [[ noreturn ]] void gobject_help()
 {
     throw std::runtime_error(
@@ -943,8 +1193,10 @@ UniValue gobject_getcurrentvotes(const JSONRPCRequest& request)
             "  count              - Count governance objects and votes (additional param: 'json' or 'all', default: 'json')\n"
             "  get                - Get governance object by hash\n"
             "  getcurrentvotes    - Get only current (tallying) votes for a governance object hash (does not include old votes)\n"
+            "  pinstatus          - Show IPFS pinning status of governance objects (masternode only)\n"
             "  list               - List governance objects (can be filtered by signal and/or object type)\n"
             "  diff               - List differences since last diff\n"
+            "  search             - Search the names and descriptions of proposals and records\n"
 #ifdef ENABLE_WALLET
             "  vote-alias         - Vote on a governance object by masternode proTxHash\n"
 #endif // ENABLE_WALLET
@@ -999,12 +1251,16 @@ UniValue gobject(const JSONRPCRequest& request)
         return gobject_list(request);
     } else if (strCommand == "diff") {
         return gobject_diff(request);
+    } else if (strCommand == "search") {
+        return gobject_search(request);
     } else if (strCommand == "get") {
         // GET SPECIFIC GOVERNANCE ENTRY
         return gobject_get(request);
     } else if (strCommand == "getcurrentvotes") {
         // GET VOTES FOR SPECIFIC GOVERNANCE OBJECT
         return gobject_getcurrentvotes(request);
+    } else if (strCommand == "pinstatus") {
+        return gobject_pinstatus(request);
     } else {
         gobject_help();
     }
@@ -6,6 +6,7 @@
 #include "base58.h"
 #include "clientversion.h"
 #include "init.h"
+#include "ipfs-health.h"
 #include "netbase.h"
 #include "validation.h"
 #include "masternode-payments.h"
@@ -370,6 +371,7 @@ UniValue masternode_status(const JSONRPCRequest& request)
     }
     mnObj.push_back(Pair("state", activeMasternodeManager->GetStateString()));
     mnObj.push_back(Pair("status", activeMasternodeManager->GetStatus()));
+    mnObj.push_back(Pair("ipfs", ipfsHealthMonitor.ToJson()));
 
     return mnObj;
 }
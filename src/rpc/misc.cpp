@@ -6,15 +6,18 @@
 
 #include "base58.h"
 #include "clientversion.h"
+#include "dbwrapper.h"
 #include "init.h"
 #include "net.h"
 #include "netbase.h"
 #include "rpc/server.h"
+#include "scheduler.h"
 #include "timedata.h"
 #include "txmempool.h"
 #include "util.h"
 #include "utilstrencodings.h"
 #include "validation.h"
+#include "workerpool.h"
 #ifdef ENABLE_WALLET
 #include "wallet/rpcwallet.h"
 #include "wallet/wallet.h"
@@ -24,6 +27,9 @@
 #include "masternode-sync.h"
 #include "spork.h"
 
+#include "evo/deterministicmns.h"
+#include "evo/simplifiedmns.h"
+
 #include <stdint.h>
 
 #include <boost/assign/list_of.hpp>
@@ -682,6 +688,58 @@ bool getAddressesFromParams(const UniValue& params, std::vector<std::pair<uint16
     return true;
 }
 
+// Reads the optional "limit" and "cursor" fields, which page through the index of a single address
+bool getAddressIndexPageFromParams(const UniValue& params, const std::vector<std::pair<uint160, int> > &addresses,
+                                   size_t &limit, bool &fHaveCursor, CAddressIndexKey &cursor)
+{
+    limit = 0;
+    fHaveCursor = false;
+    if (!params[0].isObject()) {
+        return false;
+    }
+
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    UniValue cursorValue = find_value(params[0].get_obj(), "cursor");
+    if (limitValue.isNull() && cursorValue.isNull()) {
+        return false;
+    }
+    if (addresses.size() != 1) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "limit and cursor are only supported for a single address");
+    }
+    if (!limitValue.isNum() || limitValue.get_int() <= 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "limit is expected to be a positive number");
+    }
+    limit = (size_t)limitValue.get_int();
+
+    if (!cursorValue.isNull()) {
+        if (!cursorValue.isStr() || !IsHex(cursorValue.get_str())) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "cursor is expected to be a hex string");
+        }
+        CDataStream ss(ParseHex(cursorValue.get_str()), SER_DISK, CLIENT_VERSION);
+        try {
+            ss >> cursor;
+        } catch (const std::exception&) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        if (cursor.type != (unsigned int)addresses[0].second || cursor.hashBytes != addresses[0].first) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "cursor does not belong to this address");
+        }
+        fHaveCursor = true;
+    }
+    return true;
+}
+
+// The cursor to pass for the next page, or null if the last page was returned
+UniValue getAddressIndexNextCursor(const std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, size_t limit)
+{
+    if (addressIndex.empty() || addressIndex.size() < limit) {
+        return NullUniValue;
+    }
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << addressIndex.back().first;
+    return HexStr(ss.begin(), ss.end());
+}
+
 bool heightSort(std::pair<CAddressUnspentKey, CAddressUnspentValue> a,
                 std::pair<CAddressUnspentKey, CAddressUnspentValue> b) {
     return a.second.blockHeight < b.second.blockHeight;
@@ -845,6 +903,8 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Return at most this many deltas of a single address\n"
+            "  \"cursor\" (string, optional) Continue after the page which returned this cursor\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -857,8 +917,14 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "    \"address\"  (string) The base58check encoded address\n"
             "  }\n"
             "]\n"
+            "\nResult (when limit is given):\n"
+            "{\n"
+            "  \"deltas\"  (array) The deltas as above\n"
+            "  \"cursor\"  (string) Pass this to get the next page, null if there are no more deltas\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"Hc6hWnwf45zkM888Qi4VP2vRcwFveHGRT4\"]}'")
+            + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"Hc6hWnwf45zkM888Qi4VP2vRcwFveHGRT4\"], \"limit\": 1000}'")
             + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"Hc6hWnwf45zkM888Qi4VP2vRcwFveHGRT4\"]}")
         );
 
@@ -883,15 +949,20 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    size_t limit;
+    bool fHaveCursor;
+    CAddressIndexKey cursor;
+    bool fPaged = getAddressIndexPageFromParams(request.params, addresses, limit, fHaveCursor, cursor);
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
         if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
+            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end, limit, fHaveCursor ? &cursor : nullptr)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
         } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, 0, 0, limit, fHaveCursor ? &cursor : nullptr)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
         }
@@ -915,6 +986,13 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         result.push_back(delta);
     }
 
+    if (fPaged) {
+        UniValue page(UniValue::VOBJ);
+        page.push_back(Pair("deltas", result));
+        page.push_back(Pair("cursor", getAddressIndexNextCursor(addressIndex, limit)));
+        return page;
+    }
+
     return result;
 }
 
@@ -936,6 +1014,7 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
             "{\n"
             "  \"balance\"  (string) The current balance in duffs\n"
             "  \"received\"  (string) The total number of duffs received (including change)\n"
+            "  \"txcount\"  (number) The number of transactions involving the address, counted for every address given\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressbalance", "'{\"addresses\": [\"Hc6hWnwf45zkM888Qi4VP2vRcwFveHGRT4\"]}'")
@@ -948,27 +1027,53 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    CAmount balance = 0;
+    CAmount received = 0;
+    int64_t txCount = 0;
 
+    // the balance table has the sums of the address index entries, they are only summed up here
+    // while it's being built after an upgrade
+    bool fHaveBalances = true;
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        CAddressBalance addressBalance;
+        if (!GetAddressBalance((*it).first, (*it).second, addressBalance)) {
+            fHaveBalances = false;
+            break;
         }
+        balance += addressBalance.balance;
+        received += addressBalance.received;
+        txCount += addressBalance.txCount;
     }
 
-    CAmount balance = 0;
-    CAmount received = 0;
+    if (!fHaveBalances) {
+        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        if (it->second > 0) {
-            received += it->second;
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+        }
+
+        balance = 0;
+        received = 0;
+        txCount = 0;
+        uint256 lastTxHash;
+        for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
+            if (it->second > 0) {
+                received += it->second;
+            }
+            balance += it->second;
+            if (it->first.txhash != lastTxHash) {
+                txCount++;
+                lastTxHash = it->first.txhash;
+            }
         }
-        balance += it->second;
     }
 
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("balance", balance));
     result.push_back(Pair("received", received));
+    result.push_back(Pair("txcount", txCount));
 
     return result;
 
@@ -989,14 +1094,22 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Scan at most this many index entries of a single address\n"
+            "  \"cursor\" (string, optional) Continue after the page which returned this cursor\n"
             "}\n"
             "\nResult:\n"
             "[\n"
             "  \"transactionid\"  (string) The transaction id\n"
             "  ,...\n"
             "]\n"
+            "\nResult (when limit is given):\n"
+            "{\n"
+            "  \"txids\"  (array) The txids as above, a txid can be repeated on the next page\n"
+            "  \"cursor\"  (string) Pass this to get the next page, null if there are no more entries\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"Hc6hWnwf45zkM888Qi4VP2vRcwFveHGRT4\"]}'")
+            + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"Hc6hWnwf45zkM888Qi4VP2vRcwFveHGRT4\"], \"limit\": 1000}'")
             + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"Hc6hWnwf45zkM888Qi4VP2vRcwFveHGRT4\"]}")
         );
 
@@ -1017,15 +1130,20 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
         }
     }
 
+    size_t limit;
+    bool fHaveCursor;
+    CAddressIndexKey cursor;
+    bool fPaged = getAddressIndexPageFromParams(request.params, addresses, limit, fHaveCursor, cursor);
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
         if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
+            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end, limit, fHaveCursor ? &cursor : nullptr)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
         } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, 0, 0, limit, fHaveCursor ? &cursor : nullptr)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
         }
@@ -1053,6 +1171,13 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
         }
     }
 
+    if (fPaged) {
+        UniValue page(UniValue::VOBJ);
+        page.push_back(Pair("txids", result));
+        page.push_back(Pair("cursor", getAddressIndexNextCursor(addressIndex, limit)));
+        return page;
+    }
+
     return result;
 
 }
@@ -1135,6 +1260,28 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
             "    \"locked\": xxxxxx,       (numeric) Amount of bytes that succeeded locking. If this number is smaller than total, locking pages failed at some point and key data could be swapped to disk.\n"
             "    \"chunks_used\": xxxxx,   (numeric) Number allocated chunks\n"
             "    \"chunks_free\": xxxxx,   (numeric) Number unused chunks\n"
+            "  },\n"
+            "  \"dmn\": {                  (json object) Information about cached deterministic masternode structures, in bytes\n"
+            "    \"recentLists\": xxxxx,   (numeric) Lists of the most recent blocks (-dmnlistcachedepth)\n"
+            "    \"historicalLists\": xxxxx, (numeric) Lists of older blocks, MNs shared with recent lists are not counted again\n"
+            "    \"sharedObjects\": xxxxx, (numeric) Number of distinct MN and state objects referenced by these lists\n"
+            "    \"total\": xxxxx,         (numeric) Total of the two above\n"
+            "    \"historicalLimit\": xxxxx, (numeric) Limit for historical lists (-dmncachemb)\n"
+            "    \"smlMerkleCache\": xxxxx (numeric) Cached simplified MN list and its merkle tree\n"
+            "  },\n"
+            "  \"leveldb\": {              (json object) The open databases by name, see -dbprofile\n"
+            "    \"name\": {\n"
+            "      \"cache\": xxxxx,        (numeric) Cache size in bytes\n"
+            "      \"blockcache\": n,       (numeric) Percentage of the cache used for the block cache\n"
+            "      \"filterbits\": n,       (numeric) Bloom filter bits per key, 0 for none\n"
+            "      \"compression\": true|false, (boolean) Whether tables are compressed\n"
+            "      \"blocksize\": xxxxx,    (numeric) Size of the table blocks in bytes\n"
+            "      \"memory\": xxxxx,       (numeric) Memory used by the memtables and the block cache\n"
+            "      \"files\": n,            (numeric) Number of table files\n"
+            "      \"reads\": n,            (numeric) Number of point reads\n"
+            "      \"readsfound\": n,       (numeric) Number of point reads which found the key\n"
+            "      \"bytesread\": xxxxx     (numeric) Total size of the values read\n"
+            "    }, ...\n"
             "  }\n"
             "}\n"
             "\nExamples:\n"
@@ -1143,6 +1290,132 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
         );
     UniValue obj(UniValue::VOBJ);
     obj.push_back(Pair("locked", RPCLockedMemoryInfo()));
+    if (deterministicMNManager) {
+        UniValue dmnObj;
+        deterministicMNManager->GetMemoryUsage(dmnObj);
+        dmnObj.push_back(Pair("smlMerkleCache", (int64_t)smlMerkleCache.DynamicMemoryUsage()));
+        obj.push_back(Pair("dmn", dmnObj));
+    }
+    UniValue dbObj(UniValue::VOBJ);
+    for (const CDBStats& stats : CDBWrapper::GetAllStats()) {
+        UniValue statsObj(UniValue::VOBJ);
+        statsObj.push_back(Pair("cache", (int64_t)stats.nCacheSize));
+        statsObj.push_back(Pair("blockcache", stats.profile.nBlockCachePercent));
+        statsObj.push_back(Pair("filterbits", stats.profile.nFilterBits));
+        statsObj.push_back(Pair("compression", stats.profile.fCompression));
+        statsObj.push_back(Pair("blocksize", (int64_t)stats.profile.nBlockSize));
+        statsObj.push_back(Pair("memory", (int64_t)stats.nMemoryUsage));
+        statsObj.push_back(Pair("files", (int64_t)stats.nFiles));
+        statsObj.push_back(Pair("reads", (int64_t)stats.readStats.nReads));
+        statsObj.push_back(Pair("readsfound", (int64_t)stats.readStats.nReadsFound));
+        statsObj.push_back(Pair("bytesread", (int64_t)stats.readStats.nBytesRead));
+        dbObj.push_back(Pair(stats.strName, statsObj));
+    }
+    obj.push_back(Pair("leveldb", dbObj));
+    return obj;
+}
+
+UniValue getworkerinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getworkerinfo\n"
+            "Returns the utilization of the worker threads shared by BLS, LLMQ, governance and ProTx signature jobs (-workerthreads).\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"threads\": n,           (numeric) Number of worker threads\n"
+            "  \"busy\": n,              (numeric) Number of threads currently running a job\n"
+            "  \"utilization\": x.xxx,   (numeric) Fraction of the thread time spent in jobs since startup\n"
+            "  \"stolen\": n,            (numeric) Number of jobs a thread took from the queue of another one\n"
+            "  \"high\": {               (json object) Latency sensitive jobs, e.g. LLMQ signature shares and islocks\n"
+            "    \"queued\": n,          (numeric) Number of jobs waiting for a thread\n"
+            "    \"completed\": n        (numeric) Number of jobs run since startup\n"
+            "  },\n"
+            "  \"normal\": { ... },      (json object) Same for BLS and DKG jobs\n"
+            "  \"low\": { ... }          (json object) Same for governance vote and ProTx signature precaching jobs\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getworkerinfo", "")
+            + HelpExampleRpc("getworkerinfo", "")
+        );
+
+    CWorkerPool::Stats stats = g_workerPool.GetStats();
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("threads", stats.nThreads));
+    obj.push_back(Pair("busy", stats.nBusyThreads));
+    double dUtilization = 0;
+    if (stats.nThreads != 0 && stats.nUptimeMicros != 0) {
+        dUtilization = (double)stats.nBusyMicros / ((double)stats.nUptimeMicros * stats.nThreads);
+    }
+    obj.push_back(Pair("utilization", dUtilization));
+    obj.push_back(Pair("stolen", stats.nStolen));
+    const char* priorityNames[CWorkerPool::PRIORITY_COUNT] = {"high", "normal", "low"};
+    for (int i = 0; i < CWorkerPool::PRIORITY_COUNT; i++) {
+        UniValue priorityObj(UniValue::VOBJ);
+        priorityObj.push_back(Pair("queued", stats.vQueued[i]));
+        priorityObj.push_back(Pair("completed", stats.vCompleted[i]));
+        obj.push_back(Pair(priorityNames[i], priorityObj));
+    }
+    return obj;
+}
+
+UniValue getschedulerinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getschedulerinfo\n"
+            "Returns the queue of the task scheduler (-schedulerthreads) and run time statistics of its tasks.\n"
+            "Histograms count the runs by duration, in buckets of <1ms, <10ms, <100ms, <1s, <10s and longer.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"queued\": n,                (numeric) Number of tasks waiting to run\n"
+            "  \"tasks\": {\n"
+            "    \"name\": {                 (json object) Tasks of this name, e.g. chainlocks or governance\n"
+            "      \"priority\": \"xxx\",      (string) high, normal or low\n"
+            "      \"runs\": n,              (numeric) Number of runs since startup\n"
+            "      \"avgruntime\": n,        (numeric) Average run time in microseconds\n"
+            "      \"maxruntime\": n,        (numeric) Longest run time in microseconds\n"
+            "      \"avglateness\": n,       (numeric) Average time between the scheduled and the actual start in microseconds\n"
+            "      \"maxlateness\": n,       (numeric) Largest lateness in microseconds\n"
+            "      \"runtimes\": [ n, ... ], (array) Histogram of the run times\n"
+            "      \"lateness\": [ n, ... ]  (array) Histogram of the lateness\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getschedulerinfo", "")
+            + HelpExampleRpc("getschedulerinfo", "")
+        );
+
+    if (!g_scheduler)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Scheduler not running");
+
+    boost::chrono::system_clock::time_point first, last;
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("queued", (uint64_t)g_scheduler->getQueueInfo(first, last)));
+
+    const char* priorityNames[CScheduler::PRIORITY_COUNT] = {"high", "normal", "low"};
+    UniValue tasksObj(UniValue::VOBJ);
+    for (const auto& p : g_scheduler->getTaskStats()) {
+        const CScheduler::TaskStats& stats = p.second;
+        UniValue taskObj(UniValue::VOBJ);
+        taskObj.push_back(Pair("priority", priorityNames[stats.priority]));
+        taskObj.push_back(Pair("runs", stats.nRuns));
+        taskObj.push_back(Pair("avgruntime", stats.nRuns ? stats.nTotalRunMicros / (int64_t)stats.nRuns : 0));
+        taskObj.push_back(Pair("maxruntime", stats.nMaxRunMicros));
+        taskObj.push_back(Pair("avglateness", stats.nRuns ? stats.nTotalLateMicros / (int64_t)stats.nRuns : 0));
+        taskObj.push_back(Pair("maxlateness", stats.nMaxLateMicros));
+        UniValue runArr(UniValue::VARR);
+        UniValue lateArr(UniValue::VARR);
+        for (int i = 0; i < CScheduler::HISTOGRAM_BUCKETS; i++) {
+            runArr.push_back(stats.vRunHistogram[i]);
+            lateArr.push_back(stats.vLateHistogram[i]);
+        }
+        taskObj.push_back(Pair("runtimes", runArr));
+        taskObj.push_back(Pair("lateness", lateArr));
+        tasksObj.push_back(Pair(p.first, taskObj));
+    }
+    obj.push_back(Pair("tasks", tasksObj));
     return obj;
 }
 
@@ -1165,6 +1438,8 @@ static const CRPCCommand commands[] =
     { "control",            "debug",                  &debug,                  true,  {} },
     { "control",            "getinfo",                &getinfo,                true,  {} }, /* uses wallet if enabled */
     { "control",            "getmemoryinfo",          &getmemoryinfo,          true,  {} },
+    { "control",            "getworkerinfo",          &getworkerinfo,          true,  {} },
+    { "control",            "getschedulerinfo",       &getschedulerinfo,       true,  {} },
     { "util",               "validateaddress",        &validateaddress,        true,  {"address"} }, /* uses wallet if enabled */
     { "util",               "createmultisig",         &createmultisig,         true,  {"nrequired","keys"} },
     { "util",               "verifymessage",          &verifymessage,          true,  {"address","signature","message"} },
@@ -66,6 +66,31 @@ UniValue ping(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+static UniValue ProcessingStatsToJSON(const mapMsgCmdProcessingStats& mapStats)
+{
+    UniValue ret(UniValue::VOBJ);
+    for (const auto& p : mapStats) {
+        const CMessageProcessingStats& stats = p.second;
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("count", stats.nCount));
+        obj.push_back(Pair("bytes", stats.nBytes));
+        obj.push_back(Pair("time_us", stats.nTimeMicros));
+        obj.push_back(Pair("time_max_us", stats.nMaxTimeMicros));
+        obj.push_back(Pair("queuedelay_us", stats.nQueueDelayMicros));
+        obj.push_back(Pair("queuedelay_max_us", stats.nMaxQueueDelayMicros));
+        UniValue timeHistogram(UniValue::VARR);
+        UniValue delayHistogram(UniValue::VARR);
+        for (int i = 0; i < CMessageProcessingStats::HISTOGRAM_BUCKETS; i++) {
+            timeHistogram.push_back(stats.vTimeHistogram[i]);
+            delayHistogram.push_back(stats.vQueueDelayHistogram[i]);
+        }
+        obj.push_back(Pair("time_histogram", timeHistogram));
+        obj.push_back(Pair("queuedelay_histogram", delayHistogram));
+        ret.push_back(Pair(p.first, obj));
+    }
+    return ret;
+}
+
 UniValue getpeerinfo(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0)
@@ -109,6 +134,13 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
             "    \"bytesrecv_per_msg\": {\n"
             "       \"addr\": n,              (numeric) The total bytes received aggregated by message type\n"
             "       ...\n"
+            "    },\n"
+            "    \"processqueue_msgs\": n,    (numeric) The number of received messages waiting to be processed\n"
+            "    \"processqueue_bytes\": n,   (numeric) The size of the received messages waiting to be processed\n"
+            "    \"lanequeue_msgs\": n,       (numeric) The number of messages queued for the governance, PrivateSend and LLMQ threads\n"
+            "    \"processing_per_msg\": {\n"
+            "       \"addr\": {...},          (json object) The processing statistics of the message type, as in getnettotals\n"
+            "       ...\n"
             "    }\n"
             "  }\n"
             "  ,...\n"
@@ -182,6 +214,11 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
         }
         obj.push_back(Pair("bytesrecv_per_msg", recvPerMsgCmd));
 
+        obj.push_back(Pair("processqueue_msgs", (uint64_t)stats.nProcessQueueMsgs));
+        obj.push_back(Pair("processqueue_bytes", (uint64_t)stats.nProcessQueueSize));
+        obj.push_back(Pair("lanequeue_msgs", (uint64_t)GetLaneQueueSize(stats.nodeid)));
+        obj.push_back(Pair("processing_per_msg", ProcessingStatsToJSON(stats.mapProcessingStatsPerMsgCmd)));
+
         ret.push_back(obj);
     }
 
@@ -344,6 +381,24 @@ UniValue getnettotals(const JSONRPCRequest& request)
             "    \"serve_historical_blocks\": true|false,  (boolean) True if serving historical blocks\n"
             "    \"bytes_left_in_cycle\": t,               (numeric) Bytes left in current time cycle\n"
             "    \"time_left_in_cycle\": t                 (numeric) Seconds left in current time cycle\n"
+            "  },\n"
+            "  \"bytessent_per_msg\": {\n"
+            "     \"addr\": n,               (numeric) The total bytes sent to all peers aggregated by message type\n"
+            "     ...\n"
+            "  },\n"
+            "  \"processing_per_msg\":\n"
+            "  {\n"
+            "    \"command\":                  (string) The message command, only commands received so far are listed\n"
+            "    {\n"
+            "      \"count\": n,               (numeric) Number of messages processed\n"
+            "      \"bytes\": n,               (numeric) Total size of the messages\n"
+            "      \"time_us\": n,             (numeric) Total time spent processing them in microseconds\n"
+            "      \"time_max_us\": n,         (numeric) Longest time spent processing one of them in microseconds\n"
+            "      \"queuedelay_us\": n,       (numeric) Total time between receiving and processing them in microseconds\n"
+            "      \"queuedelay_max_us\": n,   (numeric) Longest time between receiving and processing one of them in microseconds\n"
+            "      \"time_histogram\": [...],  (array) Number of messages by processing time: <100us, <1ms, <10ms, <100ms, <1s, >=1s\n"
+            "      \"queuedelay_histogram\": [...]  (array) Number of messages by queue delay, same buckets as time_histogram\n"
+            "    }, ...\n"
             "  }\n"
             "}\n"
             "\nExamples:\n"
@@ -366,6 +421,13 @@ UniValue getnettotals(const JSONRPCRequest& request)
     outboundLimit.push_back(Pair("bytes_left_in_cycle", g_connman->GetOutboundTargetBytesLeft()));
     outboundLimit.push_back(Pair("time_left_in_cycle", g_connman->GetMaxOutboundTimeLeftInCycle()));
     obj.push_back(Pair("uploadtarget", outboundLimit));
+
+    UniValue sendPerMsgCmd(UniValue::VOBJ);
+    for (const auto& p : g_connman->GetTotalBytesSentPerMsgCmd()) {
+        sendPerMsgCmd.push_back(Pair(p.first, p.second));
+    }
+    obj.push_back(Pair("bytessent_per_msg", sendPerMsgCmd));
+    obj.push_back(Pair("processing_per_msg", ProcessingStatsToJSON(GetMessageProcessingStats())));
     return obj;
 }
 
@@ -21,8 +21,10 @@
 #include "script/script_error.h"
 #include "script/sign.h"
 #include "script/standard.h"
+#include "saltedhasher.h"
 #include "txmempool.h"
 #include "uint256.h"
+#include "unordered_lru_cache.h"
 #include "utilstrencodings.h"
 #include "instantx.h"
 #ifdef ENABLE_WALLET
@@ -38,6 +40,7 @@
 #include "llmq/quorums_commitment.h"
 #include "llmq/quorums_instantsend.h"
 
+#include <memory>
 #include <stdint.h>
 
 #include <boost/assign/list_of.hpp>
@@ -68,7 +71,8 @@ void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fInclud
     out.push_back(Pair("addresses", a));
 }
 
-void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
+// The part of TxToJSON which only depends on the tx, and on the spent index if enabled
+void TxDetailsToJSON(const CTransaction& tx, UniValue& entry)
 {
     uint256 txid = tx.GetHash();
     entry.push_back(Pair("txid", txid.GetHex()));
@@ -76,6 +80,25 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
     entry.push_back(Pair("version", tx.nVersion));
     entry.push_back(Pair("type", tx.nType));
     entry.push_back(Pair("locktime", (int64_t)tx.nLockTime));
+
+    // Look up the spent info of all inputs and outputs at once if spentindex is enabled
+    std::vector<CSpentIndexKey> vSpentKeys;
+    std::vector<CSpentIndexValue> vSpentInfo;
+    std::vector<bool> vSpentFound;
+    if (!tx.IsCoinBase()) {
+        for (const CTxIn& txin : tx.vin) {
+            vSpentKeys.emplace_back(txin.prevout.hash, txin.prevout.n);
+        }
+    }
+    for (unsigned int i = 0; i < tx.vout.size(); i++) {
+        vSpentKeys.emplace_back(txid, i);
+    }
+    if (!GetSpentIndexes(vSpentKeys, vSpentInfo, vSpentFound)) {
+        vSpentInfo.assign(vSpentKeys.size(), CSpentIndexValue());
+        vSpentFound.assign(vSpentKeys.size(), false);
+    }
+    size_t nSpentKey = 0;
+
     UniValue vin(UniValue::VARR);
     BOOST_FOREACH(const CTxIn& txin, tx.vin) {
         UniValue in(UniValue::VOBJ);
@@ -90,9 +113,8 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
             in.push_back(Pair("scriptSig", o));
 
             // Add address and value info if spentindex enabled
-            CSpentIndexValue spentInfo;
-            CSpentIndexKey spentKey(txin.prevout.hash, txin.prevout.n);
-            if (GetSpentIndex(spentKey, spentInfo)) {
+            const CSpentIndexValue& spentInfo = vSpentInfo[nSpentKey];
+            if (vSpentFound[nSpentKey++]) {
                 in.push_back(Pair("value", ValueFromAmount(spentInfo.satoshis)));
                 in.push_back(Pair("valueSat", spentInfo.satoshis));
                 if (spentInfo.addressType == 1) {
@@ -119,9 +141,8 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
         out.push_back(Pair("scriptPubKey", o));
 
         // Add spent information if spentindex is enabled
-        CSpentIndexValue spentInfo;
-        CSpentIndexKey spentKey(txid, i);
-        if (GetSpentIndex(spentKey, spentInfo)) {
+        const CSpentIndexValue& spentInfo = vSpentInfo[nSpentKey];
+        if (vSpentFound[nSpentKey++]) {
             out.push_back(Pair("spentTxId", spentInfo.txid.GetHex()));
             out.push_back(Pair("spentIndex", (int)spentInfo.inputIndex));
             out.push_back(Pair("spentHeight", spentInfo.blockHeight));
@@ -179,7 +200,11 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
             entry.push_back(Pair("qcTx", obj));
         }
     }
+}
 
+// The part of TxToJSON which depends on the active chain and the locks
+void TxStateToJSON(const uint256& txid, const uint256& hashBlock, UniValue& entry)
+{
     bool chainLock = false;
     if (!hashBlock.IsNull()) {
         entry.push_back(Pair("blockhash", hashBlock.GetHex()));
@@ -206,6 +231,16 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
     entry.push_back(Pair("chainlock", chainLock));
 }
 
+void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
+{
+    TxDetailsToJSON(tx, entry);
+    TxStateToJSON(tx.GetHash(), hashBlock, entry);
+}
+
+// Verbose getrawtransaction results of mined txes without the TxStateToJSON part, with the hash of their block.
+// Only valid while that block is in the active chain, which is checked on every hit. Protected by cs_main
+static unordered_lru_cache<uint256, std::pair<uint256, std::shared_ptr<const UniValue>>, StaticSaltedHasher, 2048> verboseTxCache;
+
 UniValue getrawtransaction(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
@@ -302,6 +337,23 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
         }
     }
 
+    // the cache is only used with -txindex, without it GetTransaction finds mined txes only while they have
+    // unspent outputs, and not with -spentindex as the spent info of the outputs changes all the time
+    bool fUseCache = fVerbose && fTxIndex && !fSpentIndex;
+    if (fUseCache) {
+        std::pair<uint256, std::shared_ptr<const UniValue>> cached;
+        if (verboseTxCache.get(hash, cached)) {
+            BlockMap::iterator mi = mapBlockIndex.find(cached.first);
+            if (mi != mapBlockIndex.end() && chainActive.Contains(mi->second)) {
+                UniValue result(*cached.second);
+                TxStateToJSON(hash, cached.first, result);
+                return result;
+            }
+            // reorged out
+            verboseTxCache.erase(hash);
+        }
+    }
+
     CTransactionRef tx;
     uint256 hashBlock;
     if (!GetTransaction(hash, tx, Params().GetConsensus(), hashBlock, true))
@@ -316,7 +368,14 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
 
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("hex", strHex));
-    TxToJSON(*tx, hashBlock, result);
+    TxDetailsToJSON(*tx, result);
+    if (fUseCache && !hashBlock.IsNull()) {
+        BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
+        if (mi != mapBlockIndex.end() && chainActive.Contains(mi->second)) {
+            verboseTxCache.insert(hash, std::make_pair(hashBlock, std::make_shared<const UniValue>(result)));
+        }
+    }
+    TxStateToJSON(hash, hashBlock, result);
     return result;
 }
 
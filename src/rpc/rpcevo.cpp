@@ -28,6 +28,8 @@
 
 #include "bls/bls.h"
 
+#include <boost/algorithm/string.hpp>
+
 #ifdef ENABLE_WALLET
 extern UniValue signrawtransaction(const JSONRPCRequest& request);
 extern UniValue sendrawtransaction(const JSONRPCRequest& request);
@@ -267,7 +269,7 @@ static void SignSpecialTxPayloadByHash(const CMutableTransaction& tx, SpecialTxP
     UpdateSpecialTxInputsHash(tx, payload);
 
     uint256 hash = ::SerializeHash(payload);
-    payload.sig = key.Sign(hash);
+    payload.sig.Set(key.Sign(hash));
 }
 
 static std::string SignAndSendSpecialTx(const CMutableTransaction& tx)
@@ -501,7 +503,7 @@ UniValue protx_register(const JSONRPCRequest& request)
     }
 
     ptx.keyIDOwner = keyOwner.GetPubKey().GetID();
-    ptx.pubKeyOperator = pubKeyOperator;
+    ptx.pubKeyOperator.Set(pubKeyOperator);
     ptx.keyIDVoting = keyIDVoting;
     ptx.scriptPayout = GetScriptForDestination(payoutAddress.Get());
     
@@ -770,14 +772,14 @@ UniValue protx_update_registrar(const JSONRPCRequest& request)
     if (!dmn) {
         throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("masternode %s not found", ptx.proTxHash.ToString()));
     }
-    ptx.pubKeyOperator = dmn->pdmnState->pubKeyOperator.Get();
+    ptx.pubKeyOperator = dmn->pdmnState->pubKeyOperator;
     ptx.keyIDVoting = dmn->pdmnState->keyIDVoting;
     ptx.scriptPayout = dmn->pdmnState->scriptPayout;
     ptx.IPFSPeerID = dmn->pdmnState->IPFSPeerID;
     ptx.Identity = dmn->pdmnState->Identity;
     
     if (request.params[2].get_str() != "") {
-        ptx.pubKeyOperator = ParseBLSPubKey(request.params[2].get_str(), "operator BLS address");
+        ptx.pubKeyOperator.Set(ParseBLSPubKey(request.params[2].get_str(), "operator BLS address"));
     }
     if (request.params[3].get_str() != "") {
         ptx.keyIDVoting = ParsePubKeyIDFromAddress(request.params[3].get_str(), "voting address");
@@ -904,11 +906,14 @@ UniValue protx_revoke(const JSONRPCRequest& request)
 void protx_list_help()
 {
     throw std::runtime_error(
-            "protx list (\"type\" \"detailed\" \"height\")\n"
+            "protx list (\"type\" \"detailed\" \"height\" \"fields\")\n"
+            "protx list changed \"baseBlock\" (\"detailed\" \"fields\")\n"
             "\nLists all ProTxs in your wallet or on-chain, depending on the given type.\n"
             "If \"type\" is not specified, it defaults to \"registered\".\n"
             "If \"detailed\" is not specified, it defaults to \"false\" and only the hashes of the ProTx will be returned.\n"
             "If \"height\" is not specified, it defaults to the current chain-tip.\n"
+            "\"fields\" is a comma separated list of the fields of detailed entries to return, nested fields of the state\n"
+            "are given as \"state.<field>\". If not specified, all fields are returned.\n"
             "\nAvailable types:\n"
             "  registered   - List all ProTx which are registered at the given chain height.\n"
             "                 This will also include ProTx which failed PoSe verfication.\n"
@@ -917,9 +922,56 @@ void protx_list_help()
             "  wallet       - List only ProTx which are found in your wallet at the given chain height.\n"
             "                 This will also include ProTx which failed PoSe verfication.\n"
 #endif
+            "  changed      - List only ProTx which were added, updated or removed between \"baseBlock\" and the chain-tip.\n"
+            "                 The result has the fields \"baseBlockHash\", \"blockHash\", \"height\", \"added\", \"updated\"\n"
+            "                 and \"removed\", removed ProTxs are always listed by hash.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("protx", "list valid true 100000 \"proTxHash,state.service,state.PoSePenalty\"")
+            + HelpExampleCli("protx", "list changed \"0123456701234567012345670123456701234567012345670123456701234567\" true")
     );
 }
 
+// Parses a comma separated field list, an empty set selects all fields
+static std::set<std::string> ParseDMNListFields(const UniValue& v)
+{
+    std::set<std::string> setFields;
+    std::vector<std::string> vecFields;
+    boost::split(vecFields, v.get_str(), boost::is_any_of(","));
+    for (auto& strField : vecFields) {
+        boost::trim(strField);
+        if (!strField.empty()) {
+            setFields.emplace(strField);
+        }
+    }
+    return setFields;
+}
+
+static bool IsDMNListFieldSelected(const std::set<std::string>& setFields, const std::string& strField)
+{
+    if (setFields.empty() || setFields.count(strField)) {
+        return true;
+    }
+    // "state" is selected as a whole if any of its fields is
+    auto it = setFields.lower_bound(strField + ".");
+    return it != setFields.end() && it->compare(0, strField.size() + 1, strField + ".") == 0;
+}
+
+static UniValue SelectDMNListFields(const UniValue& obj, const std::set<std::string>& setFields, const std::string& strPrefix = "")
+{
+    UniValue ret(UniValue::VOBJ);
+    const std::vector<std::string>& keys = obj.getKeys();
+    const std::vector<UniValue>& values = obj.getValues();
+    for (size_t i = 0; i < keys.size(); i++) {
+        std::string strField = strPrefix + keys[i];
+        if (setFields.count(strField)) {
+            ret.push_back(Pair(keys[i], values[i]));
+        } else if (values[i].isObject() && IsDMNListFieldSelected(setFields, strField)) {
+            ret.push_back(Pair(keys[i], SelectDMNListFields(values[i], setFields, strField + ".")));
+        }
+    }
+    return ret;
+}
+
 static bool CheckWalletOwnsKey(CWallet* pwallet, const CKeyID& keyID) {
 #ifndef ENABLE_WALLET
     return false;
@@ -949,7 +1001,7 @@ static bool CheckWalletOwnsScript(CWallet* pwallet, const CScript& script) {
 #endif
 }
 
-UniValue BuildDMNListEntry(CWallet* pwallet, const CDeterministicMNCPtr& dmn, bool detailed)
+UniValue BuildDMNListEntry(CWallet* pwallet, const CDeterministicMNCPtr& dmn, bool detailed, const std::set<std::string>& setFields = {})
 {
     if (!detailed) {
         return dmn->proTxHash.ToString();
@@ -959,8 +1011,15 @@ UniValue BuildDMNListEntry(CWallet* pwallet, const CDeterministicMNCPtr& dmn, bo
 
     dmn->ToJson(o);
 
-    int confirmations = GetUTXOConfirmations(dmn->collateralOutpoint);
-    o.push_back(Pair("confirmations", confirmations));
+    if (IsDMNListFieldSelected(setFields, "confirmations")) {
+        int confirmations = GetUTXOConfirmations(dmn->collateralOutpoint);
+        o.push_back(Pair("confirmations", confirmations));
+    }
+
+    // the wallet fields need a lookup of the collateral transaction, skip them if they are not wanted
+    if (!IsDMNListFieldSelected(setFields, "wallet")) {
+        return SelectDMNListFields(o, setFields);
+    }
 
     bool hasOwnerKey = CheckWalletOwnsKey(pwallet, dmn->pdmnState->keyIDOwner);
     bool hasOperatorKey = false; //CheckWalletOwnsKey(dmn->pdmnState->keyIDOperator);
@@ -982,6 +1041,9 @@ UniValue BuildDMNListEntry(CWallet* pwallet, const CDeterministicMNCPtr& dmn, bo
     walletObj.push_back(Pair("ownsOperatorRewardScript", CheckWalletOwnsScript(pwallet, dmn->pdmnState->scriptOperatorPayout)));
     o.push_back(Pair("wallet", walletObj));
 
+    if (!setFields.empty()) {
+        return SelectDMNListFields(o, setFields);
+    }
     return o;
 }
 
@@ -1013,11 +1075,12 @@ UniValue protx_list(const JSONRPCRequest& request)
 #ifdef ENABLE_WALLET
         LOCK2(cs_main, pwallet->cs_wallet);
 
-        if (request.params.size() > 3) {
+        if (request.params.size() > 5) {
             protx_list_help();
         }
 
         bool detailed = request.params.size() > 2 ? ParseBoolV(request.params[2], "detailed") : false;
+        std::set<std::string> setFields = request.params.size() > 4 ? ParseDMNListFields(request.params[4]) : std::set<std::string>();
 
         int height = request.params.size() > 3 ? ParseInt32V(request.params[3], "height") : chainActive.Height();
         if (height < 1 || height > chainActive.Height()) {
@@ -1038,18 +1101,19 @@ UniValue protx_list(const JSONRPCRequest& request)
                 CheckWalletOwnsKey(pwallet, dmn->pdmnState->keyIDVoting) ||
                 CheckWalletOwnsScript(pwallet, dmn->pdmnState->scriptPayout) ||
                 CheckWalletOwnsScript(pwallet, dmn->pdmnState->scriptOperatorPayout)) {
-                ret.push_back(BuildDMNListEntry(pwallet, dmn, detailed));
+                ret.push_back(BuildDMNListEntry(pwallet, dmn, detailed, setFields));
             }
         });
 #endif
     } else if (type == "valid" || type == "registered") {
-        if (request.params.size() > 4) {
+        if (request.params.size() > 5) {
             protx_list_help();
         }
 
         LOCK(cs_main);
 
         bool detailed = request.params.size() > 2 ? ParseBoolV(request.params[2], "detailed") : false;
+        std::set<std::string> setFields = request.params.size() > 4 ? ParseDMNListFields(request.params[4]) : std::set<std::string>();
 
         int height = request.params.size() > 3 ? ParseInt32V(request.params[3], "height") : chainActive.Height();
         if (height < 1 || height > chainActive.Height()) {
@@ -1059,8 +1123,54 @@ UniValue protx_list(const JSONRPCRequest& request)
         CDeterministicMNList mnList = deterministicMNManager->GetListForBlock(chainActive[height]);
         bool onlyValid = type == "valid";
         mnList.ForEachMN(onlyValid, [&](const CDeterministicMNCPtr& dmn) {
-            ret.push_back(BuildDMNListEntry(pwallet, dmn, detailed));
+            ret.push_back(BuildDMNListEntry(pwallet, dmn, detailed, setFields));
         });
+    } else if (type == "changed") {
+        if (request.params.size() < 3 || request.params.size() > 5) {
+            protx_list_help();
+        }
+
+        uint256 baseBlockHash = ParseHashV(request.params[2], "baseBlock");
+        bool detailed = request.params.size() > 3 ? ParseBoolV(request.params[3], "detailed") : false;
+        std::set<std::string> setFields = request.params.size() > 4 ? ParseDMNListFields(request.params[4]) : std::set<std::string>();
+
+        auto it = mapBlockIndex.find(baseBlockHash);
+        if (it == mapBlockIndex.end()) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        }
+
+        // only the entries which differ between both lists are built, unchanged MNs are shared by both lists
+        CDeterministicMNList baseList = deterministicMNManager->GetListForBlock(it->second);
+        CDeterministicMNList tipList = deterministicMNManager->GetListForBlock(chainActive.Tip());
+        CDeterministicMNListDiff diff = baseList.BuildDiff(tipList);
+
+        UniValue added(UniValue::VARR);
+        for (const auto& dmn : diff.addedMNs) {
+            added.push_back(BuildDMNListEntry(pwallet, dmn, detailed, setFields));
+        }
+        UniValue updated(UniValue::VARR);
+        for (const auto& p : diff.updatedMNs) {
+            auto dmn = tipList.GetMNByInternalId(p.first);
+            if (dmn) {
+                updated.push_back(BuildDMNListEntry(pwallet, dmn, detailed, setFields));
+            }
+        }
+        UniValue removed(UniValue::VARR);
+        for (const auto& id : diff.removedMns) {
+            auto dmn = baseList.GetMNByInternalId(id);
+            if (dmn) {
+                removed.push_back(dmn->proTxHash.ToString());
+            }
+        }
+
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("baseBlockHash", baseBlockHash.ToString()));
+        obj.push_back(Pair("blockHash", chainActive.Tip()->GetBlockHash().ToString()));
+        obj.push_back(Pair("height", chainActive.Height()));
+        obj.push_back(Pair("added", added));
+        obj.push_back(Pair("updated", updated));
+        obj.push_back(Pair("removed", removed));
+        return obj;
     } else {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "invalid type specified");
     }
@@ -1104,6 +1214,38 @@ UniValue protx_info(const JSONRPCRequest& request)
     return BuildDMNListEntry(pwallet, dmn, true);
 }
 
+void protx_resolve_help()
+{
+    throw std::runtime_error(
+            "protx resolve \"identity\"\n"
+            "\nReturns the deterministic masternode registered with an identity at the chain tip.\n"
+            "The identity is matched ignoring case.\n"
+            "\nArguments:\n"
+            "1. \"identity\"            (string, required) The identity of the masternode.\n"
+            "\nResult:\n"
+            "{                             (json object) Details about the deterministic masternode\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("protx", "resolve \"mn1.historia.network\"")
+    );
+}
+
+UniValue protx_resolve(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 2) {
+        protx_resolve_help();
+    }
+
+    std::string strIdentity = request.params[1].get_str();
+    auto dmn = deterministicMNManager->ResolveIdentity(strIdentity);
+    if (!dmn) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("%s not found", strIdentity));
+    }
+    UniValue ret(UniValue::VOBJ);
+    dmn->ToJson(ret);
+    return ret;
+}
+
 void protx_diff_help()
 {
     throw std::runtime_error(
@@ -1150,6 +1292,38 @@ UniValue protx_diff(const JSONRPCRequest& request)
     return ret;
 }
 
+void protx_cachestats_help()
+{
+    throw std::runtime_error(
+            "protx cachestats\n"
+            "\nReturns statistics about the cache of deterministic masternode lists.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"depth\": n,                (numeric) Number of recent blocks for which lists are always kept\n"
+            "  \"recentLists\": n,          (numeric) Number of cached lists of recent blocks\n"
+            "  \"historicalLists\": n,      (numeric) Number of cached lists of older blocks\n"
+            "  \"historicalUsage\": n,      (numeric) Estimated memory used by the older lists in bytes\n"
+            "  \"historicalMaxUsage\": n,   (numeric) Memory limit for the older lists in bytes\n"
+            "  \"hits\": n,                 (numeric) Lookups answered from the cache\n"
+            "  \"misses\": n,               (numeric) Lookups which had to read from disk\n"
+            "  \"diffsApplied\": n          (numeric) Diffs applied to rebuild lists on misses\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("protx", "cachestats")
+    );
+}
+
+UniValue protx_cachestats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1) {
+        protx_cachestats_help();
+    }
+
+    UniValue ret;
+    deterministicMNManager->GetCacheStats(ret);
+    return ret;
+}
+
 [[ noreturn ]] void protx_help()
 {
     throw std::runtime_error(
@@ -1167,12 +1341,14 @@ UniValue protx_diff(const JSONRPCRequest& request)
 #endif
             "  list              - List ProTxs\n"
             "  info              - Return information about a ProTx\n"
+            "  resolve           - Return the ProTx registered with an identity\n"
 #ifdef ENABLE_WALLET
             "  update_service    - Create and send ProUpServTx to network\n"
             "  update_registrar  - Create and send ProUpRegTx to network\n"
             "  revoke            - Create and send ProUpRevTx to network\n"
 #endif
             "  diff              - Calculate a diff and a proof between two masternode lists\n"
+            "  cachestats        - Return statistics about the masternode list cache\n"
     );
 }
 
@@ -1204,8 +1380,12 @@ UniValue protx(const JSONRPCRequest& request)
         return protx_list(request);
     } else if (command == "info") {
         return protx_info(request);
+    } else if (command == "resolve") {
+        return protx_resolve(request);
     } else if (command == "diff") {
         return protx_diff(request);
+    } else if (command == "cachestats") {
+        return protx_cachestats(request);
     } else {
         protx_help();
     }
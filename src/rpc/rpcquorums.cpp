@@ -10,7 +10,10 @@
 #include "llmq/quorums_blockprocessor.h"
 #include "llmq/quorums_debug.h"
 #include "llmq/quorums_dkgsession.h"
+#include "llmq/quorums_instantsend.h"
 #include "llmq/quorums_signing.h"
+#include "llmq/quorums_signing_shares.h"
+#include "llmq/quorums_stats.h"
 
 void quorum_list_help()
 {
@@ -103,7 +106,7 @@ UniValue BuildQuorumInfo(const llmq::CQuorumCPtr& quorum, bool includeMembers, b
 
         ret.push_back(Pair("members", membersArr));
     }
-    ret.push_back(Pair("quorumPublicKey", quorum->qc.quorumPublicKey.ToString()));
+    ret.push_back(Pair("quorumPublicKey", quorum->qc.quorumPublicKey.Get().ToString()));
     CBLSSecretKey skShare = quorum->GetSkShare();
     if (includeSkShare && skShare.IsValid()) {
         ret.push_back(Pair("secretKeyShare", skShare.ToString()));
@@ -189,6 +192,84 @@ UniValue quorum_dkgstatus(const JSONRPCRequest& request)
     return ret;
 }
 
+void quorum_stats_help()
+{
+    throw std::runtime_error(
+            "quorum stats\n"
+            "Return the queue depths and latency statistics of signing sessions since startup.\n"
+            "Histograms count the measurements by duration, in buckets of <1ms, <10ms, <100ms, <1s, <10s and longer.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"pending\": {                 (json object) Number of queued items\n"
+            "    \"sigshares\": n,            (numeric) Incoming sig shares waiting for verification\n"
+            "    \"signs\": n,                (numeric) Own sig shares waiting to be signed\n"
+            "    \"recsigs\": n,              (numeric) Recovered sigs waiting for verification\n"
+            "    \"islocks\": n,              (numeric) ISLOCKs waiting for verification\n"
+            "    \"inputlockedtxs\": n        (numeric) TXs with all inputs locked waiting for their ISLOCK to be signed\n"
+            "  },\n"
+            "  \"llmqName\": {                (json object) Statistics of this LLMQ type\n"
+            "    \"metric\": {                (json object) One of signtorecsig, sigsharesverify, sigrecovery, recsigsverify and islocksverify\n"
+            "      \"count\": n,              (numeric) Number of measurements, e.g. verified batches\n"
+            "      \"avgtime\": n,            (numeric) Average duration in microseconds\n"
+            "      \"maxtime\": n,            (numeric) Longest duration in microseconds\n"
+            "      \"avgitems\": n,           (numeric) Average number of items per measurement, e.g. sig shares per batch\n"
+            "      \"maxitems\": n,           (numeric) Largest number of items per measurement\n"
+            "      \"histogram\": [ n, ... ]  (array) Histogram of the durations\n"
+            "    }, ...\n"
+            "  }, ...\n"
+            "}\n"
+    );
+}
+
+UniValue quorum_stats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1) {
+        quorum_stats_help();
+    }
+
+    UniValue ret(UniValue::VOBJ);
+
+    size_t nSigShares, nSigns, nISLocks, nInputLockedTxs;
+    llmq::quorumSigSharesManager->GetPendingCounts(nSigShares, nSigns);
+    llmq::quorumInstantSendManager->GetPendingCounts(nISLocks, nInputLockedTxs);
+    UniValue pendingObj(UniValue::VOBJ);
+    pendingObj.push_back(Pair("sigshares", (uint64_t)nSigShares));
+    pendingObj.push_back(Pair("signs", (uint64_t)nSigns));
+    pendingObj.push_back(Pair("recsigs", (uint64_t)llmq::quorumSigningManager->GetPendingRecoveredSigsCount()));
+    pendingObj.push_back(Pair("islocks", (uint64_t)nISLocks));
+    pendingObj.push_back(Pair("inputlockedtxs", (uint64_t)nInputLockedTxs));
+    ret.push_back(Pair("pending", pendingObj));
+
+    for (const auto& p : llmq::quorumStats.GetStats()) {
+        auto it = Params().GetConsensus().llmqs.find(p.first);
+        if (it == Params().GetConsensus().llmqs.end()) {
+            continue;
+        }
+        UniValue llmqObj(UniValue::VOBJ);
+        for (int i = 0; i < llmq::CLLMQStats::METRIC_COUNT; i++) {
+            const llmq::CLLMQStats::Stats& stats = p.second[i];
+            if (stats.nCount == 0) {
+                continue;
+            }
+            UniValue metricObj(UniValue::VOBJ);
+            metricObj.push_back(Pair("count", stats.nCount));
+            metricObj.push_back(Pair("avgtime", stats.nTotalMicros / (int64_t)stats.nCount));
+            metricObj.push_back(Pair("maxtime", stats.nMaxMicros));
+            metricObj.push_back(Pair("avgitems", stats.nTotalItems / stats.nCount));
+            metricObj.push_back(Pair("maxitems", stats.nMaxItems));
+            UniValue histArr(UniValue::VARR);
+            for (int j = 0; j < llmq::CLLMQStats::HISTOGRAM_BUCKETS; j++) {
+                histArr.push_back(stats.vHistogram[j]);
+            }
+            metricObj.push_back(Pair("histogram", histArr));
+            llmqObj.push_back(Pair(llmq::CLLMQStats::metricNames[i], metricObj));
+        }
+        ret.push_back(Pair(it->second.name, llmqObj));
+    }
+
+    return ret;
+}
+
 void quorum_memberof_help()
 {
     throw std::runtime_error(
@@ -386,6 +467,7 @@ UniValue quorum_dkgsimerror(const JSONRPCRequest& request)
             "  info              - Return information about a quorum\n"
             "  dkgsimerror       - Simulates DKG errors and malicious behavior.\n"
             "  dkgstatus         - Return the status of the current DKG process\n"
+            "  stats             - Return queue depths and latency statistics of signing sessions\n"
             "  memberof          - Checks which quorums the given masternode is a member of\n"
             "  sign              - Threshold-sign a message\n"
             "  hasrecsig         - Test if a valid recovered signature is present\n"
@@ -411,6 +493,8 @@ UniValue quorum(const JSONRPCRequest& request)
         return quorum_info(request);
     } else if (command == "dkgstatus") {
         return quorum_dkgstatus(request);
+    } else if (command == "stats") {
+        return quorum_stats(request);
     } else if (command == "memberof") {
         return quorum_memberof(request);
     } else if (command == "sign" || command == "hasrecsig" || command == "getrecsig" || command == "isconflicting") {
@@ -7,6 +7,7 @@
 #include "rpc/server.h"
 
 #include "base58.h"
+#include "httpserver.h"
 #include "init.h"
 #include "random.h"
 #include "sync.h"
@@ -14,6 +15,8 @@
 #include "util.h"
 #include "utilstrencodings.h"
 
+#include "ctpl.h"
+
 #include <univalue.h>
 
 #include <boost/bind.hpp>
@@ -27,7 +30,9 @@
 #include <boost/algorithm/string/split.hpp>
 
 #include <algorithm>
+#include <future>
 #include <memory> // for unique_ptr
+#include <set>
 #include <unordered_map>
 
 static bool fRPCRunning = false;
@@ -316,6 +321,48 @@ UniValue stop(const JSONRPCRequest& jsonRequest)
     return "Historia Core server stopping";
 }
 
+UniValue getrpcinfo(const JSONRPCRequest& jsonRequest)
+{
+    if (jsonRequest.fHelp || jsonRequest.params.size() != 0)
+        throw std::runtime_error(
+            "getrpcinfo\n"
+            "\nReturns the limits and queue statistics of the classes of RPC calls, in order of priority.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"class\": \"name\",        (string) The class of calls, see -rpcworkclass\n"
+            "    \"maxthreads\": n,          (numeric) Maximum number of calls of this class running at the same time\n"
+            "    \"maxdepth\": n,            (numeric) Maximum number of queued calls, further calls are rejected\n"
+            "    \"depth\": n,               (numeric) Number of queued calls\n"
+            "    \"running\": n,             (numeric) Number of calls which are running\n"
+            "    \"processed\": n,           (numeric) Number of calls which were taken from the queue\n"
+            "    \"rejected\": n,            (numeric) Number of calls rejected because the queue was full\n"
+            "    \"queuewait_us\": n,        (numeric) Total time processed calls spent in the queue in microseconds\n"
+            "    \"queuewait_max_us\": n     (numeric) Longest time a call spent in the queue in microseconds\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getrpcinfo", "")
+            + HelpExampleRpc("getrpcinfo", "")
+        );
+
+    UniValue ret(UniValue::VARR);
+    for (const HTTPWorkClassStats& stats : GetHTTPWorkClassStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("class", stats.name));
+        obj.push_back(Pair("maxthreads", stats.maxThreads));
+        obj.push_back(Pair("maxdepth", (uint64_t)stats.maxDepth));
+        obj.push_back(Pair("depth", (uint64_t)stats.depth));
+        obj.push_back(Pair("running", stats.running));
+        obj.push_back(Pair("processed", stats.processed));
+        obj.push_back(Pair("rejected", stats.rejected));
+        obj.push_back(Pair("queuewait_us", stats.totalWaitMicros));
+        obj.push_back(Pair("queuewait_max_us", stats.maxWaitMicros));
+        ret.push_back(obj);
+    }
+    return ret;
+}
+
 /**
  * Call Table
  */
@@ -325,6 +372,7 @@ static const CRPCCommand vRPCCommands[] =
     /* Overall control/query calls */
     { "control",            "help",                   &help,                   true,  {"command"}  },
     { "control",            "stop",                   &stop,                   true,  {}  },
+    { "control",            "getrpcinfo",             &getrpcinfo,             true,  {}  },
 };
 
 CRPCTable::CRPCTable()
@@ -361,9 +409,41 @@ bool CRPCTable::appendCommand(const std::string& name, const CRPCCommand* pcmd)
     return true;
 }
 
+/** Runs the read only calls of batches */
+static ctpl::thread_pool rpcBatchPool;
+
+/** Calls which only read state, calls of a batch which are in this list don't need to be run in order */
+static const std::set<std::string> setReadOnlyBatchMethods = {
+    "getaddressbalance",
+    "getaddressdeltas",
+    "getaddressmempool",
+    "getaddresstxids",
+    "getaddressutxos",
+    "getbestblockhash",
+    "getblock",
+    "getblockcount",
+    "getblockhash",
+    "getblockhashes",
+    "getblockheader",
+    "getblockheaders",
+    "getmempoolentry",
+    "getrawmempool",
+    "getrawtransaction",
+    "getspecialtxes",
+    "getspentinfo",
+    "gettxout",
+    "decoderawtransaction",
+    "decodescript",
+};
+
 bool StartRPC()
 {
     LogPrint("rpc", "Starting RPC\n");
+    int nBatchThreads = std::max((int)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1);
+    if (nBatchThreads > 1) {
+        rpcBatchPool.resize(nBatchThreads);
+        RenameThreadPool(rpcBatchPool, "historia-rpcbatch");
+    }
     fRPCRunning = true;
     g_rpcSignals.Started();
     return true;
@@ -380,6 +460,8 @@ void StopRPC()
 {
     LogPrint("rpc", "Stopping RPC\n");
     deadlineTimers.clear();
+    rpcBatchPool.clear_queue();
+    rpcBatchPool.stop(true);
     DeleteAuthCookie();
     g_rpcSignals.Stopped();
 }
@@ -464,13 +546,61 @@ static UniValue JSONRPCExecOne(const UniValue& req)
     return rpc_result;
 }
 
-std::string JSONRPCExecBatch(const UniValue& vReq)
+UniValue JSONRPCExecBatch(const UniValue& vReq)
 {
+    int64_t nTimeBudget = GetArg("-rpcbatchtimebudget", DEFAULT_RPC_BATCH_TIME_BUDGET);
+    int64_t nDeadline = nTimeBudget > 0 ? GetTimeMillis() + nTimeBudget : 0;
+
+    auto execOne = [nDeadline](const UniValue& req) {
+        if (nDeadline != 0 && GetTimeMillis() > nDeadline) {
+            const UniValue& id = req.isObject() ? find_value(req, "id") : NullUniValue;
+            return JSONRPCReplyObj(NullUniValue, JSONRPCError(RPC_MISC_ERROR, "Batch time budget exceeded"), id);
+        }
+        return JSONRPCExecOne(req);
+    };
+    auto isReadOnly = [](const UniValue& req) {
+        const UniValue& method = req.isObject() ? find_value(req, "method") : NullUniValue;
+        return method.isStr() && setReadOnlyBatchMethods.count(method.get_str()) != 0;
+    };
+
+    std::vector<UniValue> vReplies(vReq.size());
+    size_t i = 0;
+    while (i < vReq.size()) {
+        size_t nEnd = i;
+        while (nEnd < vReq.size() && isReadOnly(vReq[nEnd])) {
+            nEnd++;
+        }
+        if (nEnd - i < 2 || rpcBatchPool.size() == 0) {
+            // a call which modifies state, or nothing to parallelize
+            nEnd = std::max(nEnd, i + 1);
+            for (; i < nEnd; i++) {
+                vReplies[i] = execOne(vReq[i]);
+            }
+            continue;
+        }
+
+        std::vector<std::future<void>> vFutures;
+        vFutures.reserve(nEnd - i);
+        for (size_t j = i; j < nEnd; j++) {
+            vFutures.emplace_back(rpcBatchPool.push([&, j](int threadId) {
+                vReplies[j] = execOne(vReq[j]);
+            }));
+        }
+        // the tasks write into vReplies, all of them must be done before an exception is passed on
+        for (auto& f : vFutures) {
+            f.wait();
+        }
+        for (auto& f : vFutures) {
+            f.get();
+        }
+        i = nEnd;
+    }
+
     UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+    for (const UniValue& reply : vReplies)
+        ret.push_back(reply);
 
-    return ret.write() + "\n";
+    return ret;
 }
 
 /**
@@ -32,6 +32,9 @@ namespace RPCServer
 class CBlockIndex;
 class CNetAddr;
 
+/** Default time budget of a batch of calls in milliseconds, 0 for no limit */
+static const int64_t DEFAULT_RPC_BATCH_TIME_BUDGET = 0;
+
 /** Wrapper for UniValue::VType, which includes typeAny:
  * Used to denote don't care type. Only used by RPCTypeCheckObj */
 struct UniValueType {
@@ -201,7 +204,11 @@ extern std::string HelpExampleRpc(const std::string& methodname, const std::stri
 bool StartRPC();
 void InterruptRPC();
 void StopRPC();
-std::string JSONRPCExecBatch(const UniValue& vReq);
+/**
+ * Execute a batch of calls and return the replies in the same order. Consecutive read only calls are run in
+ * parallel, other calls run on their own in between. Calls which didn't start within -rpcbatchtimebudget fail.
+ */
+UniValue JSONRPCExecBatch(const UniValue& vReq);
 void RPCNotifyBlockChange(bool ibd, const CBlockIndex *);
 
 #endif // BITCOIN_RPCSERVER_H
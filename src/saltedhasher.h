@@ -6,11 +6,24 @@
 #define SALTEDHASHER_H
 
 #include "hash.h"
+#include "netaddress.h"
+#include "primitives/transaction.h"
 #include "uint256.h"
 
+#include <type_traits>
+
 /** Helper classes for std::unordered_map and std::unordered_set hashing */
 
-template<typename T> struct SaltedHasherImpl;
+template<typename T, typename Enable = void> struct SaltedHasherImpl;
+
+template<typename T>
+struct SaltedHasherImpl<T, typename std::enable_if<std::is_integral<T>::value>::type>
+{
+    static std::size_t CalcHash(const T& v, uint64_t k0, uint64_t k1)
+    {
+        return CSipHasher(k0, k1).Write((uint64_t)v).Finalize();
+    }
+};
 
 template<typename N>
 struct SaltedHasherImpl<std::pair<uint256, N>>
@@ -39,6 +52,25 @@ struct SaltedHasherImpl<uint256>
     }
 };
 
+template<>
+struct SaltedHasherImpl<COutPoint>
+{
+    static std::size_t CalcHash(const COutPoint& v, uint64_t k0, uint64_t k1)
+    {
+        return SipHashUint256Extra(k0, k1, v.hash, v.n);
+    }
+};
+
+template<>
+struct SaltedHasherImpl<CService>
+{
+    static std::size_t CalcHash(const CService& v, uint64_t k0, uint64_t k1)
+    {
+        std::vector<unsigned char> vchKey = v.GetKey();
+        return CSipHasher(k0, k1).Write(vchKey.data(), vchKey.size()).Finalize();
+    }
+};
+
 struct SaltedHasherBase
 {
     /** Salt */
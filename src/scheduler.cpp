@@ -6,10 +6,25 @@
 
 #include "reverselock.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <boost/bind.hpp>
 #include <utility>
 
+CScheduler* g_scheduler = nullptr;
+
+// 1ms, 10ms, 100ms, 1s and 10s
+const int64_t CScheduler::histogramBounds[CScheduler::HISTOGRAM_BUCKETS - 1] = {1000, 10000, 100000, 1000000, 10000000};
+
+static int HistogramBucket(int64_t nMicros)
+{
+    int i = 0;
+    while (i < CScheduler::HISTOGRAM_BUCKETS - 1 && nMicros >= CScheduler::histogramBounds[i]) {
+        i++;
+    }
+    return i;
+}
+
 CScheduler::CScheduler() : nThreadsServicingQueue(0), stopRequested(false), stopWhenEmpty(false)
 {
 }
@@ -27,7 +42,31 @@ static boost::system_time toPosixTime(const boost::chrono::system_clock::time_po
 }
 #endif
 
+bool CScheduler::empty(int maxPriority) const
+{
+    for (int i = 0; i <= maxPriority; i++) {
+        if (!taskQueues[i].empty())
+            return false;
+    }
+    return true;
+}
+
+boost::chrono::system_clock::time_point CScheduler::nextTaskTime(int maxPriority) const
+{
+    boost::chrono::system_clock::time_point result = boost::chrono::system_clock::time_point::max();
+    for (int i = 0; i <= maxPriority; i++) {
+        if (!taskQueues[i].empty() && taskQueues[i].begin()->first < result)
+            result = taskQueues[i].begin()->first;
+    }
+    return result;
+}
+
 void CScheduler::serviceQueue()
+{
+    servicePriorityQueue(PRIORITY_LOW);
+}
+
+void CScheduler::servicePriorityQueue(Priority maxPriority)
 {
     boost::unique_lock<boost::mutex> lock(newTaskMutex);
     ++nThreadsServicingQueue;
@@ -37,50 +76,73 @@ void CScheduler::serviceQueue()
     // is called.
     while (!shouldStop()) {
         try {
-            while (!shouldStop() && taskQueue.empty()) {
+            while (!shouldStop() && empty(maxPriority)) {
                 // Wait until there is something to do.
                 newTaskScheduled.wait(lock);
             }
 
             // Wait until either there is a new task, or until
-            // the time of the first item on the queue:
+            // the time of the first item on the serviced queues:
 
 // wait_until needs boost 1.50 or later; older versions have timed_wait:
 #if BOOST_VERSION < 105000
-            while (!shouldStop() && !taskQueue.empty() &&
-                   newTaskScheduled.timed_wait(lock, toPosixTime(taskQueue.begin()->first))) {
+            while (!shouldStop() && !empty(maxPriority) &&
+                   newTaskScheduled.timed_wait(lock, toPosixTime(nextTaskTime(maxPriority)))) {
                 // Keep waiting until timeout
             }
 #else
             // Some boost versions have a conflicting overload of wait_until that returns void.
             // Explicitly use a template here to avoid hitting that overload.
-            while (!shouldStop() && !taskQueue.empty()) {
-                boost::chrono::system_clock::time_point timeToWaitFor = taskQueue.begin()->first;
+            while (!shouldStop() && !empty(maxPriority)) {
+                boost::chrono::system_clock::time_point timeToWaitFor = nextTaskTime(maxPriority);
                 if (newTaskScheduled.wait_until<>(lock, timeToWaitFor) == boost::cv_status::timeout)
                     break; // Exit loop after timeout, it means we reached the time of the event
             }
 #endif
             // If there are multiple threads, the queue can empty while we're waiting (another
             // thread may service the task we were waiting on).
-            if (shouldStop() || taskQueue.empty())
+            if (shouldStop() || empty(maxPriority))
+                continue;
+
+            // Of the tasks which are due, run the most urgent one
+            boost::chrono::system_clock::time_point now = boost::chrono::system_clock::now();
+            int priority = 0;
+            while (priority <= maxPriority && (taskQueues[priority].empty() || taskQueues[priority].begin()->first > now))
+                priority++;
+            if (priority > maxPriority)
                 continue;
 
-            Function f = taskQueue.begin()->second;
-            taskQueue.erase(taskQueue.begin());
+            TaskQueue& queue = taskQueues[priority];
+            int64_t nLateMicros = boost::chrono::duration_cast<boost::chrono::microseconds>(now - queue.begin()->first).count();
+            Task task = std::move(queue.begin()->second);
+            queue.erase(queue.begin());
 
+            boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
             {
                 // Unlock before calling f, so it can reschedule itself or another task
                 // without deadlocking:
                 reverse_lock<boost::unique_lock<boost::mutex> > rlock(lock);
-                f();
+                task.f();
             }
+            int64_t nRunMicros = boost::chrono::duration_cast<boost::chrono::microseconds>(boost::chrono::steady_clock::now() - start).count();
+
+            TaskStats& stats = mapTaskStats[task.strName.empty() ? "other" : task.strName];
+            stats.priority = (Priority)priority;
+            stats.nRuns++;
+            stats.nTotalRunMicros += nRunMicros;
+            stats.nMaxRunMicros = std::max(stats.nMaxRunMicros, nRunMicros);
+            stats.nTotalLateMicros += nLateMicros;
+            stats.nMaxLateMicros = std::max(stats.nMaxLateMicros, nLateMicros);
+            stats.vRunHistogram[HistogramBucket(nRunMicros)]++;
+            stats.vLateHistogram[HistogramBucket(nLateMicros)]++;
         } catch (...) {
             --nThreadsServicingQueue;
             throw;
         }
     }
     --nThreadsServicingQueue;
-    newTaskScheduled.notify_one();
+    // threads servicing other priorities might wait for the queue to drain
+    newTaskScheduled.notify_all();
 }
 
 void CScheduler::stop(bool drain)
@@ -95,39 +157,142 @@ void CScheduler::stop(bool drain)
     newTaskScheduled.notify_all();
 }
 
-void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t)
+void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t,
+                          Priority priority, const std::string& strName)
 {
     {
         boost::unique_lock<boost::mutex> lock(newTaskMutex);
-        taskQueue.insert(std::make_pair(t, f));
+        taskQueues[priority].insert(std::make_pair(t, Task{f, strName}));
     }
-    newTaskScheduled.notify_one();
+    // not every thread services every priority, so wake up all of them
+    newTaskScheduled.notify_all();
 }
 
-void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaMilliSeconds)
+void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaMilliSeconds,
+                                 Priority priority, const std::string& strName)
 {
-    schedule(f, boost::chrono::system_clock::now() + boost::chrono::milliseconds(deltaMilliSeconds));
+    schedule(f, boost::chrono::system_clock::now() + boost::chrono::milliseconds(deltaMilliSeconds), priority, strName);
 }
 
-static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaMilliSeconds)
+static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaMilliSeconds,
+                   CScheduler::Priority priority, const std::string& strName)
 {
     f();
-    s->scheduleFromNow(boost::bind(&Repeat, s, f, deltaMilliSeconds), deltaMilliSeconds);
+    s->scheduleFromNow(boost::bind(&Repeat, s, f, deltaMilliSeconds, priority, strName), deltaMilliSeconds, priority, strName);
 }
 
-void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaMilliSeconds)
+void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaMilliSeconds,
+                               Priority priority, const std::string& strName)
 {
-    scheduleFromNow(boost::bind(&Repeat, this, f, deltaMilliSeconds), deltaMilliSeconds);
+    scheduleFromNow(boost::bind(&Repeat, this, f, deltaMilliSeconds, priority, strName), deltaMilliSeconds, priority, strName);
 }
 
 size_t CScheduler::getQueueInfo(boost::chrono::system_clock::time_point &first,
                              boost::chrono::system_clock::time_point &last) const
 {
     boost::unique_lock<boost::mutex> lock(newTaskMutex);
-    size_t result = taskQueue.size();
-    if (!taskQueue.empty()) {
-        first = taskQueue.begin()->first;
-        last = taskQueue.rbegin()->first;
+    size_t result = 0;
+    for (const TaskQueue& queue : taskQueues) {
+        if (queue.empty())
+            continue;
+        if (result == 0 || queue.begin()->first < first)
+            first = queue.begin()->first;
+        if (result == 0 || queue.rbegin()->first > last)
+            last = queue.rbegin()->first;
+        result += queue.size();
     }
     return result;
 }
+
+std::map<std::string, CScheduler::TaskStats> CScheduler::getTaskStats() const
+{
+    boost::unique_lock<boost::mutex> lock(newTaskMutex);
+    return mapTaskStats;
+}
+
+SingleThreadedSchedulerClient::SingleThreadedSchedulerClient(CScheduler* pschedulerIn, CScheduler::Priority priorityIn,
+                                                             const std::string& strNameIn) :
+    pscheduler(pschedulerIn), priority(priorityIn), strName(strNameIn), fCallbacksRunning(false)
+{
+}
+
+void SingleThreadedSchedulerClient::MaybeScheduleProcessQueue()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs_callbacksPending);
+        // the running callback schedules the next one when it's done
+        if (fCallbacksRunning || listCallbacksPending.empty())
+            return;
+    }
+    pscheduler->schedule(std::bind(&SingleThreadedSchedulerClient::ProcessQueue, this),
+                         boost::chrono::system_clock::now(), priority, strName);
+}
+
+void SingleThreadedSchedulerClient::ProcessQueue()
+{
+    CScheduler::Function callback;
+    {
+        boost::unique_lock<boost::mutex> lock(cs_callbacksPending);
+        if (fCallbacksRunning || listCallbacksPending.empty())
+            return;
+        fCallbacksRunning = true;
+        callback = std::move(listCallbacksPending.front());
+        listCallbacksPending.pop_front();
+    }
+
+    // reset fCallbacksRunning even if the callback throws or the thread is interrupted
+    struct RAIICallbacksRunning {
+        SingleThreadedSchedulerClient* instance;
+        explicit RAIICallbacksRunning(SingleThreadedSchedulerClient* _instance) : instance(_instance) {}
+        ~RAIICallbacksRunning()
+        {
+            {
+                boost::unique_lock<boost::mutex> lock(instance->cs_callbacksPending);
+                instance->fCallbacksRunning = false;
+            }
+            instance->callbacksDone.notify_all();
+            instance->MaybeScheduleProcessQueue();
+        }
+    } raiicallbacksrunning(this);
+
+    callback();
+}
+
+void SingleThreadedSchedulerClient::AddToProcessQueue(CScheduler::Function func)
+{
+    if (!pscheduler) {
+        func();
+        return;
+    }
+    {
+        boost::unique_lock<boost::mutex> lock(cs_callbacksPending);
+        listCallbacksPending.emplace_back(std::move(func));
+    }
+    MaybeScheduleProcessQueue();
+}
+
+void SingleThreadedSchedulerClient::EmptyQueue()
+{
+    boost::unique_lock<boost::mutex> lock(cs_callbacksPending);
+    while (true) {
+        while (fCallbacksRunning)
+            callbacksDone.wait(lock);
+        if (listCallbacksPending.empty())
+            return;
+        CScheduler::Function callback = std::move(listCallbacksPending.front());
+        listCallbacksPending.pop_front();
+        fCallbacksRunning = true;
+        {
+            reverse_lock<boost::unique_lock<boost::mutex> > rlock(lock);
+            callback();
+        }
+        fCallbacksRunning = false;
+        callbacksDone.notify_all();
+    }
+}
+
+size_t SingleThreadedSchedulerClient::CallbacksPending()
+{
+    boost::unique_lock<boost::mutex> lock(cs_callbacksPending);
+    return listCallbacksPending.size();
+}
@@ -12,7 +12,12 @@
 //
 #include <boost/chrono/chrono.hpp>
 #include <boost/thread.hpp>
+#include <list>
 #include <map>
+#include <string>
+
+static const int DEFAULT_SCHEDULER_THREADS = 2;
+static const int MAX_SCHEDULER_THREADS = 8;
 
 //
 // Simple class for background tasks that should be run
@@ -32,6 +37,15 @@
 // delete s; // Must be done after thread is interrupted/joined.
 //
 
+// Tasks have a priority class, when several tasks are due the most urgent
+// one runs first, e.g. chainlock processing before governance maintenance.
+// Threads running servicePriorityQueue only pick up the more urgent classes,
+// so these can't be held up by a long running task of another class.
+//
+// Run times and lateness (how long after the scheduled time a task started)
+// are recorded per task name, see getTaskStats.
+//
+
 class CScheduler
 {
 public:
@@ -40,18 +54,45 @@ public:
 
     typedef std::function<void(void)> Function;
 
+    enum Priority {
+        /** Time critical tasks, e.g. chainlock processing */
+        PRIORITY_HIGH = 0,
+        PRIORITY_NORMAL = 1,
+        /** Maintenance which may be delayed, e.g. governance cleanup and flushing */
+        PRIORITY_LOW = 2,
+    };
+    static const int PRIORITY_COUNT = 3;
+
+    // Upper bounds of the histogram buckets in microseconds, the last bucket has no bound
+    static const int HISTOGRAM_BUCKETS = 6;
+    static const int64_t histogramBounds[HISTOGRAM_BUCKETS - 1];
+
+    struct TaskStats {
+        Priority priority{PRIORITY_NORMAL};
+        uint64_t nRuns{0};
+        int64_t nTotalRunMicros{0};
+        int64_t nMaxRunMicros{0};
+        int64_t nTotalLateMicros{0};
+        int64_t nMaxLateMicros{0};
+        uint64_t vRunHistogram[HISTOGRAM_BUCKETS]{};
+        uint64_t vLateHistogram[HISTOGRAM_BUCKETS]{};
+    };
+
     // Call func at/after time t
-    void schedule(Function f, boost::chrono::system_clock::time_point t);
+    void schedule(Function f, boost::chrono::system_clock::time_point t,
+                  Priority priority = PRIORITY_NORMAL, const std::string& strName = "");
 
     // Convenience method: call f once deltaSeconds from now
-    void scheduleFromNow(Function f, int64_t deltaMilliSeconds);
+    void scheduleFromNow(Function f, int64_t deltaMilliSeconds,
+                         Priority priority = PRIORITY_NORMAL, const std::string& strName = "");
 
     // Another convenience method: call f approximately
     // every deltaSeconds forever, starting deltaSeconds from now.
     // To be more precise: every time f is finished, it
     // is rescheduled to run deltaSeconds later. If you
     // need more accurate scheduling, don't use this method.
-    void scheduleEvery(Function f, int64_t deltaMilliSeconds);
+    void scheduleEvery(Function f, int64_t deltaMilliSeconds,
+                       Priority priority = PRIORITY_NORMAL, const std::string& strName = "");
 
     // To keep things as simple as possible, there is no unschedule.
 
@@ -59,6 +100,11 @@ public:
     // and interrupted using boost::interrupt_thread
     void serviceQueue();
 
+    // Like serviceQueue, but only runs tasks of maxPriority or more urgent
+    // ones. Several threads can service the queue, so tasks must not rely
+    // on running one at a time.
+    void servicePriorityQueue(Priority maxPriority);
+
     // Tell any threads running serviceQueue to stop as soon as they're
     // done servicing whatever task they're currently servicing (drain=false)
     // or when there is no work left to be done (drain=true)
@@ -69,14 +115,64 @@ public:
     size_t getQueueInfo(boost::chrono::system_clock::time_point &first,
                         boost::chrono::system_clock::time_point &last) const;
 
+    // Returns the run time and lateness statistics of the tasks which ran
+    // so far, by task name. Unnamed tasks are counted as "other".
+    std::map<std::string, TaskStats> getTaskStats() const;
+
 private:
-    std::multimap<boost::chrono::system_clock::time_point, Function> taskQueue;
+    struct Task {
+        Function f;
+        std::string strName;
+    };
+    typedef std::multimap<boost::chrono::system_clock::time_point, Task> TaskQueue;
+
+    TaskQueue taskQueues[PRIORITY_COUNT];
+    std::map<std::string, TaskStats> mapTaskStats;
     boost::condition_variable newTaskScheduled;
     mutable boost::mutex newTaskMutex;
     int nThreadsServicingQueue;
     bool stopRequested;
     bool stopWhenEmpty;
-    bool shouldStop() { return stopRequested || (stopWhenEmpty && taskQueue.empty()); }
+    bool empty(int maxPriority = PRIORITY_LOW) const;
+    boost::chrono::system_clock::time_point nextTaskTime(int maxPriority) const;
+    bool shouldStop() const { return stopRequested || (stopWhenEmpty && empty()); }
+};
+
+/**
+ * Runs the callbacks added to it one at a time and in the order they were added on the
+ * threads of a CScheduler, so a listener gets its notifications in order without holding
+ * up the thread that sent them. Without a scheduler the callbacks run right away.
+ */
+class SingleThreadedSchedulerClient
+{
+private:
+    CScheduler* pscheduler;
+    CScheduler::Priority priority;
+    std::string strName;
+
+    boost::mutex cs_callbacksPending;
+    boost::condition_variable callbacksDone;
+    std::list<CScheduler::Function> listCallbacksPending;
+    bool fCallbacksRunning;
+
+    void MaybeScheduleProcessQueue();
+    void ProcessQueue();
+
+public:
+    SingleThreadedSchedulerClient(CScheduler* pschedulerIn, CScheduler::Priority priorityIn = CScheduler::PRIORITY_NORMAL,
+                                  const std::string& strNameIn = "");
+
+    void AddToProcessQueue(CScheduler::Function func);
+
+    // Wait for the callback which is running, if any, and run the ones still
+    // queued on the calling thread. Used when the listener goes away or the
+    // scheduler isn't serviced anymore.
+    void EmptyQueue();
+
+    size_t CallbacksPending();
 };
 
+/** The scheduler of the node, started in AppInitMain */
+extern CScheduler* g_scheduler;
+
 #endif
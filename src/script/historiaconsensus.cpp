@@ -10,6 +10,13 @@
 #include "script/interpreter.h"
 #include "version.h"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <system_error>
+#include <thread>
+#include <vector>
+
 namespace {
 
 /** A class that deserializes a single CTransaction one time. */
@@ -68,6 +75,92 @@ struct ECCryptoClosure
 };
 
 ECCryptoClosure instance_of_eccryptoclosure;
+
+static const unsigned int MAX_VERIFY_THREADS = 64;
+
+/** A deserialized transaction and its precomputed signature hash data, shared by the checks of all of its inputs */
+struct PreparedTransaction
+{
+    const CTransaction tx;
+    const PrecomputedTransactionData txdata;
+
+    explicit PreparedTransaction(TxInputStream& stream) : tx(deserialize, stream), txdata(tx) {}
+};
+
+struct BatchCheck
+{
+    const PreparedTransaction* prepared;
+    const historiaconsensus_spent_output* spentOutput;
+    int* result;
+};
+
+/** Deserializes a transaction and checks the input indexes of its spent outputs, returns nullptr and sets err on failure */
+std::unique_ptr<PreparedTransaction> PrepareTransaction(const unsigned char *txTo, unsigned int txToLen,
+                                                        const historiaconsensus_spent_output *spentOutputs, unsigned int nSpentOutputs,
+                                                        historiaconsensus_error* err)
+{
+    std::unique_ptr<PreparedTransaction> prepared;
+    try {
+        TxInputStream stream(SER_NETWORK, PROTOCOL_VERSION, txTo, txToLen);
+        prepared.reset(new PreparedTransaction(stream));
+    } catch (const std::exception&) {
+        set_error(err, historiaconsensus_ERR_TX_DESERIALIZE);
+        return nullptr;
+    }
+    for (unsigned int i = 0; i < nSpentOutputs; i++) {
+        if (spentOutputs[i].nIn >= prepared->tx.vin.size()) {
+            set_error(err, historiaconsensus_ERR_TX_INDEX);
+            return nullptr;
+        }
+    }
+    if (GetSerializeSize(prepared->tx, SER_NETWORK, PROTOCOL_VERSION) != txToLen) {
+        set_error(err, historiaconsensus_ERR_TX_SIZE_MISMATCH);
+        return nullptr;
+    }
+    set_error(err, historiaconsensus_ERR_OK);
+    return prepared;
+}
+
+/** Runs the checks on the calling thread and up to nThreads - 1 additional threads, returns true if all passed */
+bool RunBatchChecks(const std::vector<BatchCheck>& vChecks, unsigned int flags, unsigned int nThreads)
+{
+    std::atomic<size_t> nNext{0};
+    std::atomic<bool> fAllOk{true};
+    auto worker = [&]() {
+        for (size_t i = nNext++; i < vChecks.size(); i = nNext++) {
+            const BatchCheck& check = vChecks[i];
+            const CTransaction& tx = check.prepared->tx;
+            const unsigned int nIn = check.spentOutput->nIn;
+            const CScript scriptPubKey(check.spentOutput->scriptPubKey, check.spentOutput->scriptPubKey + check.spentOutput->scriptPubKeyLen);
+            bool fOk;
+            try {
+                fOk = VerifyScript(tx.vin[nIn].scriptSig, scriptPubKey, flags, TransactionSignatureChecker(&tx, nIn, &check.prepared->txdata), NULL);
+            } catch (const std::exception&) {
+                fOk = false;
+            }
+            *check.result = fOk ? 1 : 0;
+            if (!fOk) {
+                fAllOk = false;
+            }
+        }
+    };
+
+    nThreads = std::min<size_t>(std::min(nThreads, MAX_VERIFY_THREADS), vChecks.size());
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < nThreads; i++) {
+        try {
+            threads.emplace_back(worker);
+        } catch (const std::system_error&) {
+            // continue with the threads we already have
+            break;
+        }
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return fAllOk;
+}
 }
 
 /** Check that all specified flags are part of the libconsensus interface. */
@@ -100,6 +193,60 @@ int historiaconsensus_verify_script(const unsigned char *scriptPubKey, unsigned
     }
 }
 
+int historiaconsensus_verify_script_batch(const unsigned char *txTo, unsigned int txToLen,
+                                    const historiaconsensus_spent_output *spentOutputs, unsigned int nSpentOutputs,
+                                    unsigned int flags, unsigned int nThreads, int *results, historiaconsensus_error* err)
+{
+    std::fill(results, results + nSpentOutputs, 0);
+    if (!verify_flags(flags)) {
+        return set_error(err, historiaconsensus_ERR_INVALID_FLAGS);
+    }
+    std::unique_ptr<PreparedTransaction> prepared = PrepareTransaction(txTo, txToLen, spentOutputs, nSpentOutputs, err);
+    if (!prepared) {
+        return 0;
+    }
+
+    std::vector<BatchCheck> vChecks;
+    vChecks.reserve(nSpentOutputs);
+    for (unsigned int i = 0; i < nSpentOutputs; i++) {
+        vChecks.push_back(BatchCheck{prepared.get(), &spentOutputs[i], &results[i]});
+    }
+    return RunBatchChecks(vChecks, flags, nThreads) ? 1 : 0;
+}
+
+int historiaconsensus_verify_transactions(historiaconsensus_transaction *txs, unsigned int nTxs,
+                                    unsigned int flags, unsigned int nThreads, historiaconsensus_error* err)
+{
+    for (unsigned int i = 0; i < nTxs; i++) {
+        std::fill(txs[i].results, txs[i].results + txs[i].nSpentOutputs, 0);
+    }
+    if (!verify_flags(flags)) {
+        for (unsigned int i = 0; i < nTxs; i++) {
+            txs[i].err = historiaconsensus_ERR_INVALID_FLAGS;
+        }
+        return set_error(err, historiaconsensus_ERR_INVALID_FLAGS);
+    }
+    set_error(err, historiaconsensus_ERR_OK);
+
+    bool fAllPrepared = true;
+    std::vector<std::unique_ptr<PreparedTransaction>> vPrepared;
+    std::vector<BatchCheck> vChecks;
+    vPrepared.reserve(nTxs);
+    for (unsigned int i = 0; i < nTxs; i++) {
+        historiaconsensus_transaction& t = txs[i];
+        vPrepared.emplace_back(PrepareTransaction(t.txTo, t.txToLen, t.spentOutputs, t.nSpentOutputs, &t.err));
+        if (!vPrepared.back()) {
+            fAllPrepared = false;
+            continue;
+        }
+        for (unsigned int j = 0; j < t.nSpentOutputs; j++) {
+            vChecks.push_back(BatchCheck{vPrepared.back().get(), &t.spentOutputs[j], &t.results[j]});
+        }
+    }
+    bool fAllOk = RunBatchChecks(vChecks, flags, nThreads);
+    return (fAllPrepared && fAllOk) ? 1 : 0;
+}
+
 unsigned int historiaconsensus_version()
 {
     // Just use the API version for now
@@ -31,7 +31,7 @@
 extern "C" {
 #endif
 
-#define BITCOINCONSENSUS_API_VER 0
+#define BITCOINCONSENSUS_API_VER 1
 
 typedef enum historiaconsensus_error_t
 {
@@ -64,6 +64,46 @@ EXPORT_SYMBOL int historiaconsensus_verify_script(const unsigned char *scriptPub
                                     const unsigned char *txTo        , unsigned int txToLen,
                                     unsigned int nIn, unsigned int flags, historiaconsensus_error* err);
 
+/** An output spent by the input nIn of a transaction passed to the batch verification functions */
+typedef struct historiaconsensus_spent_output
+{
+    unsigned int nIn;
+    const unsigned char *scriptPubKey;
+    unsigned int scriptPubKeyLen;
+} historiaconsensus_spent_output;
+
+/// Verifies the inputs of the serialized transaction pointed to by txTo which spend
+/// the nSpentOutputs outputs in spentOutputs, under the additional constraints
+/// specified by flags. The transaction is deserialized once and its signature hash
+/// data is shared by all inputs. results must have room for nSpentOutputs entries,
+/// results[i] is set to 1 if spentOutputs[i] is correctly spent and to 0 otherwise.
+/// Up to nThreads threads (at most 64) are used, 0 or 1 verifies in the calling thread.
+/// Returns 1 if all of the inputs were correctly spent.
+/// If not NULL, err will contain an error/success code for the operation, no input
+/// is verified (and all results are 0) if it's not historiaconsensus_ERR_OK
+EXPORT_SYMBOL int historiaconsensus_verify_script_batch(const unsigned char *txTo, unsigned int txToLen,
+                                    const historiaconsensus_spent_output *spentOutputs, unsigned int nSpentOutputs,
+                                    unsigned int flags, unsigned int nThreads, int *results, historiaconsensus_error* err);
+
+/** A serialized transaction and the outputs it spends, with room for the results of historiaconsensus_verify_transactions */
+typedef struct historiaconsensus_transaction
+{
+    const unsigned char *txTo;
+    unsigned int txToLen;
+    const historiaconsensus_spent_output *spentOutputs;
+    unsigned int nSpentOutputs;
+    int *results; // nSpentOutputs entries, set like with historiaconsensus_verify_script_batch
+    historiaconsensus_error err; // set to the error/success code of this transaction
+} historiaconsensus_transaction;
+
+/// Same as historiaconsensus_verify_script_batch for each of the nTxs transactions in
+/// txs, with the inputs of all transactions verified by the same up to nThreads threads.
+/// Returns 1 if all transactions could be deserialized and all of their inputs were
+/// correctly spent. If not NULL, err will contain historiaconsensus_ERR_INVALID_FLAGS
+/// when flags are invalid (and nothing is verified) and historiaconsensus_ERR_OK otherwise
+EXPORT_SYMBOL int historiaconsensus_verify_transactions(historiaconsensus_transaction *txs, unsigned int nTxs,
+                                    unsigned int flags, unsigned int nThreads, historiaconsensus_error* err);
+
 EXPORT_SYMBOL unsigned int historiaconsensus_version();
 
 #ifdef __cplusplus
@@ -1117,9 +1117,64 @@ public:
     }
 };
 
+/** Stream which appends the serialized data to a vector */
+class CVectorAppender
+{
+private:
+    std::vector<unsigned char>& vch;
+
+public:
+    CVectorAppender(std::vector<unsigned char>& vchIn) : vch(vchIn) {}
+    int GetType() const { return SER_GETHASH; }
+    int GetVersion() const { return 0; }
+    void write(const char* pch, size_t nSize) { vch.insert(vch.end(), (const unsigned char*)pch, (const unsigned char*)pch + nSize); }
+};
+
+/** Stream which feeds the serialized data into a hasher */
+class CSHA256Streamer
+{
+private:
+    CSHA256& hasher;
+
+public:
+    CSHA256Streamer(CSHA256& hasherIn) : hasher(hasherIn) {}
+    int GetType() const { return SER_GETHASH; }
+    int GetVersion() const { return 0; }
+    void write(const char* pch, size_t nSize) { hasher.Write((const unsigned char*)pch, nSize); }
+};
+
+/** Size of an input with a blanked script: prevout, empty script and nSequence */
+static const size_t BLANK_INPUT_SIZE = 36 + 1 + 4;
+
 } // anon namespace
 
-uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType)
+PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo)
+{
+    CVectorAppender suffix(vchSuffix);
+    for (const auto& txin : txTo.vin) {
+        ::Serialize(suffix, txin.prevout);
+        ::Serialize(suffix, CScriptBase());
+        ::Serialize(suffix, txin.nSequence);
+    }
+    assert(vchSuffix.size() == txTo.vin.size() * BLANK_INPUT_SIZE);
+    ::Serialize(suffix, txTo.vout);
+    ::Serialize(suffix, txTo.nLockTime);
+    if (txTo.nVersion == 3 && txTo.nType != TRANSACTION_NORMAL)
+        ::Serialize(suffix, txTo.vExtraPayload);
+
+    CSHA256 hasher;
+    CSHA256Streamer s(hasher);
+    int32_t n32bitVersion = txTo.nVersion | (txTo.nType << 16);
+    ::Serialize(s, n32bitVersion);
+    ::WriteCompactSize(s, txTo.vin.size());
+    vMidstates.reserve(txTo.vin.size());
+    for (size_t i = 0; i < txTo.vin.size(); i++) {
+        vMidstates.emplace_back(hasher);
+        hasher.Write(&vchSuffix[i * BLANK_INPUT_SIZE], BLANK_INPUT_SIZE);
+    }
+}
+
+uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const PrecomputedTransactionData* cache)
 {
     static const uint256 one(uint256S("0000000000000000000000000000000000000000000000000000000000000001"));
     if (nIn >= txTo.vin.size()) {
@@ -1138,6 +1193,24 @@ uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsig
     // Wrapper to serialize only the necessary parts of the transaction being signed
     CTransactionSignatureSerializer txTmp(txTo, scriptCode, nIn, nHashType);
 
+    bool fHashAll = (nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE;
+    if (cache && fHashAll && !(nHashType & SIGHASH_ANYONECANPAY)) {
+        assert(cache->vMidstates.size() == txTo.vin.size());
+        // Only the signed input differs from the precomputed serialization, everything in front of it is
+        // already in the midstate
+        CSHA256 hasher(cache->vMidstates[nIn]);
+        CSHA256Streamer s(hasher);
+        txTmp.SerializeInput(s, nIn);
+        size_t nSuffixPos = (nIn + 1) * BLANK_INPUT_SIZE;
+        hasher.Write(cache->vchSuffix.data() + nSuffixPos, cache->vchSuffix.size() - nSuffixPos);
+        ::Serialize(s, nHashType);
+
+        uint256 hash;
+        hasher.Finalize(hash.begin());
+        CSHA256().Write(hash.begin(), CSHA256::OUTPUT_SIZE).Finalize(hash.begin());
+        return hash;
+    }
+
     // Serialize and hash
     CHashWriter ss(SER_GETHASH, 0);
     ss << txTmp << nHashType;
@@ -1162,7 +1235,7 @@ bool TransactionSignatureChecker::CheckSig(const std::vector<unsigned char>& vch
     int nHashType = vchSig.back();
     vchSig.pop_back();
 
-    uint256 sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType);
+    uint256 sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType, txdata);
 
     if (!VerifySignature(vchSig, pubkey, sighash))
         return false;
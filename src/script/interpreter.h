@@ -8,6 +8,7 @@
 
 #include "script_error.h"
 #include "primitives/transaction.h"
+#include "crypto/sha256.h"
 
 #include <vector>
 #include <stdint.h>
@@ -94,7 +95,23 @@ enum
 
 bool CheckSignatureEncoding(const std::vector<unsigned char> &vchSig, unsigned int flags, ScriptError* serror);
 
-uint256 SignatureHash(const CScript &scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType);
+/**
+ * The parts of the signature hash serialization of a transaction which are the same for all of its inputs.
+ * Without it, every input re-serializes and re-hashes the whole transaction, which is quadratic in the number of
+ * inputs. Only used for SIGHASH_ALL without SIGHASH_ANYONECANPAY, the other hash types don't commit to the other
+ * inputs the same way. Must outlive the signature checkers it's passed to.
+ */
+struct PrecomputedTransactionData
+{
+    /** Hasher states after the version, the input count and the blanked inputs in front of each input */
+    std::vector<CSHA256> vMidstates;
+    /** The blanked inputs, followed by the outputs, nLockTime and the extra payload */
+    std::vector<unsigned char> vchSuffix;
+
+    explicit PrecomputedTransactionData(const CTransaction& tx);
+};
+
+uint256 SignatureHash(const CScript &scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const PrecomputedTransactionData* cache = nullptr);
 
 class BaseSignatureChecker
 {
@@ -122,12 +139,13 @@ class TransactionSignatureChecker : public BaseSignatureChecker
 private:
     const CTransaction* txTo;
     unsigned int nIn;
+    const PrecomputedTransactionData* txdata;
 
 protected:
     virtual bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 
 public:
-    TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn) : txTo(txToIn), nIn(nInIn) {}
+    TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const PrecomputedTransactionData* txdataIn = nullptr) : txTo(txToIn), nIn(nInIn), txdata(txdataIn) {}
     bool CheckSig(const std::vector<unsigned char>& scriptSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode) const override;
     bool CheckLockTime(const CScriptNum& nLockTime) const override;
     bool CheckSequence(const CScriptNum& nSequence) const override;
@@ -14,6 +14,9 @@
 #include "cuckoocache.h"
 #include <boost/thread.hpp>
 
+#include <algorithm>
+#include <iterator>
+
 namespace {
 
 /**
@@ -75,6 +78,24 @@ public:
         boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
         setValid.insert(entry);
     }
+
+    /** Looks up all entries while holding the lock once, entries with their erase flag set are erased when found */
+    void GetMany(const std::vector<uint256>& vEntries, const std::vector<bool>& vErase, std::vector<bool>& vFound)
+    {
+        vFound.resize(vEntries.size());
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        for (size_t i = 0; i < vEntries.size(); i++) {
+            vFound[i] = setValid.contains(vEntries[i], vErase[i]);
+        }
+    }
+
+    void SetMany(std::vector<uint256>& vEntries)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        for (auto& entry : vEntries) {
+            setValid.insert(entry);
+        }
+    }
     uint32_t setup_bytes(size_t n)
     {
         return setValid.setup_bytes(n);
@@ -114,3 +135,54 @@ bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsig
         signatureCache.Set(entry);
     return true;
 }
+
+void CSignatureBatch::Add(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash, bool store)
+{
+    entries.emplace_back(Entry{sighash, pubkey, vchSig, store});
+}
+
+void CSignatureBatch::Append(CSignatureBatch& other)
+{
+    if (entries.empty()) {
+        entries.swap(other.entries);
+        return;
+    }
+    entries.reserve(entries.size() + other.entries.size());
+    std::move(other.entries.begin(), other.entries.end(), std::back_inserter(entries));
+    other.entries.clear();
+}
+
+bool CSignatureBatch::Verify()
+{
+    std::vector<uint256> vCacheEntries(entries.size());
+    std::vector<bool> vErase(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        signatureCache.ComputeEntry(vCacheEntries[i], entries[i].sighash, entries[i].vchSig, entries[i].pubkey);
+        vErase[i] = !entries[i].store;
+    }
+    std::vector<bool> vFound;
+    signatureCache.GetMany(vCacheEntries, vErase, vFound);
+
+    bool fValid = true;
+    std::vector<uint256> vStore;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (vFound[i])
+            continue;
+        if (!entries[i].pubkey.Verify(entries[i].sighash, entries[i].vchSig)) {
+            fValid = false;
+            break;
+        }
+        if (entries[i].store)
+            vStore.emplace_back(vCacheEntries[i]);
+    }
+    if (!vStore.empty())
+        signatureCache.SetMany(vStore);
+    entries.clear();
+    return fValid;
+}
+
+bool BatchingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
+{
+    batch.Add(vchSig, pubkey, sighash, store);
+    return true;
+}
@@ -6,7 +6,9 @@
 #ifndef BITCOIN_SCRIPT_SIGCACHE_H
 #define BITCOIN_SCRIPT_SIGCACHE_H
 
+#include "pubkey.h"
 #include "script/interpreter.h"
+#include "uint256.h"
 
 #include <vector>
 
@@ -17,15 +19,54 @@ static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 // Maximum sig cache size allowed
 static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
 
-class CPubKey;
-
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
     bool store;
 
 public:
-    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, bool storeIn=true) : TransactionSignatureChecker(txToIn, nInIn), store(storeIn) {}
+    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, bool storeIn=true, const PrecomputedTransactionData* txdataIn = nullptr) : TransactionSignatureChecker(txToIn, nInIn, txdataIn), store(storeIn) {}
+
+    bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
+};
+
+/**
+ * Signatures whose verification the script checks of a CCheckQueue batch deferred to the end of the batch, see
+ * BatchingTransactionSignatureChecker. libsecp256k1 has no batch verification for ECDSA, so the signatures are still
+ * verified one by one, but the signature cache is only locked once for all of them.
+ */
+class CSignatureBatch
+{
+private:
+    struct Entry {
+        uint256 sighash;
+        CPubKey pubkey;
+        std::vector<unsigned char> vchSig;
+        bool store;
+    };
+    std::vector<Entry> entries;
+
+public:
+    void Add(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash, bool store);
+    /** Moves the signatures of other into this batch */
+    void Append(CSignatureBatch& other);
+    /** Verifies and removes all signatures, the valid ones are added to the signature cache if their store flag is set */
+    bool Verify();
+
+    size_t size() const { return entries.size(); }
+    void clear() { entries.clear(); }
+    void swap(CSignatureBatch& other) { entries.swap(other.entries); }
+};
+
+/** Assumes all signatures to be valid and collects them, the result of a script is only valid once the batch verified */
+class BatchingTransactionSignatureChecker : public TransactionSignatureChecker
+{
+private:
+    CSignatureBatch& batch;
+    bool store;
+
+public:
+    BatchingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, CSignatureBatch& batchIn, bool storeIn=true, const PrecomputedTransactionData* txdataIn = nullptr) : TransactionSignatureChecker(txToIn, nInIn, txdataIn), batch(batchIn), store(storeIn) {}
 
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
 };
@@ -16,6 +16,7 @@
 CSporkManager sporkManager;
 
 const std::string CSporkManager::SERIALIZATION_VERSION_STRING = "CSporkManager-Version-2";
+const int64_t CSporkManager::SPORK_VALUE_UNRESOLVED;
 
 std::map<int, int64_t> mapSporkDefaults = {
     {SPORK_2_INSTANTSEND_ENABLED,            0},             // ON
@@ -55,11 +56,26 @@ bool CSporkManager::SporkValueIsActive(int nSporkID, int64_t &nActiveValueRet) c
     return false;
 }
 
+void CSporkManager::UpdateResolvedValues()
+{
+    LOCK(cs);
+    for (int i = 0; i < SPORK_COUNT; i++) {
+        int nSporkID = SPORK_START + i;
+        int64_t nValue;
+        if (!SporkValueIsActive(nSporkID, nValue)) {
+            auto it = mapSporkDefaults.find(nSporkID);
+            nValue = it != mapSporkDefaults.end() ? it->second : SPORK_VALUE_UNRESOLVED;
+        }
+        vResolvedValues[i] = nValue;
+    }
+}
+
 void CSporkManager::Clear()
 {
     LOCK(cs);
     mapSporksActive.clear();
     mapSporksByHash.clear();
+    UpdateResolvedValues();
     // sporkPubKeyID and sporkPrivKey should be set in init.cpp,
     // we should not alter them here.
 }
@@ -110,6 +126,8 @@ void CSporkManager::CheckAndRemove()
         }
         ++itByHash;
     }
+
+    UpdateResolvedValues();
 }
 
 void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)
@@ -175,6 +193,7 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
             LOCK(cs); // make sure to not lock this together with cs_main
             mapSporksByHash[hash] = spork;
             mapSporksActive[spork.nSporkID][keyIDSigner] = spork;
+            UpdateResolvedValues();
         }
         spork.Relay(connman);
 
@@ -239,6 +258,7 @@ bool CSporkManager::UpdateSpork(int nSporkID, int64_t nValue, CConnman& connman)
             LOCK(cs);
             mapSporksByHash[spork.GetHash()] = spork;
             mapSporksActive[nSporkID][keyIDSigner] = spork;
+            UpdateResolvedValues();
         }
         spork.Relay(connman);
         return true;
@@ -249,6 +269,13 @@ bool CSporkManager::UpdateSpork(int nSporkID, int64_t nValue, CConnman& connman)
 
 bool CSporkManager::IsSporkActive(int nSporkID)
 {
+    if (nSporkID >= SPORK_START && nSporkID <= SPORK_END) {
+        int64_t nResolvedValue = vResolvedValues[nSporkID - SPORK_START].load(std::memory_order_relaxed);
+        if (nResolvedValue != SPORK_VALUE_UNRESOLVED) {
+            return nResolvedValue < GetAdjustedTime();
+        }
+    }
+
     LOCK(cs);
     int64_t nSporkValue = -1;
 
@@ -266,6 +293,13 @@ bool CSporkManager::IsSporkActive(int nSporkID)
 
 int64_t CSporkManager::GetSporkValue(int nSporkID)
 {
+    if (nSporkID >= SPORK_START && nSporkID <= SPORK_END) {
+        int64_t nResolvedValue = vResolvedValues[nSporkID - SPORK_START].load(std::memory_order_relaxed);
+        if (nResolvedValue != SPORK_VALUE_UNRESOLVED) {
+            return nResolvedValue;
+        }
+    }
+
     LOCK(cs);
 
     int64_t nSporkValue = -1;
@@ -358,7 +392,9 @@ bool CSporkManager::SetMinSporkKeys(int minSporkKeys)
         LogPrintf("CSporkManager::SetMinSporkKeys -- Invalid min spork signers number: %d\n", minSporkKeys);
         return false;
     }
+    LOCK(cs);
     nMinSporkKeys = minSporkKeys;
+    UpdateResolvedValues();
     return true;
 }
 
@@ -10,6 +10,8 @@
 #include "utilstrencodings.h"
 #include "key.h"
 
+#include <atomic>
+#include <limits>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -37,6 +39,7 @@ static const int SPORK_102_IPFS_OBJECT_SIZE                             = 10101;
 
 static const int SPORK_START                                            = SPORK_2_INSTANTSEND_ENABLED;
 static const int SPORK_END                                              = SPORK_102_IPFS_OBJECT_SIZE;
+static const int SPORK_COUNT                                            = SPORK_END - SPORK_START + 1;
 
 extern std::map<int, int64_t> mapSporkDefaults;
 extern CSporkManager sporkManager;
@@ -148,15 +151,35 @@ private:
     int nMinSporkKeys;
     CKey sporkPrivKey;
 
+    /**
+     * The value of every spork from SPORK_START to SPORK_END, resolved from the spork messages, the signer
+     * threshold and the defaults. IsSporkActive and GetSporkValue are called for every transaction, islock and
+     * governance object, reading these doesn't need cs. SPORK_VALUE_UNRESOLVED until UpdateResolvedValues ran and
+     * for unknown sporks, these are looked up the slow way.
+     */
+    static const int64_t SPORK_VALUE_UNRESOLVED = std::numeric_limits<int64_t>::min();
+    std::atomic<int64_t> vResolvedValues[SPORK_COUNT];
+
     /**
      * SporkValueIsActive is used to get the value agreed upon by the majority
      * of signed spork messages for a given Spork ID.
      */
     bool SporkValueIsActive(int nSporkID, int64_t& nActiveValueRet) const;
 
+    /**
+     * UpdateResolvedValues has to be called whenever mapSporksActive or
+     * nMinSporkKeys changed.
+     */
+    void UpdateResolvedValues();
+
 public:
 
-    CSporkManager() {}
+    CSporkManager()
+    {
+        for (auto& nValue : vResolvedValues) {
+            nValue = SPORK_VALUE_UNRESOLVED;
+        }
+    }
 
     ADD_SERIALIZE_METHODS;
 
@@ -178,6 +201,9 @@ public:
         READWRITE(mapSporksByHash);
         READWRITE(mapSporksActive);
         // we don't serialize private key to prevent its leakage
+        if (ser_action.ForRead()) {
+            UpdateResolvedValues();
+        }
     }
 
     /**
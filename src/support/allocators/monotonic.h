@@ -0,0 +1,93 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef HTA_SUPPORT_ALLOCATORS_MONOTONIC_H
+#define HTA_SUPPORT_ALLOCATORS_MONOTONIC_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+//
+// Buffer that hands out memory from a few large chunks and only frees all of it at once, when it's destroyed.
+// Meant for many small objects with about the same lifetime, e.g. the transactions of a block.
+// This buffer is NOT thread safe
+//
+class CMonotonicBuffer
+{
+private:
+    std::vector<std::unique_ptr<char[]>> vChunks;
+    size_t nNextChunkSize;
+    char* pos{nullptr};
+    size_t nLeft{0};
+
+public:
+    explicit CMonotonicBuffer(size_t nInitialSize = 4096) : nNextChunkSize(std::max<size_t>(nInitialSize, 256)) {}
+    CMonotonicBuffer(const CMonotonicBuffer&) = delete;
+    CMonotonicBuffer& operator=(const CMonotonicBuffer&) = delete;
+
+    void* Allocate(size_t nSize, size_t nAlign)
+    {
+        size_t nPadding = (nAlign - reinterpret_cast<uintptr_t>(pos) % nAlign) % nAlign;
+        if (nPadding + nSize > nLeft) {
+            // chunks grow geometrically, so even a bad initial size needs only a few of them
+            size_t nChunkSize = std::max(nNextChunkSize, nSize + nAlign);
+            vChunks.emplace_back(new char[nChunkSize]);
+            pos = vChunks.back().get();
+            nLeft = nChunkSize;
+            nNextChunkSize = nChunkSize * 2;
+            nPadding = (nAlign - reinterpret_cast<uintptr_t>(pos) % nAlign) % nAlign;
+        }
+        char* ret = pos + nPadding;
+        pos = ret + nSize;
+        nLeft -= nPadding + nSize;
+        return ret;
+    }
+};
+
+//
+// Allocator that takes its memory from a shared CMonotonicBuffer, deallocate() does nothing. The buffer lives as long
+// as any copy of the allocator, e.g. std::allocate_shared keeps one in the control block of every object it creates,
+// so the buffer is freed together with the last of these objects
+//
+template <typename T>
+struct monotonic_allocator {
+    typedef T value_type;
+
+    std::shared_ptr<CMonotonicBuffer> buffer;
+
+    explicit monotonic_allocator(std::shared_ptr<CMonotonicBuffer> bufferIn) : buffer(std::move(bufferIn)) {}
+    template <typename U>
+    monotonic_allocator(const monotonic_allocator<U>& other) : buffer(other.buffer) {}
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(buffer->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+    }
+
+    template <typename U>
+    struct rebind {
+        typedef monotonic_allocator<U> other;
+    };
+};
+
+template <typename T, typename U>
+bool operator==(const monotonic_allocator<T>& a, const monotonic_allocator<U>& b)
+{
+    return a.buffer == b.buffer;
+}
+
+template <typename T, typename U>
+bool operator!=(const monotonic_allocator<T>& a, const monotonic_allocator<U>& b)
+{
+    return !(a == b);
+}
+
+#endif // HTA_SUPPORT_ALLOCATORS_MONOTONIC_H
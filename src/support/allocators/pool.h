@@ -0,0 +1,175 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef HTA_SUPPORT_ALLOCATORS_POOL_H
+#define HTA_SUPPORT_ALLOCATORS_POOL_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <list>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+//
+// Memory resource for node based containers, e.g. std::unordered_map. Blocks of up to MAX_BLOCK_SIZE_BYTES are cut
+// out of large chunks and freed blocks are kept in one free list per size, so allocating and freeing a node doesn't
+// go to malloc and doesn't pay malloc's per allocation overhead. Larger blocks (e.g. the bucket array of a hash map)
+// are forwarded to operator new. Chunks are only given back when the resource is destroyed.
+// This resource is NOT thread safe
+//
+template <std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+class CPoolResource
+{
+    static_assert(ALIGN_BYTES > 0 && (ALIGN_BYTES & (ALIGN_BYTES - 1)) == 0, "ALIGN_BYTES must be a power of two");
+    static_assert(ALIGN_BYTES <= alignof(std::max_align_t), "over-aligned blocks are not supported");
+
+    // free blocks store the next free block of the same size in place
+    struct ListNode {
+        ListNode* next;
+        explicit ListNode(ListNode* nextIn) : next(nextIn) {}
+    };
+    static_assert(std::is_trivially_destructible<ListNode>::value, "free blocks are reused without a destructor call");
+
+    static constexpr std::size_t ELEM_ALIGN_BYTES = std::max(alignof(ListNode), ALIGN_BYTES);
+    static_assert(sizeof(ListNode) <= ELEM_ALIGN_BYTES, "every block must be able to hold a ListNode");
+    static_assert(MAX_BLOCK_SIZE_BYTES % ELEM_ALIGN_BYTES == 0, "MAX_BLOCK_SIZE_BYTES must be a multiple of the alignment");
+
+    const std::size_t nChunkSize;
+    std::list<char*> listChunks;
+    std::array<ListNode*, MAX_BLOCK_SIZE_BYTES / ELEM_ALIGN_BYTES + 1> freeLists{};
+    char* pos{nullptr};
+    char* end{nullptr};
+
+    static constexpr std::size_t NumElemAlignBytes(std::size_t nBytes)
+    {
+        return (nBytes + ELEM_ALIGN_BYTES - 1) / ELEM_ALIGN_BYTES + (nBytes == 0);
+    }
+
+    static constexpr bool IsFreeListUsable(std::size_t nBytes, std::size_t nAlign)
+    {
+        return nAlign <= ELEM_ALIGN_BYTES && nBytes <= MAX_BLOCK_SIZE_BYTES;
+    }
+
+    void AddToFreeList(void* p, ListNode*& head)
+    {
+        head = new (p) ListNode(head);
+    }
+
+    void AllocateChunk()
+    {
+        // the rest of the current chunk is a multiple of ELEM_ALIGN_BYTES, keep it for blocks of that size
+        std::size_t nLeft = end - pos;
+        if (nLeft != 0) {
+            AddToFreeList(pos, freeLists[nLeft / ELEM_ALIGN_BYTES]);
+        }
+        // operator new returns memory suitably aligned for any fundamental type, which covers ELEM_ALIGN_BYTES
+        pos = static_cast<char*>(::operator new(nChunkSize));
+        end = pos + nChunkSize;
+        listChunks.emplace_back(pos);
+    }
+
+public:
+    explicit CPoolResource(std::size_t nChunkSizeIn = 256 * 1024) :
+        nChunkSize(NumElemAlignBytes(nChunkSizeIn) * ELEM_ALIGN_BYTES)
+    {
+        // the first chunk is allocated with the first block, so empty containers cost nothing
+        assert(nChunkSize >= MAX_BLOCK_SIZE_BYTES);
+    }
+
+    CPoolResource(const CPoolResource&) = delete;
+    CPoolResource& operator=(const CPoolResource&) = delete;
+
+    ~CPoolResource()
+    {
+        for (char* chunk : listChunks) {
+            ::operator delete(chunk);
+        }
+    }
+
+    void* Allocate(std::size_t nBytes, std::size_t nAlign)
+    {
+        if (!IsFreeListUsable(nBytes, nAlign)) {
+            return ::operator new(nBytes);
+        }
+        const std::size_t nElems = NumElemAlignBytes(nBytes);
+        if (freeLists[nElems] != nullptr) {
+            // ListNode is trivially destructible, the block can be handed out as is
+            return std::exchange(freeLists[nElems], freeLists[nElems]->next);
+        }
+        const std::ptrdiff_t nRoundBytes = static_cast<std::ptrdiff_t>(nElems * ELEM_ALIGN_BYTES);
+        if (nRoundBytes > end - pos) {
+            AllocateChunk();
+        }
+        return std::exchange(pos, pos + nRoundBytes);
+    }
+
+    void Deallocate(void* p, std::size_t nBytes, std::size_t nAlign) noexcept
+    {
+        if (!IsFreeListUsable(nBytes, nAlign)) {
+            ::operator delete(p);
+            return;
+        }
+        AddToFreeList(p, freeLists[NumElemAlignBytes(nBytes)]);
+    }
+
+    std::size_t NumAllocatedChunks() const { return listChunks.size(); }
+
+    std::size_t ChunkSizeBytes() const { return nChunkSize; }
+};
+
+template <std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+constexpr std::size_t CPoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>::ELEM_ALIGN_BYTES;
+
+//
+// Allocator that takes its memory from a CPoolResource, which has to outlive every container using it. Containers
+// with allocators of different resources can't swap or move their nodes into each other
+//
+template <typename T, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES = alignof(T)>
+class pool_allocator
+{
+public:
+    typedef T value_type;
+    typedef CPoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> resource_type;
+
+    pool_allocator(resource_type* resourceIn) noexcept : resource(resourceIn) {}
+    template <typename U>
+    pool_allocator(const pool_allocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& other) noexcept : resource(other.GetResource()) {}
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(resource->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        resource->Deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    resource_type* GetResource() const noexcept { return resource; }
+
+    template <typename U>
+    struct rebind {
+        typedef pool_allocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> other;
+    };
+
+private:
+    resource_type* resource;
+};
+
+template <typename T1, typename T2, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+bool operator==(const pool_allocator<T1, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& a, const pool_allocator<T2, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& b) noexcept
+{
+    return a.GetResource() == b.GetResource();
+}
+
+template <typename T1, typename T2, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+bool operator!=(const pool_allocator<T1, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& a, const pool_allocator<T2, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& b) noexcept
+{
+    return !(a == b);
+}
+
+#endif // HTA_SUPPORT_ALLOCATORS_POOL_H
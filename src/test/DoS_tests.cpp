@@ -9,6 +9,7 @@
 #include "net.h"
 #include "net_processing.h"
 #include "pow.h"
+#include "saltedhasher.h"
 #include "script/sign.h"
 #include "serialize.h"
 #include "util.h"
@@ -17,6 +18,7 @@
 #include "test/test_historia.h"
 
 #include <stdint.h>
+#include <unordered_map>
 
 #include <boost/assign/list_of.hpp> // for 'map_list_of()'
 #include <boost/date_time/posix_time/posix_time_types.hpp>
@@ -31,8 +33,10 @@ struct COrphanTx {
     CTransactionRef tx;
     NodeId fromPeer;
     int64_t nTimeExpire;
+    size_t list_pos;
+    size_t peer_pos;
 };
-extern std::map<uint256, COrphanTx> mapOrphanTransactions;
+extern std::unordered_map<uint256, COrphanTx, StaticSaltedHasher> mapOrphanTransactions;
 
 CService ip(uint32_t i)
 {
@@ -128,10 +132,8 @@ BOOST_AUTO_TEST_CASE(DoS_bantime)
 
 CTransactionRef RandomOrphan()
 {
-    std::map<uint256, COrphanTx>::iterator it;
-    it = mapOrphanTransactions.lower_bound(GetRandHash());
-    if (it == mapOrphanTransactions.end())
-        it = mapOrphanTransactions.begin();
+    auto it = mapOrphanTransactions.begin();
+    std::advance(it, GetRand(mapOrphanTransactions.size()));
     return it->second.tx;
 }
 
@@ -198,12 +200,48 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
         BOOST_CHECK(!AddOrphanTx(MakeTransactionRef(tx), i));
     }
 
+    // Test GetOrphanTx:
+    CTransactionRef txOrphan = RandomOrphan();
+    BOOST_CHECK(GetOrphanTx(txOrphan->GetHash()) == txOrphan);
+    BOOST_CHECK(GetOrphanTx(GetRandHash()) == nullptr);
+
     // Test EraseOrphansFor:
     for (NodeId i = 0; i < 3; i++)
     {
         size_t sizeBefore = mapOrphanTransactions.size();
         EraseOrphansFor(i);
         BOOST_CHECK(mapOrphanTransactions.size() < sizeBefore);
+        for (const auto& p : mapOrphanTransactions) {
+            BOOST_CHECK(p.second.fromPeer != i);
+        }
+    }
+
+    // A peer sending lots of orphans only pushes out its own ones
+    for (int i = 0; i < 30; i++)
+    {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout.n = 0;
+        tx.vin[0].prevout.hash = GetRandHash();
+        tx.vout.resize(1);
+        tx.vout[0].nValue = 1*CENT;
+        tx.vout[0].scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+        AddOrphanTx(MakeTransactionRef(tx), 1000);
+    }
+    std::map<NodeId, size_t> mapCountBefore;
+    for (const auto& p : mapOrphanTransactions) {
+        mapCountBefore[p.second.fromPeer]++;
+    }
+    LimitOrphanTxSize(mapOrphanTransactions.size() - 20);
+    std::map<NodeId, size_t> mapCountAfter;
+    for (const auto& p : mapOrphanTransactions) {
+        mapCountAfter[p.second.fromPeer]++;
+    }
+    BOOST_CHECK_EQUAL(mapCountAfter[1000], mapCountBefore[1000] - 20);
+    for (const auto& p : mapCountBefore) {
+        if (p.first != 1000) {
+            BOOST_CHECK_EQUAL(mapCountAfter[p.first], p.second);
+        }
     }
 
     // Test LimitOrphanTxSize() function:
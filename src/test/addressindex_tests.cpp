@@ -0,0 +1,72 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txdb.h"
+
+#include "test/test_historia.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(addressindex_tests, TestingSetup)
+
+static void CheckBalance(CAddressIndexDB& db, const uint160& addressHash, CAmount balance, CAmount received, int64_t txCount)
+{
+    CAddressBalance addressBalance;
+    BOOST_REQUIRE(db.ReadAddressBalance(addressHash, 1, addressBalance));
+    BOOST_CHECK_EQUAL(addressBalance.balance, balance);
+    BOOST_CHECK_EQUAL(addressBalance.received, received);
+    BOOST_CHECK_EQUAL(addressBalance.txCount, txCount);
+}
+
+BOOST_AUTO_TEST_CASE(address_balances)
+{
+    CAddressIndexDB db(1 << 20, true, true);
+    BOOST_CHECK(db.UpgradeAddressBalances());
+    BOOST_CHECK(db.HasAddressBalances());
+
+    uint160 addressA = uint160(std::vector<unsigned char>(20, 0x0a));
+    uint160 addressB = uint160(std::vector<unsigned char>(20, 0x0b));
+    uint256 txid1 = uint256S("0x01");
+    uint256 txid2 = uint256S("0x02");
+
+    // tx 1 pays 10 and 5 to A, tx 2 spends the 10 and pays 7 to B and 2 back to A
+    std::vector<std::pair<CAddressIndexKey, CAmount> > block1 = {
+        {CAddressIndexKey(1, addressA, 1, 1, txid1, 0, false), 10},
+        {CAddressIndexKey(1, addressA, 1, 1, txid1, 1, false), 5},
+    };
+    std::vector<std::pair<CAddressIndexKey, CAmount> > block2 = {
+        {CAddressIndexKey(1, addressA, 2, 1, txid2, 0, true), -10},
+        {CAddressIndexKey(1, addressB, 2, 1, txid2, 0, false), 7},
+        {CAddressIndexKey(1, addressA, 2, 1, txid2, 1, false), 2},
+    };
+    BOOST_CHECK(db.WriteAddressIndex(block1));
+    BOOST_CHECK(db.WriteAddressIndex(block2));
+    CheckBalance(db, addressA, 7, 17, 2);
+    CheckBalance(db, addressB, 7, 7, 1);
+
+    // writing the same entries again after a crash doesn't count them twice
+    BOOST_CHECK(db.WriteAddressIndex(block2));
+    CheckBalance(db, addressA, 7, 17, 2);
+
+    // disconnecting block 2 subtracts what was written
+    BOOST_CHECK(db.EraseAddressIndex(block2));
+    CheckBalance(db, addressA, 15, 15, 1);
+    CheckBalance(db, addressB, 0, 0, 0);
+    BOOST_CHECK(db.EraseAddressIndex(block2));
+    CheckBalance(db, addressA, 15, 15, 1);
+
+    // the balances built from the entries of an older database match the maintained ones
+    BOOST_CHECK(db.WriteAddressIndex(block2));
+    CAddressIndexDB dbOld(1 << 20, true, true);
+    BOOST_CHECK(!dbOld.HasAddressBalances());
+    CAddressBalance addressBalance;
+    BOOST_CHECK(!dbOld.ReadAddressBalance(addressA, 1, addressBalance));
+    BOOST_CHECK(dbOld.WriteAddressIndex(block1));
+    BOOST_CHECK(dbOld.WriteAddressIndex(block2));
+    BOOST_CHECK(dbOld.UpgradeAddressBalances());
+    CheckBalance(dbOld, addressA, 7, 17, 2);
+    CheckBalance(dbOld, addressB, 7, 7, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 #include "addrman.h"
 #include "test/test_historia.h"
+#include <set>
 #include <string>
 #include <boost/test/unit_test.hpp>
 
@@ -24,7 +25,6 @@ public:
     void MakeDeterministic()
     {
         nKey.SetNull();
-        insecure_rand = FastRandomContext(true);
     }
 
     int RandomInt(int nMax) override
@@ -209,6 +209,32 @@ BOOST_AUTO_TEST_CASE(addrman_select)
     BOOST_CHECK(addrman.Select().ToString() == "250.4.4.4:8333");
 }
 
+BOOST_AUTO_TEST_CASE(addrman_select_sparse)
+{
+    CAddrManTest addrman;
+
+    // Set addrman addr placement to be deterministic.
+    addrman.MakeDeterministic();
+
+    CNetAddr source = ResolveIP("252.2.2.2");
+
+    // Test 36: Select finds the only entries of an almost empty table, and
+    //  returns each of them at some point.
+    CService addr1 = ResolveService("250.1.1.1", 8333);
+    CService addr2 = ResolveService("251.1.1.1", 8333);
+    addrman.Add(CAddress(addr1, NODE_NONE), source);
+    addrman.Add(CAddress(addr2, NODE_NONE), source);
+    BOOST_CHECK(addrman.size() == 2);
+
+    std::set<std::string> selected;
+    for (int i = 0; i < 100; i++) {
+        selected.insert(addrman.Select(true).ToString());
+    }
+    BOOST_CHECK(selected.size() == 2);
+    BOOST_CHECK(selected.count("250.1.1.1:8333") == 1);
+    BOOST_CHECK(selected.count("251.1.1.1:8333") == 1);
+}
+
 BOOST_AUTO_TEST_CASE(addrman_new_collisions)
 {
     CAddrManTest addrman;
@@ -351,6 +377,16 @@ BOOST_AUTO_TEST_CASE(addrman_delete)
     BOOST_CHECK(addrman.size() == 0);
     CAddrInfo* info2 = addrman.Find(addr1);
     BOOST_CHECK(info2 == NULL);
+
+    // Test 35: The nId of a deleted entry is reused by the next Create.
+    CAddress addr2 = CAddress(ResolveService("250.1.2.2", 8333), NODE_NONE);
+    int nId2;
+    CAddrInfo* pinfo = addrman.Create(addr2, source1, &nId2);
+    BOOST_CHECK(nId2 == nId);
+    BOOST_CHECK(pinfo->ToString() == "250.1.2.2:8333");
+    BOOST_CHECK(addrman.Find(addr1) == NULL);
+    BOOST_CHECK(addrman.Find(addr2) == pinfo);
+    BOOST_CHECK(addrman.size() == 1);
 }
 
 BOOST_AUTO_TEST_CASE(addrman_getaddr)
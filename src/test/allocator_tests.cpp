@@ -4,8 +4,15 @@
 
 #include "util.h"
 
+#include "primitives/block.h"
+#include "streams.h"
+#include "support/allocators/monotonic.h"
+#include "support/allocators/pool.h"
 #include "support/allocators/secure.h"
 #include "test/test_historia.h"
+#include "version.h"
+
+#include <unordered_map>
 
 #include <boost/test/unit_test.hpp>
 
@@ -231,4 +238,132 @@ BOOST_AUTO_TEST_CASE(lockedpool_tests_live)
     BOOST_CHECK(pool.stats().used == initial.used);
 }
 
+BOOST_AUTO_TEST_CASE(monotonic_allocator_tests)
+{
+    std::shared_ptr<CMonotonicBuffer> buffer = std::make_shared<CMonotonicBuffer>(256);
+    std::weak_ptr<CMonotonicBuffer> weakBuffer = buffer;
+
+    // allocations are aligned, also across chunks
+    for (size_t i = 1; i < 100; i++) {
+        void* p = buffer->Allocate(i, 8);
+        BOOST_CHECK(reinterpret_cast<uintptr_t>(p) % 8 == 0);
+        memset(p, 0xff, i);
+    }
+    void* pLarge = buffer->Allocate(10000, 16);
+    BOOST_CHECK(reinterpret_cast<uintptr_t>(pLarge) % 16 == 0);
+    memset(pLarge, 0xff, 10000);
+
+    // the buffer lives until the last object allocated through a copy of the allocator is gone
+    monotonic_allocator<uint256> alloc(buffer);
+    std::shared_ptr<const uint256> a = std::allocate_shared<const uint256>(alloc, uint256S("01"));
+    std::shared_ptr<const uint256> b = std::allocate_shared<const uint256>(alloc, uint256S("02"));
+    buffer.reset();
+    alloc = monotonic_allocator<uint256>(std::make_shared<CMonotonicBuffer>());
+    BOOST_CHECK(!weakBuffer.expired());
+    a.reset();
+    BOOST_CHECK(!weakBuffer.expired());
+    BOOST_CHECK(*b == uint256S("02"));
+    b.reset();
+    BOOST_CHECK(weakBuffer.expired());
+}
+
+BOOST_AUTO_TEST_CASE(block_transactions_monotonic)
+{
+    CBlock block;
+    for (int i = 0; i < 10; i++) {
+        CMutableTransaction mtx;
+        mtx.vin.resize(i + 1);
+        mtx.vin[0].prevout.n = i;
+        mtx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(100, i);
+        mtx.vout.resize(1);
+        mtx.vout[0].nValue = i;
+        block.vtx.emplace_back(MakeTransactionRef(std::move(mtx)));
+    }
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block;
+    std::string strBlock = ss.str();
+    CTransactionRef tx;
+    {
+        CBlock block2;
+        ss >> block2;
+        BOOST_CHECK_EQUAL(block2.vtx.size(), block.vtx.size());
+        for (size_t i = 0; i < block.vtx.size(); i++) {
+            BOOST_CHECK(block2.vtx[i]->GetHash() == block.vtx[i]->GetHash());
+        }
+        CDataStream ss2(SER_NETWORK, PROTOCOL_VERSION);
+        ss2 << block2;
+        BOOST_CHECK(ss2.str() == strBlock);
+        tx = block2.vtx[5];
+    }
+    // transactions outlive the block they were read with
+    BOOST_CHECK(tx->GetHash() == block.vtx[5]->GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(pool_resource_tests)
+{
+    CPoolResource<64, 8> resource(1024);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 0);
+
+    // blocks are aligned and freed blocks are reused for the same size
+    void* a = resource.Allocate(24, 8);
+    BOOST_CHECK(reinterpret_cast<uintptr_t>(a) % 8 == 0);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1);
+    resource.Deallocate(a, 24, 8);
+    void* b = resource.Allocate(17, 8);
+    BOOST_CHECK(a == b);
+    void* c = resource.Allocate(32, 8);
+    BOOST_CHECK(c != b);
+    resource.Deallocate(b, 17, 8);
+    resource.Deallocate(c, 32, 8);
+
+    // new chunks are only allocated once the current one is used up
+    std::vector<void*> blocks;
+    for (int i = 0; i < 1024 / 64 * 3; i++) {
+        blocks.push_back(resource.Allocate(64, 8));
+        memset(blocks.back(), 0xff, 64);
+    }
+    BOOST_CHECK(resource.NumAllocatedChunks() >= 3 && resource.NumAllocatedChunks() <= 4);
+
+    // blocks which are too large bypass the pool
+    void* pLarge = resource.Allocate(1000, 8);
+    memset(pLarge, 0xff, 1000);
+    resource.Deallocate(pLarge, 1000, 8);
+    BOOST_CHECK(resource.NumAllocatedChunks() <= 4);
+
+    for (void* p : blocks) {
+        resource.Deallocate(p, 64, 8);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(pool_allocator_unordered_map)
+{
+    typedef pool_allocator<std::pair<const uint64_t, uint256>, sizeof(std::pair<const uint64_t, uint256>) + sizeof(void*) * 4, alignof(void*)> alloc_t;
+    typedef std::unordered_map<uint64_t, uint256, std::hash<uint64_t>, std::equal_to<uint64_t>, alloc_t> map_t;
+
+    alloc_t::resource_type resource;
+    map_t map(0, std::hash<uint64_t>(), std::equal_to<uint64_t>(), &resource);
+    for (int i = 0; i < 10000; i++) {
+        map.emplace(i, ArithToUint256(i));
+    }
+    for (int i = 0; i < 10000; i += 2) {
+        map.erase(i);
+    }
+    size_t nChunks = resource.NumAllocatedChunks();
+    // the erased nodes' memory is reused
+    for (int i = 0; i < 10000; i += 2) {
+        map.emplace(i, ArithToUint256(i));
+    }
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), nChunks);
+    BOOST_CHECK_EQUAL(map.size(), 10000);
+    for (int i = 0; i < 10000; i++) {
+        BOOST_CHECK(map.at(i) == ArithToUint256(i));
+    }
+
+    // the usage of a pooled map is that of its chunks and buckets, which is less than a malloc per node
+    size_t nUsage = memusage::DynamicUsage(map);
+    BOOST_CHECK(nUsage >= resource.NumAllocatedChunks() * resource.ChunkSizeBytes());
+    BOOST_CHECK(nUsage < memusage::MallocUsage(sizeof(memusage::unordered_node<std::pair<const uint64_t, uint256>>)) * map.size() + memusage::MallocUsage(sizeof(void*) * map.bucket_count()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
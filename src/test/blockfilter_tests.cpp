@@ -0,0 +1,141 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilter.h"
+#include "coins.h"
+#include "primitives/block.h"
+#include "script/script.h"
+#include "undo.h"
+
+#include "test/test_historia.h"
+#include "test/test_random.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockfilter_tests, BasicTestingSetup)
+
+static GCSFilter::Element RandomElement()
+{
+    GCSFilter::Element element(1 + insecure_rand() % 40);
+    for (auto& c : element) {
+        c = insecure_rand() % 256;
+    }
+    return element;
+}
+
+BOOST_AUTO_TEST_CASE(gcsfilter_match)
+{
+    GCSFilter::ElementSet included, excluded;
+    for (int i = 0; i < 100; i++) {
+        included.insert(RandomElement());
+        excluded.insert(RandomElement());
+    }
+
+    GCSFilter filter(0, 0, 10, 1 << 10, included);
+    BOOST_CHECK_EQUAL(filter.GetN(), included.size());
+    for (const auto& element : included) {
+        BOOST_CHECK(filter.Match(element));
+    }
+
+    GCSFilter::ElementSet mixed = excluded;
+    mixed.insert(*included.begin());
+    BOOST_CHECK(filter.MatchAny(mixed));
+    BOOST_CHECK(!filter.MatchAny({}));
+
+    // with the basic parameters false positives are rare enough to never show up here
+    GCSFilter basicFilter(0, 0, GCSFilter::BASIC_P, GCSFilter::BASIC_M, included);
+    for (const auto& element : excluded) {
+        if (!included.count(element)) {
+            BOOST_CHECK(!basicFilter.Match(element));
+        }
+    }
+
+    GCSFilter emptyFilter;
+    BOOST_CHECK_EQUAL(emptyFilter.GetN(), 0);
+    BOOST_CHECK(emptyFilter.GetEncoded() == std::vector<unsigned char>{0});
+    BOOST_CHECK(!emptyFilter.Match(*included.begin()));
+}
+
+BOOST_AUTO_TEST_CASE(gcsfilter_encoding)
+{
+    GCSFilter::ElementSet elements;
+    for (int i = 0; i < 500; i++) {
+        elements.insert(RandomElement());
+    }
+    GCSFilter filter(1, 2, GCSFilter::BASIC_P, GCSFilter::BASIC_M, elements);
+
+    GCSFilter decoded(1, 2, GCSFilter::BASIC_P, GCSFilter::BASIC_M, filter.GetEncoded());
+    BOOST_CHECK_EQUAL(decoded.GetN(), elements.size());
+    BOOST_CHECK(decoded.GetEncoded() == filter.GetEncoded());
+    for (const auto& element : elements) {
+        BOOST_CHECK(decoded.Match(element));
+    }
+
+    // truncated filters and trailing data are rejected
+    std::vector<unsigned char> vch = filter.GetEncoded();
+    vch.pop_back();
+    BOOST_CHECK_THROW(GCSFilter(1, 2, GCSFilter::BASIC_P, GCSFilter::BASIC_M, vch), std::ios_base::failure);
+    vch = filter.GetEncoded();
+    vch.push_back(0);
+    BOOST_CHECK_THROW(GCSFilter(1, 2, GCSFilter::BASIC_P, GCSFilter::BASIC_M, vch), std::ios_base::failure);
+    BOOST_CHECK_THROW(GCSFilter(1, 2, GCSFilter::BASIC_P, GCSFilter::BASIC_M, std::vector<unsigned char>()), std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(blockfilter_basic)
+{
+    CScript includedScripts[5], excludedScripts[3];
+    includedScripts[0] << std::vector<unsigned char>(32, 1) << OP_CHECKSIG;
+    includedScripts[1] << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 2) << OP_EQUALVERIFY << OP_CHECKSIG;
+    includedScripts[2] << OP_HASH160 << std::vector<unsigned char>(20, 3) << OP_EQUAL;
+    // spent outputs
+    includedScripts[3] << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 4) << OP_EQUALVERIFY << OP_CHECKSIG;
+    includedScripts[4] << OP_2 << std::vector<unsigned char>(33, 5) << OP_CHECKSIG;
+
+    excludedScripts[0] << OP_RETURN << std::vector<unsigned char>(4, 6);
+    excludedScripts[1] << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 7) << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    CMutableTransaction tx1;
+    tx1.vout.resize(2);
+    tx1.vout[0].scriptPubKey = includedScripts[0];
+    tx1.vout[1].scriptPubKey = includedScripts[1];
+    CMutableTransaction tx2;
+    tx2.vout.resize(3);
+    tx2.vout[0].scriptPubKey = includedScripts[2];
+    tx2.vout[1].scriptPubKey = excludedScripts[0];
+    // empty scripts are skipped
+    tx2.vout[2].scriptPubKey = excludedScripts[2];
+
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(tx1));
+    block.vtx.push_back(MakeTransactionRef(tx2));
+
+    CBlockUndo blockundo;
+    blockundo.vtxundo.resize(1);
+    blockundo.vtxundo[0].vprevout.emplace_back(CTxOut(100, includedScripts[3]), 1000, false);
+    blockundo.vtxundo[0].vprevout.emplace_back(CTxOut(100, includedScripts[4]), 1000, false);
+    blockundo.vtxundo[0].vprevout.emplace_back(CTxOut(100, excludedScripts[2]), 1000, false);
+
+    BlockFilter blockFilter(BLOCK_FILTER_BASIC, block, blockundo);
+    const GCSFilter& filter = blockFilter.GetFilter();
+    BOOST_CHECK_EQUAL(filter.GetN(), 5);
+    for (const auto& script : includedScripts) {
+        BOOST_CHECK(filter.Match(GCSFilter::Element(script.begin(), script.end())));
+    }
+    for (const auto& script : excludedScripts) {
+        BOOST_CHECK(!filter.Match(GCSFilter::Element(script.begin(), script.end())));
+    }
+
+    // decoding the filter gives the same filter, keyed by the block hash
+    BlockFilter decoded(BLOCK_FILTER_BASIC, block.GetHash(), blockFilter.GetEncodedFilter());
+    BOOST_CHECK(decoded.GetHash() == blockFilter.GetHash());
+    BOOST_CHECK(decoded.GetFilter().Match(GCSFilter::Element(includedScripts[0].begin(), includedScripts[0].end())));
+
+    // headers chain the filter hashes
+    uint256 header = blockFilter.ComputeHeader(uint256());
+    BOOST_CHECK(header != blockFilter.GetHash());
+    BOOST_CHECK(blockFilter.ComputeHeader(header) != header);
+    BOOST_CHECK(decoded.ComputeHeader(uint256()) == header);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,9 @@
 
 #include "bls/bls.h"
 #include "bls/bls_batchverifier.h"
+#include "bls/bls_sigcache.h"
+#include "bls/bls_worker.h"
+#include "streams.h"
 #include "test/test_historia.h"
 
 #include <boost/test/unit_test.hpp>
@@ -154,4 +157,134 @@ BOOST_AUTO_TEST_CASE(batch_verifier_tests)
     Verify(msgs);
 }
 
+BOOST_AUTO_TEST_CASE(bls_sigcache_tests)
+{
+    CBLSSecretKey sk1, sk2;
+    sk1.MakeNewKey();
+    sk2.MakeNewKey();
+    CBLSPublicKey pk1 = sk1.GetPublicKey();
+    CBLSPublicKey pk2 = sk2.GetPublicKey();
+
+    uint256 msgHash1 = uint256S("0000000000000000000000000000000000000000000000000000000000000011");
+    uint256 msgHash2 = uint256S("0000000000000000000000000000000000000000000000000000000000000012");
+    auto sig1 = sk1.Sign(msgHash1);
+
+    // only valid signatures are remembered, and only for the key and message they are valid for
+    BOOST_CHECK(!IsBLSSigCached(sig1, pk1, msgHash1));
+    BOOST_CHECK(!VerifyBLSSigCached(sig1, pk2, msgHash1));
+    BOOST_CHECK(!VerifyBLSSigCached(sig1, pk1, msgHash2));
+    BOOST_CHECK(!IsBLSSigCached(sig1, pk2, msgHash1));
+    BOOST_CHECK(!IsBLSSigCached(sig1, pk1, msgHash2));
+    BOOST_CHECK(VerifyBLSSigCached(sig1, pk1, msgHash1));
+    BOOST_CHECK(IsBLSSigCached(sig1, pk1, msgHash1));
+    BOOST_CHECK(VerifyBLSSigCached(sig1, pk1, msgHash1));
+
+    // securely aggregated signatures don't share entries with single ones
+    std::vector<CBLSPublicKey> pks = {pk1, pk2};
+    auto aggSig = CBLSSignature::AggregateSecure({sig1, sk2.Sign(msgHash1)}, pks, msgHash1);
+    BOOST_CHECK(!VerifyBLSSigSecureAggregatedCached(aggSig, pks, msgHash2));
+    BOOST_CHECK(VerifyBLSSigSecureAggregatedCached(aggSig, pks, msgHash1));
+    BOOST_CHECK(VerifyBLSSigSecureAggregatedCached(aggSig, pks, msgHash1));
+    BOOST_CHECK(!IsBLSSigCached(aggSig, pk1, msgHash1));
+
+    // the batch verifier adds valid messages and skips cached ones
+    std::vector<Message> msgs;
+    AddMessage(msgs, 1, 1, 101, true);
+    AddMessage(msgs, 1, 2, 102, true);
+    AddMessage(msgs, 2, 3, 103, false);
+    AddMessage(msgs, 3, 4, 104, true);
+    for (bool secureVerification : {false, true}) {
+        for (int i = 0; i < 2; i++) {
+            CBLSBatchVerifier<uint32_t, uint32_t> batchVerifier(secureVerification, true, 0, true);
+            for (auto& m : msgs) {
+                batchVerifier.PushMessage(m.sourceId, m.msgId, m.msgHash, m.sig, m.pk);
+            }
+            batchVerifier.Verify();
+            BOOST_CHECK(batchVerifier.badSources == std::set<uint32_t>{2});
+            BOOST_CHECK(batchVerifier.badMessages == std::set<uint32_t>{3});
+        }
+    }
+    for (auto& m : msgs) {
+        BOOST_CHECK(IsBLSSigCached(m.sig, m.pk, m.msgHash) == m.valid);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(bls_lazy_tests)
+{
+    CBLSSecretKey sk;
+    sk.MakeNewKey();
+    CBLSPublicKey pk = sk.GetPublicKey();
+    CBLSSignature sig = sk.Sign(uint256S("1"));
+
+    // lazy objects must serialize and hash exactly like the objects they wrap
+    CBLSLazyPublicKey lazyPk;
+    lazyPk.Set(pk);
+    BOOST_CHECK(::SerializeHash(lazyPk) == ::SerializeHash(pk));
+    BOOST_CHECK(lazyPk.GetHash() == pk.GetHash());
+
+    CDataStream ds(SER_NETWORK, PROTOCOL_VERSION);
+    ds << sig;
+    CBLSLazySignature lazySig;
+    ds >> lazySig;
+    BOOST_CHECK(lazySig.GetHash() == sig.GetHash());
+    BOOST_CHECK(lazySig.Get() == sig);
+    BOOST_CHECK(lazySig.Get().VerifyInsecure(pk, uint256S("1")));
+
+    // a buffer which doesn't decode to a valid signature results in an invalid object, not in an exception
+    std::vector<unsigned char> vchInvalid(CBLSSignature::SerSize, 0xff);
+    CDataStream ds2(vchInvalid, SER_NETWORK, PROTOCOL_VERSION);
+    ds2 >> lazySig;
+    BOOST_CHECK(!lazySig.Get().IsValid());
+
+    // the default wrapper is the null object
+    BOOST_CHECK(!CBLSLazyPublicKey().Get().IsValid());
+}
+
+BOOST_AUTO_TEST_CASE(bls_worker_ies_tests)
+{
+    CBLSWorker worker;
+    worker.Start();
+
+    const size_t count = 20;
+    BLSSecretKeyVector recipientSks(count);
+    BLSPublicKeyVector recipients(count);
+    BLSSecretKeyVector skShares(count);
+    for (size_t i = 0; i < count; i++) {
+        recipientSks[i].MakeNewKey();
+        recipients[i] = recipientSks[i].GetPublicKey();
+        skShares[i].MakeNewKey();
+    }
+
+    std::vector<std::shared_ptr<CBLSIESMultiRecipientObjects<CBLSSecretKey>>> contributions;
+    for (size_t i = 0; i < 3; i++) {
+        auto c = std::make_shared<CBLSIESMultiRecipientObjects<CBLSSecretKey>>();
+        BOOST_CHECK(worker.EncryptContributions(recipients, skShares, *c, PROTOCOL_VERSION));
+        BOOST_CHECK(c->blobs.size() == count);
+        contributions.emplace_back(c);
+    }
+    BOOST_CHECK(!worker.EncryptContributions(BLSPublicKeyVector(1), skShares, *contributions[0], PROTOCOL_VERSION));
+    BOOST_CHECK(worker.EncryptContributions(recipients, skShares, *contributions[0], PROTOCOL_VERSION));
+
+    for (size_t i = 0; i < count; i++) {
+        // the parallel encryption must be decryptable by the serial code
+        CBLSSecretKey sk;
+        BOOST_CHECK(contributions[0]->Decrypt(i, recipientSks[i], sk, PROTOCOL_VERSION));
+        BOOST_CHECK(sk == skShares[i]);
+
+        auto decrypted = worker.DecryptContributionShares(contributions, i, recipientSks[i], PROTOCOL_VERSION);
+        BOOST_CHECK(decrypted.size() == contributions.size());
+        for (const auto& sk2 : decrypted) {
+            BOOST_CHECK(sk2 == skShares[i]);
+        }
+    }
+
+    // out of range shares are returned as invalid keys
+    auto decrypted = worker.DecryptContributionShares(contributions, count, recipientSks[0], PROTOCOL_VERSION);
+    for (const auto& sk : decrypted) {
+        BOOST_CHECK(!sk.IsValid());
+    }
+
+    worker.Stop();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -133,4 +133,51 @@ BOOST_AUTO_TEST_CASE(cachemap_test)
     BOOST_CHECK(Compare(cmapTest1, mapTest4));
 }
 
+BOOST_AUTO_TEST_CASE(cachemap_many_items)
+{
+    // enough items to grow the index and to erase from long probe sequences
+    CacheMap<int,int> cmapTest(1000);
+    for(int i = 0; i < 5000; ++i) {
+        BOOST_CHECK(cmapTest.Insert(i, i * 2));
+        if(i % 3 == 0) {
+            cmapTest.Erase(i - 1);
+        }
+    }
+    BOOST_CHECK(cmapTest.GetSize() == 1000);
+
+    int nFound = 0;
+    for(int i = 0; i < 5000; ++i) {
+        int nVal = 0;
+        if(cmapTest.Get(i, nVal)) {
+            BOOST_CHECK(nVal == i * 2);
+            BOOST_CHECK(i >= 3500 && (i % 3) != 2);
+            nFound++;
+        }
+    }
+    BOOST_CHECK(nFound == 1000);
+
+    // items are ordered from the newest to the oldest
+    const CacheMap<int,int>::list_t& items = cmapTest.GetItemList();
+    int nLast = 5000;
+    for(CacheMap<int,int>::list_cit it = items.begin(); it != items.end(); ++it) {
+        BOOST_CHECK(it->key < nLast);
+        nLast = it->key;
+    }
+
+    // erasing while iterating only invalidates the erased item
+    CacheMap<int,int>::list_cit it = items.begin();
+    while(it != items.end()) {
+        CacheMap<int,int>::list_cit prevIt = it;
+        ++it;
+        if(prevIt->key % 2 == 0) {
+            cmapTest.Erase(prevIt->key);
+        }
+    }
+    for(it = items.begin(); it != items.end(); ++it) {
+        BOOST_CHECK(it->key % 2 == 1);
+        BOOST_CHECK(cmapTest.HasKey(it->key));
+    }
+    BOOST_CHECK(!cmapTest.HasKey(4998));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
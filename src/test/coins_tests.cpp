@@ -4,6 +4,7 @@
 
 #include "coins.h"
 #include "script/standard.h"
+#include "txdb.h"
 #include "uint256.h"
 #include "undo.h"
 #include "utilstrencodings.h"
@@ -587,7 +588,8 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags)
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
-    CCoinsMap map;
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource);
     InsertCoinsMapEntry(map, value, flags);
     view.BatchWrite(map, {});
 }
@@ -657,6 +659,41 @@ BOOST_AUTO_TEST_CASE(ccoins_access)
     CheckAccessCoin(VALUE1, VALUE2, VALUE2, DIRTY|FRESH, DIRTY|FRESH);
 }
 
+void CheckFetchedCoin(CAmount base_value, CAmount cache_value, char cache_flags)
+{
+    // Adding a coin which was read from the base view must leave the cache in
+    // the same state as fetching it through AccessCoin
+    SingleEntryCacheTest expected(base_value, cache_value, cache_flags);
+    expected.cache.AccessCoin(OUTPOINT);
+
+    SingleEntryCacheTest test(base_value, cache_value, cache_flags);
+    Coin coin;
+    if (test.base.GetCoin(OUTPOINT, coin)) {
+        test.cache.AddFetchedCoin(OUTPOINT, std::move(coin));
+    }
+    test.cache.SelfTest();
+
+    CAmount expected_value, result_value;
+    char expected_flags, result_flags;
+    GetCoinsMapEntry(expected.cache.map(), expected_value, expected_flags);
+    GetCoinsMapEntry(test.cache.map(), result_value, result_flags);
+    BOOST_CHECK_EQUAL(result_value, expected_value);
+    BOOST_CHECK_EQUAL(result_flags, expected_flags);
+    BOOST_CHECK_EQUAL(test.cache.DynamicMemoryUsage(), expected.cache.DynamicMemoryUsage());
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_add_fetched)
+{
+    for (CAmount base_value : {ABSENT, PRUNED, VALUE1}) {
+        CheckFetchedCoin(base_value, ABSENT, NO_ENTRY);
+        for (CAmount cache_value : {PRUNED, VALUE2}) {
+            for (char cache_flags : FLAGS) {
+                CheckFetchedCoin(base_value, cache_value, cache_flags);
+            }
+        }
+    }
+}
+
 void CheckSpendCoins(CAmount base_value, CAmount cache_value, CAmount expected_value, char cache_flags, char expected_flags)
 {
     SingleEntryCacheTest test(base_value, cache_value, cache_flags);
@@ -856,4 +893,42 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_background_flush)
+{
+    CCoinsViewDB db(1 << 20, true, true);
+    CCoinsViewDBFlusher flusher(&db);
+    CCoinsViewCache cache(&flusher);
+
+    COutPoint outpoint1(GetRandHash(), 0);
+    COutPoint outpoint2(GetRandHash(), 1);
+    CTxOut txout;
+    txout.nValue = VALUE1;
+    txout.scriptPubKey.assign(insecure_rand() % 64, 0);
+    cache.AddCoin(outpoint1, Coin(txout, 1, false), false);
+    cache.AddCoin(outpoint2, Coin(txout, 1, false), false);
+    uint256 hashBlock1 = GetRandHash();
+    cache.SetBestBlock(hashBlock1);
+    BOOST_CHECK(cache.Flush());
+
+    // entries are readable through the flusher before and after they are written
+    Coin coin;
+    BOOST_CHECK(flusher.GetCoin(outpoint1, coin) && coin.out == txout);
+    BOOST_CHECK(flusher.GetBestBlock() == hashBlock1);
+    BOOST_CHECK(flusher.WaitForFlush());
+    BOOST_CHECK_EQUAL(flusher.GetPendingUsage(), 0U);
+    BOOST_CHECK(db.GetCoin(outpoint1, coin) && coin.out == txout);
+    BOOST_CHECK(db.GetBestBlock() == hashBlock1);
+
+    // spends hide the coin in the database until they are written
+    BOOST_CHECK(cache.SpendCoin(outpoint2));
+    uint256 hashBlock2 = GetRandHash();
+    cache.SetBestBlock(hashBlock2);
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(!flusher.HaveCoin(outpoint2));
+    BOOST_CHECK(flusher.HaveCoin(outpoint1));
+    BOOST_CHECK(flusher.WaitForFlush());
+    BOOST_CHECK(!db.HaveCoin(outpoint2));
+    BOOST_CHECK(db.GetBestBlock() == hashBlock2);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -81,6 +81,100 @@ BOOST_AUTO_TEST_CASE(dbwrapper_batch)
     }
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_readmany)
+{
+    // Perform tests both obfuscated and non-obfuscated.
+    for (int i = 0; i < 2; i++) {
+        bool obfuscate = (bool)i;
+        boost::filesystem::path ph = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+        CDBWrapper dbw(ph, (1 << 20), true, false, obfuscate);
+
+        std::vector<uint256> vIn;
+        for (int j = 0; j < 10; j++) {
+            vIn.emplace_back(GetRandHash());
+            BOOST_CHECK(dbw.Write(std::make_pair('k', j * 2), vIn.back()));
+        }
+
+        // unsorted, with missing and duplicate keys
+        std::vector<std::pair<char, int> > vKeys = {{'k', 18}, {'k', 1}, {'k', 0}, {'k', 6}, {'k', 40}, {'k', 6}};
+        CDBReadStats statsBefore = dbw.GetReadStats();
+
+        std::vector<uint256> vOut;
+        std::vector<bool> vFound;
+        BOOST_CHECK_EQUAL(dbw.ReadMany(vKeys, vOut, vFound), 4U);
+        BOOST_REQUIRE_EQUAL(vOut.size(), vKeys.size());
+        BOOST_REQUIRE_EQUAL(vFound.size(), vKeys.size());
+        for (size_t j = 0; j < vKeys.size(); j++) {
+            bool fExpected = vKeys[j].second < 20 && vKeys[j].second % 2 == 0;
+            BOOST_CHECK_EQUAL(vFound[j], fExpected);
+            if (fExpected) {
+                BOOST_CHECK(vOut[j] == vIn[vKeys[j].second / 2]);
+            }
+        }
+
+        CDBReadStats stats = dbw.GetReadStats();
+        BOOST_CHECK_EQUAL(stats.nMultiReads - statsBefore.nMultiReads, 1U);
+        BOOST_CHECK_EQUAL(stats.nReads - statsBefore.nReads, vKeys.size());
+        BOOST_CHECK_EQUAL(stats.nReadsFound - statsBefore.nReadsFound, 4U);
+        BOOST_CHECK_EQUAL(stats.nBytesRead - statsBefore.nBytesRead, 4U * 32);
+
+        uint256 res;
+        BOOST_CHECK(dbw.Read(std::make_pair('k', 2), res));
+        BOOST_CHECK(!dbw.Read(std::make_pair('k', 3), res));
+        stats = dbw.GetReadStats();
+        BOOST_CHECK_EQUAL(stats.nReads - statsBefore.nReads, vKeys.size() + 2);
+        BOOST_CHECK_EQUAL(stats.nReadsFound - statsBefore.nReadsFound, 5U);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_profiles)
+{
+    // built-in profiles
+    CDBProfile profile = GetDBProfile("chainstate");
+    BOOST_CHECK_EQUAL(profile.nBlockCachePercent, 50);
+    BOOST_CHECK_EQUAL(profile.nFilterBits, 10);
+    BOOST_CHECK_EQUAL(profile.nBlockSize, 4U << 10);
+    profile = GetDBProfile("addressindex");
+    BOOST_CHECK_EQUAL(profile.nFilterBits, 0);
+    BOOST_CHECK_EQUAL(profile.nBlockSize, 16U << 10);
+
+    // overrides only apply to the named database, invalid ones are ignored or clamped
+    ForceSetMultiArgs("-dbprofile", {"chainstate:filterbits=16", "chainstate:blocksize=8", "chainstate:blockcache=150",
+                                     "chainstate:compression=1", "llmq:filterbits=0", "chainstate", "chainstate:filterbits"});
+    profile = GetDBProfile("chainstate");
+    BOOST_CHECK_EQUAL(profile.nFilterBits, 16);
+    BOOST_CHECK_EQUAL(profile.nBlockSize, 8U << 10);
+    BOOST_CHECK_EQUAL(profile.nBlockCachePercent, 100);
+    BOOST_CHECK(profile.fCompression);
+    BOOST_CHECK_EQUAL(GetDBProfile("llmq").nFilterBits, 0);
+    BOOST_CHECK_EQUAL(GetDBProfile("evodb").nFilterBits, 10);
+
+    // open databases report their profile and read stats
+    boost::filesystem::path ph = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    {
+        CDBWrapper dbw(ph, (1 << 20), true, false, false, "chainstate");
+        uint256 res;
+        BOOST_CHECK(dbw.Write('k', GetRandHash()));
+        BOOST_CHECK(dbw.Read('k', res));
+
+        bool fFound = false;
+        for (const CDBStats& stats : CDBWrapper::GetAllStats()) {
+            if (stats.strName != "chainstate") {
+                continue;
+            }
+            fFound = true;
+            BOOST_CHECK_EQUAL(stats.nCacheSize, 1U << 20);
+            BOOST_CHECK_EQUAL(stats.profile.nFilterBits, 16);
+            BOOST_CHECK_EQUAL(stats.readStats.nReadsFound, 1U);
+        }
+        BOOST_CHECK(fFound);
+    }
+    for (const CDBStats& stats : CDBWrapper::GetAllStats()) {
+        BOOST_CHECK(stats.strName != "chainstate");
+    }
+    ForceRemoveArg("-dbprofile");
+}
+
 BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
 {
     // Perform tests both obfuscated and non-obfuscated.
@@ -318,6 +412,49 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
     }
 }
 
+// Records what a CDBTransaction commits to it
+struct CommitRecorder
+{
+    std::vector<std::pair<bool, std::string>> ops;
+
+    template <typename V>
+    void Write(const CDataStream& ssKey, V&& v) {
+        ops.emplace_back(true, std::string(ssKey.begin(), ssKey.end()));
+    }
+    void Erase(const CDataStream& ssKey) {
+        ops.emplace_back(false, std::string(ssKey.begin(), ssKey.end()));
+    }
+    template <typename V>
+    bool Read(const CDataStream& ssKey, V& v) { return false; }
+    bool Exists(const CDataStream& ssKey) { return false; }
+};
 
+BOOST_AUTO_TEST_CASE(dbtransaction_commit_order)
+{
+    CommitRecorder recorder;
+    CDBTransaction<CommitRecorder, CommitRecorder> transaction(recorder, recorder);
+
+    transaction.Write('d', 1);
+    transaction.Erase('b');
+    transaction.Write('a', 2);
+    transaction.Erase('e');
+    transaction.Write('c', 3);
+    // overwritten and erased again
+    transaction.Write('b', 4);
+    transaction.Erase('b');
+    // erased and written again
+    transaction.Erase('f');
+    transaction.Write('f', 5);
+    BOOST_CHECK(transaction.GetMemoryUsage() > 0);
+
+    transaction.Commit();
+    BOOST_CHECK(transaction.IsClean());
+    BOOST_CHECK_EQUAL(transaction.GetMemoryUsage(), 0);
+
+    std::vector<std::pair<bool, std::string>> expected = {
+        {true, "a"}, {false, "b"}, {true, "c"}, {true, "d"}, {false, "e"}, {true, "f"},
+    };
+    BOOST_CHECK(recorder.ops == expected);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -106,7 +106,7 @@ static CMutableTransaction CreateProRegTx(SimpleUTXOMap& utxos, int port, const
     proTx.collateralOutpoint.n = 0;
     proTx.addr = LookupNumeric("1.1.1.1", port);
     proTx.keyIDOwner = ownerKeyRet.GetPubKey().GetID();
-    proTx.pubKeyOperator = operatorKeyRet.GetPublicKey();
+    proTx.pubKeyOperator.Set(operatorKeyRet.GetPublicKey());
     proTx.keyIDVoting = ownerKeyRet.GetPubKey().GetID();
     proTx.scriptPayout = scriptPayout;
 
@@ -136,7 +136,7 @@ static CMutableTransaction CreateProUpServTx(SimpleUTXOMap& utxos, const uint256
     tx.nType = TRANSACTION_PROVIDER_UPDATE_SERVICE;
     FundTransaction(tx, utxos, GetScriptForDestination(coinbaseKey.GetPubKey().GetID()), 1 * COIN, coinbaseKey);
     proTx.inputsHash = CalcTxInputsHash(tx);
-    proTx.sig = operatorKey.Sign(::SerializeHash(proTx));
+    proTx.sig.Set(operatorKey.Sign(::SerializeHash(proTx)));
     SetTxPayload(tx, proTx);
     SignTransaction(tx, coinbaseKey);
 
@@ -150,7 +150,7 @@ static CMutableTransaction CreateProUpRegTx(SimpleUTXOMap& utxos, const uint256&
 
     CProUpRegTx proTx;
     proTx.proTxHash = proTxHash;
-    proTx.pubKeyOperator = pubKeyOperator;
+    proTx.pubKeyOperator.Set(pubKeyOperator);
     proTx.keyIDVoting = keyIDVoting;
     proTx.scriptPayout = scriptPayout;
 
@@ -179,7 +179,7 @@ static CMutableTransaction CreateProUpRevTx(SimpleUTXOMap& utxos, const uint256&
     tx.nType = TRANSACTION_PROVIDER_UPDATE_REVOKE;
     FundTransaction(tx, utxos, GetScriptForDestination(coinbaseKey.GetPubKey().GetID()), 1 * COIN, coinbaseKey);
     proTx.inputsHash = CalcTxInputsHash(tx);
-    proTx.sig = operatorKey.Sign(::SerializeHash(proTx));
+    proTx.sig.Set(operatorKey.Sign(::SerializeHash(proTx)));
     SetTxPayload(tx, proTx);
     SignTransaction(tx, coinbaseKey);
 
@@ -401,4 +401,102 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChainDIP3Setup)
 
     const_cast<Consensus::Params&>(Params().GetConsensus()).DIP0003EnforcementHeight = DIP0003EnforcementHeightBackup;
 }
+BOOST_FIXTURE_TEST_CASE(dmn_serialized_state_cache, BasicTestingSetup)
+{
+    auto state = std::make_shared<CDeterministicMNState>();
+    state->nRegisteredHeight = 100;
+    state->IPFSPeerID = "QmTestPeerId";
+    state->Identity = "test.identity";
+
+    auto dmn = std::make_shared<CDeterministicMN>();
+    dmn->proTxHash = GetRandHash();
+    dmn->internalId = 1;
+    dmn->collateralOutpoint = COutPoint(GetRandHash(), 0);
+    dmn->nOperatorReward = 0;
+    dmn->pdmnState = state;
+
+    // the cached form must be identical to a regular serialization
+    CDataStream ssExpected(SER_DISK, CLIENT_VERSION);
+    ssExpected << dmn->proTxHash << VARINT(dmn->internalId) << dmn->collateralOutpoint << dmn->nOperatorReward << *state;
+    for (int i = 0; i < 2; i++) {
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << *dmn;
+        BOOST_CHECK(ss.str() == ssExpected.str());
+        BOOST_CHECK_EQUAL(::GetSerializeSize(*dmn, SER_DISK, CLIENT_VERSION), ssExpected.size());
+    }
+
+    // copies of a state are modified afterwards and must not reuse the cache
+    auto newState = std::make_shared<CDeterministicMNState>(*state);
+    newState->nLastPaidHeight = 200;
+    auto newDmn = std::make_shared<CDeterministicMN>(*dmn);
+    newDmn->pdmnState = newState;
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << *newDmn;
+    CDeterministicMN dmn2(deserialize, ss);
+    BOOST_CHECK_EQUAL(dmn2.pdmnState->nLastPaidHeight, 200);
+    BOOST_CHECK_EQUAL(dmn2.pdmnState->Identity, "test.identity");
+    BOOST_CHECK(dmn2.proTxHash == dmn->proTxHash);
+}
+
+
+static CDeterministicMNCPtr MakeIdentityDmn(uint64_t internalId, const std::string& identity, int nRegisteredHeight)
+{
+    auto state = std::make_shared<CDeterministicMNState>();
+    state->nRegisteredHeight = nRegisteredHeight;
+    state->keyIDOwner = CKeyID(uint160(std::vector<unsigned char>(20, (unsigned char)internalId)));
+    state->IPFSPeerID = strprintf("QmTestPeerId%d", internalId);
+    state->Identity = identity;
+
+    auto dmn = std::make_shared<CDeterministicMN>();
+    dmn->proTxHash = GetRandHash();
+    dmn->internalId = internalId;
+    dmn->collateralOutpoint = COutPoint(GetRandHash(), 0);
+    dmn->pdmnState = state;
+    return dmn;
+}
+
+BOOST_FIXTURE_TEST_CASE(dmn_identity_index, BasicTestingSetup)
+{
+    CEvoDB evoDbTest(1 << 20, true, true);
+    CDeterministicMNManager manager(evoDbTest);
+
+    BOOST_CHECK_EQUAL(CDeterministicMNManager::NormalizeIdentity("Mn1.Historia-Network"), "mn1.historia-network");
+
+    auto dmn1 = MakeIdentityDmn(0, "mn1.historia.network", 100);
+    auto dmn2 = MakeIdentityDmn(1, "MN2.historia.network", 101);
+    CDeterministicMNList list(uint256(), 101, 2);
+    list.AddMN(dmn1);
+    list.AddMN(dmn2);
+    manager.UpdateIdentityIndex(list);
+
+    BOOST_CHECK(manager.ResolveIdentity("MN1.Historia.Network") == dmn1);
+    BOOST_CHECK(manager.ResolveIdentity("mn2.historia.network") == dmn2);
+    BOOST_CHECK(manager.ResolveIdentity("mn3.historia.network") == nullptr);
+
+    // the same name in a different case, the exact match wins and the earlier registration otherwise
+    auto dmn3 = MakeIdentityDmn(2, "Mn1.historia.network", 102);
+    list.AddMN(dmn3);
+    manager.UpdateIdentityIndex(list);
+    BOOST_CHECK(manager.ResolveIdentity("Mn1.historia.network") == dmn3);
+    BOOST_CHECK(manager.ResolveIdentity("mn1.historia.network") == dmn1);
+    BOOST_CHECK(manager.ResolveIdentity("MN1.HISTORIA.NETWORK") == dmn1);
+
+    // identity changes and removals come in through the diff
+    auto newState = std::make_shared<CDeterministicMNState>(*dmn2->pdmnState);
+    newState->Identity = "mn4.historia.network";
+    list.UpdateMN(dmn2->proTxHash, newState);
+    list.RemoveMN(dmn1->proTxHash);
+    manager.UpdateIdentityIndex(list);
+    BOOST_CHECK(manager.ResolveIdentity("mn2.historia.network") == nullptr);
+    BOOST_CHECK(manager.ResolveIdentity("MN4.historia.network")->proTxHash == dmn2->proTxHash);
+    BOOST_CHECK(manager.ResolveIdentity("mn1.historia.network") == dmn3);
+
+    // going back, like on a reorg
+    CDeterministicMNList emptyList(uint256(), 99, 0);
+    manager.UpdateIdentityIndex(emptyList);
+    BOOST_CHECK(manager.ResolveIdentity("mn1.historia.network") == nullptr);
+    BOOST_CHECK(manager.ResolveIdentity("mn4.historia.network") == nullptr);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -12,28 +12,33 @@
 
 BOOST_FIXTURE_TEST_SUITE(evo_simplifiedmns_tests, BasicTestingSetup)
 
-BOOST_AUTO_TEST_CASE(simplifiedmns_merkleroots)
+static CSimplifiedMNListEntry CreateEntry(size_t i)
 {
-    std::vector<CSimplifiedMNListEntry> entries;
-    for (size_t i = 0; i < 15; i++) {
-        CSimplifiedMNListEntry smle;
-        smle.proRegTxHash.SetHex(strprintf("%064x", i));
-        smle.confirmedHash.SetHex(strprintf("%064x", i));
+    CSimplifiedMNListEntry smle;
+    smle.proRegTxHash.SetHex(strprintf("%064x", i));
+    smle.confirmedHash.SetHex(strprintf("%064x", i));
 
-        std::string ip = strprintf("%d.%d.%d.%d", 0, 0, 0, i);
-        Lookup(ip.c_str(), smle.service, i, false);
+    std::string ip = strprintf("%d.%d.%d.%d", 0, 0, 0, i);
+    Lookup(ip.c_str(), smle.service, i, false);
 
-        uint8_t skBuf[CBLSSecretKey::SerSize];
-        memset(skBuf, 0, sizeof(skBuf));
-        skBuf[0] = (uint8_t)i;
-        CBLSSecretKey sk;
-        sk.SetBuf(skBuf, sizeof(skBuf));
+    uint8_t skBuf[CBLSSecretKey::SerSize];
+    memset(skBuf, 0, sizeof(skBuf));
+    skBuf[0] = (uint8_t)i;
+    CBLSSecretKey sk;
+    sk.SetBuf(skBuf, sizeof(skBuf));
 
-        smle.pubKeyOperator.Set(sk.GetPublicKey());
-        smle.keyIDVoting.SetHex(strprintf("%040x", i));
-        smle.isValid = true;
+    smle.pubKeyOperator.Set(sk.GetPublicKey());
+    smle.keyIDVoting.SetHex(strprintf("%040x", i));
+    smle.isValid = true;
 
-        entries.emplace_back(smle);
+    return smle;
+}
+
+BOOST_AUTO_TEST_CASE(simplifiedmns_merkleroots)
+{
+    std::vector<CSimplifiedMNListEntry> entries;
+    for (size_t i = 0; i < 15; i++) {
+        entries.emplace_back(CreateEntry(i));
     }
 
     std::vector<std::string> expectedHashes = {
@@ -70,4 +75,51 @@ BOOST_AUTO_TEST_CASE(simplifiedmns_merkleroots)
 
     BOOST_CHECK(expectedMerkleRoot == calculatedMerkleRoot);
 }
+
+static void CheckCachedMerkleRoot(CSimplifiedMNListMerkleCache& cache, const std::vector<CSimplifiedMNListEntry>& entries)
+{
+    CSimplifiedMNList sml(entries);
+    bool mutated = false;
+    bool cachedMutated = false;
+    uint256 merkleRoot = sml.CalcMerkleRoot(&mutated);
+    BOOST_CHECK(cache.CalcMerkleRoot(sml, &cachedMutated) == merkleRoot);
+    BOOST_CHECK_EQUAL(cachedMutated, mutated);
+}
+
+BOOST_AUTO_TEST_CASE(simplifiedmns_merkleroot_cache)
+{
+    CSimplifiedMNListMerkleCache cache;
+    std::vector<CSimplifiedMNListEntry> entries;
+    CheckCachedMerkleRoot(cache, entries);
+
+    for (size_t i = 0; i < 15; i++) {
+        entries.emplace_back(CreateEntry(i));
+        CheckCachedMerkleRoot(cache, entries);
+    }
+    BOOST_CHECK(cache.CalcMerkleRoot(CSimplifiedMNList(entries)).ToString() == "b2303aca677ae2091c882e44b58f57869fa88a6db1f4e1a5d71975e5387fa195");
+
+    // changed entries only
+    entries[0].isValid = false;
+    CheckCachedMerkleRoot(cache, entries);
+    entries[7].confirmedHash = uint256();
+    entries[14].keyIDVoting = CKeyID();
+    CheckCachedMerkleRoot(cache, entries);
+
+    // two identical leaves next to each other must be reported as mutated, same as in ComputeMerkleRoot
+    CSimplifiedMNListEntry entry9 = entries[9];
+    entries[9] = entries[8];
+    CheckCachedMerkleRoot(cache, entries);
+    entries[9] = entry9;
+    CheckCachedMerkleRoot(cache, entries);
+
+    // removed and added entries
+    entries.erase(entries.begin() + 3);
+    CheckCachedMerkleRoot(cache, entries);
+    entries.emplace_back(CreateEntry(20));
+    entries.emplace_back(CreateEntry(21));
+    CheckCachedMerkleRoot(cache, entries);
+
+    cache.Clear();
+    CheckCachedMerkleRoot(cache, entries);
+}
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,43 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-collateral.h"
+#include "script/script.h"
+
+#include "test/test_historia.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governance_collateral_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(collateral_candidate)
+{
+    uint256 nObjectHash = uint256S("0x1234");
+
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(uint256S("0x01"), 0);
+    tx.vout.resize(2);
+    tx.vout[0].scriptPubKey << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 1) << OP_EQUALVERIFY << OP_CHECKSIG;
+    BOOST_CHECK(!IsGovernanceCollateralCandidate(tx));
+
+    // the proof of burn of a governance object
+    tx.vout[1].scriptPubKey << OP_RETURN << ToByteVector(nObjectHash);
+    BOOST_CHECK(IsGovernanceCollateralCandidate(tx));
+
+    // other OP_RETURN outputs aren't collaterals
+    tx.vout[1].scriptPubKey = CScript() << OP_RETURN << std::vector<unsigned char>(20, 2);
+    BOOST_CHECK(!IsGovernanceCollateralCandidate(tx));
+    tx.vout[1].scriptPubKey = CScript() << OP_RETURN << std::vector<unsigned char>(33, 2);
+    BOOST_CHECK(!IsGovernanceCollateralCandidate(tx));
+
+    // neither are coinbases
+    CMutableTransaction txCoinbase;
+    txCoinbase.vin.resize(1);
+    txCoinbase.vout.resize(1);
+    txCoinbase.vout[0].scriptPubKey << OP_RETURN << ToByteVector(nObjectHash);
+    BOOST_CHECK(!IsGovernanceCollateralCandidate(txCoinbase));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
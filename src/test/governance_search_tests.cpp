@@ -0,0 +1,96 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-search.h"
+#include "governance-object.h"
+#include "random.h"
+
+#include "test/test_historia.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governance_search_tests, BasicTestingSetup)
+
+static std::vector<uint256> Hashes(const std::vector<CGovernanceSearchIndex::time_hash_t>& vecMatches)
+{
+    std::vector<uint256> vecHashes;
+    for (const auto& match : vecMatches) {
+        vecHashes.push_back(match.second);
+    }
+    return vecHashes;
+}
+
+BOOST_AUTO_TEST_CASE(search_tokenize)
+{
+    std::vector<std::string> vecExpected = {"historia", "records", "2019", "ipfs"};
+    BOOST_CHECK(CGovernanceSearchIndex::Tokenize("Historia records, 2019: a IPFS!") == vecExpected);
+
+    // non-ASCII bytes are part of words, long words are cut
+    vecExpected = {"caf\xc3\xa9", std::string(CGovernanceSearchIndex::MAX_TOKEN_LENGTH, 'x')};
+    BOOST_CHECK(CGovernanceSearchIndex::Tokenize("Caf\xc3\xa9 " + std::string(100, 'X')) == vecExpected);
+
+    vecExpected = {"a", "b"};
+    BOOST_CHECK(CGovernanceSearchIndex::Tokenize("a-b", 1) == vecExpected);
+    BOOST_CHECK(CGovernanceSearchIndex::Tokenize(" .,").empty());
+}
+
+BOOST_AUTO_TEST_CASE(search_query)
+{
+    CGovernanceSearchIndex index;
+    uint256 nHash1 = GetRandHash();
+    uint256 nHash2 = GetRandHash();
+    uint256 nHash3 = GetRandHash();
+    index.Add(nHash1, GOVERNANCE_OBJECT_RECORD, 300, {"land-registry", "Land Registry", "Deeds of the Northern district"});
+    index.Add(nHash2, GOVERNANCE_OBJECT_PROPOSAL, 200, {"marketing", "Marketing", "Northern outreach"});
+    index.Add(nHash3, GOVERNANCE_OBJECT_RECORD, 100, {"birth-records", "Birth records", ""});
+    BOOST_CHECK_EQUAL(index.GetObjectCount(), 3);
+
+    // sorted by creation time
+    std::vector<uint256> vecExpected = {nHash2, nHash1};
+    BOOST_CHECK(Hashes(index.Search("north", GOVERNANCE_OBJECT_UNKNOWN)) == vecExpected);
+    vecExpected = {nHash1};
+    BOOST_CHECK(Hashes(index.Search("NORTHERN", GOVERNANCE_OBJECT_RECORD)) == vecExpected);
+    BOOST_CHECK(Hashes(index.Search("northern deeds", GOVERNANCE_OBJECT_UNKNOWN)) == vecExpected);
+    BOOST_CHECK(Hashes(index.Search("re land", GOVERNANCE_OBJECT_UNKNOWN)) == vecExpected);
+    vecExpected = {nHash3, nHash1};
+    BOOST_CHECK(Hashes(index.Search("r", GOVERNANCE_OBJECT_RECORD)) == vecExpected);
+
+    BOOST_CHECK(index.Search("northern birth", GOVERNANCE_OBJECT_UNKNOWN).empty());
+    BOOST_CHECK(index.Search("registryx", GOVERNANCE_OBJECT_UNKNOWN).empty());
+    BOOST_CHECK(index.Search("", GOVERNANCE_OBJECT_UNKNOWN).empty());
+    BOOST_CHECK(index.Search("north", GOVERNANCE_OBJECT_TRIGGER).empty());
+
+    std::vector<CGovernanceSearchIndex::time_hash_t> vecMatches = index.Search("land", GOVERNANCE_OBJECT_UNKNOWN);
+    BOOST_CHECK_EQUAL(vecMatches.size(), 1);
+    BOOST_CHECK_EQUAL(vecMatches[0].first, 300);
+}
+
+BOOST_AUTO_TEST_CASE(search_update)
+{
+    CGovernanceSearchIndex index;
+    uint256 nHash1 = GetRandHash();
+    uint256 nHash2 = GetRandHash();
+    index.Add(nHash1, GOVERNANCE_OBJECT_RECORD, 100, {"alpha beta"});
+    index.Add(nHash2, GOVERNANCE_OBJECT_RECORD, 200, {"beta gamma"});
+    BOOST_CHECK_EQUAL(index.GetTokenCount(), 3);
+
+    // adding an object again replaces its tokens
+    index.Add(nHash1, GOVERNANCE_OBJECT_RECORD, 100, {"delta"});
+    BOOST_CHECK(index.Search("alpha", GOVERNANCE_OBJECT_UNKNOWN).empty());
+    BOOST_CHECK_EQUAL(index.Search("delta", GOVERNANCE_OBJECT_UNKNOWN).size(), 1);
+    BOOST_CHECK_EQUAL(index.GetTokenCount(), 3);
+
+    // tokens go away with the last object using them
+    index.Remove(nHash2);
+    BOOST_CHECK(index.Search("beta", GOVERNANCE_OBJECT_UNKNOWN).empty());
+    BOOST_CHECK_EQUAL(index.GetTokenCount(), 1);
+    index.Remove(nHash2);
+    BOOST_CHECK_EQUAL(index.GetObjectCount(), 1);
+
+    index.Clear();
+    BOOST_CHECK_EQUAL(index.GetObjectCount(), 0);
+    BOOST_CHECK_EQUAL(index.GetTokenCount(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
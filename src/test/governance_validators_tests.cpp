@@ -1,6 +1,9 @@
 // Copyright (c) 2014-2018 The Dash Core developers
 
+#include "governance-object.h"
+#include "governance-payload.h"
 #include "governance-validators.h"
+#include "hash.h"
 #include "utilstrencodings.h"
 
 #include "data/proposals_valid.json.h"
@@ -59,6 +62,22 @@ BOOST_AUTO_TEST_CASE(valid_proposals_test)
         CProposalValidator validator2(strHexData2, false);
         BOOST_CHECK_MESSAGE(validator2.Validate(false), validator2.GetErrorMessages());
         BOOST_CHECK_MESSAGE(!validator2.Validate(), validator2.GetErrorMessages());
+
+        // already parsed data must give the same results
+        CGovernanceObjectPayload payload1(ParseHex(strHexData1));
+        BOOST_CHECK(payload1.fValid && payload1.fLegacyFormat);
+        CProposalValidator validator3(payload1, true);
+        BOOST_CHECK_MESSAGE(validator3.Validate(false), validator3.GetErrorMessages());
+        CProposalValidator validator4(payload1, false);
+        BOOST_CHECK(!validator4.Validate());
+        BOOST_CHECK_EQUAL(validator4.GetErrorMessages(), "Legacy proposal serialization format not allowed;JSON parsing error;");
+
+        CGovernanceObjectPayload payload2(ParseHex(strHexData2));
+        BOOST_CHECK(payload2.fValid && !payload2.fLegacyFormat);
+        BOOST_CHECK(payload2.obj.write() == objProposal.write());
+        BOOST_CHECK_EQUAL(payload2.strName, find_value(objProposal, "name").get_str());
+        CProposalValidator validator5(payload2, false);
+        BOOST_CHECK_MESSAGE(validator5.Validate(false), validator5.GetErrorMessages());
     }
 }
 
@@ -81,6 +100,30 @@ BOOST_AUTO_TEST_CASE(invalid_proposals_test)
         std::string strHexData2 = HexStr(objProposal.write());
         CProposalValidator validator2(strHexData2, false);
         BOOST_CHECK_MESSAGE(!validator2.Validate(false), validator2.GetErrorMessages());
+
+        CProposalValidator validator3(CGovernanceObjectPayload(ParseHex(strHexData2)), false);
+        BOOST_CHECK_MESSAGE(!validator3.Validate(false), validator3.GetErrorMessages());
+        // the cached data checks must report the same errors as a fresh validation
+        BOOST_CHECK_EQUAL(validator3.GetErrorMessages(), validator2.GetErrorMessages());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(governance_object_hash)
+{
+    // GetHash streams the hex string of the data into the hasher, for all sizes this must match hashing the string
+    for (size_t nSize : {0, 1, 127, 128, 129, 1000}) {
+        std::vector<unsigned char> vchData(nSize);
+        for (size_t i = 0; i < nSize; i++) {
+            vchData[i] = (unsigned char)(i * 37 + 11);
+        }
+        CGovernanceObject govobj(uint256S("01"), 1, 1558000000, uint256S("02"), HexStr(vchData));
+        BOOST_CHECK_EQUAL(govobj.GetDataAsHexString(), HexStr(vchData));
+
+        CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+        ss << uint256S("01") << 1 << (int64_t)1558000000 << HexStr(vchData);
+        ss << govobj.GetMasternodeOutpoint() << uint8_t{} << 0xffffffff;
+        ss << std::vector<unsigned char>();
+        BOOST_CHECK(govobj.GetHash() == ss.GetHash());
     }
 }
 
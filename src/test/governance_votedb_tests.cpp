@@ -0,0 +1,145 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-votedb.h"
+#include "random.h"
+#include "version.h"
+
+#include "test/test_historia.h"
+
+#include <list>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governance_votedb_tests, BasicTestingSetup)
+
+static CGovernanceVote CreateVote(const COutPoint& outpoint, const uint256& nParentHash, vote_signal_enum_t eSignal, vote_outcome_enum_t eOutcome, int64_t nTime)
+{
+    CGovernanceVote vote(outpoint, nParentHash, eSignal, eOutcome);
+    vote.SetTime(nTime);
+    vote.SetSignature(std::vector<unsigned char>(96, (unsigned char)nTime));
+    return vote;
+}
+
+BOOST_AUTO_TEST_CASE(votefile_add_and_replace)
+{
+    uint256 nParentHash = GetRandHash();
+    COutPoint outpoint1(GetRandHash(), 0);
+    COutPoint outpoint2(GetRandHash(), 1);
+
+    CGovernanceObjectVoteFile file;
+    CGovernanceVote vote1 = CreateVote(outpoint1, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES, 1000);
+    CGovernanceVote vote2 = CreateVote(outpoint2, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO, 1000);
+    CGovernanceVote vote3 = CreateVote(outpoint1, nParentHash, VOTE_SIGNAL_DELETE, VOTE_OUTCOME_NO, 1000);
+
+    file.AddVote(vote1);
+    file.AddVote(vote1);
+    file.AddVote(vote2);
+    file.AddVote(vote3);
+    BOOST_CHECK_EQUAL(file.GetVoteCount(), 3);
+    BOOST_CHECK(file.HasVote(vote1.GetHash()));
+    BOOST_CHECK(file.HasVote(vote2.GetHash()));
+    BOOST_CHECK(file.HasVote(vote3.GetHash()));
+
+    // a newer vote replaces the older one for the same masternode and signal only
+    CGovernanceVote vote4 = CreateVote(outpoint1, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO, 2000);
+    file.AddVote(vote4);
+    BOOST_CHECK_EQUAL(file.GetVoteCount(), 3);
+    BOOST_CHECK(!file.HasVote(vote1.GetHash()));
+    BOOST_CHECK(file.HasVote(vote3.GetHash()));
+    BOOST_CHECK(file.HasVote(vote4.GetHash()));
+
+    std::vector<unsigned char> vch;
+    CVectorWriter vw(SER_NETWORK, PROTOCOL_VERSION, vch, 0);
+    BOOST_CHECK(file.SerializeVoteToStream(vote4.GetHash(), vw));
+    CDataStream ssExpected(SER_NETWORK, PROTOCOL_VERSION);
+    ssExpected << vote4;
+    BOOST_CHECK(std::string(vch.begin(), vch.end()) == ssExpected.str());
+    BOOST_CHECK(!file.SerializeVoteToStream(vote1.GetHash(), vw));
+
+    file.RemoveVotesFromMasternode(outpoint1);
+    BOOST_CHECK_EQUAL(file.GetVoteCount(), 1);
+    BOOST_CHECK(!file.HasVote(vote3.GetHash()));
+    BOOST_CHECK(!file.HasVote(vote4.GetHash()));
+    std::vector<CGovernanceVote> vecVotes = file.GetVotes();
+    BOOST_REQUIRE_EQUAL(vecVotes.size(), 1U);
+    BOOST_CHECK(vecVotes[0].GetHash() == vote2.GetHash());
+    BOOST_CHECK(vecVotes[0].GetSignature() == vote2.GetSignature());
+    std::vector<uint256> vecExpected = {vote2.GetHash()};
+    BOOST_CHECK(file.GetVoteHashes() == vecExpected);
+}
+
+BOOST_AUTO_TEST_CASE(votefile_serialization)
+{
+    uint256 nParentHash = GetRandHash();
+    std::list<CGovernanceVote> listVotes;
+    for (int i = 0; i < 100; i++) {
+        listVotes.push_back(CreateVote(COutPoint(GetRandHash(), i), nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES, 1000 + i));
+    }
+    // the old list based format may contain duplicates, they are dropped on load
+    listVotes.push_back(listVotes.front());
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << (int)listVotes.size() << listVotes;
+
+    CGovernanceObjectVoteFile file;
+    ss >> file;
+    BOOST_CHECK_EQUAL(file.GetVoteCount(), 100);
+    for (const auto& vote : listVotes) {
+        BOOST_CHECK(file.HasVote(vote.GetHash()));
+    }
+
+    listVotes.pop_back();
+    CDataStream ssFile(SER_DISK, CLIENT_VERSION);
+    ssFile << file;
+    CDataStream ssList(SER_DISK, CLIENT_VERSION);
+    ssList << (int)listVotes.size() << listVotes;
+    BOOST_CHECK(ssFile.str() == ssList.str());
+
+    CGovernanceObjectVoteFile fileCopy(file);
+    BOOST_CHECK_EQUAL(fileCopy.GetVoteCount(), 100);
+    BOOST_CHECK(fileCopy.HasVote(listVotes.back().GetHash()));
+}
+
+BOOST_AUTO_TEST_CASE(votefile_digest)
+{
+    uint256 nParentHash = GetRandHash();
+    COutPoint outpoint1(GetRandHash(), 0);
+    COutPoint outpoint2(GetRandHash(), 1);
+    CGovernanceVote vote1 = CreateVote(outpoint1, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES, 1000);
+    CGovernanceVote vote2 = CreateVote(outpoint2, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO, 1000);
+
+    CGovernanceObjectVoteFile file1;
+    CGovernanceObjectVoteFile file2;
+    BOOST_CHECK(file1.GetVoteDigest() == file2.GetVoteDigest());
+    BOOST_CHECK_EQUAL(file1.GetVoteDigest().nCount, 0U);
+    BOOST_CHECK(file1.GetVoteDigest().nHash.IsNull());
+
+    // digests don't depend on the order votes arrived in
+    file1.AddVote(vote1);
+    file1.AddVote(vote2);
+    file2.AddVote(vote2);
+    BOOST_CHECK(file1.GetVoteDigest() != file2.GetVoteDigest());
+    file2.AddVote(vote1);
+    BOOST_CHECK(file1.GetVoteDigest() == file2.GetVoteDigest());
+    BOOST_CHECK_EQUAL(file1.GetVoteDigest().nCount, 2U);
+
+    // replaced and removed votes are taken out of the digest
+    CGovernanceVote vote3 = CreateVote(outpoint1, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO, 2000);
+    file1.AddVote(vote3);
+    BOOST_CHECK(file1.GetVoteDigest() != file2.GetVoteDigest());
+    file1.RemoveVotesFromMasternode(outpoint1);
+    file2.RemoveVotesFromMasternode(outpoint1);
+    BOOST_CHECK(file1.GetVoteDigest() == file2.GetVoteDigest());
+    BOOST_CHECK(file1.GetVoteDigest().nHash == vote2.GetHash());
+
+    // and rebuilt on load
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << file1;
+    CGovernanceObjectVoteFile file3;
+    ss >> file3;
+    BOOST_CHECK(file3.GetVoteDigest() == file1.GetVoteDigest());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,9 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "hash.h"
+#include "random.h"
+#include "algo/hash_algos.h"
+#include "primitives/block.h"
 #include "utilstrencodings.h"
 #include "test/test_historia.h"
 
@@ -149,4 +152,112 @@ BOOST_AUTO_TEST_CASE(siphash)
     BOOST_CHECK_EQUAL(SipHashUint256(1, 2, ss.GetHash()), 0x79751e980c2a0a35ULL);
 }
 
+BOOST_AUTO_TEST_CASE(echo512)
+{
+    // Same result with and without AES-NI, the fast path is picked at runtime
+    unsigned char in[64];
+    unsigned char out[64];
+    for (int i = 0; i < 64; i++) {
+        in[i] = i;
+    }
+    sph_echo512_context ctx;
+    sph_echo512_init(&ctx);
+    sph_echo512(&ctx, in, sizeof(in));
+    sph_echo512_close(&ctx, out);
+    BOOST_CHECK_EQUAL(HexStr(out, out + sizeof(out)),
+        "2f7a64cec7e07c9d791f902b838e9a776c03da43ef8858e89c16bbfa7eff641d5e309d9a51e13177cbb86fb1021070c64763fa93b39824dafd773154cf2ec058");
+}
+
+BOOST_AUTO_TEST_CASE(x16r_hasher)
+{
+    // CX16RHasher must match the plain implementations for every nonce
+    for (int i = 0; i < 32; i++) {
+        std::vector<unsigned char> vchHeader(80);
+        GetRandBytes(vchHeader.data(), vchHeader.size());
+        uint256 hashPrevBlock = GetRandHash();
+        bool fV2 = i % 2;
+
+        CX16RHasher hasher(vchHeader.begin(), vchHeader.end(), hashPrevBlock, fV2);
+        for (uint32_t nNonce = 0; nNonce < 4; nNonce++) {
+            memcpy(&vchHeader[76], &nNonce, sizeof(nNonce));
+            uint256 hashExpected = fV2 ? HashX16RV2(vchHeader.begin(), vchHeader.end(), hashPrevBlock)
+                                       : HashX16R(vchHeader.begin(), vchHeader.end(), hashPrevBlock);
+            BOOST_CHECK_EQUAL(hasher.Hash(nNonce).ToString(), hashExpected.ToString());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(x16r_batch)
+{
+    // HashX16RBatch must match the plain implementations, for mixed X16R/X16RV2 inputs of any size
+    for (size_t nCount : {0, 1, 2, 17, 100}) {
+        std::vector<std::vector<unsigned char>> vData(nCount);
+        std::vector<X16RBatchInput> vInputs;
+        for (size_t i = 0; i < nCount; i++) {
+            vData[i].resize(i % 7 == 3 ? 64 + i : 80);
+            GetRandBytes(vData[i].data(), vData[i].size());
+            vInputs.push_back(X16RBatchInput{vData[i].data(), vData[i].size(), GetRandHash(), i % 3 != 0});
+        }
+        std::vector<uint256> vHashes(nCount);
+        HashX16RBatch(vInputs.data(), vInputs.size(), vHashes.data());
+        for (size_t i = 0; i < nCount; i++) {
+            uint256 hashExpected = vInputs[i].fV2 ? HashX16RV2(vData[i].begin(), vData[i].end(), vInputs[i].PrevBlockHash)
+                                                  : HashX16R(vData[i].begin(), vData[i].end(), vInputs[i].PrevBlockHash);
+            BOOST_CHECK_EQUAL(vHashes[i].ToString(), hashExpected.ToString());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(blockheader_hash_cache)
+{
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.hashPrevBlock = GetRandHash();
+    header.hashMerkleRoot = GetRandHash();
+    header.nTime = 1577836800;
+    header.nBits = 0x1e0ffff0;
+    header.nNonce = 1;
+
+    uint256 hash = header.GetHash();
+    BOOST_CHECK(header.GetHash() == hash);
+    BOOST_CHECK(header.GetHash() == header.GetX16RV2Hash() || header.GetHash() == header.GetX16RHash());
+
+    // copies keep the cached hash, modifications invalidate it
+    CBlockHeader copy = header;
+    BOOST_CHECK(copy.GetHash() == hash);
+    copy.nNonce++;
+    BOOST_CHECK(copy.GetHash() != hash);
+    copy.nNonce--;
+    BOOST_CHECK(copy.GetHash() == hash);
+
+    CBlock block(header);
+    block.hashMerkleRoot = GetRandHash();
+    CBlockHeader fresh = block.GetBlockHeader();
+    BOOST_CHECK(block.GetHash() != hash);
+    BOOST_CHECK(block.GetHash() == (fresh.IsX16RV2() ? fresh.GetX16RV2Hash() : fresh.GetX16RHash()));
+}
+
+BOOST_AUTO_TEST_CASE(blockheader_cache_hashes)
+{
+    // headers on both sides of the X16RV2 switch
+    std::vector<CBlockHeader> headers(40);
+    for (size_t i = 0; i < headers.size(); i++) {
+        headers[i].nVersion = 4;
+        headers[i].hashPrevBlock = GetRandHash();
+        headers[i].hashMerkleRoot = GetRandHash();
+        headers[i].nTime = i % 2 ? 1500000000 : 1600000000;
+        headers[i].nBits = 0x1e0ffff0;
+        headers[i].nNonce = i;
+    }
+    uint256 hashFirst = headers[0].GetHash();
+    headers[1].GetHash();
+    headers[1].nNonce++;
+
+    CBlockHeader::CacheHashes(headers.data(), headers.size());
+    BOOST_CHECK(headers[0].GetHash() == hashFirst);
+    for (const CBlockHeader& header : headers) {
+        BOOST_CHECK(header.GetHash() == (header.IsX16RV2() ? header.GetX16RV2Hash() : header.GetX16RHash()));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,115 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "ipfs-pinning.h"
+
+#include "test/test_historia.h"
+#include "tinyformat.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <set>
+
+static std::vector<std::string> MakePeerIDs(int nCount)
+{
+    std::vector<std::string> vecPeerIDs;
+    for (int i = 0; i < nCount; i++) {
+        vecPeerIDs.push_back(strprintf("QmPeer%040d", i));
+    }
+    return vecPeerIDs;
+}
+
+static std::string MakeCID(int n)
+{
+    return strprintf("QmCID%041d", n);
+}
+
+BOOST_FIXTURE_TEST_SUITE(ipfs_pinning_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(ipfs_pin_assignment)
+{
+    std::vector<std::string> vecPeerIDs = MakePeerIDs(20);
+    std::vector<std::string> vecReversed(vecPeerIDs.rbegin(), vecPeerIDs.rend());
+
+    CIPFSPinAssignment assignment(3, vecPeerIDs, "");
+    BOOST_CHECK(!assignment.IsNull());
+    BOOST_CHECK(!assignment.IsLocalResponsible(MakeCID(0)));
+    // the order of the masternode list doesn't matter
+    BOOST_CHECK(assignment == CIPFSPinAssignment(3, vecReversed, ""));
+
+    std::vector<CIPFSPinAssignment> vecLocal;
+    for (const auto& strPeerID : vecPeerIDs) {
+        vecLocal.emplace_back(3, vecPeerIDs, strPeerID);
+    }
+
+    std::map<std::string, int> mapLoad;
+    for (int i = 0; i < 1000; i++) {
+        std::string strCID = MakeCID(i);
+        std::vector<std::string> vecResponsible = assignment.GetResponsiblePeers(strCID);
+        BOOST_CHECK_EQUAL(vecResponsible.size(), 3);
+        std::set<std::string> setResponsible(vecResponsible.begin(), vecResponsible.end());
+        BOOST_CHECK_EQUAL(setResponsible.size(), 3);
+
+        // every node agrees on who pins the CID
+        for (size_t j = 0; j < vecPeerIDs.size(); j++) {
+            BOOST_CHECK_EQUAL(vecLocal[j].IsLocalResponsible(strCID), setResponsible.count(vecPeerIDs[j]) == 1);
+        }
+        for (const auto& strPeerID : vecResponsible) {
+            mapLoad[strPeerID]++;
+        }
+    }
+
+    // 150 CIDs per peer on average
+    BOOST_CHECK_EQUAL(mapLoad.size(), vecPeerIDs.size());
+    for (const auto& p : mapLoad) {
+        BOOST_CHECK(p.second > 75 && p.second < 225);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ipfs_pin_assignment_rebalance)
+{
+    std::vector<std::string> vecPeerIDs = MakePeerIDs(20);
+    CIPFSPinAssignment assignment(3, vecPeerIDs, "");
+
+    std::string strLeaving = vecPeerIDs[7];
+    std::vector<std::string> vecRemaining = vecPeerIDs;
+    vecRemaining.erase(vecRemaining.begin() + 7);
+    CIPFSPinAssignment assignmentAfter(3, vecRemaining, "");
+    BOOST_CHECK(assignment != assignmentAfter);
+
+    for (int i = 0; i < 1000; i++) {
+        std::string strCID = MakeCID(i);
+        std::vector<std::string> vecBefore = assignment.GetResponsiblePeers(strCID);
+        std::vector<std::string> vecAfter = assignmentAfter.GetResponsiblePeers(strCID);
+        BOOST_CHECK_EQUAL(vecAfter.size(), 3);
+
+        auto it = std::find(vecBefore.begin(), vecBefore.end(), strLeaving);
+        if (it == vecBefore.end()) {
+            // CIDs of other peers stay where they are
+            BOOST_CHECK(vecBefore == vecAfter);
+        } else {
+            // the next peer in the ranking repairs the lost replica
+            vecBefore.erase(it);
+            BOOST_CHECK(std::equal(vecBefore.begin(), vecBefore.end(), vecAfter.begin()));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ipfs_pin_assignment_small_list)
+{
+    std::vector<std::string> vecPeerIDs = MakePeerIDs(2);
+    CIPFSPinAssignment assignment(3, vecPeerIDs, vecPeerIDs[1]);
+
+    // with less peers than replicas every peer pins everything
+    BOOST_CHECK_EQUAL(assignment.GetResponsiblePeers(MakeCID(0)).size(), 2);
+    BOOST_CHECK(assignment.IsLocalResponsible(MakeCID(0)));
+    BOOST_CHECK(assignment.IsLocalResponsible(MakeCID(1)));
+
+    CIPFSPinAssignment assignmentEmpty(3, std::vector<std::string>(), "");
+    BOOST_CHECK(!assignmentEmpty.IsNull());
+    BOOST_CHECK(assignmentEmpty.GetResponsiblePeers(MakeCID(0)).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,58 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "transport-curl-multi.h"
+
+#include "test/test_historia.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+
+using namespace ipfs::http;
+
+// nothing listens there, requests fail quickly without any network access
+static const std::string strUnreachableUrl = "http://127.0.0.1:1/api/v0/version";
+
+BOOST_FIXTURE_TEST_SUITE(ipfs_transport_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(ipfs_transport_urlencode)
+{
+    TransportCurlMultiAdapter adapter(std::make_shared<TransportCurlMulti>(), 1000);
+    std::string strEncoded;
+    adapter.UrlEncode("Qm-._~ /?&=\xc3\xbc", &strEncoded);
+    BOOST_CHECK_EQUAL(strEncoded, "Qm-._~%20%2F%3F%26%3D%C3%BC");
+}
+
+BOOST_AUTO_TEST_CASE(ipfs_transport_errors)
+{
+    auto transport = std::make_shared<TransportCurlMulti>();
+
+    // many requests in flight at once, all of them finish
+    std::vector<std::future<std::string> > vecFutures;
+    for (int i = 0; i < 16; i++) {
+        vecFutures.push_back(transport->FetchAsync(strUnreachableUrl, {}, 5000));
+    }
+    for (auto& future : vecFutures) {
+        BOOST_CHECK_THROW(future.get(), std::runtime_error);
+    }
+    BOOST_CHECK_EQUAL(transport->GetInFlightCount(), 0);
+    BOOST_CHECK(!transport->Cancel(1));
+
+    // the adapter throws like TransportCurl does
+    TransportCurlMultiAdapter adapter(transport, 5000);
+    std::stringstream response;
+    BOOST_CHECK_THROW(adapter.Fetch(strUnreachableUrl, {}, &response), std::runtime_error);
+
+    // once interrupted, requests fail right away
+    transport->Interrupt();
+    std::string strError;
+    transport->Submit(strUnreachableUrl, {}, 5000, [&strError](const std::string& error, const std::string& body) {
+        strError = error;
+    });
+    BOOST_CHECK_EQUAL(strError, "request interrupted");
+    BOOST_CHECK_EQUAL(transport->GetInFlightCount(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,119 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "lzcompress.h"
+#include "random.h"
+#include "streams.h"
+#include "version.h"
+
+#include "test/test_historia.h"
+#include "test/test_random.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(lzcompress_tests, BasicTestingSetup)
+
+static std::vector<unsigned char> ToBytes(const std::string& str)
+{
+    return std::vector<unsigned char>(str.begin(), str.end());
+}
+
+static void CheckRoundTrip(const std::vector<unsigned char>& vch)
+{
+    std::vector<unsigned char> vchCompressed, vchDecompressed;
+    LZCompress(vch, vchCompressed);
+    BOOST_CHECK(LZDecompress(vchCompressed, vch.size(), vchDecompressed));
+    BOOST_CHECK(vchDecompressed == vch);
+}
+
+BOOST_AUTO_TEST_CASE(lzcompress_roundtrip)
+{
+    CheckRoundTrip({});
+    CheckRoundTrip(ToBytes("a"));
+    CheckRoundTrip(ToBytes("abcdabcdabcd"));
+    CheckRoundTrip(ToBytes("abcdabcdabcdabcd"));
+    CheckRoundTrip(std::vector<unsigned char>(100000, 'x'));
+
+    for (int i = 0; i < 100; i++) {
+        // random data mixed with repetitions at all kinds of distances and lengths
+        std::vector<unsigned char> vch;
+        size_t nSize = insecure_rand() % 5000;
+        while (vch.size() < nSize) {
+            if (vch.size() > 4 && insecure_rand() % 2) {
+                size_t nOffset = 1 + insecure_rand() % vch.size();
+                size_t nLength = insecure_rand() % 300;
+                for (size_t j = 0; j < nLength; j++) {
+                    vch.push_back(vch[vch.size() - nOffset]);
+                }
+            } else {
+                vch.push_back(insecure_rand() % 256);
+            }
+        }
+        CheckRoundTrip(vch);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(lzcompress_json)
+{
+    std::string strJson = "[[\"record\",{\"end_epoch\":1577836800,\"name\":\"land-registry-2019\",\"payment_address\":\"HAYTV1WKs3ztVPfT2xrXW2pWUqN93rygv5\","
+                          "\"payment_amount\":1,\"start_epoch\":1546300800,\"type\":4,\"url\":\"https://historia.network/records/land-registry-2019\","
+                          "\"ipfscid\":\"QmZXbb5gRMrpBVe79d8hxPjMFJYDDo9kxFZvdb7b2UYamj\",\"summary\":{\"name\":\"Land registry 2019\","
+                          "\"description\":\"Land registry records of 2019\"}}]]";
+    std::vector<unsigned char> vch = ToBytes(strJson);
+    std::vector<unsigned char> vchCompressed;
+    LZCompress(vch, vchCompressed);
+    BOOST_CHECK(vchCompressed.size() < vch.size());
+    CheckRoundTrip(vch);
+}
+
+BOOST_AUTO_TEST_CASE(lzcompress_invalid)
+{
+    std::vector<unsigned char> vch(1000, 'x');
+    std::vector<unsigned char> vchCompressed, vchOut;
+    LZCompress(vch, vchCompressed);
+
+    BOOST_CHECK(!LZDecompress(vchCompressed, vch.size() - 1, vchOut));
+    BOOST_CHECK(!LZDecompress(vchCompressed, vch.size() + 1, vchOut));
+    BOOST_CHECK(!LZDecompress({}, 0, vchOut));
+    for (size_t i = 1; i < vchCompressed.size(); i++) {
+        BOOST_CHECK(!LZDecompress(std::vector<unsigned char>(vchCompressed.begin(), vchCompressed.begin() + i), vch.size(), vchOut));
+    }
+
+    // a match before the start of the output
+    BOOST_CHECK(!LZDecompress({0x10, 'a', 0x02, 0x00, 0x00}, 5, vchOut));
+    BOOST_CHECK(!LZDecompress({0x10, 'a', 0x00, 0x00, 0x00}, 5, vchOut));
+    BOOST_CHECK(LZDecompress({0x10, 'a', 0x01, 0x00, 0x00}, 5, vchOut));
+    BOOST_CHECK(vchOut == ToBytes("aaaaa"));
+    // more literals than there is data
+    BOOST_CHECK(!LZDecompress({0x50, 'a', 'b'}, 5, vchOut));
+    // an extended length beyond the expected size
+    BOOST_CHECK(!LZDecompress({0xf0, 0xff, 0xff, 0xff, 0xff, 0x01}, 100, vchOut));
+}
+
+BOOST_AUTO_TEST_CASE(lzcompress_serialize)
+{
+    std::vector<std::vector<unsigned char> > vecTests = {{}, ToBytes("abc"), std::vector<unsigned char>(1000, 'x')};
+    for (auto& vch : vecTests) {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << CLZCompressedBytes(vch, 1000);
+        // incompressible data is stored with one byte of overhead
+        if (vch.size() < 10) {
+            BOOST_CHECK_EQUAL(ss.size(), vch.size() + 1);
+        } else {
+            BOOST_CHECK(ss.size() < vch.size() / 10);
+        }
+        std::vector<unsigned char> vchRead;
+        ss >> REF(CLZCompressedBytes(vchRead, 1000));
+        BOOST_CHECK(vchRead == vch);
+        BOOST_CHECK(ss.empty());
+    }
+
+    std::vector<unsigned char> vch(1000, 'x');
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << CLZCompressedBytes(vch, 1000);
+    std::vector<unsigned char> vchRead;
+    BOOST_CHECK_THROW(ss >> REF(CLZCompressedBytes(vchRead, 999)), std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -427,6 +427,76 @@ BOOST_AUTO_TEST_CASE(MempoolAncestorIndexingTest)
 }
 
 
+BOOST_AUTO_TEST_CASE(MempoolDiamondDescendantsTest)
+{
+    // A parent with two children which are both spent by the same grand-child,
+    // entries reached over both paths must only be counted once
+    CTxMemPool pool;
+    TestMemPoolEntryHelper entry;
+
+    CMutableTransaction txParent;
+    txParent.vin.resize(1);
+    txParent.vin[0].scriptSig = CScript() << OP_11;
+    txParent.vout.resize(2);
+    for (int i = 0; i < 2; i++) {
+        txParent.vout[i].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        txParent.vout[i].nValue = 33000LL;
+    }
+    CMutableTransaction txChild[2];
+    for (int i = 0; i < 2; i++) {
+        txChild[i].vin.resize(1);
+        txChild[i].vin[0].scriptSig = CScript() << OP_11;
+        txChild[i].vin[0].prevout.hash = txParent.GetHash();
+        txChild[i].vin[0].prevout.n = i;
+        txChild[i].vout.resize(1);
+        txChild[i].vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        txChild[i].vout[0].nValue = 11000LL;
+    }
+    CMutableTransaction txGrandChild;
+    txGrandChild.vin.resize(2);
+    for (int i = 0; i < 2; i++) {
+        txGrandChild.vin[i].scriptSig = CScript() << OP_11;
+        txGrandChild.vin[i].prevout.hash = txChild[i].GetHash();
+        txGrandChild.vin[i].prevout.n = 0;
+    }
+    txGrandChild.vout.resize(1);
+    txGrandChild.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txGrandChild.vout[0].nValue = 11000LL;
+
+    pool.addUnchecked(txParent.GetHash(), entry.FromTx(txParent));
+    pool.addUnchecked(txChild[0].GetHash(), entry.FromTx(txChild[0]));
+    pool.addUnchecked(txChild[1].GetHash(), entry.FromTx(txChild[1]));
+
+    CTxMemPoolEntry grandChildEntry = entry.FromTx(txGrandChild);
+    CTxMemPool::setEntries setAncestors;
+    std::string errString;
+    uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    BOOST_CHECK(pool.CalculateMemPoolAncestors(grandChildEntry, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, errString));
+    BOOST_CHECK_EQUAL(setAncestors.size(), 3);
+
+    setAncestors.clear();
+    BOOST_CHECK(!pool.CalculateMemPoolAncestors(grandChildEntry, setAncestors, 3, nNoLimit, nNoLimit, nNoLimit, errString));
+    BOOST_CHECK_EQUAL(errString, "too many unconfirmed ancestors [limit: 3]");
+
+    pool.addUnchecked(txGrandChild.GetHash(), grandChildEntry);
+    CTxMemPool::txiter parentIt = pool.mapTx.find(txParent.GetHash());
+    BOOST_CHECK_EQUAL(parentIt->GetCountWithDescendants(), 4);
+    BOOST_CHECK_EQUAL(pool.mapTx.find(txGrandChild.GetHash())->GetCountWithAncestors(), 4);
+
+    CTxMemPool::setEntries setDescendants;
+    pool.CalculateDescendants(parentIt, setDescendants);
+    BOOST_CHECK_EQUAL(setDescendants.size(), 4);
+
+    // tx already accounted for in setDescendants are not walked again
+    setDescendants.clear();
+    setDescendants.insert(pool.mapTx.find(txChild[0].GetHash()));
+    pool.CalculateDescendants(pool.mapTx.find(txChild[1].GetHash()), setDescendants);
+    BOOST_CHECK_EQUAL(setDescendants.size(), 3);
+
+    pool.removeRecursive(txParent);
+    BOOST_CHECK_EQUAL(pool.size(), 0);
+}
+
 BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
 {
     CTxMemPool pool;
@@ -580,4 +650,58 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolWouldBeEvictedTest)
+{
+    CTxMemPool pool;
+    TestMemPoolEntryHelper entry;
+
+    CMutableTransaction tx1 = CMutableTransaction();
+    tx1.vin.resize(1);
+    tx1.vin[0].scriptSig = CScript() << OP_1;
+    tx1.vout.resize(1);
+    tx1.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+    tx1.vout[0].nValue = 10 * COIN;
+    pool.addUnchecked(tx1.GetHash(), entry.Fee(10000LL).FromTx(tx1));
+
+    CMutableTransaction tx2 = CMutableTransaction();
+    tx2.vin.resize(1);
+    tx2.vin[0].scriptSig = CScript() << OP_2;
+    tx2.vout.resize(1);
+    tx2.vout[0].scriptPubKey = CScript() << OP_2 << OP_EQUAL;
+    tx2.vout[0].nValue = 10 * COIN;
+    pool.addUnchecked(tx2.GetHash(), entry.Fee(5000LL).FromTx(tx2));
+
+    size_t nSize = ::GetSerializeSize(CTransaction(tx2), SER_NETWORK, PROTOCOL_VERSION);
+    size_t nUsage = pool.DynamicMemoryUsage();
+
+    // not full yet
+    BOOST_CHECK(!pool.WouldBeEvicted(0, nSize, nUsage + 1, 0));
+    // full, tx2 is at the bottom and a new tx loses ties
+    BOOST_CHECK(pool.WouldBeEvicted(4000LL, nSize, nUsage, 0));
+    BOOST_CHECK(pool.WouldBeEvicted(5000LL, nSize, nUsage, 0));
+    BOOST_CHECK(!pool.WouldBeEvicted(6000LL, nSize, nUsage, 0));
+    // expiring txes could make room
+    BOOST_CHECK(!pool.WouldBeEvicted(4000LL, nSize, nUsage, 1));
+
+    // tx3 pays for tx2 (CPFP), tx1 is at the bottom now
+    CMutableTransaction tx3 = CMutableTransaction();
+    tx3.vin.resize(1);
+    tx3.vin[0].prevout = COutPoint(tx2.GetHash(), 0);
+    tx3.vin[0].scriptSig = CScript() << OP_2;
+    tx3.vout.resize(1);
+    tx3.vout[0].scriptPubKey = CScript() << OP_3 << OP_EQUAL;
+    tx3.vout[0].nValue = 10 * COIN;
+    pool.addUnchecked(tx3.GetHash(), entry.Fee(20000LL).FromTx(tx3));
+    nUsage = pool.DynamicMemoryUsage();
+
+    BOOST_CHECK(pool.WouldBeEvicted(9000LL, nSize, nUsage, 0));
+    BOOST_CHECK(!pool.WouldBeEvicted(11000LL, nSize, nUsage, 0));
+
+    // and it is what TrimToSize evicts first
+    pool.TrimToSize(nUsage - 1);
+    BOOST_CHECK(!pool.exists(tx1.GetHash()));
+    BOOST_CHECK(pool.exists(tx2.GetHash()));
+    BOOST_CHECK(pool.exists(tx3.GetHash()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
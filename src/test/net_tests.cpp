@@ -9,6 +9,7 @@
 #include "serialize.h"
 #include "streams.h"
 #include "net.h"
+#include "netmessagemaker.h"
 #include "netbase.h"
 #include "chainparams.h"
 
@@ -21,7 +22,6 @@ public:
     void MakeDeterministic()
     {
         nKey.SetNull();
-        insecure_rand = FastRandomContext(true);
     }
 };
 
@@ -172,4 +172,102 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+BOOST_AUTO_TEST_CASE(cnode_askfor)
+{
+    in_addr ipv4Addr;
+    ipv4Addr.s_addr = 0xa0b0c001;
+    CAddress addr = CAddress(CService(ipv4Addr, 7777), NODE_NETWORK);
+    std::unique_ptr<CNode> pnode1(new CNode(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, "", false));
+    std::unique_ptr<CNode> pnode2(new CNode(1, NODE_NETWORK, 0, INVALID_SOCKET, addr, 1, 1, "", false));
+
+    CInv inv(MSG_TX, GetRandHash());
+    int64_t nNow = GetTimeMicros();
+    int64_t nRetryDelay = 60 * 1000000;
+
+    // the first peer is asked right away, the second one only after the retry delay
+    pnode1->AskFor(inv, nRetryDelay);
+    pnode1->AskFor(inv, nRetryDelay);
+    pnode2->AskFor(inv, nRetryDelay);
+    BOOST_CHECK_EQUAL(pnode1->GetAskForSize(), 1U);
+    BOOST_CHECK(requestTracker.IsScheduled(inv.hash));
+
+    std::vector<CInv> vInv;
+    pnode1->PopAskFor(nNow, vInv);
+    BOOST_REQUIRE_EQUAL(vInv.size(), 1U);
+    BOOST_CHECK(vInv[0].hash == inv.hash);
+    pnode1->MarkAskedFor(inv, nNow, true);
+    vInv.clear();
+    pnode2->PopAskFor(nNow, vInv);
+    BOOST_CHECK(vInv.empty());
+    pnode2->PopAskFor(nNow + nRetryDelay + 1000000, vInv);
+    BOOST_CHECK_EQUAL(vInv.size(), 1U);
+    pnode2->MarkAskedFor(inv, nNow, false);
+    BOOST_CHECK_EQUAL(pnode2->GetAskForSize(), 0U);
+
+    // an unanswered request is forgotten after a while, so the peer may announce the item again
+    BOOST_CHECK_EQUAL(pnode1->GetAskForSize(), 1U);
+    vInv.clear();
+    pnode1->PopAskFor(nNow + ASKFOR_IN_FLIGHT_TIMEOUT, vInv);
+    BOOST_CHECK(vInv.empty());
+    BOOST_CHECK_EQUAL(pnode1->GetAskForSize(), 0U);
+
+    pnode1->AskFor(inv, nRetryDelay);
+    BOOST_CHECK_EQUAL(pnode1->GetAskForSize(), 1U);
+    pnode1->RemoveAskFor(inv.hash);
+    requestTracker.Remove(inv.hash);
+    BOOST_CHECK_EQUAL(pnode1->GetAskForSize(), 0U);
+    BOOST_CHECK(!requestTracker.IsScheduled(inv.hash));
+}
+
+BOOST_AUTO_TEST_CASE(shared_net_msg)
+{
+    std::vector<unsigned char> vchPayload(1000, 0x42);
+    CSharedNetMsg msg(CNetMsgMaker(PROTOCOL_VERSION).Make(NetMsgType::BLOCK, vchPayload));
+    BOOST_CHECK(!msg.IsNull());
+    BOOST_CHECK_EQUAL(msg.command, NetMsgType::BLOCK);
+    BOOST_CHECK_EQUAL(msg.header->size(), CMessageHeader::HEADER_SIZE);
+
+    CDataStream ssPayload(SER_NETWORK, PROTOCOL_VERSION);
+    ssPayload << vchPayload;
+    BOOST_CHECK(*msg.data == std::vector<unsigned char>(ssPayload.begin(), ssPayload.end()));
+
+    CMessageHeader hdr(Params().MessageStart());
+    CDataStream ssHeader(*msg.header, SER_NETWORK, PROTOCOL_VERSION);
+    ssHeader >> hdr;
+    BOOST_CHECK(hdr.IsValid(Params().MessageStart()));
+    BOOST_CHECK_EQUAL(hdr.GetCommand(), NetMsgType::BLOCK);
+    BOOST_CHECK_EQUAL(hdr.nMessageSize, msg.data->size());
+    uint256 hash = Hash(msg.data->begin(), msg.data->end());
+    BOOST_CHECK(memcmp(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE) == 0);
+
+    // copies share the serialized message
+    CSharedNetMsg msgCopy = msg;
+    BOOST_CHECK(msgCopy.header == msg.header && msgCopy.data == msg.data);
+    BOOST_CHECK(CSharedNetMsg().IsNull());
+}
+
+BOOST_AUTO_TEST_CASE(message_processing_stats)
+{
+    BOOST_CHECK_EQUAL(CMessageProcessingStats::GetHistogramBucket(0), 0);
+    BOOST_CHECK_EQUAL(CMessageProcessingStats::GetHistogramBucket(99), 0);
+    BOOST_CHECK_EQUAL(CMessageProcessingStats::GetHistogramBucket(100), 1);
+    BOOST_CHECK_EQUAL(CMessageProcessingStats::GetHistogramBucket(999999), 4);
+    BOOST_CHECK_EQUAL(CMessageProcessingStats::GetHistogramBucket(1000000), 5);
+    BOOST_CHECK_EQUAL(CMessageProcessingStats::GetHistogramBucket(1000000000), 5);
+
+    CMessageProcessingStats stats;
+    stats.Add(100, 50, 2000);
+    stats.Add(200, 5000, 20);
+    BOOST_CHECK_EQUAL(stats.nCount, 2U);
+    BOOST_CHECK_EQUAL(stats.nBytes, 300U);
+    BOOST_CHECK_EQUAL(stats.nTimeMicros, 5050);
+    BOOST_CHECK_EQUAL(stats.nMaxTimeMicros, 5000);
+    BOOST_CHECK_EQUAL(stats.nQueueDelayMicros, 2020);
+    BOOST_CHECK_EQUAL(stats.nMaxQueueDelayMicros, 2000);
+    BOOST_CHECK_EQUAL(stats.vTimeHistogram[0], 1U);
+    BOOST_CHECK_EQUAL(stats.vTimeHistogram[2], 1U);
+    BOOST_CHECK_EQUAL(stats.vQueueDelayHistogram[0], 1U);
+    BOOST_CHECK_EQUAL(stats.vQueueDelayHistogram[2], 1U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
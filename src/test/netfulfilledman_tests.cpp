@@ -0,0 +1,101 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "netfulfilledman.h"
+
+#include "chainparams.h"
+#include "netbase.h"
+#include "streams.h"
+#include "test/test_historia.h"
+#include "utiltime.h"
+#include "version.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(netfulfilledman_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(netfulfilledman_expire)
+{
+    CNetFulfilledRequestManager manager;
+    int64_t nExpireTime = Params().FulfilledRequestExpireTime();
+    int64_t nStart = 1500000000;
+    CService addr1 = LookupNumeric("1.2.3.4", 10101);
+    CService addr2 = LookupNumeric("5.6.7.8", 10101);
+
+    SetMockTime(nStart);
+    manager.AddFulfilledRequest(addr1, "full-sync");
+    manager.AddFulfilledRequest(addr1, "spork-sync");
+    manager.AddFulfilledRequest(addr2, "full-sync");
+    BOOST_CHECK(manager.HasFulfilledRequest(addr1, "full-sync"));
+    BOOST_CHECK(manager.HasFulfilledRequest(addr1, "spork-sync"));
+    BOOST_CHECK(!manager.HasFulfilledRequest(addr2, "spork-sync"));
+    BOOST_CHECK_EQUAL(manager.ToString(), "Nodes with fulfilled requests: 2, requests: 3");
+
+    // fulfilling a request again pushes its expiry back
+    SetMockTime(nStart + nExpireTime / 2);
+    manager.AddFulfilledRequest(addr1, "full-sync");
+    manager.CheckAndRemove();
+    BOOST_CHECK_EQUAL(manager.ToString(), "Nodes with fulfilled requests: 2, requests: 3");
+
+    SetMockTime(nStart + nExpireTime + 1);
+    BOOST_CHECK(manager.HasFulfilledRequest(addr1, "full-sync"));
+    BOOST_CHECK(!manager.HasFulfilledRequest(addr1, "spork-sync"));
+    BOOST_CHECK(!manager.HasFulfilledRequest(addr2, "full-sync"));
+    manager.CheckAndRemove();
+    BOOST_CHECK_EQUAL(manager.ToString(), "Nodes with fulfilled requests: 1, requests: 1");
+
+    // long after the last check, everything due is still removed
+    SetMockTime(nStart + 100 * nExpireTime);
+    manager.CheckAndRemove();
+    BOOST_CHECK(!manager.HasFulfilledRequest(addr1, "full-sync"));
+    BOOST_CHECK_EQUAL(manager.ToString(), "Nodes with fulfilled requests: 0, requests: 0");
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(netfulfilledman_serialize)
+{
+    CNetFulfilledRequestManager manager;
+    int64_t nExpireTime = Params().FulfilledRequestExpireTime();
+    int64_t nStart = 1500000000;
+    CService addr1 = LookupNumeric("1.2.3.4", 10101);
+    CService addr2 = LookupNumeric("5.6.7.8", 10101);
+
+    SetMockTime(nStart);
+    manager.AddFulfilledRequest(addr1, "full-sync");
+    manager.AddFulfilledRequest(addr2, "full-sync");
+    SetMockTime(nStart + 10);
+    manager.AddFulfilledRequest(addr2, "governance-sync");
+
+    // the format is the one of the std::map the requests used to be kept in
+    CService addr1Squashed = Params().AllowMultiplePorts() ? addr1 : CService(addr1, 0);
+    CService addr2Squashed = Params().AllowMultiplePorts() ? addr2 : CService(addr2, 0);
+    std::map<CService, std::map<std::string, int64_t> > mapExpected;
+    mapExpected[addr1Squashed]["full-sync"] = nStart + nExpireTime;
+    mapExpected[addr2Squashed]["full-sync"] = nStart + nExpireTime;
+    mapExpected[addr2Squashed]["governance-sync"] = nStart + 10 + nExpireTime;
+
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << manager;
+    std::map<CService, std::map<std::string, int64_t> > mapRead;
+    CDataStream(ss) >> mapRead;
+    BOOST_CHECK(mapRead == mapExpected);
+
+    CDataStream ssExpected(SER_DISK, PROTOCOL_VERSION);
+    ssExpected << mapExpected;
+    CNetFulfilledRequestManager manager2;
+    ssExpected >> manager2;
+    BOOST_CHECK_EQUAL(manager2.ToString(), "Nodes with fulfilled requests: 2, requests: 3");
+    BOOST_CHECK(manager2.HasFulfilledRequest(addr2, "governance-sync"));
+
+    // the loaded requests expire like the others
+    SetMockTime(nStart + nExpireTime + 1);
+    manager2.CheckAndRemove();
+    BOOST_CHECK_EQUAL(manager2.ToString(), "Nodes with fulfilled requests: 1, requests: 1");
+    BOOST_CHECK(manager2.HasFulfilledRequest(addr2, "governance-sync"));
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,115 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "reconciliation.h"
+#include "random.h"
+
+#include "test/test_historia.h"
+
+#include <algorithm>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(reconciliation_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(sketch_decode)
+{
+    // decoding fails for a small share of random sets, so use fixed ids
+    std::vector<uint64_t> vCommon, vLocalOnly, vRemoteOnly;
+    for (uint64_t i = 0; i < 1000; i++) {
+        vCommon.emplace_back(i * 0x9e3779b97f4a7c15ULL);
+    }
+    for (uint64_t i = 0; i < 30; i++) {
+        vLocalOnly.emplace_back((i + 1000) * 0x9e3779b97f4a7c15ULL);
+        vRemoteOnly.emplace_back((i + 2000) * 0x9e3779b97f4a7c15ULL);
+    }
+
+    size_t nCells = CInvSketch::GetCellsForDifference(vLocalOnly.size() + vRemoteOnly.size());
+    CInvSketch local(nCells), remote(nCells);
+    for (uint64_t n : vCommon) {
+        local.Insert(n);
+        remote.Insert(n);
+    }
+    for (uint64_t n : vLocalOnly) {
+        local.Insert(n);
+    }
+    for (uint64_t n : vRemoteOnly) {
+        remote.Insert(n);
+    }
+
+    BOOST_CHECK(remote.Subtract(local));
+    std::vector<uint64_t> vPositive, vNegative;
+    BOOST_REQUIRE(remote.Decode(vPositive, vNegative));
+    std::sort(vPositive.begin(), vPositive.end());
+    std::sort(vNegative.begin(), vNegative.end());
+    std::sort(vLocalOnly.begin(), vLocalOnly.end());
+    std::sort(vRemoteOnly.begin(), vRemoteOnly.end());
+    BOOST_CHECK(vPositive == vRemoteOnly);
+    BOOST_CHECK(vNegative == vLocalOnly);
+
+    // a difference much larger than the sketch can't be decoded
+    CInvSketch small(CInvSketch::GetCellsForDifference(1));
+    for (uint64_t n : vLocalOnly) {
+        small.Insert(n);
+    }
+    BOOST_CHECK(!small.Decode(vPositive, vNegative));
+
+    // sketches of different sizes can't be subtracted
+    BOOST_CHECK(!small.Subtract(local));
+
+    // an empty difference decodes to nothing
+    CInvSketch empty(nCells);
+    BOOST_CHECK(empty.Decode(vPositive, vNegative));
+    BOOST_CHECK(vPositive.empty() && vNegative.empty());
+}
+
+BOOST_AUTO_TEST_CASE(sketch_serialization)
+{
+    CInvSketch sketch(CInvSketch::GetCellsForDifference(10));
+    for (uint64_t i = 0; i < 10; i++) {
+        sketch.Insert(i);
+    }
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << sketch;
+    CInvSketch sketch2;
+    ss >> sketch2;
+    BOOST_CHECK_EQUAL(sketch2.GetCellCount(), sketch.GetCellCount());
+
+    std::vector<uint64_t> vPositive, vNegative;
+    BOOST_CHECK(sketch2.Decode(vPositive, vNegative));
+    BOOST_CHECK_EQUAL(vPositive.size(), 10U);
+    BOOST_CHECK(vNegative.empty());
+}
+
+BOOST_AUTO_TEST_CASE(reconciliation_state)
+{
+    CReconciliationState initiator(true, 1234, 5678);
+    CReconciliationState responder(false, 5678, 1234);
+    CReconciliationState other(false, 5678, 4321);
+
+    CInv inv(MSG_TX, GetRandHash());
+    BOOST_CHECK_EQUAL(initiator.GetShortId(inv), responder.GetShortId(inv));
+    BOOST_CHECK(initiator.GetShortId(inv) != other.GetShortId(inv));
+    BOOST_CHECK(initiator.GetShortId(inv) != initiator.GetShortId(CInv(MSG_GOVERNANCE_OBJECT_VOTE, inv.hash)));
+
+    BOOST_CHECK(CReconciliationState::IsReconcilable(CInv(MSG_TX, inv.hash)));
+    BOOST_CHECK(CReconciliationState::IsReconcilable(CInv(MSG_GOVERNANCE_OBJECT_VOTE, inv.hash)));
+    BOOST_CHECK(!CReconciliationState::IsReconcilable(CInv(MSG_BLOCK, inv.hash)));
+
+    for (size_t i = 0; i < MAX_RECON_SET_SIZE; i++) {
+        BOOST_CHECK(responder.Add(CInv(MSG_TX, GetRandHash())));
+    }
+    BOOST_CHECK(!responder.Add(inv));
+
+    // the estimation covers the size difference and q times the smaller set
+    BOOST_CHECK_EQUAL(CReconciliationState::EstimateSketchCells(100, 100, 0), CInvSketch::GetCellsForDifference(1));
+    BOOST_CHECK_EQUAL(CReconciliationState::EstimateSketchCells(100, 40, DEFAULT_RECON_Q), CInvSketch::GetCellsForDifference(70));
+
+    initiator.UpdateQ(100, 100, 50);
+    BOOST_CHECK_EQUAL(initiator.nQ, RECON_Q_PRECISION / 2);
+    initiator.UpdateQ(100, 100, 500);
+    BOOST_CHECK_EQUAL(initiator.nQ, RECON_Q_PRECISION);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -114,4 +114,102 @@ BOOST_AUTO_TEST_CASE(manythreads)
     BOOST_CHECK_EQUAL(counterSum, 200);
 }
 
+static void priorityTask(std::vector<int>& vOrder, int n)
+{
+    vOrder.push_back(n);
+}
+
+BOOST_AUTO_TEST_CASE(scheduler_priorities)
+{
+    CScheduler scheduler;
+    std::vector<int> vOrder;
+
+    // all tasks are due when the thread starts, the most urgent ones run first
+    boost::chrono::system_clock::time_point now = boost::chrono::system_clock::now();
+    scheduler.schedule(boost::bind(priorityTask, boost::ref(vOrder), 3), now - boost::chrono::seconds(2), CScheduler::PRIORITY_LOW, "low");
+    scheduler.schedule(boost::bind(priorityTask, boost::ref(vOrder), 2), now - boost::chrono::seconds(2), CScheduler::PRIORITY_NORMAL);
+    scheduler.schedule(boost::bind(priorityTask, boost::ref(vOrder), 1), now - boost::chrono::seconds(1), CScheduler::PRIORITY_HIGH, "high");
+    scheduler.schedule(boost::bind(priorityTask, boost::ref(vOrder), 0), now - boost::chrono::seconds(2), CScheduler::PRIORITY_HIGH, "high");
+
+    boost::chrono::system_clock::time_point first, last;
+    BOOST_CHECK_EQUAL(scheduler.getQueueInfo(first, last), 4);
+    BOOST_CHECK(first == now - boost::chrono::seconds(2));
+    BOOST_CHECK(last == now - boost::chrono::seconds(1));
+
+    scheduler.stop(true);
+    boost::thread t(boost::bind(&CScheduler::serviceQueue, &scheduler));
+    t.join();
+
+    std::vector<int> vExpected = {0, 1, 2, 3};
+    BOOST_CHECK(vOrder == vExpected);
+
+    std::map<std::string, CScheduler::TaskStats> mapStats = scheduler.getTaskStats();
+    BOOST_CHECK_EQUAL(mapStats.size(), 3);
+    BOOST_CHECK_EQUAL(mapStats["high"].nRuns, 2);
+    BOOST_CHECK_EQUAL(mapStats["high"].priority, CScheduler::PRIORITY_HIGH);
+    BOOST_CHECK_EQUAL(mapStats["other"].nRuns, 1);
+    BOOST_CHECK_EQUAL(mapStats["low"].nRuns, 1);
+    // the tasks ran at least a second late
+    BOOST_CHECK(mapStats["low"].nMaxLateMicros >= 1000000);
+    BOOST_CHECK_EQUAL(mapStats["low"].vLateHistogram[CScheduler::HISTOGRAM_BUCKETS - 2], 1);
+}
+
+BOOST_AUTO_TEST_CASE(scheduler_high_priority_thread)
+{
+    CScheduler scheduler;
+    std::vector<int> vOrder;
+
+    // a thread servicing only high priority tasks leaves the others alone
+    boost::chrono::system_clock::time_point now = boost::chrono::system_clock::now();
+    scheduler.schedule(boost::bind(priorityTask, boost::ref(vOrder), 0), now, CScheduler::PRIORITY_NORMAL);
+    scheduler.schedule(boost::bind(priorityTask, boost::ref(vOrder), 1), now, CScheduler::PRIORITY_HIGH);
+    scheduler.scheduleFromNow(boost::bind(&CScheduler::stop, &scheduler, false), 100, CScheduler::PRIORITY_HIGH);
+
+    boost::thread t(boost::bind(&CScheduler::servicePriorityQueue, &scheduler, CScheduler::PRIORITY_HIGH));
+    t.join();
+
+    BOOST_CHECK(vOrder == std::vector<int>{1});
+    boost::chrono::system_clock::time_point first, last;
+    BOOST_CHECK_EQUAL(scheduler.getQueueInfo(first, last), 1);
+}
+
+BOOST_AUTO_TEST_CASE(singlethreadedscheduler_ordered)
+{
+    CScheduler scheduler;
+
+    // several threads service the queue, the callbacks of a client still run one at a time and in order
+    boost::thread_group threads;
+    for (int i = 0; i < 4; i++) {
+        threads.create_thread(boost::bind(&CScheduler::serviceQueue, &scheduler));
+    }
+
+    SingleThreadedSchedulerClient queue1(&scheduler);
+    SingleThreadedSchedulerClient queue2(&scheduler);
+    std::vector<int> vOrder1, vOrder2;
+    for (int i = 0; i < 100; i++) {
+        queue1.AddToProcessQueue([i, &vOrder1] { vOrder1.push_back(i); });
+        queue2.AddToProcessQueue([i, &vOrder2] { vOrder2.push_back(i); });
+    }
+
+    scheduler.stop(true);
+    threads.join_all();
+    // anything which didn't get to run is run by EmptyQueue
+    queue1.EmptyQueue();
+    queue2.EmptyQueue();
+    BOOST_CHECK_EQUAL(queue1.CallbacksPending(), 0);
+
+    std::vector<int> vExpected;
+    for (int i = 0; i < 100; i++) {
+        vExpected.push_back(i);
+    }
+    BOOST_CHECK(vOrder1 == vExpected);
+    BOOST_CHECK(vOrder2 == vExpected);
+
+    // without a scheduler callbacks run right away
+    SingleThreadedSchedulerClient queueInline(nullptr);
+    int nRuns = 0;
+    queueInline.AddToProcessQueue([&nRuns] { nRuns++; });
+    BOOST_CHECK_EQUAL(nRuns, 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -157,6 +157,10 @@ void DoTest(const CScript& scriptPubKey, const CScript& scriptSig, int flags, co
     int libconsensus_flags = flags & historiaconsensus_SCRIPT_FLAGS_VERIFY_ALL;
     if (libconsensus_flags == flags) {
         BOOST_CHECK_MESSAGE(historiaconsensus_verify_script(scriptPubKey.data(), scriptPubKey.size(), (const unsigned char*)&stream[0], stream.size(), 0, libconsensus_flags, NULL) == expect,message);
+        historiaconsensus_spent_output spentOutput = {0, scriptPubKey.data(), (unsigned int)scriptPubKey.size()};
+        int result;
+        BOOST_CHECK_MESSAGE(historiaconsensus_verify_script_batch((const unsigned char*)&stream[0], stream.size(), &spentOutput, 1, libconsensus_flags, 1, &result, NULL) == expect, message);
+        BOOST_CHECK_MESSAGE(result == expect, message);
     }
 #endif
 }
@@ -999,6 +1003,92 @@ BOOST_AUTO_TEST_CASE(script_combineSigs)
     BOOST_CHECK(combined == partial3c);
 }
 
+#if defined(HAVE_CONSENSUS_LIB)
+BOOST_AUTO_TEST_CASE(script_libconsensus_batch)
+{
+    CBasicKeyStore keystore;
+    CKey key;
+    key.MakeNewKey(true);
+    keystore.AddKey(key);
+    CKey otherKey;
+    otherKey.MakeNewKey(true);
+
+    // a transaction spending 4 outputs of the same key
+    CMutableTransaction txFrom = BuildCreditingTransaction(GetScriptForDestination(key.GetPubKey().GetID()));
+    txFrom.vout.resize(4, txFrom.vout[0]);
+    CMutableTransaction txTo = BuildSpendingTransaction(CScript(), txFrom);
+    txTo.vin.resize(4, txTo.vin[0]);
+    for (unsigned int i = 0; i < txTo.vin.size(); i++) {
+        txTo.vin[i].prevout.n = i;
+    }
+    for (unsigned int i = 0; i < txTo.vin.size(); i++) {
+        BOOST_CHECK(SignSignature(keystore, txFrom, txTo, i));
+    }
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << txTo;
+    const unsigned char* txData = (const unsigned char*)&stream[0];
+    const CScript& scriptPubKey = txFrom.vout[0].scriptPubKey;
+    const CScript otherScriptPubKey = GetScriptForDestination(otherKey.GetPubKey().GetID());
+
+    std::vector<historiaconsensus_spent_output> spentOutputs;
+    for (unsigned int i = 0; i < txTo.vin.size(); i++) {
+        spentOutputs.push_back({i, scriptPubKey.data(), (unsigned int)scriptPubKey.size()});
+    }
+    std::vector<int> results(spentOutputs.size());
+    historiaconsensus_error err;
+
+    for (unsigned int nThreads : {0, 1, 3, 100}) {
+        BOOST_CHECK_EQUAL(historiaconsensus_verify_script_batch(txData, stream.size(), spentOutputs.data(), spentOutputs.size(), historiaconsensus_SCRIPT_FLAGS_VERIFY_ALL, nThreads, results.data(), &err), 1);
+        BOOST_CHECK_EQUAL(err, historiaconsensus_ERR_OK);
+        BOOST_CHECK(results == std::vector<int>(spentOutputs.size(), 1));
+    }
+
+    // only the input with the wrong spent output fails
+    spentOutputs[2].scriptPubKey = otherScriptPubKey.data();
+    spentOutputs[2].scriptPubKeyLen = otherScriptPubKey.size();
+    BOOST_CHECK_EQUAL(historiaconsensus_verify_script_batch(txData, stream.size(), spentOutputs.data(), spentOutputs.size(), historiaconsensus_SCRIPT_FLAGS_VERIFY_ALL, 2, results.data(), &err), 0);
+    BOOST_CHECK_EQUAL(err, historiaconsensus_ERR_OK);
+    BOOST_CHECK(results == std::vector<int>({1, 1, 0, 1}));
+
+    // a subset of the inputs can be verified
+    BOOST_CHECK_EQUAL(historiaconsensus_verify_script_batch(txData, stream.size(), spentOutputs.data() + 3, 1, historiaconsensus_SCRIPT_FLAGS_VERIFY_ALL, 2, results.data(), &err), 1);
+    BOOST_CHECK_EQUAL(err, historiaconsensus_ERR_OK);
+
+    // errors fail the whole transaction
+    spentOutputs[2].nIn = 4;
+    BOOST_CHECK_EQUAL(historiaconsensus_verify_script_batch(txData, stream.size(), spentOutputs.data(), spentOutputs.size(), historiaconsensus_SCRIPT_FLAGS_VERIFY_ALL, 2, results.data(), &err), 0);
+    BOOST_CHECK_EQUAL(err, historiaconsensus_ERR_TX_INDEX);
+    BOOST_CHECK(results == std::vector<int>(spentOutputs.size(), 0));
+    BOOST_CHECK_EQUAL(historiaconsensus_verify_script_batch(txData, stream.size() - 1, spentOutputs.data(), 1, historiaconsensus_SCRIPT_FLAGS_VERIFY_ALL, 2, results.data(), &err), 0);
+    BOOST_CHECK_EQUAL(err, historiaconsensus_ERR_TX_DESERIALIZE);
+    BOOST_CHECK_EQUAL(historiaconsensus_verify_script_batch(txData, stream.size(), spentOutputs.data(), 1, ~0U, 2, results.data(), &err), 0);
+    BOOST_CHECK_EQUAL(err, historiaconsensus_ERR_INVALID_FLAGS);
+
+    // several transactions at once, a broken one doesn't affect the others
+    spentOutputs[2].nIn = 2;
+    spentOutputs[2].scriptPubKey = scriptPubKey.data();
+    spentOutputs[2].scriptPubKeyLen = scriptPubKey.size();
+    std::vector<std::vector<int>> txResults(3, std::vector<int>(spentOutputs.size()));
+    std::vector<historiaconsensus_transaction> txs;
+    for (unsigned int i = 0; i < txResults.size(); i++) {
+        txs.push_back({txData, (unsigned int)stream.size(), spentOutputs.data(), (unsigned int)spentOutputs.size(), txResults[i].data(), historiaconsensus_ERR_OK});
+    }
+    BOOST_CHECK_EQUAL(historiaconsensus_verify_transactions(txs.data(), txs.size(), historiaconsensus_SCRIPT_FLAGS_VERIFY_ALL, 4, &err), 1);
+    BOOST_CHECK_EQUAL(err, historiaconsensus_ERR_OK);
+    for (unsigned int i = 0; i < txs.size(); i++) {
+        BOOST_CHECK_EQUAL(txs[i].err, historiaconsensus_ERR_OK);
+        BOOST_CHECK(txResults[i] == std::vector<int>(spentOutputs.size(), 1));
+    }
+    txs[1].txToLen--;
+    BOOST_CHECK_EQUAL(historiaconsensus_verify_transactions(txs.data(), txs.size(), historiaconsensus_SCRIPT_FLAGS_VERIFY_ALL, 4, &err), 0);
+    BOOST_CHECK_EQUAL(err, historiaconsensus_ERR_OK);
+    BOOST_CHECK_EQUAL(txs[1].err, historiaconsensus_ERR_TX_DESERIALIZE);
+    BOOST_CHECK(txResults[1] == std::vector<int>(spentOutputs.size(), 0));
+    BOOST_CHECK(txResults[0] == std::vector<int>(spentOutputs.size(), 1));
+    BOOST_CHECK(txResults[2] == std::vector<int>(spentOutputs.size(), 1));
+}
+#endif
+
 BOOST_AUTO_TEST_CASE(script_standard_push)
 {
     ScriptError err;
@@ -0,0 +1,44 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "spork.h"
+
+#include "base58.h"
+#include "key.h"
+#include "test/test_historia.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(spork_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(spork_resolved_values)
+{
+    CSporkManager manager;
+
+    // values resolve to the defaults before any spork message is known
+    BOOST_CHECK_EQUAL(manager.GetSporkValue(SPORK_102_IPFS_OBJECT_SIZE), mapSporkDefaults[SPORK_102_IPFS_OBJECT_SIZE]);
+    BOOST_CHECK(manager.IsSporkActive(SPORK_2_INSTANTSEND_ENABLED));
+    BOOST_CHECK(!manager.IsSporkActive(SPORK_6_NEW_SIGS));
+    // no spork uses this ID
+    BOOST_CHECK_EQUAL(manager.GetSporkValue(SPORK_START + 2), -1);
+
+    CKey key;
+    key.MakeNewKey(true);
+    BOOST_CHECK(manager.SetSporkAddress(CBitcoinAddress(key.GetPubKey().GetID()).ToString()));
+    BOOST_CHECK(manager.SetMinSporkKeys(1));
+    BOOST_CHECK(manager.SetPrivKey(CBitcoinSecret(key).ToString()));
+    BOOST_CHECK_EQUAL(manager.GetSporkValue(SPORK_100_RECORD_FEE_VALUE), mapSporkDefaults[SPORK_100_RECORD_FEE_VALUE]);
+
+    // updates are visible right away
+    BOOST_CHECK(manager.UpdateSpork(SPORK_100_RECORD_FEE_VALUE, 42, *connman));
+    BOOST_CHECK_EQUAL(manager.GetSporkValue(SPORK_100_RECORD_FEE_VALUE), 42);
+    BOOST_CHECK(manager.UpdateSpork(SPORK_6_NEW_SIGS, 0, *connman));
+    BOOST_CHECK(manager.IsSporkActive(SPORK_6_NEW_SIGS));
+
+    manager.Clear();
+    BOOST_CHECK_EQUAL(manager.GetSporkValue(SPORK_100_RECORD_FEE_VALUE), mapSporkDefaults[SPORK_100_RECORD_FEE_VALUE]);
+    BOOST_CHECK(!manager.IsSporkActive(SPORK_6_NEW_SIGS));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
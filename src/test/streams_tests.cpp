@@ -72,6 +72,37 @@ BOOST_AUTO_TEST_CASE(streams_vector_writer)
     vch.clear();
 }
 
+BOOST_AUTO_TEST_CASE(streams_span_reader)
+{
+    std::vector<unsigned char> vch = {1, 255, 3, 4, 5, 6};
+
+    CSpanReader reader(SER_NETWORK, INIT_PROTO_VERSION, vch.data(), vch.size());
+    BOOST_CHECK_EQUAL(reader.size(), 6);
+    BOOST_CHECK(!reader.empty());
+
+    unsigned char a(0);
+    unsigned char b(0);
+    reader >> a >> b;
+    BOOST_CHECK_EQUAL(a, 1);
+    BOOST_CHECK_EQUAL(b, 255);
+    BOOST_CHECK_EQUAL(reader.size(), 4);
+
+    uint16_t c(0);
+    reader.ignore(2);
+    reader >> c;
+    BOOST_CHECK_EQUAL(c, 0x0605);
+    BOOST_CHECK(reader.empty());
+
+    // reading past the end throws and leaves the stream as it was
+    BOOST_CHECK_THROW(reader >> a, std::ios_base::failure);
+    BOOST_CHECK_THROW(reader.ignore(1), std::ios_base::failure);
+
+    CSpanReader reader2(SER_NETWORK, INIT_PROTO_VERSION, vch.data(), 3);
+    uint32_t d(0);
+    BOOST_CHECK_THROW(reader2 >> d, std::ios_base::failure);
+    BOOST_CHECK_EQUAL(reader2.size(), 3);
+}
+
 BOOST_AUTO_TEST_CASE(streams_serializedata_xor)
 {
     std::vector<char> in;
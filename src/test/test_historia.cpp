@@ -6,9 +6,11 @@
 
 #include "test_historia.h"
 
+#include "bls/bls_sigcache.h"
 #include "chainparams.h"
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
+#include "crypto/sha256.h"
 #include "key.h"
 #include "validation.h"
 #include "miner.h"
@@ -17,6 +19,7 @@
 #include "random.h"
 #include "txdb.h"
 #include "txmempool.h"
+#include "txvalidationcache.h"
 #include "ui_interface.h"
 #include "rpc/server.h"
 #include "rpc/register.h"
@@ -45,11 +48,14 @@ extern void noui_connect();
 
 BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
 {
+        SHA256AutoDetect();
         ECC_Start();
         BLSInit();
         SetupEnvironment();
         SetupNetworking();
         InitSignatureCache();
+        InitBLSSignatureCache();
+        InitTxValidationCache();
         fPrintToDebugLog = false; // don't want to write to debug.log file
         fCheckBlockIndex = true;
         SelectParams(chainName);
@@ -81,6 +87,10 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
         g_connman = std::unique_ptr<CConnman>(new CConnman(0x1337, 0x1337)); // Deterministic randomness for tests.
         connman = g_connman.get();
         pblocktree = new CBlockTreeDB(1 << 20, true);
+        paddressindexdb = new CAddressIndexDB(1 << 20, true);
+        paddressindexdb->UpgradeAddressBalances();
+        pspentindexdb = new CSpentIndexDB(1 << 20, true);
+        ptimestampindexdb = new CTimestampIndexDB(1 << 20, true);
         pcoinsdbview = new CCoinsViewDB(1 << 23, true);
         llmq::InitLLMQSystem(*evoDb, nullptr, true);
         pcoinsTip = new CCoinsViewCache(pcoinsdbview);
@@ -107,6 +117,9 @@ TestingSetup::~TestingSetup()
         llmq::DestroyLLMQSystem();
         delete pcoinsdbview;
         delete pblocktree;
+        delete paddressindexdb;
+        delete pspentindexdb;
+        delete ptimestampindexdb;
         boost::filesystem::remove_all(pathTemp);
 }
 
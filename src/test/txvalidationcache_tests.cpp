@@ -6,8 +6,10 @@
 #include "key.h"
 #include "validation.h"
 #include "miner.h"
+#include "policy/policy.h"
 #include "pubkey.h"
 #include "txmempool.h"
+#include "txvalidationcache.h"
 #include "random.h"
 #include "script/standard.h"
 #include "test/test_historia.h"
@@ -84,4 +86,151 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_block_doublespend, TestChain100Setup)
     BOOST_CHECK_EQUAL(mempool.size(), 0);
 }
 
+BOOST_FIXTURE_TEST_CASE(tx_validationcache_coins, BasicTestingSetup)
+{
+    CCoinsView viewDummy;
+    CCoinsViewCache view(&viewDummy);
+
+    CMutableTransaction txPrev;
+    txPrev.vout.resize(1);
+    txPrev.vout[0].nValue = 11*CENT;
+    txPrev.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    AddCoins(view, txPrev, 1);
+
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout = COutPoint(txPrev.GetHash(), 0);
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = 10*CENT;
+    mtx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    CTransaction tx(mtx);
+
+    BOOST_CHECK(!IsTxValidationCached(tx, view, STANDARD_SCRIPT_VERIFY_FLAGS, false));
+    AddTxValidationCache(tx, view, STANDARD_SCRIPT_VERIFY_FLAGS);
+    BOOST_CHECK(IsTxValidationCached(tx, view, STANDARD_SCRIPT_VERIFY_FLAGS, false));
+
+    // entries are only valid for the exact flags
+    BOOST_CHECK(!IsTxValidationCached(tx, view, MANDATORY_SCRIPT_VERIFY_FLAGS, false));
+
+    // and for the exact coins, the scripts might not pass when spending a different output with the same outpoint
+    CCoinsViewCache view2(&viewDummy);
+    txPrev.vout[0].scriptPubKey = CScript() << OP_FALSE;
+    view2.AddCoin(mtx.vin[0].prevout, Coin(txPrev.vout[0], 1, false), false);
+    BOOST_CHECK(!IsTxValidationCached(tx, view2, STANDARD_SCRIPT_VERIFY_FLAGS, false));
+
+    // erasing lookups report the entry a last time
+    BOOST_CHECK(IsTxValidationCached(tx, view, STANDARD_SCRIPT_VERIFY_FLAGS, true));
+}
+
+BOOST_FIXTURE_TEST_CASE(tx_scriptcheck_deferred_sigs, BasicTestingSetup)
+{
+    CKey key;
+    key.MakeNewKey(true);
+
+    CMutableTransaction txPrev;
+    txPrev.vout.resize(2);
+    txPrev.vout[0].nValue = 11*CENT;
+    txPrev.vout[0].scriptPubKey = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+    txPrev.vout[1].nValue = 11*CENT;
+    txPrev.vout[1].scriptPubKey = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG << OP_NOT;
+
+    CMutableTransaction mtx;
+    mtx.vin.resize(2);
+    mtx.vin[0].prevout = COutPoint(txPrev.GetHash(), 0);
+    mtx.vin[1].prevout = COutPoint(txPrev.GetHash(), 1);
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = 20*CENT;
+    mtx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+
+    // a valid signature for the first input and a signature of the wrong hash for the second one
+    std::vector<unsigned char> vchSig;
+    BOOST_CHECK(key.Sign(SignatureHash(txPrev.vout[0].scriptPubKey, mtx, 0, SIGHASH_ALL), vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    mtx.vin[0].scriptSig = CScript() << vchSig;
+    BOOST_CHECK(key.Sign(uint256S("01"), vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    mtx.vin[1].scriptSig = CScript() << vchSig;
+    CTransaction tx(mtx);
+
+    std::vector<CScriptCheck> vChecks(2);
+    CScriptCheck check0(txPrev.vout[0].scriptPubKey, txPrev.vout[0].nValue, tx, 0, SCRIPT_VERIFY_P2SH, false, nullptr, true);
+    CScriptCheck check1(txPrev.vout[1].scriptPubKey, txPrev.vout[1].nValue, tx, 1, SCRIPT_VERIFY_P2SH, false, nullptr, true);
+    vChecks[0].swap(check0);
+    vChecks[1].swap(check1);
+    // the second script needs the signature to be invalid, so it can't assume it to be valid
+    BOOST_CHECK(vChecks[0]());
+    BOOST_CHECK(vChecks[1]());
+    BOOST_CHECK(FinishCheckBatch(vChecks));
+
+    // the deferred invalid signature is only caught when the batch is verified
+    mtx.vin[0].scriptSig = mtx.vin[1].scriptSig;
+    CTransaction txInvalid(mtx);
+    std::vector<CScriptCheck> vChecksInvalid(1);
+    CScriptCheck check2(txPrev.vout[0].scriptPubKey, txPrev.vout[0].nValue, txInvalid, 0, SCRIPT_VERIFY_P2SH, false, nullptr, true);
+    vChecksInvalid[0].swap(check2);
+    BOOST_CHECK(vChecksInvalid[0]());
+    BOOST_CHECK(!FinishCheckBatch(vChecksInvalid));
+    BOOST_CHECK_EQUAL(vChecksInvalid[0].GetScriptError(), SCRIPT_ERR_EVAL_FALSE);
+}
+
+BOOST_FIXTURE_TEST_CASE(tx_mempool_parallel_script_checks, TestChain100Setup)
+{
+    CScript scriptPubKey = CScript() <<  ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const int nInputs = 6;
+
+    auto sign = [&](CMutableTransaction& mtx, unsigned int nIn) {
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(scriptPubKey, mtx, nIn, SIGHASH_ALL);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        mtx.vin[nIn].scriptSig = CScript() << vchSig;
+    };
+
+    // split the mature coinbase, so that a transaction with several inputs can be made
+    CMutableTransaction split;
+    split.vin.resize(1);
+    split.vin[0].prevout = COutPoint(coinbaseTxns[0].GetHash(), 0);
+    split.vout.resize(nInputs);
+    for (auto& txout : split.vout) {
+        txout.nValue = 10 * CENT;
+        txout.scriptPubKey = scriptPubKey;
+    }
+    sign(split, 0);
+    CBlock block = CreateAndProcessBlock({split}, scriptPubKey);
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == block.GetHash());
+
+    CMutableTransaction spend;
+    spend.vin.resize(nInputs);
+    for (int i = 0; i < nInputs; i++) {
+        spend.vin[i].prevout = COutPoint(split.GetHash(), i);
+    }
+    spend.vout.resize(1);
+    spend.vout[0].nValue = nInputs * 9 * CENT;
+    spend.vout[0].scriptPubKey = scriptPubKey;
+    for (int i = 0; i < nInputs; i++) {
+        sign(spend, i);
+    }
+
+    nMempoolParallelInputs = 2;
+
+    // one invalid signature is found by the parallel checks and rejected with the same reason as by the serial ones
+    CMutableTransaction invalid = spend;
+    std::vector<unsigned char> vchSig(invalid.vin[3].scriptSig.begin() + 1, invalid.vin[3].scriptSig.end());
+    vchSig[10] ^= 1;
+    invalid.vin[3].scriptSig = CScript() << vchSig;
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(!AcceptToMemoryPool(mempool, state, MakeTransactionRef(invalid), false, NULL, true, 0));
+        BOOST_CHECK(state.GetRejectReason().find("mandatory-script-verify-flag-failed") == 0);
+        BOOST_CHECK_EQUAL(mempool.size(), 0);
+    }
+
+    BOOST_CHECK(ToMemPool(spend));
+    BOOST_CHECK_EQUAL(mempool.size(), 1);
+
+    nMempoolParallelInputs = DEFAULT_MEMPOOL_PARALLEL_INPUTS;
+    mempool.clear();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -339,4 +339,29 @@ BOOST_AUTO_TEST_CASE(univalue_readwrite)
     BOOST_CHECK(!v.read("{} 42"));
 }
 
+BOOST_AUTO_TEST_CASE(univalue_write_chunked)
+{
+    UniValue v;
+    BOOST_CHECK(v.read(json1));
+
+    // flushing after every element must give the same output as write()
+    for (unsigned int prettyIndent : {0, 4}) {
+        std::string strOut;
+        size_t nFlushes = 0;
+        std::string strChunk;
+        v.write(strChunk, [&](const std::string& s) {
+            strOut += s;
+            nFlushes++;
+        }, 1, prettyIndent);
+        strOut += strChunk;
+        BOOST_CHECK_EQUAL(strOut, v.write(prettyIndent));
+        BOOST_CHECK(nFlushes > 1);
+    }
+
+    // nothing is flushed below the chunk size
+    std::string strChunk;
+    v.write(strChunk, [](const std::string& s) { BOOST_ERROR("unexpected flush"); });
+    BOOST_CHECK_EQUAL(strChunk, v.write());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -581,4 +581,19 @@ BOOST_AUTO_TEST_CASE(version_info_helper)
     BOOST_CHECK_THROW(IntVersionToString(0), std::bad_cast);
 }
 
+BOOST_AUTO_TEST_CASE(log_rate_limit)
+{
+    SetMockTime(1000000);
+    for (unsigned int i = 0; i < LOG_RATE_LIMIT_LINES; i++) {
+        BOOST_CHECK(LogRateLimitAccept("ratelimittest"));
+    }
+    BOOST_CHECK(!LogRateLimitAccept("ratelimittest"));
+    // categories are limited independently
+    BOOST_CHECK(LogRateLimitAccept("ratelimittest2"));
+
+    SetMockTime(1000000 + LOG_RATE_LIMIT_WINDOW);
+    BOOST_CHECK(LogRateLimitAccept("ratelimittest"));
+    SetMockTime(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,114 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "workerpool.h"
+
+#include "test/test_historia.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(workerpool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(workerpool_jobs)
+{
+    CWorkerPool pool;
+    pool.Start(4, "test-worker");
+    BOOST_CHECK_EQUAL(pool.Size(), 4);
+
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 100; i++) {
+        futures.emplace_back(pool.Push([i](int workerIdx) {
+            return i * 2;
+        }));
+    }
+    for (int i = 0; i < 100; i++) {
+        BOOST_CHECK_EQUAL(futures[i].get(), i * 2);
+    }
+
+    // jobs pushed from a job go to the queue of its worker, the other workers have to steal them
+    std::atomic<int> nSubJobs{0};
+    std::promise<void> allDone;
+    pool.Push([&](int workerIdx) {
+        for (int i = 0; i < 50; i++) {
+            pool.Push([&](int workerIdx2) {
+                if (++nSubJobs == 50) {
+                    allDone.set_value();
+                }
+            });
+        }
+    });
+    allDone.get_future().wait();
+    BOOST_CHECK_EQUAL(nSubJobs.load(), 50);
+
+    // exceptions end up in the future instead of the worker
+    auto fThrow = pool.Push([](int workerIdx) -> int {
+        throw std::runtime_error("test");
+    });
+    BOOST_CHECK_THROW(fThrow.get(), std::runtime_error);
+
+    pool.Stop();
+    BOOST_CHECK_EQUAL(pool.Size(), 0);
+
+    CWorkerPool::Stats stats = pool.GetStats();
+    BOOST_CHECK_EQUAL(stats.vCompleted[CWorkerPool::PRIORITY_NORMAL], 152);
+    BOOST_CHECK_EQUAL(stats.vQueued[CWorkerPool::PRIORITY_NORMAL], 0);
+}
+
+BOOST_AUTO_TEST_CASE(workerpool_priorities)
+{
+    CWorkerPool pool;
+    pool.Start(1, "test-worker");
+
+    // keep the only worker busy until all other jobs are queued
+    std::promise<void> started;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    auto fBlocker = pool.Push([&started, released](int workerIdx) {
+        started.set_value();
+        released.wait();
+    });
+    started.get_future().wait();
+
+    std::mutex cs;
+    std::vector<int> vOrder;
+    std::vector<std::future<void>> futures;
+    const CWorkerPool::Priority priorities[] = {CWorkerPool::PRIORITY_LOW, CWorkerPool::PRIORITY_HIGH, CWorkerPool::PRIORITY_NORMAL, CWorkerPool::PRIORITY_HIGH};
+    for (auto priority : priorities) {
+        futures.emplace_back(pool.Push([&cs, &vOrder, priority](int workerIdx) {
+            std::unique_lock<std::mutex> l(cs);
+            vOrder.emplace_back(priority);
+        }, priority));
+    }
+    BOOST_CHECK_EQUAL(pool.GetStats().vQueued[CWorkerPool::PRIORITY_HIGH], 2);
+
+    release.set_value();
+    fBlocker.get();
+    for (auto& f : futures) {
+        f.get();
+    }
+    std::vector<int> vExpected = {CWorkerPool::PRIORITY_HIGH, CWorkerPool::PRIORITY_HIGH, CWorkerPool::PRIORITY_NORMAL, CWorkerPool::PRIORITY_LOW};
+    BOOST_CHECK(vOrder == vExpected);
+
+    pool.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(workerpool_stop)
+{
+    CWorkerPool pool;
+
+    // jobs wait for the pool to be started and are dropped when it's stopped
+    auto f = pool.Push([](int workerIdx) {
+        return true;
+    });
+    BOOST_CHECK_EQUAL(pool.GetStats().vQueued[CWorkerPool::PRIORITY_NORMAL], 1);
+    pool.Stop();
+    BOOST_CHECK_THROW(f.get(), std::future_error);
+
+    // a stopped pool can be started again
+    pool.Start(2, "test-worker");
+    BOOST_CHECK(pool.Push([](int workerIdx) { return true; }).get());
+    pool.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
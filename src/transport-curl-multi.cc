@@ -0,0 +1,415 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <curl/curl.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "transport-curl-multi.h"
+
+namespace ipfs {
+
+namespace http {
+
+/* curl_global_init() is called by the global in transport-curl.cc. */
+
+/** How long the event thread waits for socket activity before it looks for
+ * new, canceled or timed out requests again. */
+static const int kWaitMs = 50;
+
+/** A request, owned by the queue or map it is in. */
+struct TransportCurlMulti::Request {
+  RequestId id;
+  std::string url;
+  std::vector<FileUpload> files;
+  long timeout_ms;
+  Callback callback;
+
+  /** CURL easy handle, set up by the event thread. */
+  CURL* easy = nullptr;
+  curl_httppost* form_parts = nullptr;
+  curl_slist* headers = nullptr;
+
+  std::string body;
+  char error[CURL_ERROR_SIZE];
+
+  /** FileUpload can't be assigned, only copied. */
+  explicit Request(const std::vector<FileUpload>& files_in) : files(files_in) {}
+
+  ~Request() {
+    if (easy != nullptr) {
+      curl_easy_cleanup(easy);
+    }
+    /* https://curl.haxx.se/libcurl/c/curl_formfree.html */
+    curl_formfree(form_parts);
+    /* https://curl.haxx.se/libcurl/c/curl_slist_free_all.html */
+    curl_slist_free_all(headers);
+  }
+};
+
+/** CURL callback for appending the result to a string. */
+static size_t curl_cb_string(char* ptr, size_t size, size_t nmemb,
+                             void* body_void) {
+  std::string* body = static_cast<std::string*>(body_void);
+  const size_t n = size * nmemb;
+  body->append(ptr, n);
+  return n;
+}
+
+TransportCurlMulti::TransportCurlMulti()
+    : next_id_(1), interrupted_(false), stop_(false) {
+  multi_ = curl_multi_init();
+  if (multi_ == NULL) {
+    throw std::runtime_error("curl_multi_init() failed");
+  }
+  thread_ = std::thread(&TransportCurlMulti::EventLoop, this);
+}
+
+TransportCurlMulti::~TransportCurlMulti() {
+  Shutdown();
+  curl_multi_cleanup(multi_);
+}
+
+TransportCurlMulti::RequestId TransportCurlMulti::Submit(
+    const std::string& url, const std::vector<FileUpload>& files,
+    long timeout_ms, Callback callback) {
+  std::unique_ptr<Request> request(new Request(files));
+  request->url = url;
+  request->timeout_ms = timeout_ms;
+  request->callback = std::move(callback);
+
+  RequestId id;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    id = request->id = next_id_++;
+    if (!interrupted_ && !stop_) {
+      pending_.emplace_back(std::move(request));
+      cond_.notify_one();
+      return id;
+    }
+  }
+
+  Finish(std::move(request), "request interrupted");
+  return id;
+}
+
+std::future<std::string> TransportCurlMulti::FetchAsync(
+    const std::string& url, const std::vector<FileUpload>& files,
+    long timeout_ms, RequestId* id) {
+  auto promise = std::make_shared<std::promise<std::string>>();
+  std::future<std::string> future = promise->get_future();
+
+  RequestId request_id = Submit(
+      url, files, timeout_ms,
+      [promise](const std::string& error, const std::string& body) {
+        if (error.empty()) {
+          promise->set_value(body);
+        } else {
+          promise->set_exception(
+              std::make_exception_ptr(std::runtime_error(error)));
+        }
+      });
+  if (id != nullptr) {
+    *id = request_id;
+  }
+  return future;
+}
+
+bool TransportCurlMulti::Cancel(RequestId id) {
+  std::unique_ptr<Request> request;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (active_.count(id) != 0) {
+      /* Only the event thread may touch the multi handle. */
+      return canceled_.insert(id).second;
+    }
+    for (auto it = pending_.begin(); it != pending_.end(); ++it) {
+      if ((*it)->id == id) {
+        request = std::move(*it);
+        pending_.erase(it);
+        break;
+      }
+    }
+  }
+
+  if (!request) {
+    return false;
+  }
+  Finish(std::move(request), "request canceled");
+  return true;
+}
+
+void TransportCurlMulti::Interrupt() {
+  std::deque<std::unique_ptr<Request>> pending;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    interrupted_ = true;
+    pending.swap(pending_);
+    for (const auto& p : active_) {
+      canceled_.insert(p.first);
+    }
+  }
+
+  for (auto& request : pending) {
+    Finish(std::move(request), "request interrupted");
+  }
+}
+
+void TransportCurlMulti::Shutdown() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+    cond_.notify_one();
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+size_t TransportCurlMulti::GetInFlightCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pending_.size() + active_.size();
+}
+
+bool TransportCurlMulti::Setup(Request& request) {
+  request.easy = curl_easy_init();
+  if (request.easy == NULL) {
+    return false;
+  }
+  CURL* easy = request.easy;
+
+  /* https://curl.haxx.se/libcurl/c/CURLOPT_PRIVATE.html */
+  curl_easy_setopt(easy, CURLOPT_PRIVATE, &request);
+
+  request.error[0] = '\0';
+  /* https://curl.haxx.se/libcurl/c/CURLOPT_ERRORBUFFER.html */
+  curl_easy_setopt(easy, CURLOPT_ERRORBUFFER, request.error);
+
+  /* No signals with many transfers in one process.
+   * https://curl.haxx.se/libcurl/c/CURLOPT_NOSIGNAL.html */
+  curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+
+  /* https://curl.haxx.se/libcurl/c/CURLOPT_TCP_KEEPALIVE.html */
+  curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+  curl_easy_setopt(easy, CURLOPT_TCP_KEEPIDLE, 30L);
+  curl_easy_setopt(easy, CURLOPT_TCP_KEEPINTVL, 10L);
+
+  /* https://curl.haxx.se/libcurl/c/CURLOPT_USERAGENT.html */
+  curl_easy_setopt(easy, CURLOPT_USERAGENT, "cpp-ipfs-api");
+
+  /* https://curl.haxx.se/libcurl/c/CURLOPT_URL.html */
+  curl_easy_setopt(easy, CURLOPT_URL, request.url.c_str());
+  /* https://curl.haxx.se/libcurl/c/CURLOPT_TIMEOUT_MS.html */
+  curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, request.timeout_ms);
+
+  /* https://curl.haxx.se/libcurl/c/CURLOPT_WRITEFUNCTION.html */
+  curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, curl_cb_string);
+  curl_easy_setopt(easy, CURLOPT_WRITEDATA, &request.body);
+
+  curl_httppost* form_parts_end = NULL;
+  for (size_t i = 0; i < request.files.size(); ++i) {
+    const FileUpload& file = request.files[i];
+    const std::string name("file" + std::to_string(i));
+    static const char* content_type = "application/octet-stream";
+
+    switch (file.type) {
+      case FileUpload::Type::kFileContents:
+        /* The buffer is not copied, `request.files` outlives the transfer. */
+        curl_formadd(&request.form_parts, &form_parts_end,
+                     CURLFORM_COPYNAME, name.c_str(),
+                     CURLFORM_BUFFER, file.path.c_str(),
+                     CURLFORM_BUFFERPTR, file.data.c_str(),
+                     CURLFORM_BUFFERLENGTH, file.data.length(),
+                     CURLFORM_CONTENTTYPE, content_type, CURLFORM_END);
+        break;
+      case FileUpload::Type::kFileName:
+        curl_formadd(&request.form_parts, &form_parts_end,
+                     CURLFORM_COPYNAME, name.c_str(),
+                     CURLFORM_FILENAME, file.path.c_str(),
+                     CURLFORM_FILE, file.data.c_str(),
+                     CURLFORM_CONTENTTYPE, content_type, CURLFORM_END);
+        break;
+    }
+  }
+  if (request.form_parts != NULL) {
+    /* https://curl.haxx.se/libcurl/c/CURLOPT_HTTPPOST.html */
+    curl_easy_setopt(easy, CURLOPT_HTTPPOST, request.form_parts);
+  } else {
+    /* https://curl.haxx.se/libcurl/c/CURLOPT_HTTPGET.html */
+    curl_easy_setopt(easy, CURLOPT_HTTPGET, 1L);
+  }
+
+  request.headers = curl_slist_append(request.headers, "Expect:");
+  /* https://curl.haxx.se/libcurl/c/CURLOPT_HTTPHEADER.html */
+  curl_easy_setopt(easy, CURLOPT_HTTPHEADER, request.headers);
+
+  return true;
+}
+
+void TransportCurlMulti::Finish(std::unique_ptr<Request> request,
+                                const std::string& error) {
+  if (request->easy != nullptr) {
+    curl_multi_remove_handle(multi_, request->easy);
+  }
+  Callback callback = std::move(request->callback);
+  std::string body = std::move(request->body);
+  request.reset();
+
+  callback(error, body);
+}
+
+void TransportCurlMulti::Done(CURL* easy, CURLcode result) {
+  Request* ptr = nullptr;
+  curl_easy_getinfo(easy, CURLINFO_PRIVATE, reinterpret_cast<char**>(&ptr));
+
+  std::unique_ptr<Request> request;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = active_.find(ptr->id);
+    if (it == active_.end()) {
+      return;
+    }
+    request = std::move(it->second);
+    active_.erase(it);
+    canceled_.erase(request->id);
+  }
+
+  std::string error;
+  if (result != CURLE_OK) {
+    error = curl_easy_strerror(result);
+    if (request->error[0] != '\0') {
+      error += std::string(": ") + request->error;
+    }
+  } else {
+    long status_code = 0;
+    CURLcode res =
+        curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &status_code);
+    if (res != CURLE_OK) {
+      error = std::string("Can't get the HTTP status code from CURL: ") +
+              curl_easy_strerror(res);
+    } else if (status_code < 200 || status_code > 299) {
+      error = "HTTP request failed with status code " +
+              std::to_string(status_code) + ". Response body:\n" +
+              request->body;
+    }
+  }
+
+  Finish(std::move(request), error);
+}
+
+void TransportCurlMulti::EventLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (!stop_) {
+    std::vector<std::unique_ptr<Request>> failed;
+    std::vector<std::unique_ptr<Request>> canceled;
+
+    while (!pending_.empty()) {
+      std::unique_ptr<Request> request = std::move(pending_.front());
+      pending_.pop_front();
+      if (!Setup(*request) ||
+          curl_multi_add_handle(multi_, request->easy) != CURLM_OK) {
+        /* Nothing to remove from the multi handle. */
+        if (request->easy != nullptr) {
+          curl_easy_cleanup(request->easy);
+          request->easy = nullptr;
+        }
+        failed.emplace_back(std::move(request));
+        continue;
+      }
+      RequestId id = request->id;
+      active_.emplace(id, std::move(request));
+    }
+
+    for (RequestId id : canceled_) {
+      auto it = active_.find(id);
+      if (it != active_.end()) {
+        canceled.emplace_back(std::move(it->second));
+        active_.erase(it);
+      }
+    }
+    canceled_.clear();
+
+    bool idle = active_.empty();
+    lock.unlock();
+
+    for (auto& request : failed) {
+      Finish(std::move(request), "curl_easy_init() failed");
+    }
+    for (auto& request : canceled) {
+      Finish(std::move(request), "request canceled");
+    }
+
+    if (!idle) {
+      int running = 0;
+      curl_multi_perform(multi_, &running);
+
+      CURLMsg* msg;
+      int left = 0;
+      while ((msg = curl_multi_info_read(multi_, &left)) != NULL) {
+        if (msg->msg == CURLMSG_DONE) {
+          Done(msg->easy_handle, msg->data.result);
+        }
+      }
+
+      int numfds = 0;
+      curl_multi_wait(multi_, NULL, 0, kWaitMs, &numfds);
+    }
+
+    lock.lock();
+    if (idle) {
+      cond_.wait(lock, [this]() { return stop_ || !pending_.empty(); });
+    }
+  }
+
+  std::deque<std::unique_ptr<Request>> pending;
+  pending.swap(pending_);
+  std::map<RequestId, std::unique_ptr<Request>> active;
+  active.swap(active_);
+  canceled_.clear();
+  lock.unlock();
+
+  for (auto& p : active) {
+    Finish(std::move(p.second), "transport shutting down");
+  }
+  for (auto& request : pending) {
+    Finish(std::move(request), "transport shutting down");
+  }
+}
+
+TransportCurlMultiAdapter::TransportCurlMultiAdapter(
+    std::shared_ptr<TransportCurlMulti> multi, long timeout_ms)
+    : multi_(std::move(multi)), timeout_ms_(timeout_ms) {}
+
+void TransportCurlMultiAdapter::Fetch(const std::string& url,
+                                      const std::vector<FileUpload>& files,
+                                      std::iostream* response) {
+  /* The event thread fails the request after the timeout at the latest. */
+  std::string body = multi_->FetchAsync(url, files, timeout_ms_).get();
+  response->write(body.data(), body.size());
+}
+
+void TransportCurlMultiAdapter::UrlEncode(const std::string& raw,
+                                          std::string* encoded) {
+  /* Same as curl_easy_escape(), which needs an easy handle. */
+  static const char* hex = "0123456789ABCDEF";
+  encoded->clear();
+  for (unsigned char c : raw) {
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+        (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' ||
+        c == '~') {
+      encoded->push_back(c);
+    } else {
+      encoded->push_back('%');
+      encoded->push_back(hex[c >> 4]);
+      encoded->push_back(hex[c & 0xf]);
+    }
+  }
+}
+
+} /* namespace http */
+} /* namespace ipfs */
@@ -0,0 +1,176 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef IPFS_HTTP_TRANSPORT_CURL_MULTI_H
+#define IPFS_HTTP_TRANSPORT_CURL_MULTI_H
+
+#include <curl/curl.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "transport.h"
+
+namespace ipfs {
+
+namespace http {
+
+/** Asynchronous HTTP transport, implemented using a CURL multi handle.
+ *
+ * All transfers are driven by a single event thread, so any number of
+ * requests can be in flight without blocking their callers. Every request has
+ * a timeout after which it fails, and requests can be canceled individually or
+ * all at once. The connections to a host are kept alive in the connection cache
+ * of the multi handle and shared by all requests. */
+class TransportCurlMulti {
+ public:
+  /** Identifies a submitted request, never 0. */
+  typedef uint64_t RequestId;
+
+  /** Called from the event thread when a request finished. `error` is empty
+   * on success, `body` holds the response body either way. */
+  typedef std::function<void(const std::string& error, const std::string& body)>
+      Callback;
+
+  /** Constructor, starts the event thread. */
+  TransportCurlMulti();
+
+  /** Destructor, fails all requests which did not finish yet. */
+  ~TransportCurlMulti();
+
+  /** Submit a request. If any files are provided in `files`, they are
+   * submitted using "Content-Type: multipart/form-data".
+   * @return the id of the request */
+  RequestId Submit(
+      /** [in] URL to get. */
+      const std::string& url,
+      /** [in] List of files to upload. */
+      const std::vector<FileUpload>& files,
+      /** [in] Milliseconds after which the request fails. */
+      long timeout_ms,
+      /** [in] Called with the result. */
+      Callback callback);
+
+  /** Submit a request, see `Submit()`. The future throws std::exception if
+   * the request failed, including erroneous HTTP status code. */
+  std::future<std::string> FetchAsync(
+      /** [in] URL to get. */
+      const std::string& url,
+      /** [in] List of files to upload. */
+      const std::vector<FileUpload>& files,
+      /** [in] Milliseconds after which the request fails. */
+      long timeout_ms,
+      /** [out] Id of the request, may be nullptr. */
+      RequestId* id = nullptr);
+
+  /** Cancel a request. Its callback is called with an error unless it
+   * finished already.
+   * @return false if the request is not known (anymore) */
+  bool Cancel(RequestId id);
+
+  /** Cancel all requests and fail all requests submitted from now on. */
+  void Interrupt();
+
+  /** Stop the event thread, requests which did not finish yet fail. */
+  void Shutdown();
+
+  /** Number of requests which did not finish yet. */
+  size_t GetInFlightCount() const;
+
+ private:
+  struct Request;
+
+  /** The event thread. */
+  void EventLoop();
+
+  /** Create and configure the easy handle of `request`, false on failure. */
+  bool Setup(Request& request);
+
+  /** Remove `request` from the multi handle and call its callback. */
+  void Finish(std::unique_ptr<Request> request, const std::string& error);
+
+  /** Result of a finished transfer. */
+  void Done(CURL* easy, CURLcode result);
+
+  /** Guards everything below. */
+  mutable std::mutex mutex_;
+
+  /** Signalled when there is work for the event thread. */
+  std::condition_variable cond_;
+
+  /** CURL multi handle, only used by the event thread. */
+  CURLM* multi_;
+
+  /** Next request id. */
+  RequestId next_id_;
+
+  /** Requests waiting to be added to the multi handle. */
+  std::deque<std::unique_ptr<Request>> pending_;
+
+  /** Requests added to the multi handle, by id. */
+  std::map<RequestId, std::unique_ptr<Request>> active_;
+
+  /** Ids of active requests to be canceled by the event thread. */
+  std::set<RequestId> canceled_;
+
+  /** Set by `Interrupt()`. */
+  bool interrupted_;
+
+  /** Set by `Shutdown()`. */
+  bool stop_;
+
+  std::thread thread_;
+};
+
+/** Synchronous `Transport` on top of a shared `TransportCurlMulti`, so that
+ * `ipfs::Client` instances can use it. Calls still block, but never longer
+ * than the timeout, and are aborted by `TransportCurlMulti::Interrupt()`. */
+class TransportCurlMultiAdapter : public Transport {
+ public:
+  /** Constructor. */
+  TransportCurlMultiAdapter(
+      /** [in] The transport to run the requests on. */
+      std::shared_ptr<TransportCurlMulti> multi,
+      /** [in] Milliseconds after which a request fails. */
+      long timeout_ms);
+
+  /** Fetch the contents of a given URL. If any files are provided in `files`,
+   * they are submitted using "Content-Type: multipart/form-data".
+   *
+   * @throw std::exception if any error occurs including erroneous HTTP status
+   * code */
+  void Fetch(
+      /** [in] URL to get. */
+      const std::string& url,
+      /** [in] List of files to upload. */
+      const std::vector<FileUpload>& files,
+      /** [out] Output to save the response body to. */
+      std::iostream* response) override;
+
+  /** URL encode a string. */
+  void UrlEncode(
+      /** [in] Input string to encode. */
+      const std::string& raw,
+      /** [out] URL encoded result. */
+      std::string* encoded) override;
+
+ private:
+  std::shared_ptr<TransportCurlMulti> multi_;
+  long timeout_ms_;
+};
+
+} /* namespace http */
+} /* namespace ipfs */
+
+#endif /* IPFS_HTTP_TRANSPORT_CURL_MULTI_H */
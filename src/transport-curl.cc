@@ -151,7 +151,9 @@ void TransportCurl::Fetch(const std::string& url,
       });
 
   /* https://curl.haxx.se/libcurl/c/CURLOPT_HTTPPOST.html */
-  curl_easy_setopt(curl_, CURLOPT_HTTPGET, form_parts);
+  if (form_parts != NULL) {
+    curl_easy_setopt(curl_, CURLOPT_HTTPPOST, form_parts);
+  }
 
   curl_slist* headers = NULL;
   /* https://curl.haxx.se/libcurl/c/curl_slist_append.html */
@@ -5,14 +5,20 @@
 
 #include "txdb.h"
 
+#include "blockfilter.h"
 #include "chainparams.h"
 #include "hash.h"
+#include "memusage.h"
 #include "pow.h"
 #include "uint256.h"
 #include "ui_interface.h"
 #include "init.h"
+#include "workerpool.h"
 
+#include <future>
+#include <set>
 #include <stdint.h>
+#include <tuple>
 
 #include <boost/thread.hpp>
 
@@ -22,14 +28,19 @@ static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
 static const char DB_ADDRESSINDEX = 'a';
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_ADDRESSBALANCE = 'A';
 static const char DB_TIMESTAMPINDEX = 's';
 static const char DB_SPENTINDEX = 'p';
+static const char DB_BLOCKFILTER = 'g';
+static const char DB_BLOCKFILTER_HEADER = 'h';
 static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_INDEX_BUILD_TIP = 'T';
+static const char DB_ADDRESSBALANCE_COMPLETE = 'W';
 
 namespace {
 
@@ -55,7 +66,7 @@ struct CoinEntry {
 
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true) 
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true, "chainstate") 
 {
 }
 
@@ -99,12 +110,192 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     return ret;
 }
 
+bool CCoinsViewDB::WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    CDBBatch batch(db);
+    size_t changed = 0;
+    for (const auto& p : mapCoins) {
+        if (p.second.flags & CCoinsCacheEntry::DIRTY) {
+            CoinEntry entry(&p.first);
+            if (p.second.coin.IsSpent())
+                batch.Erase(entry);
+            else
+                batch.Write(entry, p.second.coin);
+            changed++;
+        }
+    }
+    if (!hashBlock.IsNull())
+        batch.Write(DB_BEST_BLOCK, hashBlock);
+
+    bool ret = db.WriteBatch(batch);
+    LogPrint("coindb", "Committed %u changed transaction outputs to coin database...\n", (unsigned int)changed);
+    return ret;
+}
+
+CCoinsViewDBFlusher::CCoinsViewDBFlusher(CCoinsViewDB* _pdb) : pdb(_pdb)
+{
+    thread = std::thread(&TraceThread<std::function<void()> >, "coinsflush", std::function<void()>(std::bind(&CCoinsViewDBFlusher::ThreadMain, this)));
+}
+
+CCoinsViewDBFlusher::~CCoinsViewDBFlusher()
+{
+    {
+        std::unique_lock<std::mutex> l(cs);
+        fStop = true;
+    }
+    cond.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+bool CCoinsViewDBFlusher::GetCoin(const COutPoint &outpoint, Coin &coin) const
+{
+    std::shared_ptr<const CCoinsMap> coins;
+    {
+        std::unique_lock<std::mutex> l(cs);
+        coins = pendingCoins;
+    }
+    if (coins) {
+        auto it = coins->find(outpoint);
+        if (it != coins->end()) {
+            if (it->second.coin.IsSpent()) {
+                return false;
+            }
+            coin = it->second.coin;
+            return true;
+        }
+    }
+    return pdb->GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewDBFlusher::HaveCoin(const COutPoint &outpoint) const
+{
+    std::shared_ptr<const CCoinsMap> coins;
+    {
+        std::unique_lock<std::mutex> l(cs);
+        coins = pendingCoins;
+    }
+    if (coins) {
+        auto it = coins->find(outpoint);
+        if (it != coins->end()) {
+            return !it->second.coin.IsSpent();
+        }
+    }
+    return pdb->HaveCoin(outpoint);
+}
+
+uint256 CCoinsViewDBFlusher::GetBestBlock() const
+{
+    {
+        std::unique_lock<std::mutex> l(cs);
+        if (pendingCoins && !pendingBestBlock.IsNull()) {
+            return pendingBestBlock;
+        }
+    }
+    return pdb->GetBestBlock();
+}
+
+namespace {
+/** A coins map together with the pool its entries are allocated from */
+struct CPooledCoinsMap {
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map{0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource};
+};
+}
+
+bool CCoinsViewDBFlusher::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock)
+{
+    if (!WaitForFlush()) {
+        return false;
+    }
+
+    // only the dirty entries need to be written and kept readable
+    auto pooled = std::make_shared<CPooledCoinsMap>();
+    CCoinsMap& coins = pooled->map;
+    size_t nUsage = 0;
+    for (auto it = mapCoins.begin(); it != mapCoins.end(); it = mapCoins.erase(it)) {
+        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+            nUsage += it->second.coin.DynamicMemoryUsage();
+            coins.emplace(it->first, std::move(it->second));
+        }
+    }
+    nUsage += memusage::DynamicUsage(coins);
+
+    {
+        std::unique_lock<std::mutex> l(cs);
+        // readers only see the map, the aliasing pointer keeps its pool alive with it
+        pendingCoins = std::shared_ptr<const CCoinsMap>(pooled, &pooled->map);
+        pendingBestBlock = hashBlock;
+        nPendingUsage = nUsage;
+    }
+    cond.notify_all();
+    return true;
+}
+
+CCoinsViewCursor *CCoinsViewDBFlusher::Cursor() const
+{
+    WaitForFlush();
+    return pdb->Cursor();
+}
+
+size_t CCoinsViewDBFlusher::EstimateSize() const
+{
+    return pdb->EstimateSize();
+}
+
+bool CCoinsViewDBFlusher::WaitForFlush() const
+{
+    std::unique_lock<std::mutex> l(cs);
+    cond.wait(l, [this]() { return !pendingCoins || fWriteFailed; });
+    return !fWriteFailed;
+}
+
+size_t CCoinsViewDBFlusher::GetPendingUsage() const
+{
+    std::unique_lock<std::mutex> l(cs);
+    return pendingCoins ? nPendingUsage : 0;
+}
+
+void CCoinsViewDBFlusher::ThreadMain()
+{
+    while (true) {
+        std::shared_ptr<const CCoinsMap> coins;
+        uint256 hashBlock;
+        {
+            std::unique_lock<std::mutex> l(cs);
+            cond.wait(l, [this]() { return fStop || (pendingCoins && !fWriteFailed); });
+            if (!pendingCoins || fWriteFailed) {
+                // stopping, the final flush at shutdown always waits for the write
+                return;
+            }
+            coins = pendingCoins;
+            hashBlock = pendingBestBlock;
+        }
+
+        bool fOk = pdb->WriteCoins(*coins, hashBlock);
+
+        {
+            std::unique_lock<std::mutex> l(cs);
+            if (fOk) {
+                // readers may still hold the map, it is freed when the last one is done
+                pendingCoins.reset();
+                nPendingUsage = 0;
+            } else {
+                // keep the entries readable, the next flush fails and aborts the node
+                LogPrintf("%s: failed to write to coin database\n", __func__);
+                fWriteFailed = true;
+            }
+        }
+        cond.notify_all();
+    }
+}
+
 size_t CCoinsViewDB::EstimateSize() const
 {
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, false, "blockindex") {
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -204,11 +395,44 @@ bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos>
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
+bool COptionalIndexDB::ReadBuildTip(uint256 &hashBlock) {
+    return Read(DB_INDEX_BUILD_TIP, hashBlock);
+}
+
+bool COptionalIndexDB::WriteBuildTip(const uint256 &hashBlock) {
+    return Write(DB_INDEX_BUILD_TIP, hashBlock);
+}
+
+bool COptionalIndexDB::EraseBuildTip() {
+    return Erase(DB_INDEX_BUILD_TIP, true);
+}
+
+CAddressIndexDB::CAddressIndexDB(size_t nCacheSize, bool fMemory, bool fWipe) : COptionalIndexDB(GetDataDir() / "blocks" / "addressindex", nCacheSize, fMemory, fWipe) {
+}
+
+CSpentIndexDB::CSpentIndexDB(size_t nCacheSize, bool fMemory, bool fWipe) : COptionalIndexDB(GetDataDir() / "blocks" / "spentindex", nCacheSize, fMemory, fWipe) {
+}
+
+CTimestampIndexDB::CTimestampIndexDB(size_t nCacheSize, bool fMemory, bool fWipe) : COptionalIndexDB(GetDataDir() / "blocks" / "timestampindex", nCacheSize, fMemory, fWipe) {
+}
+
+CBlockFilterIndexDB::CBlockFilterIndexDB(size_t nCacheSize, bool fMemory, bool fWipe) : COptionalIndexDB(GetDataDir() / "blocks" / "blockfilterindex", nCacheSize, fMemory, fWipe) {
+}
+
+bool CSpentIndexDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
     return Read(std::make_pair(DB_SPENTINDEX, key), value);
 }
 
-bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
+size_t CSpentIndexDB::ReadSpentIndexes(const std::vector<CSpentIndexKey>& keys, std::vector<CSpentIndexValue>& values, std::vector<bool>& found) {
+    std::vector<std::pair<char, CSpentIndexKey> > dbKeys;
+    dbKeys.reserve(keys.size());
+    for (const auto& key : keys) {
+        dbKeys.emplace_back(DB_SPENTINDEX, key);
+    }
+    return ReadMany(dbKeys, values, found);
+}
+
+bool CSpentIndexDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
@@ -220,7 +444,7 @@ bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey,
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
+bool CAddressIndexDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
@@ -232,7 +456,7 @@ bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddres
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
+bool CAddressIndexDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
                                            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
@@ -258,42 +482,202 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
     return true;
 }
 
-bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
+void CAddressIndexDB::UpdateAddressBalances(CDBBatch& batch, const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect, bool fErase) {
+    typedef std::pair<unsigned int, uint160> AddressKey;
+
+    // entries which are already written (e.g. when blocks are connected again after a crash) must not be
+    // counted twice and erased entries are subtracted with the value they were written with
+    std::vector<std::pair<char, CAddressIndexKey> > keys;
+    keys.reserve(vect.size());
+    for (const auto& p : vect) {
+        keys.emplace_back(DB_ADDRESSINDEX, p.first);
+    }
+    std::vector<CAmount> values;
+    std::vector<bool> found;
+    ReadMany(keys, values, found);
+
+    std::map<AddressKey, CAddressBalance> mapChanges;
+    std::set<std::tuple<unsigned int, uint160, int, unsigned int, uint256, size_t, bool> > setEntries;
+    std::set<std::pair<AddressKey, uint256> > setTxes;
+    for (size_t i = 0; i < vect.size(); i++) {
+        const CAddressIndexKey& key = vect[i].first;
+        if (found[i] != fErase) {
+            continue;
+        }
+        if (!setEntries.emplace(key.type, key.hashBytes, key.blockHeight, key.txindex, key.txhash, key.index, key.spending).second) {
+            continue;
+        }
+        CAmount nValue = fErase ? values[i] : vect[i].second;
+        AddressKey addressKey(key.type, key.hashBytes);
+        CAddressBalance& change = mapChanges[addressKey];
+        change.balance += nValue;
+        if (nValue > 0) {
+            change.received += nValue;
+        }
+        // all entries of a tx are written and erased together
+        if (setTxes.emplace(addressKey, key.txhash).second) {
+            change.txCount++;
+        }
+    }
+
+    std::vector<std::pair<char, CAddressIndexIteratorKey> > balanceKeys;
+    balanceKeys.reserve(mapChanges.size());
+    for (const auto& p : mapChanges) {
+        balanceKeys.emplace_back(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(p.first.first, p.first.second));
+    }
+    std::vector<CAddressBalance> balances;
+    ReadMany(balanceKeys, balances, found);
+
+    size_t i = 0;
+    for (const auto& p : mapChanges) {
+        CAddressBalance& balance = balances[i];
+        int nSign = fErase ? -1 : 1;
+        balance.balance += nSign * p.second.balance;
+        balance.received += nSign * p.second.received;
+        balance.txCount += nSign * p.second.txCount;
+        if (balance.IsNull()) {
+            batch.Erase(balanceKeys[i]);
+        } else {
+            batch.Write(balanceKeys[i], balance);
+        }
+        i++;
+    }
+}
+
+bool CAddressIndexDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     CDBBatch batch(*this);
+    std::unique_lock<std::mutex> l(cs_balances);
+    if (fBalances) {
+        UpdateAddressBalances(batch, vect, false);
+    }
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
+bool CAddressIndexDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     CDBBatch batch(*this);
+    std::unique_lock<std::mutex> l(cs_balances);
+    if (fBalances) {
+        UpdateAddressBalances(batch, vect, true);
+    }
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Erase(std::make_pair(DB_ADDRESSINDEX, it->first));
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
+bool CAddressIndexDB::ReadAddressBalance(uint160 addressHash, int type, CAddressBalance &balance) {
+    if (!fBalances) {
+        return false;
+    }
+    if (!Read(std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, addressHash)), balance)) {
+        // no entries for this address
+        balance.SetNull();
+    }
+    return true;
+}
+
+bool CAddressIndexDB::UpgradeAddressBalances() {
+    if (Exists(DB_ADDRESSBALANCE_COMPLETE)) {
+        fBalances = true;
+        return true;
+    }
+
+    // the entries are sorted by address and all entries of a tx are next to each other
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(DB_ADDRESSINDEX);
+
+    CDBBatch batch(*this);
+    CAddressIndexIteratorKey addressKey;
+    CAddressBalance balance;
+    uint256 lastTxHash;
+    bool fHaveAddress = false;
+    size_t nAddresses = 0;
+    while (true) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressIndexKey> key;
+        bool fValid = pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX;
+        if (fHaveAddress && (!fValid || key.second.type != addressKey.type || key.second.hashBytes != addressKey.hashBytes)) {
+            batch.Write(std::make_pair(DB_ADDRESSBALANCE, addressKey), balance);
+            nAddresses++;
+            fHaveAddress = false;
+            if (batch.SizeEstimate() > (1 << 24)) {
+                if (!WriteBatch(batch)) {
+                    return false;
+                }
+                batch.Clear();
+            }
+        }
+        if (!fValid) {
+            break;
+        }
+
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue)) {
+            return error("%s: failed to read address index entry", __func__);
+        }
+        if (!fHaveAddress) {
+            addressKey = CAddressIndexIteratorKey(key.second.type, key.second.hashBytes);
+            balance.SetNull();
+            lastTxHash.SetNull();
+            fHaveAddress = true;
+        }
+        balance.balance += nValue;
+        if (nValue > 0) {
+            balance.received += nValue;
+        }
+        if (key.second.txhash != lastTxHash) {
+            balance.txCount++;
+            lastTxHash = key.second.txhash;
+        }
+        pcursor->Next();
+    }
+    batch.Write(DB_ADDRESSBALANCE_COMPLETE, true);
+    if (!WriteBatch(batch, true)) {
+        return false;
+    }
+    if (nAddresses != 0) {
+        LogPrintf("%s: computed the balances of %d addresses\n", __func__, nAddresses);
+    }
+    fBalances = true;
+    return true;
+}
+
+bool CAddressIndexDB::ReadAddressIndex(uint160 addressHash, int type,
                                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
+                                    int start, int end, size_t limit, const CAddressIndexKey* pafter) {
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
-    if (start > 0 && end > 0) {
+    if (pafter && pafter->type == (unsigned int)type && pafter->hashBytes == addressHash && pafter->blockHeight >= start) {
+        // continue a previous scan, which returned up to and including *pafter
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, *pafter));
+    } else if (start > 0 && end > 0) {
         pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
     } else {
         pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
     }
 
+    size_t nFound = 0;
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
         std::pair<char,CAddressIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.hashBytes == addressHash) {
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.type == (unsigned int)type && key.second.hashBytes == addressHash) {
             if (end > 0 && key.second.blockHeight > end) {
                 break;
             }
+            if (limit != 0 && nFound >= limit) {
+                break;
+            }
+            if (pafter && key.second.blockHeight == pafter->blockHeight && key.second.txindex == pafter->txindex &&
+                    key.second.txhash == pafter->txhash && key.second.index == pafter->index && key.second.spending == pafter->spending) {
+                pcursor->Next();
+                continue;
+            }
             CAmount nValue;
             if (pcursor->GetValue(nValue)) {
                 addressIndex.push_back(std::make_pair(key.second, nValue));
+                nFound++;
                 pcursor->Next();
             } else {
                 return error("failed to get address index value");
@@ -306,13 +690,13 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
     return true;
 }
 
-bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
+bool CTimestampIndexDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
     CDBBatch batch(*this);
     batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes) {
+bool CTimestampIndexDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes) {
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
@@ -332,6 +716,34 @@ bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned i
     return true;
 }
 
+bool CBlockFilterIndexDB::WriteFilter(const BlockFilter &filter, const uint256 &header) {
+    CDBBatch batch(*this);
+    batch.Write(std::make_pair(DB_BLOCKFILTER, filter.GetBlockHash()), filter.GetEncodedFilter());
+    batch.Write(std::make_pair(DB_BLOCKFILTER_HEADER, filter.GetBlockHash()), std::make_pair(filter.GetHash(), header));
+    return WriteBatch(batch);
+}
+
+bool CBlockFilterIndexDB::ReadFilter(const uint256 &blockHash, BlockFilter &filter) {
+    std::vector<unsigned char> vchFilter;
+    if (!Read(std::make_pair(DB_BLOCKFILTER, blockHash), vchFilter))
+        return false;
+    try {
+        filter = BlockFilter(BLOCK_FILTER_BASIC, blockHash, std::move(vchFilter));
+    } catch (const std::exception& e) {
+        return error("%s: invalid filter of block %s: %s", __func__, blockHash.ToString(), e.what());
+    }
+    return true;
+}
+
+bool CBlockFilterIndexDB::ReadFilterHeader(const uint256 &blockHash, uint256 &filterHash, uint256 &header) {
+    std::pair<uint256, uint256> value;
+    if (!Read(std::make_pair(DB_BLOCKFILTER_HEADER, blockHash), value))
+        return false;
+    filterHash = value.first;
+    header = value.second;
+    return true;
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
@@ -344,44 +756,135 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+template <typename K, typename V>
+static bool MoveIndexEntries(CDBWrapper& from, CDBWrapper& to, char prefix)
+{
+    std::unique_ptr<CDBIterator> pcursor(from.NewIterator());
+    pcursor->Seek(prefix);
+
+    CDBBatch batchTo(to);
+    CDBBatch batchFrom(from);
+    size_t nMoved = 0;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, K> key;
+        if (!pcursor->GetKey(key) || key.first != prefix) {
+            break;
+        }
+        V value;
+        if (!pcursor->GetValue(value)) {
+            return error("%s: failed to read index entry", __func__);
+        }
+        batchTo.Write(key, value);
+        batchFrom.Erase(key);
+        nMoved++;
+        if (batchTo.SizeEstimate() > (1 << 24)) {
+            // the new entries must be written before the old ones are removed
+            if (!to.WriteBatch(batchTo) || !from.WriteBatch(batchFrom)) {
+                return false;
+            }
+            batchTo.Clear();
+            batchFrom.Clear();
+        }
+        pcursor->Next();
+    }
+    if (!to.WriteBatch(batchTo, true) || !from.WriteBatch(batchFrom, true)) {
+        return false;
+    }
+    if (nMoved != 0) {
+        LogPrintf("%s: moved %d entries with prefix '%c'\n", __func__, nMoved, prefix);
+    }
+    return true;
+}
+
+bool CBlockTreeDB::MoveIndexesTo(CAddressIndexDB& addressIndexDB, CSpentIndexDB& spentIndexDB, CTimestampIndexDB& timestampIndexDB)
+{
+    return MoveIndexEntries<CAddressIndexKey, CAmount>(*this, addressIndexDB, DB_ADDRESSINDEX) &&
+           MoveIndexEntries<CAddressUnspentKey, CAddressUnspentValue>(*this, addressIndexDB, DB_ADDRESSUNSPENTINDEX) &&
+           MoveIndexEntries<CSpentIndexKey, CSpentIndexValue>(*this, spentIndexDB, DB_SPENTINDEX) &&
+           MoveIndexEntries<CTimestampIndexKey, int>(*this, timestampIndexDB, DB_TIMESTAMPINDEX);
+}
+
+bool CBlockTreeDB::ReadBlockIndexRange(int nBegin, int nEnd, std::vector<CDiskBlockIndex>& vEntriesRet, std::string& strErrorRet)
 {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
+    uint256 start;
+    *start.begin() = nBegin;
+    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, start));
 
-    // Load mapBlockIndex
     while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
         std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
-
-                if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, Params().GetConsensus()))
-                    return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
-
-                pcursor->Next();
-            } else {
-                return error("%s: failed to read value", __func__);
-            }
-        } else {
+        if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX || *key.second.begin() >= nEnd) {
             break;
         }
+        CDiskBlockIndex diskindex;
+        if (!pcursor->GetValue(diskindex)) {
+            strErrorRet = "failed to read value";
+            return false;
+        }
+        // the block hash is stored, this doesn't hash the header
+        if (!CheckProofOfWork(diskindex.GetBlockHash(), diskindex.nBits, Params().GetConsensus())) {
+            strErrorRet = strprintf("CheckProofOfWork failed: %s", diskindex.ToString());
+            return false;
+        }
+        vEntriesRet.emplace_back(diskindex);
+        pcursor->Next();
+    }
+    return true;
+}
+
+bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+{
+    // Entries are decoded and checked per range of the first byte of their key's hash, in parallel if
+    // possible. Only the inserts into mapBlockIndex are done on this thread.
+    const int nRanges = g_workerPool.Size() == 0 ? 1 : 16;
+    std::vector<std::vector<CDiskBlockIndex>> vRanges(nRanges);
+    std::vector<std::string> vErrors(nRanges);
+    std::vector<bool> vOk(nRanges);
+    if (nRanges == 1) {
+        vOk[0] = ReadBlockIndexRange(0, 256, vRanges[0], vErrors[0]);
+    } else {
+        std::vector<std::future<bool>> vFutures;
+        for (int i = 0; i < nRanges; i++) {
+            int nBegin = i * 256 / nRanges;
+            int nEnd = (i + 1) * 256 / nRanges;
+            vFutures.emplace_back(g_workerPool.Push([this, i, nBegin, nEnd, &vRanges, &vErrors](int) {
+                return ReadBlockIndexRange(nBegin, nEnd, vRanges[i], vErrors[i]);
+            }));
+        }
+        // the jobs write into vRanges, wait for all of them before bailing out
+        for (auto& future : vFutures) {
+            future.wait();
+        }
+        for (int i = 0; i < nRanges; i++) {
+            vOk[i] = vFutures[i].get();
+        }
+    }
+
+    // Load mapBlockIndex
+    for (int i = 0; i < nRanges; i++) {
+        if (!vOk[i]) {
+            return error("%s: %s", __func__, vErrors[i]);
+        }
+        for (const CDiskBlockIndex& diskindex : vRanges[i]) {
+            boost::this_thread::interruption_point();
+            // Construct block index object
+            CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
+            pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight        = diskindex.nHeight;
+            pindexNew->nFile          = diskindex.nFile;
+            pindexNew->nDataPos       = diskindex.nDataPos;
+            pindexNew->nUndoPos       = diskindex.nUndoPos;
+            pindexNew->nVersion       = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            pindexNew->nStatus        = diskindex.nStatus;
+            pindexNew->nTx            = diskindex.nTx;
+        }
+        std::vector<CDiskBlockIndex>().swap(vRanges[i]);
     }
 
     return true;
@@ -11,15 +11,24 @@
 #include "chain.h"
 #include "spentindex.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include <boost/function.hpp>
 
+class BlockFilter;
+class CAddressIndexDB;
 class CBlockIndex;
 class CCoinsViewDBCursor;
+class CSpentIndexDB;
+class CTimestampIndexDB;
 class uint256;
 
 //! Compensate for extra memory peak (x1.5-x1.9) at flush time.
@@ -40,6 +49,8 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxBlockDBAndTxIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! Max memory allocated to each of the address, spent and timestamp index DBs (MiB)
+static const int64_t nMaxIndexDBCache = 256;
 
 struct CDiskTxPos : public CDiskBlockPos
 {
@@ -79,6 +90,8 @@ public:
     bool HaveCoin(const COutPoint &outpoint) const override;
     uint256 GetBestBlock() const override;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    //! Like BatchWrite, but leaves mapCoins untouched so that it can be read while being written
+    bool WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock);
     CCoinsViewCursor *Cursor() const override;
 
     //! Attempt to update from an older database format. Returns whether an error occurred.
@@ -86,6 +99,48 @@ public:
     size_t EstimateSize() const override;
 };
 
+/**
+ * Sits between the coins tip cache and the coin database and writes flushed caches to the database on a background
+ * thread, so that validation can continue while a large cache is written. The flushed entries stay readable from
+ * here until they are on disk. Only one flush is pending at a time, the next one waits for it to finish.
+ */
+class CCoinsViewDBFlusher : public CCoinsView
+{
+private:
+    CCoinsViewDB* pdb;
+
+    mutable std::mutex cs;
+    mutable std::condition_variable cond;
+    std::shared_ptr<const CCoinsMap> pendingCoins;
+    uint256 pendingBestBlock;
+    size_t nPendingUsage{0};
+    bool fWriteFailed{false};
+    bool fStop{false};
+
+    std::thread thread;
+
+public:
+    explicit CCoinsViewDBFlusher(CCoinsViewDB* _pdb);
+    ~CCoinsViewDBFlusher();
+
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    bool HaveCoin(const COutPoint &outpoint) const override;
+    uint256 GetBestBlock() const override;
+    //! Takes over the dirty entries of mapCoins, waits for the previous flush if there is one
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    //! Waits for the pending flush, the cursor then iterates over the database
+    CCoinsViewCursor *Cursor() const override;
+    size_t EstimateSize() const override;
+
+    //! Wait until the pending flush is written, returns false if writing it failed
+    bool WaitForFlush() const;
+    //! Memory used by the entries which are being written
+    size_t GetPendingUsage() const;
+
+private:
+    void ThreadMain();
+};
+
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
 class CCoinsViewDBCursor: public CCoinsViewCursor
 {
@@ -124,8 +179,40 @@ public:
     bool ReadReindexing(bool &fReindex);
     bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &list);
-    bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
-    bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
+    bool WriteFlag(const std::string &name, bool fValue);
+    bool ReadFlag(const std::string &name, bool &fValue);
+    bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+
+    //! Move address, spent and timestamp index entries written by older versions into their own databases
+    bool MoveIndexesTo(CAddressIndexDB& addressIndexDB, CSpentIndexDB& spentIndexDB, CTimestampIndexDB& timestampIndexDB);
+
+private:
+    //! Read and check the block index entries whose key hash starts with a byte in [nBegin, nEnd), safe to run in parallel
+    bool ReadBlockIndexRange(int nBegin, int nEnd, std::vector<CDiskBlockIndex>& vEntriesRet, std::string& strErrorRet);
+};
+
+/** Common base of the optional index databases */
+class COptionalIndexDB : public CDBWrapper
+{
+public:
+    COptionalIndexDB(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe) :
+        CDBWrapper(path, nCacheSize, fMemory, fWipe) {}
+
+    //! The last block included by the background index builder, only present while the index is being built
+    bool ReadBuildTip(uint256 &hashBlock);
+    bool WriteBuildTip(const uint256 &hashBlock);
+    bool EraseBuildTip();
+};
+
+/** Access to the address and address unspent indexes (blocks/addressindex/) */
+class CAddressIndexDB : public COptionalIndexDB
+{
+public:
+    CAddressIndexDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+private:
+    CAddressIndexDB(const CAddressIndexDB&);
+    void operator=(const CAddressIndexDB&);
+public:
     bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
     bool ReadAddressUnspentIndex(uint160 addressHash, int type,
                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
@@ -133,12 +220,64 @@ public:
     bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool ReadAddressIndex(uint160 addressHash, int type,
                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                          int start = 0, int end = 0);
+                          int start = 0, int end = 0, size_t limit = 0, const CAddressIndexKey* pafter = nullptr);
+
+    //! Whether the balance table is complete, it is updated together with the address index entries then
+    bool HasAddressBalances() const { return fBalances; }
+    bool ReadAddressBalance(uint160 addressHash, int type, CAddressBalance &balance);
+    //! Build the balance table from the address index entries of databases written by older versions
+    bool UpgradeAddressBalances();
+
+private:
+    //! Add the balance changes of writing (or erasing) the entries of vect which aren't (or are) in the index to batch
+    void UpdateAddressBalances(CDBBatch& batch, const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect, bool fErase);
+
+    std::atomic<bool> fBalances{false};
+    //! Serializes the read-modify-write of the balances by the index writer and the index builder
+    std::mutex cs_balances;
+};
+
+/** Access to the spent index (blocks/spentindex/) */
+class CSpentIndexDB : public COptionalIndexDB
+{
+public:
+    CSpentIndexDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+private:
+    CSpentIndexDB(const CSpentIndexDB&);
+    void operator=(const CSpentIndexDB&);
+public:
+    bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
+    //! read all keys from one snapshot, see CDBWrapper::ReadMany
+    size_t ReadSpentIndexes(const std::vector<CSpentIndexKey>& keys, std::vector<CSpentIndexValue>& values, std::vector<bool>& found);
+    bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
+};
+
+/** Access to the timestamp index (blocks/timestampindex/) */
+class CTimestampIndexDB : public COptionalIndexDB
+{
+public:
+    CTimestampIndexDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+private:
+    CTimestampIndexDB(const CTimestampIndexDB&);
+    void operator=(const CTimestampIndexDB&);
+public:
     bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &vect);
-    bool WriteFlag(const std::string &name, bool fValue);
-    bool ReadFlag(const std::string &name, bool &fValue);
-    bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+};
+
+/** Access to the BIP158 block filters and their headers (blocks/blockfilterindex/) */
+class CBlockFilterIndexDB : public COptionalIndexDB
+{
+public:
+    CBlockFilterIndexDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+private:
+    CBlockFilterIndexDB(const CBlockFilterIndexDB&);
+    void operator=(const CBlockFilterIndexDB&);
+public:
+    bool WriteFilter(const BlockFilter &filter, const uint256 &header);
+    bool ReadFilter(const uint256 &blockHash, BlockFilter &filter);
+    //! the filter hash and header are stored apart from the filter, so header requests don't read the filters
+    bool ReadFilterHeader(const uint256 &blockHash, uint256 &filterHash, uint256 &header);
 };
 
 #endif // BITCOIN_TXDB_H
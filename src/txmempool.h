@@ -6,9 +6,11 @@
 #ifndef BITCOIN_TXMEMPOOL_H
 #define BITCOIN_TXMEMPOOL_H
 
+#include <algorithm>
 #include <memory>
 #include <set>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <utility>
 #include <string>
@@ -144,6 +146,8 @@ public:
     // If this is a proTx, this will be the hash of the key for which this ProTx was valid
     mutable uint256 validForProTxKey;
     mutable bool isKeyChangeProTx{false};
+
+    mutable uint64_t nEpoch{0}; //!< Last traversal of the mempool graph which visited this entry, see CTxMemPool::EpochGuard
 };
 
 // Helpers for modifying CTxMemPool::mapTx, which is a boost multi_index.
@@ -347,6 +351,37 @@ public:
     }
 };
 
+/** Address hash and type, as used by the mempool address index */
+typedef std::pair<uint160, int> mempoolAddress;
+
+class SaltedAddressHasher
+{
+private:
+    /** Salt */
+    const uint64_t k0, k1;
+
+public:
+    SaltedAddressHasher();
+
+    size_t operator()(const mempoolAddress& address) const {
+        return CSipHasher(k0, k1).Write(address.first.begin(), address.first.size()).Write((uint64_t)address.second).Finalize();
+    }
+};
+
+class SaltedSpentIndexKeyHasher
+{
+private:
+    /** Salt */
+    const uint64_t k0, k1;
+
+public:
+    SaltedSpentIndexKeyHasher();
+
+    size_t operator()(const CSpentIndexKey& key) const {
+        return SipHashUint256Extra(k0, k1, key.txid, key.outputIndex);
+    }
+};
+
 /**
  * CTxMemPool stores valid-according-to-the-current-best-chain transactions
  * that may be included in the next block.
@@ -493,7 +528,35 @@ public:
 
     const setEntries & GetMemPoolParents(txiter entry) const;
     const setEntries & GetMemPoolChildren(txiter entry) const;
+
+    /**
+     * Marks the start of a traversal of the mempool graph. Entries are marked as visited by storing the current
+     * epoch in them, which saves the temporary sets otherwise needed to not walk an entry twice. Traversals can't
+     * be nested, cs must be held for the lifetime of the guard.
+     */
+    class EpochGuard
+    {
+    private:
+        const CTxMemPool& pool;
+
+    public:
+        explicit EpochGuard(const CTxMemPool& _pool);
+        ~EpochGuard();
+    };
+
+    /** Mark an entry as visited in the current traversal, returns true if it was visited before */
+    bool Visited(txiter it) const
+    {
+        assert(fEpochGuarded);
+        bool ret = it->nEpoch >= nEpoch;
+        it->nEpoch = std::max(it->nEpoch, nEpoch);
+        return ret;
+    }
+
 private:
+    mutable uint64_t nEpoch{0};
+    mutable bool fEpochGuarded{false};
+
     typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
 
     struct TxLinks {
@@ -504,16 +567,19 @@ private:
     typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
     txlinksMap mapLinks;
 
-    typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> addressDeltaMap;
+    // the deltas of each address in no particular order, so they can be added and removed in constant time
+    typedef std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > addressDeltaList;
+    typedef std::unordered_map<mempoolAddress, addressDeltaList, SaltedAddressHasher> addressDeltaMap;
     addressDeltaMap mapAddress;
 
-    typedef std::map<uint256, std::vector<CMempoolAddressDeltaKey> > addressDeltaMapInserted;
+    // address and position in its addressDeltaList of every delta of a transaction
+    typedef std::unordered_map<uint256, std::vector<std::pair<mempoolAddress, size_t> >, SaltedTxidHasher> addressDeltaMapInserted;
     addressDeltaMapInserted mapAddressInserted;
 
-    typedef std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare> mapSpentIndex;
+    typedef std::unordered_map<CSpentIndexKey, CSpentIndexValue, SaltedSpentIndexKeyHasher> mapSpentIndex;
     mapSpentIndex mapSpent;
 
-    typedef std::map<uint256, std::vector<CSpentIndexKey> > mapSpentIndexInserted;
+    typedef std::unordered_map<uint256, std::vector<CSpentIndexKey>, SaltedTxidHasher> mapSpentIndexInserted;
     mapSpentIndexInserted mapSpentInserted;
 
     std::multimap<uint256, uint256> mapProTxRefs; // proTxHash -> transaction (all TXs that refer to an existing proTx)
@@ -565,7 +631,7 @@ public:
     void removeForReorg(const CCoinsViewCache *pcoins, unsigned int nMemPoolHeight, int flags);
     void removeConflicts(const CTransaction &tx);
     void removeProTxPubKeyConflicts(const CTransaction &tx, const CKeyID &keyId);
-    void removeProTxPubKeyConflicts(const CTransaction &tx, const CBLSPublicKey &pubKey);
+    void removeProTxPubKeyConflicts(const CTransaction &tx, const CBLSLazyPublicKey &pubKey);
     void removeProTxCollateralConflicts(const CTransaction &tx, const COutPoint &collateralOutpoint);
     void removeProTxSpentCollateralConflicts(const CTransaction &tx);
     void removeProTxKeyChangedConflicts(const CTransaction &tx, const uint256& proTxHash, const uint256& newKeyHash);
@@ -645,6 +711,13 @@ public:
     /** Expire all transaction (and their dependencies) in the mempool older than time. Return the number of removed transactions. */
     int Expire(int64_t time);
 
+    /** Whether a new transaction paying nModFee for nSize bytes would be the first package evicted when the mempool
+      *  is limited to sizelimit after its acceptance: the mempool is full already, Expire(nExpireTime) can't make
+      *  room and the package at the bottom of the descendant score index pays at least the same feerate. Such
+      *  transactions can be rejected before their inputs are checked. O(1) apart from the lock.
+      */
+    bool WouldBeEvicted(CAmount nModFee, size_t nSize, size_t sizelimit, int64_t nExpireTime) const;
+
     /** Returns false if the transaction is in the mempool and not within the chain limit specified. */
     bool TransactionWithinChainLimit(const uint256& txid, size_t chainLimit) const;
 
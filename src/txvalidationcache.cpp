@@ -0,0 +1,102 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txvalidationcache.h"
+
+#include "coins.h"
+#include "hash.h"
+#include "primitives/transaction.h"
+#include "random.h"
+#include "util.h"
+
+#include "cuckoocache.h"
+#include <boost/thread.hpp>
+
+namespace {
+
+/** Entries are salted hashes, so their bytes can be used as hashes directly */
+class TxValidationCacheHasher
+{
+public:
+    template <uint8_t hash_select>
+    uint32_t operator()(const uint256& key) const
+    {
+        static_assert(hash_select < 8, "TxValidationCacheHasher only has 8 hashes available.");
+        uint32_t u;
+        std::memcpy(&u, key.begin() + 4 * hash_select, 4);
+        return u;
+    }
+};
+
+class CTxValidationCache
+{
+private:
+    //! Entries are SHA256d(nonce || tx hash || flags || each spent output)
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, TxValidationCacheHasher> map_type;
+    map_type setValid;
+    boost::shared_mutex cs_txcache;
+
+public:
+    CTxValidationCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    void ComputeEntry(uint256& entry, const CTransaction& tx, const CCoinsViewCache& inputs, unsigned int flags)
+    {
+        // the outpoints are already committed to by the tx hash, the spent outputs are what the scripts depend on
+        CHashWriter hw(SER_GETHASH, 0);
+        hw << nonce << tx.GetHash() << flags;
+        for (const auto& txin : tx.vin) {
+            const Coin& coin = inputs.AccessCoin(txin.prevout);
+            assert(!coin.IsSpent());
+            hw << coin.out;
+        }
+        entry = hw.GetHash();
+    }
+
+    bool Get(const uint256& entry, bool fErase)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_txcache);
+        return setValid.contains(entry, fErase);
+    }
+
+    void Set(uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_txcache);
+        setValid.insert(entry);
+    }
+
+    uint32_t setup_bytes(size_t n)
+    {
+        return setValid.setup_bytes(n);
+    }
+};
+
+static CTxValidationCache txValidationCache;
+}
+
+// To be called once in AppInitMain/BasicTestingSetup
+void InitTxValidationCache()
+{
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, GetArg("-txvalidationcachesize", DEFAULT_MAX_TX_VALIDATION_CACHE_SIZE)), MAX_MAX_TX_VALIDATION_CACHE_SIZE) * ((size_t) 1 << 20);
+    size_t nElems = txValidationCache.setup_bytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for tx validation cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, nMaxCacheSize>>20, nElems);
+}
+
+void AddTxValidationCache(const CTransaction& tx, const CCoinsViewCache& inputs, unsigned int flags)
+{
+    uint256 entry;
+    txValidationCache.ComputeEntry(entry, tx, inputs, flags);
+    txValidationCache.Set(entry);
+}
+
+bool IsTxValidationCached(const CTransaction& tx, const CCoinsViewCache& inputs, unsigned int flags, bool fErase)
+{
+    uint256 entry;
+    txValidationCache.ComputeEntry(entry, tx, inputs, flags);
+    return txValidationCache.Get(entry, fErase);
+}
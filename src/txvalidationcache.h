@@ -0,0 +1,34 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef HTA_TXVALIDATIONCACHE_H
+#define HTA_TXVALIDATIONCACHE_H
+
+#include <stdint.h>
+
+class CCoinsViewCache;
+class CTransaction;
+
+// Each entry takes 32 bytes, 4 MiB are enough for more than 100000 transactions
+static const unsigned int DEFAULT_MAX_TX_VALIDATION_CACHE_SIZE = 4;
+// Maximum tx validation cache size allowed
+static const int64_t MAX_MAX_TX_VALIDATION_CACHE_SIZE = 16384;
+
+/**
+ * Cache of transactions whose scripts passed full validation when they were accepted into the mempool. Entries
+ * commit to the script verification flags and to the outputs spent by the transaction, so a hit means that all
+ * scripts of the transaction pass again under the same flags when spending the same coins.
+ *
+ * ConnectBlock only consults the cache for transactions that are locked by InstantSend. The lock guarantees that
+ * no conflicting transaction can be mined, so the coins seen at mempool acceptance are the ones spent in the block,
+ * and these transactions don't need to be checked input by input through the signature cache anymore.
+ */
+void InitTxValidationCache();
+
+/** Remember that all scripts of tx pass under flags when spending the coins in inputs */
+void AddTxValidationCache(const CTransaction& tx, const CCoinsViewCache& inputs, unsigned int flags);
+/** Check if all scripts of tx are known to pass under flags when spending the coins in inputs */
+bool IsTxValidationCached(const CTransaction& tx, const CCoinsViewCache& inputs, unsigned int flags, bool fErase);
+
+#endif // HTA_TXVALIDATIONCACHE_H
@@ -113,6 +113,9 @@ public:
     /** Masternode list has changed */
     boost::signals2::signal<void (const CDeterministicMNList&)> NotifyMasternodeListChanged;
 
+    /** Governance object was added, removed, voted on or had its cached flags updated */
+    boost::signals2::signal<void (const uint256& nHash)> NotifyGovernanceObjectChanged;
+
     /** Additional data sync progress changed */
     boost::signals2::signal<void (double nSyncProgress)> NotifyAdditionalDataSyncProgressChanged;
 
@@ -12,6 +12,7 @@
 #include <vector>
 #include <map>
 #include <cassert>
+#include <functional>
 
 #include <sstream>        // .get_int64()
 #include <utility>        // std::pair
@@ -124,6 +125,14 @@ public:
     std::string write(unsigned int prettyIndent = 0,
                       unsigned int indentLevel = 0) const;
 
+    // Serialize without building the whole string first: output is
+    // appended to s, and whenever s grew past flushSize it is handed to
+    // flush and cleared. The last piece is left in s for the caller.
+    typedef std::function<void(const std::string&)> FlushFunc;
+    void write(std::string& s, const FlushFunc& flush,
+               size_t flushSize = 65536,
+               unsigned int prettyIndent = 0) const;
+
     bool read(const char *raw);
     bool read(const std::string& rawStr) {
         return read(rawStr.c_str());
@@ -136,8 +145,9 @@ private:
     std::vector<UniValue> values;
 
     int findKey(const std::string& key) const;
-    void writeArray(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
-    void writeObject(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
+    void writeValue(unsigned int prettyIndent, unsigned int indentLevel, std::string& s, const FlushFunc* flush, size_t flushSize) const;
+    void writeArray(unsigned int prettyIndent, unsigned int indentLevel, std::string& s, const FlushFunc* flush, size_t flushSize) const;
+    void writeObject(unsigned int prettyIndent, unsigned int indentLevel, std::string& s, const FlushFunc* flush, size_t flushSize) const;
 
 public:
     // Strict type-specific getters, these throw std::runtime_error if the
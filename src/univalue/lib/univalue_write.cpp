@@ -10,11 +10,8 @@
 
 using namespace std;
 
-static string json_escape(const string& inS)
+static void json_escape(const string& inS, string& outS)
 {
-    string outS;
-    outS.reserve(inS.size() * 2);
-
     for (unsigned int i = 0; i < inS.size(); i++) {
         unsigned char ch = inS[i];
         const char *escStr = escapes[ch];
@@ -24,8 +21,6 @@ static string json_escape(const string& inS)
         else
             outS += ch;
     }
-
-    return outS;
 }
 
 string UniValue::write(unsigned int prettyIndent,
@@ -34,6 +29,28 @@ string UniValue::write(unsigned int prettyIndent,
     string s;
     s.reserve(1024);
 
+    writeValue(prettyIndent, indentLevel, s, NULL, 0);
+
+    return s;
+}
+
+void UniValue::write(string& s, const FlushFunc& flush, size_t flushSize,
+                     unsigned int prettyIndent) const
+{
+    writeValue(prettyIndent, 0, s, &flush, flushSize);
+}
+
+static void flushStr(string& s, const UniValue::FlushFunc* flush, size_t flushSize)
+{
+    if (flush && s.size() >= flushSize) {
+        (*flush)(s);
+        s.clear();
+    }
+}
+
+void UniValue::writeValue(unsigned int prettyIndent, unsigned int indentLevel,
+                          string& s, const FlushFunc* flush, size_t flushSize) const
+{
     unsigned int modIndent = indentLevel;
     if (modIndent == 0)
         modIndent = 1;
@@ -43,13 +60,15 @@ string UniValue::write(unsigned int prettyIndent,
         s += "null";
         break;
     case VOBJ:
-        writeObject(prettyIndent, modIndent, s);
+        writeObject(prettyIndent, modIndent, s, flush, flushSize);
         break;
     case VARR:
-        writeArray(prettyIndent, modIndent, s);
+        writeArray(prettyIndent, modIndent, s, flush, flushSize);
         break;
     case VSTR:
-        s += "\"" + json_escape(val) + "\"";
+        s += "\"";
+        json_escape(val, s);
+        s += "\"";
         break;
     case VNUM:
         s += val;
@@ -58,8 +77,6 @@ string UniValue::write(unsigned int prettyIndent,
         s += (val == "1" ? "true" : "false");
         break;
     }
-
-    return s;
 }
 
 static void indentStr(unsigned int prettyIndent, unsigned int indentLevel, string& s)
@@ -67,7 +84,8 @@ static void indentStr(unsigned int prettyIndent, unsigned int indentLevel, strin
     s.append(prettyIndent * indentLevel, ' ');
 }
 
-void UniValue::writeArray(unsigned int prettyIndent, unsigned int indentLevel, string& s) const
+void UniValue::writeArray(unsigned int prettyIndent, unsigned int indentLevel, string& s,
+                          const FlushFunc* flush, size_t flushSize) const
 {
     s += "[";
     if (prettyIndent)
@@ -76,7 +94,7 @@ void UniValue::writeArray(unsigned int prettyIndent, unsigned int indentLevel, s
     for (unsigned int i = 0; i < values.size(); i++) {
         if (prettyIndent)
             indentStr(prettyIndent, indentLevel, s);
-        s += values[i].write(prettyIndent, indentLevel + 1);
+        values[i].writeValue(prettyIndent, indentLevel + 1, s, flush, flushSize);
         if (i != (values.size() - 1)) {
             s += ",";
             if (prettyIndent)
@@ -84,6 +102,7 @@ void UniValue::writeArray(unsigned int prettyIndent, unsigned int indentLevel, s
         }
         if (prettyIndent)
             s += "\n";
+        flushStr(s, flush, flushSize);
     }
 
     if (prettyIndent)
@@ -91,7 +110,8 @@ void UniValue::writeArray(unsigned int prettyIndent, unsigned int indentLevel, s
     s += "]";
 }
 
-void UniValue::writeObject(unsigned int prettyIndent, unsigned int indentLevel, string& s) const
+void UniValue::writeObject(unsigned int prettyIndent, unsigned int indentLevel, string& s,
+                           const FlushFunc* flush, size_t flushSize) const
 {
     s += "{";
     if (prettyIndent)
@@ -100,18 +120,20 @@ void UniValue::writeObject(unsigned int prettyIndent, unsigned int indentLevel,
     for (unsigned int i = 0; i < keys.size(); i++) {
         if (prettyIndent)
             indentStr(prettyIndent, indentLevel, s);
-        s += "\"" + json_escape(keys[i]) + "\":";
+        s += "\"";
+        json_escape(keys[i], s);
+        s += "\":";
         if (prettyIndent)
             s += " ";
-        s += values.at(i).write(prettyIndent, indentLevel + 1);
+        values.at(i).writeValue(prettyIndent, indentLevel + 1, s, flush, flushSize);
         if (i != (values.size() - 1))
             s += ",";
         if (prettyIndent)
             s += "\n";
+        flushStr(s, flush, flushSize);
     }
 
     if (prettyIndent)
         indentStr(prettyIndent, indentLevel - 1, s);
     s += "}";
 }
-
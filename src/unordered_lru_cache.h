@@ -82,6 +82,13 @@ public:
         cacheMap.clear();
     }
 
+    void set_max_size(size_t _maxSize, size_t _truncateThreshold = 0)
+    {
+        assert(_maxSize != 0);
+        maxSize = _maxSize;
+        truncateThreshold = _truncateThreshold == 0 ? _maxSize * 2 : _truncateThreshold;
+    }
+
 private:
     void truncate_if_needed()
     {
@@ -41,7 +41,10 @@
 #endif // __linux__
 
 #include <algorithm>
+#include <mutex>
+#include <thread>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
 
@@ -218,6 +221,19 @@ static boost::mutex* mutexDebugLog = NULL;
 static std::list<std::string>* vMsgsBeforeOpenLog;
 static std::atomic<int> logAcceptCategoryCacheCounter(0);
 
+/**
+ * Once the log writer thread runs, LogPrintStr only queues the lines under mutexDebugLog and the
+ * thread writes them to debug.log in batches. The queue is bounded, lines are dropped (and counted)
+ * if the writer can't keep up. Allocated in DebugPrintInit and leaked like mutexDebugLog.
+ */
+static boost::condition_variable* condLogQueue = NULL;
+static std::vector<std::string>* vLogQueue = NULL;
+static size_t nLogQueueSize = 0;
+static size_t nLogQueueDropped = 0;
+static bool fLogWriterRunning = false;
+static bool fLogWriterStop = false;
+static std::thread* logWriterThread = NULL;
+
 static int FileWriteStr(const std::string &str, FILE *fp)
 {
     return fwrite(str.data(), 1, str.size(), fp);
@@ -228,6 +244,18 @@ static void DebugPrintInit()
     assert(mutexDebugLog == NULL);
     mutexDebugLog = new boost::mutex();
     vMsgsBeforeOpenLog = new std::list<std::string>;
+    condLogQueue = new boost::condition_variable();
+    vLogQueue = new std::vector<std::string>;
+}
+
+static void ReopenDebugLogIfRequested()
+{
+    if (fReopenDebugLog) {
+        fReopenDebugLog = false;
+        boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
+        if (freopen(pathDebug.string().c_str(),"a",fileout) != NULL)
+            setbuf(fileout, NULL); // unbuffered
+    }
 }
 
 void OpenDebugLog()
@@ -289,6 +317,7 @@ bool LogAcceptCategory(const char* category)
                     ptrCategory->insert(std::string("chainlocks"));
                     ptrCategory->insert(std::string("gobject"));
                     ptrCategory->insert(std::string("instantsend"));
+                    ptrCategory->insert(std::string("ipfs"));
                     ptrCategory->insert(std::string("keepass"));
                     ptrCategory->insert(std::string("llmq"));
                     ptrCategory->insert(std::string("llmq-dkg"));
@@ -399,15 +428,21 @@ int LogPrintStr(const std::string &str)
             ret = strTimestamped.length();
             vMsgsBeforeOpenLog->push_back(strTimestamped);
         }
+        else if (fLogWriterRunning)
+        {
+            if (nLogQueueSize + strTimestamped.size() > MAX_LOG_QUEUE_SIZE) {
+                nLogQueueDropped++;
+                return 0;
+            }
+            ret = strTimestamped.size();
+            nLogQueueSize += strTimestamped.size();
+            vLogQueue->emplace_back(std::move(strTimestamped));
+            condLogQueue->notify_one();
+        }
         else
         {
             // reopen the log file, if requested
-            if (fReopenDebugLog) {
-                fReopenDebugLog = false;
-                boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
-                if (freopen(pathDebug.string().c_str(),"a",fileout) != NULL)
-                    setbuf(fileout, NULL); // unbuffered
-            }
+            ReopenDebugLogIfRequested();
 
             ret = FileWriteStr(strTimestamped, fileout);
         }
@@ -415,6 +450,111 @@ int LogPrintStr(const std::string &str)
     return ret;
 }
 
+static void LogWriterThread()
+{
+    std::vector<std::string> vLines;
+    std::string strBatch;
+    while (true) {
+        size_t nDropped;
+        {
+            boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+            while (vLogQueue->empty() && !fLogWriterStop) {
+                condLogQueue->wait(scoped_lock);
+            }
+            if (vLogQueue->empty()) {
+                // everything is written, lines logged from now on are written synchronously
+                fLogWriterRunning = false;
+                return;
+            }
+            vLines.swap(*vLogQueue);
+            nLogQueueSize = 0;
+            nDropped = nLogQueueDropped;
+            nLogQueueDropped = 0;
+        }
+
+        // the file is only touched by this thread while it runs
+        ReopenDebugLogIfRequested();
+
+        strBatch.clear();
+        for (const auto& strLine : vLines) {
+            strBatch += strLine;
+        }
+        if (nDropped != 0) {
+            strBatch += strprintf("LogWriterThread -- dropped %d log messages, the log queue was full\n", nDropped);
+        }
+        FileWriteStr(strBatch, fileout);
+        vLines.clear();
+    }
+}
+
+void StartLogWriterThread()
+{
+    boost::call_once(&DebugPrintInit, debugPrintInitFlag);
+    boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+
+    if (fileout == NULL || logWriterThread != NULL) {
+        return;
+    }
+    fLogWriterStop = false;
+    fLogWriterRunning = true;
+    logWriterThread = new std::thread(&TraceThread<void (*)()>, "logwriter", &LogWriterThread);
+}
+
+void StopLogWriterThread()
+{
+    std::thread* thread;
+    {
+        boost::call_once(&DebugPrintInit, debugPrintInitFlag);
+        boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+        thread = logWriterThread;
+        logWriterThread = NULL;
+        fLogWriterStop = true;
+        condLogQueue->notify_one();
+    }
+    if (thread != NULL) {
+        thread->join();
+        delete thread;
+    }
+}
+
+bool LogRateLimitAccept(const char* category)
+{
+    // everything is logged while debugging the category
+    if (LogAcceptCategory(category)) {
+        return true;
+    }
+
+    struct RateLimitState {
+        int64_t nWindowStart{0};
+        unsigned int nLines{0};
+        unsigned int nSuppressed{0};
+    };
+    // leaked on exit, see mutexDebugLog
+    static std::mutex* mutexRateLimit = new std::mutex();
+    static std::map<std::string, RateLimitState>* mapRateLimit = new std::map<std::string, RateLimitState>();
+
+    int64_t nNow = GetTime();
+    unsigned int nSuppressed = 0;
+    {
+        std::lock_guard<std::mutex> lock(*mutexRateLimit);
+        RateLimitState& state = (*mapRateLimit)[category];
+        if (nNow - state.nWindowStart >= LOG_RATE_LIMIT_WINDOW) {
+            nSuppressed = state.nSuppressed;
+            state = RateLimitState();
+            state.nWindowStart = nNow;
+        }
+        if (state.nLines >= LOG_RATE_LIMIT_LINES) {
+            state.nSuppressed++;
+            return false;
+        }
+        state.nLines++;
+    }
+    if (nSuppressed != 0) {
+        LogPrintf("LogRateLimitAccept -- suppressed %d messages of category %s in the last %d seconds\n", nSuppressed, category, LOG_RATE_LIMIT_WINDOW);
+    }
+    return true;
+}
+
 /** Interpret string as boolean, for argument parsing */
 static bool InterpretBool(const std::string& strValue)
 {
@@ -700,6 +840,50 @@ void CreatePidFile(const boost::filesystem::path &path, pid_t pid)
 }
 #endif
 
+CMappedFile::CMappedFile(const boost::filesystem::path& path) : pdata(nullptr), nSize(0)
+{
+#ifndef WIN32
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED) {
+            pdata = (const unsigned char*)p;
+            nSize = st.st_size;
+            posix_madvise(p, nSize, POSIX_MADV_SEQUENTIAL);
+        }
+    }
+    // the mapping keeps its own reference to the file
+    close(fd);
+#endif
+}
+
+CMappedFile::~CMappedFile()
+{
+#ifndef WIN32
+    if (pdata) {
+        munmap((void*)pdata, nSize);
+    }
+#endif
+}
+
+void CMappedFile::Prefetch(size_t nOffset, size_t nLength) const
+{
+#ifndef WIN32
+    if (!pdata || nOffset >= nSize) {
+        return;
+    }
+    // posix_madvise wants a page aligned address
+    static const size_t nPageSize = sysconf(_SC_PAGESIZE);
+    size_t nStart = nOffset - (nOffset % nPageSize);
+    size_t nEnd = std::min(nSize, nOffset + nLength);
+    posix_madvise((void*)(pdata + nStart), nEnd - nStart, POSIX_MADV_WILLNEED);
+#endif
+}
+
 bool RenameOver(boost::filesystem::path src, boost::filesystem::path dest)
 {
 #ifdef WIN32
@@ -53,6 +53,13 @@ static const bool DEFAULT_LOGTIMEMICROS  = false;
 static const bool DEFAULT_LOGIPS         = false;
 static const bool DEFAULT_LOGTIMESTAMPS  = true;
 static const bool DEFAULT_LOGTHREADNAMES = false;
+static const bool DEFAULT_LOGASYNC       = true;
+
+/** Maximum size in bytes of the lines waiting for the log writer thread */
+static const size_t MAX_LOG_QUEUE_SIZE = 16 * 1024 * 1024;
+/** Rate limited log messages of a category are limited to LOG_RATE_LIMIT_LINES per LOG_RATE_LIMIT_WINDOW seconds */
+static const int64_t LOG_RATE_LIMIT_WINDOW = 60;
+static const unsigned int LOG_RATE_LIMIT_LINES = 100;
 
 /** Signals for translation. */
 class CTranslationInterface
@@ -96,6 +103,12 @@ bool LogAcceptCategory(const char* category);
 void ResetLogAcceptCategoryCache();
 /** Send a string to the log output */
 int LogPrintStr(const std::string &str);
+/** Return true if a rate limited message of this category may be logged, always true if debugging the category */
+bool LogRateLimitAccept(const char* category);
+/** Write debug.log from a background thread, LogPrintStr only queues the lines while it runs */
+void StartLogWriterThread();
+/** Write the queued lines and stop the log writer thread, lines are written synchronously again afterwards */
+void StopLogWriterThread();
 
 /** Formats a string without throwing exceptions. Instead, it'll return an error string instead of formatted string. */
 template<typename... Args>
@@ -120,6 +133,13 @@ std::string SafeStringFormat(const std::string& fmt, const Args&... args)
     LogPrintStr(SafeStringFormat(__VA_ARGS__)); \
 } while(0)
 
+/** Like LogPrintf, but messages of hot paths are rate limited per category unless debugging the category */
+#define LogPrintLimited(category, ...) do { \
+    if (LogRateLimitAccept((category))) { \
+        LogPrintStr(SafeStringFormat(__VA_ARGS__)); \
+    } \
+} while(0)
+
 template<typename... Args>
 bool error(const char* fmt, const Args&... args)
 {
@@ -133,6 +153,33 @@ void FileCommit(FILE *file);
 bool TruncateFile(FILE *file, unsigned int length);
 int RaiseFileDescriptorLimit(int nMinFD);
 void AllocateFileRange(FILE *file, unsigned int offset, unsigned int length);
+
+/**
+ * Read-only memory mapping of a whole file. The mapping stays valid when the file is
+ * appended to or deleted, but only covers the size the file had when it was mapped.
+ * Not supported on Windows, IsNull() is always true there.
+ */
+class CMappedFile
+{
+private:
+    const unsigned char* pdata;
+    size_t nSize;
+
+public:
+    explicit CMappedFile(const boost::filesystem::path& path);
+    ~CMappedFile();
+
+    CMappedFile(const CMappedFile&) = delete;
+    CMappedFile& operator=(const CMappedFile&) = delete;
+
+    bool IsNull() const { return pdata == nullptr; }
+    const unsigned char* data() const { return pdata; }
+    size_t size() const { return nSize; }
+
+    /** Advise the OS to read the given range ahead of time, clamped to the mapped size */
+    void Prefetch(size_t nOffset, size_t nLength) const;
+};
+
 bool RenameOver(boost::filesystem::path src, boost::filesystem::path dest);
 bool TryCreateDirectory(const boost::filesystem::path& p);
 boost::filesystem::path GetDefaultDataDir();
@@ -9,16 +9,19 @@
 #include "alert.h"
 #include "arith_uint256.h"
 #include "blockencodings.h"
+#include "blockfilter.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
 #include "consensus/consensus.h"
 #include "consensus/merkle.h"
 #include "consensus/validation.h"
+#include "crypto/common.h"
 #include "hash.h"
 #include "init.h"
 #include "policy/policy.h"
 #include "pow.h"
+#include "saltedhasher.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "script/script.h"
@@ -26,10 +29,13 @@
 #include "script/standard.h"
 #include "timedata.h"
 #include "tinyformat.h"
+#include "trace.h"
 #include "txdb.h"
 #include "txmempool.h"
+#include "txvalidationcache.h"
 #include "ui_interface.h"
 #include "undo.h"
+#include "unordered_lru_cache.h"
 #include "util.h"
 #include "spork.h"
 #include "utilmoneystr.h"
@@ -37,12 +43,14 @@
 #include "validationinterface.h"
 #include "versionbits.h"
 #include "warnings.h"
+#include "workerpool.h"
 
 #include "instantx.h"
 #include "masternode-payments.h"
 
 #include "evo/specialtx.h"
 #include "evo/providertx.h"
+#include "evo/protxsigcache.h"
 #include "evo/deterministicmns.h"
 #include "evo/cbtx.h"
 
@@ -50,7 +58,13 @@
 #include "llmq/quorums_chainlocks.h"
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <unordered_set>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/join.hpp>
@@ -82,6 +96,10 @@ bool fTxIndex = true;
 bool fAddressIndex = false;
 bool fTimestampIndex = false;
 bool fSpentIndex = false;
+bool fBlockFilterIndex = false;
+bool fBlockFileMmap = DEFAULT_BLOCKFILE_MMAP;
+bool fBatchSigVerify = DEFAULT_BATCH_SIG_VERIFY;
+unsigned int nMempoolParallelInputs = DEFAULT_MEMPOOL_PARALLEL_INPUTS;
 bool fHavePruned = false;
 bool fPruneMode = false;
 bool fIsBareMultisigStd = DEFAULT_PERMIT_BAREMULTISIG;
@@ -98,6 +116,7 @@ std::atomic<bool> fDIP0001ActiveAtTip{false};
 std::atomic<bool> fDIP0003ActiveAtTip{false};
 
 uint256 hashAssumeValid;
+bool fChainLockAssumeValid = DEFAULT_CHAINLOCK_ASSUMEVALID;
 
 CFeeRate minRelayTxFee = CFeeRate(DEFAULT_MIN_RELAY_TX_FEE);
 CAmount maxTxFee = DEFAULT_TRANSACTION_MAXFEE;
@@ -226,8 +245,98 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 }
 
 CCoinsViewDB *pcoinsdbview = NULL;
+CCoinsViewDBFlusher *pcoinsdbflusher = NULL;
 CCoinsViewCache *pcoinsTip = NULL;
 CBlockTreeDB *pblocktree = NULL;
+CAddressIndexDB *paddressindexdb = NULL;
+CSpentIndexDB *pspentindexdb = NULL;
+CTimestampIndexDB *ptimestampindexdb = NULL;
+CBlockFilterIndexDB *pblockfilterindexdb = NULL;
+
+/**
+ * Writes the entries of the address, spent, timestamp and block filter indexes in the background, in the order the blocks were
+ * connected and disconnected. The indexes can therefore lag a few blocks behind the tip. FlushStateToDisk waits for
+ * all queued writes before the chainstate is written, so the indexes never fall behind the chainstate on disk.
+ * When the writer thread is not running, writes are done synchronously.
+ */
+class CIndexWriter
+{
+private:
+    typedef std::pair<std::function<bool()>, std::string> Job;
+
+    std::mutex cs;
+    std::condition_variable cond;
+    std::condition_variable condDone;
+    std::deque<Job> queue;
+    bool fBusy{false};
+    bool fStop{false};
+    std::thread thread;
+
+public:
+    void Start()
+    {
+        std::unique_lock<std::mutex> l(cs);
+        if (thread.joinable()) {
+            return;
+        }
+        fStop = false;
+        thread = std::thread([this]() {
+            RenameThread("historia-idxwrite");
+            ThreadMain();
+        });
+    }
+
+    void Stop()
+    {
+        {
+            std::unique_lock<std::mutex> l(cs);
+            fStop = true;
+        }
+        cond.notify_all();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    // Returns false if the write was done synchronously and failed
+    bool Push(std::function<bool()>&& func, const std::string& strError)
+    {
+        {
+            std::unique_lock<std::mutex> l(cs);
+            if (thread.joinable()) {
+                queue.emplace_back(std::move(func), strError);
+                cond.notify_one();
+                return true;
+            }
+        }
+        return func();
+    }
+
+    void Flush()
+    {
+        std::unique_lock<std::mutex> l(cs);
+        condDone.wait(l, [this]() { return queue.empty() && !fBusy; });
+    }
+
+private:
+    void ThreadMain();
+};
+static CIndexWriter indexWriter;
+
+void StartIndexWriterThread()
+{
+    indexWriter.Start();
+}
+
+void StopIndexWriterThread()
+{
+    indexWriter.Stop();
+}
+
+void FlushIndexWrites()
+{
+    indexWriter.Flush();
+}
 
 enum FlushStateMode {
     FLUSH_STATE_NONE,
@@ -637,6 +746,26 @@ static bool IsCurrentForFeeEstimation()
     return true;
 }
 
+/**
+ * CheckInputs for AcceptToMemoryPool. The scripts of transactions with at least -mempoolparallelinputs inputs are
+ * checked on the script check threads, which are idle between blocks. If a check fails, the transaction is checked
+ * again on this thread to get the same reject reason and DoS score as without the check threads.
+ */
+static bool CheckInputsForMempool(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& view, unsigned int flags, PrecomputedTransactionData& txdata)
+{
+    if (!nScriptCheckThreads || nMempoolParallelInputs == 0 || tx.vin.size() < nMempoolParallelInputs) {
+        return CheckInputs(tx, state, view, true, flags, true, txdata);
+    }
+    std::vector<CScriptCheck> vChecks;
+    if (!CheckInputs(tx, state, view, true, flags, true, txdata, &vChecks)) {
+        return false;
+    }
+    if (RunScriptChecks(vChecks)) {
+        return true;
+    }
+    return CheckInputs(tx, state, view, true, flags, true, txdata);
+}
+
 bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const CTransactionRef& ptx, bool fLimitFree,
                               bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit,
                               const CAmount& nAbsurdFee, std::vector<COutPoint>& coins_to_uncache, bool fDryRun)
@@ -832,6 +961,13 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
             return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "min relay fee not met");
         }
 
+        // LimitMempoolSize below would evict this tx right away, don't check its inputs only to find out
+        if (!fOverrideMempoolLimit && !fDryRun &&
+                pool.WouldBeEvicted(nModifiedFees, nSize, GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000,
+                                    GetTime() - GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60)) {
+            return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool full");
+        }
+
         if (nAbsurdFee && nFees > nAbsurdFee)
             return state.Invalid(false,
                 REJECT_HIGHFEE, "absurdly-high-fee",
@@ -863,7 +999,8 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
 
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
-        if (!CheckInputs(tx, state, view, true, STANDARD_SCRIPT_VERIFY_FLAGS, true))
+        PrecomputedTransactionData txdata(tx);
+        if (!CheckInputsForMempool(tx, state, view, STANDARD_SCRIPT_VERIFY_FLAGS, txdata))
             return false; // state filled in by CheckInputs
 
         // Check again against just the consensus-critical mandatory script
@@ -875,12 +1012,15 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
         // There is a similar check in CreateNewBlock() to prevent creating
         // invalid blocks, however allowing such transactions into the mempool
         // can be exploited as a DoS attack.
-        if (!CheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true))
+        if (!CheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true, txdata))
         {
             return error("%s: BUG! PLEASE REPORT THIS! ConnectInputs failed against MANDATORY but not STANDARD flags %s, %s",
                 __func__, hash.ToString(), FormatStateMessage(state));
         }
 
+        // Lets ConnectBlock skip the script checks of this tx once it's locked by InstantSend
+        AddTxValidationCache(tx, view, STANDARD_SCRIPT_VERIFY_FLAGS);
+
         // This transaction should only count for fee estimation if the
         // node is not behind, and the transaction is not dependent on any other
         // transactions in the mempool. Also ignore 0-fee txes.
@@ -918,7 +1058,9 @@ bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState &state, const
                         const CAmount nAbsurdFee, bool fDryRun)
 {
     std::vector<COutPoint> coins_to_uncache;
+    TRACE_TIME_START(nTraceStart);
     bool res = AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, nAcceptTime, fOverrideMempoolLimit, nAbsurdFee, coins_to_uncache, fDryRun);
+    TRACE6(mempool, accept, tx->GetHash().begin(), res, fDryRun, state.GetRejectCode(), state.GetRejectReason().c_str(), TRACE_TIME_ELAPSED(nTraceStart));
     if (!res || fDryRun) {
         if(!res) LogPrint("mempool", "%s: %s %s (%s)\n", __func__, tx->GetHash().ToString(), state.GetRejectReason(), state.GetDebugMessage());
         BOOST_FOREACH(const COutPoint& hashTx, coins_to_uncache)
@@ -941,7 +1083,7 @@ bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, std::v
     if (!fTimestampIndex)
         return error("Timestamp index not enabled");
 
-    if (!pblocktree->ReadTimestampIndex(high, low, hashes))
+    if (!ptimestampindexdb->ReadTimestampIndex(high, low, hashes))
         return error("Unable to get hashes for timestamps");
 
     return true;
@@ -955,19 +1097,54 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
     if (mempool.getSpentIndex(key, value))
         return true;
 
-    if (!pblocktree->ReadSpentIndex(key, value))
+    if (!pspentindexdb->ReadSpentIndex(key, value))
+        return false;
+
+    return true;
+}
+
+bool GetSpentIndexes(const std::vector<CSpentIndexKey>& keys, std::vector<CSpentIndexValue>& values, std::vector<bool>& found)
+{
+    if (!fSpentIndex)
         return false;
 
+    values.assign(keys.size(), CSpentIndexValue());
+    found.assign(keys.size(), false);
+
+    std::vector<CSpentIndexKey> vDBKeys;
+    std::vector<size_t> vDBIndexes;
+    for (size_t i = 0; i < keys.size(); i++) {
+        CSpentIndexKey key = keys[i];
+        if (mempool.getSpentIndex(key, values[i])) {
+            found[i] = true;
+        } else {
+            vDBKeys.emplace_back(key);
+            vDBIndexes.emplace_back(i);
+        }
+    }
+    if (vDBKeys.empty())
+        return true;
+
+    std::vector<CSpentIndexValue> vDBValues;
+    std::vector<bool> vDBFound;
+    pspentindexdb->ReadSpentIndexes(vDBKeys, vDBValues, vDBFound);
+    for (size_t i = 0; i < vDBKeys.size(); i++) {
+        if (vDBFound[i]) {
+            values[vDBIndexes[i]] = vDBValues[i];
+            found[vDBIndexes[i]] = true;
+        }
+    }
     return true;
 }
 
 bool GetAddressIndex(uint160 addressHash, int type,
-                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end)
+                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end,
+                     size_t limit, const CAddressIndexKey* pafter)
 {
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end))
+    if (!paddressindexdb->ReadAddressIndex(addressHash, type, addressIndex, start, end, limit, pafter))
         return error("unable to get txids for address");
 
     return true;
@@ -979,12 +1156,29 @@ bool GetAddressUnspent(uint160 addressHash, int type,
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
+    if (!paddressindexdb->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
         return error("unable to get txids for address");
 
     return true;
 }
 
+bool GetAddressBalance(uint160 addressHash, int type, CAddressBalance &balance)
+{
+    if (!fAddressIndex)
+        return false;
+
+    return paddressindexdb->ReadAddressBalance(addressHash, type, balance);
+}
+
+/**
+ * Transactions recently found in a block by GetTransaction and the hash of that block. Governance and InstantSend
+ * look up the same collaterals and inputs over and over, this saves the txindex read and the block file access.
+ * Entries are erased when a block containing the tx is connected or disconnected. Protected by cs_main
+ */
+static unordered_lru_cache<uint256, std::pair<CTransactionRef, uint256>, StaticSaltedHasher, 1024> confirmedTxCache;
+
+static bool ReadTxFromDisk(const CDiskTxPos& postx, CTransactionRef& txOut, uint256& hashBlock);
+
 /** Return transaction in txOut, and if it was found inside a block, its hash is placed in hashBlock */
 bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus::Params& consensusParams, uint256 &hashBlock, bool fAllowSlow)
 {
@@ -999,23 +1193,21 @@ bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus
         return true;
     }
 
+    std::pair<CTransactionRef, uint256> cached;
+    if (confirmedTxCache.get(hash, cached)) {
+        txOut = cached.first;
+        hashBlock = cached.second;
+        return true;
+    }
+
     if (fTxIndex) {
         CDiskTxPos postx;
         if (pblocktree->ReadTxIndex(hash, postx)) {
-            CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-            if (file.IsNull())
-                return error("%s: OpenBlockFile failed", __func__);
-            CBlockHeader header;
-            try {
-                file >> header;
-                fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-                file >> txOut;
-            } catch (const std::exception& e) {
-                return error("%s: Deserialize or I/O error - %s", __func__, e.what());
-            }
-            hashBlock = header.GetHash();
+            if (!ReadTxFromDisk(postx, txOut, hashBlock))
+                return false;
             if (txOut->GetHash() != hash)
                 return error("%s: txid mismatch", __func__);
+            confirmedTxCache.insert(hash, std::make_pair(txOut, hashBlock));
             return true;
         }
 
@@ -1035,6 +1227,7 @@ bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus
                 if (tx->GetHash() == hash) {
                     txOut = tx;
                     hashBlock = pindexSlow->GetBlockHash();
+                    confirmedTxCache.insert(hash, std::make_pair(txOut, hashBlock));
                     return true;
                 }
             }
@@ -1075,21 +1268,167 @@ bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHea
     return true;
 }
 
+namespace {
+
+/** Number of bytes following a block or undo record which the OS is asked to read ahead */
+static const size_t BLOCKFILE_READAHEAD = 4 * 1024 * 1024;
+/** Maximum number of blk and rev files which are kept mapped at the same time */
+static const size_t MAX_MAPPED_BLOCKFILES = 4;
+
+/**
+ * Keeps the most recently read blk/rev files memory mapped. Reindex, rescans and most RPC calls read blocks in
+ * order, this saves the open/seek/read syscalls and the copies through the stdio buffer for every single block.
+ * The OS is told to read ahead the data following each record, so the next blocks are usually in the page cache
+ * by the time they are needed.
+ */
+class CMappedBlockFiles
+{
+private:
+    CCriticalSection cs;
+    // (fUndo, nFile) -> (last use, mapping)
+    std::map<std::pair<bool, int>, std::pair<int64_t, std::shared_ptr<const CMappedFile>>> mapFiles;
+    int64_t nUseCounter{0};
+
+public:
+    /**
+     * Get the record at pos, which is preceded by the network magic and its size like written by WriteBlockToDisk
+     * and UndoWriteToDisk and followed by nTrailer more bytes. Returns false if the file can't be mapped, the caller
+     * falls back to a regular read then.
+     */
+    bool GetRecord(const CDiskBlockPos& pos, bool fUndo, size_t nTrailer, std::shared_ptr<const CMappedFile>& fileRet, const unsigned char*& pchRet, size_t& nSizeRet, bool fPrefetch = true)
+    {
+        if (pos.nPos < 8) {
+            return false;
+        }
+
+        auto file = GetFile(pos, fUndo, pos.nPos);
+        if (!file) {
+            return false;
+        }
+        uint32_t nSize = ReadLE32(file->data() + pos.nPos - 4);
+        size_t nEnd = (size_t)pos.nPos + nSize + nTrailer;
+        if (nEnd > file->size()) {
+            // the file grew since it was mapped
+            file = GetFile(pos, fUndo, nEnd);
+            if (!file) {
+                return false;
+            }
+        }
+
+        if (fPrefetch) {
+            file->Prefetch(nEnd, BLOCKFILE_READAHEAD);
+        }
+
+        fileRet = file;
+        pchRet = file->data() + pos.nPos;
+        nSizeRet = nSize;
+        return true;
+    }
+
+    void Remove(int nFile)
+    {
+        LOCK(cs);
+        mapFiles.erase(std::make_pair(false, nFile));
+        mapFiles.erase(std::make_pair(true, nFile));
+    }
+
+private:
+    std::shared_ptr<const CMappedFile> GetFile(const CDiskBlockPos& pos, bool fUndo, size_t nMinSize)
+    {
+        LOCK(cs);
+
+        auto key = std::make_pair(fUndo, pos.nFile);
+        auto it = mapFiles.find(key);
+        if (it != mapFiles.end() && it->second.second->size() >= nMinSize) {
+            it->second.first = ++nUseCounter;
+            return it->second.second;
+        }
+
+        auto file = std::make_shared<const CMappedFile>(GetBlockPosFilename(pos, fUndo ? "rev" : "blk"));
+        if (file->IsNull() || file->size() < nMinSize) {
+            return nullptr;
+        }
+        // readers which still use an old mapping keep it alive until they are done
+        mapFiles[key] = std::make_pair(++nUseCounter, file);
+
+        while (mapFiles.size() > MAX_MAPPED_BLOCKFILES) {
+            auto itOldest = mapFiles.begin();
+            for (auto it2 = mapFiles.begin(); it2 != mapFiles.end(); ++it2) {
+                if (it2->second.first < itOldest->second.first) {
+                    itOldest = it2;
+                }
+            }
+            mapFiles.erase(itOldest);
+        }
+        return file;
+    }
+};
+
+CMappedBlockFiles mappedBlockFiles;
+
+} // anon namespace
+
+static bool ReadTxFromDisk(const CDiskTxPos& postx, CTransactionRef& txOut, uint256& hashBlock)
+{
+    CBlockHeader header;
+
+    std::shared_ptr<const CMappedFile> file;
+    const unsigned char* pch;
+    size_t nSize;
+    // a single tx is read from the already mapped file, without reading ahead as txes are looked up in random order
+    if (fBlockFileMmap && mappedBlockFiles.GetRecord(postx, false, 0, file, pch, nSize, false)) {
+        try {
+            CSpanReader reader(SER_DISK, CLIENT_VERSION, pch, nSize);
+            reader >> header;
+            reader.ignore(postx.nTxOffset);
+            reader >> txOut;
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize error - %s at %s", __func__, e.what(), postx.ToString());
+        }
+    } else {
+        CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+        if (file.IsNull())
+            return error("%s: OpenBlockFile failed", __func__);
+        try {
+            file >> header;
+            fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
+            file >> txOut;
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+    hashBlock = header.GetHash();
+    return true;
+}
+
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+    std::shared_ptr<const CMappedFile> file;
+    const unsigned char* pch;
+    size_t nSize;
+    if (fBlockFileMmap && mappedBlockFiles.GetRecord(pos, false, 0, file, pch, nSize)) {
+        try {
+            CSpanReader reader(SER_DISK, CLIENT_VERSION, pch, nSize);
+            reader >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize error - %s at %s", __func__, e.what(), pos.ToString());
+        }
+    } else {
+        // Open history file to read
+        CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
 
-    // Read block
-    try {
-        filein >> block;
-    }
-    catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        // Read block
+        try {
+            filein >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
     }
 
     // Check the header
@@ -1109,6 +1448,40 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
     return true;
 }
 
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& vchBlockRet, const CDiskBlockPos& pos)
+{
+    std::shared_ptr<const CMappedFile> file;
+    const unsigned char* pch;
+    size_t nSize;
+    if (fBlockFileMmap && mappedBlockFiles.GetRecord(pos, false, 0, file, pch, nSize)) {
+        vchBlockRet.assign(pch, pch + nSize);
+        return true;
+    }
+
+    if (pos.nPos < 8) {
+        return error("%s: Invalid block position %s", __func__, pos.ToString());
+    }
+    // the size of the record precedes the block
+    CDiskBlockPos posSize(pos.nFile, pos.nPos - 4);
+    CAutoFile filein(OpenBlockFile(posSize, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+
+    try {
+        uint32_t nBlockSize;
+        filein >> nBlockSize;
+        if (nBlockSize > MAX_SIZE) {
+            return error("%s: Invalid block size %u at %s", __func__, nBlockSize, pos.ToString());
+        }
+        vchBlockRet.resize(nBlockSize);
+        filein.read((char*)vchBlockRet.data(), nBlockSize);
+    }
+    catch (const std::exception& e) {
+        return error("%s: I/O error - %s at %s", __func__, e.what(), pos.ToString());
+    }
+    return true;
+}
+
 double ConvertBitsToDouble(unsigned int nBits)
 {
     int nShift = (nBits >> 24) & 0xff;
@@ -1356,12 +1729,45 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight)
 
 bool CScriptCheck::operator()() {
     const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
-    if (!VerifyScript(scriptSig, scriptPubKey, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, cacheStore), &error)) {
+    if (fDeferSigs) {
+        if (VerifyScript(scriptSig, scriptPubKey, nFlags, BatchingTransactionSignatureChecker(ptxTo, nIn, deferredSigs, cacheStore, txdata), &error)) {
+            return true;
+        }
+        // the script might rely on an invalid signature, e.g. with CHECKSIG NOT
+        deferredSigs.clear();
+        fDeferSigs = false;
+    }
+    if (!VerifyScript(scriptSig, scriptPubKey, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, cacheStore, txdata), &error)) {
         return false;
     }
     return true;
 }
 
+bool CScriptCheck::RecheckWithoutDeferring()
+{
+    deferredSigs.clear();
+    fDeferSigs = false;
+    return (*this)();
+}
+
+bool FinishCheckBatch(std::vector<CScriptCheck>& vChecks)
+{
+    CSignatureBatch batch;
+    for (auto& check : vChecks) {
+        check.TakeDeferredSigs(batch);
+    }
+    if (batch.Verify()) {
+        return true;
+    }
+    // some signature is invalid, so the scripts which assumed it to be valid have to run again to get their result
+    for (auto& check : vChecks) {
+        if (!check.RecheckWithoutDeferring()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 int GetSpendHeight(const CCoinsViewCache& inputs)
 {
     LOCK(cs_main);
@@ -1415,7 +1821,7 @@ bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CCoins
 }
 }// namespace Consensus
 
-bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheStore, std::vector<CScriptCheck> *pvChecks)
+bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks)
 {
     if (!tx.IsCoinBase())
     {
@@ -1449,7 +1855,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
                 const CAmount amount = coin.out.nValue;
 
                 // Verify signature
-                CScriptCheck check(scriptPubKey, amount, tx, i, flags, cacheStore);
+                CScriptCheck check(scriptPubKey, amount, tx, i, flags, cacheStore, &txdata, pvChecks && fBatchSigVerify);
                 if (pvChecks) {
                     pvChecks->push_back(CScriptCheck());
                     check.swap(pvChecks->back());
@@ -1462,7 +1868,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
                         // avoid splitting the network between upgraded and
                         // non-upgraded nodes.
                         CScriptCheck check2(scriptPubKey, amount, tx, i,
-                                flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheStore);
+                                flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheStore, &txdata);
                         if (check2())
                             return state.Invalid(false, REJECT_NONSTANDARD, strprintf("non-mandatory-script-verify-flag (%s)", ScriptErrorString(check.GetScriptError())));
                     }
@@ -1513,6 +1919,29 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
 
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock)
 {
+    std::shared_ptr<const CMappedFile> file;
+    const unsigned char* pch;
+    size_t nSize;
+    if (fBlockFileMmap && mappedBlockFiles.GetRecord(pos, true, 32, file, pch, nSize)) {
+        uint256 hashChecksum;
+        CSpanReader reader(SER_DISK, CLIENT_VERSION, pch, nSize + 32);
+        CHashVerifier<CSpanReader> verifier(&reader);
+        try {
+            verifier << hashBlock;
+            verifier >> blockundo;
+            reader >> hashChecksum;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize error - %s", __func__, e.what());
+        }
+
+        // Verify checksum
+        if (hashChecksum != verifier.GetHash())
+            return error("%s: Checksum mismatch", __func__);
+
+        return true;
+    }
+
     // Open history file to read
     CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
@@ -1557,6 +1986,386 @@ bool AbortNode(CValidationState& state, const std::string& strMessage, const std
 
 } // anon namespace
 
+void CIndexWriter::ThreadMain()
+{
+    std::unique_lock<std::mutex> l(cs);
+    while (true) {
+        cond.wait(l, [this]() { return fStop || !queue.empty(); });
+        if (queue.empty()) {
+            // only stop when everything is written
+            break;
+        }
+        Job job = std::move(queue.front());
+        queue.pop_front();
+        fBusy = true;
+        l.unlock();
+        if (!job.first()) {
+            AbortNode(job.second);
+        }
+        l.lock();
+        fBusy = false;
+        condDone.notify_all();
+    }
+    condDone.notify_all();
+}
+
+// Index entries for spending prevout through input j of the i-th transaction of a block
+static void AddSpendIndexEntries(const CTxIn& input, const CTxOut& prevout, const uint256& txhash, unsigned int i, size_t j, int nHeight,
+                                 bool fAddress, bool fSpent,
+                                 std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex,
+                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& addressUnspentIndex,
+                                 std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >& spentIndex)
+{
+    uint160 hashBytes;
+    int addressType;
+
+    if (prevout.scriptPubKey.IsPayToScriptHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22));
+        addressType = 2;
+    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23));
+        addressType = 1;
+    } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
+        hashBytes = Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1);
+        addressType = 1;
+    } else {
+        hashBytes.SetNull();
+        addressType = 0;
+    }
+
+    if (fAddress && addressType > 0) {
+        // record spending activity
+        addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, nHeight, i, txhash, j, true), prevout.nValue * -1));
+
+        // remove address from unspent index
+        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
+    }
+
+    if (fSpent) {
+        // add the spent index to determine the txid and input that spent an output
+        // and to find the amount and address from an input
+        spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(txhash, j, nHeight, prevout.nValue, addressType, hashBytes)));
+    }
+}
+
+// Address index entries for the outputs of the i-th transaction of a block
+static void AddOutputIndexEntries(const CTransaction& tx, const uint256& txhash, unsigned int i, int nHeight,
+                                  std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex,
+                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& addressUnspentIndex)
+{
+    for (unsigned int k = 0; k < tx.vout.size(); k++) {
+        const CTxOut &out = tx.vout[k];
+
+        if (out.scriptPubKey.IsPayToScriptHash()) {
+            std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
+
+            // record receiving activity
+            addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), nHeight, i, txhash, k, false), out.nValue));
+
+            // record unspent output
+            addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, nHeight)));
+
+        } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
+            std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
+
+            // record receiving activity
+            addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), nHeight, i, txhash, k, false), out.nValue));
+
+            // record unspent output
+            addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, nHeight)));
+
+        } else if (out.scriptPubKey.IsPayToPublicKey()) {
+            uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
+            addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, nHeight, i, txhash, k, false), out.nValue));
+            addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, nHeight)));
+        } else {
+            continue;
+        }
+
+    }
+}
+
+// Write the filter of a block and its header, the filter of the previous block has to be written already
+static bool WriteBlockFilter(const uint256& hashBlock, const uint256& hashPrevBlock, const GCSFilter::ElementSet& elements)
+{
+    // the header chain starts with a zero header before the genesis block
+    uint256 prevHeader;
+    if (!hashPrevBlock.IsNull()) {
+        uint256 prevFilterHash;
+        if (!pblockfilterindexdb->ReadFilterHeader(hashPrevBlock, prevFilterHash, prevHeader)) {
+            return error("%s: no filter header for block %s", __func__, hashPrevBlock.ToString());
+        }
+    }
+    BlockFilter filter(BLOCK_FILTER_BASIC, hashBlock, elements);
+    return pblockfilterindexdb->WriteFilter(filter, filter.ComputeHeader(prevHeader));
+}
+
+/**
+ * Builds optional indexes which were enabled after the chain was already synced. The entries are computed from the
+ * block and undo files while the node stays online. When an index reaches the tip, its flag is set (with cs_main
+ * held) and from then on ConnectBlock/DisconnectBlock maintain it.
+ */
+class CIndexBuilder
+{
+private:
+    // the last blocks are built with cs_main held, so that no block can be connected or disconnected in between
+    static const int FINAL_CATCHUP_BLOCKS = 100;
+
+    static const size_t INDEX_COUNT = 4;
+
+    struct Index {
+        std::string strName;
+        bool* pfEnabled;
+        // the block filters start at the genesis block, the other indexes after it
+        bool fIncludesGenesis{false};
+        std::atomic<bool> fBuilding{false};
+        std::atomic<int> nBuiltHeight{-1};
+        const CBlockIndex* pindexBuilt{nullptr}; // protected by cs_main
+    };
+    Index indexes[INDEX_COUNT];
+
+    std::atomic<bool> fInterrupt{false};
+    std::thread thread;
+
+public:
+    CIndexBuilder()
+    {
+        indexes[0].strName = "addressindex";
+        indexes[0].pfEnabled = &fAddressIndex;
+        indexes[1].strName = "spentindex";
+        indexes[1].pfEnabled = &fSpentIndex;
+        indexes[2].strName = "timestampindex";
+        indexes[2].pfEnabled = &fTimestampIndex;
+        indexes[3].strName = "blockfilterindex";
+        indexes[3].pfEnabled = &fBlockFilterIndex;
+        indexes[3].fIncludesGenesis = true;
+    }
+
+    void Start(bool fBuildAddressIndex, bool fBuildSpentIndex, bool fBuildTimestampIndex, bool fBuildBlockFilterIndex)
+    {
+        LOCK(cs_main);
+        bool fBuild[INDEX_COUNT] = {fBuildAddressIndex, fBuildSpentIndex, fBuildTimestampIndex, fBuildBlockFilterIndex};
+        bool fAny = false;
+        for (size_t i = 0; i < INDEX_COUNT; i++) {
+            auto& idx = indexes[i];
+            if (!fBuild[i] || *idx.pfEnabled) {
+                continue;
+            }
+            uint256 hashBlock;
+            idx.pindexBuilt = idx.fIncludesGenesis ? nullptr : chainActive.Genesis();
+            if (GetDB(i)->ReadBuildTip(hashBlock) && mapBlockIndex.count(hashBlock)) {
+                idx.pindexBuilt = mapBlockIndex[hashBlock];
+            }
+            idx.nBuiltHeight = idx.pindexBuilt ? idx.pindexBuilt->nHeight : -1;
+            idx.fBuilding = true;
+            fAny = true;
+            LogPrintf("%s: building %s in the background, starting at height %d\n", __func__, idx.strName, idx.nBuiltHeight + 1);
+        }
+        if (!fAny) {
+            return;
+        }
+        fInterrupt = false;
+        thread = std::thread([this]() {
+            RenameThread("historia-idxbuild");
+            ThreadMain();
+        });
+    }
+
+    void Stop()
+    {
+        fInterrupt = true;
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    void GetInfo(std::vector<OptionalIndexInfo>& vInfo)
+    {
+        for (auto& idx : indexes) {
+            OptionalIndexInfo info;
+            info.strName = idx.strName;
+            info.fBuilding = idx.fBuilding;
+            info.fEnabled = *idx.pfEnabled || info.fBuilding;
+            info.nBuiltHeight = info.fBuilding ? idx.nBuiltHeight.load() : -1;
+            vInfo.emplace_back(info);
+        }
+    }
+
+private:
+    static COptionalIndexDB* GetDB(size_t i)
+    {
+        switch (i) {
+        case 0: return paddressindexdb;
+        case 1: return pspentindexdb;
+        case 2: return ptimestampindexdb;
+        default: return pblockfilterindexdb;
+        }
+    }
+
+    bool IsInterrupted() const
+    {
+        return fInterrupt || ShutdownRequested();
+    }
+
+    void ThreadMain()
+    {
+        while (!IsInterrupted()) {
+            const CBlockIndex* pindex;
+            {
+                LOCK(cs_main);
+                int nHeight = std::numeric_limits<int>::max();
+                for (auto& idx : indexes) {
+                    if (!idx.fBuilding) {
+                        continue;
+                    }
+                    if (idx.pindexBuilt && !chainActive.Contains(idx.pindexBuilt)) {
+                        // only possible with a reorg deeper than FINAL_CATCHUP_BLOCKS, which we don't try to undo
+                        LogPrintf("%s: block %s of %s was disconnected, restart with -reindex to build the index\n", __func__,
+                                  idx.pindexBuilt->GetBlockHash().ToString(), idx.strName);
+                        idx.fBuilding = false;
+                        continue;
+                    }
+                    nHeight = std::min(nHeight, idx.nBuiltHeight + 1);
+                }
+                if (nHeight == std::numeric_limits<int>::max()) {
+                    return;
+                }
+                if (nHeight > chainActive.Height() - FINAL_CATCHUP_BLOCKS) {
+                    for (; nHeight <= chainActive.Height() && !IsInterrupted(); nHeight++) {
+                        if (!BuildBlock(chainActive[nHeight])) {
+                            return;
+                        }
+                    }
+                    if (nHeight > chainActive.Height()) {
+                        Finish();
+                    }
+                    return;
+                }
+                pindex = chainActive[nHeight];
+            }
+
+            if (!BuildBlock(pindex)) {
+                return;
+            }
+        }
+    }
+
+    bool BuildBlock(const CBlockIndex* pindex)
+    {
+        const Consensus::Params& consensusParams = Params().GetConsensus();
+
+        bool fBuild[INDEX_COUNT];
+        bool fAny = false;
+        for (size_t i = 0; i < INDEX_COUNT; i++) {
+            // ConnectBlock doesn't index the genesis block, except for its filter
+            fBuild[i] = indexes[i].fBuilding && indexes[i].nBuiltHeight < pindex->nHeight && (pindex->nHeight > 0 || indexes[i].fIncludesGenesis);
+            fAny |= fBuild[i];
+        }
+
+        if (fAny) {
+            CBlock block;
+            CBlockUndo blockundo;
+            if (!ReadBlockFromDisk(block, pindex, consensusParams)) {
+                return AbortNode(strprintf("Failed to read block %s while building indexes", pindex->GetBlockHash().ToString()));
+            }
+            if ((fBuild[0] || fBuild[1] || fBuild[3]) && pindex->nHeight > 0) {
+                CDiskBlockPos pos = pindex->GetUndoPos();
+                if (pos.IsNull() || !UndoReadFromDisk(blockundo, pos, pindex->pprev->GetBlockHash())) {
+                    return AbortNode(strprintf("Failed to read undo data of block %s while building indexes", pindex->GetBlockHash().ToString()));
+                }
+            }
+
+            std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+            std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+
+            if (fBuild[0] || fBuild[1]) {
+                // same order as in ConnectBlock, outputs spent in the same block must end up removed from the unspent index
+                for (unsigned int i = 0; i < block.vtx.size(); i++) {
+                    const CTransaction& tx = *block.vtx[i];
+                    const uint256 txhash = tx.GetHash();
+                    if (!tx.IsCoinBase()) {
+                        const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+                        for (size_t j = 0; j < tx.vin.size(); j++) {
+                            AddSpendIndexEntries(tx.vin[j], txundo.vprevout[j].out, txhash, i, j, pindex->nHeight, fBuild[0], fBuild[1],
+                                                 addressIndex, addressUnspentIndex, spentIndex);
+                        }
+                    }
+                    if (fBuild[0]) {
+                        AddOutputIndexEntries(tx, txhash, i, pindex->nHeight, addressIndex, addressUnspentIndex);
+                    }
+                }
+            }
+
+            if (fBuild[0] && (!paddressindexdb->WriteAddressIndex(addressIndex) || !paddressindexdb->UpdateAddressUnspentIndex(addressUnspentIndex))) {
+                return AbortNode("Failed to write address index");
+            }
+            if (fBuild[1] && !pspentindexdb->UpdateSpentIndex(spentIndex)) {
+                return AbortNode("Failed to write spent index");
+            }
+            if (fBuild[2] && !ptimestampindexdb->WriteTimestampIndex(CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash()))) {
+                return AbortNode("Failed to write timestamp index");
+            }
+            if (fBuild[3]) {
+                uint256 hashPrevBlock = pindex->pprev ? pindex->pprev->GetBlockHash() : uint256();
+                if (!WriteBlockFilter(pindex->GetBlockHash(), hashPrevBlock, BlockFilter::BasicFilterElements(block, blockundo))) {
+                    return AbortNode("Failed to write block filter index");
+                }
+            }
+        }
+
+        LOCK(cs_main);
+        for (size_t i = 0; i < INDEX_COUNT; i++) {
+            if (!fBuild[i]) {
+                continue;
+            }
+            auto& idx = indexes[i];
+            if (!GetDB(i)->WriteBuildTip(pindex->GetBlockHash())) {
+                return AbortNode(strprintf("Failed to write %s progress", idx.strName));
+            }
+            idx.pindexBuilt = pindex;
+            idx.nBuiltHeight = pindex->nHeight;
+        }
+        return true;
+    }
+
+    void Finish()
+    {
+        AssertLockHeld(cs_main);
+
+        for (size_t i = 0; i < INDEX_COUNT; i++) {
+            auto& idx = indexes[i];
+            if (!idx.fBuilding) {
+                continue;
+            }
+            // from this point on, ConnectBlock writes the index
+            *idx.pfEnabled = true;
+            pblocktree->WriteFlag(idx.strName, true);
+            GetDB(i)->EraseBuildTip();
+            idx.fBuilding = false;
+            LogPrintf("%s: %s is synced at height %d\n", __func__, idx.strName, idx.nBuiltHeight);
+        }
+    }
+};
+static CIndexBuilder indexBuilder;
+
+void StartIndexBuilderThread(bool fBuildAddressIndex, bool fBuildSpentIndex, bool fBuildTimestampIndex, bool fBuildBlockFilterIndex)
+{
+    indexBuilder.Start(fBuildAddressIndex, fBuildSpentIndex, fBuildTimestampIndex, fBuildBlockFilterIndex);
+}
+
+void StopIndexBuilderThread()
+{
+    indexBuilder.Stop();
+}
+
+std::vector<OptionalIndexInfo> GetOptionalIndexInfo()
+{
+    std::vector<OptionalIndexInfo> vInfo;
+    indexBuilder.GetInfo(vInfo);
+    return vInfo;
+}
+
 enum DisconnectResult
 {
     DISCONNECT_OK,      // All good.
@@ -1750,12 +2559,13 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
     if (fAddressIndex) {
-        if (!pblocktree->EraseAddressIndex(addressIndex)) {
-            AbortNode(state, "Failed to delete address index");
-            return DISCONNECT_FAILED;
-        }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            AbortNode(state, "Failed to write address unspent index");
+        auto vAddressIndex = std::make_shared<std::vector<std::pair<CAddressIndexKey, CAmount> > >(std::move(addressIndex));
+        auto vAddressUnspentIndex = std::make_shared<std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > >(std::move(addressUnspentIndex));
+        bool fWritten = indexWriter.Push([vAddressIndex, vAddressUnspentIndex]() {
+            return paddressindexdb->EraseAddressIndex(*vAddressIndex) && paddressindexdb->UpdateAddressUnspentIndex(*vAddressUnspentIndex);
+        }, "Failed to update address index");
+        if (!fWritten) {
+            AbortNode(state, "Failed to update address index");
             return DISCONNECT_FAILED;
         }
     }
@@ -1796,9 +2606,124 @@ bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigne
 
 static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
 
-void ThreadScriptCheck() {
-    RenameThread("historia-scriptch");
-    scriptcheckqueue.Thread();
+void ThreadScriptCheck() {
+    RenameThread("historia-scriptch");
+    scriptcheckqueue.Thread();
+}
+
+bool RunScriptChecks(std::vector<CScriptCheck>& vChecks)
+{
+    if (!nScriptCheckThreads || vChecks.size() <= 1) {
+        for (auto& check : vChecks) {
+            if (!check()) {
+                return false;
+            }
+        }
+        // checks created by CheckInputs with pvChecks might have deferred their signatures
+        return FinishCheckBatch(vChecks);
+    }
+
+    // waits for ConnectBlock or another caller if one is using the queue right now
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    control.Add(vChecks);
+    return control.Wait();
+}
+
+/**
+ * Closure representing an arbitrary piece of work which is split up and run on the parallel check threads, e.g.
+ * the PoW checks of a batch of headers or the coin prefetch ahead of ConnectBlock. The caller blocks until all
+ * jobs are done, so jobs may refer to data owned by the caller.
+ */
+class CParallelCheck
+{
+private:
+    std::function<bool()> func;
+
+public:
+    CParallelCheck() {}
+    CParallelCheck(std::function<bool()> _func) : func(std::move(_func)) {}
+
+    bool operator()() {
+        return func();
+    }
+
+    void swap(CParallelCheck& check) {
+        func.swap(check.func);
+    }
+};
+
+static CCheckQueue<CParallelCheck> parallelcheckqueue(128);
+
+/** Maximum number of headers hashed together by one CBlockHeader::CacheHashes call in ProcessNewBlockHeaders */
+static const size_t HEADER_HASH_BATCH_SIZE = 64;
+
+void ThreadParallelCheck() {
+    RenameThread("historia-parcheck");
+    parallelcheckqueue.Thread();
+}
+
+/** Number of coins read from disk by a single prefetch job */
+static const size_t COINS_PREFETCH_BATCH = 16;
+
+/**
+ * Read all coins spent by the block which are not yet in the coins tip cache from disk in parallel and add them to
+ * the cache, so that the serial input lookups in ConnectBlock don't wait for the database one coin at a time.
+ * Inputs which are created by the same block are skipped. This is only a cache warmup, missing coins are left for
+ * ConnectBlock to reject.
+ */
+static void PrefetchBlockCoins(const CBlock& block)
+{
+    AssertLockHeld(cs_main);
+
+    if (!nScriptCheckThreads || block.vtx.size() <= 1) {
+        return;
+    }
+
+    std::unordered_set<uint256, StaticSaltedHasher> setBlockTxids;
+    setBlockTxids.reserve(block.vtx.size());
+    for (const auto& tx : block.vtx) {
+        setBlockTxids.emplace(tx->GetHash());
+    }
+
+    std::vector<COutPoint> vOutPoints;
+    for (size_t i = 1; i < block.vtx.size(); i++) {
+        for (const CTxIn& txin : block.vtx[i]->vin) {
+            if (!setBlockTxids.count(txin.prevout.hash) && !pcoinsTip->HaveCoinInCache(txin.prevout)) {
+                vOutPoints.emplace_back(txin.prevout);
+            }
+        }
+    }
+    if (vOutPoints.size() < 2 * COINS_PREFETCH_BATCH) {
+        // not worth the overhead of waking up the other threads
+        return;
+    }
+
+    // coins which are being flushed in the background are not in the database yet
+    const CCoinsView* pbase = pcoinsdbflusher ? (const CCoinsView*)pcoinsdbflusher : pcoinsdbview;
+    std::vector<Coin> vCoins(vOutPoints.size());
+    std::unique_ptr<bool[]> vFound(new bool[vOutPoints.size()]());
+    {
+        CCheckQueueControl<CParallelCheck> control(&parallelcheckqueue);
+        std::vector<CParallelCheck> vChecks;
+        vChecks.reserve(vOutPoints.size() / COINS_PREFETCH_BATCH + 1);
+        for (size_t i = 0; i < vOutPoints.size(); i += COINS_PREFETCH_BATCH) {
+            size_t end = std::min(i + COINS_PREFETCH_BATCH, vOutPoints.size());
+            vChecks.emplace_back([&vOutPoints, &vCoins, &vFound, pbase, i, end]() {
+                for (size_t j = i; j < end; j++) {
+                    vFound[j] = pbase->GetCoin(vOutPoints[j], vCoins[j]);
+                }
+                return true;
+            });
+        }
+        control.Add(vChecks);
+        control.Wait();
+    }
+
+    for (size_t i = 0; i < vOutPoints.size(); i++) {
+        if (vFound[i]) {
+            pcoinsTip->AddFetchedCoin(vOutPoints[i], std::move(vCoins[i]));
+        }
+    }
 }
 
 // Protected by cs_main
@@ -1866,6 +2791,7 @@ static ThresholdConditionCache warningcache[VERSIONBITS_NUM_BITS];
 
 static int64_t nTimeCheck = 0;
 static int64_t nTimeForks = 0;
+static int64_t nTimeCoinsPrefetch = 0;
 static int64_t nTimeVerify = 0;
 static int64_t nTimeISFilter = 0;
 static int64_t nTimeSubsidy = 0;
@@ -1882,7 +2808,7 @@ static int64_t nTimeTotal = 0;
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
 static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
-                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false)
+                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false, BlockConnectTimings* pTimings = nullptr)
 {
     AssertLockHeld(cs_main);
     assert(pindex);
@@ -1916,8 +2842,12 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     // Special case for the genesis block, skipping connection of its transactions
     // (its coinbase is unspendable)
     if (block.GetHash() == chainparams.GetConsensus().hashGenesisBlock) {
-        if (!fJustCheck)
+        if (!fJustCheck) {
             view.SetBestBlock(pindex->GetBlockHash());
+            // the filter headers of all later blocks commit to the genesis filter
+            if (fBlockFilterIndex && !WriteBlockFilter(pindex->GetBlockHash(), uint256(), BlockFilter::BasicFilterElements(block, CBlockUndo())))
+                return AbortNode(state, "Failed to write block filter index");
+        }
         return true;
     }
 
@@ -1946,8 +2876,18 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             }
         }
     }
+    if (fScriptChecks && fChainLockAssumeValid &&
+        pindexBestHeader->GetAncestor(pindex->nHeight) == pindex &&
+        pindexBestHeader->nChainWork >= UintToArith256(chainparams.GetConsensus().nMinimumChainWork) &&
+        llmq::chainLocksHandler->HasChainLock(pindex->nHeight, pindex->GetBlockHash())) {
+        // The block is an ancestor of a ChainLock which was verified against the LLMQ, so it can't be reorged
+        // anymore and the quorum vouches for its history much like an assumevalid block. No equivalent time check
+        // here, the CLSIG is signed by the masternodes and not something users are told to set.
+        fScriptChecks = false;
+    }
 
-    int64_t nTime1 = GetTimeMicros(); nTimeCheck += nTime1 - nTimeStart;
+    BlockConnectTimings timings;
+    int64_t nTime1 = GetTimeMicros(); nTimeCheck += nTime1 - nTimeStart; timings.nTimeSanity = nTime1 - nTimeStart;
     LogPrint("bench", "    - Sanity checks: %.2fms [%.2fs]\n", 0.001 * (nTime1 - nTimeStart), nTimeCheck * 0.000001);
 
     // Do not allow blocks that contain transactions which 'overwrite' older transactions,
@@ -2025,13 +2965,23 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         flags |= SCRIPT_VERIFY_NULLDUMMY;
     }
 
-    int64_t nTime2 = GetTimeMicros(); nTimeForks += nTime2 - nTime1;
+    int64_t nTime2 = GetTimeMicros(); nTimeForks += nTime2 - nTime1; timings.nTimeForks = nTime2 - nTime1;
     LogPrint("bench", "    - Fork checks: %.2fms [%.2fs]\n", 0.001 * (nTime2 - nTime1), nTimeForks * 0.000001);
 
     CBlockUndo blockundo;
 
+    PrefetchBlockCoins(block);
+
+    int64_t nTime2a = GetTimeMicros(); nTimeCoinsPrefetch += nTime2a - nTime2; timings.nTimeCoinsPrefetch = nTime2a - nTime2;
+    LogPrint("bench", "    - Coins prefetch: %.2fms [%.2fs]\n", 0.001 * (nTime2a - nTime2), nTimeCoinsPrefetch * 0.000001);
+
     CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : NULL);
 
+    // Locked txs which passed the standard flags in the mempool don't need their scripts checked again. The flags
+    // of blocks are a subset of the standard flags, but this must not break silently if that ever changes.
+    const bool fCheckLockedTxs = (flags & ~STANDARD_SCRIPT_VERIFY_FLAGS) == 0 && llmq::quorumInstantSendManager;
+    int nLockedTxsCached = 0;
+
     std::vector<int> prevheights;
     CAmount nFees = 0;
     int nInputs = 0;
@@ -2040,6 +2990,9 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     std::vector<std::pair<uint256, CDiskTxPos> > vPos;
     vPos.reserve(block.vtx.size());
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
+    // the script checks keep pointers into txdata until control.Wait(), it must not be reallocated
+    std::vector<PrecomputedTransactionData> txdata;
+    txdata.reserve(block.vtx.size());
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
     std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
@@ -2079,39 +3032,9 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             if (fAddressIndex || fSpentIndex)
             {
                 for (size_t j = 0; j < tx.vin.size(); j++) {
-                    const CTxIn input = tx.vin[j];
                     const Coin& coin = view.AccessCoin(tx.vin[j].prevout);
-                    const CTxOut &prevout = coin.out;
-                    uint160 hashBytes;
-                    int addressType;
-
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        hashBytes = uint160(std::vector<unsigned char>(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22));
-                        addressType = 2;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        hashBytes = uint160(std::vector<unsigned char>(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23));
-                        addressType = 1;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-                        hashBytes = Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1);
-                        addressType = 1;
-                    } else {
-                        hashBytes.SetNull();
-                        addressType = 0;
-                    }
-
-                    if (fAddressIndex && addressType > 0) {
-                        // record spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, txhash, j, true), prevout.nValue * -1));
-
-                        // remove address from unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                    }
-
-                    if (fSpentIndex) {
-                        // add the spent index to determine the txid and input that spent an output
-                        // and to find the amount and address from an input
-                        spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(txhash, j, pindex->nHeight, prevout.nValue, addressType, hashBytes)));
-                    }
+                    AddSpendIndexEntries(tx.vin[j], coin.out, txhash, i, j, pindex->nHeight, fAddressIndex, fSpentIndex,
+                                         addressIndex, addressUnspentIndex, spentIndex);
                 }
 
             }
@@ -2131,43 +3054,23 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
             std::vector<CScriptCheck> vChecks;
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
-            if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, nScriptCheckThreads ? &vChecks : NULL))
+            bool fTxScriptChecks = fScriptChecks;
+            if (fTxScriptChecks && fCheckLockedTxs && llmq::quorumInstantSendManager->IsLocked(txhash) &&
+                IsTxValidationCached(tx, view, STANDARD_SCRIPT_VERIFY_FLAGS, !fCacheResults)) {
+                // The scripts passed the standard flags, which include all flags of the block, when the locked tx
+                // was accepted into the mempool, spending the same coins it spends here
+                fTxScriptChecks = false;
+                nLockedTxsCached++;
+            }
+            txdata.emplace_back(tx);
+            if (!CheckInputs(tx, state, view, fTxScriptChecks, flags, fCacheResults, txdata.back(), nScriptCheckThreads ? &vChecks : NULL))
                 return error("ConnectBlock(): CheckInputs on %s failed with %s",
                     tx.GetHash().ToString(), FormatStateMessage(state));
             control.Add(vChecks);
         }
 
         if (fAddressIndex) {
-            for (unsigned int k = 0; k < tx.vout.size(); k++) {
-                const CTxOut &out = tx.vout[k];
-
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKey()) {
-                    uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, txhash, k, false), out.nValue));
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-                } else {
-                    continue;
-                }
-
-            }
+            AddOutputIndexEntries(tx, txhash, i, pindex->nHeight, addressIndex, addressUnspentIndex);
         }
 
         CTxUndo undoDummy;
@@ -2179,13 +3082,14 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         vPos.push_back(std::make_pair(tx.GetHash(), pos));
         pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
     }
-    int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
-    LogPrint("bench", "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs]\n", (unsigned)block.vtx.size(), 0.001 * (nTime3 - nTime2), 0.001 * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : 0.001 * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * 0.000001);
+    int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2a; timings.nTimeConnectTxs = nTime3 - nTime2a;
+    LogPrint("bench", "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs]\n", (unsigned)block.vtx.size(), 0.001 * (nTime3 - nTime2a), 0.001 * (nTime3 - nTime2a) / block.vtx.size(), nInputs <= 1 ? 0 : 0.001 * (nTime3 - nTime2a) / (nInputs-1), nTimeConnect * 0.000001);
+    LogPrint("bench", "      - Skipped script checks of %d locked transactions\n", nLockedTxsCached);
 
     if (!control.Wait())
         return state.DoS(100, false);
-    int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2;
-    LogPrint("bench", "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, 0.001 * (nTime4 - nTime2), nInputs <= 1 ? 0 : 0.001 * (nTime4 - nTime2) / (nInputs-1), nTimeVerify * 0.000001);
+    int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2a; timings.nTimeVerifyScripts = nTime4 - nTime3;
+    LogPrint("bench", "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, 0.001 * (nTime4 - nTime2a), nInputs <= 1 ? 0 : 0.001 * (nTime4 - nTime2a) / (nInputs-1), nTimeVerify * 0.000001);
 
 
     // HTA
@@ -2235,7 +3139,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         LogPrintf("ConnectBlock(HTA): spork is off, skipping transaction locking checks\n");
     }
 
-    int64_t nTime5_1 = GetTimeMicros(); nTimeISFilter += nTime5_1 - nTime4;
+    int64_t nTime5_1 = GetTimeMicros(); nTimeISFilter += nTime5_1 - nTime4; timings.nTimeISFilter = nTime5_1 - nTime4;
     LogPrint("bench", "      - IS filter: %.2fms [%.2fs]\n", 0.001 * (nTime5_1 - nTime4), nTimeISFilter * 0.000001);
 
     // HTA : MODIFIED TO CHECK MASTERNODE PAYMENTS AND SUPERBLOCKS
@@ -2244,14 +3148,14 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     CAmount blockReward = nFees + GetBlockSubsidy(pindex->pprev->nBits, pindex->pprev->nHeight, chainparams.GetConsensus());
     std::string strError = "";
 
-    int64_t nTime5_2 = GetTimeMicros(); nTimeSubsidy += nTime5_2 - nTime5_1;
+    int64_t nTime5_2 = GetTimeMicros(); nTimeSubsidy += nTime5_2 - nTime5_1; timings.nTimeSubsidy = nTime5_2 - nTime5_1;
     LogPrint("bench", "      - GetBlockSubsidy: %.2fms [%.2fs]\n", 0.001 * (nTime5_2 - nTime5_1), nTimeSubsidy * 0.000001);
 
     if (!IsBlockValueValid(block, pindex->nHeight, blockReward, strError)) {
         return state.DoS(0, error("ConnectBlock(HTA): %s", strError), REJECT_INVALID, "bad-cb-amount");
     }
 
-    int64_t nTime5_3 = GetTimeMicros(); nTimeValueValid += nTime5_3 - nTime5_2;
+    int64_t nTime5_3 = GetTimeMicros(); nTimeValueValid += nTime5_3 - nTime5_2; timings.nTimeBlockValue = nTime5_3 - nTime5_2;
     LogPrint("bench", "      - IsBlockValueValid: %.2fms [%.2fs]\n", 0.001 * (nTime5_3 - nTime5_2), nTimeValueValid * 0.000001);
 
     if (!IsBlockPayeeValid(*block.vtx[0], pindex->nHeight, blockReward)) {
@@ -2260,10 +3164,10 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
                                 REJECT_INVALID, "bad-cb-payee");
     }
 
-    int64_t nTime5_4 = GetTimeMicros(); nTimePayeeValid += nTime5_4 - nTime5_3;
+    int64_t nTime5_4 = GetTimeMicros(); nTimePayeeValid += nTime5_4 - nTime5_3; timings.nTimeBlockPayee = nTime5_4 - nTime5_3;
     LogPrint("bench", "      - IsBlockPayeeValid: %.2fms [%.2fs]\n", 0.001 * (nTime5_4 - nTime5_3), nTimePayeeValid * 0.000001);
 
-    if (!ProcessSpecialTxsInBlock(block, pindex, state, fJustCheck, fScriptChecks)) {
+    if (!ProcessSpecialTxsInBlock(block, pindex, state, fJustCheck, fScriptChecks, &timings)) {
         return error("ConnectBlock(HTA): ProcessSpecialTxsInBlock for block %s failed with %s",
                      pindex->GetBlockHash().ToString(), FormatStateMessage(state));
     }
@@ -2302,28 +3206,55 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         if (!pblocktree->WriteTxIndex(vPos))
             return AbortNode(state, "Failed to write transaction index");
 
+    // a tx cached from a block which got reorged away may be mined again here
+    for (const auto& tx : block.vtx) {
+        confirmedTxCache.erase(tx->GetHash());
+    }
+
     if (fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(addressIndex)) {
+        auto vAddressIndex = std::make_shared<std::vector<std::pair<CAddressIndexKey, CAmount> > >(std::move(addressIndex));
+        auto vAddressUnspentIndex = std::make_shared<std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > >(std::move(addressUnspentIndex));
+        bool fWritten = indexWriter.Push([vAddressIndex, vAddressUnspentIndex]() {
+            return paddressindexdb->WriteAddressIndex(*vAddressIndex) && paddressindexdb->UpdateAddressUnspentIndex(*vAddressUnspentIndex);
+        }, "Failed to write address index");
+        if (!fWritten)
             return AbortNode(state, "Failed to write address index");
-        }
-
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            return AbortNode(state, "Failed to write address unspent index");
-        }
     }
 
-    if (fSpentIndex)
-        if (!pblocktree->UpdateSpentIndex(spentIndex))
-            return AbortNode(state, "Failed to write transaction index");
+    if (fSpentIndex) {
+        auto vSpentIndex = std::make_shared<std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > >(std::move(spentIndex));
+        bool fWritten = indexWriter.Push([vSpentIndex]() {
+            return pspentindexdb->UpdateSpentIndex(*vSpentIndex);
+        }, "Failed to write spent index");
+        if (!fWritten)
+            return AbortNode(state, "Failed to write spent index");
+    }
 
-    if (fTimestampIndex)
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash())))
+    if (fTimestampIndex) {
+        CTimestampIndexKey timestampIndex(pindex->nTime, pindex->GetBlockHash());
+        bool fWritten = indexWriter.Push([timestampIndex]() {
+            return ptimestampindexdb->WriteTimestampIndex(timestampIndex);
+        }, "Failed to write timestamp index");
+        if (!fWritten)
             return AbortNode(state, "Failed to write timestamp index");
+    }
+
+    if (fBlockFilterIndex) {
+        // only collect the scripts here, the filter is encoded by the index writer
+        auto filterElements = std::make_shared<GCSFilter::ElementSet>(BlockFilter::BasicFilterElements(block, blockundo));
+        uint256 hashBlock = pindex->GetBlockHash();
+        uint256 hashPrevBlock = pindex->pprev->GetBlockHash();
+        bool fWritten = indexWriter.Push([filterElements, hashBlock, hashPrevBlock]() {
+            return WriteBlockFilter(hashBlock, hashPrevBlock, *filterElements);
+        }, "Failed to write block filter index");
+        if (!fWritten)
+            return AbortNode(state, "Failed to write block filter index");
+    }
 
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
-    int64_t nTime6 = GetTimeMicros(); nTimeIndex += nTime6 - nTime5;
+    int64_t nTime6 = GetTimeMicros(); nTimeIndex += nTime6 - nTime5; timings.nTimeIndex = nTime6 - nTime5;
     LogPrint("bench", "    - Index writing: %.2fms [%.2fs]\n", 0.001 * (nTime6 - nTime5), nTimeIndex * 0.000001);
 
     // Watch for changes to the previous coinbase transaction.
@@ -2333,9 +3264,19 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
     evoDb->WriteBestBlock(pindex->GetBlockHash());
 
-    int64_t nTime7 = GetTimeMicros(); nTimeCallbacks += nTime7 - nTime6;
+    int64_t nTime7 = GetTimeMicros(); nTimeCallbacks += nTime7 - nTime6; timings.nTimeCallbacks = nTime7 - nTime6;
     LogPrint("bench", "    - Callbacks: %.2fms [%.2fs]\n", 0.001 * (nTime7 - nTime6), nTimeCallbacks * 0.000001);
 
+    TRACE12(validation, connect_block, pindex->GetBlockHash().begin(), pindex->nHeight, (unsigned)block.vtx.size(), nInputs,
+        timings.nTimeSanity, timings.nTimeForks, timings.nTimeConnectTxs, timings.nTimeVerifyScripts, nTime5 - nTime4,
+        timings.nTimeIndex, timings.nTimeCallbacks, nTime7 - nTimeStart);
+
+    if (pTimings) {
+        timings.nTxs = block.vtx.size();
+        timings.nInputs = nInputs;
+        *pTimings = timings;
+    }
+
     return true;
 }
 
@@ -2382,7 +3323,9 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode, int n
         nLastSetChain = nNow;
     }
     int64_t nMempoolSizeMax = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
-    int64_t cacheSize = pcoinsTip->DynamicMemoryUsage() * DB_PEAK_USAGE_FACTOR;
+    // Coins which are being written in the background still count against the limit until they are on disk
+    size_t nPendingCoinsUsage = pcoinsdbflusher ? pcoinsdbflusher->GetPendingUsage() : 0;
+    int64_t cacheSize = (pcoinsTip->DynamicMemoryUsage() + nPendingCoinsUsage) * DB_PEAK_USAGE_FACTOR;
     cacheSize += evoDb->GetMemoryUsage() * DB_PEAK_USAGE_FACTOR;
     int64_t nTotalSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
     // The cache is large and we're within 10% and 10 MiB of the limit, but we have time now (not in the middle of a block processing).
@@ -2393,8 +3336,13 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode, int n
     bool fPeriodicWrite = mode == FLUSH_STATE_PERIODIC && nNow > nLastWrite + (int64_t)DATABASE_WRITE_INTERVAL * 1000000;
     // It's been very long since we flushed the cache. Do this infrequently, to optimize cache usage.
     bool fPeriodicFlush = mode == FLUSH_STATE_PERIODIC && nNow > nLastFlush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
+    // With background flushing, hand the cache off to the flusher once it is within 10% of the limit while no other
+    // flush is pending. Validation continues while it's written and only has to wait for the flusher if the remaining
+    // 10% fill up first, so the cache can grow to the configured -dbcache.
+    bool fCacheBackground = pcoinsdbflusher && mode == FLUSH_STATE_IF_NEEDED && nPendingCoinsUsage == 0 &&
+                            cacheSize > (int64_t)(9 * nCoinCacheUsage) / 10;
     // Combine all conditions that result in a full cache flush.
-    bool fDoFullFlush = (mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush || fFlushForPrune;
+    bool fDoFullFlush = (mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical || fCacheBackground || fPeriodicFlush || fFlushForPrune;
     // Write blocks and block index to disk.
     if (fDoFullFlush || fPeriodicWrite) {
         // Depend on nMinDiskSpace to ensure we can write block index
@@ -2434,9 +3382,14 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode, int n
         // overwrite one. Still, use a conservative safety factor of 2.
         if (!CheckDiskSpace(48 * 2 * 2 * pcoinsTip->GetCacheSize()))
             return state.Error("out of disk space");
-        // Flush the chainstate (which may refer to block index entries).
+        // The chainstate on disk must never be ahead of the indexes
+        FlushIndexWrites();
+        // Flush the chainstate (which may refer to block index entries). With background flushing, the coins are written
+        // after the evo DB, which is ahead of the chainstate if we crash in between, see RollforwardCoins.
         if (!pcoinsTip->Flush())
             return AbortNode(state, "Failed to write to coin database");
+        if (pcoinsdbflusher && mode == FLUSH_STATE_ALWAYS && !pcoinsdbflusher->WaitForFlush())
+            return AbortNode(state, "Failed to write to coin database");
         if (!evoDb->CommitRootTransaction()) {
             return AbortNode(state, "Failed to commit EvoDB");
         }
@@ -2556,6 +3509,7 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
     std::vector<uint256> vHashUpdate;
     for (const auto& it : block.vtx) {
         const CTransaction& tx = *it;
+        confirmedTxCache.erase(tx.GetHash());
         // ignore validation errors in resurrected transactions
         CValidationState stateDummy;
         if (tx.IsCoinBase() || !AcceptToMemoryPool(mempool, stateDummy, it, false, NULL, true)) {
@@ -2586,6 +3540,21 @@ static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
 static int64_t nTimePostConnect = 0;
 
+static CCriticalSection cs_blockConnectTimings;
+// newest last
+static std::deque<BlockConnectTimings> dequeBlockConnectTimings;
+
+std::vector<BlockConnectTimings> GetBlockConnectTimings(size_t nCount)
+{
+    LOCK(cs_blockConnectTimings);
+    std::vector<BlockConnectTimings> ret;
+    ret.reserve(std::min(nCount, dequeBlockConnectTimings.size()));
+    for (auto it = dequeBlockConnectTimings.rbegin(); it != dequeBlockConnectTimings.rend() && ret.size() < nCount; ++it) {
+        ret.emplace_back(*it);
+    }
+    return ret;
+}
+
 /**
  * Used to track blocks whose transactions were applied to the UTXO state as a
  * part of a single ActivateBestChainStep call.
@@ -2619,12 +3588,13 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     // Apply the block atomically to the chain state.
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
+    BlockConnectTimings timings;
     LogPrint("bench", "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
     {
         auto dbTx = evoDb->BeginTransaction();
 
         CCoinsViewCache view(pcoinsTip);
-        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
+        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams, false, &timings);
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
             if (state.IsInvalid())
@@ -2652,6 +3622,21 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
     LogPrint("bench", "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime6 - nTime5) * 0.001, nTimePostConnect * 0.000001);
     LogPrint("bench", "- Connect block: %.2fms [%.2fs]\n", (nTime6 - nTime1) * 0.001, nTimeTotal * 0.000001);
+
+    timings.blockHash = pindexNew->GetBlockHash();
+    timings.nHeight = pindexNew->nHeight;
+    timings.nTimeReadFromDisk = nTime2 - nTime1;
+    timings.nTimeFlush = nTime4 - nTime3;
+    timings.nTimeChainState = nTime5 - nTime4;
+    timings.nTimePostConnect = nTime6 - nTime5;
+    timings.nTimeTotal = nTime6 - nTime1;
+    {
+        LOCK(cs_blockConnectTimings);
+        dequeBlockConnectTimings.emplace_back(timings);
+        if (dequeBlockConnectTimings.size() > MAX_BLOCK_CONNECT_TIMINGS) {
+            dequeBlockConnectTimings.pop_front();
+        }
+    }
     return true;
 }
 
@@ -2803,6 +3788,11 @@ static bool ActivateBestChainStep(CValidationState& state, const CChainParams& c
         }
         nHeight = nTargetHeight;
 
+        // Verify ProTx signatures of these blocks on worker threads while we connect them one by one
+        if (IsInitialBlockDownload()) {
+            proTxSigCache.QueueBlocks(vpindexToConnect);
+        }
+
         // Connect new blocks.
         BOOST_REVERSE_FOREACH(CBlockIndex *pindexConnect, vpindexToConnect) {
             if (!ConnectTip(state, chainparams, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace)) {
@@ -3512,6 +4502,36 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex)
 {
+    // Computing the X16Rv2 hash is by far the most expensive part of accepting a header. The headers are hashed
+    // before taking cs_main, which fills their hash caches for AcceptBlockHeader.
+    if (nScriptCheckThreads && headers.size() > 1) {
+        // Hash and check the PoW of the headers in parallel. The result is not used here, a failing header is
+        // rejected by AcceptBlockHeader below after the ones in front of it were accepted. Every thread (the
+        // script check threads and this one) gets a share, only large batches fill HEADER_HASH_BATCH_SIZE per job.
+        const Consensus::Params& consensusParams = chainparams.GetConsensus();
+        const size_t nThreads = nScriptCheckThreads + 1;
+        const size_t nBatchSize = std::min(HEADER_HASH_BATCH_SIZE, (headers.size() + nThreads - 1) / nThreads);
+        CCheckQueueControl<CParallelCheck> control(&parallelcheckqueue);
+        std::vector<CParallelCheck> vChecks;
+        vChecks.reserve((headers.size() + nBatchSize - 1) / nBatchSize);
+        for (size_t nBegin = 0; nBegin < headers.size(); nBegin += nBatchSize) {
+            size_t nCount = std::min(nBatchSize, headers.size() - nBegin);
+            const CBlockHeader* pheaders = &headers[nBegin];
+            vChecks.emplace_back([pheaders, nCount, &consensusParams]() {
+                CBlockHeader::CacheHashes(pheaders, nCount);
+                bool fOk = true;
+                for (size_t i = 0; i < nCount; i++) {
+                    fOk &= CheckProofOfWork(pheaders[i].GetHash(), pheaders[i].nBits, consensusParams);
+                }
+                return fOk;
+            });
+        }
+        control.Add(vChecks);
+        control.Wait();
+    } else if (headers.size() > 1) {
+        CBlockHeader::CacheHashes(headers.data(), headers.size());
+    }
+
     {
         LOCK(cs_main);
         for (const CBlockHeader& header : headers) {
@@ -3729,6 +4749,7 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
 {
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         CDiskBlockPos pos(*it, 0);
+        mappedBlockFiles.Remove(*it);
         boost::filesystem::remove(GetBlockPosFilename(pos, "blk"));
         boost::filesystem::remove(GetBlockPosFilename(pos, "rev"));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -3879,6 +4900,167 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
     return pindexNew;
 }
 
+/** Undo the coin changes of a block only, without touching the evo DB or the indexes (see DisconnectBlock) */
+static DisconnectResult DisconnectBlockCoins(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)
+{
+    CBlockUndo blockUndo;
+    CDiskBlockPos pos = pindex->GetUndoPos();
+    if (pos.IsNull()) {
+        error("%s: no undo data available for block %s", __func__, pindex->GetBlockHash().ToString());
+        return DISCONNECT_FAILED;
+    }
+    if (!UndoReadFromDisk(blockUndo, pos, pindex->pprev->GetBlockHash())) {
+        error("%s: failure reading undo data for block %s", __func__, pindex->GetBlockHash().ToString());
+        return DISCONNECT_FAILED;
+    }
+    if (blockUndo.vtxundo.size() + 1 != block.vtx.size()) {
+        error("%s: block and undo data inconsistent", __func__);
+        return DISCONNECT_FAILED;
+    }
+
+    bool fClean = true;
+    for (int i = block.vtx.size() - 1; i >= 0; i--) {
+        const CTransaction& tx = *(block.vtx[i]);
+        uint256 hash = tx.GetHash();
+        for (size_t o = 0; o < tx.vout.size(); o++) {
+            if (!tx.vout[o].scriptPubKey.IsUnspendable()) {
+                fClean = view.SpendCoin(COutPoint(hash, o)) && fClean;
+            }
+        }
+        if (i > 0) { // not coinbases
+            CTxUndo& txundo = blockUndo.vtxundo[i-1];
+            if (txundo.vprevout.size() != tx.vin.size()) {
+                error("%s: transaction and undo data inconsistent", __func__);
+                return DISCONNECT_FAILED;
+            }
+            for (unsigned int j = tx.vin.size(); j-- > 0;) {
+                int res = ApplyTxInUndo(std::move(txundo.vprevout[j]), view, tx.vin[j].prevout);
+                if (res == DISCONNECT_FAILED) return DISCONNECT_FAILED;
+                fClean = fClean && res != DISCONNECT_UNCLEAN;
+            }
+        }
+    }
+    view.SetBestBlock(pindex->pprev->GetBlockHash());
+
+    return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
+}
+
+/**
+ * With background coin flushing (see CCoinsViewDBFlusher), the evo DB is committed before the coins are on disk. If
+ * the node crashed in between, the evo DB is ahead of the chainstate, possibly on another branch when the flush was
+ * handed off after a reorg. Like ReplayBlocks, disconnect the coins down to the fork point using the undo data and
+ * then replay the blocks up to the evo DB's best block, so that both refer to the same block again.
+ */
+static bool RollforwardCoins(const CChainParams& chainparams)
+{
+    uint256 hashCoins = pcoinsTip->GetBestBlock();
+    uint256 hashEvo;
+    if (hashCoins.IsNull() || !evoDb->Read(EVODB_BEST_BLOCK, hashEvo) || hashEvo == hashCoins) {
+        return true;
+    }
+
+    BlockMap::iterator itCoins = mapBlockIndex.find(hashCoins);
+    BlockMap::iterator itEvo = mapBlockIndex.find(hashEvo);
+    if (itCoins == mapBlockIndex.end() || itEvo == mapBlockIndex.end()) {
+        return true;
+    }
+    const CBlockIndex* pindexCoins = itCoins->second;
+    const CBlockIndex* pindexEvo = itEvo->second;
+    if (pindexCoins->GetAncestor(pindexEvo->nHeight) == pindexEvo) {
+        // coins ahead of the evo DB is not something an interrupted background flush leaves behind, let the usual
+        // checks deal with it
+        return true;
+    }
+
+    const CBlockIndex* pindexFork = pindexEvo->GetAncestor(std::min(pindexCoins->nHeight, pindexEvo->nHeight));
+    const CBlockIndex* pindexOld = pindexCoins->GetAncestor(pindexFork->nHeight);
+    while (pindexFork != pindexOld) {
+        pindexFork = pindexFork->pprev;
+        pindexOld = pindexOld->pprev;
+    }
+
+    LogPrintf("%s: rolling coins from %s (%d) via fork point %s (%d) to %s (%d)\n", __func__,
+              hashCoins.ToString(), pindexCoins->nHeight, pindexFork->GetBlockHash().ToString(), pindexFork->nHeight,
+              hashEvo.ToString(), pindexEvo->nHeight);
+
+    CCoinsViewCache cache(pcoinsTip);
+    for (const CBlockIndex* pindex = pindexCoins; pindex != pindexFork; pindex = pindex->pprev) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus())) {
+            return error("%s: failed to read block %s", __func__, pindex->GetBlockHash().ToString());
+        }
+        if (DisconnectBlockCoins(block, pindex, cache) == DISCONNECT_FAILED) {
+            return error("%s: failed to disconnect coins of block %s", __func__, pindex->GetBlockHash().ToString());
+        }
+    }
+
+    std::vector<const CBlockIndex*> vpindex;
+    for (const CBlockIndex* pindex = pindexEvo; pindex != pindexFork; pindex = pindex->pprev) {
+        vpindex.push_back(pindex);
+    }
+
+    for (auto it = vpindex.rbegin(); it != vpindex.rend(); ++it) {
+        const CBlockIndex* pindex = *it;
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus())) {
+            return error("%s: failed to read block %s", __func__, pindex->GetBlockHash().ToString());
+        }
+        for (const auto& tx : block.vtx) {
+            if (!tx->IsCoinBase()) {
+                for (const CTxIn& txin : tx->vin) {
+                    cache.SpendCoin(txin.prevout);
+                }
+            }
+            AddCoins(cache, *tx, pindex->nHeight);
+        }
+    }
+    cache.SetBestBlock(hashEvo);
+    cache.Flush();
+
+    return true;
+}
+
+/** Sorts chunks of v on the shared worker pool and merges them pairwise */
+template<typename T>
+static void ParallelSort(std::vector<T>& v)
+{
+    size_t nChunks = std::min((size_t)g_workerPool.Size(), v.size() / 10000);
+    if (nChunks < 2) {
+        std::sort(v.begin(), v.end());
+        return;
+    }
+
+    std::vector<size_t> vBounds;
+    for (size_t i = 0; i <= nChunks; i++) {
+        vBounds.push_back(v.size() * i / nChunks);
+    }
+
+    std::vector<std::future<void>> vFutures;
+    for (size_t i = 0; i < nChunks; i++) {
+        vFutures.emplace_back(g_workerPool.Push([&v, &vBounds, i](int) {
+            std::sort(v.begin() + vBounds[i], v.begin() + vBounds[i + 1]);
+        }));
+    }
+    for (auto& future : vFutures) {
+        future.get();
+    }
+
+    for (size_t nStep = 1; nStep < nChunks; nStep *= 2) {
+        vFutures.clear();
+        for (size_t i = 0; i + nStep < nChunks; i += 2 * nStep) {
+            size_t nBegin = vBounds[i];
+            size_t nMiddle = vBounds[i + nStep];
+            size_t nEnd = vBounds[std::min(i + 2 * nStep, nChunks)];
+            vFutures.emplace_back(g_workerPool.Push([&v, nBegin, nMiddle, nEnd](int) {
+                std::inplace_merge(v.begin() + nBegin, v.begin() + nMiddle, v.begin() + nEnd);
+            }));
+        }
+        for (auto& future : vFutures) {
+            future.get();
+        }
+    }
+}
+
 bool static LoadBlockIndexDB(const CChainParams& chainparams)
 {
     if (!pblocktree->LoadBlockIndexGuts(InsertBlockIndex))
@@ -3899,7 +5081,7 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
             mapPrevBlockIndex.emplace(pindex->pprev->GetBlockHash(), pindex);
         }
     }
-    sort(vSortedByHeight.begin(), vSortedByHeight.end());
+    ParallelSort(vSortedByHeight);
     BOOST_FOREACH(const PAIRTYPE(int, CBlockIndex*)& item, vSortedByHeight)
     {
         CBlockIndex* pindex = item.second;
@@ -3990,6 +5172,13 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     pblocktree->ReadFlag("spentindex", fSpentIndex);
     LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
 
+    // Check whether we have a block filter index
+    pblocktree->ReadFlag("blockfilterindex", fBlockFilterIndex);
+    LogPrintf("%s: block filter index %s\n", __func__, fBlockFilterIndex ? "enabled" : "disabled");
+
+    if (!RollforwardCoins(chainparams))
+        return false;
+
     // Load pointer to end of best chain
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     if (it == mapBlockIndex.end())
@@ -4189,6 +5378,9 @@ bool InitBlockIndex(const CChainParams& chainparams)
     fSpentIndex = GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
     pblocktree->WriteFlag("spentindex", fSpentIndex);
 
+    fBlockFilterIndex = GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX);
+    pblocktree->WriteFlag("blockfilterindex", fBlockFilterIndex);
+
     LogPrintf("Initializing databases...\n");
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
@@ -4218,6 +5410,112 @@ bool InitBlockIndex(const CChainParams& chainparams)
     return true;
 }
 
+/** Maximum number of blocks read from an external file before they are checked and processed */
+static const size_t IMPORT_BATCH_BLOCKS = 64;
+/** Maximum total size of the blocks read from an external file before they are checked and processed */
+static const size_t IMPORT_BATCH_BYTES = 32 * 1024 * 1024;
+
+typedef std::vector<std::pair<std::shared_ptr<CBlock>, CDiskBlockPos>> ImportBatch;
+
+/**
+ * Check and accept a batch of blocks read by LoadExternalBlockFile. The context free checks (PoW hash, merkle root
+ * and transaction checks) are run on all blocks of the batch in parallel first, their result is cached in the block
+ * and AcceptBlock only does the contextual checks then, in file order. Returns false on a state error.
+ */
+static bool ProcessImportBatch(const CChainParams& chainparams, ImportBatch& vBatch, bool fReindexPos,
+                               std::multimap<uint256, CDiskBlockPos>& mapBlocksUnknownParent, int& nLoaded)
+{
+    const Consensus::Params& consensusParams = chainparams.GetConsensus();
+
+    if (nScriptCheckThreads && vBatch.size() > 1) {
+        CCheckQueueControl<CParallelCheck> control(&parallelcheckqueue);
+        std::vector<CParallelCheck> vChecks;
+        vChecks.reserve(vBatch.size());
+        for (const auto& p : vBatch) {
+            const CBlock& block = *p.first;
+            vChecks.emplace_back([&block, &consensusParams]() {
+                // Invalid blocks are rejected with the proper state by AcceptBlock, which repeats the check
+                CValidationState dummy;
+                CheckBlock(block, dummy, consensusParams);
+                return true;
+            });
+        }
+        control.Add(vChecks);
+        control.Wait();
+    }
+
+    for (auto& p : vBatch) {
+        std::shared_ptr<CBlock> pblock = p.first;
+        CDiskBlockPos* dbp = fReindexPos ? &p.second : NULL;
+        try {
+            const CBlock& block = *pblock;
+
+            // detect out of order blocks, and store them for later
+            uint256 hash = block.GetHash();
+            if (hash != consensusParams.hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
+                LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+                        block.hashPrevBlock.ToString());
+                if (dbp)
+                    mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+                continue;
+            }
+
+            // process in case the block isn't known yet
+            if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
+                LOCK(cs_main);
+                CValidationState state;
+                if (AcceptBlock(pblock, state, chainparams, NULL, true, dbp, NULL))
+                    nLoaded++;
+                if (state.IsError())
+                    return false;
+            } else if (hash != consensusParams.hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
+                LogPrint("reindex", "Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
+            }
+
+            // Activate the genesis block so normal node progress can continue
+            if (hash == consensusParams.hashGenesisBlock) {
+                CValidationState state;
+                if (!ActivateBestChain(state, chainparams)) {
+                    return false;
+                }
+            }
+
+            NotifyHeaderTip();
+
+            // Recursively process earlier encountered successors of this block
+            std::deque<uint256> queue;
+            queue.push_back(hash);
+            while (!queue.empty()) {
+                uint256 head = queue.front();
+                queue.pop_front();
+                std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+                while (range.first != range.second) {
+                    std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
+                    std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
+                    if (ReadBlockFromDisk(*pblockrecursive, it->second, consensusParams))
+                    {
+                        LogPrint("reindex", "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
+                                head.ToString());
+                        LOCK(cs_main);
+                        CValidationState dummy;
+                        if (AcceptBlock(pblockrecursive, dummy, chainparams, NULL, true, &it->second, NULL))
+                        {
+                            nLoaded++;
+                            queue.push_back(pblockrecursive->GetHash());
+                        }
+                    }
+                    range.first++;
+                    mapBlocksUnknownParent.erase(it);
+                    NotifyHeaderTip();
+                }
+            }
+        } catch (const std::exception& e) {
+            LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+        }
+    }
+    return true;
+}
+
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp)
 {
     // Map of disk positions for blocks with unknown parent (only used for reindex)
@@ -4230,6 +5528,10 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2*nMaxBlockSize, nMaxBlockSize+8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
+        // Blocks are read in batches, see ProcessImportBatch
+        ImportBatch vBatch;
+        size_t nBatchBytes = 0;
+        bool fAborted = false;
         while (!blkdat.eof()) {
             boost::this_thread::interruption_point();
 
@@ -4261,72 +5563,26 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
                 blkdat.SetLimit(nBlockPos + nSize);
                 blkdat.SetPos(nBlockPos);
                 std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
+                blkdat >> *pblock;
                 nRewind = blkdat.GetPos();
 
-                // detect out of order blocks, and store them for later
-                uint256 hash = block.GetHash();
-                if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
-                    LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                            block.hashPrevBlock.ToString());
-                    if (dbp)
-                        mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                    continue;
-                }
-
-                // process in case the block isn't known yet
-                if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
-                    LOCK(cs_main);
-                    CValidationState state;
-                    if (AcceptBlock(pblock, state, chainparams, NULL, true, dbp, NULL))
-                        nLoaded++;
-                    if (state.IsError())
-                        break;
-                } else if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
-                    LogPrint("reindex", "Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
-                }
-
-                // Activate the genesis block so normal node progress can continue
-                if (hash == chainparams.GetConsensus().hashGenesisBlock) {
-                    CValidationState state;
-                    if (!ActivateBestChain(state, chainparams)) {
-                        break;
-                    }
-                }
-
-                NotifyHeaderTip();
-
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
-                        if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
-                        {
-                            LogPrint("reindex", "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
-                                    head.ToString());
-                            LOCK(cs_main);
-                            CValidationState dummy;
-                            if (AcceptBlock(pblockrecursive, dummy, chainparams, NULL, true, &it->second, NULL))
-                            {
-                                nLoaded++;
-                                queue.push_back(pblockrecursive->GetHash());
-                            }
-                        }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                        NotifyHeaderTip();
-                    }
-                }
+                vBatch.emplace_back(pblock, dbp ? *dbp : CDiskBlockPos());
+                nBatchBytes += nSize;
             } catch (const std::exception& e) {
                 LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
             }
+
+            if (vBatch.size() >= IMPORT_BATCH_BLOCKS || nBatchBytes >= IMPORT_BATCH_BYTES) {
+                if (!ProcessImportBatch(chainparams, vBatch, dbp != NULL, mapBlocksUnknownParent, nLoaded)) {
+                    fAborted = true;
+                    break;
+                }
+                vBatch.clear();
+                nBatchBytes = 0;
+            }
+        }
+        if (!fAborted && !vBatch.empty()) {
+            ProcessImportBatch(chainparams, vBatch, dbp != NULL, mapBlocksUnknownParent, nLoaded);
         }
     } catch (const std::runtime_error& e) {
         AbortNode(std::string("System error: ") + e.what());
@@ -4543,6 +5799,84 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
 
+/** Number of transactions read from mempool.dat whose scripts are checked in parallel before they are added */
+static const size_t MEMPOOL_LOAD_BATCH = 1000;
+/** Number of transactions whose scripts are checked by a single job */
+static const size_t MEMPOOL_LOAD_JOB_SIZE = 16;
+
+/**
+ * Check the scripts of a batch of transactions read from mempool.dat on the parallel check threads, without holding
+ * cs_main. This fills the signature cache, so the AcceptToMemoryPool calls which add the transactions one by one
+ * afterwards skip the signature checks. Inputs spending earlier transactions of the batch are checked against their
+ * outputs, failures and missing inputs are left for AcceptToMemoryPool to reject.
+ */
+static void PrecheckMempoolScripts(const std::vector<std::pair<CTransactionRef, int64_t>>& vTxes)
+{
+    if (!nScriptCheckThreads || vTxes.size() <= MEMPOOL_LOAD_JOB_SIZE) {
+        return;
+    }
+
+    std::unordered_map<uint256, const CTransaction*, StaticSaltedHasher> mapBatchTxes;
+    mapBatchTxes.reserve(vTxes.size());
+    for (const auto& p : vTxes) {
+        mapBatchTxes.emplace(p.first->GetHash(), p.first.get());
+    }
+
+    std::vector<PrecomputedTransactionData> vTxData;
+    vTxData.reserve(vTxes.size());
+    std::vector<std::vector<CScriptCheck>> vTxChecks(vTxes.size());
+    {
+        LOCK2(cs_main, mempool.cs);
+        CCoinsViewMemPool viewMemPool(pcoinsTip, mempool);
+        CCoinsViewCache view(&viewMemPool);
+        for (size_t i = 0; i < vTxes.size(); i++) {
+            const CTransaction& tx = *vTxes[i].first;
+            vTxData.emplace_back(tx);
+            vTxChecks[i].reserve(tx.vin.size());
+            for (size_t j = 0; j < tx.vin.size(); j++) {
+                const COutPoint& prevout = tx.vin[j].prevout;
+                const CTxOut* pout = nullptr;
+                auto it = mapBatchTxes.find(prevout.hash);
+                if (it != mapBatchTxes.end()) {
+                    if (prevout.n < it->second->vout.size()) {
+                        pout = &it->second->vout[prevout.n];
+                    }
+                } else {
+                    const Coin& coin = view.AccessCoin(prevout);
+                    if (!coin.IsSpent()) {
+                        pout = &coin.out;
+                    }
+                }
+                if (pout == nullptr) {
+                    continue;
+                }
+                CScriptCheck check(pout->scriptPubKey, pout->nValue, tx, j, STANDARD_SCRIPT_VERIFY_FLAGS, true, &vTxData.back());
+                vTxChecks[i].push_back(CScriptCheck());
+                check.swap(vTxChecks[i].back());
+            }
+        }
+    }
+
+    CCheckQueueControl<CParallelCheck> control(&parallelcheckqueue);
+    std::vector<CParallelCheck> vChecks;
+    vChecks.reserve(vTxes.size() / MEMPOOL_LOAD_JOB_SIZE + 1);
+    for (size_t i = 0; i < vTxes.size(); i += MEMPOOL_LOAD_JOB_SIZE) {
+        size_t end = std::min(i + MEMPOOL_LOAD_JOB_SIZE, vTxes.size());
+        vChecks.emplace_back([&vTxChecks, i, end]() {
+            for (size_t j = i; j < end; j++) {
+                for (auto& check : vTxChecks[j]) {
+                    if (!check()) {
+                        break;
+                    }
+                }
+            }
+            return true;
+        });
+    }
+    control.Add(vChecks);
+    control.Wait();
+}
+
 bool LoadMempool(void)
 {
     if (GetBoolArg("-zapwallettxes", false)) {
@@ -4563,6 +5897,23 @@ bool LoadMempool(void)
     int64_t failed = 0;
     int64_t nNow = GetTime();
 
+    // the transactions are dumped parents first, so adding each batch in file order respects the dependencies
+    std::vector<std::pair<CTransactionRef, int64_t>> vBatch;
+    auto acceptBatch = [&]() {
+        PrecheckMempoolScripts(vBatch);
+        for (const auto& p : vBatch) {
+            CValidationState state;
+            LOCK(cs_main);
+            AcceptToMemoryPoolWithTime(mempool, state, p.first, true, NULL, p.second);
+            if (state.IsValid()) {
+                ++count;
+            } else {
+                ++failed;
+            }
+        }
+        vBatch.clear();
+    };
+
     try {
         uint64_t version;
         file >> version;
@@ -4571,6 +5922,7 @@ bool LoadMempool(void)
         }
         uint64_t num;
         file >> num;
+        vBatch.reserve(std::min<uint64_t>(num, MEMPOOL_LOAD_BATCH));
         while (num--) {
             CTransactionRef tx;
             int64_t nTime;
@@ -4583,18 +5935,14 @@ bool LoadMempool(void)
             if (amountdelta) {
                 mempool.PrioritiseTransaction(tx->GetHash(), amountdelta);
             }
-            CValidationState state;
             if (nTime + nExpiryTimeout > nNow) {
-                LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(mempool, state, tx, true, NULL, nTime);
-                if (state.IsValid()) {
-                    ++count;
-                } else {
-                    ++failed;
-                }
+                vBatch.emplace_back(tx, nTime);
             } else {
                 ++skipped;
             }
+            if (vBatch.size() >= MEMPOOL_LOAD_BATCH || num == 0) {
+                acceptBatch();
+            }
             if (ShutdownRequested())
                 return false;
         }
@@ -4606,6 +5954,8 @@ bool LoadMempool(void)
         }
     } catch (const std::exception& e) {
         LogPrintf("Failed to deserialize mempool data on disk: %s. Continuing anyway.\n", e.what());
+        // keep what was read before the error, like when the transactions were added one by one
+        acceptBatch();
         return false;
     }
 
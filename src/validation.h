@@ -16,6 +16,7 @@
 #include "coins.h"
 #include "protocol.h" // For CMessageHeader::MessageStartChars
 #include "script/script_error.h"
+#include "script/sigcache.h"
 #include "sync.h"
 #include "versionbits.h"
 #include "spentindex.h"
@@ -35,10 +36,15 @@
 #include <boost/filesystem/path.hpp>
 
 class CBlockIndex;
+class CAddressIndexDB;
+class CBlockFilterIndexDB;
 class CBlockTreeDB;
 class CBloomFilter;
 class CChainParams;
 class CCoinsViewDB;
+class CCoinsViewDBFlusher;
+class CSpentIndexDB;
+class CTimestampIndexDB;
 class CInv;
 class CConnman;
 class CScriptCheck;
@@ -46,6 +52,7 @@ class CTxMemPool;
 class CValidationInterface;
 class CValidationState;
 struct ChainTxData;
+struct PrecomputedTransactionData;
 
 struct LockPoints;
 
@@ -136,6 +143,14 @@ static const bool DEFAULT_TXINDEX = true;
 static const bool DEFAULT_ADDRESSINDEX = false;
 static const bool DEFAULT_TIMESTAMPINDEX = false;
 static const bool DEFAULT_SPENTINDEX = false;
+static const bool DEFAULT_BLOCKFILTERINDEX = false;
+/** Default for -blockfilemmap */
+static const bool DEFAULT_BLOCKFILE_MMAP = true;
+/** Default for -batchsigverify */
+static const bool DEFAULT_BATCH_SIG_VERIFY = false;
+/** Default for -mempoolparallelinputs */
+static const unsigned int DEFAULT_MEMPOOL_PARALLEL_INPUTS = 4;
+static const bool DEFAULT_CHAINLOCK_ASSUMEVALID = false;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 
 /** Maximum number of headers to announce when relaying blocks with headers message.*/
@@ -145,6 +160,7 @@ static const unsigned int MAX_BLOCKS_TO_ANNOUNCE = 8;
 static const int MAX_UNCONNECTING_HEADERS = 10;
 
 static const bool DEFAULT_PEERBLOOMFILTERS = true;
+static const bool DEFAULT_PEERBLOCKFILTERS = false;
 
 struct BlockHasher
 {
@@ -167,6 +183,16 @@ extern std::atomic_bool fImporting;
 extern bool fReindex;
 extern int nScriptCheckThreads;
 extern bool fTxIndex;
+extern bool fAddressIndex;
+extern bool fTimestampIndex;
+extern bool fSpentIndex;
+extern bool fBlockFilterIndex;
+/** Read blocks and undo data through memory mappings of the blk/rev files */
+extern bool fBlockFileMmap;
+/** Defer the signature checks of queued script checks to the end of their CCheckQueue batch */
+extern bool fBatchSigVerify;
+/** Transactions with at least this many inputs have their scripts checked on the script check threads in AcceptToMemoryPool, 0 to never */
+extern unsigned int nMempoolParallelInputs;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern unsigned int nBytesPerSigOp;
@@ -191,6 +217,9 @@ extern std::atomic<bool> fDIP0001ActiveAtTip;
 /** Block hash whose ancestors we will assume to have valid scripts without checking them. */
 extern uint256 hashAssumeValid;
 
+/** Whether to skip script verification of the ancestors of the best verified ChainLock, like for hashAssumeValid. */
+extern bool fChainLockAssumeValid;
+
 /** Best header we've seen so far (used for getheaders queries' starting points). */
 extern CBlockIndex *pindexBestHeader;
 
@@ -271,6 +300,10 @@ bool LoadBlockIndex(const CChainParams& chainparams);
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run script checks outside of block connection, on the script checking threads if there are any */
+bool RunScriptChecks(std::vector<CScriptCheck>& vChecks);
+/** Run an instance of the thread which runs parallel checks and jobs other than script checks */
+void ThreadParallelCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Format a string that describes several potential problems detected by the core.
@@ -375,7 +408,7 @@ unsigned int GetP2SHSigOpCount(const CTransaction& tx, const CCoinsViewCache& ma
  * instead of being performed inline.
  */
 bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &view, bool fScriptChecks,
-                 unsigned int flags, bool cacheStore, std::vector<CScriptCheck> *pvChecks = NULL);
+                 unsigned int flags, bool cacheStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks = NULL);
 
 /** Apply the effects of this transaction on the UTXO set represented by view */
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight);
@@ -437,7 +470,7 @@ bool CheckSequenceLocks(const CTransaction &tx, int flags, LockPoints* lp = NULL
 
 /**
  * Closure representing one script verification
- * Note that this stores references to the spending transaction 
+ * Note that this stores references to the spending transaction and its precomputed data
  */
 class CScriptCheck
 {
@@ -448,15 +481,31 @@ private:
     unsigned int nFlags;
     bool cacheStore;
     ScriptError error;
+    const PrecomputedTransactionData *txdata;
+    bool fDeferSigs;
+    CSignatureBatch deferredSigs;
 
 public:
-    CScriptCheck(): ptxTo(0), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR) {}
-    CScriptCheck(const CScript& scriptPubKeyIn, const CAmount amountIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn) :
+    CScriptCheck(): ptxTo(0), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(nullptr), fDeferSigs(false) {}
+    CScriptCheck(const CScript& scriptPubKeyIn, const CAmount amountIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, const PrecomputedTransactionData* txdataIn = nullptr, bool fDeferSigsIn = false) :
         scriptPubKey(scriptPubKeyIn),
-        ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR) { }
+        ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(txdataIn),
+        fDeferSigs(fDeferSigsIn && CanDeferSigs(scriptPubKeyIn)) { }
+
+    /**
+     * Only the signature of a single key CHECKSIG is deferred. Deferring assumes every signature to be valid, which
+     * pairs the signatures of a CHECKMULTISIG with the wrong keys whenever not the first keys signed
+     */
+    static bool CanDeferSigs(const CScript& scriptPubKey) { return scriptPubKey.IsPayToPublicKeyHash() || scriptPubKey.IsPayToPublicKey(); }
 
+    /** With fDeferSigs, a successful result is only valid once the signatures in deferredSigs verified */
     bool operator()();
 
+    /** Moves the signatures deferred by operator() into batch */
+    void TakeDeferredSigs(CSignatureBatch& batch) { batch.Append(deferredSigs); }
+    /** Runs the check again without assuming any signature to be valid */
+    bool RecheckWithoutDeferring();
+
     void swap(CScriptCheck &check) {
         scriptPubKey.swap(check.scriptPubKey);
         std::swap(ptxTo, check.ptxTo);
@@ -464,23 +513,35 @@ public:
         std::swap(nFlags, check.nFlags);
         std::swap(cacheStore, check.cacheStore);
         std::swap(error, check.error);
+        std::swap(txdata, check.txdata);
+        std::swap(fDeferSigs, check.fDeferSigs);
+        deferredSigs.swap(check.deferredSigs);
     }
 
     ScriptError GetScriptError() const { return error; }
 };
 
+/** Verifies the signatures deferred by the checks of a CCheckQueue batch, see CCheckQueue::Loop */
+bool FinishCheckBatch(std::vector<CScriptCheck>& vChecks);
+
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes);
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
+/** Look up multiple keys at once, the ones not in the mempool are read from one DB snapshot */
+bool GetSpentIndexes(const std::vector<CSpentIndexKey>& keys, std::vector<CSpentIndexValue>& values, std::vector<bool>& found);
 bool GetAddressIndex(uint160 addressHash, int type,
                      std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                     int start = 0, int end = 0);
+                     int start = 0, int end = 0, size_t limit = 0, const CAddressIndexKey* pafter = nullptr);
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+/** Get the aggregate of the address index entries of an address, false if the balance table isn't available */
+bool GetAddressBalance(uint160 addressHash, int type, CAddressBalance &balance);
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Read the serialized block as it is stored on disk, which is the same as the network serialization */
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& vchBlockRet, const CDiskBlockPos& pos);
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -527,12 +588,78 @@ extern CChain chainActive;
 /** Global variable that points to the coins database (protected by cs_main) */
 extern CCoinsViewDB *pcoinsdbview;
 
+/** Writes coin flushes in the background, sits on top of pcoinsdbview if not NULL (protected by cs_main) */
+extern CCoinsViewDBFlusher *pcoinsdbflusher;
+
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern CCoinsViewCache *pcoinsTip;
 
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
+/** Global variables that point to the optional index databases */
+extern CAddressIndexDB *paddressindexdb;
+extern CSpentIndexDB *pspentindexdb;
+extern CTimestampIndexDB *ptimestampindexdb;
+extern CBlockFilterIndexDB *pblockfilterindexdb;
+
+/** Start/stop writing index entries in the background */
+void StartIndexWriterThread();
+void StopIndexWriterThread();
+/** Wait until all queued index entries are written */
+void FlushIndexWrites();
+
+/** Build the given indexes in the background, they are enabled when they reach the tip */
+void StartIndexBuilderThread(bool fBuildAddressIndex, bool fBuildSpentIndex, bool fBuildTimestampIndex, bool fBuildBlockFilterIndex);
+void StopIndexBuilderThread();
+
+struct OptionalIndexInfo {
+    std::string strName;
+    bool fEnabled;
+    bool fBuilding;
+    //! the last block included while building, -1 if not building
+    int nBuiltHeight;
+};
+std::vector<OptionalIndexInfo> GetOptionalIndexInfo();
+
+/** Time spent in each stage of connecting a block to the active chain, in microseconds */
+struct BlockConnectTimings {
+    uint256 blockHash;
+    int nHeight{0};
+    unsigned int nTxs{0};
+    int nInputs{0};
+
+    int64_t nTimeReadFromDisk{0};
+    // ConnectBlock
+    int64_t nTimeSanity{0};
+    int64_t nTimeForks{0};
+    int64_t nTimeCoinsPrefetch{0};
+    int64_t nTimeConnectTxs{0};
+    int64_t nTimeVerifyScripts{0};
+    int64_t nTimeISFilter{0};
+    int64_t nTimeSubsidy{0};
+    //! IsBlockValueValid, includes the superblock checks
+    int64_t nTimeBlockValue{0};
+    //! IsBlockPayeeValid, masternode and superblock payments
+    int64_t nTimeBlockPayee{0};
+    // ProcessSpecialTxsInBlock
+    int64_t nTimeSpecialTxs{0};
+    int64_t nTimeQuorumBlockProcessor{0};
+    int64_t nTimeDeterministicMNs{0};
+    int64_t nTimeCbTxMerkleRoots{0};
+    int64_t nTimeIndex{0};
+    int64_t nTimeCallbacks{0};
+    // ConnectTip
+    int64_t nTimeFlush{0};
+    int64_t nTimeChainState{0};
+    int64_t nTimePostConnect{0};
+    int64_t nTimeTotal{0};
+};
+/** Number of blocks for which the connect timings are kept */
+static const size_t MAX_BLOCK_CONNECT_TIMINGS = 1000;
+/** Return the timings of the last nCount blocks connected to the active chain, newest first */
+std::vector<BlockConnectTimings> GetBlockConnectTimings(size_t nCount);
+
 /**
  * Return the spend height, which is one more than the inputs.GetBestBlock().
  * While checking, GetBestBlock() refers to the parent block. (protected by cs_main)
@@ -5,8 +5,117 @@
 
 #include "validationinterface.h"
 
+#include "chain.h"
+#include "governance-object.h"
+#include "governance-vote.h"
+#include "ipfs-pinning.h"
+#include "primitives/block.h"
+#include "primitives/transaction.h"
+#include "scheduler.h"
+
+#include "evo/deterministicmns.h"
+
+#include <assert.h>
+#include <map>
+#include <vector>
+
 static CMainSignals g_signals;
 
+/**
+ * Registered in place of a queued listener, copies the arguments of each notification and
+ * hands the call to the listener's SingleThreadedSchedulerClient.
+ */
+class CQueuedValidationInterface : public CValidationInterface
+{
+private:
+    CValidationInterface* target;
+    SingleThreadedSchedulerClient queue;
+
+public:
+    CQueuedValidationInterface(CValidationInterface* targetIn, CScheduler* pscheduler, const std::string& strName) :
+        target(targetIn), queue(pscheduler, CScheduler::PRIORITY_NORMAL, strName) {}
+
+    void EmptyQueue() { queue.EmptyQueue(); }
+
+protected:
+    void AcceptedBlockHeader(const CBlockIndex *pindexNew) override
+    {
+        queue.AddToProcessQueue([this, pindexNew] { target->AcceptedBlockHeader(pindexNew); });
+    }
+    void NotifyHeaderTip(const CBlockIndex *pindexNew, bool fInitialDownload) override
+    {
+        queue.AddToProcessQueue([this, pindexNew, fInitialDownload] { target->NotifyHeaderTip(pindexNew, fInitialDownload); });
+    }
+    void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override
+    {
+        queue.AddToProcessQueue([this, pindexNew, pindexFork, fInitialDownload] { target->UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload); });
+    }
+    void SyncTransaction(const CTransaction &tx, const CBlockIndex *pindex, int posInBlock) override
+    {
+        CTransactionRef ptx = MakeTransactionRef(tx);
+        queue.AddToProcessQueue([this, ptx, pindex, posInBlock] { target->SyncTransaction(*ptx, pindex, posInBlock); });
+    }
+    void NotifyTransactionLock(const CTransaction &tx) override
+    {
+        CTransactionRef ptx = MakeTransactionRef(tx);
+        queue.AddToProcessQueue([this, ptx] { target->NotifyTransactionLock(*ptx); });
+    }
+    void NotifyChainLock(const CBlockIndex* pindex) override
+    {
+        queue.AddToProcessQueue([this, pindex] { target->NotifyChainLock(pindex); });
+    }
+    void NotifyGovernanceVote(const CGovernanceVote &vote) override
+    {
+        queue.AddToProcessQueue([this, vote] { target->NotifyGovernanceVote(vote); });
+    }
+    void NotifyGovernanceObject(const CGovernanceObject &object) override
+    {
+        auto pobject = std::make_shared<const CGovernanceObject>(object);
+        queue.AddToProcessQueue([this, pobject] { target->NotifyGovernanceObject(*pobject); });
+    }
+    void NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx) override
+    {
+        CTransactionRef pcurrentTx = MakeTransactionRef(currentTx);
+        CTransactionRef ppreviousTx = MakeTransactionRef(previousTx);
+        queue.AddToProcessQueue([this, pcurrentTx, ppreviousTx] { target->NotifyInstantSendDoubleSpendAttempt(*pcurrentTx, *ppreviousTx); });
+    }
+    void NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff) override
+    {
+        queue.AddToProcessQueue([this, undo, oldMNList, diff] { target->NotifyMasternodeListChanged(undo, oldMNList, diff); });
+    }
+    void NotifyIPFSPinEvent(const CIPFSPinEvent& event) override
+    {
+        queue.AddToProcessQueue([this, event] { target->NotifyIPFSPinEvent(event); });
+    }
+    void SetBestChain(const CBlockLocator &locator) override
+    {
+        queue.AddToProcessQueue([this, locator] { target->SetBestChain(locator); });
+    }
+    void Inventory(const uint256 &hash) override
+    {
+        queue.AddToProcessQueue([this, hash] { target->Inventory(hash); });
+    }
+    void ResetRequestCount(const uint256 &hash) override
+    {
+        queue.AddToProcessQueue([this, hash] { target->ResetRequestCount(hash); });
+    }
+    void NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& block) override
+    {
+        queue.AddToProcessQueue([this, pindex, block] { target->NewPoWValidBlock(pindex, block); });
+    }
+
+    // these can't wait, the caller uses the result or state passed in right away
+    bool UpdatedTransaction(const uint256 &hash) override { return target->UpdatedTransaction(hash); }
+    void ResendWalletTransactions(int64_t nBestBlockTime, CConnman* connman) override { target->ResendWalletTransactions(nBestBlockTime, connman); }
+    void BlockChecked(const CBlock& block, const CValidationState& state) override { target->BlockChecked(block, state); }
+    void GetScriptForMining(boost::shared_ptr<CReserveScript>& script) override { target->GetScriptForMining(script); }
+};
+
+// Queued listeners and the interfaces registered for them. An unregistered interface is
+// kept around, a scheduler thread might still be about to look at its (empty) queue.
+static std::map<CValidationInterface*, CQueuedValidationInterface*> mapQueuedInterfaces;
+static std::vector<std::unique_ptr<CQueuedValidationInterface>> vecQueuedInterfaces;
+
 CMainSignals& GetMainSignals()
 {
     return g_signals;
@@ -31,9 +140,25 @@ void RegisterValidationInterface(CValidationInterface* pwalletIn) {
     g_signals.NotifyGovernanceVote.connect(boost::bind(&CValidationInterface::NotifyGovernanceVote, pwalletIn, _1));
     g_signals.NotifyInstantSendDoubleSpendAttempt.connect(boost::bind(&CValidationInterface::NotifyInstantSendDoubleSpendAttempt, pwalletIn, _1, _2));
     g_signals.NotifyMasternodeListChanged.connect(boost::bind(&CValidationInterface::NotifyMasternodeListChanged, pwalletIn, _1, _2, _3));
+    g_signals.NotifyIPFSPinEvent.connect(boost::bind(&CValidationInterface::NotifyIPFSPinEvent, pwalletIn, _1));
+}
+
+void RegisterQueuedValidationInterface(CValidationInterface* pwalletIn, CScheduler* pscheduler, const std::string& strName) {
+    assert(!mapQueuedInterfaces.count(pwalletIn));
+    vecQueuedInterfaces.emplace_back(new CQueuedValidationInterface(pwalletIn, pscheduler, strName));
+    mapQueuedInterfaces.emplace(pwalletIn, vecQueuedInterfaces.back().get());
+    RegisterValidationInterface(vecQueuedInterfaces.back().get());
 }
 
 void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
+    auto it = mapQueuedInterfaces.find(pwalletIn);
+    if (it != mapQueuedInterfaces.end()) {
+        CQueuedValidationInterface* pqueued = it->second;
+        mapQueuedInterfaces.erase(it);
+        UnregisterValidationInterface(pqueued);
+        pqueued->EmptyQueue();
+        return;
+    }
     g_signals.BlockFound.disconnect(boost::bind(&CValidationInterface::ResetRequestCount, pwalletIn, _1));
     g_signals.ScriptForMining.disconnect(boost::bind(&CValidationInterface::GetScriptForMining, pwalletIn, _1));
     g_signals.BlockChecked.disconnect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
@@ -52,6 +177,7 @@ void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
     g_signals.NotifyGovernanceVote.disconnect(boost::bind(&CValidationInterface::NotifyGovernanceVote, pwalletIn, _1));
     g_signals.NotifyInstantSendDoubleSpendAttempt.disconnect(boost::bind(&CValidationInterface::NotifyInstantSendDoubleSpendAttempt, pwalletIn, _1, _2));
     g_signals.NotifyMasternodeListChanged.disconnect(boost::bind(&CValidationInterface::NotifyMasternodeListChanged, pwalletIn, _1, _2, _3));
+    g_signals.NotifyIPFSPinEvent.disconnect(boost::bind(&CValidationInterface::NotifyIPFSPinEvent, pwalletIn, _1));
 }
 
 void UnregisterAllValidationInterfaces() {
@@ -73,4 +199,10 @@ void UnregisterAllValidationInterfaces() {
     g_signals.NotifyGovernanceVote.disconnect_all_slots();
     g_signals.NotifyInstantSendDoubleSpendAttempt.disconnect_all_slots();
     g_signals.NotifyMasternodeListChanged.disconnect_all_slots();
+    g_signals.NotifyIPFSPinEvent.disconnect_all_slots();
+
+    for (const auto& p : mapQueuedInterfaces) {
+        p.second->EmptyQueue();
+    }
+    mapQueuedInterfaces.clear();
 }
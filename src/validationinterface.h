@@ -9,12 +9,14 @@
 #include <boost/signals2/signal.hpp>
 #include <boost/shared_ptr.hpp>
 #include <memory>
+#include <string>
 
 class CBlock;
 class CBlockIndex;
 struct CBlockLocator;
 class CConnman;
 class CReserveScript;
+class CScheduler;
 class CTransaction;
 class CValidationInterface;
 class CValidationState;
@@ -22,13 +24,21 @@ class CGovernanceVote;
 class CGovernanceObject;
 class CDeterministicMNList;
 class CDeterministicMNListDiff;
+struct CIPFSPinEvent;
 class uint256;
 
 // These functions dispatch to one or all registered wallets
 
 /** Register a wallet to receive updates from core */
 void RegisterValidationInterface(CValidationInterface* pwalletIn);
-/** Unregister a wallet from core */
+/**
+ * Register a listener whose notifications are queued and delivered in order on the threads of
+ * pscheduler, so a slow listener doesn't hold up validation. Notifications which return a result
+ * or need the caller's state (UpdatedTransaction, ResendWalletTransactions, BlockChecked and
+ * GetScriptForMining) are still delivered right away.
+ */
+void RegisterQueuedValidationInterface(CValidationInterface* pwalletIn, CScheduler* pscheduler, const std::string& strName);
+/** Unregister a wallet from core, a queued listener gets its pending notifications before this returns */
 void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 /** Unregister all wallets from core */
 void UnregisterAllValidationInterfaces();
@@ -45,6 +55,7 @@ protected:
     virtual void NotifyGovernanceObject(const CGovernanceObject &object) {}
     virtual void NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx) {}
     virtual void NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff) {}
+    virtual void NotifyIPFSPinEvent(const CIPFSPinEvent& event) {}
     virtual void SetBestChain(const CBlockLocator &locator) {}
     virtual bool UpdatedTransaction(const uint256 &hash) { return false;}
     virtual void Inventory(const uint256 &hash) {}
@@ -56,6 +67,7 @@ protected:
     friend void ::RegisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
+    friend class CQueuedValidationInterface;
 };
 
 struct CMainSignals {
@@ -88,6 +100,8 @@ struct CMainSignals {
     boost::signals2::signal<void(const CTransaction &currentTx, const CTransaction &previousTx)> NotifyInstantSendDoubleSpendAttempt;
     /** Notifies listeners that the MN list changed */
     boost::signals2::signal<void(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff)> NotifyMasternodeListChanged;
+    /** Notifies listeners that an IPFS pin worker pinned, unpinned or gave up on a CID */
+    boost::signals2::signal<void(const CIPFSPinEvent& event)> NotifyIPFSPinEvent;
     /** Notifies listeners of an updated transaction without new data (for now: a coinbase potentially becoming visible). */
     boost::signals2::signal<bool (const uint256 &)> UpdatedTransaction;
     /** Notifies listeners of a new active block chain. */
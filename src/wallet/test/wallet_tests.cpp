@@ -9,6 +9,7 @@
 #include <utility>
 #include <vector>
 
+#include "privatesend.h"
 #include "rpc/server.h"
 #include "test/test_historia.h"
 #include "validation.h"
@@ -513,6 +514,79 @@ BOOST_FIXTURE_TEST_CASE(coin_mark_dirty_immature_credit, TestChain100Setup)
     BOOST_CHECK_EQUAL(wtx.GetImmatureCredit(), 500*COIN);
 }
 
+BOOST_AUTO_TEST_CASE(wallet_utxo_index)
+{
+    CWallet wallet;
+    CKey key;
+    key.MakeNewKey(true);
+    LOCK2(cs_main, wallet.cs_wallet);
+    wallet.AddKeyPubKey(key, key.GetPubKey());
+    CScript scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    tx.vout.emplace_back(7 * COIN, scriptPubKey);
+    tx.vout.emplace_back(7 * COIN, scriptPubKey);
+    tx.vout.emplace_back(3 * COIN, scriptPubKey);
+    tx.vout.emplace_back(3 * COIN, CScript() << OP_TRUE);
+    wallet.AddToWallet(CWalletTx(&wallet, MakeTransactionRef(tx)));
+    BOOST_CHECK_EQUAL(wallet.CountInputsWithAmount(7 * COIN), 2);
+    BOOST_CHECK_EQUAL(wallet.CountInputsWithAmount(3 * COIN), 1);
+    BOOST_CHECK_EQUAL(wallet.CountInputsWithAmount(5 * COIN), 0);
+
+    CMutableTransaction txSpend;
+    txSpend.vin.emplace_back(tx.GetHash(), 1);
+    txSpend.vout.emplace_back(5 * COIN, CScript() << OP_TRUE);
+    wallet.AddToWallet(CWalletTx(&wallet, MakeTransactionRef(txSpend)));
+    BOOST_CHECK_EQUAL(wallet.CountInputsWithAmount(7 * COIN), 1);
+    BOOST_CHECK_EQUAL(wallet.CountInputsWithAmount(5 * COIN), 0);
+
+    // the spent output is available again when the spending tx is abandoned
+    BOOST_CHECK(wallet.AbandonTransaction(txSpend.GetHash()));
+    BOOST_CHECK_EQUAL(wallet.CountInputsWithAmount(7 * COIN), 2);
+}
+
+BOOST_AUTO_TEST_CASE(privatesend_rounds)
+{
+    CPrivateSend::InitStandardDenominations();
+    const CAmount nDenom = CPrivateSend::GetStandardDenominations().back();
+
+    CWallet wallet;
+    CKey key;
+    key.MakeNewKey(true);
+    LOCK2(cs_main, wallet.cs_wallet);
+    wallet.AddKeyPubKey(key, key.GetPubKey());
+    CScript scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+
+    auto addTx = [&](const COutPoint& prevout, bool fAllDenoms) {
+        CMutableTransaction tx;
+        tx.vin.emplace_back(prevout);
+        tx.vout.emplace_back(nDenom, scriptPubKey);
+        tx.vout.emplace_back(fAllDenoms ? nDenom : 3 * COIN, scriptPubKey);
+        wallet.AddToWallet(CWalletTx(&wallet, MakeTransactionRef(tx)));
+        return tx.GetHash();
+    };
+
+    uint256 hash0 = addTx(COutPoint(GetRandHash(), 0), false);
+    uint256 hash1 = addTx(COutPoint(hash0, 0), true);
+    uint256 hash2 = addTx(COutPoint(hash1, 0), true);
+    BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(hash2, 0)), 2);
+    BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(hash1, 1)), 1);
+    BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(hash0, 0)), 0);
+    BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(hash0, 1)), -2);
+    BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(GetRandHash(), 0)), -1);
+
+    // a tx arriving after the tx spending it invalidates the rounds of its descendants
+    CMutableTransaction txParent;
+    txParent.vin.emplace_back(COutPoint(GetRandHash(), 0));
+    txParent.vout.emplace_back(nDenom, scriptPubKey);
+    uint256 hashChild = addTx(COutPoint(txParent.GetHash(), 0), true);
+    BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(hashChild, 0)), 0);
+    wallet.AddToWallet(CWalletTx(&wallet, MakeTransactionRef(txParent)));
+    BOOST_CHECK_EQUAL(wallet.GetRealOutpointPrivateSendRounds(COutPoint(hashChild, 0)), 1);
+}
+
 static int64_t AddTx(CWallet& wallet, uint32_t lockTime, int64_t mockTime, int64_t blockTime)
 {
     CMutableTransaction tx;
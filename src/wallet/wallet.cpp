@@ -10,6 +10,7 @@
 #include "checkpoints.h"
 #include "chain.h"
 #include "wallet/coincontrol.h"
+#include "ctpl.h"
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
 #include "key.h"
@@ -27,6 +28,7 @@
 #include "util.h"
 #include "ui_interface.h"
 #include "utilmoneystr.h"
+#include "workerpool.h"
 
 #include "governance.h"
 #include "instantx.h"
@@ -41,6 +43,9 @@
 
 #include <assert.h>
 
+#include <deque>
+#include <future>
+
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/thread.hpp>
@@ -122,8 +127,9 @@ CPubKey CWallet::GenerateNewKey(uint32_t nAccountIndex, bool fInternal)
     CPubKey pubkey;
     // use HD key derivation if HD was enabled during wallet creation
     if (IsHDEnabled()) {
-        DeriveNewChildKey(metadata, secret, nAccountIndex, fInternal);
-        pubkey = secret.GetPubKey();
+        std::vector<CPubKey> vecPubKeys;
+        DeriveNewChildKeys(metadata, nAccountIndex, fInternal, 1, vecPubKeys);
+        pubkey = vecPubKeys[0];
     } else {
         secret.MakeNewKey(fCompressed);
 
@@ -144,8 +150,53 @@ CPubKey CWallet::GenerateNewKey(uint32_t nAccountIndex, bool fInternal)
     return pubkey;
 }
 
-void CWallet::DeriveNewChildKey(const CKeyMetadata& metadata, CKey& secretRet, uint32_t nAccountIndex, bool fInternal)
+// the worker pool is only used for batches of at least this many keys per job
+static const size_t MIN_HD_KEYS_PER_JOB = 64;
+
+// Derive the children [nFirstIndex, nFirstIndex + vecKeysRet.size()) of chainKey, split over the worker pool if possible
+static void DeriveChildExtPubKeys(const CExtKey& chainKey, uint32_t nFirstIndex, std::vector<CExtPubKey>& vecKeysRet)
+{
+    auto deriveRange = [&chainKey, nFirstIndex, &vecKeysRet](size_t nBegin, size_t nEnd) {
+        for (size_t i = nBegin; i < nEnd; i++) {
+            CExtKey childKey;
+            chainKey.Derive(childKey, nFirstIndex + i);
+            vecKeysRet[i] = childKey.Neuter();
+            assert(childKey.key.VerifyPubKey(vecKeysRet[i].pubkey));
+        }
+    };
+
+    const size_t nJobs = std::min<size_t>(g_workerPool.Size(), vecKeysRet.size() / MIN_HD_KEYS_PER_JOB);
+    if (nJobs <= 1) {
+        deriveRange(0, vecKeysRet.size());
+        return;
+    }
+
+    std::vector<std::future<void>> vFutures;
+    for (size_t i = 0; i < nJobs; i++) {
+        size_t nBegin = i * vecKeysRet.size() / nJobs;
+        size_t nEnd = (i + 1) * vecKeysRet.size() / nJobs;
+        vFutures.emplace_back(g_workerPool.Push([&deriveRange, nBegin, nEnd](int) {
+            deriveRange(nBegin, nEnd);
+        }));
+    }
+    // the jobs write into vecKeysRet, wait for all of them before get() can rethrow
+    for (auto& future : vFutures) {
+        future.wait();
+    }
+    for (auto& future : vFutures) {
+        future.get();
+    }
+}
+
+void CWallet::DeriveNewChildKeys(const CKeyMetadata& metadata, uint32_t nAccountIndex, bool fInternal, size_t nCount, std::vector<CPubKey>& vecPubKeysRet)
 {
+    AssertLockHeld(cs_wallet); // mapKeyMetadata
+
+    vecPubKeysRet.clear();
+    if (nCount == 0) {
+        return;
+    }
+
     CHDChain hdChainTmp;
     if (!GetHDChain(hdChainTmp)) {
         throw std::runtime_error(std::string(__func__) + ": GetHDChain failed");
@@ -161,22 +212,23 @@ void CWallet::DeriveNewChildKey(const CKeyMetadata& metadata, CKey& secretRet, u
     if (!hdChainTmp.GetAccount(nAccountIndex, acc))
         throw std::runtime_error(std::string(__func__) + ": Wrong HD account!");
 
-    // derive child key at next index, skip keys already known to the wallet
-    CExtKey childKey;
-    uint32_t nChildIndex = fInternal ? acc.nInternalChainCounter : acc.nExternalChainCounter;
-    do {
-        hdChainTmp.DeriveChildExtKey(nAccountIndex, fInternal, nChildIndex, childKey);
-        // increment childkey index
-        nChildIndex++;
-    } while (HaveKey(childKey.key.GetPubKey().GetID()));
-    secretRet = childKey.key;
+    // the hardened part of the path is derived once, the children are derived from the chain key
+    CExtKey chainKey;
+    hdChainTmp.DeriveChainExtKey(nAccountIndex, fInternal, chainKey);
 
-    CPubKey pubkey = secretRet.GetPubKey();
-    assert(secretRet.VerifyPubKey(pubkey));
-
-    // store metadata
-    mapKeyMetadata[pubkey.GetID()] = metadata;
-    UpdateTimeFirstKey(metadata.nCreateTime);
+    // derive child keys from the next index, skip keys already known to the wallet
+    std::vector<CExtPubKey> vecNewKeys;
+    uint32_t nChildIndex = fInternal ? acc.nInternalChainCounter : acc.nExternalChainCounter;
+    while (vecNewKeys.size() < nCount) {
+        std::vector<CExtPubKey> vecDerived(nCount - vecNewKeys.size());
+        DeriveChildExtPubKeys(chainKey, nChildIndex, vecDerived);
+        nChildIndex += vecDerived.size();
+        for (const auto& extPubKey : vecDerived) {
+            if (!HaveKey(extPubKey.pubkey.GetID())) {
+                vecNewKeys.emplace_back(extPubKey);
+            }
+        }
+    }
 
     // update the chain model in the database
     CHDChain hdChainCurrent;
@@ -201,8 +253,18 @@ void CWallet::DeriveNewChildKey(const CKeyMetadata& metadata, CKey& secretRet, u
             throw std::runtime_error(std::string(__func__) + ": SetHDChain failed");
     }
 
-    if (!AddHDPubKey(childKey.Neuter(), fInternal))
-        throw std::runtime_error(std::string(__func__) + ": AddHDPubKey failed");
+    // all keys go through the same batch, so the database is only flushed once
+    CWalletBatch walletdb(*this);
+    vecPubKeysRet.reserve(vecNewKeys.size());
+    for (const auto& extPubKey : vecNewKeys) {
+        // store metadata
+        mapKeyMetadata[extPubKey.pubkey.GetID()] = metadata;
+        UpdateTimeFirstKey(metadata.nCreateTime);
+
+        if (!AddHDPubKey(extPubKey, fInternal))
+            throw std::runtime_error(std::string(__func__) + ": AddHDPubKey failed");
+        vecPubKeysRet.emplace_back(extPubKey.pubkey);
+    }
 }
 
 bool CWallet::GetPubKey(const CKeyID &address, CPubKey& vchPubKeyOut) const
@@ -275,6 +337,7 @@ bool CWallet::AddHDPubKey(const CExtPubKey &extPubKey, bool fInternal)
     hdPubKey.hdchainID = hdChainCurrent.GetID();
     hdPubKey.nChangeIndex = fInternal ? 1 : 0;
     mapHdPubKeys[extPubKey.pubkey.GetID()] = hdPubKey;
+    nKeyStoreChanges++;
 
     // check if we need to remove from watch-only
     CScript script;
@@ -288,7 +351,7 @@ bool CWallet::AddHDPubKey(const CExtPubKey &extPubKey, bool fInternal)
     if (!fFileBacked)
         return true;
 
-    return CWalletDB(strWalletFile).WriteHDPubKey(hdPubKey, mapKeyMetadata[extPubKey.pubkey.GetID()]);
+    return CWalletBatch(*this)->WriteHDPubKey(hdPubKey, mapKeyMetadata[extPubKey.pubkey.GetID()]);
 }
 
 bool CWallet::AddKeyPubKey(const CKey& secret, const CPubKey &pubkey)
@@ -296,6 +359,7 @@ bool CWallet::AddKeyPubKey(const CKey& secret, const CPubKey &pubkey)
     AssertLockHeld(cs_wallet); // mapKeyMetadata
     if (!CCryptoKeyStore::AddKeyPubKey(secret, pubkey))
         return false;
+    nKeyStoreChanges++;
 
     // check if we need to remove from watch-only
     CScript script;
@@ -309,9 +373,9 @@ bool CWallet::AddKeyPubKey(const CKey& secret, const CPubKey &pubkey)
     if (!fFileBacked)
         return true;
     if (!IsCrypted()) {
-        return CWalletDB(strWalletFile).WriteKey(pubkey,
-                                                 secret.GetPrivKey(),
-                                                 mapKeyMetadata[pubkey.GetID()]);
+        return CWalletBatch(*this)->WriteKey(pubkey,
+                                             secret.GetPrivKey(),
+                                             mapKeyMetadata[pubkey.GetID()]);
     }
     return true;
 }
@@ -321,6 +385,7 @@ bool CWallet::AddCryptedKey(const CPubKey &vchPubKey,
 {
     if (!CCryptoKeyStore::AddCryptedKey(vchPubKey, vchCryptedSecret))
         return false;
+    nKeyStoreChanges++;
     if (!fFileBacked)
         return true;
     {
@@ -330,9 +395,9 @@ bool CWallet::AddCryptedKey(const CPubKey &vchPubKey,
                                                         vchCryptedSecret,
                                                         mapKeyMetadata[vchPubKey.GetID()]);
         else
-            return CWalletDB(strWalletFile).WriteCryptedKey(vchPubKey,
-                                                            vchCryptedSecret,
-                                                            mapKeyMetadata[vchPubKey.GetID()]);
+            return CWalletBatch(*this)->WriteCryptedKey(vchPubKey,
+                                                        vchCryptedSecret,
+                                                        mapKeyMetadata[vchPubKey.GetID()]);
     }
     return false;
 }
@@ -366,6 +431,7 @@ bool CWallet::AddCScript(const CScript& redeemScript)
 {
     if (!CCryptoKeyStore::AddCScript(redeemScript))
         return false;
+    nKeyStoreChanges++;
     if (!fFileBacked)
         return true;
     return CWalletDB(strWalletFile).WriteCScript(Hash160(redeemScript), redeemScript);
@@ -391,6 +457,7 @@ bool CWallet::AddWatchOnly(const CScript& dest)
 {
     if (!CCryptoKeyStore::AddWatchOnly(dest))
         return false;
+    nKeyStoreChanges++;
     const CKeyMetadata& meta = mapKeyMetadata[CScriptID(dest)];
     UpdateTimeFirstKey(meta.nCreateTime);
     NotifyWatchonlyChanged(true);
@@ -564,11 +631,12 @@ bool CWallet::SetMinVersion(enum WalletFeature nVersion, CWalletDB* pwalletdbIn,
 
     if (fFileBacked)
     {
-        CWalletDB* pwalletdb = pwalletdbIn ? pwalletdbIn : new CWalletDB(strWalletFile);
-        if (nWalletVersion > 40000)
-            pwalletdb->WriteMinVersion(nWalletVersion);
-        if (!pwalletdbIn)
-            delete pwalletdb;
+        if (nWalletVersion > 40000) {
+            if (pwalletdbIn)
+                pwalletdbIn->WriteMinVersion(nWalletVersion);
+            else
+                CWalletBatch(*this)->WriteMinVersion(nWalletVersion);
+        }
     }
 
     return true;
@@ -709,7 +777,7 @@ bool CWallet::IsSpent(const uint256& hash, unsigned int n) const
 void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
     mapTxSpends.insert(std::make_pair(outpoint, wtxid));
-    setWalletUTXO.erase(outpoint);
+    EraseWalletUTXO(outpoint);
 
     std::pair<TxSpends::iterator, TxSpends::iterator> range;
     range = mapTxSpends.equal_range(outpoint);
@@ -717,6 +785,75 @@ void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 }
 
 
+void CWallet::AddWalletUTXO(const COutPoint& outpoint, CAmount nValue)
+{
+    AssertLockHeld(cs_wallet);
+    if (setWalletUTXO.insert(outpoint).second) {
+        mapWalletUTXOByAmount[nValue].insert(outpoint);
+    }
+}
+
+void CWallet::EraseWalletUTXO(const COutPoint& outpoint)
+{
+    AssertLockHeld(cs_wallet);
+    if (!setWalletUTXO.erase(outpoint)) {
+        return;
+    }
+    auto itTx = mapWallet.find(outpoint.hash);
+    auto itBucket = itTx != mapWallet.end() && outpoint.n < itTx->second.tx->vout.size() ?
+                    mapWalletUTXOByAmount.find(itTx->second.tx->vout[outpoint.n].nValue) : mapWalletUTXOByAmount.end();
+    if (itBucket == mapWalletUTXOByAmount.end() || !itBucket->second.count(outpoint)) {
+        // the tx is gone already, look through all buckets
+        itBucket = std::find_if(mapWalletUTXOByAmount.begin(), mapWalletUTXOByAmount.end(),
+                                [&](const std::pair<const CAmount, std::set<COutPoint> >& p) { return p.second.count(outpoint) != 0; });
+        if (itBucket == mapWalletUTXOByAmount.end()) {
+            return;
+        }
+    }
+    itBucket->second.erase(outpoint);
+    if (itBucket->second.empty()) {
+        mapWalletUTXOByAmount.erase(itBucket);
+    }
+}
+
+bool CWallet::GetWalletUTXOsByCoinType(AvailableCoinsType nCoinType, std::map<uint256, std::vector<unsigned int> >& mapRet) const
+{
+    AssertLockHeld(cs_wallet);
+
+    std::vector<std::pair<CAmount, CAmount> > vecRanges;
+    switch (nCoinType) {
+    case ONLY_DENOMINATED:
+        for (const auto& nDenomValue : CPrivateSend::GetStandardDenominations()) {
+            vecRanges.emplace_back(nDenomValue, nDenomValue);
+        }
+        break;
+    case ONLY_100:
+        vecRanges.emplace_back(100 * COIN, 100 * COIN);
+        break;
+    case ONLY_5000:
+        vecRanges.emplace_back(5000 * COIN, 5000 * COIN);
+        break;
+    case ONLY_PRIVATESEND_COLLATERAL:
+        vecRanges.emplace_back(CPrivateSend::GetCollateralAmount(), CPrivateSend::GetMaxCollateralAmount());
+        break;
+    default:
+        return false;
+    }
+
+    mapRet.clear();
+    for (const auto& range : vecRanges) {
+        for (auto it = mapWalletUTXOByAmount.lower_bound(range.first); it != mapWalletUTXOByAmount.end() && it->first <= range.second; ++it) {
+            for (const auto& outpoint : it->second) {
+                mapRet[outpoint.hash].emplace_back(outpoint.n);
+            }
+        }
+    }
+    for (auto& p : mapRet) {
+        std::sort(p.second.begin(), p.second.end());
+    }
+    return true;
+}
+
 void CWallet::AddToSpends(const uint256& wtxid)
 {
     assert(mapWallet.count(wtxid));
@@ -1030,13 +1167,14 @@ void CWallet::MarkDirty()
 
     fAnonymizableTallyCached = false;
     fAnonymizableTallyCachedNonDenom = false;
+    MarkBalancesDirty();
 }
 
 bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
 {
     LOCK(cs_wallet);
 
-    CWalletDB walletdb(strWalletFile, "r+", fFlushOnClose);
+    CWalletBatch walletdb(*this, fFlushOnClose);
 
     uint256 hash = wtxIn.GetHash();
 
@@ -1048,20 +1186,31 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
     if (fInsertedNew)
     {
         wtx.nTimeReceived = GetAdjustedTime();
-        wtx.nOrderPos = IncOrderPosNext(&walletdb);
+        wtx.nOrderPos = IncOrderPosNext(&*walletdb);
         wtxOrdered.insert(std::make_pair(wtx.nOrderPos, TxPair(&wtx, (CAccountingEntry*)0)));
         wtx.nTimeSmart = ComputeTimeSmart(wtx);
         AddToSpends(hash);
+        if (mapTxSpends.lower_bound(COutPoint(hash, 0)) != mapTxSpends.end() && mapTxSpends.lower_bound(COutPoint(hash, 0))->first.hash == hash) {
+            // spent by txes we already know, the rounds of those have been calculated without this tx
+            InvalidatePrivateSendRounds(hash);
+        }
 
         auto mnList = deterministicMNManager->GetListAtChainTip();
         for(unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
             if (IsMine(wtx.tx->vout[i]) && !IsSpent(hash, i)) {
-                setWalletUTXO.insert(COutPoint(hash, i));
+                AddWalletUTXO(COutPoint(hash, i), wtx.tx->vout[i].nValue);
                 if (deterministicMNManager->IsProTxWithCollateral(wtx.tx, i) || mnList.HasMNByCollateral(COutPoint(hash, i))) {
                     LockCoin(COutPoint(hash, i));
                 }
             }
         }
+    } else {
+        // outputs can become ours after the tx was added, e.g. when rescanning after a key import
+        for(unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
+            if (!setWalletUTXO.count(COutPoint(hash, i)) && IsMine(wtx.tx->vout[i]) && !IsSpent(hash, i)) {
+                AddWalletUTXO(COutPoint(hash, i), wtx.tx->vout[i].nValue);
+            }
+        }
     }
 
     bool fUpdated = false;
@@ -1096,7 +1245,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
 
     // Write to disk
     if (fInsertedNew || fUpdated)
-        if (!walletdb.WriteTx(wtx))
+        if (!walletdb->WriteTx(wtx))
             return false;
 
     // Break debit/credit balance caches:
@@ -1236,8 +1385,13 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
             // available of the outputs it spends. So force those to be recomputed
             BOOST_FOREACH(const CTxIn& txin, wtx.tx->vin)
             {
-                if (mapWallet.count(txin.prevout.hash))
-                    mapWallet[txin.prevout.hash].MarkDirty();
+                if (mapWallet.count(txin.prevout.hash)) {
+                    CWalletTx& prevtx = mapWallet[txin.prevout.hash];
+                    prevtx.MarkDirty();
+                    if (txin.prevout.n < prevtx.tx->vout.size() && IsMine(prevtx.tx->vout[txin.prevout.n]) && !IsSpent(txin.prevout.hash, txin.prevout.n)) {
+                        AddWalletUTXO(txin.prevout, prevtx.tx->vout[txin.prevout.n].nValue);
+                    }
+                }
             }
         }
     }
@@ -1300,8 +1454,13 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
             // available of the outputs it spends. So force those to be recomputed
             BOOST_FOREACH(const CTxIn& txin, wtx.tx->vin)
             {
-                if (mapWallet.count(txin.prevout.hash))
-                    mapWallet[txin.prevout.hash].MarkDirty();
+                if (mapWallet.count(txin.prevout.hash)) {
+                    CWalletTx& prevtx = mapWallet[txin.prevout.hash];
+                    prevtx.MarkDirty();
+                    if (txin.prevout.n < prevtx.tx->vout.size() && IsMine(prevtx.tx->vout[txin.prevout.n]) && !IsSpent(txin.prevout.hash, txin.prevout.n)) {
+                        AddWalletUTXO(txin.prevout, prevtx.tx->vout[txin.prevout.n].nValue);
+                    }
+                }
             }
         }
     }
@@ -1365,85 +1524,131 @@ CAmount CWallet::GetDebit(const CTxIn &txin, const isminefilter& filter) const
 }
 
 // Recursively determine the rounds of a given input (How deep is the PrivateSend chain for a given input)
-int CWallet::GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRounds) const
+int CWallet::GetRealOutpointPrivateSendRounds(const COutPoint& outpoint) const
 {
-    static std::map<uint256, CMutableTransaction> mDenomWtxes;
+    LOCK(cs_wallet);
 
-    if(nRounds >= MAX_PRIVATESEND_ROUNDS) {
-        // there can only be MAX_PRIVATESEND_ROUNDS rounds max
-        return MAX_PRIVATESEND_ROUNDS - 1;
+    auto itCache = mapOutpointRoundsCache.find(outpoint);
+    if (itCache != mapOutpointRoundsCache.end()) {
+        return itCache->second;
+    }
+    if (GetWalletTx(outpoint.hash) == NULL) {
+        return -1;
     }
 
-    uint256 hash = outpoint.hash;
-    unsigned int nout = outpoint.n;
-
-    const CWalletTx* wtx = GetWalletTx(hash);
-    if(wtx != NULL)
-    {
-        std::map<uint256, CMutableTransaction>::const_iterator mdwi = mDenomWtxes.find(hash);
-        if (mdwi == mDenomWtxes.end()) {
-            // not known yet, let's add it
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds INSERTING %s\n", hash.ToString());
-            mDenomWtxes[hash] = CMutableTransaction(*wtx);
-        } else if(mDenomWtxes[hash].vout[nout].nRounds != -10) {
-            // found and it's not an initial value, just return it
-            return mDenomWtxes[hash].vout[nout].nRounds;
+    // Walk the denominated ancestors depth first, an outpoint is calculated once the rounds of all its inputs are
+    // known. Every outpoint is calculated only once, no matter how many descendants it has.
+    std::vector<std::pair<COutPoint, int> > vecCalculated;
+    std::vector<COutPoint> vecStack{outpoint};
+    while (!vecStack.empty()) {
+        const COutPoint cur = vecStack.back();
+        if (mapOutpointRoundsCache.count(cur)) {
+            vecStack.pop_back();
+            continue;
         }
 
-
-        // bounds check
-        if (nout >= wtx->tx->vout.size()) {
+        const CWalletTx* wtx = GetWalletTx(cur.hash);
+        assert(wtx != NULL);
+        int nRounds;
+        if (cur.n >= wtx->tx->vout.size()) {
             // should never actually hit this
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, -4);
-            return -4;
-        }
+            nRounds = -4;
+        } else if (CPrivateSend::IsCollateralAmount(wtx->tx->vout[cur.n].nValue)) {
+            nRounds = -3;
+        } else if (!CPrivateSend::IsDenominatedAmount(wtx->tx->vout[cur.n].nValue)) {
+            //make sure the final output is non-denominate
+            nRounds = -2;
+        } else {
+            bool fAllDenoms = true;
+            for (const auto& out : wtx->tx->vout) {
+                fAllDenoms = fAllDenoms && CPrivateSend::IsDenominatedAmount(out.nValue);
+            }
 
-        if (CPrivateSend::IsCollateralAmount(wtx->tx->vout[nout].nValue)) {
-            mDenomWtxes[hash].vout[nout].nRounds = -3;
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
+            if (!fAllDenoms) {
+                // this one is denominated but there is another non-denominated output found in the same tx
+                nRounds = 0;
+            } else {
+                // only denoms here so let's look up the inputs, IsMine makes sure they are in the wallet
+                int nShortest = -10; // an initial value, should be no way to get this by calculations
+                bool fMissingInputs = false;
+                for (const auto& txinNext : wtx->tx->vin) {
+                    if (!IsMine(txinNext)) {
+                        continue;
+                    }
+                    auto itInput = mapOutpointRoundsCache.find(txinNext.prevout);
+                    if (itInput == mapOutpointRoundsCache.end()) {
+                        vecStack.emplace_back(txinNext.prevout);
+                        fMissingInputs = true;
+                        continue;
+                    }
+                    // denom found, find the shortest chain or initially assign nShortest with the first found value
+                    int n = itInput->second;
+                    if (n >= 0 && (n < nShortest || nShortest == -10)) {
+                        nShortest = n;
+                    }
+                }
+                if (fMissingInputs) {
+                    continue;
+                }
+                nRounds = nShortest != -10
+                        ? std::min(nShortest + 1, MAX_PRIVATESEND_ROUNDS) // good, we a +1 to the shortest one but only MAX_PRIVATESEND_ROUNDS rounds max allowed
+                        : 0;            // too bad, we are the fist one in that chain
+            }
         }
 
-        //make sure the final output is non-denominate
-        if (!CPrivateSend::IsDenominatedAmount(wtx->tx->vout[nout].nValue)) { //NOT DENOM
-            mDenomWtxes[hash].vout[nout].nRounds = -2;
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
-        }
+        vecStack.pop_back();
+        mapOutpointRoundsCache.emplace(cur, nRounds);
+        vecCalculated.emplace_back(cur, nRounds);
+        LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", cur.hash.ToString(), cur.n, nRounds);
+    }
 
-        bool fAllDenoms = true;
-        for (const auto& out : wtx->tx->vout) {
-            fAllDenoms = fAllDenoms && CPrivateSend::IsDenominatedAmount(out.nValue);
+    if (fFileBacked) {
+        CWalletDB walletdb(strWalletFile);
+        for (const auto& p : vecCalculated) {
+            walletdb.WritePrivateSendRounds(p.first, p.second);
         }
+    }
 
-        // this one is denominated but there is another non-denominated output found in the same tx
-        if (!fAllDenoms) {
-            mDenomWtxes[hash].vout[nout].nRounds = 0;
-            LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
-        }
+    return mapOutpointRoundsCache.at(outpoint);
+}
 
-        int nShortest = -10; // an initial value, should be no way to get this by calculations
-        bool fDenomFound = false;
-        // only denoms here so let's look up
-        for (const auto& txinNext : wtx->tx->vin) {
-            if (IsMine(txinNext)) {
-                int n = GetRealOutpointPrivateSendRounds(txinNext.prevout, nRounds + 1);
-                // denom found, find the shortest chain or initially assign nShortest with the first found value
-                if(n >= 0 && (n < nShortest || nShortest == -10)) {
-                    nShortest = n;
-                    fDenomFound = true;
-                }
-            }
+bool CWallet::LoadPrivateSendRounds(const COutPoint& outpoint, int nRounds)
+{
+    AssertLockHeld(cs_wallet);
+    mapOutpointRoundsCache[outpoint] = nRounds;
+    return true;
+}
+
+void CWallet::InvalidatePrivateSendRounds(const uint256& hashTx)
+{
+    AssertLockHeld(cs_wallet);
+
+    // the rounds of all descendants depend on the rounds of the outputs of this tx
+    std::vector<COutPoint> vecErased;
+    std::set<uint256> setDone;
+    std::vector<uint256> vecTodo{hashTx};
+    while (!vecTodo.empty()) {
+        uint256 hash = vecTodo.back();
+        vecTodo.pop_back();
+        if (!setDone.emplace(hash).second) {
+            continue;
+        }
+        auto it = mapOutpointRoundsCache.lower_bound(COutPoint(hash, 0));
+        while (it != mapOutpointRoundsCache.end() && it->first.hash == hash) {
+            vecErased.emplace_back(it->first);
+            it = mapOutpointRoundsCache.erase(it);
+        }
+        for (auto itSpend = mapTxSpends.lower_bound(COutPoint(hash, 0)); itSpend != mapTxSpends.end() && itSpend->first.hash == hash; ++itSpend) {
+            vecTodo.emplace_back(itSpend->second);
         }
-        mDenomWtxes[hash].vout[nout].nRounds = fDenomFound
-                ? (nShortest >= MAX_PRIVATESEND_ROUNDS - 1 ? MAX_PRIVATESEND_ROUNDS : nShortest + 1) // good, we a +1 to the shortest one but only MAX_PRIVATESEND_ROUNDS rounds max allowed
-                : 0;            // too bad, we are the fist one in that chain
-        LogPrint("privatesend", "GetRealOutpointPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-        return mDenomWtxes[hash].vout[nout].nRounds;
     }
 
-    return nRounds - 1;
+    if (fFileBacked && !vecErased.empty()) {
+        CWalletDB walletdb(strWalletFile);
+        for (const auto& outpoint : vecErased) {
+            walletdb.ErasePrivateSendRounds(outpoint);
+        }
+    }
 }
 
 // respect current settings
@@ -1555,7 +1760,7 @@ bool CWallet::SetHDChain(const CHDChain& chain, bool memonly)
     if (!CCryptoKeyStore::SetHDChain(chain))
         return false;
 
-    if (!memonly && !CWalletDB(strWalletFile).WriteHDChain(chain))
+    if (!memonly && !CWalletBatch(*this)->WriteHDChain(chain))
         throw std::runtime_error(std::string(__func__) + ": WriteHDChain failed");
 
     return true;
@@ -1575,7 +1780,7 @@ bool CWallet::SetCryptedHDChain(const CHDChain& chain, bool memonly)
             if (!pwalletdbEncryption->WriteCryptedHDChain(chain))
                 throw std::runtime_error(std::string(__func__) + ": WriteCryptedHDChain failed");
         } else {
-            if (!CWalletDB(strWalletFile).WriteCryptedHDChain(chain))
+            if (!CWalletBatch(*this)->WriteCryptedHDChain(chain))
                 throw std::runtime_error(std::string(__func__) + ": WriteCryptedHDChain failed");
         }
     }
@@ -1825,21 +2030,131 @@ void CWalletTx::GetAccountAmounts(const std::string& strAccount, CAmount& nRecei
  * successfully scanned.
  *
  */
+/**
+ * Conservative filter for the outputs of blocks read ahead during a rescan. It only matches scripts against
+ * a snapshot of the keys and scripts of the wallet, so it can run without cs_wallet. A script which might be
+ * IsMine always matches, IsMine decides when the tx is applied.
+ */
+class CRescanScriptFilter
+{
+public:
+    std::set<CKeyID> setKeyIDs;
+    std::set<CScriptID> setScriptIDs;
+    std::set<CScript> setWatchOnly;
+
+    bool MaybeMine(const CScript& scriptPubKey) const
+    {
+        if (setWatchOnly.count(scriptPubKey)) {
+            return true;
+        }
+        txnouttype whichType;
+        std::vector<std::vector<unsigned char> > vSolutions;
+        if (!Solver(scriptPubKey, whichType, vSolutions)) {
+            return false;
+        }
+        switch (whichType) {
+        case TX_PUBKEY:
+            return setKeyIDs.count(CPubKey(vSolutions[0]).GetID()) != 0;
+        case TX_PUBKEYHASH:
+            return setKeyIDs.count(CKeyID(uint160(vSolutions[0]))) != 0;
+        case TX_SCRIPTHASH:
+            return setScriptIDs.count(CScriptID(uint160(vSolutions[0]))) != 0;
+        case TX_MULTISIG:
+            // keys are in between the required and total key counts
+            for (size_t i = 1; i + 1 < vSolutions.size(); i++) {
+                if (setKeyIDs.count(CPubKey(vSolutions[i]).GetID())) {
+                    return true;
+                }
+            }
+            return false;
+        default:
+            return false;
+        }
+    }
+};
+
+struct CRescanBlock
+{
+    bool fRead{false};
+    CBlock block;
+    // for each tx, whether one of its outputs might be ours
+    std::vector<char> vMaybeMine;
+};
+
 CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
 {
     CBlockIndex* ret = nullptr;
     int64_t nNow = GetTime();
     const CChainParams& chainParams = Params();
+    const Consensus::Params& consensusParams = chainParams.GetConsensus();
 
     CBlockIndex* pindex = pindexStart;
     {
         LOCK2(cs_main, cs_wallet);
+        CWalletBatch walletdb(*this, false);
 
         // no need to read and scan block, if block was created before
         // our wallet birthday (as adjusted for block time variability)
         while (pindex && nTimeFirstKey && (pindex->GetBlockTime() < (nTimeFirstKey - TIMESTAMP_WINDOW)))
             pindex = chainActive.Next(pindex);
 
+        // Blocks are read and filtered ahead on worker threads, the txes are applied in order on this thread.
+        // Workers only see a snapshot of the keys, blocks filtered before the keys changed are fully checked here.
+        int nThreads = std::max(0, (int)GetArg("-rescanthreads", DEFAULT_RESCAN_THREADS));
+        ctpl::thread_pool workerPool(nThreads);
+        if (nThreads != 0) {
+            RenameThreadPool(workerPool, "historia-rescan");
+        }
+        std::shared_ptr<const CRescanScriptFilter> filter;
+        uint64_t nFilterKeyStoreChanges = 0;
+        auto makeFilter = [&]() {
+            auto newFilter = std::make_shared<CRescanScriptFilter>();
+            GetKeys(newFilter->setKeyIDs);
+            for (const auto& p : mapHdPubKeys) {
+                newFilter->setKeyIDs.emplace(p.first);
+            }
+            {
+                LOCK(cs_KeyStore);
+                for (const auto& p : mapScripts) {
+                    newFilter->setScriptIDs.emplace(p.first);
+                }
+                newFilter->setWatchOnly = setWatchOnly;
+            }
+            filter = newFilter;
+            nFilterKeyStoreChanges = nKeyStoreChanges;
+        };
+
+        std::deque<std::pair<CBlockIndex*, std::future<std::shared_ptr<CRescanBlock> > > > dequePrefetched;
+        CBlockIndex* pindexPrefetch = pindex;
+        auto prefetch = [&]() {
+            if (nFilterKeyStoreChanges != nKeyStoreChanges || !filter) {
+                makeFilter();
+            }
+            while (pindexPrefetch && dequePrefetched.size() < (size_t)RESCAN_PREFETCH_BLOCKS) {
+                CDiskBlockPos pos = pindexPrefetch->GetBlockPos();
+                uint256 blockHash = pindexPrefetch->GetBlockHash();
+                std::shared_ptr<const CRescanScriptFilter> blockFilter = filter;
+                dequePrefetched.emplace_back(pindexPrefetch, workerPool.push([pos, blockHash, blockFilter, &consensusParams](int threadId) {
+                    auto result = std::make_shared<CRescanBlock>();
+                    if (!ReadBlockFromDisk(result->block, pos, consensusParams) || result->block.GetHash() != blockHash) {
+                        return result;
+                    }
+                    result->fRead = true;
+                    result->vMaybeMine.resize(result->block.vtx.size());
+                    for (size_t i = 0; i < result->block.vtx.size(); i++) {
+                        for (const auto& txout : result->block.vtx[i]->vout) {
+                            if (blockFilter->MaybeMine(txout.scriptPubKey)) {
+                                result->vMaybeMine[i] = true;
+                                break;
+                            }
+                        }
+                    }
+                    return result;
+                }));
+                pindexPrefetch = chainActive.Next(pindexPrefetch);
+            }
+        };
+
         ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
         double dProgressStart = GuessVerificationProgress(chainParams.TxData(), pindex);
         double dProgressTip = GuessVerificationProgress(chainParams.TxData(), chainActive.Tip());
@@ -1852,10 +2167,32 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool f
                 LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
             }
 
-            CBlock block;
-            if (ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            std::shared_ptr<CRescanBlock> rescanBlock;
+            bool fFiltered = false;
+            if (nThreads != 0) {
+                prefetch();
+                assert(!dequePrefetched.empty() && dequePrefetched.front().first == pindex);
+                rescanBlock = dequePrefetched.front().second.get();
+                dequePrefetched.pop_front();
+                // the keys didn't change since the block was filtered
+                fFiltered = nFilterKeyStoreChanges == nKeyStoreChanges;
+            } else {
+                rescanBlock = std::make_shared<CRescanBlock>();
+                rescanBlock->fRead = ReadBlockFromDisk(rescanBlock->block, pindex, consensusParams);
+            }
+
+            if (rescanBlock->fRead) {
+                const CBlock& block = rescanBlock->block;
                 for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                    AddToWalletIfInvolvingMe(*block.vtx[posInBlock], pindex, posInBlock, fUpdate);
+                    const CTransaction& tx = *block.vtx[posInBlock];
+                    bool fCheck = !fFiltered || rescanBlock->vMaybeMine[posInBlock] || mapWallet.count(tx.GetHash());
+                    for (size_t i = 0; i < tx.vin.size() && !fCheck; i++) {
+                        // spends or conflicts with one of our txes
+                        fCheck = mapWallet.count(tx.vin[i].prevout.hash) || mapTxSpends.count(tx.vin[i].prevout);
+                    }
+                    if (fCheck) {
+                        AddToWalletIfInvolvingMe(tx, pindex, posInBlock, fUpdate);
+                    }
                 }
                 if (!ret) {
                     ret = pindex;
@@ -2192,6 +2529,25 @@ bool CWalletTx::InMempool() const
     return false;
 }
 
+void CWalletTx::MarkDirty()
+{
+    fCreditCached = false;
+    fAvailableCreditCached = false;
+    fImmatureCreditCached = false;
+    fAnonymizedCreditCached = false;
+    fDenomUnconfCreditCached = false;
+    fDenomConfCreditCached = false;
+    fWatchDebitCached = false;
+    fWatchCreditCached = false;
+    fAvailableWatchCreditCached = false;
+    fImmatureWatchCreditCached = false;
+    fDebitCached = false;
+    fChangeCached = false;
+    if (pwallet) {
+        pwallet->MarkBalancesDirty();
+    }
+}
+
 bool CWalletTx::IsTrusted() const
 {
     // Quick answer in most cases
@@ -2292,41 +2648,110 @@ void CWallet::ResendWalletTransactions(int64_t nBestBlockTime, CConnman* connman
  */
 
 
-CAmount CWallet::GetBalance() const
+const CWallet::CachedBalances& CWallet::GetCachedBalances() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-                nTotal += pcoin->GetAvailableCredit();
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    uint64_t nChanges = nBalanceChanges;
+    uint256 tipHash = chainActive.Tip() ? chainActive.Tip()->GetBlockHash() : uint256();
+    if (cachedBalances.fValid && cachedBalances.nBalanceChanges == nChanges && cachedBalances.tipHash == tipHash &&
+            cachedBalances.nPrivateSendRounds == privateSendClient.nPrivateSendRounds) {
+        return cachedBalances;
+    }
+
+    CachedBalances balances;
+    balances.fValid = true;
+    balances.nBalanceChanges = nChanges;
+    balances.tipHash = tipHash;
+    balances.nPrivateSendRounds = privateSendClient.nPrivateSendRounds;
+
+    for (const auto& pair : mapWallet) {
+        const CWalletTx& wtx = pair.second;
+        if (wtx.IsTrusted()) {
+            balances.nTrusted += wtx.GetAvailableCredit();
+            balances.nWatchOnlyTrusted += wtx.GetAvailableWatchOnlyCredit();
+        } else if (wtx.GetDepthInMainChain() == 0 && !wtx.IsLockedByInstantSend() && wtx.InMempool()) {
+            balances.nUnconfirmed += wtx.GetAvailableCredit();
+            balances.nWatchOnlyUnconfirmed += wtx.GetAvailableWatchOnlyCredit();
+        }
+        balances.nImmature += wtx.GetImmatureCredit();
+        balances.nWatchOnlyImmature += wtx.GetImmatureWatchOnlyCredit();
+    }
+
+    if (!fLiteMode) {
+        int nRoundsTotal = 0;
+        int nRoundsCount = 0;
+        std::set<uint256> setWalletTxesCounted;
+        for (const auto& outpoint : setWalletUTXO) {
+            const auto it = mapWallet.find(outpoint.hash);
+            if (it == mapWallet.end()) continue;
+            const CWalletTx& wtx = it->second;
+
+            if (setWalletTxesCounted.emplace(outpoint.hash).second) {
+                if (wtx.IsTrusted()) {
+                    balances.nAnonymized += wtx.GetAnonymizedCredit();
+                }
+                balances.nDenominatedConfirmed += wtx.GetDenominatedCredit(false);
+                balances.nDenominatedUnconfirmed += wtx.GetDenominatedCredit(true);
+            }
+
+            // Note: rounds are calculated including unconfirmed,
+            // that's ok as long as we use them for informational purposes only
+            CAmount nValue = wtx.tx->vout[outpoint.n].nValue;
+            if (!CPrivateSend::IsDenominatedAmount(nValue)) continue;
+            int nRounds = GetCappedOutpointPrivateSendRounds(outpoint);
+            nRoundsTotal += nRounds;
+            nRoundsCount++;
+            if (wtx.GetDepthInMainChain() >= 0) {
+                balances.nNormalizedAnonymized += nValue * nRounds / privateSendClient.nPrivateSendRounds;
+            }
+        }
+        if (nRoundsCount > 0) {
+            balances.nAverageAnonymizedRounds = (float)nRoundsTotal / nRoundsCount;
         }
     }
 
-    return nTotal;
+    cachedBalances = std::move(balances);
+    return cachedBalances;
+}
+
+CAmount CWallet::GetBalance() const
+{
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalances().nTrusted;
 }
 
 CAmount CWallet::GetAnonymizableBalance(bool fSkipDenominated, bool fSkipUnconfirmed) const
 {
     if(fLiteMode) return 0;
 
-    std::vector<CompactTallyItem> vecTally;
-    if(!SelectCoinsGroupedByAddresses(vecTally, fSkipDenominated, true, fSkipUnconfirmed)) return 0;
+    LOCK2(cs_main, cs_wallet);
+
+    // validates the cache, the anonymizable balances are dropped together with the other balances
+    GetCachedBalances();
+    const auto key = std::make_pair(fSkipDenominated, fSkipUnconfirmed);
+    const auto it = cachedBalances.mapAnonymizable.find(key);
+    if (it != cachedBalances.mapAnonymizable.end()) {
+        return it->second;
+    }
 
     CAmount nTotal = 0;
 
-    const CAmount nSmallestDenom = CPrivateSend::GetSmallestDenomination();
-    const CAmount nMixingCollateral = CPrivateSend::GetCollateralAmount();
-    for (const auto& item : vecTally) {
-        bool fIsDenominated = CPrivateSend::IsDenominatedAmount(item.nAmount);
-        if(fSkipDenominated && fIsDenominated) continue;
-        // assume that the fee to create denoms should be mixing collateral at max
-        if(item.nAmount >= nSmallestDenom + (fIsDenominated ? 0 : nMixingCollateral))
-            nTotal += item.nAmount;
+    std::vector<CompactTallyItem> vecTally;
+    if(SelectCoinsGroupedByAddresses(vecTally, fSkipDenominated, true, fSkipUnconfirmed)) {
+        const CAmount nSmallestDenom = CPrivateSend::GetSmallestDenomination();
+        const CAmount nMixingCollateral = CPrivateSend::GetCollateralAmount();
+        for (const auto& item : vecTally) {
+            bool fIsDenominated = CPrivateSend::IsDenominatedAmount(item.nAmount);
+            if(fSkipDenominated && fIsDenominated) continue;
+            // assume that the fee to create denoms should be mixing collateral at max
+            if(item.nAmount >= nSmallestDenom + (fIsDenominated ? 0 : nMixingCollateral))
+                nTotal += item.nAmount;
+        }
     }
 
+    cachedBalances.mapAnonymizable.emplace(key, nTotal);
     return nTotal;
 }
 
@@ -2334,163 +2759,63 @@ CAmount CWallet::GetAnonymizedBalance() const
 {
     if(fLiteMode) return 0;
 
-    CAmount nTotal = 0;
-
     LOCK2(cs_main, cs_wallet);
-
-    std::set<uint256> setWalletTxesCounted;
-    for (const auto& outpoint : setWalletUTXO) {
-
-        if (!setWalletTxesCounted.emplace(outpoint.hash).second) continue;
-
-        const auto it = mapWallet.find(outpoint.hash);
-        if (it == mapWallet.end() || !it->second.IsTrusted()) continue;
-
-        nTotal += it->second.GetAnonymizedCredit();
-    }
-
-    return nTotal;
+    return GetCachedBalances().nAnonymized;
 }
 
-// Note: calculated including unconfirmed,
-// that's ok as long as we use it for informational purposes only
 float CWallet::GetAverageAnonymizedRounds() const
 {
     if(fLiteMode) return 0;
 
-    int nTotal = 0;
-    int nCount = 0;
-
     LOCK2(cs_main, cs_wallet);
-    for (const auto& outpoint : setWalletUTXO) {
-        if(!IsDenominated(outpoint)) continue;
-
-        nTotal += GetCappedOutpointPrivateSendRounds(outpoint);
-        nCount++;
-    }
-
-    if(nCount == 0) return 0;
-
-    return (float)nTotal/nCount;
+    return GetCachedBalances().nAverageAnonymizedRounds;
 }
 
-// Note: calculated including unconfirmed,
-// that's ok as long as we use it for informational purposes only
 CAmount CWallet::GetNormalizedAnonymizedBalance() const
 {
     if(fLiteMode) return 0;
 
-    CAmount nTotal = 0;
-
     LOCK2(cs_main, cs_wallet);
-    for (const auto& outpoint : setWalletUTXO) {
-        const auto it = mapWallet.find(outpoint.hash);
-        if (it == mapWallet.end()) continue;
-
-        CAmount nValue = it->second.tx->vout[outpoint.n].nValue;
-        if (!CPrivateSend::IsDenominatedAmount(nValue)) continue;
-        if (it->second.GetDepthInMainChain() < 0) continue;
-
-        int nRounds = GetCappedOutpointPrivateSendRounds(outpoint);
-        nTotal += nValue * nRounds / privateSendClient.nPrivateSendRounds;
-    }
-
-    return nTotal;
+    return GetCachedBalances().nNormalizedAnonymized;
 }
 
 CAmount CWallet::GetDenominatedBalance(bool unconfirmed) const
 {
     if(fLiteMode) return 0;
 
-    CAmount nTotal = 0;
-
     LOCK2(cs_main, cs_wallet);
-
-    std::set<uint256> setWalletTxesCounted;
-    for (const auto& outpoint : setWalletUTXO) {
-        if (!setWalletTxesCounted.emplace(outpoint.hash).second) continue;
-
-        const auto it = mapWallet.find(outpoint.hash);
-        if (it == mapWallet.end()) continue;
-
-        nTotal += it->second.GetDenominatedCredit(unconfirmed);
-    }
-
-    return nTotal;
+    const CachedBalances& balances = GetCachedBalances();
+    return unconfirmed ? balances.nDenominatedUnconfirmed : balances.nDenominatedConfirmed;
 }
 
 CAmount CWallet::GetUnconfirmedBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && !pcoin->IsLockedByInstantSend() && pcoin->InMempool())
-                nTotal += pcoin->GetAvailableCredit();
-        }
-    }
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalances().nUnconfirmed;
 }
 
 CAmount CWallet::GetImmatureBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            nTotal += pcoin->GetImmatureCredit();
-        }
-    }
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalances().nImmature;
 }
 
 CAmount CWallet::GetWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-                nTotal += pcoin->GetAvailableWatchOnlyCredit();
-        }
-    }
-
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalances().nWatchOnlyTrusted;
 }
 
 CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && !pcoin->IsLockedByInstantSend() && pcoin->InMempool())
-                nTotal += pcoin->GetAvailableWatchOnlyCredit();
-        }
-    }
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalances().nWatchOnlyUnconfirmed;
 }
 
 CAmount CWallet::GetImmatureWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            nTotal += pcoin->GetImmatureWatchOnlyCredit();
-        }
-    }
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalances().nWatchOnlyImmature;
 }
 
 void CWallet::AvailableCoins(std::vector<COutput>& vCoins, bool fOnlySafe, const CCoinControl *coinControl, bool fIncludeZeroValue, AvailableCoinsType nCoinType, bool fUseInstantSend) const
@@ -2501,34 +2826,36 @@ void CWallet::AvailableCoins(std::vector<COutput>& vCoins, bool fOnlySafe, const
         LOCK2(cs_main, cs_wallet);
         int nInstantSendConfirmationsRequired = Params().GetConsensus().nInstantSendConfirmationsRequired;
 
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
+        // pvecOutputs limits the outputs to check, all outputs of the tx are checked if it's null
+        auto addCoins = [&](std::map<uint256, CWalletTx>::const_iterator it, const std::vector<unsigned int>* pvecOutputs) {
             const uint256& wtxid = it->first;
             const CWalletTx* pcoin = &(*it).second;
 
             if (!CheckFinalTx(*pcoin))
-                continue;
+                return;
 
             if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
-                continue;
+                return;
 
             int nDepth = pcoin->GetDepthInMainChain();
             // do not use IX for inputs that have less then nInstantSendConfirmationsRequired blockchain confirmations
             if (fUseInstantSend && nDepth < nInstantSendConfirmationsRequired)
-                continue;
+                return;
 
             // We should not consider coins which aren't at least in our mempool
             // It's possible for these to be conflicted via ancestors which we may never be able to detect
             if (nDepth == 0 && !pcoin->InMempool())
-                continue;
+                return;
 
             bool safeTx = pcoin->IsTrusted();
 
             if (fOnlySafe && !safeTx) {
-                continue;
+                return;
             }
 
-            for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
+            size_t nOutputs = pvecOutputs ? pvecOutputs->size() : pcoin->tx->vout.size();
+            for (size_t j = 0; j < nOutputs; j++) {
+                unsigned int i = pvecOutputs ? (*pvecOutputs)[j] : j;
                 bool found = false;
                 if(nCoinType == ONLY_DENOMINATED) {
                     found = CPrivateSend::IsDenominatedAmount(pcoin->tx->vout[i].nValue);
@@ -2556,6 +2883,22 @@ void CWallet::AvailableCoins(std::vector<COutput>& vCoins, bool fOnlySafe, const
                                                   (coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
                                                  (mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO, safeTx));
             }
+        };
+
+        // PrivateSend and masternode coin types only need the outputs with a few specific amounts, which are
+        // looked up in the UTXO index instead of checking every wallet transaction
+        std::map<uint256, std::vector<unsigned int> > mapIndexedOutputs;
+        if (GetWalletUTXOsByCoinType(nCoinType, mapIndexedOutputs)) {
+            for (const auto& p : mapIndexedOutputs) {
+                auto it = mapWallet.find(p.first);
+                if (it != mapWallet.end()) {
+                    addCoins(it, &p.second);
+                }
+            }
+        } else {
+            for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
+                addCoins(it, nullptr);
+            }
         }
     }
 }
@@ -3223,10 +3566,14 @@ int CWallet::CountInputsWithAmount(CAmount nInputAmount) const
 
     LOCK2(cs_main, cs_wallet);
 
-    for (const auto& outpoint : setWalletUTXO) {
+    const auto itBucket = mapWalletUTXOByAmount.find(nInputAmount);
+    if (itBucket == mapWalletUTXOByAmount.end()) {
+        return 0;
+    }
+
+    for (const auto& outpoint : itBucket->second) {
         const auto it = mapWallet.find(outpoint.hash);
         if (it == mapWallet.end()) continue;
-        if (it->second.tx->vout[outpoint.n].nValue != nInputAmount) continue;
         if (it->second.GetDepthInMainChain() < 0) continue;
 
         nTotal++;
@@ -3710,13 +4057,15 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend, CWalletT
         if (sign)
         {
             CTransaction txNewConst(txNew);
+            // the scriptSigs are blanked in the signature hashes, so the precomputed data stays valid while signing
+            PrecomputedTransactionData txdata(txNewConst);
             int nIn = 0;
             for(const auto& txdsin : vecTxDSInTmp)
             {
                 const CScript& scriptPubKey = txdsin.prevPubKey;
                 CScript& scriptSigRes = txNew.vin[nIn].scriptSig;
 
-                if (!ProduceSignature(TransactionSignatureCreator(this, &txNewConst, nIn, SIGHASH_ALL), scriptPubKey, scriptSigRes))
+                if (!ProduceSignature(TransactionSignatureCreator(this, &txNewConst, nIn, SIGHASH_ALL, &txdata), scriptPubKey, scriptSigRes))
                 {
                     strFailReason = _("Signing transaction failed");
                     return false;
@@ -3757,6 +4106,9 @@ bool CWallet::CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey, CCon
         LOCK2(cs_main, cs_wallet);
         LogPrintf("CommitTransaction:\n%s", wtxNew.tx->ToString());
         {
+            // the key pool and the wallet txes are updated in one go
+            CWalletBatch walletdb(*this);
+
             // Take key pair from key pool so it won't be used again
             reservekey.KeepKey();
 
@@ -3875,7 +4227,7 @@ DBErrors CWallet::LoadWallet(bool& fFirstRunRet)
         for (auto& pair : mapWallet) {
             for(unsigned int i = 0; i < pair.second.tx->vout.size(); ++i) {
                 if (IsMine(pair.second.tx->vout[i]) && !IsSpent(pair.first, i)) {
-                    setWalletUTXO.insert(COutPoint(pair.first, i));
+                    AddWalletUTXO(COutPoint(pair.first, i), pair.second.tx->vout[i].nValue);
                 }
             }
         }
@@ -3915,8 +4267,16 @@ DBErrors CWallet::ZapSelectTx(std::vector<uint256>& vHashIn, std::vector<uint256
     AssertLockHeld(cs_wallet); // mapWallet
     vchDefaultKey = CPubKey();
     DBErrors nZapSelectTxRet = CWalletDB(strWalletFile,"cr+").ZapSelectTx(vHashIn, vHashOut);
-    for (uint256 hash : vHashOut)
+    for (uint256 hash : vHashOut) {
+        InvalidatePrivateSendRounds(hash);
+        auto it = mapWallet.find(hash);
+        if (it != mapWallet.end()) {
+            for (unsigned int i = 0; i < it->second.tx->vout.size(); i++) {
+                EraseWalletUTXO(COutPoint(hash, i));
+            }
+        }
         mapWallet.erase(hash);
+    }
 
     if (nZapSelectTxRet == DB_NEED_REWRITE)
     {
@@ -4092,7 +4452,16 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
             nTargetSize *= 2;
         }
         bool fInternal = false;
-        CWalletDB walletdb(strWalletFile);
+        // the new keys, their metadata and the HD chain are written along with the pool entries
+        CWalletBatch walletdb(*this);
+        // HD keys are derived for the whole top up at once, the others are generated one by one
+        std::vector<CPubKey> vecExternalKeys;
+        std::vector<CPubKey> vecInternalKeys;
+        if (IsHDEnabled()) {
+            CKeyMetadata metadata(GetTime());
+            DeriveNewChildKeys(metadata, 0, false, missingExternal, vecExternalKeys);
+            DeriveNewChildKeys(metadata, 0, true, missingInternal, vecInternalKeys);
+        }
         for (int64_t i = missingInternal + missingExternal; i--;)
         {
             int64_t nEnd = 1;
@@ -4105,8 +4474,16 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
             if (!setExternalKeyPool.empty()) {
                 nEnd = std::max(nEnd, *(--setExternalKeyPool.end()) + 1);
             }
-            // TODO: implement keypools for all accounts?
-            if (!walletdb.WritePool(nEnd, CKeyPool(GenerateNewKey(0, fInternal), fInternal)))
+            CPubKey pubkey;
+            if (!IsHDEnabled()) {
+                // TODO: implement keypools for all accounts?
+                pubkey = GenerateNewKey(0, fInternal);
+            } else if (fInternal) {
+                pubkey = vecInternalKeys[missingInternal - 1 - i];
+            } else {
+                pubkey = vecExternalKeys[missingInternal + missingExternal - 1 - i];
+            }
+            if (!walletdb->WritePool(nEnd, CKeyPool(pubkey, fInternal)))
                 throw std::runtime_error(std::string(__func__) + ": writing generated key failed");
 
             if (fInternal) {
@@ -4165,8 +4542,9 @@ void CWallet::KeepKey(int64_t nIndex)
     // Remove from key pool
     if (fFileBacked)
     {
-        CWalletDB walletdb(strWalletFile);
-        if (walletdb.ErasePool(nIndex))
+        LOCK(cs_wallet);
+        CWalletBatch walletdb(*this);
+        if (walletdb->ErasePool(nIndex))
             --nKeysLeftSinceAutoBackup;
         if (!nWalletBackups)
             nKeysLeftSinceAutoBackup = 0;
@@ -4174,6 +4552,26 @@ void CWallet::KeepKey(int64_t nIndex)
     LogPrintf("keypool keep %d\n", nIndex);
 }
 
+CWalletBatch::CWalletBatch(CWallet& walletIn, bool fFlushOnClose) :
+    wallet(walletIn)
+{
+    AssertLockHeld(wallet.cs_wallet);
+    fOwner = wallet.pwalletdbBatch == NULL;
+    if (fOwner) {
+        wallet.pwalletdbBatch = new CWalletDB(wallet.strWalletFile, "r+", fFlushOnClose);
+    }
+    pwalletdb = wallet.pwalletdbBatch;
+}
+
+CWalletBatch::~CWalletBatch()
+{
+    if (fOwner) {
+        // closing the database flushes it
+        wallet.pwalletdbBatch = NULL;
+        delete pwalletdb;
+    }
+}
+
 void CWallet::ReturnKey(int64_t nIndex, bool fInternal)
 {
     // Return to key pool
@@ -4535,6 +4933,7 @@ void CWallet::UnlockAllCoins()
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.clear();
+    MarkBalancesDirty();
 }
 
 bool CWallet::IsLockedCoin(uint256 hash, unsigned int n) const
@@ -4777,6 +5176,7 @@ std::string CWallet::GetWalletHelpString(bool showDebug)
     strUsage += HelpMessageOpt("-paytxfee=<amt>", strprintf(_("Fee (in %s/kB) to add to transactions you send (default: %s)"),
                                                             CURRENCY_UNIT, FormatMoney(payTxFee.GetFeePerK())));
     strUsage += HelpMessageOpt("-rescan", _("Rescan the block chain for missing wallet transactions on startup"));
+    strUsage += HelpMessageOpt("-rescanthreads=<n>", strprintf(_("Number of threads reading and filtering blocks ahead during wallet rescans, 0 reads them on the rescanning thread (default: %u)"), DEFAULT_RESCAN_THREADS));
     strUsage += HelpMessageOpt("-salvagewallet", _("Attempt to recover private keys from a corrupt wallet on startup"));
     strUsage += HelpMessageOpt("-spendzeroconfchange", strprintf(_("Spend unconfirmed change when sending transactions (default: %u)"), DEFAULT_SPEND_ZEROCONF_CHANGE));
     strUsage += HelpMessageOpt("-txconfirmtarget=<n>", strprintf(_("If paytxfee is not set, include enough fee so transactions begin confirmation on average within n blocks (default: %u)"), DEFAULT_TX_CONFIRM_TARGET));
@@ -5051,7 +5451,7 @@ void CWallet::postInitProcess(CScheduler& scheduler)
 
     // Run a thread to flush wallet periodically
     if (!CWallet::fFlushScheduled.exchange(true)) {
-        scheduler.scheduleEvery(MaybeCompactWalletDB, 500);
+        scheduler.scheduleEvery(MaybeCompactWalletDB, 500, CScheduler::PRIORITY_LOW, "compactwallet");
     }
 }
 
@@ -5340,12 +5740,15 @@ void CWallet::NotifyTransactionLock(const CTransaction &tx)
     // Only notify UI if this transaction is in this wallet
     std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(tx.GetHash());
     if (mi != mapWallet.end()){
+        // the lock makes the tx and its unconfirmed children trusted
+        MarkBalancesDirty();
         NotifyISLockReceived();
     }
 }
 
 void CWallet::NotifyChainLock(const CBlockIndex* pindexChainLock)
 {
+    MarkBalancesDirty();
     NotifyChainLockReceived(pindexChainLock->nHeight);
 }
 
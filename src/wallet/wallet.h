@@ -65,6 +65,10 @@ static const bool DEFAULT_WALLET_REJECT_LONG_CHAINS = false;
 //! -txconfirmtarget default
 static const unsigned int DEFAULT_TX_CONFIRM_TARGET = 6;
 static const bool DEFAULT_WALLETBROADCAST = true;
+//! -rescanthreads default
+static const int DEFAULT_RESCAN_THREADS = 4;
+//! Number of blocks read ahead of a rescan
+static const int RESCAN_PREFETCH_BLOCKS = 64;
 static const bool DEFAULT_DISABLE_WALLET = false;
 
 extern const char * DEFAULT_WALLET_DAT;
@@ -459,22 +463,8 @@ public:
         mapValue.erase("timesmart");
     }
 
-    //! make sure balances are recalculated
-    void MarkDirty()
-    {
-        fCreditCached = false;
-        fAvailableCreditCached = false;
-        fImmatureCreditCached = false;
-        fAnonymizedCreditCached = false;
-        fDenomUnconfCreditCached = false;
-        fDenomConfCreditCached = false;
-        fWatchDebitCached = false;
-        fWatchCreditCached = false;
-        fAvailableWatchCreditCached = false;
-        fImmatureWatchCreditCached = false;
-        fDebitCached = false;
-        fChangeCached = false;
-    }
+    //! make sure balances are recalculated, including the balances cached by the wallet
+    void MarkDirty();
 
     void BindWallet(CWallet *pwalletIn)
     {
@@ -683,6 +673,9 @@ private:
     bool SelectCoins(const std::vector<COutput>& vAvailableCoins, const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, const CCoinControl *coinControl = NULL, AvailableCoinsType nCoinType=ALL_COINS, bool fUseInstantSend = true) const;
 
     CWalletDB *pwalletdbEncryption;
+    //! the database of the outermost active CWalletBatch
+    CWalletDB *pwalletdbBatch;
+    friend class CWalletBatch;
 
     //! the current wallet version: clients below this version are not able to load the wallet
     int nWalletVersion;
@@ -699,6 +692,37 @@ private:
     mutable bool fAnonymizableTallyCachedNonDenom;
     mutable std::vector<CompactTallyItem> vecAnonymizableTallyCachedNonDenom;
 
+    /**
+     * Wallet balances, all computed in one pass over the wallet and reused until the wallet, the chain tip
+     * or the PrivateSend rounds target change. Guarded by cs_main and cs_wallet.
+     */
+    struct CachedBalances
+    {
+        bool fValid{false};
+        uint64_t nBalanceChanges{0};
+        uint256 tipHash;
+        int nPrivateSendRounds{0};
+
+        CAmount nTrusted{0};
+        CAmount nUnconfirmed{0};
+        CAmount nImmature{0};
+        CAmount nWatchOnlyTrusted{0};
+        CAmount nWatchOnlyUnconfirmed{0};
+        CAmount nWatchOnlyImmature{0};
+
+        CAmount nAnonymized{0};
+        CAmount nNormalizedAnonymized{0};
+        float nAverageAnonymizedRounds{0};
+        CAmount nDenominatedConfirmed{0};
+        CAmount nDenominatedUnconfirmed{0};
+        // (fSkipDenominated, fSkipUnconfirmed) -> anonymizable balance, filled on demand
+        std::map<std::pair<bool, bool>, CAmount> mapAnonymizable;
+    };
+    mutable CachedBalances cachedBalances;
+    // incremented whenever a wallet tx is marked dirty, coins get (un)locked or a wallet tx gets locked
+    mutable std::atomic<uint64_t> nBalanceChanges{0};
+    const CachedBalances& GetCachedBalances() const;
+
     /**
      * Used to keep track of spent outpoints, and
      * detect and report conflicts (double-spends or
@@ -711,13 +735,33 @@ private:
 
     std::set<COutPoint> setWalletUTXO;
 
+    // incremented whenever keys, scripts or watch-only scripts are added, rescans use it to detect a stale key snapshot
+    std::atomic<uint64_t> nKeyStoreChanges{0};
+
+    /**
+     * PrivateSend chain depth of wallet outpoints, persisted in the wallet. It only depends on the wallet txes
+     * and not on their confirmation, so entries are only invalidated when a tx is added after txes spending it
+     * or when a tx is zapped.
+     */
+    mutable std::map<COutPoint, int> mapOutpointRoundsCache;
+    void InvalidatePrivateSendRounds(const uint256& hashTx);
+    // setWalletUTXO bucketed by output amount, used to find denominated, collateral and masternode outputs
+    std::map<CAmount, std::set<COutPoint> > mapWalletUTXOByAmount;
+    void AddWalletUTXO(const COutPoint& outpoint, CAmount nValue);
+    void EraseWalletUTXO(const COutPoint& outpoint);
+    /**
+     * Get the outputs of setWalletUTXO with amounts matching nCoinType, grouped by tx. Returns false if the
+     * coin type is not limited to a few amounts and all wallet transactions have to be checked instead.
+     */
+    bool GetWalletUTXOsByCoinType(AvailableCoinsType nCoinType, std::map<uint256, std::vector<unsigned int> >& mapRet) const;
+
     /* Mark a transaction (and its in-wallet descendants) as conflicting with a particular block. */
     void MarkConflicted(const uint256& hashBlock, const uint256& hashTx);
 
     void SyncMetaData(std::pair<TxSpends::iterator, TxSpends::iterator>);
 
-    /* HD derive new child key (on internal or external chain) */
-    void DeriveNewChildKey(const CKeyMetadata& metadata, CKey& secretRet, uint32_t nAccountIndex, bool fInternal /*= false*/);
+    /* HD derive nCount new child keys (on internal or external chain), the chain key is only derived once */
+    void DeriveNewChildKeys(const CKeyMetadata& metadata, uint32_t nAccountIndex, bool fInternal, size_t nCount, std::vector<CPubKey>& vecPubKeysRet);
 
     bool fFileBacked;
 
@@ -799,6 +843,7 @@ public:
         fFileBacked = false;
         nMasterKeyMaxID = 0;
         pwalletdbEncryption = NULL;
+        pwalletdbBatch = NULL;
         nOrderPosNext = 0;
         nNextResend = 0;
         nLastResend = 0;
@@ -864,7 +909,9 @@ public:
     int  CountInputsWithAmount(CAmount nInputAmount) const;
 
     // get the PrivateSend chain depth for a given input
-    int GetRealOutpointPrivateSendRounds(const COutPoint& outpoint, int nRounds = 0) const;
+    int GetRealOutpointPrivateSendRounds(const COutPoint& outpoint) const;
+    //! Adds a calculated PrivateSend chain depth to the cache, used by LoadWallet
+    bool LoadPrivateSendRounds(const COutPoint& outpoint, int nRounds);
     // respect current settings
     int GetCappedOutpointPrivateSendRounds(const COutPoint& outpoint) const;
 
@@ -947,6 +994,8 @@ public:
     bool GetAccountPubkey(CPubKey &pubKey, std::string strAccount, bool bForceNew = false);
 
     void MarkDirty();
+    //! invalidate the cached wallet balances, the per tx credits are invalidated by CWalletTx::MarkDirty
+    void MarkBalancesDirty() const { nBalanceChanges++; }
     bool AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose=true);
     bool LoadToWallet(const CWalletTx& wtxIn);
     void SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock) override;
@@ -1208,6 +1257,29 @@ public:
     void KeepScript() override { KeepKey(); }
 };
 
+/**
+ * Shares one CWalletDB between the database writes of one logical operation, e.g. topping up the keypool or
+ * committing a tx, so the database is opened once and flushed once at the end of the operation instead of
+ * after every write. Batches can be nested, inner ones write through the outermost one. cs_wallet must be held.
+ */
+class CWalletBatch
+{
+private:
+    CWallet& wallet;
+    CWalletDB* pwalletdb;
+    bool fOwner;
+
+public:
+    explicit CWalletBatch(CWallet& walletIn, bool fFlushOnClose = true);
+    ~CWalletBatch();
+
+    CWalletBatch(const CWalletBatch&) = delete;
+    CWalletBatch& operator=(const CWalletBatch&) = delete;
+
+    CWalletDB& operator*() { return *pwalletdb; }
+    CWalletDB* operator->() { return pwalletdb; }
+};
+
 
 /** 
  * Account information.
@@ -24,6 +24,7 @@ class CAccountingEntry;
 struct CBlockLocator;
 class CKeyPool;
 class CMasterKey;
+class COutPoint;
 class CScript;
 class CWallet;
 class CWalletTx;
@@ -124,6 +125,11 @@ public:
     /// Erase destination data tuple from wallet database
     bool EraseDestData(const std::string &address, const std::string &key);
 
+    /// Write the calculated PrivateSend chain depth of an outpoint
+    bool WritePrivateSendRounds(const COutPoint& outpoint, int nRounds);
+    /// Erase the PrivateSend chain depth of an outpoint
+    bool ErasePrivateSendRounds(const COutPoint& outpoint);
+
     CAmount GetAccountCreditDebit(const std::string& strAccount);
     void ListAccountCreditDebit(const std::string& strAccount, std::list<CAccountingEntry>& acentries);
 
@@ -0,0 +1,182 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "workerpool.h"
+
+#include "tinyformat.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <assert.h>
+
+CWorkerPool g_workerPool;
+
+// set on the threads of a pool so that jobs pushed from a job go to the queue of the worker running it
+static thread_local const CWorkerPool* currentPool = nullptr;
+static thread_local int currentWorkerIdx = -1;
+
+CWorkerPool::CWorkerPool()
+{
+    for (int i = 0; i < PRIORITY_COUNT; i++) {
+        vQueued[i] = 0;
+        vCompleted[i] = 0;
+    }
+}
+
+CWorkerPool::~CWorkerPool()
+{
+    Stop();
+}
+
+void CWorkerPool::Start(int _nThreads, const std::string& threadName)
+{
+    assert(threads.empty());
+
+    {
+        std::unique_lock<std::mutex> l(csWait);
+        fStopping = false;
+    }
+    nStartTime = GetTimeMicros();
+    nBusyMicros = 0;
+
+    for (int i = 0; i < _nThreads; i++) {
+        workerQueues.emplace_back(new Queue());
+    }
+    for (int i = 0; i < _nThreads; i++) {
+        threads.emplace_back(&CWorkerPool::ThreadMain, this, i, strprintf("%s-%d", threadName, i));
+    }
+    nThreads = _nThreads;
+}
+
+void CWorkerPool::Stop()
+{
+    {
+        std::unique_lock<std::mutex> l(csWait);
+        fStopping = true;
+    }
+    cvWait.notify_all();
+    for (auto& t : threads) {
+        t.join();
+    }
+    threads.clear();
+    nThreads = 0;
+
+    // destroying the jobs breaks the promises of their futures
+    workerQueues.clear();
+    {
+        std::unique_lock<std::mutex> l(sharedQueue.cs);
+        for (auto& jobs : sharedQueue.jobs) {
+            jobs.clear();
+        }
+    }
+    {
+        std::unique_lock<std::mutex> l(csWait);
+        nPending = 0;
+    }
+    for (int i = 0; i < PRIORITY_COUNT; i++) {
+        vQueued[i] = 0;
+    }
+}
+
+CWorkerPool::Stats CWorkerPool::GetStats() const
+{
+    Stats stats;
+    stats.nThreads = nThreads;
+    stats.nBusyThreads = nBusyThreads;
+    stats.nUptimeMicros = stats.nThreads ? GetTimeMicros() - nStartTime : 0;
+    stats.nBusyMicros = nBusyMicros;
+    stats.nStolen = nStolen;
+    for (int i = 0; i < PRIORITY_COUNT; i++) {
+        stats.vQueued[i] = vQueued[i];
+        stats.vCompleted[i] = vCompleted[i];
+    }
+    return stats;
+}
+
+void CWorkerPool::PushJob(Job&& job, Priority priority)
+{
+    Queue& queue = currentPool == this ? *workerQueues[currentWorkerIdx] : sharedQueue;
+    {
+        std::unique_lock<std::mutex> l(queue.cs);
+        queue.jobs[priority].emplace_back(std::move(job));
+    }
+    vQueued[priority]++;
+    {
+        std::unique_lock<std::mutex> l(csWait);
+        nPending++;
+    }
+    cvWait.notify_one();
+}
+
+bool CWorkerPool::PopFromQueue(Queue& queue, int priority, bool fNewest, Job& jobRet)
+{
+    std::unique_lock<std::mutex> l(queue.cs);
+    auto& jobs = queue.jobs[priority];
+    if (jobs.empty()) {
+        return false;
+    }
+    if (fNewest) {
+        jobRet = std::move(jobs.back());
+        jobs.pop_back();
+    } else {
+        jobRet = std::move(jobs.front());
+        jobs.pop_front();
+    }
+    return true;
+}
+
+bool CWorkerPool::PopJob(int workerIdx, Job& jobRet, int& priorityRet)
+{
+    size_t nWorkers = workerQueues.size();
+    for (int priority = 0; priority < PRIORITY_COUNT; priority++) {
+        bool fFound = PopFromQueue(*workerQueues[workerIdx], priority, true, jobRet) ||
+                      PopFromQueue(sharedQueue, priority, false, jobRet);
+        for (size_t i = 1; !fFound && i < nWorkers; i++) {
+            if (PopFromQueue(*workerQueues[(workerIdx + i) % nWorkers], priority, false, jobRet)) {
+                nStolen++;
+                fFound = true;
+            }
+        }
+        if (fFound) {
+            priorityRet = priority;
+            vQueued[priority]--;
+            std::unique_lock<std::mutex> l(csWait);
+            nPending--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void CWorkerPool::ThreadMain(int workerIdx, const std::string& threadName)
+{
+    RenameThread(threadName.c_str());
+    currentPool = this;
+    currentWorkerIdx = workerIdx;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> l(csWait);
+            cvWait.wait(l, [&] { return fStopping || nPending > 0; });
+            if (fStopping) {
+                return;
+            }
+        }
+
+        Job job;
+        int priority;
+        if (!PopJob(workerIdx, job, priority)) {
+            // another worker took the job between the wakeup and the pop
+            std::this_thread::yield();
+            continue;
+        }
+
+        nBusyThreads++;
+        int64_t nStart = GetTimeMicros();
+        job(workerIdx);
+        nBusyMicros += GetTimeMicros() - nStart;
+        nBusyThreads--;
+        vCompleted[priority]++;
+    }
+}
@@ -0,0 +1,115 @@
+// Copyright (c) 2019 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef HTA_WORKERPOOL_H
+#define HTA_WORKERPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const int DEFAULT_WORKER_THREADS = 0;
+static const int MAX_WORKER_THREADS = 64;
+
+/**
+ * Work stealing thread pool for the CPU bound background jobs of the node, e.g. BLS operations, LLMQ signature
+ * verification and governance vote checks. These used to run on a separate set of threads per subsystem, which
+ * oversubscribed the cores and didn't let the idle threads of one subsystem help another one.
+ *
+ * Jobs pushed from a worker go to the worker's own queue, jobs pushed from other threads go to a shared queue.
+ * A worker runs the newest job of its own queue first, then the oldest one of the shared queue, and otherwise
+ * steals the oldest job of another worker. Jobs of a higher priority are always taken before jobs of a lower one.
+ *
+ * Jobs must not wait for the results of other jobs of the pool, all workers could end up waiting. Jobs which didn't
+ * run yet are dropped when the pool is stopped, their futures then report a broken promise.
+ */
+class CWorkerPool
+{
+public:
+    enum Priority {
+        /** Latency sensitive jobs, e.g. verification of LLMQ signature shares and islocks */
+        PRIORITY_HIGH = 0,
+        PRIORITY_NORMAL = 1,
+        /** Jobs which only save work later on, e.g. precaching of ProTx signatures during reindex */
+        PRIORITY_LOW = 2,
+    };
+    static const int PRIORITY_COUNT = 3;
+
+    struct Stats {
+        int nThreads{0};
+        int nBusyThreads{0};
+        int64_t nUptimeMicros{0};
+        /** Time spent in jobs, summed up over all workers */
+        int64_t nBusyMicros{0};
+        uint64_t nStolen{0};
+        int64_t vQueued[PRIORITY_COUNT]{};
+        uint64_t vCompleted[PRIORITY_COUNT]{};
+    };
+
+private:
+    typedef std::function<void(int)> Job;
+
+    struct Queue {
+        std::mutex cs;
+        std::deque<Job> jobs[PRIORITY_COUNT];
+    };
+
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<Queue>> workerQueues;
+    Queue sharedQueue;
+
+    std::mutex csWait;
+    std::condition_variable cvWait;
+    int64_t nPending{0};
+    bool fStopping{false};
+
+    std::atomic<int> nThreads{0};
+    std::atomic<int> nBusyThreads{0};
+    std::atomic<int64_t> nStartTime{0};
+    std::atomic<int64_t> nBusyMicros{0};
+    std::atomic<uint64_t> nStolen{0};
+    std::atomic<int64_t> vQueued[PRIORITY_COUNT];
+    std::atomic<uint64_t> vCompleted[PRIORITY_COUNT];
+
+public:
+    CWorkerPool();
+    ~CWorkerPool();
+
+    /** Not thread safe, must not be called while the pool is running */
+    void Start(int nThreads, const std::string& threadName);
+    /** Waits for the running jobs and drops the queued ones */
+    void Stop();
+
+    /** Number of workers, 0 while the pool is not running */
+    int Size() const { return nThreads; }
+    Stats GetStats() const;
+
+    /** Queue f, which is called with the index of the worker that runs it */
+    template<typename F>
+    auto Push(F&& f, Priority priority = PRIORITY_NORMAL) -> std::future<decltype(f(0))>
+    {
+        auto task = std::make_shared<std::packaged_task<decltype(f(0))(int)>>(std::forward<F>(f));
+        auto ret = task->get_future();
+        PushJob([task](int workerIdx) { (*task)(workerIdx); }, priority);
+        return ret;
+    }
+
+private:
+    void PushJob(Job&& job, Priority priority);
+    bool PopJob(int workerIdx, Job& jobRet, int& priorityRet);
+    bool PopFromQueue(Queue& queue, int priority, bool fNewest, Job& jobRet);
+    void ThreadMain(int workerIdx, const std::string& threadName);
+};
+
+/** Pool shared by the subsystems of the node, started in AppInitMain */
+extern CWorkerPool g_workerPool;
+
+#endif // HTA_WORKERPOOL_H
@@ -45,3 +45,13 @@ bool CZMQAbstractNotifier::NotifyInstantSendDoubleSpendAttempt(const CTransactio
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyMasternodeListChanged(bool /*undo*/, const CDeterministicMNList& /*oldMNList*/, const CDeterministicMNListDiff& /*diff*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyIPFSPinEvent(const CIPFSPinEvent& /*event*/)
+{
+    return true;
+}
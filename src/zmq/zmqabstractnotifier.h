@@ -10,10 +10,16 @@
 class CBlockIndex;
 class CGovernanceObject;
 class CGovernanceVote;
+class CDeterministicMNList;
+class CDeterministicMNListDiff;
+struct CIPFSPinEvent;
 class CZMQAbstractNotifier;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
+/** Default ZMQ_SNDHWM of the sockets, also the default limit of messages waiting for the publisher thread */
+static const int DEFAULT_ZMQ_SNDHWM = 1000;
+
 class CZMQAbstractNotifier
 {
 public:
@@ -30,6 +36,14 @@ public:
     void SetType(const std::string &t) { type = t; }
     std::string GetAddress() const { return address; }
     void SetAddress(const std::string &a) { address = a; }
+    int GetOutboundMessageHighWaterMark() const { return outbound_message_high_water_mark; }
+    void SetOutboundMessageHighWaterMark(const int sndhwm) {
+        if (sndhwm >= 0) {
+            outbound_message_high_water_mark = sndhwm;
+        }
+    }
+    bool GetDropOldest() const { return fDropOldest; }
+    void SetDropOldest(bool f) { fDropOldest = f; }
 
     virtual bool Initialize(void *pcontext) = 0;
     virtual void Shutdown() = 0;
@@ -41,12 +55,16 @@ public:
     virtual bool NotifyGovernanceVote(const CGovernanceVote &vote);
     virtual bool NotifyGovernanceObject(const CGovernanceObject &object);
     virtual bool NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx);
+    virtual bool NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff);
+    virtual bool NotifyIPFSPinEvent(const CIPFSPinEvent& event);
 
 
 protected:
     void *psocket;
     std::string type;
     std::string address;
+    int outbound_message_high_water_mark{DEFAULT_ZMQ_SNDHWM}; // aka SNDHWM, 0 means unlimited
+    bool fDropOldest{false}; // which message to drop when the high water mark is reached
 };
 
 #endif // BITCOIN_ZMQ_ZMQABSTRACTNOTIFIER_H
@@ -49,6 +49,10 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     factories["pubrawgovernancevote"] = CZMQAbstractNotifier::Create<CZMQPublishRawGovernanceVoteNotifier>;
     factories["pubrawgovernanceobject"] = CZMQAbstractNotifier::Create<CZMQPublishRawGovernanceObjectNotifier>;
     factories["pubrawinstantsenddoublespend"] = CZMQAbstractNotifier::Create<CZMQPublishRawInstantSendDoubleSpendNotifier>;
+    factories["pubrawmnlistdiff"] = CZMQAbstractNotifier::Create<CZMQPublishRawMNListDiffNotifier>;
+    factories["pubrawipfspin"] = CZMQAbstractNotifier::Create<CZMQPublishRawIPFSPinNotifier>;
+    factories["pubrawipfsunpin"] = CZMQAbstractNotifier::Create<CZMQPublishRawIPFSUnpinNotifier>;
+    factories["pubrawipfspinfailure"] = CZMQAbstractNotifier::Create<CZMQPublishRawIPFSPinFailureNotifier>;
 
     for (std::map<std::string, CZMQNotifierFactory>::const_iterator i=factories.begin(); i!=factories.end(); ++i)
     {
@@ -60,6 +64,12 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
             CZMQAbstractNotifier *notifier = factory();
             notifier->SetType(i->first);
             notifier->SetAddress(address);
+            notifier->SetOutboundMessageHighWaterMark(static_cast<int>(GetArg(arg + "hwm", DEFAULT_ZMQ_SNDHWM)));
+            std::string strDropPolicy = GetArg(arg + "droppolicy", "newest");
+            if (strDropPolicy != "newest" && strDropPolicy != "oldest") {
+                LogPrintf("zmq: Unknown drop policy %s for %s, using newest\n", strDropPolicy, i->first);
+            }
+            notifier->SetDropOldest(strDropPolicy == "oldest");
             notifiers.push_back(notifier);
         }
     }
@@ -113,6 +123,8 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    CZMQAbstractPublishNotifier::StartPublisher();
+
     return true;
 }
 
@@ -122,6 +134,9 @@ void CZMQNotificationInterface::Shutdown()
     LogPrint("zmq", "zmq: Shutdown notification interface\n");
     if (pcontext)
     {
+        // sends the queued messages and closes the sockets of failed notifiers
+        CZMQAbstractPublishNotifier::StopPublisher();
+
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
         {
             CZMQAbstractNotifier *notifier = *i;
@@ -251,3 +266,29 @@ void CZMQNotificationInterface::NotifyInstantSendDoubleSpendAttempt(const CTrans
         }
     }
 }
+
+void CZMQNotificationInterface::NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff)
+{
+    for (auto it = notifiers.begin(); it != notifiers.end();) {
+        CZMQAbstractNotifier *notifier = *it;
+        if (notifier->NotifyMasternodeListChanged(undo, oldMNList, diff)) {
+            ++it;
+        } else {
+            notifier->Shutdown();
+            it = notifiers.erase(it);
+        }
+    }
+}
+
+void CZMQNotificationInterface::NotifyIPFSPinEvent(const CIPFSPinEvent& event)
+{
+    for (auto it = notifiers.begin(); it != notifiers.end();) {
+        CZMQAbstractNotifier *notifier = *it;
+        if (notifier->NotifyIPFSPinEvent(event)) {
+            ++it;
+        } else {
+            notifier->Shutdown();
+            it = notifiers.erase(it);
+        }
+    }
+}
@@ -3,13 +3,40 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chainparams.h"
+#include "ipfs-pinning.h"
 #include "streams.h"
 #include "zmqpublishnotifier.h"
 #include "validation.h"
 #include "util.h"
 
+#include "evo/deterministicmns.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
+struct CZMQPublishItem
+{
+    CZMQAbstractPublishNotifier* notifier;
+    const char* command;
+    std::vector<unsigned char> data;
+    // set for raw blocks, data is read by the publisher thread
+    bool fBlock{false};
+    CDiskBlockPos blockPos;
+    uint256 blockHash;
+    bool fShutdown{false};
+};
+
+static std::mutex csPublishQueue;
+static std::condition_variable cvPublishQueue;
+static std::deque<CZMQPublishItem> publishQueue;
+static bool fPublisherRunning = false;
+static bool fStopPublisher = false;
+static std::thread publisherThread;
+
 static const char *MSG_HASHBLOCK     = "hashblock";
 static const char *MSG_HASHCHAINLOCK = "hashchainlock";
 static const char *MSG_HASHTX        = "hashtx";
@@ -24,6 +51,10 @@ static const char *MSG_RAWTXLOCK     = "rawtxlock";
 static const char *MSG_RAWGVOTE      = "rawgovernancevote";
 static const char *MSG_RAWGOBJ       = "rawgovernanceobject";
 static const char *MSG_RAWISCON      = "rawinstantsenddoublespend";
+static const char *MSG_RAWMNLISTDIFF = "rawmnlistdiff";
+static const char *MSG_RAWIPFSPIN    = "rawipfspin";
+static const char *MSG_RAWIPFSUNPIN  = "rawipfsunpin";
+static const char *MSG_RAWIPFSFAIL   = "rawipfspinfailure";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -81,7 +112,17 @@ bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
             return false;
         }
 
-        int rc = zmq_bind(psocket, address.c_str());
+        LogPrint("zmq", "zmq: Outbound message high water mark for %s at %s is %d\n", type, address, outbound_message_high_water_mark);
+
+        int rc = zmq_setsockopt(psocket, ZMQ_SNDHWM, &outbound_message_high_water_mark, sizeof(outbound_message_high_water_mark));
+        if (rc != 0)
+        {
+            zmqError("Failed to set outbound message high water mark");
+            zmq_close(psocket);
+            return false;
+        }
+
+        rc = zmq_bind(psocket, address.c_str());
         if (rc!=0)
         {
             zmqError("Failed to bind address");
@@ -105,6 +146,24 @@ bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
 }
 
 void CZMQAbstractPublishNotifier::Shutdown()
+{
+    {
+        // the socket belongs to the publisher thread while it runs, close it after the queued messages
+        std::unique_lock<std::mutex> lock(csPublishQueue);
+        if (fPublisherRunning) {
+            CZMQPublishItem item;
+            item.notifier = this;
+            item.command = nullptr;
+            item.fShutdown = true;
+            publishQueue.emplace_back(std::move(item));
+            cvPublishQueue.notify_one();
+            return;
+        }
+    }
+    DoShutdown();
+}
+
+void CZMQAbstractPublishNotifier::DoShutdown()
 {
     assert(psocket);
 
@@ -151,6 +210,131 @@ bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* d
     return true;
 }
 
+void CZMQAbstractPublishNotifier::StartPublisher()
+{
+    std::unique_lock<std::mutex> lock(csPublishQueue);
+    if (fPublisherRunning) {
+        return;
+    }
+    fPublisherRunning = true;
+    fStopPublisher = false;
+    publisherThread = std::thread(&TraceThread<std::function<void()> >, "zmqpub", std::function<void()>(&CZMQAbstractPublishNotifier::ThreadPublisher));
+}
+
+void CZMQAbstractPublishNotifier::StopPublisher()
+{
+    {
+        std::unique_lock<std::mutex> lock(csPublishQueue);
+        if (!fPublisherRunning) {
+            return;
+        }
+        fStopPublisher = true;
+        cvPublishQueue.notify_one();
+    }
+    publisherThread.join();
+}
+
+void CZMQAbstractPublishNotifier::ThreadPublisher()
+{
+    std::unique_lock<std::mutex> lock(csPublishQueue);
+    while (true) {
+        cvPublishQueue.wait(lock, [] { return fStopPublisher || !publishQueue.empty(); });
+        if (publishQueue.empty()) {
+            // only stop after everything queued before was sent
+            break;
+        }
+        CZMQPublishItem item = std::move(publishQueue.front());
+        publishQueue.pop_front();
+        if (!item.fShutdown) {
+            item.notifier->nQueued--;
+        }
+
+        lock.unlock();
+        ProcessItem(item);
+        lock.lock();
+    }
+    fPublisherRunning = false;
+}
+
+void CZMQAbstractPublishNotifier::ProcessItem(CZMQPublishItem& item)
+{
+    CZMQAbstractPublishNotifier* notifier = item.notifier;
+    if (item.fShutdown) {
+        notifier->DoShutdown();
+        return;
+    }
+    if (notifier->fFailed) {
+        return;
+    }
+
+    if (item.fBlock) {
+        // blocks are stored with the network serialization, so the bytes from disk are published as they are
+        if (!ReadRawBlockFromDisk(item.data, item.blockPos)) {
+            LogPrint("zmq", "zmq: Can't read block %s from disk\n", item.blockHash.ToString());
+            return;
+        }
+    }
+
+    if (!notifier->SendMessage(item.command, item.data.data(), item.data.size())) {
+        // the notification interface shuts the notifier down on its next notification
+        notifier->fFailed = true;
+    }
+}
+
+bool CZMQAbstractPublishNotifier::PushItem(CZMQPublishItem&& item)
+{
+    if (fFailed) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(csPublishQueue);
+    if (!fPublisherRunning) {
+        // not started yet or already stopped
+        return true;
+    }
+    if (outbound_message_high_water_mark > 0 && nQueued >= (size_t)outbound_message_high_water_mark) {
+        if (!fDropOldest) {
+            LogPrint("zmq", "zmq: Queue for %s at %s is full, dropping new %s message\n", type, address, item.command);
+            return true;
+        }
+        for (auto it = publishQueue.begin(); it != publishQueue.end(); ++it) {
+            if (it->notifier == this && !it->fShutdown) {
+                LogPrint("zmq", "zmq: Queue for %s at %s is full, dropping oldest %s message\n", type, address, it->command);
+                publishQueue.erase(it);
+                nQueued--;
+                break;
+            }
+        }
+    }
+    publishQueue.emplace_back(std::move(item));
+    nQueued++;
+    cvPublishQueue.notify_one();
+    return true;
+}
+
+bool CZMQAbstractPublishNotifier::QueueMessage(const char *command, const void* data, size_t size)
+{
+    CZMQPublishItem item;
+    item.notifier = this;
+    item.command = command;
+    item.data.assign((const unsigned char*)data, (const unsigned char*)data + size);
+    return PushItem(std::move(item));
+}
+
+bool CZMQAbstractPublishNotifier::QueueRawBlock(const char *command, const CBlockIndex *pindex)
+{
+    CZMQPublishItem item;
+    item.notifier = this;
+    item.command = command;
+    item.fBlock = true;
+    item.blockHash = pindex->GetBlockHash();
+    {
+        LOCK(cs_main);
+        item.blockPos = pindex->GetBlockPos();
+    }
+    return PushItem(std::move(item));
+}
+
 bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     uint256 hash = pindex->GetBlockHash();
@@ -158,7 +342,7 @@ bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
         data[31 - i] = hash.begin()[i];
-    return SendMessage(MSG_HASHBLOCK, data, 32);
+    return QueueMessage(MSG_HASHBLOCK, data, 32);
 }
 
 bool CZMQPublishHashChainLockNotifier::NotifyChainLock(const CBlockIndex *pindex)
@@ -168,7 +352,7 @@ bool CZMQPublishHashChainLockNotifier::NotifyChainLock(const CBlockIndex *pindex
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
         data[31 - i] = hash.begin()[i];
-    return SendMessage(MSG_HASHCHAINLOCK, data, 32);
+    return QueueMessage(MSG_HASHCHAINLOCK, data, 32);
 }
 
 bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
@@ -178,7 +362,7 @@ bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &t
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
         data[31 - i] = hash.begin()[i];
-    return SendMessage(MSG_HASHTX, data, 32);
+    return QueueMessage(MSG_HASHTX, data, 32);
 }
 
 bool CZMQPublishHashTransactionLockNotifier::NotifyTransactionLock(const CTransaction &transaction)
@@ -188,7 +372,7 @@ bool CZMQPublishHashTransactionLockNotifier::NotifyTransactionLock(const CTransa
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
         data[31 - i] = hash.begin()[i];
-    return SendMessage(MSG_HASHTXLOCK, data, 32);
+    return QueueMessage(MSG_HASHTXLOCK, data, 32);
 }
 
 bool CZMQPublishHashGovernanceVoteNotifier::NotifyGovernanceVote(const CGovernanceVote &vote)
@@ -198,7 +382,7 @@ bool CZMQPublishHashGovernanceVoteNotifier::NotifyGovernanceVote(const CGovernan
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
         data[31 - i] = hash.begin()[i];
-    return SendMessage(MSG_HASHGVOTE, data, 32);
+    return QueueMessage(MSG_HASHGVOTE, data, 32);
 }
 
 bool CZMQPublishHashGovernanceObjectNotifier::NotifyGovernanceObject(const CGovernanceObject &object)
@@ -208,7 +392,7 @@ bool CZMQPublishHashGovernanceObjectNotifier::NotifyGovernanceObject(const CGove
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
         data[31 - i] = hash.begin()[i];
-    return SendMessage(MSG_HASHGOBJ, data, 32);
+    return QueueMessage(MSG_HASHGOBJ, data, 32);
 }
 
 bool CZMQPublishHashInstantSendDoubleSpendNotifier::NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx)
@@ -220,8 +404,8 @@ bool CZMQPublishHashInstantSendDoubleSpendNotifier::NotifyInstantSendDoubleSpend
         dataCurrentHash[31 - i] = currentHash.begin()[i];
         dataPreviousHash[31 - i] = previousHash.begin()[i];
     }
-    return SendMessage(MSG_HASHISCON, dataCurrentHash, 32)
-        && SendMessage(MSG_HASHISCON, dataPreviousHash, 32);
+    return QueueMessage(MSG_HASHISCON, dataCurrentHash, 32)
+        && QueueMessage(MSG_HASHISCON, dataPreviousHash, 32);
 }
 
 
@@ -229,42 +413,14 @@ bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     LogPrint("zmq", "zmq: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
-    const Consensus::Params& consensusParams = Params().GetConsensus();
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex, consensusParams))
-        {
-            zmqError("Can't read block from disk");
-            return false;
-        }
-
-        ss << block;
-    }
-
-    return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+    return QueueRawBlock(MSG_RAWBLOCK, pindex);
 }
 
 bool CZMQPublishRawChainLockNotifier::NotifyChainLock(const CBlockIndex *pindex)
 {
     LogPrint("zmq", "zmq: Publish rawchainlock %s\n", pindex->GetBlockHash().GetHex());
 
-    const Consensus::Params& consensusParams = Params().GetConsensus();
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex, consensusParams))
-        {
-            zmqError("Can't read block from disk");
-            return false;
-        }
-
-        ss << block;
-    }
-
-    return SendMessage(MSG_RAWCHAINLOCK, &(*ss.begin()), ss.size());
+    return QueueRawBlock(MSG_RAWCHAINLOCK, pindex);
 }
 
 bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
@@ -273,7 +429,7 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     LogPrint("zmq", "zmq: Publish rawtx %s\n", hash.GetHex());
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     ss << transaction;
-    return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
+    return QueueMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
 
 bool CZMQPublishRawTransactionLockNotifier::NotifyTransactionLock(const CTransaction &transaction)
@@ -282,7 +438,7 @@ bool CZMQPublishRawTransactionLockNotifier::NotifyTransactionLock(const CTransac
     LogPrint("zmq", "zmq: Publish rawtxlock %s\n", hash.GetHex());
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     ss << transaction;
-    return SendMessage(MSG_RAWTXLOCK, &(*ss.begin()), ss.size());
+    return QueueMessage(MSG_RAWTXLOCK, &(*ss.begin()), ss.size());
 }
 
 bool CZMQPublishRawGovernanceVoteNotifier::NotifyGovernanceVote(const CGovernanceVote &vote)
@@ -291,7 +447,7 @@ bool CZMQPublishRawGovernanceVoteNotifier::NotifyGovernanceVote(const CGovernanc
     LogPrint("gobject", "gobject: Publish rawgovernanceobject: hash = %s, vote = %d\n", nHash.ToString(), vote.ToString());
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     ss << vote;
-    return SendMessage(MSG_RAWGVOTE, &(*ss.begin()), ss.size());
+    return QueueMessage(MSG_RAWGVOTE, &(*ss.begin()), ss.size());
 }
 
 bool CZMQPublishRawGovernanceObjectNotifier::NotifyGovernanceObject(const CGovernanceObject &govobj)
@@ -300,7 +456,7 @@ bool CZMQPublishRawGovernanceObjectNotifier::NotifyGovernanceObject(const CGover
     LogPrint("gobject", "gobject: Publish rawgovernanceobject: hash = %s, type = %d\n", nHash.ToString(), govobj.GetObjectType());
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     ss << govobj;
-    return SendMessage(MSG_RAWGOBJ, &(*ss.begin()), ss.size());
+    return QueueMessage(MSG_RAWGOBJ, &(*ss.begin()), ss.size());
 }
 
 bool CZMQPublishRawInstantSendDoubleSpendNotifier::NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx)
@@ -309,6 +465,66 @@ bool CZMQPublishRawInstantSendDoubleSpendNotifier::NotifyInstantSendDoubleSpendA
     CDataStream ssCurrent(SER_NETWORK, PROTOCOL_VERSION), ssPrevious(SER_NETWORK, PROTOCOL_VERSION);
     ssCurrent << currentTx;
     ssPrevious << previousTx;
-    return SendMessage(MSG_RAWISCON, &(*ssCurrent.begin()), ssCurrent.size())
-        && SendMessage(MSG_RAWISCON, &(*ssPrevious.begin()), ssPrevious.size());
+    return QueueMessage(MSG_RAWISCON, &(*ssCurrent.begin()), ssCurrent.size())
+        && QueueMessage(MSG_RAWISCON, &(*ssPrevious.begin()), ssPrevious.size());
+}
+
+bool CZMQPublishRawMNListDiffNotifier::NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff)
+{
+    // internal ids mean nothing to subscribers, updated and removed MNs are identified by their proTxHash
+    std::vector<std::pair<uint256, CDeterministicMNStateDiff> > vecUpdated;
+    std::vector<uint256> vecRemoved;
+    for (const auto& p : diff.updatedMNs) {
+        auto dmn = oldMNList.GetMNByInternalId(p.first);
+        if (dmn) {
+            vecUpdated.emplace_back(dmn->proTxHash, p.second);
+        }
+    }
+    for (const auto& id : diff.removedMns) {
+        auto dmn = oldMNList.GetMNByInternalId(id);
+        if (dmn) {
+            vecRemoved.emplace_back(dmn->proTxHash);
+        }
+    }
+
+    int nHeight = oldMNList.GetHeight() + (undo ? -1 : 1);
+    LogPrint("zmq", "zmq: Publish rawmnlistdiff height=%d, undo=%d, added=%d, updated=%d, removed=%d\n",
+        nHeight, undo, diff.addedMNs.size(), vecUpdated.size(), vecRemoved.size());
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << undo << oldMNList.GetBlockHash() << nHeight << diff.addedMNs << vecUpdated << vecRemoved;
+    return QueueMessage(MSG_RAWMNLISTDIFF, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishRawIPFSPinNotifier::NotifyIPFSPinEvent(const CIPFSPinEvent& event)
+{
+    if (event.type != CIPFSPinEvent::PINNED) {
+        return true;
+    }
+    LogPrint("zmq", "zmq: Publish rawipfspin %s\n", event.strCID);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << event;
+    return QueueMessage(MSG_RAWIPFSPIN, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishRawIPFSUnpinNotifier::NotifyIPFSPinEvent(const CIPFSPinEvent& event)
+{
+    if (event.type != CIPFSPinEvent::UNPINNED) {
+        return true;
+    }
+    LogPrint("zmq", "zmq: Publish rawipfsunpin %s\n", event.strCID);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << event;
+    return QueueMessage(MSG_RAWIPFSUNPIN, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishRawIPFSPinFailureNotifier::NotifyIPFSPinEvent(const CIPFSPinEvent& event)
+{
+    if (event.type != CIPFSPinEvent::FAILED) {
+        return true;
+    }
+    LogPrint("zmq", "zmq: Publish rawipfspinfailure %s\n", event.strCID);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << event;
+    return QueueMessage(MSG_RAWIPFSFAIL, &(*ss.begin()), ss.size());
 }
@@ -7,14 +7,35 @@
 
 #include "zmqabstractnotifier.h"
 
+#include <atomic>
+
 class CBlockIndex;
 class CGovernanceVote;
 class CGovernanceObject;
+struct CZMQPublishItem;
 
+/**
+ * Messages are not sent from the validation interface callbacks, they are queued and sent by a single publisher
+ * thread, which also owns the sockets while it runs. Each notifier queues at most its high water mark of messages,
+ * further messages either replace the oldest queued one or are dropped, depending on the drop policy.
+ */
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 {
 private:
-    uint32_t nSequence; //!< upcounting per message sequence number
+    uint32_t nSequence{0}; //!< upcounting per message sequence number, only used by the publisher thread
+    size_t nQueued{0}; //!< messages waiting for the publisher thread, protected by the queue lock
+    std::atomic<bool> fFailed{false};
+
+    static void ThreadPublisher();
+    static void ProcessItem(CZMQPublishItem& item);
+    bool PushItem(CZMQPublishItem&& item);
+    void DoShutdown();
+
+protected:
+    /** Queue a message for the publisher thread, returns false if sending an earlier message failed */
+    bool QueueMessage(const char *command, const void* data, size_t size);
+    /** Queue a block, which is read from disk by the publisher thread */
+    bool QueueRawBlock(const char *command, const CBlockIndex *pindex);
 
 public:
 
@@ -28,6 +49,10 @@ public:
 
     bool Initialize(void *pcontext) override;
     void Shutdown() override;
+
+    static void StartPublisher();
+    /** Send all queued messages and stop the publisher thread */
+    static void StopPublisher();
 };
 
 class CZMQPublishHashBlockNotifier : public CZMQAbstractPublishNotifier
@@ -113,4 +138,28 @@ class CZMQPublishRawInstantSendDoubleSpendNotifier : public CZMQAbstractPublishN
 public:
     bool NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx) override;
 };
+
+class CZMQPublishRawMNListDiffNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff) override;
+};
+
+class CZMQPublishRawIPFSPinNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyIPFSPinEvent(const CIPFSPinEvent& event) override;
+};
+
+class CZMQPublishRawIPFSUnpinNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyIPFSPinEvent(const CIPFSPinEvent& event) override;
+};
+
+class CZMQPublishRawIPFSPinFailureNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyIPFSPinEvent(const CIPFSPinEvent& event) override;
+};
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H